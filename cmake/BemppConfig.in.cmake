@@ -14,6 +14,7 @@ set(BEMPP_DIRICHLET_TUTOTIAL tutorial_dirichlet)
 set(BEMPP_PYTHON_INCLUDE_DIRS @PYTHON_INCLUDE_DIRS@ @NUMPY_INCLUDE_DIRS@)
 set(BEMPP_CXX_FLAGS "@CXX11_FLAGS@ @BLAS_CMAKE_C_FLAGS@")
 set(BEMPP_CXX_FLAGS "${BEMPP_CXX_FLAGS} @ARMADILLO_CXX_FLAGS@ @ORIGINAL_CXX_FLAGS@")
+set(BEMPP_CXX_FLAGS "${BEMPP_CXX_FLAGS} @SIMD_CXX_FLAGS@")
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${BEMPP_CXX_FLAGS}")
 if(NOT "@BEMPP_PREFIX_PATH@" STREQUAL "" AND EXISTS "@BEMPP_PREFIX_PATH@")
     list(APPEND CMAKE_PREFIX_PATH @BEMPP_PREFIX_PATH@)
@@ -169,5 +169,31 @@ if(WITH_OPENCL)
     list(APPEND BEMPP_INCLUDE_DIRS ${OPENCL_INCLUDE_DIR})
 endif()
 
+if(WITH_MPI)
+    find_package(MPI REQUIRED)
+    list(APPEND BEMPP_INCLUDE_DIRS ${MPI_CXX_INCLUDE_PATH})
+endif()
+
+if(WITH_ZLIB)
+    find_package(ZLIB REQUIRED)
+    list(APPEND BEMPP_INCLUDE_DIRS ${ZLIB_INCLUDE_DIRS})
+endif()
+
+if(WITH_HDF5)
+    find_package(HDF5 REQUIRED COMPONENTS C)
+    list(APPEND BEMPP_INCLUDE_DIRS ${HDF5_INCLUDE_DIRS})
+endif()
+
+if(WITH_SCALAPACK)
+    if(NOT WITH_MPI)
+        message(FATAL_ERROR "WITH_SCALAPACK requires WITH_MPI")
+    endif()
+    find_library(SCALAPACK_LIBRARIES
+        NAMES scalapack scalapack-openmpi scalapack-mpich)
+    if(NOT SCALAPACK_LIBRARIES)
+        message(FATAL_ERROR "ScaLAPACK library not found")
+    endif()
+endif()
+
 list(REMOVE_DUPLICATES BEMPP_INCLUDE_DIRS)
 include_directories(${BEMPP_INCLUDE_DIRS})
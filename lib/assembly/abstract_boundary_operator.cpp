@@ -102,6 +102,12 @@ AbstractBoundaryOperator<BasisFunctionType, ResultType>::id() const {
   return shared_ptr<const AbstractBoundaryOperatorId>();
 }
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const AbstractBoundaryOperatorId>
+AbstractBoundaryOperator<BasisFunctionType, ResultType>::transposeId() const {
+  return shared_ptr<const AbstractBoundaryOperatorId>();
+}
+
 template <typename BasisFunctionType, typename ResultType>
 std::string
 AbstractBoundaryOperator<BasisFunctionType, ResultType>::uniqueLabel() {
@@ -149,8 +155,10 @@ template <typename BasisFunctionType, typename ResultType>
 void AbstractBoundaryOperator<BasisFunctionType, ResultType>::
     collectDataForAssemblerConstruction(
         const AssemblyOptions &options,
-        shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
-        shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &trialRawGeometry,
+        shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+            testRawGeometry,
+        shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+            trialRawGeometry,
         shared_ptr<GeometryFactory> &testGeometryFactory,
         shared_ptr<GeometryFactory> &trialGeometryFactory,
         shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType> *>> &
@@ -170,8 +178,10 @@ void AbstractBoundaryOperator<BasisFunctionType, ResultType>::
 template <typename BasisFunctionType, typename ResultType>
 void AbstractBoundaryOperator<BasisFunctionType, ResultType>::
     collectOptionsIndependentDataForAssemblerConstruction(
-        shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
-        shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &trialRawGeometry,
+        shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+            testRawGeometry,
+        shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+            trialRawGeometry,
         shared_ptr<GeometryFactory> &testGeometryFactory,
         shared_ptr<GeometryFactory> &trialGeometryFactory,
         shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType> *>> &
@@ -200,9 +210,9 @@ template <typename BasisFunctionType, typename ResultType>
 void AbstractBoundaryOperator<BasisFunctionType, ResultType>::
     collectOptionsDependentDataForAssemblerConstruction(
         const AssemblyOptions &options,
-        const shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &
+        const shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
             testRawGeometry,
-        const shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &
+        const shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
             trialRawGeometry,
         shared_ptr<Fiber::OpenClHandler> &openClHandler,
         bool &cacheSingularIntegrals) const {
@@ -146,12 +146,20 @@ public:
    *  If the weak form of this operator is not cacheable, return a null shared
    *  pointer. This is the default implementation.
    *
-   *  \deprecated This method is deprecated and will be removed in a future
-   *  version of BEM++. Boundary operator identifiers are no longer used
-   *  by the discrete weak-form caching mechanism.
-   */
-  virtual BEMPP_DEPRECATED shared_ptr<const AbstractBoundaryOperatorId>
-  id() const;
+   *  The identifier is used by the WeakFormCache of a Context to share the
+   *  weak forms of equivalent operators. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
+
+  /** \brief Return an identifier of an operator whose weak form is the
+   *  transpose of the weak form of this operator.
+   *
+   *  The operator it identifies acts on dualToRange(), with test functions
+   *  from domain(). If its weak form is in the WeakFormCache of a Context,
+   *  the weak form of this operator is returned as a transposed view of it
+   *  instead of being assembled.
+   *
+   *  The default implementation returns a null shared pointer. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> transposeId() const;
 
   /** @}
    *  @name Spaces
@@ -231,8 +239,9 @@ protected:
    *  subsequent local assembler construction. */
   void collectDataForAssemblerConstruction(
       const AssemblyOptions &options,
-      shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
-      shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &trialRawGeometry,
+      shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
+      shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+          trialRawGeometry,
       shared_ptr<GeometryFactory> &testGeometryFactory,
       shared_ptr<GeometryFactory> &trialGeometryFactory,
       shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_> *>> &
@@ -245,8 +254,9 @@ protected:
   /** \brief Construct those objects necessary for subsequent local
    *  assembler construction that are independent from assembly options. */
   void collectOptionsIndependentDataForAssemblerConstruction(
-      shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
-      shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &trialRawGeometry,
+      shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
+      shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+          trialRawGeometry,
       shared_ptr<GeometryFactory> &testGeometryFactory,
       shared_ptr<GeometryFactory> &trialGeometryFactory,
       shared_ptr<std::vector<const Fiber::Shapeset<BasisFunctionType_> *>> &
@@ -259,8 +269,9 @@ protected:
    */
   void collectOptionsDependentDataForAssemblerConstruction(
       const AssemblyOptions &options,
-      const shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &testRawGeometry,
-      const shared_ptr<Fiber::RawGridGeometry<CoordinateType>> &
+      const shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
+          testRawGeometry,
+      const shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &
           trialRawGeometry,
       shared_ptr<Fiber::OpenClHandler> &openClHandler,
       bool &cacheSingularIntegrals) const;
@@ -24,13 +24,20 @@
 
 #include "abstract_boundary_operator_pseudoinverse.hpp"
 #include "boundary_operator.hpp"
+#include "boundary_operator_simplification_helper.hpp"
+#include "composite_boundary_operator_id.hpp"
 #include "context.hpp"
 #include "discrete_boundary_operator_composition.hpp"
+#include "discrete_null_boundary_operator.hpp"
 #include "identity_operator.hpp"
+#include "null_operator.hpp"
+#include "scaled_abstract_boundary_operator.hpp"
+#include "scaled_discrete_boundary_operator.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
 #include "../common/shared_ptr.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../space/space.hpp"
 
 #ifdef WITH_TRILINOS
 
@@ -68,6 +75,51 @@ AbstractBoundaryOperatorComposition<BasisFunctionType, ResultType>::isLocal()
           m_inner.abstractOperator()->isLocal());
 }
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const AbstractBoundaryOperatorId>
+AbstractBoundaryOperatorComposition<BasisFunctionType, ResultType>::id()
+    const {
+  std::vector<shared_ptr<const AbstractBoundaryOperatorId>> operands;
+  operands.push_back(m_outer.abstractOperator()->id());
+  operands.push_back(m_inner.abstractOperator()->id());
+  std::vector<const void *> contexts;
+  contexts.push_back(m_outer.context().get());
+  contexts.push_back(m_inner.context().get());
+  return CompositeBoundaryOperatorId::create("composition", operands,
+                                             contexts);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BoundaryOperator<BasisFunctionType, ResultType>
+AbstractBoundaryOperatorComposition<BasisFunctionType, ResultType>::outer()
+    const {
+  return m_outer;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BoundaryOperator<BasisFunctionType, ResultType>
+AbstractBoundaryOperatorComposition<BasisFunctionType, ResultType>::inner()
+    const {
+  return m_inner;
+}
+
+namespace {
+
+// True if the weak form of op is a square mass matrix between
+// testSpace and trialSpace
+template <typename BasisFunctionType, typename ResultType>
+bool isMassMatrix(
+    const BoundaryOperator<BasisFunctionType, ResultType> &op,
+    const shared_ptr<const Space<BasisFunctionType>> &testSpace,
+    const shared_ptr<const Space<BasisFunctionType>> &trialSpace) {
+  typedef IdentityOperator<BasisFunctionType, ResultType> IdOp;
+  return boost::dynamic_pointer_cast<const IdOp>(op.abstractOperator()) &&
+         op.dualToRange() == testSpace && op.domain() == trialSpace &&
+         testSpace->globalDofCount() == trialSpace->globalDofCount();
+}
+
+} // namespace
+
 template <typename BasisFunctionType, typename ResultType>
 shared_ptr<DiscreteBoundaryOperator<ResultType>>
 AbstractBoundaryOperatorComposition<BasisFunctionType, ResultType>::
@@ -75,25 +127,57 @@ AbstractBoundaryOperatorComposition<BasisFunctionType, ResultType>::
     const {
   typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
   typedef DiscreteBoundaryOperator<ResultType> DiscreteLinOp;
-
-  shared_ptr<const DiscreteLinOp> discreteOuter = m_outer.weakForm();
-  shared_ptr<const DiscreteLinOp> discreteInner = m_inner.weakForm();
-
-  // Calculate the (pseudo)inverse mass matrix
-  BoundaryOp id = identityOperator(
-      // We don't need a persistent shared_ptr since identityOperator
-      // will go out of scope at the end of this function anyway.
-      // All we need is a weak form.
-      make_shared_from_ref(context), m_inner.range(), m_inner.range(),
-      m_inner.dualToRange());
-  BoundaryOp pinvId = pseudoinverse(id, m_inner.dualToRange());
-  // Dual space not important here. Could be anything.
-
-  shared_ptr<const DiscreteLinOp> temp =
-      boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType>>(
-          pinvId.weakForm(), discreteInner);
-  return boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType>>(
-      discreteOuter, temp);
+  typedef NullOperator<BasisFunctionType, ResultType> NullOp;
+
+  // Simplify the expression before assembling anything: the multipliers of
+  // scaled factors are applied once to the product, products with zero are
+  // not assembled at all, and mass matrices cancelling the inverse mass
+  // matrix between the factors (i.e. identity operators composed with
+  // operators on the same spaces) are dropped.
+  ResultType outerMultiplier, innerMultiplier;
+  BoundaryOp outer = BoundaryOperatorSimplificationHelper::unscaledOperator(
+      m_outer, outerMultiplier);
+  BoundaryOp inner = BoundaryOperatorSimplificationHelper::unscaledOperator(
+      m_inner, innerMultiplier);
+  const ResultType weight = outerMultiplier * innerMultiplier;
+  if (weight == static_cast<ResultType>(0.) ||
+      boost::dynamic_pointer_cast<const NullOp>(outer.abstractOperator()) ||
+      boost::dynamic_pointer_cast<const NullOp>(inner.abstractOperator()))
+    return boost::make_shared<DiscreteNullBoundaryOperator<ResultType>>(
+        this->dualToRange()->globalDofCount(),
+        this->domain()->globalDofCount());
+
+  shared_ptr<const DiscreteLinOp> product;
+  if (isMassMatrix(outer, inner.dualToRange(), inner.range()))
+    product = inner.weakForm();
+  else if (isMassMatrix(inner, inner.dualToRange(), inner.range()))
+    product = outer.weakForm();
+  else {
+    shared_ptr<const DiscreteLinOp> discreteOuter = outer.weakForm();
+    shared_ptr<const DiscreteLinOp> discreteInner = inner.weakForm();
+
+    // Calculate the (pseudo)inverse mass matrix
+    BoundaryOp id = identityOperator(
+        // We don't need a persistent shared_ptr since identityOperator
+        // will go out of scope at the end of this function anyway.
+        // All we need is a weak form.
+        make_shared_from_ref(context), inner.range(), inner.range(),
+        inner.dualToRange());
+    BoundaryOp pinvId = pseudoinverse(id, inner.dualToRange());
+    // Dual space not important here. Could be anything.
+
+    shared_ptr<const DiscreteLinOp> temp =
+        boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType>>(
+            pinvId.weakForm(), discreteInner);
+    shared_ptr<DiscreteLinOp> result =
+        boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType>>(
+            discreteOuter, temp);
+    if (weight == static_cast<ResultType>(1.))
+      return result;
+    product = result;
+  }
+  return boost::make_shared<ScaledDiscreteBoundaryOperator<ResultType>>(
+      weight, product);
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
@@ -84,6 +84,13 @@ public:
 
   virtual bool isLocal() const;
 
+  /** \brief Return an identifier combining those of the factors, or a null
+   *  pointer if either factor has none; see CompositeBoundaryOperatorId. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
+
+  BoundaryOperator<BasisFunctionType_, ResultType_> outer() const;
+  BoundaryOperator<BasisFunctionType_, ResultType_> inner() const;
+
 protected:
   virtual shared_ptr<DiscreteBoundaryOperator<ResultType_>>
   assembleWeakFormImpl(const Context<BasisFunctionType, ResultType> &context)
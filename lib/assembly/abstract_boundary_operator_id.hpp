@@ -33,10 +33,8 @@ namespace Bempp {
 /** \ingroup abstract_boundary_operators
  *  \brief Base class for identifiers of an abstract boundary operator.
  *
- *  \deprecated This class is deprecated and will be removed in a
- *  future version of BEM++. Boundary operator identifiers are no longer used
- *  by the discrete weak-form caching mechanism.
- */
+ *  Identifiers of logically equivalent operators compare equal and have
+ *  equal hashes. They are the keys of WeakFormCache. */
 class AbstractBoundaryOperatorId {
 public:
   virtual ~AbstractBoundaryOperatorId() {}
@@ -20,6 +20,7 @@
 
 #include "abstract_boundary_operator_sum.hpp"
 
+#include "composite_boundary_operator_id.hpp"
 #include "context.hpp"
 #include "discrete_boundary_operator_sum.hpp"
 
@@ -66,6 +67,18 @@ AbstractBoundaryOperatorSum<BasisFunctionType, ResultType>::isLocal() const {
           m_term2.abstractOperator()->isLocal());
 }
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const AbstractBoundaryOperatorId>
+AbstractBoundaryOperatorSum<BasisFunctionType, ResultType>::id() const {
+  std::vector<shared_ptr<const AbstractBoundaryOperatorId>> operands;
+  operands.push_back(m_term1.abstractOperator()->id());
+  operands.push_back(m_term2.abstractOperator()->id());
+  std::vector<const void *> contexts;
+  contexts.push_back(m_term1.context().get());
+  contexts.push_back(m_term2.context().get());
+  return CompositeBoundaryOperatorId::create("sum", operands, contexts);
+}
+
 template <typename BasisFunctionType, typename ResultType>
 BoundaryOperator<BasisFunctionType, ResultType>
 AbstractBoundaryOperatorSum<BasisFunctionType, ResultType>::term1() const {
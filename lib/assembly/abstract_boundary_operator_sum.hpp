@@ -83,6 +83,10 @@ public:
 
   virtual bool isLocal() const;
 
+  /** \brief Return an identifier combining those of the terms, or a null
+   *  pointer if either term has none; see CompositeBoundaryOperatorId. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
+
   BoundaryOperator<BasisFunctionType_, ResultType_> term1() const;
   BoundaryOperator<BasisFunctionType_, ResultType_> term2() const;
 
@@ -21,12 +21,16 @@
 #include "abstract_boundary_operator_superposition_base.hpp"
 
 #include "context.hpp"
+#include "abstract_boundary_operator_id.hpp"
 #include "abstract_boundary_operator_sum.hpp"
 #include "aca_global_assembler.hpp"
+#include "boundary_operator_simplification_helper.hpp"
 #include "discrete_boundary_operator_sum.hpp"
 #include "discrete_dense_boundary_operator.hpp"
 #include "discrete_null_boundary_operator.hpp"
 #include "elementary_integral_operator_base.hpp"
+#include "hmat_global_assembler.hpp"
+#include "null_operator.hpp"
 #include "scaled_abstract_boundary_operator.hpp"
 #include "scaled_discrete_boundary_operator.hpp"
 
@@ -35,6 +39,7 @@
 #include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
+#include "../space/space.hpp"
 
 #include <tbb/tick_count.h>
 
@@ -138,6 +143,44 @@ void decomposeBoundaryOperator(
                                        joinableOpWeights, nonjoinableOpWeights);
 }
 
+// Merge terms with the same weak form, adding their weights, and drop
+// terms with zero weight and null operators, so that they are not
+// assembled at all
+template <typename BasisFunctionType, typename ResultType>
+void simplifyTerms(std::vector<BoundaryOperator<BasisFunctionType, ResultType>>
+                       &ops,
+                   std::vector<ResultType> &opWeights) {
+  typedef BoundaryOperator<BasisFunctionType, ResultType> Op;
+  typedef NullOperator<BasisFunctionType, ResultType> NullOp;
+  const ResultType zero = 0.;
+
+  std::vector<Op> newOps;
+  std::vector<ResultType> newOpWeights;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    if (opWeights[i] == zero ||
+        boost::dynamic_pointer_cast<const NullOp>(ops[i].abstractOperator()))
+      continue;
+    size_t j = 0;
+    while (j < newOps.size() &&
+           !BoundaryOperatorSimplificationHelper::haveSameWeakForm(ops[i],
+                                                                   newOps[j]))
+      ++j;
+    if (j < newOps.size())
+      newOpWeights[j] += opWeights[i];
+    else {
+      newOps.push_back(ops[i]);
+      newOpWeights.push_back(opWeights[i]);
+    }
+  }
+  ops.clear();
+  opWeights.clear();
+  for (size_t j = 0; j < newOps.size(); ++j)
+    if (newOpWeights[j] != zero) {
+      ops.push_back(newOps[j]);
+      opWeights.push_back(newOpWeights[j]);
+    }
+}
+
 } // namespace
 
 template <typename BasisFunctionType_, typename ResultType_>
@@ -172,6 +215,12 @@ AbstractBoundaryOperatorSuperpositionBase<BasisFunctionType_, ResultType_>::
                             joinableOpWeights, nonjoinableOpWeights);
   assert(joinableOps.size() == joinableOpWeights.size());
   assert(nonjoinableOps.size() == nonjoinableOpWeights.size());
+  simplifyTerms(joinableOps, joinableOpWeights);
+  simplifyTerms(nonjoinableOps, nonjoinableOpWeights);
+  if (joinableOps.empty() && nonjoinableOps.empty())
+    return boost::make_shared<DiscreteNullOp>(
+        this->dualToRange()->globalDofCount(),
+        this->domain()->globalDofCount());
 
   // std::cout << "joinable ops:\n";
   // for (size_t i = 0; i < joinableOps.size(); ++i)
@@ -192,7 +241,12 @@ AbstractBoundaryOperatorSuperpositionBase<BasisFunctionType_, ResultType_>::
   else if (context.assemblyOptions().assemblyMode() == AssemblyOptions::ACA)
     result = assembleJointOperatorWeakFormInAcaMode(context, joinableOps,
                                                     joinableOpWeights);
-  else
+  else if (context.assemblyOptions().assemblyMode() == AssemblyOptions::HMAT)
+    result = assembleJointOperatorWeakFormInHMatMode(
+        context, joinableOps, joinableOpWeights, nonjoinableOps,
+        nonjoinableOpWeights);
+  // In the FMM mode all operators are assembled separately
+  else if (context.assemblyOptions().assemblyMode() != AssemblyOptions::FMM)
     throw std::invalid_argument(
         "AbstractBoundaryOperatorSuperpositionBase::"
         "assembleWeakFormImpl(): unknown assembly mode");
@@ -356,7 +410,7 @@ AbstractBoundaryOperatorSuperpositionBase<BasisFunctionType_, ResultType_>::
     typedef std::vector<const Fiber::Shapeset<BasisFunctionType> *>
     ShapesetPtrVector;
 
-    shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
+    shared_ptr<const RawGridGeometry> testRawGeometry, trialRawGeometry;
     shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
     shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
 
@@ -434,6 +488,149 @@ AbstractBoundaryOperatorSuperpositionBase<BasisFunctionType_, ResultType_>::
   return nonlocalPart;
 }
 
+template <typename BasisFunctionType_, typename ResultType_>
+shared_ptr<DiscreteBoundaryOperator<ResultType_>>
+AbstractBoundaryOperatorSuperpositionBase<BasisFunctionType_, ResultType_>::
+    assembleJointOperatorWeakFormInHMatMode(
+        const Context<BasisFunctionType, ResultType> &context,
+        std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &ops,
+        std::vector<ResultType> &opWeights,
+        std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &
+            nonjoinableOps,
+        std::vector<ResultType> &nonjoinableOpWeights) const {
+  typedef BoundaryOperator<BasisFunctionType, ResultType> Op;
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  typedef ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>
+  ElemIntegralOp;
+  size_t opCount = ops.size();
+  assert(opWeights.size() == opCount);
+
+  bool verbose =
+      (context.assemblyOptions().verbosityLevel() >= VerbosityLevel::DEFAULT);
+
+  // Split operators into local and nonlocal
+  std::vector<Op> localOps, nonlocalOps;
+  std::vector<ResultType> localOpWeights, nonlocalOpWeights;
+  for (size_t i = 0; i < opCount; ++i)
+    if (ops[i].abstractOperator()->isLocal()) {
+      localOps.push_back(ops[i]);
+      localOpWeights.push_back(opWeights[i]);
+    } else {
+      nonlocalOps.push_back(ops[i]);
+      nonlocalOpWeights.push_back(opWeights[i]);
+    }
+
+  if (nonlocalOps.empty())
+    return shared_ptr<DiscreteOp>();
+
+  // Sparse terms (e.g. identity operators) can only be added to the dense
+  // blocks of the H-matrix if the latter is indexed with global DOFs and the
+  // terms act on the same pair of spaces as the superposition operator.
+  const bool indexWithGlobalDofs = context.hMatOptions().indexWithGlobalDofs;
+  std::vector<shared_ptr<const DiscreteOp>> sparseDiscreteTerms;
+  std::vector<ResultType> sparseTermMultipliers;
+  int sparseTermSymmetry = 0xfffffff;
+  if (indexWithGlobalDofs)
+    for (size_t i = 0; i < nonjoinableOps.size();)
+      if (nonjoinableOps[i].abstractOperator()->isLocal() &&
+          nonjoinableOps[i].domain() == this->domain() &&
+          nonjoinableOps[i].dualToRange() == this->dualToRange()) {
+        sparseDiscreteTerms.push_back(nonjoinableOps[i].weakForm());
+        sparseTermMultipliers.push_back(nonjoinableOpWeights[i]);
+        sparseTermSymmetry &= nonjoinableOps[i].abstractOperator()->symmetry();
+        nonjoinableOps.erase(nonjoinableOps.begin() + i);
+        nonjoinableOpWeights.erase(nonjoinableOpWeights.begin() + i);
+      } else
+        ++i;
+
+  std::string label;
+  if (verbose) {
+    // Prepare label
+    for (size_t i = 0; i < nonlocalOps.size(); ++i)
+      if (nonlocalOpWeights[i] == static_cast<ResultType>(1.))
+        label += "(" + nonlocalOps[i].label() + ") + ";
+      else
+        label += toString(nonlocalOpWeights[i]) + " * (" +
+                 nonlocalOps[i].label() + ") + ";
+    label = label.substr(0, label.size() - 3); // remove the trailing plus
+
+    std::cout << "Assembling the weak form of operator '" << label << "'";
+    if (!sparseDiscreteTerms.empty())
+      std::cout << " with " << sparseDiscreteTerms.size()
+                << " sparse term(s) merged into its dense blocks";
+    std::cout << "..." << std::endl;
+  }
+  tbb::tick_count start = tbb::tick_count::now();
+
+  // Collect data used in the construction of all assemblers
+  typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+  typedef std::vector<const Fiber::Shapeset<BasisFunctionType> *>
+  ShapesetPtrVector;
+
+  shared_ptr<const RawGridGeometry> testRawGeometry, trialRawGeometry;
+  shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
+  shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
+
+  this->collectOptionsIndependentDataForAssemblerConstruction(
+      testRawGeometry, trialRawGeometry, testGeometryFactory,
+      trialGeometryFactory, testShapesets, trialShapesets);
+
+  // Construct assemblers and determine overall symmetry
+  boost::ptr_vector<LocalAssembler> assemblersForNonlocalTerms;
+  int symmetry = 0xfffffff;
+
+  for (size_t i = 0; i < nonlocalOps.size(); ++i) {
+    shared_ptr<const ElemIntegralOp> elemOp =
+        boost::dynamic_pointer_cast<const ElemIntegralOp>(
+            nonlocalOps[i].abstractOperator());
+    assert(elemOp);
+    const AssemblyOptions &options =
+        nonlocalOps[i].context()->assemblyOptions();
+    shared_ptr<Fiber::OpenClHandler> openClHandler;
+    bool cacheSingularIntegrals;
+    this->collectOptionsDependentDataForAssemblerConstruction(
+        options, testRawGeometry, trialRawGeometry, openClHandler,
+        cacheSingularIntegrals);
+
+    std::unique_ptr<LocalAssembler> assembler = elemOp->makeAssembler(
+        *nonlocalOps[i].context()->quadStrategy(), testGeometryFactory,
+        trialGeometryFactory, testRawGeometry, trialRawGeometry, testShapesets,
+        trialShapesets, openClHandler, options.parallelizationOptions(),
+        options.verbosityLevel(), cacheSingularIntegrals);
+    assemblersForNonlocalTerms.push_back(assembler.release());
+    symmetry &= elemOp->symmetry();
+  }
+  symmetry &= sparseTermSymmetry;
+
+  // Convert boost::ptr_vectors to std::vectors
+  std::vector<LocalAssembler *> stlAssemblersForNonlocalTerms(
+      assemblersForNonlocalTerms.size());
+  for (size_t i = 0; i < assemblersForNonlocalTerms.size(); ++i)
+    stlAssemblersForNonlocalTerms[i] = &assemblersForNonlocalTerms[i];
+  std::vector<const DiscreteOp *> stlSparseDiscreteTerms(
+      sparseDiscreteTerms.size());
+  for (size_t i = 0; i < sparseDiscreteTerms.size(); ++i)
+    stlSparseDiscreteTerms[i] = sparseDiscreteTerms[i].get();
+
+  shared_ptr<DiscreteOp> result(
+      HMatGlobalAssembler<BasisFunctionType, ResultType>::
+          assembleDetachedWeakForm(
+              *this->dualToRange(), *this->domain(),
+              stlAssemblersForNonlocalTerms, stlAssemblersForNonlocalTerms,
+              stlSparseDiscreteTerms, nonlocalOpWeights, sparseTermMultipliers,
+              context, symmetry & SYMMETRIC).release());
+  tbb::tick_count end = tbb::tick_count::now();
+  if (verbose)
+    std::cout << "Assembly of the weak form of operator '" << label
+              << "' took " << (end - start).seconds() << " s" << std::endl;
+
+  // Local joinable operators are left for the caller
+  ops = localOps;
+  opWeights = localOpWeights;
+
+  return result;
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
     AbstractBoundaryOperatorSuperpositionBase);
 
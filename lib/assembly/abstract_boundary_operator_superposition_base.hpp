@@ -83,6 +83,14 @@ private:
       const Context<BasisFunctionType, ResultType> &context,
       std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &ops,
       std::vector<ResultType> &opWeights) const;
+  shared_ptr<DiscreteBoundaryOperator<ResultType_>>
+  assembleJointOperatorWeakFormInHMatMode(
+      const Context<BasisFunctionType, ResultType> &context,
+      std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &ops,
+      std::vector<ResultType> &opWeights,
+      std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &
+          nonjoinableOps,
+      std::vector<ResultType> &nonjoinableOpWeights) const;
 };
 
 } // namespace Bempp
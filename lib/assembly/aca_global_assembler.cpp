@@ -40,10 +40,13 @@
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
 #include "../fiber/local_assembler_for_potential_operators.hpp"
+#include "../fiber/profiler.hpp"
 #include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../fiber/scalar_traits.hpp"
 #include "../space/space.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <fstream>
 #include <iostream>
@@ -52,7 +55,6 @@
 
 #include <tbb/atomic.h>
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
 #include <tbb/concurrent_queue.h>
 
 #ifdef WITH_AHMED
@@ -103,6 +105,34 @@ namespace Bempp {
 namespace {
 
 #ifdef WITH_AHMED
+// Inadmissible blocks with at least this many entries are assembled by
+// several tasks, each evaluating a range of columns of at least
+// MIN_DENSE_SUBBLOCK_SIZE entries, so that a large near-field block
+// scheduled last does not leave the other threads idle
+const size_t MIN_SPLIT_DENSE_BLOCK_SIZE = 1 << 16;
+const size_t MIN_DENSE_SUBBLOCK_SIZE = 1 << 12;
+
+template <typename AcaAssemblyHelper, typename AhmedMblock,
+          typename AhmedBemBlcluster>
+void assembleDenseBlockByColumns(const AcaAssemblyHelper &helper,
+                                 AhmedMblock *&block,
+                                 AhmedBemBlcluster *cluster) {
+  const unsigned b1 = cluster->getb1(), n1 = cluster->getn1();
+  const unsigned b2 = cluster->getb2(), n2 = cluster->getn2();
+  // this will be deallocated by freembls
+  block = new AhmedMblock(n1, n2);
+  block->init0_GeM(n1, n2);
+  typename AcaAssemblyHelper::AhmedResultType *data = block->getdata();
+  const size_t grainSize =
+      std::max<size_t>(1, MIN_DENSE_SUBBLOCK_SIZE / std::max(1u, n1));
+  tbb::parallel_for(tbb::blocked_range<unsigned>(0, n2, grainSize),
+                    [&](const tbb::blocked_range<unsigned> &r) {
+    helper.cmpbl(b1, n1, b2 + r.begin(), r.size(),
+                 data + size_t(r.begin()) * n1, cluster->getcl1(),
+                 cluster->getcl2());
+  });
+}
+
 template <typename BasisFunctionType, typename ResultType,
           typename AcaAssemblyHelper>
 class AcaAssemblerLoopBody {
@@ -151,6 +181,8 @@ public:
           dynamic_cast<AhmedBemBlcluster *>(m_leafClusters[leafClusterIndex]);
       AhmedBemBlcluster *localCluster = dynamic_cast<AhmedBemBlcluster *>(
           m_localLeafClusters[leafClusterIndex]);
+      Fiber::ProfileRegion region(cluster->isadm() ? "ACA admissible block"
+                                                   : "ACA inadmissible block");
       bool globalAssembly = m_options.mode != AcaOptions::HYBRID_ASSEMBLY ||
                             !localCluster->isadm();
       AcaAssemblyHelper *helper =
@@ -159,7 +191,12 @@ public:
           globalAssembly ? m_blocks.get() : m_flatLocalBlocks.get();
       if (!globalAssembly)
         cluster = localCluster;
-      if (m_symmetric)
+      if (!m_symmetric && !cluster->isadm() &&
+          size_t(cluster->getn1()) * cluster->getn2() >=
+              MIN_SPLIT_DENSE_BLOCK_SIZE)
+        assembleDenseBlockByColumns(*helper, blocks[cluster->getidx()],
+                                    cluster);
+      else if (m_symmetric)
         apprx_sym(*helper, blocks[cluster->getidx()], cluster, m_options.eps,
                   m_options.maximumRank, true /* complex_sym */);
       else {
@@ -417,7 +454,10 @@ std::unique_ptr<DiscreteAcaBoundaryOperator<ResultType>> assembleAcaOperator(
   const size_t trialDofCount = trial_o2pPermutation->size();
 
   AhmedLeafClusterArray leafClusters(blclusterTree.get());
-  leafClusters.sortAccordingToClusterSize();
+  // The workers pop the clusters in this order, so the most expensive blocks
+  // are started first and the cheap ones fill in the gaps at the end
+  leafClusters.sortAccordingToAssemblyCost(acaOptions.eps,
+                                           acaOptions.maximumRank);
   if (acaOptions.firstClusterIndex >= 0)
     leafClusters.startWithClusterOfIndex(acaOptions.firstClusterIndex);
   const size_t leafClusterCount = leafClusters.size();
@@ -426,13 +466,8 @@ std::unique_ptr<DiscreteAcaBoundaryOperator<ResultType>> assembleAcaOperator(
   reorderIdentically(localLeafClusters, leafClusters);
 
   int maxThreadCount = 1;
-  if (!parallelOptions.isOpenClEnabled()) {
-    if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-      maxThreadCount = tbb::task_scheduler_init::automatic;
-    else
-      maxThreadCount = parallelOptions.maxThreadCount();
-  }
-  tbb::task_scheduler_init scheduler(maxThreadCount);
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
   tbb::atomic<size_t> done;
   done = 0;
 
@@ -464,11 +499,14 @@ std::unique_ptr<DiscreteAcaBoundaryOperator<ResultType>> assembleAcaOperator(
   {
     Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is
                                     // single-threaded
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, leafClusterCount),
-                      Body(helper, admissibleHelper, leafClusters,
-                           localLeafClusters, leafClusterIndexQueue, blocks,
-                           decomposedBlocks, coalescer.get(), acaOptions, done,
-                           verbosityAtLeastDefault, symmetric, chunkStats));
+    Fiber::executeInTaskArena(maxThreadCount, [&] {
+      tbb::parallel_for(
+          tbb::blocked_range<size_t>(0, leafClusterCount),
+          Body(helper, admissibleHelper, leafClusters, localLeafClusters,
+               leafClusterIndexQueue, blocks, decomposedBlocks,
+               coalescer.get(), acaOptions, done, verbosityAtLeastDefault,
+               symmetric, chunkStats));
+    });
   }
   tbb::tick_count loopEnd = tbb::tick_count::now();
   if (verbosityAtLeastDefault) {
@@ -571,12 +609,15 @@ std::unique_ptr<DiscreteAcaBoundaryOperator<ResultType>> assembleAcaOperator(
     if (!boost::is_complex<ResultType>())
       outSymmetry |= HERMITIAN;
   }
+  const size_t storageSize = sizeH(blclusterTree.get(), blocks.get());
   typedef DiscreteAcaBoundaryOperator<ResultType> DiscreteAcaLinOp;
   std::unique_ptr<DiscreteAcaLinOp> acaOp(new DiscreteAcaLinOp(
       testDofCount, trialDofCount, acaOptions.eps, acaOptions.maximumRank,
       outSymmetry, blclusterTree, blocks, *trial_o2pPermutation, // domain
       *test_o2pPermutation,                                      // range
       parallelOptions));
+  acaOp->trackMemory(Fiber::MemoryCategory::ACA_MATRICES, storageSize);
+  acaOp->setMatvecMode(acaOptions.matvecMode);
   return acaOp;
 }
 
@@ -597,6 +638,7 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
     const std::vector<ResultType> &sparseTermMultipliers,
     const Context<BasisFunctionType, ResultType> &context, int symmetry) {
 #ifdef WITH_AHMED
+  Fiber::ProfileRegion region("ACA weak-form assembly");
   typedef AhmedDofWrapper<CoordinateType> AhmedDofType;
   typedef ExtendedBemCluster<AhmedDofType> AhmedBemCluster;
   typedef bbxbemblcluster<AhmedDofType, AhmedDofType> AhmedBemBlcluster;
@@ -30,6 +30,7 @@ AcaOptions::AcaOptions()
       reactionToUnsupportedMode(WARNING), recompress(false),
       outputPostscript(false), outputFname("aca.ps"), scaling(1.0),
       useAhmedAca(false), firstClusterIndex(-1),
+      matvecMode(ROW_PARTITIONED_MATVEC),
       globalAssemblyBeforeCompression(true) {}
 
 } // namespace Bempp
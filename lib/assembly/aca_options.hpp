@@ -254,6 +254,34 @@ public:
    */
   int firstClusterIndex;
 
+  /** \brief Algorithm of the H-matrix-vector product. See
+   *  documentation of the member \p matvecMode for more information. */
+  enum AcaMatvecMode {
+    MIN_MATVEC_MODE,
+    REDUCTION_MATVEC = MIN_MATVEC_MODE,
+    ROW_PARTITIONED_MATVEC,
+    MAX_MATVEC_MODE = ROW_PARTITIONED_MATVEC
+  };
+
+  /** \brief Algorithm of the H-matrix-vector product.
+   *
+   *  If set to \p ROW_PARTITIONED_MATVEC (default), the block cluster tree
+   *  is traversed recursively and the sons of a block cluster lying in
+   *  different block rows are processed concurrently. Every task then
+   *  writes to its own part of the result vector, so that no reduction is
+   *  needed.
+   *
+   *  If set to \p REDUCTION_MATVEC, the leaves are multiplied in arbitrary
+   *  order by threads accumulating their contributions in private vectors
+   *  of the full length, which are summed up at the end. This needs
+   *  memory proportional to the number of threads times the number of
+   *  rows and is kept mainly for comparison.
+   *
+   *  The mode of an existing operator can be changed with
+   *  DiscreteAcaBoundaryOperator::setMatvecMode(). Symmetric and Hermitian
+   *  H-matrices are always multiplied serially by AHMED. */
+  AcaMatvecMode matvecMode;
+
   /** \brief Do global assembly before ACA?
    *
    *  \deprecated This parameter is deprecated and should not be used in new
@@ -25,6 +25,8 @@
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #define BASMOD // prevent inclusion of Ahmed's basmod.h, which contains
                // a conflicting definition of swap()
@@ -44,6 +46,24 @@ bool isFirstClusterBigger(const blcluster *cluster1,
          cluster2->getn1() * cluster2->getn2();
 }
 
+// Estimated number of matrix entries evaluated during the assembly of the
+// block of \p cluster
+double assemblyCost(const blcluster *cluster, double eps,
+                    unsigned int maximumRank) {
+  const double n1 = cluster->getn1();
+  const double n2 = cluster->getn2();
+  if (!cluster->isadm())
+    return n1 * n2;
+  // For a fixed tolerance, the ACA ranks of admissible blocks grow roughly
+  // like log(n) * log(1/eps)
+  const double digits = std::max(1., -std::log10(eps));
+  double rank = std::ceil(digits * std::log(1. + std::min(n1, n2)) / 2.);
+  rank = std::min(rank, std::min(n1, n2));
+  if (maximumRank > 0)
+    rank = std::min(rank, double(maximumRank));
+  return rank * (n1 + n2);
+}
+
 } // namespace
 
 AhmedLeafClusterArray::AhmedLeafClusterArray(blcluster *clusterTree)
@@ -64,6 +84,22 @@ void AhmedLeafClusterArray::sortAccordingToClusterSize() {
   std::sort(&m_leafClusters[0], &m_leafClusters[m_size], isFirstClusterBigger);
 }
 
+void AhmedLeafClusterArray::sortAccordingToAssemblyCost(
+    double eps, unsigned int maximumRank) {
+  std::vector<std::pair<double, blcluster *>> costs(m_size);
+  for (size_t i = 0; i < m_size; ++i)
+    costs[i] = std::make_pair(
+        assemblyCost(m_leafClusters[i], eps, maximumRank), m_leafClusters[i]);
+  // Stable, so that clusters of equal cost stay in tree order
+  std::stable_sort(costs.begin(), costs.end(),
+                   [](const std::pair<double, blcluster *> &a,
+                      const std::pair<double, blcluster *> &b) {
+    return a.first > b.first;
+  });
+  for (size_t i = 0; i < m_size; ++i)
+    m_leafClusters[i] = costs[i].second;
+}
+
 void AhmedLeafClusterArray::startWithClusterOfIndex(size_t index) {
   if (index >= m_size)
     throw std::invalid_argument("AhmedLeafClusterArray::"
@@ -54,6 +54,17 @@ public:
   /** \brief Sort cluster list, putting biggest clusters first. */
   void sortAccordingToClusterSize();
 
+  /** \brief Sort cluster list, putting the clusters whose blocks are the
+   *  most expensive to assemble first.
+   *
+   *  The cost of a block is estimated as the number of matrix entries to be
+   *  evaluated: all n1 x n2 entries of an inadmissible block and r (n1 + n2)
+   *  entries of an admissible block approximated by ACA with tolerance \p
+   *  eps. The rank r is estimated from the block dimensions and \p eps,
+   *  following the logarithmic growth of ACA ranks with the block size, and
+   *  capped at \p maximumRank. */
+  void sortAccordingToAssemblyCost(double eps, unsigned int maximumRank);
+
   void startWithClusterOfIndex(size_t index);
 
 private:
@@ -22,6 +22,7 @@
 
 #include "discrete_boundary_operator.hpp"
 #include "grid_function.hpp"
+#include "multi_grid_function.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../space/space.hpp"
 
@@ -105,6 +106,29 @@ AssembledPotentialOperator<BasisFunctionType, ResultType>::apply(
   return result;
 }
 
+template <typename BasisFunctionType, typename ResultType>
+arma::Cube<ResultType>
+AssembledPotentialOperator<BasisFunctionType, ResultType>::apply(
+    const MultiGridFunction<BasisFunctionType, ResultType> &arguments) const {
+  if (m_space && arguments.space() != m_space)
+    throw std::invalid_argument(
+        "AssembledPotentialOperator::apply(): "
+        "space used to expand 'arguments' does not "
+        "match the one used during operator construction");
+  const arma::Mat<ResultType> &coeffs = arguments.coefficients();
+  assert(m_op->rowCount() % m_componentCount == 0);
+  // Each slice of the cube is stored like one column of the matrix of
+  // results, so the operator can write into the cube's memory directly
+  arma::Cube<ResultType> result(m_componentCount,
+                                m_op->rowCount() / m_componentCount,
+                                coeffs.n_cols);
+  arma::Mat<ResultType> matResult(result.memptr(), m_op->rowCount(),
+                                  coeffs.n_cols, false /* copy_aux_mem */,
+                                  true /* strict */);
+  m_op->apply(NO_TRANSPOSE, coeffs, matResult, 1., 0.);
+  return result;
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
     AssembledPotentialOperator);
 
@@ -31,6 +31,8 @@ namespace Bempp {
 
 template <typename ValueType> class DiscreteBoundaryOperator;
 template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType, typename ResultType>
+class MultiGridFunction;
 template <typename BasisFunctionType> class Space;
 
 /** \ingroup potential_operators
@@ -108,6 +110,20 @@ public:
   arma::Mat<ResultType>
   apply(const GridFunction<BasisFunctionType, ResultType> &argument) const;
 
+  /** \brief Apply the operator to several functions at once.
+   *
+   *  \param[in] arguments Functions expanded in the space returned by
+   *  space().
+   *
+   *  The discrete operator is applied to the whole matrix of coefficients
+   *  of \p arguments in one call. The (\e i, \e j, \e k)th element of the
+   *  returned cube contains the value of the <em>i</em>th component of the
+   *  potential generated by the <em>k</em>th function at the <em>j</em>th
+   *  point from the array returned by evaluationPoints(). */
+  arma::Cube<ResultType>
+  apply(const MultiGridFunction<BasisFunctionType, ResultType> &arguments)
+      const;
+
 private:
   /** \cond PRIVATE */
   shared_ptr<const Space<BasisFunctionType>> m_space;
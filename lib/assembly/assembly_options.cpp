@@ -27,13 +27,15 @@ namespace Bempp {
 AssemblyOptions::AssemblyOptions()
     : m_assemblyMode(DENSE), m_verbosityLevel(VerbosityLevel::DEFAULT),
       m_singularIntegralCaching(true), m_sparseStorageOfLocalOperators(true),
-      m_jointAssembly(false), m_uniformQuadrature(true),
-      m_blasInQuadrature(AUTO) {}
+      m_jointAssembly(false), m_barycentricOperatorReuse(false),
+      m_uniformQuadrature(true), m_blasInQuadrature(AUTO) {}
 
 void AssemblyOptions::switchToDenseMode() { m_assemblyMode = DENSE; }
 
 void AssemblyOptions::switchToHMatMode() { m_assemblyMode = HMAT; }
 
+void AssemblyOptions::switchToFmmMode() { m_assemblyMode = FMM; }
+
 void AssemblyOptions::switchToAcaMode(const AcaOptions &acaOptions) {
   AcaOptions canonicalAcaOptions = acaOptions;
   if (!canonicalAcaOptions.globalAssemblyBeforeCompression) {
@@ -66,10 +68,13 @@ AssemblyOptions::Mode AssemblyOptions::assemblyMode() const {
 
 const AcaOptions &AssemblyOptions::acaOptions() const { return m_acaOptions; }
 
-// void AssemblyOptions::switchToOpenCl(const OpenClOptions& openClOptions)
-//{
-//    m_parallelizationOptions.switchToOpenCl(openClOptions);
-//}
+void AssemblyOptions::enableOpenCl(const OpenClOptions &openClOptions) {
+  m_parallelizationOptions.enableOpenCl(openClOptions);
+}
+
+void AssemblyOptions::disableOpenCl() {
+  m_parallelizationOptions.disableOpenCl();
+}
 
 void AssemblyOptions::setMaxThreadCount(int maxThreadCount) {
   m_parallelizationOptions.setMaxThreadCount(maxThreadCount);
@@ -121,6 +126,14 @@ void AssemblyOptions::enableJointAssembly(bool value) {
 
 bool AssemblyOptions::isJointAssemblyEnabled() const { return m_jointAssembly; }
 
+void AssemblyOptions::enableBarycentricOperatorReuse(bool value) {
+  m_barycentricOperatorReuse = value;
+}
+
+bool AssemblyOptions::isBarycentricOperatorReuseEnabled() const {
+  return m_barycentricOperatorReuse;
+}
+
 void AssemblyOptions::enableBlasInQuadrature(Value value) {
   if (value != AUTO && value != YES && value != NO)
     throw std::invalid_argument("AssemblyOptions::enableBlasInQuadrature(): "
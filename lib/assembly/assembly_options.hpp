@@ -61,7 +61,10 @@ public:
        (ACA). */
     ACA,
     /** \brief Assemble hierarchical matrices using the HMat library. */
-    HMAT
+    HMAT,
+    /** \brief Evaluate the far field of Laplace and modified Helmholtz
+       operators by the fast multipole method (see FmmGlobalAssembler). */
+    FMM
   };
 
   /** \brief Use dense-matrix representations of weak forms of boundary integral
@@ -80,6 +83,13 @@ public:
   /** \brief Assemble using the HMat hierarchical matrix library. */
   void switchToHMatMode();
 
+  /** \brief Assemble using the fast multipole method.
+   *
+   *  Only the near field of an operator is stored; its far field is applied
+   *  by multipole translations. Operators not supported by the FMM are
+   *  assembled in the HMat mode. */
+  void switchToFmmMode();
+
   /** \brief Use dense-matrix representations of weak forms of boundary integral
    *operators.
    *
@@ -109,9 +119,17 @@ public:
     @name Parallelization
     @{ */
 
-  // Temporarily removed (OpenCl support is broken).
-  // void enableOpenCl(const OpenClOptions& openClOptions);
-  // void disableOpenCl();
+  /** \brief Enable GPU-based integration of regular element pairs.
+   *
+   *  Only the Laplace and (modified) Helmholtz single- and double-layer
+   *  operators discretised with scalar shape functions on flat triangles, in
+   *  double precision, are integrated on the GPU; all other integrals are
+   *  still evaluated on the CPU. Has no effect if BEM++ was compiled without
+   *  OpenCL support. */
+  void enableOpenCl(const OpenClOptions &openClOptions = OpenClOptions());
+
+  /** \brief Disable GPU-based calculations. */
+  void disableOpenCl();
 
   /** \brief Set the maximum number of threads used during the assembly.
    *
@@ -195,7 +213,13 @@ public:
    *  assembled together (for example, in a single run of ACA) and stored as a
    *  single H-matrix or dense matrix. By default joint assembly is disabled,
    *  which means that the discrete weak form of each elementary operator is
-   *  stored separately. */
+   *  stored separately.
+   *
+   *  The Calderon projectors (e.g. laplace3dExteriorCalderonProjector())
+   *  constructed with joint assembly enabled assemble the weak forms of the
+   *  single-layer operator and of the superposition of the double-layer
+   *  and identity operators immediately and concurrently; all four blocks
+   *  of the projector are built from these two weak forms. */
   void enableJointAssembly(bool value = true);
 
   /** \brief Return whether joint assembly of integral-operator superpositions
@@ -204,13 +228,43 @@ public:
    * See enableJointAssembly() for more information. */
   bool isJointAssemblyEnabled() const;
 
+  /** \brief Enable or disable reuse of integral operators between spaces
+   *  defined on barycentric grids.
+   *
+   *  Spaces such as PiecewiseLinearContinuousScalarSpaceBarycentric and
+   *  PiecewiseConstantDualGridScalarSpace live on the barycentric refinement
+   *  of a grid, which has six times as many elements. If <tt>value ==
+   *  true</tt>, the single-layer, double-layer, adjoint double-layer and
+   *  hypersingular operators of the Laplace and (modified) Helmholtz
+   *  equations acting on such spaces are not integrated directly. Instead,
+   *  their weak forms are stored as products of sparse matrices with the
+   *  weak form of the operator discretised in piecewise polynomial
+   *  discontinuous spaces on the barycentric grid. These discontinuous
+   *  spaces are shared by all spaces of the same kind on a grid (see
+   *  Context::discontinuousSpaceCache()), so the weak form of the internal
+   *  operator is found in the weak-form cache of the context and assembled
+   *  only once for, e.g., all operators of a Calderon preconditioner.
+   *
+   *  By default reuse is disabled. It has no effect in the local ACA mode,
+   *  which always assembles these operators in the above form. */
+  void enableBarycentricOperatorReuse(bool value = true);
+
+  /** \brief Return whether integral operators are reused between spaces
+   *  defined on barycentric grids.
+   *
+   *  See enableBarycentricOperatorReuse() for more information. */
+  bool isBarycentricOperatorReuseEnabled() const;
+
   /** \brief Specify whether BLAS matrix multiplication routines should be
    *  used during evaluation of elementary integrals.
    *
    *  If this option is set to AUTO (default), BLAS is used in the evaluation
    *  of integrals occurring in the weak forms of operators whose test or
-   *  trial space is composed of quadratic or higher-order elements; for the
-   *  remaining operators, BLAS routines are not used. You can force
+   *  trial space is composed of quadratic or higher-order elements. The
+   *  single-, double- and adjoint double-layer operators use the same code
+   *  path for constant and linear elements, where fixed-size loops replace
+   *  the BLAS calls; for the remaining operators, BLAS routines are not
+   *  used. You can force
    *  BLAS-based integration routines to be used always (or never) by setting
    *  this option to \c YES (or \c NO).
    */
@@ -263,6 +317,7 @@ private:
   bool m_singularIntegralCaching;
   bool m_sparseStorageOfLocalOperators;
   bool m_jointAssembly;
+  bool m_barycentricOperatorReuse;
   bool m_uniformQuadrature;
   Value m_blasInQuadrature;
   /** \endcond */
@@ -0,0 +1,282 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_assembly_report_hpp
+#define bempp_assembly_report_hpp
+
+#include "../common/common.hpp"
+
+#include "../fiber/local_assembly_statistics.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include <tbb/tick_count.h>
+
+namespace Bempp {
+
+/** \ingroup weak_form_assembly
+ *  \brief Wall-clock and CPU time in seconds spent in one phase of the
+ *  assembly of a weak form.
+ *
+ *  The CPU time is that of the whole process, i.e. summed over all threads;
+ *  its ratio to the wall-clock time shows how well the phase was
+ *  parallelised. */
+struct AssemblyPhaseTime {
+  AssemblyPhaseTime() : wallTime(0), cpuTime(0) {}
+  double wallTime;
+  double cpuTime;
+};
+
+/** \ingroup weak_form_assembly
+ *  \brief Measure the wall-clock and CPU time elapsed since construction. */
+class AssemblyPhaseTimer {
+public:
+  AssemblyPhaseTimer()
+      : m_wallStart(tbb::tick_count::now()), m_cpuStart(std::clock()) {}
+
+  AssemblyPhaseTime elapsed() const {
+    AssemblyPhaseTime result;
+    result.wallTime = (tbb::tick_count::now() - m_wallStart).seconds();
+    result.cpuTime = double(std::clock() - m_cpuStart) / CLOCKS_PER_SEC;
+    return result;
+  }
+
+private:
+  tbb::tick_count m_wallStart;
+  std::clock_t m_cpuStart;
+};
+
+/** \ingroup weak_form_assembly
+ *  \brief Record of the work done to assemble a weak form.
+ *
+ *  Attached to the discrete boundary operators returned by
+ *  AbstractBoundaryOperator::assembleWeakForm() for elementary integral
+ *  operators; see DiscreteBoundaryOperator::assemblyReport(). It can be used
+ *  to check the cost of a change of the quadrature or compression options on
+ *  a small problem before running a large one.
+ *
+ *  Element pairs sharing at least one vertex are singular. The quadrature
+ *  descriptors do not record the distance of regular pairs, so regular pairs
+ *  integrated with the lowest quadrature order used by the operator are
+ *  counted as far pairs and those integrated with higher orders (which the
+ *  default quadrature descriptor selector only chooses for elements lying
+ *  close to each other) as near pairs. */
+struct AssemblyReport {
+  enum Phase {
+    GEOMETRY,          // raw geometry, element sizes, cluster trees
+    SINGULAR_CACHING,  // precalculation of the singular integrals
+    REGULAR_INTEGRALS, // integration on demand and global assembly
+    COMPRESSION,       // recompression and conversion of H-matrices
+    PHASE_COUNT
+  };
+
+  enum PairClass {
+    SINGULAR_PAIRS,
+    NEAR_PAIRS,
+    FAR_PAIRS,
+    PAIR_CLASS_COUNT
+  };
+
+  /** \brief Number of element pairs integrated with one quadrature rule. */
+  struct QuadratureRuleUsage {
+    PairClass pairClass;
+    Fiber::ElementPairTopology::Type topology;
+    int testOrder;
+    int trialOrder;
+    bool singlePrecision;
+    std::size_t elementPairCount;       // integrated on demand
+    std::size_t cachedElementPairCount; // precalculated
+  };
+
+  AssemblyReport() : cacheHitCount(0), storageSize(0), threadCount(0) {}
+
+  AssemblyPhaseTime phases[PHASE_COUNT];
+  std::vector<QuadratureRuleUsage> quadratureRules;
+  // Number of local weak forms taken from the singular integral cache
+  std::size_t cacheHitCount;
+  // Bytes of memory used by the discrete operator, 0 if unknown
+  std::size_t storageSize;
+  // Maximum number of threads used
+  int threadCount;
+
+  double wallTime() const {
+    double result = 0;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+      result += phases[phase].wallTime;
+    return result;
+  }
+
+  double cpuTime() const {
+    double result = 0;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+      result += phases[phase].cpuTime;
+    return result;
+  }
+
+  /** \brief Number of element pairs of the given class integrated on demand
+   *  or precalculated. */
+  std::size_t elementPairCount(PairClass pairClass) const {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < quadratureRules.size(); ++i)
+      if (quadratureRules[i].pairClass == pairClass)
+        result += quadratureRules[i].elementPairCount +
+                  quadratureRules[i].cachedElementPairCount;
+    return result;
+  }
+
+  /** \brief Add the quadrature rule usage and cache hits recorded by a local
+   *  assembler to this report. */
+  void addLocalAssemblyStatistics(
+      const Fiber::LocalAssemblyStatistics &statistics) {
+    typedef std::map<Fiber::DoubleQuadratureDescriptor, std::size_t> Counts;
+    typedef std::map<Fiber::DoubleQuadratureDescriptor,
+                     std::pair<std::size_t, std::size_t>> MergedCounts;
+    MergedCounts counts;
+    for (Counts::const_iterator it = statistics.elementPairCounts.begin();
+         it != statistics.elementPairCounts.end(); ++it)
+      counts[it->first].first += it->second;
+    for (Counts::const_iterator it =
+             statistics.cachedElementPairCounts.begin();
+         it != statistics.cachedElementPairCounts.end(); ++it)
+      counts[it->first].second += it->second;
+
+    int farOrder = INT_MAX;
+    for (MergedCounts::const_iterator it = counts.begin(); it != counts.end();
+         ++it)
+      if (it->first.topology.type == Fiber::ElementPairTopology::Disjoint)
+        farOrder =
+            std::min(farOrder, it->first.testOrder + it->first.trialOrder);
+
+    for (MergedCounts::const_iterator it = counts.begin(); it != counts.end();
+         ++it) {
+      const Fiber::DoubleQuadratureDescriptor &desc = it->first;
+      QuadratureRuleUsage usage;
+      if (desc.topology.type != Fiber::ElementPairTopology::Disjoint)
+        usage.pairClass = SINGULAR_PAIRS;
+      else if (desc.testOrder + desc.trialOrder > farOrder)
+        usage.pairClass = NEAR_PAIRS;
+      else
+        usage.pairClass = FAR_PAIRS;
+      usage.topology = desc.topology.type;
+      usage.testOrder = desc.testOrder;
+      usage.trialOrder = desc.trialOrder;
+      usage.singlePrecision = desc.singlePrecisionKernels;
+      usage.elementPairCount = it->second.first;
+      usage.cachedElementPairCount = it->second.second;
+      quadratureRules.push_back(usage);
+    }
+    cacheHitCount += statistics.cacheHitCount;
+  }
+
+  static const char *phaseName(Phase phase) {
+    static const char *names[PHASE_COUNT] = {"geometry", "singularCaching",
+                                             "regularIntegrals",
+                                             "compression"};
+    return names[phase];
+  }
+
+  static const char *pairClassName(PairClass pairClass) {
+    static const char *names[PAIR_CLASS_COUNT] = {"singular", "near", "far"};
+    return names[pairClass];
+  }
+
+  static const char *topologyName(Fiber::ElementPairTopology::Type topology) {
+    switch (topology) {
+    case Fiber::ElementPairTopology::Coincident:
+      return "coincident";
+    case Fiber::ElementPairTopology::SharedEdge:
+      return "sharedEdge";
+    case Fiber::ElementPairTopology::SharedVertex:
+      return "sharedVertex";
+    default:
+      return "disjoint";
+    }
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const AssemblyReport &report) {
+  os << "Assembly: " << report.wallTime() << " s wall, " << report.cpuTime()
+     << " s CPU on up to " << report.threadCount << " threads (";
+  for (int phase = 0; phase < AssemblyReport::PHASE_COUNT; ++phase)
+    os << (phase > 0 ? ", " : "")
+       << AssemblyReport::phaseName(AssemblyReport::Phase(phase)) << ": "
+       << report.phases[phase].wallTime << " s";
+  os << "), element pairs: ";
+  for (int c = 0; c < AssemblyReport::PAIR_CLASS_COUNT; ++c)
+    os << (c > 0 ? ", " : "")
+       << report.elementPairCount(AssemblyReport::PairClass(c)) << " "
+       << AssemblyReport::pairClassName(AssemblyReport::PairClass(c));
+  os << ", cache hits: " << report.cacheHitCount;
+  if (report.storageSize > 0)
+    os << ", storage: " << report.storageSize / 1024. << " KB";
+  return os;
+}
+
+/** \brief Write the report as a JSON object. */
+inline void writeJson(std::ostream &os, const AssemblyReport &report) {
+  os << "{\n"
+     << "  \"wallTime\": " << report.wallTime() << ",\n"
+     << "  \"cpuTime\": " << report.cpuTime() << ",\n"
+     << "  \"threadCount\": " << report.threadCount << ",\n"
+     << "  \"storageSize\": " << report.storageSize << ",\n"
+     << "  \"cacheHitCount\": " << report.cacheHitCount << ",\n";
+
+  os << "  \"phases\": {";
+  for (int phase = 0; phase < AssemblyReport::PHASE_COUNT; ++phase)
+    os << (phase > 0 ? "," : "") << "\n    \""
+       << AssemblyReport::phaseName(AssemblyReport::Phase(phase))
+       << "\": {\"wallTime\": " << report.phases[phase].wallTime
+       << ", \"cpuTime\": " << report.phases[phase].cpuTime << "}";
+  os << "\n  },\n";
+
+  os << "  \"elementPairCounts\": {";
+  for (int c = 0; c < AssemblyReport::PAIR_CLASS_COUNT; ++c)
+    os << (c > 0 ? ", " : "") << "\""
+       << AssemblyReport::pairClassName(AssemblyReport::PairClass(c))
+       << "\": " << report.elementPairCount(AssemblyReport::PairClass(c));
+  os << "},\n";
+
+  os << "  \"quadratureRules\": [";
+  for (std::size_t i = 0; i < report.quadratureRules.size(); ++i) {
+    const AssemblyReport::QuadratureRuleUsage &usage =
+        report.quadratureRules[i];
+    os << (i > 0 ? "," : "") << "\n    {\"pairClass\": \""
+       << AssemblyReport::pairClassName(usage.pairClass)
+       << "\", \"topology\": \"" << AssemblyReport::topologyName(usage.topology)
+       << "\", \"testOrder\": " << usage.testOrder
+       << ", \"trialOrder\": " << usage.trialOrder << ", \"singlePrecision\": "
+       << (usage.singlePrecision ? "true" : "false")
+       << ", \"elementPairCount\": " << usage.elementPairCount
+       << ", \"cachedElementPairCount\": " << usage.cachedElementPairCount
+       << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+} // namespace Bempp
+
+#endif
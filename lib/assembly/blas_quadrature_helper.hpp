@@ -29,15 +29,24 @@
 
 namespace Bempp {
 
+/** \brief Return true if Fiber::TypicalTestScalarKernelTrialIntegral should
+ *  be used to evaluate the weak form of an operator.
+ *
+ *  In the AUTO mode this is the case if either space contains quadratic or
+ *  higher-order elements, for which BLAS pays off. If \p
+ *  scalarTransformations is true, i.e. the operator integrates the values of
+ *  scalar P0 or P1 functions, it is also the case for those spaces;
+ *  TypicalTestScalarKernelTrialIntegral has fixed-size loops for them. */
 template <typename BasisFunctionType>
 inline bool
 shouldUseBlasInQuadrature(const AssemblyOptions &assemblyOptions,
                           const Space<BasisFunctionType> &domain,
-                          const Space<BasisFunctionType> &dualToRange) {
+                          const Space<BasisFunctionType> &dualToRange,
+                          bool scalarTransformations = false) {
   return assemblyOptions.isBlasEnabledInQuadrature() == AssemblyOptions::YES ||
          (assemblyOptions.isBlasEnabledInQuadrature() ==
               AssemblyOptions::AUTO &&
-          (maximumShapesetOrder(domain) >= 2 ||
+          (scalarTransformations || maximumShapesetOrder(domain) >= 2 ||
            maximumShapesetOrder(dualToRange) >= 2));
 }
 
@@ -0,0 +1,69 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "block_cyclic_layout.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace Bempp {
+
+BlockCyclicLayout::BlockCyclicLayout(std::size_t rows, std::size_t columns,
+                                     int processCount, int rank,
+                                     int blockSize, int processRows)
+    : m_rows(rows), m_columns(columns), m_blockSize(blockSize),
+      m_processRows(processRows) {
+  if (processCount < 1 || rank < 0 || rank >= processCount)
+    throw std::invalid_argument("BlockCyclicLayout::BlockCyclicLayout(): "
+                                "invalid process count or rank");
+  if (blockSize < 1)
+    throw std::invalid_argument("BlockCyclicLayout::BlockCyclicLayout(): "
+                                "block size must be positive");
+  if (m_processRows <= 0) {
+    // Largest divisor of the process count not exceeding its square root
+    m_processRows = static_cast<int>(std::sqrt(double(processCount)));
+    while (processCount % m_processRows != 0)
+      --m_processRows;
+  }
+  if (processCount % m_processRows != 0)
+    throw std::invalid_argument("BlockCyclicLayout::BlockCyclicLayout(): "
+                                "the number of process rows must divide the "
+                                "number of processes");
+  m_processColumns = processCount / m_processRows;
+  m_processRow = rank / m_processColumns;
+  m_processColumn = rank % m_processColumns;
+  m_localRows = localCount(rows, blockSize, m_processRow, m_processRows);
+  m_localColumns =
+      localCount(columns, blockSize, m_processColumn, m_processColumns);
+}
+
+std::size_t BlockCyclicLayout::localCount(std::size_t count, int blockSize,
+                                          int process, int processCount) {
+  const std::size_t blocks = count / blockSize;
+  std::size_t result = (blocks / processCount) * blockSize;
+  const std::size_t extraBlocks = blocks % processCount;
+  if (static_cast<std::size_t>(process) < extraBlocks)
+    result += blockSize;
+  else if (static_cast<std::size_t>(process) == extraBlocks)
+    result += count % blockSize;
+  return result;
+}
+
+} // namespace Bempp
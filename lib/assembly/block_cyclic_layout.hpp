@@ -0,0 +1,114 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_block_cyclic_layout_hpp
+#define bempp_block_cyclic_layout_hpp
+
+#include "../common/common.hpp"
+
+#include <cstddef>
+
+namespace Bempp {
+
+/** \ingroup discrete_boundary_operators
+ *  \brief Two-dimensional block-cyclic distribution of a matrix over a grid
+ *  of processes, as used by ScaLAPACK.
+ *
+ *  The rows are split into blocks of blockSize() consecutive rows, which
+ *  are dealt out cyclically to the processRows() rows of the process grid,
+ *  and the columns likewise to its processColumns() columns. Process
+ *  \f$p\f$ sits in row \f$p / c\f$ and column \f$p \bmod c\f$ of a grid
+ *  with \f$c\f$ columns ("row-major" BLACS ordering); the first block
+ *  belongs to process (0, 0). Every process stores its entries as one
+ *  column-major local matrix of localRows() x localColumns() entries. */
+class BlockCyclicLayout {
+public:
+  /** \brief Constructor.
+   *
+   *  Describes the part of a \p rows x \p columns matrix stored by process
+   *  \p rank of \p processCount processes. If \p processRows is not
+   *  positive, the process grid is chosen as square as possible. */
+  BlockCyclicLayout(std::size_t rows, std::size_t columns, int processCount,
+                    int rank, int blockSize = 64, int processRows = 0);
+
+  std::size_t rows() const { return m_rows; }
+  std::size_t columns() const { return m_columns; }
+  int blockSize() const { return m_blockSize; }
+  int processRows() const { return m_processRows; }
+  int processColumns() const { return m_processColumns; }
+  int processRow() const { return m_processRow; }
+  int processColumn() const { return m_processColumn; }
+
+  std::size_t localRows() const { return m_localRows; }
+  std::size_t localColumns() const { return m_localColumns; }
+
+  /** \brief Row of the process grid owning global row \p row. */
+  int rowOwner(std::size_t row) const {
+    return static_cast<int>((row / m_blockSize) % m_processRows);
+  }
+  /** \brief Column of the process grid owning global column \p column. */
+  int columnOwner(std::size_t column) const {
+    return static_cast<int>((column / m_blockSize) % m_processColumns);
+  }
+
+  /** \brief Local index of global row \p row on its owner. */
+  std::size_t localRow(std::size_t row) const {
+    return (row / (m_blockSize * m_processRows)) * m_blockSize +
+           row % m_blockSize;
+  }
+  /** \brief Local index of global column \p column on its owner. */
+  std::size_t localColumn(std::size_t column) const {
+    return (column / (m_blockSize * m_processColumns)) * m_blockSize +
+           column % m_blockSize;
+  }
+
+  /** \brief Global index of local row \p row of this process. */
+  std::size_t globalRow(std::size_t row) const {
+    return ((row / m_blockSize) * m_processRows + m_processRow) *
+               m_blockSize +
+           row % m_blockSize;
+  }
+  /** \brief Global index of local column \p column of this process. */
+  std::size_t globalColumn(std::size_t column) const {
+    return ((column / m_blockSize) * m_processColumns + m_processColumn) *
+               m_blockSize +
+           column % m_blockSize;
+  }
+
+  /** \brief Number of the \p count indices of one dimension stored by
+   *  process \p process of \p processCount (ScaLAPACK's NUMROC). */
+  static std::size_t localCount(std::size_t count, int blockSize,
+                                int process, int processCount);
+
+private:
+  std::size_t m_rows;
+  std::size_t m_columns;
+  int m_blockSize;
+  int m_processRows;
+  int m_processColumns;
+  int m_processRow;
+  int m_processColumn;
+  std::size_t m_localRows;
+  std::size_t m_localColumns;
+};
+
+} // namespace Bempp
+
+#endif
@@ -20,15 +20,23 @@
 
 #include "blocked_boundary_operator.hpp"
 
+#include "abstract_boundary_operator_id.hpp"
 #include "blocked_operator_structure.hpp"
+#include "boundary_operator_simplification_helper.hpp"
 #include "context.hpp"
 #include "discrete_blocked_boundary_operator.hpp"
 #include "grid_function.hpp"
+#include "scaled_abstract_boundary_operator.hpp"
+#include "scaled_discrete_boundary_operator.hpp"
 #include "../common/boost_make_shared_fwd.hpp"
 #include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../space/space.hpp"
 
+#include <tbb/task_group.h>
+
 namespace Bempp {
 
 template <typename BasisFunctionType, typename ResultType>
@@ -178,6 +186,20 @@ BlockedBoundaryOperator<BasisFunctionType, ResultType>::weakForm() const {
   return m_weakForm;
 }
 
+template <typename BasisFunctionType, typename ResultType>
+std::shared_future<shared_ptr<const DiscreteBoundaryOperator<ResultType>>>
+BlockedBoundaryOperator<BasisFunctionType, ResultType>::weakFormAsync() const {
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  if (m_weakForm) {
+    std::promise<shared_ptr<const DiscreteOp>> promise;
+    promise.set_value(m_weakForm);
+    return promise.get_future().share();
+  }
+  const BlockedBoundaryOperator copy(*this);
+  return std::async(std::launch::async, [copy]() { return copy.weakForm(); })
+      .share();
+}
+
 template <typename BasisFunctionType, typename ResultType>
 shared_ptr<const Space<BasisFunctionType>>
 BlockedBoundaryOperator<BasisFunctionType, ResultType>::domain(size_t column)
@@ -257,7 +279,7 @@ void BlockedBoundaryOperator<BasisFunctionType, ResultType>::apply(
     ySize += m_dualsToRanges[row]->globalDofCount();
   arma::Col<ResultType> yVals(ySize);
   for (size_t row = 0, start = 0; row < rowCount; ++row) {
-    arma::Col<ResultType> chunk =
+    const arma::Col<ResultType> &chunk =
         y_inout[row].projections(m_dualsToRanges[row]);
     size_t chunkSize = chunk.n_rows;
     yVals.rows(start, start + chunkSize - 1) = chunk;
@@ -281,17 +303,72 @@ shared_ptr<const DiscreteBoundaryOperator<ResultType>>
 BlockedBoundaryOperator<BasisFunctionType, ResultType>::constructWeakForm()
     const {
   typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  typedef ScaledDiscreteBoundaryOperator<ResultType> ScaledDiscreteOp;
   typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
 
+  const size_t INVALID = static_cast<size_t>(-1);
   const size_t rowCount = this->rowCount();
   const size_t columnCount = this->columnCount();
-  Fiber::_2dArray<shared_ptr<const DiscreteOp>> blocks(rowCount, columnCount);
+
+  // Collect the distinct operators up to scalar factors. Copies of the
+  // same BoundaryOperator share their weak form and must not be assembled
+  // concurrently; operators with equal identifiers, e.g. the same
+  // elementary operator created for several positions of a multitrace
+  // formulation, would be assembled twice.
+  std::vector<BoundaryOp> ops;
+  Fiber::_2dArray<size_t> opIndices(rowCount, columnCount);
+  Fiber::_2dArray<ResultType> multipliers(rowCount, columnCount);
   for (size_t col = 0; col < columnCount; ++col)
     for (size_t row = 0; row < rowCount; ++row) {
-      BoundaryOp op = m_structure.block(row, col);
-      if (op.isInitialized())
-        blocks(row, col) = op.weakForm();
+      opIndices(row, col) = INVALID;
+      if (!m_structure.block(row, col).isInitialized())
+        continue;
+      BoundaryOp op = BoundaryOperatorSimplificationHelper::unscaledOperator(
+          m_structure.block(row, col), multipliers(row, col));
+      for (size_t i = 0; i < ops.size(); ++i)
+        if (BoundaryOperatorSimplificationHelper::haveSameWeakForm(ops[i],
+                                                                   op)) {
+          opIndices(row, col) = i;
+          break;
+        }
+      if (opIndices(row, col) == INVALID) {
+        opIndices(row, col) = ops.size();
+        ops.push_back(op);
+      }
+    }
+
+  // Assemble them as tasks of a single scheduler; the parallel loops of
+  // the individual assemblers run in the same arena and share its threads
+  std::vector<shared_ptr<const DiscreteOp>> weakForms(ops.size());
+  if (!ops.empty()) {
+    const ParallelizationOptions &parallelOptions =
+        ops[0].context()->assemblyOptions().parallelizationOptions();
+    int maxThreadCount = 1;
+    if (!parallelOptions.isOpenClEnabled())
+      maxThreadCount = parallelOptions.maxThreadCount();
+    {
+      Fiber::SerialBlasRegion region;
+      Fiber::executeInTaskArena(maxThreadCount, [&] {
+        tbb::task_group group;
+        for (size_t i = 0; i < ops.size(); ++i)
+          group.run([&, i] { weakForms[i] = ops[i].weakForm(); });
+        group.wait();
+      });
     }
+  }
+
+  Fiber::_2dArray<shared_ptr<const DiscreteOp>> blocks(rowCount, columnCount);
+  for (size_t col = 0; col < columnCount; ++col)
+    for (size_t row = 0; row < rowCount; ++row)
+      if (opIndices(row, col) != INVALID) {
+        const shared_ptr<const DiscreteOp> &weakForm =
+            weakForms[opIndices(row, col)];
+        if (multipliers(row, col) == static_cast<ResultType>(1.))
+          blocks(row, col) = weakForm;
+        else
+          blocks(row, col) = boost::make_shared<ScaledDiscreteOp>(
+              multipliers(row, col), weakForm);
+      }
 
   std::vector<size_t> rowCounts(rowCount);
   for (size_t row = 0; row < rowCount; ++row)
@@ -27,6 +27,7 @@
 #include "blocked_operator_structure.hpp"
 #include "transposition_mode.hpp"
 
+#include <future>
 #include <vector>
 
 namespace Bempp {
@@ -95,9 +96,27 @@ public:
    *      \end{bmatrix},
    *  \f]
    *  where \f$L_{ij}\f$ is the weak form of the operator from row *i* and
-   *  column *j* of this blocked boundary operator. */
+   *  column *j* of this blocked boundary operator.
+   *
+   *  The weak forms of all the blocks are assembled concurrently, as tasks
+   *  of a single TBB scheduler, so that the assembly of small blocks (e.g.
+   *  sparse identity operators) overlaps with that of large ones.
+   *
+   *  Blocks whose operators have equal identifiers (see
+   *  AbstractBoundaryOperator::id()) and spaces are assembled once, also if
+   *  they differ by scalar factors (see ScaledAbstractBoundaryOperator) and
+   *  joint assembly is disabled: all their positions refer to the same weak
+   *  form, scaled by a ScaledDiscreteBoundaryOperator where necessary. */
   shared_ptr<const DiscreteBoundaryOperator<ResultType>> weakForm() const;
 
+  /** \brief Start the assembly of the weak form of this operator in the
+   *  background and return a future holding it.
+   *
+   *  See BoundaryOperator::weakFormAsync(). The weak forms of the blocks are
+   *  stored in the blocks, so a subsequent call to weakForm() reuses them. */
+  std::shared_future<shared_ptr<const DiscreteBoundaryOperator<ResultType>>>
+  weakFormAsync() const;
+
   /** \brief Return the function space being the domain of all the operators
    *  from column \p column of this blocked operator. */
   shared_ptr<const Space<BasisFunctionType>> domain(size_t column) const;
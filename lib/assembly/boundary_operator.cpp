@@ -25,10 +25,17 @@
 #include "adjoint_abstract_boundary_operator.hpp"
 #include "discrete_boundary_operator.hpp"
 #include "context.hpp"
+#include "elementary_integral_operator_base.hpp"
 #include "grid_function.hpp"
 #include "scaled_abstract_boundary_operator.hpp"
+#include "weak_form_cache.hpp"
 #include "../common/boost_make_shared_fwd.hpp"
+#include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <tbb/task_group.h>
 
 namespace Bempp {
 
@@ -104,7 +111,8 @@ BoundaryOperator<BasisFunctionType, ResultType>::weakForm() const {
   typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
   shared_ptr<const DiscreteOp> discreteOp = m_weakWeakFormContainer->lock();
   if (!discreteOp) {
-    discreteOp = m_abstractOp->assembleWeakForm(*m_context);
+    discreteOp =
+        m_context->weakFormCache()->getWeakForm(*m_context, *m_abstractOp);
     assert(discreteOp);
     *m_weakWeakFormContainer = discreteOp;
     if (m_holdWeakForm)
@@ -113,6 +121,52 @@ BoundaryOperator<BasisFunctionType, ResultType>::weakForm() const {
   return discreteOp;
 }
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+BoundaryOperator<BasisFunctionType, ResultType>::weakFormUpdatedFrom(
+    const BoundaryOperator &previous,
+    const std::vector<int> &changedElements) const {
+  if (!isInitialized() || !previous.isInitialized())
+    throw std::runtime_error(
+        "BoundaryOperator::weakFormUpdatedFrom(): attempted to retrieve the "
+        "weak form of an uninitialized operator");
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  typedef ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>
+  ElementaryOp;
+  shared_ptr<const DiscreteOp> discreteOp = m_weakWeakFormContainer->lock();
+  const ElementaryOp *elementaryOp =
+      dynamic_cast<const ElementaryOp *>(m_abstractOp.get());
+  if (discreteOp || !elementaryOp)
+    return weakForm();
+  discreteOp = elementaryOp->updateWeakForm(*previous.weakForm(),
+                                            changedElements, *m_context);
+  assert(discreteOp);
+  *m_weakWeakFormContainer = discreteOp;
+  if (m_holdWeakForm)
+    *m_weakFormContainer = discreteOp;
+  return discreteOp;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::shared_future<shared_ptr<const DiscreteBoundaryOperator<ResultType>>>
+BoundaryOperator<BasisFunctionType, ResultType>::weakFormAsync() const {
+  if (!isInitialized())
+    throw std::runtime_error(
+        "BoundaryOperator::weakFormAsync(): attempted to retrieve the "
+        "weak form of an uninitialized operator");
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  shared_ptr<const DiscreteOp> discreteOp = m_weakWeakFormContainer->lock();
+  if (discreteOp) {
+    std::promise<shared_ptr<const DiscreteOp>> promise;
+    promise.set_value(discreteOp);
+    return promise.get_future().share();
+  }
+  // The copy shares the weak-form containers with this object
+  const BoundaryOperator copy(*this);
+  return std::async(std::launch::async, [copy]() { return copy.weakForm(); })
+      .share();
+}
+
 template <typename BasisFunctionType, typename ResultType>
 shared_ptr<const Space<BasisFunctionType>>
 BoundaryOperator<BasisFunctionType, ResultType>::domain() const {
@@ -179,7 +233,7 @@ void BoundaryOperator<BasisFunctionType, ResultType>::apply(
       m_abstractOp->dualToRange();
 
   // Extract coefficient vectors
-  arma::Col<ResultType> xVals = x_in.coefficients();
+  const arma::Col<ResultType> &xVals = x_in.coefficients();
   arma::Col<ResultType> yVals = y_inout.projections(dualToRange);
 
   // Apply operator and assign the result to y_inout's projections
@@ -323,6 +377,31 @@ adjoint(const BoundaryOperator<BasisFunctionType, ResultType> &op,
       op.context(), boost::make_shared<Adjoint>(op, range));
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void assembleWeakForms(
+    const std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &ops) {
+  for (size_t i = 0; i < ops.size(); ++i)
+    if (!ops[i].isInitialized())
+      throw std::invalid_argument(
+          "assembleWeakForms(): operator " + toString(i) +
+          " is uninitialized");
+  if (ops.empty())
+    return;
+
+  const ParallelizationOptions &parallelOptions =
+      ops[0].context()->assemblyOptions().parallelizationOptions();
+  int maxThreadCount = 1;
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
+  Fiber::SerialBlasRegion region;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::task_group group;
+    for (size_t i = 0; i < ops.size(); ++i)
+      group.run([&, i] { ops[i].weakForm(); });
+    group.wait();
+  });
+}
+
 template <typename BasisFunctionType, typename ResultType>
 BoundaryOperator<BasisFunctionType, ResultType> &
 throwIfUninitialized(BoundaryOperator<BasisFunctionType, ResultType> &op,
@@ -369,6 +448,8 @@ FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(BoundaryOperator);
   template BoundaryOperator<BASIS, RESULT> adjoint(                            \
       const BoundaryOperator<BASIS, RESULT> &op,                               \
       const shared_ptr<const Space<BASIS>> &range);                            \
+  template void assembleWeakForms(                                             \
+      const std::vector<BoundaryOperator<BASIS, RESULT>> &ops);                \
   template BoundaryOperator<BASIS, RESULT> &throwIfUninitialized(              \
       BoundaryOperator<BASIS, RESULT> &op, std::string message);               \
   template const BoundaryOperator<BASIS, RESULT> &throwIfUninitialized(        \
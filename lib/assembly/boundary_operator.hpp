@@ -29,7 +29,9 @@
 #include <boost/mpl/has_key.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <boost/weak_ptr.hpp>
+#include <future>
 #include <string>
+#include <vector>
 
 namespace Bempp {
 
@@ -131,6 +133,44 @@ public:
    *  BoundaryOperator. */
   shared_ptr<const DiscreteBoundaryOperator<ResultType>> weakForm() const;
 
+  /** \brief Return a shared pointer to the weak form of the encapsulated
+   *  abstract boundary operator, obtained by updating that of \p previous.
+   *
+   *  \p previous should represent an operator of the same kind defined on
+   *  a grid differing from that of this operator only by the position of
+   *  the vertices of the elements listed in \p changedElements; see
+   *  ElementaryIntegralOperatorBase::updateWeakForm() for details. If the
+   *  weak form of this operator is already available, or if the
+   *  encapsulated operator is not an elementary integral operator, the
+   *  result is the same as that of weakForm(). The weak form is stored in
+   *  this BoundaryOperator as if it were returned by weakForm().
+   *
+   *  An exception is thrown if this function is called on an uninitialized
+   *  BoundaryOperator. */
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+  weakFormUpdatedFrom(const BoundaryOperator &previous,
+                      const std::vector<int> &changedElements) const;
+
+  /** \brief Start the assembly of the weak form of the encapsulated abstract
+   *  boundary operator in the background and return a future holding it.
+   *
+   *  If the weak form is already available, the returned future is ready.
+   *  Otherwise the weak form is assembled as by weakForm() in a separate
+   *  thread, which joins the same TBB scheduler as all the other assembly
+   *  routines, so that several operators assembled at the same time share
+   *  the available cores. The weak form is stored in this BoundaryOperator
+   *  (and its copies) as soon as it has been assembled.
+   *
+   *  Neither this object nor its copies should be used from other threads
+   *  before the future is ready. The destructor of the last copy of the
+   *  future waits until the assembly is complete.
+   *
+   *  An exception is thrown if this function is called on an uninitialized
+   *  BoundaryOperator; exceptions thrown during assembly are rethrown by
+   *  <tt>get()</tt>. */
+  std::shared_future<shared_ptr<const DiscreteBoundaryOperator<ResultType>>>
+  weakFormAsync() const;
+
   /** \brief Return a shared pointer to the domain of the encapsulated
    *  abstract boundary operator.
    *
@@ -335,6 +375,21 @@ BoundaryOperator<BasisFunctionType, ResultType>
 adjoint(const BoundaryOperator<BasisFunctionType, ResultType> &op,
         const shared_ptr<const Space<BasisFunctionType>> &range);
 
+/** \relates BoundaryOperator
+ *  \brief Assemble the weak forms of several operators concurrently.
+ *
+ *  The weak forms of \p ops are assembled as tasks of a single scheduler, as
+ *  those of the blocks of a BlockedBoundaryOperator, and are then held by
+ *  the operators and their copies (see BoundaryOperator::isWeakFormHeld()).
+ *  This makes it possible to assemble the operators shared by several
+ *  composite operators up front, instead of letting each of the latter
+ *  assemble them when they are in turn assembled concurrently.
+ *
+ *  An exception is thrown if any of the operators is uninitialized. */
+template <typename BasisFunctionType, typename ResultType>
+void assembleWeakForms(
+    const std::vector<BoundaryOperator<BasisFunctionType, ResultType>> &ops);
+
 /** \relates BoundaryOperator
  *  \brief Check whether a BoundaryOperator object is initialized.
  *
@@ -0,0 +1,89 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_boundary_operator_simplification_helper_hpp
+#define bempp_boundary_operator_simplification_helper_hpp
+
+#include "../common/common.hpp"
+
+#include "abstract_boundary_operator_id.hpp"
+#include "boundary_operator.hpp"
+#include "context.hpp"
+#include "scaled_abstract_boundary_operator.hpp"
+#include "../common/shared_ptr.hpp"
+
+namespace Bempp {
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Utility functions used to simplify operator expressions before
+ *  their weak forms are assembled.
+ */
+struct BoundaryOperatorSimplificationHelper {
+  /** \brief Strip the scalar factors off \p op, returning the unscaled
+   *  operator and its multiplier.
+   *
+   *  Only factors whose multiplicand is assembled with the same context are
+   *  removed, and only without joint assembly; in that case the weak form
+   *  of a scaled operator would be a ScaledDiscreteBoundaryOperator
+   *  anyway. */
+  template <typename BasisFunctionType, typename ResultType>
+  static BoundaryOperator<BasisFunctionType, ResultType>
+  unscaledOperator(const BoundaryOperator<BasisFunctionType, ResultType> &op,
+                   ResultType &multiplier) {
+    typedef ScaledAbstractBoundaryOperator<BasisFunctionType, ResultType>
+        ScaledOp;
+    BoundaryOperator<BasisFunctionType, ResultType> result = op;
+    multiplier = static_cast<ResultType>(1.);
+    while (shared_ptr<const ScaledOp> scaledOp =
+               boost::dynamic_pointer_cast<const ScaledOp>(
+                   result.abstractOperator())) {
+      if (scaledOp->multiplicand().context() != result.context() ||
+          result.context()->assemblyOptions().isJointAssemblyEnabled())
+        break;
+      multiplier *= scaledOp->multiplier();
+      result = scaledOp->multiplicand();
+    }
+    return result;
+  }
+
+  /** \brief Return true if \p op1 and \p op2 are known to have the same
+   *  weak form. */
+  template <typename BasisFunctionType, typename ResultType>
+  static bool
+  haveSameWeakForm(const BoundaryOperator<BasisFunctionType, ResultType> &op1,
+                   const BoundaryOperator<BasisFunctionType, ResultType> &op2) {
+    if (op1.context() != op2.context())
+      return false;
+    if (op1.abstractOperator() == op2.abstractOperator())
+      return true;
+    if (op1.domain() != op2.domain() ||
+        op1.dualToRange() != op2.dualToRange())
+      return false;
+    shared_ptr<const AbstractBoundaryOperatorId> id1 =
+        op1.abstractOperator()->id();
+    shared_ptr<const AbstractBoundaryOperatorId> id2 =
+        op2.abstractOperator()->id();
+    return id1 && id2 && *id1 == *id2;
+  }
+};
+
+} // namespace Bempp
+
+#endif
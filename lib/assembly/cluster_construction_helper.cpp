@@ -63,11 +63,9 @@ void ClusterConstructionHelper<BasisFunctionType>::constructBemCluster(
   for (size_t i = 0; i < dofCount; ++i)
     p2oDofs[i] = i;
 
-  std::vector<BoundingBox<CoordinateType>> dofCenters;
-  if (indexWithGlobalDofs)
-    space.getGlobalDofBoundingBoxes(dofCenters);
-  else
-    space.getFlatLocalDofBoundingBoxes(dofCenters);
+  std::vector<BoundingBox<CoordinateType>> dofCenters(
+      indexWithGlobalDofs ? space.globalDofBoundingBoxes()
+                          : space.flatLocalDofBoundingBoxes());
 
   // Use static_cast to convert from a pointer to BoundingBox to a pointer to
   // its descendant AhmedDofWrapper, which does not contain any new data
@@ -53,8 +53,12 @@ template <typename RealType>
 void ComplexifiedDiscreteBoundaryOperator<RealType>::addBlock(
     const std::vector<int> &rows, const std::vector<int> &cols,
     const ValueType alpha, arma::Mat<ValueType> &block) const {
-  throw std::runtime_error("ComplexifiedDiscreteBoundaryOperator::addBlock(): "
-                           "not implemented yet");
+  arma::Mat<RealType> realBlock(rows.size(), cols.size());
+  realBlock.fill(0.);
+  m_operator->addBlock(rows, cols, 1., realBlock);
+  for (size_t c = 0; c < realBlock.n_cols; ++c)
+    for (size_t r = 0; r < realBlock.n_rows; ++r)
+      block(r, c) += alpha * realBlock(r, c);
 }
 
 #ifdef WITH_TRILINOS
@@ -73,7 +77,10 @@ ComplexifiedDiscreteBoundaryOperator<RealType>::range() const {
 template <typename RealType>
 bool ComplexifiedDiscreteBoundaryOperator<RealType>::opSupportedImpl(
     Thyra::EOpTransp M_trans) const {
-  return m_operator->opSupported(M_trans);
+  // The wrapped operator is real, so conjugation does not affect it
+  return m_operator->opSupported(
+      (M_trans == Thyra::TRANS || M_trans == Thyra::CONJTRANS) ? Thyra::TRANS
+                                                               : Thyra::NOTRANS);
 }
 #endif
 
@@ -82,25 +89,15 @@ void ComplexifiedDiscreteBoundaryOperator<RealType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
-  if (beta == static_cast<ValueType>(0.))
-    y_inout.fill(static_cast<ValueType>(0.));
-  else
-    y_inout *= beta;
-
-  arma::Col<RealType> x_re = arma::real(x_in);
-  arma::Col<RealType> x_im = arma::imag(x_in);
-
-  arma::Col<RealType> y_re = arma::real(y_inout);
-  arma::Col<RealType> y_im = arma::imag(y_inout);
-
-  m_operator->apply(trans, x_re, y_re, alpha.real(), 1.);
-  m_operator->apply(trans, x_im, y_re, -alpha.imag(), 1.);
-
-  m_operator->apply(trans, x_re, y_im, alpha.imag(), 1.);
-  m_operator->apply(trans, x_im, y_im, alpha.real(), 1.);
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
 
-  y_inout.set_real(y_re);
-  y_inout.set_imag(y_im);
+template <typename RealType>
+void ComplexifiedDiscreteBoundaryOperator<RealType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  m_operator->applyToComplex(trans, x_in, y_inout, alpha, beta);
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT_REAL_ONLY(
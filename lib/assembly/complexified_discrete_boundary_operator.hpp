@@ -78,6 +78,12 @@ private:
                                 const ValueType alpha,
                                 const ValueType beta) const;
 
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
+
 private:
   /** \cond */
   shared_ptr<const DiscreteBoundaryOperator<RealType>> m_operator;
@@ -0,0 +1,86 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "composite_boundary_operator_id.hpp"
+
+#include <boost/make_shared.hpp>
+
+#include <stdexcept>
+#include <typeinfo>
+
+namespace Bempp {
+
+CompositeBoundaryOperatorId::CompositeBoundaryOperatorId(
+    const std::string &kind,
+    const std::vector<shared_ptr<const AbstractBoundaryOperatorId>> &operands,
+    const std::vector<const void *> &contexts,
+    const std::vector<std::complex<double>> &weights)
+    : m_kind(kind), m_operands(operands), m_contexts(contexts),
+      m_weights(weights) {
+  if (m_contexts.size() != m_operands.size())
+    throw std::invalid_argument(
+        "CompositeBoundaryOperatorId::CompositeBoundaryOperatorId(): "
+        "one context per operand is required");
+}
+
+shared_ptr<const AbstractBoundaryOperatorId>
+CompositeBoundaryOperatorId::create(
+    const std::string &kind,
+    const std::vector<shared_ptr<const AbstractBoundaryOperatorId>> &operands,
+    const std::vector<const void *> &contexts,
+    const std::vector<std::complex<double>> &weights) {
+  for (size_t i = 0; i < operands.size(); ++i)
+    if (!operands[i])
+      return shared_ptr<const AbstractBoundaryOperatorId>();
+  return boost::make_shared<CompositeBoundaryOperatorId>(kind, operands,
+                                                         contexts, weights);
+}
+
+size_t CompositeBoundaryOperatorId::hash() const {
+  size_t result = tbb::tbb_hasher(m_kind);
+  for (size_t i = 0; i < m_operands.size(); ++i) {
+    tbb_hash_combine(result, m_operands[i]->hash());
+    tbb_hash_combine(result, m_contexts[i]);
+  }
+  for (size_t i = 0; i < m_weights.size(); ++i) {
+    tbb_hash_combine(result, m_weights[i].real());
+    tbb_hash_combine(result, m_weights[i].imag());
+  }
+  return result;
+}
+
+bool CompositeBoundaryOperatorId::isEqual(
+    const AbstractBoundaryOperatorId &other) const {
+  if (typeid(other) != typeid(*this))
+    return false;
+  const CompositeBoundaryOperatorId &otherCompatible =
+      static_cast<const CompositeBoundaryOperatorId &>(other);
+  if (m_kind != otherCompatible.m_kind ||
+      m_contexts != otherCompatible.m_contexts ||
+      m_weights != otherCompatible.m_weights ||
+      m_operands.size() != otherCompatible.m_operands.size())
+    return false;
+  for (size_t i = 0; i < m_operands.size(); ++i)
+    if (*m_operands[i] != *otherCompatible.m_operands[i])
+      return false;
+  return true;
+}
+
+} // namespace Bempp
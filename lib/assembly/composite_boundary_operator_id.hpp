@@ -0,0 +1,79 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_composite_boundary_operator_id_hpp
+#define bempp_composite_boundary_operator_id_hpp
+
+#include "../common/common.hpp"
+
+#include "abstract_boundary_operator_id.hpp"
+
+#include <complex>
+#include <string>
+#include <vector>
+
+namespace Bempp {
+
+/** \ingroup composite_boundary_operators
+ *  \brief Identifier of a sum, scaling or composition of boundary operators.
+ *
+ *  Composite operators are identified by their kind, the identifiers and
+ *  contexts of their operands and their scalar weights. Equal expressions
+ *  built separately, such as the repeated factors of a Calderon product,
+ *  therefore share their weak forms in the WeakFormCache. */
+class CompositeBoundaryOperatorId : public AbstractBoundaryOperatorId {
+public:
+  /** \brief Constructor.
+   *
+   *  \p contexts[i] is the address of the context of the operand identified
+   *  by \p operands[i]. */
+  CompositeBoundaryOperatorId(
+      const std::string &kind,
+      const std::vector<shared_ptr<const AbstractBoundaryOperatorId>> &
+          operands,
+      const std::vector<const void *> &contexts,
+      const std::vector<std::complex<double>> &weights =
+          std::vector<std::complex<double>>());
+
+  /** \brief Return a new identifier, or a null pointer if any of the
+   *  operands has no identifier. */
+  static shared_ptr<const AbstractBoundaryOperatorId>
+  create(const std::string &kind,
+         const std::vector<shared_ptr<const AbstractBoundaryOperatorId>> &
+             operands,
+         const std::vector<const void *> &contexts,
+         const std::vector<std::complex<double>> &weights =
+             std::vector<std::complex<double>>());
+
+  virtual size_t hash() const;
+  virtual bool isEqual(const AbstractBoundaryOperatorId &other) const;
+
+private:
+  /** \cond PRIVATE */
+  std::string m_kind;
+  std::vector<shared_ptr<const AbstractBoundaryOperatorId>> m_operands;
+  std::vector<const void *> m_contexts;
+  std::vector<std::complex<double>> m_weights;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
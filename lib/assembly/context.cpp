@@ -21,10 +21,15 @@
 #include "context.hpp"
 
 #include "abstract_boundary_operator.hpp"
+#include "discontinuous_space_cache.hpp"
+#include "hmat_block_cluster_tree_cache.hpp"
+#include "mass_matrix_cache.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/verbosity_level.hpp"
 #include "../fiber/accuracy_options.hpp"
+#include "../fiber/singular_integral_store.hpp"
 #include "numerical_quadrature_strategy.hpp"
+#include "weak_form_cache.hpp"
 #include <Teuchos_ParameterList.hpp>
 
 #include <boost/make_shared.hpp>
@@ -32,13 +37,39 @@
 
 namespace Bempp {
 
+namespace {
+
+double weakFormCacheMemoryBudget(const ParameterList &parameters) {
+  if (parameters.isParameter("weakFormCacheMemoryBudget"))
+    return parameters.get<double>("weakFormCacheMemoryBudget");
+  return 0.;
+}
+
+HMatOptions hMatOptions(const ParameterList &parameters) {
+  if (parameters.isSublist("HMat"))
+    return HMatOptions(parameters.sublist("HMat"));
+  return HMatOptions();
+}
+
+} // namespace
+
 template <typename BasisFunctionType, typename ResultType>
 Context<BasisFunctionType, ResultType>::Context(
     const shared_ptr<const QuadratureStrategy> &quadStrategy,
     const AssemblyOptions &assemblyOptions,
     const ParameterList &globalParameterList)
     : m_quadStrategy(quadStrategy), m_assemblyOptions(assemblyOptions),
-      m_globalParameterList(globalParameterList) {
+      m_globalParameterList(globalParameterList),
+      m_hMatOptions(hMatOptions(globalParameterList)),
+      m_hMatBlockClusterTreeCache(
+          boost::make_shared<HMatBlockClusterTreeCache<BasisFunctionType>>()),
+      m_weakFormCache(
+          boost::make_shared<WeakFormCache<BasisFunctionType, ResultType>>(
+              weakFormCacheMemoryBudget(globalParameterList))),
+      m_massMatrixCache(boost::make_shared<
+          MassMatrixCache<BasisFunctionType, ResultType>>()),
+      m_discontinuousSpaceCache(
+          boost::make_shared<DiscontinuousSpaceCache<BasisFunctionType>>()) {
   if (quadStrategy.get() == 0)
     throw std::invalid_argument("Context::Context(): "
                                 "quadStrategy must not be null");
@@ -51,7 +82,13 @@ Context<BasisFunctionType, ResultType>::Context() :
 
 template <typename BasisFunctionType, typename ResultType>
 Context<BasisFunctionType, ResultType>::Context(
-    const ParameterList &globalParameterList) {
+    const ParameterList &globalParameterList)
+    : m_hMatBlockClusterTreeCache(
+          boost::make_shared<HMatBlockClusterTreeCache<BasisFunctionType>>()),
+      m_massMatrixCache(boost::make_shared<
+          MassMatrixCache<BasisFunctionType, ResultType>>()),
+      m_discontinuousSpaceCache(
+          boost::make_shared<DiscontinuousSpaceCache<BasisFunctionType>>()) {
 
   ParameterList parameters(globalParameterList);
   parameters.setParametersNotAlreadySet(GlobalParameters::parameterList());
@@ -60,6 +97,8 @@ Context<BasisFunctionType, ResultType>::Context(
       parameters.get<std::string>("boundaryOperatorAssemblyType");
   if (assemblyType == "hmat")
     m_assemblyOptions.switchToHMatMode();
+  else if (assemblyType == "fmm")
+    m_assemblyOptions.switchToFmmMode();
   else if (assemblyType == "dense")
     m_assemblyOptions.switchToDenseMode();
   else
@@ -84,6 +123,9 @@ Context<BasisFunctionType, ResultType>::Context(
   m_assemblyOptions.enableSingularIntegralCaching(
       parameters.get<bool>("enableSingularIntegralCaching"));
 
+  m_assemblyOptions.enableBarycentricOperatorReuse(
+      parameters.get<bool>("enableBarycentricOperatorReuse"));
+
   std::string enableBlasInQuadrature =
       parameters.get<std::string>("enableBlasInQuadrature");
   if (enableBlasInQuadrature == "auto")
@@ -120,18 +162,38 @@ Context<BasisFunctionType, ResultType>::Context(
       quadOps.get<int>("doubleSingular"),
       quadOps.get<bool>("quadratureOrdersAreRelative"));
 
-  m_quadStrategy.reset(
-      new NumericalQuadratureStrategy<BasisFunctionType, ResultType>(
-          accuracyOptions));
+  accuracyOptions.setAdaptiveDoubleRegular(
+      quadOps.get<double>("adaptiveTolerance"),
+      quadOps.get<int>("adaptiveKernelDerivativeOrder"));
+
+  accuracyOptions.setSingularKernelSplitting(
+      quadOps.get<bool>("splitSingularKernels"),
+      quadOps.get<int>("smoothPartOrderIncrement"));
+
+  shared_ptr<NumericalQuadratureStrategy<BasisFunctionType, ResultType>>
+      quadStrategy(
+          new NumericalQuadratureStrategy<BasisFunctionType, ResultType>(
+              accuracyOptions));
+  std::string singularIntegralStoreDirectory =
+      parameters.get<std::string>("singularIntegralStoreDirectory");
+  if (!singularIntegralStoreDirectory.empty())
+    quadStrategy->setSingularIntegralStore(
+        boost::make_shared<Fiber::SingularIntegralStore>(
+            singularIntegralStoreDirectory));
+  m_quadStrategy = quadStrategy;
 
   m_globalParameterList = parameters;
+  m_hMatOptions = HMatOptions(parameters.sublist("HMat"));
+  m_weakFormCache =
+      boost::make_shared<WeakFormCache<BasisFunctionType, ResultType>>(
+          weakFormCacheMemoryBudget(parameters));
 }
 
 template <typename BasisFunctionType, typename ResultType>
 shared_ptr<const DiscreteBoundaryOperator<ResultType>>
 Context<BasisFunctionType, ResultType>::getWeakForm(
     const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op) const {
-  return op.assembleWeakForm(*this);
+  return m_weakFormCache->getWeakForm(*this, op);
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(Context);
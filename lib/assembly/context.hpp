@@ -7,6 +7,7 @@
 #include "../common/global_parameters.hpp"
 #include "../common/types.hpp"
 #include "assembly_options.hpp"
+#include "hmat_options.hpp"
 #include "discrete_boundary_operator_cache.hpp"
 
 namespace Bempp {
@@ -16,6 +17,11 @@ class GeometryFactory;
 template <typename ValueType> class DiscreteBoundaryOperator;
 template <typename BasisFunctionType, typename ResultType>
 class AbstractBoundaryOperator;
+template <typename BasisFunctionType> class DiscontinuousSpaceCache;
+template <typename BasisFunctionType> class HMatBlockClusterTreeCache;
+template <typename BasisFunctionType, typename ResultType> class WeakFormCache;
+template <typename BasisFunctionType, typename ResultType>
+class MassMatrixCache;
 /** \endcond */
 
 /** \ingroup weak_form_assembly
@@ -27,6 +33,13 @@ class AbstractBoundaryOperator;
  *  the way integrals are calculated, and assembly options, which control
  *  higher-level aspects of weak-form assembly, e.g. the use or not of
  *  acceleration algorithms such as ACA and the level of parallelism.
+ *
+ *  A context, its quadrature strategy and the grids and spaces it is used
+ *  with may be shared by several application threads assembling operators
+ *  at the same time; its caches are thread-safe. All parallel loops run in
+ *  the process-wide task arenas returned by Fiber::taskArena(), so that
+ *  concurrent assemblies share the TBB worker threads instead of each
+ *  starting a scheduler of its own.
  */
 template <typename BasisFunctionType, typename ResultType> class Context {
 public:
@@ -81,6 +94,12 @@ public:
    *  passed when constructing the Context. */
   const AssemblyOptions &assemblyOptions() const { return m_assemblyOptions; }
 
+  /** \brief Return the options of the H-matrix assembly.
+   *
+   *  They are read from the "HMat" sublist of the global parameter list
+   *  when the Context is constructed. */
+  const HMatOptions &hMatOptions() const { return m_hMatOptions; }
+
   /** \brief Return a reference to the QuadratureStrategy object
    *  passed when constructing the Context. */
   shared_ptr<const QuadratureStrategy> quadStrategy() const {
@@ -93,10 +112,56 @@ public:
     return m_globalParameterList;
   }
 
+  /** \brief Return the cache of H-matrix block cluster trees.
+   *
+   *  The cache is shared by all copies of this Context, so operators
+   *  assembled with them on the same spaces reuse the same trees. */
+  shared_ptr<HMatBlockClusterTreeCache<BasisFunctionType>>
+  hMatBlockClusterTreeCache() const {
+    return m_hMatBlockClusterTreeCache;
+  }
+
+  /** \brief Return the cache of weak forms.
+   *
+   *  The cache is shared by all copies of this Context. BoundaryOperator
+   *  objects look up their weak forms in it, so that equivalent operators
+   *  share a single weak form. Its memory budget is initialised from the
+   *  <tt>weakFormCacheMemoryBudget</tt> global parameter. */
+  shared_ptr<WeakFormCache<BasisFunctionType, ResultType>>
+  weakFormCache() const {
+    return m_weakFormCache;
+  }
+
+  /** \brief Return the cache of mass matrices.
+   *
+   *  The cache is shared by all copies of this Context. GridFunction uses
+   *  it to convert between expansion coefficients and projections. */
+  shared_ptr<MassMatrixCache<BasisFunctionType, ResultType>>
+  massMatrixCache() const {
+    return m_massMatrixCache;
+  }
+
+  /** \brief Return the cache of discontinuous spaces.
+   *
+   *  The cache is shared by all copies of this Context. Synthetic operators
+   *  take the discontinuous spaces of their internal operators from it when
+   *  AssemblyOptions::enableBarycentricOperatorReuse() is set. */
+  shared_ptr<DiscontinuousSpaceCache<BasisFunctionType>>
+  discontinuousSpaceCache() const {
+    return m_discontinuousSpaceCache;
+  }
+
 private:
   shared_ptr<const QuadratureStrategy> m_quadStrategy;
   AssemblyOptions m_assemblyOptions;
   ParameterList m_globalParameterList;
+  HMatOptions m_hMatOptions;
+  shared_ptr<HMatBlockClusterTreeCache<BasisFunctionType>>
+      m_hMatBlockClusterTreeCache;
+  shared_ptr<WeakFormCache<BasisFunctionType, ResultType>> m_weakFormCache;
+  shared_ptr<MassMatrixCache<BasisFunctionType, ResultType>> m_massMatrixCache;
+  shared_ptr<DiscontinuousSpaceCache<BasisFunctionType>>
+      m_discontinuousSpaceCache;
 };
 
 } // namespace Bempp
@@ -20,18 +20,26 @@
 
 #include "dense_global_assembler.hpp"
 
+#include "bempp/common/config_mpi.hpp"
+
 #include "../fiber/explicit_instantiation.hpp"
 
 #include "assembly_options.hpp"
+#include "assembly_report.hpp"
+#include "block_cyclic_layout.hpp"
 #include "evaluation_options.hpp"
 #include "discrete_dense_boundary_operator.hpp"
+#include "discrete_distributed_dense_boundary_operator.hpp"
 #include "context.hpp"
 
 #include "../common/auto_timer.hpp"
+#include "../common/global_parameters.hpp"
 #include "../common/multidimensional_arrays.hpp"
 #include "../common/not_implemented_error.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/numa_first_touch.hpp"
 #include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
 #include "../fiber/local_assembler_for_potential_operators.hpp"
 #include "../grid/entity.hpp"
@@ -43,13 +51,12 @@
 
 #include "../common/armadillo_fwd.hpp"
 #include "../common/complex_aux.hpp"
+#include "../fiber/profiler.hpp"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
 #include <tbb/parallel_for.h>
-#include <tbb/spin_mutex.h>
-#include <tbb/task_scheduler_init.h>
-//#include <tbb/tick_count.h>
 
 namespace Bempp
 {
@@ -59,74 +66,186 @@ namespace Bempp
 namespace
 {
 
-// Body of parallel loop
+// Body of parallel loop. Its range runs over trialIndices, a set of trial
+// elements no two of which contribute to the same global DOF (see
+// colourElementsByGlobalDofs()), so the local matrices can be scattered into
+// the result without locking.
 
 template <typename BasisFunctionType, typename ResultType>
 class DenseWeakFormAssemblerLoopBody
 {
 public:
-    typedef tbb::spin_mutex MutexType;
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    // Number of test elements handled together. The inner loop runs over the
+    // trial elements of the current range, so that the data of the test
+    // elements of a chunk stay in cache.
+    enum { TEST_CHUNK_SIZE = 256 };
 
     DenseWeakFormAssemblerLoopBody(
             const std::vector<int>& testIndices,
+            const std::vector<int>& trialIndices,
             const std::vector<std::vector<GlobalDofIndex> >& testGlobalDofs,
             const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
             const std::vector<std::vector<BasisFunctionType> >& testLocalDofWeights,
             const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
-            Fiber::LocalAssemblerForIntegralOperators<ResultType>& assembler,
-            arma::Mat<ResultType>& result, MutexType& mutex) :
-        m_testIndices(testIndices),
+            const std::vector<Fiber::LocalAssemblerForIntegralOperators<ResultType>*>&
+                assemblers,
+            const std::vector<arma::Mat<ResultType>*>& results,
+            bool upperTriangleOnly) :
+        m_testIndices(testIndices), m_trialIndices(trialIndices),
         m_testGlobalDofs(testGlobalDofs), m_trialGlobalDofs(trialGlobalDofs),
         m_testLocalDofWeights(testLocalDofWeights),
         m_trialLocalDofWeights(trialLocalDofWeights),
-        m_assembler(assembler), m_result(result), m_mutex(mutex) {
+        m_assemblers(assemblers), m_results(results),
+        m_upperTriangleOnly(upperTriangleOnly) {
     }
 
     void operator() (const tbb::blocked_range<int>& r) const {
         const int testElementCount = m_testIndices.size();
+        std::vector<int> chunkTestIndices;
         std::vector<arma::Mat<ResultType> > localResult;
-        for (int trialIndex = r.begin(); trialIndex != r.end(); ++trialIndex) {
-            // Handle this trial element only if it contributes to any global DOFs.
-            bool skipTrialElement = true;
-            const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
-            for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
-                int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
-                if (trialGlobalDof >= 0) {
-                    skipTrialElement = false;
-                    break;
-                }
+        for (int chunkStart = 0; chunkStart < testElementCount;
+             chunkStart += TEST_CHUNK_SIZE) {
+            const std::vector<int>::const_iterator chunkBegin =
+                    m_testIndices.begin() + chunkStart;
+            const std::vector<int>::const_iterator chunkEnd =
+                    m_testIndices.begin() +
+                    std::min<int>(chunkStart + TEST_CHUNK_SIZE, testElementCount);
+            for (int i = r.begin(); i != r.end(); ++i) {
+                const int trialIndex = m_trialIndices[i];
+                // In the upper-triangle mode, only the pairs with
+                // testIndex <= trialIndex are evaluated (m_testIndices is
+                // sorted)
+                chunkTestIndices.assign(
+                        chunkBegin,
+                        m_upperTriangleOnly ?
+                            std::upper_bound(chunkBegin, chunkEnd, trialIndex) :
+                            chunkEnd);
+                if (chunkTestIndices.empty())
+                    continue;
+                addLocalWeakForms(chunkTestIndices, trialIndex, localResult);
             }
-            if (skipTrialElement)
-                continue;
+        }
+    }
 
+private:
+    void addLocalWeakForms(const std::vector<int>& testIndices, int trialIndex,
+                           std::vector<arma::Mat<ResultType> >& localResult) const {
+        const int testElementCount = testIndices.size();
+        const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
+
+        // The operators share the element pairs, so each of them is
+        // evaluated on the current trial element before moving on
+        for (size_t op = 0; op < m_assemblers.size(); ++op) {
             // Evaluate integrals over pairs of the current trial element and
-            // all the test elements
-            m_assembler.evaluateLocalWeakForms(TEST_TRIAL, m_testIndices, trialIndex,
-                                               ALL_DOFS, localResult);
+            // the given test elements
+            m_assemblers[op]->evaluateLocalWeakForms(TEST_TRIAL, testIndices,
+                                                     trialIndex, ALL_DOFS,
+                                                     localResult);
 
             // Global assembly
-            {
-                MutexType::scoped_lock lock(m_mutex);
-                // Loop over test indices
-                for (int row = 0; row < testElementCount; ++row) {
-                    const int testIndex = m_testIndices[row];
-                    const int testDofCount = m_testGlobalDofs[testIndex].size();
-                    // Add the integrals to appropriate entries in the operator's matrix
-                    for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
-                        int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
-                        if (trialGlobalDof < 0)
+            arma::Mat<ResultType>& result = *m_results[op];
+            // Loop over test indices
+            for (int row = 0; row < testElementCount; ++row) {
+                const int testIndex = testIndices[row];
+                const int testDofCount = m_testGlobalDofs[testIndex].size();
+                // The diagonal pairs are completed together with their
+                // transposes by completeSymmetricMatrix()
+                const CoordinateType factor =
+                        m_upperTriangleOnly && testIndex == trialIndex ? 0.5 : 1.;
+                // Add the integrals to appropriate entries in the operator's matrix
+                for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
+                    int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
+                    if (trialGlobalDof < 0)
+                        continue;
+                    for (int testDof = 0; testDof < testDofCount; ++testDof) {
+                        int testGlobalDof = m_testGlobalDofs[testIndex][testDof];
+                        if (testGlobalDof < 0)
                             continue;
-                        for (int testDof = 0; testDof < testDofCount; ++testDof) {
-                            int testGlobalDof = m_testGlobalDofs[testIndex][testDof];
-                            if (testGlobalDof < 0)
-                                continue;
-                            assert(std::abs(m_testLocalDofWeights[testIndex][testDof]) > 0.);
-                            assert(std::abs(m_trialLocalDofWeights[trialIndex][trialDof]) > 0.);
-                            m_result(testGlobalDof, trialGlobalDof) +=
-                                    conj(m_testLocalDofWeights[testIndex][testDof]) *
-                                    m_trialLocalDofWeights[trialIndex][trialDof] *
-                                    localResult[row](testDof, trialDof);
-                        }
+                        assert(std::abs(m_testLocalDofWeights[testIndex][testDof]) > 0.);
+                        assert(std::abs(m_trialLocalDofWeights[trialIndex][trialDof]) > 0.);
+                        result(testGlobalDof, trialGlobalDof) += factor *
+                                conj(m_testLocalDofWeights[testIndex][testDof]) *
+                                m_trialLocalDofWeights[trialIndex][trialDof] *
+                                localResult[row](testDof, trialDof);
+                    }
+                }
+            }
+        }
+    }
+
+    const std::vector<int>& m_testIndices;
+    const std::vector<int>& m_trialIndices;
+    const std::vector<std::vector<GlobalDofIndex> >& m_testGlobalDofs;
+    const std::vector<std::vector<GlobalDofIndex> >& m_trialGlobalDofs;
+    const std::vector<std::vector<BasisFunctionType> >& m_testLocalDofWeights;
+    const std::vector<std::vector<BasisFunctionType> >& m_trialLocalDofWeights;
+    // Assemblers are thread-safe
+    const std::vector<Fiber::LocalAssemblerForIntegralOperators<ResultType>*>&
+        m_assemblers;
+    // no two elements of m_trialIndices write to the same columns
+    const std::vector<arma::Mat<ResultType>*>& m_results;
+    bool m_upperTriangleOnly;
+};
+
+// Body of the parallel loops recomputing selected rows and columns of a weak
+// form (see DenseGlobalAssembler::updateDetachedWeakForm()). Its range runs
+// over a colour of trial elements, as for DenseWeakFormAssemblerLoopBody. In
+// the row pass the entries of the changed rows are accumulated; in the column
+// pass, the entries of the changed columns lying outside the changed rows.
+
+template <typename BasisFunctionType, typename ResultType>
+class DenseWeakFormUpdateLoopBody
+{
+public:
+    DenseWeakFormUpdateLoopBody(
+            const std::vector<int>& testIndices,
+            const std::vector<int>& trialIndices,
+            const std::vector<std::vector<GlobalDofIndex> >& testGlobalDofs,
+            const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
+            const std::vector<std::vector<BasisFunctionType> >& testLocalDofWeights,
+            const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
+            Fiber::LocalAssemblerForIntegralOperators<ResultType>& assembler,
+            const std::vector<char>& rowChanged,
+            const std::vector<char>& colChanged,
+            bool columnPass,
+            arma::Mat<ResultType>& result) :
+        m_testIndices(testIndices), m_trialIndices(trialIndices),
+        m_testGlobalDofs(testGlobalDofs), m_trialGlobalDofs(trialGlobalDofs),
+        m_testLocalDofWeights(testLocalDofWeights),
+        m_trialLocalDofWeights(trialLocalDofWeights),
+        m_assembler(assembler), m_rowChanged(rowChanged),
+        m_colChanged(colChanged), m_columnPass(columnPass),
+        m_result(result) {
+    }
+
+    void operator() (const tbb::blocked_range<int>& r) const {
+        std::vector<arma::Mat<ResultType> > localResult;
+        for (int i = r.begin(); i != r.end(); ++i) {
+            const int trialIndex = m_trialIndices[i];
+            const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
+            m_assembler.evaluateLocalWeakForms(TEST_TRIAL, m_testIndices,
+                                               trialIndex, ALL_DOFS,
+                                               localResult);
+            for (size_t row = 0; row < m_testIndices.size(); ++row) {
+                const int testIndex = m_testIndices[row];
+                const int testDofCount = m_testGlobalDofs[testIndex].size();
+                for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
+                    int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
+                    if (trialGlobalDof < 0 ||
+                            (m_columnPass && !m_colChanged[trialGlobalDof]))
+                        continue;
+                    for (int testDof = 0; testDof < testDofCount; ++testDof) {
+                        int testGlobalDof = m_testGlobalDofs[testIndex][testDof];
+                        // Changed rows are handled by the row pass only
+                        if (testGlobalDof < 0 ||
+                                bool(m_rowChanged[testGlobalDof]) == m_columnPass)
+                            continue;
+                        m_result(testGlobalDof, trialGlobalDof) +=
+                                conj(m_testLocalDofWeights[testIndex][testDof]) *
+                                m_trialLocalDofWeights[trialIndex][trialDof] *
+                                localResult[row](testDof, trialDof);
                     }
                 }
             }
@@ -135,37 +254,40 @@ public:
 
 private:
     const std::vector<int>& m_testIndices;
+    const std::vector<int>& m_trialIndices;
     const std::vector<std::vector<GlobalDofIndex> >& m_testGlobalDofs;
     const std::vector<std::vector<GlobalDofIndex> >& m_trialGlobalDofs;
     const std::vector<std::vector<BasisFunctionType> >& m_testLocalDofWeights;
     const std::vector<std::vector<BasisFunctionType> >& m_trialLocalDofWeights;
-    // mutable OK because Assembler is thread-safe. (Alternative to "mutable" here:
-    // make assembler's internal integrator map mutable)
-    typename Fiber::LocalAssemblerForIntegralOperators<ResultType>& m_assembler;
-    // mutable OK because write access to this matrix is protected by a mutex
+    // Assembler is thread-safe
+    Fiber::LocalAssemblerForIntegralOperators<ResultType>& m_assembler;
+    const std::vector<char>& m_rowChanged;
+    const std::vector<char>& m_colChanged;
+    bool m_columnPass;
+    // no two elements of m_trialIndices write to the same columns
     arma::Mat<ResultType>& m_result;
-
-    // mutex must be mutable because we need to lock and unlock it
-    MutexType& m_mutex;
 };
 
+// Body of parallel loop over a set of trial elements no two of which
+// contribute to the same global DOF, as for DenseWeakFormAssemblerLoopBody.
+
 template <typename BasisFunctionType, typename ResultType>
 class DensePotentialOperatorAssemblerLoopBody
 {
 public:
-    typedef tbb::spin_mutex MutexType;
     typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
 
     DensePotentialOperatorAssemblerLoopBody(
             const std::vector<int>& pointIndices,
+            const std::vector<int>& trialIndices,
             const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
             const std::vector<std::vector<BasisFunctionType> >& trialLocalDofWeights,
             Fiber::LocalAssemblerForPotentialOperators<ResultType>& assembler,
-            arma::Mat<ResultType>& result, MutexType& mutex) :
-        m_pointIndices(pointIndices),
+            arma::Mat<ResultType>& result) :
+        m_pointIndices(pointIndices), m_trialIndices(trialIndices),
         m_trialGlobalDofs(trialGlobalDofs),
         m_trialLocalDofWeights(trialLocalDofWeights),
-        m_assembler(assembler), m_result(result), m_mutex(mutex) {
+        m_assembler(assembler), m_result(result) {
     }
 
     void operator() (const tbb::blocked_range<int>& r) const {
@@ -177,19 +299,9 @@ public:
         const int componentCount = m_assembler.resultDimension();
 
         std::vector<arma::Mat<ResultType> > localResult;
-        for (int trialIndex = r.begin(); trialIndex != r.end(); ++trialIndex) {
-            // Handle this trial element only if it contributes to any global DOFs.
-            bool skipTrialElement = true;
+        for (int i = r.begin(); i != r.end(); ++i) {
+            const int trialIndex = m_trialIndices[i];
             const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
-            for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
-                int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
-                if (trialGlobalDof >= 0) {
-                    skipTrialElement = false;
-                    break;
-                }
-            }
-            if (skipTrialElement)
-                continue;
 
             // Evaluate integrals over pairs of the current trial element and
             // all the points and components
@@ -198,7 +310,6 @@ public:
 
             // Global assembly
             {
-                MutexType::scoped_lock lock(m_mutex);
                 // Add the integrals to appropriate entries in the operator's matrix
                 for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
                     int trialGlobalDof = m_trialGlobalDofs[trialIndex][trialDof];
@@ -220,16 +331,14 @@ public:
 
 private:
     const std::vector<int>& m_pointIndices;
+    const std::vector<int>& m_trialIndices;
     const std::vector<std::vector<GlobalDofIndex> >& m_trialGlobalDofs;
     const std::vector<std::vector<BasisFunctionType> >& m_trialLocalDofWeights;
     // mutable OK because Assembler is thread-safe. (Alternative to "mutable" here:
     // make assembler's internal integrator map mutable)
     typename Fiber::LocalAssemblerForPotentialOperators<ResultType>& m_assembler;
-    // mutable OK because write access to this matrix is protected by a mutex
+    // no two elements of m_trialIndices write to the same columns
     arma::Mat<ResultType>& m_result;
-
-    // mutex must be mutable because we need to lock and unlock it
-    MutexType& m_mutex;
 };
 
 /** Build a list of lists of global DOF indices corresponding to the local DOFs
@@ -263,6 +372,201 @@ void gatherGlobalDofs(
     }
 }
 
+/** Split the elements contributing to at least one global DOF into groups
+ *  ("colours") such that no two elements of a group share a global DOF.
+ *
+ *  The elements are coloured greedily in the order of their indices. If no
+ *  DOFs are shared (e.g. for piecewise constant spaces), all elements get the
+ *  same colour. */
+void colourElementsByGlobalDofs(
+    const std::vector<std::vector<GlobalDofIndex> >& globalDofs,
+    std::vector<std::vector<int> >& colours)
+{
+    const int elementCount = globalDofs.size();
+    GlobalDofIndex dofCount = 0;
+    for (int e = 0; e < elementCount; ++e)
+        for (size_t i = 0; i < globalDofs[e].size(); ++i)
+            dofCount = std::max(dofCount, globalDofs[e][i] + 1);
+
+    // Colours of the elements already coloured that contribute to each DOF
+    std::vector<std::vector<int> > dofColours(dofCount);
+    std::vector<char> colourTaken;
+    colours.clear();
+    for (int e = 0; e < elementCount; ++e) {
+        colourTaken.assign(colours.size(), false);
+        bool contributes = false;
+        for (size_t i = 0; i < globalDofs[e].size(); ++i) {
+            const GlobalDofIndex dof = globalDofs[e][i];
+            if (dof < 0)
+                continue;
+            contributes = true;
+            for (size_t c = 0; c < dofColours[dof].size(); ++c)
+                colourTaken[dofColours[dof][c]] = true;
+        }
+        if (!contributes)
+            continue;
+        const int colour = std::find(colourTaken.begin(), colourTaken.end(),
+                                     false) - colourTaken.begin();
+        if (colour == static_cast<int>(colours.size()))
+            colours.push_back(std::vector<int>());
+        colours[colour].push_back(e);
+        for (size_t i = 0; i < globalDofs[e].size(); ++i) {
+            const GlobalDofIndex dof = globalDofs[e][i];
+            if (dof >= 0 && (dofColours[dof].empty() ||
+                             dofColours[dof].back() != colour))
+                dofColours[dof].push_back(colour);
+        }
+    }
+}
+
+/** Replace the square matrix \p result, assembled from the element pairs with
+ *  testIndex <= trialIndex only (with the diagonal pairs halved), by
+ *  result + op(result),
+ *  where op is the conjugate transpose if \p hermitian is true and the
+ *  transpose otherwise.
+ *
+ *  The matrix is traversed in square blocks so that the columns read in the
+ *  transposed block stay in cache. */
+template <typename ResultType>
+void completeSymmetricMatrix(arma::Mat<ResultType>& result, bool hermitian)
+{
+    const int BLOCK_SIZE = 64;
+    const int size = result.n_rows;
+    assert(result.n_cols == result.n_rows);
+    for (int colStart = 0; colStart < size; colStart += BLOCK_SIZE) {
+        const int colEnd = std::min(colStart + BLOCK_SIZE, size);
+        for (int rowStart = 0; rowStart <= colStart; rowStart += BLOCK_SIZE) {
+            const int rowEnd = std::min(rowStart + BLOCK_SIZE, size);
+            for (int col = colStart; col < colEnd; ++col)
+                for (int row = rowStart; row < std::min(rowEnd, col + 1); ++row) {
+                    const ResultType transposed =
+                            hermitian ? conj(result(col, row)) : result(col, row);
+                    if (row == col)
+                        result(row, col) += transposed;
+                    else {
+                        result(row, col) += transposed;
+                        result(col, row) = hermitian ? conj(result(row, col))
+                                                     : result(row, col);
+                    }
+                }
+        }
+    }
+}
+
+/** Wrap a matrix in a discrete operator, attaching a report of its storage
+ *  size to be completed by the caller. The operator takes over the memory of
+ *  \p matrix, which was first touched with \p maxThreadCount threads. */
+template <typename ResultType>
+DiscreteBoundaryOperator<ResultType>* makeDenseOperator(
+    arma::Mat<ResultType>& matrix, int maxThreadCount)
+{
+    const size_t storageSize = matrix.n_elem * sizeof(ResultType);
+    DiscreteBoundaryOperator<ResultType>* op =
+            new DiscreteDenseBoundaryOperator<ResultType>(matrix,
+                                                          maxThreadCount);
+    shared_ptr<AssemblyReport> report(new AssemblyReport);
+    report->storageSize = storageSize;
+    op->setAssemblyReport(report);
+    return op;
+}
+
+/** Replace the global DOF indices of each element by the local index of
+ *  the row (if \p rows is true) or column of the distributed matrix given
+ *  by \p layout, or by -1 if this process does not store it. Elements
+ *  contributing to no local row or column are then skipped by the
+ *  assembly. */
+void localizeGlobalDofs(const BlockCyclicLayout& layout, bool rows,
+                        std::vector<std::vector<GlobalDofIndex> >& globalDofs)
+{
+    const int process = rows ? layout.processRow() : layout.processColumn();
+    for (size_t e = 0; e < globalDofs.size(); ++e)
+        for (size_t i = 0; i < globalDofs[e].size(); ++i) {
+            GlobalDofIndex& dof = globalDofs[e][i];
+            if (dof < 0)
+                continue;
+            if (rows)
+                dof = layout.rowOwner(dof) == process ?
+                            layout.localRow(dof) : -1;
+            else
+                dof = layout.columnOwner(dof) == process ?
+                            layout.localColumn(dof) : -1;
+        }
+}
+
+/** Layout of the weak forms of a pair of spaces if the "DenseAssembly"
+ *  parameters request distributed assembly, otherwise null. */
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<BlockCyclicLayout> distributedLayout(
+    const Space<BasisFunctionType>& testSpace,
+    const Space<BasisFunctionType>& trialSpace,
+    const Context<BasisFunctionType, ResultType>& context)
+{
+    const ParameterList& parameters = context.globalParameterList();
+    if (!parameters.isSublist("DenseAssembly"))
+        return std::unique_ptr<BlockCyclicLayout>();
+    const ParameterList& denseParameters =
+            parameters.sublist("DenseAssembly");
+    if (!denseParameters.get<bool>("distributed"))
+        return std::unique_ptr<BlockCyclicLayout>();
+#ifdef WITH_MPI
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized)
+        throw std::runtime_error(
+                "DenseGlobalAssembler::assembleDetachedWeakForm(): "
+                "distributed assembly requires MPI to be initialized");
+    int size = 0, rank = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return std::unique_ptr<BlockCyclicLayout>(new BlockCyclicLayout(
+                testSpace.globalDofCount(), trialSpace.globalDofCount(),
+                size, rank, denseParameters.get<int>("blockSize"),
+                denseParameters.get<int>("processRows")));
+#else
+    throw std::runtime_error(
+            "DenseGlobalAssembler::assembleDetachedWeakForm(): "
+            "distributed assembly requires BEM++ to be compiled with MPI "
+            "support (WITH_MPI)");
+#endif
+}
+
+/** Number of threads used for the assembly of dense matrices and for the
+ *  products with them. */
+inline int maxThreadCount(const ParallelizationOptions& parallelOptions)
+{
+    if (parallelOptions.isOpenClEnabled())
+        return 1;
+    return parallelOptions.maxThreadCount();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+int maxThreadCount(const Context<BasisFunctionType, ResultType>& context)
+{
+    return maxThreadCount(
+                context.assemblyOptions().parallelizationOptions());
+}
+
+/** Wrap the local part of a distributed matrix in a discrete operator,
+ *  taking over its memory, as for makeDenseOperator(). */
+template <typename ResultType>
+DiscreteBoundaryOperator<ResultType>* makeDistributedDenseOperator(
+    arma::Mat<ResultType>& localMatrix, const BlockCyclicLayout& layout)
+{
+#ifdef WITH_MPI
+    const size_t storageSize = localMatrix.n_elem * sizeof(ResultType);
+    DiscreteBoundaryOperator<ResultType>* op =
+            new DiscreteDistributedDenseBoundaryOperator<ResultType>(
+                localMatrix, layout);
+    shared_ptr<AssemblyReport> report(new AssemblyReport);
+    report->storageSize = storageSize;
+    op->setAssemblyReport(report);
+    return op;
+#else
+    throw std::logic_error("makeDistributedDenseOperator(): "
+                           "BEM++ was compiled without MPI support");
+#endif
+}
+
 } // namespace
 
 template <typename BasisFunctionType, typename ResultType>
@@ -272,9 +576,192 @@ assembleDetachedWeakForm(
         const Space<BasisFunctionType>& testSpace,
         const Space<BasisFunctionType>& trialSpace,
         LocalAssemblerForIntegralOperators& assembler,
+        const Context<BasisFunctionType, ResultType>& context,
+        int symmetry)
+{
+    std::vector<LocalAssemblerForIntegralOperators*> assemblers(1, &assembler);
+    std::vector<arma::Mat<ResultType> > results;
+    const std::unique_ptr<BlockCyclicLayout> layout =
+            distributedLayout(testSpace, trialSpace, context);
+    assembleDetachedWeakFormMatrices(testSpace, trialSpace, assemblers, context,
+                                     symmetry, layout.get(), results);
+    if (layout)
+        return std::unique_ptr<DiscreteBoundaryOperator<ResultType> >(
+                    makeDistributedDenseOperator(results[0], *layout));
+    return std::unique_ptr<DiscreteBoundaryOperator<ResultType> >(
+                makeDenseOperator(results[0], maxThreadCount(context)));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType> > >
+DenseGlobalAssembler<BasisFunctionType, ResultType>::
+assembleDetachedWeakForms(
+        const Space<BasisFunctionType>& testSpace,
+        const Space<BasisFunctionType>& trialSpace,
+        const std::vector<LocalAssemblerForIntegralOperators*>& assemblers,
+        const Context<BasisFunctionType, ResultType>& context,
+        int symmetry)
+{
+    std::vector<arma::Mat<ResultType> > results;
+    const std::unique_ptr<BlockCyclicLayout> layout =
+            distributedLayout(testSpace, trialSpace, context);
+    assembleDetachedWeakFormMatrices(testSpace, trialSpace, assemblers, context,
+                                     symmetry, layout.get(), results);
+    const int threadCount = maxThreadCount(context);
+    std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType> > > ops;
+    ops.reserve(results.size());
+    for (size_t i = 0; i < results.size(); ++i)
+        ops.push_back(shared_ptr<DiscreteBoundaryOperator<ResultType> >(
+                layout ? makeDistributedDenseOperator(results[i], *layout) :
+                         makeDenseOperator(results[i], threadCount)));
+    return ops;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType> >
+DenseGlobalAssembler<BasisFunctionType, ResultType>::
+updateDetachedWeakForm(
+        const Space<BasisFunctionType>& testSpace,
+        const Space<BasisFunctionType>& trialSpace,
+        LocalAssemblerForIntegralOperators& assembler,
+        const arma::Mat<ResultType>& previousWeakForm,
+        const std::vector<int>& changedElements,
         const Context<BasisFunctionType, ResultType>& context)
 {
-    const AssemblyOptions& options = context.assemblyOptions();
+    Fiber::ProfileRegion region("Dense weak-form update");
+    const int testDofCount = testSpace.globalDofCount();
+    const int trialDofCount = trialSpace.globalDofCount();
+    if (static_cast<int>(previousWeakForm.n_rows) != testDofCount ||
+            static_cast<int>(previousWeakForm.n_cols) != trialDofCount)
+        throw std::invalid_argument(
+                "DenseGlobalAssembler::updateDetachedWeakForm(): "
+                "the previous weak form does not match the spaces");
+
+    std::vector<std::vector<GlobalDofIndex> > testGlobalDofs, trialGlobalDofs;
+    std::vector<std::vector<BasisFunctionType> > testLocalDofWeights,
+        trialLocalDofWeights;
+    gatherGlobalDofs(testSpace, testGlobalDofs, testLocalDofWeights);
+    gatherGlobalDofs(trialSpace, trialGlobalDofs, trialLocalDofWeights);
+    const int testElementCount = testGlobalDofs.size();
+    const int trialElementCount = trialGlobalDofs.size();
+
+    // Rows and columns of the DOFs living on the changed elements
+    std::vector<char> rowChanged(testDofCount, false);
+    std::vector<char> colChanged(trialDofCount, false);
+    for (size_t i = 0; i < changedElements.size(); ++i) {
+        const int element = changedElements[i];
+        if (element < 0 || element >= testElementCount ||
+                element >= trialElementCount)
+            throw std::invalid_argument(
+                    "DenseGlobalAssembler::updateDetachedWeakForm(): "
+                    "invalid element index");
+        for (size_t j = 0; j < testGlobalDofs[element].size(); ++j)
+            if (testGlobalDofs[element][j] >= 0)
+                rowChanged[testGlobalDofs[element][j]] = true;
+        for (size_t j = 0; j < trialGlobalDofs[element].size(); ++j)
+            if (trialGlobalDofs[element][j] >= 0)
+                colChanged[trialGlobalDofs[element][j]] = true;
+    }
+
+    // Elements contributing to at least one DOF, and those contributing to
+    // a changed one. The entries of a changed row or column are sums over
+    // all the elements containing its DOF, not only the changed ones.
+    std::vector<int> testIndices, changedTestIndices;
+    for (int e = 0; e < testElementCount; ++e) {
+        bool contributes = false, changed = false;
+        for (size_t j = 0; j < testGlobalDofs[e].size(); ++j) {
+            const GlobalDofIndex dof = testGlobalDofs[e][j];
+            if (dof < 0)
+                continue;
+            contributes = true;
+            changed = changed || rowChanged[dof];
+        }
+        if (contributes)
+            testIndices.push_back(e);
+        if (changed)
+            changedTestIndices.push_back(e);
+    }
+    std::vector<std::vector<GlobalDofIndex> > changedTrialGlobalDofs(
+                trialElementCount);
+    for (int e = 0; e < trialElementCount; ++e)
+        for (size_t j = 0; j < trialGlobalDofs[e].size(); ++j) {
+            const GlobalDofIndex dof = trialGlobalDofs[e][j];
+            if (dof >= 0 && colChanged[dof]) {
+                changedTrialGlobalDofs[e] = trialGlobalDofs[e];
+                break;
+            }
+        }
+    std::vector<std::vector<int> > trialColours, changedTrialColours;
+    colourElementsByGlobalDofs(trialGlobalDofs, trialColours);
+    colourElementsByGlobalDofs(changedTrialGlobalDofs, changedTrialColours);
+
+    // Copy the previous weak form into a matrix first touched as in
+    // assembleDetachedWeakFormMatrices() and clear the entries to recompute
+    const int threadCount = maxThreadCount(context);
+    arma::Mat<ResultType> result;
+    Fiber::firstTouchZeros(result, testDofCount, trialDofCount, threadCount);
+    result = previousWeakForm;
+    for (int col = 0; col < trialDofCount; ++col) {
+        if (colChanged[col])
+            result.col(col).zeros();
+        else
+            for (int row = 0; row < testDofCount; ++row)
+                if (rowChanged[row])
+                    result(row, col) = 0.;
+    }
+
+    typedef DenseWeakFormUpdateLoopBody<BasisFunctionType, ResultType> Body;
+
+    {
+        Fiber::SerialBlasRegion region;
+        Fiber::executeInTaskArena(threadCount, [&] {
+            if (!changedTestIndices.empty())
+                for (size_t colour = 0; colour < trialColours.size(); ++colour)
+                    tbb::parallel_for(tbb::blocked_range<int>(
+                                          0, trialColours[colour].size()),
+                                      Body(changedTestIndices,
+                                           trialColours[colour],
+                                           testGlobalDofs, trialGlobalDofs,
+                                           testLocalDofWeights,
+                                           trialLocalDofWeights, assembler,
+                                           rowChanged, colChanged,
+                                           false /* row pass */, result));
+            for (size_t colour = 0; colour < changedTrialColours.size();
+                 ++colour)
+                tbb::parallel_for(tbb::blocked_range<int>(
+                                      0, changedTrialColours[colour].size()),
+                                  Body(testIndices,
+                                       changedTrialColours[colour],
+                                       testGlobalDofs, trialGlobalDofs,
+                                       testLocalDofWeights,
+                                       trialLocalDofWeights, assembler,
+                                       rowChanged, colChanged,
+                                       true /* column pass */, result));
+        });
+    }
+    return std::unique_ptr<DiscreteBoundaryOperator<ResultType> >(
+                makeDenseOperator(result, threadCount));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DenseGlobalAssembler<BasisFunctionType, ResultType>::
+assembleDetachedWeakFormMatrices(
+        const Space<BasisFunctionType>& testSpace,
+        const Space<BasisFunctionType>& trialSpace,
+        const std::vector<LocalAssemblerForIntegralOperators*>& assemblers,
+        const Context<BasisFunctionType, ResultType>& context,
+        int symmetry,
+        const BlockCyclicLayout* layout,
+        std::vector<arma::Mat<ResultType> >& results)
+{
+    Fiber::ProfileRegion region("Dense weak-form assembly");
+    // For a symmetric (Hermitian) form on a single space only the pairs with
+    // testIndex <= trialIndex need to be integrated. The transposed entries
+    // of a distributed matrix live on other processes, so it is always
+    // assembled in full.
+    const bool upperTriangleOnly =
+            &testSpace == &trialSpace && (symmetry & (SYMMETRIC | HERMITIAN)) &&
+            !layout;
 
     // Global DOF indices corresponding to local DOFs on elements
     std::vector<std::vector<GlobalDofIndex> > testGlobalDofs, trialGlobalDofs;
@@ -286,8 +773,13 @@ assembleDetachedWeakForm(
         trialLocalDofWeights = testLocalDofWeights;
     } else
         gatherGlobalDofs(trialSpace, trialGlobalDofs, trialLocalDofWeights);
+    // Each process integrates only the element pairs contributing to its
+    // own rows and columns
+    if (layout) {
+        localizeGlobalDofs(*layout, true, testGlobalDofs);
+        localizeGlobalDofs(*layout, false, trialGlobalDofs);
+    }
     const int testElementCount = testGlobalDofs.size();
-    const int trialElementCount = trialGlobalDofs.size();
 
     // Enumerate the test elements that contribute to at least one global DOF
     std::vector<int> testIndices;
@@ -303,31 +795,46 @@ assembleDetachedWeakForm(
         }
     }
 
-    // Create the operator's matrix
-    arma::Mat<ResultType> result(testSpace.globalDofCount(),
-                                 trialSpace.globalDofCount());
-    result.fill(0.);
+    const int threadCount = maxThreadCount(context);
+
+    // Create the operators' matrices. They are zeroed by the threads that
+    // will later multiply with the same columns (see
+    // DiscreteDenseBoundaryOperator), so that on NUMA machines the columns
+    // are stored on the node of the thread reading them.
+    results.resize(assemblers.size());
+    std::vector<arma::Mat<ResultType>*> resultPtrs(assemblers.size());
+    for (size_t i = 0; i < assemblers.size(); ++i) {
+        Fiber::firstTouchZeros(results[i],
+                               layout ? layout->localRows() :
+                                        testSpace.globalDofCount(),
+                               layout ? layout->localColumns() :
+                                        trialSpace.globalDofCount(),
+                               threadCount);
+        resultPtrs[i] = &results[i];
+    }
+
+    // Trial elements sharing no global DOFs can be processed concurrently
+    std::vector<std::vector<int> > trialColours;
+    colourElementsByGlobalDofs(trialGlobalDofs, trialColours);
 
     typedef DenseWeakFormAssemblerLoopBody<BasisFunctionType, ResultType> Body;
-    typename Body::MutexType mutex;
-
-    const ParallelizationOptions& parallelOptions =
-            options.parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+
     {
         Fiber::SerialBlasRegion region;
-        tbb::parallel_for(tbb::blocked_range<int>(0, trialElementCount),
-                          Body(testIndices, testGlobalDofs, trialGlobalDofs,
-                               testLocalDofWeights, trialLocalDofWeights,
-                               assembler, result, mutex));
+        Fiber::executeInTaskArena(threadCount, [&] {
+            for (size_t colour = 0; colour < trialColours.size(); ++colour)
+                tbb::parallel_for(tbb::blocked_range<int>(
+                                      0, trialColours[colour].size()),
+                                  Body(testIndices, trialColours[colour],
+                                       testGlobalDofs, trialGlobalDofs,
+                                       testLocalDofWeights,
+                                       trialLocalDofWeights, assemblers,
+                                       resultPtrs, upperTriangleOnly));
+        });
     }
+    if (upperTriangleOnly)
+        for (size_t i = 0; i < results.size(); ++i)
+            completeSymmetricMatrix(results[i], !(symmetry & SYMMETRIC));
 
     //// Old serial code (TODO: decide whether to keep it behind e.g. #ifndef PARALLEL)
     //    std::vector<arma::Mat<ValueType> > localResult;
@@ -348,11 +855,6 @@ assembleDetachedWeakForm(
     //                       trialGlobalDofs[trialIndex][trialDof]) +=
     //                        localResult[testIndex](testDof, trialDof);
     //    }
-
-    // Create and return a discrete operator represented by the matrix that
-    // has just been calculated
-    return std::unique_ptr<DiscreteBoundaryOperator<ResultType> >(
-                new DiscreteDenseBoundaryOperator<ResultType>(result));
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -364,12 +866,12 @@ assemblePotentialOperator(
         LocalAssemblerForPotentialOperators& assembler,
         const EvaluationOptions& options)
 {
+    Fiber::ProfileRegion region("Dense potential operator assembly");
     // Global DOF indices corresponding to local DOFs on elements
     std::vector<std::vector<GlobalDofIndex> > trialGlobalDofs;
     std::vector<std::vector<BasisFunctionType> > trialLocalDofWeights;
     gatherGlobalDofs(trialSpace, trialGlobalDofs, trialLocalDofWeights);
 
-    const int trialElementCount = trialGlobalDofs.size();
     const int pointCount = points.n_cols;
     const int componentCount = assembler.resultDimension();
 
@@ -378,35 +880,36 @@ assemblePotentialOperator(
     for (int i = 0; i < pointCount; ++i)
         pointIndices[i] = i;
 
-    // Create the operator's matrix
-    arma::Mat<ResultType> result(pointCount * componentCount,
-                                 trialSpace.globalDofCount());
-    result.fill(0.);
+    const int threadCount = maxThreadCount(options.parallelizationOptions());
+
+    // Create the operator's matrix, first touched as in
+    // assembleDetachedWeakFormMatrices()
+    arma::Mat<ResultType> result;
+    Fiber::firstTouchZeros(result, pointCount * componentCount,
+                           trialSpace.globalDofCount(), threadCount);
+
+    // Trial elements sharing no global DOFs can be processed concurrently
+    std::vector<std::vector<int> > trialColours;
+    colourElementsByGlobalDofs(trialGlobalDofs, trialColours);
 
     typedef DensePotentialOperatorAssemblerLoopBody<BasisFunctionType, ResultType> Body;
-    typename Body::MutexType mutex;
-
-    const ParallelizationOptions& parallelOptions =
-            options.parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+
     {
         Fiber::SerialBlasRegion region;
-        tbb::parallel_for(tbb::blocked_range<int>(0, trialElementCount),
-                          Body(pointIndices, trialGlobalDofs,
-                               trialLocalDofWeights,
-                               assembler, result, mutex));
+        Fiber::executeInTaskArena(threadCount, [&] {
+            for (size_t colour = 0; colour < trialColours.size(); ++colour)
+                tbb::parallel_for(tbb::blocked_range<int>(
+                                      0, trialColours[colour].size()),
+                                  Body(pointIndices, trialColours[colour],
+                                       trialGlobalDofs, trialLocalDofWeights,
+                                       assembler, result));
+        });
     }
     // Create and return a discrete operator represented by the matrix that
     // has just been calculated
     return std::unique_ptr<DiscreteBoundaryOperator<ResultType> >(
-                new DiscreteDenseBoundaryOperator<ResultType>(result));
+                new DiscreteDenseBoundaryOperator<ResultType>(result,
+                                                              threadCount));
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DenseGlobalAssembler);
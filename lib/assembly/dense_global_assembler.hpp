@@ -4,8 +4,11 @@
 #include "../common/common.hpp"
 #include "../common/armadillo_fwd.hpp"
 #include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+#include "symmetry.hpp"
 
 #include <memory>
+#include <vector>
 
 namespace Fiber
 {
@@ -19,6 +22,7 @@ namespace Bempp
 {
     /** \cond FORWARD_DECL */
     class AssemblyOptions;
+    class BlockCyclicLayout;
     class EvaluationOptions;
     template <typename ValueType> class DiscreteBoundaryOperator;
     template <typename BasisFunctionType> class Space;
@@ -36,11 +40,63 @@ namespace Bempp
                     LocalAssemblerForIntegralOperators;
                 typedef Fiber::LocalAssemblerForPotentialOperators<ResultType>
                     LocalAssemblerForPotentialOperators;
+                /** \brief Assemble the weak form of an operator.
+                 *
+                 *  If \p testSpace and \p trialSpace are the same object and
+                 *  \p symmetry (a combination of Symmetry flags) contains
+                 *  SYMMETRIC or HERMITIAN, only the element pairs in the upper
+                 *  triangle are evaluated and the rest of the matrix is filled
+                 *  in by symmetry.
+                 *
+                 *  If the "distributed" parameter of the "DenseAssembly"
+                 *  sublist of the context's global parameters is set, the
+                 *  matrix is distributed block-cyclically over the processes
+                 *  of MPI_COMM_WORLD and every process integrates only the
+                 *  element pairs contributing to its own entries; the result
+                 *  is then a DiscreteDistributedDenseBoundaryOperator and
+                 *  the symmetry is not exploited. */
                 static std::unique_ptr<DiscreteBoundaryOperator<ResultType> >
                     assembleDetachedWeakForm(
                             const Space<BasisFunctionType>& testSpace,
                             const Space<BasisFunctionType>& trialSpace,
                             LocalAssemblerForIntegralOperators& assembler,
+                            const Context<BasisFunctionType, ResultType>& context,
+                            int symmetry = NO_SYMMETRY);
+                /** \brief Assemble the weak forms of several operators acting
+                 *  on the same pair of spaces in a single pass over the
+                 *  element pairs.
+                 *
+                 *  The global DOF lists are gathered once and each trial
+                 *  element is handed to all the assemblers in turn. The i'th
+                 *  returned operator corresponds to \p assemblers[i].
+                 *  \p symmetry must hold for all the operators (see
+                 *  assembleDetachedWeakForm()). */
+                static std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType> > >
+                    assembleDetachedWeakForms(
+                            const Space<BasisFunctionType>& testSpace,
+                            const Space<BasisFunctionType>& trialSpace,
+                            const std::vector<LocalAssemblerForIntegralOperators*>&
+                                assemblers,
+                            const Context<BasisFunctionType, ResultType>& context,
+                            int symmetry = NO_SYMMETRY);
+                /** \brief Update the weak form of an operator after a change
+                 *  of the geometry of some elements.
+                 *
+                 *  \p previousWeakForm is the weak form of the operator
+                 *  assembled on a grid differing from that of \p testSpace
+                 *  and \p trialSpace only by the position of the elements
+                 *  whose indices are listed in \p changedElements; the DOFs
+                 *  must be numbered in the same way. Only the rows and
+                 *  columns of the DOFs living on these elements are
+                 *  recomputed; the other entries are copied. The symmetry of
+                 *  the operator is not exploited. */
+                static std::unique_ptr<DiscreteBoundaryOperator<ResultType> >
+                    updateDetachedWeakForm(
+                            const Space<BasisFunctionType>& testSpace,
+                            const Space<BasisFunctionType>& trialSpace,
+                            LocalAssemblerForIntegralOperators& assembler,
+                            const arma::Mat<ResultType>& previousWeakForm,
+                            const std::vector<int>& changedElements,
                             const Context<BasisFunctionType, ResultType>& context);
                 static std::unique_ptr<DiscreteBoundaryOperator<ResultType> >
                     assemblePotentialOperator(
@@ -48,6 +104,19 @@ namespace Bempp
                             const Space<BasisFunctionType>& trialSpace,
                             LocalAssemblerForPotentialOperators& assembler,
                             const EvaluationOptions& options);
+
+            private:
+                /** \cond PRIVATE */
+                static void assembleDetachedWeakFormMatrices(
+                        const Space<BasisFunctionType>& testSpace,
+                        const Space<BasisFunctionType>& trialSpace,
+                        const std::vector<LocalAssemblerForIntegralOperators*>&
+                            assemblers,
+                        const Context<BasisFunctionType, ResultType>& context,
+                        int symmetry,
+                        const BlockCyclicLayout* layout,
+                        std::vector<arma::Mat<ResultType> >& results);
+                /** \endcond */
         };
 } // namespace Bempp
 
@@ -0,0 +1,115 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "discontinuous_space_cache.hpp"
+
+#include "../common/bounding_box.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../grid/grid.hpp"
+#include "../space/space.hpp"
+
+#include <boost/functional/hash.hpp>
+
+namespace Bempp {
+
+namespace {
+
+template <typename CoordinateType>
+void hashPoint(std::size_t &seed, const Point3D<CoordinateType> &point) {
+  boost::hash_combine(seed, point.x);
+  boost::hash_combine(seed, point.y);
+  boost::hash_combine(seed, point.z);
+}
+
+template <typename BasisFunctionType>
+std::size_t dofHash(const Space<BasisFunctionType> &space) {
+  typedef typename Space<BasisFunctionType>::CoordinateType CoordinateType;
+  const std::vector<BoundingBox<CoordinateType>> &boxes =
+      space.globalDofBoundingBoxes();
+  std::size_t seed = boxes.size();
+  for (const auto &box : boxes) {
+    hashPoint(seed, box.reference);
+    hashPoint(seed, box.lbound);
+    hashPoint(seed, box.ubound);
+  }
+  return seed;
+}
+
+} // namespace
+
+template <typename BasisFunctionType>
+shared_ptr<const Space<BasisFunctionType>>
+DiscontinuousSpaceCache<BasisFunctionType>::discontinuousSpace(
+    const shared_ptr<const SpaceType> &space) {
+  if (!space)
+    throw std::invalid_argument(
+        "DiscontinuousSpaceCache::discontinuousSpace(): "
+        "space must not be null");
+  shared_ptr<const SpaceType> result = space->discontinuousSpace(space);
+  shared_ptr<const Grid> grid = result->grid();
+  Key key(grid.get(), static_cast<int>(result->spaceIdentifier()));
+  Entry newEntry;
+  newEntry.grid = grid;
+  newEntry.space = result;
+  newEntry.globalDofCount = result->globalDofCount();
+  newEntry.dofHash = dofHash(*result);
+
+  tbb::mutex::scoped_lock lock(m_mutex);
+  removeExpiredEntries();
+  typedef typename EntryMap::const_iterator Iterator;
+  std::pair<Iterator, Iterator> range = m_entries.equal_range(key);
+  for (Iterator it = range.first; it != range.second; ++it) {
+    const Entry &entry = it->second;
+    shared_ptr<const SpaceType> cached = entry.space.lock();
+    if (cached && entry.grid.lock() == grid &&
+        entry.globalDofCount == newEntry.globalDofCount &&
+        entry.dofHash == newEntry.dofHash)
+      return cached;
+  }
+  m_entries.insert(std::make_pair(key, newEntry));
+  return result;
+}
+
+template <typename BasisFunctionType>
+void DiscontinuousSpaceCache<BasisFunctionType>::clear() {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  m_entries.clear();
+}
+
+template <typename BasisFunctionType>
+std::size_t DiscontinuousSpaceCache<BasisFunctionType>::size() const {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  return m_entries.size();
+}
+
+template <typename BasisFunctionType>
+void DiscontinuousSpaceCache<BasisFunctionType>::removeExpiredEntries() {
+  for (typename EntryMap::iterator it = m_entries.begin();
+       it != m_entries.end();) {
+    if (it->second.space.expired() || it->second.grid.expired())
+      m_entries.erase(it++);
+    else
+      ++it;
+  }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(DiscontinuousSpaceCache);
+
+} // namespace Bempp
@@ -0,0 +1,95 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_discontinuous_space_cache_hpp
+#define bempp_discontinuous_space_cache_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <boost/weak_ptr.hpp>
+#include <tbb/mutex.h>
+#include <map>
+#include <utility>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class Grid;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Cache of the discontinuous spaces in which the internal operators
+ *  of synthetic operators are discretised.
+ *
+ *  Space::discontinuousSpace() constructs a new discontinuous space for
+ *  every space, so internal operators built for different spaces on the
+ *  same grid have different domains and cannot share a weak form. This
+ *  cache returns the same discontinuous space for all spaces whose
+ *  discontinuous spaces are defined on the same grid, have the same
+ *  identifier and the same global DOFs. The latter are compared by the
+ *  number and bounding boxes of the DOFs, which distinguishes spaces
+ *  restricted to different segments of the grid.
+ *
+ *  Only weak pointers to the spaces are stored, so a discontinuous space
+ *  is destroyed when the last operator using it is.
+ *
+ *  Every Context owns one cache, which is shared by its copies. */
+template <typename BasisFunctionType> class DiscontinuousSpaceCache {
+public:
+  typedef Space<BasisFunctionType> SpaceType;
+
+  /** \brief Return a discontinuous space containing expansions of the basis
+   *  functions of \p space, in the sense of Space::discontinuousSpace().
+   *
+   *  If an equivalent discontinuous space is in the cache and still alive,
+   *  it is returned; otherwise <tt>space->discontinuousSpace(space)</tt> is
+   *  stored in the cache and returned. */
+  shared_ptr<const SpaceType>
+  discontinuousSpace(const shared_ptr<const SpaceType> &space);
+
+  /** \brief Remove all entries. */
+  void clear();
+
+  /** \brief Return the number of entries. */
+  std::size_t size() const;
+
+private:
+  /** \cond PRIVATE */
+  typedef std::pair<const Grid *, int> Key;
+  struct Entry {
+    boost::weak_ptr<const Grid> grid;
+    boost::weak_ptr<const SpaceType> space;
+    std::size_t globalDofCount;
+    std::size_t dofHash;
+  };
+  typedef std::multimap<Key, Entry> EntryMap;
+
+  void removeExpiredEntries();
+
+  EntryMap m_entries;
+  mutable tbb::mutex m_mutex;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
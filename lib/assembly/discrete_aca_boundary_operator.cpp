@@ -32,6 +32,7 @@
 #include "../common/complex_aux.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -40,8 +41,8 @@
 
 #include <tbb/blocked_range.h>
 #include <tbb/concurrent_queue.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_reduce.h>
-#include <tbb/task_scheduler_init.h>
 
 #ifdef WITH_TRILINOS
 #include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
@@ -147,6 +148,43 @@ private:
   std::vector<ChunkStatistics> &m_stats;
 };
 
+// Multiply the leaves below bc by x and add the result to y. Sons of bc in
+// different block rows (block columns for transposed products) write to
+// disjoint parts of y and are processed concurrently; sons sharing a block
+// row are processed one after the other by the same task.
+template <typename ValueType>
+void multiplyRowPartitioned(
+    TranspositionMode trans, ValueType multiplier, const blcluster *bc,
+    mblock<typename AhmedTypeTraits<ValueType>::Type> **blocks, ValueType *x,
+    ValueType *y) {
+  if (bc->isleaf()) {
+    mblock<typename AhmedTypeTraits<ValueType>::Type> *block =
+        blocks[bc->getidx()];
+    if (trans == NO_TRANSPOSE)
+      block->mltaVec(ahmedCast(multiplier), ahmedCast(x + bc->getb2()),
+                     ahmedCast(y + bc->getb1()));
+    else if (trans == TRANSPOSE)
+      block->mltatVec(ahmedCast(multiplier), ahmedCast(x + bc->getb1()),
+                      ahmedCast(y + bc->getb2()));
+    else // trans == CONJUGATE_TRANSPOSE
+      block->mltahVec(ahmedCast(multiplier), ahmedCast(x + bc->getb1()),
+                      ahmedCast(y + bc->getb2()));
+    return;
+  }
+
+  const bool transposed = (trans != NO_TRANSPOSE);
+  const unsigned outputSonCount = transposed ? bc->getncs() : bc->getnrs();
+  const unsigned inputSonCount = transposed ? bc->getnrs() : bc->getncs();
+  tbb::parallel_for(0u, outputSonCount, [&](unsigned output) {
+    for (unsigned input = 0; input < inputSonCount; ++input) {
+      const blcluster *son =
+          transposed ? bc->getson(input, output) : bc->getson(output, input);
+      if (son)
+        multiplyRowPartitioned(trans, multiplier, son, blocks, x, y);
+    }
+  });
+}
+
 bool areEqual(const blcluster *op1, const blcluster *op2) {
   if (!op1 || !op2)
     return (!op1 && !op2);
@@ -221,7 +259,8 @@ DiscreteAcaBoundaryOperator<ValueType>::DiscreteAcaBoundaryOperator(
       m_domainPermutation(domainPermutation_),
       m_rangePermutation(rangePermutation_),
       m_parallelizationOptions(parallelizationOptions_),
-      m_sharedBlocks(sharedBlocks_) {
+      m_sharedBlocks(sharedBlocks_),
+      m_matvecMode(AcaOptions().matvecMode) {
   if (eps_ <= 0 || eps_ > 1)
     std::cout << "DiscreteAcaBoundaryOperator::DiscreteAcaBoundaryOperator(): "
                  "warning: suspicious value of eps (" << eps_ << ")"
@@ -254,7 +293,8 @@ DiscreteAcaBoundaryOperator<ValueType>::DiscreteAcaBoundaryOperator(
       m_domainPermutation(domainPermutation_),
       m_rangePermutation(rangePermutation_),
       m_parallelizationOptions(parallelizationOptions_),
-      m_sharedBlocks(sharedBlocks_) {
+      m_sharedBlocks(sharedBlocks_),
+      m_matvecMode(AcaOptions().matvecMode) {
 }
 
 template <typename ValueType>
@@ -279,7 +319,8 @@ DiscreteAcaBoundaryOperator<ValueType>::DiscreteAcaBoundaryOperator(
       m_domainPermutation(domainPermutation_),
       m_rangePermutation(rangePermutation_),
       m_parallelizationOptions(parallelizationOptions_),
-      m_sharedBlocks(sharedBlocks_) {
+      m_sharedBlocks(sharedBlocks_),
+      m_matvecMode(AcaOptions().matvecMode) {
 }
 
 template <typename ValueType>
@@ -391,9 +432,8 @@ DiscreteAcaBoundaryOperator<ValueType>::range() const {
 template <typename ValueType>
 bool DiscreteAcaBoundaryOperator<ValueType>::opSupportedImpl(
     Thyra::EOpTransp M_trans) const {
-  // TODO: implement remaining variant (conjugate)
   return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
-          M_trans == Thyra::CONJTRANS);
+          M_trans == Thyra::CONJ || M_trans == Thyra::CONJTRANS);
 }
 #endif // WITH_TRILINOS
 
@@ -402,12 +442,20 @@ void DiscreteAcaBoundaryOperator<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
+  if (trans == CONJUGATE) {
+    // alpha conj(A) x + beta y = conj(conj(alpha) A conj(x) + conj(beta)
+    // conj(y))
+    const arma::Col<ValueType> x = arma::conj(x_in);
+    arma::Col<ValueType> y = arma::conj(y_inout);
+    applyBuiltInImpl(NO_TRANSPOSE, x, y, conj(alpha), conj(beta));
+    y_inout = arma::conj(y);
+    return;
+  }
   if (trans != NO_TRANSPOSE && trans != TRANSPOSE &&
       trans != CONJUGATE_TRANSPOSE)
     throw std::runtime_error(
         "DiscreteAcaBoundaryOperator::applyBuiltInImpl(): "
-        "transposition modes other than NO_TRANSPOSE, TRANSPOSE and "
-        "CONJUGATE_TRANSPOSE are not supported");
+        "invalid transposition mode");
   bool transposed = (trans & TRANSPOSE);
 
   const blcluster *blockCluster = m_blockCluster.get();
@@ -477,19 +525,27 @@ void DiscreteAcaBoundaryOperator<ValueType>::applyBuiltInImpl(
     //                        ahmedCast(permutedArgument.memptr()),
     //                        ahmedCast(permutedResult.memptr()));
 
-    AhmedLeafClusterArray leafClusters(nonconstBlockCluster);
-    leafClusters.sortAccordingToClusterSize();
-    const size_t leafClusterCount = leafClusters.size();
-
     int maxThreadCount = 1;
-    if (!m_parallelizationOptions.isOpenClEnabled()) {
-      if (m_parallelizationOptions.maxThreadCount() ==
-          ParallelizationOptions::AUTO)
-        maxThreadCount = tbb::task_scheduler_init::automatic;
+    if (!m_parallelizationOptions.isOpenClEnabled())
+      maxThreadCount = m_parallelizationOptions.maxThreadCount();
+
+    if (m_matvecMode == AcaOptions::ROW_PARTITIONED_MATVEC) {
+      Fiber::SerialBlasRegion region;
+      Fiber::executeInTaskArena(maxThreadCount, [&] {
+        multiplyRowPartitioned(trans, alpha, blockCluster, m_blocks.get(),
+                               permutedArgument.memptr(),
+                               permutedResult.memptr());
+      });
+      if (!transposed)
+        m_rangePermutation.unpermuteVector(permutedResult, y_inout);
       else
-        maxThreadCount = m_parallelizationOptions.maxThreadCount();
+        m_domainPermutation.unpermuteVector(permutedResult, y_inout);
+      return;
     }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+
+    AhmedLeafClusterArray leafClusters(nonconstBlockCluster);
+    leafClusters.sortAccordingToClusterSize();
+    const size_t leafClusterCount = leafClusters.size();
 
     std::vector<ChunkStatistics> chunkStats(leafClusterCount);
 
@@ -505,8 +561,10 @@ void DiscreteAcaBoundaryOperator<ValueType>::applyBuiltInImpl(
               m_blocks, leafClusterIndexQueue, chunkStats);
     {
       Fiber::SerialBlasRegion region;
-      tbb::parallel_reduce(tbb::blocked_range<size_t>(0, leafClusterCount),
-                           body);
+      Fiber::executeInTaskArena(maxThreadCount, [&] {
+        tbb::parallel_reduce(tbb::blocked_range<size_t>(0, leafClusterCount),
+                             body);
+      });
     }
     permutedResult = body.m_local_y;
   }
@@ -581,6 +639,21 @@ DiscreteAcaBoundaryOperator<ValueType>::parallelizationOptions() const {
   return m_parallelizationOptions;
 }
 
+template <typename ValueType>
+void DiscreteAcaBoundaryOperator<ValueType>::setMatvecMode(
+    AcaOptions::AcaMatvecMode mode) {
+  if (mode < AcaOptions::MIN_MATVEC_MODE || mode > AcaOptions::MAX_MATVEC_MODE)
+    throw std::invalid_argument(
+        "DiscreteAcaBoundaryOperator::setMatvecMode(): invalid mode");
+  m_matvecMode = mode;
+}
+
+template <typename ValueType>
+AcaOptions::AcaMatvecMode
+DiscreteAcaBoundaryOperator<ValueType>::matvecMode() const {
+  return m_matvecMode;
+}
+
 template <typename ValueType>
 std::vector<
     typename DiscreteAcaBoundaryOperator<ValueType>::AhmedConstMblockArray>
@@ -633,12 +706,13 @@ acaOperatorSum(const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op1,
   copyH(nonConstSumBlockCluster, acaOp1->m_blocks.get(), sumBlocks.get());
   addGeHGeH(nonConstSumBlockCluster, sumBlocks.get(), acaOp2->m_blocks.get(),
             eps, maximumRank);
-  shared_ptr<const DiscreteBoundaryOperator<ValueType>> result(
+  shared_ptr<DiscreteAcaBoundaryOperator<ValueType>> result(
       new DiscreteAcaBoundaryOperator<ValueType>(
           acaOp1->rowCount(), acaOp1->columnCount(), eps, maximumRank,
           acaOp1->m_symmetry & acaOp2->m_symmetry, sumBlockCluster, sumBlocks,
           acaOp1->m_domainPermutation, acaOp2->m_rangePermutation,
           acaOp1->m_parallelizationOptions));
+  result->setMatvecMode(acaOp1->matvecMode());
   return result;
 }
 
@@ -704,12 +778,13 @@ shared_ptr<const DiscreteBoundaryOperator<ValueType>> scaledAcaOperator(
   int scaledSymmetry = symmetry;
   if (imagPart(multiplier) != 0.)
     scaledSymmetry &= ~HERMITIAN;
-  shared_ptr<const DiscreteBoundaryOperator<ValueType>> result(
+  shared_ptr<DiscreteAcaBoundaryOperator<ValueType>> result(
       new DiscreteAcaBoundaryOperator<ValueType>(
           acaOp->rowCount(), acaOp->columnCount(), acaOp->eps(),
           acaOp->maximumRank(), scaledSymmetry, scaledBlockCluster,
           scaledBlocks, acaOp->domainPermutation(), acaOp->rangePermutation(),
           acaOp->parallelizationOptions()));
+  result->setMatvecMode(acaOp->matvecMode());
   return result;
 }
 
@@ -384,6 +384,15 @@ public:
    *  multiply. */
   const ParallelizationOptions &parallelizationOptions() const;
 
+  /** \brief Select the algorithm used by apply() to multiply non-symmetric
+   *  H-matrices by vectors.
+   *
+   *  See AcaOptions::matvecMode. */
+  void setMatvecMode(AcaOptions::AcaMatvecMode mode);
+
+  /** \brief Return the algorithm used by apply(). */
+  AcaOptions::AcaMatvecMode matvecMode() const;
+
   /** \brief Return the vector of mblock arrays that this operator implicitly
    *  depends on. */
   std::vector<AhmedConstMblockArray> sharedBlocks() const;
@@ -424,6 +433,7 @@ private:
   IndexPermutation m_rangePermutation;
   ParallelizationOptions m_parallelizationOptions;
   std::vector<AhmedConstMblockArray> m_sharedBlocks;
+  AcaOptions::AcaMatvecMode m_matvecMode;
   /** \endcond */
 };
 
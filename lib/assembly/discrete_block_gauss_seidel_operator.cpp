@@ -0,0 +1,162 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "discrete_block_gauss_seidel_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename ValueType>
+DiscreteBlockGaussSeidelOperator<ValueType>::DiscreteBlockGaussSeidelOperator(
+    const shared_ptr<const DiscreteBlockedBoundaryOperator<ValueType>> &op,
+    const std::vector<shared_ptr<const Base>> &diagonalInverses,
+    bool symmetric)
+    : m_op(op), m_diagonalInverses(diagonalInverses), m_symmetric(symmetric) {
+  if (!m_op)
+    throw std::invalid_argument("DiscreteBlockGaussSeidelOperator::"
+                                "DiscreteBlockGaussSeidelOperator(): "
+                                "op must not be NULL");
+  const size_t n = m_diagonalInverses.size();
+  if (m_op->blockRowCount() != n || m_op->blockColumnCount() != n)
+    throw std::invalid_argument("DiscreteBlockGaussSeidelOperator::"
+                                "DiscreteBlockGaussSeidelOperator(): "
+                                "op must have one block row and column per "
+                                "diagonal inverse");
+  m_rowOffsets.resize(n + 1, 0);
+  m_columnOffsets.resize(n + 1, 0);
+  for (size_t i = 0; i < n; ++i) {
+    if (!m_diagonalInverses[i])
+      throw std::invalid_argument("DiscreteBlockGaussSeidelOperator::"
+                                  "DiscreteBlockGaussSeidelOperator(): "
+                                  "diagonal inverses must not be NULL");
+    m_rowOffsets[i + 1] =
+        m_rowOffsets[i] + m_diagonalInverses[i]->columnCount();
+    m_columnOffsets[i + 1] =
+        m_columnOffsets[i] + m_diagonalInverses[i]->rowCount();
+  }
+  if (m_rowOffsets[n] != m_op->rowCount() ||
+      m_columnOffsets[n] != m_op->columnCount())
+    throw std::invalid_argument("DiscreteBlockGaussSeidelOperator::"
+                                "DiscreteBlockGaussSeidelOperator(): "
+                                "dimensions of the diagonal inverses do not "
+                                "match those of op");
+}
+
+template <typename ValueType>
+unsigned int DiscreteBlockGaussSeidelOperator<ValueType>::rowCount() const {
+  return m_op->columnCount();
+}
+
+template <typename ValueType>
+unsigned int DiscreteBlockGaussSeidelOperator<ValueType>::columnCount() const {
+  return m_op->rowCount();
+}
+
+template <typename ValueType>
+void DiscreteBlockGaussSeidelOperator<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {
+  throw std::runtime_error("DiscreteBlockGaussSeidelOperator::addBlock(): "
+                           "not implemented");
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteBlockGaussSeidelOperator<ValueType>::domain() const {
+  return m_op->range();
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteBlockGaussSeidelOperator<ValueType>::range() const {
+  return m_op->domain();
+}
+
+template <typename ValueType>
+bool DiscreteBlockGaussSeidelOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return M_trans == Thyra::NOTRANS;
+}
+#endif // WITH_TRILINOS
+
+template <typename ValueType>
+void DiscreteBlockGaussSeidelOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteBlockGaussSeidelOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  if (trans != NO_TRANSPOSE)
+    throw std::invalid_argument("DiscreteBlockGaussSeidelOperator::"
+                                "applyBuiltInBlockImpl(): "
+                                "only NO_TRANSPOSE is supported");
+  if (x_in.n_rows != columnCount() || y_inout.n_rows != rowCount())
+    throw std::invalid_argument("DiscreteBlockGaussSeidelOperator::"
+                                "applyBuiltInBlockImpl(): "
+                                "incorrect vector length");
+
+  const size_t n = m_diagonalInverses.size();
+  arma::Mat<ValueType> y(rowCount(), x_in.n_cols, arma::fill::zeros);
+  for (size_t i = 0; i < n; ++i)
+    updateBlock(i, 0, i, x_in, y);
+  if (m_symmetric)
+    for (size_t i = n; i-- > 0;)
+      updateBlock(i, 0, n, x_in, y);
+
+  if (beta == static_cast<ValueType>(0.))
+    y_inout = alpha * y;
+  else
+    y_inout = alpha * y + beta * y_inout;
+}
+
+template <typename ValueType>
+void DiscreteBlockGaussSeidelOperator<ValueType>::updateBlock(
+    size_t i, size_t begin, size_t end, const arma::Mat<ValueType> &x,
+    arma::Mat<ValueType> &y) const {
+  arma::Mat<ValueType> residual =
+      x.rows(m_rowOffsets[i], m_rowOffsets[i + 1] - 1);
+  for (size_t j = begin; j < end; ++j) {
+    shared_ptr<const Base> block = m_op->getComponent(i, j);
+    if (j == i || !block)
+      continue;
+    const arma::Mat<ValueType> yj =
+        y.rows(m_columnOffsets[j], m_columnOffsets[j + 1] - 1);
+    block->apply(NO_TRANSPOSE, yj, residual, -1., 1.);
+  }
+  arma::Mat<ValueType> yi(m_columnOffsets[i + 1] - m_columnOffsets[i],
+                          x.n_cols);
+  m_diagonalInverses[i]->apply(NO_TRANSPOSE, residual, yi, 1., 0.);
+  y.rows(m_columnOffsets[i], m_columnOffsets[i + 1] - 1) = yi;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteBlockGaussSeidelOperator);
+
+} // namespace Bempp
@@ -0,0 +1,121 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_discrete_block_gauss_seidel_operator_hpp
+#define bempp_discrete_block_gauss_seidel_operator_hpp
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "../common/common.hpp"
+
+#include "discrete_blocked_boundary_operator.hpp"
+
+#include "../common/shared_ptr.hpp"
+
+#include <vector>
+
+#ifdef WITH_TRILINOS
+#include <Teuchos_RCP.hpp>
+#endif
+
+namespace Bempp {
+
+/** \ingroup composite_discrete_boundary_operators
+ *  \brief Block Gauss-Seidel sweep over a blocked operator.
+ *
+ *  Given a square DiscreteBlockedBoundaryOperator \f$A\f$ with blocks
+ *  \f$A_{ij}\f$ and approximate inverses \f$D_i^{-1}\f$ of its diagonal
+ *  blocks, this operator maps \f$x\f$ to the result \f$y\f$ of one forward
+ *  block Gauss-Seidel sweep for \f$A y = x\f$ started from zero,
+ *  \f[ y_i = D_i^{-1} \Bigl(x_i - \sum_{j < i} A_{ij} y_j\Bigr),
+ *      \quad i = 1, \dots, n, \f]
+ *  followed, if \p symmetric is true, by a backward sweep using the
+ *  blocks above the diagonal. It is meant as a preconditioner for
+ *  multi-domain problems: the blocks coupling different subdomains are only
+ *  applied, which is cheap since those between distant subdomains compress
+ *  to very low rank, and null blocks are skipped. Only the operator itself,
+ *  not its transpose, can be applied. */
+template <typename ValueType>
+class DiscreteBlockGaussSeidelOperator
+    : public DiscreteBoundaryOperator<ValueType> {
+public:
+  typedef DiscreteBoundaryOperator<ValueType> Base;
+
+  /** \brief Constructor.
+   *
+   *  \param[in] op
+   *    Blocked operator with as many block rows as block columns.
+   *  \param[in] diagonalInverses
+   *    Approximate inverses of the diagonal blocks of \p op, e.g. built by
+   *    hMatOperatorApproximateLuInverse().
+   *  \param[in] symmetric
+   *    If true, a backward sweep follows the forward sweep. */
+  DiscreteBlockGaussSeidelOperator(
+      const shared_ptr<const DiscreteBlockedBoundaryOperator<ValueType>> &op,
+      const std::vector<shared_ptr<const Base>> &diagonalInverses,
+      bool symmetric = false);
+
+  virtual unsigned int rowCount() const;
+  virtual unsigned int columnCount() const;
+
+  virtual void addBlock(const std::vector<int> &rows,
+                        const std::vector<int> &cols, const ValueType alpha,
+                        arma::Mat<ValueType> &block) const;
+
+#ifdef WITH_TRILINOS
+public:
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+#endif
+
+private:
+  virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                const arma::Col<ValueType> &x_in,
+                                arma::Col<ValueType> &y_inout,
+                                const ValueType alpha,
+                                const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
+
+  // y_i = D_i^{-1} (x_i - sum_{j != i, j in [begin, end)} A_ij y_j)
+  void updateBlock(size_t i, size_t begin, size_t end,
+                   const arma::Mat<ValueType> &x,
+                   arma::Mat<ValueType> &y) const;
+
+private:
+  /** \cond PRIVATE */
+  shared_ptr<const DiscreteBlockedBoundaryOperator<ValueType>> m_op;
+  std::vector<shared_ptr<const Base>> m_diagonalInverses;
+  bool m_symmetric;
+  // Offsets of the block rows of op in x and of its block columns in y
+  std::vector<size_t> m_rowOffsets;
+  std::vector<size_t> m_columnOffsets;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -24,6 +24,7 @@
 #include "discrete_blocked_boundary_operator.hpp"
 
 #include "discrete_aca_boundary_operator.hpp"
+#include "discrete_hmat_boundary_operator.hpp"
 #ifdef WITH_AHMED
 #include "ahmed_aux.hpp"
 #endif
@@ -32,6 +33,8 @@
 #include "../fiber/explicit_instantiation.hpp"
 
 #include <numeric>
+#include <tbb/parallel_for.h>
+
 #ifdef WITH_TRILINOS
 #include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
 #endif // WITH_TRILINOS
@@ -512,6 +515,16 @@ DiscreteBlockedBoundaryOperator<ValueType>::getComponent(int row,
   return m_blocks(row, col);
 }
 
+template <typename ValueType>
+size_t DiscreteBlockedBoundaryOperator<ValueType>::blockRowCount() const {
+  return m_rowCounts.size();
+}
+
+template <typename ValueType>
+size_t DiscreteBlockedBoundaryOperator<ValueType>::blockColumnCount() const {
+  return m_columnCounts.size();
+}
+
 template <typename ValueType>
 void DiscreteBlockedBoundaryOperator<ValueType>::addBlock(
     const std::vector<int> &rows, const std::vector<int> &cols,
@@ -530,13 +543,16 @@ DiscreteBlockedBoundaryOperator<
   size_t nrows = m_blocks.extent(0);
   size_t ncols = m_blocks.extent(1);
   Fiber::_2dArray<shared_ptr<const Base>> acaBlocks(nrows, ncols);
-  for (size_t i = 0; i < nrows; i++) {
-    for (size_t j = 0; j < ncols; j++) {
-      if (m_blocks(i, j).get() != 0)
-        acaBlocks(i, j) =
-            m_blocks(i, j)->asDiscreteAcaBoundaryOperator(eps, maximumRank);
-    }
-  }
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, nrows * ncols, 1),
+      [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t k = r.begin(); k != r.end(); ++k) {
+          const size_t i = k / ncols, j = k % ncols;
+          if (m_blocks(i, j).get() != 0)
+            acaBlocks(i, j) = m_blocks(i, j)
+                ->asDiscreteAcaBoundaryOperator(eps, maximumRank);
+        }
+      });
   return shared_ptr<const DiscreteBlockedBoundaryOperator<ValueType>>(
       new DiscreteBlockedBoundaryOperator(acaBlocks, m_rowCounts,
                                           m_columnCounts));
@@ -643,22 +659,31 @@ void DiscreteBlockedBoundaryOperator<ValueType>::mergeHMatrices(
       for (size_t rb = 0, i = 0; rb < rowBlockCount; ++rb) {
         unsigned b2 = result->getb2();
         for (size_t cb = 0; cb < colBlockCount; ++cb, ++i) {
-          std::unique_ptr<AhmedBemBlcluster> branch(new AhmedBemBlcluster(
-              b1, b2, blockRowCount[rb], blockColCount[cb]));
-          if (clusters(rb, cb))
-            copySonsAdjustingIndices<ValueType>(clusters(rb, cb), branch.get(),
-                                                indexOffsets(rb, cb));
-          else {
-            branch->setidx(indexOffsets(rb, cb));
-            branch->setadm(true); // unsure about it
-            branch->setsep(true); // unsure about it
-          }
-          checkConsistency(branch.get());
+          branches[i] = new AhmedBemBlcluster(b1, b2, blockRowCount[rb],
+                                              blockColCount[cb]);
           b2 += blockColCount[cb];
-          branches[i] = branch.release();
         }
         b1 += blockRowCount[rb];
       }
+      // The trees of the individual blocks are independent, so they are
+      // copied concurrently, one task per block
+      tbb::parallel_for(
+          tbb::blocked_range<size_t>(0, branches.size(), 1),
+          [&](const tbb::blocked_range<size_t> &r) {
+            for (size_t i = r.begin(); i != r.end(); ++i) {
+              const size_t rb = i / colBlockCount, cb = i % colBlockCount;
+              blcluster *branch = branches[i];
+              if (clusters(rb, cb))
+                copySonsAdjustingIndices<ValueType>(clusters(rb, cb), branch,
+                                                    indexOffsets(rb, cb));
+              else {
+                branch->setidx(indexOffsets(rb, cb));
+                branch->setadm(true); // unsure about it
+                branch->setsep(true); // unsure about it
+              }
+              checkConsistency(branch);
+            }
+          });
       result->setsons(rowBlockCount, colBlockCount, &branches[0]);
       checkConsistency(result);
     }
@@ -687,14 +712,22 @@ DiscreteBlockedBoundaryOperator<ValueType>::asDiscreteAcaBoundaryOperator(
   typedef typename AcaOp::AhmedMblockArray AhmedMblockArray;
   typedef typename AcaOp::AhmedConstMblockArray AhmedConstMblockArray;
 
-  // Convert blocks into ACA operators
+  // Convert blocks into ACA operators. Conversions of non-ACA blocks (e.g.
+  // sums of H-matrices) are expensive and independent of each other, so
+  // every block gets its own task.
   Fiber::_2dArray<shared_ptr<const AcaOp>> acaBlocks(rowBlockCount,
                                                      colBlockCount);
-  for (size_t col = 0; col < colBlockCount; ++col)
-    for (size_t row = 0; row < rowBlockCount; ++row)
-      if (m_blocks(row, col))
-        acaBlocks(row, col) = boost::shared_dynamic_cast<const AcaOp>(m_blocks(
-            row, col)->asDiscreteAcaBoundaryOperator(eps, maximumRank));
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, rowBlockCount * colBlockCount, 1),
+      [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          const size_t row = i % rowBlockCount, col = i / rowBlockCount;
+          if (m_blocks(row, col))
+            acaBlocks(row, col) = boost::shared_dynamic_cast<const AcaOp>(
+                m_blocks(row, col)
+                    ->asDiscreteAcaBoundaryOperator(eps, maximumRank));
+        }
+      });
   // else: perhaps create a new "empty" aca operator
 
   Fiber::_2dArray<const blcluster *> blockClusters(rowBlockCount,
@@ -784,6 +817,37 @@ DiscreteBlockedBoundaryOperator<ValueType>::asDiscreteAcaBoundaryOperator(
 #endif
 }
 
+template <typename ValueType>
+shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+DiscreteBlockedBoundaryOperator<ValueType>::asDiscreteHMatBoundaryOperator(
+    int maxThreadCount) const {
+  typedef DiscreteHMatBoundaryOperator<ValueType> HMatOp;
+  typedef hmat::DefaultHMatrixType<ValueType> HMatrix;
+
+  const size_t rowBlockCount = m_blocks.extent(0);
+  const size_t colBlockCount = m_blocks.extent(1);
+  std::vector<std::vector<shared_ptr<const HMatrix>>> hMatrices(
+      rowBlockCount, std::vector<shared_ptr<const HMatrix>>(colBlockCount));
+  for (size_t row = 0; row < rowBlockCount; ++row)
+    for (size_t col = 0; col < colBlockCount; ++col) {
+      if (!m_blocks(row, col))
+        continue;
+      shared_ptr<const HMatOp> hMatBlock =
+          boost::dynamic_pointer_cast<const HMatOp>(m_blocks(row, col));
+      if (!hMatBlock || hMatBlock->hMatDofOrdering() ||
+          hMatBlock->nearFieldOnly())
+        throw std::invalid_argument(
+            "DiscreteBlockedBoundaryOperator::"
+            "asDiscreteHMatBoundaryOperator(): block (" +
+            toString(row) + ", " + toString(col) +
+            ") is not an H-matrix operator in original DOF ordering");
+      hMatrices[row][col] = hMatBlock->hMatrix();
+    }
+
+  shared_ptr<HMatrix> merged = HMatrix::merge(hMatrices, maxThreadCount);
+  return boost::make_shared<HMatOp>(merged);
+}
+
 #ifdef WITH_TRILINOS
 template <typename ValueType>
 Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
@@ -808,44 +872,107 @@ bool DiscreteBlockedBoundaryOperator<ValueType>::opSupportedImpl(
 }
 #endif // WITH_TRILINOS
 
+namespace {
+
+// Body of parallel loop over the non-null blocks. Each block is applied to
+// its chunk of x and writes alpha * op * x to its own chunk of the partial
+// results; the partial results are summed row by row afterwards.
+
+template <typename ValueType> class BlockApplyLoopBody {
+public:
+  typedef DiscreteBoundaryOperator<ValueType> Op;
+
+  struct BlockTask {
+    shared_ptr<const Op> op;
+    size_t xStart, xSize;
+    // Partial result of this block
+    arma::Mat<ValueType> y;
+  };
+
+  BlockApplyLoopBody(TranspositionMode trans, const arma::Mat<ValueType> &x,
+                     ValueType alpha, std::vector<BlockTask> &tasks)
+      : m_trans(trans), m_x(x), m_alpha(alpha), m_tasks(tasks) {}
+
+  void operator()(const tbb::blocked_range<size_t> &r) const {
+    for (size_t i = r.begin(); i != r.end(); ++i) {
+      BlockTask &task = m_tasks[i];
+      task.y.fill(0.);
+      const arma::Mat<ValueType> x =
+          m_x.rows(task.xStart, task.xStart + task.xSize - 1);
+      task.op->apply(m_trans, x, task.y, m_alpha, 0.);
+    }
+  }
+
+private:
+  TranspositionMode m_trans;
+  const arma::Mat<ValueType> &m_x;
+  ValueType m_alpha;
+  std::vector<BlockTask> &m_tasks;
+};
+
+} // namespace
+
 template <typename ValueType>
 void DiscreteBlockedBoundaryOperator<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteBlockedBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
   bool transpose = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
   size_t y_count = transpose ? m_columnCounts.size() : m_rowCounts.size();
   size_t x_count = transpose ? m_rowCounts.size() : m_columnCounts.size();
 
-  for (int yi = 0, y_start = 0; yi < y_count; ++yi) {
+  // Collect one task per non-null block; tasks of the same block row are
+  // stored contiguously, starting at rowTaskStarts[yi]
+  typedef BlockApplyLoopBody<ValueType> Body;
+  typedef typename Body::BlockTask BlockTask;
+  std::vector<BlockTask> tasks;
+  std::vector<size_t> rowTaskStarts(y_count + 1, 0);
+  for (size_t yi = 0; yi < y_count; ++yi) {
     size_t y_chunk_size = transpose ? m_columnCounts[yi] : m_rowCounts[yi];
-    arma::Col<ValueType> y_chunk(&y_inout[y_start], y_chunk_size,
-                                 false /* copy_aux_mem */);
-    for (int xi = 0, x_start = 0; xi < x_count; ++xi) {
+    for (size_t xi = 0, x_start = 0; xi < x_count; ++xi) {
       size_t x_chunk_size = transpose ? m_rowCounts[xi] : m_columnCounts[xi];
       shared_ptr<const Base> op =
           transpose ? m_blocks(xi, yi) : m_blocks(yi, xi);
-      //            arma::Col<ValueType> x_chunk(&x_in[colStart],
-      // m_columnCounts[col],
-      //                                         false /* copy_aux_mem */);
-      if (xi == 0) {
-        // This branch ensures that the "y += beta * y" part is done
-        if (op)
-          //                    op->apply(trans, x_chunk, y_chunk, alpha, beta);
-          op->apply(trans, x_in.rows(x_start, x_start + x_chunk_size - 1),
-                    y_chunk, alpha, beta);
-        else {
-          if (beta == static_cast<ValueType>(0.))
-            y_chunk.fill(0.);
-          else
-            y_chunk *= beta;
-        }
-      } else if (op)
-        //                    op->apply(trans, x_chunk, y_chunk, alpha, 1.);
-        op->apply(trans, x_in.rows(x_start, x_start + x_chunk_size - 1),
-                  y_chunk, alpha, 1.);
+      if (op) {
+        tasks.push_back(BlockTask());
+        tasks.back().op = op;
+        tasks.back().xStart = x_start;
+        tasks.back().xSize = x_chunk_size;
+        tasks.back().y.set_size(y_chunk_size, x_in.n_cols);
+      }
       x_start += x_chunk_size;
     }
+    rowTaskStarts[yi + 1] = tasks.size();
+  }
+
+  // Apply the blocks concurrently. The blocks may differ widely in cost
+  // (e.g. H-matrix vs. sparse blocks), so each task is scheduled on its own
+  // and left to work stealing to balance.
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, tasks.size(), 1),
+                    Body(trans, x_in, alpha, tasks));
+
+  // Reduce the partial results of each block row
+  for (size_t yi = 0, y_start = 0; yi < y_count; ++yi) {
+    size_t y_chunk_size = transpose ? m_columnCounts[yi] : m_rowCounts[yi];
+    if (y_chunk_size == 0)
+      continue;
+    arma::subview<ValueType> y_chunk =
+        y_inout.rows(y_start, y_start + y_chunk_size - 1);
+    // This ensures that the "y += beta * y" part is done
+    if (beta == static_cast<ValueType>(0.))
+      y_chunk.fill(0.);
+    else
+      y_chunk *= beta;
+    for (size_t t = rowTaskStarts[yi]; t < rowTaskStarts[yi + 1]; ++t)
+      y_chunk += tasks[t].y;
     y_start += y_chunk_size;
   }
 }
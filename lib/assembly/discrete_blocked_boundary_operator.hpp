@@ -37,6 +37,8 @@ class blcluster;
 
 namespace Bempp {
 
+template <typename ValueType> class DiscreteHMatBoundaryOperator;
+
 /** \ingroup discrete_boundary_operators
  *  \brief Discrete boundary operator composed of multiple blocks stored
  *separately.
@@ -84,6 +86,12 @@ public:
   virtual shared_ptr<const DiscreteBoundaryOperator<ValueType>>
   getComponent(int row, int col) const;
 
+  /** \brief Number of block rows. */
+  size_t blockRowCount() const;
+
+  /** \brief Number of block columns. */
+  size_t blockColumnCount() const;
+
   virtual void addBlock(const std::vector<int> &rows,
                         const std::vector<int> &cols, const ValueType alpha,
                         arma::Mat<ValueType> &block) const;
@@ -116,6 +124,20 @@ public:
   asDiscreteAcaBoundaryOperator(double eps = -1, int maximumRank = -1,
                                 bool interleave = false) const;
 
+  /** \brief Merge all blocks into a single H-matrix operator.
+   *
+   *  Every non-null block must be a DiscreteHMatBoundaryOperator acting in
+   *  the original DOF ordering; see hmat::HMatrix::merge() for the further
+   *  requirements on the blocks. The merged operator does not depend on
+   *  AHMED and can be passed to hMatOperatorApproximateLuInverse() to
+   *  obtain a single H-LU preconditioner for the whole blocked system.
+   *
+   *  \param[in] maxThreadCount
+   *    Maximum number of threads used to copy the blocks, or -1 to let TBB
+   *    decide. */
+  shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+  asDiscreteHMatBoundaryOperator(int maxThreadCount = -1) const;
+
 #ifdef WITH_TRILINOS
 public:
   virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
@@ -131,6 +153,11 @@ private:
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
 
 #ifdef WITH_AHMED
   void mergeHMatrices(unsigned currentLevel,
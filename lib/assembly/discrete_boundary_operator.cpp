@@ -31,10 +31,73 @@
 
 #include "../fiber/explicit_instantiation.hpp"
 
+#include <Thyra_DetachedMultiVectorView.hpp>
 #include <Thyra_DetachedSpmdVectorView.hpp>
 
+#include <boost/type_traits/is_complex.hpp>
+
 namespace Bempp {
 
+namespace {
+
+// Complex operators act on complex vectors directly
+template <typename ValueType>
+void applyToComplexBySplitting(const DiscreteBoundaryOperator<ValueType> &op,
+                               const TranspositionMode trans,
+                               const arma::Mat<ValueType> &x_in,
+                               arma::Mat<ValueType> &y_inout,
+                               const ValueType alpha, const ValueType beta,
+                               boost::true_type /* complex operator */) {
+  op.apply(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename RealType>
+void applyToComplexBySplitting(
+    const DiscreteBoundaryOperator<RealType> &op,
+    const TranspositionMode trans,
+    const arma::Mat<std::complex<RealType>> &x_in,
+    arma::Mat<std::complex<RealType>> &y_inout,
+    const std::complex<RealType> alpha, const std::complex<RealType> beta,
+    boost::false_type /* complex operator */) {
+  typedef std::complex<RealType> ComplexType;
+
+  // The operator is real, so conjugation does not affect it
+  const TranspositionMode realTrans =
+      (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE) ? TRANSPOSE
+                                                           : NO_TRANSPOSE;
+  const size_t colCount = x_in.n_cols;
+
+  // Apply the operator to the real and imaginary parts of all the columns
+  // at once, so that it is traversed only once
+  arma::Mat<RealType> x(x_in.n_rows, 2 * colCount);
+  for (size_t c = 0; c < colCount; ++c) {
+    const ComplexType *xCol = x_in.colptr(c);
+    RealType *xRe = x.colptr(c);
+    RealType *xIm = x.colptr(colCount + c);
+    for (size_t r = 0; r < x_in.n_rows; ++r) {
+      xRe[r] = xCol[r].real();
+      xIm[r] = xCol[r].imag();
+    }
+  }
+  arma::Mat<RealType> y(y_inout.n_rows, 2 * colCount);
+  op.apply(realTrans, x, y, 1., 0.);
+
+  // y_inout := alpha * (y_re + i * y_im) + beta * y_inout
+  for (size_t c = 0; c < colCount; ++c) {
+    const RealType *yRe = y.colptr(c);
+    const RealType *yIm = y.colptr(colCount + c);
+    ComplexType *yCol = y_inout.colptr(c);
+    if (beta == static_cast<ComplexType>(0.))
+      for (size_t r = 0; r < y_inout.n_rows; ++r)
+        yCol[r] = alpha * ComplexType(yRe[r], yIm[r]);
+    else
+      for (size_t r = 0; r < y_inout.n_rows; ++r)
+        yCol[r] = alpha * ComplexType(yRe[r], yIm[r]) + beta * yCol[r];
+  }
+}
+
+} // namespace
+
 template <typename ValueType>
 arma::Mat<ValueType> DiscreteBoundaryOperator<ValueType>::asMatrix() const {
   // Default brute-force implementation: apply operator to all basis vectors
@@ -74,6 +137,43 @@ void DiscreteBoundaryOperator<ValueType>::apply(
                                 "vectors x_in and y_inout must have "
                                 "the same number of columns");
 
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperator<ValueType>::applyToComplex(
+    const TranspositionMode trans, const arma::Mat<ComplexType> &x_in,
+    arma::Mat<ComplexType> &y_inout, const ComplexType alpha,
+    const ComplexType beta) const {
+  bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+  if (x_in.n_rows != (transposed ? rowCount() : columnCount()))
+    throw std::invalid_argument("DiscreteBoundaryOperator::applyToComplex(): "
+                                "vector x_in has invalid length");
+  if (y_inout.n_rows != (transposed ? columnCount() : rowCount()))
+    throw std::invalid_argument("DiscreteBoundaryOperator::applyToComplex(): "
+                                "vector y_inout has invalid length");
+  if (x_in.n_cols != y_inout.n_cols)
+    throw std::invalid_argument("DiscreteBoundaryOperator::applyToComplex(): "
+                                "vectors x_in and y_inout must have "
+                                "the same number of columns");
+
+  applyToComplexImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperator<ValueType>::applyToComplexImpl(
+    const TranspositionMode trans, const arma::Mat<ComplexType> &x_in,
+    arma::Mat<ComplexType> &y_inout, const ComplexType alpha,
+    const ComplexType beta) const {
+  applyToComplexBySplitting(*this, trans, x_in, y_inout, alpha, beta,
+                            typename boost::is_complex<ValueType>::type());
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
   for (size_t i = 0; i < x_in.n_cols; ++i) {
     const arma::Col<ValueType> x_in_col = x_in.unsafe_col(i);
     arma::Col<ValueType> y_inout_col = y_inout.unsafe_col(i);
@@ -122,6 +222,24 @@ void DiscreteBoundaryOperator<ValueType>::applyImpl(
 
   const Ordinal colCount = X_in.domain()->dim();
 
+  if (colCount > 1) {
+    // If both multivectors are stored contiguously, wrap them in Armadillo
+    // matrices and apply the operator to the whole block at once
+    Thyra::ConstDetachedMultiVectorView<ValueType> xView(X_in);
+    Thyra::DetachedMultiVectorView<ValueType> yView(*Y_inout);
+    if (xView.leadingDim() == xView.subDim() &&
+        yView.leadingDim() == yView.subDim()) {
+      const arma::Mat<ValueType> xMat(
+          const_cast<ValueType *>(xView.values().get()), xView.subDim(),
+          xView.numSubCols(), false /* copy_aux_mem */);
+      arma::Mat<ValueType> yMat(yView.values().get(), yView.subDim(),
+                                yView.numSubCols(), false);
+      applyBuiltInBlockImpl(static_cast<TranspositionMode>(M_trans), xMat,
+                            yMat, alpha, beta);
+      return;
+    }
+  }
+
   // Loop over the input columns
 
   for (Ordinal col = 0; col < colCount; ++col) {
@@ -27,6 +27,8 @@
 #include "../common/shared_ptr.hpp"
 
 #include "transposition_mode.hpp"
+#include "../fiber/memory_registry.hpp"
+#include "../fiber/scalar_traits.hpp"
 #include "boost/enable_shared_from_this.hpp"
 
 #include "../common/armadillo_fwd.hpp"
@@ -41,6 +43,10 @@
 
 namespace Bempp {
 
+/** \cond FORWARD_DECL */
+struct AssemblyReport;
+/** \endcond */
+
 /** \ingroup discrete_boundary_operators
  *  \brief Discrete boundary operator.
  *
@@ -80,6 +86,8 @@ class DiscreteBoundaryOperator
 #endif
       {
 public:
+  typedef typename Fiber::ScalarTraits<ValueType>::ComplexType ComplexType;
+
   /** \brief Destructor. */
   virtual ~DiscreteBoundaryOperator() {}
 
@@ -147,6 +155,18 @@ public:
              arma::Mat<ValueType> &y_inout, const ValueType alpha,
              const ValueType beta) const;
 
+  /** \brief Apply the operator to complex vectors.
+   *
+   *  Same as apply(), except that \p x_in, \p y_inout and the scalars are
+   *  complex even if the operator is real. Real operators then act on
+   *  complex data with real arithmetic, without complex copies of their
+   *  entries; for complex operators this function is equivalent to
+   *  apply(). */
+  void applyToComplex(const TranspositionMode trans,
+                      const arma::Mat<ComplexType> &x_in,
+                      arma::Mat<ComplexType> &y_inout,
+                      const ComplexType alpha, const ComplexType beta) const;
+
   /** \brief Return a representation that can be cast to a
    *  DiscreteAcaBoundaryOperator
    *
@@ -219,6 +239,60 @@ public:
                         const std::vector<int> &cols, const ValueType alpha,
                         arma::Mat<ValueType> &block) const = 0;
 
+  /** \brief Record of the assembly of this operator.
+   *
+   *  Returns a null pointer unless the operator is the weak form of an
+   *  elementary integral operator, assembled by
+   *  AbstractBoundaryOperator::assembleWeakForm(). */
+  shared_ptr<const AssemblyReport> assemblyReport() const {
+    return m_assemblyReport;
+  }
+
+  /** \brief Attach a record of the assembly to this operator.
+   *
+   *  This function is called by the assemblers. */
+  void setAssemblyReport(const shared_ptr<const AssemblyReport> &report) {
+    m_assemblyReport = report;
+  }
+
+  /** \brief Record of the memory held by this operator in the
+   *  Fiber::MemoryRegistry.
+   *
+   *  Returns a null pointer unless the operator stores a dense matrix or an
+   *  H-matrix created by one of the global assemblers. */
+  shared_ptr<const Fiber::MemoryAllocation> memoryAllocation() const {
+    return m_memoryAllocation;
+  }
+
+  /** \brief Record in the Fiber::MemoryRegistry that this operator holds
+   *  \p bytes of memory of the given category.
+   *
+   *  This function is called by the assemblers. The record is released
+   *  when the operator (and all operators sharing the record, see
+   *  shareMemoryAllocation()) is destroyed. */
+  void trackMemory(Fiber::MemoryCategory::Type category, size_t bytes) {
+    const std::string owner =
+        m_memoryAllocation ? m_memoryAllocation->owner() : std::string();
+    m_memoryAllocation.reset(
+        new Fiber::MemoryAllocation(category, bytes, owner));
+  }
+
+  /** \brief Make this operator share the memory record of \p other.
+   *
+   *  To be called by operators that are views of the data of another
+   *  operator. */
+  void shareMemoryAllocation(const DiscreteBoundaryOperator &other) {
+    m_memoryAllocation = other.m_memoryAllocation;
+  }
+
+  /** \brief Set the name under which the memory held by this operator is
+   *  listed by the Fiber::MemoryRegistry, typically the label of the
+   *  boundary operator whose weak form it is. */
+  void setMemoryOwner(const std::string &owner) {
+    if (m_memoryAllocation)
+      m_memoryAllocation->setOwner(owner);
+  }
+
 #ifdef WITH_TRILINOS
 protected:
   virtual void
@@ -228,12 +302,41 @@ protected:
             const ValueType alpha, const ValueType beta) const;
 #endif
 
+protected:
+  /** \brief Implementation of applyToComplex().
+   *
+   *  The default implementation applies a real operator once to a real
+   *  matrix holding the real and imaginary parts of all columns of \p x_in.
+   *  Subclasses that can work on complex data in place, e.g. by viewing it
+   *  as interleaved real data, should override this function and fall back
+   *  to it where they cannot. */
+  virtual void applyToComplexImpl(const TranspositionMode trans,
+                                  const arma::Mat<ComplexType> &x_in,
+                                  arma::Mat<ComplexType> &y_inout,
+                                  const ComplexType alpha,
+                                  const ComplexType beta) const;
+
 private:
   virtual void applyBuiltInImpl(const TranspositionMode trans,
                                 const arma::Col<ValueType> &x_in,
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const = 0;
+
+  /** \brief Apply the operator to all columns of \p x_in at once.
+   *
+   *  The default implementation calls applyBuiltInImpl() for each column
+   *  separately. Subclasses that can process a block of vectors more
+   *  efficiently than one vector at a time (e.g. with a single matrix-matrix
+   *  product) should override this function. */
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
+
+  shared_ptr<const AssemblyReport> m_assemblyReport;
+  shared_ptr<Fiber::MemoryAllocation> m_memoryAllocation;
 };
 
 /** \relates DiscreteBoundaryOperator
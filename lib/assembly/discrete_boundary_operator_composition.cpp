@@ -86,12 +86,20 @@ void DiscreteBoundaryOperatorComposition<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperatorComposition<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
   if (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE) {
-    arma::Col<ValueType> tmp(m_outer->columnCount());
+    arma::Mat<ValueType> tmp(m_outer->columnCount(), x_in.n_cols);
     m_outer->apply(trans, x_in, tmp, alpha, 0.);
     m_inner->apply(trans, tmp, y_inout, 1., beta);
   } else {
-    arma::Col<ValueType> tmp(m_inner->rowCount());
+    arma::Mat<ValueType> tmp(m_inner->rowCount(), x_in.n_cols);
     m_inner->apply(trans, x_in, tmp, alpha, 0.);
     m_outer->apply(trans, tmp, y_inout, 1., beta);
   }
@@ -22,8 +22,16 @@
 
 #include "discrete_boundary_operator_sum.hpp"
 #include "discrete_aca_boundary_operator.hpp"
+#include "discrete_sparse_boundary_operator.hpp"
+#include "scaled_discrete_boundary_operator.hpp"
+#include "../common/complex_aux.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 
+#ifdef WITH_TRILINOS
+#include <Epetra_CrsMatrix.h>
+#include <EpetraExt_MatrixMatrix.h>
+#endif
+
 namespace Bempp {
 
 template <typename ValueType>
@@ -40,6 +48,81 @@ DiscreteBoundaryOperatorSum<ValueType>::DiscreteBoundaryOperatorSum(
         "DiscreteBoundaryOperatorSum::DiscreteBoundaryOperatorSum(): "
         "both terms must have the same dimensions");
   // TODO: perhaps test for compatibility of Thyra spaces
+
+  addFlattenedTerms(m_term1, static_cast<ValueType>(1.));
+  addFlattenedTerms(m_term2, static_cast<ValueType>(1.));
+  mergeSparseTerms();
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperatorSum<ValueType>::addFlattenedTerms(
+    const shared_ptr<const Base> &term, ValueType weight) {
+  typedef ScaledDiscreteBoundaryOperator<ValueType> ScaledOp;
+  if (shared_ptr<const DiscreteBoundaryOperatorSum> sum =
+          boost::dynamic_pointer_cast<const DiscreteBoundaryOperatorSum>(
+              term)) {
+    // The terms of a sum are already flattened
+    for (size_t i = 0; i < sum->m_terms.size(); ++i) {
+      m_terms.push_back(sum->m_terms[i]);
+      m_weights.push_back(weight * sum->m_weights[i]);
+    }
+  } else if (shared_ptr<const ScaledOp> scaled =
+                 boost::dynamic_pointer_cast<const ScaledOp>(term))
+    addFlattenedTerms(scaled->scaledOperator(), weight * scaled->multiplier());
+  else {
+    m_terms.push_back(term);
+    m_weights.push_back(weight);
+  }
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperatorSum<ValueType>::mergeSparseTerms() {
+#ifdef WITH_TRILINOS
+  typedef DiscreteSparseBoundaryOperator<ValueType> SparseOp;
+  // Epetra matrices are real, so only sparse terms with real weights that are
+  // not transposed or conjugated can be merged
+  std::vector<shared_ptr<const Base>> terms;
+  std::vector<ValueType> weights;
+  shared_ptr<const Epetra_CrsMatrix> merged;
+  double mergedWeight = 1.;
+  size_t mergedTermCount = 0;
+  for (size_t i = 0; i < m_terms.size(); ++i) {
+    shared_ptr<const SparseOp> sparse =
+        boost::dynamic_pointer_cast<const SparseOp>(m_terms[i]);
+    if (!sparse || sparse->transpositionMode() != NO_TRANSPOSE ||
+        imagPart(m_weights[i]) != 0.) {
+      terms.push_back(m_terms[i]);
+      weights.push_back(m_weights[i]);
+      continue;
+    }
+    ++mergedTermCount;
+    if (!merged) {
+      merged = sparse->epetraMatrix();
+      mergedWeight = realPart(m_weights[i]);
+      continue;
+    }
+    const Epetra_CrsMatrix &mat = *sparse->epetraMatrix();
+    Epetra_CrsMatrix *sum = 0;
+    int errorCode = EpetraExt::MatrixMatrix::Add(
+        *merged, false /* transposeA */, mergedWeight, mat,
+        false /* transposeB */, realPart(m_weights[i]), sum);
+    if (errorCode != 0) {
+      delete sum;
+      throw std::runtime_error(
+          "DiscreteBoundaryOperatorSum::mergeSparseTerms(): "
+          "addition of sparse matrices failed");
+    }
+    sum->FillComplete(mat.DomainMap(), mat.RangeMap());
+    merged.reset(sum);
+    mergedWeight = 1.;
+  }
+  if (mergedTermCount < 2)
+    return; // nothing gained
+  terms.push_back(shared_ptr<const Base>(new SparseOp(merged)));
+  weights.push_back(static_cast<ValueType>(1.));
+  m_terms.swap(terms);
+  m_weights.swap(weights);
+#endif // WITH_TRILINOS
 }
 
 template <typename ValueType>
@@ -114,9 +197,21 @@ void DiscreteBoundaryOperatorSum<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
-  m_term1->apply(trans, x_in, y_inout, alpha, beta);
-  m_term2->apply(trans, x_in, y_inout, alpha,
-                 1. /* "+ beta * y_inout" has already been done */);
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteBoundaryOperatorSum<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  const bool conjugate = (trans == CONJUGATE || trans == CONJUGATE_TRANSPOSE);
+  for (size_t i = 0; i < m_terms.size(); ++i) {
+    const ValueType weight = conjugate ? conj(m_weights[i]) : m_weights[i];
+    m_terms[i]->apply(trans, x_in, y_inout, weight * alpha,
+                      i == 0 ? beta : static_cast<ValueType>(1.)
+                      /* "+ beta * y_inout" has already been done */);
+  }
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteBoundaryOperatorSum);
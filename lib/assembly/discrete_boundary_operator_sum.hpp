@@ -30,6 +30,8 @@
 
 #include "../common/shared_ptr.hpp"
 
+#include <vector>
+
 #ifdef WITH_TRILINOS
 #include <Teuchos_RCP.hpp>
 #endif
@@ -38,6 +40,12 @@ namespace Bempp {
 
 /** \ingroup composite_discrete_boundary_operators
  *  \brief Sum of discrete linear operators stored separately.
+ *
+ *  On construction, nested sums and scaled operators among the terms are
+ *  flattened into a single list of weighted operators, which apply() then
+ *  accumulates directly into the output vector. Sparse terms (if any)
+ *  are merged into a single sparse matrix, so that they are applied in a
+ *  single pass over the input vector.
  */
 template <typename ValueType>
 class DiscreteBoundaryOperatorSum : public DiscreteBoundaryOperator<ValueType> {
@@ -84,10 +92,21 @@ private:
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
 
 private:
   /** \cond PRIVATE */
+  void addFlattenedTerms(const shared_ptr<const Base> &term, ValueType weight);
+  void mergeSparseTerms();
+
   shared_ptr<const Base> m_term1, m_term2;
+  // The sum expressed as sum_i m_weights[i] * m_terms[i]
+  std::vector<shared_ptr<const Base>> m_terms;
+  std::vector<ValueType> m_weights;
   /** \endcond */
 };
 
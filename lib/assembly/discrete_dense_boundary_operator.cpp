@@ -25,10 +25,18 @@
 #include "../fiber/explicit_instantiation.hpp"
 
 #include "fiber/scalar_traits.hpp"
+#include "../fiber/numa_first_touch.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../hmat/hmatrix_file_format.hpp"
 
 #include <iostream>
 #include <stdexcept>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <tbb/enumerable_thread_specific.h>
 
 #ifdef WITH_TRILINOS
 #include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
@@ -36,16 +44,239 @@
 
 namespace Bempp {
 
+namespace {
+
+// Products with smaller matrices are left to BLAS
+const size_t MIN_COLUMN_BLOCK_PRODUCT_SIZE = 1 << 16;
+
+// Header of the files written by DiscreteDenseBoundaryOperator::save(). The
+// entries follow at dataOffset, a multiple of hmat::HMATRIX_FILE_ALIGNMENT,
+// in column-major order and native byte order.
+struct DenseMatrixFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrderMark;
+  std::uint32_t valueTypeId;
+  std::uint32_t reserved;
+  std::uint64_t rows;
+  std::uint64_t columns;
+  std::uint64_t dataOffset;
+  std::uint64_t fileSize;
+  std::uint64_t checksum; // FNV-1a of the entries
+};
+
+const char DENSE_MATRIX_FILE_MAGIC[8] = {'B', 'E', 'M', 'P', 'P', 'D', 'M',
+                                         '\0'};
+const std::uint32_t DENSE_MATRIX_FILE_VERSION = 1;
+
+// Check the header of a file image of the given size and return the header
+template <typename ValueType>
+DenseMatrixFileHeader readDenseMatrixFileHeader(const char *data,
+                                                std::size_t size) {
+  DenseMatrixFileHeader header;
+  if (size < sizeof(header))
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::load(): "
+                             "File is truncated or corrupt.");
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, DENSE_MATRIX_FILE_MAGIC, 8) != 0 ||
+      header.version != DENSE_MATRIX_FILE_VERSION ||
+      header.byteOrderMark != hmat::HMATRIX_FILE_BYTE_ORDER_MARK)
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::load(): "
+                             "Not a dense matrix file of this format "
+                             "version and byte order.");
+  if (header.valueTypeId != hmat::hMatrixFileValueTypeId<ValueType>())
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::load(): "
+                             "File was written for another value type.");
+  const std::uint64_t dataSize =
+      header.rows * header.columns * sizeof(ValueType);
+  if (header.fileSize != size || header.dataOffset > size ||
+      dataSize != size - header.dataOffset ||
+      header.dataOffset % hmat::HMATRIX_FILE_ALIGNMENT != 0)
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::load(): "
+                             "File is truncated or corrupt.");
+  if (hmat::hMatrixFileChecksum(data + header.dataOffset, dataSize) !=
+      header.checksum)
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::load(): "
+                             "Checksum mismatch.");
+  return header;
+}
+
+// Complex matrices are applied to complex vectors by apply()
+template <typename ValueType>
+bool applyInterleaved(const arma::Mat<ValueType> &mat, bool transposed,
+                      int columnBlockThreadCount,
+                      const arma::Mat<ValueType> &x_in,
+                      arma::Mat<ValueType> &y_inout, ValueType alpha,
+                      ValueType beta) {
+  return false;
+}
+
+// Compute y := alpha * op(A) * x + beta * y for a real matrix A and a single
+// complex vector x. In memory, x is the real 2 x n matrix [Re x^T; Im x^T],
+// so op(A) * x is the single real product [Re x^T; Im x^T] * op(A)^T, done
+// without copying x and with half the arithmetic of a complex product. If
+// columnBlockThreadCount is nonzero, the product is split into the column
+// blocks of A as in applyByColumnBlocks().
+template <typename RealType>
+bool applyInterleaved(const arma::Mat<RealType> &mat, bool transposed,
+                      int columnBlockThreadCount,
+                      const arma::Mat<std::complex<RealType>> &x_in,
+                      arma::Mat<std::complex<RealType>> &y_inout,
+                      std::complex<RealType> alpha,
+                      std::complex<RealType> beta) {
+  typedef std::complex<RealType> ComplexType;
+
+  // Several vectors are better applied at once with their real and
+  // imaginary parts as separate columns, so that A is read only once
+  if (x_in.n_cols != 1)
+    return false;
+
+  const arma::Mat<RealType> x(
+      reinterpret_cast<RealType *>(const_cast<ComplexType *>(x_in.memptr())),
+      2, x_in.n_rows, false, true);
+  arma::Mat<RealType> product(2, y_inout.n_rows);
+  if (columnBlockThreadCount == 0) {
+    if (transposed)
+      product = x * mat;
+    else
+      product = x * mat.t();
+  } else if (transposed) {
+    Fiber::SerialBlasRegion region;
+    Fiber::forEachColumnBlock(
+        mat.n_cols, columnBlockThreadCount, [&](size_t first, size_t last) {
+          const arma::Mat<RealType> block(
+              const_cast<RealType *>(mat.colptr(first)), mat.n_rows,
+              last - first, false, true);
+          product.cols(first, last - 1) = x * block;
+        });
+  } else {
+    Fiber::SerialBlasRegion region;
+    tbb::enumerable_thread_specific<arma::Mat<RealType>> localProducts(
+        arma::Mat<RealType>(2, y_inout.n_rows, arma::fill::zeros));
+    Fiber::forEachColumnBlock(
+        mat.n_cols, columnBlockThreadCount, [&](size_t first, size_t last) {
+          const arma::Mat<RealType> block(
+              const_cast<RealType *>(mat.colptr(first)), mat.n_rows,
+              last - first, false, true);
+          localProducts.local() += x.cols(first, last - 1) * block.t();
+        });
+    product.zeros();
+    localProducts.combine_each(
+        [&product](const arma::Mat<RealType> &local) { product += local; });
+  }
+
+  ComplexType *y = y_inout.memptr();
+  if (beta == static_cast<ComplexType>(0.))
+    for (size_t r = 0; r < y_inout.n_rows; ++r)
+      y[r] = alpha * ComplexType(product(0, r), product(1, r));
+  else
+    for (size_t r = 0; r < y_inout.n_rows; ++r)
+      y[r] = alpha * ComplexType(product(0, r), product(1, r)) + beta * y[r];
+  return true;
+}
+
+} // namespace
+
 template <typename ValueType>
 DiscreteDenseBoundaryOperator<ValueType>::DiscreteDenseBoundaryOperator(
     const arma::Mat<ValueType> &mat)
-    : m_mat(mat)
+    : m_mat(mat), m_maxThreadCount(1)
+#ifdef WITH_TRILINOS
+      ,
+      m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_cols)),
+      m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_rows))
+#endif
+{
+  this->trackMemory(Fiber::MemoryCategory::DENSE_MATRICES,
+                    m_mat.n_elem * sizeof(ValueType));
+}
+
+template <typename ValueType>
+DiscreteDenseBoundaryOperator<ValueType>::DiscreteDenseBoundaryOperator(
+    arma::Mat<ValueType> &mat, int maxThreadCount)
+    : m_maxThreadCount(maxThreadCount)
 #ifdef WITH_TRILINOS
       ,
       m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_cols)),
       m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_rows))
 #endif
 {
+  // Copying the matrix would place all its pages on the NUMA node of the
+  // calling thread
+  m_mat.steal_mem(mat);
+  this->trackMemory(Fiber::MemoryCategory::DENSE_MATRICES,
+                    m_mat.n_elem * sizeof(ValueType));
+}
+
+template <typename ValueType>
+DiscreteDenseBoundaryOperator<ValueType>::DiscreteDenseBoundaryOperator(
+    const shared_ptr<const hmat::HMatrixMappedFile> &mappedFile,
+    std::size_t offset, unsigned int rows, unsigned int columns)
+    : m_mappedFile(mappedFile),
+      m_mat(reinterpret_cast<ValueType *>(
+                const_cast<char *>(mappedFile->data() + offset)),
+            rows, columns, false, true),
+      m_maxThreadCount(1)
+#ifdef WITH_TRILINOS
+      ,
+      m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(columns)),
+      m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(rows))
+#endif
+{
+  // The entries live in the page cache, shared with other processes mapping
+  // the same file, and are not counted as private memory
+}
+
+template <typename ValueType>
+void DiscreteDenseBoundaryOperator<ValueType>::save(
+    const std::string &fileName) const {
+  DenseMatrixFileHeader header = DenseMatrixFileHeader();
+  std::memcpy(header.magic, DENSE_MATRIX_FILE_MAGIC, 8);
+  header.version = DENSE_MATRIX_FILE_VERSION;
+  header.byteOrderMark = hmat::HMATRIX_FILE_BYTE_ORDER_MARK;
+  header.valueTypeId = hmat::hMatrixFileValueTypeId<ValueType>();
+  header.rows = m_mat.n_rows;
+  header.columns = m_mat.n_cols;
+  header.dataOffset = ((sizeof(header) + hmat::HMATRIX_FILE_ALIGNMENT - 1) /
+                       hmat::HMATRIX_FILE_ALIGNMENT) *
+                      hmat::HMATRIX_FILE_ALIGNMENT;
+  const std::size_t dataSize = m_mat.n_elem * sizeof(ValueType);
+  const char *data = reinterpret_cast<const char *>(m_mat.memptr());
+  header.fileSize = header.dataOffset + dataSize;
+  header.checksum = hmat::hMatrixFileChecksum(data, dataSize);
+
+  std::ofstream stream(fileName.c_str(), std::ios::binary | std::ios::trunc);
+  if (!stream)
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::save(): "
+                             "Cannot open file " +
+                             fileName + " for writing.");
+  static const char zeros[hmat::HMATRIX_FILE_ALIGNMENT] = {};
+  stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  stream.write(zeros, header.dataOffset - sizeof(header));
+  stream.write(data, dataSize);
+  stream.close();
+  if (!stream)
+    throw std::runtime_error("DiscreteDenseBoundaryOperator::save(): "
+                             "Writing the file failed.");
+}
+
+template <typename ValueType>
+shared_ptr<DiscreteDenseBoundaryOperator<ValueType>>
+DiscreteDenseBoundaryOperator<ValueType>::load(const std::string &fileName,
+                                               bool memoryMap) {
+  typedef DiscreteDenseBoundaryOperator<ValueType> Op;
+  shared_ptr<const hmat::HMatrixMappedFile> mappedFile(
+      new hmat::HMatrixMappedFile(fileName));
+  const DenseMatrixFileHeader header = readDenseMatrixFileHeader<ValueType>(
+      mappedFile->data(), mappedFile->size());
+  if (memoryMap)
+    return shared_ptr<Op>(new Op(mappedFile, header.dataOffset, header.rows,
+                                 header.columns));
+  arma::Mat<ValueType> mat(
+      reinterpret_cast<const ValueType *>(mappedFile->data() +
+                                          header.dataOffset),
+      header.rows, header.columns);
+  return shared_ptr<Op>(new Op(mat, 1));
 }
 
 template <typename ValueType>
@@ -123,29 +354,112 @@ void DiscreteDenseBoundaryOperator<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteDenseBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
   if (beta == static_cast<ValueType>(0.))
     y_inout.fill(static_cast<ValueType>(0.));
   else
     y_inout *= beta;
 
+  if (useColumnBlocks()) {
+    applyByColumnBlocks(trans, x_in, y_inout, alpha);
+    return;
+  }
+
+  // Only transposition and conjugate transposition are passed on to BLAS
+  // directly. The other modes conjugate the vectors instead of the matrix,
+  // using conj(A) x = conj(A conj(x)) and A^T x = conj(A^H conj(x)), so that
+  // the matrix is never copied.
   switch (trans) {
   case NO_TRANSPOSE:
     y_inout += alpha * m_mat * x_in;
     break;
   case CONJUGATE:
-    y_inout += alpha * arma::conj(m_mat) * x_in;
+    y_inout += alpha * arma::conj(m_mat * arma::conj(x_in));
     break;
   case TRANSPOSE:
-    y_inout += alpha * m_mat.st() * x_in;
+    y_inout += alpha * arma::conj(m_mat.t() * arma::conj(x_in));
     break;
   case CONJUGATE_TRANSPOSE:
     y_inout += alpha * m_mat.t() * x_in;
     break;
   default:
     throw std::invalid_argument(
-        "DiscreteDenseBoundaryOperator::applyBuiltInImpl(): "
+        "DiscreteDenseBoundaryOperator::applyBuiltInBlockImpl(): "
+        "invalid transposition mode");
+  }
+}
+
+template <typename ValueType>
+void DiscreteDenseBoundaryOperator<ValueType>::applyToComplexImpl(
+    const TranspositionMode trans, const arma::Mat<ComplexType> &x_in,
+    arma::Mat<ComplexType> &y_inout, const ComplexType alpha,
+    const ComplexType beta) const {
+  // The conjugation of a real matrix can be ignored
+  const bool transposed = trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE;
+  if (!applyInterleaved(m_mat, transposed,
+                        useColumnBlocks() ? m_maxThreadCount : 0, x_in,
+                        y_inout, alpha, beta))
+    Base::applyToComplexImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+bool DiscreteDenseBoundaryOperator<ValueType>::useColumnBlocks() const {
+  return m_maxThreadCount != 1 &&
+         m_mat.n_elem >= MIN_COLUMN_BLOCK_PRODUCT_SIZE;
+}
+
+template <typename ValueType>
+void DiscreteDenseBoundaryOperator<ValueType>::applyByColumnBlocks(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha) const {
+  if (trans != NO_TRANSPOSE && trans != CONJUGATE &&
+      trans != TRANSPOSE && trans != CONJUGATE_TRANSPOSE)
+    throw std::invalid_argument(
+        "DiscreteDenseBoundaryOperator::applyByColumnBlocks(): "
         "invalid transposition mode");
+
+  // Each thread multiplies with the columns it zeroed in
+  // Fiber::firstTouchZeros(), calling BLAS serially
+  Fiber::SerialBlasRegion region;
+  const bool transposed = trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE;
+  if (transposed) {
+    // The column blocks produce disjoint row blocks of the result
+    Fiber::forEachColumnBlock(
+        m_mat.n_cols, m_maxThreadCount, [&](size_t first, size_t last) {
+          const arma::Mat<ValueType> block(m_mat.colptr(first), m_mat.n_rows,
+                                           last - first, false, true);
+          if (trans == TRANSPOSE)
+            y_inout.rows(first, last - 1) +=
+                alpha * arma::conj(block.t() * arma::conj(x_in));
+          else
+            y_inout.rows(first, last - 1) += alpha * block.t() * x_in;
+        });
+    return;
   }
+
+  // The column blocks contribute to all rows of the result, so every thread
+  // accumulates into its own buffer; the buffers are summed up at the end
+  tbb::enumerable_thread_specific<arma::Mat<ValueType>> localResults(
+      arma::Mat<ValueType>(y_inout.n_rows, y_inout.n_cols, arma::fill::zeros));
+  Fiber::forEachColumnBlock(
+      m_mat.n_cols, m_maxThreadCount, [&](size_t first, size_t last) {
+        const arma::Mat<ValueType> block(m_mat.colptr(first), m_mat.n_rows,
+                                         last - first, false, true);
+        arma::Mat<ValueType> &yLocal = localResults.local();
+        if (trans == NO_TRANSPOSE)
+          yLocal += block * x_in.rows(first, last - 1);
+        else
+          yLocal += arma::conj(block * arma::conj(x_in.rows(first, last - 1)));
+      });
+  localResults.combine_each([&y_inout, alpha](
+      const arma::Mat<ValueType> &yLocal) { y_inout += alpha * yLocal; });
 }
 
 template <typename ValueType>
@@ -29,11 +29,19 @@
 
 #include "../common/shared_ptr.hpp"
 
+#include <string>
+
 #ifdef WITH_TRILINOS
 #include <Teuchos_RCP.hpp>
 #include <Thyra_SpmdVectorSpaceBase_decl.hpp>
 #endif
 
+namespace hmat {
+/** \cond FORWARD_DECL */
+class HMatrixMappedFile;
+/** \endcond */
+} // namespace hmat
+
 namespace Bempp {
 
 /** \ingroup discrete_boundary_operators
@@ -42,12 +50,46 @@ template <typename ValueType>
 class DiscreteDenseBoundaryOperator
     : public DiscreteBoundaryOperator<ValueType> {
 public:
+  typedef DiscreteBoundaryOperator<ValueType> Base;
+  typedef typename Base::ComplexType ComplexType;
+
   /** \brief Constructor.
    *
    *  Construct a discrete boundary operator represented by the matrix \p mat.
    */
   explicit DiscreteDenseBoundaryOperator(const arma::Mat<ValueType> &mat);
 
+  /** \brief Constructor.
+   *
+   *  Construct a discrete boundary operator represented by the matrix \p
+   *  mat, taking over its memory; \p mat is left empty.
+   *
+   *  Products with the operator are split into the column blocks of
+   *  Fiber::forEachColumnBlock() and computed by up to \p maxThreadCount
+   *  threads (a positive number or ParallelizationOptions::AUTO). If \p
+   *  mat was initialised with Fiber::firstTouchZeros() with the same thread
+   *  count, each thread then reads the columns stored on its own NUMA node.
+   */
+  DiscreteDenseBoundaryOperator(arma::Mat<ValueType> &mat,
+                                int maxThreadCount);
+
+  /** \brief Write the matrix to a binary file.
+   *
+   *  The file consists of a header with the value type and the dimensions,
+   *  followed by the entries in column-major order starting at an aligned
+   *  offset. */
+  void save(const std::string &fileName) const;
+
+  /** \brief Load an operator from a file written by save().
+   *
+   *  If \p memoryMap is true, the file is mapped read-only into memory and
+   *  the entries are used in place, so that processes loading the same file
+   *  share its pages; otherwise they are copied to the heap. Files written
+   *  for another value type, and files whose checksum does not match, are
+   *  rejected with an exception. */
+  static shared_ptr<DiscreteDenseBoundaryOperator<ValueType>>
+  load(const std::string &fileName, bool memoryMap = true);
+
   virtual void dump() const;
 
   virtual arma::Mat<ValueType> asMatrix() const;
@@ -76,10 +118,33 @@ private:
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
+  virtual void applyToComplexImpl(const TranspositionMode trans,
+                                  const arma::Mat<ComplexType> &x_in,
+                                  arma::Mat<ComplexType> &y_inout,
+                                  const ComplexType alpha,
+                                  const ComplexType beta) const;
 
 private:
   /** \cond PRIVATE */
+  DiscreteDenseBoundaryOperator(
+      const shared_ptr<const hmat::HMatrixMappedFile> &mappedFile,
+      std::size_t offset, unsigned int rows, unsigned int columns);
+
+  bool useColumnBlocks() const;
+  void applyByColumnBlocks(const TranspositionMode trans,
+                           const arma::Mat<ValueType> &x_in,
+                           arma::Mat<ValueType> &y_inout,
+                           const ValueType alpha) const;
+
+  // Keeps the entries of a matrix loaded by load() mapped
+  shared_ptr<const hmat::HMatrixMappedFile> m_mappedFile;
 mutable  arma::Mat<ValueType> m_mat;
+  int m_maxThreadCount;
 #ifdef WITH_TRILINOS
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
@@ -0,0 +1,199 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "discrete_distributed_dense_boundary_operator.hpp"
+
+#ifdef WITH_MPI
+
+#include "../common/mpi_datatype.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include <boost/numeric/conversion/converter.hpp>
+
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename ValueType>
+DiscreteDistributedDenseBoundaryOperator<ValueType>::
+    DiscreteDistributedDenseBoundaryOperator(arma::Mat<ValueType> &localMatrix,
+                                             const BlockCyclicLayout &layout,
+                                             MPI_Comm comm)
+    : m_layout(layout), m_comm(comm),
+      m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(
+          layout.columns())),
+      m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(layout.rows())) {
+  int initialized = 0;
+  MPI_Initialized(&initialized);
+  if (!initialized)
+    throw std::runtime_error(
+        "DiscreteDistributedDenseBoundaryOperator::"
+        "DiscreteDistributedDenseBoundaryOperator(): MPI is not initialized");
+  int size = 0, rank = 0;
+  MPI_Comm_size(m_comm, &size);
+  MPI_Comm_rank(m_comm, &rank);
+  if (size != layout.processRows() * layout.processColumns() ||
+      rank != layout.processRow() * layout.processColumns() +
+                  layout.processColumn())
+    throw std::invalid_argument(
+        "DiscreteDistributedDenseBoundaryOperator::"
+        "DiscreteDistributedDenseBoundaryOperator(): the layout does not "
+        "match the communicator");
+  if (localMatrix.n_rows != layout.localRows() ||
+      localMatrix.n_cols != layout.localColumns())
+    throw std::invalid_argument(
+        "DiscreteDistributedDenseBoundaryOperator::"
+        "DiscreteDistributedDenseBoundaryOperator(): the local matrix does "
+        "not match the layout");
+  m_localMatrix.swap(localMatrix);
+}
+
+template <typename ValueType>
+unsigned int
+DiscreteDistributedDenseBoundaryOperator<ValueType>::rowCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_layout.rows());
+}
+
+template <typename ValueType>
+unsigned int
+DiscreteDistributedDenseBoundaryOperator<ValueType>::columnCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_layout.columns());
+}
+
+template <typename ValueType>
+const arma::Mat<ValueType> &
+DiscreteDistributedDenseBoundaryOperator<ValueType>::localMatrix() const {
+  return m_localMatrix;
+}
+
+template <typename ValueType>
+const BlockCyclicLayout &
+DiscreteDistributedDenseBoundaryOperator<ValueType>::layout() const {
+  return m_layout;
+}
+
+template <typename ValueType>
+MPI_Comm
+DiscreteDistributedDenseBoundaryOperator<ValueType>::communicator() const {
+  return m_comm;
+}
+
+template <typename ValueType>
+void DiscreteDistributedDenseBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {
+  throw std::runtime_error(
+      "DiscreteDistributedDenseBoundaryOperator::addBlock(): "
+      "not implemented");
+}
+
+template <typename ValueType>
+void DiscreteDistributedDenseBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteDistributedDenseBoundaryOperator<ValueType>::
+    applyBuiltInBlockImpl(const TranspositionMode trans,
+                          const arma::Mat<ValueType> &x_in,
+                          arma::Mat<ValueType> &y_inout,
+                          const ValueType alpha, const ValueType beta) const {
+
+  const bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+  const std::size_t inputCount =
+      transposed ? m_localMatrix.n_rows : m_localMatrix.n_cols;
+  const std::size_t outputCount =
+      transposed ? m_localMatrix.n_cols : m_localMatrix.n_rows;
+  auto globalInput = [&](std::size_t i) {
+    return transposed ? m_layout.globalRow(i) : m_layout.globalColumn(i);
+  };
+  auto globalOutput = [&](std::size_t i) {
+    return transposed ? m_layout.globalColumn(i) : m_layout.globalRow(i);
+  };
+
+  arma::Mat<ValueType> localInput(inputCount, x_in.n_cols);
+  for (std::size_t j = 0; j < x_in.n_cols; ++j)
+    for (std::size_t i = 0; i < inputCount; ++i)
+      localInput(i, j) = x_in(globalInput(i), j);
+
+  arma::Mat<ValueType> localOutput;
+  switch (trans) {
+  case NO_TRANSPOSE:
+    localOutput = m_localMatrix * localInput;
+    break;
+  case CONJUGATE:
+    localOutput = arma::conj(m_localMatrix * arma::conj(localInput));
+    break;
+  case TRANSPOSE:
+    localOutput = arma::conj(m_localMatrix.t() * arma::conj(localInput));
+    break;
+  case CONJUGATE_TRANSPOSE:
+    localOutput = m_localMatrix.t() * localInput;
+    break;
+  default:
+    throw std::invalid_argument(
+        "DiscreteDistributedDenseBoundaryOperator::applyBuiltInBlockImpl(): "
+        "invalid transposition mode");
+  }
+
+  // The processes of a row (column) of the process grid contribute to the
+  // same entries of the output
+  arma::Mat<ValueType> y(transposed ? m_layout.columns() : m_layout.rows(),
+                         x_in.n_cols, arma::fill::zeros);
+  for (std::size_t j = 0; j < x_in.n_cols; ++j)
+    for (std::size_t i = 0; i < outputCount; ++i)
+      y(globalOutput(i), j) = localOutput(i, j);
+  MPI_Allreduce(MPI_IN_PLACE, y.memptr(), static_cast<int>(y.n_elem),
+                mpiDatatype<ValueType>(), MPI_SUM, m_comm);
+
+  if (beta == ValueType(0))
+    y_inout = alpha * y;
+  else
+    y_inout = beta * y_inout + alpha * y;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteDistributedDenseBoundaryOperator<ValueType>::domain() const {
+  return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteDistributedDenseBoundaryOperator<ValueType>::range() const {
+  return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool DiscreteDistributedDenseBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJTRANS);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(
+    DiscreteDistributedDenseBoundaryOperator);
+}
+
+#endif // WITH_MPI
@@ -0,0 +1,109 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_discrete_distributed_dense_boundary_operator_hpp
+#define bempp_discrete_distributed_dense_boundary_operator_hpp
+
+#include "bempp/common/config_mpi.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#ifdef WITH_MPI
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+#include "block_cyclic_layout.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+
+#include <mpi.h>
+
+namespace Bempp {
+
+/** \ingroup discrete_boundary_operators
+ *  \brief Dense matrix distributed block-cyclically over the processes of
+ *  an MPI communicator.
+ *
+ *  Every process stores the entries assigned to it by a BlockCyclicLayout
+ *  as a local matrix, in the format expected by ScaLAPACK. Input and output
+ *  vectors are replicated on all processes. In apply() every process
+ *  multiplies its local matrix with the entries of the input vector
+ *  belonging to its columns, and the partial results are summed up on all
+ *  processes. The operator must therefore be applied collectively by all
+ *  processes of the communicator. */
+template <typename ValueType>
+class DiscreteDistributedDenseBoundaryOperator
+    : public DiscreteBoundaryOperator<ValueType> {
+public:
+  /** \brief Constructor.
+   *
+   *  \p localMatrix must hold the localRows() x localColumns() entries of
+   *  this process in \p layout, whose process count and rank must be those
+   *  of \p comm. The operator takes over the memory of \p localMatrix,
+   *  which is left empty. MPI must be initialized. */
+  DiscreteDistributedDenseBoundaryOperator(arma::Mat<ValueType> &localMatrix,
+                                           const BlockCyclicLayout &layout,
+                                           MPI_Comm comm = MPI_COMM_WORLD);
+
+  unsigned int rowCount() const override;
+
+  unsigned int columnCount() const override;
+
+  /** \brief The entries of the matrix stored on this process. */
+  const arma::Mat<ValueType> &localMatrix() const;
+
+  const BlockCyclicLayout &layout() const;
+
+  MPI_Comm communicator() const;
+
+  void addBlock(const std::vector<int> &rows, const std::vector<int> &cols,
+                const ValueType alpha, arma::Mat<ValueType> &block) const
+      override;
+
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+
+private:
+  void applyBuiltInImpl(const TranspositionMode trans,
+                        const arma::Col<ValueType> &x_in,
+                        arma::Col<ValueType> &y_inout, const ValueType alpha,
+                        const ValueType beta) const override;
+
+  void applyBuiltInBlockImpl(const TranspositionMode trans,
+                             const arma::Mat<ValueType> &x_in,
+                             arma::Mat<ValueType> &y_inout,
+                             const ValueType alpha,
+                             const ValueType beta) const override;
+
+  arma::Mat<ValueType> m_localMatrix;
+  BlockCyclicLayout m_layout;
+  MPI_Comm m_comm;
+
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
+};
+}
+
+#endif // WITH_MPI
+
+#endif
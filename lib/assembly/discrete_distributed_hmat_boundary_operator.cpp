@@ -0,0 +1,200 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "discrete_distributed_hmat_boundary_operator.hpp"
+
+#ifdef WITH_MPI
+
+#include "../common/mpi_datatype.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include <boost/numeric/conversion/converter.hpp>
+#include "../hmat/hmatrix.hpp"
+
+#include <complex>
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename ValueType>
+DiscreteDistributedHMatBoundaryOperator<ValueType>::
+    DiscreteDistributedHMatBoundaryOperator(
+        const shared_ptr<hmat::DefaultHMatrixType<ValueType>> &hMatrix,
+        const shared_ptr<const hmat::LeafPartition<2>> &partition,
+        MPI_Comm comm)
+    : m_hMatrix(hMatrix), m_partition(partition), m_comm(comm), m_rank(0),
+      m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(
+          hMatrix->columns())),
+      m_rangeSpace(
+          Thyra::defaultSpmdVectorSpace<ValueType>(hMatrix->rows())) {
+  int initialized = 0;
+  MPI_Initialized(&initialized);
+  if (!initialized)
+    throw std::runtime_error(
+        "DiscreteDistributedHMatBoundaryOperator::"
+        "DiscreteDistributedHMatBoundaryOperator(): MPI is not initialized");
+  int size = 0;
+  MPI_Comm_size(m_comm, &size);
+  MPI_Comm_rank(m_comm, &m_rank);
+  if (size != m_partition->numberOfParts())
+    throw std::invalid_argument(
+        "DiscreteDistributedHMatBoundaryOperator::"
+        "DiscreteDistributedHMatBoundaryOperator(): the number of parts of "
+        "the partition differs from the size of the communicator");
+
+  m_rowCounts.resize(size);
+  m_rowOffsets.resize(size);
+  for (int part = 0; part < size; ++part) {
+    const auto &rowRange = m_partition->rowRange(part);
+    m_rowOffsets[part] = static_cast<int>(rowRange[0]);
+    m_rowCounts[part] = static_cast<int>(rowRange[1] - rowRange[0]);
+  }
+}
+
+template <typename ValueType>
+unsigned int
+DiscreteDistributedHMatBoundaryOperator<ValueType>::rowCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_hMatrix->rows());
+}
+
+template <typename ValueType>
+unsigned int
+DiscreteDistributedHMatBoundaryOperator<ValueType>::columnCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_hMatrix->columns());
+}
+
+template <typename ValueType>
+shared_ptr<const hmat::DefaultHMatrixType<ValueType>>
+DiscreteDistributedHMatBoundaryOperator<ValueType>::hMatrix() const {
+  return m_hMatrix;
+}
+
+template <typename ValueType>
+shared_ptr<const hmat::LeafPartition<2>>
+DiscreteDistributedHMatBoundaryOperator<ValueType>::partition() const {
+  return m_partition;
+}
+
+template <typename ValueType>
+MPI_Comm
+DiscreteDistributedHMatBoundaryOperator<ValueType>::communicator() const {
+  return m_comm;
+}
+
+template <typename ValueType>
+void DiscreteDistributedHMatBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {
+  throw std::runtime_error(
+      "DiscreteDistributedHMatBoundaryOperator::addBlock(): "
+      "not implemented");
+}
+
+template <typename ValueType>
+void DiscreteDistributedHMatBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteDistributedHMatBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+
+  hmat::TransposeMode hmatTrans;
+  if (trans == TranspositionMode::NO_TRANSPOSE)
+    hmatTrans = hmat::NOTRANS;
+  else if (trans == TranspositionMode::TRANSPOSE)
+    hmatTrans = hmat::TRANS;
+  else if (trans == TranspositionMode::CONJUGATE)
+    hmatTrans = hmat::CONJ;
+  else
+    hmatTrans = hmat::CONJTRANS;
+  const bool transposed =
+      (hmatTrans == hmat::TRANS || hmatTrans == hmat::CONJTRANS);
+
+  arma::Mat<ValueType> xPermuted = m_hMatrix->permuteMatToHMatDofs(
+      x_in, transposed ? hmat::ROW : hmat::COL);
+  const std::size_t outputSize =
+      transposed ? m_hMatrix->columns() : m_hMatrix->rows();
+  arma::Mat<ValueType> partialProduct(outputSize, x_in.n_cols);
+  m_hMatrix->applyPermuted(xPermuted, partialProduct, hmatTrans, alpha, 0);
+
+  const MPI_Datatype datatype = mpiDatatype<ValueType>();
+  arma::Mat<ValueType> yPermuted(outputSize, x_in.n_cols);
+  if (!transposed) {
+    // The rows of a part only receive contributions from its own leaves
+    // and from leaves of other parts overlapping its row range; each part
+    // sums up its own rows before they are replicated.
+    arma::Col<ValueType> ownedRows(m_rowCounts[m_rank]);
+    for (std::size_t j = 0; j < x_in.n_cols; ++j) {
+      MPI_Reduce_scatter(partialProduct.colptr(j), ownedRows.memptr(),
+                         const_cast<int *>(m_rowCounts.data()), datatype,
+                         MPI_SUM, m_comm);
+      MPI_Allgatherv(ownedRows.memptr(), m_rowCounts[m_rank], datatype,
+                     yPermuted.colptr(j),
+                     const_cast<int *>(m_rowCounts.data()),
+                     const_cast<int *>(m_rowOffsets.data()), datatype,
+                     m_comm);
+    }
+  } else {
+    // The partition is by rows, so columns are not owned by any single
+    // part
+    MPI_Allreduce(partialProduct.memptr(), yPermuted.memptr(),
+                  static_cast<int>(partialProduct.n_elem), datatype, MPI_SUM,
+                  m_comm);
+  }
+
+  arma::Mat<ValueType> y = m_hMatrix->permuteMatToOriginalDofs(
+      yPermuted, transposed ? hmat::COL : hmat::ROW);
+  if (beta == ValueType(0))
+    y_inout = y;
+  else
+    y_inout = beta * y_inout + y;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteDistributedHMatBoundaryOperator<ValueType>::domain() const {
+  return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteDistributedHMatBoundaryOperator<ValueType>::range() const {
+  return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool DiscreteDistributedHMatBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJTRANS);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(
+    DiscreteDistributedHMatBoundaryOperator);
+}
+
+#endif // WITH_MPI
@@ -0,0 +1,169 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "discrete_fmm_boundary_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include <boost/numeric/conversion/converter.hpp>
+
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename ValueType>
+DiscreteFmmBoundaryOperator<ValueType>::DiscreteFmmBoundaryOperator(
+    const shared_ptr<const hmat::BlockSparseMatrix<ValueType>> &nearField,
+    const shared_ptr<const FmmFarField<ValueType>> &farField,
+    bool nearFieldOnly)
+    : m_nearField(nearField), m_farField(farField),
+      m_nearFieldOnly(nearFieldOnly),
+      m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(
+          farField->columns())),
+      m_rangeSpace(
+          Thyra::defaultSpmdVectorSpace<ValueType>(farField->rows())) {
+  if (nearField->rows() != farField->rows() ||
+      nearField->columns() != farField->columns())
+    throw std::invalid_argument(
+        "DiscreteFmmBoundaryOperator::DiscreteFmmBoundaryOperator(): "
+        "the near and far fields have different dimensions");
+}
+
+template <typename ValueType>
+unsigned int DiscreteFmmBoundaryOperator<ValueType>::rowCount() const {
+
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_farField->rows());
+}
+
+template <typename ValueType>
+unsigned int DiscreteFmmBoundaryOperator<ValueType>::columnCount() const {
+
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_farField->columns());
+}
+
+template <typename ValueType>
+shared_ptr<const hmat::BlockSparseMatrix<ValueType>>
+DiscreteFmmBoundaryOperator<ValueType>::nearField() const {
+  return m_nearField;
+}
+
+template <typename ValueType>
+shared_ptr<const FmmFarField<ValueType>>
+DiscreteFmmBoundaryOperator<ValueType>::farField() const {
+  return m_farField;
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteFmmBoundaryOperator<ValueType>>
+DiscreteFmmBoundaryOperator<ValueType>::nearFieldOperator() const {
+  return shared_ptr<const DiscreteFmmBoundaryOperator<ValueType>>(
+      new DiscreteFmmBoundaryOperator<ValueType>(m_nearField, m_farField,
+                                                 true));
+}
+
+template <typename ValueType>
+bool DiscreteFmmBoundaryOperator<ValueType>::nearFieldOnly() const {
+  return m_nearFieldOnly;
+}
+
+template <typename ValueType>
+void DiscreteFmmBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {}
+
+template <typename ValueType>
+void DiscreteFmmBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteFmmBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+
+  hmat::TransposeMode hmatTrans;
+  if (trans == TranspositionMode::NO_TRANSPOSE)
+    hmatTrans = hmat::NOTRANS;
+  else if (trans == TranspositionMode::TRANSPOSE)
+    hmatTrans = hmat::TRANS;
+  else if (trans == TranspositionMode::CONJUGATE)
+    hmatTrans = hmat::CONJ;
+  else
+    hmatTrans = hmat::CONJTRANS;
+  const bool transposed =
+      (hmatTrans == hmat::TRANS || hmatTrans == hmat::CONJTRANS);
+
+  const auto &blockClusterTree = *m_farField->blockClusterTree();
+  const std::vector<std::size_t> &inputDofs =
+      transposed ? blockClusterTree.rowClusterTree()->hMatDofToOriginalDofMap()
+                 : blockClusterTree.columnClusterTree()
+                       ->hMatDofToOriginalDofMap();
+  const std::vector<std::size_t> &outputDofs =
+      transposed ? blockClusterTree.columnClusterTree()
+                       ->hMatDofToOriginalDofMap()
+                 : blockClusterTree.rowClusterTree()->hMatDofToOriginalDofMap();
+  if (x_in.n_rows != inputDofs.size() || y_inout.n_rows != outputDofs.size() ||
+      x_in.n_cols != y_inout.n_cols)
+    throw std::invalid_argument(
+        "DiscreteFmmBoundaryOperator::applyBuiltInBlockImpl(): "
+        "incompatible dimensions");
+
+  arma::Mat<ValueType> xPermuted(x_in.n_rows, x_in.n_cols);
+  for (std::size_t i = 0; i < inputDofs.size(); ++i)
+    xPermuted.row(i) = x_in.row(inputDofs[i]);
+  arma::Mat<ValueType> yPermuted(y_inout.n_rows, y_inout.n_cols,
+                                 arma::fill::zeros);
+  m_nearField->apply(xPermuted, yPermuted, hmatTrans, alpha);
+  if (!m_nearFieldOnly)
+    m_farField->apply(xPermuted, yPermuted, hmatTrans, alpha);
+
+  if (beta == ValueType(0))
+    y_inout.zeros();
+  else if (beta != ValueType(1))
+    y_inout *= beta;
+  for (std::size_t i = 0; i < outputDofs.size(); ++i)
+    y_inout.row(outputDofs[i]) += yPermuted.row(i);
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteFmmBoundaryOperator<ValueType>::domain() const {
+  return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteFmmBoundaryOperator<ValueType>::range() const {
+  return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool DiscreteFmmBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJTRANS);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteFmmBoundaryOperator);
+}
@@ -0,0 +1,106 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_discrete_fmm_boundary_operator_hpp
+#define bempp_discrete_fmm_boundary_operator_hpp
+
+#include "bempp/common/config_trilinos.hpp"
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "fmm_far_field.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#include "../hmat/block_sparse_matrix.hpp"
+
+namespace Bempp {
+
+/** \brief Discrete boundary operator evaluated by the fast multipole
+ *  method.
+ *
+ *  The operator is the sum of a near field, stored as a block-sparse matrix
+ *  of the inadmissible blocks of a block cluster tree, and a far field
+ *  applied by multipole translations without being assembled (see
+ *  FmmFarField). Both use the H-matrix DOF ordering of the cluster trees
+ *  of the far field; vectors are permuted on every apply. */
+template <typename ValueType>
+class DiscreteFmmBoundaryOperator
+    : public DiscreteBoundaryOperator<ValueType> {
+public:
+  /** \brief Constructor.
+   *
+   *  The near field must use the DOF ordering of the cluster trees of
+   *  \p farField. If \p nearFieldOnly is true, the far field only
+   *  provides the DOF permutations and is not applied. */
+  DiscreteFmmBoundaryOperator(
+      const shared_ptr<const hmat::BlockSparseMatrix<ValueType>> &nearField,
+      const shared_ptr<const FmmFarField<ValueType>> &farField,
+      bool nearFieldOnly = false);
+
+  unsigned int rowCount() const override;
+
+  unsigned int columnCount() const override;
+
+  shared_ptr<const hmat::BlockSparseMatrix<ValueType>> nearField() const;
+  shared_ptr<const FmmFarField<ValueType>> farField() const;
+
+  /** \brief Return an operator sharing the near field of this operator and
+   *  omitting its far field.
+   *
+   *  The near field is cheap to apply and can serve as the basis of a
+   *  preconditioner. */
+  shared_ptr<const DiscreteFmmBoundaryOperator<ValueType>>
+  nearFieldOperator() const;
+
+  /** \brief Return true if the operator represents only the near field. */
+  bool nearFieldOnly() const;
+
+  void addBlock(const std::vector<int> &rows, const std::vector<int> &cols,
+                const ValueType alpha, arma::Mat<ValueType> &block) const
+      override;
+
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+
+private:
+  void applyBuiltInImpl(const TranspositionMode trans,
+                        const arma::Col<ValueType> &x_in,
+                        arma::Col<ValueType> &y_inout, const ValueType alpha,
+                        const ValueType beta) const override;
+
+  void applyBuiltInBlockImpl(const TranspositionMode trans,
+                             const arma::Mat<ValueType> &x_in,
+                             arma::Mat<ValueType> &y_inout,
+                             const ValueType alpha,
+                             const ValueType beta) const override;
+
+  shared_ptr<const hmat::BlockSparseMatrix<ValueType>> m_nearField;
+  shared_ptr<const FmmFarField<ValueType>> m_farField;
+  bool m_nearFieldOnly;
+
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
+};
+}
+
+#endif
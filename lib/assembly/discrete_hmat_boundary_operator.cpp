@@ -23,17 +23,146 @@
 #include <boost/numeric/conversion/converter.hpp>
 #include "../hmat/compressed_matrix.hpp"
 #include "../hmat/hmatrix.hpp"
+#include "../hmat/hmatrix_arithmetic.hpp"
+#include "../hmat/hmatrix_sketching_compressor.hpp"
+#include "../hmat/matvec_accessor.hpp"
+
+#include <stdexcept>
+#include <string>
 
 namespace Bempp {
 
+namespace {
+
+// Complex H-matrices are applied to complex vectors by apply()
+template <typename ValueType>
+bool applyToComplexNatively(const hmat::DefaultHMatrixType<ValueType> &hMatrix,
+                            bool hMatDofOrdering, bool transposed,
+                            const arma::Mat<ValueType> &x_in,
+                            arma::Mat<ValueType> &y_inout, ValueType alpha,
+                            ValueType beta) {
+  return false;
+}
+
+// Compute y := alpha * op(A) * x + beta * y for a real H-matrix A and complex
+// x and y. The real and imaginary parts of x are gathered directly in
+// H-matrix DOF ordering and the result is scattered back in one pass, so the
+// tree is traversed once with real arithmetic and without the permuted
+// complex copies that HMatrix::apply() would make.
+template <typename RealType>
+bool applyToComplexNatively(const hmat::DefaultHMatrixType<RealType> &hMatrix,
+                            bool hMatDofOrdering, bool transposed,
+                            const arma::Mat<std::complex<RealType>> &x_in,
+                            arma::Mat<std::complex<RealType>> &y_inout,
+                            std::complex<RealType> alpha,
+                            std::complex<RealType> beta) {
+  typedef std::complex<RealType> ComplexType;
+
+  const hmat::DefaultBlockClusterTreeType &tree = *hMatrix.blockClusterTree();
+  const std::vector<std::size_t> &inputDofs =
+      (transposed ? tree.rowClusterTree() : tree.columnClusterTree())
+          ->hMatDofToOriginalDofMap();
+  const std::vector<std::size_t> &outputDofs =
+      (transposed ? tree.columnClusterTree() : tree.rowClusterTree())
+          ->originalDofToHMatDofMap();
+
+  const std::size_t colCount = x_in.n_cols;
+  arma::Mat<RealType> x(x_in.n_rows, 2 * colCount);
+  for (std::size_t c = 0; c < colCount; ++c) {
+    const ComplexType *xCol = x_in.colptr(c);
+    RealType *xRe = x.colptr(c);
+    RealType *xIm = x.colptr(colCount + c);
+    for (std::size_t i = 0; i < x_in.n_rows; ++i) {
+      const ComplexType value = xCol[hMatDofOrdering ? i : inputDofs[i]];
+      xRe[i] = value.real();
+      xIm[i] = value.imag();
+    }
+  }
+  arma::Mat<RealType> y(y_inout.n_rows, 2 * colCount);
+  hMatrix.applyPermuted(x, y, transposed ? hmat::TRANS : hmat::NOTRANS, 1.,
+                        0.);
+
+  for (std::size_t c = 0; c < colCount; ++c) {
+    const RealType *yRe = y.colptr(c);
+    const RealType *yIm = y.colptr(colCount + c);
+    ComplexType *yCol = y_inout.colptr(c);
+    for (std::size_t i = 0; i < y_inout.n_rows; ++i) {
+      const std::size_t j = hMatDofOrdering ? i : outputDofs[i];
+      const ComplexType value = alpha * ComplexType(yRe[j], yIm[j]);
+      yCol[i] = beta == ComplexType(0) ? value : value + beta * yCol[i];
+    }
+  }
+  return true;
+}
+
+// Products of a discrete operator with vectors in H-matrix DOF ordering
+template <typename ValueType>
+class DiscreteOperatorMatVecAccessor
+    : public hmat::MatVecAccessor<ValueType> {
+public:
+  DiscreteOperatorMatVecAccessor(
+      const DiscreteBoundaryOperator<ValueType> &op,
+      const hmat::DefaultBlockClusterTreeType &blockClusterTree)
+      : m_op(op), m_blockClusterTree(blockClusterTree) {}
+
+  void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+             hmat::TransposeMode trans) const override {
+    const bool adjoint = trans == hmat::CONJTRANS;
+    const std::vector<std::size_t> &inputDofs =
+        (adjoint ? m_blockClusterTree.rowClusterTree()
+                 : m_blockClusterTree.columnClusterTree())
+            ->hMatDofToOriginalDofMap();
+    const std::vector<std::size_t> &outputDofs =
+        (adjoint ? m_blockClusterTree.columnClusterTree()
+                 : m_blockClusterTree.rowClusterTree())
+            ->hMatDofToOriginalDofMap();
+
+    arma::Mat<ValueType> x(X.n_rows, X.n_cols);
+    for (std::size_t i = 0; i < inputDofs.size(); ++i)
+      x.row(inputDofs[i]) = X.row(i);
+    arma::Mat<ValueType> y(outputDofs.size(), X.n_cols);
+    m_op.apply(adjoint ? CONJUGATE_TRANSPOSE : NO_TRANSPOSE, x, y, 1, 0);
+    Y.set_size(outputDofs.size(), X.n_cols);
+    for (std::size_t i = 0; i < outputDofs.size(); ++i)
+      Y.row(i) = y.row(outputDofs[i]);
+  }
+
+private:
+  const DiscreteBoundaryOperator<ValueType> &m_op;
+  const hmat::DefaultBlockClusterTreeType &m_blockClusterTree;
+};
+
+template <typename ValueType>
+shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+castToHMatOperator(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op,
+    const char *function) {
+  shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>> hMatOp =
+      boost::dynamic_pointer_cast<const DiscreteHMatBoundaryOperator<ValueType>>(
+          op);
+  if (!hMatOp || hMatOp->nearFieldOnly())
+    throw std::invalid_argument(std::string(function) +
+                                "(): operator is not stored as a H-matrix");
+  return hMatOp;
+}
+
+} // namespace
+
 template <typename ValueType>
 DiscreteHMatBoundaryOperator<ValueType>::DiscreteHMatBoundaryOperator(
-    const shared_ptr<hmat::DefaultHMatrixType<ValueType>> &hMatrix)
-    : m_hMatrix(hMatrix),
+    const shared_ptr<hmat::DefaultHMatrixType<ValueType>> &hMatrix,
+    bool hMatDofOrdering, bool nearFieldOnly)
+    : m_hMatrix(hMatrix), m_hMatDofOrdering(hMatDofOrdering),
+      m_nearFieldOnly(nearFieldOnly),
       m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(
           hMatrix->columns())),
       m_rangeSpace(
-          Thyra::defaultSpmdVectorSpace<ValueType>(hMatrix->rows())) {}
+          Thyra::defaultSpmdVectorSpace<ValueType>(hMatrix->rows())) {
+  if (nearFieldOnly && !hMatrix->nearField())
+    throw std::invalid_argument(
+        "DiscreteHMatBoundaryOperator::DiscreteHMatBoundaryOperator(): "
+        "the near field of the H-matrix has not been extracted");
+}
 
 template <typename ValueType>
 unsigned int DiscreteHMatBoundaryOperator<ValueType>::rowCount() const {
@@ -56,6 +185,51 @@ DiscreteHMatBoundaryOperator<ValueType>::hMatrix() const
     return m_hMatrix;
 }
 
+template <typename ValueType>
+bool DiscreteHMatBoundaryOperator<ValueType>::hMatDofOrdering() const {
+  return m_hMatDofOrdering;
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+DiscreteHMatBoundaryOperator<ValueType>::operatorInHMatDofOrdering() const {
+  shared_ptr<DiscreteHMatBoundaryOperator<ValueType>> result(
+      new DiscreteHMatBoundaryOperator<ValueType>(m_hMatrix, true,
+                                                  m_nearFieldOnly));
+  result->shareMemoryAllocation(*this);
+  return result;
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+DiscreteHMatBoundaryOperator<ValueType>::nearFieldOperator() const {
+  shared_ptr<DiscreteHMatBoundaryOperator<ValueType>> result(
+      new DiscreteHMatBoundaryOperator<ValueType>(m_hMatrix, m_hMatDofOrdering,
+                                                  true));
+  result->shareMemoryAllocation(*this);
+  return result;
+}
+
+template <typename ValueType>
+bool DiscreteHMatBoundaryOperator<ValueType>::nearFieldOnly() const {
+  return m_nearFieldOnly;
+}
+
+template <typename ValueType>
+void DiscreteHMatBoundaryOperator<ValueType>::save(
+    const std::string &fileName) const {
+  m_hMatrix->save(fileName);
+}
+
+template <typename ValueType>
+shared_ptr<DiscreteHMatBoundaryOperator<ValueType>>
+DiscreteHMatBoundaryOperator<ValueType>::load(const std::string &fileName,
+                                              bool memoryMap) {
+  return shared_ptr<DiscreteHMatBoundaryOperator<ValueType>>(
+      new DiscreteHMatBoundaryOperator<ValueType>(
+          hmat::DefaultHMatrixType<ValueType>::load(fileName, memoryMap)));
+}
+
 template <typename ValueType>
 void DiscreteHMatBoundaryOperator<ValueType>::addBlock(
     const std::vector<int> &rows, const std::vector<int> &cols,
@@ -66,6 +240,14 @@ void DiscreteHMatBoundaryOperator<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteHMatBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
 
   hmat::TransposeMode hmatTrans;
   if (trans == TranspositionMode::NO_TRANSPOSE)
@@ -76,7 +258,33 @@ void DiscreteHMatBoundaryOperator<ValueType>::applyBuiltInImpl(
     hmatTrans = hmat::CONJ;
   else
     hmatTrans = hmat::CONJTRANS;
-  m_hMatrix->apply(x_in, y_inout, hmatTrans, alpha, beta);
+  if (m_nearFieldOnly) {
+    if (m_hMatDofOrdering) {
+      if (beta == ValueType(0))
+        y_inout.zeros();
+      else if (beta != ValueType(1))
+        y_inout *= beta;
+      m_hMatrix->nearField()->apply(x_in, y_inout, hmatTrans, alpha);
+    } else
+      m_hMatrix->applyNearField(x_in, y_inout, hmatTrans, alpha, beta);
+  } else if (m_hMatDofOrdering)
+    m_hMatrix->applyPermuted(x_in, y_inout, hmatTrans, alpha, beta);
+  else
+    m_hMatrix->apply(x_in, y_inout, hmatTrans, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteHMatBoundaryOperator<ValueType>::applyToComplexImpl(
+    const TranspositionMode trans, const arma::Mat<ComplexType> &x_in,
+    arma::Mat<ComplexType> &y_inout, const ComplexType alpha,
+    const ComplexType beta) const {
+  // The conjugation of a real matrix can be ignored
+  const bool transposed = trans == TranspositionMode::TRANSPOSE ||
+                          trans == TranspositionMode::CONJUGATE_TRANSPOSE;
+  if (m_nearFieldOnly ||
+      !applyToComplexNatively(*m_hMatrix, m_hMatDofOrdering, transposed, x_in,
+                              y_inout, alpha, beta))
+    Base::applyToComplexImpl(trans, x_in, y_inout, alpha, beta);
 }
 
 template <typename ValueType>
@@ -98,7 +306,108 @@ bool DiscreteHMatBoundaryOperator<ValueType>::opSupportedImpl(
           M_trans == Thyra::CONJTRANS);
 }
 
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> sketchedHMatOperator(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op,
+    const shared_ptr<const hmat::DefaultBlockClusterTreeType> &
+        blockClusterTree,
+    double eps, int sampleCount) {
+  if (!op || !blockClusterTree)
+    throw std::invalid_argument("sketchedHMatOperator(): "
+                                "operator and block cluster tree must not "
+                                "be null");
+  if (op->rowCount() != blockClusterTree->rows() ||
+      op->columnCount() != blockClusterTree->columns())
+    throw std::invalid_argument("sketchedHMatOperator(): "
+                                "dimensions of the operator and of the "
+                                "block cluster tree do not match");
+
+  DiscreteOperatorMatVecAccessor<ValueType> matVecAccessor(
+      *op, *blockClusterTree);
+  hmat::HMatrixSketchingCompressor<ValueType, 2> compressor(
+      *blockClusterTree, matVecAccessor, sampleCount, eps);
+  shared_ptr<hmat::DefaultHMatrixType<ValueType>> hMatrix(
+      new hmat::DefaultHMatrixType<ValueType>(
+          boost::const_pointer_cast<hmat::DefaultBlockClusterTreeType>(
+              blockClusterTree),
+          compressor));
+  return shared_ptr<const DiscreteBoundaryOperator<ValueType>>(
+      new DiscreteHMatBoundaryOperator<ValueType>(hMatrix));
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> hMatOperatorSum(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op1,
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op2,
+    double eps) {
+  auto hMatOp1 = castToHMatOperator(op1, "hMatOperatorSum");
+  auto hMatOp2 = castToHMatOperator(op2, "hMatOperatorSum");
+  if (hMatOp1->hMatDofOrdering() != hMatOp2->hMatDofOrdering())
+    throw std::invalid_argument("hMatOperatorSum(): "
+                                "operators act in different DOF orderings");
+  return shared_ptr<const DiscreteBoundaryOperator<ValueType>>(
+      new DiscreteHMatBoundaryOperator<ValueType>(
+          hmat::formattedAddition(*hMatOp1->hMatrix(), *hMatOp2->hMatrix(),
+                                  eps),
+          hMatOp1->hMatDofOrdering()));
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> hMatOperatorProduct(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op1,
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op2,
+    double eps) {
+  auto hMatOp1 = castToHMatOperator(op1, "hMatOperatorProduct");
+  auto hMatOp2 = castToHMatOperator(op2, "hMatOperatorProduct");
+  if (hMatOp1->hMatDofOrdering() != hMatOp2->hMatDofOrdering())
+    throw std::invalid_argument("hMatOperatorProduct(): "
+                                "operators act in different DOF orderings");
+  return shared_ptr<const DiscreteBoundaryOperator<ValueType>>(
+      new DiscreteHMatBoundaryOperator<ValueType>(
+          hmat::formattedMultiplication(*hMatOp1->hMatrix(),
+                                        *hMatOp2->hMatrix(), eps),
+          hMatOp1->hMatDofOrdering()));
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteHMatBoundaryOperator);
+
+#define INSTANTIATE_FREE_FUNCTIONS(RESULT)                                     \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  sketchedHMatOperator(                                                        \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op,            \
+      const shared_ptr<const hmat::DefaultBlockClusterTreeType> &              \
+          blockClusterTree,                                                    \
+      double eps, int sampleCount);                                            \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  hMatOperatorSum(                                                             \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op1,           \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op2,           \
+      double eps);                                                             \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  hMatOperatorProduct(                                                         \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op1,           \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op2,           \
+      double eps)
+
+#if defined(ENABLE_SINGLE_PRECISION)
+INSTANTIATE_FREE_FUNCTIONS(float);
+#endif
+
+#if defined(ENABLE_SINGLE_PRECISION) &&                                        \
+    (defined(ENABLE_COMPLEX_BASIS_FUNCTIONS) ||                                \
+     defined(ENABLE_COMPLEX_KERNELS))
+INSTANTIATE_FREE_FUNCTIONS(std::complex<float>);
+#endif
+
+#if defined(ENABLE_DOUBLE_PRECISION)
+INSTANTIATE_FREE_FUNCTIONS(double);
+#endif
+
+#if defined(ENABLE_DOUBLE_PRECISION) &&                                        \
+    (defined(ENABLE_COMPLEX_BASIS_FUNCTIONS) ||                                \
+     defined(ENABLE_COMPLEX_KERNELS))
+INSTANTIATE_FREE_FUNCTIONS(std::complex<double>);
+#endif
 }
 
 
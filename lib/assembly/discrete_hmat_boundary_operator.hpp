@@ -29,14 +29,27 @@
 #include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
 #include "../hmat/hmatrix.hpp"
 
+#include <string>
+
 namespace Bempp {
 
 template <typename ValueType>
 class DiscreteHMatBoundaryOperator
     : public DiscreteBoundaryOperator<ValueType> {
 public:
+  typedef DiscreteBoundaryOperator<ValueType> Base;
+  typedef typename Base::ComplexType ComplexType;
+
+  /** \brief Constructor.
+   *
+   *  If \p hMatDofOrdering is true, the operator acts on vectors ordered
+   *  according to the H-matrix DOF permutation instead of the original
+   *  DOF ordering, which saves two vector permutations per apply. If
+   *  \p nearFieldOnly is true, the operator represents only the near field
+   *  extracted by hmat::HMatrix::extractNearField(). */
   DiscreteHMatBoundaryOperator(
-      const shared_ptr<hmat::DefaultHMatrixType<ValueType>> &hMatrix);
+      const shared_ptr<hmat::DefaultHMatrixType<ValueType>> &hMatrix,
+      bool hMatDofOrdering = false, bool nearFieldOnly = false);
 
   unsigned int rowCount() const override;
 
@@ -44,6 +57,44 @@ public:
 
   shared_ptr<const hmat::DefaultHMatrixType<ValueType>> hMatrix() const;
 
+  /** \brief Return true if the operator acts in H-matrix DOF ordering. */
+  bool hMatDofOrdering() const;
+
+  /** \brief Return an operator sharing the same H-matrix that acts on
+   *  vectors in H-matrix DOF ordering.
+   *
+   *  Right-hand sides must be permuted with
+   *  <tt>hMatrix()->permuteMatToHMatDofs(rhs, hmat::ROW)</tt> and solutions
+   *  permuted back with
+   *  <tt>hMatrix()->permuteMatToOriginalDofs(sol, hmat::COL)</tt>. */
+  shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+  operatorInHMatDofOrdering() const;
+
+  /** \brief Return an operator sharing the same H-matrix that represents
+   *  only its near field, i.e. its inadmissible blocks.
+   *
+   *  Requires the near field to be stored as a block-sparse matrix (HMat
+   *  parameter "blockSparseNearField"). The near field is cheap to apply
+   *  and can serve as the basis of a preconditioner. */
+  shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>>
+  nearFieldOperator() const;
+
+  /** \brief Return true if the operator represents only the near field. */
+  bool nearFieldOnly() const;
+
+  /** \brief Write the underlying H-matrix to a binary file.
+   *
+   *  See hmat::HMatrix::save(). */
+  void save(const std::string &fileName) const;
+
+  /** \brief Load an operator from a file written by save().
+   *
+   *  The H-matrix is frozen. If \p memoryMap is true, its payloads are used
+   *  in place from a memory mapping of the file. See
+   *  hmat::HMatrix::load(). */
+  static shared_ptr<DiscreteHMatBoundaryOperator<ValueType>>
+  load(const std::string &fileName, bool memoryMap = true);
+
   void addBlock(const std::vector<int> &rows, const std::vector<int> &cols,
                 const ValueType alpha, arma::Mat<ValueType> &block) const
       override;
@@ -61,11 +112,80 @@ private:
                         arma::Col<ValueType> &y_inout, const ValueType alpha,
                         const ValueType beta) const override;
 
+  void applyBuiltInBlockImpl(const TranspositionMode trans,
+                             const arma::Mat<ValueType> &x_in,
+                             arma::Mat<ValueType> &y_inout,
+                             const ValueType alpha,
+                             const ValueType beta) const override;
+
+  void applyToComplexImpl(const TranspositionMode trans,
+                          const arma::Mat<ComplexType> &x_in,
+                          arma::Mat<ComplexType> &y_inout,
+                          const ComplexType alpha,
+                          const ComplexType beta) const override;
+
   shared_ptr<hmat::DefaultHMatrixType<ValueType>> m_hMatrix;
+  bool m_hMatDofOrdering;
+  bool m_nearFieldOnly;
 
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
 };
+
+/** \relates DiscreteHMatBoundaryOperator
+ *  \brief Compress an operator given only by its products with vectors.
+ *
+ *  Composite operators such as sums, products and synthetic operators have
+ *  no entry access and cannot be compressed by ACA. This function builds
+ *  an H-matrix approximation of \p op on \p blockClusterTree from the
+ *  products of \p op and of its adjoint with blocks of random vectors; see
+ *  hmat::HMatrixSketchingCompressor. The block cluster tree of any
+ *  H-matrix operator mapping between the same spaces can be used, e.g.
+ *  <tt>hMatrix()->blockClusterTree()</tt>. \p op must support the
+ *  conjugate transpose.
+ *
+ *  \param[in] op Operator to compress.
+ *  \param[in] blockClusterTree Block structure of the H-matrix.
+ *  \param[in] eps Relative accuracy of the low-rank blocks.
+ *  \param[in] sampleCount Number of random vectors per block, which bounds
+ *  the block ranks.
+ *
+ *  \return A shared pointer to a newly allocated
+ *  DiscreteHMatBoundaryOperator. */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> sketchedHMatOperator(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op,
+    const shared_ptr<const hmat::DefaultBlockClusterTreeType> &
+        blockClusterTree,
+    double eps, int sampleCount = 30);
+
+/** \relates DiscreteHMatBoundaryOperator
+ *  \brief Return the sum of two operators stored as H-matrices on the same
+ *  block cluster tree, as a single H-matrix.
+ *
+ *  The sum is formed by formatted addition with truncation to the relative
+ *  accuracy \p eps; see hmat::formattedAddition(). */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> hMatOperatorSum(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op1,
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op2,
+    double eps);
+
+/** \relates DiscreteHMatBoundaryOperator
+ *  \brief Return the product \p op1 * \p op2 of two operators stored as
+ *  H-matrices, as a single H-matrix.
+ *
+ *  The product is formed by formatted multiplication with truncation to the
+ *  relative accuracy \p eps in the block structure of one of the factors;
+ *  see hmat::formattedMultiplication(). The domain of \p op1 and the range
+ *  of \p op2 must be clustered alike, which is the case if they are
+ *  discretized in the same space. Applying the result costs one H-matrix
+ *  product instead of two. */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> hMatOperatorProduct(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op1,
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op2,
+    double eps);
 }
 
 #endif
@@ -23,6 +23,7 @@
 
 #include "discrete_inverse_sparse_boundary_operator.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
+#include "sparse_ldlt_decomposition.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 
 #include <iostream>
@@ -161,12 +162,15 @@ DiscreteInverseSparseBoundaryOperator<ValueType>::
     throw std::invalid_argument("DiscreteInverseSparseBoundaryOperator::"
                                 "DiscreteInverseSparseBoundaryOperator(): "
                                 "square matrix expected");
+  if (m_symmetry & (SYMMETRIC | HERMITIAN)) { // Epetra matrices are real,
+                                              // so symmetric == Hermitian
+    m_ldlt.reset(new SparseLdltDecomposition(*m_mat));
+    return;
+  }
+
   // const_cast: Amesos is not const-correct. Amesos2 will be,
   // and Amesos2 takes a RCP to a const matrix.
   m_problem->SetOperator(const_cast<Epetra_CrsMatrix *>(m_mat.get()));
-  if (m_symmetry & (SYMMETRIC | HERMITIAN)) // Epetra matrices are real, so
-                                            // symmetric == Hermitian
-    m_problem->AssertSymmetric();
 
   Amesos amesosFactory;
   const char *solverName = "Amesos_Klu";
@@ -229,7 +233,8 @@ DiscreteInverseSparseBoundaryOperator<ValueType>::range() const {
 template <typename ValueType>
 bool DiscreteInverseSparseBoundaryOperator<ValueType>::opSupportedImpl(
     Thyra::EOpTransp M_trans) const {
-  return (M_trans == Thyra::NOTRANS);
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJ || M_trans == Thyra::CONJTRANS);
 }
 
 template <typename ValueType>
@@ -238,18 +243,75 @@ void DiscreteInverseSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
   // TODO: protect with a mutex (this function is not thread-safe)
-  if (trans != NO_TRANSPOSE)
+  if (trans != NO_TRANSPOSE && trans != CONJUGATE && trans != TRANSPOSE &&
+      trans != CONJUGATE_TRANSPOSE)
     throw std::invalid_argument("DiscreteInverseSparseBoundaryOperator::"
                                 "applyBuiltInImpl(): "
-                                "transposes and conjugates are not supported");
+                                "invalid transposition mode");
+  // The matrix is real, so conjugation does not affect its inverse. The
+  // transposed system is solved with the existing factorisation.
+  const bool transposed =
+      (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE) &&
+      !(m_symmetry & (SYMMETRIC | HERMITIAN));
   const size_t dim = m_space->dim();
   if (x_in.n_rows != dim || y_inout.n_rows != dim)
     throw std::invalid_argument("DiscreteInverseSparseBoundaryOperator::"
                                 "applyBuiltInImpl(): "
                                 "incorrect vector lengths");
   arma::Col<ValueType> solution(dim);
+  if (m_ldlt) {
+    solution = x_in;
+    m_ldlt->solve(solution);
+    if (beta == static_cast<ValueType>(0.))
+      y_inout = alpha * solution;
+    else {
+      y_inout *= beta;
+      y_inout += alpha * solution;
+    }
+    return;
+  }
   solution.fill(0.);
-  solveWithAmesos(*m_problem, *m_solver, solution, x_in);
+  if (transposed)
+    m_solver->SetUseTranspose(true);
+  try {
+    solveWithAmesos(*m_problem, *m_solver, solution, x_in);
+  } catch (...) {
+    if (transposed)
+      m_solver->SetUseTranspose(false);
+    throw;
+  }
+  if (transposed)
+    m_solver->SetUseTranspose(false);
+  if (beta == static_cast<ValueType>(0.))
+    y_inout = alpha * solution;
+  else {
+    y_inout *= beta;
+    y_inout += alpha * solution;
+  }
+}
+
+template <typename ValueType>
+void DiscreteInverseSparseBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  if (!m_ldlt) {
+    for (size_t i = 0; i < x_in.n_cols; ++i) {
+      const arma::Col<ValueType> x_in_col = x_in.unsafe_col(i);
+      arma::Col<ValueType> y_inout_col = y_inout.unsafe_col(i);
+      applyBuiltInImpl(trans, x_in_col, y_inout_col, alpha, beta);
+    }
+    return;
+  }
+  // The inverse is symmetric, so trans only matters for conjugation, and the
+  // matrix is real
+  const size_t dim = m_space->dim();
+  if (x_in.n_rows != dim || y_inout.n_rows != dim)
+    throw std::invalid_argument("DiscreteInverseSparseBoundaryOperator::"
+                                "applyBuiltInBlockImpl(): "
+                                "incorrect vector lengths");
+  arma::Mat<ValueType> solution = x_in;
+  m_ldlt->solve(solution);
   if (beta == static_cast<ValueType>(0.))
     y_inout = alpha * solution;
   else {
@@ -44,9 +44,17 @@ class Epetra_CrsMatrix;
 
 namespace Bempp {
 
+/** \cond FORWARD_DECL */
+class SparseLdltDecomposition;
+/** \endcond */
+
 /** \ingroup discrete_boundary_operators
  *  \brief Discrete boundary operator representing the inverse of another
  *  operator and stored as a sparse LU decomposition.
+ *
+ *  Symmetric matrices are decomposed by SparseLdltDecomposition, which
+ *  also solves for all columns of a multivector at once; other matrices by
+ *  the KLU solver of Amesos.
  */
 template <typename ValueType>
 class DiscreteInverseSparseBoundaryOperator
@@ -85,6 +93,11 @@ private:
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
 
 private:
   /** \cond PRIVATE */
@@ -93,6 +106,7 @@ private:
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_space;
   int m_symmetry;
   std::unique_ptr<Amesos_BaseSolver> m_solver;
+  std::unique_ptr<const SparseLdltDecomposition> m_ldlt;
   /** \endcond */
 };
 
@@ -0,0 +1,260 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_opencl.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#include "discrete_opencl_dense_boundary_operator.hpp"
+#include "../common/boost_make_shared_fwd.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#ifdef WITH_OPENCL
+#include "../fiber/CL/dense_matrix_vector_product.cl.str"
+#endif
+
+#include <stdexcept>
+
+#ifdef WITH_TRILINOS
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#endif
+
+namespace Bempp {
+
+namespace {
+
+// Type of the matrix and vector elements stored on the device. The OpenCL
+// programs are compiled with ValueType = double (see
+// Fiber::OpenClHandler::initStr()).
+template <typename ValueType> struct OpenClValueType {
+  typedef double Type;
+  enum { IS_COMPLEX = 0 };
+};
+
+template <typename T> struct OpenClValueType<std::complex<T>> {
+  typedef std::complex<double> Type;
+  enum { IS_COMPLEX = 1 };
+};
+
+} // namespace
+
+template <typename ValueType>
+DiscreteOpenClDenseBoundaryOperator<ValueType>::
+    DiscreteOpenClDenseBoundaryOperator(const arma::Mat<ValueType> &mat,
+                                        const OpenClOptions &openClOptions)
+    : m_rowCount(mat.n_rows), m_columnCount(mat.n_cols)
+#ifdef WITH_TRILINOS
+      ,
+      m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_cols)),
+      m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_rows))
+#endif
+{
+#ifdef WITH_OPENCL
+  typedef typename OpenClValueType<ValueType>::Type DeviceValueType;
+  m_clMat = 0;
+  if (openClOptions.useOpenCl) {
+    m_openClHandler = boost::make_shared<Fiber::OpenClHandler>(openClOptions);
+    const arma::Mat<DeviceValueType> deviceMat =
+        arma::conv_to<arma::Mat<DeviceValueType>>::from(mat);
+    m_clMat = m_openClHandler->pushBuffer<DeviceValueType>(deviceMat.memptr(),
+                                                           deviceMat.n_elem);
+    return;
+  }
+#endif
+  m_mat = mat;
+}
+
+template <typename ValueType>
+DiscreteOpenClDenseBoundaryOperator<
+    ValueType>::~DiscreteOpenClDenseBoundaryOperator() {
+#ifdef WITH_OPENCL
+  delete m_clMat;
+#endif
+}
+
+template <typename ValueType>
+bool DiscreteOpenClDenseBoundaryOperator<ValueType>::isOnDevice() const {
+#ifdef WITH_OPENCL
+  return m_clMat != 0;
+#else
+  return false;
+#endif
+}
+
+template <typename ValueType>
+arma::Mat<ValueType>
+DiscreteOpenClDenseBoundaryOperator<ValueType>::asMatrix() const {
+#ifdef WITH_OPENCL
+  if (m_clMat) {
+    typedef typename OpenClValueType<ValueType>::Type DeviceValueType;
+    arma::Mat<DeviceValueType> deviceMat(m_rowCount, m_columnCount);
+    {
+      tbb::mutex::scoped_lock lock(m_openClHandler->mutex());
+      m_openClHandler->pullBuffer<DeviceValueType>(
+          *m_clMat, deviceMat.memptr(), deviceMat.n_elem);
+    }
+    return arma::conv_to<arma::Mat<ValueType>>::from(deviceMat);
+  }
+#endif
+  return m_mat;
+}
+
+template <typename ValueType>
+unsigned int DiscreteOpenClDenseBoundaryOperator<ValueType>::rowCount() const {
+  return m_rowCount;
+}
+
+template <typename ValueType>
+unsigned int
+DiscreteOpenClDenseBoundaryOperator<ValueType>::columnCount() const {
+  return m_columnCount;
+}
+
+template <typename ValueType>
+void DiscreteOpenClDenseBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {
+  if (block.n_rows != rows.size() || block.n_cols != cols.size())
+    throw std::invalid_argument(
+        "DiscreteOpenClDenseBoundaryOperator::addBlock(): "
+        "incorrect block size");
+  const arma::Mat<ValueType> mat = asMatrix();
+  for (size_t col = 0; col < cols.size(); ++col)
+    for (size_t row = 0; row < rows.size(); ++row)
+      block(row, col) += alpha * mat(rows[row], cols[col]);
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteOpenClDenseBoundaryOperator<ValueType>::domain() const {
+  return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteOpenClDenseBoundaryOperator<ValueType>::range() const {
+  return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool DiscreteOpenClDenseBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJ || M_trans == Thyra::CONJTRANS);
+}
+#endif // WITH_TRILINOS
+
+template <typename ValueType>
+void DiscreteOpenClDenseBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  if (trans != NO_TRANSPOSE && trans != CONJUGATE && trans != TRANSPOSE &&
+      trans != CONJUGATE_TRANSPOSE)
+    throw std::invalid_argument(
+        "DiscreteOpenClDenseBoundaryOperator::applyBuiltInImpl(): "
+        "invalid transposition mode");
+  const bool transposed = trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE;
+  const bool conjugated = trans == CONJUGATE || trans == CONJUGATE_TRANSPOSE;
+
+  arma::Col<ValueType> product;
+#ifdef WITH_OPENCL
+  if (m_clMat) {
+    typedef typename OpenClValueType<ValueType>::Type DeviceValueType;
+    const int inputCount = transposed ? m_rowCount : m_columnCount;
+    const int outputCount = transposed ? m_columnCount : m_rowCount;
+    const arma::Col<DeviceValueType> x =
+        arma::conv_to<arma::Col<DeviceValueType>>::from(x_in);
+    arma::Col<DeviceValueType> y(outputCount);
+
+    {
+      const Fiber::OpenClHandler &handler = *m_openClHandler;
+      tbb::mutex::scoped_lock lock(handler.mutex());
+
+      cl::Program::Sources sources;
+      sources.push_back(handler.initStr());
+      sources.push_back(std::make_pair(dense_matrix_vector_product_cl,
+                                       dense_matrix_vector_product_cl_len));
+      handler.loadProgramFromStringArray(sources);
+      cl::Kernel &clKernel =
+          handler.setKernel(OpenClValueType<ValueType>::IS_COMPLEX
+                                ? "clDenseMatVecComplex"
+                                : "clDenseMatVec");
+
+      cl::Buffer *clX =
+          handler.pushBuffer<DeviceValueType>(x.memptr(), inputCount);
+      cl::Buffer *clY = handler.createBuffer<DeviceValueType>(
+          outputCount, CL_MEM_WRITE_ONLY);
+      int argIdx = 0;
+      clKernel.setArg(argIdx++, int(m_rowCount));
+      clKernel.setArg(argIdx++, int(m_columnCount));
+      clKernel.setArg(argIdx++, int(transposed));
+      if (OpenClValueType<ValueType>::IS_COMPLEX)
+        clKernel.setArg(argIdx++, int(conjugated));
+      clKernel.setArg(argIdx++, *m_clMat);
+      clKernel.setArg(argIdx++, *clX);
+      clKernel.setArg(argIdx++, *clY);
+      handler.enqueueKernel(cl::NDRange(outputCount));
+      handler.pullBuffer<DeviceValueType>(*clY, y.memptr(), outputCount);
+      delete clY;
+      delete clX;
+    }
+    product = arma::conv_to<arma::Col<ValueType>>::from(y);
+  } else
+#endif
+  {
+    // Conjugate the vectors rather than the matrix (see
+    // DiscreteDenseBoundaryOperator::applyBuiltInBlockImpl())
+    if (transposed)
+      product = conjugated
+                    ? arma::Col<ValueType>(m_mat.t() * x_in)
+                    : arma::Col<ValueType>(
+                          arma::conj(m_mat.t() * arma::conj(x_in)));
+    else
+      product = conjugated ? arma::Col<ValueType>(
+                                 arma::conj(m_mat * arma::conj(x_in)))
+                           : arma::Col<ValueType>(m_mat * x_in);
+  }
+
+  if (beta == static_cast<ValueType>(0.))
+    y_inout.fill(static_cast<ValueType>(0.));
+  else
+    y_inout *= beta;
+  y_inout += alpha * product;
+}
+
+template <typename ValueType>
+shared_ptr<DiscreteOpenClDenseBoundaryOperator<ValueType>>
+discreteOpenClDenseBoundaryOperator(const arma::Mat<ValueType> &mat,
+                                    const OpenClOptions &openClOptions) {
+  typedef DiscreteOpenClDenseBoundaryOperator<ValueType> Op;
+  return boost::make_shared<Op>(mat, openClOptions);
+}
+
+#define INSTANTIATE_NONMEMBER_CONSTRUCTOR(VALUE)                               \
+  template shared_ptr<DiscreteOpenClDenseBoundaryOperator<VALUE>>              \
+  discreteOpenClDenseBoundaryOperator(const arma::Mat<VALUE> &,                \
+                                      const OpenClOptions &)
+FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_NONMEMBER_CONSTRUCTOR);
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(
+    DiscreteOpenClDenseBoundaryOperator);
+
+} // namespace Bempp
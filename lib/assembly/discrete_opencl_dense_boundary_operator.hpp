@@ -0,0 +1,135 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_opencl.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#ifndef bempp_discrete_opencl_dense_boundary_operator_hpp
+#define bempp_discrete_opencl_dense_boundary_operator_hpp
+
+#include "../common/common.hpp"
+
+#include "discrete_boundary_operator.hpp"
+
+#include "../common/shared_ptr.hpp"
+#include "../fiber/opencl_handler.hpp"
+#include "../fiber/opencl_options.hpp"
+
+#ifdef WITH_TRILINOS
+#include <Teuchos_RCP.hpp>
+#include <Thyra_SpmdVectorSpaceBase_decl.hpp>
+#endif
+
+namespace Bempp {
+
+using Fiber::OpenClOptions;
+
+/** \ingroup discrete_boundary_operators
+ *  \brief Discrete boundary operator stored as a dense matrix in the memory
+ *  of an OpenCL device.
+ *
+ *  The matrix is uploaded to the device once, on construction. Each
+ *  matrix-vector product transfers only the input and output vectors, so
+ *  this operator can be used in place of a DiscreteDenseBoundaryOperator in
+ *  iterative solvers whose cost is dominated by matrix-vector products.
+ *
+ *  The device stores the matrix in double precision, whatever \p ValueType.
+ *  If BEM++ has been compiled without OpenCL support or the \p useOpenCl
+ *  member of the OpenClOptions passed to the constructor is false, the
+ *  matrix is kept in host memory and the operator behaves like a
+ *  DiscreteDenseBoundaryOperator. */
+template <typename ValueType>
+class DiscreteOpenClDenseBoundaryOperator
+    : public DiscreteBoundaryOperator<ValueType> {
+public:
+  /** \brief Constructor.
+   *
+   *  Construct a discrete boundary operator represented by the matrix \p mat
+   *  and copy \p mat to the device selected by \p openClOptions. */
+  DiscreteOpenClDenseBoundaryOperator(
+      const arma::Mat<ValueType> &mat,
+      const OpenClOptions &openClOptions = OpenClOptions());
+
+  virtual ~DiscreteOpenClDenseBoundaryOperator();
+
+  /** \brief Return true if the matrix is stored in device memory. */
+  bool isOnDevice() const;
+
+  /** \brief Matrix representation of the operator.
+   *
+   *  The matrix is copied back from the device. */
+  virtual arma::Mat<ValueType> asMatrix() const;
+
+  virtual unsigned int rowCount() const;
+  virtual unsigned int columnCount() const;
+
+  /** \brief Add a subblock of this operator to a matrix.
+   *
+   *  \note The whole matrix is copied back from the device, so this
+   *  function is slow. */
+  virtual void addBlock(const std::vector<int> &rows,
+                        const std::vector<int> &cols, const ValueType alpha,
+                        arma::Mat<ValueType> &block) const;
+
+#ifdef WITH_TRILINOS
+public:
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+#endif
+
+private:
+  virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                const arma::Col<ValueType> &x_in,
+                                arma::Col<ValueType> &y_inout,
+                                const ValueType alpha,
+                                const ValueType beta) const;
+
+private:
+  /** \cond PRIVATE */
+  unsigned int m_rowCount;
+  unsigned int m_columnCount;
+  // Used only if the matrix is not stored on the device
+  arma::Mat<ValueType> m_mat;
+#ifdef WITH_OPENCL
+  shared_ptr<Fiber::OpenClHandler> m_openClHandler;
+  cl::Buffer *m_clMat;
+#endif
+#ifdef WITH_TRILINOS
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
+#endif
+  /** \endcond */
+};
+
+/** \brief
+ *  Return a shared pointer to newly constructed
+ *  DiscreteOpenClDenseBoundaryOperator wrapping a specified matrix. */
+template <typename ValueType>
+shared_ptr<DiscreteOpenClDenseBoundaryOperator<ValueType>>
+discreteOpenClDenseBoundaryOperator(
+    const arma::Mat<ValueType> &mat,
+    const OpenClOptions &openClOptions = OpenClOptions());
+
+} // namespace Bempp
+
+#endif
@@ -35,6 +35,9 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
 #include <Epetra_Map.h>
 #include <Epetra_Vector.h>
@@ -176,6 +179,104 @@ void reallyApplyBuiltInImpl<std::complex<double>>(
     y_inout(i) = std::complex<double>(y_real(i), y_imag(i));
 }
 
+// Native multiplication by a matrix stored in the CRS format (as exposed by
+// Epetra_CrsMatrix::ExtractCrsDataPointers()). Each column of x is multiplied
+// separately, but all of them are processed in a single pass over the matrix.
+
+const size_t SPMV_GRAIN_SIZE = 256;
+
+// Compute y := alpha * A * x + beta * y, with the rows of A distributed
+// among threads.
+template <typename ValueType> class CrsMultiplicationLoopBody {
+public:
+  typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+
+  CrsMultiplicationLoopBody(const int *rowOffsets, const int *colIndices,
+                            const double *values,
+                            const arma::Mat<ValueType> &x,
+                            arma::Mat<ValueType> &y, ValueType alpha,
+                            ValueType beta)
+      : m_rowOffsets(rowOffsets), m_colIndices(colIndices), m_values(values),
+        m_x(x), m_y(y), m_alpha(alpha), m_beta(beta) {}
+
+  void operator()(const tbb::blocked_range<size_t> &r) const {
+    const ValueType zero = 0.;
+    for (size_t row = r.begin(); row != r.end(); ++row) {
+      const int begin = m_rowOffsets[row], end = m_rowOffsets[row + 1];
+      for (size_t col = 0; col < m_x.n_cols; ++col) {
+        const ValueType *x = m_x.colptr(col);
+        ValueType sum = zero;
+        for (int entry = begin; entry < end; ++entry)
+          sum += static_cast<CoordinateType>(m_values[entry]) *
+                 x[m_colIndices[entry]];
+        if (m_beta == zero)
+          m_y(row, col) = m_alpha * sum;
+        else
+          m_y(row, col) = m_alpha * sum + m_beta * m_y(row, col);
+      }
+    }
+  }
+
+private:
+  const int *m_rowOffsets;
+  const int *m_colIndices;
+  const double *m_values;
+  const arma::Mat<ValueType> &m_x;
+  arma::Mat<ValueType> &m_y;
+  ValueType m_alpha, m_beta;
+};
+
+// Compute A^T * x. Rows of A are distributed among threads, each of which
+// scatters its contributions into a private accumulator.
+template <typename ValueType> class TransposedCrsMultiplicationLoopBody {
+public:
+  typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+
+  TransposedCrsMultiplicationLoopBody(const int *rowOffsets,
+                                      const int *colIndices,
+                                      const double *values,
+                                      const arma::Mat<ValueType> &x,
+                                      size_t resultRowCount)
+      : m_rowOffsets(rowOffsets), m_colIndices(colIndices), m_values(values),
+        m_x(x), m_result(resultRowCount, x.n_cols) {
+    m_result.fill(0.);
+  }
+
+  TransposedCrsMultiplicationLoopBody(TransposedCrsMultiplicationLoopBody &body,
+                                      tbb::split)
+      : m_rowOffsets(body.m_rowOffsets), m_colIndices(body.m_colIndices),
+        m_values(body.m_values), m_x(body.m_x),
+        m_result(body.m_result.n_rows, body.m_result.n_cols) {
+    m_result.fill(0.);
+  }
+
+  void operator()(const tbb::blocked_range<size_t> &r) {
+    for (size_t row = r.begin(); row != r.end(); ++row) {
+      const int begin = m_rowOffsets[row], end = m_rowOffsets[row + 1];
+      for (size_t col = 0; col < m_x.n_cols; ++col) {
+        const ValueType x = m_x(row, col);
+        ValueType *result = m_result.colptr(col);
+        for (int entry = begin; entry < end; ++entry)
+          result[m_colIndices[entry]] +=
+              static_cast<CoordinateType>(m_values[entry]) * x;
+      }
+    }
+  }
+
+  void join(const TransposedCrsMultiplicationLoopBody &other) {
+    m_result += other.m_result;
+  }
+
+  const arma::Mat<ValueType> &result() const { return m_result; }
+
+private:
+  const int *m_rowOffsets;
+  const int *m_colIndices;
+  const double *m_values;
+  const arma::Mat<ValueType> &m_x;
+  arma::Mat<ValueType> m_result;
+};
+
 } // namespace
 
 template <typename ValueType>
@@ -186,7 +287,23 @@ DiscreteSparseBoundaryOperator<ValueType>::DiscreteSparseBoundaryOperator(
     const shared_ptr<IndexPermutation> &rangePermutation)
     : m_mat(mat), m_symmetry(symmetry), m_trans(trans),
       m_blockCluster(blockCluster), m_domainPermutation(domainPermutation),
-      m_rangePermutation(rangePermutation) {
+      m_rangePermutation(rangePermutation), m_rowOffsets(0), m_colIndices(0),
+      m_values(0) {
+  // Use the CRS arrays of the matrix directly in applyBuiltInImpl() if they
+  // are available (i.e. the matrix is local, has optimized storage and its
+  // local column indices coincide with global ones); otherwise fall back to
+  // Epetra_CrsMatrix::Multiply().
+  int *rowOffsets = 0;
+  int *colIndices = 0;
+  double *values = 0;
+  if (m_mat->Comm().NumProc() == 1 && m_mat->Filled() &&
+      m_mat->StorageOptimized() &&
+      m_mat->ColMap().SameAs(m_mat->DomainMap()) &&
+      m_mat->ExtractCrsDataPointers(rowOffsets, colIndices, values) == 0) {
+    m_rowOffsets = rowOffsets;
+    m_colIndices = colIndices;
+    m_values = values;
+  }
   m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(
       isTransposed() ? m_mat->NumGlobalRows() : m_mat->NumGlobalCols());
   m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(
@@ -408,7 +525,78 @@ void DiscreteSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
       // default: should not happen; anyway, don't change trans
     }
 
-  reallyApplyBuiltInImpl(*m_mat, realTrans, x_in, y_inout, alpha, beta);
+  if (m_values)
+    applyNatively(realTrans, x_in, y_inout, alpha, beta);
+  else
+    reallyApplyBuiltInImpl(*m_mat, realTrans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  if (!m_values) {
+    for (size_t i = 0; i < x_in.n_cols; ++i) {
+      const arma::Col<ValueType> x_in_col = x_in.unsafe_col(i);
+      arma::Col<ValueType> y_inout_col = y_inout.unsafe_col(i);
+      applyBuiltInImpl(trans, x_in_col, y_inout_col, alpha, beta);
+    }
+    return;
+  }
+  applyNatively(isTransposed() != (trans == TRANSPOSE ||
+                                    trans == CONJUGATE_TRANSPOSE)
+                    ? TRANSPOSE
+                    : NO_TRANSPOSE,
+                x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::applyToComplexImpl(
+    const TranspositionMode trans, const arma::Mat<ComplexType> &x_in,
+    arma::Mat<ComplexType> &y_inout, const ComplexType alpha,
+    const ComplexType beta) const {
+  if (!m_values) {
+    Base::applyToComplexImpl(trans, x_in, y_inout, alpha, beta);
+    return;
+  }
+  // The CRS loops multiply the real entries with complex vectors directly
+  applyNatively(isTransposed() != (trans == TRANSPOSE ||
+                                    trans == CONJUGATE_TRANSPOSE)
+                    ? TRANSPOSE
+                    : NO_TRANSPOSE,
+                x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+template <typename VectorValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::applyNatively(
+    const TranspositionMode realTrans, const arma::Mat<VectorValueType> &x_in,
+    arma::Mat<VectorValueType> &y_inout, const VectorValueType alpha,
+    const VectorValueType beta) const {
+  // The stored matrix is real, so conjugation can be ignored
+  const size_t storedRowCount = m_mat->NumMyRows();
+  const size_t storedColCount = m_mat->NumMyCols();
+  if (realTrans == TRANSPOSE || realTrans == CONJUGATE_TRANSPOSE) {
+    assert(x_in.n_rows == storedRowCount);
+    assert(y_inout.n_rows == storedColCount);
+    typedef TransposedCrsMultiplicationLoopBody<VectorValueType> Body;
+    Body body(m_rowOffsets, m_colIndices, m_values, x_in, storedColCount);
+    tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(0, storedRowCount, SPMV_GRAIN_SIZE), body);
+    if (beta == static_cast<VectorValueType>(0.))
+      y_inout = alpha * body.result();
+    else
+      y_inout = alpha * body.result() + beta * y_inout;
+  } else {
+    assert(x_in.n_rows == storedColCount);
+    assert(y_inout.n_rows == storedRowCount);
+    typedef CrsMultiplicationLoopBody<VectorValueType> Body;
+    Body body(m_rowOffsets, m_colIndices, m_values, x_in, y_inout, alpha,
+              beta);
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, storedRowCount, SPMV_GRAIN_SIZE), body);
+  }
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteSparseBoundaryOperator);
@@ -58,6 +58,8 @@ class DiscreteSparseBoundaryOperator
   typedef AhmedDofWrapper<CoordinateType> AhmedDofType;
   typedef bbxbemblcluster<AhmedDofType, AhmedDofType> AhmedBemBlcluster;
   typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+  typedef DiscreteBoundaryOperator<ValueType> Base;
+  typedef typename Base::ComplexType ComplexType;
 
 #ifdef WITH_TRILINOS
 public:
@@ -151,6 +153,22 @@ private:
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
+  virtual void applyToComplexImpl(const TranspositionMode trans,
+                                  const arma::Mat<ComplexType> &x_in,
+                                  arma::Mat<ComplexType> &y_inout,
+                                  const ComplexType alpha,
+                                  const ComplexType beta) const;
+  template <typename VectorValueType>
+  void applyNatively(const TranspositionMode realTrans,
+                     const arma::Mat<VectorValueType> &x_in,
+                     arma::Mat<VectorValueType> &y_inout,
+                     const VectorValueType alpha,
+                     const VectorValueType beta) const;
   bool isTransposed() const;
 
   // void constructAhmedMatrix(
@@ -174,6 +192,10 @@ private:
   shared_ptr<IndexPermutation> m_domainPermutation, m_rangePermutation;
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
   Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
+  // CRS arrays of m_mat used by applyNatively(); null if unavailable
+  const int *m_rowOffsets;
+  const int *m_colIndices;
+  const double *m_values;
 #endif
   /** \endcond */
 };
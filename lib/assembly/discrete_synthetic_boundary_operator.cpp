@@ -0,0 +1,188 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "discrete_synthetic_boundary_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <algorithm>
+
+namespace Bempp {
+
+template <typename ValueType>
+DiscreteSyntheticBoundaryOperator<ValueType>::DiscreteSyntheticBoundaryOperator(
+    const std::vector<shared_ptr<const Base>> &testOps,
+    const shared_ptr<const Base> &integralOp,
+    const std::vector<shared_ptr<const Base>> &trialOps)
+    : m_testOps(testOps), m_integralOp(integralOp), m_trialOps(trialOps) {
+  if (!m_integralOp)
+    throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                "DiscreteSyntheticBoundaryOperator(): "
+                                "integralOp must not be NULL");
+  if (m_testOps.empty() && m_trialOps.empty())
+    throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                "DiscreteSyntheticBoundaryOperator(): "
+                                "testOps and trialOps must not both be empty");
+  if (!m_testOps.empty() && !m_trialOps.empty() &&
+      m_testOps.size() != m_trialOps.size())
+    throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                "DiscreteSyntheticBoundaryOperator(): "
+                                "testOps and trialOps must have the same "
+                                "length");
+  for (size_t i = 0; i < m_testOps.size(); ++i) {
+    if (!m_testOps[i])
+      throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                  "DiscreteSyntheticBoundaryOperator(): "
+                                  "operators must not be NULL");
+    if (m_testOps[i]->columnCount() != m_integralOp->rowCount() ||
+        m_testOps[i]->rowCount() != m_testOps[0]->rowCount())
+      throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                  "DiscreteSyntheticBoundaryOperator(): "
+                                  "test operator dimensions do not match");
+  }
+  for (size_t i = 0; i < m_trialOps.size(); ++i) {
+    if (!m_trialOps[i])
+      throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                  "DiscreteSyntheticBoundaryOperator(): "
+                                  "operators must not be NULL");
+    if (m_trialOps[i]->rowCount() != m_integralOp->columnCount() ||
+        m_trialOps[i]->columnCount() != m_trialOps[0]->columnCount())
+      throw std::invalid_argument("DiscreteSyntheticBoundaryOperator::"
+                                  "DiscreteSyntheticBoundaryOperator(): "
+                                  "trial operator dimensions do not match");
+  }
+}
+
+template <typename ValueType>
+unsigned int DiscreteSyntheticBoundaryOperator<ValueType>::rowCount() const {
+  return m_testOps.empty() ? m_integralOp->rowCount()
+                           : m_testOps[0]->rowCount();
+}
+
+template <typename ValueType>
+unsigned int DiscreteSyntheticBoundaryOperator<ValueType>::columnCount() const {
+  return m_trialOps.empty() ? m_integralOp->columnCount()
+                            : m_trialOps[0]->columnCount();
+}
+
+template <typename ValueType>
+void DiscreteSyntheticBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {
+  throw std::runtime_error("DiscreteSyntheticBoundaryOperator::addBlock(): "
+                           "not implemented yet");
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteSyntheticBoundaryOperator<ValueType>::domain() const {
+  return m_trialOps.empty() ? m_integralOp->domain() : m_trialOps[0]->domain();
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+DiscreteSyntheticBoundaryOperator<ValueType>::range() const {
+  return m_testOps.empty() ? m_integralOp->range() : m_testOps[0]->range();
+}
+
+template <typename ValueType>
+bool DiscreteSyntheticBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  if (!m_integralOp->opSupported(M_trans))
+    return false;
+  for (size_t i = 0; i < m_testOps.size(); ++i)
+    if (!m_testOps[i]->opSupported(M_trans))
+      return false;
+  for (size_t i = 0; i < m_trialOps.size(); ++i)
+    if (!m_trialOps[i]->opSupported(M_trans))
+      return false;
+  return true;
+}
+#endif // WITH_TRILINOS
+
+template <typename ValueType>
+void DiscreteSyntheticBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteSyntheticBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  if (x_in.n_cols == 0)
+    return;
+
+  // The transpose of sum_i T_i A R_i is sum_i R_i^T A^T T_i^T, so the roles
+  // of the test and trial operators are swapped
+  const bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+  const std::vector<shared_ptr<const Base>> &innerOps =
+      transposed ? m_testOps : m_trialOps;
+  const std::vector<shared_ptr<const Base>> &outerOps =
+      transposed ? m_trialOps : m_testOps;
+  const size_t termCount = std::max(innerOps.size(), outerOps.size());
+  const size_t colCount = x_in.n_cols;
+  const size_t internalInSize = transposed ? m_integralOp->rowCount()
+                                           : m_integralOp->columnCount();
+  const size_t internalOutSize = transposed ? m_integralOp->columnCount()
+                                            : m_integralOp->rowCount();
+
+  // Gather the inputs of the integral operator in all terms into one block
+  const arma::Mat<ValueType> *internalIn = &x_in;
+  arma::Mat<ValueType> gatheredIn;
+  if (!innerOps.empty()) {
+    gatheredIn.set_size(internalInSize, termCount * colCount);
+    for (size_t i = 0; i < termCount; ++i) {
+      arma::Mat<ValueType> part(gatheredIn.colptr(i * colCount),
+                                internalInSize, colCount,
+                                false /* copy_aux_mem */, true /* strict */);
+      innerOps[i]->apply(trans, x_in, part, 1., 0.);
+    }
+    internalIn = &gatheredIn;
+  }
+
+  arma::Mat<ValueType> internalOut(internalOutSize, internalIn->n_cols);
+  m_integralOp->apply(trans, *internalIn, internalOut, alpha, 0.);
+
+  if (outerOps.empty()) {
+    if (beta == static_cast<ValueType>(0.))
+      y_inout.zeros();
+    else
+      y_inout *= beta;
+    for (size_t i = 0; i < termCount; ++i)
+      y_inout += internalOut.cols(i * colCount, (i + 1) * colCount - 1);
+  } else
+    for (size_t i = 0; i < termCount; ++i) {
+      const size_t partIndex = innerOps.empty() ? 0 : i;
+      arma::Mat<ValueType> part(internalOut.colptr(partIndex * colCount),
+                                internalOutSize, colCount,
+                                false /* copy_aux_mem */, true /* strict */);
+      outerOps[i]->apply(trans, part, y_inout, 1., i == 0 ? beta : 1.);
+    }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteSyntheticBoundaryOperator);
+
+} // namespace Bempp
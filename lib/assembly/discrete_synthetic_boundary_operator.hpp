@@ -0,0 +1,117 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_discrete_synthetic_boundary_operator_hpp
+#define bempp_discrete_synthetic_boundary_operator_hpp
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "../common/common.hpp"
+
+#include "discrete_boundary_operator.hpp"
+
+#include "../common/shared_ptr.hpp"
+
+#include <vector>
+
+#ifdef WITH_TRILINOS
+#include <Teuchos_RCP.hpp>
+#endif
+
+namespace Bempp {
+
+/** \ingroup composite_discrete_boundary_operators
+ *  \brief Sum of products of an integral operator with test- and trial-side
+ *  local operators.
+ *
+ *  This class represents the discrete operator
+ *  \f[ \sum_i T_i A R_i, \f]
+ *  where \f$A\f$ is the discrete weak form of an integral operator and
+ *  \f$T_i\f$ and \f$R_i\f$ are (typically sparse) discrete operators; it is
+ *  the weak form of a SyntheticIntegralOperator. Either list of local
+ *  operators may be empty, in which case the corresponding factors are
+ *  omitted.
+ *
+ *  In contrast to a sum of DiscreteBoundaryOperatorComposition objects, which
+ *  applies \f$A\f$ once per term, this operator gathers the vectors
+ *  \f$R_i x\f$ of all terms into a single block and applies \f$A\f$ to that
+ *  block in one call. Operators that process blocks of vectors in one pass
+ *  (such as H-matrices) therefore traverse their data once per application,
+ *  whatever the number of terms. */
+template <typename ValueType>
+class DiscreteSyntheticBoundaryOperator
+    : public DiscreteBoundaryOperator<ValueType> {
+public:
+  typedef DiscreteBoundaryOperator<ValueType> Base;
+
+  /** \brief Constructor.
+   *
+   *  \param[in] testOps Operators \f$T_i\f$.
+   *  \param[in] integralOp Operator \f$A\f$.
+   *  \param[in] trialOps Operators \f$R_i\f$.
+   *
+   *  \p testOps and \p trialOps must not both be empty; if neither is empty,
+   *  they must be of the same length. All operators must be non-null and
+   *  have compatible dimensions, otherwise a <tt>std::invalid_argument</tt>
+   *  exception is thrown. */
+  DiscreteSyntheticBoundaryOperator(
+      const std::vector<shared_ptr<const Base>> &testOps,
+      const shared_ptr<const Base> &integralOp,
+      const std::vector<shared_ptr<const Base>> &trialOps);
+
+  virtual unsigned int rowCount() const;
+  virtual unsigned int columnCount() const;
+
+  virtual void addBlock(const std::vector<int> &rows,
+                        const std::vector<int> &cols, const ValueType alpha,
+                        arma::Mat<ValueType> &block) const;
+
+#ifdef WITH_TRILINOS
+public:
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+#endif
+
+private:
+  virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                const arma::Col<ValueType> &x_in,
+                                arma::Col<ValueType> &y_inout,
+                                const ValueType alpha,
+                                const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
+
+private:
+  /** \cond PRIVATE */
+  std::vector<shared_ptr<const Base>> m_testOps;
+  shared_ptr<const Base> m_integralOp;
+  std::vector<shared_ptr<const Base>> m_trialOps;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
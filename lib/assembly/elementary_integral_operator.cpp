@@ -22,18 +22,27 @@
 
 #include "aca_global_assembler.hpp"
 #include "assembly_options.hpp"
+#include "assembly_report.hpp"
 #include "dense_global_assembler.hpp"
 #include "discrete_boundary_operator.hpp"
+#include "discrete_dense_boundary_operator.hpp"
 #include "context.hpp"
 #include "local_assembler_construction_helper.hpp"
 #include "hmat_global_assembler.hpp"
+#include "fmm_global_assembler.hpp"
 
+#include "../fiber/basis_data.hpp"
+#include "../fiber/collection_of_kernels.hpp"
+#include "../fiber/collection_of_shapeset_transformations.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
 #include "../fiber/quadrature_strategy.hpp"
+#include "../fiber/test_kernel_trial_integral.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
 
+#include <boost/type_traits/is_complex.hpp>
+#include <complex>
 #include <stdexcept>
 #include <iostream>
 
@@ -99,10 +108,19 @@ ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
               << "'..." << std::endl;
 
   tbb::tick_count start = tbb::tick_count::now();
+  AssemblyPhaseTimer constructionTimer;
   std::unique_ptr<LocalAssembler> assembler =
       this->makeAssembler(*context.quadStrategy(), context.assemblyOptions());
+  assembler->setMemoryOwner(this->label());
+  const AssemblyPhaseTime constructionTime = constructionTimer.elapsed();
+  AssemblyPhaseTimer globalAssemblyTimer;
   shared_ptr<DiscreteBoundaryOperator<ResultType>> result =
       assembleWeakFormInternalImpl2(*assembler, context);
+  this->attachAssemblyReport(*result, *assembler, constructionTime,
+                             globalAssemblyTimer.elapsed(),
+                             context.assemblyOptions());
+  result->setMemoryOwner(this->label());
+  this->enforceMemoryBudget(context);
   tbb::tick_count end = tbb::tick_count::now();
 
   if (verbose)
@@ -119,6 +137,12 @@ ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
         const Context<BasisFunctionType, ResultType> &context) const {
   switch (context.assemblyOptions().assemblyMode()) {
   case AssemblyOptions::DENSE:
+    if (!this->makeRoomForDenseWeakForm(
+            context, this->dualToRange()->globalDofCount() *
+                         this->domain()->globalDofCount() * sizeof(ResultType),
+            "operator '" + this->label() + "'"))
+      return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
+          assembleWeakFormInHMatMode(assembler, context).release());
     return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
         assembleWeakFormInDenseMode(assembler, context).release());
   case AssemblyOptions::ACA:
@@ -127,6 +151,9 @@ ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
   case AssemblyOptions::HMAT:
     return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
         assembleWeakFormInHMatMode(assembler, context).release());
+  case AssemblyOptions::FMM:
+    return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
+        assembleWeakFormInFmmMode(assembler, context).release());
   default:
     throw std::runtime_error(
         "ElementaryIntegralOperator::assembleWeakFormInternalImpl2(): "
@@ -134,6 +161,41 @@ ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
   }
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+shared_ptr<DiscreteBoundaryOperator<ResultType>>
+ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
+    updateWeakFormInternalImpl2(
+        LocalAssembler &assembler,
+        const DiscreteBoundaryOperator<ResultType> &previousWeakForm,
+        const std::vector<int> &changedElements,
+        const Context<BasisFunctionType, ResultType> &context) const {
+  const Space<BasisFunctionType> &testSpace = *this->dualToRange();
+  const Space<BasisFunctionType> &trialSpace = *this->domain();
+  switch (context.assemblyOptions().assemblyMode()) {
+  case AssemblyOptions::DENSE: {
+    const DiscreteDenseBoundaryOperator<ResultType> *previous =
+        dynamic_cast<const DiscreteDenseBoundaryOperator<ResultType> *>(
+            &previousWeakForm);
+    if (!previous)
+      break;
+    return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
+        DenseGlobalAssembler<BasisFunctionType, ResultType>::
+            updateDetachedWeakForm(testSpace, trialSpace, assembler,
+                                   previous->asMatrix(), changedElements,
+                                   context).release());
+  }
+  case AssemblyOptions::HMAT:
+    return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
+        HMatGlobalAssembler<BasisFunctionType, ResultType>::
+            updateDetachedWeakForm(testSpace, trialSpace, assembler,
+                                   previousWeakForm, changedElements, context)
+                .release());
+  default:
+    break;
+  }
+  return shared_ptr<DiscreteBoundaryOperator<ResultType>>();
+}
+
 // UNDOCUMENTED PRIVATE METHODS
 
 /** \cond PRIVATE */
@@ -151,7 +213,8 @@ ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
                               ResultType>::assembleDetachedWeakForm(testSpace,
                                                                     trialSpace,
                                                                     assembler,
-                                                                    context);
+                                                                    context,
+                                                                    this->symmetry());
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
@@ -179,11 +242,75 @@ ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
         const Context<BasisFunctionType, ResultType> &context) const {
   const Space<BasisFunctionType> &testSpace = *this->dualToRange();
   const Space<BasisFunctionType> &trialSpace = *this->domain();
+  if (context.hMatOptions().compressionAlgorithm ==
+      HMatOptions::INTERPOLATION) {
+    Fiber::KernelTileType kernelType;
+    std::complex<double> waveNumber;
+    if (describeInterpolableKernel(kernelType, waveNumber))
+      return HMatGlobalAssembler<BasisFunctionType, ResultType>::
+          assembleDetachedWeakFormByInterpolation(
+              testSpace, trialSpace, assembler, kernelType, waveNumber,
+              context, this->symmetry());
+    if (context.assemblyOptions().verbosityLevel() >= VerbosityLevel::DEFAULT)
+      std::cout << "Operator '" << this->label()
+                << "' cannot be compressed by interpolation; using ACA"
+                << std::endl;
+  }
   return HMatGlobalAssembler<
       BasisFunctionType,
       ResultType>::assembleDetachedWeakForm(testSpace, trialSpace, assembler,
                                             assembler, context,
-                                            this->symmetry() & SYMMETRIC);
+                                            this->symmetry());
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
+    assembleWeakFormInFmmMode(
+        LocalAssembler &assembler,
+        const Context<BasisFunctionType, ResultType> &context) const {
+  const Space<BasisFunctionType> &testSpace = *this->dualToRange();
+  const Space<BasisFunctionType> &trialSpace = *this->domain();
+
+  Fiber::KernelTileType kernelType;
+  std::complex<double> waveNumber;
+  if (!describeInterpolableKernel(kernelType, waveNumber)) {
+    if (context.assemblyOptions().verbosityLevel() >= VerbosityLevel::DEFAULT)
+      std::cout << "Operator '" << this->label()
+                << "' is not supported by the FMM; assembling it as an "
+                   "H-matrix" << std::endl;
+    return assembleWeakFormInHMatMode(assembler, context);
+  }
+  return FmmGlobalAssembler<BasisFunctionType, ResultType>::
+      assembleDetachedWeakForm(testSpace, trialSpace, assembler, kernelType,
+                               waveNumber, context);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+bool ElementaryIntegralOperator<BasisFunctionType, KernelType, ResultType>::
+    describeInterpolableKernel(Fiber::KernelTileType &kernelType,
+                               std::complex<double> &waveNumber) const {
+  // The FMM and the interpolation compressor handle a single Laplace or
+  // modified Helmholtz kernel integrated against the plain values of scalar
+  // test and trial functions (e.g. not the curls used by hypersingular
+  // operators), the same conditions as for the OpenCL regular-pair
+  // integrator
+  size_t testBasisDeps = 0, trialBasisDeps = 0;
+  size_t testGeomDeps = 0, trialGeomDeps = 0;
+  testTransformations().addDependencies(testBasisDeps, testGeomDeps);
+  trialTransformations().addDependencies(trialBasisDeps, trialGeomDeps);
+  return kernels().describeModifiedHelmholtz3dKernel(kernelType,
+                                                     waveNumber) &&
+         (boost::is_complex<ResultType>::value || waveNumber.imag() == 0.) &&
+         integral().isTestScalarKernelTrialProduct() &&
+         testTransformations().transformationCount() == 1 &&
+         testTransformations().argumentDimension() == 1 &&
+         testTransformations().resultDimension(0) == 1 &&
+         trialTransformations().transformationCount() == 1 &&
+         trialTransformations().argumentDimension() == 1 &&
+         trialTransformations().resultDimension(0) == 1 &&
+         testBasisDeps == Fiber::VALUES && trialBasisDeps == Fiber::VALUES &&
+         testGeomDeps == 0 && trialGeomDeps == 0;
 }
 
 /** \endcond */
@@ -26,8 +26,10 @@
 #include "elementary_integral_operator_base.hpp"
 #include "../common/multidimensional_arrays.hpp"
 #include "../common/types.hpp"
+#include "../fiber/kernel_tile_type.hpp"
 #include "../fiber/types.hpp"
 
+#include <complex>
 #include <vector>
 #include "../common/armadillo_fwd.hpp"
 
@@ -197,6 +199,13 @@ private:
       LocalAssembler &assembler,
       const Context<BasisFunctionType, ResultType> &context) const;
 
+  virtual shared_ptr<DiscreteBoundaryOperator<ResultType_>>
+  updateWeakFormInternalImpl2(
+      LocalAssembler &assembler,
+      const DiscreteBoundaryOperator<ResultType_> &previousWeakForm,
+      const std::vector<int> &changedElements,
+      const Context<BasisFunctionType, ResultType> &context) const;
+
   /** \cond PRIVATE */
 
   std::unique_ptr<DiscreteBoundaryOperator<ResultType_>>
@@ -211,6 +220,12 @@ private:
   assembleWeakFormInHMatMode(
       LocalAssembler &assembler,
       const Context<BasisFunctionType, ResultType> &context) const;
+  std::unique_ptr<DiscreteBoundaryOperator<ResultType_>>
+  assembleWeakFormInFmmMode(
+      LocalAssembler &assembler,
+      const Context<BasisFunctionType, ResultType> &context) const;
+  bool describeInterpolableKernel(Fiber::KernelTileType &kernelType,
+                                  std::complex<double> &waveNumber) const;
 
   /** \endcond */
 };
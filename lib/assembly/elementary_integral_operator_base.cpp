@@ -20,15 +20,108 @@
 
 #include "elementary_integral_operator_base.hpp"
 
+#include "assembly_options.hpp"
+#include "assembly_report.hpp"
 #include "context.hpp"
+#include "dense_global_assembler.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
 #include "numerical_quadrature_strategy.hpp"
 
+#include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
+#include "../fiber/memory_registry.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <typeinfo>
+
+#include <Teuchos_ParameterList.hpp>
+
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tick_count.h>
 
 namespace Bempp {
 
+namespace {
+
+size_t memoryBudget(const ParameterList &parameters) {
+  if (parameters.isParameter("memoryBudget"))
+    return static_cast<size_t>(parameters.get<double>("memoryBudget") * 1024. *
+                               1024.);
+  return 0;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// ElementaryIntegralOperatorId
+
+template <typename BasisFunctionType, typename ResultType>
+ElementaryIntegralOperatorId<BasisFunctionType, ResultType>::
+    ElementaryIntegralOperatorId(
+        const std::string &name,
+        const ElementaryIntegralOperatorBase<BasisFunctionType, ResultType> &op,
+        const std::vector<std::complex<double>> &parameters)
+    : m_name(name), m_domain(op.domain().get()),
+      m_dualToRange(op.dualToRange().get()), m_symmetry(op.symmetry()),
+      m_parameters(parameters) {}
+
+template <typename BasisFunctionType, typename ResultType>
+ElementaryIntegralOperatorId<BasisFunctionType, ResultType>::
+    ElementaryIntegralOperatorId(
+        const std::string &name, const Space<BasisFunctionType> *domain,
+        const Space<BasisFunctionType> *dualToRange, int symmetry,
+        const std::vector<std::complex<double>> &parameters)
+    : m_name(name), m_domain(domain), m_dualToRange(dualToRange),
+      m_symmetry(symmetry), m_parameters(parameters) {}
+
+template <typename BasisFunctionType, typename ResultType>
+size_t
+ElementaryIntegralOperatorId<BasisFunctionType, ResultType>::hash() const {
+  typedef ElementaryIntegralOperatorId<BasisFunctionType, ResultType> IdType;
+  size_t result = tbb::tbb_hasher(typeid(IdType).name());
+  tbb_hash_combine(result, m_name);
+  tbb_hash_combine(result, m_domain);
+  tbb_hash_combine(result, m_dualToRange);
+  tbb_hash_combine(result, m_symmetry);
+  for (size_t i = 0; i < m_parameters.size(); ++i) {
+    tbb_hash_combine(result, m_parameters[i].real());
+    tbb_hash_combine(result, m_parameters[i].imag());
+  }
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void ElementaryIntegralOperatorId<BasisFunctionType, ResultType>::dump() const {
+  std::cout << m_name << ", " << m_domain << ", " << m_dualToRange << ", "
+            << m_symmetry;
+  for (size_t i = 0; i < m_parameters.size(); ++i)
+    std::cout << ", " << m_parameters[i];
+  std::cout << std::endl;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool ElementaryIntegralOperatorId<BasisFunctionType, ResultType>::isEqual(
+    const AbstractBoundaryOperatorId &other) const {
+  // dynamic_cast won't suffice since we want to make sure both objects
+  // are of exactly the same type (dynamic_cast would succeed for a subclass)
+  if (typeid(other) == typeid(*this)) {
+    const ElementaryIntegralOperatorId &otherCompatible =
+        static_cast<const ElementaryIntegralOperatorId &>(other);
+    return (m_name == otherCompatible.m_name &&
+            m_domain == otherCompatible.m_domain &&
+            m_dualToRange == otherCompatible.m_dualToRange &&
+            m_symmetry == otherCompatible.m_symmetry &&
+            m_parameters == otherCompatible.m_parameters);
+  } else
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ElementaryIntegralOperatorBase
+
 template <typename BasisFunctionType, typename ResultType>
 ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
     ElementaryIntegralOperatorBase(
@@ -42,6 +135,32 @@ template <typename BasisFunctionType, typename ResultType>
 ElementaryIntegralOperatorBase<BasisFunctionType,
                                ResultType>::~ElementaryIntegralOperatorBase() {}
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const AbstractBoundaryOperatorId>
+ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::id() const {
+  return m_id;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::setId(
+    const shared_ptr<const AbstractBoundaryOperatorId> &id) {
+  m_id = id;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const AbstractBoundaryOperatorId>
+ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::transposeId()
+    const {
+  return m_transposeId;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void ElementaryIntegralOperatorBase<BasisFunctionType,
+                                    ResultType>::setTransposeId(
+    const shared_ptr<const AbstractBoundaryOperatorId> &id) {
+  m_transposeId = id;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 shared_ptr<DiscreteBoundaryOperator<ResultType>>
 ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
@@ -51,6 +170,138 @@ ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
   return assembleWeakFormInternalImpl2(assembler, context);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<DiscreteBoundaryOperator<ResultType>>
+ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::updateWeakForm(
+    const DiscreteBoundaryOperator<ResultType> &previousWeakForm,
+    const std::vector<int> &changedElements,
+    const Context<BasisFunctionType, ResultType> &context) const {
+  // The indices of the changed elements refer to both spaces
+  if (this->domain()->grid() != this->dualToRange()->grid())
+    return this->assembleWeakForm(context);
+
+  bool verbose =
+      (context.assemblyOptions().verbosityLevel() >= VerbosityLevel::DEFAULT);
+  if (verbose)
+    std::cout << "Updating the weak form of operator '" << this->label()
+              << "' on " << changedElements.size() << " changed elements..."
+              << std::endl;
+
+  tbb::tick_count start = tbb::tick_count::now();
+  AssemblyPhaseTimer constructionTimer;
+  // Only the integrals over pairs involving few elements are needed, so
+  // precomputing all the singular integrals would not pay off
+  AssemblyOptions options = context.assemblyOptions();
+  options.enableSingularIntegralCaching(false);
+  std::unique_ptr<LocalAssembler> assembler =
+      this->makeAssembler(*context.quadStrategy(), options);
+  assembler->setMemoryOwner(this->label());
+  const AssemblyPhaseTime constructionTime = constructionTimer.elapsed();
+  AssemblyPhaseTimer globalAssemblyTimer;
+  shared_ptr<DiscreteBoundaryOperator<ResultType>> result =
+      updateWeakFormInternalImpl2(*assembler, previousWeakForm,
+                                  changedElements, context);
+  if (!result)
+    return this->assembleWeakForm(context);
+  attachAssemblyReport(*result, *assembler, constructionTime,
+                       globalAssemblyTimer.elapsed(), options);
+  result->setMemoryOwner(this->label());
+  enforceMemoryBudget(context);
+  tbb::tick_count end = tbb::tick_count::now();
+
+  if (verbose)
+    std::cout << "Update of the weak form of operator '" << this->label()
+              << "' took " << (end - start).seconds() << " s" << std::endl;
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<DiscreteBoundaryOperator<ResultType>>
+ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
+    updateWeakFormInternalImpl2(
+        LocalAssembler &assembler,
+        const DiscreteBoundaryOperator<ResultType> &previousWeakForm,
+        const std::vector<int> &changedElements,
+        const Context<BasisFunctionType, ResultType> &context) const {
+  return shared_ptr<DiscreteBoundaryOperator<ResultType>>();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
+    attachAssemblyReport(DiscreteBoundaryOperator<ResultType> &op,
+                         const LocalAssembler &assembler,
+                         const AssemblyPhaseTime &constructionTime,
+                         const AssemblyPhaseTime &globalAssemblyTime,
+                         const AssemblyOptions &options) {
+  AssemblyReport report;
+  if (op.assemblyReport())
+    report = *op.assemblyReport();
+  const Fiber::LocalAssemblyStatistics statistics = assembler.statistics();
+  report.addLocalAssemblyStatistics(statistics);
+
+  AssemblyPhaseTime &geometry = report.phases[AssemblyReport::GEOMETRY];
+  AssemblyPhaseTime &caching = report.phases[AssemblyReport::SINGULAR_CACHING];
+  AssemblyPhaseTime &integrals =
+      report.phases[AssemblyReport::REGULAR_INTEGRALS];
+  const AssemblyPhaseTime &compression =
+      report.phases[AssemblyReport::COMPRESSION];
+  integrals.wallTime = std::max(0., globalAssemblyTime.wallTime -
+                                        geometry.wallTime -
+                                        compression.wallTime);
+  integrals.cpuTime = std::max(0., globalAssemblyTime.cpuTime -
+                                       geometry.cpuTime - compression.cpuTime);
+  caching.wallTime = statistics.singularCachingWallTime;
+  caching.cpuTime = statistics.singularCachingCpuTime;
+  geometry.wallTime +=
+      std::max(0., constructionTime.wallTime - caching.wallTime);
+  geometry.cpuTime += std::max(0., constructionTime.cpuTime - caching.cpuTime);
+
+  const int maxThreadCount = options.parallelizationOptions().maxThreadCount();
+  report.threadCount = maxThreadCount == ParallelizationOptions::AUTO
+                           ? tbb::task_scheduler_init::default_num_threads()
+                           : maxThreadCount;
+  op.setAssemblyReport(
+      shared_ptr<const AssemblyReport>(new AssemblyReport(report)));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
+    makeRoomForDenseWeakForm(
+        const Context<BasisFunctionType, ResultType> &context, size_t bytes,
+        const std::string &description) {
+  const ParameterList &parameters = context.globalParameterList();
+  if (Fiber::MemoryRegistry::makeRoom(bytes, memoryBudget(parameters)))
+    return true;
+
+  std::string fallback = "hmat";
+  if (parameters.isParameter("memoryBudgetFallback"))
+    fallback = parameters.get<std::string>("memoryBudgetFallback");
+  if (fallback == "hmat") {
+    if (context.assemblyOptions().verbosityLevel() >= VerbosityLevel::DEFAULT)
+      std::cout << "The dense weak form of " << description << " ("
+                << bytes / (1024. * 1024.)
+                << " MB) does not fit in the memory budget; assembling it as "
+                   "an H-matrix" << std::endl;
+    return false;
+  }
+  if (fallback == "none")
+    throw std::runtime_error(
+        "ElementaryIntegralOperatorBase::makeRoomForDenseWeakForm(): "
+        "the dense weak form of " + description + " (" +
+        toString(bytes / (1024. * 1024.)) +
+        " MB) does not fit in the memory budget");
+  throw std::runtime_error(
+      "ElementaryIntegralOperatorBase::makeRoomForDenseWeakForm(): "
+      "unknown memoryBudgetFallback '" + fallback + "'");
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
+    enforceMemoryBudget(const Context<BasisFunctionType, ResultType> &context) {
+  Fiber::MemoryRegistry::makeRoom(
+      0, memoryBudget(context.globalParameterList()));
+}
+
 template <typename BasisFunctionType, typename ResultType>
 std::unique_ptr<typename ElementaryIntegralOperatorBase<
     BasisFunctionType, ResultType>::LocalAssembler>
@@ -87,7 +338,7 @@ ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::makeAssembler(
 
   const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
 
-  shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
+  shared_ptr<const RawGridGeometry> testRawGeometry, trialRawGeometry;
   shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
@@ -109,6 +360,119 @@ ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::makeAssembler(
                            options.verbosityLevel(), cacheSingularIntegrals);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType>>>
+ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>::
+    assembleWeakForms(
+        const std::vector<const ElementaryIntegralOperatorBase *> &operators,
+        const Context<BasisFunctionType, ResultType> &context) {
+  typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+  typedef std::vector<const Fiber::Shapeset<BasisFunctionType> *>
+  ShapesetPtrVector;
+
+  std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType>>> result;
+  if (operators.empty())
+    return result;
+  for (size_t i = 0; i < operators.size(); ++i) {
+    if (!operators[i])
+      throw std::invalid_argument(
+          "ElementaryIntegralOperatorBase::assembleWeakForms(): "
+          "operators must not be null");
+    if (operators[i]->domain() != operators[0]->domain() ||
+        operators[i]->dualToRange() != operators[0]->dualToRange())
+      throw std::invalid_argument(
+          "ElementaryIntegralOperatorBase::assembleWeakForms(): "
+          "all operators must have the same domain and dual to range");
+  }
+
+  const AssemblyOptions &options = context.assemblyOptions();
+  const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
+  if (verbose)
+    std::cout << "Assembling the weak forms of " << operators.size()
+              << " operators..." << std::endl;
+  tbb::tick_count start = tbb::tick_count::now();
+  AssemblyPhaseTimer collectionTimer;
+
+  shared_ptr<const RawGridGeometry> testRawGeometry, trialRawGeometry;
+  shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
+  shared_ptr<Fiber::OpenClHandler> openClHandler;
+  shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
+  bool cacheSingularIntegrals;
+  operators[0]->collectDataForAssemblerConstruction(
+      options, testRawGeometry, trialRawGeometry, testGeometryFactory,
+      trialGeometryFactory, testShapesets, trialShapesets, openClHandler,
+      cacheSingularIntegrals);
+
+  // The shared data collection is charged to the first operator
+  std::vector<AssemblyPhaseTime> constructionTimes(operators.size());
+  constructionTimes[0] = collectionTimer.elapsed();
+
+  std::vector<std::unique_ptr<LocalAssembler>> assemblers;
+  std::vector<LocalAssembler *> assemblerPtrs;
+  assemblers.reserve(operators.size());
+  for (size_t i = 0; i < operators.size(); ++i) {
+    AssemblyPhaseTimer constructionTimer;
+    assemblers.push_back(operators[i]->makeAssembler(
+        *context.quadStrategy(), testGeometryFactory, trialGeometryFactory,
+        testRawGeometry, trialRawGeometry, testShapesets, trialShapesets,
+        openClHandler, options.parallelizationOptions(),
+        options.verbosityLevel(), cacheSingularIntegrals));
+    assemblers.back()->setMemoryOwner(operators[i]->label());
+    assemblerPtrs.push_back(assemblers.back().get());
+    const AssemblyPhaseTime elapsed = constructionTimer.elapsed();
+    constructionTimes[i].wallTime += elapsed.wallTime;
+    constructionTimes[i].cpuTime += elapsed.cpuTime;
+  }
+
+  // Assemble all the dense weak forms at once only if they fit in the
+  // memory budget together; otherwise each operator checks its own
+  const size_t denseBytes = operators.size() *
+                            operators[0]->dualToRange()->globalDofCount() *
+                            operators[0]->domain()->globalDofCount() *
+                            sizeof(ResultType);
+  if (options.assemblyMode() == AssemblyOptions::DENSE &&
+      Fiber::MemoryRegistry::makeRoom(
+          denseBytes, memoryBudget(context.globalParameterList()))) {
+    // The element pairs are integrated for all the operators at once, so
+    // each of them is charged an equal share of the time
+    AssemblyPhaseTimer globalAssemblyTimer;
+    // Exploit only the symmetries shared by all the operators
+    int symmetry = operators[0]->symmetry();
+    for (size_t i = 1; i < operators.size(); ++i)
+      symmetry &= operators[i]->symmetry();
+    result = DenseGlobalAssembler<BasisFunctionType, ResultType>::
+        assembleDetachedWeakForms(*operators[0]->dualToRange(),
+                                  *operators[0]->domain(), assemblerPtrs,
+                                  context, symmetry);
+    AssemblyPhaseTime share = globalAssemblyTimer.elapsed();
+    share.wallTime /= operators.size();
+    share.cpuTime /= operators.size();
+    for (size_t i = 0; i < operators.size(); ++i)
+      attachAssemblyReport(*result[i], *assemblers[i], constructionTimes[i],
+                           share, options);
+  } else
+    for (size_t i = 0; i < operators.size(); ++i) {
+      AssemblyPhaseTimer globalAssemblyTimer;
+      result.push_back(
+          operators[i]->assembleWeakFormInternal(*assemblers[i], context));
+      attachAssemblyReport(*result.back(), *assemblers[i],
+                           constructionTimes[i], globalAssemblyTimer.elapsed(),
+                           options);
+    }
+  for (size_t i = 0; i < operators.size(); ++i)
+    result[i]->setMemoryOwner(operators[i]->label());
+  enforceMemoryBudget(context);
+
+  tbb::tick_count end = tbb::tick_count::now();
+  if (verbose)
+    std::cout << "Assembly of the weak forms of " << operators.size()
+              << " operators took " << (end - start).seconds() << " s"
+              << std::endl;
+  return result;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
+    ElementaryIntegralOperatorId);
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
     ElementaryIntegralOperatorBase);
 
@@ -24,10 +24,13 @@
 #include "../common/common.hpp"
 
 #include "abstract_boundary_operator.hpp"
+#include "abstract_boundary_operator_id.hpp"
 
 #include "../common/shared_ptr.hpp"
 
+#include <complex>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace Fiber {
@@ -43,6 +46,53 @@ class OpenClHandler;
 
 namespace Bempp {
 
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType>
+class ElementaryIntegralOperatorBase;
+struct AssemblyPhaseTime;
+/** \endcond */
+
+/** \ingroup abstract_boundary_operators
+ *  \brief Identifier of an elementary integral operator.
+ *
+ *  Two identifiers compare equal if they were created with the same kernel
+ *  name and parameters for operators with the same domain, dual to range
+ *  and symmetry. The range is not taken into account, since it does not
+ *  affect the weak form. The kernel name should be unique for each family of
+ *  operators (e.g. "laplace3dSingleLayer") and the parameters should contain
+ *  every quantity other than the spaces on which the weak form depends (e.g.
+ *  the wave number). */
+template <typename BasisFunctionType, typename ResultType>
+class ElementaryIntegralOperatorId : public AbstractBoundaryOperatorId {
+public:
+  ElementaryIntegralOperatorId(
+      const std::string &name,
+      const ElementaryIntegralOperatorBase<BasisFunctionType, ResultType> &op,
+      const std::vector<std::complex<double>> &parameters =
+          std::vector<std::complex<double>>());
+  /** \brief Construct the identifier of an operator of the family \p name
+   *  acting on \p domain, with test functions from \p dualToRange.
+   *
+   *  Used to describe operators that have not necessarily been created, such
+   *  as the one returned by
+   *  ElementaryIntegralOperatorBase::transposeId(). */
+  ElementaryIntegralOperatorId(
+      const std::string &name, const Space<BasisFunctionType> *domain,
+      const Space<BasisFunctionType> *dualToRange, int symmetry,
+      const std::vector<std::complex<double>> &parameters =
+          std::vector<std::complex<double>>());
+  virtual size_t hash() const;
+  virtual void dump() const;
+  virtual bool isEqual(const AbstractBoundaryOperatorId &other) const;
+
+private:
+  std::string m_name;
+  const Space<BasisFunctionType> *m_domain;
+  const Space<BasisFunctionType> *m_dualToRange;
+  int m_symmetry;
+  std::vector<std::complex<double>> m_parameters;
+};
+
 /** \ingroup abstract_boundary_operators
  *  \brief Base class of ElementaryIntegralOperator, containing functionality
  *  independent from \c KernelType.
@@ -75,6 +125,37 @@ public:
   /** \brief Destructor. */
   ~ElementaryIntegralOperatorBase();
 
+  /** \brief Return the identifier of this operator.
+   *
+   *  Return the identifier set with setId() or a null pointer if none has
+   *  been set, in which case the weak form of this operator is not cached. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
+
+  /** \brief Set the identifier of this operator.
+   *
+   *  Functions constructing elementary integral operators call this with an
+   *  ElementaryIntegralOperatorId describing the kernel, so that the weak
+   *  forms of equivalent operators can be shared through the WeakFormCache
+   *  of a Context. */
+  void setId(const shared_ptr<const AbstractBoundaryOperatorId> &id);
+
+  /** \brief Return the identifier of an operator whose weak form is the
+   *  transpose of the weak form of this operator.
+   *
+   *  Return the identifier set with setTransposeId() or a null pointer if
+   *  none has been set. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> transposeId() const;
+
+  /** \brief Set the identifier of an operator whose weak form is the
+   *  transpose of the weak form of this operator.
+   *
+   *  \p id must describe an operator acting on dualToRange(), with test
+   *  functions from domain(). For example, the adjoint double-layer
+   *  operators set it to the identifier of the double-layer operator on the
+   *  swapped spaces, so that WeakFormCache can return a transposed view of
+   *  an already assembled weak form. */
+  void setTransposeId(const shared_ptr<const AbstractBoundaryOperatorId> &id);
+
   /** \brief Construct a local assembler suitable for this operator.
    *
    *  \param[in] quadStrategy  Quadrature strategy to be used to construct the
@@ -123,6 +204,85 @@ public:
       LocalAssembler &assembler,
       const Context<BasisFunctionType, ResultType> &context) const;
 
+  /** \brief Update the weak form of an operator defined on a grid whose
+   *  geometry differs from that of this operator only locally.
+   *
+   *  \p previousWeakForm should be the weak form of an operator of the same
+   *  kind acting on spaces of the same type, defined on a grid with the same
+   *  topology as that of the spaces of this operator but a different
+   *  position of the vertices of the elements listed in \p changedElements,
+   *  e.g. in a shape optimisation loop. The DOFs must be numbered in the
+   *  same way.
+   *
+   *  In dense mode, the rows and columns of the DOFs living on the changed
+   *  elements are recomputed and the other entries copied. In H-matrix mode,
+   *  only the leaves containing such rows or columns are compressed again;
+   *  the other leaves are shared with \p previousWeakForm. This requires the
+   *  admissible blocks to stay admissible in the new geometry.
+   *
+   *  If the weak form cannot be updated in this way, e.g. because the
+   *  domain and the dual to range are defined on different grids, because
+   *  \p previousWeakForm is stored in another format or because the changes
+   *  of the geometry modify the block structure of the H-matrix, it is
+   *  assembled from scratch with assembleWeakForm(). */
+  shared_ptr<DiscreteBoundaryOperator<ResultType_>>
+  updateWeakForm(const DiscreteBoundaryOperator<ResultType_> &previousWeakForm,
+                 const std::vector<int> &changedElements,
+                 const Context<BasisFunctionType, ResultType> &context) const;
+
+  /** \brief Assemble the weak forms of several operators in one pass.
+   *
+   *  All the operators must have the same domain and dual to range. The
+   *  grid geometry and shapesets needed to construct the local assemblers
+   *  are collected only once and shared by all the assemblers, and the block
+   *  cluster trees used in H-matrix mode are shared through the cache owned
+   *  by \p context. In dense mode the element pairs are traversed only once:
+   *  each trial element is handed to all the local assemblers in turn.
+   *
+   *  This is intended for parameter sweeps, e.g. the assembly of a
+   *  Helmholtz operator at many wave numbers on the same mesh. The i'th
+   *  returned operator is the weak form of \p operators[i]. */
+  static std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType_>>>
+  assembleWeakForms(
+      const std::vector<const ElementaryIntegralOperatorBase *> &operators,
+      const Context<BasisFunctionType, ResultType> &context);
+
+protected:
+  /** \brief Attach an assembly report to the weak form \p op.
+   *
+   *  The report attached by the global assembler, if any, is completed with
+   *  the statistics of \p assembler, the time \p constructionTime spent on
+   *  constructing it (the geometry and singular caching phases) and the time
+   *  \p globalAssemblyTime spent in the global assembler, less the phases
+   *  already recorded by the latter. */
+  static void
+  attachAssemblyReport(DiscreteBoundaryOperator<ResultType_> &op,
+                       const LocalAssembler &assembler,
+                       const AssemblyPhaseTime &constructionTime,
+                       const AssemblyPhaseTime &globalAssemblyTime,
+                       const AssemblyOptions &options);
+
+  /** \brief Make room for a dense weak form of \p bytes bytes in the
+   *  memory budget.
+   *
+   *  The budget is given by the <tt>memoryBudget</tt> global parameter of
+   *  \p context; if it would be exceeded, cached data registered in the
+   *  Fiber::MemoryRegistry are released. Returns true if the weak form then
+   *  fits in the budget. Otherwise, returns false if the
+   *  <tt>memoryBudgetFallback</tt> global parameter is <tt>"hmat"</tt>, in
+   *  which case the weak form should be assembled as an H-matrix instead,
+   *  and throws std::runtime_error if it is <tt>"none"</tt>. \p description
+   *  names the weak form in messages. */
+  static bool makeRoomForDenseWeakForm(
+      const Context<BasisFunctionType, ResultType> &context, size_t bytes,
+      const std::string &description);
+
+  /** \brief Release cached data registered in the Fiber::MemoryRegistry
+   *  while the memory in use exceeds the <tt>memoryBudget</tt> global
+   *  parameter of \p context. */
+  static void
+  enforceMemoryBudget(const Context<BasisFunctionType, ResultType> &context);
+
 private:
   /** \brief Construct a local assembler suitable for this operator.
    *
@@ -154,6 +314,22 @@ private:
   assembleWeakFormInternalImpl2(
       LocalAssembler &assembler,
       const Context<BasisFunctionType_, ResultType_> &options) const = 0;
+
+  /** \brief Update the operator's weak form using a specified local
+   *  assembler.
+   *
+   *  This virtual function is invoked by updateWeakForm() to do the actual
+   *  work. It should return a null pointer if \p previousWeakForm cannot be
+   *  updated. The default implementation always does so. */
+  virtual shared_ptr<DiscreteBoundaryOperator<ResultType_>>
+  updateWeakFormInternalImpl2(
+      LocalAssembler &assembler,
+      const DiscreteBoundaryOperator<ResultType_> &previousWeakForm,
+      const std::vector<int> &changedElements,
+      const Context<BasisFunctionType_, ResultType_> &context) const;
+
+  shared_ptr<const AbstractBoundaryOperatorId> m_id;
+  shared_ptr<const AbstractBoundaryOperatorId> m_transposeId;
 };
 
 } // namespace Bempp
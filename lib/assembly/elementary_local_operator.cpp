@@ -32,6 +32,7 @@
 #include "cluster_construction_helper.hpp"
 #include "discrete_dense_boundary_operator.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
+#include "local_operator_pattern.hpp"
 #include "context.hpp"
 
 #include "../common/types.hpp"
@@ -43,6 +44,8 @@
 #include "../fiber/opencl_handler.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
 #include "../fiber/scalar_function_value_functor.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../fiber/default_collection_of_basis_transformations.hpp"
 #include "../grid/entity_iterator.hpp"
 #include "../grid/geometry_factory.hpp"
@@ -54,9 +57,14 @@
 #include "../common/boost_make_shared_fwd.hpp"
 #include <boost/type_traits/is_complex.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/tick_count.h>
 
+#include <algorithm>
+#include <map>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #ifdef WITH_TRILINOS
@@ -67,12 +75,12 @@
 // solution would be for AHMED to use namespaces.
 #ifndef __IBMCPP__
 #define __IBMCPP__
-#include <Epetra_FECrsMatrix.h>
+#include <Epetra_CrsMatrix.h>
 #include <Epetra_LocalMap.h>
 #include <Epetra_SerialComm.h>
 #undef __IBMCPP__
 #else
-#include <Epetra_FECrsMatrix.h>
+#include <Epetra_CrsMatrix.h>
 #include <Epetra_LocalMap.h>
 #include <Epetra_SerialComm.h>
 #endif
@@ -82,115 +90,66 @@ namespace Bempp {
 
 namespace {
 
-#ifdef WITH_TRILINOS
-// Internal helper functions for Epetra
-template <typename ValueType>
-int epetraSumIntoGlobalValues(Epetra_FECrsMatrix &matrix,
-                              const std::vector<int> &rowIndices,
-                              const std::vector<int> &colIndices,
-                              const arma::Mat<ValueType> &values);
-
-// Specialisation for double -- no intermediate array is needed
-template <>
-inline int epetraSumIntoGlobalValues<double>(Epetra_FECrsMatrix &matrix,
-                                             const std::vector<int> &rowIndices,
-                                             const std::vector<int> &colIndices,
-                                             const arma::Mat<double> &values) {
-  assert(rowIndices.size() == values.n_rows);
-  assert(colIndices.size() == values.n_cols);
-  return matrix.SumIntoGlobalValues(
-      rowIndices.size(), &rowIndices[0], colIndices.size(), &colIndices[0],
-      values.memptr(), Epetra_FECrsMatrix::COLUMN_MAJOR);
-}
-
-// Specialisation for float
-template <>
-inline int epetraSumIntoGlobalValues<float>(Epetra_FECrsMatrix &matrix,
-                                            const std::vector<int> &rowIndices,
-                                            const std::vector<int> &colIndices,
-                                            const arma::Mat<float> &values) {
-  // Convert data from float into double (expected by Epetra)
-  arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-  std::copy(values.begin(), values.end(), doubleValues.begin());
-  return epetraSumIntoGlobalValues<double>(matrix, rowIndices, colIndices,
-                                           doubleValues);
+int maxThreadCount(const AssemblyOptions &options) {
+  const ParallelizationOptions &parallelOptions =
+      options.parallelizationOptions();
+  if (parallelOptions.isOpenClEnabled())
+    return 1;
+  return parallelOptions.maxThreadCount();
 }
 
-// Specialisation for std::complex<float>.
-// WARNING: at present only the real part is taken into account!
-// This is sufficient as long as we provide real-valued basis functions only.
-template <>
-inline int epetraSumIntoGlobalValues<std::complex<float>>(
-    Epetra_FECrsMatrix &matrix, const std::vector<int> &rowIndices,
-    const std::vector<int> &colIndices,
-    const arma::Mat<std::complex<float>> &values) {
-  // Extract the real part of "values" into an array of type double
-  arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-  // Check whether arma::real returns a view or a copy (if the latter,
-  // this assert will fail)
-  for (size_t i = 0; i < values.n_elem; ++i)
-    doubleValues[i] = values[i].real();
-  return epetraSumIntoGlobalValues<double>(matrix, rowIndices, colIndices,
-                                           doubleValues);
+/** Evaluate the local weak forms on all elements, integrating batches of
+ *  elements in parallel. */
+template <typename ResultType>
+void evaluateAllLocalWeakForms(
+    Fiber::LocalAssemblerForLocalOperators<ResultType> &assembler,
+    int elementCount, int maxThreadCount,
+    std::vector<arma::Mat<ResultType>> &localResult) {
+  localResult.resize(elementCount);
+  Fiber::SerialBlasRegion region;
+  // Batches must be large enough for the local assembler to group the
+  // elements by quadrature variant
+  const int LOCAL_OPERATOR_GRAIN_SIZE = 1024;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, elementCount, LOCAL_OPERATOR_GRAIN_SIZE),
+        [&](const tbb::blocked_range<int> &r) {
+          std::vector<int> elementIndices(r.size());
+          for (int e = r.begin(); e != r.end(); ++e)
+            elementIndices[e - r.begin()] = e;
+          std::vector<arma::Mat<ResultType>> batchResult;
+          assembler.evaluateLocalWeakForms(elementIndices, batchResult);
+          for (int e = r.begin(); e != r.end(); ++e)
+            localResult[e].swap(batchResult[e - r.begin()]);
+        });
+  });
 }
 
-// Specialisation for std::complex<double>.
-// WARNING: at present only the real part is taken into account!
-// This is sufficient as long as we provide real-valued basis functions only.
-template <>
-inline int epetraSumIntoGlobalValues<std::complex<double>>(
-    Epetra_FECrsMatrix &matrix, const std::vector<int> &rowIndices,
-    const std::vector<int> &colIndices,
-    const arma::Mat<std::complex<double>> &values) {
-  // Extract the real part of "values" into an array of type double
-  arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-  for (size_t i = 0; i < values.n_elem; ++i)
-    doubleValues[i] = values[i].real();
-  return epetraSumIntoGlobalValues<double>(matrix, rowIndices, colIndices,
-                                           doubleValues);
-}
-#endif
-
-/** Build a list of lists of global DOF indices corresponding to the local DOFs
- *  on each element of space.grid(). */
-template <typename BasisFunctionType>
-void gatherGlobalDofs(
-    const Space<BasisFunctionType> &testSpace,
-    const Space<BasisFunctionType> &trialSpace,
-    std::vector<std::vector<GlobalDofIndex>> &testGlobalDofs,
-    std::vector<std::vector<GlobalDofIndex>> &trialGlobalDofs,
-    std::vector<std::vector<BasisFunctionType>> &testLocalDofWeights,
-    std::vector<std::vector<BasisFunctionType>> &trialLocalDofWeights) {
-  // We use the fact that test and trial space are required to be defined
-  // on the same grid
-
-  // Get the grid's leaf view so that we can iterate over elements
-  const GridView &view = testSpace.gridView();
-  const int elementCount = view.entityCount(0);
-
-  // Global DOF indices corresponding to local DOFs on elements
-  testGlobalDofs.clear();
-  testGlobalDofs.resize(elementCount);
-  trialGlobalDofs.clear();
-  trialGlobalDofs.resize(elementCount);
-  // Weights of the local DOFs on elements
-  testLocalDofWeights.clear();
-  testLocalDofWeights.resize(elementCount);
-  trialLocalDofWeights.clear();
-  trialLocalDofWeights.resize(elementCount);
-
-  // Gather global DOF lists
-  const Mapper &mapper = view.elementMapper();
-  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
-  while (!it->finished()) {
-    const Entity<0> &element = it->entity();
-    const int elementIndex = mapper.entityIndex(element);
-    testSpace.getGlobalDofs(element, testGlobalDofs[elementIndex],
-                            testLocalDofWeights[elementIndex]);
-    trialSpace.getGlobalDofs(element, trialGlobalDofs[elementIndex],
-                             trialLocalDofWeights[elementIndex]);
-    it->next();
-  }
+/** Sum the contributions of the local weak forms to the nonzero entries of
+ *  the global weak form. */
+template <typename BasisFunctionType, typename ResultType>
+void sumLocalWeakForms(const LocalOperatorPattern<BasisFunctionType> &pattern,
+                       const std::vector<arma::Mat<ResultType>> &localResult,
+                       int maxThreadCount, std::vector<ResultType> &values) {
+  typedef typename LocalOperatorPattern<BasisFunctionType>::Contribution
+      Contribution;
+  const int entryCount = pattern.columnIndices.size();
+  values.resize(entryCount);
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, entryCount, 4096),
+        [&](const tbb::blocked_range<int> &r) {
+          for (int k = r.begin(); k != r.end(); ++k) {
+            ResultType sum = 0.;
+            for (int i = pattern.entryStarts[k]; i < pattern.entryStarts[k + 1];
+                 ++i) {
+              const Contribution &c = pattern.contributions[i];
+              sum += c.weight * localResult[c.element].memptr()[c.localIndex];
+            }
+            values[k] = sum;
+          }
+        });
+  });
 }
 
 } // anonymous namespace
@@ -257,46 +216,26 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::
     assembleWeakFormInDenseMode(LocalAssembler &assembler,
                                 const AssemblyOptions &options) const {
   const Space<BasisFunctionType> &testSpace = *this->dualToRange();
-  const Space<BasisFunctionType> &trialSpace = *this->domain();
+  const int threadCount = maxThreadCount(options);
 
   // Fill local submatrices
   const GridView &view = testSpace.gridView();
-  const size_t elementCount = view.entityCount(0);
-  std::vector<int> elementIndices(elementCount);
-  for (size_t i = 0; i < elementCount; ++i)
-    elementIndices[i] = i;
   std::vector<arma::Mat<ResultType>> localResult;
-  assembler.evaluateLocalWeakForms(elementIndices, localResult);
+  evaluateAllLocalWeakForms(assembler, view.entityCount(0), threadCount,
+                            localResult);
 
-  // Create the operator's matrix
-  arma::Mat<ResultType> result(testSpace.globalDofCount(),
-                               trialSpace.globalDofCount());
-  result.fill(0.);
+  // Sum them into the nonzero entries of the operator's matrix
+  shared_ptr<const LocalOperatorPattern<BasisFunctionType>> pattern =
+      sharedLocalOperatorPattern(this->dualToRange(), this->domain(),
+                                 threadCount);
+  std::vector<ResultType> values;
+  sumLocalWeakForms(*pattern, localResult, threadCount, values);
 
-  // Retrieve global DOFs corresponding to local DOFs on all elements
-  std::vector<std::vector<GlobalDofIndex>> testGdofs(elementCount);
-  std::vector<std::vector<GlobalDofIndex>> trialGdofs(elementCount);
-  std::vector<std::vector<BasisFunctionType>> testLdofWeights(elementCount);
-  std::vector<std::vector<BasisFunctionType>> trialLdofWeights(elementCount);
-  gatherGlobalDofs(testSpace, trialSpace, testGdofs, trialGdofs,
-                   testLdofWeights, trialLdofWeights);
-
-  // Distribute local matrices into the global matrix
-  for (size_t e = 0; e < elementCount; ++e)
-    for (size_t trialIndex = 0; trialIndex < trialGdofs[e].size();
-         ++trialIndex) {
-      int trialGdof = trialGdofs[e][trialIndex];
-      if (trialGdof < 0)
-        continue;
-      for (size_t testIndex = 0; testIndex < testGdofs[e].size(); ++testIndex) {
-        int testGdof = testGdofs[e][testIndex];
-        if (testGdof < 0)
-          continue;
-        result(testGdof, trialGdof) += conj(testLdofWeights[e][testIndex]) *
-                                       trialLdofWeights[e][trialIndex] *
-                                       localResult[e](testIndex, trialIndex);
-      }
-    }
+  arma::Mat<ResultType> result(pattern->rowCount, pattern->columnCount);
+  result.fill(0.);
+  for (int row = 0; row < pattern->rowCount; ++row)
+    for (int k = pattern->rowStarts[row]; k < pattern->rowStarts[row + 1]; ++k)
+      result(row, pattern->columnIndices[k]) = values[k];
 
   return std::unique_ptr<DiscreteBoundaryOperator<ResultType>>(
       new DiscreteDenseBoundaryOperator<ResultType>(result));
@@ -316,32 +255,30 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::
 
   const Space<BasisFunctionType> &testSpace = *this->dualToRange();
   const Space<BasisFunctionType> &trialSpace = *this->domain();
+  const int threadCount = maxThreadCount(options);
 
   // Fill local submatrices
   const GridView &view = testSpace.gridView();
-  const size_t elementCount = view.entityCount(0);
-  std::vector<int> elementIndices(elementCount);
-  for (size_t i = 0; i < elementCount; ++i)
-    elementIndices[i] = i;
   std::vector<arma::Mat<ResultType>> localResult;
-  assembler.evaluateLocalWeakForms(elementIndices, localResult);
-
-  // Global DOF indices corresponding to local DOFs on elements
-  std::vector<std::vector<GlobalDofIndex>> testGdofs(elementCount);
-  std::vector<std::vector<GlobalDofIndex>> trialGdofs(elementCount);
-  std::vector<std::vector<BasisFunctionType>> testLdofWeights(elementCount);
-  std::vector<std::vector<BasisFunctionType>> trialLdofWeights(elementCount);
-  gatherGlobalDofs(testSpace, trialSpace, testGdofs, trialGdofs,
-                   testLdofWeights, trialLdofWeights);
-
-  // Multiply matrix entries by DOF weights
-  for (size_t e = 0; e < elementCount; ++e)
-    for (size_t trialDof = 0; trialDof < trialGdofs[e].size(); ++trialDof)
-      for (size_t testDof = 0; testDof < testGdofs[e].size(); ++testDof)
-        localResult[e](testDof, trialDof) *=
-            conj(testLdofWeights[e][testDof]) * trialLdofWeights[e][trialDof];
-
-  // Estimate number of entries in each row
+  evaluateAllLocalWeakForms(assembler, view.entityCount(0), threadCount,
+                            localResult);
+
+  // Sum them into the nonzero entries of the operator's matrix
+  shared_ptr<const LocalOperatorPattern<BasisFunctionType>> pattern =
+      sharedLocalOperatorPattern(this->dualToRange(), this->domain(),
+                                 threadCount);
+  std::vector<ResultType> values;
+  sumLocalWeakForms(*pattern, localResult, threadCount, values);
+
+  // Epetra stores doubles. WARNING: at present only the real part of
+  // complex entries is taken into account! This is sufficient as long as we
+  // provide real-valued basis functions only.
+  std::vector<double> epetraValues(values.size());
+  for (size_t k = 0; k < values.size(); ++k)
+    epetraValues[k] = realPart(values[k]);
+  std::vector<int> rowLengths(pattern->rowCount);
+  for (int row = 0; row < pattern->rowCount; ++row)
+    rowLengths[row] = pattern->rowStarts[row + 1] - pattern->rowStarts[row];
 
   //    This will be useful when we begin to use MPI
   //    // Get global DOF indices for which this process is responsible
@@ -352,47 +289,25 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::
   //                                      rowMap.NumMyElements());
   //    const int myTestGlobalDofCount = myTestGlobalDofs.size();
 
-  const int testGlobalDofCount = testSpace.globalDofCount();
-  const int trialGlobalDofCount = trialSpace.globalDofCount();
-  arma::Col<int> nonzeroEntryCountEstimates(testGlobalDofCount);
-  nonzeroEntryCountEstimates.fill(0);
-
-  // Upper estimate for the number of global trial DOFs coupled to a given
-  // global test DOF: sum of the local trial DOF counts for each element that
-  // contributes to the global test DOF in question
-  for (size_t e = 0; e < elementCount; ++e)
-    for (size_t testLdof = 0; testLdof < testGdofs[e].size(); ++testLdof) {
-      int testGdof = testGdofs[e][testLdof];
-      if (testGdof >= 0)
-        nonzeroEntryCountEstimates(testGdof) += trialGdofs[e].size();
-    }
-
+  // The rows are inserted already merged and sorted, so the matrix can be
+  // created with a static profile of the exact size
   Epetra_SerialComm comm; // To be replaced once we begin to use MPI
-  Epetra_LocalMap rowMap(testGlobalDofCount, 0 /* index_base */, comm);
-  Epetra_LocalMap colMap(trialGlobalDofCount, 0 /* index_base */, comm);
-  shared_ptr<Epetra_FECrsMatrix> result =
-      boost::make_shared<Epetra_FECrsMatrix>(
-          Copy, rowMap, colMap, nonzeroEntryCountEstimates.memptr());
-
-  // TODO: make each process responsible for a subset of elements
-  // Find maximum number of local dofs per element
-  size_t maxLdofCount = 0;
-  for (size_t e = 0; e < elementCount; ++e)
-    maxLdofCount =
-        std::max(maxLdofCount, testGdofs[e].size() * trialGdofs[e].size());
-
-  // Initialise sparse matrix with zeros at required positions
-  arma::Col<double> zeros(maxLdofCount);
-  zeros.fill(0.);
-  for (size_t e = 0; e < elementCount; ++e)
-    result->InsertGlobalValues(testGdofs[e].size(), &testGdofs[e][0],
-                               trialGdofs[e].size(), &trialGdofs[e][0],
-                               zeros.memptr());
-  // Add contributions from individual elements
-  for (size_t e = 0; e < elementCount; ++e)
-    epetraSumIntoGlobalValues(*result, testGdofs[e], trialGdofs[e],
-                              localResult[e]);
-  result->GlobalAssemble();
+  Epetra_LocalMap rowMap(pattern->rowCount, 0 /* index_base */, comm);
+  Epetra_LocalMap colMap(pattern->columnCount, 0 /* index_base */, comm);
+  shared_ptr<Epetra_CrsMatrix> result = boost::make_shared<Epetra_CrsMatrix>(
+      Copy, rowMap, colMap, &rowLengths[0], true /* static profile */);
+  for (int row = 0; row < pattern->rowCount; ++row) {
+    if (rowLengths[row] == 0)
+      continue;
+    const int start = pattern->rowStarts[row];
+#ifndef NDEBUG
+    int errorCode =
+#endif
+        result->InsertGlobalValues(row, rowLengths[row], &epetraValues[start],
+                                   &pattern->columnIndices[start]);
+    assert(errorCode == 0);
+  }
+  result->FillComplete(colMap, rowMap);
 
   // If assembly mode is equal to ACA and we have AHMED,
   // construct the block cluster tree. Otherwise leave it uninitialized.
@@ -453,7 +368,7 @@ ElementaryLocalOperator<BasisFunctionType, ResultType>::makeAssembler(
 
   const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
 
-  shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
+  shared_ptr<const RawGridGeometry> testRawGeometry, trialRawGeometry;
   shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
@@ -28,6 +28,8 @@
 #include "local_assembler_construction_helper.hpp"
 #include "discrete_null_boundary_operator.hpp"
 #include "dense_global_assembler.hpp"
+#include "hmat_global_assembler.hpp"
+#include "potential_evaluator.hpp"
 
 #include "../common/shared_ptr.hpp"
 
@@ -44,6 +46,8 @@
 #include "../grid/index_set.hpp"
 #include "../grid/mapper.hpp"
 
+#include <algorithm>
+
 namespace Bempp {
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
@@ -127,12 +131,13 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
     std::unique_ptr<Evaluator> evaluator =
         makeEvaluator(argument, quadStrategy, options);
 
-    // right now we don't bother about far and near field
-    // (this might depend on evaluation options)
+    // Elements close to the evaluation points are integrated with the
+    // distance-dependent quadrature orders set in the accuracy options
     arma::Mat<ResultType> result;
-    evaluator->evaluate(Evaluator::FAR_FIELD, evaluationPoints, result);
+    evaluator->evaluate(Evaluator::NEAR_FIELD, evaluationPoints, result);
     return result;
-  } else if (options.evaluationMode() == EvaluationOptions::ACA) {
+  } else if (options.evaluationMode() == EvaluationOptions::ACA ||
+             options.evaluationMode() == EvaluationOptions::HMAT) {
     AssembledPotentialOperator<BasisFunctionType, ResultType> assembledOp =
         assemble(argument.space(), make_shared_from_ref(evaluationPoints),
                  quadStrategy, options);
@@ -143,6 +148,58 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
         "Invalid evaluation mode");
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
+    evaluateOnGridInChunks(
+        const GridFunction<BasisFunctionType, ResultType> &argument,
+        const Grid &evaluationGrid, const QuadratureStrategy &quadStrategy,
+        const EvaluationOptions &options, const PotentialSink &sink,
+        size_t chunkSize) const {
+  if (evaluationGrid.dimWorld() != argument.grid()->dimWorld())
+    throw std::invalid_argument(
+        "ElementaryPotentialOperator::evaluateOnGridInChunks(): "
+        "the evaluation grid and the surface on which the grid "
+        "function 'argument' is defined must be embedded in a space "
+        "of the same dimension");
+  if (chunkSize == 0)
+    throw std::invalid_argument(
+        "ElementaryPotentialOperator::evaluateOnGridInChunks(): "
+        "chunkSize must be positive");
+  if (!sink)
+    throw std::invalid_argument(
+        "ElementaryPotentialOperator::evaluateOnGridInChunks(): "
+        "sink must not be empty");
+
+  // The vertex coordinates are fetched in one go, column j holding the
+  // vertex of index j
+  std::unique_ptr<GridView> evalView = evaluationGrid.leafView();
+  arma::Mat<CoordinateType> vertices;
+  arma::Mat<int> elementCorners;
+  arma::Mat<char> auxData;
+  evalView->getRawElementData(vertices, elementCorners, auxData);
+  elementCorners.reset();
+
+  std::unique_ptr<Evaluator> evaluator =
+      makeEvaluator(argument, quadStrategy, options);
+  const size_t dimWorld = vertices.n_rows;
+  const size_t vertexCount = vertices.n_cols;
+  const size_t componentCount = this->componentCount();
+
+  arma::Mat<ResultType> values(componentCount, chunkSize);
+  for (size_t first = 0; first < vertexCount; first += chunkSize) {
+    const size_t count = std::min(chunkSize, vertexCount - first);
+    // View of the columns of 'vertices' belonging to this chunk
+    const arma::Mat<CoordinateType> points(vertices.colptr(first), dimWorld,
+                                           count, false /* copy_aux_mem */,
+                                           true /* strict */);
+    if (values.n_cols != count)
+      values.set_size(componentCount, count);
+    evaluator->evaluate(Evaluator::NEAR_FIELD, points.memptr(), count,
+                        values.memptr());
+    sink(first, points, values);
+  }
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
 AssembledPotentialOperator<BasisFunctionType, ResultType>
 ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
@@ -173,6 +230,19 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
       space, evaluationPoints, discreteOperator, componentCount());
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+std::unique_ptr<PotentialEvaluator<ResultType>>
+ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
+    makePotentialEvaluator(
+        const GridFunction<BasisFunctionType, ResultType> &argument,
+        const QuadratureStrategy &quadStrategy,
+        const EvaluationOptions &options) const {
+  return std::unique_ptr<PotentialEvaluator<ResultType>>(
+      new PotentialEvaluator<ResultType>(
+          makeEvaluator(argument, quadStrategy, options),
+          options.parallelizationOptions()));
+}
+
 // UNDOCUMENTED PRIVATE METHODS
 
 /** \cond PRIVATE */
@@ -192,7 +262,7 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
   typedef std::vector<std::vector<ResultType>> CoefficientsVector;
   typedef LocalAssemblerConstructionHelper Helper;
 
-  shared_ptr<RawGridGeometry> rawGeometry;
+  shared_ptr<const RawGridGeometry> rawGeometry;
   shared_ptr<GeometryFactory> geometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> shapesets;
@@ -244,7 +314,7 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
   typedef std::vector<std::vector<ResultType>> CoefficientsVector;
   typedef LocalAssemblerConstructionHelper Helper;
 
-  shared_ptr<RawGridGeometry> rawGeometry;
+  shared_ptr<const RawGridGeometry> rawGeometry;
   shared_ptr<GeometryFactory> geometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> shapesets;
@@ -280,6 +350,10 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
     return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
         assembleOperatorInAcaMode(space, evaluationPoints, assembler, options)
             .release());
+  case EvaluationOptions::HMAT:
+    return shared_ptr<DiscreteBoundaryOperator<ResultType>>(
+        assembleOperatorInHMatMode(space, evaluationPoints, assembler, options)
+            .release());
   default:
     throw std::runtime_error(
         "ElementaryPotentialOperator::assembleWeakFormInternalImpl(): "
@@ -310,6 +384,17 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
       assemblePotentialOperator(evaluationPoints, space, assembler, options);
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::
+    assembleOperatorInHMatMode(
+        const Space<BasisFunctionType> &space,
+        const arma::Mat<CoordinateType> &evaluationPoints,
+        LocalAssembler &assembler, const EvaluationOptions &options) const {
+  return HMatGlobalAssembler<BasisFunctionType, ResultType>::
+      assemblePotentialOperator(evaluationPoints, space, assembler, options);
+}
+
 /** \endcond */
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_KERNEL_AND_RESULT(
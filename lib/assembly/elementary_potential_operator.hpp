@@ -25,6 +25,8 @@
 
 #include "../common/shared_ptr.hpp"
 
+#include <functional>
+
 namespace Fiber {
 
 /** \cond FORWARD_DECL */
@@ -43,6 +45,7 @@ namespace Bempp {
 
 /** \cond FORWARD_DECL */
 template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename ResultType> class PotentialEvaluator;
 /** \endcond */
 
 /** \ingroup potential_operators
@@ -148,6 +151,55 @@ public:
 
   virtual int componentCount() const;
 
+  /** \brief Type of the function receiving the chunks of a potential
+   *  evaluated by evaluateOnGridInChunks().
+   *
+   *  The arguments are the index of the first vertex of the chunk, the
+   *  coordinates of the vertices of the chunk (stored column by column) and
+   *  the values of the potential at these vertices. Both matrices are only
+   *  valid during the call. */
+  typedef std::function<void(size_t firstVertex,
+                             const arma::Mat<CoordinateType> &points,
+                             const arma::Mat<ResultType> &values)>
+  PotentialSink;
+
+  /** \brief Evaluate the potential of a given charge distribution on the
+   *  vertices of a grid, passing the values to \p sink chunk by chunk.
+   *
+   *  The vertices of the leaf view of \p evaluationGrid are processed in
+   *  order of their indices, in chunks of at most \p chunkSize vertices;
+   *  each chunk is evaluated in parallel and handed to \p sink before the
+   *  next one is started. Only the values of a single chunk are held in
+   *  memory at any time, which makes this function suitable for writing
+   *  the potential on large visualization grids directly to a file.
+   *
+   *  The remaining parameters have the same meaning as in evaluateOnGrid().
+   *  As in makePotentialEvaluator(), the potential is always evaluated as in
+   *  the EvaluationOptions::DENSE mode. */
+  void evaluateOnGridInChunks(
+      const GridFunction<BasisFunctionType, ResultType> &argument,
+      const Grid &evaluationGrid, const QuadratureStrategy &quadStrategy,
+      const EvaluationOptions &options, const PotentialSink &sink,
+      size_t chunkSize = 4096) const;
+
+  /** \brief Create an object evaluating the potential of a given charge
+   *  distribution at streamed points.
+   *
+   *  The data related to \p argument are calculated once, by this function;
+   *  the returned PotentialEvaluator can then be applied to any number of
+   *  batches of evaluation points. This is the preferred way of evaluating
+   *  the potential at point sets too large to be held in memory at once, or
+   *  when the points become available incrementally.
+   *
+   *  The parameters have the same meaning as in evaluateAtPoints(). The
+   *  potential is always evaluated as in the EvaluationOptions::DENSE
+   *  mode. */
+  std::unique_ptr<PotentialEvaluator<ResultType_>>
+  makePotentialEvaluator(
+      const GridFunction<BasisFunctionType, ResultType> &argument,
+      const QuadratureStrategy &quadStrategy,
+      const EvaluationOptions &options) const;
+
 private:
   /** \brief Return the collection of kernel functions occurring in the
    *  integrand of this operator. */
@@ -195,6 +247,12 @@ private:
                             const arma::Mat<CoordinateType> &evaluationPoints,
                             LocalAssembler &assembler,
                             const EvaluationOptions &options) const;
+
+  std::unique_ptr<DiscreteBoundaryOperator<ResultType_>>
+  assembleOperatorInHMatMode(const Space<BasisFunctionType> &space,
+                             const arma::Mat<CoordinateType> &evaluationPoints,
+                             LocalAssembler &assembler,
+                             const EvaluationOptions &options) const;
   /** \endcond */
 };
 
@@ -27,7 +27,10 @@ EvaluationOptions::EvaluationOptions()
     : EvaluationOptions(GlobalParameters::parameterList()) {}
 
 EvaluationOptions::EvaluationOptions(const ParameterList &parameters)
-    : m_parameterList(parameters) {
+    : m_parameterList(parameters),
+      m_hMatOptions(parameters.isSublist("HMat")
+                        ? HMatOptions(parameters.sublist("HMat"))
+                        : HMatOptions()) {
 
   std::string assemblyType =
       parameters.get<std::string>("potentialOperatorAssemblyType");
@@ -62,10 +65,21 @@ EvaluationOptions::Mode EvaluationOptions::evaluationMode() const {
 
 const AcaOptions &EvaluationOptions::acaOptions() const { return m_acaOptions; }
 
-// void EvaluationOptions::switchToOpenCl(const OpenClOptions& openClOptions)
-//{
-//    m_parallelizationOptions.switchToOpenCl(openClOptions);
-//}
+const HMatOptions &EvaluationOptions::hMatOptions() const {
+  return m_hMatOptions;
+}
+
+const ParameterList &EvaluationOptions::parameterList() const {
+  return m_parameterList;
+}
+
+void EvaluationOptions::enableOpenCl(const OpenClOptions &openClOptions) {
+  m_parallelizationOptions.enableOpenCl(openClOptions);
+}
+
+void EvaluationOptions::disableOpenCl() {
+  m_parallelizationOptions.disableOpenCl();
+}
 
 void EvaluationOptions::setMaxThreadCount(int maxThreadCount) {
   m_parallelizationOptions.setMaxThreadCount(maxThreadCount);
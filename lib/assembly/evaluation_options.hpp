@@ -25,6 +25,7 @@
 #include "../common/types.hpp"
 
 #include "aca_options.hpp"
+#include "hmat_options.hpp"
 
 #include "../common/deprecated.hpp"
 #include "../fiber/opencl_options.hpp"
@@ -129,6 +130,15 @@ public:
    *  switchToAcaMode(). */
   Mode evaluationMode() const;
 
+  /** \brief Return the parameter list the options were constructed from.
+   *
+   *  The "HMat" sublist controls the assembly in the HMAT evaluation mode. */
+  const ParameterList &parameterList() const;
+
+  /** \brief Return the options read from the "HMat" sublist of
+   *  parameterList(). */
+  const HMatOptions &hMatOptions() const;
+
   /** \brief Return the current adaptive cross approximation (ACA) settings.
    *
    *  \note These settings are only used in the ACA evaluation mode, i.e. when
@@ -139,9 +149,16 @@ public:
     @name Parallelization
     @{ */
 
-  // Temporarily removed (OpenCl support is broken).
-  // void enableOpenCl(const OpenClOptions& openClOptions);
-  // void disableOpenCl();
+  /** \brief Enable GPU-based evaluation of potentials.
+   *
+   *  The far field of the Laplace and (modified) Helmholtz single- and
+   *  double-layer potentials of scalar functions in 3D is summed on the GPU;
+   *  near-field corrections and all other potentials are still evaluated on
+   *  the CPU. Has no effect if BEM++ was compiled without OpenCL support. */
+  void enableOpenCl(const OpenClOptions &openClOptions = OpenClOptions());
+
+  /** \brief Disable GPU-based calculations. */
+  void disableOpenCl();
 
   /** \brief Set the maximum number of threads used during evaluation of
    *potentials.
@@ -182,6 +199,7 @@ private:
   ParallelizationOptions m_parallelizationOptions;
   VerbosityLevel::Level m_verbosityLevel;
   ParameterList m_parameterList;
+  HMatOptions m_hMatOptions;
   /** \endcond */
 };
 
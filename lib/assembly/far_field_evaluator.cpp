@@ -0,0 +1,383 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "far_field_evaluator.hpp"
+
+#include "assembled_potential_operator.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "evaluation_options.hpp"
+#include "grid_function.hpp"
+#include "hmat_block_cluster_tree_cache.hpp"
+#include "potential_operator.hpp"
+
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
+#include "../grid/grid.hpp"
+#include "../space/space.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace Bempp {
+
+namespace {
+
+template <typename T>
+void convertWaveNumber(std::complex<double> waveNumber, T &result) {
+  if (waveNumber.imag() != 0.)
+    throw std::invalid_argument(
+        "FarFieldEvaluator::FarFieldEvaluator(): "
+        "real operators require a purely imaginary wave number");
+  result = static_cast<T>(waveNumber.real());
+}
+
+template <typename T>
+void convertWaveNumber(std::complex<double> waveNumber,
+                       std::complex<T> &result) {
+  result = std::complex<T>(waveNumber);
+}
+
+// Weights of the Lagrange interpolation at x through the nodes 0, ..., p - 1
+template <typename CoordinateType>
+void lagrangeWeights(CoordinateType x, int p, CoordinateType *w) {
+  for (int a = 0; a < p; ++a) {
+    CoordinateType weight = 1.;
+    for (int b = 0; b < p; ++b)
+      if (b != a)
+        weight *= (x - b) / (a - b);
+    w[a] = weight;
+  }
+}
+
+// Upper bound on the memory taken by the products of the samples of a batch
+// of clusters with the densities
+const std::size_t maxBatchBytes = 64 * 1024 * 1024;
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+FarFieldEvaluator<BasisFunctionType, ResultType>::FarFieldEvaluator(
+    const PotentialOperator<BasisFunctionType, ResultType> &op,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    std::complex<double> waveNumber, const ParameterList &parameterList)
+    : m_space(space), m_componentCount(op.componentCount()) {
+  if (!space)
+    throw std::invalid_argument("FarFieldEvaluator::FarFieldEvaluator(): "
+                                "space must not be null");
+  if (space->grid()->dimWorld() != 3)
+    throw std::invalid_argument("FarFieldEvaluator::FarFieldEvaluator(): "
+                                "only three-dimensional grids are supported");
+
+  const ParameterList &farFieldParameters =
+      parameterList.sublist("FarField");
+  const int clusterSize = farFieldParameters.template get<int>("clusterSize");
+  const double samplingFactor =
+      farFieldParameters.template get<double>("samplingFactor");
+  m_order = farFieldParameters.template get<int>("interpolationOrder");
+  if (clusterSize < 1 || samplingFactor <= 0.)
+    throw std::invalid_argument("FarFieldEvaluator::FarFieldEvaluator(): "
+                                "clusterSize and samplingFactor must be "
+                                "positive");
+  if (m_order < 2 || m_order > 64)
+    throw std::invalid_argument("FarFieldEvaluator::FarFieldEvaluator(): "
+                                "interpolationOrder must be between 2 and 64");
+  convertWaveNumber(waveNumber / std::complex<double>(0., 1.), m_waveNumber);
+  m_maxThreadCount =
+      EvaluationOptions(parameterList).parallelizationOptions()
+          .maxThreadCount();
+
+  // Clusters
+  shared_ptr<hmat::DefaultClusterTreeType> clusterTree =
+      HMatBlockClusterTreeCache<BasisFunctionType>::buildClusterTree(
+          *space, clusterSize);
+  const std::vector<std::size_t> &hMatDofToOriginalDof =
+      clusterTree->hMatDofToOriginalDofMap();
+  const auto leaves = clusterTree->leafNodes();
+  m_clusterCenters.set_size(3, leaves.size());
+  m_clusterOffsets.assign(1, 0);
+  m_clusterDofs.reserve(clusterTree->numberOfDofs());
+  double maxRadius = 0.;
+  for (std::size_t l = 0; l < leaves.size(); ++l) {
+    const auto &data = leaves[l]->data();
+    const std::array<double, 6> &bounds = data.boundingBox.bounds();
+    for (int dim = 0; dim < 3; ++dim)
+      m_clusterCenters(dim, l) = 0.5 * (bounds[2 * dim] + bounds[2 * dim + 1]);
+    maxRadius = std::max(maxRadius, 0.5 * data.boundingBox.diameter());
+    for (std::size_t i = data.indexRange[0]; i < data.indexRange[1]; ++i)
+      m_clusterDofs.push_back(hMatDofToOriginalDof[i]);
+    m_clusterOffsets.push_back(m_clusterDofs.size());
+  }
+
+  // Sampling directions. The demodulated far fields have an angular
+  // bandwidth of about |kappa| R; the polynomial factors of the kernels add
+  // a few units to it. The polar angles are offset by half a step, so
+  // neither pole is a sample.
+  const double bandwidth = std::abs(m_waveNumber) * maxRadius + 3.;
+  m_thetaCount = std::max<std::size_t>(
+      m_order, static_cast<std::size_t>(std::ceil(samplingFactor * bandwidth)));
+  m_phiCount = 2 * m_thetaCount;
+  const std::size_t samplingCount = m_thetaCount * m_phiCount;
+  shared_ptr<arma::Mat<CoordinateType>> samplingDirections(
+      new arma::Mat<CoordinateType>(3, samplingCount));
+  for (std::size_t i = 0; i < m_thetaCount; ++i) {
+    const CoordinateType theta = (i + 0.5) * M_PI / m_thetaCount;
+    for (std::size_t j = 0; j < m_phiCount; ++j) {
+      const CoordinateType phi = 2. * M_PI * j / m_phiCount;
+      const std::size_t s = i * m_phiCount + j;
+      (*samplingDirections)(0, s) = std::sin(theta) * std::cos(phi);
+      (*samplingDirections)(1, s) = std::sin(theta) * std::sin(phi);
+      (*samplingDirections)(2, s) = std::cos(theta);
+    }
+  }
+
+  // The interpolation needs every entry, so the operator is assembled in
+  // dense mode whatever the caller asked for
+  ParameterList denseParameterList(parameterList);
+  denseParameterList.set("potentialOperatorAssemblyType",
+                         std::string("dense"));
+  const arma::Mat<ResultType> matrix =
+      op.assemble(space, samplingDirections, denseParameterList)
+          .discreteOperator()
+          ->asMatrix();
+
+  const std::size_t cc = m_componentCount;
+  m_samples.resize(leaves.size());
+  Fiber::SerialBlasRegion region;
+  Fiber::executeInTaskArena(m_maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, leaves.size()),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t l = r.begin(); l != r.end(); ++l) {
+            const unsigned int *dofs = &m_clusterDofs[m_clusterOffsets[l]];
+            const std::size_t dofCount =
+                m_clusterOffsets[l + 1] - m_clusterOffsets[l];
+            arma::Mat<ResultType> &samples = m_samples[l];
+            samples.set_size(cc * samplingCount, dofCount);
+            for (std::size_t s = 0; s < samplingCount; ++s) {
+              CoordinateType projection = 0.;
+              for (int dim = 0; dim < 3; ++dim)
+                projection += (*samplingDirections)(dim, s) *
+                              m_clusterCenters(dim, l);
+              const ResultType phase = std::exp(-m_waveNumber * projection);
+              for (std::size_t j = 0; j < dofCount; ++j)
+                for (std::size_t c = 0; c < cc; ++c)
+                  samples(s * cc + c, j) = phase * matrix(s * cc + c, dofs[j]);
+            }
+          }
+        });
+  });
+}
+
+template <typename BasisFunctionType, typename ResultType>
+int FarFieldEvaluator<BasisFunctionType, ResultType>::componentCount() const {
+  return m_componentCount;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::size_t
+FarFieldEvaluator<BasisFunctionType, ResultType>::samplingDirectionCount()
+    const {
+  return m_thetaCount * m_phiCount;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::size_t
+FarFieldEvaluator<BasisFunctionType, ResultType>::clusterCount() const {
+  return m_samples.size();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+double FarFieldEvaluator<BasisFunctionType, ResultType>::memSizeKb() const {
+  double result = 0.;
+  for (const auto &samples : m_samples)
+    result += sizeof(ResultType) * double(samples.n_elem) / 1024;
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void FarFieldEvaluator<BasisFunctionType, ResultType>::computeStencil(
+    const CoordinateType *direction, Stencil &stencil) const {
+  const CoordinateType x = direction[0], y = direction[1], z = direction[2];
+  const CoordinateType norm = std::sqrt(x * x + y * y + z * z);
+  if (norm == 0.)
+    throw std::invalid_argument("FarFieldEvaluator::evaluate(): "
+                                "directions must not be zero");
+  const CoordinateType theta = std::acos(
+      std::max(CoordinateType(-1.), std::min(CoordinateType(1.), z / norm)));
+  CoordinateType phi = std::atan2(y, x);
+  if (phi < 0.)
+    phi += 2. * M_PI;
+
+  // Positions in units of the grid steps; the ith polar sample lies at i
+  const CoordinateType t = theta * m_thetaCount / M_PI - 0.5;
+  const CoordinateType u = phi * m_phiCount / (2. * M_PI);
+  const int p = m_order;
+  const int i0 = static_cast<int>(std::floor(t)) - (p - 1) / 2;
+  const int j0 = static_cast<int>(std::floor(u)) - (p - 1) / 2;
+  CoordinateType thetaWeights[64], phiWeights[64];
+  lagrangeWeights(t - i0, p, thetaWeights);
+  lagrangeWeights(u - j0, p, phiWeights);
+
+  // Polar indices beyond a pole are reflected to the other side of the
+  // sphere, i.e. to the opposite meridian
+  const int thetaCount = m_thetaCount, phiCount = m_phiCount;
+  stencil.samples.resize(p * p);
+  stencil.weights.resize(p * p);
+  for (int a = 0; a < p; ++a) {
+    int i = i0 + a, shift = 0;
+    if (i < 0) {
+      i = -1 - i;
+      shift = phiCount / 2;
+    } else if (i >= thetaCount) {
+      i = 2 * thetaCount - 1 - i;
+      shift = phiCount / 2;
+    }
+    for (int b = 0; b < p; ++b) {
+      const int j = ((j0 + b + shift) % phiCount + phiCount) % phiCount;
+      stencil.samples[a * p + b] = std::size_t(i) * m_phiCount + j;
+      stencil.weights[a * p + b] = thetaWeights[a] * phiWeights[b];
+    }
+  }
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void FarFieldEvaluator<BasisFunctionType, ResultType>::evaluate(
+    const arma::Mat<CoordinateType> &directions,
+    const arma::Mat<ResultType> &coefficients,
+    arma::Mat<ResultType> &result) const {
+  if (directions.n_rows != 3)
+    throw std::invalid_argument("FarFieldEvaluator::evaluate(): "
+                                "directions must have three rows");
+  if (coefficients.n_rows != m_space->globalDofCount())
+    throw std::invalid_argument("FarFieldEvaluator::evaluate(): "
+                                "coefficients have incorrect number of rows");
+
+  const std::size_t cc = m_componentCount;
+  const std::size_t directionCount = directions.n_cols;
+  const std::size_t densityCount = coefficients.n_cols;
+  const std::size_t clusterCount = m_samples.size();
+  result.zeros(cc * directionCount, densityCount);
+  if (directionCount == 0 || densityCount == 0)
+    return;
+
+  std::vector<Stencil> stencils(directionCount);
+  std::vector<std::size_t> batchStarts(1, 0);
+  const std::size_t bytesPerCluster =
+      sizeof(ResultType) * cc * samplingDirectionCount() * densityCount;
+  for (std::size_t l = 0, bytes = 0; l < clusterCount; ++l) {
+    if (bytes > 0 && bytes + bytesPerCluster > maxBatchBytes) {
+      batchStarts.push_back(l);
+      bytes = 0;
+    }
+    bytes += bytesPerCluster;
+  }
+  batchStarts.push_back(clusterCount);
+
+  Fiber::SerialBlasRegion region;
+  Fiber::executeInTaskArena(m_maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, directionCount),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t d = r.begin(); d != r.end(); ++d)
+            computeStencil(directions.colptr(d), stencils[d]);
+        });
+
+    std::vector<arma::Mat<ResultType>> projected;
+    for (std::size_t batch = 0; batch + 1 < batchStarts.size(); ++batch) {
+      const std::size_t first = batchStarts[batch];
+      const std::size_t last = batchStarts[batch + 1];
+      projected.resize(last - first);
+
+      // Far fields of the densities restricted to each cluster at the
+      // sampling directions
+      tbb::parallel_for(
+          tbb::blocked_range<std::size_t>(first, last),
+          [&](const tbb::blocked_range<std::size_t> &r) {
+            for (std::size_t l = r.begin(); l != r.end(); ++l) {
+              const std::size_t offset = m_clusterOffsets[l];
+              const std::size_t dofCount = m_clusterOffsets[l + 1] - offset;
+              arma::Mat<ResultType> localCoefficients(dofCount, densityCount);
+              for (std::size_t k = 0; k < densityCount; ++k)
+                for (std::size_t j = 0; j < dofCount; ++j)
+                  localCoefficients(j, k) =
+                      coefficients(m_clusterDofs[offset + j], k);
+              projected[l - first] = m_samples[l] * localCoefficients;
+            }
+          });
+
+      // Interpolation and modulation
+      tbb::parallel_for(
+          tbb::blocked_range<std::size_t>(0, directionCount),
+          [&](const tbb::blocked_range<std::size_t> &r) {
+            std::vector<ResultType> sum(cc * densityCount);
+            for (std::size_t d = r.begin(); d != r.end(); ++d) {
+              const Stencil &stencil = stencils[d];
+              const CoordinateType *direction = directions.colptr(d);
+              const CoordinateType norm =
+                  std::sqrt(direction[0] * direction[0] +
+                            direction[1] * direction[1] +
+                            direction[2] * direction[2]);
+              for (std::size_t l = first; l < last; ++l) {
+                const arma::Mat<ResultType> &values = projected[l - first];
+                std::fill(sum.begin(), sum.end(), ResultType(0.));
+                for (std::size_t n = 0; n < stencil.samples.size(); ++n) {
+                  const std::size_t row = stencil.samples[n] * cc;
+                  const CoordinateType weight = stencil.weights[n];
+                  for (std::size_t k = 0; k < densityCount; ++k)
+                    for (std::size_t c = 0; c < cc; ++c)
+                      sum[k * cc + c] += weight * values(row + c, k);
+                }
+                CoordinateType projection = 0.;
+                for (int dim = 0; dim < 3; ++dim)
+                  projection += direction[dim] * m_clusterCenters(dim, l);
+                const ResultType phase =
+                    std::exp(m_waveNumber * (projection / norm));
+                for (std::size_t k = 0; k < densityCount; ++k)
+                  for (std::size_t c = 0; c < cc; ++c)
+                    result(d * cc + c, k) += phase * sum[k * cc + c];
+              }
+            }
+          });
+    }
+  });
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> FarFieldEvaluator<BasisFunctionType, ResultType>::evaluate(
+    const arma::Mat<CoordinateType> &directions,
+    const GridFunction<BasisFunctionType, ResultType> &argument) const {
+  if (argument.space() != m_space)
+    throw std::invalid_argument("FarFieldEvaluator::evaluate(): "
+                                "argument is defined in a different space "
+                                "than the one passed to the constructor");
+  const arma::Mat<ResultType> coefficients = argument.coefficients();
+  arma::Mat<ResultType> result;
+  evaluate(directions, coefficients, result);
+  result.reshape(m_componentCount, directions.n_cols);
+  return result;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(FarFieldEvaluator);
+
+} // namespace Bempp
@@ -0,0 +1,176 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_far_field_evaluator_hpp
+#define bempp_far_field_evaluator_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../common/types.hpp"
+
+#include <complex>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType, typename ResultType>
+class PotentialOperator;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup potential_operators
+ *  \brief Fast evaluation of far-field patterns in many directions.
+ *
+ *  The kernels of the far-field operators (e.g.
+ *  Helmholtz3dFarFieldSingleLayerPotentialOperator or
+ *  Maxwell3dFarFieldDoubleLayerPotentialOperator) are of the form
+ *  \f$P(\hat x, y) \exp(\kappa \hat x \cdot y)\f$, where \f$\hat x\f$ is the
+ *  direction, \f$P\f$ is a polynomial of low degree in \f$\hat x\f$ and
+ *  \f$\kappa = -ik\f$. The DOFs of the space are divided into clusters; for
+ *  a cluster with center \f$c\f$ and radius \f$R\f$, the far field of the
+ *  cluster's basis functions multiplied by \f$\exp(-\kappa \hat x \cdot
+ *  c)\f$ is a smooth function of \f$\hat x\f$ whose angular bandwidth is
+ *  about \f$|\kappa| R\f$.
+ *
+ *  On construction these demodulated far fields are evaluated, by the
+ *  assembly routines of the far-field operator, on a regular grid of
+ *  directions in spherical coordinates whose resolution is determined by
+ *  the largest cluster. The far field in an arbitrary direction is then
+ *  obtained by local Lagrange interpolation of the samples of every
+ *  cluster, followed by multiplication with the cluster's phase factor.
+ *  Densities are applied to the samples by matrix products, so any number
+ *  of densities is evaluated in one batch.
+ *
+ *  The parameters are taken from the "FarField" sublist of the parameter
+ *  list passed to the constructor:
+ *
+ *  - "clusterSize": maximum number of DOFs in a cluster;
+ *  - "samplingFactor": number of samples per unit of angular bandwidth in
+ *    the polar angle (the azimuth is sampled twice as finely);
+ *  - "interpolationOrder": number of samples per dimension used to
+ *    interpolate the far field in each direction.
+ *
+ *  The construction costs about as much as assembling the far-field
+ *  operator at the sampling directions, and the evaluation in \f$D\f$
+ *  directions costs \f$O(S N + D N_c p^2)\f$ operations per density, where
+ *  \f$S\f$ is the number of sampling directions, \f$N_c\f$ the number of
+ *  clusters and \f$p\f$ the interpolation order. The method pays off if many more directions are needed than there
+ *  are sampling directions (see samplingDirectionCount()). */
+template <typename BasisFunctionType, typename ResultType>
+class FarFieldEvaluator {
+public:
+  typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+  /** \brief Constructor.
+   *
+   *  \param[in] op
+   *    Far-field potential operator. Its evaluation points are directions
+   *    of unit length.
+   *  \param[in] space
+   *    Space of the densities.
+   *  \param[in] waveNumber
+   *    Wave number \f$k\f$ passed to the constructor of \p op. For real
+   *    \p ResultType it must be purely imaginary.
+   *  \param[in] parameterList
+   *    Parameters controlling the assembly of \p op at the sampling
+   *    directions and the "FarField" sublist described above. The
+   *    operator is always assembled in dense mode. */
+  FarFieldEvaluator(const PotentialOperator<BasisFunctionType, ResultType> &op,
+                    const shared_ptr<const Space<BasisFunctionType>> &space,
+                    std::complex<double> waveNumber,
+                    const ParameterList &parameterList);
+
+  /** \brief Number of components of the far field. */
+  int componentCount() const;
+
+  /** \brief Number of directions at which the far fields of the clusters
+   *  are sampled. */
+  std::size_t samplingDirectionCount() const;
+
+  /** \brief Number of clusters. */
+  std::size_t clusterCount() const;
+
+  /** \brief Memory taken by the samples, in kB. */
+  double memSizeKb() const;
+
+  /** \brief Evaluate the far fields of several densities.
+   *
+   *  \param[in] directions
+   *    Array whose (i, j)th element is the ith coordinate of the jth
+   *    direction. The directions must be of unit length.
+   *  \param[in] coefficients
+   *    Array whose jth column contains the coefficients of the jth
+   *    density in the basis of the space passed to the constructor.
+   *  \param[out] result
+   *    On output, the (i * componentCount() + c, j)th element is the cth
+   *    component of the far field of the jth density in the ith
+   *    direction, as in AssembledPotentialOperator. */
+  void evaluate(const arma::Mat<CoordinateType> &directions,
+                const arma::Mat<ResultType> &coefficients,
+                arma::Mat<ResultType> &result) const;
+
+  /** \brief Evaluate the far field of a grid function.
+   *
+   *  Returns an array whose (c, i)th element is the cth component of the
+   *  far field in the ith direction, as AssembledPotentialOperator::apply()
+   *  does. */
+  arma::Mat<ResultType>
+  evaluate(const arma::Mat<CoordinateType> &directions,
+           const GridFunction<BasisFunctionType, ResultType> &argument) const;
+
+private:
+  /** \cond PRIVATE */
+  struct Stencil {
+    std::vector<std::size_t> samples;
+    std::vector<CoordinateType> weights;
+  };
+
+  void computeStencil(const CoordinateType *direction, Stencil &stencil)
+      const;
+
+  shared_ptr<const Space<BasisFunctionType>> m_space;
+  int m_componentCount;
+  int m_order;
+  ResultType m_waveNumber; // kappa = -ik
+  std::size_t m_thetaCount;
+  std::size_t m_phiCount;
+  int m_maxThreadCount;
+
+  // DOFs of each cluster (in the original numbering), stored in CSR format
+  std::vector<std::size_t> m_clusterOffsets;
+  std::vector<unsigned int> m_clusterDofs;
+  arma::Mat<CoordinateType> m_clusterCenters;
+
+  // Demodulated samples of each cluster: the (s * componentCount + c, j)th
+  // element of m_samples[l] is the cth component of the far field of the
+  // jth DOF of cluster l in sampling direction s, times
+  // exp(-kappa s . c_l)
+  std::vector<arma::Mat<ResultType>> m_samples;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,525 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fmm_far_field.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace Bempp {
+
+namespace {
+
+template <typename T>
+void convertWaveNumber(std::complex<double> waveNumber, T &result) {
+  if (waveNumber.imag() != 0.)
+    throw std::invalid_argument("FmmFarField::FmmFarField(): "
+                                "real operators require a real wave number");
+  result = static_cast<T>(waveNumber.real());
+}
+
+template <typename T>
+void convertWaveNumber(std::complex<double> waveNumber,
+                       std::complex<T> &result) {
+  result = std::complex<T>(waveNumber);
+}
+
+// Values S[i] of the one-dimensional Chebyshev interpolants of the given
+// order at xi in [-1, 1] and, if dS is not null, their derivatives
+template <typename CoordinateType>
+void chebyshevInterpolants(const std::vector<CoordinateType> &chebyshevValues,
+                           int order, CoordinateType xi, CoordinateType *S,
+                           CoordinateType *dS) {
+  // T_k(xi) and k U_{k-1}(xi) = T_k'(xi)
+  CoordinateType T[64], dT[64];
+  T[0] = 1.;
+  dT[0] = 0.;
+  if (order > 1) {
+    T[1] = xi;
+    dT[1] = 1.;
+  }
+  CoordinateType uPrevious = 1., u = 2. * xi; // U_0 and U_1
+  for (int k = 2; k < order; ++k) {
+    T[k] = 2. * xi * T[k - 1] - T[k - 2];
+    dT[k] = k * u;
+    CoordinateType uNext = 2. * xi * u - uPrevious;
+    uPrevious = u;
+    u = uNext;
+  }
+  const CoordinateType scale = 2. / order;
+  for (int i = 0; i < order; ++i) {
+    const CoordinateType *t = &chebyshevValues[i * order];
+    CoordinateType s = 0.5 * scale, ds = 0.;
+    for (int k = 1; k < order; ++k) {
+      s += scale * t[k] * T[k];
+      ds += scale * t[k] * dT[k];
+    }
+    S[i] = s;
+    if (dS)
+      dS[i] = ds;
+  }
+}
+
+} // namespace
+
+template <typename ValueType>
+FmmFarField<ValueType>::FmmFarField(
+    const shared_ptr<const hmat::DefaultBlockClusterTreeType> &
+        blockClusterTree,
+    int order, std::complex<double> waveNumber, bool storeM2LMatrices)
+    : m_blockClusterTree(blockClusterTree), m_order(order) {
+  if (order < 1 || order > 64)
+    throw std::invalid_argument("FmmFarField::FmmFarField(): "
+                                "order must be between 1 and 64");
+  convertWaveNumber(waveNumber, m_waveNumber);
+
+  // Entry (k, i) is T_k at the Chebyshev node x_i = cos((2i + 1) pi / 2p)
+  m_chebyshevNodes.resize(order);
+  m_chebyshevValues.resize(order * order);
+  for (int i = 0; i < order; ++i) {
+    m_chebyshevNodes[i] = std::cos((2 * i + 1) * M_PI / (2 * order));
+    for (int k = 0; k < order; ++k)
+      m_chebyshevValues[i * order + k] =
+          std::cos(k * (2 * i + 1) * M_PI / (2 * order));
+  }
+
+  initializeTree(blockClusterTree->rowClusterTree(), m_rowTree);
+  initializeTree(blockClusterTree->columnClusterTree(), m_columnTree);
+
+  for (const auto &leaf : blockClusterTree->leafNodes())
+    if (leaf->data().admissible) {
+      m_blockRowNodes.push_back(leaf->data().rowClusterTreeNode->index());
+      m_blockColumnNodes.push_back(leaf->data().columnClusterTreeNode->index());
+    }
+
+  auto fillInteractions = [](const std::vector<std::size_t> &targets,
+                             const std::vector<std::size_t> &sources,
+                             std::size_t nodeCount,
+                             Interactions &interactions) {
+    interactions.offsets.assign(nodeCount + 1, 0);
+    for (std::size_t target : targets)
+      ++interactions.offsets[target + 1];
+    for (std::size_t node = 0; node < nodeCount; ++node)
+      interactions.offsets[node + 1] += interactions.offsets[node];
+    std::vector<std::size_t> position(interactions.offsets.begin(),
+                                      interactions.offsets.end() - 1);
+    interactions.nodes.resize(targets.size());
+    interactions.blocks.resize(targets.size());
+    for (std::size_t block = 0; block < targets.size(); ++block) {
+      std::size_t k = position[targets[block]]++;
+      interactions.nodes[k] = sources[block];
+      interactions.blocks[k] = block;
+    }
+  };
+  fillInteractions(m_blockRowNodes, m_blockColumnNodes,
+                   m_rowTree.leafMatrices.size(), m_rowInteractions);
+  fillInteractions(m_blockColumnNodes, m_blockRowNodes,
+                   m_columnTree.leafMatrices.size(), m_columnInteractions);
+
+  if (storeM2LMatrices) {
+    m_m2lMatrices.resize(m_blockRowNodes.size());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, m_m2lMatrices.size()),
+                      [this](const tbb::blocked_range<std::size_t> &r) {
+      for (std::size_t block = r.begin(); block != r.end(); ++block)
+        evaluateM2LMatrix(block, m_m2lMatrices[block]);
+    });
+  }
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::initializeTree(
+    const shared_ptr<const hmat::DefaultClusterTreeType> &clusterTree,
+    Tree &tree) const {
+  const auto &treeIndex = clusterTree->treeIndex();
+  const std::size_t nodeCount = treeIndex.numberOfNodes();
+  tree.clusterTree = clusterTree;
+  tree.centers.resize(3 * nodeCount);
+  tree.halfWidths.resize(3 * nodeCount);
+  tree.leafMatrices.resize(nodeCount);
+
+  // Boxes that are flat in some direction, e.g. of clusters on a plane, are
+  // given a small thickness so that the interpolants remain defined
+  for (std::size_t node = 0; node < nodeCount; ++node) {
+    const auto &bounds = treeIndex.node(node).data().boundingBox.bounds();
+    CoordinateType maxHalfWidth = 0.;
+    for (int d = 0; d < 3; ++d) {
+      tree.centers[3 * node + d] = 0.5 * (bounds[2 * d] + bounds[2 * d + 1]);
+      tree.halfWidths[3 * node + d] = 0.5 * (bounds[2 * d + 1] - bounds[2 * d]);
+      maxHalfWidth = std::max(maxHalfWidth, tree.halfWidths[3 * node + d]);
+    }
+    if (maxHalfWidth == 0.)
+      maxHalfWidth = 1.;
+    for (int d = 0; d < 3; ++d)
+      tree.halfWidths[3 * node + d] =
+          std::max(tree.halfWidths[3 * node + d],
+                   static_cast<CoordinateType>(1e-3) * maxHalfWidth);
+  }
+
+  std::size_t levelCount = 0;
+  for (std::size_t node = 0; node < nodeCount; ++node)
+    levelCount = std::max(levelCount, treeIndex.level(node) + 1);
+  tree.levelOffsets.assign(levelCount + 1, 0);
+  for (std::size_t node = 0; node < nodeCount; ++node)
+    ++tree.levelOffsets[treeIndex.level(node) + 1];
+  for (std::size_t level = 0; level < levelCount; ++level)
+    tree.levelOffsets[level + 1] += tree.levelOffsets[level];
+  tree.nodesByLevel.resize(nodeCount);
+  std::vector<std::size_t> position(tree.levelOffsets.begin(),
+                                    tree.levelOffsets.end() - 1);
+  for (std::size_t node = 0; node < nodeCount; ++node)
+    tree.nodesByLevel[position[treeIndex.level(node)]++] = node;
+
+  const int p = m_order;
+  tree.transferMatrices.assign(3 * p * p * nodeCount, 0.);
+  std::vector<CoordinateType> S(p);
+  for (std::size_t node = 0; node < nodeCount; ++node) {
+    const std::size_t parent = treeIndex.parent(node);
+    if (parent == node)
+      continue;
+    for (int d = 0; d < 3; ++d) {
+      CoordinateType *T = &tree.transferMatrices[(3 * node + d) * p * p];
+      for (int j = 0; j < p; ++j) {
+        const CoordinateType x =
+            tree.centers[3 * node + d] +
+            tree.halfWidths[3 * node + d] * m_chebyshevNodes[j];
+        const CoordinateType xi = (x - tree.centers[3 * parent + d]) /
+                                  tree.halfWidths[3 * parent + d];
+        chebyshevInterpolants(m_chebyshevValues, p, xi, S.data(),
+                              static_cast<CoordinateType *>(0));
+        for (int i = 0; i < p; ++i)
+          T[i + p * j] = S[i];
+      }
+    }
+  }
+}
+
+template <typename ValueType>
+std::size_t FmmFarField<ValueType>::rows() const {
+  return m_blockClusterTree->rows();
+}
+
+template <typename ValueType>
+std::size_t FmmFarField<ValueType>::columns() const {
+  return m_blockClusterTree->columns();
+}
+
+template <typename ValueType> int FmmFarField<ValueType>::order() const {
+  return m_order;
+}
+
+template <typename ValueType>
+int FmmFarField<ValueType>::interpolationNodeCount() const {
+  return m_order * m_order * m_order;
+}
+
+template <typename ValueType>
+shared_ptr<const hmat::DefaultBlockClusterTreeType>
+FmmFarField<ValueType>::blockClusterTree() const {
+  return m_blockClusterTree;
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::evaluateInterpolants(
+    Side side, std::size_t nodeIndex, const arma::Mat<CoordinateType> &points,
+    const arma::Mat<CoordinateType> *normals,
+    arma::Mat<CoordinateType> &values) const {
+  const Tree &tree = (side == ROWS) ? m_rowTree : m_columnTree;
+  if (points.n_rows != 3 || (normals && (normals->n_rows != 3 ||
+                                         normals->n_cols != points.n_cols)))
+    throw std::invalid_argument("FmmFarField::evaluateInterpolants(): "
+                                "points and normals must be 3D");
+
+  const int p = m_order;
+  std::vector<CoordinateType> S(3 * p), dS(3 * p);
+  values.set_size(p * p * p, points.n_cols);
+  for (std::size_t point = 0; point < points.n_cols; ++point) {
+    for (int d = 0; d < 3; ++d) {
+      const CoordinateType h = tree.halfWidths[3 * nodeIndex + d];
+      const CoordinateType xi =
+          (points(d, point) - tree.centers[3 * nodeIndex + d]) / h;
+      chebyshevInterpolants(m_chebyshevValues, p, xi, &S[d * p],
+                            normals ? &dS[d * p]
+                                    : static_cast<CoordinateType *>(0));
+      if (normals)
+        for (int i = 0; i < p; ++i)
+          dS[d * p + i] *= (*normals)(d, point) / h;
+    }
+    CoordinateType *v = values.colptr(point);
+    for (int i3 = 0; i3 < p; ++i3)
+      for (int i2 = 0; i2 < p; ++i2)
+        for (int i1 = 0; i1 < p; ++i1) {
+          const CoordinateType s1 = S[i1], s2 = S[p + i2], s3 = S[2 * p + i3];
+          *v++ = normals ? dS[i1] * s2 * s3 + s1 * dS[p + i2] * s3 +
+                               s1 * s2 * dS[2 * p + i3]
+                         : s1 * s2 * s3;
+        }
+  }
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::setLeafMatrix(Side side, std::size_t nodeIndex,
+                                           arma::Mat<ValueType> &matrix) {
+  Tree &tree = (side == ROWS) ? m_rowTree : m_columnTree;
+  const auto &treeIndex = tree.clusterTree->treeIndex();
+  if (nodeIndex >= treeIndex.numberOfNodes() || !treeIndex.isLeaf(nodeIndex))
+    throw std::invalid_argument("FmmFarField::setLeafMatrix(): "
+                                "invalid leaf");
+  const hmat::IndexRangeType &range =
+      treeIndex.node(nodeIndex).data().indexRange;
+  if (matrix.n_rows != interpolationNodeCount() ||
+      matrix.n_cols != range[1] - range[0])
+    throw std::invalid_argument("FmmFarField::setLeafMatrix(): "
+                                "matrix has wrong dimensions");
+  tree.leafMatrices[nodeIndex].swap(matrix);
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::interpolationNodes(
+    const Tree &tree, std::size_t nodeIndex,
+    arma::Mat<CoordinateType> &nodes) const {
+  const int p = m_order;
+  nodes.set_size(3, p * p * p);
+  std::size_t n = 0;
+  for (int i3 = 0; i3 < p; ++i3)
+    for (int i2 = 0; i2 < p; ++i2)
+      for (int i1 = 0; i1 < p; ++i1, ++n) {
+        const int i[3] = {i1, i2, i3};
+        for (int d = 0; d < 3; ++d)
+          nodes(d, n) = tree.centers[3 * nodeIndex + d] +
+                        tree.halfWidths[3 * nodeIndex + d] *
+                            m_chebyshevNodes[i[d]];
+      }
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::evaluateM2LMatrix(
+    std::size_t block, arma::Mat<ValueType> &M2L) const {
+  evaluateCouplingMatrix(m_blockRowNodes[block], m_blockColumnNodes[block],
+                         M2L);
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::evaluateCouplingMatrix(
+    std::size_t rowNodeIndex, std::size_t columnNodeIndex,
+    arma::Mat<ValueType> &coupling) const {
+  arma::Mat<CoordinateType> rowNodes, columnNodes;
+  interpolationNodes(m_rowTree, rowNodeIndex, rowNodes);
+  interpolationNodes(m_columnTree, columnNodeIndex, columnNodes);
+  coupling.set_size(rowNodes.n_cols, columnNodes.n_cols);
+  const CoordinateType factor = 1. / (4. * M_PI);
+  for (std::size_t n = 0; n < columnNodes.n_cols; ++n)
+    for (std::size_t m = 0; m < rowNodes.n_cols; ++m) {
+      CoordinateType distanceSq = 0.;
+      for (int d = 0; d < 3; ++d) {
+        const CoordinateType diff = rowNodes(d, m) - columnNodes(d, n);
+        distanceSq += diff * diff;
+      }
+      const CoordinateType distance = std::sqrt(distanceSq);
+      coupling(m, n) = std::exp(-m_waveNumber * distance) * (factor / distance);
+    }
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::applyTransfer(const Tree &tree,
+                                           std::size_t nodeIndex,
+                                           bool transposed, const ValueType *in,
+                                           ValueType *out) const {
+  // Apply the tensor product of the three one-dimensional matrices of the
+  // node, or of their transposes, one dimension at a time
+  const int p = m_order;
+  const CoordinateType *T = &tree.transferMatrices[3 * nodeIndex * p * p];
+  auto entry = [p, transposed](const CoordinateType *T1, int a, int b) {
+    return transposed ? T1[b + p * a] : T1[a + p * b];
+  };
+  std::vector<ValueType> first(p * p * p, 0.), second(p * p * p, 0.);
+  for (int j3 = 0; j3 < p; ++j3)
+    for (int j2 = 0; j2 < p; ++j2)
+      for (int i1 = 0; i1 < p; ++i1) {
+        ValueType sum = 0.;
+        for (int j1 = 0; j1 < p; ++j1)
+          sum += entry(T, i1, j1) * in[j1 + p * (j2 + p * j3)];
+        first[i1 + p * (j2 + p * j3)] = sum;
+      }
+  for (int j3 = 0; j3 < p; ++j3)
+    for (int i2 = 0; i2 < p; ++i2)
+      for (int i1 = 0; i1 < p; ++i1) {
+        ValueType sum = 0.;
+        for (int j2 = 0; j2 < p; ++j2)
+          sum += entry(T + p * p, i2, j2) * first[i1 + p * (j2 + p * j3)];
+        second[i1 + p * (i2 + p * j3)] = sum;
+      }
+  for (int i3 = 0; i3 < p; ++i3)
+    for (int i2 = 0; i2 < p; ++i2)
+      for (int i1 = 0; i1 < p; ++i1) {
+        ValueType sum = 0.;
+        for (int j3 = 0; j3 < p; ++j3)
+          sum += entry(T + 2 * p * p, i3, j3) * second[i1 + p * (i2 + p * j3)];
+        out[i1 + p * (i2 + p * i3)] += sum;
+      }
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::applyNonConjugated(const arma::Mat<ValueType> &X,
+                                                arma::Mat<ValueType> &Y,
+                                                bool transposed,
+                                                ValueType alpha) const {
+  // In the transposed product the column tree receives the result
+  const Tree &sourceTree = transposed ? m_rowTree : m_columnTree;
+  const Tree &targetTree = transposed ? m_columnTree : m_rowTree;
+  const Interactions &interactions =
+      transposed ? m_columnInteractions : m_rowInteractions;
+  const auto &sourceIndex = sourceTree.clusterTree->treeIndex();
+  const auto &targetIndex = targetTree.clusterTree->treeIndex();
+  const std::size_t nodeCount = interpolationNodeCount();
+  const std::size_t columnCount = X.n_cols;
+
+  // Upward pass: P2M at the leaves, M2M above them
+  std::vector<arma::Mat<ValueType>> multipoles(sourceIndex.numberOfNodes());
+  const std::size_t sourceLevelCount = sourceTree.levelOffsets.size() - 1;
+  for (std::size_t level = sourceLevelCount; level-- > 0;)
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(sourceTree.levelOffsets[level],
+                                        sourceTree.levelOffsets[level + 1]),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t k = r.begin(); k != r.end(); ++k) {
+            const std::size_t node = sourceTree.nodesByLevel[k];
+            arma::Mat<ValueType> &multipole = multipoles[node];
+            if (sourceIndex.isLeaf(node)) {
+              const hmat::IndexRangeType &range =
+                  sourceIndex.node(node).data().indexRange;
+              multipole = sourceTree.leafMatrices[node] *
+                          X.rows(range[0], range[1] - 1);
+              continue;
+            }
+            multipole.zeros(nodeCount, columnCount);
+            for (int i = 0; i < 2; ++i) {
+              const std::size_t child = sourceIndex.child(node, i);
+              for (std::size_t c = 0; c < columnCount; ++c)
+                applyTransfer(sourceTree, child, false,
+                              multipoles[child].colptr(c),
+                              multipole.colptr(c));
+            }
+          }
+        });
+
+  // M2L for all admissible blocks
+  std::vector<arma::Mat<ValueType>> locals(targetIndex.numberOfNodes());
+  tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, locals.size()),
+      [&](const tbb::blocked_range<std::size_t> &r) {
+        arma::Mat<ValueType> M2L;
+        for (std::size_t node = r.begin(); node != r.end(); ++node) {
+          locals[node].zeros(nodeCount, columnCount);
+          for (std::size_t k = interactions.offsets[node];
+               k < interactions.offsets[node + 1]; ++k) {
+            const std::size_t block = interactions.blocks[k];
+            const arma::Mat<ValueType> &multipole =
+                multipoles[interactions.nodes[k]];
+            const arma::Mat<ValueType> *matrix = &M2L;
+            if (!m_m2lMatrices.empty())
+              matrix = &m_m2lMatrices[block];
+            else
+              evaluateM2LMatrix(block, M2L);
+            if (transposed)
+              locals[node] += matrix->st() * multipole;
+            else
+              locals[node] += *matrix * multipole;
+          }
+        }
+      });
+  multipoles.clear();
+
+  // Downward pass: L2L below the root, L2P at the leaves
+  const std::size_t targetLevelCount = targetTree.levelOffsets.size() - 1;
+  for (std::size_t level = 0; level < targetLevelCount; ++level)
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(targetTree.levelOffsets[level],
+                                        targetTree.levelOffsets[level + 1]),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t k = r.begin(); k != r.end(); ++k) {
+            const std::size_t node = targetTree.nodesByLevel[k];
+            const std::size_t parent = targetIndex.parent(node);
+            if (parent != node)
+              for (std::size_t c = 0; c < columnCount; ++c)
+                applyTransfer(targetTree, node, true,
+                              locals[parent].colptr(c), locals[node].colptr(c));
+            if (targetIndex.isLeaf(node)) {
+              const hmat::IndexRangeType &range =
+                  targetIndex.node(node).data().indexRange;
+              Y.rows(range[0], range[1] - 1) +=
+                  alpha * (targetTree.leafMatrices[node].st() * locals[node]);
+            }
+          }
+        });
+}
+
+template <typename ValueType>
+void FmmFarField<ValueType>::apply(const arma::Mat<ValueType> &X,
+                                   arma::Mat<ValueType> &Y,
+                                   hmat::TransposeMode trans,
+                                   ValueType alpha) const {
+  const bool transposed =
+      (trans == hmat::TRANS || trans == hmat::CONJTRANS);
+  const bool conjugate = (trans == hmat::CONJ || trans == hmat::CONJTRANS);
+  if (X.n_rows != (transposed ? rows() : columns()) ||
+      Y.n_rows != (transposed ? columns() : rows()) || X.n_cols != Y.n_cols)
+    throw std::invalid_argument("FmmFarField::apply(): "
+                                "incompatible matrix dimensions");
+  if (alpha == ValueType(0) || m_blockRowNodes.empty())
+    return;
+
+  // conj(A) X = conj(A conj(X))
+  if (conjugate) {
+    arma::Mat<ValueType> result(Y.n_rows, Y.n_cols, arma::fill::zeros);
+    applyNonConjugated(arma::conj(X), result, transposed, conj(alpha));
+    Y += arma::conj(result);
+  } else
+    applyNonConjugated(X, Y, transposed, alpha);
+}
+
+template <typename ValueType>
+std::size_t FmmFarField<ValueType>::numberOfInteractions() const {
+  return m_blockRowNodes.size();
+}
+
+template <typename ValueType>
+double FmmFarField<ValueType>::memSizeKb() const {
+  double result = 0.;
+  for (const Tree *tree : {&m_rowTree, &m_columnTree}) {
+    for (const auto &matrix : tree->leafMatrices)
+      result += sizeof(ValueType) * double(matrix.n_elem);
+    result += sizeof(CoordinateType) *
+              double(tree->transferMatrices.size() + tree->centers.size() +
+                     tree->halfWidths.size());
+  }
+  for (const auto &matrix : m_m2lMatrices)
+    result += sizeof(ValueType) * double(matrix.n_elem);
+  return result / 1024;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(FmmFarField);
+
+} // namespace Bempp
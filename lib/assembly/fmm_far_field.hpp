@@ -0,0 +1,192 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_fmm_far_field_hpp
+#define bempp_fmm_far_field_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../fiber/scalar_traits.hpp"
+#include "../hmat/block_cluster_tree.hpp"
+#include "../hmat/common.hpp"
+
+#include <complex>
+#include <vector>
+
+namespace Bempp {
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Far field of a Laplace or modified Helmholtz operator evaluated
+ *  by a black-box fast multipole method.
+ *
+ *  The kernel \f$G(x, y) = \exp(-k|x-y|)/(4\pi|x-y|)\f$ is interpolated on
+ *  the tensor Chebyshev nodes of order \p order in the bounding boxes of
+ *  the clusters of both trees of \p blockClusterTree, i.e. for an
+ *  admissible block \f$(t, s)\f$
+ *
+ *  \f[ G(x, y) \approx \sum_{m,n} S^t_m(x)\, G(\bar x^t_m, \bar y^s_n)\,
+ *      S^s_n(y). \f]
+ *
+ *  The matvec consists of the usual sequence of operators: the leaf
+ *  matrices set by setLeafMatrix() map the coefficients of the DOFs in a
+ *  column leaf to the multipole coefficients of the leaf (P2M) and the
+ *  local coefficients of a row leaf to the DOFs (L2P); the interpolants of
+ *  child boxes are nested in those of their parents (M2M and L2L); and the
+ *  multipole coefficients of the column cluster of every admissible block
+ *  contribute to the local coefficients of its row cluster through the
+ *  kernel evaluated at the Chebyshev nodes (M2L). All operators except the
+ *  leaf matrices have tensor-product structure or are evaluated on the
+ *  fly, unless \p storeM2LMatrices is true, so the memory needed is
+ *  proportional to the number of DOFs times \p order cubed.
+ *
+ *  Inadmissible blocks do not contribute; they form the near field of the
+ *  operator (see DiscreteFmmBoundaryOperator). Because the kernel is not
+ *  differentiated, the normal derivatives of the double-layer kernels are
+ *  applied to the interpolants in the leaf matrices (see
+ *  evaluateInterpolants()). */
+template <typename ValueType> class FmmFarField {
+public:
+  typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+
+  /** \brief Cluster trees whose leaves carry leaf matrices. */
+  enum Side { ROWS, COLUMNS };
+
+  /** \brief Constructor.
+   *
+   *  For real \p ValueType the wave number must be real. */
+  FmmFarField(const shared_ptr<const hmat::DefaultBlockClusterTreeType> &
+                  blockClusterTree,
+              int order, std::complex<double> waveNumber,
+              bool storeM2LMatrices);
+
+  std::size_t rows() const;
+  std::size_t columns() const;
+
+  int order() const;
+
+  /** \brief Number of interpolation nodes of a box, i.e. order() cubed. */
+  int interpolationNodeCount() const;
+
+  shared_ptr<const hmat::DefaultBlockClusterTreeType> blockClusterTree() const;
+
+  /** \brief Evaluate the interpolants of a cluster box at some points.
+   *
+   *  Column \p j of \p values receives the values of the
+   *  interpolationNodeCount() interpolants of the box of node \p nodeIndex
+   *  (see hmat::TreeIndex) of the tree \p side at column \p j of \p points.
+   *  If \p normals is not null, the derivatives of the interpolants in the
+   *  direction of the corresponding column of \p *normals are evaluated
+   *  instead. */
+  void evaluateInterpolants(Side side, std::size_t nodeIndex,
+                            const arma::Mat<CoordinateType> &points,
+                            const arma::Mat<CoordinateType> *normals,
+                            arma::Mat<CoordinateType> &values) const;
+
+  /** \brief Evaluate the kernel at the interpolation nodes of two boxes.
+   *
+   *  Entry (m, n) of \p coupling receives the kernel at interpolation node
+   *  m of the box of row node \p rowNodeIndex and node n of the box of
+   *  column node \p columnNodeIndex; for an admissible block this is its
+   *  M2L matrix. */
+  void evaluateCouplingMatrix(std::size_t rowNodeIndex,
+                              std::size_t columnNodeIndex,
+                              arma::Mat<ValueType> &coupling) const;
+
+  /** \brief Set the matrix of a leaf of one of the trees.
+   *
+   *  The matrix has interpolationNodeCount() rows and one column per DOF
+   *  of the leaf. For a column leaf, column \p j holds the integrals of the
+   *  interpolants against trial function \p j (P2M); for a row leaf, those
+   *  against the conjugated test function \p j (the transpose of L2P). The
+   *  contents of \p matrix are moved into the object. */
+  void setLeafMatrix(Side side, std::size_t nodeIndex,
+                     arma::Mat<ValueType> &matrix);
+
+  /** \brief Compute <tt>Y += alpha * op(A) * X</tt> for the far-field
+   *  matrix \p A.
+   *
+   *  The rows of \p X and \p Y are in H-matrix DOF ordering. */
+  void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+             hmat::TransposeMode trans, ValueType alpha) const;
+
+  /** \brief Number of admissible blocks. */
+  std::size_t numberOfInteractions() const;
+
+  double memSizeKb() const;
+
+private:
+  /** \cond PRIVATE */
+  struct Tree {
+    shared_ptr<const hmat::DefaultClusterTreeType> clusterTree;
+    // Centres and half-widths of the interpolation boxes, 3 per node
+    std::vector<CoordinateType> centers;
+    std::vector<CoordinateType> halfWidths;
+    // For every node but the root, the 3 one-dimensional matrices of size
+    // order x order interpolating the parent's interpolants at the node's
+    // Chebyshev nodes; entry (i, j) is interpolant i of the parent at node j
+    std::vector<CoordinateType> transferMatrices;
+    // Node numbers grouped by level, and the position of every level
+    std::vector<std::size_t> nodesByLevel;
+    std::vector<std::size_t> levelOffsets;
+    std::vector<arma::Mat<ValueType>> leafMatrices;
+  };
+
+  // Admissible blocks in compressed sparse row format, indexed by the row
+  // node (forward) and by the column node (transposed)
+  struct Interactions {
+    std::vector<std::size_t> offsets;
+    std::vector<std::size_t> nodes;
+    std::vector<std::size_t> blocks;
+  };
+
+  void initializeTree(const shared_ptr<const hmat::DefaultClusterTreeType> &
+                          clusterTree,
+                      Tree &tree) const;
+  void interpolationNodes(const Tree &tree, std::size_t nodeIndex,
+                          arma::Mat<CoordinateType> &nodes) const;
+  void evaluateM2LMatrix(std::size_t block, arma::Mat<ValueType> &M2L) const;
+  void applyTransfer(const Tree &tree, std::size_t nodeIndex, bool transposed,
+                     const ValueType *in, ValueType *out) const;
+  void applyNonConjugated(const arma::Mat<ValueType> &X,
+                          arma::Mat<ValueType> &Y, bool transposed,
+                          ValueType alpha) const;
+
+  shared_ptr<const hmat::DefaultBlockClusterTreeType> m_blockClusterTree;
+  int m_order;
+  ValueType m_waveNumber;
+  // Chebyshev nodes in [-1, 1], and the values of the first order()
+  // Chebyshev polynomials at them; entry (k, i) is T_k at node i
+  std::vector<CoordinateType> m_chebyshevNodes;
+  std::vector<CoordinateType> m_chebyshevValues;
+  Tree m_rowTree;
+  Tree m_columnTree;
+  std::vector<std::size_t> m_blockRowNodes;
+  std::vector<std::size_t> m_blockColumnNodes;
+  Interactions m_rowInteractions;
+  Interactions m_columnInteractions;
+  std::vector<arma::Mat<ValueType>> m_m2lMatrices;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
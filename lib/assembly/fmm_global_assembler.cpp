@@ -0,0 +1,216 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fmm_global_assembler.hpp"
+
+#include "assembly_options.hpp"
+#include "context.hpp"
+#include "discrete_fmm_boundary_operator.hpp"
+#include "fmm_far_field.hpp"
+#include "hmat_block_cluster_tree_cache.hpp"
+#include "interpolant_moments_assembler.hpp"
+#include "local_dof_lists_cache.hpp"
+#include "weak_form_hmat_assembly_helper.hpp"
+
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/local_assembler_for_integral_operators.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
+#include "../space/space.hpp"
+
+#include "../hmat/block_cluster_tree.hpp"
+#include "../hmat/block_sparse_matrix.hpp"
+#include "../hmat/cluster_tree.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+#include <Teuchos_ParameterList.hpp>
+
+namespace Bempp {
+
+namespace {
+
+// Compute the leaf matrices of one side of the far field: the integrals of
+// the interpolants of every leaf box (or of their normal derivatives)
+// against the (conjugated) basis functions of the DOFs of the leaf.
+template <typename BasisFunctionType, typename ResultType>
+void computeLeafMatrices(
+    const Space<BasisFunctionType> &space,
+    const hmat::DefaultClusterTreeType &clusterTree,
+    const shared_ptr<LocalDofListsCache<BasisFunctionType>> &dofListsCache,
+    typename FmmFarField<ResultType>::Side side, bool normalDerivative,
+    bool conjugateBasis, int quadratureOrder,
+    FmmFarField<ResultType> &farField) {
+  InterpolantMomentsAssembler<BasisFunctionType, ResultType> momentsAssembler(
+      space, dofListsCache, farField, side, normalDerivative, conjugateBasis,
+      quadratureOrder);
+
+  const auto &treeIndex = clusterTree.treeIndex();
+  const std::vector<std::size_t> &leaves = treeIndex.leaves();
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, leaves.size()),
+                    [&](const tbb::blocked_range<std::size_t> &r) {
+    arma::Mat<ResultType> matrix;
+    for (std::size_t l = r.begin(); l != r.end(); ++l) {
+      const std::size_t leaf = leaves[l];
+      momentsAssembler.assemble(leaf, treeIndex.node(leaf).data().indexRange,
+                                matrix);
+      farField.setLeafMatrix(side, leaf, matrix);
+    }
+  });
+}
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+FmmGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
+    const Space<BasisFunctionType> &testSpace,
+    const Space<BasisFunctionType> &trialSpace,
+    LocalAssemblerForIntegralOperators &localAssembler,
+    Fiber::KernelTileType kernelType, std::complex<double> waveNumber,
+    const Context<BasisFunctionType, ResultType> &context) {
+
+  if (testSpace.worldDimension() != 3 || trialSpace.worldDimension() != 3 ||
+      testSpace.gridDimension() != 2 || trialSpace.gridDimension() != 2)
+    throw std::invalid_argument(
+        "FmmGlobalAssembler::assembleDetachedWeakForm(): "
+        "FMM assembly requires surface grids in 3D");
+
+  const AssemblyOptions &options = context.assemblyOptions();
+  const auto fmmParameterList = context.globalParameterList().sublist("FMM");
+  const bool verbosityAtLeastDefault =
+      (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
+
+  auto minBlockSize = fmmParameterList.template get<int>("minBlockSize");
+  auto eta = fmmParameterList.template get<double>("eta");
+  auto order = fmmParameterList.template get<int>("interpolationOrder");
+  auto quadratureOrder = fmmParameterList.template get<int>("quadratureOrder");
+  auto storeM2LMatrices = fmmParameterList.template get<bool>("storeM2LMatrices");
+
+  // Both boxes of a block are interpolated, so admissibility is based on
+  // the larger one. Admissible blocks are never split.
+  typedef HMatBlockClusterTreeCache<BasisFunctionType> TreeCache;
+  auto testClusterTree = TreeCache::buildClusterTree(testSpace, minBlockSize);
+  auto trialClusterTree = TreeCache::buildClusterTree(trialSpace, minBlockSize);
+  const int maxBlockSize = static_cast<int>(std::max(
+      testClusterTree->numberOfDofs(), trialClusterTree->numberOfDofs()));
+  auto blockClusterTree = shared_ptr<hmat::DefaultBlockClusterTreeType>(
+      new hmat::DefaultBlockClusterTreeType(
+          testClusterTree, trialClusterTree, maxBlockSize,
+          [eta](const hmat::BoundingBox &box1, const hmat::BoundingBox &box2) {
+            return std::max(box1.diameter(), box2.diameter()) <
+                   eta * box1.distance(box2);
+          }));
+
+  const int maxThreadCount = options.parallelizationOptions().isOpenClEnabled()
+                                 ? 1
+                                 : options.parallelizationOptions()
+                                       .maxThreadCount();
+
+  shared_ptr<hmat::BlockSparseMatrix<ResultType>> nearField;
+  shared_ptr<FmmFarField<ResultType>> farField;
+  {
+    Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is
+                                    // single-threaded
+    Fiber::executeInTaskArena(maxThreadCount, [&] {
+      // Near field
+      auto testDofListsCache =
+          shared_ptr<LocalDofListsCache<BasisFunctionType>>(
+              new LocalDofListsCache<BasisFunctionType>(
+                  testSpace, testClusterTree->hMatDofToOriginalDofMap(),
+                  true));
+      auto trialDofListsCache =
+          shared_ptr<LocalDofListsCache<BasisFunctionType>>(
+              new LocalDofListsCache<BasisFunctionType>(
+                  trialSpace, trialClusterTree->hMatDofToOriginalDofMap(),
+                  true));
+      std::vector<LocalAssemblerForIntegralOperators *> localAssemblers(
+          1, &localAssembler);
+      std::vector<const DiscreteBndOp *> sparseTermsToAdd;
+      std::vector<ResultType> denseTermMultipliers(1, 1.0);
+      std::vector<ResultType> sparseTermMultipliers;
+      WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType> helper(
+          testSpace, trialSpace, blockClusterTree, localAssemblers,
+          sparseTermsToAdd, denseTermMultipliers, sparseTermMultipliers,
+          testDofListsCache, trialDofListsCache);
+
+      std::vector<shared_ptr<const hmat::DefaultBlockClusterTreeNodeType>>
+          nearLeaves;
+      for (const auto &leaf :
+           static_cast<const hmat::DefaultBlockClusterTreeType &>(
+               *blockClusterTree).leafNodes())
+        if (!leaf->data().admissible)
+          nearLeaves.push_back(leaf);
+      std::vector<hmat::IndexRangeType> rowRanges(nearLeaves.size());
+      std::vector<hmat::IndexRangeType> columnRanges(nearLeaves.size());
+      std::vector<arma::Mat<ResultType>> blocks(nearLeaves.size());
+      tbb::parallel_for(tbb::blocked_range<std::size_t>(0, nearLeaves.size()),
+                        [&](const tbb::blocked_range<std::size_t> &r) {
+        for (std::size_t i = r.begin(); i != r.end(); ++i) {
+          const auto &data = nearLeaves[i]->data();
+          rowRanges[i] = data.rowClusterTreeNode->data().indexRange;
+          columnRanges[i] = data.columnClusterTreeNode->data().indexRange;
+          helper.computeMatrixBlock(rowRanges[i], columnRanges[i],
+                                    *nearLeaves[i], blocks[i]);
+        }
+      });
+      std::vector<const arma::Mat<ResultType> *> blockPointers;
+      for (const auto &block : blocks)
+        blockPointers.push_back(&block);
+      nearField.reset(new hmat::BlockSparseMatrix<ResultType>(
+          blockClusterTree->rows(), blockClusterTree->columns(), rowRanges,
+          columnRanges, blockPointers));
+      blocks.clear();
+
+      // Far field. The normal derivative of a double-layer kernel at the
+      // trial point, or of an adjoint double-layer kernel at the test
+      // point, is moved onto the interpolants of that side.
+      farField.reset(new FmmFarField<ResultType>(blockClusterTree, order,
+                                                 waveNumber, storeM2LMatrices));
+      computeLeafMatrices<BasisFunctionType, ResultType>(
+          testSpace, *testClusterTree, testDofListsCache,
+          FmmFarField<ResultType>::ROWS,
+          kernelType == Fiber::ADJOINT_DOUBLE_LAYER_TILE, true,
+          quadratureOrder, *farField);
+      computeLeafMatrices<BasisFunctionType, ResultType>(
+          trialSpace, *trialClusterTree, trialDofListsCache,
+          FmmFarField<ResultType>::COLUMNS,
+          kernelType == Fiber::DOUBLE_LAYER_TILE, false, quadratureOrder,
+          *farField);
+    });
+  }
+
+  if (verbosityAtLeastDefault)
+    std::cout << "FMM operator: near field of " << nearField->numberOfBlocks()
+              << " blocks (" << nearField->memSizeKb() << " KB), far field of "
+              << farField->numberOfInteractions() << " interactions ("
+              << farField->memSizeKb() << " KB)" << std::endl;
+
+  return std::unique_ptr<DiscreteBoundaryOperator<ResultType>>(
+      new DiscreteFmmBoundaryOperator<ResultType>(nearField, farField));
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(FmmGlobalAssembler);
+
+} // namespace Bempp
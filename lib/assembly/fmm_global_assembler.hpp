@@ -0,0 +1,78 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_fmm_global_assembler_hpp
+#define bempp_fmm_global_assembler_hpp
+
+#include "../common/common.hpp"
+
+#include "../fiber/kernel_tile_type.hpp"
+#include "../fiber/scalar_traits.hpp"
+
+#include <complex>
+#include <memory>
+
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename ResultType> class LocalAssemblerForIntegralOperators;
+/** \endcond */
+
+} // namespace Fiber
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType> class Space;
+template <typename BasisFunctionType, typename ResultType> class Context;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief FMM-mode assembler.
+ *
+ *  Assembles the weak form of an operator whose kernel is a single Laplace
+ *  or modified Helmholtz kernel (see
+ *  Fiber::CollectionOfKernels::describeModifiedHelmholtz3dKernel()),
+ *  integrated against the values of scalar test and trial functions, as a
+ *  DiscreteFmmBoundaryOperator. The blocks of the block cluster tree that
+ *  are inadmissible according to the "FMM" parameters are evaluated by \p
+ *  localAssembler, i.e. with the same singular and near-singular
+ *  quadrature as in the other assembly modes, and stored; the far field is
+ *  represented by an FmmFarField. Test and trial functions are indexed
+ *  by global DOFs. */
+template <typename BasisFunctionType, typename ResultType>
+class FmmGlobalAssembler {
+public:
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteBndOp;
+  typedef Fiber::LocalAssemblerForIntegralOperators<ResultType>
+  LocalAssemblerForIntegralOperators;
+
+  static std::unique_ptr<DiscreteBndOp> assembleDetachedWeakForm(
+      const Space<BasisFunctionType> &testSpace,
+      const Space<BasisFunctionType> &trialSpace,
+      LocalAssemblerForIntegralOperators &localAssembler,
+      Fiber::KernelTileType kernelType, std::complex<double> waveNumber,
+      const Context<BasisFunctionType, ResultType> &context);
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,162 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "frequency_sweep.hpp"
+
+#include "../fiber/memory_registry.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <tbb/task_group.h>
+#include <algorithm>
+#include <exception>
+
+namespace Bempp {
+
+namespace {
+
+// Starts frequencies in a task group as long as the concurrency limit and
+// the memory budget allow; each finishing frequency starts the next ones.
+class FrequencyScheduler {
+public:
+  FrequencyScheduler(const FrequencySweep::Task &task, std::size_t first,
+                     std::size_t count, int maxConcurrent,
+                     std::size_t bytesPerFrequency, std::size_t budget,
+                     tbb::task_group &group)
+      : m_task(task), m_next(first), m_count(count),
+        m_maxConcurrent(maxConcurrent), m_bytesPerFrequency(bytesPerFrequency),
+        m_budget(budget),
+        m_baselineBytes(Fiber::MemoryRegistry::liveBytes()), m_inFlight(0),
+        m_peakConcurrency(0), m_group(group) {}
+
+  void start() {
+    tbb::mutex::scoped_lock lock(m_mutex);
+    launchAdmissible();
+  }
+
+  int peakConcurrency() const { return m_peakConcurrency; }
+  std::exception_ptr error() const { return m_error; }
+
+private:
+  // Must be called with m_mutex held
+  void launchAdmissible() {
+    while (m_next < m_count && !m_error && m_inFlight < m_maxConcurrent &&
+           (m_inFlight == 0 || fitsInBudget())) {
+      const std::size_t index = m_next++;
+      ++m_inFlight;
+      m_peakConcurrency = std::max(m_peakConcurrency, m_inFlight);
+      m_group.run([this, index] { execute(index); });
+    }
+  }
+
+  // True if one more frequency fits in the budget, assuming that each
+  // frequency in flight will use m_bytesPerFrequency on top of the memory
+  // recorded at the start
+  bool fitsInBudget() const {
+    if (m_budget == 0 || m_bytesPerFrequency == 0)
+      return true;
+    const std::size_t required =
+        m_baselineBytes + (m_inFlight + 1) * m_bytesPerFrequency;
+    const std::size_t live = Fiber::MemoryRegistry::liveBytes();
+    return Fiber::MemoryRegistry::makeRoom(
+        required > live ? required - live : 0, m_budget);
+  }
+
+  void execute(std::size_t index) {
+    std::exception_ptr error;
+    try {
+      m_task(index);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    tbb::mutex::scoped_lock lock(m_mutex);
+    if (error && !m_error)
+      m_error = error;
+    --m_inFlight;
+    launchAdmissible();
+  }
+
+  const FrequencySweep::Task &m_task;
+  std::size_t m_next;
+  const std::size_t m_count;
+  const int m_maxConcurrent;
+  const std::size_t m_bytesPerFrequency;
+  const std::size_t m_budget;
+  const std::size_t m_baselineBytes;
+  int m_inFlight;
+  int m_peakConcurrency;
+  std::exception_ptr m_error;
+  tbb::task_group &m_group;
+  tbb::mutex m_mutex;
+};
+
+std::size_t megabytesToBytes(double megabytes) {
+  return megabytes > 0. ? static_cast<std::size_t>(megabytes * 1024. * 1024.)
+                        : 0;
+}
+
+} // namespace
+
+FrequencySweep::FrequencySweep(const FrequencySweepOptions &options)
+    : m_options(options), m_memoryPerFrequency(0), m_peakConcurrency(0) {}
+
+void FrequencySweep::run(std::size_t frequencyCount, const Task &task) {
+  m_memoryPerFrequency = megabytesToBytes(m_options.memoryPerFrequency);
+  m_peakConcurrency = 0;
+  if (frequencyCount == 0)
+    return;
+
+  tbb::task_arena &arena = Fiber::taskArena(m_options.maxThreadCount);
+  const int maxConcurrent = m_options.maxConcurrentFrequencies > 0
+                                ? m_options.maxConcurrentFrequencies
+                                : arena.max_concurrency();
+
+  std::size_t first = 0;
+  if (m_options.warmUp) {
+    const bool measure = m_memoryPerFrequency == 0;
+    const std::size_t liveBytes = Fiber::MemoryRegistry::liveBytes();
+    if (measure)
+      Fiber::MemoryRegistry::resetPeak();
+    arena.execute([&] { task(0); });
+    const std::size_t peakBytes = Fiber::MemoryRegistry::peakBytes();
+    if (measure && peakBytes > liveBytes)
+      m_memoryPerFrequency = peakBytes - liveBytes;
+    m_peakConcurrency = 1;
+    first = 1;
+  }
+  if (first == frequencyCount)
+    return;
+
+  std::exception_ptr error;
+  arena.execute([&] {
+    tbb::task_group group;
+    FrequencyScheduler scheduler(
+        task, first, frequencyCount, std::max(maxConcurrent, 1),
+        m_memoryPerFrequency, megabytesToBytes(m_options.memoryBudget), group);
+    scheduler.start();
+    group.wait();
+    m_peakConcurrency =
+        std::max(m_peakConcurrency, scheduler.peakConcurrency());
+    error = scheduler.error();
+  });
+  if (error)
+    std::rethrow_exception(error);
+}
+
+} // namespace Bempp
@@ -0,0 +1,193 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_frequency_sweep_hpp
+#define bempp_frequency_sweep_hpp
+
+#include "../common/common.hpp"
+
+#include "context.hpp"
+
+#include <tbb/mutex.h>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+namespace Bempp {
+
+/** \ingroup weak_form_assembly
+ *  \brief Options controlling a FrequencySweep. */
+struct FrequencySweepOptions {
+  FrequencySweepOptions()
+      : maxThreadCount(ParallelizationOptions::AUTO),
+        maxConcurrentFrequencies(ParallelizationOptions::AUTO),
+        memoryBudget(0.), memoryPerFrequency(0.), warmUp(true),
+        ordered(true) {}
+
+  /** \brief Maximum number of threads shared by all frequencies, or
+   *  ParallelizationOptions::AUTO.
+   *
+   *  It should be the thread count the assemblers use, so that the
+   *  parallel loops of the individual stages run in the task arena of the
+   *  sweep instead of competing with it; see Fiber::taskArena(). */
+  int maxThreadCount;
+  /** \brief Maximum number of frequencies processed at the same time, or
+   *  ParallelizationOptions::AUTO to allow one per thread. */
+  int maxConcurrentFrequencies;
+  /** \brief Memory in MB that the data recorded by the
+   *  Fiber::MemoryRegistry may occupy while frequencies run concurrently;
+   *  0 means no budget. */
+  double memoryBudget;
+  /** \brief Memory in MB recorded by the Fiber::MemoryRegistry during the
+   *  processing of one frequency; 0 means that it is measured on the
+   *  warm-up frequency. */
+  double memoryPerFrequency;
+  /** \brief If true, process the first frequency alone before the others.
+   *
+   *  Its stages then use all threads, and the data it leaves behind for the
+   *  others (e.g. the block cluster trees cached by a shared Context or the
+   *  wave-number-independent singular integrals saved to the singular
+   *  integral store) is computed only once. */
+  bool warmUp;
+  /** \brief If true, results are handed out in the order of the
+   *  frequencies; otherwise as soon as they are available. */
+  bool ordered;
+};
+
+/** \relates FrequencySweepOptions
+ *  \brief Return options using the thread count of the assembly options
+ *  and the <tt>memoryBudget</tt> global parameter of \p context. */
+template <typename BasisFunctionType, typename ResultType>
+FrequencySweepOptions
+frequencySweepOptions(const Context<BasisFunctionType, ResultType> &context) {
+  FrequencySweepOptions options;
+  options.maxThreadCount =
+      context.assemblyOptions().parallelizationOptions().maxThreadCount();
+  const ParameterList &parameters = context.globalParameterList();
+  if (parameters.isParameter("memoryBudget"))
+    options.memoryBudget = parameters.get<double>("memoryBudget");
+  return options;
+}
+
+/** \ingroup weak_form_assembly
+ *  \brief Driver running the frequencies of a sweep concurrently.
+ *
+ *  A typical sweep assembles, solves and evaluates a far field for each of
+ *  many wave numbers. Each stage is parallel by itself, but stages at small
+ *  wave numbers cannot keep all cores busy. This class runs several
+ *  frequencies as tasks of one TBB task arena, inside which the parallel
+ *  loops of the stages nest, so that idle threads of one frequency help
+ *  with another.
+ *
+ *  The number of frequencies in flight is limited by
+ *  FrequencySweepOptions::maxConcurrentFrequencies and by the memory
+ *  budget: a frequency is only started if the memory recorded by the
+ *  Fiber::MemoryRegistry at the start of the sweep plus the memory per
+ *  frequency of all frequencies in flight fits in the budget, after
+ *  releasing evictable caches if necessary. One frequency is always
+ *  allowed to run, so the sweep makes progress even if the budget is too
+ *  small.
+ *
+ *  To share data between frequencies, the tasks should construct their
+ *  operators with a single Context: the block cluster trees of H-matrices
+ *  are then built only once. With singular kernel splitting (see
+ *  AccuracyOptionsEx::setSingularKernelSplitting()) and a singular
+ *  integral store, the singular integrals of the Laplace part are computed
+ *  by the warm-up frequency and loaded by all others. */
+class FrequencySweep {
+public:
+  /** \brief Processing of the frequency with the given index. Called
+   *  concurrently for different frequencies. */
+  typedef std::function<void(std::size_t)> Task;
+
+  explicit FrequencySweep(
+      const FrequencySweepOptions &options = FrequencySweepOptions());
+
+  const FrequencySweepOptions &options() const { return m_options; }
+
+  /** \brief Call \p task for each index from 0 to \p frequencyCount - 1.
+   *
+   *  If a task throws, no further frequencies are started and the first
+   *  exception is rethrown once the frequencies in flight have finished.
+   *
+   *  \note If FrequencySweepOptions::memoryPerFrequency is 0, the peak of
+   *  the Fiber::MemoryRegistry is reset before the warm-up frequency. */
+  void run(std::size_t frequencyCount, const Task &task);
+
+  /** \brief Compute a result for each frequency and stream it out.
+   *
+   *  \p compute is called concurrently with the index of a frequency and
+   *  returns its result; \p consume is called with the index and the
+   *  result as soon as the result is available (in order of the indices if
+   *  FrequencySweepOptions::ordered is set), one call at a time. Results
+   *  are released after \p consume returns, so that all results are never
+   *  held at once; in ordered mode, the results of frequencies that
+   *  finished early are kept until their turn comes. */
+  template <typename Compute, typename Consume>
+  void run(std::size_t frequencyCount, const Compute &compute,
+           const Consume &consume);
+
+  /** \brief Memory per frequency in bytes used by the last call of run(),
+   *  as given in the options or measured on the warm-up frequency. */
+  std::size_t memoryPerFrequency() const { return m_memoryPerFrequency; }
+
+  /** \brief Largest number of frequencies that were in flight at the same
+   *  time during the last call of run(). */
+  int peakConcurrency() const { return m_peakConcurrency; }
+
+private:
+  /** \cond PRIVATE */
+  FrequencySweepOptions m_options;
+  std::size_t m_memoryPerFrequency;
+  int m_peakConcurrency;
+  /** \endcond */
+};
+
+template <typename Compute, typename Consume>
+void FrequencySweep::run(std::size_t frequencyCount, const Compute &compute,
+                         const Consume &consume) {
+  typedef typename std::decay<
+      typename std::result_of<Compute(std::size_t)>::type>::type Result;
+
+  tbb::mutex mutex;
+  std::map<std::size_t, Result> pending;
+  std::size_t nextIndex = 0;
+  const bool ordered = m_options.ordered;
+  run(frequencyCount, [&](std::size_t index) {
+    Result result = compute(index);
+    tbb::mutex::scoped_lock lock(mutex);
+    if (!ordered) {
+      consume(index, result);
+      return;
+    }
+    pending.insert(std::make_pair(index, std::move(result)));
+    while (!pending.empty() && pending.begin()->first == nextIndex) {
+      consume(nextIndex, pending.begin()->second);
+      pending.erase(pending.begin());
+      ++nextIndex;
+    }
+  });
+}
+
+} // namespace Bempp
+
+#endif
@@ -27,6 +27,7 @@
 #include "discrete_boundary_operator.hpp"
 #include "identity_operator.hpp"
 #include "local_assembler_construction_helper.hpp"
+#include "mass_matrix_cache.hpp"
 
 #include "../common/complex_aux.hpp"
 #include "../common/deprecated.hpp"
@@ -40,6 +41,8 @@
 #include "../fiber/opencl_handler.hpp"
 #include "../fiber/quadrature_strategy.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../grid/geometry_factory.hpp"
 #include "../grid/grid.hpp"
 #include "../grid/grid_view.hpp"
@@ -56,19 +59,91 @@
 #include <set>
 #include <sstream>
 
+#include <tbb/parallel_reduce.h>
+
 namespace Bempp {
 
 // Internal routines
 
 namespace {
 
+// Body of parallel reduction over elements. Each body accumulates the
+// projections of all the functions (one per column) on its own copy of the
+// result matrix; the copies are summed in join().
+
 template <typename BasisFunctionType, typename ResultType>
-shared_ptr<arma::Col<ResultType>> reallyCalculateProjections(
+class ProjectionLoopBody {
+public:
+  typedef Fiber::LocalAssemblerForGridFunctions<ResultType> LocalAssembler;
+
+  ProjectionLoopBody(
+      const std::vector<std::vector<GlobalDofIndex>> &testGlobalDofs,
+      const std::vector<std::vector<BasisFunctionType>> &testLocalDofWeights,
+      const std::vector<LocalAssembler *> &assemblers, size_t dofCount)
+      : m_testGlobalDofs(testGlobalDofs),
+        m_testLocalDofWeights(testLocalDofWeights), m_assemblers(assemblers),
+        m_result(dofCount, assemblers.size()) {
+    m_result.fill(0.);
+  }
+
+  ProjectionLoopBody(ProjectionLoopBody &other, tbb::split)
+      : m_testGlobalDofs(other.m_testGlobalDofs),
+        m_testLocalDofWeights(other.m_testLocalDofWeights),
+        m_assemblers(other.m_assemblers),
+        m_result(other.m_result.n_rows, other.m_result.n_cols) {
+    m_result.fill(0.);
+  }
+
+  void operator()(const tbb::blocked_range<int> &r) {
+    std::vector<int> testIndices(r.size());
+    for (int i = r.begin(); i != r.end(); ++i)
+      testIndices[i - r.begin()] = i;
+
+    std::vector<arma::Col<ResultType>> localResult;
+    for (size_t f = 0; f < m_assemblers.size(); ++f) {
+      // Evaluate local weak forms
+      m_assemblers[f]->evaluateLocalWeakForms(testIndices, localResult);
+
+      // Loop over test indices
+      for (size_t i = 0; i < testIndices.size(); ++i) {
+        const int testIndex = testIndices[i];
+        // Add the integrals to appropriate entries in the global weak form
+        for (size_t testDof = 0; testDof < m_testGlobalDofs[testIndex].size();
+             ++testDof) {
+          int testGlobalDof = m_testGlobalDofs[testIndex][testDof];
+          if (testGlobalDof >= 0) // if it's negative, it means that this
+                                  // local dof is constrained (not used)
+            m_result(testGlobalDof, f) +=
+                conj(m_testLocalDofWeights[testIndex][testDof]) *
+                localResult[i](testDof);
+        }
+      }
+    }
+  }
+
+  void join(const ProjectionLoopBody &other) { m_result += other.m_result; }
+
+private:
+  const std::vector<std::vector<GlobalDofIndex>> &m_testGlobalDofs;
+  const std::vector<std::vector<BasisFunctionType>> &m_testLocalDofWeights;
+  // Assemblers are thread-safe
+  const std::vector<LocalAssembler *> &m_assemblers;
+
+public:
+  arma::Mat<ResultType> m_result;
+};
+
+/** \brief Calculate the projections of several functions on the basis
+  functions of \p dualSpace in a single pass over the elements.
+
+  The i'th column of the returned matrix holds the projections of the function
+  integrated by \p assemblers[i]. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<arma::Mat<ResultType>> reallyCalculateProjections(
     const Space<BasisFunctionType> &dualSpace,
-    Fiber::LocalAssemblerForGridFunctions<ResultType> &assembler,
+    const std::vector<Fiber::LocalAssemblerForGridFunctions<ResultType> *>
+        &assemblers,
     const AssemblyOptions &options) {
-  // TODO: parallelise using TBB (the parameter options will then start be used)
-
   // Get the grid's leaf view so that we can iterate over elements
   const GridView &view = dualSpace.gridView();
   const size_t elementCount = view.entityCount(0);
@@ -88,54 +163,53 @@ shared_ptr<arma::Col<ResultType>> reallyCalculateProjections(
     it->next();
   }
 
-  // Make a vector of all element indices
-  std::vector<int> testIndices(elementCount);
-  for (size_t i = 0; i < elementCount; ++i)
-    testIndices[i] = i;
-
-  // Create the weak form's column vector
-  shared_ptr<arma::Col<ResultType>> result(
-      new arma::Col<ResultType>(dualSpace.globalDofCount()));
-  result->fill(0.);
-
-  std::vector<arma::Col<ResultType>> localResult;
-  // Evaluate local weak forms
-  assembler.evaluateLocalWeakForms(testIndices, localResult);
-
-  // Loop over test indices
-  for (size_t testIndex = 0; testIndex < elementCount; ++testIndex)
-    // Add the integrals to appropriate entries in the global weak form
-    for (size_t testDof = 0; testDof < testGlobalDofs[testIndex].size();
-         ++testDof) {
-      int testGlobalDof = testGlobalDofs[testIndex][testDof];
-      if (testGlobalDof >= 0) // if it's negative, it means that this
-                              // local dof is constrained (not used)
-        (*result)(testGlobalDof) +=
-            conj(testLocalDofWeights[testIndex][testDof]) *
-            localResult[testIndex](testDof);
-    }
+  typedef ProjectionLoopBody<BasisFunctionType, ResultType> Body;
+  Body body(testGlobalDofs, testLocalDofWeights, assemblers,
+            dualSpace.globalDofCount());
 
-  // Return the vector of projections <phi_i, f>
-  return result;
+  const ParallelizationOptions &parallelOptions =
+      options.parallelizationOptions();
+  int maxThreadCount = 1;
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
+  {
+    Fiber::SerialBlasRegion region;
+    // Elements are integrated in batches of at least PROJECTION_GRAIN_SIZE
+    // so that the local assembler can still group them by quadrature variant
+    const int PROJECTION_GRAIN_SIZE = 256;
+    Fiber::executeInTaskArena(maxThreadCount, [&] {
+      tbb::parallel_reduce(
+          tbb::blocked_range<int>(0, elementCount, PROJECTION_GRAIN_SIZE),
+          body);
+    });
+  }
+
+  // Return the vectors of projections <phi_i, f>
+  return shared_ptr<arma::Mat<ResultType>>(
+      new arma::Mat<ResultType>(body.m_result));
 }
 
-/** \brief Calculate projections of the function on the basis functions of
-  the given dual space. */
+/** \brief Calculate projections of the functions on the basis functions of
+  the given dual space.
+
+  The i'th column of the returned matrix corresponds to \p globalFunctions[i].
+  The local assemblers share the grid data of \p dualSpace. */
 template <typename BasisFunctionType, typename ResultType>
-shared_ptr<arma::Col<ResultType>>
+shared_ptr<arma::Mat<ResultType>>
 calculateProjections(const Context<BasisFunctionType, ResultType> &context,
-                     const Function<ResultType> &globalFunction,
+                     const std::vector<const Function<ResultType> *>
+                         &globalFunctions,
                      const Space<BasisFunctionType> &dualSpace) {
   const AssemblyOptions &options = context.assemblyOptions();
 
-  // Prepare local assembler
+  // Prepare local assemblers
   typedef typename Fiber::ScalarTraits<ResultType>::RealType CoordinateType;
   typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
   typedef std::vector<const Fiber::Shapeset<BasisFunctionType> *>
   ShapesetPtrVector;
   typedef LocalAssemblerConstructionHelper Helper;
 
-  shared_ptr<RawGridGeometry> rawGeometry;
+  shared_ptr<const RawGridGeometry> rawGeometry;
   shared_ptr<GeometryFactory> geometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> testShapesets;
@@ -150,13 +224,33 @@ calculateProjections(const Context<BasisFunctionType, ResultType> &context,
   testTransformations = dualSpace.basisFunctionValue();
 
   typedef Fiber::LocalAssemblerForGridFunctions<ResultType> LocalAssembler;
-  std::unique_ptr<LocalAssembler> assembler =
-      context.quadStrategy()->makeAssemblerForGridFunctions(
-          geometryFactory, rawGeometry, testShapesets,
-          make_shared_from_ref(testTransformations),
-          make_shared_from_ref(globalFunction), openClHandler);
+  std::vector<std::unique_ptr<LocalAssembler>> assemblers;
+  std::vector<LocalAssembler *> assemblerPtrs;
+  assemblers.reserve(globalFunctions.size());
+  for (size_t i = 0; i < globalFunctions.size(); ++i) {
+    assemblers.push_back(context.quadStrategy()->makeAssemblerForGridFunctions(
+        geometryFactory, rawGeometry, testShapesets,
+        make_shared_from_ref(testTransformations),
+        make_shared_from_ref(*globalFunctions[i]), openClHandler));
+    assemblerPtrs.push_back(assemblers.back().get());
+  }
 
-  return reallyCalculateProjections(dualSpace, *assembler, options);
+  return reallyCalculateProjections(dualSpace, assemblerPtrs, options);
+}
+
+/** \brief Calculate projections of the function on the basis functions of
+  the given dual space. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<arma::Col<ResultType>>
+calculateProjections(const Context<BasisFunctionType, ResultType> &context,
+                     const Function<ResultType> &globalFunction,
+                     const Space<BasisFunctionType> &dualSpace) {
+  std::vector<const Function<ResultType> *> globalFunctions(1,
+                                                            &globalFunction);
+  shared_ptr<arma::Mat<ResultType>> projections =
+      calculateProjections(context, globalFunctions, dualSpace);
+  return shared_ptr<arma::Col<ResultType>>(
+      new arma::Col<ResultType>(projections->col(0)));
 }
 
 /** \brief Evaluate the function at the interpolation points of the chosen
@@ -199,6 +293,17 @@ arma::Col<ResultType> interpolate(const Function<ResultType> &globalFunction,
   return result;
 }
 
+// Return a modifiable reference to *vector, copying it first if it is shared
+// with another GridFunction. The vector was allocated as non-const, so
+// casting the constness away is safe.
+template <typename ValueType>
+arma::Col<ValueType> &
+unsharedVector(shared_ptr<const arma::Col<ValueType>> &vector) {
+  if (!vector.unique())
+    vector = boost::make_shared<arma::Col<ValueType>>(*vector);
+  return const_cast<arma::Col<ValueType> &>(*vector);
+}
+
 } // namespace
 
 // Recommended constructors
@@ -577,7 +682,8 @@ void GridFunction<BasisFunctionType, ResultType>::setCoefficients(
 }
 
 template <typename BasisFunctionType, typename ResultType>
-arma::Col<ResultType> GridFunction<BasisFunctionType, ResultType>::projections(
+const arma::Col<ResultType> &
+GridFunction<BasisFunctionType, ResultType>::projections(
     const shared_ptr<const Space<BasisFunctionType>> &dualSpace_) const {
   if (!m_space)
     throw std::runtime_error("GridFunction::projections() must not be called "
@@ -671,6 +777,60 @@ void GridFunction<BasisFunctionType, ResultType>::setProjections(
   setProjections(m_dualSpace, projects);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> &
+GridFunction<BasisFunctionType, ResultType>::axpy(ResultType alpha,
+                                                   const GridFunction &other) {
+  if (!isInitialized() || !other.isInitialized())
+    throw std::runtime_error("GridFunction::axpy() must not be called "
+                             "on uninitialized GridFunction objects");
+  if (m_space != other.m_space)
+    throw std::runtime_error("GridFunction::axpy(): spaces don't match");
+  if (m_wasInitializedFromCoefficients) {
+    const arma::Col<ResultType> &x = other.coefficients();
+    unsharedVector(m_coefficients) += alpha * x;
+    m_projections.reset();
+  } else {
+    const arma::Col<ResultType> &x = other.projections(m_dualSpace);
+    unsharedVector(m_projections) += alpha * x;
+    m_coefficients.reset();
+  }
+  return *this;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> &
+GridFunction<BasisFunctionType, ResultType>::scale(ResultType alpha) {
+  if (!isInitialized())
+    throw std::runtime_error("GridFunction::scale() must not be called "
+                             "on an uninitialized GridFunction object");
+  if (m_coefficients)
+    unsharedVector(m_coefficients) *= alpha;
+  if (m_projections)
+    unsharedVector(m_projections) *= alpha;
+  return *this;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> &
+GridFunction<BasisFunctionType, ResultType>::
+operator+=(const GridFunction &other) {
+  return axpy(static_cast<ResultType>(1.), other);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> &
+GridFunction<BasisFunctionType, ResultType>::
+operator-=(const GridFunction &other) {
+  return axpy(static_cast<ResultType>(-1.), other);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> &
+GridFunction<BasisFunctionType, ResultType>::operator*=(ResultType alpha) {
+  return scale(alpha);
+}
+
 template <typename BasisFunctionType, typename ResultType>
 void
 GridFunction<BasisFunctionType, ResultType>::updateProjectionsFromCoefficients(
@@ -681,13 +841,13 @@ GridFunction<BasisFunctionType, ResultType>::updateProjectionsFromCoefficients(
   assert(dualSpace_);
   assert(m_coefficients);
 
-  // Calculate the mass matrix
-  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-  BoundaryOp id = identityOperator(m_context, m_space, m_space, dualSpace_);
+  // Retrieve the mass matrix
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> massMatrix =
+      m_context->massMatrixCache()->massMatrix(m_context, m_space, dualSpace_);
 
   shared_ptr<arma::Col<ResultType>> newProjections(
       new arma::Col<ResultType>(dualSpace_->globalDofCount()));
-  id.weakForm()->apply(NO_TRANSPOSE, *m_coefficients, *newProjections,
+  massMatrix->apply(NO_TRANSPOSE, *m_coefficients, *newProjections,
                        static_cast<ResultType>(1.),
                        static_cast<ResultType>(0.));
   m_projections = newProjections;
@@ -704,14 +864,14 @@ GridFunction<BasisFunctionType, ResultType>::updateCoefficientsFromProjections()
   assert(m_projections);
   assert(m_dualSpace);
 
-  // Calculate the (pseudo)inverse mass matrix
-  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-  BoundaryOp id = identityOperator(m_context, m_space, m_space, m_dualSpace);
-  BoundaryOp pinvId = pseudoinverse(id);
+  // Retrieve the factorised (pseudo)inverse mass matrix
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> inverseMassMatrix =
+      m_context->massMatrixCache()->inverseMassMatrix(m_context, m_space,
+                                                      m_dualSpace);
 
   shared_ptr<arma::Col<ResultType>> newCoefficients(
       new arma::Col<ResultType>(m_space->globalDofCount()));
-  pinvId.weakForm()->apply(NO_TRANSPOSE, *m_projections, *newCoefficients,
+  inverseMassMatrix->apply(NO_TRANSPOSE, *m_projections, *newCoefficients,
                            static_cast<ResultType>(1.),
                            static_cast<ResultType>(0.));
   m_coefficients = newCoefficients;
@@ -727,15 +887,12 @@ GridFunction<BasisFunctionType, ResultType>::L2Norm() const {
   if (!m_space)
     throw std::runtime_error("GridFunction::L2_Norm() must not be called "
                              "on an uninitialized GridFunction object");
-  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-
   // Get the vector of coefficients
   const arma::Col<ResultType> &coeffs = coefficients();
 
-  // Calculate the mass matrix
-  BoundaryOp id = identityOperator(m_context, m_space, m_space, m_space);
+  // Retrieve the mass matrix
   shared_ptr<const DiscreteBoundaryOperator<ResultType>> massMatrix =
-      id.weakForm();
+      m_context->massMatrixCache()->massMatrix(m_context, m_space, m_space);
 
   arma::Col<ResultType> product(coeffs.n_rows);
   massMatrix->apply(NO_TRANSPOSE, coeffs, product, 1., 0.);
@@ -826,11 +983,9 @@ void GridFunction<BasisFunctionType, ResultType>::evaluateAtSpecialPoints(
   std::fill(multiplicities.begin(), multiplicities.end(), 0);
 
   // Gather geometric data
-  Fiber::RawGridGeometry<CoordinateType> rawGeometry(gridDim,
-                                                     m_space->worldDimension());
-  view.getRawElementData(rawGeometry.vertices(),
-                         rawGeometry.elementCornerIndices(),
-                         rawGeometry.auxData(), rawGeometry.domainIndices());
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> rawGeometryPtr =
+      view.rawGeometry<CoordinateType>();
+  const Fiber::RawGridGeometry<CoordinateType> &rawGeometry = *rawGeometryPtr;
 
   // Make geometry factory
   shared_ptr<const Grid> grid = m_space->grid();
@@ -1126,6 +1281,58 @@ exportToVtk(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
                            filesPath, outputType);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void exportToVtu(
+    const std::vector<const GridFunction<BasisFunctionType, ResultType> *> &
+        gridFunctions,
+    VtkWriter::DataType dataType, const std::vector<std::string> &dataLabels,
+    const char *fileNamesBase, const char *filesPath,
+    VtuWriter::Encoding encoding, int pieceCount) {
+  if (gridFunctions.empty())
+    throw std::invalid_argument("exportToVtu(): no functions given");
+  if (dataLabels.size() != gridFunctions.size())
+    throw std::invalid_argument("exportToVtu(): 'gridFunctions' and "
+                                "'dataLabels' must have the same length");
+  shared_ptr<const Grid> grid;
+  for (size_t i = 0; i < gridFunctions.size(); ++i) {
+    if (!gridFunctions[i] || !gridFunctions[i]->space())
+      throw std::runtime_error("exportToVtu(): gridFunctions must not contain "
+                               "uninitialized GridFunction objects");
+    if (i == 0)
+      grid = gridFunctions[i]->space()->grid();
+    else if (gridFunctions[i]->space()->grid() != grid)
+      throw std::invalid_argument("exportToVtu(): all functions must be "
+                                  "defined on the same grid");
+  }
+
+  // The writer refers to the values, which must therefore be kept until the
+  // file has been written
+  std::vector<arma::Mat<ResultType>> data(gridFunctions.size());
+  std::unique_ptr<GridView> view = grid->leafView();
+  VtuWriter vtuWriter(*view);
+  for (size_t i = 0; i < gridFunctions.size(); ++i) {
+    gridFunctions[i]->evaluateAtSpecialPoints(dataType, data[i]);
+    if (dataType == VtkWriter::CELL_DATA)
+      vtuWriter.addCellData(data[i], dataLabels[i]);
+    else // VERTEX_DATA
+      vtuWriter.addVertexData(data[i], dataLabels[i]);
+  }
+  vtuWriter.write(fileNamesBase, encoding, pieceCount,
+                  filesPath ? std::string(filesPath) : std::string());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void
+exportToVtu(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+            VtkWriter::DataType dataType, const char *dataLabel,
+            const char *fileNamesBase, const char *filesPath,
+            VtuWriter::Encoding encoding, int pieceCount) {
+  exportToVtu(std::vector<const GridFunction<BasisFunctionType, ResultType> *>(
+                  1, &gridFunction),
+              dataType, std::vector<std::string>(1, dataLabel), fileNamesBase,
+              filesPath, encoding, pieceCount);
+}
+
 BEMPP_GCC_DIAG_OFF(deprecated - declarations);
 
 // Redundant, in fact -- can be obtained directly from Space
@@ -1138,24 +1345,77 @@ GridFunction<BasisFunctionType, ResultType>::basis(const Entity<0> &element)
   return m_space->basis(element);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> linearCombination(
+    const std::vector<ResultType> &weights,
+    const std::vector<const GridFunction<BasisFunctionType, ResultType> *> &
+        functions) {
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+  if (functions.empty() || weights.size() != functions.size())
+    throw std::invalid_argument("linearCombination(): 'weights' and "
+                                "'functions' must be nonempty and have the "
+                                "same length");
+  for (size_t i = 0; i < functions.size(); ++i)
+    if (!functions[i] || !functions[i]->isInitialized())
+      throw std::runtime_error("linearCombination(): functions must not be "
+                               "uninitialized GridFunction objects");
+  const GF &first = *functions[0];
+  for (size_t i = 1; i < functions.size(); ++i)
+    if (functions[i]->space() != first.space())
+      throw std::runtime_error("linearCombination(): spaces don't match");
+
+  // For the sake of old-style code (with dualSpace stored in the
+  // GridFunction), combine the projections if that needs no conversion.
+  bool useProjections = true;
+  for (size_t i = 0; i < functions.size() && useProjections; ++i)
+    useProjections = !functions[i]->wasInitializedFromCoefficients() &&
+                     functions[i]->m_projections &&
+                     functions[i]->m_dualSpace == first.m_dualSpace;
+
+  const size_t termCount = functions.size();
+  std::vector<const ResultType *> terms(termCount);
+  for (size_t i = 0; i < termCount; ++i)
+    terms[i] = useProjections
+                   ? functions[i]->m_projections->memptr()
+                   : functions[i]->coefficients().memptr();
+  const size_t size = useProjections ? first.m_projections->n_rows
+                                     : first.coefficients().n_rows;
+
+  shared_ptr<arma::Col<ResultType>> sum =
+      boost::make_shared<arma::Col<ResultType>>(size);
+  ResultType *out = sum->memptr();
+  for (size_t j = 0; j < size; ++j) {
+    ResultType value = weights[0] * terms[0][j];
+    for (size_t i = 1; i < termCount; ++i)
+      value += weights[i] * terms[i][j];
+    out[j] = value;
+  }
+
+  GF result(first);
+  if (useProjections) {
+    result.m_projections = sum;
+    result.m_coefficients.reset();
+    result.m_wasInitializedFromCoefficients = false;
+  } else {
+    result.m_coefficients = sum;
+    result.m_projections.reset();
+    result.m_dualSpace.reset();
+    result.m_wasInitializedFromCoefficients = true;
+  }
+  return result;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 GridFunction<BasisFunctionType, ResultType>
 operator+(const GridFunction<BasisFunctionType, ResultType> &g1,
           const GridFunction<BasisFunctionType, ResultType> &g2) {
   if (g1.space() != g2.space())
     throw std::runtime_error("GridFunction::operator+(): spaces don't match");
-  if (g1.wasInitializedFromCoefficients() ||
-      g2.wasInitializedFromCoefficients() || g1.dualSpace() != g2.dualSpace())
-    return GridFunction<BasisFunctionType, ResultType>(
-        g1.context(), // arbitrary choice...
-        g1.space(), g1.coefficients() + g2.coefficients());
-  else {
-    shared_ptr<const Space<BasisFunctionType>> dualSpace = g1.dualSpace();
-    return GridFunction<BasisFunctionType, ResultType>(
-        g1.context(), // arbitrary choice...
-        g1.space(), dualSpace,
-        g1.projections(dualSpace) + g2.projections(dualSpace));
-  }
+  std::vector<ResultType> weights(2, static_cast<ResultType>(1.));
+  std::vector<const GridFunction<BasisFunctionType, ResultType> *> functions;
+  functions.push_back(&g1);
+  functions.push_back(&g2);
+  return linearCombination(weights, functions);
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -1164,36 +1424,84 @@ operator-(const GridFunction<BasisFunctionType, ResultType> &g1,
           const GridFunction<BasisFunctionType, ResultType> &g2) {
   if (g1.space() != g2.space())
     throw std::runtime_error("GridFunction::operator-(): spaces don't match");
-  // For the sake of old-style code (with dualSpace stored in the GridFunction),
-  // we try to provide a sensible dual space to the composite GridFunction.
-  if (g1.wasInitializedFromCoefficients() ||
-      g2.wasInitializedFromCoefficients() || g1.dualSpace() != g2.dualSpace())
-    return GridFunction<BasisFunctionType, ResultType>(
-        g1.context(), // arbitrary choice...
-        g1.space(), g1.coefficients() - g2.coefficients());
-  else {
-    shared_ptr<const Space<BasisFunctionType>> dualSpace = g1.dualSpace();
-    return GridFunction<BasisFunctionType, ResultType>(
-        g1.context(), // arbitrary choice...
-        g1.space(), dualSpace,
-        g1.projections(dualSpace) - g2.projections(dualSpace));
-  }
+  std::vector<ResultType> weights(2, static_cast<ResultType>(1.));
+  weights[1] = static_cast<ResultType>(-1.);
+  std::vector<const GridFunction<BasisFunctionType, ResultType> *> functions;
+  functions.push_back(&g1);
+  functions.push_back(&g2);
+  return linearCombination(weights, functions);
 }
 
 template <typename BasisFunctionType, typename ResultType, typename ScalarType>
 GridFunction<BasisFunctionType, ResultType>
 operator*(const GridFunction<BasisFunctionType, ResultType> &g1,
           const ScalarType &scalar) {
-  if (g1.wasInitializedFromCoefficients())
-    return GridFunction<BasisFunctionType, ResultType>(
-        g1.context(), g1.space(),
-        static_cast<ResultType>(scalar) * g1.coefficients());
-  else {
-    shared_ptr<const Space<BasisFunctionType>> dualSpace = g1.dualSpace();
-    return GridFunction<BasisFunctionType, ResultType>(
-        g1.context(), g1.space(), dualSpace,
-        static_cast<ResultType>(scalar) * g1.projections(dualSpace));
+  return linearCombination(
+      std::vector<ResultType>(1, static_cast<ResultType>(scalar)),
+      std::vector<const GridFunction<BasisFunctionType, ResultType> *>(1,
+                                                                      &g1));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<GridFunction<BasisFunctionType, ResultType>> makeGridFunctions(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const std::vector<const Function<ResultType> *> &functions) {
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+  if (!context)
+    throw std::invalid_argument("makeGridFunctions(): "
+                                "context must not be null");
+  if (!space)
+    throw std::invalid_argument("makeGridFunctions(): "
+                                "space must not be null");
+  if (!dualSpace)
+    throw std::invalid_argument("makeGridFunctions(): "
+                                "dualSpace must not be null");
+  for (size_t i = 0; i < functions.size(); ++i)
+    if (!functions[i])
+      throw std::invalid_argument("makeGridFunctions(): "
+                                  "functions must not be null");
+
+  std::vector<GF> result;
+  result.reserve(functions.size());
+  // The constructor replaces barycentric spaces by their barycentric
+  // refinements; leave these cases to it
+  if (space->isBarycentric() || dualSpace->isBarycentric()) {
+    for (size_t i = 0; i < functions.size(); ++i)
+      result.push_back(GF(context, space, dualSpace, *functions[i]));
+    return result;
   }
+
+  if (space->grid() != dualSpace->grid())
+    throw std::invalid_argument(
+        "makeGridFunctions(): "
+        "space and dualSpace must be defined on the same grid");
+  for (size_t i = 0; i < functions.size(); ++i)
+    if (functions[i]->codomainDimension() != space->codomainDimension())
+      throw std::invalid_argument(
+          "makeGridFunctions(): "
+          "functions from 'space' have a different number of "
+          "components than one of 'functions'");
+
+  shared_ptr<arma::Mat<ResultType>> projections =
+      calculateProjections(*context, functions, *dualSpace);
+  for (size_t i = 0; i < functions.size(); ++i)
+    result.push_back(GF(context, space, dualSpace,
+                        arma::Col<ResultType>(projections->col(i))));
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType>
+projectFunctions(const Context<BasisFunctionType, ResultType> &context,
+                 const std::vector<const Function<ResultType> *> &functions,
+                 const Space<BasisFunctionType> &dualSpace) {
+  for (size_t i = 0; i < functions.size(); ++i)
+    if (!functions[i])
+      throw std::invalid_argument("projectFunctions(): "
+                                  "functions must not be null");
+  return *calculateProjections(context, functions, dualSpace);
 }
 
 BEMPP_GCC_DIAG_ON(deprecated - declarations);
@@ -1211,11 +1519,33 @@ FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(GridFunction);
   template GridFunction<BASIS, RESULT> operator-(                              \
       const GridFunction<BASIS, RESULT> &op1,                                  \
       const GridFunction<BASIS, RESULT> &op2);                                 \
+  template GridFunction<BASIS, RESULT> linearCombination(                      \
+      const std::vector<RESULT> &weights,                                      \
+      const std::vector<const GridFunction<BASIS, RESULT> *> &functions);      \
+  template std::vector<GridFunction<BASIS, RESULT>> makeGridFunctions(         \
+      const shared_ptr<const Context<BASIS, RESULT>> &context,                 \
+      const shared_ptr<const Space<BASIS>> &space,                             \
+      const shared_ptr<const Space<BASIS>> &dualSpace,                         \
+      const std::vector<const Function<RESULT> *> &functions);                 \
+  template arma::Mat<RESULT> projectFunctions(                                 \
+      const Context<BASIS, RESULT> &context,                                   \
+      const std::vector<const Function<RESULT> *> &functions,                  \
+      const Space<BASIS> &dualSpace);                                          \
   template void exportToVtk(const GridFunction<BASIS, RESULT> &gridFunction,   \
                             VtkWriter::DataType dataType,                      \
                             const char *dataLabel, const char *fileNamesBase,  \
                             const char *filesPath,                             \
-                            VtkWriter::OutputType outputType)
+                            VtkWriter::OutputType outputType);                 \
+  template void exportToVtu(                                                   \
+      const std::vector<const GridFunction<BASIS, RESULT> *> &gridFunctions,   \
+      VtkWriter::DataType dataType,                                            \
+      const std::vector<std::string> &dataLabels, const char *fileNamesBase,   \
+      const char *filesPath, VtuWriter::Encoding encoding, int pieceCount);    \
+  template void exportToVtu(const GridFunction<BASIS, RESULT> &gridFunction,   \
+                            VtkWriter::DataType dataType,                      \
+                            const char *dataLabel, const char *fileNamesBase,  \
+                            const char *filesPath,                             \
+                            VtuWriter::Encoding encoding, int pieceCount)
 #define INSTANTIATE_FREE_FUNCTIONS_WITH_SCALAR(BASIS, RESULT, SCALAR)          \
   template GridFunction<BASIS, RESULT> operator*(                              \
       const GridFunction<BASIS, RESULT> &op, const SCALAR &scalar);            \
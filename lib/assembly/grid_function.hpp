@@ -29,6 +29,7 @@
 #include "../common/types.hpp"
 
 #include "../grid/vtk_writer.hpp"
+#include "../grid/vtu_writer.hpp"
 #include "../fiber/quadrature_strategy.hpp"
 #include "../fiber/scalar_traits.hpp"
 
@@ -36,6 +37,7 @@
 #include <boost/mpl/has_key.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <memory>
+#include <vector>
 
 namespace Fiber {
 
@@ -322,9 +324,15 @@ public:
    *  \p dualSpace must be defined on the same grid as the space in which the
    *  GridFunction is expanded.
    *
+   *  The vector is calculated on the first call and stored; the returned
+   *  reference remains valid until the function is modified or its
+   *  projections on a different dual space are requested. Conversions
+   *  between coefficients and projections use the mass matrices cached in
+   *  the context (see Context::massMatrixCache()).
+   *
    *  An exception is thrown if this function is called on an uninitialized
    *  GridFunction object (one constructed with the default constructor). */
-  arma::Col<ResultType> projections(
+  const arma::Col<ResultType> &projections(
       const shared_ptr<const Space<BasisFunctionType>> &dualSpace_) const;
 
   /** \brief Reset the expansion coefficients of this function in the basis
@@ -344,6 +352,31 @@ public:
   setProjections(const shared_ptr<const Space<BasisFunctionType>> &dualSpace_,
                  const arma::Col<ResultType> &projects);
 
+  /** \brief Add \p alpha times \p other to this function in place.
+   *
+   *  The vector this function was initialized from (coefficients if
+   *  wasInitializedFromCoefficients() returns \c true, projections on the
+   *  stored dual space otherwise) is updated directly, in a single pass and
+   *  without temporaries; the other vector is recalculated on demand. Vectors
+   *  shared with copies of this function are copied before being modified.
+   *
+   *  \p other must be expanded in the same space as this function, otherwise
+   *  an exception is thrown. */
+  GridFunction &axpy(ResultType alpha, const GridFunction &other);
+
+  /** \brief Multiply this function by \p alpha in place.
+   *
+   *  Both the coefficients and the projections, if stored, are scaled, so
+   *  that no conversion between them is needed afterwards. */
+  GridFunction &scale(ResultType alpha);
+
+  /** \brief Equivalent to <tt>axpy(1, other)</tt>. */
+  GridFunction &operator+=(const GridFunction &other);
+  /** \brief Equivalent to <tt>axpy(-1, other)</tt>. */
+  GridFunction &operator-=(const GridFunction &other);
+  /** \brief Equivalent to <tt>scale(alpha)</tt>. */
+  GridFunction &operator*=(ResultType alpha);
+
   /** \brief Return the \f$L^2\f$-norm of the grid function.
    *
    *  \note For better accuracy, prefer to use L2NormOfDifference() or
@@ -529,6 +562,11 @@ private:
       const shared_ptr<const Space<BasisFunctionType>> &dualSpace_) const;
   void updateCoefficientsFromProjections() const;
 
+  template <typename B, typename R>
+  friend GridFunction<B, R>
+  linearCombination(const std::vector<R> &weights,
+                    const std::vector<const GridFunction<B, R> *> &functions);
+
 private:
   shared_ptr<const Context<BasisFunctionType, ResultType>> m_context;
   shared_ptr<const Space<BasisFunctionType>> m_space;
@@ -613,6 +651,60 @@ GridFunction<BasisFunctionType, ResultType>
 operator/(const GridFunction<BasisFunctionType, ResultType> &g1,
           const ScalarType &scalar);
 
+/** \relates GridFunction
+ *  \brief Return the grid function \f$\sum_i w_i f_i\f$, where \f$w_i\f$ =
+ *  \p weights[i] and \f$f_i\f$ = \p *functions[i].
+ *
+ *  The result is calculated in a single pass over the vectors of the
+ *  operands, without the temporaries an equivalent chain of operator+() and
+ *  operator*() calls would create. If none of the functions was initialized
+ *  from coefficients and all of them store projections on the same dual
+ *  space, the projections are combined and the result is initialized from
+ *  them; otherwise the coefficients are combined.
+ *
+ *  All the functions must be initialized and expanded in the same space, and
+ *  \p weights and \p functions must be nonempty and have the same length,
+ *  otherwise an exception is thrown. */
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType> linearCombination(
+    const std::vector<ResultType> &weights,
+    const std::vector<const GridFunction<BasisFunctionType, ResultType> *> &
+        functions);
+
+// Construction of several grid functions
+
+/** \relates GridFunction
+ *  \brief Approximate several functions by grid functions in one pass.
+ *
+ *  Equivalent to constructing <tt>GridFunction(context, space, dualSpace,
+ *  *functions[i], APPROXIMATE)</tt> for each \p i, but the
+ *  global DOF lists and the grid data of \p dualSpace are gathered once and
+ *  the projections of all the functions are calculated in a single
+ *  (parallel) loop over elements. Useful e.g. for sweeps over incident
+ *  fields.
+ *
+ *  The i'th returned grid function corresponds to \p functions[i]. */
+template <typename BasisFunctionType, typename ResultType>
+std::vector<GridFunction<BasisFunctionType, ResultType>> makeGridFunctions(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const std::vector<const Function<ResultType> *> &functions);
+
+/** \relates GridFunction
+ *  \brief Calculate the projections of several functions on the basis
+ *  functions of a space in one pass.
+ *
+ *  The i'th column of the returned matrix holds the scalar products of \p
+ *  *functions[i] and the basis functions of \p dualSpace. The integrals are
+ *  evaluated with the quadrature strategy of \p context, in a single
+ *  (parallel) loop over elements, as in makeGridFunctions(). */
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType>
+projectFunctions(const Context<BasisFunctionType, ResultType> &context,
+                 const std::vector<const Function<ResultType> *> &functions,
+                 const Space<BasisFunctionType> &dualSpace);
+
 // Export
 
 /** \relates GridFunction
@@ -645,6 +737,55 @@ exportToVtk(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
             const char *fileNamesBase, const char *filesPath = 0,
             VtkWriter::OutputType type = VtkWriter::ASCII);
 
+/** \relates GridFunction
+  \brief Export several functions to a VTU file with appended binary data.
+
+  Unlike exportToVtk(), this function writes all the functions in a single
+  pass with VtuWriter, without making real copies of their values.
+
+  \param[in] gridFunctions
+    Functions to export. They must be defined on the same grid.
+
+  \param[in] dataType
+    Determines whether data are attached to vertices or cells.
+
+  \param[in] dataLabels
+    Labels used to identify the functions in the VTU file.
+
+  \param[in] fileNamesBase
+    Base name of the output files. It should not contain any directory
+    part or filename extensions.
+
+  \param[in] filesPath
+    Output directory. Can be set to NULL, in which case the files are
+    output in the current directory.
+
+  \param[in] encoding
+    How the data arrays are stored.
+
+  \param[in] pieceCount
+    Number of pieces written in parallel (see VtuWriter::write()). */
+template <typename BasisFunctionType, typename ResultType>
+void exportToVtu(
+    const std::vector<const GridFunction<BasisFunctionType, ResultType> *> &
+        gridFunctions,
+    VtkWriter::DataType dataType, const std::vector<std::string> &dataLabels,
+    const char *fileNamesBase, const char *filesPath = 0,
+    VtuWriter::Encoding encoding = VtuWriter::APPENDED_RAW,
+    int pieceCount = 1);
+
+/** \relates GridFunction
+  \brief Export a function to a VTU file with appended binary data.
+
+  See the overload taking a vector of functions for details. */
+template <typename BasisFunctionType, typename ResultType>
+void
+exportToVtu(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+            VtkWriter::DataType dataType, const char *dataLabel,
+            const char *fileNamesBase, const char *filesPath = 0,
+            VtuWriter::Encoding encoding = VtuWriter::APPENDED_RAW,
+            int pieceCount = 1);
+
 ///** \relates GridFunction
 //  \brief Export this function to a Gmsh (.msh) file.
 
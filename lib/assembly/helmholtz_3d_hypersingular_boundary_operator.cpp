@@ -71,6 +71,31 @@ helmholtz3dHypersingularBoundaryOperator(
       useInterpolation, interpPtsPerWavelength);
 }
 
+template <typename BasisFunctionType>
+void helmholtz3dSingleLayerAndHypersingularBoundaryOperators(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    typename ScalarTraits<BasisFunctionType>::ComplexType waveNumber,
+    BoundaryOperator<BasisFunctionType,
+                     typename ScalarTraits<BasisFunctionType>::ComplexType> &
+        slp,
+    BoundaryOperator<BasisFunctionType,
+                     typename ScalarTraits<BasisFunctionType>::ComplexType> &
+        hypersingular,
+    const std::string &label, int symmetry, bool useInterpolation,
+    int interpPtsPerWavelength) {
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType ComplexType;
+  modifiedHelmholtz3dSingleLayerAndHypersingularBoundaryOperators<
+      BasisFunctionType, ComplexType, ComplexType>(
+      context, domain, range, dualToRange, waveNumber / ComplexType(0., 1.),
+      slp, hypersingular, label, symmetry, useInterpolation,
+      interpPtsPerWavelength);
+}
+
 #define INSTANTIATE_NONMEMBER_CONSTRUCTOR(BASIS)                               \
   template BoundaryOperator<BASIS, ScalarTraits<BASIS>::ComplexType>           \
   helmholtz3dHypersingularBoundaryOperator(                                    \
@@ -86,7 +111,17 @@ helmholtz3dHypersingularBoundaryOperator(
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
-      ScalarTraits<BASIS>::ComplexType, const std::string &, int, bool, int)
+      ScalarTraits<BASIS>::ComplexType, const std::string &, int, bool, int); \
+  template void helmholtz3dSingleLayerAndHypersingularBoundaryOperators(       \
+      const shared_ptr<                                                        \
+          const Context<BASIS, ScalarTraits<BASIS>::ComplexType>> &,           \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      ScalarTraits<BASIS>::ComplexType,                                        \
+      BoundaryOperator<BASIS, ScalarTraits<BASIS>::ComplexType> &,             \
+      BoundaryOperator<BASIS, ScalarTraits<BASIS>::ComplexType> &,             \
+      const std::string &, int, bool, int)
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_NONMEMBER_CONSTRUCTOR);
 
 } // namespace Bempp
@@ -140,6 +140,32 @@ helmholtz3dHypersingularBoundaryOperator(
     bool useInterpolation = false,
     int interpPtsPerWavelength = DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY);
 
+/** \ingroup helmholtz_3d
+ *  \brief Construct the single-layer and hypersingular operators associated
+ *  with the Helmholtz equation in 3D, sharing a single evaluation of the
+ *  kernel.
+ *
+ *  See modifiedHelmholtz3dSingleLayerAndHypersingularBoundaryOperators() for
+ *  a description of the construction and the parameters. */
+template <typename BasisFunctionType>
+void helmholtz3dSingleLayerAndHypersingularBoundaryOperators(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    typename ScalarTraits<BasisFunctionType>::ComplexType waveNumber,
+    BoundaryOperator<BasisFunctionType,
+                     typename ScalarTraits<BasisFunctionType>::ComplexType> &
+        slp,
+    BoundaryOperator<BasisFunctionType,
+                     typename ScalarTraits<BasisFunctionType>::ComplexType> &
+        hypersingular,
+    const std::string &label = "", int symmetry = NO_SYMMETRY,
+    bool useInterpolation = false,
+    int interpPtsPerWavelength = DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY);
+
 } // namespace Bempp
 
 #endif
@@ -24,6 +24,8 @@
 
 #include "../fiber/explicit_instantiation.hpp"
 #include "context.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "elementary_integral_operator_base.hpp"
 
 namespace Bempp {
 
@@ -70,6 +72,50 @@ helmholtz3dSingleLayerBoundaryOperator(
       useInterpolation, interpPtsPerWavelength);
 }
 
+template <typename BasisFunctionType>
+std::vector<shared_ptr<const DiscreteBoundaryOperator<
+    typename ScalarTraits<BasisFunctionType>::ComplexType>>>
+helmholtz3dSingleLayerBoundaryOperatorWeakForms(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    const std::vector<typename ScalarTraits<BasisFunctionType>::ComplexType> &
+        waveNumbers,
+    const std::string &label, int symmetry, bool useInterpolation,
+    int interpPtsPerWavelength) {
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType ComplexType;
+  typedef ElementaryIntegralOperatorBase<BasisFunctionType, ComplexType>
+  ElementaryOp;
+
+  std::vector<BoundaryOperator<BasisFunctionType, ComplexType>> ops;
+  std::vector<const ElementaryOp *> elementaryOps;
+  bool allElementary = true;
+  for (size_t i = 0; i < waveNumbers.size(); ++i) {
+    ops.push_back(helmholtz3dSingleLayerBoundaryOperator(
+        context, domain, range, dualToRange, waveNumbers[i], label, symmetry,
+        useInterpolation, interpPtsPerWavelength));
+    const ElementaryOp *op =
+        dynamic_cast<const ElementaryOp *>(ops.back().abstractOperator().get());
+    allElementary = allElementary && op;
+    elementaryOps.push_back(op);
+  }
+
+  std::vector<shared_ptr<const DiscreteBoundaryOperator<ComplexType>>> result;
+  if (allElementary) {
+    std::vector<shared_ptr<DiscreteBoundaryOperator<ComplexType>>> weakForms =
+        ElementaryOp::assembleWeakForms(elementaryOps, *context);
+    result.assign(weakForms.begin(), weakForms.end());
+  } else {
+    // Synthetic operators (local-mode ACA) are assembled one by one
+    for (size_t i = 0; i < ops.size(); ++i)
+      result.push_back(ops[i].weakForm());
+  }
+  return result;
+}
+
 #define INSTANTIATE_NONMEMBER_CONSTRUCTOR(BASIS)                               \
   template BoundaryOperator<BASIS, ScalarTraits<BASIS>::ComplexType>           \
   helmholtz3dSingleLayerBoundaryOperator(                                      \
@@ -85,7 +131,17 @@ helmholtz3dSingleLayerBoundaryOperator(
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
-      ScalarTraits<BASIS>::ComplexType, const std::string &, int, bool, int)
+      ScalarTraits<BASIS>::ComplexType, const std::string &, int, bool, int);  \
+  template std::vector<shared_ptr<                                             \
+      const DiscreteBoundaryOperator<ScalarTraits<BASIS>::ComplexType>>>       \
+  helmholtz3dSingleLayerBoundaryOperatorWeakForms(                             \
+      const shared_ptr<                                                        \
+          const Context<BASIS, ScalarTraits<BASIS>::ComplexType>> &,           \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const std::vector<ScalarTraits<BASIS>::ComplexType> &,                   \
+      const std::string &, int, bool, int)
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_NONMEMBER_CONSTRUCTOR);
 
 } // namespace Bempp
@@ -28,6 +28,8 @@
 
 #include "../common/scalar_traits.hpp"
 
+#include <vector>
+
 namespace Bempp {
 
 /** \ingroup helmholtz_3d
@@ -121,6 +123,37 @@ helmholtz3dSingleLayerBoundaryOperator(
     bool useInterpolation = false,
     int interpPtsPerWavelength = DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY);
 
+/** \ingroup helmholtz_3d
+ *  \brief Assemble the weak forms of the single-layer boundary operator
+ *  associated with the Helmholtz equation in 3D at several wave numbers.
+ *
+ *  This function is intended for frequency sweeps. It is equivalent to
+ *  calling helmholtz3dSingleLayerBoundaryOperator() for each element of \p
+ *  waveNumbers and retrieving the weak forms of the resulting operators,
+ *  but the grid geometry, shapesets and (in H-matrix mode) block cluster
+ *  tree are built only once, and in dense mode all the weak forms are
+ *  assembled in a single pass over the element pairs. See
+ *  ElementaryIntegralOperatorBase::assembleWeakForms() for details.
+ *
+ *  The i'th returned operator is the weak form at \p waveNumbers[i]. The
+ *  remaining parameters have the same meaning as in
+ *  helmholtz3dSingleLayerBoundaryOperator(). */
+template <typename BasisFunctionType>
+std::vector<shared_ptr<const DiscreteBoundaryOperator<
+    typename ScalarTraits<BasisFunctionType>::ComplexType>>>
+helmholtz3dSingleLayerBoundaryOperatorWeakForms(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    const std::vector<typename ScalarTraits<BasisFunctionType>::ComplexType> &
+        waveNumbers,
+    const std::string &label = "", int symmetry = NO_SYMMETRY,
+    bool useInterpolation = false,
+    int interpPtsPerWavelength = DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY);
+
 } // namespace Bempp
 
 #endif
@@ -0,0 +1,190 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hmat_approximate_lu_inverse.hpp"
+#include "discrete_hmat_boundary_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include <boost/numeric/conversion/converter.hpp>
+#include <tbb/tick_count.h>
+#include <iostream>
+
+namespace Bempp {
+
+template <typename ValueType>
+HMatApproximateLuInverse<ValueType>::HMatApproximateLuInverse(
+    const DiscreteHMatBoundaryOperator<ValueType> &fwdOp, double eps,
+    bool symmetric, int maxThreadCount, VerbosityLevel::Level verbosityLevel)
+    : m_hMatDofOrdering(fwdOp.hMatDofOrdering()),
+      // All range-domain swaps intended!
+      m_domainSpace(
+          Thyra::defaultSpmdVectorSpace<ValueType>(fwdOp.rowCount())),
+      m_rangeSpace(
+          Thyra::defaultSpmdVectorSpace<ValueType>(fwdOp.columnCount())) {
+
+  const bool verbosityAtLeastDefault =
+      (verbosityLevel >= VerbosityLevel::DEFAULT);
+  if (verbosityAtLeastDefault)
+    std::cout << "Starting H-" << (symmetric ? "Cholesky" : "LU")
+              << " decomposition..." << std::endl;
+  tbb::tick_count start = tbb::tick_count::now();
+  m_decomposition.reset(new hmat::HMatrixLuDecomposition<ValueType, 2>(
+      *fwdOp.hMatrix(), eps, symmetric, maxThreadCount));
+  tbb::tick_count end = tbb::tick_count::now();
+
+  if (verbosityAtLeastDefault) {
+    double origMemory = sizeof(ValueType) * fwdOp.rowCount() *
+                        static_cast<double>(fwdOp.columnCount()) / 1024.;
+    double memory = m_decomposition->memSizeKb();
+    std::cout << "H-" << (symmetric ? "Cholesky" : "LU")
+              << " decomposition took " << (end - start).seconds() << " s"
+              << std::endl;
+    std::cout << "\nNeeded storage: " << memory / 1024. << " MB.\n"
+              << "Without approximation: " << origMemory / 1024. << " MB.\n"
+              << "Compressed to " << (100. * memory) / origMemory << "%.\n"
+              << std::endl;
+  }
+}
+
+template <typename ValueType>
+unsigned int HMatApproximateLuInverse<ValueType>::rowCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_decomposition->columns());
+}
+
+template <typename ValueType>
+unsigned int HMatApproximateLuInverse<ValueType>::columnCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_decomposition->rows());
+}
+
+template <typename ValueType>
+void HMatApproximateLuInverse<ValueType>::addBlock(
+    const std::vector<int> &rows, const std::vector<int> &cols,
+    const ValueType alpha, arma::Mat<ValueType> &block) const {
+  throw std::runtime_error("HMatApproximateLuInverse::addBlock(): "
+                           "not implemented");
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+HMatApproximateLuInverse<ValueType>::domain() const {
+  return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+HMatApproximateLuInverse<ValueType>::range() const {
+  return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool HMatApproximateLuInverse<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJTRANS);
+}
+
+template <typename ValueType>
+void HMatApproximateLuInverse<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void HMatApproximateLuInverse<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+
+  if (columnCount() != x_in.n_rows || rowCount() != y_inout.n_rows)
+    throw std::invalid_argument(
+        "HMatApproximateLuInverse::applyBuiltInBlockImpl(): "
+        "incorrect vector length");
+
+  hmat::TransposeMode hmatTrans;
+  if (trans == TranspositionMode::NO_TRANSPOSE)
+    hmatTrans = hmat::NOTRANS;
+  else if (trans == TranspositionMode::TRANSPOSE)
+    hmatTrans = hmat::TRANS;
+  else if (trans == TranspositionMode::CONJUGATE)
+    hmatTrans = hmat::CONJ;
+  else
+    hmatTrans = hmat::CONJTRANS;
+
+  arma::Mat<ValueType> solution;
+  if (m_hMatDofOrdering) {
+    solution = x_in;
+    m_decomposition->solvePermuted(solution, hmatTrans);
+  } else
+    m_decomposition->solve(x_in, solution, hmatTrans);
+
+  if (beta == static_cast<ValueType>(0.))
+    y_inout = alpha * solution;
+  else
+    y_inout = alpha * solution + beta * y_inout;
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>>
+hMatOperatorApproximateLuInverse(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op,
+    double eps, bool symmetric) {
+  shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>> hMatOp =
+      boost::dynamic_pointer_cast<const DiscreteHMatBoundaryOperator<ValueType>>(
+          op);
+  if (!hMatOp)
+    throw std::invalid_argument("hMatOperatorApproximateLuInverse(): "
+                                "operator is not stored as a H-matrix");
+  shared_ptr<const DiscreteBoundaryOperator<ValueType>> result(
+      new HMatApproximateLuInverse<ValueType>(*hMatOp, eps, symmetric));
+  return result;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(HMatApproximateLuInverse);
+
+#define INSTANTIATE_FREE_FUNCTIONS(RESULT)                                     \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  hMatOperatorApproximateLuInverse(                                            \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op,            \
+      double eps, bool symmetric)
+
+#if defined(ENABLE_SINGLE_PRECISION)
+INSTANTIATE_FREE_FUNCTIONS(float);
+#endif
+
+#if defined(ENABLE_SINGLE_PRECISION) &&                                        \
+    (defined(ENABLE_COMPLEX_BASIS_FUNCTIONS) ||                                \
+     defined(ENABLE_COMPLEX_KERNELS))
+INSTANTIATE_FREE_FUNCTIONS(std::complex<float>);
+#endif
+
+#if defined(ENABLE_DOUBLE_PRECISION)
+INSTANTIATE_FREE_FUNCTIONS(double);
+#endif
+
+#if defined(ENABLE_DOUBLE_PRECISION) &&                                        \
+    (defined(ENABLE_COMPLEX_BASIS_FUNCTIONS) ||                                \
+     defined(ENABLE_COMPLEX_KERNELS))
+INSTANTIATE_FREE_FUNCTIONS(std::complex<double>);
+#endif
+
+} // namespace Bempp
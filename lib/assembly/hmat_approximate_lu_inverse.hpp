@@ -0,0 +1,118 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_hmat_approximate_lu_inverse_hpp
+#define bempp_hmat_approximate_lu_inverse_hpp
+
+#include "bempp/common/config_trilinos.hpp"
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/verbosity_level.hpp"
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#include "../hmat/hmatrix_lu_decomposition.hpp"
+
+using Fiber::VerbosityLevel;
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteHMatBoundaryOperator;
+/** \endcond */
+
+/** \ingroup composite_discrete_operators
+ *  \brief Approximate inverse of an operator stored as a native H-matrix.
+ *
+ *  The inverse is represented by a hierarchical LU decomposition, or by a
+ *  hierarchical Cholesky decomposition if the operator is Hermitian positive
+ *  definite. With a small \p eps the operator can be used as a direct
+ *  solver, with a coarse one (e.g. 0.1) as a preconditioner, for instance
+ *  through discreteOperatorToPreconditioner(). */
+template <typename ValueType>
+class HMatApproximateLuInverse : public DiscreteBoundaryOperator<ValueType> {
+public:
+  /** \brief Constructor.
+
+  \param[in] fwdOp  Operator to invert. Its test and trial spaces must be
+                    equal.
+  \param[in] eps    Relative accuracy of the low-rank truncations done
+                    during the factorization.
+  \param[in] symmetric  If true, compute a Cholesky decomposition. The
+                    operator must then be Hermitian positive definite.
+  \param[in] maxThreadCount  Maximum number of threads used for the
+                    factorization, or -1 to choose it automatically. */
+  HMatApproximateLuInverse(const DiscreteHMatBoundaryOperator<ValueType> &fwdOp,
+                           double eps, bool symmetric = false,
+                           int maxThreadCount = -1,
+                           VerbosityLevel::Level verbosityLevel =
+                               VerbosityLevel::DEFAULT);
+
+  unsigned int rowCount() const override;
+  unsigned int columnCount() const override;
+
+  void addBlock(const std::vector<int> &rows, const std::vector<int> &cols,
+                const ValueType alpha, arma::Mat<ValueType> &block) const
+      override;
+
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+
+private:
+  void applyBuiltInImpl(const TranspositionMode trans,
+                        const arma::Col<ValueType> &x_in,
+                        arma::Col<ValueType> &y_inout, const ValueType alpha,
+                        const ValueType beta) const override;
+
+  void applyBuiltInBlockImpl(const TranspositionMode trans,
+                             const arma::Mat<ValueType> &x_in,
+                             arma::Mat<ValueType> &y_inout,
+                             const ValueType alpha,
+                             const ValueType beta) const override;
+
+  shared_ptr<hmat::HMatrixLuDecomposition<ValueType, 2>> m_decomposition;
+  bool m_hMatDofOrdering;
+
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
+};
+
+/** \relates HMatApproximateLuInverse
+ *  \brief Approximate inverse of a discrete boundary operator stored as a
+ *  native H-matrix.
+ *
+ *  \param[in] op Operator of type DiscreteHMatBoundaryOperator.
+ *  \param[in] eps Relative accuracy of the low-rank truncations.
+ *  \param[in] symmetric If true, use a Cholesky instead of an LU
+ *  decomposition.
+ *
+ *  \return A shared pointer to a newly allocated HMatApproximateLuInverse. */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>>
+hMatOperatorApproximateLuInverse(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op,
+    double eps, bool symmetric = false);
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,239 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hmat_block_cluster_tree_cache.hpp"
+
+#include "local_dof_lists_cache.hpp"
+#include "../common/bounding_box.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/scalar_traits.hpp"
+#include "../space/space.hpp"
+
+#include "../hmat/cluster_tree.hpp"
+#include "../hmat/geometry.hpp"
+#include "../hmat/geometry_data_type.hpp"
+#include "../hmat/geometry_interface.hpp"
+
+#include <boost/functional/hash.hpp>
+
+namespace Bempp {
+
+namespace {
+
+template <typename BasisFunctionType>
+class SpaceHMatGeometryInterface : public hmat::GeometryInterface {
+
+public:
+  typedef typename Fiber::ScalarTraits<BasisFunctionType>::RealType
+  CoordinateType;
+  SpaceHMatGeometryInterface(const Space<BasisFunctionType> &space)
+      : m_bemppBoundingBoxes(space.globalDofBoundingBoxes()), m_counter(0) {}
+  shared_ptr<const hmat::GeometryDataType> next() override {
+
+    if (m_counter == m_bemppBoundingBoxes.size())
+      return shared_ptr<hmat::GeometryDataType>();
+
+    auto lbound = m_bemppBoundingBoxes[m_counter].lbound;
+    auto ubound = m_bemppBoundingBoxes[m_counter].ubound;
+    auto center = m_bemppBoundingBoxes[m_counter].reference;
+    m_counter++;
+    return shared_ptr<hmat::GeometryDataType>(new hmat::GeometryDataType(
+        hmat::BoundingBox(lbound.x, ubound.x, lbound.y, ubound.y, lbound.z,
+                          ubound.z),
+        std::array<double, 3>({{center.x, center.y, center.z}})));
+  }
+
+  std::size_t numberOfEntities() const override {
+    return m_bemppBoundingBoxes.size();
+  }
+  void reset() override { m_counter = 0; }
+
+  void fill(std::vector<hmat::GeometryDataType> &geometry) override {
+    geometry.clear();
+    geometry.reserve(m_bemppBoundingBoxes.size());
+    for (const auto &box : m_bemppBoundingBoxes)
+      geometry.push_back(hmat::GeometryDataType(
+          hmat::BoundingBox(box.lbound.x, box.ubound.x, box.lbound.y,
+                            box.ubound.y, box.lbound.z, box.ubound.z),
+          std::array<double, 3>(
+              {{box.reference.x, box.reference.y, box.reference.z}})));
+  }
+
+private:
+  const std::vector<BoundingBox<CoordinateType>> &m_bemppBoundingBoxes;
+  std::size_t m_counter;
+};
+
+template <typename BasisFunctionType>
+void spaceGeometry(const Space<BasisFunctionType> &space,
+                   hmat::FlatGeometry &geometry) {
+  SpaceHMatGeometryInterface<BasisFunctionType> geometryInterface(space);
+  hmat::fillGeometry(geometry, geometryInterface);
+}
+
+std::size_t geometryHash(const hmat::FlatGeometry &geometry) {
+  std::size_t seed = geometry.size();
+  for (const auto &geometryData : geometry) {
+    for (double value : geometryData.center)
+      boost::hash_combine(seed, value);
+    for (double value : geometryData.boundingBox.bounds())
+      boost::hash_combine(seed, value);
+  }
+  return seed;
+}
+
+template <typename BasisFunctionType>
+typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry
+buildEntry(const Space<BasisFunctionType> &testSpace,
+           const Space<BasisFunctionType> &trialSpace,
+           const hmat::FlatGeometry &testGeometry,
+           const hmat::FlatGeometry &trialGeometry, int minBlockSize,
+           int maxBlockSize, double eta, double waveNumber,
+           double highFrequencyEta, bool weakAdmissibility) {
+
+  auto testClusterTree = shared_ptr<hmat::DefaultClusterTreeType>(
+      new hmat::DefaultClusterTreeType(testGeometry, minBlockSize));
+
+  auto trialClusterTree = shared_ptr<hmat::DefaultClusterTreeType>(
+      new hmat::DefaultClusterTreeType(trialGeometry, minBlockSize));
+
+  typedef HMatBlockClusterTreeCache<BasisFunctionType> Cache;
+  typename Cache::Entry entry;
+  entry.blockClusterTree.reset(new hmat::DefaultBlockClusterTreeType(
+      testClusterTree, trialClusterTree, maxBlockSize,
+      Cache::admissibilityFunction(eta, waveNumber, highFrequencyEta,
+                                   weakAdmissibility)));
+  entry.testDofListsCache.reset(new LocalDofListsCache<BasisFunctionType>(
+      testSpace, testClusterTree->hMatDofToOriginalDofMap(), true));
+  entry.trialDofListsCache.reset(new LocalDofListsCache<BasisFunctionType>(
+      trialSpace, trialClusterTree->hMatDofToOriginalDofMap(), true));
+  entry.acaPivots.reset(new typename Cache::AcaPivots);
+  return entry;
+}
+
+} // end anonymous namespace
+
+template <typename BasisFunctionType>
+typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry
+HMatBlockClusterTreeCache<BasisFunctionType>::get(
+    const Space<BasisFunctionType> &testSpace,
+    const Space<BasisFunctionType> &trialSpace, int minBlockSize,
+    int maxBlockSize, double eta, double waveNumber, double highFrequencyEta,
+    bool weakAdmissibility) {
+
+  hmat::FlatGeometry testGeometry;
+  hmat::FlatGeometry trialGeometry;
+  spaceGeometry(testSpace, testGeometry);
+  spaceGeometry(trialSpace, trialGeometry);
+  std::size_t testGeometryHash = geometryHash(testGeometry);
+  std::size_t trialGeometryHash = geometryHash(trialGeometry);
+
+  // The wave number only matters if the high-frequency condition is used
+  // and none of the geometric parameters if the weak condition is used
+  if (highFrequencyEta <= 0 || weakAdmissibility)
+    waveNumber = 0;
+  if (weakAdmissibility)
+    eta = highFrequencyEta = 0;
+  Key key(&testSpace, &trialSpace, minBlockSize, maxBlockSize, eta,
+          waveNumber, highFrequencyEta, weakAdmissibility);
+
+  // Only the look-up is done under the cache-wide lock. The tree is built
+  // under the lock of its slot, so that operators assembled concurrently on
+  // the same spaces wait for one tree instead of each building their own,
+  // while trees for other spaces are built at the same time.
+  shared_ptr<Slot> slot;
+  {
+    tbb::mutex::scoped_lock lock(m_mutex);
+    shared_ptr<Slot> &entrySlot = m_entries[key];
+    if (!entrySlot)
+      entrySlot.reset(new Slot);
+    slot = entrySlot;
+  }
+
+  tbb::mutex::scoped_lock slotLock(slot->mutex);
+  if (slot->built && slot->testGeometryHash == testGeometryHash &&
+      slot->trialGeometryHash == trialGeometryHash)
+    return slot->entry;
+
+  slot->entry = buildEntry(testSpace, trialSpace, testGeometry, trialGeometry,
+                           minBlockSize, maxBlockSize, eta, waveNumber,
+                           highFrequencyEta, weakAdmissibility);
+  slot->testGeometryHash = testGeometryHash;
+  slot->trialGeometryHash = trialGeometryHash;
+  slot->built = true;
+  return slot->entry;
+}
+
+template <typename BasisFunctionType>
+typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry
+HMatBlockClusterTreeCache<BasisFunctionType>::build(
+    const Space<BasisFunctionType> &testSpace,
+    const Space<BasisFunctionType> &trialSpace, int minBlockSize,
+    int maxBlockSize, double eta, double waveNumber, double highFrequencyEta,
+    bool weakAdmissibility) {
+
+  hmat::FlatGeometry testGeometry;
+  hmat::FlatGeometry trialGeometry;
+  spaceGeometry(testSpace, testGeometry);
+  spaceGeometry(trialSpace, trialGeometry);
+  return buildEntry(testSpace, trialSpace, testGeometry, trialGeometry,
+                    minBlockSize, maxBlockSize, eta, waveNumber,
+                    highFrequencyEta, weakAdmissibility);
+}
+
+template <typename BasisFunctionType>
+hmat::AdmissibilityFunction
+HMatBlockClusterTreeCache<BasisFunctionType>::admissibilityFunction(
+    double eta, double waveNumber, double highFrequencyEta,
+    bool weakAdmissibility) {
+  if (weakAdmissibility)
+    return hmat::WeakAdmissibility();
+  if (waveNumber > 0 && highFrequencyEta > 0)
+    return hmat::HighFrequencyAdmissibility(eta, waveNumber,
+                                            highFrequencyEta);
+  return hmat::StandardAdmissibility(eta);
+}
+
+template <typename BasisFunctionType>
+shared_ptr<hmat::DefaultClusterTreeType>
+HMatBlockClusterTreeCache<BasisFunctionType>::buildClusterTree(
+    const Space<BasisFunctionType> &space, int minBlockSize) {
+
+  hmat::FlatGeometry geometry;
+  spaceGeometry(space, geometry);
+  return shared_ptr<hmat::DefaultClusterTreeType>(
+      new hmat::DefaultClusterTreeType(geometry, minBlockSize));
+}
+
+template <typename BasisFunctionType>
+void HMatBlockClusterTreeCache<BasisFunctionType>::clear() {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  m_entries.clear();
+}
+
+template <typename BasisFunctionType>
+std::size_t HMatBlockClusterTreeCache<BasisFunctionType>::size() const {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  return m_entries.size();
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(HMatBlockClusterTreeCache);
+
+} // namespace Bempp
@@ -0,0 +1,143 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_hmat_block_cluster_tree_cache_hpp
+#define bempp_hmat_block_cluster_tree_cache_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../hmat/aca_pivot_table.hpp"
+#include "../hmat/block_cluster_tree.hpp"
+
+#include <tbb/mutex.h>
+#include <map>
+#include <tuple>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType> class LocalDofListsCache;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Cache of block cluster trees used by HMatGlobalAssembler.
+ *
+ *  Operators assembled on the same pair of spaces with the same
+ *  minBlockSize, maxBlockSize and admissibility parameters share one block
+ *  cluster tree and the LocalDofListsCache objects built from its DOF
+ *  permutations. Entries are keyed by the addresses of the spaces; a hash
+ *  of the DOF geometry is
+ *  stored with each entry, so that a tree is rebuilt if a different space
+ *  ends up at the same address.
+ *
+ *  Every Context owns one cache, which is shared by its copies. */
+template <typename BasisFunctionType> class HMatBlockClusterTreeCache {
+public:
+  /** \brief Pivots of the latest ACA compression on the tree of an entry,
+   *  used to warm-start the next one (see the "acaWarmStart" parameter). */
+  class AcaPivots {
+  public:
+    shared_ptr<const hmat::AcaPivotTable> get() const {
+      tbb::mutex::scoped_lock lock(m_mutex);
+      return m_pivots;
+    }
+    void set(const shared_ptr<const hmat::AcaPivotTable> &pivots) {
+      tbb::mutex::scoped_lock lock(m_mutex);
+      m_pivots = pivots;
+    }
+
+  private:
+    mutable tbb::mutex m_mutex;
+    shared_ptr<const hmat::AcaPivotTable> m_pivots;
+  };
+
+  struct Entry {
+    shared_ptr<hmat::DefaultBlockClusterTreeType> blockClusterTree;
+    shared_ptr<LocalDofListsCache<BasisFunctionType>> testDofListsCache;
+    shared_ptr<LocalDofListsCache<BasisFunctionType>> trialDofListsCache;
+    shared_ptr<AcaPivots> acaPivots;
+  };
+
+  /** \brief Return the block cluster tree for the given spaces and
+   *  parameters, building it if it is not in the cache yet.
+   *
+   *  The spaces must use global DOF indexing, i.e. be the spaces whose
+   *  DOFs index the H-matrix. If \p waveNumber and \p highFrequencyEta
+   *  are positive, hmat::HighFrequencyAdmissibility is used instead of
+   *  hmat::StandardAdmissibility. If \p weakAdmissibility is true,
+   *  hmat::WeakAdmissibility is used and the other admissibility
+   *  parameters are ignored. */
+  Entry get(const Space<BasisFunctionType> &testSpace,
+            const Space<BasisFunctionType> &trialSpace, int minBlockSize,
+            int maxBlockSize, double eta, double waveNumber = 0.,
+            double highFrequencyEta = 0., bool weakAdmissibility = false);
+
+  /** \brief Build a block cluster tree without consulting the cache. */
+  static Entry build(const Space<BasisFunctionType> &testSpace,
+                     const Space<BasisFunctionType> &trialSpace,
+                     int minBlockSize, int maxBlockSize, double eta,
+                     double waveNumber = 0., double highFrequencyEta = 0.,
+                     bool weakAdmissibility = false);
+
+  /** \brief Return the admissibility condition used by get() and build()
+   *  for the given parameters. */
+  static hmat::AdmissibilityFunction
+  admissibilityFunction(double eta, double waveNumber = 0.,
+                        double highFrequencyEta = 0.,
+                        bool weakAdmissibility = false);
+
+  /** \brief Build the cluster tree of the global DOFs of a single space.
+   *
+   *  Used for operators whose other dimension is not given by a space,
+   *  such as potential operators. */
+  static shared_ptr<hmat::DefaultClusterTreeType>
+  buildClusterTree(const Space<BasisFunctionType> &space, int minBlockSize);
+
+  /** \brief Remove all entries. */
+  void clear();
+
+  /** \brief Return the number of entries, including those still being
+   *  built. */
+  std::size_t size() const;
+
+private:
+  /** \cond PRIVATE */
+  typedef std::tuple<const void *, const void *, int, int, double, double,
+                     double, bool> Key;
+  // Inserted before its entry is built; threads asking for the same key
+  // wait on its mutex, threads asking for other keys do not
+  struct Slot {
+    Slot() : built(false) {}
+    tbb::mutex mutex; // held while the entry is built
+    bool built;
+    std::size_t testGeometryHash;
+    std::size_t trialGeometryHash;
+    Entry entry;
+  };
+
+  std::map<Key, shared_ptr<Slot>> m_entries;
+  mutable tbb::mutex m_mutex; // guards m_entries only
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -19,17 +19,28 @@
 // THE SOFTWARE.
 
 #include "bempp/common/config_ahmed.hpp"
+#include "bempp/common/config_mpi.hpp"
 #include "bempp/common/config_trilinos.hpp"
 
 #include "hmat_global_assembler.hpp"
 
 #include "assembly_options.hpp"
+#include "assembly_report.hpp"
 #include "context.hpp"
 #include "evaluation_options.hpp"
+#include "hmat_options.hpp"
 #include "discrete_boundary_operator_composition.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
 #include "weak_form_hmat_assembly_helper.hpp"
+#include "potential_operator_hmat_assembly_helper.hpp"
 #include "discrete_hmat_boundary_operator.hpp"
+#include "discrete_h2mat_boundary_operator.hpp"
+#include "discrete_distributed_hmat_boundary_operator.hpp"
+#include "fmm_far_field.hpp"
+#include "hmat_block_cluster_tree_cache.hpp"
+#include "interpolant_moments_assembler.hpp"
+#include "local_dof_lists_cache.hpp"
+#include "symmetry.hpp"
 
 #include "../common/armadillo_fwd.hpp"
 #include "../common/auto_timer.hpp"
@@ -37,29 +48,48 @@
 #include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
+#include "../fiber/local_assembler_for_potential_operators.hpp"
+#include "../fiber/profiler.hpp"
 #include "../fiber/scalar_traits.hpp"
+#include "../fiber/serial_blas_region.hpp"
 #include "../fiber/shared_ptr.hpp"
+#include "../fiber/task_arena_cache.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/grid_view.hpp"
+#include "../grid/mapper.hpp"
 #include "../space/space.hpp"
-#include "../common/bounding_box.hpp"
 
+#include "../hmat/aca_pivot_table.hpp"
 #include "../hmat/block_cluster_tree.hpp"
-#include "../hmat/geometry_interface.hpp"
-#include "../hmat/geometry_data_type.hpp"
+#include "../hmat/cluster_tree.hpp"
 #include "../hmat/geometry.hpp"
+#include "../hmat/geometry_data_type.hpp"
 #include "../hmat/hmatrix.hpp"
+#include "../hmat/h2matrix.hpp"
+#include "../hmat/hmatrix_checkpoint.hpp"
+#include "../hmat/leaf_partition.hpp"
 #include "../hmat/data_accessor.hpp"
 #include "../hmat/hmatrix_dense_compressor.hpp"
 #include "../hmat/hmatrix_aca_compressor.hpp"
+#include "../hmat/hmatrix_interpolation_compressor.hpp"
+#include "../hmat/interpolation_data_accessor.hpp"
+#include "../hmat/hmatrix_dense_data.hpp"
+#include "../hmat/hmatrix_low_rank_data.hpp"
 
+#include <algorithm>
+#include <array>
 #include <stdexcept>
 #include <fstream>
 #include <iostream>
+#include <map>
 
+#include <boost/functional/hash.hpp>
 #include <boost/type_traits/is_complex.hpp>
 
 #include <tbb/atomic.h>
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
+#include <tbb/parallel_invoke.h>
 #include <tbb/concurrent_queue.h>
 
 #include <Teuchos_ParameterList.hpp>
@@ -68,73 +98,537 @@ namespace Bempp {
 
 namespace {
 
-template <typename BasisFunctionType>
-class SpaceHMatGeometryInterface : public hmat::GeometryInterface {
+// Print the statistics of an assembled H-matrix and write them to the file
+// named by the "statisticsFile" parameter, if any.
+template <typename ResultType>
+void reportStatistics(const hmat::DefaultHMatrixType<ResultType> &hMatrix,
+                      const hmat::DataAccessor<ResultType, 2> &dataAccessor,
+                      const HMatOptions &hMatOptions, int part,
+                      bool verbosityAtLeastDefault) {
 
-public:
-  typedef typename Fiber::ScalarTraits<BasisFunctionType>::RealType
-  CoordinateType;
-  SpaceHMatGeometryInterface(const Space<BasisFunctionType> &space)
-      : m_counter(0) {
-    space.getGlobalDofBoundingBoxes(m_bemppBoundingBoxes);
-  }
-  shared_ptr<const hmat::GeometryDataType> next() override {
+  std::string fileName = hMatOptions.statisticsFile;
+  if (!verbosityAtLeastDefault && fileName.empty())
+    return;
 
-    if (m_counter == m_bemppBoundingBoxes.size())
-      return shared_ptr<hmat::GeometryDataType>();
+  hmat::HMatrixStatistics statistics = hMatrix.statistics();
+  statistics.accessedEntryCount = dataAccessor.accessedEntryCount();
+  if (verbosityAtLeastDefault)
+    std::cout << statistics << std::endl;
+  if (fileName.empty())
+    return;
 
-    auto lbound = m_bemppBoundingBoxes[m_counter].lbound;
-    auto ubound = m_bemppBoundingBoxes[m_counter].ubound;
-    auto center = m_bemppBoundingBoxes[m_counter].reference;
-    m_counter++;
-    return shared_ptr<hmat::GeometryDataType>(new hmat::GeometryDataType(
-        hmat::BoundingBox(lbound.x, ubound.x, lbound.y, ubound.y, lbound.z,
-                          ubound.z),
-        std::array<double, 3>({{center.x, center.y, center.z}})));
+  // Every process of a distributed assembly writes the statistics of its
+  // own part to a separate file
+  if (hMatOptions.distributed)
+    fileName += "." + toString(part);
+  std::ofstream file(fileName.c_str());
+  if (!file)
+    throw std::runtime_error("HMatGlobalAssember::assembleHMatrix: "
+                             "Cannot open file " + fileName +
+                             " for writing the statistics");
+  hmat::writeJson(file, statistics);
+}
+
+// Complete the compression time and storage size of an assembly report and
+// attach it to the operator, whose storage is also recorded in the memory
+// registry.
+template <typename ResultType>
+void attachReport(DiscreteBoundaryOperator<ResultType> &op,
+                  const AssemblyPhaseTimer &compressionTimer,
+                  double memSizeKb, AssemblyReport &report) {
+  const AssemblyPhaseTime elapsed = compressionTimer.elapsed();
+  report.phases[AssemblyReport::COMPRESSION].wallTime += elapsed.wallTime;
+  report.phases[AssemblyReport::COMPRESSION].cpuTime += elapsed.cpuTime;
+  report.storageSize = static_cast<std::size_t>(memSizeKb * 1024);
+  op.setAssemblyReport(
+      shared_ptr<const AssemblyReport>(new AssemblyReport(report)));
+  op.trackMemory(Fiber::MemoryCategory::HMATRICES, report.storageSize);
+}
+
+// Call compress() with the compressor of H-matrix blocks selected by the
+// "HMat" parameters. The ACA compressor is warm-started with \p seedPivots
+// and records its pivots in \p recordedPivots (see
+// HMatrixAcaCompressor::setWarmStart()).
+template <typename ResultType, typename CompressFunction>
+void compressWithSelectedCompressor(
+    const hmat::DataAccessor<ResultType, 2> &dataAccessor,
+    const HMatOptions &hMatOptions, bool verbosityAtLeastDefault,
+    const CompressFunction &compress,
+    const shared_ptr<const hmat::AcaPivotTable> &seedPivots =
+        shared_ptr<const hmat::AcaPivotTable>(),
+    const shared_ptr<hmat::AcaPivotTable> &recordedPivots =
+        shared_ptr<hmat::AcaPivotTable>()) {
+  if (hMatOptions.compressionAlgorithm == HMatOptions::DENSE) {
+    hmat::HMatrixDenseCompressor<ResultType, 2> compressor(dataAccessor);
+    compress(compressor);
+  } else {
+    const int maxRank = hMatOptions.maxRank;
+    auto pivoting = (hMatOptions.compressionAlgorithm == HMatOptions::ACA_PLUS)
+                        ? hmat::ACA_PLUS
+                        : hmat::ACA_PARTIAL_PIVOTING;
+    auto maxRankPolicy = hMatOptions.adaptiveMaxRank ? hmat::ACA_ADAPTIVE
+                                                     : hmat::ACA_TRUNCATE;
+    auto epsReference = hMatOptions.epsRelativeToMatrix
+                            ? hmat::ACA_MATRIX_NORM
+                            : hmat::ACA_BLOCK_NORM;
+    hmat::HMatrixAcaCompressor<ResultType, 2> compressor(
+        dataAccessor, hMatOptions.eps, maxRank, 10, pivoting,
+        hMatOptions.acaPivotBatchSize, maxRankPolicy, epsReference);
+    compressor.setWarmStart(seedPivots, recordedPivots);
+    compress(compressor);
+    if (verbosityAtLeastDefault && compressor.numberOfBlocksAtMaxRank() > 0)
+      std::cout << compressor.numberOfBlocksAtMaxRank()
+                << " admissible blocks reached maxRank = " << maxRank
+                << " without converging; "
+                << compressor.numberOfRecomputedBlocks()
+                << " of them were evaluated completely." << std::endl;
   }
+}
+
+// Compressor applying the recompression, single-precision conversion and
+// dense block compression requested by the "HMat" parameters to each block
+// it produces. Used when only some leaves are compressed, since
+// HMatrix::recompress() and its siblings process all of them.
+template <typename ResultType>
+class PostProcessingCompressor : public hmat::HMatrixCompressor<ResultType, 2> {
+public:
+  PostProcessingCompressor(
+      const hmat::HMatrixCompressor<ResultType, 2> &compressor,
+      const HMatOptions &hMatOptions)
+      : m_compressor(compressor), m_hMatOptions(hMatOptions) {}
 
-  std::size_t numberOfEntities() const override {
-    return m_bemppBoundingBoxes.size();
+  void compressBlock(const hmat::BlockClusterTreeNode<2> &blockClusterTreeNode,
+                     shared_ptr<hmat::HMatrixData<ResultType>> &hMatrixData)
+      const override {
+    m_compressor.compressBlock(blockClusterTreeNode, hMatrixData);
+    if (m_hMatOptions.denseStorageBits)
+      if (auto denseData = dynamic_cast<hmat::HMatrixDenseData<ResultType> *>(
+              hMatrixData.get()))
+        denseData->compress(m_hMatOptions.denseStorageBits);
+    auto lowRankData =
+        dynamic_cast<hmat::HMatrixLowRankData<ResultType> *>(hMatrixData.get());
+    if (!lowRankData)
+      return;
+    if (m_hMatOptions.recompress)
+      lowRankData->recompress(m_hMatOptions.eps);
+    if (m_hMatOptions.singlePrecisionLowRankBlocks)
+      lowRankData->convertToSinglePrecision();
   }
-  void reset() override { m_counter = 0; }
 
 private:
-  std::size_t m_counter;
-  std::vector<BoundingBox<CoordinateType>> m_bemppBoundingBoxes;
+  const hmat::HMatrixCompressor<ResultType, 2> &m_compressor;
+  const HMatOptions &m_hMatOptions;
 };
 
+// Signature of the checkpoint files of an H-matrix: the options that
+// determine its leaves, the value type and the entries of the first rows
+// and columns of the first admissible and inadmissible leaves, which tell
+// apart operators with different kernels, parameters, spaces or
+// quadrature.
+template <typename ResultType>
+std::uint64_t
+checkpointSignature(const hmat::DefaultBlockClusterTreeType &blockClusterTree,
+                    const hmat::DataAccessor<ResultType, 2> &dataAccessor,
+                    const HMatOptions &hMatOptions) {
+  std::size_t result = hMatOptions.compressionHash();
+  boost::hash_combine(result, sizeof(ResultType));
+  bool sampled[2] = {false, false};
+  for (const auto &leaf : blockClusterTree.leafNodes()) {
+    const bool admissible = leaf->data().admissible;
+    if (sampled[admissible])
+      continue;
+    sampled[admissible] = true;
+    const hmat::IndexRangeType &rowRange =
+        leaf->data().rowClusterTreeNode->data().indexRange;
+    const hmat::IndexRangeType &columnRange =
+        leaf->data().columnClusterTreeNode->data().indexRange;
+    const hmat::IndexRangeType rows = {
+        {rowRange[0], std::min(rowRange[1], rowRange[0] + 4)}};
+    const hmat::IndexRangeType columns = {
+        {columnRange[0], std::min(columnRange[1], columnRange[0] + 4)}};
+    arma::Mat<ResultType> entries;
+    dataAccessor.computeMatrixBlock(rows, columns, *leaf, entries);
+    for (arma::uword i = 0; i < entries.n_elem; ++i)
+      boost::hash_combine(result, entries[i]);
+    if (sampled[0] && sampled[1])
+      break;
+  }
+  return result;
+}
+
+// Merge the bounding boxes of the DOFs of a (non-empty) cluster.
+template <typename CoordinateType>
+hmat::BoundingBox
+clusterBoundingBox(const hmat::DefaultClusterTreeNodeType &clusterTreeNode,
+                   const hmat::DefaultClusterTreeType &clusterTree,
+                   const std::vector<BoundingBox<CoordinateType>> &dofBoxes) {
+  auto hMatBox = [&](std::size_t hMatDof) {
+    const BoundingBox<CoordinateType> &box =
+        dofBoxes[clusterTree.mapHMatDofToOriginalDof(hMatDof)];
+    return hmat::BoundingBox(box.lbound.x, box.ubound.x, box.lbound.y,
+                             box.ubound.y, box.lbound.z, box.ubound.z);
+  };
+  const hmat::IndexRangeType &range = clusterTreeNode.data().indexRange;
+  hmat::BoundingBox result = hMatBox(range[0]);
+  for (std::size_t hMatDof = range[0] + 1; hMatDof < range[1]; ++hMatDof)
+    result.merge(hMatBox(hMatDof));
+  return result;
+}
+
+// Function counting, for each H-matrix DOF index i, the DOFs of \p space
+// with H-matrix index below i that live on at least one of the given
+// elements. Its ith element is the count; the last one is the total.
+template <typename BasisFunctionType>
+void countDofsOfElements(const Space<BasisFunctionType> &space,
+                         const std::vector<int> &elementIndices,
+                         const hmat::DefaultClusterTreeType &clusterTree,
+                         std::vector<std::size_t> &counts) {
+  const GridView &view = space.gridView();
+  const Mapper &mapper = view.elementMapper();
+  const int elementCount = view.entityCount(0);
+  std::vector<char> elementChanged(elementCount, false);
+  for (size_t i = 0; i < elementIndices.size(); ++i) {
+    if (elementIndices[i] < 0 || elementIndices[i] >= elementCount)
+      throw std::invalid_argument(
+          "HMatGlobalAssembler::updateDetachedWeakForm(): "
+          "invalid element index");
+    elementChanged[elementIndices[i]] = true;
+  }
+
+  std::vector<char> hMatDofChanged(space.globalDofCount(), false);
+  std::vector<GlobalDofIndex> globalDofs;
+  std::vector<BasisFunctionType> localDofWeights;
+  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
+  while (!it->finished()) {
+    const Entity<0> &element = it->entity();
+    if (elementChanged[mapper.entityIndex(element)]) {
+      space.getGlobalDofs(element, globalDofs, localDofWeights);
+      for (size_t i = 0; i < globalDofs.size(); ++i)
+        if (globalDofs[i] >= 0)
+          hMatDofChanged[clusterTree.mapOriginalDofToHMatDof(globalDofs[i])] =
+              true;
+    }
+    it->next();
+  }
+
+  counts.assign(hMatDofChanged.size() + 1, 0);
+  for (size_t i = 0; i < hMatDofChanged.size(); ++i)
+    counts[i + 1] = counts[i] + hMatDofChanged[i];
+}
+
+// Return the storage scheme of the H-matrix of an operator with the given
+// symmetry (see Symmetry). Only the lower block triangle is compressed if
+// "symmetricStorage" is set, the operator is symmetric or Hermitian, its
+// test and trial spaces coincide and none of the formats that need all
+// leaves is requested.
 template <typename BasisFunctionType>
-shared_ptr<hmat::DefaultBlockClusterTreeType>
-generateBlockClusterTree(const Space<BasisFunctionType> &testSpace,
-                         const Space<BasisFunctionType> &trialSpace,
-                         int minBlockSize, int maxBlockSize, double eta) {
+hmat::HMatrixSymmetry
+selectStorage(int symmetry, const HMatOptions &hMatOptions,
+              const Space<BasisFunctionType> &testSpace,
+              const Space<BasisFunctionType> &trialSpace) {
+  if (!hMatOptions.symmetricStorage || &testSpace != &trialSpace ||
+      hMatOptions.distributed || hMatOptions.h2Matrix ||
+      !hMatOptions.outOfCoreDirectory.empty() ||
+      hMatOptions.blockSparseNearField || hMatOptions.groupedLowRankApply ||
+      hMatOptions.frozenLayout)
+    return hmat::GENERAL_STORAGE;
+  if (symmetry & SYMMETRIC)
+    return hmat::SYMMETRIC_STORAGE;
+  if (symmetry & HERMITIAN)
+    return hmat::HERMITIAN_STORAGE;
+  return hmat::GENERAL_STORAGE;
+}
+
+// Compress the H-matrix on the given block cluster tree as requested by the
+// "HMat" parameters and wrap it in a discrete operator. The time of the
+// conversions following the compression and the storage size are added to
+// \p report, which is then attached to the operator. The pivot tables are
+// passed to compressWithSelectedCompressor(); if \p compressor is not null,
+// it is used instead of the compressor selected by the "HMat" parameters.
+// With a symmetric \p storage only the lower block triangle is compressed.
+template <typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>> assembleHMatrix(
+    const shared_ptr<hmat::DefaultBlockClusterTreeType> &blockClusterTree,
+    const hmat::DataAccessor<ResultType, 2> &dataAccessor,
+    const HMatOptions &hMatOptions, int maxThreadCount,
+    bool verbosityAtLeastDefault, AssemblyReport &report,
+    const shared_ptr<const hmat::AcaPivotTable> &seedPivots =
+        shared_ptr<const hmat::AcaPivotTable>(),
+    const shared_ptr<hmat::AcaPivotTable> &recordedPivots =
+        shared_ptr<hmat::AcaPivotTable>(),
+    const hmat::HMatrixCompressor<ResultType, 2> *compressor = 0,
+    hmat::HMatrixSymmetry storage = hmat::GENERAL_STORAGE) {
+  Fiber::ProfileRegion profileRegion("H-matrix assembly");
+
+  shared_ptr<hmat::DefaultHMatrixType<ResultType>> hMatrix;
+
+  // In distributed mode every process only compresses the leaves of its
+  // own part of the block cluster tree
+  shared_ptr<const hmat::LeafPartition<2>> partition;
+  int part = 0;
+  if (hMatOptions.distributed) {
+#ifdef WITH_MPI
+    if (hMatOptions.h2Matrix)
+      throw std::runtime_error(
+          "HMatGlobalAssember::assembleHMatrix: "
+          "Distributed H2-matrices are not supported");
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized)
+      throw std::runtime_error("HMatGlobalAssember::assembleHMatrix: "
+                               "Distributed assembly requires MPI to be "
+                               "initialized");
+    int numberOfParts = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &numberOfParts);
+    MPI_Comm_rank(MPI_COMM_WORLD, &part);
+    partition.reset(new hmat::LeafPartition<2>(
+        *blockClusterTree, numberOfParts, hMatOptions.maxRank));
+#else
+    throw std::runtime_error("HMatGlobalAssember::assembleHMatrix: "
+                             "Distributed assembly requires BEM++ to be "
+                             "compiled with MPI support (WITH_MPI)");
+#endif
+  }
+  // Out-of-core H-matrices are frozen as they are written, so the blocks
+  // are recompressed by the compressor
+  const bool outOfCore = !hMatOptions.outOfCoreDirectory.empty();
+  if (outOfCore && (partition || hMatOptions.h2Matrix))
+    throw std::runtime_error("HMatGlobalAssember::assembleHMatrix: "
+                             "Out-of-core storage is not supported for "
+                             "distributed H-matrices and H2-matrices");
+  HMatOptions outOfCoreOptions = hMatOptions;
+  outOfCoreOptions.singlePrecisionLowRankBlocks = false;
+  outOfCoreOptions.denseStorageBits = 0;
+
+  // The leaves found in the checkpoint file are not compressed again. The
+  // checkpoint wraps the selected compressor, so that restored leaves are
+  // post-processed like new ones. Under "epsReference" = "matrix" the ACA
+  // accuracy depends on the norms of the inadmissible leaves, which are
+  // therefore always recomputed.
+  std::unique_ptr<hmat::HMatrixCheckpoint<ResultType, 2>> checkpoint;
+  if (!hMatOptions.checkpointFile.empty()) {
+    std::string fileName = hMatOptions.checkpointFile;
+    if (partition)
+      fileName += "." + toString(part);
+    checkpoint.reset(new hmat::HMatrixCheckpoint<ResultType, 2>(
+        fileName, blockClusterTree,
+        checkpointSignature(*blockClusterTree, dataAccessor, hMatOptions),
+        hMatOptions.checkpointInterval));
+    if (verbosityAtLeastDefault && checkpoint->restoredLeafCount() > 0)
+      std::cout << checkpoint->restoredLeafCount()
+                << " H-matrix leaves restored from " << fileName << std::endl;
+  }
+
+  auto compress = [&](const hmat::HMatrixCompressor<ResultType, 2> &
+                          selectedCompressor) {
+    std::unique_ptr<hmat::HMatrixCheckpointingCompressor<ResultType, 2>>
+        checkpointingCompressor;
+    if (checkpoint)
+      checkpointingCompressor.reset(
+          new hmat::HMatrixCheckpointingCompressor<ResultType, 2>(
+              selectedCompressor, *checkpoint,
+              !hMatOptions.epsRelativeToMatrix));
+    const hmat::HMatrixCompressor<ResultType, 2> &leafCompressor =
+        checkpoint ? *checkpointingCompressor : selectedCompressor;
+    if (outOfCore) {
+      hMatrix.reset(new hmat::DefaultHMatrixType<ResultType>(blockClusterTree));
+      hMatrix->initializeOutOfCore(
+          PostProcessingCompressor<ResultType>(leafCompressor,
+                                               outOfCoreOptions),
+          hMatOptions.outOfCoreDirectory, 256, maxThreadCount);
+    } else if (partition)
+      hMatrix.reset(new hmat::DefaultHMatrixType<ResultType>(
+          blockClusterTree, leafCompressor, *partition, part, maxThreadCount));
+    else if (storage != hmat::GENERAL_STORAGE) {
+      hMatrix.reset(new hmat::DefaultHMatrixType<ResultType>(blockClusterTree));
+      hMatrix->initializeSymmetric(leafCompressor, storage, maxThreadCount);
+    } else
+      hMatrix.reset(new hmat::DefaultHMatrixType<ResultType>(
+          blockClusterTree, leafCompressor, maxThreadCount));
+    if (checkpoint)
+      checkpoint->flush();
+  };
+
+  Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is
+                                  // single-threaded
+  if (compressor)
+    compress(*compressor);
+  else
+    compressWithSelectedCompressor(dataAccessor, hMatOptions,
+                                   verbosityAtLeastDefault, compress,
+                                   seedPivots, recordedPivots);
+
+  AssemblyPhaseTimer compressionTimer;
+
+  if (hMatOptions.recompress && !outOfCore) {
+    auto statistics = hMatrix->recompress(hMatOptions.eps);
+    if (verbosityAtLeastDefault)
+      std::cout << statistics << std::endl;
+  }
 
-  hmat::Geometry testGeometry;
-  hmat::Geometry trialGeometry;
+  if (hMatOptions.h2Matrix) {
+    reportStatistics(*hMatrix, dataAccessor, hMatOptions, part,
+                     verbosityAtLeastDefault);
+    shared_ptr<hmat::H2Matrix<ResultType, 2>> h2Matrix(
+        new hmat::H2Matrix<ResultType, 2>(*hMatrix, hMatOptions.eps,
+                                          maxThreadCount));
+    if (verbosityAtLeastDefault)
+      std::cout << "Converted to H2-matrix: " << h2Matrix->memSizeKb()
+                << " KB, maximum basis rank " << h2Matrix->maxBasisRank()
+                << std::endl;
+    std::unique_ptr<DiscreteBoundaryOperator<ResultType>> result(
+        new DiscreteH2MatBoundaryOperator<ResultType>(h2Matrix));
+    attachReport(*result, compressionTimer, h2Matrix->memSizeKb(), report);
+    return result;
+  }
+
+  if (hMatOptions.singlePrecisionLowRankBlocks && !outOfCore)
+    hMatrix->convertLowRankBlocksToSinglePrecision();
+
+  // The near field and the frozen layout would store the dense blocks
+  // decoded again
+  const bool compressDense = hMatOptions.denseStorageBits && !outOfCore;
+  if (compressDense)
+    hMatrix->compressDenseBlocks(hMatOptions.denseStorageBits);
+
+  if (hMatOptions.blockSparseNearField && !outOfCore && !compressDense)
+    hMatrix->extractNearField();
+
+  if (hMatOptions.groupedLowRankApply && !outOfCore &&
+      !hMatOptions.singlePrecisionLowRankBlocks)
+    hMatrix->groupLowRankLeaves();
+
+  if (hMatOptions.frozenLayout && !compressDense)
+    hMatrix->freeze();
+
+  reportStatistics(*hMatrix, dataAccessor, hMatOptions, part,
+                   verbosityAtLeastDefault);
+
+  std::unique_ptr<DiscreteBoundaryOperator<ResultType>> result;
+#ifdef WITH_MPI
+  if (partition)
+    result.reset(new DiscreteDistributedHMatBoundaryOperator<ResultType>(
+        hMatrix, partition));
+#endif
+  if (!result)
+    result.reset(new DiscreteHMatBoundaryOperator<ResultType>(hMatrix));
+  attachReport(*result, compressionTimer, hMatrix->statistics().memSizeKb,
+               report);
+  return result;
+}
+
+// Interpolation of a Laplace or modified Helmholtz kernel in the cluster
+// boxes, for hmat::HMatrixInterpolationCompressor. The boxes, interpolants
+// and kernel are those of the far field of the FMM; as there, the normal
+// derivative of a double-layer kernel is applied to the interpolants.
+template <typename BasisFunctionType, typename ResultType>
+class InterpolationAssemblyHelper
+    : public hmat::InterpolationDataAccessor<ResultType, 2> {
+public:
+  InterpolationAssemblyHelper(
+      const Space<BasisFunctionType> &testSpace,
+      const Space<BasisFunctionType> &trialSpace,
+      const typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry &
+          trees,
+      Fiber::KernelTileType kernelType, std::complex<double> waveNumber,
+      const HMatOptions &hMatOptions)
+      : m_farField(trees.blockClusterTree, hMatOptions.interpolationOrder,
+                   waveNumber, false),
+        m_testMoments(testSpace, trees.testDofListsCache, m_farField,
+                      FmmFarField<ResultType>::ROWS,
+                      kernelType == Fiber::ADJOINT_DOUBLE_LAYER_TILE, true,
+                      hMatOptions.interpolationQuadratureOrder),
+        m_trialMoments(trialSpace, trees.trialDofListsCache, m_farField,
+                       FmmFarField<ResultType>::COLUMNS,
+                       kernelType == Fiber::DOUBLE_LAYER_TILE, false,
+                       hMatOptions.interpolationQuadratureOrder) {}
+
+  void computeClusterMoments(hmat::RowColSelector side,
+                             const hmat::DefaultClusterTreeNodeType &node,
+                             arma::Mat<ResultType> &moments) const override {
+    const auto &assembler = (side == hmat::ROW) ? m_testMoments
+                                                : m_trialMoments;
+    assembler.assemble(node.index(), node.data().indexRange, moments);
+  }
+
+  void computeCouplingMatrix(
+      const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
+      arma::Mat<ResultType> &coupling) const override {
+    m_farField.evaluateCouplingMatrix(
+        blockClusterTreeNode.data().rowClusterTreeNode->index(),
+        blockClusterTreeNode.data().columnClusterTreeNode->index(), coupling);
+  }
+
+private:
+  FmmFarField<ResultType> m_farField;
+  InterpolantMomentsAssembler<BasisFunctionType, ResultType> m_testMoments;
+  InterpolantMomentsAssembler<BasisFunctionType, ResultType> m_trialMoments;
+};
 
-  auto testSpaceGeometryInterface = shared_ptr<hmat::GeometryInterface>(
-      new SpaceHMatGeometryInterface<BasisFunctionType>(testSpace));
+// Return the block cluster tree on which the weak form of an operator
+// between the given spaces is assembled as an H-matrix, taking it from the
+// cache of \p context if requested. The spaces whose DOFs index the
+// H-matrix, i.e. the discontinuous counterparts of the given ones in local
+// assembly mode, are stored in \p actualTestSpace and \p actualTrialSpace.
+template <typename BasisFunctionType, typename ResultType>
+typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry
+getWeakFormTrees(const Space<BasisFunctionType> &testSpace,
+                 const Space<BasisFunctionType> &trialSpace,
+                 const Context<BasisFunctionType, ResultType> &context,
+                 double waveNumber,
+                 shared_ptr<const Space<BasisFunctionType>> &actualTestSpace,
+                 shared_ptr<const Space<BasisFunctionType>> &actualTrialSpace) {
+  const HMatOptions &hMatOptions = context.hMatOptions();
 
-  auto trialSpaceGeometryInterface = shared_ptr<hmat::GeometryInterface>(
-      new SpaceHMatGeometryInterface<BasisFunctionType>(trialSpace));
+  auto testSpacePointer = Fiber::make_shared_from_const_ref(testSpace);
+  auto trialSpacePointer = Fiber::make_shared_from_const_ref(trialSpace);
 
-  hmat::fillGeometry(testGeometry, *testSpaceGeometryInterface);
-  hmat::fillGeometry(trialGeometry, *trialSpaceGeometryInterface);
+  if (!hMatOptions.indexWithGlobalDofs) {
+    // The discontinuous spaces are derived lazily and only once per space;
+    // derive those of distinct test and trial spaces concurrently.
+    if (testSpacePointer.get() == trialSpacePointer.get()) {
+      actualTestSpace = testSpacePointer->discontinuousSpace(testSpacePointer);
+      actualTrialSpace = actualTestSpace;
+    } else
+      tbb::parallel_invoke(
+          [&]() {
+            actualTestSpace =
+                testSpacePointer->discontinuousSpace(testSpacePointer);
+          },
+          [&]() {
+            actualTrialSpace =
+                trialSpacePointer->discontinuousSpace(trialSpacePointer);
+          });
+  } else {
+    actualTestSpace = testSpacePointer;
+    actualTrialSpace = trialSpacePointer;
+  }
 
-  auto testClusterTree = shared_ptr<hmat::DefaultClusterTreeType>(
-      new hmat::DefaultClusterTreeType(testGeometry, minBlockSize));
+  const unsigned int minBlockSize = hMatOptions.minBlockSize;
+  const unsigned int maxBlockSize = hMatOptions.maxBlockSize;
+  const double eta = hMatOptions.eta;
+  const double highFrequencyEta = hMatOptions.highFrequencyEta;
 
-  auto trialClusterTree = shared_ptr<hmat::DefaultClusterTreeType>(
-      new hmat::DefaultClusterTreeType(trialGeometry, minBlockSize));
+  const bool weakAdmissibility = hMatOptions.weakAdmissibility;
 
-  shared_ptr<hmat::DefaultBlockClusterTreeType> blockClusterTree(
-      new hmat::DefaultBlockClusterTreeType(testClusterTree, trialClusterTree,
-                                            maxBlockSize,
-                                            hmat::StandardAdmissibility(eta)));
+  if (context.assemblyOptions().verbosityLevel() >= VerbosityLevel::DEFAULT &&
+      waveNumber > 0 && !weakAdmissibility)
+    std::cout << "Using the high-frequency admissibility condition for "
+                 "wave number " << waveNumber << std::endl;
 
-  return blockClusterTree;
+  typedef HMatBlockClusterTreeCache<BasisFunctionType> TreeCache;
+  return hMatOptions.cacheClusterTrees
+             ? context.hMatBlockClusterTreeCache()->get(
+                   *actualTestSpace, *actualTrialSpace, minBlockSize,
+                   maxBlockSize, eta, waveNumber, highFrequencyEta,
+                   weakAdmissibility)
+             : TreeCache::build(*actualTestSpace, *actualTrialSpace,
+                                minBlockSize, maxBlockSize, eta, waveNumber,
+                                highFrequencyEta, weakAdmissibility);
 }
-} // end anonymous namespace
+
+} // namespace
+
 template <typename BasisFunctionType, typename ResultType>
 std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
 HMatGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
@@ -149,69 +643,59 @@ HMatGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
     const Context<BasisFunctionType, ResultType> &context, int symmetry) {
 
   const AssemblyOptions &options = context.assemblyOptions();
-  const auto hMatParameterList =
-      context.globalParameterList().sublist("HMatParameters");
-  const bool indexWithGlobalDofs =
-      (hMatParameterList.template get<std::string>("HMatAssemblyMode") ==
-       "GlobalAssembly");
+  const HMatOptions &hMatOptions = context.hMatOptions();
   const bool verbosityAtLeastDefault =
       (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
   const bool verbosityAtLeastHigh =
       (options.verbosityLevel() >= VerbosityLevel::HIGH);
 
-  auto testSpacePointer = Fiber::make_shared_from_const_ref(testSpace);
-  auto trialSpacePointer = Fiber::make_shared_from_const_ref(trialSpace);
+  // Blocks of oscillatory operators are adapted to the largest wave number
+  // of all terms
+  double waveNumber = 0.;
+  if (hMatOptions.highFrequencyEta > 0)
+    for (size_t i = 0; i < localAssemblers.size(); ++i)
+      waveNumber = std::max(
+          waveNumber,
+          static_cast<double>(localAssemblers[i]->oscillationWaveNumber()));
 
+  AssemblyPhaseTimer geometryTimer;
   shared_ptr<const Space<BasisFunctionType>> actualTestSpace;
   shared_ptr<const Space<BasisFunctionType>> actualTrialSpace;
-  if (!indexWithGlobalDofs) {
-    actualTestSpace = testSpacePointer->discontinuousSpace(testSpacePointer);
-    actualTrialSpace = trialSpacePointer->discontinuousSpace(trialSpacePointer);
-  } else {
-    actualTestSpace = testSpacePointer;
-    actualTrialSpace = trialSpacePointer;
-  }
-
-  auto minBlockSize =
-      hMatParameterList.template get<unsigned int>("minBlockSize");
-  auto maxBlockSize =
-      hMatParameterList.template get<unsigned int>("maxBlockSize");
-  auto eta = hMatParameterList.template get<double>("eta");
-
-  auto blockClusterTree = generateBlockClusterTree(
-      *actualTestSpace, *actualTrialSpace, minBlockSize, maxBlockSize, eta);
+  typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry trees =
+      getWeakFormTrees(testSpace, trialSpace, context, waveNumber,
+                       actualTestSpace, actualTrialSpace);
+  auto blockClusterTree = trees.blockClusterTree;
 
   WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType> helper(
       *actualTestSpace, *actualTrialSpace, blockClusterTree, localAssemblers,
-      sparseTermsToAdd, denseTermMultipliers, sparseTermMultipliers);
+      sparseTermsToAdd, denseTermMultipliers, sparseTermMultipliers,
+      trees.testDofListsCache, trees.trialDofListsCache);
 
-  auto defaultCompressionAlg = hMatParameterList.
-      template get<std::string>("defaultCompressionAlg");
-
-  shared_ptr<hmat::DefaultHMatrixType<ResultType>> hMatrix;
+  const int maxThreadCount = options.parallelizationOptions().maxThreadCount();
 
-  if (defaultCompressionAlg=="aca")
-  {
+  // The cluster trees belong to the geometry phase; the caller adds the time
+  // spent on integration
+  AssemblyReport report;
+  report.phases[AssemblyReport::GEOMETRY] = geometryTimer.elapsed();
 
-    auto eps = hMatParameterList.template get<double>("eps");
-    auto maxRank = hMatParameterList.template get<int>("maxRank");
-    hmat::HMatrixAcaCompressor<ResultType, 2> 
-        compressor(helper, 1E-3, 30);
-    hMatrix.reset(new hmat::DefaultHMatrixType<ResultType>
-            (blockClusterTree, compressor));
+  // The pivots of the previous ACA compression on the same tree, e.g. of
+  // the same operator at a nearby wave number, seed this one
+  shared_ptr<const hmat::AcaPivotTable> seedPivots;
+  shared_ptr<hmat::AcaPivotTable> recordedPivots;
+  if (hMatOptions.acaWarmStart && hMatOptions.cacheClusterTrees &&
+      hMatOptions.compressionAlgorithm == HMatOptions::ACA) {
+    seedPivots = trees.acaPivots->get();
+    recordedPivots.reset(new hmat::AcaPivotTable(
+        blockClusterTree->treeIndex().numberOfNodes()));
   }
-  else if (defaultCompressionAlg=="dense")
-  {
-    hmat::HMatrixDenseCompressor<ResultType, 2> compressor(helper);
-    hMatrix.reset(new hmat::DefaultHMatrixType<ResultType>
-            (blockClusterTree,compressor));
-  }
-  else throw std::runtime_error(
-          "HMatGlobalAssember::assembleDetachedWeakForm: "
-          "Unknown compression algorithm");
-  return std::unique_ptr<DiscreteBoundaryOperator<ResultType>>(
-      new DiscreteHMatBoundaryOperator<ResultType>(hMatrix));
-
+  std::unique_ptr<DiscreteBndOp> result = assembleHMatrix<ResultType>(
+      blockClusterTree, helper, hMatOptions, maxThreadCount,
+      verbosityAtLeastDefault, report, seedPivots, recordedPivots, 0,
+      selectStorage(symmetry, hMatOptions, *actualTestSpace,
+                    *actualTrialSpace));
+  if (recordedPivots)
+    trees.acaPivots->set(recordedPivots);
+  return result;
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -236,6 +720,321 @@ HMatGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
                                   sparseTermsMultipliers, context, symmetry);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+HMatGlobalAssembler<BasisFunctionType, ResultType>::
+    assembleDetachedWeakFormByInterpolation(
+        const Space<BasisFunctionType> &testSpace,
+        const Space<BasisFunctionType> &trialSpace,
+        LocalAssemblerForIntegralOperators &localAssembler,
+        Fiber::KernelTileType kernelType, std::complex<double> waveNumber,
+        const Context<BasisFunctionType, ResultType> &context, int symmetry) {
+
+  if (testSpace.worldDimension() != 3 || trialSpace.worldDimension() != 3 ||
+      testSpace.gridDimension() != 2 || trialSpace.gridDimension() != 2)
+    throw std::invalid_argument(
+        "HMatGlobalAssembler::assembleDetachedWeakFormByInterpolation(): "
+        "interpolation requires surface grids in 3D");
+
+  const AssemblyOptions &options = context.assemblyOptions();
+  const HMatOptions &hMatOptions = context.hMatOptions();
+  const bool verbosityAtLeastDefault =
+      (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
+
+  const double oscillationWaveNumber =
+      hMatOptions.highFrequencyEta > 0
+          ? static_cast<double>(localAssembler.oscillationWaveNumber())
+          : 0.;
+
+  AssemblyPhaseTimer geometryTimer;
+  shared_ptr<const Space<BasisFunctionType>> actualTestSpace;
+  shared_ptr<const Space<BasisFunctionType>> actualTrialSpace;
+  typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry trees =
+      getWeakFormTrees(testSpace, trialSpace, context, oscillationWaveNumber,
+                       actualTestSpace, actualTrialSpace);
+  auto blockClusterTree = trees.blockClusterTree;
+
+  // Inadmissible blocks are integrated as usual
+  std::vector<LocalAssemblerForIntegralOperators *> localAssemblers(
+      1, &localAssembler);
+  std::vector<const DiscreteBndOp *> sparseTermsToAdd;
+  std::vector<ResultType> denseTermMultipliers(1, 1.0);
+  std::vector<ResultType> sparseTermMultipliers;
+  WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType> helper(
+      *actualTestSpace, *actualTrialSpace, blockClusterTree, localAssemblers,
+      sparseTermsToAdd, denseTermMultipliers, sparseTermMultipliers,
+      trees.testDofListsCache, trees.trialDofListsCache);
+
+  const int maxThreadCount = options.parallelizationOptions().maxThreadCount();
+
+  AssemblyReport report;
+  report.phases[AssemblyReport::GEOMETRY] = geometryTimer.elapsed();
+
+  // The moment matrices of the clusters are computed in parallel by the
+  // constructor of the compressor
+  InterpolationAssemblyHelper<BasisFunctionType, ResultType>
+      interpolationHelper(*actualTestSpace, *actualTrialSpace, trees,
+                          kernelType, waveNumber, hMatOptions);
+  std::unique_ptr<hmat::HMatrixInterpolationCompressor<ResultType, 2>>
+      compressor;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    compressor.reset(new hmat::HMatrixInterpolationCompressor<ResultType, 2>(
+        *blockClusterTree, helper, interpolationHelper, hMatOptions.eps));
+  });
+
+  return assembleHMatrix<ResultType>(
+      blockClusterTree, helper, hMatOptions, maxThreadCount,
+      verbosityAtLeastDefault, report, shared_ptr<const hmat::AcaPivotTable>(),
+      shared_ptr<hmat::AcaPivotTable>(), compressor.get(),
+      selectStorage(symmetry, hMatOptions, *actualTestSpace,
+                    *actualTrialSpace));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+HMatGlobalAssembler<BasisFunctionType, ResultType>::updateDetachedWeakForm(
+    const Space<BasisFunctionType> &testSpace,
+    const Space<BasisFunctionType> &trialSpace,
+    LocalAssemblerForIntegralOperators &localAssembler,
+    const DiscreteBndOp &previousWeakForm,
+    const std::vector<int> &changedElements,
+    const Context<BasisFunctionType, ResultType> &context) {
+
+  const AssemblyOptions &options = context.assemblyOptions();
+  const HMatOptions &hMatOptions = context.hMatOptions();
+  const bool verbosityAtLeastDefault =
+      (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
+
+  // Only H-matrices indexed with global DOFs and holding all their leaves
+  // can be updated leaf by leaf; the other formats are built from a
+  // complete H-matrix
+  std::unique_ptr<DiscreteBndOp> noUpdate;
+  const DiscreteHMatBoundaryOperator<ResultType> *previous =
+      dynamic_cast<const DiscreteHMatBoundaryOperator<ResultType> *>(
+          &previousWeakForm);
+  if (!previous || previous->hMatDofOrdering() || previous->nearFieldOnly() ||
+      !hMatOptions.indexWithGlobalDofs || hMatOptions.distributed ||
+      hMatOptions.h2Matrix || hMatOptions.blockSparseNearField ||
+      hMatOptions.groupedLowRankApply || hMatOptions.frozenLayout)
+    return noUpdate;
+  shared_ptr<const hmat::DefaultHMatrixType<ResultType>> previousHMatrix =
+      previous->hMatrix();
+  if (previousHMatrix->isFrozen() || previousHMatrix->nearField() ||
+      previousHMatrix->lowRankGroups() ||
+      previousHMatrix->symmetry() != hmat::GENERAL_STORAGE ||
+      previousHMatrix->rows() != testSpace.globalDofCount() ||
+      previousHMatrix->columns() != trialSpace.globalDofCount())
+    return noUpdate;
+
+  Fiber::ProfileRegion profileRegion("H-matrix update");
+  AssemblyPhaseTimer geometryTimer;
+
+  // The DOFs are numbered as before, so the cluster trees of the previous
+  // weak form still partition them. The trees may be shared with other
+  // operators and are left untouched.
+  shared_ptr<const hmat::DefaultBlockClusterTreeType> blockClusterTree =
+      previousHMatrix->blockClusterTree();
+  const hmat::DefaultClusterTreeType &testClusterTree =
+      *blockClusterTree->rowClusterTree();
+  const hmat::DefaultClusterTreeType &trialClusterTree =
+      *blockClusterTree->columnClusterTree();
+  std::vector<std::size_t> changedTestDofCounts, changedTrialDofCounts;
+  countDofsOfElements(testSpace, changedElements, testClusterTree,
+                      changedTestDofCounts);
+  countDofsOfElements(trialSpace, changedElements, trialClusterTree,
+                      changedTrialDofCounts);
+
+  double waveNumber = 0.;
+  if (hMatOptions.highFrequencyEta > 0)
+    waveNumber = localAssembler.oscillationWaveNumber();
+  hmat::AdmissibilityFunction admissibility =
+      HMatBlockClusterTreeCache<BasisFunctionType>::admissibilityFunction(
+          hMatOptions.eta, waveNumber, hMatOptions.highFrequencyEta,
+          hMatOptions.weakAdmissibility);
+
+  // Select the leaves with modified rows or columns. The blocks keep their
+  // structure only if the admissible ones stay admissible for the bounding
+  // boxes of the clusters in the new geometry.
+  const std::vector<BoundingBox<CoordinateType>> &testDofBoxes =
+      testSpace.globalDofBoundingBoxes();
+  const std::vector<BoundingBox<CoordinateType>> &trialDofBoxes =
+      trialSpace.globalDofBoundingBoxes();
+  std::map<const hmat::DefaultClusterTreeNodeType *, hmat::BoundingBox>
+      testBoxes, trialBoxes;
+  std::vector<shared_ptr<const hmat::DefaultBlockClusterTreeNodeType>> leaves;
+  for (const auto &leaf : blockClusterTree->leafNodes()) {
+    const hmat::DefaultClusterTreeNodeType &testNode =
+        *leaf->data().rowClusterTreeNode;
+    const hmat::DefaultClusterTreeNodeType &trialNode =
+        *leaf->data().columnClusterTreeNode;
+    const hmat::IndexRangeType &testRange = testNode.data().indexRange;
+    const hmat::IndexRangeType &trialRange = trialNode.data().indexRange;
+    if (changedTestDofCounts[testRange[1]] ==
+            changedTestDofCounts[testRange[0]] &&
+        changedTrialDofCounts[trialRange[1]] ==
+            changedTrialDofCounts[trialRange[0]])
+      continue;
+    if (leaf->data().admissible) {
+      if (!testBoxes.count(&testNode))
+        testBoxes[&testNode] =
+            clusterBoundingBox(testNode, testClusterTree, testDofBoxes);
+      if (!trialBoxes.count(&trialNode))
+        trialBoxes[&trialNode] =
+            clusterBoundingBox(trialNode, trialClusterTree, trialDofBoxes);
+      if (!admissibility(testBoxes[&testNode], trialBoxes[&trialNode])) {
+        if (verbosityAtLeastDefault)
+          std::cout << "The changes of the geometry invalidate the block "
+                       "structure of the H-matrix; "
+                       "assembling it from scratch" << std::endl;
+        return noUpdate;
+      }
+    }
+    leaves.push_back(leaf);
+  }
+  if (verbosityAtLeastDefault)
+    std::cout << "Updating " << leaves.size() << " of "
+              << blockClusterTree->leafNodes().size()
+              << " leaves of the H-matrix" << std::endl;
+
+  shared_ptr<LocalDofListsCache<BasisFunctionType>> testDofListsCache(
+      new LocalDofListsCache<BasisFunctionType>(
+          testSpace, testClusterTree.hMatDofToOriginalDofMap(), true));
+  shared_ptr<LocalDofListsCache<BasisFunctionType>> trialDofListsCache(
+      new LocalDofListsCache<BasisFunctionType>(
+          trialSpace, trialClusterTree.hMatDofToOriginalDofMap(), true));
+  std::vector<LocalAssemblerForIntegralOperators *> localAssemblers(
+      1, &localAssembler);
+  // The helper only reads the tree
+  WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType> helper(
+      testSpace, trialSpace,
+      boost::const_pointer_cast<hmat::DefaultBlockClusterTreeType>(
+          blockClusterTree),
+      localAssemblers, std::vector<const DiscreteBndOp *>(),
+      std::vector<ResultType>(1, 1.), std::vector<ResultType>(),
+      testDofListsCache, trialDofListsCache);
+
+  AssemblyReport report;
+  report.phases[AssemblyReport::GEOMETRY] = geometryTimer.elapsed();
+
+  const int maxThreadCount = options.parallelizationOptions().maxThreadCount();
+  shared_ptr<hmat::DefaultHMatrixType<ResultType>> hMatrix;
+  {
+    Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is
+                                    // single-threaded
+    compressWithSelectedCompressor(
+        helper, hMatOptions, verbosityAtLeastDefault,
+        [&](const hmat::HMatrixCompressor<ResultType, 2> &compressor) {
+          PostProcessingCompressor<ResultType> postProcessingCompressor(
+              compressor, hMatOptions);
+          hMatrix = previousHMatrix->withUpdatedLeaves(
+              leaves, postProcessingCompressor, maxThreadCount);
+        });
+  }
+
+  AssemblyPhaseTimer compressionTimer;
+  std::unique_ptr<DiscreteBndOp> result(
+      new DiscreteHMatBoundaryOperator<ResultType>(hMatrix));
+  attachReport(*result, compressionTimer, hMatrix->statistics().memSizeKb,
+               report);
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+HMatGlobalAssembler<BasisFunctionType, ResultType>::assemblePotentialOperator(
+    const arma::Mat<CoordinateType> &points,
+    const Space<BasisFunctionType> &trialSpace,
+    const std::vector<LocalAssemblerForPotentialOperators *> &localAssemblers,
+    const std::vector<ResultType> &termMultipliers,
+    const EvaluationOptions &options) {
+
+  if (localAssemblers.empty())
+    throw std::runtime_error("HMatGlobalAssembler::assemblePotentialOperator(): "
+                             "the 'localAssemblers' vector must not be empty");
+  if (points.n_rows > 3)
+    throw std::invalid_argument(
+        "HMatGlobalAssembler::assemblePotentialOperator(): "
+        "points from the array 'points' must have at most 3 coordinates");
+
+  const HMatOptions &hMatOptions = options.hMatOptions();
+  const bool verbosityAtLeastDefault =
+      (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
+
+  const unsigned int minBlockSize = hMatOptions.minBlockSize;
+  const unsigned int maxBlockSize = hMatOptions.maxBlockSize;
+  const double eta = hMatOptions.eta;
+  const double highFrequencyEta = hMatOptions.highFrequencyEta;
+
+  double waveNumber = 0.;
+  bool farField = false;
+  for (size_t i = 0; i < localAssemblers.size(); ++i) {
+    waveNumber = std::max(
+        waveNumber,
+        static_cast<double>(localAssemblers[i]->oscillationWaveNumber()));
+    farField = farField || localAssemblers[i]->isFarFieldOperator();
+  }
+
+  // Every component of the potential at a point is a separate row located
+  // at that point.
+  const int componentCount = localAssemblers[0]->resultDimension();
+  hmat::FlatGeometry pointGeometry;
+  pointGeometry.reserve(points.n_cols * componentCount);
+  for (std::size_t p = 0; p < points.n_cols; ++p) {
+    std::array<double, 3> center = {{0., 0., 0.}};
+    for (std::size_t d = 0; d < points.n_rows; ++d)
+      center[d] = points(d, p);
+    hmat::BoundingBox boundingBox(center[0], center[0], center[1], center[1],
+                                  center[2], center[2]);
+    for (int c = 0; c < componentCount; ++c)
+      pointGeometry.push_back(hmat::GeometryDataType(boundingBox, center));
+  }
+
+  auto pointClusterTree = shared_ptr<hmat::DefaultClusterTreeType>(
+      new hmat::DefaultClusterTreeType(pointGeometry, minBlockSize));
+  auto trialClusterTree =
+      HMatBlockClusterTreeCache<BasisFunctionType>::buildClusterTree(
+          trialSpace, minBlockSize);
+
+  // The rows of far-field operators are directions, so their distance from
+  // the surface is meaningless
+  hmat::AdmissibilityFunction admissibility;
+  if (highFrequencyEta > 0 && farField)
+    admissibility = hmat::FarFieldAdmissibility(waveNumber, highFrequencyEta);
+  else if (highFrequencyEta > 0 && waveNumber > 0)
+    admissibility =
+        hmat::HighFrequencyAdmissibility(eta, waveNumber, highFrequencyEta);
+  else
+    admissibility = hmat::StandardAdmissibility(eta);
+  auto blockClusterTree = shared_ptr<hmat::DefaultBlockClusterTreeType>(
+      new hmat::DefaultBlockClusterTreeType(pointClusterTree, trialClusterTree,
+                                            maxBlockSize, admissibility));
+
+  PotentialOperatorHMatAssemblyHelper<BasisFunctionType, ResultType> helper(
+      points, trialSpace, blockClusterTree, localAssemblers, termMultipliers);
+
+  const int maxThreadCount = options.parallelizationOptions().maxThreadCount();
+
+  AssemblyReport report;
+  return assembleHMatrix<ResultType>(blockClusterTree, helper,
+                                     hMatOptions, maxThreadCount,
+                                     verbosityAtLeastDefault, report);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<DiscreteBoundaryOperator<ResultType>>
+HMatGlobalAssembler<BasisFunctionType, ResultType>::assemblePotentialOperator(
+    const arma::Mat<CoordinateType> &points,
+    const Space<BasisFunctionType> &trialSpace,
+    LocalAssemblerForPotentialOperators &localAssembler,
+    const EvaluationOptions &options) {
+  std::vector<LocalAssemblerForPotentialOperators *> localAssemblers(
+      1, &localAssembler);
+  std::vector<ResultType> termMultipliers(1, 1.0);
+
+  return assemblePotentialOperator(points, trialSpace, localAssemblers,
+                                   termMultipliers, options);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(HMatGlobalAssembler);
 
 } // namespace Bempp
@@ -25,8 +25,10 @@
 
 #include "../common/armadillo_fwd.hpp"
 #include "../common/shared_ptr.hpp"
+#include "../fiber/kernel_tile_type.hpp"
 #include "../fiber/scalar_traits.hpp"
 
+#include <complex>
 #include <memory>
 #include <vector>
 
@@ -88,6 +90,51 @@ public:
       int symmetry); // used to be "bool symmetric"; fortunately "true"
                      // is converted to 1 == SYMMETRIC
 
+  /** \brief Assemble the weak form of an operator with a single Laplace or
+   *  modified Helmholtz kernel, compressing the admissible blocks by
+   *  interpolation of the kernel.
+   *
+   *  \p kernelType and \p waveNumber describe the kernel (see
+   *  Fiber::CollectionOfKernels::describeModifiedHelmholtz3dKernel()); it
+   *  must be integrated against the values of scalar test and trial
+   *  functions. The inadmissible blocks are evaluated by \p
+   *  localAssembler. The admissible ones are compressed by
+   *  hmat::HMatrixInterpolationCompressor, with the kernel interpolated on
+   *  the tensor Chebyshev nodes of order HMatOptions::interpolationOrder in
+   *  the cluster boxes, so no entries of these blocks are integrated. */
+  static std::unique_ptr<DiscreteBndOp> assembleDetachedWeakFormByInterpolation(
+      const Space<BasisFunctionType> &testSpace,
+      const Space<BasisFunctionType> &trialSpace,
+      LocalAssemblerForIntegralOperators &localAssembler,
+      Fiber::KernelTileType kernelType, std::complex<double> waveNumber,
+      const Context<BasisFunctionType, ResultType> &context, int symmetry);
+
+  /** \brief Update the weak form of an operator after a change of the
+   *  geometry of some elements, keeping the block structure of the
+   *  H-matrix.
+   *
+   *  \p previousWeakForm is the weak form of the operator assembled on a
+   *  grid differing from that of \p testSpace and \p trialSpace only by the
+   *  position of the elements whose indices are listed in \p
+   *  changedElements; the DOFs must be numbered in the same way. The leaves
+   *  of the H-matrix containing rows or columns of the DOFs living on these
+   *  elements are compressed again; the data of the other leaves are
+   *  shared with \p previousWeakForm.
+   *
+   *  Returns a null pointer if \p previousWeakForm cannot be updated in this
+   *  way, in which case the caller should assemble the weak form from
+   *  scratch: if it is not a complete H-matrix indexed with global DOFs, if
+   *  it is stored in a format built from a complete H-matrix (see
+   *  HMatOptions), or if an admissible block is no longer admissible in the
+   *  new geometry. */
+  static std::unique_ptr<DiscreteBndOp>
+  updateDetachedWeakForm(const Space<BasisFunctionType> &testSpace,
+                         const Space<BasisFunctionType> &trialSpace,
+                         LocalAssemblerForIntegralOperators &localAssembler,
+                         const DiscreteBndOp &previousWeakForm,
+                         const std::vector<int> &changedElements,
+                         const Context<BasisFunctionType, ResultType> &context);
+
   static std::unique_ptr<DiscreteBndOp> assemblePotentialOperator(
       const arma::Mat<CoordinateType> &points,
       const Space<BasisFunctionType> &trialSpace,
@@ -0,0 +1,171 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hmat_near_field_spai.hpp"
+#include "discrete_hmat_boundary_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../hmat/block_sparse_spai.hpp"
+#include <boost/numeric/conversion/converter.hpp>
+
+namespace Bempp {
+
+template <typename ValueType>
+HMatNearFieldSpai<ValueType>::HMatNearFieldSpai(
+    const DiscreteHMatBoundaryOperator<ValueType> &fwdOp)
+    : m_hMatrix(fwdOp.hMatrix()), m_hMatDofOrdering(fwdOp.hMatDofOrdering()),
+      // All range-domain swaps intended!
+      m_domainSpace(
+          Thyra::defaultSpmdVectorSpace<ValueType>(fwdOp.rowCount())),
+      m_rangeSpace(
+          Thyra::defaultSpmdVectorSpace<ValueType>(fwdOp.columnCount())) {
+
+  if (!m_hMatrix->nearField())
+    throw std::invalid_argument("HMatNearFieldSpai::HMatNearFieldSpai(): "
+                                "the near field of the H-matrix has not "
+                                "been extracted");
+  const auto &tree = *m_hMatrix->blockClusterTree();
+  if (tree.rowClusterTree()->hMatDofToOriginalDofMap() !=
+      tree.columnClusterTree()->hMatDofToOriginalDofMap())
+    throw std::invalid_argument("HMatNearFieldSpai::HMatNearFieldSpai(): "
+                                "row and column cluster trees differ");
+  m_inverse = hmat::sparseApproximateInverse(*m_hMatrix->nearField());
+}
+
+template <typename ValueType>
+unsigned int HMatNearFieldSpai<ValueType>::rowCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_inverse->rows());
+}
+
+template <typename ValueType>
+unsigned int HMatNearFieldSpai<ValueType>::columnCount() const {
+  return boost::numeric::converter<unsigned int, std::size_t>::convert(
+      m_inverse->columns());
+}
+
+template <typename ValueType>
+double HMatNearFieldSpai<ValueType>::memSizeKb() const {
+  return m_inverse->memSizeKb();
+}
+
+template <typename ValueType>
+void HMatNearFieldSpai<ValueType>::addBlock(const std::vector<int> &rows,
+                                            const std::vector<int> &cols,
+                                            const ValueType alpha,
+                                            arma::Mat<ValueType> &block) const {
+  throw std::runtime_error("HMatNearFieldSpai::addBlock(): "
+                           "not implemented");
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+HMatNearFieldSpai<ValueType>::domain() const {
+  return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+HMatNearFieldSpai<ValueType>::range() const {
+  return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool HMatNearFieldSpai<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const {
+  return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+          M_trans == Thyra::CONJTRANS);
+}
+
+template <typename ValueType>
+void HMatNearFieldSpai<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans, const arma::Col<ValueType> &x_in,
+    arma::Col<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void HMatNearFieldSpai<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
+
+  hmat::TransposeMode hmatTrans;
+  if (trans == TranspositionMode::NO_TRANSPOSE)
+    hmatTrans = hmat::NOTRANS;
+  else if (trans == TranspositionMode::TRANSPOSE)
+    hmatTrans = hmat::TRANS;
+  else if (trans == TranspositionMode::CONJUGATE)
+    hmatTrans = hmat::CONJ;
+  else
+    hmatTrans = hmat::CONJTRANS;
+
+  if (m_hMatDofOrdering) {
+    if (beta == ValueType(0))
+      y_inout.zeros();
+    else if (beta != ValueType(1))
+      y_inout *= beta;
+    m_inverse->apply(x_in, y_inout, hmatTrans, alpha);
+    return;
+  }
+
+  // The approximate inverse maps the range of the H-matrix to its domain
+  const bool transposed =
+      (hmatTrans == hmat::TRANS || hmatTrans == hmat::CONJTRANS);
+  const hmat::RowColSelector inputSelector = transposed ? hmat::COL : hmat::ROW;
+  const hmat::RowColSelector outputSelector =
+      transposed ? hmat::ROW : hmat::COL;
+  arma::Mat<ValueType> xPermuted, yPermuted;
+  m_hMatrix->permuteMatToHMatDofs(x_in, inputSelector, xPermuted);
+  if (beta == ValueType(0))
+    yPermuted.zeros(y_inout.n_rows, y_inout.n_cols);
+  else {
+    m_hMatrix->permuteMatToHMatDofs(y_inout, outputSelector, yPermuted);
+    if (beta != ValueType(1))
+      yPermuted *= beta;
+  }
+  m_inverse->apply(xPermuted, yPermuted, hmatTrans, alpha);
+  m_hMatrix->permuteMatToOriginalDofs(yPermuted, outputSelector, y_inout);
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> hMatOperatorNearFieldSpai(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op) {
+  shared_ptr<const DiscreteHMatBoundaryOperator<ValueType>> hMatOp =
+      boost::dynamic_pointer_cast<
+          const DiscreteHMatBoundaryOperator<ValueType>>(op);
+  if (!hMatOp)
+    throw std::invalid_argument("hMatOperatorNearFieldSpai(): "
+                                "operator is not stored as a H-matrix");
+  shared_ptr<const DiscreteBoundaryOperator<ValueType>> result(
+      new HMatNearFieldSpai<ValueType>(*hMatOp));
+  return result;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(HMatNearFieldSpai);
+
+#define INSTANTIATE_FREE_FUNCTIONS(RESULT)                                     \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  hMatOperatorNearFieldSpai(                                                   \
+      const shared_ptr<const DiscreteBoundaryOperator<RESULT>> &op)
+
+FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_FREE_FUNCTIONS);
+
+} // namespace Bempp
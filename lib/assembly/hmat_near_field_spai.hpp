@@ -0,0 +1,115 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_hmat_near_field_spai_hpp
+#define bempp_hmat_near_field_spai_hpp
+
+#include "bempp/common/config_trilinos.hpp"
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#include "../hmat/block_sparse_matrix.hpp"
+#include "../hmat/hmatrix.hpp"
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteHMatBoundaryOperator;
+/** \endcond */
+
+/** \ingroup composite_discrete_operators
+ *  \brief Sparse approximate inverse of the near field of an operator stored
+ *  as a native H-matrix.
+ *
+ *  The approximate inverse is computed from the inadmissible leaves of the
+ *  H-matrix only, by hmat::sparseApproximateInverse(): the columns
+ *  belonging to each leaf cluster are obtained from a small local problem
+ *  on the neighbouring clusters, and all local problems are solved in
+ *  parallel. The result is a block-sparse matrix with the sparsity of the
+ *  near field. It is much cheaper to build than an approximate LU
+ *  decomposition and cheap to apply, and serves as a preconditioner for
+ *  first-kind operators, for instance through
+ *  discreteOperatorToPreconditioner().
+ *
+ *  The near field must have been extracted (HMat parameter
+ *  "blockSparseNearField") and the test and trial spaces of the operator
+ *  must be equal. */
+template <typename ValueType>
+class HMatNearFieldSpai : public DiscreteBoundaryOperator<ValueType> {
+public:
+  /** \brief Constructor.
+
+  \param[in] fwdOp  Operator whose near field is inverted. */
+  explicit HMatNearFieldSpai(
+      const DiscreteHMatBoundaryOperator<ValueType> &fwdOp);
+
+  unsigned int rowCount() const override;
+  unsigned int columnCount() const override;
+
+  /** \brief Storage of the approximate inverse in kB. */
+  double memSizeKb() const;
+
+  void addBlock(const std::vector<int> &rows, const std::vector<int> &cols,
+                const ValueType alpha, arma::Mat<ValueType> &block) const
+      override;
+
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> domain() const;
+  Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const;
+
+protected:
+  bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+
+private:
+  void applyBuiltInImpl(const TranspositionMode trans,
+                        const arma::Col<ValueType> &x_in,
+                        arma::Col<ValueType> &y_inout, const ValueType alpha,
+                        const ValueType beta) const override;
+
+  void applyBuiltInBlockImpl(const TranspositionMode trans,
+                             const arma::Mat<ValueType> &x_in,
+                             arma::Mat<ValueType> &y_inout,
+                             const ValueType alpha,
+                             const ValueType beta) const override;
+
+  shared_ptr<const hmat::DefaultHMatrixType<ValueType>> m_hMatrix;
+  shared_ptr<const hmat::BlockSparseMatrix<ValueType>> m_inverse;
+  bool m_hMatDofOrdering;
+
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_domainSpace;
+  Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType>> m_rangeSpace;
+};
+
+/** \relates HMatNearFieldSpai
+ *  \brief Sparse approximate inverse of the near field of a discrete
+ *  boundary operator stored as a native H-matrix.
+ *
+ *  \param[in] op Operator of type DiscreteHMatBoundaryOperator whose near
+ *  field has been extracted.
+ *
+ *  \return A shared pointer to a newly allocated HMatNearFieldSpai. */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>> hMatOperatorNearFieldSpai(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op);
+
+} // namespace Bempp
+
+#endif
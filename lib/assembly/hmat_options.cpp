@@ -0,0 +1,200 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hmat_options.hpp"
+
+#include "../common/global_parameters.hpp"
+
+#include <Teuchos_ParameterList.hpp>
+#include <boost/functional/hash.hpp>
+#include <stdexcept>
+
+namespace Bempp {
+
+namespace {
+
+// The block sizes are set as int by GlobalParameters but may be given as
+// unsigned int by user code
+unsigned int getBlockSize(const ParameterList &parameters,
+                          const std::string &name) {
+  if (parameters.isType<unsigned int>(name))
+    return parameters.get<unsigned int>(name);
+  return static_cast<unsigned int>(parameters.get<int>(name));
+}
+
+std::string getChoice(const ParameterList &parameters, const std::string &name,
+                      const char *first, const char *second) {
+  std::string value = parameters.get<std::string>(name);
+  if (value != first && value != second)
+    throw std::runtime_error("HMatOptions::HMatOptions(): "
+                             "Unknown " + name + ": " + value);
+  return value;
+}
+
+} // namespace
+
+HMatOptions::HMatOptions()
+    : HMatOptions(GlobalParameters::parameterList().sublist("HMat")) {}
+
+HMatOptions::HMatOptions(const ParameterList &parameters) {
+  indexWithGlobalDofs = (getChoice(parameters, "HMatAssemblyMode",
+                                   "GlobalAssembly", "LocalAssembly") ==
+                         "GlobalAssembly");
+  minBlockSize = getBlockSize(parameters, "minBlockSize");
+  maxBlockSize = getBlockSize(parameters, "maxBlockSize");
+  eta = parameters.get<double>("eta");
+  highFrequencyEta = parameters.get<double>("highFrequencyEta");
+  weakAdmissibility =
+      (getChoice(parameters, "admissibility", "standard", "weak") == "weak");
+  eps = parameters.get<double>("eps");
+  maxRank = parameters.get<int>("maxRank");
+
+  const std::string algorithm =
+      parameters.get<std::string>("defaultCompressionAlg");
+  if (algorithm == "aca")
+    compressionAlgorithm = ACA;
+  else if (algorithm == "aca+")
+    compressionAlgorithm = ACA_PLUS;
+  else if (algorithm == "dense")
+    compressionAlgorithm = DENSE;
+  else if (algorithm == "interpolation")
+    compressionAlgorithm = INTERPOLATION;
+  else
+    throw std::runtime_error("HMatOptions::HMatOptions(): "
+                             "Unknown compression algorithm: " + algorithm);
+
+  acaPivotBatchSize = parameters.get<int>("acaPivotBatchSize");
+  acaWarmStart = parameters.get<bool>("acaWarmStart");
+  interpolationOrder = parameters.get<int>("interpolationOrder");
+  interpolationQuadratureOrder =
+      parameters.get<int>("interpolationQuadratureOrder");
+  adaptiveMaxRank = (getChoice(parameters, "maxRankPolicy", "truncate",
+                               "adaptive") == "adaptive");
+  epsRelativeToMatrix =
+      (getChoice(parameters, "epsReference", "block", "matrix") == "matrix");
+  cacheClusterTrees = parameters.get<bool>("cacheClusterTrees");
+  recompress = parameters.get<bool>("recompress");
+  frozenLayout = parameters.get<bool>("frozenLayout");
+  outOfCoreDirectory = parameters.get<std::string>("outOfCoreDirectory");
+  blockSparseNearField = parameters.get<bool>("blockSparseNearField");
+  groupedLowRankApply = parameters.get<bool>("groupedLowRankApply");
+  singlePrecisionLowRankBlocks =
+      (getChoice(parameters, "lowRankStoragePrecision", "full", "single") ==
+       "single");
+  denseStorageBits = parameters.get<int>("denseStorageBits");
+  if (denseStorageBits != 0 && denseStorageBits != 8 &&
+      denseStorageBits != 16 && denseStorageBits != 24 &&
+      denseStorageBits != 32)
+    throw std::runtime_error("HMatOptions::HMatOptions(): "
+                             "denseStorageBits must be 0, 8, 16, 24 or 32");
+  h2Matrix = parameters.get<bool>("h2Matrix");
+  distributed = parameters.get<bool>("distributed");
+  symmetricStorage = parameters.get<bool>("symmetricStorage");
+  statisticsFile = parameters.get<std::string>("statisticsFile");
+  checkpointFile = parameters.get<std::string>("checkpointFile");
+  checkpointInterval = parameters.get<double>("checkpointInterval");
+  if (checkpointInterval < 0)
+    throw std::runtime_error("HMatOptions::HMatOptions(): "
+                             "checkpointInterval must not be negative");
+}
+
+std::size_t HMatOptions::hash() const {
+  std::size_t result = 0;
+  boost::hash_combine(result, indexWithGlobalDofs);
+  boost::hash_combine(result, minBlockSize);
+  boost::hash_combine(result, maxBlockSize);
+  boost::hash_combine(result, eta);
+  boost::hash_combine(result, highFrequencyEta);
+  boost::hash_combine(result, weakAdmissibility);
+  boost::hash_combine(result, eps);
+  boost::hash_combine(result, maxRank);
+  boost::hash_combine(result, static_cast<int>(compressionAlgorithm));
+  boost::hash_combine(result, acaPivotBatchSize);
+  boost::hash_combine(result, acaWarmStart);
+  boost::hash_combine(result, interpolationOrder);
+  boost::hash_combine(result, interpolationQuadratureOrder);
+  boost::hash_combine(result, adaptiveMaxRank);
+  boost::hash_combine(result, epsRelativeToMatrix);
+  boost::hash_combine(result, cacheClusterTrees);
+  boost::hash_combine(result, recompress);
+  boost::hash_combine(result, frozenLayout);
+  boost::hash_combine(result, outOfCoreDirectory);
+  boost::hash_combine(result, blockSparseNearField);
+  boost::hash_combine(result, groupedLowRankApply);
+  boost::hash_combine(result, singlePrecisionLowRankBlocks);
+  boost::hash_combine(result, denseStorageBits);
+  boost::hash_combine(result, h2Matrix);
+  boost::hash_combine(result, distributed);
+  boost::hash_combine(result, symmetricStorage);
+  boost::hash_combine(result, statisticsFile);
+  boost::hash_combine(result, checkpointFile);
+  boost::hash_combine(result, checkpointInterval);
+  return result;
+}
+
+std::size_t HMatOptions::compressionHash() const {
+  std::size_t result = 0;
+  boost::hash_combine(result, indexWithGlobalDofs);
+  boost::hash_combine(result, minBlockSize);
+  boost::hash_combine(result, maxBlockSize);
+  boost::hash_combine(result, eta);
+  boost::hash_combine(result, highFrequencyEta);
+  boost::hash_combine(result, weakAdmissibility);
+  boost::hash_combine(result, eps);
+  boost::hash_combine(result, maxRank);
+  boost::hash_combine(result, static_cast<int>(compressionAlgorithm));
+  boost::hash_combine(result, acaPivotBatchSize);
+  boost::hash_combine(result, interpolationOrder);
+  boost::hash_combine(result, interpolationQuadratureOrder);
+  boost::hash_combine(result, adaptiveMaxRank);
+  boost::hash_combine(result, epsRelativeToMatrix);
+  return result;
+}
+
+bool HMatOptions::operator==(const HMatOptions &other) const {
+  return indexWithGlobalDofs == other.indexWithGlobalDofs &&
+         minBlockSize == other.minBlockSize &&
+         maxBlockSize == other.maxBlockSize && eta == other.eta &&
+         highFrequencyEta == other.highFrequencyEta &&
+         weakAdmissibility == other.weakAdmissibility && eps == other.eps &&
+         maxRank == other.maxRank &&
+         compressionAlgorithm == other.compressionAlgorithm &&
+         acaPivotBatchSize == other.acaPivotBatchSize &&
+         acaWarmStart == other.acaWarmStart &&
+         interpolationOrder == other.interpolationOrder &&
+         interpolationQuadratureOrder == other.interpolationQuadratureOrder &&
+         adaptiveMaxRank == other.adaptiveMaxRank &&
+         epsRelativeToMatrix == other.epsRelativeToMatrix &&
+         cacheClusterTrees == other.cacheClusterTrees &&
+         recompress == other.recompress &&
+         frozenLayout == other.frozenLayout &&
+         outOfCoreDirectory == other.outOfCoreDirectory &&
+         blockSparseNearField == other.blockSparseNearField &&
+         groupedLowRankApply == other.groupedLowRankApply &&
+         singlePrecisionLowRankBlocks == other.singlePrecisionLowRankBlocks &&
+         denseStorageBits == other.denseStorageBits &&
+         h2Matrix == other.h2Matrix && distributed == other.distributed &&
+         symmetricStorage == other.symmetricStorage &&
+         statisticsFile == other.statisticsFile &&
+         checkpointFile == other.checkpointFile &&
+         checkpointInterval == other.checkpointInterval;
+}
+
+} // namespace Bempp
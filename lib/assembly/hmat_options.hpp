@@ -0,0 +1,114 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_hmat_options_hpp
+#define bempp_hmat_options_hpp
+
+#include "../common/common.hpp"
+#include "../common/types.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace Bempp {
+
+/** \ingroup weak_form_assembly
+ *  \brief Typed snapshot of the "HMat" sublist of the global parameters.
+ *
+ *  The parameters are read and validated once, when the Context or the
+ *  EvaluationOptions are constructed, so that the H-matrix assembly does not
+ *  look them up by name. See GlobalParameters for the meaning of the
+ *  individual parameters.
+ */
+class HMatOptions {
+public:
+  /** \brief Compression algorithms of admissible blocks. */
+  enum CompressionAlgorithm {
+    /** \brief Partially pivoted ACA ("aca"). */
+    ACA,
+    /** \brief ACA with reference row and column ("aca+"). */
+    ACA_PLUS,
+    /** \brief Complete evaluation of all blocks ("dense"). */
+    DENSE,
+    /** \brief Chebyshev interpolation of the kernel in the cluster boxes
+     *  ("interpolation"); see hmat::HMatrixInterpolationCompressor. */
+    INTERPOLATION
+  };
+
+  /** \brief Read the "HMat" sublist of GlobalParameters::parameterList(). */
+  HMatOptions();
+
+  /** \brief Read the given "HMat" parameter list.
+   *
+   *  An exception is thrown if a string parameter has an unsupported
+   *  value. */
+  explicit HMatOptions(const ParameterList &hMatParameterList);
+
+  /** \brief Hash of all options, e.g. for keys of caches. */
+  std::size_t hash() const;
+
+  bool operator==(const HMatOptions &other) const;
+  bool operator!=(const HMatOptions &other) const { return !(*this == other); }
+
+  /** \brief True if HMatAssemblyMode is "GlobalAssembly". */
+  bool indexWithGlobalDofs;
+  unsigned int minBlockSize;
+  unsigned int maxBlockSize;
+  double eta;
+  double highFrequencyEta;
+  /** \brief True if admissibility is "weak". */
+  bool weakAdmissibility;
+  double eps;
+  int maxRank;
+  CompressionAlgorithm compressionAlgorithm;
+  int acaPivotBatchSize;
+  bool acaWarmStart;
+  int interpolationOrder;
+  int interpolationQuadratureOrder;
+  /** \brief True if maxRankPolicy is "adaptive". */
+  bool adaptiveMaxRank;
+  /** \brief True if epsReference is "matrix". */
+  bool epsRelativeToMatrix;
+  bool cacheClusterTrees;
+  bool recompress;
+  bool frozenLayout;
+  std::string outOfCoreDirectory;
+  bool blockSparseNearField;
+  bool groupedLowRankApply;
+  /** \brief True if lowRankStoragePrecision is "single". */
+  bool singlePrecisionLowRankBlocks;
+  /** \brief Bits per real value of compressed dense blocks, 0 if they are
+   *  stored uncompressed. */
+  int denseStorageBits;
+  bool h2Matrix;
+  bool distributed;
+  bool symmetricStorage;
+  std::string statisticsFile;
+  std::string checkpointFile;
+  double checkpointInterval;
+
+  /** \brief Hash of the options that determine the leaves of the
+   *  compressed H-matrix, for the signature of checkpoint files. */
+  std::size_t compressionHash() const;
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,523 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hmat_parameter_tuner.hpp"
+
+#include "assembly_options.hpp"
+#include "boundary_operator.hpp"
+#include "context.hpp"
+#include "elementary_integral_operator_base.hpp"
+#include "hmat_block_cluster_tree_cache.hpp"
+#include "hmat_options.hpp"
+#include "local_dof_lists_cache.hpp"
+#include "weak_form_hmat_assembly_helper.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/local_assembler_for_integral_operators.hpp"
+#include "../space/space.hpp"
+
+#include "../hmat/block_cluster_tree.hpp"
+#include "../hmat/cluster_tree.hpp"
+#include "../hmat/hmatrix_aca_compressor.hpp"
+#include "../hmat/hmatrix_data.hpp"
+
+#include <tbb/tick_count.h>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace Bempp {
+
+namespace {
+
+typedef hmat::DefaultBlockClusterTreeNodeType BlockNode;
+typedef shared_ptr<const BlockNode> BlockNodePtr;
+
+// Number of products timed per sampled leaf
+const int productRepetitions = 10;
+
+const char *const quadratureBands[] = {"near", "medium", "far"};
+
+const hmat::IndexRangeType &rowRange(const BlockNode &leaf) {
+  return leaf.data().rowClusterTreeNode->data().indexRange;
+}
+
+const hmat::IndexRangeType &columnRange(const BlockNode &leaf) {
+  return leaf.data().columnClusterTreeNode->data().indexRange;
+}
+
+std::size_t rowCount(const BlockNode &leaf) {
+  return rowRange(leaf)[1] - rowRange(leaf)[0];
+}
+
+std::size_t columnCount(const BlockNode &leaf) {
+  return columnRange(leaf)[1] - columnRange(leaf)[0];
+}
+
+std::size_t entryCount(const BlockNode &leaf) {
+  return rowCount(leaf) * columnCount(leaf);
+}
+
+void splitLeaves(const hmat::DefaultBlockClusterTreeType &tree,
+                 std::vector<BlockNodePtr> &admissibleLeaves,
+                 std::vector<BlockNodePtr> &denseLeaves) {
+  for (const auto &leaf : tree.leafNodes())
+    (leaf->data().admissible ? admissibleLeaves : denseLeaves).push_back(leaf);
+}
+
+// At most count leaves spread evenly over the list
+std::vector<BlockNodePtr> evenlySpread(const std::vector<BlockNodePtr> &leaves,
+                                       int count) {
+  std::vector<BlockNodePtr> result;
+  const std::size_t n =
+      std::min(leaves.size(), static_cast<std::size_t>(std::max(count, 0)));
+  for (std::size_t i = 0; i < n; ++i)
+    result.push_back(leaves[i * leaves.size() / n]);
+  return result;
+}
+
+// Leaf of median size, off the diagonal if there is any such leaf
+BlockNodePtr medianLeaf(const std::vector<BlockNodePtr> &leaves) {
+  std::vector<BlockNodePtr> candidates;
+  for (const auto &leaf : leaves)
+    if (rowRange(*leaf) != columnRange(*leaf))
+      candidates.push_back(leaf);
+  if (candidates.empty())
+    candidates = leaves;
+  if (candidates.empty())
+    return BlockNodePtr();
+  std::sort(candidates.begin(), candidates.end(),
+            [](const BlockNodePtr &a, const BlockNodePtr &b) {
+              return entryCount(*a) < entryCount(*b);
+            });
+  return candidates[candidates.size() / 2];
+}
+
+// Rank of the sampled leaf closest in size, given (rows + columns, rank)
+// pairs sorted by size
+int predictedRank(const std::vector<std::pair<std::size_t, int>> &samples,
+                  std::size_t size) {
+  if (samples.empty())
+    return 0;
+  auto it = std::lower_bound(
+      samples.begin(), samples.end(),
+      std::make_pair(size, std::numeric_limits<int>::min()));
+  if (it == samples.end())
+    return samples.back().second;
+  if (it != samples.begin() && size - std::prev(it)->first < it->first - size)
+    --it;
+  return it->second;
+}
+
+// Copy of the parameters with the orders of the regular integrals of all
+// bands changed by increment
+ParameterList withQuadratureOrderIncrement(const ParameterList &parameters,
+                                           int increment) {
+  ParameterList result(parameters);
+  ParameterList &orders = result.sublist("QuadratureOrders");
+  for (const char *band : quadratureBands) {
+    ParameterList &bandOrders = orders.sublist(band);
+    bandOrders.set("singleOrder",
+                   bandOrders.get<int>("singleOrder") + increment);
+    bandOrders.set("doubleOrder",
+                   bandOrders.get<int>("doubleOrder") + increment);
+  }
+  return result;
+}
+
+// Smallest increment keeping relative orders nonnegative and absolute
+// orders positive
+int minQuadratureOrderIncrement(const ParameterList &parameters) {
+  const ParameterList &orders = parameters.sublist("QuadratureOrders");
+  int minOrder = std::numeric_limits<int>::max();
+  for (const char *band : quadratureBands) {
+    const ParameterList &bandOrders = orders.sublist(band);
+    minOrder = std::min(minOrder, bandOrders.get<int>("singleOrder"));
+    minOrder = std::min(minOrder, bandOrders.get<int>("doubleOrder"));
+  }
+  return (orders.get<bool>("quadratureOrdersAreRelative") ? 0 : 1) - minOrder;
+}
+
+template <typename ValueType>
+double relativeDifference(const arma::Mat<ValueType> &block,
+                          const arma::Mat<ValueType> &reference) {
+  const double norm = arma::norm(reference, "fro");
+  const double difference = arma::norm(block - reference, "fro");
+  return norm > 0 ? difference / norm : difference;
+}
+
+template <typename Function> double timed(const Function &function) {
+  const tbb::tick_count start = tbb::tick_count::now();
+  function();
+  return (tbb::tick_count::now() - start).seconds();
+}
+
+template <typename ResultType>
+shared_ptr<hmat::HMatrixData<ResultType>>
+compressLeaf(const hmat::DataAccessor<ResultType, 2> &dataAccessor,
+             const BlockNode &leaf, double eps) {
+  hmat::HMatrixAcaCompressor<ResultType, 2> compressor(
+      dataAccessor, eps, std::min(rowCount(leaf), columnCount(leaf)));
+  shared_ptr<hmat::HMatrixData<ResultType>> data;
+  compressor.compressBlock(leaf, data);
+  return data;
+}
+
+// Evaluates leaves of the weak form of an operator with the quadrature
+// given by a parameter list
+template <typename BasisFunctionType, typename ResultType>
+class LeafSampler {
+public:
+  typedef WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType> Helper;
+  typedef typename HMatBlockClusterTreeCache<BasisFunctionType>::Entry Trees;
+
+  LeafSampler(
+      const ElementaryIntegralOperatorBase<BasisFunctionType, ResultType> &op,
+      const Space<BasisFunctionType> &testSpace,
+      const Space<BasisFunctionType> &trialSpace,
+      const ParameterList &parameters)
+      : m_testSpace(testSpace), m_trialSpace(trialSpace),
+        m_context(parameters), m_denseMultipliers(1, ResultType(1.)) {
+    // Only a few leaves are evaluated, so precomputing all the singular
+    // integrals would not pay off
+    AssemblyOptions options = m_context.assemblyOptions();
+    options.enableSingularIntegralCaching(false);
+    m_assembler = op.makeAssembler(*m_context.quadStrategy(), options);
+    m_assemblers.push_back(m_assembler.get());
+  }
+
+  std::unique_ptr<Helper> helper(const Trees &trees) const {
+    return std::unique_ptr<Helper>(new Helper(
+        m_testSpace, m_trialSpace, trees.blockClusterTree, m_assemblers,
+        m_sparseTerms, m_denseMultipliers, m_sparseMultipliers,
+        trees.testDofListsCache, trees.trialDofListsCache));
+  }
+
+  std::vector<arma::Mat<ResultType>>
+  evaluate(const Trees &trees, const std::vector<BlockNodePtr> &leaves) const {
+    std::unique_ptr<Helper> accessor = helper(trees);
+    std::vector<arma::Mat<ResultType>> blocks(leaves.size());
+    for (std::size_t i = 0; i < leaves.size(); ++i)
+      accessor->computeMatrixBlock(rowRange(*leaves[i]),
+                                   columnRange(*leaves[i]), *leaves[i],
+                                   blocks[i]);
+    return blocks;
+  }
+
+private:
+  const Space<BasisFunctionType> &m_testSpace;
+  const Space<BasisFunctionType> &m_trialSpace;
+  Context<BasisFunctionType, ResultType> m_context;
+  std::unique_ptr<typename Helper::LocalAssembler> m_assembler;
+  std::vector<typename Helper::LocalAssembler *> m_assemblers;
+  std::vector<const typename Helper::DiscreteLinOp *> m_sparseTerms;
+  std::vector<ResultType> m_denseMultipliers;
+  std::vector<ResultType> m_sparseMultipliers;
+};
+
+// Leaf statistics of a candidate block cluster tree
+struct TreeStatistics {
+  TreeStatistics(double eta_, int minBlockSize_, int maxBlockSize_)
+      : eta(eta_), minBlockSize(minBlockSize_), maxBlockSize(maxBlockSize_),
+        denseEntries(0.), lowRankEntries(0.), maxRank(0) {}
+
+  double eta;
+  int minBlockSize;
+  int maxBlockSize;
+  // Entries of the dense leaves
+  double denseEntries;
+  // Predicted entries of the factors of the admissible leaves
+  double lowRankEntries;
+  // Largest rank of the sampled admissible leaves
+  int maxRank;
+};
+
+// Times and numbers of entries measured on the sampled leaves of all
+// candidate trees
+struct CostSamples {
+  CostSamples()
+      : integrationTime(0.), integratedEntries(0.), acaTime(0.),
+        acaEntries(0.), productTime(0.), productEntries(0.) {}
+
+  static double perEntry(double time, double entries) {
+    return entries > 0 ? time / entries : 0.;
+  }
+
+  double assemblyTime(const TreeStatistics &tree) const {
+    // ACA evaluates about as many entries as its factors have
+    return tree.denseEntries * perEntry(integrationTime, integratedEntries) +
+           tree.lowRankEntries * perEntry(acaTime, acaEntries);
+  }
+
+  double matvecTime(const TreeStatistics &tree) const {
+    return (tree.denseEntries + tree.lowRankEntries) *
+           perEntry(productTime, productEntries);
+  }
+
+  double integrationTime;
+  double integratedEntries;
+  double acaTime;
+  double acaEntries;
+  double productTime;
+  double productEntries;
+};
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+HMatParameterTuner<BasisFunctionType, ResultType>::HMatParameterTuner(
+    const HMatTuningTargets &targets)
+    : m_targets(targets) {
+  if (!(targets.accuracy > 0))
+    throw std::invalid_argument("HMatParameterTuner::HMatParameterTuner(): "
+                                "accuracy must be positive");
+}
+
+template <typename BasisFunctionType, typename ResultType>
+HMatTuningResult HMatParameterTuner<BasisFunctionType, ResultType>::tune(
+    const BoundaryOperator<BasisFunctionType, ResultType> &op) const {
+  typedef ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>
+      Operator;
+  typedef HMatBlockClusterTreeCache<BasisFunctionType> TreeCache;
+  typedef LeafSampler<BasisFunctionType, ResultType> Sampler;
+  typedef typename Sampler::Trees Trees;
+
+  shared_ptr<const Operator> elementaryOp =
+      boost::dynamic_pointer_cast<const Operator>(op.abstractOperator());
+  if (!elementaryOp || !op.context())
+    throw std::invalid_argument("HMatParameterTuner::tune(): operator must "
+                                "be an initialized elementary integral "
+                                "operator");
+  const Context<BasisFunctionType, ResultType> &context = *op.context();
+  const HMatOptions &hMatOptions = context.hMatOptions();
+  ParameterList parameters = context.globalParameterList();
+
+  // The H-matrix is indexed by the DOFs of the discontinuous spaces unless
+  // "indexWithGlobalDofs" is set
+  shared_ptr<const Space<BasisFunctionType>> testSpace = op.dualToRange();
+  shared_ptr<const Space<BasisFunctionType>> trialSpace = op.domain();
+  if (!hMatOptions.indexWithGlobalDofs) {
+    testSpace = testSpace->discontinuousSpace(testSpace);
+    trialSpace = trialSpace->discontinuousSpace(trialSpace);
+  }
+
+  HMatTuningResult result;
+
+  // Quadrature: probe a typical admissible and dense leaf of the tree of
+  // the current parameters
+  const Trees currentTrees = TreeCache::build(
+      *testSpace, *trialSpace, hMatOptions.minBlockSize,
+      hMatOptions.maxBlockSize, hMatOptions.eta);
+  std::vector<BlockNodePtr> currentAdmissibleLeaves, currentDenseLeaves;
+  splitLeaves(*currentTrees.blockClusterTree, currentAdmissibleLeaves,
+              currentDenseLeaves);
+  const BlockNodePtr admissibleProbe = medianLeaf(currentAdmissibleLeaves);
+  std::vector<BlockNodePtr> probes;
+  if (admissibleProbe)
+    probes.push_back(admissibleProbe);
+  if (BlockNodePtr denseProbe = medianLeaf(currentDenseLeaves))
+    probes.push_back(denseProbe);
+
+  const double quadratureAccuracy = m_targets.quadratureAccuracy > 0
+                                        ? m_targets.quadratureAccuracy
+                                        : m_targets.accuracy / 10;
+  const int maxIncrement = m_targets.maxQuadratureOrderIncrement;
+  const int minIncrement =
+      std::min(minQuadratureOrderIncrement(parameters), maxIncrement);
+  const std::vector<arma::Mat<ResultType>> reference =
+      Sampler(*elementaryOp, *testSpace, *trialSpace,
+              withQuadratureOrderIncrement(parameters, maxIncrement + 2))
+          .evaluate(currentTrees, probes);
+  for (int increment = minIncrement; increment <= maxIncrement; ++increment) {
+    const std::vector<arma::Mat<ResultType>> blocks =
+        Sampler(*elementaryOp, *testSpace, *trialSpace,
+                withQuadratureOrderIncrement(parameters, increment))
+            .evaluate(currentTrees, probes);
+    result.quadratureOrderIncrement = increment;
+    result.quadratureError = 0.;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+      result.quadratureError = std::max(
+          result.quadratureError, relativeDifference(blocks[i], reference[i]));
+    if (result.quadratureError <= quadratureAccuracy)
+      break;
+  }
+  parameters =
+      withQuadratureOrderIncrement(parameters, result.quadratureOrderIncrement);
+  const Sampler sampler(*elementaryOp, *testSpace, *trialSpace, parameters);
+
+  // ACA tolerance: the block-relative tolerance may have to be tighter
+  // than the accuracy for the rank to be revealed reliably
+  double eps = m_targets.accuracy;
+  result.blockError = 0.;
+  if (admissibleProbe) {
+    const int maxTightenings = 3;
+    const arma::Mat<ResultType> block =
+        sampler.evaluate(currentTrees, std::vector<BlockNodePtr>(
+                                           1, admissibleProbe)).front();
+    const arma::Mat<ResultType> identity =
+        arma::eye<arma::Mat<ResultType>>(block.n_cols, block.n_cols);
+    std::unique_ptr<typename Sampler::Helper> accessor =
+        sampler.helper(currentTrees);
+    for (int tightening = 0;; ++tightening) {
+      shared_ptr<hmat::HMatrixData<ResultType>> data =
+          compressLeaf(*accessor, *admissibleProbe, eps);
+      arma::Mat<ResultType> approximation(block.n_rows, block.n_cols);
+      data->apply(identity, approximation, hmat::NOTRANS, ResultType(1.),
+                  ResultType(0.));
+      result.blockError = relativeDifference(approximation, block);
+      if (result.blockError <= m_targets.accuracy ||
+          tightening == maxTightenings)
+        break;
+      eps /= 10;
+    }
+  }
+
+  // Trees: sample the leaves of every candidate
+  const std::vector<double> etas = m_targets.etaCandidates.empty()
+                                       ? std::vector<double>(1, hMatOptions.eta)
+                                       : m_targets.etaCandidates;
+  const std::vector<int> minBlockSizes =
+      m_targets.minBlockSizeCandidates.empty()
+          ? std::vector<int>(1, hMatOptions.minBlockSize)
+          : m_targets.minBlockSizeCandidates;
+  const std::vector<int> maxBlockSizes =
+      m_targets.maxBlockSizeCandidates.empty()
+          ? std::vector<int>(1, hMatOptions.maxBlockSize)
+          : m_targets.maxBlockSizeCandidates;
+  std::vector<TreeStatistics> trees;
+  CostSamples costs;
+  for (double eta : etas)
+    for (int minBlockSize : minBlockSizes)
+      for (int maxBlockSize : maxBlockSizes) {
+        if (maxBlockSize < minBlockSize)
+          continue;
+        const Trees candidate = TreeCache::build(
+            *testSpace, *trialSpace, minBlockSize, maxBlockSize, eta);
+        std::unique_ptr<typename Sampler::Helper> accessor =
+            sampler.helper(candidate);
+        std::vector<BlockNodePtr> admissibleLeaves, denseLeaves;
+        splitLeaves(*candidate.blockClusterTree, admissibleLeaves,
+                    denseLeaves);
+        TreeStatistics tree(eta, minBlockSize, maxBlockSize);
+
+        for (const auto &leaf : denseLeaves)
+          tree.denseEntries += entryCount(*leaf);
+        for (const auto &leaf :
+             evenlySpread(denseLeaves, m_targets.sampleBlockCount)) {
+          arma::Mat<ResultType> block;
+          costs.integrationTime += timed([&]() {
+            accessor->computeMatrixBlock(rowRange(*leaf), columnRange(*leaf),
+                                         *leaf, block);
+          });
+          costs.integratedEntries += block.n_elem;
+          const arma::Mat<ResultType> x =
+              arma::ones<arma::Mat<ResultType>>(block.n_cols, 1);
+          arma::Mat<ResultType> y;
+          costs.productTime += timed([&]() {
+            for (int i = 0; i < productRepetitions; ++i)
+              y = block * x;
+          });
+          costs.productEntries += productRepetitions * block.n_elem;
+        }
+
+        std::vector<std::pair<std::size_t, int>> ranks;
+        for (const auto &leaf :
+             evenlySpread(admissibleLeaves, m_targets.sampleBlockCount)) {
+          shared_ptr<hmat::HMatrixData<ResultType>> data;
+          costs.acaTime +=
+              timed([&]() { data = compressLeaf(*accessor, *leaf, eps); });
+          const std::size_t size = rowCount(*leaf) + columnCount(*leaf);
+          const double entries = static_cast<double>(data->rank()) * size;
+          costs.acaEntries += entries;
+          const arma::Mat<ResultType> x =
+              arma::ones<arma::Mat<ResultType>>(columnCount(*leaf), 1);
+          arma::Mat<ResultType> y(rowCount(*leaf), 1);
+          costs.productTime += timed([&]() {
+            for (int i = 0; i < productRepetitions; ++i)
+              data->apply(x, y, hmat::NOTRANS, ResultType(1.), ResultType(0.));
+          });
+          costs.productEntries += productRepetitions * entries;
+          ranks.push_back(std::make_pair(size, data->rank()));
+          tree.maxRank = std::max(tree.maxRank, data->rank());
+        }
+        std::sort(ranks.begin(), ranks.end());
+        for (const auto &leaf : admissibleLeaves) {
+          const std::size_t size = rowCount(*leaf) + columnCount(*leaf);
+          tree.lowRankEntries +=
+              static_cast<double>(predictedRank(ranks, size)) * size;
+        }
+        trees.push_back(tree);
+      }
+  if (trees.empty())
+    throw std::invalid_argument("HMatParameterTuner::tune(): no candidate "
+                                "has maxBlockSize >= minBlockSize");
+
+  // Choose the fastest tree that fits in the budget, or the smallest one
+  double budget = m_targets.memoryBudget;
+  if (!(budget > 0) && parameters.isParameter("memoryBudget"))
+    budget = parameters.get<double>("memoryBudget");
+  const double bytesPerMb = 1024. * 1024.;
+  const int matvecCount = std::max(m_targets.matvecCount, 0);
+  const TreeStatistics *best = 0;
+  double bestMemory = 0., bestTime = 0.;
+  bool bestFits = false;
+  for (const auto &tree : trees) {
+    const double memory = sizeof(ResultType) *
+                          (tree.denseEntries + tree.lowRankEntries) /
+                          bytesPerMb;
+    const double time =
+        costs.assemblyTime(tree) + matvecCount * costs.matvecTime(tree);
+    const bool fits = !(budget > 0) || memory <= budget;
+    if (!best || (fits && !bestFits) ||
+        (fits == bestFits && (fits ? time < bestTime : memory < bestMemory))) {
+      best = &tree;
+      bestMemory = memory;
+      bestTime = time;
+      bestFits = fits;
+    }
+  }
+
+  ParameterList &hMatParameters = parameters.sublist("HMat");
+  hMatParameters.set("eta", best->eta);
+  hMatParameters.set("minBlockSize", best->minBlockSize);
+  hMatParameters.set("maxBlockSize", best->maxBlockSize);
+  hMatParameters.set("eps", eps);
+  if (best->maxRank > 0)
+    hMatParameters.set("maxRank",
+                       static_cast<int>(std::ceil(1.5 * best->maxRank)));
+  parameters.set("boundaryOperatorAssemblyType", std::string("hmat"));
+
+  result.parameters = parameters;
+  result.predictedMemory = bestMemory;
+  result.predictedAssemblyTime = costs.assemblyTime(*best);
+  result.predictedMatvecTime = costs.matvecTime(*best);
+  result.feasible = bestFits && result.quadratureError <= quadratureAccuracy &&
+                    result.blockError <= m_targets.accuracy;
+  return result;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(HMatParameterTuner);
+
+} // namespace Bempp
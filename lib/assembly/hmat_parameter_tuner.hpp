@@ -0,0 +1,157 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_hmat_parameter_tuner_hpp
+#define bempp_hmat_parameter_tuner_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/types.hpp"
+
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType>
+class BoundaryOperator;
+/** \endcond */
+
+/** \ingroup weak_form_assembly
+ *  \brief Targets and search space of an HMatParameterTuner. */
+struct HMatTuningTargets {
+  HMatTuningTargets()
+      : accuracy(1e-3), quadratureAccuracy(0.), memoryBudget(0.),
+        matvecCount(100), sampleBlockCount(8), maxQuadratureOrderIncrement(4),
+        etaCandidates({0.6, 1.2, 2.0}), minBlockSizeCandidates({16, 32, 64}),
+        maxBlockSizeCandidates({1024, 2048}) {}
+
+  /** \brief Relative accuracy of the admissible blocks. */
+  double accuracy;
+  /** \brief Relative accuracy of the regular integrals; 0 means
+   *  accuracy / 10. */
+  double quadratureAccuracy;
+  /** \brief Memory in MB the H-matrix may occupy; 0 means the
+   *  <tt>memoryBudget</tt> global parameter of the operator's Context, and
+   *  no cap if that is 0 as well. */
+  double memoryBudget;
+  /** \brief Expected number of matrix-vector products of the solve, which
+   *  weighs the application time of the H-matrix against its assembly
+   *  time. */
+  int matvecCount;
+  /** \brief Number of admissible and of dense leaves sampled per
+   *  candidate block cluster tree. */
+  int sampleBlockCount;
+  /** \brief Largest increment of the orders of the regular integrals
+   *  over those of the operator's Context that is tried. */
+  int maxQuadratureOrderIncrement;
+  /** \brief Values of the "eta" parameter that are tried. */
+  std::vector<double> etaCandidates;
+  /** \brief Values of the "minBlockSize" parameter that are tried. */
+  std::vector<int> minBlockSizeCandidates;
+  /** \brief Values of the "maxBlockSize" parameter that are tried. */
+  std::vector<int> maxBlockSizeCandidates;
+};
+
+/** \ingroup weak_form_assembly
+ *  \brief Parameters chosen by an HMatParameterTuner and the predictions
+ *  of its models. */
+struct HMatTuningResult {
+  /** \brief Global parameters of the operator's Context with the chosen
+   *  "HMat" and "QuadratureOrders" parameters. */
+  ParameterList parameters;
+  /** \brief Predicted storage of the H-matrix in MB. */
+  double predictedMemory;
+  /** \brief Predicted single-threaded assembly time in seconds. */
+  double predictedAssemblyTime;
+  /** \brief Predicted single-threaded time of one matrix-vector product
+   *  in seconds. */
+  double predictedMatvecTime;
+  /** \brief Largest relative error of the regular integrals on the
+   *  sampled blocks. */
+  double quadratureError;
+  /** \brief Relative error of the low-rank approximation of the sampled
+   *  admissible block. */
+  double blockError;
+  /** \brief Increment of the band orders of the regular integrals over
+   *  those of the operator's Context. */
+  int quadratureOrderIncrement;
+  /** \brief True if the predicted memory fits in the budget and the
+   *  sampled errors meet the accuracy targets. */
+  bool feasible;
+};
+
+/** \ingroup weak_form_assembly
+ *  \brief Selection of H-matrix and quadrature parameters for an operator
+ *  on its actual mesh.
+ *
+ *  tune() proceeds in three steps, all working on sampled leaves of block
+ *  cluster trees instead of complete H-matrices:
+ *
+ *  1. The band orders of the regular integrals (the "near", "medium" and
+ *     "far" sublists of "QuadratureOrders") are raised or lowered
+ *     together, and the smallest increment whose entries of a sampled
+ *     admissible and a sampled dense leaf agree with those of orders
+ *     raised by two more to HMatTuningTargets::quadratureAccuracy is
+ *     chosen.
+ *
+ *  2. The ACA tolerance "eps" starts at HMatTuningTargets::accuracy and
+ *     is lowered until the sampled admissible leaf is approximated to
+ *     that accuracy.
+ *
+ *  3. For every combination of the candidate values of "eta",
+ *     "minBlockSize" and "maxBlockSize", the block cluster tree is built
+ *     and evenly spread admissible and dense leaves are assembled. The
+ *     ranks of the unsampled admissible leaves are predicted by those of
+ *     the sampled leaves closest in size, which gives the storage of the
+ *     H-matrix; the costs per entry of the integration, the ACA and the
+ *     products, measured on all samples, give its assembly and
+ *     application times. The tree with the smallest time to solution,
+ *     i.e. assembly time plus HMatTuningTargets::matvecCount products,
+ *     whose storage fits in the memory budget is chosen, or the one with
+ *     the smallest storage if none fits. "maxRank" is set to 1.5 times
+ *     the largest sampled rank.
+ *
+ *  The result contains a copy of the global parameters of the operator's
+ *  Context with the chosen values, from which the Context of the actual
+ *  assembly can be constructed. */
+template <typename BasisFunctionType, typename ResultType>
+class HMatParameterTuner {
+public:
+  explicit HMatParameterTuner(
+      const HMatTuningTargets &targets = HMatTuningTargets());
+
+  const HMatTuningTargets &targets() const { return m_targets; }
+
+  /** \brief Choose the parameters for the weak form of \p op.
+   *
+   *  \p op must wrap an elementary integral operator. */
+  HMatTuningResult
+  tune(const BoundaryOperator<BasisFunctionType, ResultType> &op) const;
+
+private:
+  /** \cond PRIVATE */
+  HMatTuningTargets m_targets;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
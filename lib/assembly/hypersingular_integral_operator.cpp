@@ -70,7 +70,7 @@ HypersingularIntegralOperator<
 
   const bool verbose = (options.verbosityLevel() >= VerbosityLevel::DEFAULT);
 
-  shared_ptr<RawGridGeometry> testRawGeometry, trialRawGeometry;
+  shared_ptr<const RawGridGeometry> testRawGeometry, trialRawGeometry;
   shared_ptr<GeometryFactory> testGeometryFactory, trialGeometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
@@ -213,7 +213,8 @@ HypersingularIntegralOperator<BasisFunctionType, KernelType, ResultType>::
                               ResultType>::assembleDetachedWeakForm(testSpace,
                                                                     trialSpace,
                                                                     assembler,
-                                                                    context);
+                                                                    context,
+                                                                    this->symmetry());
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
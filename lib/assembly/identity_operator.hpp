@@ -47,7 +47,7 @@ class IdentityOperator;
 /** \endcond */
 
 template <typename BasisFunctionType, typename ResultType>
-class BEMPP_DEPRECATED IdentityOperatorId : public AbstractBoundaryOperatorId {
+class IdentityOperatorId : public AbstractBoundaryOperatorId {
 public:
   IdentityOperatorId(const IdentityOperator<BasisFunctionType, ResultType> &op);
   virtual size_t hash() const;
@@ -129,13 +129,8 @@ public:
   /** \brief Return the identifier of this operator.
    *
    *  Identity operators are treated as equivalent if they have the same domain,
-   *  range and dual to range.
-   *
-   *  \deprecated This function is deprecated and will be removed in a future
-   *  version of BEM++.
-   */
-  BEMPP_DEPRECATED virtual shared_ptr<const AbstractBoundaryOperatorId>
-  id() const;
+   *  range and dual to range. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
 
 private:
   virtual const CollectionOfShapesetTransformations &
@@ -0,0 +1,158 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "integral_operators_on_space_pairs.hpp"
+
+#include "abstract_boundary_operator.hpp"
+#include "context.hpp"
+#include "synthetic_integral_operator.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
+
+#include "../common/to_string.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/shapeset.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/grid_view.hpp"
+#include "../space/space.hpp"
+
+#include <boost/type_traits/is_complex.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Bempp {
+
+namespace {
+
+template <typename BasisFunctionType>
+int maxShapesetOrder(const Space<BasisFunctionType> &space) {
+  int result = 0;
+  const GridView &view = space.gridView();
+  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
+  while (!it->finished()) {
+    result = std::max(result, space.shapeset(it->entity()).order());
+    it->next();
+  }
+  return result;
+}
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<BoundaryOperator<BasisFunctionType, ResultType>>
+integralOperatorsOnSpacePairs(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const std::vector<shared_ptr<const Space<BasisFunctionType>>> &domains,
+    const std::vector<shared_ptr<const Space<BasisFunctionType>>> &ranges,
+    const std::vector<shared_ptr<const Space<BasisFunctionType>>> &
+        dualsToRanges,
+    const std::function<BoundaryOperator<BasisFunctionType, ResultType>(
+        const shared_ptr<const Context<BasisFunctionType, ResultType>> &,
+        const shared_ptr<const Space<BasisFunctionType>> &,
+        const shared_ptr<const Space<BasisFunctionType>> &,
+        const shared_ptr<const Space<BasisFunctionType>> &)> &makeOperator,
+    const std::string &label) {
+  typedef SyntheticIntegralOperator<BasisFunctionType, ResultType> SyntheticOp;
+  typedef shared_ptr<const Space<BasisFunctionType>> SpacePtr;
+
+  if (!context)
+    throw std::invalid_argument("integralOperatorsOnSpacePairs(): "
+                                "context must not be null");
+  if (domains.empty() || ranges.size() != domains.size() ||
+      dualsToRanges.size() != domains.size())
+    throw std::invalid_argument("integralOperatorsOnSpacePairs(): "
+                                "domains, ranges and dualsToRanges must have "
+                                "the same, nonzero length");
+
+  // The internal space must contain the functions of all domains and duals
+  // to ranges; for Lagrange spaces the discontinuous space of the highest
+  // order does
+  std::vector<SpacePtr> spaces(domains);
+  spaces.insert(spaces.end(), dualsToRanges.begin(), dualsToRanges.end());
+  SpacePtr internalSpace;
+  int internalOrder = -1;
+  for (const SpacePtr &space : spaces) {
+    if (!space)
+      throw std::invalid_argument("integralOperatorsOnSpacePairs(): "
+                                  "spaces must not be null");
+    if (space->codomainDimension() != 1)
+      throw std::invalid_argument("integralOperatorsOnSpacePairs(): "
+                                  "all spaces must be scalar");
+    if (!space->gridIsIdentical(*spaces.front()))
+      throw std::invalid_argument("integralOperatorsOnSpacePairs(): "
+                                  "all spaces must be defined on the same "
+                                  "grid");
+    SpacePtr discontinuousSpace = internalDiscontinuousSpace(*context, space);
+    const int order = maxShapesetOrder(*discontinuousSpace);
+    if (order > internalOrder) {
+      internalSpace = discontinuousSpace;
+      internalOrder = order;
+    }
+  }
+
+  std::string baseLabel = label;
+  if (baseLabel.empty())
+    baseLabel =
+        AbstractBoundaryOperator<BasisFunctionType, ResultType>::uniqueLabel();
+
+  shared_ptr<const Context<BasisFunctionType, ResultType>> internalContext,
+      auxContext;
+  SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
+      context, internalContext, auxContext);
+  BoundaryOperator<BasisFunctionType, ResultType> internalOp = makeOperator(
+      internalContext, internalSpace, internalSpace, internalSpace);
+  if (!internalOp.isInitialized())
+    throw std::invalid_argument("integralOperatorsOnSpacePairs(): "
+                                "makeOperator returned an uninitialized "
+                                "operator");
+
+  std::vector<BoundaryOperator<BasisFunctionType, ResultType>> result;
+  result.reserve(domains.size());
+  for (size_t i = 0; i < domains.size(); ++i) {
+    // Both sides are expanded in the same internal space, so the trial
+    // expansion is the adjoint of the test expansion if the spaces agree
+    int syntheseSymmetry = NO_SYMMETRY;
+    if (domains[i] == dualsToRanges[i])
+      syntheseSymmetry =
+          HERMITIAN | (boost::is_complex<BasisFunctionType>() ? 0 : SYMMETRIC);
+    result.push_back(syntheticNonhypersingularIntegralOperator(
+        internalOp, domains[i], ranges[i], dualsToRanges[i], internalSpace,
+        internalSpace, baseLabel + "_" + toString(i), syntheseSymmetry));
+  }
+  return result;
+}
+
+#define INSTANTIATE_FUNCTION(BASIS, RESULT)                                    \
+  template std::vector<BoundaryOperator<BASIS, RESULT>>                        \
+  integralOperatorsOnSpacePairs(                                               \
+      const shared_ptr<const Context<BASIS, RESULT>> &,                        \
+      const std::vector<shared_ptr<const Space<BASIS>>> &,                     \
+      const std::vector<shared_ptr<const Space<BASIS>>> &,                     \
+      const std::vector<shared_ptr<const Space<BASIS>>> &,                     \
+      const std::function<BoundaryOperator<BASIS, RESULT>(                     \
+          const shared_ptr<const Context<BASIS, RESULT>> &,                    \
+          const shared_ptr<const Space<BASIS>> &,                              \
+          const shared_ptr<const Space<BASIS>> &,                              \
+          const shared_ptr<const Space<BASIS>> &)> &,                          \
+      const std::string &)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_FUNCTION);
+
+} // namespace Bempp
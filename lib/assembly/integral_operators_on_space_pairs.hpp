@@ -0,0 +1,88 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_integral_operators_on_space_pairs_hpp
+#define bempp_integral_operators_on_space_pairs_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include "boundary_operator.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Bempp {
+
+template <typename BasisFunctionType> class Space;
+template <typename BasisFunctionType, typename ResultType> class Context;
+
+/** \ingroup composite_boundary_operators
+ *  \brief Discretise one integral operator on several pairs of spaces
+ *  defined on the same grid, evaluating its kernel only once.
+ *
+ *  \param[in] context
+ *    Assembly context.
+ *  \param[in] domains, ranges, dualsToRanges
+ *    The spaces of the operators to construct; the ith operator acts on
+ *    <tt>domains[i]</tt> and is tested with <tt>dualsToRanges[i]</tt>. The
+ *    vectors must have the same, nonzero length.
+ *  \param[in] makeOperator
+ *    Callable returning the integral operator, e.g.
+ *    laplace3dSingleLayerBoundaryOperator(), on given context, domain,
+ *    range and dual to range.
+ *  \param[in] label
+ *    (Optional) Label of the internal operator; the operator returned for
+ *    the ith pair is labelled by appending "_" and \p i.
+ *
+ *  \p makeOperator is called once, to discretise the operator on a
+ *  discontinuous space \f$\mathcal D\f$ of the highest polynomial order
+ *  among the discontinuous counterparts of all domains and duals to ranges;
+ *  e.g. on piecewise linear discontinuous functions for pairs of piecewise
+ *  constant and continuous piecewise linear spaces. The operator of each
+ *  pair is then obtained from this internal operator through the sparse
+ *  matrices expanding the basis functions of its spaces in those of
+ *  \f$\mathcal D\f$, as in syntheticNonhypersingularIntegralOperator(). All
+ *  returned operators therefore share the weak form of the internal
+ *  operator, whose geometry, kernel values and quadrature are computed once
+ *  per element pair, in dense as well as in H-matrix mode.
+ *
+ *  All spaces must be scalar spaces of piecewise polynomials on the same
+ *  grid whose functions are contained in \f$\mathcal D\f$, as is the case
+ *  for the Lagrange spaces. The operator must not be hypersingular. */
+template <typename BasisFunctionType, typename ResultType>
+std::vector<BoundaryOperator<BasisFunctionType, ResultType>>
+integralOperatorsOnSpacePairs(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const std::vector<shared_ptr<const Space<BasisFunctionType>>> &domains,
+    const std::vector<shared_ptr<const Space<BasisFunctionType>>> &ranges,
+    const std::vector<shared_ptr<const Space<BasisFunctionType>>> &
+        dualsToRanges,
+    const std::function<BoundaryOperator<BasisFunctionType, ResultType>(
+        const shared_ptr<const Context<BasisFunctionType, ResultType>> &,
+        const shared_ptr<const Space<BasisFunctionType>> &,
+        const shared_ptr<const Space<BasisFunctionType>> &,
+        const shared_ptr<const Space<BasisFunctionType>> &)> &makeOperator,
+    const std::string &label = "");
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,138 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "interpolant_moments_assembler.hpp"
+
+#include "local_dof_lists_cache.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../fiber/basis_data.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/geometrical_data.hpp"
+#include "../fiber/numerical_quadrature.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+#include "../fiber/shapeset.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/geometry.hpp"
+#include "../grid/geometry_factory.hpp"
+#include "../grid/grid.hpp"
+#include "../grid/grid_view.hpp"
+#include "../grid/mapper.hpp"
+#include "../space/space.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename BasisFunctionType, typename ResultType>
+InterpolantMomentsAssembler<BasisFunctionType, ResultType>::
+    InterpolantMomentsAssembler(
+        const Space<BasisFunctionType> &space,
+        const shared_ptr<LocalDofListsCache<BasisFunctionType>> &dofListsCache,
+        const FmmFarField<ResultType> &farField,
+        typename FmmFarField<ResultType>::Side side, bool normalDerivative,
+        bool conjugateBasis, int quadratureOrder)
+    : m_dofListsCache(dofListsCache), m_farField(farField), m_side(side),
+      m_normalDerivative(normalDerivative), m_conjugateBasis(conjugateBasis),
+      m_quadPoints(5), m_quadWeights(5) {
+  const GridView &view = space.gridView();
+  m_rawGeometry = view.rawGeometry<CoordinateType>();
+  m_geometryFactory = space.grid()->elementGeometryFactory();
+
+  m_shapesets.resize(view.entityCount(0));
+  const Mapper &mapper = view.elementMapper();
+  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
+  while (!it->finished()) {
+    const Entity<0> &element = it->entity();
+    m_shapesets[mapper.entityIndex(element)] = &space.shapeset(element);
+    it->next();
+  }
+
+  for (int cornerCount = 3; cornerCount <= 4; ++cornerCount)
+    Fiber::fillSingleQuadraturePointsAndWeights(
+        cornerCount, quadratureOrder, m_quadPoints[cornerCount],
+        m_quadWeights[cornerCount]);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+InterpolantMomentsAssembler<BasisFunctionType,
+                            ResultType>::~InterpolantMomentsAssembler() {}
+
+template <typename BasisFunctionType, typename ResultType>
+void InterpolantMomentsAssembler<BasisFunctionType, ResultType>::assemble(
+    std::size_t nodeIndex, const hmat::IndexRangeType &range,
+    arma::Mat<ResultType> &moments) const {
+  const LocalDofLists<BasisFunctionType> &dofLists =
+      m_dofListsCache->get(range[0], range[1] - range[0]);
+
+  size_t geomDeps = Fiber::GLOBALS | Fiber::INTEGRATION_ELEMENTS;
+  if (m_normalDerivative)
+    geomDeps |= Fiber::NORMALS;
+  const int nodeCount = m_farField.interpolationNodeCount();
+
+  std::unique_ptr<typename GeometryFactory::Geometry> geometry(
+      m_geometryFactory->make());
+  Fiber::GeometricalData<CoordinateType> geomData;
+  Fiber::BasisData<BasisFunctionType> basisData;
+  arma::Mat<CoordinateType> interpolants;
+
+  moments.zeros(nodeCount, range[1] - range[0]);
+  for (std::size_t e = 0; e < dofLists.elementIndices.size(); ++e) {
+    const int element = dofLists.elementIndices[e];
+    const int cornerCount = m_rawGeometry->elementCornerCount(element);
+    if (cornerCount < 3 || cornerCount > 4)
+      throw std::runtime_error("InterpolantMomentsAssembler::assemble(): "
+                               "unsupported element type");
+    const arma::Mat<CoordinateType> &points = m_quadPoints[cornerCount];
+    const std::vector<CoordinateType> &weights = m_quadWeights[cornerCount];
+    m_rawGeometry->setupGeometry(element, *geometry);
+    geometry->getData(geomDeps, points, geomData);
+    m_shapesets[element]->evaluate(Fiber::VALUES, points, ALL_DOFS,
+                                   basisData);
+    m_farField.evaluateInterpolants(
+        m_side, nodeIndex, geomData.globals,
+        m_normalDerivative ? &geomData.normals
+                           : static_cast<arma::Mat<CoordinateType> *>(0),
+        interpolants);
+
+    for (int k = dofLists.elementOffsets[e];
+         k < dofLists.elementOffsets[e + 1]; ++k) {
+      const LocalDofIndex localDof = dofLists.localDofIndices[k];
+      ResultType *column = moments.colptr(dofLists.arrayIndices[k]);
+      for (std::size_t q = 0; q < weights.size(); ++q) {
+        BasisFunctionType value =
+            basisData.values(0, localDof, q) * dofLists.localDofWeights[k];
+        if (m_conjugateBasis)
+          value = conj(value);
+        const ResultType factor =
+            static_cast<ResultType>(value) *
+            (weights[q] * geomData.integrationElements(q));
+        for (int n = 0; n < nodeCount; ++n)
+          column[n] += factor * interpolants(n, q);
+      }
+    }
+  }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
+    InterpolantMomentsAssembler);
+
+} // namespace Bempp
@@ -0,0 +1,109 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_interpolant_moments_assembler_hpp
+#define bempp_interpolant_moments_assembler_hpp
+
+#include "../common/common.hpp"
+
+#include "fmm_far_field.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../fiber/scalar_traits.hpp"
+#include "../hmat/common.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class Shapeset;
+template <typename CoordinateType> class RawGridGeometry;
+/** \endcond */
+
+} // namespace Fiber
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class GeometryFactory;
+template <typename BasisFunctionType> class LocalDofListsCache;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Integrals of the Chebyshev interpolants of cluster boxes against
+ *  basis functions.
+ *
+ *  Computes the moment matrices of the clusters of one side of an
+ *  FmmFarField: the leaf matrices of the FMM and the cluster bases of
+ *  H-matrix blocks compressed by interpolation. The DOFs of a cluster are
+ *  looked up in \p dofListsCache, so they are global or local DOFs
+ *  depending on how the cache was constructed. */
+template <typename BasisFunctionType, typename ResultType>
+class InterpolantMomentsAssembler {
+public:
+  typedef typename Fiber::ScalarTraits<ResultType>::RealType CoordinateType;
+
+  /** \brief Constructor.
+   *
+   *  If \p normalDerivative is true, the derivatives of the interpolants in
+   *  the direction of the surface normal are integrated instead of their
+   *  values; if \p conjugateBasis is true, the basis functions are
+   *  conjugated. The integrals are evaluated by a quadrature rule of
+   *  accuracy order \p quadratureOrder on each element. */
+  InterpolantMomentsAssembler(
+      const Space<BasisFunctionType> &space,
+      const shared_ptr<LocalDofListsCache<BasisFunctionType>> &dofListsCache,
+      const FmmFarField<ResultType> &farField,
+      typename FmmFarField<ResultType>::Side side, bool normalDerivative,
+      bool conjugateBasis, int quadratureOrder);
+  ~InterpolantMomentsAssembler();
+
+  /** \brief Compute the moment matrix of a cluster.
+   *
+   *  \p range is the range of H-matrix indices of the cluster with number
+   *  \p nodeIndex (see hmat::TreeIndex). \p moments receives
+   *  FmmFarField::interpolationNodeCount() rows and one column per index.
+   *  Thread-safe. */
+  void assemble(std::size_t nodeIndex, const hmat::IndexRangeType &range,
+                arma::Mat<ResultType> &moments) const;
+
+private:
+  /** \cond PRIVATE */
+  shared_ptr<LocalDofListsCache<BasisFunctionType>> m_dofListsCache;
+  const FmmFarField<ResultType> &m_farField;
+  typename FmmFarField<ResultType>::Side m_side;
+  bool m_normalDerivative;
+  bool m_conjugateBasis;
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> m_rawGeometry;
+  std::unique_ptr<GeometryFactory> m_geometryFactory;
+  std::vector<const Fiber::Shapeset<BasisFunctionType> *> m_shapesets;
+  // Quadrature rules for triangles (index 3) and quadrilaterals (index 4)
+  std::vector<arma::Mat<CoordinateType>> m_quadPoints;
+  std::vector<std::vector<CoordinateType>> m_quadWeights;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
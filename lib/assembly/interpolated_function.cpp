@@ -29,13 +29,295 @@
 
 #include "../space/piecewise_linear_continuous_scalar_space.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <vector>
+
 namespace Bempp {
 
+namespace {
+
+/** \brief Spatial index of the simplicial elements of a grid view.
+ *
+ *  The bounding box of the grid is divided into a uniform grid of bins of
+ *  roughly the size of an element; each element is registered in all bins
+ *  overlapping its bounding box, so that an element containing a point is
+ *  always registered in the bin of that point. For each element the affine
+ *  map from world coordinates to barycentric coordinates (the pseudoinverse
+ *  of its Jacobian if the grid is a manifold of lower dimension than the
+ *  world) is stored. */
+template <typename CoordinateType> class PointLocator {
+public:
+  PointLocator(const GridView &view, int dim, int dimWorld);
+
+  /** \brief Find the element containing the point \p x.
+   *
+   *  On success, set \p element to its index in the grid view and write the
+   *  dim + 1 barycentric coordinates of \p x in it to \p barycentric, then
+   *  return true. Points lying off the grid by less than a small tolerance
+   *  relative to the element size are accepted. */
+  bool locate(const CoordinateType *x, int &element,
+              CoordinateType *barycentric) const;
+
+  /** \brief Indices of the vertices of the element \p element. */
+  const int *corners(int element) const {
+    return &m_corners[size_t(element) * (m_dim + 1)];
+  }
+
+  int dim() const { return m_dim; }
+
+private:
+  // Compute the barycentric coordinates of x in the element e and return by
+  // how much x violates the containment (0 if it lies inside)
+  CoordinateType violation(int e, const CoordinateType *x,
+                           CoordinateType *barycentric) const;
+  int binCoordinate(int d, CoordinateType x) const;
+
+  int m_dim, m_dimWorld;
+  CoordinateType m_tolerance;
+  std::vector<int> m_corners;
+  std::vector<CoordinateType> m_origins;        // dimWorld per element
+  std::vector<CoordinateType> m_jacobians;      // dimWorld x dim per element
+  std::vector<CoordinateType> m_pseudoInverses; // dim x dimWorld per element
+  std::vector<CoordinateType> m_diameters;
+  CoordinateType m_lower[3], m_upper[3], m_binSize;
+  int m_binCounts[3];
+  std::vector<int> m_binStarts, m_binElements;
+};
+
+template <typename CoordinateType>
+PointLocator<CoordinateType>::PointLocator(const GridView &view, int dim,
+                                           int dimWorld)
+    : m_dim(dim), m_dimWorld(dimWorld),
+      m_tolerance(std::sqrt(std::numeric_limits<CoordinateType>::epsilon())) {
+  if (dim < 1 || dim > dimWorld || dimWorld > 3)
+    throw std::invalid_argument("InterpolatedFunction::evaluate(): "
+                                "unsupported grid dimensions");
+  arma::Mat<CoordinateType> vertices;
+  arma::Mat<int> elementCorners;
+  arma::Mat<char> auxData;
+  view.getRawElementData(vertices, elementCorners, auxData);
+  const int elementCount = elementCorners.n_cols;
+  const int cornerCount = dim + 1;
+  if (elementCount == 0)
+    throw std::invalid_argument("InterpolatedFunction::evaluate(): "
+                                "the interpolation grid is empty");
+
+  m_corners.resize(size_t(elementCount) * cornerCount);
+  m_origins.resize(size_t(elementCount) * dimWorld);
+  m_jacobians.resize(size_t(elementCount) * dimWorld * dim);
+  m_pseudoInverses.resize(size_t(elementCount) * dim * dimWorld);
+  m_diameters.resize(elementCount);
+  std::vector<CoordinateType> boxes(size_t(elementCount) * 2 * dimWorld);
+  CoordinateType diameterSum = 0;
+  for (int e = 0; e < elementCount; ++e) {
+    if ((int)elementCorners.n_rows > cornerCount &&
+        elementCorners(cornerCount, e) != -1)
+      throw std::invalid_argument("InterpolatedFunction::evaluate(): "
+                                  "only simplicial elements are supported");
+    for (int k = 0; k < cornerCount; ++k)
+      m_corners[size_t(e) * cornerCount + k] = elementCorners(k, e);
+    const int *corners = &m_corners[size_t(e) * cornerCount];
+
+    arma::Mat<CoordinateType> jacobian(dimWorld, dim);
+    for (int d = 0; d < dimWorld; ++d) {
+      m_origins[size_t(e) * dimWorld + d] = vertices(d, corners[0]);
+      for (int k = 0; k < dim; ++k)
+        jacobian(d, k) = vertices(d, corners[k + 1]) - vertices(d, corners[0]);
+    }
+    arma::Mat<CoordinateType> gramInverse;
+    if (!arma::inv(gramInverse, arma::Mat<CoordinateType>(jacobian.t() *
+                                                          jacobian)))
+      throw std::invalid_argument("InterpolatedFunction::evaluate(): "
+                                  "degenerate element in the interpolation "
+                                  "grid");
+    arma::Mat<CoordinateType> pseudoInverse = gramInverse * jacobian.t();
+    std::copy(jacobian.begin(), jacobian.end(),
+              m_jacobians.begin() + size_t(e) * dimWorld * dim);
+    std::copy(pseudoInverse.begin(), pseudoInverse.end(),
+              m_pseudoInverses.begin() + size_t(e) * dim * dimWorld);
+
+    CoordinateType diameterSq = 0;
+    for (int k = 0; k < cornerCount; ++k)
+      for (int l = k + 1; l < cornerCount; ++l) {
+        CoordinateType distanceSq = 0;
+        for (int d = 0; d < dimWorld; ++d) {
+          const CoordinateType diff =
+              vertices(d, corners[k]) - vertices(d, corners[l]);
+          distanceSq += diff * diff;
+        }
+        diameterSq = std::max(diameterSq, distanceSq);
+      }
+    m_diameters[e] = std::sqrt(diameterSq);
+    diameterSum += m_diameters[e];
+
+    CoordinateType *box = &boxes[size_t(e) * 2 * dimWorld];
+    const CoordinateType margin = m_tolerance * m_diameters[e];
+    for (int d = 0; d < dimWorld; ++d) {
+      box[d] = box[dimWorld + d] = vertices(d, corners[0]);
+      for (int k = 1; k < cornerCount; ++k) {
+        box[d] = std::min(box[d], vertices(d, corners[k]));
+        box[dimWorld + d] =
+            std::max(box[dimWorld + d], vertices(d, corners[k]));
+      }
+      box[d] -= margin;
+      box[dimWorld + d] += margin;
+    }
+  }
+
+  // Bins of about the mean element diameter, but not many more bins than
+  // elements
+  CoordinateType maxExtent = 0;
+  for (int d = 0; d < dimWorld; ++d) {
+    m_lower[d] = boxes[d];
+    m_upper[d] = boxes[dimWorld + d];
+    for (int e = 1; e < elementCount; ++e) {
+      m_lower[d] = std::min(m_lower[d], boxes[size_t(e) * 2 * dimWorld + d]);
+      m_upper[d] =
+          std::max(m_upper[d], boxes[size_t(e) * 2 * dimWorld + dimWorld + d]);
+    }
+    maxExtent = std::max(maxExtent, m_upper[d] - m_lower[d]);
+  }
+  m_binSize = std::max(diameterSum / elementCount, maxExtent / 1024);
+  std::fill(m_binCounts, m_binCounts + 3, 1);
+  size_t binCount;
+  for (;;) {
+    binCount = 1;
+    for (int d = 0; d < dimWorld; ++d) {
+      m_binCounts[d] = std::max(
+          1, (int)std::ceil((m_upper[d] - m_lower[d]) / m_binSize));
+      binCount *= m_binCounts[d];
+    }
+    if (binCount <= 8 * size_t(elementCount) + 8)
+      break;
+    m_binSize *= 2;
+  }
+
+  // Register the elements in the bins, as a compressed sparse row structure
+  m_binStarts.assign(binCount + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<int> fill;
+    if (pass == 1) {
+      for (size_t b = 0; b < binCount; ++b)
+        m_binStarts[b + 1] += m_binStarts[b];
+      m_binElements.resize(m_binStarts[binCount]);
+      fill.assign(m_binStarts.begin(), m_binStarts.end() - 1);
+    }
+    for (int e = 0; e < elementCount; ++e) {
+      const CoordinateType *box = &boxes[size_t(e) * 2 * dimWorld];
+      int first[3] = {0, 0, 0}, last[3] = {0, 0, 0};
+      for (int d = 0; d < dimWorld; ++d) {
+        first[d] = binCoordinate(d, box[d]);
+        last[d] = binCoordinate(d, box[dimWorld + d]);
+      }
+      for (int i2 = first[2]; i2 <= last[2]; ++i2)
+        for (int i1 = first[1]; i1 <= last[1]; ++i1)
+          for (int i0 = first[0]; i0 <= last[0]; ++i0) {
+            const size_t b =
+                i0 + m_binCounts[0] * (i1 + size_t(m_binCounts[1]) * i2);
+            if (pass == 0)
+              ++m_binStarts[b + 1];
+            else
+              m_binElements[fill[b]++] = e;
+          }
+    }
+  }
+}
+
+template <typename CoordinateType>
+int PointLocator<CoordinateType>::binCoordinate(int d, CoordinateType x) const {
+  const int i = (int)std::floor((x - m_lower[d]) / m_binSize);
+  return std::min(std::max(i, 0), m_binCounts[d] - 1);
+}
+
+template <typename CoordinateType>
+CoordinateType
+PointLocator<CoordinateType>::violation(int e, const CoordinateType *x,
+                                        CoordinateType *barycentric) const {
+  const CoordinateType *origin = &m_origins[size_t(e) * m_dimWorld];
+  const CoordinateType *pseudoInverse =
+      &m_pseudoInverses[size_t(e) * m_dim * m_dimWorld];
+  CoordinateType diff[3];
+  for (int d = 0; d < m_dimWorld; ++d)
+    diff[d] = x[d] - origin[d];
+
+  CoordinateType first = 1, minimum = 0;
+  for (int k = 0; k < m_dim; ++k) {
+    CoordinateType value = 0;
+    for (int d = 0; d < m_dimWorld; ++d)
+      value += pseudoInverse[k + d * m_dim] * diff[d];
+    barycentric[k + 1] = value;
+    first -= value;
+    minimum = std::min(minimum, value);
+  }
+  barycentric[0] = first;
+  CoordinateType result = -std::min(minimum, first);
+
+  if (m_dim < m_dimWorld) {
+    // Distance of x from the plane of the element
+    const CoordinateType *jacobian =
+        &m_jacobians[size_t(e) * m_dimWorld * m_dim];
+    CoordinateType distanceSq = 0;
+    for (int d = 0; d < m_dimWorld; ++d) {
+      CoordinateType residual = diff[d];
+      for (int k = 0; k < m_dim; ++k)
+        residual -= jacobian[d + k * m_dimWorld] * barycentric[k + 1];
+      distanceSq += residual * residual;
+    }
+    result += std::sqrt(distanceSq) / m_diameters[e];
+  }
+  return result;
+}
+
+template <typename CoordinateType>
+bool PointLocator<CoordinateType>::locate(const CoordinateType *x,
+                                          int &element,
+                                          CoordinateType *barycentric) const {
+  size_t b = 0, stride = 1;
+  for (int d = 0; d < m_dimWorld; ++d) {
+    if (x[d] < m_lower[d] || x[d] > m_upper[d])
+      return false;
+    b += stride * binCoordinate(d, x[d]);
+    stride *= m_binCounts[d];
+  }
+
+  CoordinateType candidate[4];
+  CoordinateType bestViolation = std::numeric_limits<CoordinateType>::max();
+  element = -1;
+  for (int i = m_binStarts[b]; i < m_binStarts[b + 1]; ++i) {
+    const int e = m_binElements[i];
+    const CoordinateType v = violation(e, x, candidate);
+    if (v < bestViolation) {
+      bestViolation = v;
+      element = e;
+      std::copy(candidate, candidate + m_dim + 1, barycentric);
+      if (v <= 0)
+        break;
+    }
+  }
+  return element >= 0 && bestViolation <= m_tolerance;
+}
+
+} // namespace
+
+template <typename ValueType>
+struct InterpolatedFunction<ValueType>::LocatorCache {
+  std::once_flag flag;
+  std::unique_ptr<const PointLocator<CoordinateType>> locator;
+};
+
 template <typename ValueType>
 InterpolatedFunction<ValueType>::InterpolatedFunction(
     const Grid &grid, const arma::Mat<ValueType> &vertexValues,
     InterpolationMethod method)
-    : m_grid(grid), m_vertexValues(vertexValues), m_method(method) {
+    : m_grid(grid), m_vertexValues(vertexValues), m_method(method),
+      m_locatorCache(new LocatorCache) {
   std::unique_ptr<GridView> view = grid.leafView();
 
   if (view->entityCount(grid.dim()) != vertexValues.n_cols)
@@ -72,16 +354,51 @@ template <typename ValueType>
 void InterpolatedFunction<ValueType>::evaluate(
     const Fiber::GeometricalData<CoordinateType> &geomData,
     arma::Mat<ValueType> &result) const {
+  evaluate(geomData.globals, result);
+}
 
-#ifndef NDEBUG
-  const arma::Mat<CoordinateType> &points = geomData.globals;
+template <typename ValueType>
+void InterpolatedFunction<ValueType>::evaluate(
+    const arma::Mat<CoordinateType> &points,
+    arma::Mat<ValueType> &values) const {
   if ((int)points.n_rows != worldDimension())
     throw std::invalid_argument("InterpolatedFunction::evaluate(): "
                                 "incompatible world dimension");
-#endif
 
-  throw std::runtime_error("InterpolatedFunction::evaluate(): "
-                           "not implemented yet");
+  std::call_once(m_locatorCache->flag, [this]() {
+    m_locatorCache->locator.reset(new PointLocator<CoordinateType>(
+        *m_grid.leafView(), m_grid.dim(), m_grid.dimWorld()));
+  });
+  const PointLocator<CoordinateType> &locator = *m_locatorCache->locator;
+
+  const size_t pointCount = points.n_cols;
+  const int componentCount = m_vertexValues.n_rows;
+  const int cornerCount = locator.dim() + 1;
+  values.set_size(componentCount, pointCount);
+  std::atomic<bool> pointsOffGrid(false);
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, pointCount, 256),
+      [&](const tbb::blocked_range<size_t> &r) {
+        CoordinateType barycentric[4];
+        for (size_t p = r.begin(); p != r.end(); ++p) {
+          int element;
+          if (!locator.locate(points.colptr(p), element, barycentric)) {
+            pointsOffGrid = true;
+            continue;
+          }
+          const int *corners = locator.corners(element);
+          for (int c = 0; c < componentCount; ++c) {
+            ValueType value = 0;
+            for (int k = 0; k < cornerCount; ++k)
+              value += barycentric[k] * m_vertexValues(c, corners[k]);
+            values(c, p) = value;
+          }
+        }
+      });
+  if (pointsOffGrid)
+    throw std::runtime_error("InterpolatedFunction::evaluate(): "
+                             "some points do not lie on the interpolation "
+                             "grid");
 }
 
 template <typename ValueType>
@@ -29,6 +29,7 @@
 #include "../fiber/scalar_traits.hpp"
 
 #include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
 
 namespace Bempp {
 
@@ -42,8 +43,13 @@ template <typename ValueType> class InterpolatedFunction;
  *  \brief Function defined by its values at a set of interpolation points
  *    and an interpolation method.
  *
- *  Currently the evaluate() method is not implemented. However, VTK-file export
- *  (exportToVtk()) works.
+ *  The function is interpolated linearly on the simplicial elements of the
+ *  interpolation grid. The first evaluation builds a spatial index of the
+ *  elements (a uniform grid of bins covering the bounding box of the grid)
+ *  and the affine maps from world to barycentric coordinates of all
+ *  elements. The index is shared by all copies of the function and by the
+ *  results of arithmetic operations on them, so that repeated evaluations
+ *  only locate the points and combine vertex values.
  */
 template <typename ValueType>
 class InterpolatedFunction : public Function<ValueType> {
@@ -69,8 +75,17 @@ public:
   virtual void evaluate(const Fiber::GeometricalData<CoordinateType> &geomData,
                         arma::Mat<ValueType> &result) const;
 
-  //    virtual void evaluate(const arma::Mat<ValueType>& global,
-  //                          arma::Mat<ValueType>& values) const;
+  /** \brief Evaluate the function at the points \p points.
+   *
+   *  The (i, j)th element of \p points should contain the ith coordinate
+   *  of the jth point. On output, the ith column of \p values contains the
+   *  value of the function at the ith point. The points are processed in
+   *  parallel.
+   *
+   *  A <tt>std::runtime_error</tt> is thrown if a point does not lie on the
+   *  interpolation grid. */
+  void evaluate(const arma::Mat<CoordinateType> &points,
+                arma::Mat<ValueType> &values) const;
 
   /** Export the function to a VTK file.
 
@@ -119,9 +134,14 @@ private:
   void checkCompatibility(const InterpolatedFunction<ValueType> &other) const;
 
 private:
+  /** \cond PRIVATE */
+  struct LocatorCache;
+
   const Grid &m_grid;
   arma::Mat<ValueType> m_vertexValues;
   InterpolationMethod m_method;
+  shared_ptr<LocatorCache> m_locatorCache;
+  /** \endcond */
 };
 
 /** \relates InterpolatedFunction
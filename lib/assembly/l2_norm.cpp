@@ -39,30 +39,72 @@
 #include "../fiber/geometrical_data.hpp"
 #include "../grid/mapper.hpp"
 
+#include <stdexcept>
+#include <vector>
+
+#include <tbb/parallel_for.h>
+
 namespace Bempp {
 
 namespace {
 
-template <typename ValueType_> class KernelFunctorFromUnaryFunction {
+// Copy points [start, end) of the geometrical data src to dest
+template <typename CoordinateType>
+void copyGeometricalDataPoints(const Fiber::GeometricalData<CoordinateType> &src,
+                               size_t start, size_t end,
+                               Fiber::GeometricalData<CoordinateType> &dest) {
+  if (!src.globals.is_empty())
+    dest.globals = src.globals.cols(start, end - 1);
+  if (!src.normals.is_empty())
+    dest.normals = src.normals.cols(start, end - 1);
+  if (!src.integrationElements.is_empty())
+    dest.integrationElements = src.integrationElements.cols(start, end - 1);
+  if (!src.jacobiansTransposed.is_empty()) {
+    dest.jacobiansTransposed.set_size(src.jacobiansTransposed.extent(0),
+                                      src.jacobiansTransposed.extent(1),
+                                      end - start);
+    for (size_t p = start; p < end; ++p)
+      for (size_t j = 0; j < src.jacobiansTransposed.extent(1); ++j)
+        for (size_t i = 0; i < src.jacobiansTransposed.extent(0); ++i)
+          dest.jacobiansTransposed(i, j, p - start) =
+              src.jacobiansTransposed(i, j, p);
+  }
+  if (!src.jacobianInversesTransposed.is_empty()) {
+    dest.jacobianInversesTransposed.set_size(
+        src.jacobianInversesTransposed.extent(0),
+        src.jacobianInversesTransposed.extent(1), end - start);
+    for (size_t p = start; p < end; ++p)
+      for (size_t j = 0; j < src.jacobianInversesTransposed.extent(1); ++j)
+        for (size_t i = 0; i < src.jacobianInversesTransposed.extent(0); ++i)
+          dest.jacobianInversesTransposed(i, j, p - start) =
+              src.jacobianInversesTransposed(i, j, p);
+  }
+  dest.domainIndex = src.domainIndex;
+}
+
+// Collection of kernels, the ith of which is the ith function; the kernels
+// do not depend on the test point
+template <typename ValueType_> class KernelFunctorFromUnaryFunctions {
 public:
   typedef ValueType_ ValueType;
   typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
 
-  explicit KernelFunctorFromUnaryFunction(
-      const Fiber::Function<ValueType> &function)
-      : m_function(function) {}
+  explicit KernelFunctorFromUnaryFunctions(
+      const std::vector<const Fiber::Function<ValueType> *> &functions)
+      : m_functions(functions) {}
 
-  int kernelCount() const { return 1; }
+  int kernelCount() const { return m_functions.size(); }
 
   int kernelRowCount(int kernelIndex) const {
-    return m_function.codomainDimension();
+    return m_functions[kernelIndex]->codomainDimension();
   }
 
   int kernelColCount(int kernelIndex) const { return 1; }
 
   void addGeometricalDependencies(size_t &testGeomDeps,
                                   size_t &trialGeomDeps) const {
-    m_function.addGeometricalDependencies(trialGeomDeps);
+    for (size_t f = 0; f < m_functions.size(); ++f)
+      m_functions[f]->addGeometricalDependencies(trialGeomDeps);
   }
 
   template <template <typename T> class CollectionOf2dSlicesOfNdArrays>
@@ -73,18 +115,54 @@ public:
     Fiber::GeometricalData<CoordinateType> geomData =
         trialGeomData.asGeometricalData();
     arma::Mat<ValueType> resultMatrix;
-    m_function.evaluate(geomData, resultMatrix);
-    assert(resultMatrix.n_rows == result[0].extent(0));
-    assert(resultMatrix.n_cols == result[0].extent(1));
-    for (size_t j = 0; j < resultMatrix.n_cols; ++j)
-      for (size_t i = 0; i < resultMatrix.n_rows; ++i)
-        result[0](i, j) = resultMatrix(i, j);
+    for (size_t f = 0; f < m_functions.size(); ++f) {
+      m_functions[f]->evaluate(geomData, resultMatrix);
+      assert(resultMatrix.n_rows == result[f].extent(0));
+      assert(resultMatrix.n_cols == result[f].extent(1));
+      for (size_t j = 0; j < resultMatrix.n_cols; ++j)
+        for (size_t i = 0; i < resultMatrix.n_rows; ++i)
+          result[f](i, j) = resultMatrix(i, j);
+    }
+  }
+
+  // Evaluate the functions at all trial points at once, in parallel over
+  // chunks of points, instead of calling them point by point
+  bool evaluateOnGrid(
+      const Fiber::GeometricalData<CoordinateType> &testGeomData,
+      const Fiber::GeometricalData<CoordinateType> &trialGeomData,
+      Fiber::CollectionOf4dArrays<ValueType> &result) const {
+    const size_t testPointCount = testGeomData.pointCount();
+    const size_t trialPointCount = trialGeomData.pointCount();
+    const size_t CHUNK_SIZE = 1024;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, trialPointCount, CHUNK_SIZE),
+        [&](const tbb::blocked_range<size_t> &r) {
+          Fiber::GeometricalData<CoordinateType> geomData;
+          copyGeometricalDataPoints(trialGeomData, r.begin(), r.end(),
+                                    geomData);
+          arma::Mat<ValueType> values;
+          for (size_t f = 0; f < m_functions.size(); ++f) {
+            m_functions[f]->evaluate(geomData, values);
+            assert(values.n_rows == result[f].extent(0));
+            assert(values.n_cols == r.size());
+            for (size_t point = r.begin(); point != r.end(); ++point)
+              for (size_t testPoint = 0; testPoint < testPointCount;
+                   ++testPoint)
+                for (size_t i = 0; i < values.n_rows; ++i)
+                  result[f](i, 0, testPoint, point) =
+                      values(i, point - r.begin());
+          }
+        });
+    return true;
   }
 
 private:
-  const Fiber::Function<ValueType> &m_function;
+  std::vector<const Fiber::Function<ValueType> *> m_functions;
 };
 
+// Integrand whose (2 * i)th component is the squared norm of the difference
+// between the argument and the ith kernel and whose (2 * i + 1)th component
+// is the squared norm of the ith kernel
 template <typename BasisFunctionType_, typename KernelType_,
           typename ResultType_>
 class L2NormOfDifferenceIntegrandFunctor {
@@ -94,11 +172,14 @@ public:
   typedef ResultType_ ResultType;
   typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
 
+  explicit L2NormOfDifferenceIntegrandFunctor(int functionCount)
+      : m_functionCount(functionCount) {}
+
   void addGeometricalDependencies(size_t &trialGeomDeps) const {
     // do nothing
   }
 
-  int resultDimension() const { return 1; }
+  int resultDimension() const { return 2 * m_functionCount; }
 
   template <typename CollectionOf1dSlicesOfConstNdArrays>
   void evaluate(const Fiber::ConstGeometricalDataSlice<
@@ -107,34 +188,43 @@ public:
                     kernelValues,
                 const CollectionOf1dSlicesOfConstNdArrays &trialValues,
                 std::vector<ResultType> &result) const {
-    // Assert that there is only a single kernel with a single column
-    assert(kernelValues.size() == 1);
-    assert(kernelValues[0].extent(1) == 1);
-    const size_t componentCount = kernelValues[0].extent(0);
+    // Assert that there is one single-column kernel per function
+    assert(kernelValues.size() == m_functionCount);
 
     // Assert that there is only one trial transformation
-    // and that its dimensions are correct
     assert(trialValues.size() == 1);
+
+    // Assert that the result has two elements per function
+    assert(result.size() == 2 * m_functionCount);
+
+    for (size_t f = 0; f < kernelValues.size(); ++f) {
+      assert(kernelValues[f].extent(1) == 1);
+      const size_t componentCount = kernelValues[f].extent(0);
 #ifndef NDEBUG
-    assert(trialValues[0].extent(0) == componentCount);
+      assert(trialValues[0].extent(0) == componentCount);
 #endif
 
-    // Assert that the result has only one element
-    assert(result.size() == 1);
-
-    // (t - k)* . (t - k)
-    result[0] = 0.;
-    for (size_t i = 0; i < componentCount; ++i) {
-      result[0] += conj(trialValues[0](i) - kernelValues[0](i, 0)) *
-                   (trialValues[0](i) - kernelValues[0](i, 0));
+      // (t - k)* . (t - k) and k* . k
+      ResultType difference = 0., reference = 0.;
+      for (size_t i = 0; i < componentCount; ++i) {
+        difference += conj(trialValues[0](i) - kernelValues[f](i, 0)) *
+                      (trialValues[0](i) - kernelValues[f](i, 0));
+        reference += conj(kernelValues[f](i, 0)) * kernelValues[f](i, 0);
+      }
+      result[2 * f] = difference;
+      result[2 * f + 1] = reference;
     }
   }
+
+private:
+  size_t m_functionCount;
 };
 
 template <typename BasisFunctionType, typename ResultType>
 std::unique_ptr<Fiber::EvaluatorForIntegralOperators<ResultType>>
 makeEvaluator(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
-              const Fiber::Function<ResultType> &refFunction,
+              const std::vector<const Fiber::Function<ResultType> *> &
+                  refFunctions,
               const Fiber::QuadratureStrategy<BasisFunctionType, ResultType,
                                               GeometryFactory> &quadStrategy,
               const EvaluationOptions &options) {
@@ -148,7 +238,7 @@ makeEvaluator(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
   typedef std::vector<std::vector<ResultType>> CoefficientsVector;
   typedef LocalAssemblerConstructionHelper Helper;
 
-  shared_ptr<RawGridGeometry> rawGeometry;
+  shared_ptr<const RawGridGeometry> rawGeometry;
   shared_ptr<GeometryFactory> geometryFactory;
   shared_ptr<Fiber::OpenClHandler> openClHandler;
   shared_ptr<ShapesetPtrVector> shapesets;
@@ -176,10 +266,10 @@ makeEvaluator(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
   }
 
   // Construct kernels collection
-  typedef KernelFunctorFromUnaryFunction<ResultType> KernelFunctor;
+  typedef KernelFunctorFromUnaryFunctions<ResultType> KernelFunctor;
   typedef Fiber::DefaultCollectionOfKernels<KernelFunctor> Kernels;
   shared_ptr<Fiber::CollectionOfKernels<ResultType>> kernels =
-      boost::make_shared<Kernels>(KernelFunctor(refFunction));
+      boost::make_shared<Kernels>(KernelFunctor(refFunctions));
 
   // Construct trial function transformations collection
   const Fiber::CollectionOfShapesetTransformations<CoordinateType> &
@@ -191,7 +281,7 @@ makeEvaluator(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
   shared_ptr<Fiber::KernelTrialIntegral<BasisFunctionType, ResultType,
                                         ResultType>> integral =
       boost::make_shared<Fiber::DefaultKernelTrialIntegral<IntegralFunctor>>(
-          IntegralFunctor());
+          IntegralFunctor(refFunctions.size()));
 
   // Now create the evaluator
   return quadStrategy.makeEvaluatorForIntegralOperators(
@@ -201,34 +291,66 @@ makeEvaluator(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
       options.parallelizationOptions());
 }
 
-} // namespace
-
+// Integrate the squared norms of the differences between gridFunction and
+// each of refFunctions, and of refFunctions themselves, in one pass over
+// the grid; return their square roots
 template <typename BasisFunctionType, typename ResultType>
-typename ScalarTraits<BasisFunctionType>::RealType L2NormOfDifference(
+void calculateL2Norms(
     const GridFunction<BasisFunctionType, ResultType> &gridFunction,
-    const Fiber::Function<ResultType> &refFunction,
+    const std::vector<const Fiber::Function<ResultType> *> &refFunctions,
     const Fiber::QuadratureStrategy<BasisFunctionType, ResultType,
                                     GeometryFactory> &quadStrategy,
-    const EvaluationOptions &options) {
+    const EvaluationOptions &options,
+    std::vector<typename ScalarTraits<BasisFunctionType>::RealType> &
+        differenceNorms,
+    std::vector<typename ScalarTraits<BasisFunctionType>::RealType> &
+        refNorms) {
+  typedef typename Fiber::ScalarTraits<BasisFunctionType>::RealType
+  MagnitudeType;
+  typedef MagnitudeType CoordinateType;
+
+  differenceNorms.resize(refFunctions.size());
+  refNorms.resize(refFunctions.size());
+  if (refFunctions.empty())
+    return;
+
   // First, construct the evaluator.
   typedef Fiber::EvaluatorForIntegralOperators<ResultType> Evaluator;
   std::unique_ptr<Evaluator> evaluator =
-      makeEvaluator(gridFunction, refFunction, quadStrategy, options);
+      makeEvaluator(gridFunction, refFunctions, quadStrategy, options);
 
-  typedef typename Fiber::ScalarTraits<BasisFunctionType>::RealType
-  MagnitudeType;
-  typedef MagnitudeType CoordinateType;
   arma::Mat<CoordinateType> evaluationPoints(1, 1);
   evaluationPoints(0, 0) = 0.;
   arma::Mat<ResultType> resultMatrix;
   evaluator->evaluate(Evaluator::FAR_FIELD, evaluationPoints, resultMatrix);
 
-  ResultType result = resultMatrix(0, 0);
-  if (fabs(imagPart(result)) >
-      1000. * std::numeric_limits<MagnitudeType>::epsilon())
-    std::cout << "Warning: squared L2 norm has non-negligible imaginary part: "
-              << imagPart(result) << std::endl;
-  return sqrt(realPart(result));
+  for (size_t i = 0; i < resultMatrix.n_rows; ++i) {
+    ResultType result = resultMatrix(i, 0);
+    if (fabs(imagPart(result)) >
+        1000. * std::numeric_limits<MagnitudeType>::epsilon())
+      std::cout << "Warning: squared L2 norm has non-negligible imaginary "
+                   "part: " << imagPart(result) << std::endl;
+    (i % 2 == 0 ? differenceNorms : refNorms)[i / 2] = sqrt(realPart(result));
+  }
+}
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+typename ScalarTraits<BasisFunctionType>::RealType L2NormOfDifference(
+    const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+    const Fiber::Function<ResultType> &refFunction,
+    const Fiber::QuadratureStrategy<BasisFunctionType, ResultType,
+                                    GeometryFactory> &quadStrategy,
+    const EvaluationOptions &options) {
+  typedef typename Fiber::ScalarTraits<BasisFunctionType>::RealType
+  MagnitudeType;
+  std::vector<MagnitudeType> differenceNorms, refNorms;
+  calculateL2Norms(gridFunction,
+                   std::vector<const Fiber::Function<ResultType> *>(
+                       1, &refFunction),
+                   quadStrategy, options, differenceNorms, refNorms);
+  return differenceNorms[0];
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -242,11 +364,13 @@ estimateL2Error(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
                 typename ScalarTraits<BasisFunctionType>::RealType &relError) {
   typedef typename Fiber::ScalarTraits<BasisFunctionType>::RealType
   MagnitudeType;
-  absError =
-      L2NormOfDifference(gridFunction, refFunction, quadStrategy, options);
-  MagnitudeType refNorm =
-      L2NormOfDifference(0. * gridFunction, refFunction, quadStrategy, options);
-  relError = absError / refNorm;
+  std::vector<MagnitudeType> absErrors, relErrors;
+  estimateL2Errors(gridFunction,
+                   std::vector<const Fiber::Function<ResultType> *>(
+                       1, &refFunction),
+                   quadStrategy, options, absErrors, relErrors);
+  absError = absErrors[0];
+  relError = relErrors[0];
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -261,6 +385,27 @@ estimateL2Error(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
                   absError, relError);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void estimateL2Errors(
+    const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+    const std::vector<const Fiber::Function<ResultType> *> &refFunctions,
+    const Fiber::QuadratureStrategy<BasisFunctionType, ResultType,
+                                    GeometryFactory> &quadStrategy,
+    const EvaluationOptions &options,
+    std::vector<typename ScalarTraits<BasisFunctionType>::RealType> &absErrors,
+    std::vector<typename ScalarTraits<BasisFunctionType>::RealType> &
+        relErrors) {
+  for (size_t i = 0; i < refFunctions.size(); ++i)
+    if (!refFunctions[i])
+      throw std::invalid_argument("estimateL2Errors(): "
+                                  "refFunctions must not contain null "
+                                  "pointers");
+  calculateL2Norms(gridFunction, refFunctions, quadStrategy, options,
+                   absErrors, relErrors);
+  for (size_t i = 0; i < refFunctions.size(); ++i)
+    relErrors[i] = absErrors[i] / relErrors[i];
+}
+
 #define INSTANTIATE_FUNCTION(BASIS, RESULT)                                    \
   template ScalarTraits<BASIS>::RealType L2NormOfDifference(                   \
       const GridFunction<BASIS, RESULT> &gridFunction,                         \
@@ -282,7 +427,15 @@ estimateL2Error(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
       const Fiber::QuadratureStrategy<BASIS, RESULT, GeometryFactory> &        \
           quadStrategy,                                                        \
       ScalarTraits<BASIS>::RealType &absError,                                 \
-      ScalarTraits<BASIS>::RealType &relError)
+      ScalarTraits<BASIS>::RealType &relError);                                \
+  template void estimateL2Errors(                                              \
+      const GridFunction<BASIS, RESULT> &gridFunction,                         \
+      const std::vector<const Fiber::Function<RESULT> *> &refFunctions,        \
+      const Fiber::QuadratureStrategy<BASIS, RESULT, GeometryFactory> &        \
+          quadStrategy,                                                        \
+      const EvaluationOptions &options,                                        \
+      std::vector<ScalarTraits<BASIS>::RealType> &absErrors,                   \
+      std::vector<ScalarTraits<BASIS>::RealType> &relErrors)
 
 FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_FUNCTION);
 
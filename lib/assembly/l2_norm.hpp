@@ -29,6 +29,8 @@
 #include "evaluation_options.hpp"
 #include "../fiber/quadrature_strategy.hpp"
 
+#include <vector>
+
 namespace Fiber {
 
 /** \cond FORWARD_DECL */
@@ -110,6 +112,26 @@ estimateL2Error(const GridFunction<BasisFunctionType, ResultType> &gridFunction,
                 typename ScalarTraits<BasisFunctionType>::RealType &absError,
                 typename ScalarTraits<BasisFunctionType>::RealType &relError);
 
+/** \relates GridFunction
+ *  \brief Calculate the absolute and relative \f$L^2\f$ errors of a solution
+ *  with respect to several functions at once.
+ *
+ *  On output, \p absErrors[i] and \p relErrors[i] are the absolute and
+ *  relative \f$L^2\f$ norms of the difference between \p gridFunction and
+ *  \p *refFunctions[i], as returned by estimateL2Error(). All the norms are
+ *  integrated in a single pass over the grid, which is considerably cheaper
+ *  than calling estimateL2Error() for each function. */
+template <typename BasisFunctionType, typename ResultType>
+void estimateL2Errors(
+    const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+    const std::vector<const Fiber::Function<ResultType> *> &refFunctions,
+    const Fiber::QuadratureStrategy<BasisFunctionType, ResultType,
+                                    GeometryFactory> &quadStrategy,
+    const EvaluationOptions &options,
+    std::vector<typename ScalarTraits<BasisFunctionType>::RealType> &absErrors,
+    std::vector<typename ScalarTraits<BasisFunctionType>::RealType> &
+        relErrors);
+
 } // namespace Bempp
 
 #endif
@@ -0,0 +1,142 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "lagrange_trace.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/boost_make_shared_fwd.hpp"
+#include "../common/types.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../space/piecewise_linear_continuous_scalar_space.hpp"
+#include "../space/piecewise_polynomial_continuous_scalar_space.hpp"
+
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
+#include <Epetra_SerialComm.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace Bempp {
+
+template <typename BasisFunctionType>
+shared_ptr<Epetra_CrsMatrix>
+lagrangeTraceMatrix(const Space<BasisFunctionType> &space,
+                    const arma::Mat<double> &femDofPositions,
+                    double tolerance) {
+  typedef PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>
+      PolynomialSpace;
+  if (!dynamic_cast<const PiecewiseLinearContinuousScalarSpace<
+          BasisFunctionType> *>(&space) &&
+      !(dynamic_cast<const PolynomialSpace *>(&space) &&
+        maximumShapesetOrder(space) <= 2))
+    throw std::invalid_argument(
+        "lagrangeTraceMatrix(): space must be a space of continuous "
+        "piecewise polynomial functions of order 1 or 2");
+  if (femDofPositions.n_rows != 3)
+    throw std::invalid_argument(
+        "lagrangeTraceMatrix(): femDofPositions must have three rows");
+  if (!(tolerance > 0.))
+    throw std::invalid_argument(
+        "lagrangeTraceMatrix(): tolerance must be positive");
+
+  const int femDofCount = femDofPositions.n_cols;
+  const int dofCount = space.globalDofCount();
+  typedef typename Space<BasisFunctionType>::CoordinateType CoordinateType;
+  std::vector<Point3D<CoordinateType>> positions;
+  space.getGlobalDofPositions(positions);
+
+  // Hash grid of the finite-element DOFs with cells of size 2 * tol, so
+  // that the counterpart of a DOF lies in one of the 27 cells around it
+  double diameter = 0.;
+  if (femDofCount > 0)
+    diameter = arma::norm(arma::max(femDofPositions, 1) -
+                              arma::min(femDofPositions, 1),
+                          2);
+  const double tol = tolerance * std::max(diameter, 1.);
+  const double cellSize = 2. * tol;
+  typedef std::array<long long, 3> CellKey;
+  std::map<CellKey, std::vector<int>> cells;
+  for (int j = 0; j < femDofCount; ++j) {
+    CellKey key;
+    for (int d = 0; d < 3; ++d)
+      key[d] = std::floor(femDofPositions(d, j) / cellSize);
+    cells[key].push_back(j);
+  }
+
+  std::vector<int> columns(dofCount, -1);
+  for (int i = 0; i < dofCount; ++i) {
+    const double x[3] = {positions[i].x, positions[i].y, positions[i].z};
+    CellKey center;
+    for (int d = 0; d < 3; ++d)
+      center[d] = std::floor(x[d] / cellSize);
+    CellKey key;
+    for (int dx = -1; dx <= 1 && columns[i] < 0; ++dx)
+      for (int dy = -1; dy <= 1 && columns[i] < 0; ++dy)
+        for (int dz = -1; dz <= 1 && columns[i] < 0; ++dz) {
+          key[0] = center[0] + dx;
+          key[1] = center[1] + dy;
+          key[2] = center[2] + dz;
+          auto cell = cells.find(key);
+          if (cell == cells.end())
+            continue;
+          for (int j : cell->second)
+            if (std::abs(femDofPositions(0, j) - x[0]) <= tol &&
+                std::abs(femDofPositions(1, j) - x[1]) <= tol &&
+                std::abs(femDofPositions(2, j) - x[2]) <= tol) {
+              columns[i] = j;
+              break;
+            }
+        }
+    if (columns[i] < 0)
+      throw std::runtime_error(
+          "lagrangeTraceMatrix(): no finite-element DOF found at the "
+          "position of a DOF of the boundary-element space");
+  }
+
+  std::vector<int> rowLengths(dofCount, 1);
+  Epetra_SerialComm comm; // To be replaced once we begin to use MPI
+  Epetra_LocalMap rowMap(dofCount, 0 /* index_base */, comm);
+  Epetra_LocalMap colMap(femDofCount, 0 /* index_base */, comm);
+  shared_ptr<Epetra_CrsMatrix> result = boost::make_shared<Epetra_CrsMatrix>(
+      Copy, rowMap, colMap, dofCount > 0 ? &rowLengths[0] : 0,
+      true /* static profile */);
+  const double one = 1.;
+  for (int row = 0; row < dofCount; ++row)
+    result->InsertGlobalValues(row, 1, &one, &columns[row]);
+  result->FillComplete(colMap, rowMap);
+  return result;
+}
+
+#define INSTANTIATE_LAGRANGE_TRACE_MATRIX(BASIS)                               \
+  template shared_ptr<Epetra_CrsMatrix> lagrangeTraceMatrix(                   \
+      const Space<BASIS> &space, const arma::Mat<double> &femDofPositions,    \
+      double tolerance)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_LAGRANGE_TRACE_MATRIX);
+
+} // namespace Bempp
+
+#endif // WITH_TRILINOS
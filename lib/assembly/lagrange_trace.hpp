@@ -0,0 +1,72 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_lagrange_trace_hpp
+#define bempp_lagrange_trace_hpp
+
+#include "../common/common.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+
+/** \cond FORWARD_DECL */
+class Epetra_CrsMatrix;
+/** \endcond */
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \brief Sparse matrix of the trace of a continuous Lagrange finite-element
+ *  space onto a boundary-element space.
+ *
+ *  \p space must be a space of continuous piecewise polynomial functions
+ *  (PiecewiseLinearContinuousScalarSpace or
+ *  PiecewisePolynomialContinuousScalarSpace of order at most 2) defined on
+ *  the boundary of the finite-element mesh, and \p femDofPositions a
+ *  (3 x n) matrix whose <em>j</em>th column contains the position of the
+ *  <em>j</em>th degree of freedom of a finite-element space of the same
+ *  order, for example as returned by FEniCS'
+ *  <tt>FunctionSpace.tabulate_dof_coordinates()</tt>. The nodal DOFs of both
+ *  spaces then coincide on the boundary, and the <tt>(i, j)</tt>th entry of
+ *  the returned (<tt>space.globalDofCount()</tt> x n) matrix is 1 if the
+ *  <em>i</em>th DOF of \p space lies at the position of the <em>j</em>th
+ *  finite-element DOF and 0 otherwise.
+ *
+ *  Positions are considered equal if they differ, in each coordinate, by at
+ *  most \p tolerance times the diameter of the bounding box of
+ *  \p femDofPositions. The matching uses a hash grid and takes linear time.
+ *  An exception is thrown if some DOF of \p space has no counterpart. */
+template <typename BasisFunctionType>
+shared_ptr<Epetra_CrsMatrix>
+lagrangeTraceMatrix(const Space<BasisFunctionType> &space,
+                    const arma::Mat<double> &femDofPositions,
+                    double tolerance = 1e-10);
+
+} // namespace Bempp
+
+#endif // WITH_TRILINOS
+
+#endif
@@ -24,6 +24,7 @@
 #include "context.hpp"
 #include "general_elementary_singular_integral_operator_imp.hpp"
 #include "laplace_3d_synthetic_boundary_operator_builder.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../fiber/explicit_instantiation.hpp"
 
@@ -43,8 +44,9 @@ laplace3dAdjointDoubleLayerBoundaryOperator(
     const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
     const std::string &label, int symmetry) {
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
-  if (assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
-      assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY)
+  if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
+       assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange))
     return laplace3dSyntheticBoundaryOperator(
         &laplace3dAdjointDoubleLayerBoundaryOperator<BasisFunctionType,
                                                      ResultType>,
@@ -62,7 +64,8 @@ laplace3dAdjointDoubleLayerBoundaryOperator(
 
   shared_ptr<Fiber::TestKernelTrialIntegral<BasisFunctionType, KernelType,
                                             ResultType>> integral;
-  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange))
+  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange,
+                                true /* scalar transformations */))
     integral.reset(new Fiber::TypicalTestScalarKernelTrialIntegral<
         BasisFunctionType, KernelType, ResultType>());
   else
@@ -74,6 +77,15 @@ laplace3dAdjointDoubleLayerBoundaryOperator(
   shared_ptr<Op> newOp(new Op(domain, range, dualToRange, label, symmetry,
                               KernelFunctor(), TransformationFunctor(),
                               TransformationFunctor(), integral));
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "laplace3dAdjointDoubleLayer", *newOp));
+  // The weak form of this operator is the transpose of that of the
+  // double-layer operator on the swapped spaces
+  newOp->setTransposeId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "laplace3dDoubleLayer", dualToRange.get(), domain.get(),
+      newOp->symmetry()));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
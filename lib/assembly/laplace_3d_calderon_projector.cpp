@@ -31,6 +31,7 @@
 #include "../assembly/context.hpp"
 
 #include <boost/make_shared.hpp>
+#include <vector>
 
 namespace Bempp {
 
@@ -74,11 +75,21 @@ laplace3dExteriorCalderonProjector(
 
   BlockedOperatorStructure<BasisFunctionType, ResultType> structure;
 
-  structure.setBlock(0, 0, .5 * idDouble + dlp);
+  BdOp doubleLayerBlock = .5 * idDouble + dlp;
+  structure.setBlock(0, 0, doubleLayerBlock);
   structure.setBlock(0, 1, -1. * idSpaceTransformation2 * internalSlp *
                                idSpaceTransformation1);
   structure.setBlock(1, 0, -1. * hyp);
-  structure.setBlock(1, 1, .5 * idAdjDouble - adjDlp);
+  if (context->assemblyOptions().isJointAssemblyEnabled()) {
+    // The jointly assembled (0, 0) block does not reuse the weak form of
+    // dlp, so the (1, 1) block is expressed through its adjoint. The
+    // weak forms shared by several blocks are then assembled once, up
+    // front, rather than by each block when the blocks are assembled
+    // concurrently.
+    structure.setBlock(1, 1, idAdjDouble - adjoint(doubleLayerBlock));
+    assembleWeakForms(std::vector<BdOp>{internalSlp, doubleLayerBlock});
+  } else
+    structure.setBlock(1, 1, .5 * idAdjDouble - adjDlp);
 
   return BlockedBoundaryOperator<BasisFunctionType, ResultType>(structure);
 }
@@ -123,11 +134,17 @@ laplace3dInteriorCalderonProjector(
 
   BlockedOperatorStructure<BasisFunctionType, ResultType> structure;
 
-  structure.setBlock(0, 0, .5 * idDouble - dlp);
+  BdOp doubleLayerBlock = .5 * idDouble - dlp;
+  structure.setBlock(0, 0, doubleLayerBlock);
   structure.setBlock(0, 1, idSpaceTransformation2 * internalSlp *
                                idSpaceTransformation1);
   structure.setBlock(1, 0, hyp);
-  structure.setBlock(1, 1, .5 * idAdjDouble + adjDlp);
+  if (context->assemblyOptions().isJointAssemblyEnabled()) {
+    // See laplace3dExteriorCalderonProjector()
+    structure.setBlock(1, 1, idAdjDouble - adjoint(doubleLayerBlock));
+    assembleWeakForms(std::vector<BdOp>{internalSlp, doubleLayerBlock});
+  } else
+    structure.setBlock(1, 1, .5 * idAdjDouble + adjDlp);
 
   return BlockedBoundaryOperator<BasisFunctionType, ResultType>(structure);
 }
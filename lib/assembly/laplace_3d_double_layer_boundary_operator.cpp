@@ -24,6 +24,7 @@
 #include "context.hpp"
 #include "general_elementary_singular_integral_operator_imp.hpp"
 #include "laplace_3d_synthetic_boundary_operator_builder.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../fiber/explicit_instantiation.hpp"
 
@@ -49,8 +50,9 @@ laplace3dDoubleLayerBoundaryOperator(
     const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
     const std::string &label, int symmetry) {
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
-  if (assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
-      assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY)
+  if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
+       assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange))
     return laplace3dSyntheticBoundaryOperator(
         &laplace3dDoubleLayerBoundaryOperator<BasisFunctionType, ResultType>,
         context, domain, range, dualToRange, label, symmetry, NO_SYMMETRY);
@@ -69,7 +71,8 @@ laplace3dDoubleLayerBoundaryOperator(
                                                     KernelType, ResultType> Op;
   shared_ptr<Fiber::TestKernelTrialIntegral<BasisFunctionType, KernelType,
                                             ResultType>> integral;
-  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange))
+  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange,
+                                true /* scalar transformations */))
     integral.reset(new Fiber::TypicalTestScalarKernelTrialIntegral<
         BasisFunctionType, KernelType, ResultType>());
   else
@@ -79,6 +82,15 @@ laplace3dDoubleLayerBoundaryOperator(
   shared_ptr<Op> newOp(new Op(domain, range, dualToRange, label, symmetry,
                               KernelFunctor(), TransformationFunctor(),
                               TransformationFunctor(), integral));
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "laplace3dDoubleLayer", *newOp));
+  // The weak form of this operator is the transpose of that of the adjoint
+  // double-layer operator on the swapped spaces
+  newOp->setTransposeId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "laplace3dAdjointDoubleLayer", dualToRange.get(), domain.get(),
+      newOp->symmetry()));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
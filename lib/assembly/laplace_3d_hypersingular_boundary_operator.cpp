@@ -26,6 +26,7 @@
 #include "general_hypersingular_integral_operator_imp.hpp"
 #include "laplace_3d_single_layer_boundary_operator.hpp"
 #include "synthetic_integral_operator.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
 
@@ -89,9 +90,9 @@ laplace3dSyntheticHypersingularBoundaryOperator(
   SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
       context, internalContext, auxContext);
   shared_ptr<const Space<BasisFunctionType>> internalTrialSpace =
-      newDomain->discontinuousSpace(newDomain);
+      internalDiscontinuousSpace(*context, newDomain);
   shared_ptr<const Space<BasisFunctionType>> internalTestSpace =
-      newDualToRange->discontinuousSpace(newDualToRange);
+      internalDiscontinuousSpace(*context, newDualToRange);
 
   // Note: we don't really need to care about ranges and duals to domains of
   // the internal operator. The only range space that matters is that of the
@@ -163,7 +164,8 @@ laplace3dHypersingularBoundaryOperator(
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
   if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
        assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
-      (externalSlp.isInitialized()))
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange) ||
+      externalSlp.isInitialized())
     return laplace3dSyntheticHypersingularBoundaryOperator(
         context, domain, range, dualToRange, label, symmetry, externalSlp);
 
@@ -207,6 +209,9 @@ laplace3dHypersingularBoundaryOperator(
              OffDiagonalKernelFunctor(), OffDiagonalTransformationFunctor(),
              OffDiagonalTransformationFunctor(), offDiagonalIntegral));
 
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "laplace3dHypersingular", *newOp));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
@@ -24,6 +24,7 @@
 #include "context.hpp"
 #include "general_elementary_singular_integral_operator_imp.hpp"
 #include "laplace_3d_synthetic_boundary_operator_builder.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
 
@@ -48,8 +49,9 @@ laplace3dSingleLayerBoundaryOperator(
     const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
     const std::string &label, int symmetry) {
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
-  if (assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
-      assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY)
+  if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
+       assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange))
     return laplace3dSyntheticBoundaryOperator(
         &laplace3dSingleLayerBoundaryOperator<BasisFunctionType, ResultType>,
         context, domain, range, dualToRange, label, symmetry,
@@ -70,7 +72,8 @@ laplace3dSingleLayerBoundaryOperator(
 
   shared_ptr<Fiber::TestKernelTrialIntegral<BasisFunctionType, KernelType,
                                             ResultType>> integral;
-  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange))
+  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange,
+                                true /* scalar transformations */))
     integral.reset(new Fiber::TypicalTestScalarKernelTrialIntegral<
         BasisFunctionType, KernelType, ResultType>());
   else
@@ -79,6 +82,9 @@ laplace3dSingleLayerBoundaryOperator(
   shared_ptr<Op> newOp(new Op(domain, range, dualToRange, label, symmetry,
                               KernelFunctor(), TransformationFunctor(),
                               TransformationFunctor(), integral));
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "laplace3dSingleLayer", *newOp));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
@@ -23,6 +23,7 @@
 #include "abstract_boundary_operator.hpp"
 #include "boundary_operator.hpp"
 #include "context.hpp"
+#include "synthetic_integral_operator.hpp"
 #include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../fiber/explicit_instantiation.hpp"
@@ -62,17 +63,15 @@ laplace3dSyntheticBoundaryOperator(
     newDualToRange = dualToRange->barycentricSpace(dualToRange);
   }
 
-  AssemblyOptions internalAssemblyOptions = context->assemblyOptions();
-  AcaOptions internalAcaOptions = internalAssemblyOptions.acaOptions();
-  internalAcaOptions.mode = AcaOptions::GLOBAL_ASSEMBLY;
-  internalAssemblyOptions.switchToAcaMode(internalAcaOptions);
-  typedef Context<BasisFunctionType, ResultType> Ctx;
-  shared_ptr<Ctx> internalContext(
-      new Ctx(context->quadStrategy(), internalAssemblyOptions));
+  typedef SyntheticIntegralOperator<BasisFunctionType, ResultType> SyntheticOp;
+  shared_ptr<const Context<BasisFunctionType, ResultType>> internalContext,
+      auxContext;
+  SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
+      context, internalContext, auxContext);
   shared_ptr<const Space<BasisFunctionType>> internalTrialSpace =
-      newDomain->discontinuousSpace(domain);
+      internalDiscontinuousSpace(*context, newDomain);
   shared_ptr<const Space<BasisFunctionType>> internalTestSpace =
-      newDualToRange->discontinuousSpace(dualToRange);
+      internalDiscontinuousSpace(*context, newDualToRange);
 
   if (label.empty())
     label =
@@ -84,7 +83,7 @@ laplace3dSyntheticBoundaryOperator(
           : 0;
   // std::cout << "syntheseSymmetry: " << syntheseSymmetry << std::endl;
   BoundaryOperator<BasisFunctionType, ResultType> internalOp = constructor(
-      internalContext, internalTrialSpace, range /* or whatever */,
+      internalContext, internalTrialSpace, internalTestSpace /* or whatever */,
       internalTestSpace, "(" + label + ")_internal", internalSymmetry);
   return syntheticNonhypersingularIntegralOperator(
       internalOp, newDomain, range, newDualToRange, internalTrialSpace,
@@ -0,0 +1,176 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "level_transfer.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "../common/boost_make_shared_fwd.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/entity_pointer.hpp"
+#include "../grid/geometry.hpp"
+#include "../grid/grid.hpp"
+#include "../grid/grid_view.hpp"
+#include "../grid/index_set.hpp"
+#include "../space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
+#include <Epetra_SerialComm.h>
+
+#include <cmath>
+#include <stdexcept>
+
+namespace Bempp {
+
+namespace {
+
+// Barycentric coordinates of the point x in the triangle with the given
+// corners, computed in the plane of the triangle
+void barycentricCoordinates(const arma::Mat<double> &corners,
+                            const arma::Col<double> &x, double *lambda) {
+  const arma::Col<double> e1 = corners.col(1) - corners.col(0);
+  const arma::Col<double> e2 = corners.col(2) - corners.col(0);
+  const arma::Col<double> d = x - corners.col(0);
+  const double g11 = arma::dot(e1, e1), g12 = arma::dot(e1, e2),
+               g22 = arma::dot(e2, e2);
+  const double r1 = arma::dot(e1, d), r2 = arma::dot(e2, d);
+  const double det = g11 * g22 - g12 * g12;
+  lambda[1] = (g22 * r1 - g12 * r2) / det;
+  lambda[2] = (g11 * r2 - g12 * r1) / det;
+  lambda[0] = 1. - lambda[1] - lambda[2];
+}
+
+} // namespace
+
+template <typename BasisFunctionType>
+shared_ptr<Epetra_CrsMatrix>
+levelTransferMatrix(const Space<BasisFunctionType> &space, int level,
+                    std::vector<double> *meshSizes) {
+  if (!dynamic_cast<const PiecewiseLinearContinuousScalarSpace<
+          BasisFunctionType> *>(&space))
+    throw std::invalid_argument("levelTransferMatrix(): space must be a "
+                                "PiecewiseLinearContinuousScalarSpace");
+  const Grid &grid = *space.grid();
+  if (grid.dim() != 2)
+    throw std::invalid_argument("levelTransferMatrix(): only triangular "
+                                "grids are supported");
+  if (level < 0 || level > grid.maxLevel())
+    throw std::invalid_argument("levelTransferMatrix(): invalid level");
+
+  const int vertexCodim = 2;
+  std::unique_ptr<GridView> levelView = grid.levelView(level);
+  const IndexSet &levelIndexSet = levelView->indexSet();
+  const int levelVertexCount = levelView->entityCount(vertexCodim);
+  const int dofCount = space.globalDofCount();
+
+  // Columns and values of the rows; every row has at most three entries
+  // per leaf element, and repeated entries have equal values
+  std::vector<std::vector<int>> columns(dofCount);
+  std::vector<std::vector<double>> values(dofCount);
+
+  std::unique_ptr<GridView> leafView = grid.leafView();
+  std::unique_ptr<EntityIterator<0>> it = leafView->entityIterator<0>();
+  std::vector<GlobalDofIndex> dofs;
+  arma::Mat<double> corners, ancestorCorners;
+  while (!it->finished()) {
+    const Entity<0> &element = it->entity();
+    if (element.level() >= static_cast<size_t>(level)) {
+      std::unique_ptr<EntityPointer<0>> ancestor;
+      const Entity<0> *current = &element;
+      while (current->level() > static_cast<size_t>(level)) {
+        ancestor = current->father();
+        current = &ancestor->entity();
+      }
+      current->geometry().getCorners(ancestorCorners);
+      element.geometry().getCorners(corners);
+      space.getGlobalDofs(element, dofs);
+      for (size_t k = 0; k < dofs.size(); ++k) {
+        const int dof = dofs[k];
+        if (dof < 0)
+          continue;
+        double lambda[3];
+        barycentricCoordinates(ancestorCorners, corners.unsafe_col(k),
+                               lambda);
+        for (int c = 0; c < 3; ++c) {
+          if (std::abs(lambda[c]) < 1e-10)
+            continue;
+          const int vertex =
+              levelIndexSet.subEntityIndex(*current, c, vertexCodim);
+          bool present = false;
+          for (size_t e = 0; e < columns[dof].size(); ++e)
+            present = present || columns[dof][e] == vertex;
+          if (!present) {
+            columns[dof].push_back(vertex);
+            values[dof].push_back(lambda[c]);
+          }
+        }
+      }
+    }
+    it->next();
+  }
+
+  if (meshSizes) {
+    std::vector<double> areas(levelVertexCount, 0.);
+    std::vector<int> counts(levelVertexCount, 0);
+    std::unique_ptr<EntityIterator<0>> levelIt =
+        levelView->entityIterator<0>();
+    while (!levelIt->finished()) {
+      const Entity<0> &element = levelIt->entity();
+      const double area = element.geometry().volume();
+      for (int c = 0; c < 3; ++c) {
+        const int vertex =
+            levelIndexSet.subEntityIndex(element, c, vertexCodim);
+        areas[vertex] += area;
+        ++counts[vertex];
+      }
+      levelIt->next();
+    }
+    meshSizes->resize(levelVertexCount);
+    for (int i = 0; i < levelVertexCount; ++i)
+      (*meshSizes)[i] = counts[i] ? std::sqrt(areas[i] / counts[i]) : 1.;
+  }
+
+  std::vector<int> rowLengths(dofCount);
+  for (int row = 0; row < dofCount; ++row)
+    rowLengths[row] = columns[row].size();
+  Epetra_SerialComm comm; // To be replaced once we begin to use MPI
+  Epetra_LocalMap rowMap(dofCount, 0 /* index_base */, comm);
+  Epetra_LocalMap colMap(levelVertexCount, 0 /* index_base */, comm);
+  shared_ptr<Epetra_CrsMatrix> result = boost::make_shared<Epetra_CrsMatrix>(
+      Copy, rowMap, colMap, &rowLengths[0], true /* static profile */);
+  for (int row = 0; row < dofCount; ++row)
+    if (rowLengths[row] > 0)
+      result->InsertGlobalValues(row, rowLengths[row], &values[row][0],
+                                 &columns[row][0]);
+  result->FillComplete(colMap, rowMap);
+  return result;
+}
+
+#define INSTANTIATE_LEVEL_TRANSFER_MATRIX(BASIS)                               \
+  template shared_ptr<Epetra_CrsMatrix> levelTransferMatrix(                   \
+      const Space<BASIS> &space, int level, std::vector<double> *meshSizes)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_LEVEL_TRANSFER_MATRIX);
+
+} // namespace Bempp
+
+#endif // WITH_TRILINOS
@@ -0,0 +1,68 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_level_transfer_hpp
+#define bempp_level_transfer_hpp
+
+#include "../common/common.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "../common/shared_ptr.hpp"
+
+#include <vector>
+
+/** \cond FORWARD_DECL */
+class Epetra_CrsMatrix;
+/** \endcond */
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \brief Sparse matrix expressing the nodal basis of a level of the grid
+ *  hierarchy in a space of continuous piecewise linear functions.
+ *
+ *  \p space must be a PiecewiseLinearContinuousScalarSpace on the leaf view
+ *  of a triangular grid. The <tt>(j, i)</tt>th entry of the returned
+ *  matrix is the value, at the position of the <em>j</em>th global DOF of
+ *  \p space, of the nodal basis function of vertex \p i of
+ *  <tt>grid.levelView(level)</tt>, i.e. the continuous piecewise linear
+ *  function on the elements of that level equal to 1 at vertex \p i and 0
+ *  at all other vertices. The entries are found by walking from every leaf
+ *  element up to its ancestor on \p level; leaf elements coarser than \p
+ *  level, which occur in adaptively refined grids, contribute nothing.
+ *
+ *  If \p meshSizes is not null, it is set to the local mesh sizes of the
+ *  level at its vertices, the square roots of the mean areas of the
+ *  adjacent elements. */
+template <typename BasisFunctionType>
+shared_ptr<Epetra_CrsMatrix>
+levelTransferMatrix(const Space<BasisFunctionType> &space, int level,
+                    std::vector<double> *meshSizes = 0);
+
+} // namespace Bempp
+
+#endif // WITH_TRILINOS
+
+#endif
@@ -23,17 +23,33 @@
 #include "../fiber/explicit_instantiation.hpp"
 #include "../space/space.hpp"
 
-#include <map>
-#include <set>
+#include <algorithm>
 #include <utility>
 
 namespace Bempp {
 
+namespace {
+
+template <typename T> std::size_t memorySize(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+
+template <typename BasisFunctionType>
+std::size_t memorySize(const LocalDofLists<BasisFunctionType> &lists) {
+  return sizeof(lists) + memorySize(lists.originalIndices) +
+         memorySize(lists.elementIndices) + memorySize(lists.elementOffsets) +
+         memorySize(lists.localDofIndices) +
+         memorySize(lists.localDofWeights) + memorySize(lists.arrayIndices);
+}
+
+} // namespace
+
 template <typename BasisFunctionType>
 LocalDofListsCache<BasisFunctionType>::LocalDofListsCache(
     const Space<BasisFunctionType> &space, const std::vector<std::size_t> &p2o,
     bool indexWithGlobalDofs)
-    : m_space(space), m_p2o(p2o), m_indexWithGlobalDofs(indexWithGlobalDofs) {}
+    : m_space(space), m_p2o(p2o), m_indexWithGlobalDofs(indexWithGlobalDofs),
+      m_memory(Fiber::MemoryCategory::LOCAL_DOF_LISTS_CACHES) {}
 
 template <typename BasisFunctionType>
 LocalDofListsCache<BasisFunctionType>::~LocalDofListsCache() {
@@ -44,29 +60,24 @@ LocalDofListsCache<BasisFunctionType>::~LocalDofListsCache() {
 }
 
 template <typename BasisFunctionType>
-shared_ptr<const LocalDofLists<BasisFunctionType>>
+const LocalDofLists<BasisFunctionType> &
 LocalDofListsCache<BasisFunctionType>::get(int start, int indexCount) {
   if (indexCount == 1) {
-    shared_ptr<LocalDofLists<BasisFunctionType>> result(
-        new LocalDofLists<BasisFunctionType>);
-    findLocalDofs(start, result->originalIndices, result->elementIndices,
-                  result->localDofIndices, result->localDofWeights,
-                  result->arrayIndices);
-    return result;
+    Scratch &scratch = m_scratch.local();
+    findLocalDofs(start, scratch);
+    return scratch.lists;
   }
 
   std::pair<int, int> key(start, indexCount);
   typename LocalDofListsMap::const_iterator it = m_map.find(key);
   if (it != m_map.end()) {
-    return make_shared_from_ref(*it->second);
+    return *it->second;
   }
 
   // The relevant local DOF list doesn't exist yet and must be created.
   LocalDofLists<BasisFunctionType> *newLists =
       new LocalDofLists<BasisFunctionType>;
-  findLocalDofs(start, indexCount, newLists->originalIndices,
-                newLists->elementIndices, newLists->localDofIndices,
-                newLists->localDofWeights, newLists->arrayIndices);
+  findLocalDofs(start, indexCount, *newLists);
 
   // Attempt to insert the newly created DOF list into the map
   std::pair<typename LocalDofListsMap::iterator, bool> result =
@@ -74,170 +85,124 @@ LocalDofListsCache<BasisFunctionType>::get(int start, int indexCount) {
   if (result.second)
     // Insertion succeeded. The newly created DOF list will be deleted in
     // our own destructor
-    ;
+    m_memory.grow(memorySize(*newLists));
   else
     // Insertion failed -- another thread was faster. Delete the newly
     // created DOF list.
     delete newLists;
 
-  // Return pointer to the DOF list that ended up in the map.
-  return make_shared_from_ref(*result.first->second);
+  // Return the DOF list that ended up in the map.
+  return *result.first->second;
 }
 
 template <typename BasisFunctionType>
 void LocalDofListsCache<BasisFunctionType>::findLocalDofs(
-    int start, int indexCount,
-    std::vector<typename LocalDofLists<BasisFunctionType>::DofIndex> &
-        originalIndices,
-    std::vector<int> &elementIndices,
-    std::vector<std::vector<LocalDofIndex>> &localDofIndices,
-    std::vector<std::vector<BasisFunctionType>> &localDofWeights,
-    std::vector<std::vector<int>> &arrayIndices) const {
-  using std::make_pair;
-  using std::map;
-  using std::pair;
-  using std::set;
-  using std::vector;
+    int start, int indexCount, LocalDofLists<BasisFunctionType> &result) const {
+  result.clear();
 
   // Convert permuted indices into original indices
+  std::vector<typename LocalDofLists<BasisFunctionType>::DofIndex> &
+      originalIndices = result.originalIndices;
   originalIndices.resize(indexCount);
   for (int i = 0; i < indexCount; ++i)
     originalIndices[i] = m_p2o[start + i];
 
-  // map of pairs (local dof index, array index) to local dof weights
-  typedef std::map<pair<LocalDofIndex, int>, BasisFunctionType>
-  LocalDofWeightMap;
-  typedef std::map<EntityIndex, LocalDofWeightMap> LocalDofMap;
-
-  // Temporary map: entityIndex -> set(localDofIndex, arrayIndex)
-  // with arrayIndex standing for the index of the row or column in the matrix
-  // that needs to be returned to Ahmed.
-  LocalDofMap requiredLocalDofs;
-
-  // Retrieve lists of local DOFs corresponding to original indices,
-  // treated either as global DOFs (if m_indexWithGlobalDofs is true)
-  // or flat local DOFs (if m_indexWithGlobalDofs is false)
+  // Local DOFs corresponding to the original indices, treated either as
+  // global DOFs (if m_indexWithGlobalDofs is true) or flat local DOFs (if
+  // m_indexWithGlobalDofs is false), with arrayIndex standing for the index
+  // of the row or column in the matrix block being assembled
+  struct Entry {
+    EntityIndex elementIndex;
+    LocalDofIndex localDofIndex;
+    int arrayIndex;
+    BasisFunctionType weight;
+
+    bool operator<(const Entry &other) const {
+      if (elementIndex != other.elementIndex)
+        return elementIndex < other.elementIndex;
+      if (localDofIndex != other.localDofIndex)
+        return localDofIndex < other.localDofIndex;
+      return arrayIndex < other.arrayIndex;
+    }
+  };
+  std::vector<Entry> entries;
   if (m_indexWithGlobalDofs) {
-    vector<vector<LocalDof>> localDofs;
-    vector<vector<BasisFunctionType>> localDofWeights;
-    m_space.global2localDofs(originalIndices, localDofs, localDofWeights);
-
+    const typename Space<BasisFunctionType>::GlobalToLocalDofTable &table =
+        m_space.globalToLocalDofTable();
     for (int arrayIndex = 0; arrayIndex < indexCount; ++arrayIndex) {
-      const vector<LocalDof> &currentLocalDofs = localDofs[arrayIndex];
-      const vector<BasisFunctionType> &currentLocalDofWeights =
-          localDofWeights[arrayIndex];
-      for (size_t j = 0; j < currentLocalDofs.size(); ++j)
-        requiredLocalDofs[currentLocalDofs[j].entityIndex]
-                         [make_pair(currentLocalDofs[j].dofIndex, arrayIndex)] =
-                             currentLocalDofWeights[j];
+      const int dof = originalIndices[arrayIndex];
+      for (int j = table.offsets[dof]; j < table.offsets[dof + 1]; ++j) {
+        Entry entry = {table.localDofs[j].entityIndex,
+                       table.localDofs[j].dofIndex, arrayIndex,
+                       table.localDofWeights[j]};
+        entries.push_back(entry);
+      }
     }
   } else {
-    vector<LocalDof> localDofs;
-    m_space.flatLocal2localDofs(originalIndices, localDofs);
-
+    const std::vector<LocalDof> &table = m_space.flatLocalToLocalDofTable();
+    entries.reserve(indexCount);
     for (int arrayIndex = 0; arrayIndex < indexCount; ++arrayIndex) {
-      const LocalDof &currentLocalDof = localDofs[arrayIndex];
-      requiredLocalDofs[currentLocalDof.entityIndex]
-                       [make_pair(currentLocalDof.dofIndex, arrayIndex)] = 1.;
+      const LocalDof &localDof = table[originalIndices[arrayIndex]];
+      Entry entry = {localDof.entityIndex, localDof.dofIndex, arrayIndex,
+                     BasisFunctionType(1.)};
+      entries.push_back(entry);
     }
   }
 
-  // Use the temporary map requiredLocalDofs to build the three output vectors
-  const int elementCount = requiredLocalDofs.size();
-  // vector<EntityIndex> elementIndices;
-  // elementIndices.reserve(elementCount);
-
-  elementIndices.resize(elementCount);
-  localDofIndices.clear();
-  localDofIndices.resize(elementCount);
-  localDofWeights.clear();
-  localDofWeights.resize(elementCount);
-  arrayIndices.clear();
-  arrayIndices.resize(elementCount);
-
-  // const ReverseElementMapper& mapper = m_view.reverseElementMapper();
-
-  int e = 0;
-  for (typename LocalDofMap::const_iterator mapIt = requiredLocalDofs.begin();
-       mapIt != requiredLocalDofs.end(); ++mapIt, ++e) {
-    elementIndices[e] = mapIt->first;
-    //        elements[e] = &mapper.entityPointer(mapIt->first);
-    for (typename LocalDofWeightMap::const_iterator wmapIt =
-             mapIt->second.begin();
-         wmapIt != mapIt->second.end(); ++wmapIt) {
-      localDofIndices[e].push_back(wmapIt->first.first);
-      localDofWeights[e].push_back(wmapIt->second);
-      arrayIndices[e].push_back(wmapIt->first.second);
-    }
+  // Group the entries by element to build the flat output arrays
+  std::sort(entries.begin(), entries.end());
+  result.localDofIndices.reserve(entries.size());
+  result.localDofWeights.reserve(entries.size());
+  result.arrayIndices.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i > 0 && entries[i].elementIndex != entries[i - 1].elementIndex)
+      result.elementOffsets.push_back(i);
+    if (i == 0 || entries[i].elementIndex != entries[i - 1].elementIndex)
+      result.elementIndices.push_back(entries[i].elementIndex);
+    result.localDofIndices.push_back(entries[i].localDofIndex);
+    result.localDofWeights.push_back(entries[i].weight);
+    result.arrayIndices.push_back(entries[i].arrayIndex);
   }
+  if (!entries.empty())
+    result.elementOffsets.push_back(entries.size());
 }
 
 template <typename BasisFunctionType>
 void LocalDofListsCache<BasisFunctionType>::findLocalDofs(
-    int index,
-    std::vector<typename LocalDofLists<BasisFunctionType>::DofIndex> &
-        originalIndices,
-    std::vector<int> &elementIndices,
-    std::vector<std::vector<LocalDofIndex>> &localDofIndices,
-    std::vector<std::vector<BasisFunctionType>> &localDofWeights,
-    std::vector<std::vector<int>> &arrayIndices) const {
-  using std::make_pair;
-  using std::map;
-  using std::pair;
-  using std::set;
-  using std::vector;
+    int index, Scratch &scratch) const {
+  LocalDofLists<BasisFunctionType> &result = scratch.lists;
+  result.clear();
 
   // Convert permuted indices into original indices
-  originalIndices.resize(1);
   assert(index >= 0 && index < m_p2o.size());
-  originalIndices[0] = m_p2o[index];
-
-  // set of pairs (local dof index, array index)
-  typedef std::set<pair<LocalDofIndex, int>> LocalDofSet;
-  typedef std::map<EntityIndex, LocalDofSet> LocalDofMap;
-
-  // Retrieve lists of local DOFs corresponding to original indices,
-  // treated either as global DOFs (if m_indexWithGlobalDofs is true)
-  // or flat local DOFs (if m_indexWithGlobalDofs is false)
+  const int dof = m_p2o[index];
+  result.originalIndices.push_back(dof);
+
+  // Look up the local DOFs corresponding to the original index, treated
+  // either as a global DOF (if m_indexWithGlobalDofs is true) or a flat
+  // local DOF (if m_indexWithGlobalDofs is false), in the tables of the
+  // space. All arrays live in the scratch object, so once they have grown
+  // to their final size no memory is allocated any more.
   if (m_indexWithGlobalDofs) {
-    // raw -- means arrays as returned by global2localDofs; the data need to be
-    // subsequently rearranged
-    vector<vector<LocalDof>> rawLocalDofs;
-    vector<vector<BasisFunctionType>> rawLocalDofWeights;
-    m_space.global2localDofs(originalIndices, rawLocalDofs, rawLocalDofWeights);
+    const typename Space<BasisFunctionType>::GlobalToLocalDofTable &table =
+        m_space.globalToLocalDofTable();
 
     // Here we assume that no global DOF contains more than one local DOF
     // from a particular element
-    const vector<LocalDof> &currentLocalDofs = rawLocalDofs[0];
-    const vector<BasisFunctionType> &currentLocalDofWeights =
-        rawLocalDofWeights[0];
-    size_t cnt = currentLocalDofs.size();
-    elementIndices.resize(cnt);
-    localDofIndices.resize(cnt, std::vector<LocalDofIndex>(1));
-    localDofWeights.resize(cnt, std::vector<BasisFunctionType>(1));
-    arrayIndices.resize(cnt, std::vector<int>(1));
-    for (size_t j = 0; j < cnt; ++j) {
-      elementIndices[j] = currentLocalDofs[j].entityIndex;
-      localDofIndices[j][0] = currentLocalDofs[j].dofIndex;
-      localDofWeights[j][0] = currentLocalDofWeights[j];
-      arrayIndices[j][0] = 0;
+    for (int j = table.offsets[dof]; j < table.offsets[dof + 1]; ++j) {
+      result.elementIndices.push_back(table.localDofs[j].entityIndex);
+      result.localDofIndices.push_back(table.localDofs[j].dofIndex);
+      result.localDofWeights.push_back(table.localDofWeights[j]);
+      result.arrayIndices.push_back(0);
+      result.elementOffsets.push_back(j - table.offsets[dof] + 1);
     }
   } else {
-    vector<LocalDof> localDofs;
-    m_space.flatLocal2localDofs(originalIndices, localDofs);
-
-    size_t cnt = localDofs.size();
-    elementIndices.resize(cnt);
-    localDofIndices.resize(cnt, std::vector<LocalDofIndex>(1));
-    localDofWeights.resize(cnt, std::vector<BasisFunctionType>(1));
-    arrayIndices.resize(cnt, std::vector<int>(1));
-
-    for (size_t j = 0; j < cnt; ++j) {
-      elementIndices[j] = localDofs[0].entityIndex;
-      localDofIndices[j][0] = localDofs[0].dofIndex;
-      localDofWeights[j][0] = 1.;
-      arrayIndices[j][0] = 0;
-    }
+    const LocalDof &localDof = m_space.flatLocalToLocalDofTable()[dof];
+    result.elementIndices.push_back(localDof.entityIndex);
+    result.localDofIndices.push_back(localDof.dofIndex);
+    result.localDofWeights.push_back(1.);
+    result.arrayIndices.push_back(0);
+    result.elementOffsets.push_back(1);
   }
 }
 
@@ -24,8 +24,10 @@
 #include "../common/common.hpp"
 #include "../common/shared_ptr.hpp"
 #include "../common/types.hpp"
+#include "../fiber/memory_registry.hpp"
 
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <vector>
 #include <iostream>
 
@@ -38,7 +40,12 @@ template <typename BasisFunctionType> class Space;
 /** \ingroup weak_form_assembly_internal
  *
  *  \brief Data used by WeakFormAcaAssemblyHelper to convert between
- *  H-matrix indices, global and local degrees of freedom. */
+ *  H-matrix indices, global and local degrees of freedom.
+ *
+ *  The local DOFs are stored in compressed sparse row format: those of the
+ *  element elementIndices[e] are the entries elementOffsets[e], ...,
+ *  elementOffsets[e + 1] - 1 of localDofIndices, localDofWeights and
+ *  arrayIndices. */
 template <typename BasisFunctionType> struct LocalDofLists {
   /** \brief Type used to index matrices.
    *
@@ -47,14 +54,28 @@ template <typename BasisFunctionType> struct LocalDofLists {
   typedef int DofIndex;
   std::vector<DofIndex> originalIndices;
   std::vector<int> elementIndices;
-  std::vector<std::vector<LocalDofIndex>> localDofIndices;
-  std::vector<std::vector<BasisFunctionType>> localDofWeights;
-  std::vector<std::vector<int>> arrayIndices;
+  std::vector<int> elementOffsets;
+  std::vector<LocalDofIndex> localDofIndices;
+  std::vector<BasisFunctionType> localDofWeights;
+  std::vector<int> arrayIndices;
+
+  /** \brief Remove all entries, keeping the allocated memory. */
+  void clear() {
+    originalIndices.clear();
+    elementIndices.clear();
+    elementOffsets.assign(1, 0);
+    localDofIndices.clear();
+    localDofWeights.clear();
+    arrayIndices.clear();
+  }
 };
 
 /** \ingroup weak_form_assembly_internal
  *
- *  \brief Cache of LocalDofLists objects. */
+ *  \brief Cache of LocalDofLists objects.
+ *
+ *  The lists are sliced from the DOF tables of the space (see
+ *  Space::globalToLocalDofTable()), which are built once per space. */
 template <typename BasisFunctionType> class LocalDofListsCache {
 public:
   LocalDofListsCache(const Space<BasisFunctionType> &space,
@@ -63,32 +84,28 @@ public:
   ~LocalDofListsCache();
 
   /** \brief Return the LocalDofLists object describing the DOFs corresponding
-   * to
-   *  AHMED matrix indices [start, start + indexCount). */
-  shared_ptr<const LocalDofLists<BasisFunctionType>> get(int start,
-                                                         int indexCount);
+   *  to H-matrix indices [start, start + indexCount).
+   *
+   *  Lists of more than one index are cached and stay valid for the
+   *  lifetime of the cache. Lists of a single index, requested by each ACA
+   *  row and column evaluation, are not cached; they are built in a
+   *  per-thread scratch object, whose memory is reused, and stay valid
+   *  only until the next call of get() for a single index from the same
+   *  thread. */
+  const LocalDofLists<BasisFunctionType> &get(int start, int indexCount);
 
 private:
-  void findLocalDofs(
-      int start, int indexCount,
-      std::vector<typename LocalDofLists<BasisFunctionType>::DofIndex> &
-          originalIndices,
-      std::vector<int> &elementIndices,
-      std::vector<std::vector<LocalDofIndex>> &localDofIndices,
-      std::vector<std::vector<BasisFunctionType>> &localDofWeights,
-      std::vector<std::vector<int>> &arrayIndices) const;
-
-  void findLocalDofs(
-      int index,
-      std::vector<typename LocalDofLists<BasisFunctionType>::DofIndex> &
-          originalIndices,
-      std::vector<int> &elementIndices,
-      std::vector<std::vector<LocalDofIndex>> &localDofIndices,
-      std::vector<std::vector<BasisFunctionType>> &localDofWeights,
-      std::vector<std::vector<int>> &arrayIndices) const;
+  void findLocalDofs(int start, int indexCount,
+                     LocalDofLists<BasisFunctionType> &result) const;
 
-private:
   /** \cond PRIVATE */
+  // Thread-local buffer of the single-index path
+  struct Scratch {
+    LocalDofLists<BasisFunctionType> lists;
+  };
+
+  void findLocalDofs(int index, Scratch &scratch) const;
+
   const Space<BasisFunctionType> &m_space;
   const std::vector<std::size_t> &m_p2o;
   bool m_indexWithGlobalDofs;
@@ -97,6 +114,9 @@ private:
       std::pair<int, int>, const LocalDofLists<BasisFunctionType> *>
   LocalDofListsMap;
   LocalDofListsMap m_map;
+  tbb::enumerable_thread_specific<Scratch> m_scratch;
+  // Size of the lists in m_map
+  Fiber::MemoryAllocation m_memory;
   /** \endcond */
 };
 
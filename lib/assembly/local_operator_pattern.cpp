@@ -0,0 +1,252 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "local_operator_pattern.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../common/types.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/task_arena_cache.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/grid_view.hpp"
+#include "../grid/mapper.hpp"
+#include "../space/space.hpp"
+
+#include <boost/weak_ptr.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/mutex.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace Bempp {
+
+namespace {
+
+/** Build a list of lists of global DOF indices corresponding to the local DOFs
+ *  on each element of space.grid(). */
+template <typename BasisFunctionType>
+void gatherGlobalDofs(
+    const Space<BasisFunctionType> &testSpace,
+    const Space<BasisFunctionType> &trialSpace,
+    std::vector<std::vector<GlobalDofIndex>> &testGlobalDofs,
+    std::vector<std::vector<GlobalDofIndex>> &trialGlobalDofs,
+    std::vector<std::vector<BasisFunctionType>> &testLocalDofWeights,
+    std::vector<std::vector<BasisFunctionType>> &trialLocalDofWeights) {
+  // We use the fact that test and trial space are required to be defined
+  // on the same grid
+
+  // Get the grid's leaf view so that we can iterate over elements
+  const GridView &view = testSpace.gridView();
+  const int elementCount = view.entityCount(0);
+
+  // Global DOF indices corresponding to local DOFs on elements
+  testGlobalDofs.clear();
+  testGlobalDofs.resize(elementCount);
+  trialGlobalDofs.clear();
+  trialGlobalDofs.resize(elementCount);
+  // Weights of the local DOFs on elements
+  testLocalDofWeights.clear();
+  testLocalDofWeights.resize(elementCount);
+  trialLocalDofWeights.clear();
+  trialLocalDofWeights.resize(elementCount);
+
+  // Gather global DOF lists
+  const Mapper &mapper = view.elementMapper();
+  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
+  while (!it->finished()) {
+    const Entity<0> &element = it->entity();
+    const int elementIndex = mapper.entityIndex(element);
+    testSpace.getGlobalDofs(element, testGlobalDofs[elementIndex],
+                            testLocalDofWeights[elementIndex]);
+    trialSpace.getGlobalDofs(element, trialGlobalDofs[elementIndex],
+                             trialLocalDofWeights[elementIndex]);
+    it->next();
+  }
+}
+
+/** Build the pattern of local operators mapping \p trialSpace to \p
+ *  testSpace. The contributions are first bucketed by row in the order of
+ *  elements (symbolic pass), then sorted by column within each row and
+ *  merged into nonzero entries. */
+template <typename BasisFunctionType>
+shared_ptr<const LocalOperatorPattern<BasisFunctionType>>
+buildLocalOperatorPattern(const Space<BasisFunctionType> &testSpace,
+                          const Space<BasisFunctionType> &trialSpace,
+                          int maxThreadCount) {
+  typedef LocalOperatorPattern<BasisFunctionType> Pattern;
+  typedef typename Pattern::Contribution Contribution;
+
+  std::vector<std::vector<GlobalDofIndex>> testGdofs, trialGdofs;
+  std::vector<std::vector<BasisFunctionType>> testLdofWeights,
+      trialLdofWeights;
+  gatherGlobalDofs(testSpace, trialSpace, testGdofs, trialGdofs,
+                   testLdofWeights, trialLdofWeights);
+  const int elementCount = testGdofs.size();
+
+  shared_ptr<Pattern> pattern(new Pattern);
+  const int rowCount = testSpace.globalDofCount();
+  pattern->rowCount = rowCount;
+  pattern->columnCount = trialSpace.globalDofCount();
+
+  // Count the contributions to each row
+  std::vector<int> contributionStarts(rowCount + 1, 0);
+  for (int e = 0; e < elementCount; ++e) {
+    const int trialCount =
+        std::count_if(trialGdofs[e].begin(), trialGdofs[e].end(),
+                      [](GlobalDofIndex gdof) { return gdof >= 0; });
+    for (size_t testIndex = 0; testIndex < testGdofs[e].size(); ++testIndex)
+      if (testGdofs[e][testIndex] >= 0)
+        contributionStarts[testGdofs[e][testIndex] + 1] += trialCount;
+  }
+  for (int row = 0; row < rowCount; ++row)
+    contributionStarts[row + 1] += contributionStarts[row];
+
+  std::vector<Contribution> &contributions = pattern->contributions;
+  contributions.resize(contributionStarts[rowCount]);
+  std::vector<int> fill(contributionStarts.begin(),
+                        contributionStarts.end() - 1);
+  for (int e = 0; e < elementCount; ++e) {
+    const int testCount = testGdofs[e].size();
+    for (size_t trialIndex = 0; trialIndex < trialGdofs[e].size();
+         ++trialIndex) {
+      const int trialGdof = trialGdofs[e][trialIndex];
+      if (trialGdof < 0)
+        continue;
+      for (int testIndex = 0; testIndex < testCount; ++testIndex) {
+        const int testGdof = testGdofs[e][testIndex];
+        if (testGdof < 0)
+          continue;
+        Contribution &c = contributions[fill[testGdof]++];
+        c.column = trialGdof;
+        c.element = e;
+        c.localIndex = testIndex + trialIndex * testCount;
+        c.weight = conj(testLdofWeights[e][testIndex]) *
+                   trialLdofWeights[e][trialIndex];
+      }
+    }
+  }
+
+  // Sort the contributions to each row by column and count the distinct
+  // columns
+  std::vector<int> &rowStarts = pattern->rowStarts;
+  rowStarts.assign(rowCount + 1, 0);
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, rowCount),
+        [&](const tbb::blocked_range<int> &r) {
+          for (int row = r.begin(); row != r.end(); ++row) {
+            const int begin = contributionStarts[row];
+            const int end = contributionStarts[row + 1];
+            std::sort(contributions.begin() + begin,
+                      contributions.begin() + end);
+            for (int i = begin; i < end; ++i)
+              if (i == begin ||
+                  contributions[i].column != contributions[i - 1].column)
+                ++rowStarts[row + 1];
+          }
+        });
+  });
+  for (int row = 0; row < rowCount; ++row)
+    rowStarts[row + 1] += rowStarts[row];
+
+  const int entryCount = rowStarts[rowCount];
+  pattern->columnIndices.resize(entryCount);
+  pattern->entryStarts.resize(entryCount + 1);
+  pattern->entryStarts[entryCount] = contributions.size();
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, rowCount),
+        [&](const tbb::blocked_range<int> &r) {
+          for (int row = r.begin(); row != r.end(); ++row) {
+            const int begin = contributionStarts[row];
+            int k = rowStarts[row];
+            for (int i = begin; i < contributionStarts[row + 1]; ++i)
+              if (i == begin ||
+                  contributions[i].column != contributions[i - 1].column) {
+                pattern->columnIndices[k] = contributions[i].column;
+                pattern->entryStarts[k] = i;
+                ++k;
+              }
+          }
+        });
+  });
+  return pattern;
+}
+
+} // namespace
+
+template <typename BasisFunctionType>
+shared_ptr<const LocalOperatorPattern<BasisFunctionType>>
+sharedLocalOperatorPattern(
+    const shared_ptr<const Space<BasisFunctionType>> &testSpace,
+    const shared_ptr<const Space<BasisFunctionType>> &trialSpace,
+    int maxThreadCount) {
+  typedef LocalOperatorPattern<BasisFunctionType> Pattern;
+  typedef Space<BasisFunctionType> SpaceType;
+  struct Entry {
+    boost::weak_ptr<const SpaceType> testSpace, trialSpace;
+    shared_ptr<const Pattern> pattern;
+  };
+  typedef std::pair<const SpaceType *, const SpaceType *> Key;
+  typedef std::map<Key, Entry> Cache;
+  static Cache cache;
+  static tbb::mutex mutex;
+
+  const Key key(testSpace.get(), trialSpace.get());
+  {
+    tbb::mutex::scoped_lock lock(mutex);
+    // Forget the patterns of destroyed spaces
+    for (typename Cache::iterator it = cache.begin(); it != cache.end();)
+      if (it->second.testSpace.expired() || it->second.trialSpace.expired())
+        cache.erase(it++);
+      else
+        ++it;
+    typename Cache::const_iterator it = cache.find(key);
+    if (it != cache.end())
+      return it->second.pattern;
+  }
+
+  // The lock is not held while the pattern is built. If another thread
+  // builds the same pattern in the meantime, the first one to be stored is
+  // returned to both
+  shared_ptr<const Pattern> pattern =
+      buildLocalOperatorPattern(*testSpace, *trialSpace, maxThreadCount);
+  tbb::mutex::scoped_lock lock(mutex);
+  Entry &entry = cache[key];
+  if (!entry.pattern) {
+    entry.testSpace = testSpace;
+    entry.trialSpace = trialSpace;
+    entry.pattern = pattern;
+  }
+  return entry.pattern;
+}
+
+#define INSTANTIATE_SHARED_LOCAL_OPERATOR_PATTERN(BASIS)                       \
+  template shared_ptr<const LocalOperatorPattern<BASIS>>                       \
+  sharedLocalOperatorPattern(const shared_ptr<const Space<BASIS>> &,           \
+                             const shared_ptr<const Space<BASIS>> &, int)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_SHARED_LOCAL_OPERATOR_PATTERN);
+
+} // namespace Bempp
@@ -0,0 +1,86 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_local_operator_pattern_hpp
+#define bempp_local_operator_pattern_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/shared_ptr.hpp"
+
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Sparsity pattern of the weak forms of local operators acting on a
+ *  pair of spaces, together with the entries of the local weak forms
+ *  contributing to each nonzero entry of the global weak form. */
+template <typename BasisFunctionType> struct LocalOperatorPattern {
+  struct Contribution {
+    int column; // global trial DOF
+    int element;
+    // Index of the entry in the (column-major) local weak form
+    int localIndex;
+    // Product of the weights of the local test and trial DOFs
+    BasisFunctionType weight;
+
+    bool operator<(const Contribution &other) const {
+      if (column != other.column)
+        return column < other.column;
+      if (element != other.element)
+        return element < other.element;
+      return localIndex < other.localIndex;
+    }
+  };
+
+  int rowCount, columnCount;
+  // Nonzero entries in the compressed sparse row format; the column indices
+  // are sorted within each row
+  std::vector<int> rowStarts, columnIndices;
+  // The kth nonzero entry is the sum of the contributions entryStarts[k],
+  // ..., entryStarts[k + 1] - 1
+  std::vector<int> entryStarts;
+  std::vector<Contribution> contributions;
+};
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Return the pattern of local operators mapping \p trialSpace to \p
+ *  testSpace, building it if it has not been built yet.
+ *
+ *  Patterns are kept for as long as both their spaces are alive, so that
+ *  all local operators acting on the same pair of spaces share one pattern.
+ *  The spaces are stored with the pattern, so that it is not reused for
+ *  spaces that merely happen to live at the same addresses as destroyed
+ *  ones. Patterns are built in taskArena(\p maxThreadCount). */
+template <typename BasisFunctionType>
+shared_ptr<const LocalOperatorPattern<BasisFunctionType>>
+sharedLocalOperatorPattern(
+    const shared_ptr<const Space<BasisFunctionType>> &testSpace,
+    const shared_ptr<const Space<BasisFunctionType>> &trialSpace,
+    int maxThreadCount);
+
+} // namespace Bempp
+
+#endif
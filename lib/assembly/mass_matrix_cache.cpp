@@ -0,0 +1,127 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "mass_matrix_cache.hpp"
+
+#include "abstract_boundary_operator_pseudoinverse.hpp"
+#include "boundary_operator.hpp"
+#include "context.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "identity_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../space/space.hpp"
+
+namespace Bempp {
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+MassMatrixCache<BasisFunctionType, ResultType>::massMatrix(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const SpaceType> &space,
+    const shared_ptr<const SpaceType> &dualSpace) {
+  {
+    tbb::mutex::scoped_lock lock(m_mutex);
+    const Entry &cached = entry(space, dualSpace);
+    if (cached.massMatrix)
+      return cached.massMatrix;
+  }
+
+  shared_ptr<const DiscreteOp> result =
+      identityOperator<BasisFunctionType, ResultType>(context, space, space,
+                                                      dualSpace)
+          .weakForm();
+
+  tbb::mutex::scoped_lock lock(m_mutex);
+  Entry &cached = entry(space, dualSpace);
+  if (!cached.massMatrix)
+    cached.massMatrix = result;
+  return cached.massMatrix;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+MassMatrixCache<BasisFunctionType, ResultType>::inverseMassMatrix(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const SpaceType> &space,
+    const shared_ptr<const SpaceType> &dualSpace) {
+  {
+    tbb::mutex::scoped_lock lock(m_mutex);
+    const Entry &cached = entry(space, dualSpace);
+    if (cached.inverseMassMatrix)
+      return cached.inverseMassMatrix;
+  }
+
+  // Keeping the mass matrix alive lets the weak-form cache of the context
+  // hand it to the pseudoinverse instead of assembling it again
+  shared_ptr<const DiscreteOp> mass = massMatrix(context, space, dualSpace);
+  shared_ptr<const DiscreteOp> result =
+      pseudoinverse(identityOperator<BasisFunctionType, ResultType>(
+                        context, space, space, dualSpace))
+          .weakForm();
+
+  tbb::mutex::scoped_lock lock(m_mutex);
+  Entry &cached = entry(space, dualSpace);
+  if (!cached.inverseMassMatrix)
+    cached.inverseMassMatrix = result;
+  return cached.inverseMassMatrix;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void MassMatrixCache<BasisFunctionType, ResultType>::clear() {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  m_entries.clear();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::size_t MassMatrixCache<BasisFunctionType, ResultType>::size() const {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  return m_entries.size();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+typename MassMatrixCache<BasisFunctionType, ResultType>::Entry &
+MassMatrixCache<BasisFunctionType, ResultType>::entry(
+    const shared_ptr<const SpaceType> &space,
+    const shared_ptr<const SpaceType> &dualSpace) {
+  // Called with m_mutex locked
+  removeExpiredEntries();
+  Entry &result = m_entries[Key(space.get(), dualSpace.get())];
+  if (result.space.expired()) {
+    result.space = space;
+    result.dualSpace = dualSpace;
+  }
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void MassMatrixCache<BasisFunctionType, ResultType>::removeExpiredEntries() {
+  for (typename EntryMap::iterator it = m_entries.begin();
+       it != m_entries.end();) {
+    const Entry &entry = it->second;
+    if (entry.space.expired() || entry.dualSpace.expired())
+      it = m_entries.erase(it);
+    else
+      ++it;
+  }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(MassMatrixCache);
+
+} // namespace Bempp
@@ -0,0 +1,114 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_mass_matrix_cache_hpp
+#define bempp_mass_matrix_cache_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <boost/weak_ptr.hpp>
+#include <tbb/mutex.h>
+#include <map>
+#include <utility>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType> class Context;
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Cache of the mass matrices used by GridFunction to convert
+ *  between expansion coefficients and projections.
+ *
+ *  For each pair of an expansion space and a dual space, the cache keeps the
+ *  weak form of the identity operator and, once it has been requested, the
+ *  weak form of its (pseudo)inverse, which stores the factorisation of the
+ *  mass matrix. Repeated conversions of grid functions defined on the same
+ *  spaces therefore only multiply by the mass matrix or solve with its
+ *  stored factors. Entries are kept for as long as both of their spaces are
+ *  alive.
+ *
+ *  The spaces are stored with each entry, so that an entry is not reused
+ *  for spaces that merely happen to live at the same addresses as destroyed
+ *  ones.
+ *
+ *  Every Context owns one cache, which is shared by its copies. */
+template <typename BasisFunctionType, typename ResultType>
+class MassMatrixCache {
+public:
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  typedef Space<BasisFunctionType> SpaceType;
+
+  /** \brief Return the weak form of the identity operator acting on \p
+   *  space, discretised with the test functions from \p dualSpace.
+   *
+   *  The weak form is assembled with \p context if it is not in the cache
+   *  yet. */
+  shared_ptr<const DiscreteOp>
+  massMatrix(const shared_ptr<const Context<BasisFunctionType, ResultType>> &
+                 context,
+             const shared_ptr<const SpaceType> &space,
+             const shared_ptr<const SpaceType> &dualSpace);
+
+  /** \brief Return the weak form of the (pseudo)inverse of the identity
+   *  operator returned by massMatrix().
+   *
+   *  The mass matrix is factorised if its inverse is not in the cache yet.
+   *  The cache lock is not held during assembly and factorisation. Two
+   *  threads requesting the same matrix at the same time may therefore both
+   *  build it; the first result to be inserted is returned to both. */
+  shared_ptr<const DiscreteOp> inverseMassMatrix(
+      const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+      const shared_ptr<const SpaceType> &space,
+      const shared_ptr<const SpaceType> &dualSpace);
+
+  /** \brief Remove all entries. */
+  void clear();
+
+  /** \brief Return the number of entries. */
+  std::size_t size() const;
+
+private:
+  /** \cond PRIVATE */
+  typedef std::pair<const SpaceType *, const SpaceType *> Key;
+  struct Entry {
+    boost::weak_ptr<const SpaceType> space;
+    boost::weak_ptr<const SpaceType> dualSpace;
+    shared_ptr<const DiscreteOp> massMatrix;
+    shared_ptr<const DiscreteOp> inverseMassMatrix;
+  };
+  typedef std::map<Key, Entry> EntryMap;
+
+  Entry &entry(const shared_ptr<const SpaceType> &space,
+               const shared_ptr<const SpaceType> &dualSpace);
+  void removeExpiredEntries();
+
+  EntryMap m_entries;
+  mutable tbb::mutex m_mutex;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
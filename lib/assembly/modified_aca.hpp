@@ -39,8 +39,65 @@
 #include <boost/scoped_array.hpp>
 #include <limits>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 namespace Bempp {
 
+/** \brief Wrapper of an ACA assembly helper that evaluates long single rows
+ *  and columns in parallel.
+ *
+ *  Every cross built by ACAs() needs one full row and one full column of the
+ *  block, each requested from the helper by a separate cmpbl() call, and the
+ *  next pivot depends on them. For big blocks these calls dominate and would
+ *  otherwise run on a single thread; here they are split into chunks of at
+ *  least MIN_CHUNK_SIZE entries evaluated by TBB tasks. Since the chunks
+ *  of a given row or column block are always the same, their local DOF lists
+ *  are looked up in the cache of the helper only once per block. */
+template <class MATGEN_T> class ParallelCrossMatGen {
+public:
+  typedef typename MATGEN_T::AhmedResultType AhmedResultType;
+  typedef typename MATGEN_T::MagnitudeType MagnitudeType;
+
+  enum { MIN_CHUNK_SIZE = 64 };
+
+  explicit ParallelCrossMatGen(MATGEN_T &matGen) : m_matGen(matGen) {}
+
+  void cmpbl(unsigned b1, unsigned n1, unsigned b2, unsigned n2,
+             AhmedResultType *data, const cluster *c1 = 0,
+             const cluster *c2 = 0) const {
+    // A chunk lies inside the clusters c1 and c2, so their distance is
+    // still a valid lower bound for the choice of quadrature order
+    if (n1 == 1 && n2 >= 2 * MIN_CHUNK_SIZE)
+      tbb::parallel_for(tbb::blocked_range<unsigned>(0, n2, MIN_CHUNK_SIZE),
+                        [&](const tbb::blocked_range<unsigned> &r) {
+        m_matGen.cmpbl(b1, 1, b2 + r.begin(), r.size(), data + r.begin(), c1,
+                       c2);
+      });
+    else if (n2 == 1 && n1 >= 2 * MIN_CHUNK_SIZE)
+      tbb::parallel_for(tbb::blocked_range<unsigned>(0, n1, MIN_CHUNK_SIZE),
+                        [&](const tbb::blocked_range<unsigned> &r) {
+        m_matGen.cmpbl(b1 + r.begin(), r.size(), b2, 1, data + r.begin(), c1,
+                       c2);
+      });
+    else
+      m_matGen.cmpbl(b1, n1, b2, n2, data, c1, c2);
+  }
+
+  void cmpblsym(unsigned b1, unsigned n1, AhmedResultType *data,
+                const cluster *c1 = 0) const {
+    m_matGen.cmpblsym(b1, n1, data, c1);
+  }
+
+  MagnitudeType scale(unsigned b1, unsigned n1, unsigned b2, unsigned n2,
+                      const cluster *c1 = 0, const cluster *c2 = 0) const {
+    return m_matGen.scale(b1, n1, b2, n2, c1, c2);
+  }
+
+private:
+  MATGEN_T &m_matGen;
+};
+
 // returns true if a pivot could be found (there were any nonapproximated
 // rows or columns), false otherwise
 template <class abs_T>
@@ -68,6 +125,9 @@ bool ACAs(MATGEN_T &MatGen, unsigned b1, unsigned n1, unsigned b2, unsigned n2,
 
   abs_T scale = MatGen.scale(b1, n1, b2, n2, c1, c2); // set initial scale
 
+  // The rows and columns of the crosses are evaluated in parallel
+  ParallelCrossMatGen<MATGEN_T> crossMatGen(MatGen);
+
   U = new T[(kmax + 1) * n1]; // these arrays are expected to be
   V = new T[(kmax + 1) * n2]; // deallocated by the caller
   assert(U != NULL && V != NULL);
@@ -111,12 +171,12 @@ bool ACAs(MATGEN_T &MatGen, unsigned b1, unsigned n1, unsigned b2, unsigned n2,
     bool retry_if_zero = (stage == NORMAL); // don't retry if shooting
     // compute a cross
     if (mode == ROW)
-      status = ACA_row_step(MatGen, b1, n1, b2, n2, klast, next_pivot, k, no,
-                            Z.get(), S.get(), U, V, nrmlsk2, scale, c1, c2,
-                            retry_if_zero, orig_row.get(), orig_col.get());
+      status = ACA_row_step(crossMatGen, b1, n1, b2, n2, klast, next_pivot, k,
+                            no, Z.get(), S.get(), U, V, nrmlsk2, scale, c1,
+                            c2, retry_if_zero, orig_row.get(), orig_col.get());
     else
-      status = ACA_col_step(MatGen, b1, n1, b2, n2, next_pivot, k, no, Z.get(),
-                            S.get(), U, V, nrmlsk2, scale, c1, c2,
+      status = ACA_col_step(crossMatGen, b1, n1, b2, n2, next_pivot, k, no,
+                            Z.get(), S.get(), U, V, nrmlsk2, scale, c1, c2,
                             retry_if_zero, orig_row.get(), orig_col.get());
     // std::cout << "status = " << status << std::endl;
 
@@ -29,6 +29,7 @@
 #include "../fiber/explicit_instantiation.hpp"
 
 #include <boost/make_shared.hpp>
+#include <vector>
 
 namespace Bempp {
 
@@ -74,11 +75,17 @@ modifiedHelmholtz3dExteriorCalderonProjector(
 
   BlockedOperatorStructure<BasisFunctionType, ResultType> structure;
 
-  structure.setBlock(0, 0, .5 * idDouble + dlp);
+  BdOp doubleLayerBlock = .5 * idDouble + dlp;
+  structure.setBlock(0, 0, doubleLayerBlock);
   structure.setBlock(0, 1, -1. * idSpaceTransformation2 * internalSlp *
                                idSpaceTransformation1);
   structure.setBlock(1, 0, -1. * hyp);
-  structure.setBlock(1, 1, .5 * idAdjDouble - adjDlp);
+  if (context->assemblyOptions().isJointAssemblyEnabled()) {
+    // See laplace3dExteriorCalderonProjector()
+    structure.setBlock(1, 1, idAdjDouble - adjoint(doubleLayerBlock));
+    assembleWeakForms(std::vector<BdOp>{internalSlp, doubleLayerBlock});
+  } else
+    structure.setBlock(1, 1, .5 * idAdjDouble - adjDlp);
 
   return BlockedBoundaryOperator<BasisFunctionType, ResultType>(structure);
 }
@@ -125,11 +132,17 @@ modifiedHelmholtz3dInteriorCalderonProjector(
 
   BlockedOperatorStructure<BasisFunctionType, ResultType> structure;
 
-  structure.setBlock(0, 0, .5 * idDouble - dlp);
+  BdOp doubleLayerBlock = .5 * idDouble - dlp;
+  structure.setBlock(0, 0, doubleLayerBlock);
   structure.setBlock(0, 1, idSpaceTransformation2 * internalSlp *
                                idSpaceTransformation1);
   structure.setBlock(1, 0, hyp);
-  structure.setBlock(1, 1, .5 * idAdjDouble + adjDlp);
+  if (context->assemblyOptions().isJointAssemblyEnabled()) {
+    // See laplace3dExteriorCalderonProjector()
+    structure.setBlock(1, 1, idAdjDouble - adjoint(doubleLayerBlock));
+    assembleWeakForms(std::vector<BdOp>{internalSlp, doubleLayerBlock});
+  } else
+    structure.setBlock(1, 1, .5 * idAdjDouble + adjDlp);
 
   return BlockedBoundaryOperator<BasisFunctionType, ResultType>(structure);
 }
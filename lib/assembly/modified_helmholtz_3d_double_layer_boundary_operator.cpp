@@ -24,6 +24,7 @@
 #include "context.hpp"
 #include "general_elementary_singular_integral_operator_imp.hpp"
 #include "modified_helmholtz_3d_synthetic_boundary_operator_builder.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
 
@@ -49,8 +50,9 @@ modifiedHelmholtz3dDoubleLayerBoundaryOperator(
     KernelType waveNumber, const std::string &label, int symmetry,
     bool useInterpolation, int interpPtsPerWavelength) {
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
-  if (assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
-      assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY)
+  if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
+       assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange))
     return modifiedHelmholtz3dSyntheticBoundaryOperator(
         &modifiedHelmholtz3dDoubleLayerBoundaryOperator<BasisFunctionType,
                                                         KernelType, ResultType>,
@@ -79,7 +81,8 @@ modifiedHelmholtz3dDoubleLayerBoundaryOperator(
 
   shared_ptr<Fiber::TestKernelTrialIntegral<BasisFunctionType, KernelType,
                                             ResultType>> integral;
-  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange))
+  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange,
+                                true /* scalar transformations */))
     integral.reset(new Fiber::TypicalTestScalarKernelTrialIntegral<
         BasisFunctionType, KernelType, ResultType>());
   else
@@ -100,6 +103,19 @@ modifiedHelmholtz3dDoubleLayerBoundaryOperator(
                        NoninterpolatedKernelFunctor(waveNumber),
                        TransformationFunctor(), TransformationFunctor(),
                        integral));
+  std::vector<std::complex<double>> idParameters(3);
+  idParameters[0] = waveNumber;
+  idParameters[1] = useInterpolation;
+  idParameters[2] = interpPtsPerWavelength;
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "modifiedHelmholtz3dDoubleLayer", *newOp, idParameters));
+  // The weak form of this operator is the transpose of that of the adjoint
+  // double-layer operator on the swapped spaces
+  newOp->setTransposeId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "modifiedHelmholtz3dAdjointDoubleLayer", dualToRange.get(), domain.get(),
+      newOp->symmetry(), idParameters));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
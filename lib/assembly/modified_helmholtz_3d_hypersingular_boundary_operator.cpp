@@ -30,6 +30,7 @@
 #include "general_hypersingular_integral_operator_imp.hpp"
 #include "modified_helmholtz_3d_single_layer_boundary_operator.hpp"
 #include "synthetic_integral_operator.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../fiber/explicit_instantiation.hpp"
 
@@ -96,9 +97,9 @@ modifiedHelmholtz3dSyntheticHypersingularBoundaryOperator(
   SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
       context, internalContext, auxContext);
   shared_ptr<const Space<BasisFunctionType>> internalTrialSpace =
-      newDomain->discontinuousSpace(newDomain);
+      internalDiscontinuousSpace(*context, newDomain);
   shared_ptr<const Space<BasisFunctionType>> internalTestSpace =
-      newDualToRange->discontinuousSpace(newDualToRange);
+      internalDiscontinuousSpace(*context, newDualToRange);
 
   // Note: we don't really need to care about ranges and duals to domains of
   // the internal operator. The only range space that matters is that of the
@@ -197,6 +198,7 @@ modifiedHelmholtz3dHypersingularBoundaryOperator(
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
   if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
        assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange) ||
       externalSlp.isInitialized())
     return modifiedHelmholtz3dSyntheticHypersingularBoundaryOperator(
         context, domain, range, dualToRange, waveNumber, label, symmetry,
@@ -293,6 +295,13 @@ modifiedHelmholtz3dHypersingularBoundaryOperator(
           OffDiagonalTransformationFunctor(),
           OffDiagonalTransformationFunctor(), OffDiagonalIntegrandFunctor()));
   }
+  std::vector<std::complex<double>> idParameters(3);
+  idParameters[0] = waveNumber;
+  idParameters[1] = useInterpolation;
+  idParameters[2] = interpPtsPerWavelength;
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "modifiedHelmholtz3dHypersingular", *newOp, idParameters));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
@@ -316,6 +325,66 @@ modifiedHelmholtz3dHypersingularBoundaryOperator(
             useInterpolation,interpPtsPerWavelength,externalSlp);
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void modifiedHelmholtz3dSingleLayerAndHypersingularBoundaryOperators(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    KernelType waveNumber, BoundaryOperator<BasisFunctionType, ResultType> &slp,
+    BoundaryOperator<BasisFunctionType, ResultType> &hypersingular,
+    const std::string &label, int symmetry, bool useInterpolation,
+    int interpPtsPerWavelength) {
+  typedef SyntheticIntegralOperator<BasisFunctionType, ResultType> SyntheticOp;
+
+  if (!domain || !range || !dualToRange)
+    throw std::invalid_argument(
+        "modifiedHelmholtz3dSingleLayerAndHypersingularBoundaryOperators(): "
+        "domain, range and dualToRange must not be null");
+
+  // The internal spaces must be those chosen by
+  // modifiedHelmholtz3dSyntheticHypersingularBoundaryOperator()
+  shared_ptr<const Space<BasisFunctionType>> newDomain = domain;
+  shared_ptr<const Space<BasisFunctionType>> newDualToRange = dualToRange;
+  if (domain->isBarycentric() || dualToRange->isBarycentric()) {
+    newDomain = domain->barycentricSpace(domain);
+    newDualToRange = dualToRange->barycentricSpace(dualToRange);
+  }
+  shared_ptr<const Space<BasisFunctionType>> internalTrialSpace =
+      internalDiscontinuousSpace(*context, newDomain);
+  shared_ptr<const Space<BasisFunctionType>> internalTestSpace =
+      internalDiscontinuousSpace(*context, newDualToRange);
+
+  std::string baseLabel = label;
+  if (baseLabel.empty())
+    baseLabel =
+        AbstractBoundaryOperator<BasisFunctionType, ResultType>::uniqueLabel();
+
+  shared_ptr<const Context<BasisFunctionType, ResultType>> internalContext,
+      auxContext;
+  SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
+      context, internalContext, auxContext);
+  BoundaryOperator<BasisFunctionType, ResultType> internalSlp =
+      modifiedHelmholtz3dSingleLayerBoundaryOperator<BasisFunctionType,
+                                                     KernelType, ResultType>(
+          internalContext, internalTrialSpace,
+          internalTestSpace /* or whatever */, internalTestSpace, waveNumber,
+          "(" + baseLabel + ")_internal_SLP", symmetry, useInterpolation,
+          interpPtsPerWavelength);
+
+  int syntheseSymmetry = 0; // symmetry of the decomposition
+  if (newDomain == newDualToRange && internalTrialSpace == internalTestSpace)
+    syntheseSymmetry =
+        HERMITIAN | (boost::is_complex<BasisFunctionType>() ? 0 : SYMMETRIC);
+
+  slp = syntheticNonhypersingularIntegralOperator(
+      internalSlp, newDomain, range, newDualToRange, internalTrialSpace,
+      internalTestSpace, baseLabel + "_SLP", syntheseSymmetry);
+  hypersingular = modifiedHelmholtz3dSyntheticHypersingularBoundaryOperator(
+      context, domain, range, dualToRange, waveNumber, baseLabel + "_HYP",
+      symmetry, useInterpolation, interpPtsPerWavelength, internalSlp);
+}
+
 #define INSTANTIATE_NONMEMBER_CONSTRUCTOR(BASIS, KERNEL, RESULT)               \
   template BoundaryOperator<BASIS, RESULT>                                     \
   modifiedHelmholtz3dHypersingularBoundaryOperator(                            \
@@ -329,7 +398,15 @@ modifiedHelmholtz3dHypersingularBoundaryOperator(
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &, KERNEL, const std::string &,     \
-      int, bool, int, const BoundaryOperator<BASIS, RESULT> &externalSlp)
+      int, bool, int, const BoundaryOperator<BASIS, RESULT> &externalSlp);     \
+  template void                                                                \
+  modifiedHelmholtz3dSingleLayerAndHypersingularBoundaryOperators(             \
+      const shared_ptr<const Context<BASIS, RESULT>> &,                        \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &, KERNEL,                          \
+      BoundaryOperator<BASIS, RESULT> &, BoundaryOperator<BASIS, RESULT> &,    \
+      const std::string &, int, bool, int)
 
 FIBER_ITERATE_OVER_BASIS_KERNEL_AND_RESULT_TYPES(
     INSTANTIATE_NONMEMBER_CONSTRUCTOR);
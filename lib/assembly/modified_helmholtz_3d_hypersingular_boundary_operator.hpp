@@ -153,6 +153,45 @@ modifiedHelmholtz3dHypersingularBoundaryOperator(
     const BoundaryOperator<BasisFunctionType, ResultType> &externalSlp =
         BoundaryOperator<BasisFunctionType, ResultType>());
 
+/** \ingroup modified_helmholtz_3d
+ *  \brief Construct the single-layer and hypersingular operators associated
+ *  with the modified Helmholtz equation in 3D, sharing a single evaluation of
+ *  the kernel.
+ *
+ *  Both operators act on the same spaces \p domain, \p range and \p
+ *  dualToRange. They are built from one single-layer operator \f$V_d\f$
+ *  defined on the discontinuous counterparts of \p domain and \p
+ *  dualToRange: \p slp becomes the product of \f$V_d\f$ with the sparse
+ *  matrices expanding the basis functions of \p domain and \p dualToRange in
+ *  the single-element functions, and \p hypersingular becomes the synthetic
+ *  operator described in modifiedHelmholtz3dHypersingularBoundaryOperator()
+ *  built from \f$V_d\f$. The kernel is therefore integrated over each pair
+ *  of elements only once, when the weak form of \f$V_d\f$ is assembled; the
+ *  weak form is shared by \p slp and \p hypersingular. This halves the
+ *  kernel evaluations needed by formulations combining both operators, such
+ *  as the Burton-Miller formulation.
+ *
+ *  \param[out] slp
+ *    Single-layer operator.
+ *  \param[out] hypersingular
+ *    Hypersingular operator.
+ *
+ *  The remaining parameters have the same meaning as in
+ *  modifiedHelmholtz3dHypersingularBoundaryOperator(); \p symmetry is the
+ *  symmetry of \f$V_d\f$. The labels of the two operators are formed by
+ *  appending "_SLP" and "_HYP" to \p label. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void modifiedHelmholtz3dSingleLayerAndHypersingularBoundaryOperators(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    KernelType waveNumber, BoundaryOperator<BasisFunctionType, ResultType> &slp,
+    BoundaryOperator<BasisFunctionType, ResultType> &hypersingular,
+    const std::string &label = "", int symmetry = NO_SYMMETRY,
+    bool useInterpolation = false,
+    int interpPtsPerWavelength = DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY);
+
 } // namespace Bempp
 
 #endif
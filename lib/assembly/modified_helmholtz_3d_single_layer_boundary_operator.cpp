@@ -24,6 +24,7 @@
 #include "context.hpp"
 #include "general_elementary_singular_integral_operator_imp.hpp"
 #include "modified_helmholtz_3d_synthetic_boundary_operator_builder.hpp"
+#include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
 #include "../common/boost_make_shared_fwd.hpp"
 
@@ -51,8 +52,9 @@ modifiedHelmholtz3dSingleLayerBoundaryOperator(
     KernelType waveNumber, const std::string &label, int symmetry,
     bool useInterpolation, int interpPtsPerWavelength) {
   const AssemblyOptions &assemblyOptions = context->assemblyOptions();
-  if (assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
-      assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY)
+  if ((assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
+       assemblyOptions.acaOptions().mode == AcaOptions::LOCAL_ASSEMBLY) ||
+      shouldReuseBarycentricOperator(assemblyOptions, domain, dualToRange))
     return modifiedHelmholtz3dSyntheticBoundaryOperator(
         &modifiedHelmholtz3dSingleLayerBoundaryOperator<BasisFunctionType,
                                                         KernelType, ResultType>,
@@ -82,7 +84,8 @@ modifiedHelmholtz3dSingleLayerBoundaryOperator(
                                                     KernelType, ResultType> Op;
   shared_ptr<Fiber::TestKernelTrialIntegral<BasisFunctionType, KernelType,
                                             ResultType>> integral;
-  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange))
+  if (shouldUseBlasInQuadrature(assemblyOptions, *domain, *dualToRange,
+                                true /* scalar transformations */))
     integral.reset(new Fiber::TypicalTestScalarKernelTrialIntegral<
         BasisFunctionType, KernelType, ResultType>());
   else
@@ -103,6 +106,13 @@ modifiedHelmholtz3dSingleLayerBoundaryOperator(
                        NoninterpolatedKernelFunctor(waveNumber),
                        TransformationFunctor(), TransformationFunctor(),
                        integral));
+  std::vector<std::complex<double>> idParameters(3);
+  idParameters[0] = waveNumber;
+  idParameters[1] = useInterpolation;
+  idParameters[2] = interpPtsPerWavelength;
+  newOp->setId(boost::make_shared<
+      ElementaryIntegralOperatorId<BasisFunctionType, ResultType>>(
+      "modifiedHelmholtz3dSingleLayer", *newOp, idParameters));
   return BoundaryOperator<BasisFunctionType, ResultType>(context, newOp);
 }
 
@@ -0,0 +1,372 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "multi_grid_function.hpp"
+
+#include "context.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "mass_matrix_cache.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../grid/grid.hpp"
+#include "../space/space.hpp"
+
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename BasisFunctionType, typename ResultType>
+MultiGridFunction<BasisFunctionType, ResultType>::MultiGridFunction()
+    : m_wasInitializedFromCoefficients(false) {}
+
+template <typename BasisFunctionType, typename ResultType>
+MultiGridFunction<BasisFunctionType, ResultType>::MultiGridFunction(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const arma::Mat<ResultType> &coefficients)
+    : m_context(context), m_space(space),
+      m_wasInitializedFromCoefficients(true) {
+  if (!context)
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): context must not be null");
+  if (!space)
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): space must not be null");
+  if (coefficients.n_rows != space->globalDofCount())
+    throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                "the coefficient matrix has incorrect number "
+                                "of rows");
+  m_coefficients = boost::make_shared<arma::Mat<ResultType>>(coefficients);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+MultiGridFunction<BasisFunctionType, ResultType>::MultiGridFunction(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const arma::Mat<ResultType> &projections)
+    : m_context(context), m_wasInitializedFromCoefficients(false) {
+  if (!context)
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): context must not be null");
+  if (!space)
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): space must not be null");
+  if (!dualSpace)
+    throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                "dualSpace must not be null");
+  // As in GridFunction, barycentric spaces are replaced by their
+  // counterparts on the refined grid
+  if (space->isBarycentric() || dualSpace->isBarycentric()) {
+    m_space = space->barycentricSpace(space);
+    m_dualSpace = dualSpace->barycentricSpace(dualSpace);
+  } else {
+    m_space = space;
+    m_dualSpace = dualSpace;
+  }
+  if (m_space->grid() != m_dualSpace->grid())
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): "
+        "space and dualSpace must be defined on the same grid");
+  if (projections.n_rows != m_dualSpace->globalDofCount())
+    throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                "the projection matrix has incorrect number "
+                                "of rows");
+  m_projections = boost::make_shared<arma::Mat<ResultType>>(projections);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+MultiGridFunction<BasisFunctionType, ResultType>::MultiGridFunction(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const std::vector<const Function<ResultType> *> &functions)
+    : m_context(context), m_wasInitializedFromCoefficients(false) {
+  if (!context)
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): context must not be null");
+  if (!space)
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): space must not be null");
+  if (!dualSpace)
+    throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                "dualSpace must not be null");
+  if (space->codomainDimension() != dualSpace->codomainDimension())
+    throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                "functions from 'space' and 'dualSpace' have "
+                                "a different number of components");
+  for (size_t i = 0; i < functions.size(); ++i)
+    if (!functions[i] ||
+        functions[i]->codomainDimension() != space->codomainDimension())
+      throw std::invalid_argument(
+          "MultiGridFunction::MultiGridFunction(): "
+          "functions must not be null and must have as many components as "
+          "the functions from 'space'");
+  if (space->isBarycentric() || dualSpace->isBarycentric()) {
+    m_space = space->barycentricSpace(space);
+    m_dualSpace = dualSpace->barycentricSpace(dualSpace);
+  } else {
+    m_space = space;
+    m_dualSpace = dualSpace;
+  }
+  if (m_space->grid() != m_dualSpace->grid())
+    throw std::invalid_argument(
+        "MultiGridFunction::MultiGridFunction(): "
+        "space and dualSpace must be defined on the same grid");
+  m_projections = boost::make_shared<arma::Mat<ResultType>>(
+      projectFunctions(*context, functions, *m_dualSpace));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+MultiGridFunction<BasisFunctionType, ResultType>::MultiGridFunction(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &functions)
+    : m_wasInitializedFromCoefficients(false) {
+  if (functions.empty())
+    throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                "'functions' must not be empty");
+  for (size_t i = 0; i < functions.size(); ++i) {
+    if (!functions[i].isInitialized())
+      throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                  "functions must be initialized");
+    if (functions[i].space() != functions[0].space())
+      throw std::invalid_argument("MultiGridFunction::MultiGridFunction(): "
+                                  "spaces don't match");
+  }
+  m_context = functions[0].context();
+  m_space = functions[0].space();
+
+  // Gather the projections if that needs no conversion
+  bool useProjections = true;
+  for (size_t i = 0; i < functions.size() && useProjections; ++i)
+    useProjections = !functions[i].wasInitializedFromCoefficients() &&
+                     functions[i].dualSpace() &&
+                     functions[i].dualSpace() == functions[0].dualSpace();
+
+  shared_ptr<arma::Mat<ResultType>> data;
+  if (useProjections) {
+    m_dualSpace = functions[0].dualSpace();
+    data = boost::make_shared<arma::Mat<ResultType>>(
+        m_dualSpace->globalDofCount(), functions.size());
+    for (size_t i = 0; i < functions.size(); ++i)
+      data->col(i) = functions[i].projections(m_dualSpace);
+    m_projections = data;
+  } else {
+    data = boost::make_shared<arma::Mat<ResultType>>(
+        m_space->globalDofCount(), functions.size());
+    for (size_t i = 0; i < functions.size(); ++i)
+      data->col(i) = functions[i].coefficients();
+    m_coefficients = data;
+    m_wasInitializedFromCoefficients = true;
+  }
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool MultiGridFunction<BasisFunctionType, ResultType>::isInitialized() const {
+  return (bool)m_space;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool MultiGridFunction<
+    BasisFunctionType, ResultType>::wasInitializedFromCoefficients() const {
+  return m_wasInitializedFromCoefficients;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+size_t MultiGridFunction<BasisFunctionType, ResultType>::columnCount() const {
+  if (m_coefficients)
+    return m_coefficients->n_cols;
+  if (m_projections)
+    return m_projections->n_cols;
+  return 0;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Grid>
+MultiGridFunction<BasisFunctionType, ResultType>::grid() const {
+  checkInitialized("grid");
+  return m_space->grid();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType>>
+MultiGridFunction<BasisFunctionType, ResultType>::space() const {
+  return m_space;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType>>
+MultiGridFunction<BasisFunctionType, ResultType>::dualSpace() const {
+  return m_dualSpace;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Context<BasisFunctionType, ResultType>>
+MultiGridFunction<BasisFunctionType, ResultType>::context() const {
+  return m_context;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const arma::Mat<ResultType> &
+MultiGridFunction<BasisFunctionType, ResultType>::coefficients() const {
+  checkInitialized("coefficients");
+  if (!m_coefficients) {
+    shared_ptr<const DiscreteBoundaryOperator<ResultType>> inverseMassMatrix =
+        m_context->massMatrixCache()->inverseMassMatrix(m_context, m_space,
+                                                        m_dualSpace);
+    shared_ptr<arma::Mat<ResultType>> newCoefficients =
+        boost::make_shared<arma::Mat<ResultType>>(m_space->globalDofCount(),
+                                                 m_projections->n_cols);
+    inverseMassMatrix->apply(NO_TRANSPOSE, *m_projections, *newCoefficients,
+                             static_cast<ResultType>(1.),
+                             static_cast<ResultType>(0.));
+    m_coefficients = newCoefficients;
+  }
+  return *m_coefficients;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const arma::Mat<ResultType> &
+MultiGridFunction<BasisFunctionType, ResultType>::projections(
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace_) const {
+  checkInitialized("projections");
+  if (!dualSpace_)
+    throw std::invalid_argument("MultiGridFunction::projections(): "
+                                "dualSpace_ must not be null");
+  if (m_space->grid() != dualSpace_->grid())
+    if (!m_space->grid()->isBarycentricRepresentationOf(*dualSpace_->grid()) &&
+        !dualSpace_->grid()->isBarycentricRepresentationOf(*m_space->grid()))
+      throw std::invalid_argument(
+          "MultiGridFunction::projections(): "
+          "space and dual space must be defined on the same grid");
+  if (m_projections && m_dualSpace->spaceIsCompatible(*dualSpace_))
+    return *m_projections;
+
+  const arma::Mat<ResultType> &coeffs = coefficients();
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> massMatrix =
+      m_context->massMatrixCache()->massMatrix(m_context, m_space, dualSpace_);
+  shared_ptr<arma::Mat<ResultType>> newProjections =
+      boost::make_shared<arma::Mat<ResultType>>(dualSpace_->globalDofCount(),
+                                               coeffs.n_cols);
+  massMatrix->apply(NO_TRANSPOSE, coeffs, *newProjections,
+                    static_cast<ResultType>(1.), static_cast<ResultType>(0.));
+  m_projections = newProjections;
+  m_dualSpace = dualSpace_;
+  return *m_projections;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunction<BasisFunctionType, ResultType>
+MultiGridFunction<BasisFunctionType, ResultType>::column(size_t i) const {
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+  checkInitialized("column");
+  if (i >= columnCount())
+    throw std::out_of_range("MultiGridFunction::column(): "
+                            "index out of range");
+  if (m_wasInitializedFromCoefficients)
+    return GF(m_context, m_space,
+              arma::Col<ResultType>(m_coefficients->col(i)));
+  return GF(m_context, m_space, m_dualSpace,
+            arma::Col<ResultType>(m_projections->col(i)));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<GridFunction<BasisFunctionType, ResultType>>
+MultiGridFunction<BasisFunctionType, ResultType>::columns() const {
+  checkInitialized("columns");
+  std::vector<GridFunction<BasisFunctionType, ResultType>> result;
+  result.reserve(columnCount());
+  for (size_t i = 0; i < columnCount(); ++i)
+    result.push_back(column(i));
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<typename MultiGridFunction<BasisFunctionType,
+                                       ResultType>::MagnitudeType>
+MultiGridFunction<BasisFunctionType, ResultType>::L2Norms() const {
+  checkInitialized("L2Norms");
+  // The squared norms are the diagonal entries of C^H M C, with C the
+  // coefficient matrix and M the mass matrix of m_space
+  const arma::Mat<ResultType> &coeffs = coefficients();
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> massMatrix =
+      m_context->massMatrixCache()->massMatrix(m_context, m_space, m_space);
+  arma::Mat<ResultType> product(coeffs.n_rows, coeffs.n_cols);
+  massMatrix->apply(NO_TRANSPOSE, coeffs, product, static_cast<ResultType>(1.),
+                    static_cast<ResultType>(0.));
+  std::vector<MagnitudeType> result(coeffs.n_cols);
+  for (size_t i = 0; i < coeffs.n_cols; ++i) {
+    const MagnitudeType squaredNorm = realPart(
+        arma::cdot(coeffs.col(i), product.col(i)));
+    result[i] = sqrt(std::max(squaredNorm, static_cast<MagnitudeType>(0.)));
+  }
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void MultiGridFunction<BasisFunctionType, ResultType>::checkInitialized(
+    const char *function) const {
+  if (!m_space)
+    throw std::runtime_error("MultiGridFunction::" + std::string(function) +
+                             "() must not be called on an uninitialized "
+                             "MultiGridFunction object");
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void exportToVtu(
+    const MultiGridFunction<BasisFunctionType, ResultType> &functions,
+    VtkWriter::DataType dataType, const std::vector<std::string> &dataLabels,
+    const char *fileNamesBase, const char *filesPath,
+    VtuWriter::Encoding encoding, int pieceCount) {
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+  if (!functions.isInitialized())
+    throw std::invalid_argument("exportToVtu(): MultiGridFunction must be "
+                                "initialized");
+  if (dataLabels.size() != functions.columnCount())
+    throw std::invalid_argument("exportToVtu(): there must be one label per "
+                                "function");
+  // The columns share the coefficients, which are converted only once
+  const arma::Mat<ResultType> &coefficients = functions.coefficients();
+  std::vector<GF> columns;
+  std::vector<const GF *> columnPtrs;
+  columns.reserve(functions.columnCount());
+  for (size_t i = 0; i < functions.columnCount(); ++i)
+    columns.push_back(GF(functions.context(), functions.space(),
+                         arma::Col<ResultType>(coefficients.col(i))));
+  for (size_t i = 0; i < columns.size(); ++i)
+    columnPtrs.push_back(&columns[i]);
+  exportToVtu(columnPtrs, dataType, dataLabels, fileNamesBase, filesPath,
+              encoding, pieceCount);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(MultiGridFunction);
+
+#define INSTANTIATE_EXPORT_TO_VTU(BASIS, RESULT)                               \
+  template void exportToVtu(                                                   \
+      const MultiGridFunction<BASIS, RESULT> &functions,                       \
+      VtkWriter::DataType dataType,                                            \
+      const std::vector<std::string> &dataLabels, const char *fileNamesBase,   \
+      const char *filesPath, VtuWriter::Encoding encoding, int pieceCount)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_EXPORT_TO_VTU);
+
+} // namespace Bempp
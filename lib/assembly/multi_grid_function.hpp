@@ -0,0 +1,191 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_multi_grid_function_hpp
+#define bempp_multi_grid_function_hpp
+
+#include "../common/common.hpp"
+
+#include "grid_function.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Bempp {
+
+/** \ingroup assembly_functions
+ *  \brief Several functions defined on a grid and expanded in the same
+ *  function space.
+ *
+ *  This class plays the part of a vector of GridFunction objects sharing
+ *  their space and context, but stores the coefficients or projections of
+ *  all the functions as the columns of a single matrix. Conversions between
+ *  the two representations then apply the (inverse) mass matrix to all the
+ *  columns at once, and the functions can be passed in one block to
+ *  AssembledPotentialOperator::apply() and the iterative solvers. This is
+ *  useful e.g. for sweeps over many incident fields or sources.
+ *
+ *  As in GridFunction, setting one representation invalidates the other,
+ *  which is recalculated when (and if) it is needed. */
+template <typename BasisFunctionType, typename ResultType>
+class MultiGridFunction {
+public:
+  typedef typename Fiber::ScalarTraits<ResultType>::RealType CoordinateType;
+  typedef typename Fiber::ScalarTraits<ResultType>::RealType MagnitudeType;
+
+  /** \brief Construct an uninitialized object. */
+  MultiGridFunction();
+
+  /** \brief Constructor.
+   *
+   *  \param[in] context      Assembly context from which a quadrature
+   *                          strategy can be retrieved.
+   *  \param[in] space        Function space to expand the functions in.
+   *  \param[in] coefficients
+   *    Matrix with <tt>space.globalDofCount()</tt> rows whose i'th column
+   *    contains the expansion coefficients of the i'th function. */
+  MultiGridFunction(
+      const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+      const shared_ptr<const Space<BasisFunctionType>> &space,
+      const arma::Mat<ResultType> &coefficients);
+
+  /** \brief Constructor.
+   *
+   *  \param[in] context      Assembly context from which a quadrature
+   *                          strategy can be retrieved.
+   *  \param[in] space        Function space to expand the functions in.
+   *  \param[in] dualSpace    Function space dual to \p space.
+   *  \param[in] projections
+   *    Matrix with <tt>dualSpace.globalDofCount()</tt> rows whose i'th
+   *    column contains the scalar products of the i'th function and the
+   *    basis functions of \p dualSpace.
+   *
+   *  Both spaces must be defined on the same grid. */
+  MultiGridFunction(
+      const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+      const shared_ptr<const Space<BasisFunctionType>> &space,
+      const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+      const arma::Mat<ResultType> &projections);
+
+  /** \brief Constructor.
+   *
+   *  Approximate the functions \p *functions[i] in \p space, as the
+   *  GridFunction constructor does in the APPROXIMATE mode. The projections
+   *  of all the functions on \p dualSpace are calculated in a single pass
+   *  over the elements (see projectFunctions()). */
+  MultiGridFunction(
+      const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+      const shared_ptr<const Space<BasisFunctionType>> &space,
+      const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+      const std::vector<const Function<ResultType> *> &functions);
+
+  /** \brief Constructor.
+   *
+   *  Gather the given grid functions, which must be initialized and expanded
+   *  in the same space, into the columns of a new object. If all of them
+   *  were initialized from projections on the same dual space, the
+   *  projections are gathered; otherwise the coefficients are. The context
+   *  of the first function is used. */
+  explicit MultiGridFunction(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &
+          functions);
+
+  /** \brief Return whether this object has been properly initialized. */
+  bool isInitialized() const;
+
+  /** \brief Return true if the object was initialized with coefficients
+   *  and false if it was initialized with projections. */
+  bool wasInitializedFromCoefficients() const;
+
+  /** \brief Number of functions. */
+  size_t columnCount() const;
+
+  /** \brief Grid on which the functions are defined. */
+  shared_ptr<const Grid> grid() const;
+
+  /** \brief Space in which the functions are expanded. */
+  shared_ptr<const Space<BasisFunctionType>> space() const;
+
+  /** \brief Space on whose basis functions the stored projections were
+   *  calculated, or a null pointer if there are none. */
+  shared_ptr<const Space<BasisFunctionType>> dualSpace() const;
+
+  /** \brief Assembly context used to convert the representations. */
+  shared_ptr<const Context<BasisFunctionType, ResultType>> context() const;
+
+  /** \brief Matrix whose i'th column holds the expansion coefficients of the
+   *  i'th function in space().
+   *
+   *  If the object was initialized from projections, the coefficients of
+   *  all the functions are calculated at the first call by a single
+   *  application of the inverse mass matrix. */
+  const arma::Mat<ResultType> &coefficients() const;
+
+  /** \brief Matrix whose i'th column holds the projections of the i'th
+   *  function on the basis functions of \p dualSpace_.
+   *
+   *  They are calculated, if necessary, by a single application of the mass
+   *  matrix to all the coefficients. */
+  const arma::Mat<ResultType> &
+  projections(const shared_ptr<const Space<BasisFunctionType>> &dualSpace_)
+      const;
+
+  /** \brief Return the i'th function as a GridFunction.
+   *
+   *  The returned function holds a copy of the representation the object
+   *  was initialized with. */
+  GridFunction<BasisFunctionType, ResultType> column(size_t i) const;
+
+  /** \brief Return all the functions as GridFunction objects. */
+  std::vector<GridFunction<BasisFunctionType, ResultType>> columns() const;
+
+  /** \brief Return the \f$L^2\f$ norms of all the functions. */
+  std::vector<MagnitudeType> L2Norms() const;
+
+private:
+  void checkInitialized(const char *function) const;
+
+  shared_ptr<const Context<BasisFunctionType, ResultType>> m_context;
+  shared_ptr<const Space<BasisFunctionType>> m_space;
+  mutable shared_ptr<const Space<BasisFunctionType>> m_dualSpace;
+  mutable shared_ptr<const arma::Mat<ResultType>> m_coefficients;
+  mutable shared_ptr<const arma::Mat<ResultType>> m_projections;
+  bool m_wasInitializedFromCoefficients;
+};
+
+/** \relates MultiGridFunction
+  \brief Export the functions to a VTU file with appended binary data.
+
+  The i'th function is labelled \p dataLabels[i]; see the overload of
+  exportToVtu() taking a vector of grid functions for details. */
+template <typename BasisFunctionType, typename ResultType>
+void exportToVtu(
+    const MultiGridFunction<BasisFunctionType, ResultType> &functions,
+    VtkWriter::DataType dataType, const std::vector<std::string> &dataLabels,
+    const char *fileNamesBase, const char *filesPath = 0,
+    VtuWriter::Encoding encoding = VtuWriter::APPENDED_RAW,
+    int pieceCount = 1);
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "node_shared_weak_form.hpp"
+
+#include "abstract_boundary_operator.hpp"
+#include "boundary_operator.hpp"
+#include "context.hpp"
+#include "discrete_dense_boundary_operator.hpp"
+#include "discrete_hmat_boundary_operator.hpp"
+
+#include "../fiber/explicit_instantiation.hpp"
+#include "../hmat/hmatrix_file_format.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Bempp {
+
+namespace {
+
+// Exclusive flock() on a lock file, held for the lifetime of the object.
+// Unlike a communicator, a lock file also coordinates processes that were
+// not started by MPI, e.g. the worker processes of a Python program.
+class NodeLock {
+public:
+  explicit NodeLock(const std::string &fileName) {
+    m_fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0)
+      throw std::runtime_error("nodeSharedWeakForm(): "
+                               "Cannot open lock file " +
+                               fileName + ".");
+    int result;
+    while ((result = ::flock(m_fd, LOCK_EX)) != 0 && errno == EINTR)
+      ;
+    if (result != 0) {
+      ::close(m_fd);
+      throw std::runtime_error("nodeSharedWeakForm(): "
+                               "Cannot lock file " +
+                               fileName + ".");
+    }
+  }
+
+  ~NodeLock() {
+    ::flock(m_fd, LOCK_UN);
+    ::close(m_fd);
+  }
+
+  NodeLock(const NodeLock &) = delete;
+  NodeLock &operator=(const NodeLock &) = delete;
+
+private:
+  int m_fd;
+};
+
+bool fileExists(const std::string &fileName) {
+  struct stat fileStatus;
+  return ::stat(fileName.c_str(), &fileStatus) == 0;
+}
+
+bool isHMatrixFile(const std::string &fileName) {
+  char magic[8] = {};
+  std::ifstream stream(fileName.c_str(), std::ios::binary);
+  stream.read(magic, sizeof(magic));
+  return stream &&
+         std::memcmp(magic, hmat::HMATRIX_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+template <typename ValueType>
+void saveWeakForm(const DiscreteBoundaryOperator<ValueType> &weakForm,
+                  const std::string &fileName) {
+  typedef DiscreteDenseBoundaryOperator<ValueType> DenseOp;
+  typedef DiscreteHMatBoundaryOperator<ValueType> HMatOp;
+  if (const DenseOp *denseOp = dynamic_cast<const DenseOp *>(&weakForm))
+    denseOp->save(fileName);
+  else if (const HMatOp *hMatOp = dynamic_cast<const HMatOp *>(&weakForm))
+    hMatOp->save(fileName);
+  else
+    throw std::invalid_argument("nodeSharedWeakForm(): "
+                                "Only dense and H-matrix weak forms can be "
+                                "shared.");
+}
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+nodeSharedWeakForm(const BoundaryOperator<BasisFunctionType, ResultType> &op,
+                   const std::string &fileName) {
+  {
+    NodeLock lock(fileName + ".lock");
+    if (!fileExists(fileName)) {
+      // Processes that do not hold the lock must never see a partial file
+      const std::string temporaryName =
+          fileName + ".tmp." + std::to_string(::getpid());
+      try {
+        // Assembled past the weak form cache, so that the private copy is
+        // released once it is written
+        if (!op.isInitialized())
+          throw std::invalid_argument("nodeSharedWeakForm(): "
+                                      "Operator is uninitialized.");
+        saveWeakForm(*op.abstractOperator()->assembleWeakForm(*op.context()),
+                     temporaryName);
+        if (std::rename(temporaryName.c_str(), fileName.c_str()) != 0)
+          throw std::runtime_error("nodeSharedWeakForm(): "
+                                   "Cannot rename " +
+                                   temporaryName + " to " + fileName + ".");
+      } catch (...) {
+        std::remove(temporaryName.c_str());
+        throw;
+      }
+    }
+  }
+
+  if (isHMatrixFile(fileName))
+    return DiscreteHMatBoundaryOperator<ResultType>::load(fileName, true);
+  return DiscreteDenseBoundaryOperator<ResultType>::load(fileName, true);
+}
+
+#define INSTANTIATE_NONMEMBER_FUNCTION(BASIS, RESULT)                          \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  nodeSharedWeakForm(const BoundaryOperator<BASIS, RESULT> &,                  \
+                     const std::string &)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_NONMEMBER_FUNCTION);
+
+} // namespace Bempp
@@ -0,0 +1,65 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_node_shared_weak_form_hpp
+#define bempp_node_shared_weak_form_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <string>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType>
+class BoundaryOperator;
+template <typename ValueType> class DiscreteBoundaryOperator;
+/** \endcond */
+
+/** \ingroup assembly_functions
+ *  \brief Assemble the weak form of an operator once and share it between
+ *  the processes of a compute node.
+ *
+ *  \p fileName should lie in a directory shared by the processes of a node,
+ *  preferably a memory-backed one such as <tt>/dev/shm</tt>. The first
+ *  process to get here assembles the weak form of \p op and writes it to
+ *  \p fileName with DiscreteDenseBoundaryOperator::save() or
+ *  DiscreteHMatBoundaryOperator::save(); the others wait for it on the
+ *  lock file <tt>fileName + ".lock"</tt> and do not assemble anything. All
+ *  processes, including the first one, then return the operator loaded
+ *  from a read-only memory mapping of the file, so that the node holds a
+ *  single copy of its entries in the page cache. The weak form is assembled
+ *  past the weak form cache of the context of \p op, so that the private
+ *  copy is released once it is written.
+ *
+ *  If \p fileName exists already, it is loaded without assembly, also by
+ *  later runs. Its name should therefore identify the operator and its
+ *  discretisation; removing the file and its lock file is left to the
+ *  caller. Weak forms other than dense and H-matrix operators are rejected
+ *  with an exception. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+nodeSharedWeakForm(const BoundaryOperator<BasisFunctionType, ResultType> &op,
+                   const std::string &fileName);
+
+} // namespace Bempp
+
+#endif
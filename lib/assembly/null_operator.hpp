@@ -44,7 +44,7 @@ template <typename BasisFunctionType, typename ResultType> class NullOperator;
 /** \endcond */
 
 template <typename BasisFunctionType, typename ResultType>
-class BEMPP_DEPRECATED NullOperatorId : public AbstractBoundaryOperatorId {
+class NullOperatorId : public AbstractBoundaryOperatorId {
 public:
   NullOperatorId(const NullOperator<BasisFunctionType, ResultType> &op);
   virtual size_t hash() const;
@@ -110,12 +110,8 @@ public:
   /** \brief Return the identifier of this operator.
    *
    *  Null operators are treated as equivalent if they have the same domain,
-   *  range and dual to range.
-   *
-   *  \deprecated This function is deprecated and will be removed in a future
-   *  version of BEM++. */
-  BEMPP_DEPRECATED virtual shared_ptr<const AbstractBoundaryOperatorId>
-  id() const;
+   *  range and dual to range. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
 
   /** \brief Return true. */
   virtual bool isLocal() const;
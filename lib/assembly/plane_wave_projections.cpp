@@ -0,0 +1,387 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "plane_wave_projections.hpp"
+
+#include "assembly_options.hpp"
+#include "context.hpp"
+#include "grid_function.hpp"
+#include "local_assembler_construction_helper.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../fiber/basis_data.hpp"
+#include "../fiber/collection_of_3d_arrays.hpp"
+#include "../fiber/collection_of_shapeset_transformations.hpp"
+#include "../fiber/default_quadrature_descriptor_selector_for_grid_functions.hpp"
+#include "../fiber/default_single_quadrature_rule_family.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/geometrical_data.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/shapeset.hpp"
+#include "../fiber/task_arena_cache.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/geometry.hpp"
+#include "../grid/geometry_factory.hpp"
+#include "../grid/grid_view.hpp"
+#include "../grid/mapper.hpp"
+#include "../space/space.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
+namespace Bempp {
+
+namespace {
+
+// Quadrature rule together with the values of the test shape functions at
+// its points
+template <typename BasisFunctionType> struct QuadratureVariant {
+  typedef typename ScalarTraits<BasisFunctionType>::RealType
+  CoordinateType;
+
+  arma::Mat<CoordinateType> points;
+  std::vector<CoordinateType> weights;
+  Fiber::BasisData<BasisFunctionType> basisData;
+};
+
+// Values of the test functions of each element at its quadrature points,
+// multiplied by the quadrature weights and integration elements, and the
+// physical coordinates of these points
+template <typename BasisFunctionType> struct WeightedTestValues {
+  typedef typename ScalarTraits<BasisFunctionType>::RealType
+  CoordinateType;
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType
+  ResultType;
+
+  // Columns pointOffsets[e] to pointOffsets[e + 1] - 1 of points belong to
+  // element e
+  std::vector<size_t> pointOffsets;
+  arma::Mat<CoordinateType> points;
+  // values[e](dof, point): conjugated value of the test function dof at the
+  // given quadrature point of element e, times the quadrature weight
+  std::vector<arma::Mat<ResultType>> values;
+};
+
+template <typename CoordinateType>
+CoordinateType longestEdge(const Fiber::RawGridGeometry<CoordinateType> &geom,
+                           int elementIndex) {
+  const arma::Mat<CoordinateType> &vertices = geom.vertices();
+  const int cornerCount = geom.elementCornerCount(elementIndex);
+  CoordinateType result = 0.;
+  for (int i = 0; i < cornerCount; ++i) {
+    const int a = geom.elementCornerIndices()(i, elementIndex);
+    const int b =
+        geom.elementCornerIndices()((i + 1) % cornerCount, elementIndex);
+    result = std::max(result, static_cast<CoordinateType>(arma::norm(
+                                  vertices.col(a) - vertices.col(b), 2)));
+  }
+  return result;
+}
+
+template <typename BasisFunctionType>
+void evaluateWeightedTestValues(
+    const Space<BasisFunctionType> &dualSpace,
+    typename ScalarTraits<BasisFunctionType>::RealType waveNumberAbs,
+    const AccuracyOptionsEx &accuracyOptions, int maxThreadCount,
+    WeightedTestValues<BasisFunctionType> &result) {
+  typedef typename ScalarTraits<BasisFunctionType>::RealType
+  CoordinateType;
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType
+  ResultType;
+  typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+  typedef std::vector<const Fiber::Shapeset<BasisFunctionType> *>
+  ShapesetPtrVector;
+  typedef LocalAssemblerConstructionHelper Helper;
+  typedef QuadratureVariant<BasisFunctionType> Variant;
+  typedef std::pair<const Fiber::Shapeset<BasisFunctionType> *,
+                    Fiber::SingleQuadratureDescriptor> VariantKey;
+
+  shared_ptr<const RawGridGeometry> rawGeometry;
+  shared_ptr<GeometryFactory> geometryFactory;
+  shared_ptr<ShapesetPtrVector> testShapesets;
+  Helper::collectGridData(dualSpace, rawGeometry, geometryFactory);
+  Helper::collectShapesets(dualSpace, testShapesets);
+  const Fiber::CollectionOfShapesetTransformations<CoordinateType> &
+  testTransformations = dualSpace.basisFunctionValue();
+
+  size_t testBasisDeps = 0;
+  size_t geomDeps = Fiber::GLOBALS | Fiber::INTEGRATION_ELEMENTS;
+  testTransformations.addDependencies(testBasisDeps, geomDeps);
+
+  // Select the quadrature rules and evaluate the shape functions, once per
+  // rule and shapeset
+  Fiber::DefaultQuadratureDescriptorSelectorForGridFunctions<BasisFunctionType>
+  selector(rawGeometry, testShapesets, accuracyOptions);
+  Fiber::DefaultSingleQuadratureRuleFamily<CoordinateType> ruleFamily;
+  const size_t elementCount = rawGeometry->elementCount();
+  std::map<VariantKey, Variant> variants;
+  std::vector<const Variant *> elementVariants(elementCount);
+  result.pointOffsets.resize(elementCount + 1);
+  result.pointOffsets[0] = 0;
+  for (size_t e = 0; e < elementCount; ++e) {
+    Fiber::SingleQuadratureDescriptor desc = selector.quadratureDescriptor(e);
+    desc.order += static_cast<int>(
+        std::ceil(waveNumberAbs * longestEdge(*rawGeometry, e)));
+    const VariantKey key((*testShapesets)[e], desc);
+    typename std::map<VariantKey, Variant>::iterator it = variants.find(key);
+    if (it == variants.end()) {
+      it = variants.insert(std::make_pair(key, Variant())).first;
+      Variant &variant = it->second;
+      ruleFamily.fillQuadraturePointsAndWeights(desc, variant.points,
+                                                variant.weights);
+      key.first->evaluate(testBasisDeps, variant.points, Fiber::ALL_DOFS,
+                          variant.basisData);
+    }
+    elementVariants[e] = &it->second;
+    result.pointOffsets[e + 1] =
+        result.pointOffsets[e] + it->second.weights.size();
+  }
+
+  result.points.set_size(rawGeometry->worldDimension(),
+                         result.pointOffsets[elementCount]);
+  result.values.resize(elementCount);
+
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, elementCount, 256),
+        [&](const tbb::blocked_range<size_t> &r) {
+          std::unique_ptr<Geometry> geometry(geometryFactory->make());
+          Fiber::GeometricalData<CoordinateType> geomData;
+          Fiber::CollectionOf3dArrays<BasisFunctionType> testValues;
+          for (size_t e = r.begin(); e != r.end(); ++e) {
+            const Variant &variant = *elementVariants[e];
+            rawGeometry->setupGeometry(e, *geometry);
+            geometry->getData(geomDeps, variant.points, geomData);
+            testTransformations.evaluate(variant.basisData, geomData,
+                                         testValues);
+
+            const size_t pointCount = variant.weights.size();
+            const size_t dofCount = testValues[0].extent(1);
+            if (pointCount > 0)
+              result.points.cols(result.pointOffsets[e],
+                                 result.pointOffsets[e + 1] - 1) =
+                  geomData.globals;
+            arma::Mat<ResultType> &values = result.values[e];
+            values.set_size(dofCount, pointCount);
+            for (size_t point = 0; point < pointCount; ++point) {
+              const CoordinateType weight =
+                  variant.weights[point] * geomData.integrationElements(point);
+              for (size_t dof = 0; dof < dofCount; ++dof)
+                values(dof, point) =
+                    static_cast<ResultType>(conj(testValues[0](0, dof, point)))
+                    * weight;
+            }
+          }
+        });
+  });
+}
+
+} // namespace
+
+template <typename BasisFunctionType>
+arma::Mat<typename ScalarTraits<BasisFunctionType>::ComplexType>
+calculatePlaneWaveProjections(
+    const Context<BasisFunctionType,
+                  typename ScalarTraits<BasisFunctionType>::ComplexType>
+        &context,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace_,
+    const arma::Mat<typename ScalarTraits<BasisFunctionType>::RealType>
+        &directions,
+    typename ScalarTraits<BasisFunctionType>::ComplexType waveNumber,
+    const AccuracyOptionsEx &accuracyOptions) {
+  typedef typename ScalarTraits<BasisFunctionType>::RealType
+  CoordinateType;
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType
+  ResultType;
+
+  if (!dualSpace_)
+    throw std::invalid_argument("calculatePlaneWaveProjections(): "
+                                "dualSpace must not be null");
+  if (dualSpace_->codomainDimension() != 1)
+    throw std::invalid_argument("calculatePlaneWaveProjections(): "
+                                "functions from 'dualSpace' must be scalar");
+  if (directions.n_rows != 3)
+    throw std::invalid_argument("calculatePlaneWaveProjections(): "
+                                "'directions' must have three rows");
+  // The projections on a barycentric space are calculated on the refined grid
+  shared_ptr<const Space<BasisFunctionType>> dualSpace =
+      dualSpace_->isBarycentric() ? dualSpace_->barycentricSpace(dualSpace_)
+                                  : dualSpace_;
+
+  const ParallelizationOptions &parallelOptions =
+      context.assemblyOptions().parallelizationOptions();
+  int maxThreadCount = 1;
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
+
+  WeightedTestValues<BasisFunctionType> testValues;
+  evaluateWeightedTestValues(*dualSpace, std::abs(waveNumber),
+                             accuracyOptions, maxThreadCount, testValues);
+  if (testValues.points.n_rows != 3)
+    throw std::invalid_argument("calculatePlaneWaveProjections(): "
+                                "the grid must be embedded in 3D space");
+
+  // Gather global DOF lists
+  const GridView &view = dualSpace->gridView();
+  const size_t elementCount = view.entityCount(0);
+  std::vector<std::vector<GlobalDofIndex>> globalDofs(elementCount);
+  std::vector<std::vector<BasisFunctionType>> localDofWeights(elementCount);
+  const Mapper &mapper = view.elementMapper();
+  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
+  while (!it->finished()) {
+    const Entity<0> &element = it->entity();
+    const int elementIndex = mapper.entityIndex(element);
+    dualSpace->getGlobalDofs(element, globalDofs[elementIndex],
+                             localDofWeights[elementIndex]);
+    it->next();
+  }
+
+  const size_t directionCount = directions.n_cols;
+  arma::Mat<ResultType> result(dualSpace->globalDofCount(), directionCount);
+  result.fill(0.);
+  if (directionCount == 0 || elementCount == 0)
+    return result;
+
+  // Each task handles a block of directions, i.e. a block of columns of the
+  // result, over all elements, so no synchronisation is needed. The points
+  // are processed in chunks of whole elements to bound the size of the
+  // matrices of phases.
+  const size_t DIRECTION_BLOCK_SIZE = 16;
+  const size_t POINT_CHUNK_SIZE = 4096;
+  const ResultType ik = ResultType(0., 1.) * waveNumber;
+  {
+    Fiber::SerialBlasRegion region;
+    Fiber::executeInTaskArena(maxThreadCount, [&] {
+      tbb::parallel_for(
+          tbb::blocked_range<size_t>(0, directionCount, DIRECTION_BLOCK_SIZE),
+          [&](const tbb::blocked_range<size_t> &r) {
+            const arma::Mat<CoordinateType> blockDirections =
+                directions.cols(r.begin(), r.end() - 1);
+            arma::Mat<CoordinateType> phases;
+            arma::Mat<ResultType> waves, localResult;
+            for (size_t start = 0, end = 0; start < elementCount;
+                 start = end) {
+              end = start + 1;
+              while (end < elementCount &&
+                     testValues.pointOffsets[end + 1] -
+                             testValues.pointOffsets[start] <=
+                         POINT_CHUNK_SIZE)
+                ++end;
+              const size_t firstPoint = testValues.pointOffsets[start];
+              const size_t lastPoint = testValues.pointOffsets[end];
+              if (lastPoint == firstPoint)
+                continue;
+
+              // phases(p, j) = x_p . d_j
+              phases = arma::trans(testValues.points.cols(
+                           firstPoint, lastPoint - 1)) *
+                       blockDirections;
+              waves.set_size(phases.n_rows, phases.n_cols);
+              for (size_t i = 0; i < phases.n_elem; ++i)
+                waves[i] = std::exp(ik * phases[i]);
+
+              for (size_t e = start; e < end; ++e) {
+                const size_t offset = testValues.pointOffsets[e] - firstPoint;
+                const size_t pointCount =
+                    testValues.pointOffsets[e + 1] -
+                    testValues.pointOffsets[e];
+                if (pointCount == 0)
+                  continue;
+                localResult =
+                    testValues.values[e] *
+                    waves.rows(offset, offset + pointCount - 1);
+                for (size_t dof = 0; dof < globalDofs[e].size(); ++dof) {
+                  const int globalDof = globalDofs[e][dof];
+                  if (globalDof < 0) // constrained local DOF
+                    continue;
+                  const ResultType weight = conj(localDofWeights[e][dof]);
+                  for (size_t j = 0; j < localResult.n_cols; ++j)
+                    result(globalDof, r.begin() + j) +=
+                        weight * localResult(dof, j);
+                }
+              }
+            }
+          });
+    });
+  }
+  return result;
+}
+
+template <typename BasisFunctionType>
+std::vector<GridFunction<
+    BasisFunctionType,
+    typename ScalarTraits<BasisFunctionType>::ComplexType>>
+makePlaneWaveGridFunctions(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const arma::Mat<typename ScalarTraits<BasisFunctionType>::RealType>
+        &directions,
+    typename ScalarTraits<BasisFunctionType>::ComplexType waveNumber,
+    const AccuracyOptionsEx &accuracyOptions) {
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType
+  ResultType;
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+  if (!context)
+    throw std::invalid_argument("makePlaneWaveGridFunctions(): "
+                                "context must not be null");
+  if (!space)
+    throw std::invalid_argument("makePlaneWaveGridFunctions(): "
+                                "space must not be null");
+
+  arma::Mat<ResultType> projections = calculatePlaneWaveProjections(
+      *context, dualSpace, directions, waveNumber, accuracyOptions);
+  std::vector<GF> result;
+  result.reserve(projections.n_cols);
+  for (size_t i = 0; i < projections.n_cols; ++i)
+    result.push_back(GF(context, space, dualSpace,
+                        arma::Col<ResultType>(projections.col(i))));
+  return result;
+}
+
+#define INSTANTIATE_FUNCTIONS(BASIS)                                           \
+  template arma::Mat<ScalarTraits<BASIS>::ComplexType>                         \
+  calculatePlaneWaveProjections(                                               \
+      const Context<BASIS, ScalarTraits<BASIS>::ComplexType> &context,         \
+      const shared_ptr<const Space<BASIS>> &dualSpace,                         \
+      const arma::Mat<ScalarTraits<BASIS>::RealType> &directions,              \
+      ScalarTraits<BASIS>::ComplexType waveNumber,                             \
+      const AccuracyOptionsEx &accuracyOptions);                               \
+  template std::vector<GridFunction<BASIS, ScalarTraits<BASIS>::ComplexType>>  \
+  makePlaneWaveGridFunctions(                                                  \
+      const shared_ptr<const Context<BASIS, ScalarTraits<BASIS>::ComplexType>> \
+          &context,                                                            \
+      const shared_ptr<const Space<BASIS>> &space,                             \
+      const shared_ptr<const Space<BASIS>> &dualSpace,                         \
+      const arma::Mat<ScalarTraits<BASIS>::RealType> &directions,              \
+      ScalarTraits<BASIS>::ComplexType waveNumber,                             \
+      const AccuracyOptionsEx &accuracyOptions)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_FUNCTIONS);
+
+} // namespace Bempp
@@ -0,0 +1,112 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_plane_wave_projections_hpp
+#define bempp_plane_wave_projections_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../fiber/accuracy_options.hpp"
+#include "../common/scalar_traits.hpp"
+
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType> class Context;
+template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+using Fiber::AccuracyOptionsEx;
+
+/** \relates GridFunction
+ *  \brief Calculate the projections of several plane waves on the basis
+ *  functions of a scalar space.
+ *
+ *  On output, <tt>result(i, j)</tt> is equal to
+ *  \f[
+ *    \int_\Gamma \overline{\phi_i(x)} \exp(\mathrm{i} k\, d_j \cdot x)
+ *    \,\mathrm{d}\Gamma(x),
+ *  \f]
+ *  where \f$\phi_i\f$ is the \f$i\f$th basis function of \p dualSpace,
+ *  \f$k\f$ = \p waveNumber and \f$d_j\f$ is the \f$j\f$th column of the
+ *  3 x n matrix \p directions.
+ *
+ *  The quadrature points of all elements are mapped to the physical space
+ *  once. The phases \f$d_j \cdot x\f$ are then obtained as a product of the
+ *  matrix of points and the matrix of directions, and the projections as
+ *  products of the matrices of weighted basis function values and the
+ *  matrices of plane-wave values. This is much faster than constructing a
+ *  GridFunction for each direction and suits scattering problems with many
+ *  incident fields, whose right-hand sides can be solved for together. The
+ *  directions are distributed among threads; the maximum thread count is
+ *  taken from the assembly options of \p context.
+ *
+ *  The quadrature order on each element is chosen by
+ *  Fiber::DefaultQuadratureDescriptorSelectorForGridFunctions from \p
+ *  accuracyOptions and raised by \f$\lceil |k| h \rceil\f$, \f$h\f$ being
+ *  the length of the longest edge of the element, to resolve the
+ *  oscillations of the integrand.
+ *
+ *  An exception is thrown if the functions of \p dualSpace are not scalar
+ *  or \p directions does not have three rows. */
+template <typename BasisFunctionType>
+arma::Mat<typename ScalarTraits<BasisFunctionType>::ComplexType>
+calculatePlaneWaveProjections(
+    const Context<BasisFunctionType,
+                  typename ScalarTraits<BasisFunctionType>::ComplexType>
+        &context,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const arma::Mat<typename ScalarTraits<BasisFunctionType>::RealType>
+        &directions,
+    typename ScalarTraits<BasisFunctionType>::ComplexType waveNumber,
+    const AccuracyOptionsEx &accuracyOptions = AccuracyOptionsEx());
+
+/** \relates GridFunction
+ *  \brief Construct grid functions representing plane waves travelling in
+ *  the given directions.
+ *
+ *  The i'th returned grid function, expanded in \p space, is initialized
+ *  from the projections of \f$\exp(\mathrm{i} k\, d_i \cdot x)\f$ on the
+ *  basis functions of \p dualSpace. They are calculated by
+ *  calculatePlaneWaveProjections(), to which the remaining parameters are
+ *  passed. */
+template <typename BasisFunctionType>
+std::vector<GridFunction<
+    BasisFunctionType,
+    typename ScalarTraits<BasisFunctionType>::ComplexType>>
+makePlaneWaveGridFunctions(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    const shared_ptr<const Space<BasisFunctionType>> &dualSpace,
+    const arma::Mat<typename ScalarTraits<BasisFunctionType>::RealType>
+        &directions,
+    typename ScalarTraits<BasisFunctionType>::ComplexType waveNumber,
+    const AccuracyOptionsEx &accuracyOptions = AccuracyOptionsEx());
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,85 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "potential_evaluator.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/evaluator_for_integral_operators.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename ResultType>
+PotentialEvaluator<ResultType>::PotentialEvaluator(
+    std::unique_ptr<Evaluator> evaluator,
+    const ParallelizationOptions &parallelizationOptions)
+    : m_evaluator(std::move(evaluator)) {
+  if (!m_evaluator)
+    throw std::invalid_argument("PotentialEvaluator::PotentialEvaluator(): "
+                                "evaluator must not be null");
+  m_maxThreadCount = 1;
+  if (!parallelizationOptions.isOpenClEnabled())
+    m_maxThreadCount = parallelizationOptions.maxThreadCount();
+}
+
+template <typename ResultType>
+PotentialEvaluator<ResultType>::~PotentialEvaluator() {}
+
+template <typename ResultType>
+int PotentialEvaluator<ResultType>::worldDimension() const {
+  return m_evaluator->worldDimension();
+}
+
+template <typename ResultType>
+int PotentialEvaluator<ResultType>::componentCount() const {
+  return m_evaluator->resultDimension();
+}
+
+template <typename ResultType>
+void PotentialEvaluator<ResultType>::evaluate(const CoordinateType *points,
+                                              size_t pointCount,
+                                              ResultType *result) const {
+  // As in ElementaryPotentialOperator::evaluateAtPoints(), elements close to
+  // the points are integrated with near-field quadrature orders
+  Fiber::executeInTaskArena(m_maxThreadCount, [&] {
+    m_evaluator->evaluate(Evaluator::NEAR_FIELD, points, pointCount, result);
+  });
+}
+
+template <typename ResultType>
+void PotentialEvaluator<ResultType>::evaluate(
+    const arma::Mat<CoordinateType> &points,
+    arma::Mat<ResultType> &result) const {
+  if (static_cast<int>(points.n_rows) != worldDimension())
+    throw std::invalid_argument(
+        "PotentialEvaluator::evaluate(): "
+        "the number of coordinates of each evaluation point must be "
+        "equal to the dimension of the space containing the surface "
+        "on which the charge distribution is defined");
+  result.set_size(componentCount(), points.n_cols);
+  evaluate(points.memptr(), points.n_cols, result.memptr());
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(PotentialEvaluator);
+
+} // namespace Bempp
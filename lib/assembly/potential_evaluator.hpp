@@ -0,0 +1,115 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_potential_evaluator_hpp
+#define bempp_potential_evaluator_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/scalar_traits.hpp"
+#include "../fiber/parallelization_options.hpp"
+
+#include <memory>
+
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename ResultType> class EvaluatorForIntegralOperators;
+/** \endcond */
+
+} // namespace Fiber
+
+namespace Bempp {
+
+using Fiber::ParallelizationOptions;
+
+/** \ingroup potential_operators
+ *  \brief Evaluator of the potential of a fixed charge distribution at
+ *  streamed points.
+ *
+ *  Objects of this class are created by
+ *  ElementaryPotentialOperator::makePotentialEvaluator(). The data related to the
+ *  charge distribution (quadrature points, values of the argument etc.) are
+ *  calculated once, on construction, and reused by all subsequent calls to
+ *  evaluate(). The evaluation points can therefore be supplied in batches of
+ *  arbitrary size, e.g. read successively from a file or a memory-mapped
+ *  array, and the potential written directly into buffers owned by the
+ *  caller.
+ */
+template <typename ResultType> class PotentialEvaluator {
+public:
+  /** \brief Type used to represent point coordinates. */
+  typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+  /** \brief Type of the underlying low-level evaluator. */
+  typedef Fiber::EvaluatorForIntegralOperators<ResultType> Evaluator;
+
+  /** \brief Constructor.
+   *
+   *  \param[in] evaluator
+   *    Low-level evaluator of the potential. Ownership is taken over.
+   *  \param[in] parallelizationOptions
+   *    Options determining the number of threads used by evaluate().
+   */
+  PotentialEvaluator(std::unique_ptr<Evaluator> evaluator,
+                     const ParallelizationOptions &parallelizationOptions);
+
+  /** \brief Destructor. */
+  ~PotentialEvaluator();
+
+  /** \brief Return the number of coordinates of each evaluation point. */
+  int worldDimension() const;
+
+  /** \brief Return the number of components of the potential. */
+  int componentCount() const;
+
+  /** \brief Evaluate the potential at a batch of points.
+   *
+   *  \param[in] points
+   *    Array of <tt>worldDimension() * pointCount</tt> coordinates; the
+   *    coordinates of each point are stored contiguously.
+   *  \param[in] pointCount
+   *    Number of points in the batch.
+   *  \param[out] result
+   *    Buffer of <tt>componentCount() * pointCount</tt> values, to which the
+   *    components of the potential at each point are written contiguously.
+   */
+  void evaluate(const CoordinateType *points, size_t pointCount,
+                ResultType *result) const;
+
+  /** \brief Evaluate the potential at a batch of points.
+   *
+   *  Convenience overload of evaluate(). The (i, j)th element of \p points
+   *  is the ith coordinate of the jth point; on output, the (i, j)th element
+   *  of \p result is the ith component of the potential at the jth point.
+   *  If \p result already has the right size, its memory is reused. */
+  void evaluate(const arma::Mat<CoordinateType> &points,
+                arma::Mat<ResultType> &result) const;
+
+private:
+  /** \cond PRIVATE */
+  std::unique_ptr<Evaluator> m_evaluator;
+  int m_maxThreadCount;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -3,6 +3,16 @@
 #include "assembled_potential_operator.hpp"
 #include "interpolated_function.hpp"
 
+#ifdef WITH_MPI
+#include "../common/block_partition.hpp"
+#include "../common/mpi_datatype.hpp"
+#include "../grid/grid.hpp"
+#include "../grid/grid_view.hpp"
+
+#include <stdexcept>
+#include <vector>
+#endif
+
 namespace Bempp {
 
 template <typename BasisFunctionType, typename ResultType>
@@ -48,6 +58,62 @@ PotentialOperator<BasisFunctionType, ResultType>::evaluateOnGrid(
                               EvaluationOptions(parameterList));
 }
 
+#ifdef WITH_MPI
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType>
+PotentialOperator<BasisFunctionType, ResultType>::evaluateAtPointsDistributed(
+    const GridFunction<BasisFunctionType, ResultType> &argument,
+    const arma::Mat<CoordinateType> &evaluationPoints,
+    const ParameterList &parameterList, MPI_Comm comm) const {
+
+  int size = 0, rank = 0;
+  MPI_Comm_size(comm, &size);
+  MPI_Comm_rank(comm, &rank);
+  const std::pair<size_t, size_t> range =
+      blockPartitionRange(evaluationPoints.n_cols, size, rank);
+  if (range.first == range.second)
+    return arma::Mat<ResultType>(componentCount(), 0);
+  return this->evaluateAtPoints(
+      argument, evaluationPoints.cols(range.first, range.second - 1),
+      parameterList);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::unique_ptr<InterpolatedFunction<ResultType>>
+PotentialOperator<BasisFunctionType, ResultType>::evaluateOnGridDistributed(
+    const GridFunction<BasisFunctionType, ResultType> &argument,
+    const Grid &evaluationGrid, const ParameterList &parameterList,
+    MPI_Comm comm) const {
+
+  arma::Mat<CoordinateType> vertices;
+  arma::Mat<int> elementCorners;
+  arma::Mat<char> auxData;
+  evaluationGrid.leafView()->getRawElementData(vertices, elementCorners,
+                                               auxData);
+  const arma::Mat<ResultType> localResult =
+      evaluateAtPointsDistributed(argument, vertices, parameterList, comm);
+
+  int size = 0;
+  MPI_Comm_size(comm, &size);
+  std::vector<int> counts(size), displacements(size);
+  for (int p = 0; p < size; ++p) {
+    const std::pair<size_t, size_t> range =
+        blockPartitionRange(vertices.n_cols, size, p);
+    counts[p] = componentCount() * (range.second - range.first);
+    displacements[p] = componentCount() * range.first;
+  }
+  arma::Mat<ResultType> result(componentCount(), vertices.n_cols);
+  if (MPI_Allgatherv(const_cast<ResultType *>(localResult.memptr()),
+                     localResult.n_elem, mpiDatatype<ResultType>(),
+                     result.memptr(), &counts[0], &displacements[0],
+                     mpiDatatype<ResultType>(), comm) != MPI_SUCCESS)
+    throw std::runtime_error("PotentialOperator::evaluateOnGridDistributed(): "
+                             "gathering the potential failed");
+  return std::unique_ptr<InterpolatedFunction<ResultType>>(
+      new InterpolatedFunction<ResultType>(evaluationGrid, result));
+}
+#endif
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
         PotentialOperator);
 
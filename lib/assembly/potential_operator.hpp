@@ -22,6 +22,7 @@
 #define bempp_potential_operator_hpp
 
 #include "../common/common.hpp"
+#include "bempp/common/config_mpi.hpp"
 
 #include "../fiber/quadrature_strategy.hpp"
 #include "../common/scalar_traits.hpp"
@@ -32,6 +33,10 @@
 #include "../common/armadillo_fwd.hpp"
 #include <memory>
 
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
 namespace Bempp {
 
 /** \cond FORWARD_DECL */
@@ -173,6 +178,37 @@ public:
                    const arma::Mat<CoordinateType> &evaluationPoints,
                    const ParameterList& parameterList) const;
 
+#ifdef WITH_MPI
+  /** \brief Evaluate the potential at the points owned by this process.
+   *
+   *  The columns of \p evaluationPoints, which must be the same on all
+   *  processes of \p comm, are split into contiguous blocks of almost equal
+   *  size by blockPartitionRange(). Every process evaluates the potential
+   *  at the points of its own block only, using its own copy of \p
+   *  argument, and returns the corresponding columns of the array that
+   *  evaluateAtPoints() would return for all the points. The function does
+   *  not communicate; the local results can be written collectively with
+   *  writeDistributedPointData(). */
+  arma::Mat<ResultType> evaluateAtPointsDistributed(
+      const GridFunction<BasisFunctionType, ResultType> &argument,
+      const arma::Mat<CoordinateType> &evaluationPoints,
+      const ParameterList &parameterList,
+      MPI_Comm comm = MPI_COMM_WORLD) const;
+
+  /** \brief Evaluate the potential on a grid, distributing the vertices
+   *  over the processes of \p comm.
+   *
+   *  Every process evaluates the potential at its own block of vertices of
+   *  \p evaluationGrid, as in evaluateAtPointsDistributed(), and the
+   *  results are then gathered on all processes. The function must be
+   *  called collectively and returns the same InterpolatedFunction as
+   *  evaluateOnGrid() on every process. */
+  std::unique_ptr<InterpolatedFunction<ResultType>> evaluateOnGridDistributed(
+      const GridFunction<BasisFunctionType, ResultType> &argument,
+      const Grid &evaluationGrid, const ParameterList &parameterList,
+      MPI_Comm comm = MPI_COMM_WORLD) const;
+#endif
+
   /** \brief Create and return an AssembledPotentialOperator object.
    *
    *  The returned AssembledPotentialOperator object stores the values of the
@@ -166,7 +166,7 @@ void PotentialOperatorAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
   // Convert AHMED matrix indices into point and DOF indices
   shared_ptr<const ComponentLists> componentLists =
       m_componentListsCache->get(b1, n1);
-  shared_ptr<const LocalDofLists<BasisFunctionType>> trialDofLists =
+  const LocalDofLists<BasisFunctionType> &trialDofLists =
       m_trialDofListsCache->get(b2, n2);
 
   // Necessary points
@@ -177,20 +177,20 @@ void PotentialOperatorAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
 
   typedef typename LocalDofLists<BasisFunctionType>::DofIndex DofIndex;
   // Necessary elements
-  const std::vector<int> &trialElementIndices = trialDofLists->elementIndices;
-  // Necessary local dof indices in each element
-  const std::vector<std::vector<LocalDofIndex>> &trialLocalDofs =
-      trialDofLists->localDofIndices;
+  const std::vector<int> &trialElementIndices = trialDofLists.elementIndices;
+  // Ranges of the local dofs of each element in the arrays below
+  const std::vector<int> &trialOffsets = trialDofLists.elementOffsets;
+  const std::vector<LocalDofIndex> &trialLocalDofs =
+      trialDofLists.localDofIndices;
   // Weights of local dofs in each element
-  const std::vector<std::vector<BasisFunctionType>> &trialLocalDofWeights =
-      trialDofLists->localDofWeights;
+  const std::vector<BasisFunctionType> &trialLocalDofWeights =
+      trialDofLists.localDofWeights;
   for (size_t i = 0; i < trialLocalDofWeights.size(); ++i)
-    for (size_t j = 0; j < trialLocalDofWeights[i].size(); ++j)
-      assert(std::abs(trialLocalDofWeights[i][j]) > 0.);
+    assert(std::abs(trialLocalDofWeights[i]) > 0.);
   // Corresponding row and column indices in the matrix to be calculated
   // and stored in ahmedData
   const std::vector<std::vector<int>> &blockRows = componentLists->arrayIndices;
-  const std::vector<std::vector<int>> &blockCols = trialDofLists->arrayIndices;
+  const std::vector<int> &blockCols = trialDofLists.arrayIndices;
 
   arma::Mat<ResultType> result(data, n1, n2, false /*copy_aux_mem*/,
                                true /*strict*/);
@@ -209,12 +209,11 @@ void PotentialOperatorAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
 
       // The body of this loop will very probably only run once (single
       // local DOF per trial element)
-      for (size_t nTrialDof = 0; nTrialDof < trialLocalDofs[nTrialElem].size();
-           ++nTrialDof) {
-        LocalDofIndex activeTrialLocalDof =
-            trialLocalDofs[nTrialElem][nTrialDof];
+      for (int nTrialDof = trialOffsets[nTrialElem];
+           nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof) {
+        LocalDofIndex activeTrialLocalDof = trialLocalDofs[nTrialDof];
         BasisFunctionType activeTrialLocalDofWeight =
-            trialLocalDofWeights[nTrialElem][nTrialDof];
+            trialLocalDofWeights[nTrialDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalContributions(
               pointIndices, activeTrialElementIndex, activeTrialLocalDof,
@@ -244,12 +243,12 @@ void PotentialOperatorAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
           localResult, minDist);
       for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
            ++nTrialElem)
-        for (size_t nTrialDof = 0;
-             nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
-          result(0, blockCols[nTrialElem][nTrialDof]) +=
+        for (int nTrialDof = trialOffsets[nTrialElem];
+             nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+          result(0, blockCols[nTrialDof]) +=
               m_termMultipliers[nTerm] *
-              trialLocalDofWeights[nTrialElem][nTrialDof] *
-              localResult[nTrialElem](0, trialLocalDofs[nTrialElem][nTrialDof]);
+              trialLocalDofWeights[nTrialDof] *
+              localResult[nTrialElem](0, trialLocalDofs[nTrialDof]);
     }
   } else { // a "fat" block
     // The whole block or its submatrix needed. This means that we are
@@ -263,18 +262,18 @@ void PotentialOperatorAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
           pointIndices, trialElementIndices, localResult, minDist);
       for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
            ++nTrialElem)
-        for (size_t nTrialDof = 0;
-             nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
+        for (int nTrialDof = trialOffsets[nTrialElem];
+             nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
           for (size_t nPoint = 0; nPoint < pointIndices.size(); ++nPoint)
             for (size_t nComponent = 0;
                  nComponent < componentIndices[nPoint].size(); ++nComponent)
               result(blockRows[nPoint][nComponent],
-                     blockCols[nTrialElem][nTrialDof]) +=
+                     blockCols[nTrialDof]) +=
                   m_termMultipliers[nTerm] *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
+                  trialLocalDofWeights[nTrialDof] *
                   localResult(nPoint, nTrialElem)(
                       componentIndices[nPoint][nComponent],
-                      trialLocalDofs[nTrialElem][nTrialDof]);
+                      trialLocalDofs[nTrialDof]);
     }
   }
 }
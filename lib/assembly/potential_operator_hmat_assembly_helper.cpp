@@ -0,0 +1,223 @@
+// Copyright (C) 2011-2014 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "potential_operator_hmat_assembly_helper.hpp"
+
+#include "component_lists_cache.hpp"
+#include "local_dof_lists_cache.hpp"
+
+#include "../common/multidimensional_arrays.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/local_assembler_for_potential_operators.hpp"
+#include "../fiber/types.hpp"
+#include "../space/space.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+template <typename BasisFunctionType, typename ResultType>
+PotentialOperatorHMatAssemblyHelper<BasisFunctionType, ResultType>::
+    PotentialOperatorHMatAssemblyHelper(
+        const arma::Mat<CoordinateType> &points,
+        const Space<BasisFunctionType> &trialSpace,
+        const shared_ptr<hmat::DefaultBlockClusterTreeType> blockClusterTree,
+        const std::vector<LocalAssembler *> &assemblers,
+        const std::vector<ResultType> &termMultipliers)
+    : m_points(points), m_trialSpace(trialSpace),
+      m_blockClusterTree(blockClusterTree), m_assemblers(assemblers),
+      m_termMultipliers(termMultipliers),
+      m_trialDofListsCache(new LocalDofListsCache<BasisFunctionType>(
+          m_trialSpace,
+          blockClusterTree->columnClusterTree()->hMatDofToOriginalDofMap(),
+          true)) {
+  if (assemblers.empty())
+    throw std::invalid_argument("PotentialOperatorHMatAssemblyHelper::"
+                                "PotentialOperatorHMatAssemblyHelper(): "
+                                "the 'assemblers' vector must not be empty");
+  if (assemblers.size() != termMultipliers.size())
+    throw std::invalid_argument(
+        "PotentialOperatorHMatAssemblyHelper::"
+        "PotentialOperatorHMatAssemblyHelper(): "
+        "the 'assemblers' and 'termMultipliers' vectors must have the "
+        "same length");
+  for (size_t i = 0; i < assemblers.size(); ++i)
+    if (!assemblers[i])
+      throw std::invalid_argument(
+          "PotentialOperatorHMatAssemblyHelper::"
+          "PotentialOperatorHMatAssemblyHelper(): "
+          "no elements of the 'assemblers' vector may be null");
+  m_componentCount = assemblers[0]->resultDimension();
+  for (size_t i = 1; i < assemblers.size(); ++i)
+    if (assemblers[i]->resultDimension() != m_componentCount)
+      throw std::invalid_argument(
+          "PotentialOperatorHMatAssemblyHelper::"
+          "PotentialOperatorHMatAssemblyHelper(): "
+          "all assemblers must produce results with the same number "
+          "of components");
+
+  const auto &p2o =
+      blockClusterTree->rowClusterTree()->hMatDofToOriginalDofMap();
+  m_p2oPoints.assign(p2o.begin(), p2o.end());
+  m_componentListsCache.reset(
+      new ComponentListsCache(m_p2oPoints, m_componentCount));
+  m_accessedEntryCount = 0;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+typename PotentialOperatorHMatAssemblyHelper<BasisFunctionType,
+                                             ResultType>::MagnitudeType
+PotentialOperatorHMatAssemblyHelper<BasisFunctionType, ResultType>::
+    estimateMinimumDistance(const hmat::DefaultBlockClusterTreeNodeType &
+                                blockClusterTreeNode) const {
+
+  return MagnitudeType(
+      blockClusterTreeNode.data()
+          .rowClusterTreeNode->data()
+          .boundingBox.distance(blockClusterTreeNode.data()
+                                    .columnClusterTreeNode->data()
+                                    .boundingBox));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void PotentialOperatorHMatAssemblyHelper<BasisFunctionType, ResultType>::
+    computeMatrixBlock(
+        const hmat::IndexRangeType &pointIndexRange,
+        const hmat::IndexRangeType &trialIndexRange,
+        const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
+        arma::Mat<ResultType> &data) const {
+
+  auto numberOfPointIndices = pointIndexRange[1] - pointIndexRange[0];
+  auto numberOfTrialIndices = trialIndexRange[1] - trialIndexRange[0];
+
+  m_accessedEntryCount += numberOfPointIndices * numberOfTrialIndices;
+
+  const CoordinateType minDist = estimateMinimumDistance(blockClusterTreeNode);
+
+  // Convert H-matrix indices into point and DOF indices
+  shared_ptr<const ComponentLists> componentLists =
+      m_componentListsCache->get(pointIndexRange[0], numberOfPointIndices);
+  const LocalDofLists<BasisFunctionType> &trialDofLists =
+      m_trialDofListsCache->get(trialIndexRange[0], numberOfTrialIndices);
+
+  // Necessary points
+  const std::vector<int> &pointIndices = componentLists->pointIndices;
+  // Necessary components at each point
+  const std::vector<std::vector<int>> &componentIndices =
+      componentLists->componentIndices;
+  // Necessary elements
+  const std::vector<int> &trialElementIndices = trialDofLists.elementIndices;
+  // Ranges of the local dofs of each element in the arrays below
+  const std::vector<int> &trialOffsets = trialDofLists.elementOffsets;
+  const std::vector<LocalDofIndex> &trialLocalDofs =
+      trialDofLists.localDofIndices;
+  // Weights of local dofs in each element
+  const std::vector<BasisFunctionType> &trialLocalDofWeights =
+      trialDofLists.localDofWeights;
+  // Corresponding row and column indices in the matrix to be calculated
+  const std::vector<std::vector<int>> &blockRows = componentLists->arrayIndices;
+  const std::vector<int> &blockCols = trialDofLists.arrayIndices;
+
+  data.zeros(numberOfPointIndices, numberOfTrialIndices);
+
+  if (numberOfTrialIndices == 1) {
+    // Only one column of the block needed. This means that we need only
+    // one local DOF from just one or a few trial elements. Evaluate the
+    // local potential operator for one local trial DOF at a time.
+
+    // indices: vector: point index; matrix: component, dof
+    std::vector<arma::Mat<ResultType>> localResult;
+    for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
+         ++nTrialElem) {
+      const int activeTrialElementIndex = trialElementIndices[nTrialElem];
+      for (int nTrialDof = trialOffsets[nTrialElem];
+           nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof) {
+        LocalDofIndex activeTrialLocalDof = trialLocalDofs[nTrialDof];
+        BasisFunctionType activeTrialLocalDofWeight =
+            trialLocalDofWeights[nTrialDof];
+        for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
+          m_assemblers[nTerm]->evaluateLocalContributions(
+              pointIndices, activeTrialElementIndex, activeTrialLocalDof,
+              localResult, minDist);
+          for (size_t nPoint = 0; nPoint < pointIndices.size(); ++nPoint)
+            for (size_t nComponent = 0;
+                 nComponent < componentIndices[nPoint].size(); ++nComponent)
+              data(blockRows[nPoint][nComponent], 0) +=
+                  m_termMultipliers[nTerm] * activeTrialLocalDofWeight *
+                  localResult[nPoint](componentIndices[nPoint][nComponent], 0);
+        }
+      }
+    }
+  } else if (numberOfPointIndices == 1) {
+    // Only one row of the block needed. This means that we need to
+    // evaluate a single component of the local potential operator at
+    // a single point.
+
+    // indices: vector: trial element; matrix: component, dof
+    std::vector<arma::Mat<ResultType>> localResult;
+    for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
+      m_assemblers[nTerm]->evaluateLocalContributions(
+          pointIndices[0], componentIndices[0][0], trialElementIndices,
+          localResult, minDist);
+      for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
+           ++nTrialElem)
+        for (int nTrialDof = trialOffsets[nTrialElem];
+             nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+          data(0, blockCols[nTrialDof]) +=
+              m_termMultipliers[nTerm] *
+              trialLocalDofWeights[nTrialDof] *
+              localResult[nTrialElem](0, trialLocalDofs[nTrialDof]);
+    }
+  } else { // a "fat" block
+    // Evaluate the local potential operator for each pair of points and
+    // trial elements and then select the entries that we need.
+
+    Fiber::_2dArray<arma::Mat<ResultType>> localResult;
+    for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
+      m_assemblers[nTerm]->evaluateLocalContributions(
+          pointIndices, trialElementIndices, localResult, minDist);
+      for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
+           ++nTrialElem)
+        for (int nTrialDof = trialOffsets[nTrialElem];
+             nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+          for (size_t nPoint = 0; nPoint < pointIndices.size(); ++nPoint)
+            for (size_t nComponent = 0;
+                 nComponent < componentIndices[nPoint].size(); ++nComponent)
+              data(blockRows[nPoint][nComponent],
+                   blockCols[nTrialDof]) +=
+                  m_termMultipliers[nTerm] *
+                  trialLocalDofWeights[nTrialDof] *
+                  localResult(nPoint, nTrialElem)(
+                      componentIndices[nPoint][nComponent],
+                      trialLocalDofs[nTrialDof]);
+    }
+  }
+}
+
+template <typename BasisFunctionType, typename ResultType>
+size_t PotentialOperatorHMatAssemblyHelper<
+    BasisFunctionType, ResultType>::accessedEntryCount() const {
+  return m_accessedEntryCount;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
+    PotentialOperatorHMatAssemblyHelper);
+
+} // namespace Bempp
@@ -20,6 +20,7 @@
 
 #include "scaled_abstract_boundary_operator.hpp"
 
+#include "composite_boundary_operator_id.hpp"
 #include "context.hpp"
 #include "scaled_discrete_boundary_operator.hpp"
 
@@ -69,6 +70,18 @@ ScaledAbstractBoundaryOperator<BasisFunctionType, ResultType>::isLocal() const {
   return m_multiplicand.abstractOperator()->isLocal();
 }
 
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const AbstractBoundaryOperatorId>
+ScaledAbstractBoundaryOperator<BasisFunctionType, ResultType>::id() const {
+  std::vector<shared_ptr<const AbstractBoundaryOperatorId>> operands(
+      1, m_multiplicand.abstractOperator()->id());
+  std::vector<const void *> contexts(1, m_multiplicand.context().get());
+  std::vector<std::complex<double>> weights(
+      1, std::complex<double>(realPart(m_multiplier), imagPart(m_multiplier)));
+  return CompositeBoundaryOperatorId::create("scaled", operands, contexts,
+                                             weights);
+}
+
 template <typename BasisFunctionType_, typename ResultType_>
 ResultType_
 ScaledAbstractBoundaryOperator<BasisFunctionType_, ResultType_>::multiplier()
@@ -67,6 +67,11 @@ public:
 
   virtual bool isLocal() const;
 
+  /** \brief Return an identifier combining the multiplier and the identifier
+   *  of the multiplicand, or a null pointer if the multiplicand has none;
+   *  see CompositeBoundaryOperatorId. */
+  virtual shared_ptr<const AbstractBoundaryOperatorId> id() const;
+
   ResultType_ multiplier() const;
   BoundaryOperator<BasisFunctionType_, ResultType_> multiplicand() const;
 
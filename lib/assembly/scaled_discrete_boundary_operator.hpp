@@ -55,6 +55,12 @@ public:
   ScaledDiscreteBoundaryOperator(ValueType multiplier,
                                  const shared_ptr<const Base> &op);
 
+  /** \brief Return the scalar multiplier \f$\alpha\f$. */
+  ValueType multiplier() const { return m_multiplier; }
+
+  /** \brief Return the operator \f$L\f$ being scaled. */
+  shared_ptr<const Base> scaledOperator() const { return m_operator; }
+
   virtual arma::Mat<ValueType> asMatrix() const;
 
   virtual unsigned int rowCount() const;
@@ -85,6 +91,11 @@ private:
                                 arma::Col<ValueType> &y_inout,
                                 const ValueType alpha,
                                 const ValueType beta) const;
+  virtual void applyBuiltInBlockImpl(const TranspositionMode trans,
+                                     const arma::Mat<ValueType> &x_in,
+                                     arma::Mat<ValueType> &y_inout,
+                                     const ValueType alpha,
+                                     const ValueType beta) const;
 
 private:
   ValueType m_multiplier;
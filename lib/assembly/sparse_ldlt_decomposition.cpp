@@ -0,0 +1,320 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "sparse_ldlt_decomposition.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/scalar_traits.hpp"
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <numeric>
+#include <stdexcept>
+
+#ifdef WITH_TRILINOS
+#include <Epetra_CrsMatrix.h>
+#endif
+
+namespace Bempp {
+
+namespace {
+
+// Return the reverse Cuthill-McKee ordering of the graph of a symmetric
+// matrix: order[k] is the index of the node placed at position k
+std::vector<int> reverseCuthillMcKee(int size, const int *rowOffsets,
+                                     const int *colIndices) {
+  std::vector<int> degree(size);
+  for (int r = 0; r < size; ++r)
+    degree[r] = rowOffsets[r + 1] - rowOffsets[r];
+  auto byDegree = [&degree](int a, int b) {
+    return degree[a] < degree[b] || (degree[a] == degree[b] && a < b);
+  };
+
+  // Each connected component is traversed breadth-first, starting from its
+  // node of minimum degree and visiting neighbours in order of degree
+  std::vector<int> startNodes(size);
+  std::iota(startNodes.begin(), startNodes.end(), 0);
+  std::sort(startNodes.begin(), startNodes.end(), byDegree);
+
+  std::vector<int> order;
+  order.reserve(size);
+  std::vector<char> visited(size, false);
+  for (int s = 0; s < size; ++s) {
+    const int start = startNodes[s];
+    if (visited[start])
+      continue;
+    visited[start] = true;
+    order.push_back(start);
+    for (size_t head = order.size() - 1; head < order.size(); ++head) {
+      const int node = order[head];
+      const size_t firstNeighbour = order.size();
+      for (int p = rowOffsets[node]; p < rowOffsets[node + 1]; ++p) {
+        const int neighbour = colIndices[p];
+        if (!visited[neighbour]) {
+          visited[neighbour] = true;
+          order.push_back(neighbour);
+        }
+      }
+      std::sort(order.begin() + firstNeighbour, order.end(), byDegree);
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+} // namespace
+
+SparseLdltDecomposition::SparseLdltDecomposition(int size,
+                                                 const int *rowOffsets,
+                                                 const int *colIndices,
+                                                 const double *values)
+    : m_size(size) {
+  if (size < 0)
+    throw std::invalid_argument("SparseLdltDecomposition::"
+                                "SparseLdltDecomposition(): "
+                                "size must not be negative");
+  factorize(rowOffsets, colIndices, values);
+}
+
+#ifdef WITH_TRILINOS
+SparseLdltDecomposition::SparseLdltDecomposition(const Epetra_CrsMatrix &mat)
+    : m_size(mat.NumGlobalRows()) {
+  if (mat.NumGlobalRows() != mat.NumGlobalCols())
+    throw std::invalid_argument("SparseLdltDecomposition::"
+                                "SparseLdltDecomposition(): "
+                                "matrix must be square");
+  int *rowOffsets = 0;
+  int *colIndices = 0;
+  double *values = 0;
+  mat.ExtractCrsDataPointers(rowOffsets, colIndices, values);
+  factorize(rowOffsets, colIndices, values);
+}
+#endif
+
+void SparseLdltDecomposition::factorize(const int *rowOffsets,
+                                        const int *colIndices,
+                                        const double *values) {
+  const int n = m_size;
+  m_permutation = reverseCuthillMcKee(n, rowOffsets, colIndices);
+  std::vector<int> inversePermutation(n);
+  for (int k = 0; k < n; ++k)
+    inversePermutation[m_permutation[k]] = k;
+
+  // Lower triangle of B = P A P^T, stored both by rows (without the
+  // diagonal) and by columns (with the diagonal)
+  std::vector<size_t> bRowOffsets(n + 1, 0), bColOffsets(n + 1, 0);
+  for (int r = 0; r < n; ++r)
+    for (int p = rowOffsets[r]; p < rowOffsets[r + 1]; ++p) {
+      const int i = inversePermutation[r];
+      const int j = inversePermutation[colIndices[p]];
+      if (j < i)
+        ++bRowOffsets[i + 1];
+      if (j <= i)
+        ++bColOffsets[j + 1];
+    }
+  std::partial_sum(bRowOffsets.begin(), bRowOffsets.end(),
+                   bRowOffsets.begin());
+  std::partial_sum(bColOffsets.begin(), bColOffsets.end(),
+                   bColOffsets.begin());
+  std::vector<int> bRowCols(bRowOffsets[n]);
+  std::vector<int> bColRows(bColOffsets[n]);
+  std::vector<double> bColValues(bColOffsets[n]);
+  {
+    std::vector<size_t> rowFill(bRowOffsets.begin(), bRowOffsets.end() - 1);
+    std::vector<size_t> colFill(bColOffsets.begin(), bColOffsets.end() - 1);
+    for (int r = 0; r < n; ++r)
+      for (int p = rowOffsets[r]; p < rowOffsets[r + 1]; ++p) {
+        const int i = inversePermutation[r];
+        const int j = inversePermutation[colIndices[p]];
+        if (j < i)
+          bRowCols[rowFill[i]++] = j;
+        if (j <= i) {
+          bColRows[colFill[j]] = i;
+          bColValues[colFill[j]++] = values[p];
+        }
+      }
+  }
+
+  // Elimination tree (Liu's algorithm with path compression)
+  std::vector<int> parent(n, -1), ancestor(n, -1);
+  for (int i = 0; i < n; ++i)
+    for (size_t p = bRowOffsets[i]; p < bRowOffsets[i + 1]; ++p)
+      for (int node = bRowCols[p]; node != -1 && node < i;) {
+        const int next = ancestor[node];
+        ancestor[node] = i;
+        if (next == -1)
+          parent[node] = i;
+        node = next;
+      }
+
+  // Nonzero pattern of each row of L, obtained by traversing the row
+  // subtrees of the elimination tree
+  std::vector<size_t> lRowOffsets(n + 1, 0);
+  std::vector<int> lRowCols;
+  std::vector<size_t> lColCounts(n, 0);
+  {
+    std::vector<int> flag(n, -1);
+    for (int i = 0; i < n; ++i) {
+      flag[i] = i;
+      for (size_t p = bRowOffsets[i]; p < bRowOffsets[i + 1]; ++p)
+        for (int node = bRowCols[p]; flag[node] != i; node = parent[node]) {
+          lRowCols.push_back(node);
+          ++lColCounts[node];
+          flag[node] = i;
+        }
+      lRowOffsets[i + 1] = lRowCols.size();
+    }
+  }
+
+  // Nonzero pattern of the columns of L; lRowPositions[e] is the position
+  // in m_factorRows of the element given by lRowCols[e]
+  m_factorColOffsets.assign(n + 1, 0);
+  std::partial_sum(lColCounts.begin(), lColCounts.end(),
+                   m_factorColOffsets.begin() + 1);
+  m_factorRows.resize(m_factorColOffsets[n]);
+  std::vector<size_t> lRowPositions(lRowCols.size());
+  {
+    std::vector<size_t> colFill(m_factorColOffsets.begin(),
+                                m_factorColOffsets.end() - 1);
+    for (int i = 0; i < n; ++i)
+      for (size_t e = lRowOffsets[i]; e < lRowOffsets[i + 1]; ++e) {
+        const size_t p = colFill[lRowCols[e]]++;
+        m_factorRows[p] = i;
+        lRowPositions[e] = p;
+      }
+  }
+
+  // Column j only depends on its descendants in the elimination tree, so
+  // the columns at the same height of the tree can be computed in parallel
+  std::vector<int> level(n, 0);
+  int levelCount = n > 0 ? 1 : 0;
+  for (int j = 0; j < n; ++j)
+    if (parent[j] != -1) {
+      level[parent[j]] = std::max(level[parent[j]], level[j] + 1);
+      levelCount = std::max(levelCount, level[parent[j]] + 1);
+    }
+  std::vector<size_t> levelOffsets(levelCount + 1, 0);
+  for (int j = 0; j < n; ++j)
+    ++levelOffsets[level[j] + 1];
+  std::partial_sum(levelOffsets.begin(), levelOffsets.end(),
+                   levelOffsets.begin());
+  std::vector<int> columnsByLevel(n);
+  {
+    std::vector<size_t> levelFill(levelOffsets.begin(),
+                                  levelOffsets.end() - 1);
+    for (int j = 0; j < n; ++j)
+      columnsByLevel[levelFill[level[j]]++] = j;
+  }
+
+  // Left-looking numeric factorization
+  m_factorValues.assign(m_factorRows.size(), 0.);
+  m_diagonal.assign(n, 0.);
+  tbb::enumerable_thread_specific<std::vector<double>> workspaces(
+      std::vector<double>(n, 0.));
+  std::atomic<bool> zeroPivot(false);
+  for (int l = 0; l < levelCount; ++l)
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(levelOffsets[l], levelOffsets[l + 1]),
+        [&](const tbb::blocked_range<size_t> &r) {
+      std::vector<double> &x = workspaces.local();
+      for (size_t c = r.begin(); c != r.end(); ++c) {
+        const int j = columnsByLevel[c];
+        // x = B(j:n, j) - sum_k L(j:n, k) D(k) L(j, k)
+        for (size_t p = bColOffsets[j]; p < bColOffsets[j + 1]; ++p)
+          x[bColRows[p]] += bColValues[p];
+        for (size_t e = lRowOffsets[j]; e < lRowOffsets[j + 1]; ++e) {
+          const int k = lRowCols[e];
+          const size_t p = lRowPositions[e];
+          const double factor = m_factorValues[p] * m_diagonal[k];
+          x[j] -= m_factorValues[p] * factor;
+          for (size_t q = p + 1; q < m_factorColOffsets[k + 1]; ++q)
+            x[m_factorRows[q]] -= m_factorValues[q] * factor;
+        }
+        const double pivot = x[j];
+        x[j] = 0.;
+        if (pivot == 0.)
+          zeroPivot = true;
+        m_diagonal[j] = pivot;
+        for (size_t q = m_factorColOffsets[j]; q < m_factorColOffsets[j + 1];
+             ++q) {
+          double &value = x[m_factorRows[q]];
+          m_factorValues[q] = pivot == 0. ? 0. : value / pivot;
+          value = 0.;
+        }
+      }
+    });
+  if (zeroPivot)
+    throw std::runtime_error("SparseLdltDecomposition::"
+                             "SparseLdltDecomposition(): "
+                             "zero pivot encountered, the matrix is singular "
+                             "or not positive definite");
+}
+
+template <typename ValueType>
+void SparseLdltDecomposition::solve(arma::Mat<ValueType> &x) const {
+  typedef typename Fiber::ScalarTraits<ValueType>::RealType RealType;
+
+  if (x.n_rows != static_cast<size_t>(m_size))
+    throw std::invalid_argument("SparseLdltDecomposition::solve(): "
+                                "incorrect number of rows of the "
+                                "right-hand side");
+  const int n = m_size;
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, x.n_cols),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    std::vector<ValueType> y(n);
+    for (size_t c = r.begin(); c != r.end(); ++c) {
+      ValueType *column = x.colptr(c);
+      for (int k = 0; k < n; ++k)
+        y[k] = column[m_permutation[k]];
+      // L z = P x
+      for (int j = 0; j < n; ++j) {
+        const ValueType yj = y[j];
+        for (size_t q = m_factorColOffsets[j]; q < m_factorColOffsets[j + 1];
+             ++q)
+          y[m_factorRows[q]] -= static_cast<RealType>(m_factorValues[q]) * yj;
+      }
+      for (int j = 0; j < n; ++j)
+        y[j] /= static_cast<RealType>(m_diagonal[j]);
+      // L^T (P y) = D^{-1} z
+      for (int j = n - 1; j >= 0; --j) {
+        ValueType sum = y[j];
+        for (size_t q = m_factorColOffsets[j]; q < m_factorColOffsets[j + 1];
+             ++q)
+          sum -= static_cast<RealType>(m_factorValues[q]) * y[m_factorRows[q]];
+        y[j] = sum;
+      }
+      for (int k = 0; k < n; ++k)
+        column[m_permutation[k]] = y[k];
+    }
+  });
+}
+
+template void SparseLdltDecomposition::solve(arma::Mat<float> &x) const;
+template void SparseLdltDecomposition::solve(arma::Mat<double> &x) const;
+template void
+SparseLdltDecomposition::solve(arma::Mat<std::complex<float>> &x) const;
+template void
+SparseLdltDecomposition::solve(arma::Mat<std::complex<double>> &x) const;
+
+} // namespace Bempp
@@ -0,0 +1,91 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_sparse_ldlt_decomposition_hpp
+#define bempp_sparse_ldlt_decomposition_hpp
+
+#include "../common/common.hpp"
+#include "../common/armadillo_fwd.hpp"
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include <vector>
+
+/** \cond FORWARD_DECL */
+class Epetra_CrsMatrix;
+/** \endcond */
+
+namespace Bempp {
+
+/** \ingroup discrete_boundary_operators
+ *  \brief Sparse LDL^T decomposition of a symmetric matrix.
+
+  The matrix is symmetrically permuted by the reverse Cuthill-McKee ordering
+  to reduce the fill-in and decomposed as
+
+  \f[ P A P^T = L D L^T, \f]
+
+  where \f$L\f$ is unit lower triangular and \f$D\f$ diagonal. No pivoting
+  is done, so the matrix should be positive definite, like the Gram matrix
+  of a pair of identical spaces.
+
+  The columns of \f$L\f$ are computed in parallel, level by level of the
+  elimination tree; the right-hand sides passed to solve() are processed in
+  parallel, too. */
+class SparseLdltDecomposition {
+public:
+  /** \brief Decompose a matrix stored in the compressed sparse row format.
+
+    Both triangles of the matrix must be stored; only the lower one is used.
+    The column indices of each row need not be sorted. */
+  SparseLdltDecomposition(int size, const int *rowOffsets,
+                          const int *colIndices, const double *values);
+
+#ifdef WITH_TRILINOS
+  /** \brief Decompose a serial Epetra matrix. */
+  explicit SparseLdltDecomposition(const Epetra_CrsMatrix &mat);
+#endif
+
+  /** \brief Order of the decomposed matrix. */
+  int size() const { return m_size; }
+
+  /** \brief Number of nonzero off-diagonal elements of L. */
+  size_t factorNonzeroCount() const { return m_factorRows.size(); }
+
+  /** \brief Overwrite each column of \p x with the solution of A y = x. */
+  template <typename ValueType> void solve(arma::Mat<ValueType> &x) const;
+
+private:
+  void factorize(const int *rowOffsets, const int *colIndices,
+                 const double *values);
+
+  int m_size;
+  // P A P^T (i, j) = A(m_permutation[i], m_permutation[j])
+  std::vector<int> m_permutation;
+  // Strictly lower triangle of L in the compressed sparse column format
+  std::vector<size_t> m_factorColOffsets;
+  std::vector<int> m_factorRows;
+  std::vector<double> m_factorValues;
+  std::vector<double> m_diagonal;
+};
+
+} // namespace Bempp
+
+#endif
@@ -25,106 +25,95 @@
 #include "sparse_to_h_matrix_converter.hpp"
 
 #include "ahmed_aux.hpp"
+#include "ahmed_leaf_cluster_array.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 
-namespace {
-
-// Adapted from AHMED
-void copyH(unsigned n, mblock<double> **A, mblock<dcomp> **B) {
-  for (unsigned i = 0; i < n; ++i) {
-    assert(A[i]);
-    delete B[i];
-    B[i] = new mblock<dcomp>(A[i]->getn1(), A[i]->getn2());
-    assert(B[i]);
+#include <tbb/parallel_for.h>
 
-    if (A[i]->isLrM()) {
-      const unsigned k = A[i]->rank();
-      B[i]->setrank(k);
-    } else { // mbl is dense
-      assert(A[i]->isGeM());
-      if (A[i]->isHeM())
-        B[i]->setHeM();
-      else if (A[i]->isLtM())
-        B[i]->setLtM();
-      else if (A[i]->isUtM())
-        B[i]->setUtM();
-      else
-        B[i]->setGeM();
-    }
-    for (unsigned int j = 0; j < A[i]->nvals(); ++j)
-      B[i]->getdata()[j] = A[i]->getdata()[j];
-  }
-}
+namespace Bempp {
 
-// Adapted from AHMED
-void copyH(unsigned n, mblock<double> **A, mblock<scomp> **B) {
-  for (unsigned i = 0; i < n; ++i) {
-    assert(A[i]);
-    delete B[i];
-    B[i] = new mblock<scomp>(A[i]->getn1(), A[i]->getn2());
-    assert(B[i]);
+namespace {
 
-    if (A[i]->isLrM()) {
-      const unsigned k = A[i]->rank();
-      B[i]->setrank(k);
-    } else { // mbl is dense
-      assert(A[i]->isGeM());
-      if (A[i]->isHeM())
-        B[i]->setHeM();
-      else if (A[i]->isLtM())
-        B[i]->setLtM();
-      else if (A[i]->isUtM())
-        B[i]->setUtM();
-      else
-        B[i]->setGeM();
+// Gather the entries of a CRS matrix lying in the (permuted) leaf block bc
+// into a dense column-major array of bc->getn1() x bc->getn2() entries.
+// Returns false if the block contains no entries.
+bool gatherBlockEntries(const blcluster *bc, const int *rowOffsets,
+                        const int *colIndices, const double *values,
+                        const std::vector<unsigned int> &domain_o2p,
+                        const std::vector<unsigned int> &range_p2o,
+                        std::vector<double> &dense) {
+  const unsigned b1 = bc->getb1(), n1 = bc->getn1();
+  const unsigned b2 = bc->getb2(), n2 = bc->getn2();
+  bool empty = true;
+  for (unsigned i = 0; i < n1; ++i) {
+    const unsigned row = range_p2o[b1 + i];
+    for (int k = rowOffsets[row]; k < rowOffsets[row + 1]; ++k) {
+      const unsigned col = domain_o2p[colIndices[k]];
+      if (col < b2 || col >= b2 + n2)
+        continue;
+      if (empty) {
+        dense.assign(size_t(n1) * n2, 0.);
+        empty = false;
+      }
+      dense[i + size_t(col - b2) * n1] += values[k];
     }
-    for (unsigned int j = 0; j < A[i]->nvals(); ++j)
-      B[i]->getdata()[j] = A[i]->getdata()[j];
   }
+  return !empty;
 }
 
 } // namespace
 
-namespace Bempp {
-
-// Convert an array of mblock<FromType> objects (in) to an array of
-// mblock<ToType> objects (out).
-template <typename FromType, typename ToType> struct MblockArrayConverter {
-  static void convert(unsigned int n,
-                      const boost::shared_array<mblock<FromType> *> &in,
-                      boost::shared_array<mblock<ToType> *> &out) {
-    out = allocateAhmedMblockArray<ToType>(n);
-    copyH(n, in.get(), out.get());
-  }
-};
-
-template <typename Type> struct MblockArrayConverter<Type, Type> {
-  static void convert(unsigned int n,
-                      const boost::shared_array<mblock<Type> *> &in,
-                      boost::shared_array<mblock<Type> *> &out) {
-    out = in;
-  }
-};
-
 template <typename ValueType>
 void SparseToHMatrixConverter<ValueType>::constructHMatrix(
     int *rowOffsets, int *colIndices, double *values,
     std::vector<unsigned int> &domain_o2p, std::vector<unsigned int> &range_p2o,
     double eps, bbxbemblcluster<AhmedDofType, AhmedDofType> *blockCluster,
     boost::shared_array<AhmedMblock *> &mblocks, int &maximumRank) {
-  typedef mblock<AhmedTypeTraits<double>::Type> AhmedDoubleMblock;
-  AhmedDoubleMblock **rawDoubleMblocks = 0;
-  const unsigned int blockCount = blockCluster->nleaves();
-  convCRS_toGeH(
-      values, reinterpret_cast<unsigned int *>(colIndices), // int* -> uint*
-      reinterpret_cast<unsigned int *>(rowOffsets),         // int* -> uint*
-      &domain_o2p[0], &range_p2o[0], eps, blockCluster, rawDoubleMblocks);
-  boost::shared_array<AhmedDoubleMblock *> doubleMblocks(
-      (rawDoubleMblocks), (AhmedMblockArrayDeleter(blockCount)));
-  MblockArrayConverter<
-      double, typename AhmedTypeTraits<ValueType>::Type>::convert(blockCount,
-                                                                  doubleMblocks,
-                                                                  mblocks);
+  typedef typename AhmedTypeTraits<ValueType>::Type AhmedValueType;
+
+  AhmedLeafClusterArray leafClusters(blockCluster);
+  mblocks = allocateAhmedMblockArray<ValueType>(blockCluster);
+
+  // Each leaf only reads the rows of the CRS arrays falling into its row
+  // cluster and writes its own mblock, so the leaves are converted
+  // concurrently
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, leafClusters.size()),
+      [&](const tbb::blocked_range<size_t> &r) {
+        std::vector<double> dense;
+        std::vector<AhmedValueType> U, V;
+        for (size_t l = r.begin(); l != r.end(); ++l) {
+          const blcluster *bc = leafClusters[l];
+          const unsigned n1 = bc->getn1(), n2 = bc->getn2();
+          AhmedMblock *&block = mblocks[bc->getidx()];
+          block = new AhmedMblock(n1, n2);
+          const bool nonzero =
+              gatherBlockEntries(bc, rowOffsets, colIndices, values,
+                                 domain_o2p, range_p2o, dense);
+          if (!nonzero) {
+            if (bc->isadm())
+              block->setrank(0);
+            else
+              block->init0_GeM(n1, n2);
+          } else if (!bc->isadm()) {
+            block->init0_GeM(n1, n2);
+            AhmedValueType *data = block->getdata();
+            for (size_t j = 0; j < dense.size(); ++j)
+              data[j] = dense[j];
+          } else {
+            // Write the block as the product of itself and the identity
+            // and let AHMED compress it
+            U.resize(dense.size());
+            for (size_t j = 0; j < dense.size(); ++j)
+              U[j] = dense[j];
+            V.resize(size_t(n2) * n2);
+            for (size_t j = 0; j < V.size(); ++j)
+              V[j] = (j % (n2 + 1) == 0) ? 1. : 0.;
+            block->cpyLrM_cmpr(n2, &U[0], n1, &V[0], n2, eps, n2);
+          }
+        }
+      });
+
   maximumRank = Hmax_rank(blockCluster, mblocks.get());
 }
 
@@ -59,6 +59,18 @@ using Fiber::SurfaceNormalAndDomainIndexDependentFunction;
                     const arma::Col<CoordinateType>& normal,
                     int domainIndex,
                     arma::Col<ValueType>& result) const;
+
+      // (Optional)
+      // Evaluate the function at all points (columns of "points", with
+      // normals in the columns of "normals") at once and store the values in
+      // the columns of "result", which will be preinitialised to correct
+      // dimensions. If this function is defined, it is called instead of
+      // evaluate(), which may then be omitted. The points may come from
+      // several elements of the same domain.
+      void evaluateAtPoints(const arma::Mat<CoordinateType>& points,
+                            const arma::Mat<CoordinateType>& normals,
+                            int domainIndex,
+                            arma::Mat<ValueType>& result) const;
   };
   \endcode
 
@@ -57,6 +57,17 @@ using Fiber::SurfaceNormalDependentFunction;
       void evaluate(const arma::Col<CoordinateType>& point,
                     const arma::Col<CoordinateType>& normal,
                     arma::Col<ValueType>& result) const;
+
+      // (Optional)
+      // Evaluate the function at all points (columns of "points", with
+      // normals in the columns of "normals") at once and store the values in
+      // the columns of "result", which will be preinitialised to correct
+      // dimensions. If this function is defined, it is called instead of
+      // evaluate(), which may then be omitted. The points may come from
+      // several elements.
+      void evaluateAtPoints(const arma::Mat<CoordinateType>& points,
+                            const arma::Mat<CoordinateType>& normals,
+                            arma::Mat<ValueType>& result) const;
   };
   \endcode
 
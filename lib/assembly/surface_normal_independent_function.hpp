@@ -57,6 +57,15 @@ using Fiber::SurfaceNormalIndependentFunction;
       // preinitialized to correct dimensions.
       void evaluate(const arma::Col<CoordinateType>& point,
                     arma::Col<ValueType>& result) const;
+
+      // (Optional)
+      // Evaluate the function at all points (columns of "points") at once
+      // and store the values in the columns of "result", which will be
+      // preinitialised to correct dimensions. If this function is defined,
+      // it is called instead of evaluate(), which may then be omitted.
+      // The points may come from several elements.
+      void evaluateAtPoints(const arma::Mat<CoordinateType>& points,
+                            arma::Mat<ValueType>& result) const;
   };
   \endcode
 
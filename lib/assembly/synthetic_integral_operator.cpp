@@ -27,6 +27,7 @@
 #include "context.hpp"
 #include "discrete_boundary_operator.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
+#include "discrete_synthetic_boundary_operator.hpp"
 #include "identity_operator.hpp"
 #include "sparse_inverse.hpp"
 #include "transposed_discrete_boundary_operator.hpp"
@@ -415,29 +416,11 @@ SyntheticIntegralOperator<BasisFunctionType, ResultType>::assembleWeakFormImpl(
     discreteTrialLocalOps =
         coalesceTrialOperators(discreteTrialLocalOps, trialInverse);
 
-  // Now join all the pieces together
-  shared_ptr<DiscreteLinOp> result;
-  if (discreteTestLocalOps.empty()) {
-    result = mul<ResultType>(discreteIntegralOp, discreteTrialLocalOps[0]);
-    for (size_t i = 1; i < discreteTestLocalOps.size(); ++i)
-      result =
-          sum<ResultType>(result, mul<ResultType>(discreteIntegralOp,
-                                                  discreteTrialLocalOps[i]));
-  } else if (discreteTrialLocalOps.empty()) {
-    result = mul<ResultType>(discreteTestLocalOps[0], discreteIntegralOp);
-    for (size_t i = 1; i < discreteTestLocalOps.size(); ++i)
-      result = sum<ResultType>(
-          result, mul<ResultType>(discreteTestLocalOps[i], discreteIntegralOp));
-  } else {
-    result = mul<ResultType>(
-        mul<ResultType>(discreteTestLocalOps[0], discreteIntegralOp),
-        discreteTrialLocalOps[0]);
-    for (size_t i = 1; i < discreteTestLocalOps.size(); ++i)
-      result = sum<ResultType>(
-          result, mul<ResultType>(mul<ResultType>(discreteTestLocalOps[i],
-                                                  discreteIntegralOp),
-                                  discreteTrialLocalOps[i]));
-  }
+  // Now join all the pieces together. The integral operator is applied to
+  // the vectors of all terms at once.
+  shared_ptr<DiscreteLinOp> result(
+      new DiscreteSyntheticBoundaryOperator<ResultType>(
+          discreteTestLocalOps, discreteIntegralOp, discreteTrialLocalOps));
 
   tbb::tick_count end = tbb::tick_count::now();
 
@@ -457,10 +440,16 @@ void SyntheticIntegralOperator<BasisFunctionType, ResultType>::
   typedef Context<BasisFunctionType, ResultType> Ctx;
   AssemblyOptions assemblyOptions = context->assemblyOptions();
   AcaOptions acaOptions = assemblyOptions.acaOptions();
+  bool localAcaMode = assemblyOptions.assemblyMode() == AssemblyOptions::ACA &&
+                      acaOptions.mode == AcaOptions::LOCAL_ASSEMBLY;
   acaOptions.mode = AcaOptions::GLOBAL_ASSEMBLY;
   if (assemblyOptions.assemblyMode() == AssemblyOptions::ACA)
     assemblyOptions.switchToAcaMode(acaOptions);
-  internalContext.reset(new Ctx(context->quadStrategy(), assemblyOptions));
+  if (assemblyOptions.isBarycentricOperatorReuseEnabled() && !localAcaMode)
+    // Internal operators are looked up in the weak-form cache of context
+    internalContext = context;
+  else
+    internalContext.reset(new Ctx(context->quadStrategy(), assemblyOptions));
   auxContext = internalContext;
   if (assemblyOptions.verbosityLevel() < VerbosityLevel::HIGH) {
     // Suppress timing messages from auxiliary operators
@@ -154,7 +154,11 @@ public:
   virtual bool isLocal() const;
 
   /** \brief Get contexts appropriate for construction of internal integral
-      operators and auxiliary local operators. */
+      operators and auxiliary local operators.
+
+      If AssemblyOptions::enableBarycentricOperatorReuse() is set and \p
+      context is not in the local ACA mode, \p internalContext is \p context
+      itself, so that internal operators share its weak-form cache. */
   static void getContextsForInternalAndAuxiliaryOperators(
       const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
       shared_ptr<const Context<BasisFunctionType, ResultType>> &internalContext,
@@ -20,9 +20,13 @@
 
 #include "synthetic_nonhypersingular_integral_operator_builder.hpp"
 
+#include "context.hpp"
+#include "discontinuous_space_cache.hpp"
 #include "general_elementary_local_operator_imp.hpp"
 #include "synthetic_integral_operator.hpp"
 
+#include "../space/space.hpp"
+
 #include "../fiber/explicit_instantiation.hpp"
 
 #include "../fiber/scalar_function_value_functor.hpp"
@@ -103,6 +107,32 @@ syntheticNonhypersingularIntegralOperator(
                      testLocalOps, internalOp, trialLocalOps, label, symmetry));
 }
 
+template <typename BasisFunctionType>
+bool shouldReuseBarycentricOperator(
+    const AssemblyOptions &assemblyOptions,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange) {
+  return assemblyOptions.isBarycentricOperatorReuseEnabled() && domain &&
+         dualToRange &&
+         (domain->isBarycentric() || dualToRange->isBarycentric()) &&
+         !(domain->isDiscontinuous() && dualToRange->isDiscontinuous());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType>> internalDiscontinuousSpace(
+    const Context<BasisFunctionType, ResultType> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space) {
+  if (context.assemblyOptions().isBarycentricOperatorReuseEnabled())
+    return context.discontinuousSpaceCache()->discontinuousSpace(space);
+  return space->discontinuousSpace(space);
+}
+
+#define INSTANTIATE_REUSE_FUNCTION(BASIS)                                      \
+  template bool shouldReuseBarycentricOperator(                                \
+      const AssemblyOptions &, const shared_ptr<const Space<BASIS>> &,         \
+      const shared_ptr<const Space<BASIS>> &)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_REUSE_FUNCTION);
+
 #define INSTANTIATE_FUNCTION(BASIS, RESULT)                                    \
   template BoundaryOperator<BASIS, RESULT>                                     \
   syntheticNonhypersingularIntegralOperator(                                   \
@@ -111,7 +141,9 @@ syntheticNonhypersingularIntegralOperator(
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
       const shared_ptr<const Space<BASIS>> &,                                  \
-      const shared_ptr<const Space<BASIS>> &, std::string, int)
+      const shared_ptr<const Space<BASIS>> &, std::string, int);               \
+  template shared_ptr<const Space<BASIS>> internalDiscontinuousSpace(          \
+      const Context<BASIS, RESULT> &, const shared_ptr<const Space<BASIS>> &)
 FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_FUNCTION);
 
 } // namespace Bempp
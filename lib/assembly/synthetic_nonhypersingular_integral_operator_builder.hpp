@@ -9,9 +9,11 @@
 
 namespace Bempp {
 
+class AssemblyOptions;
 template <typename BasisFunctionType> class Space;
 template <typename BasisFunctionType, typename ResultType>
 class BoundaryOperator;
+template <typename BasisFunctionType, typename ResultType> class Context;
 
 template <typename BasisFunctionType, typename ResultType>
 BoundaryOperator<BasisFunctionType, ResultType>
@@ -24,6 +26,31 @@ syntheticNonhypersingularIntegralOperator(
     const shared_ptr<const Space<BasisFunctionType>> &internalTestSpace,
     std::string label = "", int symmetry = NO_SYMMETRY);
 
+/** \brief Return true if an integral operator acting on \p domain, with test
+ *  functions from \p dualToRange, should be assembled as a synthetic operator
+ *  so that its internal operator can be reused.
+ *
+ *  This is the case if AssemblyOptions::enableBarycentricOperatorReuse() is
+ *  set and at least one of the spaces is barycentric, unless both spaces are
+ *  already discontinuous. Returns false if any of the spaces is null. */
+template <typename BasisFunctionType>
+bool shouldReuseBarycentricOperator(
+    const AssemblyOptions &assemblyOptions,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange);
+
+/** \brief Return the discontinuous space in which the internal operator of a
+ *  synthetic operator acting on \p space is discretised.
+ *
+ *  If AssemblyOptions::enableBarycentricOperatorReuse() is set, the space is
+ *  taken from Context::discontinuousSpaceCache(), so that internal operators
+ *  built for different spaces can share their weak forms. Otherwise
+ *  <tt>space->discontinuousSpace(space)</tt> is returned. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType>> internalDiscontinuousSpace(
+    const Context<BasisFunctionType, ResultType> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &space);
+
 } // namespace Bempp
 
 #endif
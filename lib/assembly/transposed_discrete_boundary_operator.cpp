@@ -60,7 +60,37 @@ template <typename ValueType>
 void TransposedDiscreteBoundaryOperator<ValueType>::addBlock(
     const std::vector<int> &rows, const std::vector<int> &cols,
     const ValueType alpha, arma::Mat<ValueType> &block) const {
-  m_operator->addBlock(cols, rows, alpha, block);
+  if (m_trans == NO_TRANSPOSE) {
+    m_operator->addBlock(rows, cols, alpha, block);
+    return;
+  }
+  if (block.n_rows != rows.size() || block.n_cols != cols.size())
+    throw std::invalid_argument(
+        "TransposedDiscreteBoundaryOperator::addBlock(): "
+        "incorrect block size");
+  // Only the block, not the whole operator, is transposed or conjugated
+  arma::Mat<ValueType> origBlock;
+  if (isTransposed()) {
+    origBlock.zeros(cols.size(), rows.size());
+    m_operator->addBlock(cols, rows, 1., origBlock);
+  } else {
+    origBlock.zeros(rows.size(), cols.size());
+    m_operator->addBlock(rows, cols, 1., origBlock);
+  }
+  switch (m_trans) {
+  case CONJUGATE:
+    block += alpha * arma::conj(origBlock);
+    break;
+  case TRANSPOSE:
+    block += alpha * origBlock.st();
+    break;
+  case CONJUGATE_TRANSPOSE:
+    block += alpha * origBlock.t();
+    break;
+  default:
+    throw std::runtime_error("TransposedDiscreteBoundaryOperator::addBlock(): "
+                             "invalid transposition mode");
+  }
 }
 
 #ifdef WITH_TRILINOS
@@ -90,6 +120,14 @@ void TransposedDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
     const TranspositionMode trans, const arma::Col<ValueType> &x_in,
     arma::Col<ValueType> &y_inout, const ValueType alpha,
     const ValueType beta) const {
+  applyBuiltInBlockImpl(trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void TransposedDiscreteBoundaryOperator<ValueType>::applyBuiltInBlockImpl(
+    const TranspositionMode trans, const arma::Mat<ValueType> &x_in,
+    arma::Mat<ValueType> &y_inout, const ValueType alpha,
+    const ValueType beta) const {
   // Bitwise xor. We use the fact that bit 0 of M_trans denotes
   // conjugation, and bit 1 -- transposition.
   m_operator->apply(TranspositionMode(trans ^ m_trans), x_in, y_inout, alpha,
@@ -169,41 +169,41 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
   ResultType *data = reinterpret_cast<ResultType *>(ahmedData);
 
   // Convert AHMED matrix indices into DOF indices
-  shared_ptr<const LocalDofLists<BasisFunctionType>> testDofLists =
+  const LocalDofLists<BasisFunctionType> &testDofLists =
       m_testDofListsCache->get(b1, n1);
-  shared_ptr<const LocalDofLists<BasisFunctionType>> trialDofLists =
+  const LocalDofLists<BasisFunctionType> &trialDofLists =
       m_trialDofListsCache->get(b2, n2);
 
   // Requested original matrix indices
   typedef typename LocalDofLists<BasisFunctionType>::DofIndex DofIndex;
   const std::vector<DofIndex> &testOriginalIndices =
-      testDofLists->originalIndices;
+      testDofLists.originalIndices;
   const std::vector<DofIndex> &trialOriginalIndices =
-      trialDofLists->originalIndices;
+      trialDofLists.originalIndices;
   // Necessary elements
-  const std::vector<int> &testElementIndices = testDofLists->elementIndices;
-  const std::vector<int> &trialElementIndices = trialDofLists->elementIndices;
-  // Necessary local dof indices in each element
-  const std::vector<std::vector<LocalDofIndex>> &testLocalDofs =
-      testDofLists->localDofIndices;
-  const std::vector<std::vector<LocalDofIndex>> &trialLocalDofs =
-      trialDofLists->localDofIndices;
+  const std::vector<int> &testElementIndices = testDofLists.elementIndices;
+  const std::vector<int> &trialElementIndices = trialDofLists.elementIndices;
+  // Ranges of the local dofs of each element in the arrays below
+  const std::vector<int> &testOffsets = testDofLists.elementOffsets;
+  const std::vector<LocalDofIndex> &testLocalDofs =
+      testDofLists.localDofIndices;
+  const std::vector<int> &trialOffsets = trialDofLists.elementOffsets;
+  const std::vector<LocalDofIndex> &trialLocalDofs =
+      trialDofLists.localDofIndices;
   // Weights of local dofs in each element
-  const std::vector<std::vector<BasisFunctionType>> &testLocalDofWeights =
-      testDofLists->localDofWeights;
-  const std::vector<std::vector<BasisFunctionType>> &trialLocalDofWeights =
-      trialDofLists->localDofWeights;
+  const std::vector<BasisFunctionType> &testLocalDofWeights =
+      testDofLists.localDofWeights;
+  const std::vector<BasisFunctionType> &trialLocalDofWeights =
+      trialDofLists.localDofWeights;
   for (size_t i = 0; i < testLocalDofWeights.size(); ++i)
-    for (size_t j = 0; j < testLocalDofWeights[i].size(); ++j)
-      assert(std::abs(testLocalDofWeights[i][j]) > 0.);
+    assert(std::abs(testLocalDofWeights[i]) > 0.);
   for (size_t i = 0; i < trialLocalDofWeights.size(); ++i)
-    for (size_t j = 0; j < trialLocalDofWeights[i].size(); ++j)
-      assert(std::abs(trialLocalDofWeights[i][j]) > 0.);
+    assert(std::abs(trialLocalDofWeights[i]) > 0.);
 
   // Corresponding row and column indices in the matrix to be calculated
   // and stored in ahmedData
-  const std::vector<std::vector<int>> &blockRows = testDofLists->arrayIndices;
-  const std::vector<std::vector<int>> &blockCols = trialDofLists->arrayIndices;
+  const std::vector<int> &blockRows = testDofLists.arrayIndices;
+  const std::vector<int> &blockCols = trialDofLists.arrayIndices;
 
   arma::Mat<ResultType> result(data, n1, n2, false /*copy_aux_mem*/,
                                true /*strict*/);
@@ -222,25 +222,24 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
 
       // The body of this loop will very probably only run once (single
       // local DOF per trial element)
-      for (size_t nTrialDof = 0; nTrialDof < trialLocalDofs[nTrialElem].size();
-           ++nTrialDof) {
-        LocalDofIndex activeTrialLocalDof =
-            trialLocalDofs[nTrialElem][nTrialDof];
+      for (int nTrialDof = trialOffsets[nTrialElem];
+           nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof) {
+        LocalDofIndex activeTrialLocalDof = trialLocalDofs[nTrialDof];
         BasisFunctionType activeTrialLocalDofWeight =
-            trialLocalDofWeights[nTrialElem][nTrialDof];
+            trialLocalDofWeights[nTrialDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalWeakForms(
               Fiber::TEST_TRIAL, testElementIndices, activeTrialElementIndex,
               activeTrialLocalDof, localResult, minDist);
           for (size_t nTestElem = 0; nTestElem < testElementIndices.size();
                ++nTestElem)
-            for (size_t nTestDof = 0;
-                 nTestDof < testLocalDofs[nTestElem].size(); ++nTestDof)
-              result(blockRows[nTestElem][nTestDof], 0) +=
+            for (int nTestDof = testOffsets[nTestElem];
+                 nTestDof < testOffsets[nTestElem + 1]; ++nTestDof)
+              result(blockRows[nTestDof], 0) +=
                   m_denseTermsMultipliers[nTerm] *
-                  conj(testLocalDofWeights[nTestElem][nTestDof]) *
+                  conj(testLocalDofWeights[nTestDof]) *
                   activeTrialLocalDofWeight *
-                  localResult[nTestElem](testLocalDofs[nTestElem][nTestDof]);
+                  localResult[nTestElem](testLocalDofs[nTestDof]);
         }
       }
     }
@@ -256,25 +255,24 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
       const int activeTestElementIndex = testElementIndices[nTestElem];
       // The body of this loop will very probably only run once (single
       // local DOF per test element)
-      for (size_t nTestDof = 0; nTestDof < testLocalDofs[nTestElem].size();
-           ++nTestDof) {
-        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestElem][nTestDof];
+      for (int nTestDof = testOffsets[nTestElem];
+           nTestDof < testOffsets[nTestElem + 1]; ++nTestDof) {
+        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestDof];
         BasisFunctionType activeTestLocalDofWeight =
-            testLocalDofWeights[nTestElem][nTestDof];
+            testLocalDofWeights[nTestDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalWeakForms(
               Fiber::TRIAL_TEST, trialElementIndices, activeTestElementIndex,
               activeTestLocalDof, localResult, minDist);
           for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
                ++nTrialElem)
-            for (size_t nTrialDof = 0;
-                 nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
-              result(0, blockCols[nTrialElem][nTrialDof]) +=
+            for (int nTrialDof = trialOffsets[nTrialElem];
+                 nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+              result(0, blockCols[nTrialDof]) +=
                   m_denseTermsMultipliers[nTerm] *
                   conj(activeTestLocalDofWeight) *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
-                  localResult[nTrialElem](
-                      trialLocalDofs[nTrialElem][nTrialDof]);
+                  trialLocalDofWeights[nTrialDof] *
+                  localResult[nTrialElem]( trialLocalDofs[nTrialDof]);
         }
       }
     }
@@ -291,20 +289,18 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
           testElementIndices, trialElementIndices, localResult, minDist);
       for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
            ++nTrialElem)
-        for (size_t nTrialDof = 0;
-             nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
+        for (int nTrialDof = trialOffsets[nTrialElem];
+             nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
           for (size_t nTestElem = 0; nTestElem < testElementIndices.size();
                ++nTestElem)
-            for (size_t nTestDof = 0;
-                 nTestDof < testLocalDofs[nTestElem].size(); ++nTestDof)
-              result(blockRows[nTestElem][nTestDof],
-                     blockCols[nTrialElem][nTrialDof]) +=
+            for (int nTestDof = testOffsets[nTestElem];
+                 nTestDof < testOffsets[nTestElem + 1]; ++nTestDof)
+              result(blockRows[nTestDof], blockCols[nTrialDof]) +=
                   m_denseTermsMultipliers[nTerm] *
-                  conj(testLocalDofWeights[nTestElem][nTestDof]) *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
-                  localResult(nTestElem, nTrialElem)(
-                      testLocalDofs[nTestElem][nTestDof],
-                      trialLocalDofs[nTrialElem][nTrialDof]);
+                  conj(testLocalDofWeights[nTestDof]) *
+                  trialLocalDofWeights[nTrialDof] *
+                  localResult(nTestElem, nTrialElem)( testLocalDofs[nTestDof],
+                      trialLocalDofs[nTrialDof]);
     }
   } else {
     std::vector<arma::Mat<ResultType>> localResult;
@@ -313,26 +309,24 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
       const int activeTestElementIndex = testElementIndices[nTestElem];
       // The body of this loop will very probably only run once (single
       // local DOF per test element)
-      for (size_t nTestDof = 0; nTestDof < testLocalDofs[nTestElem].size();
-           ++nTestDof) {
-        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestElem][nTestDof];
+      for (int nTestDof = testOffsets[nTestElem];
+           nTestDof < testOffsets[nTestElem + 1]; ++nTestDof) {
+        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestDof];
         BasisFunctionType activeTestLocalDofWeight =
-            testLocalDofWeights[nTestElem][nTestDof];
+            testLocalDofWeights[nTestDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalWeakForms(
               Fiber::TRIAL_TEST, trialElementIndices, activeTestElementIndex,
               activeTestLocalDof, localResult, minDist);
           for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
                ++nTrialElem)
-            for (size_t nTrialDof = 0;
-                 nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
-              result(blockRows[nTestElem][nTestDof],
-                     blockCols[nTrialElem][nTrialDof]) +=
+            for (int nTrialDof = trialOffsets[nTrialElem];
+                 nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+              result(blockRows[nTestDof], blockCols[nTrialDof]) +=
                   m_denseTermsMultipliers[nTerm] *
                   conj(activeTestLocalDofWeight) *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
-                  localResult[nTrialElem](
-                      trialLocalDofs[nTrialElem][nTrialDof]);
+                  trialLocalDofWeights[nTrialDof] *
+                  localResult[nTrialElem]( trialLocalDofs[nTrialDof]);
         }
       }
     }
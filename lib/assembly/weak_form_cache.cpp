@@ -0,0 +1,253 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "weak_form_cache.hpp"
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "abstract_boundary_operator.hpp"
+#include "abstract_boundary_operator_id.hpp"
+#include "context.hpp"
+#include "discrete_dense_boundary_operator.hpp"
+#include "discrete_hmat_boundary_operator.hpp"
+#include "discrete_sparse_boundary_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/memory_registry.hpp"
+
+#ifdef WITH_TRILINOS
+#include <Epetra_CrsMatrix.h>
+#endif
+
+#include <cassert>
+
+namespace Bempp {
+
+template <typename BasisFunctionType, typename ResultType>
+std::size_t WeakFormCache<BasisFunctionType, ResultType>::KeyHash::
+operator()(const Key &key) const {
+  return key->hash();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool WeakFormCache<BasisFunctionType, ResultType>::KeyEqual::
+operator()(const Key &key1, const Key &key2) const {
+  return *key1 == *key2;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+WeakFormCache<BasisFunctionType, ResultType>::WeakFormCache(
+    double memoryBudget)
+    : m_memoryBudget(memoryBudget), m_retainedSize(0.) {
+  m_evictionHandlerId =
+      Fiber::MemoryRegistry::addEvictionHandler([this](std::size_t bytes) {
+        releaseRetained(bytes / (1024. * 1024.));
+      });
+}
+
+template <typename BasisFunctionType, typename ResultType>
+WeakFormCache<BasisFunctionType, ResultType>::~WeakFormCache() {
+  Fiber::MemoryRegistry::removeEvictionHandler(m_evictionHandlerId);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+WeakFormCache<BasisFunctionType, ResultType>::getWeakForm(
+    const Context<BasisFunctionType, ResultType> &context,
+    const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op) {
+  Key key = op.id();
+  if (!key)
+    return op.assembleWeakForm(context);
+
+  shared_ptr<const DiscreteOp> transposedWeakForm;
+  {
+    tbb::mutex::scoped_lock lock(m_mutex);
+    shared_ptr<const DiscreteOp> weakForm = lookUp(key, op);
+    if (weakForm)
+      return weakForm;
+    transposedWeakForm = lookUpTranspose(op);
+  }
+
+  // A view of the transposed weak form costs neither assembly nor memory
+  shared_ptr<const DiscreteOp> weakForm =
+      transposedWeakForm ? transpose(transposedWeakForm)
+                         : op.assembleWeakForm(context);
+  const double size = estimateMemorySize(*weakForm);
+
+  tbb::mutex::scoped_lock lock(m_mutex);
+  // Another thread may have inserted the same weak form in the meantime
+  shared_ptr<const DiscreteOp> existingWeakForm = lookUp(key, op);
+  if (existingWeakForm)
+    return existingWeakForm;
+
+  removeExpiredEntries();
+  Entry &entry = m_entries[key];
+  release(entry);
+  entry.domain = op.domain();
+  entry.dualToRange = op.dualToRange();
+  entry.weakForm = weakForm;
+  // A transposed view would keep its untracked original alive
+  if (!transposedWeakForm && size <= m_memoryBudget) {
+    RetainedWeakForm retainedWeakForm = {key, weakForm, size};
+    m_retained.push_front(retainedWeakForm);
+    m_retainedSize += size;
+    entry.retained = true;
+    entry.retainedPosition = m_retained.begin();
+    releaseLeastRecentlyUsed();
+  }
+  return weakForm;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormCache<BasisFunctionType, ResultType>::setMemoryBudget(
+    double memoryBudget) {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  m_memoryBudget = memoryBudget;
+  releaseLeastRecentlyUsed();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+double WeakFormCache<BasisFunctionType, ResultType>::memoryBudget() const {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  return m_memoryBudget;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormCache<BasisFunctionType, ResultType>::clear() {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  m_entries.clear();
+  m_retained.clear();
+  m_retainedSize = 0.;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+double
+WeakFormCache<BasisFunctionType, ResultType>::releaseRetained(double memory) {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  double released = 0.;
+  while (released < memory && !m_retained.empty()) {
+    released += m_retained.back().size;
+    typename EntryMap::iterator it = m_entries.find(m_retained.back().key);
+    assert(it != m_entries.end());
+    release(it->second);
+  }
+  return released;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::size_t WeakFormCache<BasisFunctionType, ResultType>::size() const {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  return m_entries.size();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+double WeakFormCache<BasisFunctionType, ResultType>::estimateMemorySize(
+    const DiscreteBoundaryOperator<ResultType> &weakForm) {
+  const double bytesPerMb = 1024. * 1024.;
+  if (const DiscreteHMatBoundaryOperator<ResultType> *hMatOp =
+          dynamic_cast<const DiscreteHMatBoundaryOperator<ResultType> *>(
+              &weakForm))
+    return hMatOp->hMatrix()->statistics().memSizeKb / 1024.;
+  if (dynamic_cast<const DiscreteDenseBoundaryOperator<ResultType> *>(
+          &weakForm))
+    return double(weakForm.rowCount()) * weakForm.columnCount() *
+           sizeof(ResultType) / bytesPerMb;
+#ifdef WITH_TRILINOS
+  if (const DiscreteSparseBoundaryOperator<ResultType> *sparseOp =
+          dynamic_cast<const DiscreteSparseBoundaryOperator<ResultType> *>(
+              &weakForm))
+    return double(sparseOp->epetraMatrix()->NumMyNonzeros()) *
+           (sizeof(double) + sizeof(int)) / bytesPerMb;
+#endif
+  return 0.;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+WeakFormCache<BasisFunctionType, ResultType>::lookUp(
+    const Key &key,
+    const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op) {
+  typename EntryMap::iterator it = m_entries.find(key);
+  if (it == m_entries.end())
+    return shared_ptr<const DiscreteOp>();
+  Entry &entry = it->second;
+  if (entry.domain.lock() != op.domain() ||
+      entry.dualToRange.lock() != op.dualToRange())
+    return shared_ptr<const DiscreteOp>();
+  shared_ptr<const DiscreteOp> weakForm = entry.weakForm.lock();
+  if (weakForm && entry.retained)
+    m_retained.splice(m_retained.begin(), m_retained, entry.retainedPosition);
+  return weakForm;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+WeakFormCache<BasisFunctionType, ResultType>::lookUpTranspose(
+    const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op) {
+  Key key = op.transposeId();
+  if (!key)
+    return shared_ptr<const DiscreteOp>();
+  typename EntryMap::iterator it = m_entries.find(key);
+  if (it == m_entries.end())
+    return shared_ptr<const DiscreteOp>();
+  Entry &entry = it->second;
+  if (entry.domain.lock() != op.dualToRange() ||
+      entry.dualToRange.lock() != op.domain())
+    return shared_ptr<const DiscreteOp>();
+  shared_ptr<const DiscreteOp> weakForm = entry.weakForm.lock();
+  if (weakForm && entry.retained)
+    m_retained.splice(m_retained.begin(), m_retained, entry.retainedPosition);
+  return weakForm;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormCache<BasisFunctionType, ResultType>::release(Entry &entry) {
+  if (!entry.retained)
+    return;
+  m_retainedSize -= entry.retainedPosition->size;
+  m_retained.erase(entry.retainedPosition);
+  entry.retained = false;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormCache<BasisFunctionType, ResultType>::releaseLeastRecentlyUsed() {
+  while (m_retainedSize > m_memoryBudget && !m_retained.empty()) {
+    typename EntryMap::iterator it = m_entries.find(m_retained.back().key);
+    assert(it != m_entries.end());
+    release(it->second);
+  }
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormCache<BasisFunctionType, ResultType>::removeExpiredEntries() {
+  for (typename EntryMap::iterator it = m_entries.begin();
+       it != m_entries.end();) {
+    Entry &entry = it->second;
+    if (entry.weakForm.expired() || entry.domain.expired() ||
+        entry.dualToRange.expired()) {
+      release(entry);
+      it = m_entries.erase(it);
+    } else
+      ++it;
+  }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(WeakFormCache);
+
+} // namespace Bempp
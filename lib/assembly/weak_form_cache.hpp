@@ -0,0 +1,174 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_weak_form_cache_hpp
+#define bempp_weak_form_cache_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <boost/weak_ptr.hpp>
+#include <tbb/mutex.h>
+#include <list>
+#include <unordered_map>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class AbstractBoundaryOperatorId;
+template <typename BasisFunctionType, typename ResultType>
+class AbstractBoundaryOperator;
+template <typename BasisFunctionType, typename ResultType> class Context;
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Cache of the weak forms of boundary operators.
+ *
+ *  Weak forms are keyed by the identifiers returned by
+ *  AbstractBoundaryOperator::id(); operators without an identifier are
+ *  assembled every time. As long as a weak form is in use, further requests
+ *  for the weak form of an equivalent operator return the same object. In
+ *  addition, the most recently used weak forms are kept alive after their
+ *  last user has released them, up to a total estimated size given by the
+ *  memory budget; the least recently used ones are released first.
+ *
+ *  If the weak form of an operator is not in the cache but that of the
+ *  operator identified by AbstractBoundaryOperator::transposeId() is, the
+ *  weak form is returned as a transposed view of the latter. For example,
+ *  the weak form of an adjoint double-layer operator is obtained from the
+ *  double-layer operator on the swapped spaces without any assembly.
+ *
+ *  The domain and dual to range of an operator are stored with the entry,
+ *  so that an entry is not reused by an operator whose spaces merely happen
+ *  to live at the same addresses as those of a destroyed one. The range does
+ *  not affect the weak form and is ignored.
+ *
+ *  Every Context owns one cache, which is shared by its copies. The weak
+ *  forms therefore all have been assembled with the same quadrature strategy
+ *  and assembly options.
+ *
+ *  The cache registers an eviction handler with the Fiber::MemoryRegistry,
+ *  so that retained weak forms are released when the global memory budget
+ *  is exceeded (see releaseRetained()). */
+template <typename BasisFunctionType, typename ResultType> class WeakFormCache {
+public:
+  /** \brief Constructor.
+   *
+   *  \param[in] memoryBudget
+   *    Memory (in MB) for which weak forms are kept alive after they are
+   *    no longer used. */
+  explicit WeakFormCache(double memoryBudget = 0.);
+
+  /** \brief Destructor. */
+  ~WeakFormCache();
+
+  /** \brief Return the weak form of \p op, assembling it with \p context if
+   *  it is not in the cache yet.
+   *
+   *  The cache lock is not held during assembly. Two threads requesting the
+   *  weak form of equivalent operators at the same time may therefore both
+   *  assemble it; the first result to be inserted is returned to both. */
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> getWeakForm(
+      const Context<BasisFunctionType, ResultType> &context,
+      const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op);
+
+  /** \brief Set the memory budget (in MB), releasing weak forms if
+   *  necessary. */
+  void setMemoryBudget(double memoryBudget);
+
+  /** \brief Return the memory budget (in MB). */
+  double memoryBudget() const;
+
+  /** \brief Remove all entries. */
+  void clear();
+
+  /** \brief Release least recently used retained weak forms until their
+   *  estimated sizes add up to \p memory (in MB) or none is left; return
+   *  the estimated memory (in MB) released.
+   *
+   *  Weak forms still in use elsewhere stay alive, but are no longer
+   *  retained by the cache. */
+  double releaseRetained(double memory);
+
+  /** \brief Return the number of entries. */
+  std::size_t size() const;
+
+  /** \brief Return an estimate of the memory (in MB) occupied by a weak
+   *  form.
+   *
+   *  Only dense, sparse and H-matrix operators are taken into account;
+   *  the estimate for other operators is zero. */
+  static double
+  estimateMemorySize(const DiscreteBoundaryOperator<ResultType> &weakForm);
+
+private:
+  /** \cond PRIVATE */
+  typedef shared_ptr<const AbstractBoundaryOperatorId> Key;
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  typedef Space<BasisFunctionType> SpaceType;
+
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const;
+  };
+  struct KeyEqual {
+    bool operator()(const Key &key1, const Key &key2) const;
+  };
+
+  struct RetainedWeakForm {
+    Key key;
+    shared_ptr<const DiscreteOp> weakForm;
+    double size;
+  };
+  typedef std::list<RetainedWeakForm> RetainedList;
+
+  struct Entry {
+    Entry() : retained(false) {}
+    boost::weak_ptr<const SpaceType> domain;
+    boost::weak_ptr<const SpaceType> dualToRange;
+    boost::weak_ptr<const DiscreteOp> weakForm;
+    bool retained;
+    typename RetainedList::iterator retainedPosition;
+  };
+  typedef std::unordered_map<Key, Entry, KeyHash, KeyEqual> EntryMap;
+
+  shared_ptr<const DiscreteOp> lookUp(
+      const Key &key,
+      const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op);
+  shared_ptr<const DiscreteOp> lookUpTranspose(
+      const AbstractBoundaryOperator<BasisFunctionType, ResultType> &op);
+  void release(Entry &entry);
+  void releaseLeastRecentlyUsed();
+  void removeExpiredEntries();
+
+  EntryMap m_entries;
+  // Most recently used first
+  RetainedList m_retained;
+  double m_memoryBudget;
+  double m_retainedSize;
+  mutable tbb::mutex m_mutex;
+  int m_evictionHandlerId;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
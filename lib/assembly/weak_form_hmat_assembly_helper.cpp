@@ -27,10 +27,35 @@
 #include "discrete_boundary_operator.hpp"
 #include "../fiber/local_assembler_for_integral_operators.hpp"
 #include "../fiber/conjugate.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+#include "../grid/grid_view.hpp"
+#include "../space/space.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
 
 namespace Bempp {
 
 using Fiber::conjugate;
+
+namespace {
+
+// Return true if the planes (n_x, n_y, n_z, d) a and b, with unit normals,
+// coincide up to the orientation of the normal
+bool samePlane(const double *a, const double *b, double tolerance) {
+  const double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  const double crossX = a[1] * b[2] - a[2] * b[1];
+  const double crossY = a[2] * b[0] - a[0] * b[2];
+  const double crossZ = a[0] * b[1] - a[1] * b[0];
+  const double sine =
+      std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ);
+  return sine <= std::sqrt(std::numeric_limits<double>::epsilon()) &&
+         std::abs(a[3] - (dot < 0 ? -b[3] : b[3])) <= tolerance;
+}
+
+} // namespace
 }
 
 namespace Bempp {
@@ -44,19 +69,32 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::
         const std::vector<LocalAssembler *> &assemblers,
         const std::vector<const DiscreteLinOp *> &sparseTermsToAdd,
         const std::vector<ResultType> &denseTermsMultipliers,
-        const std::vector<ResultType> &sparseTermsMultipliers)
+        const std::vector<ResultType> &sparseTermsMultipliers,
+        const shared_ptr<LocalDofListsCache<BasisFunctionType>> &
+            testDofListsCache,
+        const shared_ptr<LocalDofListsCache<BasisFunctionType>> &
+            trialDofListsCache)
     : m_testSpace(testSpace), m_trialSpace(trialSpace),
       m_blockClusterTree(blockClusterTree), m_assemblers(assemblers),
       m_sparseTermsToAdd(sparseTermsToAdd),
       m_denseTermsMultipliers(denseTermsMultipliers),
       m_sparseTermsMultipliers(sparseTermsMultipliers),
-      m_testDofListsCache(new LocalDofListsCache<BasisFunctionType>(
-          m_testSpace,
-          blockClusterTree->rowClusterTree()->hMatDofToOriginalDofMap(), true)),
-      m_trialDofListsCache(new LocalDofListsCache<BasisFunctionType>(
-          m_trialSpace,
-          blockClusterTree->columnClusterTree()->hMatDofToOriginalDofMap(),
-          true)) {
+      m_testDofListsCache(
+          testDofListsCache
+              ? testDofListsCache
+              : shared_ptr<LocalDofListsCache<BasisFunctionType>>(
+                    new LocalDofListsCache<BasisFunctionType>(
+                        m_testSpace, blockClusterTree->rowClusterTree()
+                                         ->hMatDofToOriginalDofMap(),
+                        true))),
+      m_trialDofListsCache(
+          trialDofListsCache
+              ? trialDofListsCache
+              : shared_ptr<LocalDofListsCache<BasisFunctionType>>(
+                    new LocalDofListsCache<BasisFunctionType>(
+                        m_trialSpace, blockClusterTree->columnClusterTree()
+                                          ->hMatDofToOriginalDofMap(),
+                        true))) {
 
   for (size_t i = 0; i < assemblers.size(); ++i)
     if (!assemblers[i])
@@ -69,6 +107,11 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::
           "WeakFormAcaAssemblyHelper::WeakFormAcaAssemblyHelper(): "
           "no elements of the 'sparseTermsToAdd' vector may be null");
   m_accessedEntryCount = 0;
+
+  m_vanishesOnCoplanarElements = !assemblers.empty();
+  for (size_t i = 0; i < assemblers.size(); ++i)
+    if (!assemblers[i]->vanishesOnCoplanarElements())
+      m_vanishesOnCoplanarElements = false;
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -101,40 +144,35 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeMatrixBlock(
 
   const CoordinateType minDist = estimateMinimumDistance(blockClusterTreeNode);
 
-  shared_ptr<const LocalDofLists<BasisFunctionType>> testDofLists =
+  const LocalDofLists<BasisFunctionType> &testDofLists =
       m_testDofListsCache->get(testIndexRange[0], numberOfTestIndices);
-  shared_ptr<const LocalDofLists<BasisFunctionType>> trialDofLists =
+  const LocalDofLists<BasisFunctionType> &trialDofLists =
       m_trialDofListsCache->get(trialIndexRange[0], numberOfTrialIndices);
 
-  // Requested original matrix indices
-  typedef typename LocalDofLists<BasisFunctionType>::DofIndex DofIndex;
-  const std::vector<DofIndex> &testOriginalIndices =
-      testDofLists->originalIndices;
-  const std::vector<DofIndex> &trialOriginalIndices =
-      trialDofLists->originalIndices;
   // Necessary elements
-  const std::vector<int> &testElementIndices = testDofLists->elementIndices;
-  const std::vector<int> &trialElementIndices = trialDofLists->elementIndices;
-  // Necessary local dof indices in each element
-  const std::vector<std::vector<LocalDofIndex>> &testLocalDofs =
-      testDofLists->localDofIndices;
-  const std::vector<std::vector<LocalDofIndex>> &trialLocalDofs =
-      trialDofLists->localDofIndices;
-  // Weights of local dofs in each element
-  const std::vector<std::vector<BasisFunctionType>> &testLocalDofWeights =
-      testDofLists->localDofWeights;
-  const std::vector<std::vector<BasisFunctionType>> &trialLocalDofWeights =
-      trialDofLists->localDofWeights;
+  const std::vector<int> &testElementIndices = testDofLists.elementIndices;
+  const std::vector<int> &trialElementIndices = trialDofLists.elementIndices;
+  // Ranges of the local dofs of each element in the arrays below
+  const std::vector<int> &testOffsets = testDofLists.elementOffsets;
+  const std::vector<int> &trialOffsets = trialDofLists.elementOffsets;
+  // Necessary local dof indices
+  const std::vector<LocalDofIndex> &testLocalDofs =
+      testDofLists.localDofIndices;
+  const std::vector<LocalDofIndex> &trialLocalDofs =
+      trialDofLists.localDofIndices;
+  // Weights of local dofs
+  const std::vector<BasisFunctionType> &testLocalDofWeights =
+      testDofLists.localDofWeights;
+  const std::vector<BasisFunctionType> &trialLocalDofWeights =
+      trialDofLists.localDofWeights;
   for (size_t i = 0; i < testLocalDofWeights.size(); ++i)
-    for (size_t j = 0; j < testLocalDofWeights[i].size(); ++j)
-      assert(std::abs(testLocalDofWeights[i][j]) > 0.);
+    assert(std::abs(testLocalDofWeights[i]) > 0.);
   for (size_t i = 0; i < trialLocalDofWeights.size(); ++i)
-    for (size_t j = 0; j < trialLocalDofWeights[i].size(); ++j)
-      assert(std::abs(trialLocalDofWeights[i][j]) > 0.);
+    assert(std::abs(trialLocalDofWeights[i]) > 0.);
 
   // Corresponding row and column indices in the matrix to be calculated
-  const std::vector<std::vector<int>> &blockRows = testDofLists->arrayIndices;
-  const std::vector<std::vector<int>> &blockCols = trialDofLists->arrayIndices;
+  const std::vector<int> &blockRows = testDofLists.arrayIndices;
+  const std::vector<int> &blockCols = trialDofLists.arrayIndices;
 
   data.resize(numberOfTestIndices, numberOfTrialIndices);
   data.fill(0.);
@@ -152,25 +190,24 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeMatrixBlock(
 
       // The body of this loop will very probably only run once (single
       // local DOF per trial element)
-      for (size_t nTrialDof = 0; nTrialDof < trialLocalDofs[nTrialElem].size();
-           ++nTrialDof) {
-        LocalDofIndex activeTrialLocalDof =
-            trialLocalDofs[nTrialElem][nTrialDof];
+      for (int nTrialDof = trialOffsets[nTrialElem];
+           nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof) {
+        LocalDofIndex activeTrialLocalDof = trialLocalDofs[nTrialDof];
         BasisFunctionType activeTrialLocalDofWeight =
-            trialLocalDofWeights[nTrialElem][nTrialDof];
+            trialLocalDofWeights[nTrialDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalWeakForms(
               Fiber::TEST_TRIAL, testElementIndices, activeTrialElementIndex,
               activeTrialLocalDof, localResult, minDist);
           for (size_t nTestElem = 0; nTestElem < testElementIndices.size();
                ++nTestElem)
-            for (size_t nTestDof = 0;
-                 nTestDof < testLocalDofs[nTestElem].size(); ++nTestDof)
-              data(blockRows[nTestElem][nTestDof], 0) +=
+            for (int nTestDof = testOffsets[nTestElem];
+                 nTestDof < testOffsets[nTestElem + 1]; ++nTestDof)
+              data(blockRows[nTestDof], 0) +=
                   m_denseTermsMultipliers[nTerm] *
-                  conjugate(testLocalDofWeights[nTestElem][nTestDof]) *
+                  conjugate(testLocalDofWeights[nTestDof]) *
                   activeTrialLocalDofWeight *
-                  localResult[nTestElem](testLocalDofs[nTestElem][nTestDof]);
+                  localResult[nTestElem](testLocalDofs[nTestDof]);
         }
       }
     }
@@ -186,25 +223,24 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeMatrixBlock(
       const int activeTestElementIndex = testElementIndices[nTestElem];
       // The body of this loop will very probably only run once (single
       // local DOF per test element)
-      for (size_t nTestDof = 0; nTestDof < testLocalDofs[nTestElem].size();
-           ++nTestDof) {
-        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestElem][nTestDof];
+      for (int nTestDof = testOffsets[nTestElem];
+           nTestDof < testOffsets[nTestElem + 1]; ++nTestDof) {
+        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestDof];
         BasisFunctionType activeTestLocalDofWeight =
-            testLocalDofWeights[nTestElem][nTestDof];
+            testLocalDofWeights[nTestDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalWeakForms(
               Fiber::TRIAL_TEST, trialElementIndices, activeTestElementIndex,
               activeTestLocalDof, localResult, minDist);
           for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
                ++nTrialElem)
-            for (size_t nTrialDof = 0;
-                 nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
-              data(0, blockCols[nTrialElem][nTrialDof]) +=
+            for (int nTrialDof = trialOffsets[nTrialElem];
+                 nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+              data(0, blockCols[nTrialDof]) +=
                   m_denseTermsMultipliers[nTerm] *
                   conjugate(activeTestLocalDofWeight) *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
-                  localResult[nTrialElem](
-                      trialLocalDofs[nTrialElem][nTrialDof]);
+                  trialLocalDofWeights[nTrialDof] *
+                  localResult[nTrialElem](trialLocalDofs[nTrialDof]);
         }
       }
     }
@@ -216,27 +252,7 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeMatrixBlock(
     // Evaluate the full local weak form for each pair of test and trial
     // elements and then select the entries that we need.
 
-    Fiber::_2dArray<arma::Mat<ResultType>> localResult;
-    for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
-      m_assemblers[nTerm]->evaluateLocalWeakForms(
-          testElementIndices, trialElementIndices, localResult, minDist);
-      for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
-           ++nTrialElem)
-        for (size_t nTrialDof = 0;
-             nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
-          for (size_t nTestElem = 0; nTestElem < testElementIndices.size();
-               ++nTestElem)
-            for (size_t nTestDof = 0;
-                 nTestDof < testLocalDofs[nTestElem].size(); ++nTestDof)
-              data(blockRows[nTestElem][nTestDof],
-                   blockCols[nTrialElem][nTrialDof]) +=
-                  m_denseTermsMultipliers[nTerm] *
-                  conjugate(testLocalDofWeights[nTestElem][nTestDof]) *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
-                  localResult(nTestElem, nTrialElem)(
-                      testLocalDofs[nTestElem][nTestDof],
-                      trialLocalDofs[nTrialElem][nTrialDof]);
-    }
+    evaluateElementPairs(testDofLists, trialDofLists, minDist, data);
   } else {
     std::vector<arma::Mat<ResultType>> localResult;
     for (size_t nTestElem = 0; nTestElem < testElementIndices.size();
@@ -244,40 +260,330 @@ WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeMatrixBlock(
       const int activeTestElementIndex = testElementIndices[nTestElem];
       // The body of this loop will very probably only run once (single
       // local DOF per test element)
-      for (size_t nTestDof = 0; nTestDof < testLocalDofs[nTestElem].size();
-           ++nTestDof) {
-        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestElem][nTestDof];
+      for (int nTestDof = testOffsets[nTestElem];
+           nTestDof < testOffsets[nTestElem + 1]; ++nTestDof) {
+        LocalDofIndex activeTestLocalDof = testLocalDofs[nTestDof];
         BasisFunctionType activeTestLocalDofWeight =
-            testLocalDofWeights[nTestElem][nTestDof];
+            testLocalDofWeights[nTestDof];
         for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
           m_assemblers[nTerm]->evaluateLocalWeakForms(
               Fiber::TRIAL_TEST, trialElementIndices, activeTestElementIndex,
               activeTestLocalDof, localResult, minDist);
           for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
                ++nTrialElem)
-            for (size_t nTrialDof = 0;
-                 nTrialDof < trialLocalDofs[nTrialElem].size(); ++nTrialDof)
-              data(blockRows[nTestElem][nTestDof],
-                   blockCols[nTrialElem][nTrialDof]) +=
+            for (int nTrialDof = trialOffsets[nTrialElem];
+                 nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+              data(blockRows[nTestDof], blockCols[nTrialDof]) +=
                   m_denseTermsMultipliers[nTerm] *
                   conjugate(activeTestLocalDofWeight) *
-                  trialLocalDofWeights[nTrialElem][nTrialDof] *
-                  localResult[nTrialElem](
-                      trialLocalDofs[nTrialElem][nTrialDof]);
+                  trialLocalDofWeights[nTrialDof] *
+                  localResult[nTrialElem](trialLocalDofs[nTrialDof]);
         }
       }
     }
   }
 
   // Now, add the contributions of the sparse terms
+  addSparseTerms(testDofLists, trialDofLists, data);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void
+WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeMatrixRows(
+    const hmat::IndexSetType &testIndices,
+    const hmat::IndexRangeType &trialIndexRange,
+    const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
+    arma::Mat<ResultType> &data) const {
+
+  auto numberOfTrialIndices = trialIndexRange[1] - trialIndexRange[0];
+
+  m_accessedEntryCount += testIndices.size() * numberOfTrialIndices;
+
+  const CoordinateType minDist = estimateMinimumDistance(blockClusterTreeNode);
+
+  LocalDofLists<BasisFunctionType> &testDofLists =
+      m_gatheredDofLists.local();
+  gatherDofLists(*m_testDofListsCache, testIndices, testDofLists);
+  const LocalDofLists<BasisFunctionType> &trialDofLists =
+      m_trialDofListsCache->get(trialIndexRange[0], numberOfTrialIndices);
+
+  data.zeros(testIndices.size(), numberOfTrialIndices);
+  evaluateElementPairs(testDofLists, trialDofLists, minDist, data);
+  addSparseTerms(testDofLists, trialDofLists, data);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::
+    computeMatrixColumns(
+        const hmat::IndexRangeType &testIndexRange,
+        const hmat::IndexSetType &trialIndices,
+        const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
+        arma::Mat<ResultType> &data) const {
+
+  auto numberOfTestIndices = testIndexRange[1] - testIndexRange[0];
+
+  m_accessedEntryCount += numberOfTestIndices * trialIndices.size();
+
+  const CoordinateType minDist = estimateMinimumDistance(blockClusterTreeNode);
+
+  const LocalDofLists<BasisFunctionType> &testDofLists =
+      m_testDofListsCache->get(testIndexRange[0], numberOfTestIndices);
+  LocalDofLists<BasisFunctionType> &trialDofLists =
+      m_gatheredDofLists.local();
+  gatherDofLists(*m_trialDofListsCache, trialIndices, trialDofLists);
+
+  data.zeros(numberOfTestIndices, trialIndices.size());
+  evaluateElementPairs(testDofLists, trialDofLists, minDist, data);
+  addSparseTerms(testDofLists, trialDofLists, data);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::gatherDofLists(
+    LocalDofListsCache<BasisFunctionType> &cache,
+    const hmat::IndexSetType &indices,
+    LocalDofLists<BasisFunctionType> &result) {
+
+  result.clear();
+
+  // Count the local DOFs of every element, then fill the flat arrays. The
+  // elements are found by linear search, which is cheap for the few indices
+  // of an ACA row or column request and does not allocate.
+  std::vector<int> &offsets = result.elementOffsets;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const LocalDofLists<BasisFunctionType> &dofLists = cache.get(indices[i], 1);
+    result.originalIndices.push_back(dofLists.originalIndices[0]);
+    for (size_t nElem = 0; nElem < dofLists.elementIndices.size(); ++nElem) {
+      const int element = dofLists.elementIndices[nElem];
+      size_t position = std::find(result.elementIndices.begin(),
+                                  result.elementIndices.end(), element) -
+                        result.elementIndices.begin();
+      if (position == result.elementIndices.size()) {
+        result.elementIndices.push_back(element);
+        offsets.push_back(0);
+      }
+      offsets[position + 1] +=
+          dofLists.elementOffsets[nElem + 1] - dofLists.elementOffsets[nElem];
+    }
+  }
+  for (size_t nElem = 0; nElem < result.elementIndices.size(); ++nElem)
+    offsets[nElem + 1] += offsets[nElem];
+
+  const size_t dofCount = offsets.back();
+  result.localDofIndices.resize(dofCount);
+  result.localDofWeights.resize(dofCount);
+  result.arrayIndices.resize(dofCount);
+
+  // Use the offsets as insertion positions, shifting them back afterwards
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const LocalDofLists<BasisFunctionType> &dofLists = cache.get(indices[i], 1);
+    for (size_t nElem = 0; nElem < dofLists.elementIndices.size(); ++nElem) {
+      size_t position =
+          std::find(result.elementIndices.begin(), result.elementIndices.end(),
+                    dofLists.elementIndices[nElem]) -
+          result.elementIndices.begin();
+      for (int nDof = dofLists.elementOffsets[nElem];
+           nDof < dofLists.elementOffsets[nElem + 1]; ++nDof) {
+        const int target = offsets[position]++;
+        result.localDofIndices[target] = dofLists.localDofIndices[nDof];
+        result.localDofWeights[target] = dofLists.localDofWeights[nDof];
+        result.arrayIndices[target] = i;
+      }
+    }
+  }
+  for (size_t nElem = result.elementIndices.size(); nElem > 0; --nElem)
+    offsets[nElem] = offsets[nElem - 1];
+  offsets[0] = 0;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::
+    evaluateElementPairs(
+        const LocalDofLists<BasisFunctionType> &testDofLists,
+        const LocalDofLists<BasisFunctionType> &trialDofLists,
+        CoordinateType minDist, arma::Mat<ResultType> &data) const {
+
+  const std::vector<int> &testElementIndices = testDofLists.elementIndices;
+  const std::vector<int> &trialElementIndices = trialDofLists.elementIndices;
+  const std::vector<int> &testOffsets = testDofLists.elementOffsets;
+  const std::vector<int> &trialOffsets = trialDofLists.elementOffsets;
+  const std::vector<LocalDofIndex> &testLocalDofs =
+      testDofLists.localDofIndices;
+  const std::vector<LocalDofIndex> &trialLocalDofs =
+      trialDofLists.localDofIndices;
+  const std::vector<BasisFunctionType> &testLocalDofWeights =
+      testDofLists.localDofWeights;
+  const std::vector<BasisFunctionType> &trialLocalDofWeights =
+      trialDofLists.localDofWeights;
+  const std::vector<int> &blockRows = testDofLists.arrayIndices;
+  const std::vector<int> &blockCols = trialDofLists.arrayIndices;
+
+  Fiber::_2dArray<arma::Mat<ResultType>> localResult;
+  for (size_t nTerm = 0; nTerm < m_assemblers.size(); ++nTerm) {
+    m_assemblers[nTerm]->evaluateLocalWeakForms(
+        testElementIndices, trialElementIndices, localResult, minDist);
+    for (size_t nTrialElem = 0; nTrialElem < trialElementIndices.size();
+         ++nTrialElem)
+      for (int nTrialDof = trialOffsets[nTrialElem];
+           nTrialDof < trialOffsets[nTrialElem + 1]; ++nTrialDof)
+        for (size_t nTestElem = 0; nTestElem < testElementIndices.size();
+             ++nTestElem)
+          for (int nTestDof = testOffsets[nTestElem];
+               nTestDof < testOffsets[nTestElem + 1]; ++nTestDof)
+            data(blockRows[nTestDof], blockCols[nTrialDof]) +=
+                m_denseTermsMultipliers[nTerm] *
+                conjugate(testLocalDofWeights[nTestDof]) *
+                trialLocalDofWeights[nTrialDof] *
+                localResult(nTestElem, nTrialElem)(testLocalDofs[nTestDof],
+                                                   trialLocalDofs[nTrialDof]);
+  }
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::addSparseTerms(
+    const LocalDofLists<BasisFunctionType> &testDofLists,
+    const LocalDofLists<BasisFunctionType> &trialDofLists,
+    arma::Mat<ResultType> &data) const {
+
   for (size_t nTerm = 0; nTerm < m_sparseTermsToAdd.size(); ++nTerm)
     m_sparseTermsToAdd[nTerm]->addBlock(
         // since m_indexWithGlobalDofs is set, these refer
         // to global DOFs
-        testOriginalIndices, trialOriginalIndices,
+        testDofLists.originalIndices, trialDofLists.originalIndices,
         m_sparseTermsMultipliers[nTerm], data);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+typename WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::DofPlanes
+WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::computeDofPlanes(
+    const Space<BasisFunctionType> &space,
+    const std::vector<std::size_t> &p2o) {
+
+  const size_t dofCount = p2o.size();
+  DofPlanes result;
+  result.tolerance = 0;
+  result.planes.resize(4 * dofCount);
+  result.runEnds.resize(dofCount);
+  for (size_t i = 0; i < dofCount; ++i)
+    result.runEnds[i] = i;
+
+  shared_ptr<const Fiber::RawGridGeometry<double>> geometry =
+      space.gridView().rawGeometry<double>();
+  const arma::Mat<double> &vertices = geometry->vertices();
+  const arma::Mat<int> &corners = geometry->elementCornerIndices();
+  const arma::Mat<double> &normals = geometry->normals();
+  if (geometry->gridDimension() != 2 || geometry->worldDimension() != 3 ||
+      static_cast<int>(normals.n_cols) != geometry->elementCount() ||
+      vertices.n_cols == 0)
+    return result;
+
+  // Distances from the planes are compared relative to the grid size
+  const double diameter = arma::norm(
+      arma::max(vertices, 1) - arma::min(vertices, 1), 2);
+  result.tolerance =
+      std::sqrt(std::numeric_limits<double>::epsilon()) * diameter;
+
+  std::vector<GlobalDofIndex> globalDofs(p2o.begin(), p2o.end());
+  std::vector<std::vector<LocalDof>> localDofs;
+  space.global2localDofs(globalDofs, localDofs);
+
+  // Plane of the first element adjacent to each DOF, accepted if the other
+  // adjacent elements lie in it as well
+  std::vector<char> planar(dofCount, 0);
+  for (size_t i = 0; i < dofCount; ++i) {
+    if (localDofs[i].empty())
+      continue;
+    double *plane = &result.planes[4 * i];
+    const int firstElement = localDofs[i][0].entityIndex;
+    const double *origin = vertices.colptr(corners(0, firstElement));
+    plane[3] = 0;
+    for (int dim = 0; dim < 3; ++dim) {
+      plane[dim] = normals(dim, firstElement);
+      plane[3] += plane[dim] * origin[dim];
+    }
+    bool isPlanar = true;
+    for (size_t j = 0; isPlanar && j < localDofs[i].size(); ++j) {
+      const int element = localDofs[i][j].entityIndex;
+      for (size_t corner = 0; isPlanar && corner < corners.n_rows; ++corner) {
+        const int vertex = corners(corner, element);
+        if (vertex < 0)
+          break;
+        const double *x = vertices.colptr(vertex);
+        const double distance =
+            plane[0] * x[0] + plane[1] * x[1] + plane[2] * x[2] - plane[3];
+        isPlanar = std::abs(distance) <= result.tolerance;
+      }
+    }
+    planar[i] = isPlanar;
+  }
+
+  // Runs of consecutive DOFs lying in the plane of the first DOF of the run
+  size_t start = 0;
+  while (start < dofCount) {
+    if (!planar[start]) {
+      ++start;
+      continue;
+    }
+    size_t end = start + 1;
+    while (end < dofCount && planar[end] &&
+           samePlane(&result.planes[4 * start], &result.planes[4 * end],
+                     result.tolerance))
+      ++end;
+    for (size_t i = start; i < end; ++i)
+      result.runEnds[i] = end;
+    start = end;
+  }
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool WeakFormHMatAssemblyHelper<BasisFunctionType, ResultType>::isZeroBlock(
+    const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode) const {
+
+  if (!m_vanishesOnCoplanarElements)
+    return false;
+  // Admissible blocks are disjoint from the supports of sparse terms
+  if (!m_sparseTermsToAdd.empty() && !blockClusterTreeNode.data().admissible)
+    return false;
+
+  const hmat::IndexRangeType &testIndexRange =
+      blockClusterTreeNode.data().rowClusterTreeNode->data().indexRange;
+  const hmat::IndexRangeType &trialIndexRange =
+      blockClusterTreeNode.data().columnClusterTreeNode->data().indexRange;
+  if (testIndexRange[1] <= testIndexRange[0] ||
+      trialIndexRange[1] <= trialIndexRange[0])
+    return false;
+
+  const DofPlanes &testPlanes = m_testDofPlanes.get([&]() {
+    return computeDofPlanes(
+        m_testSpace,
+        m_blockClusterTree->rowClusterTree()->hMatDofToOriginalDofMap());
+  });
+  const DofPlanes &trialPlanes = m_trialDofPlanes.get([&]() {
+    return computeDofPlanes(
+        m_trialSpace,
+        m_blockClusterTree->columnClusterTree()->hMatDofToOriginalDofMap());
+  });
+
+  if (testPlanes.runEnds[testIndexRange[0]] < testIndexRange[1] ||
+      trialPlanes.runEnds[trialIndexRange[0]] < trialIndexRange[1])
+    return false;
+  return samePlane(&testPlanes.planes[4 * testIndexRange[0]],
+                   &trialPlanes.planes[4 * trialIndexRange[0]],
+                   std::max(testPlanes.tolerance, trialPlanes.tolerance));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+size_t WeakFormHMatAssemblyHelper<BasisFunctionType,
+                                  ResultType>::accessedEntryCount() const {
+  return m_accessedEntryCount;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeakFormHMatAssemblyHelper<BasisFunctionType,
+                                ResultType>::resetAccessedEntryCount() {
+  m_accessedEntryCount = 0;
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
     WeakFormHMatAssemblyHelper);
 }
@@ -24,15 +24,18 @@
 #include "../common/common.hpp"
 
 #include "../common/armadillo_fwd.hpp"
+#include "../common/lazy.hpp"
 #include "../common/shared_ptr.hpp"
 #include "../common/types.hpp"
 #include "../fiber/scalar_traits.hpp"
 #include "../hmat/common.hpp"
 #include "../hmat/block_cluster_tree.hpp"
 #include "../hmat/data_accessor.hpp"
+#include "local_dof_lists_cache.hpp"
 
 #include <tbb/atomic.h>
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <vector>
 
 
@@ -50,7 +53,6 @@ namespace Bempp {
 /** \cond FORWARD_DECL */
 class AssemblyOptions;
 template <typename ResultType> class DiscreteBoundaryOperator;
-template <typename BasisFunctionType> class LocalDofListsCache;
 template <typename BasisFunctionType> class Space;
 /** \endcond */
 
@@ -73,7 +75,12 @@ public:
       const std::vector<LocalAssembler *> &assemblers,
       const std::vector<const DiscreteLinOp *> &sparseTermsToAdd,
       const std::vector<ResultType> &denseTermsMultipliers,
-      const std::vector<ResultType> &sparseTermsMultipliers);
+      const std::vector<ResultType> &sparseTermsMultipliers,
+      const shared_ptr<LocalDofListsCache<BasisFunctionType>> &
+          testDofListsCache = shared_ptr<LocalDofListsCache<BasisFunctionType>>(),
+      const shared_ptr<LocalDofListsCache<BasisFunctionType>> &
+          trialDofListsCache =
+              shared_ptr<LocalDofListsCache<BasisFunctionType>>());
 
   /** \brief Evaluate entries of a general block. */
 
@@ -83,18 +90,78 @@ public:
       const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
       arma::Mat<ResultType> &data) const override;
 
-  // /** \brief Return the number of entries in the matrix that have been
-  //  *  accessed so far. */
-  // size_t accessedEntryCount() const;
- 
-  // /** \brief Reset the number of entries in the matrix that have been
-  //  *  accessed so far. */
-  // void resetAccessedEntryCount();
+  /** \brief Evaluate several rows of a block.
+   *
+   *  The local weak forms are evaluated once for all pairs of test
+   *  elements adjacent to any of the requested DOFs and trial elements of
+   *  the column range, so that geometry, basis and quadrature data are
+   *  shared between the rows. */
+  void computeMatrixRows(
+      const hmat::IndexSetType &testIndices,
+      const hmat::IndexRangeType &trialIndexRange,
+      const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
+      arma::Mat<ResultType> &data) const override;
+
+  /** \brief Evaluate several columns of a block; see computeMatrixRows(). */
+  void computeMatrixColumns(
+      const hmat::IndexRangeType &testIndexRange,
+      const hmat::IndexSetType &trialIndices,
+      const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode,
+      arma::Mat<ResultType> &data) const override;
+
+  /** \brief Return the number of entries in the matrix that have been
+   *  accessed so far. */
+  size_t accessedEntryCount() const override;
+
+  /** \brief Reset the number of entries in the matrix that have been
+   *  accessed so far. */
+  void resetAccessedEntryCount();
+
+  /** \brief Return true if the kernels of all terms vanish on coplanar
+   *  elements and the supports of all test and trial DOFs of the block lie
+   *  in one plane, as for double-layer operators on a planar screen.
+   *
+   *  Blocks overlapping the support of sparse terms are never reported as
+   *  zero. */
+  bool isZeroBlock(const hmat::DefaultBlockClusterTreeNodeType &
+                       blockClusterTreeNode) const override;
 
 private:
     MagnitudeType estimateMinimumDistance(
         const hmat::DefaultBlockClusterTreeNodeType &blockClusterTreeNode) const;
 
+    /** \brief Merge the DOF lists of single, scattered indices.
+     *
+     *  The array indices of the result refer to positions in \p indices. */
+    static void gatherDofLists(LocalDofListsCache<BasisFunctionType> &cache,
+                               const hmat::IndexSetType &indices,
+                               LocalDofLists<BasisFunctionType> &result);
+
+    /** \brief Add the contributions of all pairs of test and trial elements
+     *  to \p data, evaluating full local weak forms. */
+    void evaluateElementPairs(
+        const LocalDofLists<BasisFunctionType> &testDofLists,
+        const LocalDofLists<BasisFunctionType> &trialDofLists,
+        CoordinateType minDist, arma::Mat<ResultType> &data) const;
+
+    void addSparseTerms(const LocalDofLists<BasisFunctionType> &testDofLists,
+                        const LocalDofLists<BasisFunctionType> &trialDofLists,
+                        arma::Mat<ResultType> &data) const;
+
+    /** \brief Planes n . x = d containing the supports of the DOFs of a
+     *  space, in H-matrix DOF order. */
+    struct DofPlanes {
+      // Normal and offset (n_x, n_y, n_z, d) of the plane of each DOF
+      std::vector<double> planes;
+      // DOFs i, ..., runEnds[i] - 1 lie in the plane of DOF i; runEnds[i]
+      // is i if the support of DOF i is not planar
+      std::vector<std::size_t> runEnds;
+      double tolerance;
+    };
+
+    static DofPlanes computeDofPlanes(const Space<BasisFunctionType> &space,
+                                      const std::vector<std::size_t> &p2o);
+
 private:
   /** \cond PRIVATE */
   const Space<BasisFunctionType> &m_testSpace;
@@ -110,11 +177,21 @@ private:
 
   mutable tbb::atomic<size_t> m_accessedEntryCount;
 
+  // True if all local assemblers vanish on coplanar elements; otherwise the
+  // DOF planes are never computed
+  bool m_vanishesOnCoplanarElements;
+  Lazy<DofPlanes> m_testDofPlanes, m_trialDofPlanes;
+
   typedef tbb::concurrent_unordered_map<
       shared_ptr<const hmat::DefaultBlockClusterTreeNodeType>, CoordinateType,
       std::hash<shared_ptr<const hmat::DefaultBlockClusterTreeNodeType>>> DistanceMap;
   mutable DistanceMap m_distancesCache;
 
+  // Per-thread result of gatherDofLists(), reused by all row and column
+  // evaluations
+  mutable tbb::enumerable_thread_specific<LocalDofLists<BasisFunctionType>>
+  m_gatheredDofLists;
+
   /** \endcond */
 };
 
@@ -0,0 +1,479 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "weighted_local_operator.hpp"
+
+#include "assembly_options.hpp"
+#include "context.hpp"
+#include "discrete_boundary_operator_sum.hpp"
+#include "discrete_dense_boundary_operator.hpp"
+#include "discrete_sparse_boundary_operator.hpp"
+#include "grid_function.hpp"
+#include "local_assembler_construction_helper.hpp"
+#include "local_operator_pattern.hpp"
+#include "scaled_discrete_boundary_operator.hpp"
+
+#include "../common/complex_aux.hpp"
+#include "../fiber/basis_data.hpp"
+#include "../fiber/collection_of_3d_arrays.hpp"
+#include "../fiber/collection_of_shapeset_transformations.hpp"
+#include "../fiber/default_quadrature_descriptor_selector_for_local_operators.hpp"
+#include "../fiber/default_single_quadrature_rule_family.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/geometrical_data.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+#include "../fiber/shapeset.hpp"
+#include "../fiber/task_arena_cache.hpp"
+#include "../grid/entity.hpp"
+#include "../grid/entity_iterator.hpp"
+#include "../grid/geometry.hpp"
+#include "../grid/geometry_factory.hpp"
+#include "../grid/grid_view.hpp"
+#include "../grid/mapper.hpp"
+#include "../space/space.hpp"
+
+#include "../common/boost_make_shared_fwd.hpp"
+#include <boost/type_traits/is_complex.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+#ifdef WITH_TRILINOS
+// See elementary_local_operator.cpp for the reason of this workaround
+#ifndef __IBMCPP__
+#define __IBMCPP__
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
+#include <Epetra_SerialComm.h>
+#undef __IBMCPP__
+#else
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
+#include <Epetra_SerialComm.h>
+#endif
+#endif // WITH_TRILINOS
+
+namespace Bempp {
+
+namespace {
+
+// Quadrature rule together with the values of the test and trial shape
+// functions at its points
+template <typename BasisFunctionType> struct WeightedQuadratureVariant {
+  typedef typename ScalarTraits<BasisFunctionType>::RealType
+  CoordinateType;
+
+  int index;
+  arma::Mat<CoordinateType> points;
+  std::vector<CoordinateType> weights;
+  Fiber::BasisData<BasisFunctionType> testBasisData;
+  Fiber::BasisData<BasisFunctionType> trialBasisData;
+};
+
+// The imaginary unit; only called for complex types
+template <typename ValueType>
+typename boost::enable_if<boost::is_complex<ValueType>, ValueType>::type
+imaginaryUnit() {
+  return ValueType(0., 1.);
+}
+
+template <typename ValueType>
+typename boost::disable_if<boost::is_complex<ValueType>, ValueType>::type
+imaginaryUnit() {
+  throw std::logic_error("imaginaryUnit(): real types have no imaginary unit");
+}
+
+#ifdef WITH_TRILINOS
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<DiscreteBoundaryOperator<ResultType>>
+makeSparseOperator(const LocalOperatorPattern<BasisFunctionType> &pattern,
+                   const std::vector<double> &values) {
+  std::vector<int> rowLengths(pattern.rowCount);
+  for (int row = 0; row < pattern.rowCount; ++row)
+    rowLengths[row] = pattern.rowStarts[row + 1] - pattern.rowStarts[row];
+
+  Epetra_SerialComm comm; // To be replaced once we begin to use MPI
+  Epetra_LocalMap rowMap(pattern.rowCount, 0 /* index_base */, comm);
+  Epetra_LocalMap colMap(pattern.columnCount, 0 /* index_base */, comm);
+  shared_ptr<Epetra_CrsMatrix> result = boost::make_shared<Epetra_CrsMatrix>(
+      Copy, rowMap, colMap, &rowLengths[0], true /* static profile */);
+  for (int row = 0; row < pattern.rowCount; ++row) {
+    if (rowLengths[row] == 0)
+      continue;
+    const int start = pattern.rowStarts[row];
+#ifndef NDEBUG
+    int errorCode =
+#endif
+        result->InsertGlobalValues(row, rowLengths[row], &values[start],
+                                   &pattern.columnIndices[start]);
+    assert(errorCode == 0);
+  }
+  result->FillComplete(colMap, rowMap);
+  return boost::make_shared<DiscreteSparseBoundaryOperator<ResultType>>(
+      result);
+}
+#endif // WITH_TRILINOS
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+WeightedLocalOperator<BasisFunctionType, ResultType>::WeightedLocalOperator(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+    int coefficientOrder)
+    : m_context(context), m_domain(domain), m_dualToRange(dualToRange) {
+  typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+  typedef std::vector<const Fiber::Shapeset<BasisFunctionType> *>
+  ShapesetPtrVector;
+  typedef LocalAssemblerConstructionHelper Helper;
+  typedef WeightedQuadratureVariant<BasisFunctionType> Variant;
+  typedef std::pair<std::pair<const Fiber::Shapeset<BasisFunctionType> *,
+                              const Fiber::Shapeset<BasisFunctionType> *>,
+                    Fiber::SingleQuadratureDescriptor> VariantKey;
+  typedef typename LocalOperatorPattern<BasisFunctionType>::Contribution
+  Contribution;
+
+  if (!context)
+    throw std::invalid_argument(
+        "WeightedLocalOperator::WeightedLocalOperator(): "
+        "context must not be null");
+  if (!domain || !dualToRange)
+    throw std::invalid_argument(
+        "WeightedLocalOperator::WeightedLocalOperator(): "
+        "domain and dualToRange must not be null");
+  if (domain->codomainDimension() != 1 ||
+      dualToRange->codomainDimension() != 1)
+    throw std::invalid_argument(
+        "WeightedLocalOperator::WeightedLocalOperator(): "
+        "functions from domain and dualToRange must be scalar");
+  if (coefficientOrder < 0)
+    throw std::invalid_argument(
+        "WeightedLocalOperator::WeightedLocalOperator(): "
+        "coefficientOrder must not be negative");
+  // As in AbstractBoundaryOperator, a barycentric space moves both spaces
+  // to the refined grid
+  if (domain->isBarycentric() || dualToRange->isBarycentric()) {
+    m_trialSpace = domain->barycentricSpace(domain);
+    m_testSpace = dualToRange->barycentricSpace(dualToRange);
+  } else {
+    m_trialSpace = domain;
+    m_testSpace = dualToRange;
+  }
+  if (m_trialSpace->grid() != m_testSpace->grid())
+    throw std::invalid_argument(
+        "WeightedLocalOperator::WeightedLocalOperator(): "
+        "domain and dualToRange must be defined on the same grid");
+
+  const ParallelizationOptions &parallelOptions =
+      context->assemblyOptions().parallelizationOptions();
+  m_maxThreadCount = 1;
+  if (!parallelOptions.isOpenClEnabled())
+    m_maxThreadCount = parallelOptions.maxThreadCount();
+
+  shared_ptr<const RawGridGeometry> rawGeometry;
+  shared_ptr<GeometryFactory> geometryFactory;
+  shared_ptr<ShapesetPtrVector> testShapesets, trialShapesets;
+  Helper::collectGridData(*m_testSpace, rawGeometry, geometryFactory);
+  Helper::collectShapesets(*m_testSpace, testShapesets);
+  Helper::collectShapesets(*m_trialSpace, trialShapesets);
+  const Fiber::CollectionOfShapesetTransformations<CoordinateType> &
+  testTransformations = m_testSpace->basisFunctionValue();
+  const Fiber::CollectionOfShapesetTransformations<CoordinateType> &
+  trialTransformations = m_trialSpace->basisFunctionValue();
+
+  size_t testBasisDeps = 0, trialBasisDeps = 0;
+  size_t geomDeps = Fiber::GLOBALS | Fiber::INTEGRATION_ELEMENTS;
+  testTransformations.addDependencies(testBasisDeps, geomDeps);
+  trialTransformations.addDependencies(trialBasisDeps, geomDeps);
+
+  // Select the quadrature rules and evaluate the shape functions, once per
+  // rule and pair of shapesets
+  Fiber::DefaultQuadratureDescriptorSelectorForLocalOperators<
+      BasisFunctionType> selector(rawGeometry, testShapesets, trialShapesets,
+                                  Fiber::AccuracyOptionsEx());
+  Fiber::DefaultSingleQuadratureRuleFamily<CoordinateType> ruleFamily;
+  const size_t elementCount = rawGeometry->elementCount();
+  std::map<VariantKey, Variant> variants;
+  std::vector<const Variant *> elementVariants(elementCount);
+  m_elementRules.resize(elementCount);
+  m_pointOffsets.resize(elementCount + 1);
+  m_pointOffsets[0] = 0;
+  for (size_t e = 0; e < elementCount; ++e) {
+    Fiber::SingleQuadratureDescriptor desc = selector.quadratureDescriptor(e);
+    desc.order += coefficientOrder;
+    const VariantKey key(
+        std::make_pair((*testShapesets)[e], (*trialShapesets)[e]), desc);
+    typename std::map<VariantKey, Variant>::iterator it = variants.find(key);
+    if (it == variants.end()) {
+      it = variants.insert(std::make_pair(key, Variant())).first;
+      Variant &variant = it->second;
+      variant.index = m_rulePoints.size();
+      ruleFamily.fillQuadraturePointsAndWeights(desc, variant.points,
+                                                variant.weights);
+      key.first.first->evaluate(testBasisDeps, variant.points,
+                                Fiber::ALL_DOFS, variant.testBasisData);
+      key.first.second->evaluate(trialBasisDeps, variant.points,
+                                 Fiber::ALL_DOFS, variant.trialBasisData);
+      m_rulePoints.push_back(variant.points);
+    }
+    elementVariants[e] = &it->second;
+    m_elementRules[e] = it->second.index;
+    m_pointOffsets[e + 1] = m_pointOffsets[e] + it->second.weights.size();
+  }
+
+  // Map the points to the physical space and evaluate the conjugated test
+  // functions, times the quadrature weights and integration elements, and
+  // the trial functions at them
+  m_points.set_size(rawGeometry->worldDimension(),
+                    m_pointOffsets[elementCount]);
+  std::vector<arma::Mat<BasisFunctionType>> testValues(elementCount);
+  std::vector<arma::Mat<BasisFunctionType>> trialValues(elementCount);
+  Fiber::executeInTaskArena(m_maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, elementCount, 256),
+        [&](const tbb::blocked_range<size_t> &r) {
+          std::unique_ptr<Geometry> geometry(geometryFactory->make());
+          Fiber::GeometricalData<CoordinateType> geomData;
+          Fiber::CollectionOf3dArrays<BasisFunctionType> testData, trialData;
+          for (size_t e = r.begin(); e != r.end(); ++e) {
+            const Variant &variant = *elementVariants[e];
+            rawGeometry->setupGeometry(e, *geometry);
+            geometry->getData(geomDeps, variant.points, geomData);
+            testTransformations.evaluate(variant.testBasisData, geomData,
+                                         testData);
+            trialTransformations.evaluate(variant.trialBasisData, geomData,
+                                          trialData);
+
+            const size_t pointCount = variant.weights.size();
+            if (pointCount > 0)
+              m_points.cols(m_pointOffsets[e], m_pointOffsets[e + 1] - 1) =
+                  geomData.globals;
+            testValues[e].set_size(testData[0].extent(1), pointCount);
+            trialValues[e].set_size(trialData[0].extent(1), pointCount);
+            for (size_t point = 0; point < pointCount; ++point) {
+              const CoordinateType weight =
+                  variant.weights[point] * geomData.integrationElements(point);
+              for (size_t dof = 0; dof < testValues[e].n_rows; ++dof)
+                testValues[e](dof, point) =
+                    conj(testData[0](0, dof, point)) * weight;
+              for (size_t dof = 0; dof < trialValues[e].n_rows; ++dof)
+                trialValues[e](dof, point) = trialData[0](0, dof, point);
+            }
+          }
+        });
+  });
+
+  // Expand the contributions of the local weak forms to each nonzero entry
+  // into contributions of the individual quadrature points
+  m_pattern =
+      sharedLocalOperatorPattern(m_testSpace, m_trialSpace, m_maxThreadCount);
+  const LocalOperatorPattern<BasisFunctionType> &pattern = *m_pattern;
+  const size_t entryCount = pattern.columnIndices.size();
+  m_termStarts.assign(entryCount + 1, 0);
+  for (size_t k = 0; k < entryCount; ++k) {
+    size_t termCount = 0;
+    for (int i = pattern.entryStarts[k]; i < pattern.entryStarts[k + 1]; ++i) {
+      const int e = pattern.contributions[i].element;
+      termCount += m_pointOffsets[e + 1] - m_pointOffsets[e];
+    }
+    m_termStarts[k + 1] = m_termStarts[k] + termCount;
+  }
+  m_termPoints.resize(m_termStarts[entryCount]);
+  m_termFactors.resize(m_termStarts[entryCount]);
+  Fiber::executeInTaskArena(m_maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, entryCount),
+        [&](const tbb::blocked_range<size_t> &r) {
+          for (size_t k = r.begin(); k != r.end(); ++k) {
+            size_t term = m_termStarts[k];
+            for (int i = pattern.entryStarts[k]; i < pattern.entryStarts[k + 1];
+                 ++i) {
+              const Contribution &c = pattern.contributions[i];
+              const arma::Mat<BasisFunctionType> &test = testValues[c.element];
+              const arma::Mat<BasisFunctionType> &trial =
+                  trialValues[c.element];
+              const int testIndex = c.localIndex % test.n_rows;
+              const int trialIndex = c.localIndex / test.n_rows;
+              for (size_t point = 0; point < test.n_cols; ++point, ++term) {
+                m_termPoints[term] = m_pointOffsets[c.element] + point;
+                m_termFactors[term] = c.weight * test(testIndex, point) *
+                                      trial(trialIndex, point);
+              }
+            }
+          }
+        });
+  });
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType>>
+WeightedLocalOperator<BasisFunctionType, ResultType>::domain() const {
+  return m_domain;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType>>
+WeightedLocalOperator<BasisFunctionType, ResultType>::dualToRange() const {
+  return m_dualToRange;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const arma::Mat<typename WeightedLocalOperator<BasisFunctionType,
+                                               ResultType>::CoordinateType> &
+WeightedLocalOperator<BasisFunctionType, ResultType>::quadraturePoints()
+    const {
+  return m_points;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const std::vector<size_t> &
+WeightedLocalOperator<BasisFunctionType, ResultType>::quadraturePointOffsets()
+    const {
+  return m_pointOffsets;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const std::vector<int> &
+WeightedLocalOperator<BasisFunctionType, ResultType>::rowStarts() const {
+  return m_pattern->rowStarts;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const std::vector<int> &
+WeightedLocalOperator<BasisFunctionType, ResultType>::columnIndices() const {
+  return m_pattern->columnIndices;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType>
+WeightedLocalOperator<BasisFunctionType, ResultType>::coefficientValues(
+    const GridFunction<BasisFunctionType, ResultType> &coefficient) const {
+  if (coefficient.componentCount() != 1)
+    throw std::invalid_argument(
+        "WeightedLocalOperator::coefficientValues(): "
+        "coefficient must be scalar");
+  if (coefficient.grid() != m_testSpace->grid())
+    throw std::invalid_argument(
+        "WeightedLocalOperator::coefficientValues(): "
+        "coefficient must be defined on the grid of the spaces");
+
+  arma::Col<ResultType> result(m_points.n_cols);
+  const GridView &view = m_testSpace->gridView();
+  const Mapper &mapper = view.elementMapper();
+  arma::Mat<ResultType> values;
+  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
+  while (!it->finished()) {
+    const Entity<0> &element = it->entity();
+    const int e = mapper.entityIndex(element);
+    if (m_pointOffsets[e + 1] > m_pointOffsets[e]) {
+      coefficient.evaluate(element, m_rulePoints[m_elementRules[e]], values);
+      result.subvec(m_pointOffsets[e], m_pointOffsets[e + 1] - 1) =
+          arma::trans(values.row(0));
+    }
+    it->next();
+  }
+  return result;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void WeightedLocalOperator<BasisFunctionType, ResultType>::fillValues(
+    const arma::Col<ResultType> &coefficients,
+    std::vector<ResultType> &values) const {
+  if (coefficients.n_elem != m_points.n_cols)
+    throw std::invalid_argument(
+        "WeightedLocalOperator::fillValues(): "
+        "the number of coefficients must be equal to the number of "
+        "quadrature points");
+
+  const size_t entryCount = m_termStarts.size() - 1;
+  values.resize(entryCount);
+  Fiber::executeInTaskArena(m_maxThreadCount, [&] {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, entryCount),
+                      [&](const tbb::blocked_range<size_t> &r) {
+                        for (size_t k = r.begin(); k != r.end(); ++k) {
+                          ResultType sum = 0.;
+                          for (size_t i = m_termStarts[k];
+                               i < m_termStarts[k + 1]; ++i)
+                            sum += m_termFactors[i] *
+                                   coefficients[m_termPoints[i]];
+                          values[k] = sum;
+                        }
+                      });
+  });
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<DiscreteBoundaryOperator<ResultType>>
+WeightedLocalOperator<BasisFunctionType, ResultType>::weakForm(
+    const arma::Col<ResultType> &coefficients) const {
+  const LocalOperatorPattern<BasisFunctionType> &pattern = *m_pattern;
+  std::vector<ResultType> values;
+  fillValues(coefficients, values);
+
+#ifdef WITH_TRILINOS
+  if (m_context->assemblyOptions().isSparseStorageOfLocalOperatorsEnabled()) {
+    std::vector<double> realValues(values.size()), imagValues(values.size());
+    bool isReal = true;
+    for (size_t k = 0; k < values.size(); ++k) {
+      realValues[k] = realPart(values[k]);
+      imagValues[k] = imagPart(values[k]);
+      isReal = isReal && imagValues[k] == 0.;
+    }
+    shared_ptr<DiscreteBoundaryOperator<ResultType>> result =
+        makeSparseOperator<BasisFunctionType, ResultType>(pattern,
+                                                          realValues);
+    if (isReal)
+      return result;
+    return boost::make_shared<DiscreteBoundaryOperatorSum<ResultType>>(
+        result,
+        boost::make_shared<ScaledDiscreteBoundaryOperator<ResultType>>(
+            imaginaryUnit<ResultType>(),
+            makeSparseOperator<BasisFunctionType, ResultType>(pattern,
+                                                              imagValues)));
+  }
+#endif
+
+  arma::Mat<ResultType> result(pattern.rowCount, pattern.columnCount);
+  result.fill(0.);
+  for (int row = 0; row < pattern.rowCount; ++row)
+    for (int k = pattern.rowStarts[row]; k < pattern.rowStarts[row + 1]; ++k)
+      result(row, pattern.columnIndices[k]) = values[k];
+  return boost::make_shared<DiscreteDenseBoundaryOperator<ResultType>>(
+      result);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<DiscreteBoundaryOperator<ResultType>>
+WeightedLocalOperator<BasisFunctionType, ResultType>::weakForm(
+    const GridFunction<BasisFunctionType, ResultType> &coefficient) const {
+  return weakForm(coefficientValues(coefficient));
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(WeightedLocalOperator);
+
+} // namespace Bempp
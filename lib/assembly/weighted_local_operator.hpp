@@ -0,0 +1,158 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_weighted_local_operator_hpp
+#define bempp_weighted_local_operator_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType> class Context;
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType> struct LocalOperatorPattern;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup local_operators
+ *  \brief Weak form of an identity operator weighted by a coefficient that
+ *  can be changed cheaply.
+ *
+ *  For a scalar coefficient \f$z\f$, weakForm() returns the matrix with
+ *  entries
+ *  \f[
+ *    \int_\Gamma z(x)\, \overline{\phi_i(x)}\, \psi_j(x) \,\mathrm{d}\Gamma(x),
+ *  \f]
+ *  where \f$\phi_i\f$ are the basis functions of \p dualToRange and
+ *  \f$\psi_j\f$ those of \p domain, as needed e.g. for impedance and Robin
+ *  boundary conditions.
+ *
+ *  The constructor selects the quadrature rules, maps their points to the
+ *  physical space and evaluates the products of the test and trial
+ *  functions at them, and takes the sparsity pattern from the local
+ *  operators defined on the same spaces. Each nonzero entry is then a fixed
+ *  linear combination of the values of \f$z\f$ at the quadrature points,
+ *  and a new coefficient only requires evaluating these combinations, in a
+ *  single parallel pass over the nonzero entries.
+ *
+ *  The coefficient is given either by its values at quadraturePoints() or
+ *  as a GridFunction. The quadrature is exact for polynomial coefficients
+ *  of degree up to \p coefficientOrder on flat elements. */
+template <typename BasisFunctionType, typename ResultType>
+class WeightedLocalOperator {
+public:
+  typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+
+  /** \brief Constructor.
+   *
+   *  Both spaces must be scalar and defined on the same grid. The
+   *  parallelization options of \p context determine the number of threads
+   *  used here and in weakForm(). */
+  WeightedLocalOperator(
+      const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+      const shared_ptr<const Space<BasisFunctionType>> &domain,
+      const shared_ptr<const Space<BasisFunctionType>> &dualToRange,
+      int coefficientOrder = 0);
+
+  shared_ptr<const Space<BasisFunctionType>> domain() const;
+  shared_ptr<const Space<BasisFunctionType>> dualToRange() const;
+
+  /** \brief Physical coordinates of the quadrature points, one per column.
+   *
+   *  The points of the element with index \p e in the element mapper of
+   *  the leaf view of the grid are the columns \p offsets[e], ...,
+   *  <tt>offsets[e + 1] - 1</tt>, where \p offsets is the vector returned
+   *  by quadraturePointOffsets(). If either space is barycentric, the
+   *  elements are those of the barycentrically refined grid. */
+  const arma::Mat<CoordinateType> &quadraturePoints() const;
+  const std::vector<size_t> &quadraturePointOffsets() const;
+
+  /** \brief Sparsity pattern of the weak form in the compressed sparse row
+   *  format, with the column indices sorted within each row. */
+  const std::vector<int> &rowStarts() const;
+  const std::vector<int> &columnIndices() const;
+
+  /** \brief Values of \p coefficient at quadraturePoints().
+   *
+   *  \p coefficient must be scalar and defined on the grid of the spaces
+   *  (on the refined grid if either space is barycentric). */
+  arma::Col<ResultType> coefficientValues(
+      const GridFunction<BasisFunctionType, ResultType> &coefficient) const;
+
+  /** \brief Calculate the nonzero entries of the weak form for the
+   *  coefficient taking the values \p coefficients at quadraturePoints().
+   *
+   *  On output, \p values[k] is the entry stored at position \p k of
+   *  columnIndices(). */
+  void fillValues(const arma::Col<ResultType> &coefficients,
+                  std::vector<ResultType> &values) const;
+
+  /** \brief Weak form for the coefficient taking the values \p
+   *  coefficients at quadraturePoints().
+   *
+   *  The weak form is stored as a sparse matrix if sparse storage of local
+   *  operators is enabled in the assembly options of the context and
+   *  BEM++ has been compiled with Trilinos, and as a dense one otherwise.
+   *  Since Epetra matrices are real, complex weak forms are stored as the
+   *  sum of their real part and i times their imaginary part. */
+  shared_ptr<DiscreteBoundaryOperator<ResultType>>
+  weakForm(const arma::Col<ResultType> &coefficients) const;
+  /** \brief Weak form for the coefficient \p coefficient. */
+  shared_ptr<DiscreteBoundaryOperator<ResultType>>
+  weakForm(const GridFunction<BasisFunctionType, ResultType> &coefficient)
+      const;
+
+private:
+  /** \cond PRIVATE */
+  shared_ptr<const Context<BasisFunctionType, ResultType>> m_context;
+  shared_ptr<const Space<BasisFunctionType>> m_domain;
+  shared_ptr<const Space<BasisFunctionType>> m_dualToRange;
+  // Spaces on the grid of the quadrature points
+  shared_ptr<const Space<BasisFunctionType>> m_trialSpace;
+  shared_ptr<const Space<BasisFunctionType>> m_testSpace;
+  int m_maxThreadCount;
+
+  // Quadrature rules in local coordinates and the rule used on each element
+  std::vector<arma::Mat<CoordinateType>> m_rulePoints;
+  std::vector<int> m_elementRules;
+  arma::Mat<CoordinateType> m_points;
+  std::vector<size_t> m_pointOffsets;
+
+  shared_ptr<const LocalOperatorPattern<BasisFunctionType>> m_pattern;
+  // The kth nonzero entry is the sum of m_termFactors[i] times the
+  // coefficient at the point m_termPoints[i] over i = m_termStarts[k], ...,
+  // m_termStarts[k + 1] - 1
+  std::vector<size_t> m_termStarts;
+  std::vector<size_t> m_termPoints;
+  std::vector<BasisFunctionType> m_termFactors;
+  /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
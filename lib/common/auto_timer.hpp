@@ -21,6 +21,8 @@
 #ifndef bempp_auto_timer_hpp
 #define bempp_auto_timer_hpp
 
+#include "../fiber/profiler.hpp"
+
 #include <string>
 #include <iostream>
 
@@ -30,18 +32,22 @@ namespace Bempp {
 
 /** \ingroup common
  *  \brief Timer that on destruction outputs the time elapsed since
- * construction. */
+ * construction.
+ *
+ * If the Fiber::Profiler is enabled, the lifetime of the timer is also
+ * recorded as a region named by its message. */
 class AutoTimer {
 public:
   /** \brief Constructor.
 
     \param[in] text Message to be printed on destruction. */
   explicit AutoTimer(const char *text = 0)
-      : m_text(text), m_start(tbb::tick_count::now()) {}
+      : m_text(text ? text : ""), m_region(m_text),
+        m_start(tbb::tick_count::now()) {}
 
   /** \overload */
   explicit AutoTimer(const std::string &text = std::string())
-      : m_text(text), m_start(tbb::tick_count::now()) {}
+      : m_text(text), m_region(m_text), m_start(tbb::tick_count::now()) {}
 
   /** \brief Destructor. Print the previously specified message. */
   ~AutoTimer() {
@@ -51,6 +57,7 @@ public:
 
 private:
   std::string m_text;
+  Fiber::ProfileRegion m_region;
   tbb::tick_count m_start;
 };
 
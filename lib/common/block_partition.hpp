@@ -0,0 +1,50 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_block_partition_hpp
+#define bempp_block_partition_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace Bempp {
+
+/** \brief Range of items owned by a part of a contiguous block partition.
+ *
+ *  Splits \p itemCount items into \p partCount consecutive blocks whose
+ *  sizes differ by at most one, the larger blocks coming first, and returns
+ *  the half-open range <tt>[first, second)</tt> of the block number \p part.
+ */
+inline std::pair<std::size_t, std::size_t>
+blockPartitionRange(std::size_t itemCount, int partCount, int part) {
+  if (partCount < 1 || part < 0 || part >= partCount)
+    throw std::invalid_argument("blockPartitionRange(): invalid part");
+  const std::size_t base = itemCount / partCount;
+  const std::size_t remainder = itemCount % partCount;
+  const std::size_t p = part;
+  const std::size_t begin = p * base + std::min(p, remainder);
+  return std::make_pair(begin, begin + base + (p < remainder ? 1 : 0));
+}
+
+} // namespace Bempp
+
+#endif
@@ -35,7 +35,7 @@ ParameterList GlobalParameters::parameterList() {
 
   parameters.set("boundaryOperatorAssemblyType", std::string("dense"),
                   "(string) Default assembly type for boundary operators. "
-                  "Allowed values are dense and hmat.");
+                  "Allowed values are dense, hmat and fmm.");
 
   parameters.set("potentialOperatorAssemblyType", std::string("dense"),
           "(string) Default assembly type for potential oeprators. "
@@ -51,6 +51,41 @@ ParameterList GlobalParameters::parameterList() {
           "(bool) If true then singular integrals are pre-calculated and cached "
           "before the boundary operator assembly");
 
+  parameters.set("enableBarycentricOperatorReuse",
+          false,
+          "(bool) If true then integral operators acting on spaces defined "
+          "on barycentric grids are assembled in discontinuous spaces shared "
+          "by all such spaces and reused through sparse transformations");
+
+  parameters.set("singularIntegralStoreDirectory",
+          std::string(""),
+          "(string) Existing directory in which cached singular integrals "
+          "are stored on disk and looked up when the same operator is "
+          "assembled again on the same mesh, also by other processes. "
+          "An empty string disables the store.");
+
+  parameters.set("weakFormCacheMemoryBudget",
+          static_cast<double>(0),
+          "(double) Memory in MB for which weak forms of boundary operators "
+          "are kept alive by the weak-form cache of a context after all "
+          "operators using them are destroyed. Weak forms that are still in "
+          "use are shared in any case. Least recently used weak forms are "
+          "released first.");
+
+  parameters.set("memoryBudget",
+          static_cast<double>(0),
+          "(double) Memory in MB that the discrete operators and caches "
+          "recorded by the memory registry may occupy in total; 0 means no "
+          "budget. Before a dense weak form is assembled that would exceed "
+          "it, retained weak forms are released. Dense weak forms that still "
+          "do not fit are handled as specified by memoryBudgetFallback.");
+
+  parameters.set("memoryBudgetFallback",
+          std::string("hmat"),
+          "(string) What to do with a dense weak form that does not fit in "
+          "memoryBudget. Allowed values are hmat (assemble it as an H-matrix) "
+          "and none (throw an exception).");
+
 
   parameters.set("enableBlasInQuadrature",
           std::string("auto"),
@@ -69,6 +104,26 @@ ParameterList GlobalParameters::parameterList() {
   quadratureOrders.set("doubleSingular",static_cast<int>(0),
           "(int) Order for singular double integrals.");
 
+  quadratureOrders.set("adaptiveTolerance",static_cast<double>(0),
+          "(double) If positive, lower the orders of regular double integrals "
+          "to the smallest ones whose estimated relative error does not exceed "
+          "this tolerance. The orders given below remain upper bounds.");
+
+  quadratureOrders.set("adaptiveKernelDerivativeOrder",static_cast<int>(0),
+          "(int) Number of derivatives of 1/r in the kernel assumed by the "
+          "error estimate of adaptiveTolerance (0 for single-layer, 1 for "
+          "double-layer kernels).");
+
+  quadratureOrders.set("splitSingularKernels",static_cast<bool>(false),
+          "(bool) Integrate the singular part of kernels such as the modified "
+          "Helmholtz single-layer kernel over adjacent elements separately "
+          "from their bounded remainder; the singular part does not depend on "
+          "the wave number.");
+
+  quadratureOrders.set("smoothPartOrderIncrement",static_cast<int>(2),
+          "(int) Increase above the shapeset order of the quadrature order "
+          "used for the bounded remainder of split kernels.");
+
   auto createQuadratureOptions = [&quadratureOrders](const std::string name,
           double relDist, int singleOrder, int doubleOrder) {
 
@@ -95,6 +150,24 @@ ParameterList GlobalParameters::parameterList() {
 
   quadratureOrders.sublist("far").remove("maxRelDist");
 
+  ParameterList& denseParameters = parameters.sublist("DenseAssembly");
+
+  denseParameters.set("distributed", false,
+          "(bool) If true then dense weak forms are distributed over the "
+          "processes of MPI_COMM_WORLD in a two-dimensional block-cyclic "
+          "layout, and each process integrates only the element pairs "
+          "contributing to its own blocks. Vectors remain replicated on all "
+          "processes. DefaultDirectSolver factorizes such weak forms with "
+          "ScaLAPACK if BEM++ is compiled with it (WITH_SCALAPACK). Requires "
+          "BEM++ to be compiled with MPI support.");
+  denseParameters.set("blockSize", static_cast<int>(64),
+          "(int) Order of the square blocks of the block-cyclic layout of "
+          "distributed dense weak forms.");
+  denseParameters.set("processRows", static_cast<int>(0),
+          "(int) Number of rows of the process grid of distributed dense "
+          "weak forms, which must divide the number of processes. If not "
+          "positive, the grid is chosen as square as possible.");
+
   ParameterList& hmatParameters = parameters.sublist("HMat");
 
   hmatParameters.set("HMatAssemblyMode", std::string("GlobalAssembly"),
@@ -113,6 +186,24 @@ ParameterList GlobalParameters::parameterList() {
   hmatParameters.set("eta", static_cast<double>(1.2),
                      "(double) Specifies the block separation parameter eta");
 
+  hmatParameters.set("highFrequencyEta", static_cast<double>(0),
+          "(double) If positive, blocks of operators with oscillatory kernels "
+          "(Helmholtz and Maxwell) are only admissible if in addition "
+          "k * diam^2 < highFrequencyEta * dist, where k is the wave number "
+          "and diam the larger cluster diameter. This keeps the ranks "
+          "bounded independently of the frequency, at the cost of more and "
+          "smaller blocks. Blocks of far-field operators are then admissible "
+          "if k * diam1 * diam2 < highFrequencyEta. A value of about 1 is "
+          "recommended for objects larger than a few wavelengths.");
+
+  hmatParameters.set("admissibility", std::string("standard"),
+          "(string) Admissibility condition of the block cluster trees of "
+          "boundary operators. \"standard\" uses eta (and highFrequencyEta). "
+          "\"weak\" makes every block that does not couple a cluster with "
+          "itself admissible; the resulting HODLR matrices have a much "
+          "simpler structure for elongated geometries and can be factorised "
+          "by the HODLR direct solver (see DefaultDirectSolver).");
+
   hmatParameters.set("eps", static_cast<double>(1E-3),
           "(double) Specifies the accuracy of low-rank approximations");
 
@@ -120,7 +211,171 @@ ParameterList GlobalParameters::parameterList() {
           "(int) maximum rank of a low rank subblock");
 
   hmatParameters.set("defaultCompressionAlg",std::string("aca"),
-          "(string) Compression Algorithm");
+          "(string) Compression Algorithm. Allowed values are aca "
+          "(partially pivoted ACA), aca+ (ACA with reference row and "
+          "column), dense and interpolation (Chebyshev interpolation of "
+          "Laplace and modified Helmholtz kernels in the cluster boxes; "
+          "other operators fall back to aca).");
+  hmatParameters.set("acaPivotBatchSize", static_cast<int>(1),
+          "(int) Number of pivot rows that partially pivoted ACA evaluates "
+          "together in one batch. The value 1 gives the classical ACA.");
+  hmatParameters.set("acaWarmStart", false,
+          "(bool) If true then partially pivoted ACA starts every block "
+          "from the pivot rows found by the previous ACA compression on the "
+          "same block cluster tree, e.g. of the same operator at a nearby "
+          "wave number in a frequency sweep, and preallocates the factors "
+          "for the rank found then. Requires cacheClusterTrees. The accuracy "
+          "is still controlled by eps.");
+  hmatParameters.set("interpolationOrder", static_cast<int>(5),
+          "(int) Number of Chebyshev nodes per dimension of the "
+          "interpolation in every cluster box if defaultCompressionAlg is "
+          "interpolation. The blocks are recompressed to the accuracy eps, "
+          "but the interpolation error itself is controlled by this order.");
+  hmatParameters.set("interpolationQuadratureOrder", static_cast<int>(4),
+          "(int) Accuracy order of the quadrature rule used to integrate the "
+          "interpolants against the basis functions if "
+          "defaultCompressionAlg is interpolation.");
+  hmatParameters.set("maxRankPolicy", std::string("truncate"),
+          "(string) Treatment of admissible blocks for which ACA reaches "
+          "maxRank without converging. Possible values: truncate (keep the "
+          "approximation of rank maxRank) and adaptive (evaluate the block "
+          "completely and store it as a truncated SVD of the rank required "
+          "for eps, or densely if that is smaller).");
+  hmatParameters.set("epsReference", std::string("block"),
+          "(string) Norm to which eps refers. Possible values: block (every "
+          "block is approximated to the relative accuracy eps) and matrix "
+          "(the tolerance of every block is scaled so that the error of the "
+          "whole matrix is about eps times its Frobenius norm, estimated "
+          "from the inadmissible blocks).");
+
+  hmatParameters.set("cacheClusterTrees", true,
+          "(bool) If true then the cluster trees and block cluster trees are "
+          "cached in the assembly context and reused for all operators "
+          "assembled on the same spaces with the same block parameters.");
+  hmatParameters.set("recompress", false,
+          "(bool) If true then all low-rank blocks are recompressed by a "
+          "truncated SVD to the accuracy given by \"eps\" after assembly.");
+  hmatParameters.set("frozenLayout", false,
+          "(bool) If true then the leaf blocks of the assembled H-matrix are "
+          "packed into one contiguous, row-sorted array for faster matvecs. "
+          "A frozen H-matrix can only be applied.");
+  hmatParameters.set("outOfCoreDirectory", std::string(""),
+          "(string) If not empty then the leaf payloads of the assembled "
+          "H-matrix are written, batch by batch during the compression, to "
+          "a scratch file in this directory, which is then mapped into "
+          "memory and read ahead during matvecs. This allows H-matrices "
+          "larger than the RAM. The H-matrix is frozen; low-rank blocks are "
+          "recompressed before they are written if \"recompress\" is set, "
+          "\"lowRankStoragePrecision\" and \"blockSparseNearField\" are "
+          "ignored, and it cannot be combined with \"h2Matrix\" or "
+          "\"distributed\".");
+  hmatParameters.set("blockSparseNearField", false,
+          "(bool) If true then all inadmissible blocks of the assembled "
+          "H-matrix are moved out of the tree into one block-sparse matrix, "
+          "which is applied in a single pass and is available as a "
+          "near-field operator for preconditioning. Such H-matrices cannot "
+          "be saved.");
+  hmatParameters.set("groupedLowRankApply", false,
+          "(bool) If true then all low-rank blocks of the assembled H-matrix "
+          "are moved out of the tree into one matrix storing their factors "
+          "grouped by row and column cluster, so that matvecs form one "
+          "large matrix product per cluster instead of two small ones per "
+          "block. Such H-matrices cannot be saved. The parameter is ignored "
+          "if \"lowRankStoragePrecision\" is single.");
+  hmatParameters.set("lowRankStoragePrecision", std::string("full"),
+          "(string) Precision in which the factors of low-rank blocks are "
+          "stored. Allowed values are full (the precision of the operator) "
+          "and single. In single precision the products with the factors are "
+          "accumulated in the precision of the operator.");
+  hmatParameters.set("denseStorageBits", 0,
+          "(int) If positive then the dense blocks of the assembled H-matrix "
+          "are stored with this many bits (8, 16, 24 or 32) per real value "
+          "by a fixed-rate block floating-point codec and decoded on the fly "
+          "in matvecs. 16 bits reduce the memory of double precision dense "
+          "blocks fourfold at a relative error of about 1e-5 per entry. "
+          "\"blockSparseNearField\" and \"frozenLayout\" are then ignored, "
+          "and the parameter is ignored by \"outOfCoreDirectory\" and "
+          "\"h2Matrix\".");
+  hmatParameters.set("h2Matrix", false,
+          "(bool) If true then the assembled H-matrix is converted into an "
+          "H2-matrix with nested cluster bases, accurate to \"eps\" relative "
+          "to each block. The H-matrix is released after the conversion, and "
+          "\"lowRankStoragePrecision\", \"blockSparseNearField\" and "
+          "\"frozenLayout\" are ignored.");
+  hmatParameters.set("distributed", false,
+          "(bool) If true then the leaves of the H-matrix are distributed "
+          "over the processes of MPI_COMM_WORLD, each of which compresses and "
+          "stores only its own part. Vectors remain replicated on all "
+          "processes. Requires BEM++ to be compiled with MPI support.");
+  hmatParameters.set("symmetricStorage", false,
+          "(bool) If true then only the leaves in the lower block triangle "
+          "of the H-matrices of symmetric or Hermitian operators whose test "
+          "and trial spaces coincide are compressed and stored; matvecs use "
+          "every off-diagonal leaf for both of its contributions. This "
+          "halves the assembly time and the memory of the off-diagonal "
+          "blocks. Such H-matrices can be factorised by the hierarchical "
+          "Cholesky decomposition but cannot be saved, merged or updated. "
+          "The parameter is ignored together with \"h2Matrix\", "
+          "\"distributed\", \"outOfCoreDirectory\", "
+          "\"blockSparseNearField\", \"groupedLowRankApply\" and "
+          "\"frozenLayout\".");
+  hmatParameters.set("statisticsFile", std::string(""),
+          "(string) If not empty then the block structure, rank histogram, "
+          "per-level memory and per-block assembly times of every assembled "
+          "H-matrix are written to this file in JSON format. In distributed "
+          "mode the rank of the process is appended to the file name.");
+  hmatParameters.set("checkpointFile", std::string(""),
+          "(string) If not empty then the compressed leaves of every "
+          "assembled H-matrix are appended to this file while the "
+          "compression runs. An assembly of the same operator with the same "
+          "H-matrix parameters restarted after an interruption takes the "
+          "leaves found in the file from it and only compresses the missing "
+          "ones; a file written for another matrix is overwritten. In "
+          "distributed mode the rank of the process is appended to the file "
+          "name.");
+  hmatParameters.set("checkpointInterval", static_cast<double>(60),
+          "(double) Minimum number of seconds between two writes of the "
+          "leaves compressed since the last write to \"checkpointFile\"; 0 "
+          "writes every leaf at once.");
+
+  ParameterList& fmmParameters = parameters.sublist("FMM");
+
+  fmmParameters.set(
+      "minBlockSize", static_cast<int>(50),
+      "(int) Specifies the maximum number of DOFs in a leaf cluster of the "
+      "FMM cluster trees");
+  fmmParameters.set("eta", static_cast<double>(1.0),
+          "(double) Specifies the separation parameter eta. A block is "
+          "evaluated by the FMM if the larger diameter of its clusters is "
+          "below eta times their distance; all other blocks near the "
+          "diagonal are assembled and stored.");
+  fmmParameters.set("interpolationOrder", static_cast<int>(5),
+          "(int) Number of Chebyshev nodes per dimension of the "
+          "interpolation in every cluster box. The memory needed grows with "
+          "its cube and the cost of the far-field evaluation with its sixth "
+          "power.");
+  fmmParameters.set("quadratureOrder", static_cast<int>(4),
+          "(int) Accuracy order of the quadrature rule used to integrate the "
+          "interpolants against the basis functions.");
+  fmmParameters.set("storeM2LMatrices", false,
+          "(bool) If true then the interaction matrices of all admissible "
+          "blocks are stored, which speeds up the matvec at a memory cost "
+          "of interpolationOrder^6 values per block; otherwise they are "
+          "evaluated on the fly.");
+
+  ParameterList& farFieldParameters = parameters.sublist("FarField");
+
+  farFieldParameters.set(
+      "clusterSize", static_cast<int>(100),
+      "(int) Specifies the maximum number of DOFs in a cluster. Larger "
+      "clusters need finer sampling grids.");
+  farFieldParameters.set("samplingFactor", static_cast<double>(3.0),
+          "(double) Number of samples of the polar angle per unit of the "
+          "angular bandwidth of the cluster far fields; the azimuth is "
+          "sampled twice as finely.");
+  farFieldParameters.set("interpolationOrder", static_cast<int>(8),
+          "(int) Number of samples per angle used to interpolate the far "
+          "field in a direction.");
 
   return parameters;
 }
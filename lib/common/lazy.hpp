@@ -21,52 +21,62 @@
 #ifndef bempp_lazy_hpp
 #define bempp_lazy_hpp
 
-// After Intel(R) Threading Building Blocks Design Patterns, modified
-
-#include <tbb/atomic.h>
-#include <tbb/mutex.h>
-#include <memory>
+#include <atomic>
+#include <mutex>
 
 namespace Bempp {
 
 /** \ingroup common
- *  \brief Thread-safe wrapper of a lazily inititialised object.
-
-  \tparam T           Type of the stored object.
-  \tparam Initializer Type of a copy-constructible functor providing the
-                      member function
-                        std::unique_ptr<T> operator()()
-                      that will be used to construct the object the first time
-                      it is requested.
-  \tparam Mutex       Type of the mutex to be used to lock the object during
-                      initialisation.
-*/
-template <typename T, typename Initializer, typename Mutex = tbb::mutex>
-class Lazy {
+ *  \brief Thread-safe wrapper of a lazily initialised object.
+ *
+ *  The object is constructed by the initializer passed to the first call
+ *  of get(); later calls return it after a single atomic load with acquire
+ *  semantics, without locking. Concurrent first calls are serialised by
+ *  \c std::call_once, so the initializer runs exactly once; if it throws,
+ *  the next call of get() tries again.
+ *
+ *  \tparam T Type of the stored object; it must be default-constructible
+ *           and move-assignable. Typically a (shared or unique) pointer.
+ *
+ *  Lazy members of classes are normally declared \c mutable only through
+ *  this wrapper, whose get() is a const member function:
+ *  \code
+ *  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
+ *  ...
+ *  return m_discontinuousSpace.get([&]() {
+ *      return boost::make_shared<DiscontinuousSpace>(this->grid()); });
+ *  \endcode
+ */
+template <typename T> class Lazy {
 public:
-  Lazy(const Initializer &init) : m_init(init), m_value() {}
+  Lazy() : m_initialized(false), m_value() {}
 
-  ~Lazy() { delete m_value; }
+  Lazy(const Lazy &) = delete;
+  Lazy &operator=(const Lazy &) = delete;
 
-  T &get() {
-    if (!m_value) {
-      typename Mutex::scoped_lock lock(m_mutex);
-      if (!m_value) {
-        std::unique_ptr<T> t = m_init();
-        m_value = t.release();
-      }
-    }
-    return *m_value;
+  /** \brief Return the stored object, constructing it first with
+   *  <tt>init()</tt> if necessary.
+   *
+   *  \p init must be callable without arguments and return a value
+   *  convertible to \p T. */
+  template <typename Initializer> const T &get(Initializer &&init) const {
+    if (!m_initialized.load(std::memory_order_acquire))
+      std::call_once(m_flag, [&]() {
+        m_value = init();
+        m_initialized.store(true, std::memory_order_release);
+      });
+    return m_value;
   }
 
-  T &operator*() { return get(); }
-
-  T *operator->() { return &get(); }
+  /** \brief Return true if the object has already been constructed. */
+  bool isInitialized() const {
+    return m_initialized.load(std::memory_order_acquire);
+  }
 
 private:
-  Initializer m_init;
-  tbb::atomic<T *> m_value;
-  Mutex m_mutex;
+  mutable std::once_flag m_flag;
+  mutable std::atomic<bool> m_initialized;
+  mutable T m_value;
 };
 
 } // namespace Bempp
@@ -0,0 +1,49 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_mpi_datatype_hpp
+#define bempp_mpi_datatype_hpp
+
+#include "bempp/common/config_mpi.hpp"
+
+#ifdef WITH_MPI
+
+#include <mpi.h>
+
+#include <complex>
+
+namespace Bempp {
+
+/** \brief MPI datatype of the scalar type \p ValueType. */
+template <typename ValueType> MPI_Datatype mpiDatatype();
+template <> inline MPI_Datatype mpiDatatype<float>() { return MPI_FLOAT; }
+template <> inline MPI_Datatype mpiDatatype<double>() { return MPI_DOUBLE; }
+template <> inline MPI_Datatype mpiDatatype<std::complex<float>>() {
+  return MPI_C_FLOAT_COMPLEX;
+}
+template <> inline MPI_Datatype mpiDatatype<std::complex<double>>() {
+  return MPI_C_DOUBLE_COMPLEX;
+}
+
+} // namespace Bempp
+
+#endif // WITH_MPI
+
+#endif
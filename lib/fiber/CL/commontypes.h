@@ -17,4 +17,9 @@ typedef struct { // see opencl_framework.hpp for details
     __global const int *cl_elbuf;
 } MeshGeom;
 
+typedef struct { // layout-compatible with std::complex<ValueType>
+    ValueType re;
+    ValueType im;
+} ComplexValue;
+
 #endif
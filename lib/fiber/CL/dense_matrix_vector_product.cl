@@ -0,0 +1,86 @@
+// -*-C++-*-
+
+/**
+ * \file dense_matrix_vector_product.cl
+ * CL code for multiplying a dense matrix stored in device memory by a vector
+ */
+
+/**
+ * \brief Product of a real matrix or its transpose with a vector
+ *
+ * One work item computes one element of the result.
+ *
+ * \param rowCount number of rows of the matrix
+ * \param colCount number of columns of the matrix
+ * \param transposed if nonzero, multiply by the transpose of the matrix
+ * \param g_mat matrix (rowCount x colCount, column-major)
+ * \param g_x input vector [transposed ? rowCount : colCount]
+ * \param g_y output vector [transposed ? colCount : rowCount]
+ */
+__kernel void clDenseMatVec (
+	int rowCount,
+	int colCount,
+	int transposed,
+	__global const ValueType *g_mat,
+	__global const ValueType *g_x,
+	__global ValueType *g_y)
+{
+    int i, j;
+    int row = get_global_id(0);
+    ValueType sum = 0;
+
+    if (transposed) {
+        if (row >= colCount) return;
+	__global const ValueType *col = g_mat + row*rowCount;
+	for (i = 0; i < rowCount; i++)
+	    sum += col[i] * g_x[i];
+    } else {
+        if (row >= rowCount) return;
+	for (j = 0; j < colCount; j++)
+	    sum += g_mat[row + j*rowCount] * g_x[j];
+    }
+    g_y[row] = sum;
+}
+
+/**
+ * \brief Product of a complex matrix, its transpose, conjugate or conjugate
+ *   transpose with a vector
+ *
+ * \param conjugated if nonzero, use the complex conjugate of the matrix
+ * \note The other parameters have the same meaning as in clDenseMatVec.
+ */
+__kernel void clDenseMatVecComplex (
+	int rowCount,
+	int colCount,
+	int transposed,
+	int conjugated,
+	__global const ComplexValue *g_mat,
+	__global const ComplexValue *g_x,
+	__global ComplexValue *g_y)
+{
+    int i, j;
+    int row = get_global_id(0);
+    ValueType sign = conjugated ? -1 : 1;
+    ComplexValue a, x, sum;
+    sum.re = sum.im = 0;
+
+    if (transposed) {
+        if (row >= colCount) return;
+	__global const ComplexValue *col = g_mat + row*rowCount;
+	for (i = 0; i < rowCount; i++) {
+	    a = col[i];
+	    x = g_x[i];
+	    sum.re += a.re*x.re - sign*a.im*x.im;
+	    sum.im += a.re*x.im + sign*a.im*x.re;
+	}
+    } else {
+        if (row >= rowCount) return;
+	for (j = 0; j < colCount; j++) {
+	    a = g_mat[row + j*rowCount];
+	    x = g_x[j];
+	    sum.re += a.re*x.re - sign*a.im*x.im;
+	    sum.im += a.re*x.im + sign*a.im*x.re;
+	}
+    }
+    g_y[row] = sum;
+}
@@ -0,0 +1,85 @@
+// -*-C++-*-
+
+/**
+ * \file modified_helmholtz_3d_potential.cl
+ * CL code for evaluating Laplace and modified Helmholtz single- and
+ * double-layer potentials at a batch of points by direct summation over
+ * the trial quadrature points
+ */
+
+// Kernel variants; must match the values of Fiber::KernelTileType
+#define SINGLE_LAYER_TILE 0
+#define DOUBLE_LAYER_TILE 1
+
+/**
+ * \brief Evaluate a potential at a batch of points
+ *
+ * One work item handles one point x and computes
+ * sum_q K(x, y_q) d_q, where y_q are the trial quadrature points and d_q
+ * the density values multiplied by the quadrature weights and
+ * integration elements. K is exp(-k r) / (4 pi r) or its normal
+ * derivative at y_q.
+ *
+ * \param type kernel variant (SINGLE_LAYER_TILE or DOUBLE_LAYER_TILE)
+ * \param kre real part of the wave number
+ * \param kim imaginary part of the wave number
+ * \param quadPointCount number of trial quadrature points
+ * \param g_quadPoints trial quadrature points (3 x quadPointCount,
+ *   column-major)
+ * \param g_quadNormals unit normals at the trial quadrature points
+ *   (3 x quadPointCount, column-major); only read by the double layer
+ * \param g_densities weighted densities d_q [quadPointCount]
+ * \param pointCount number of evaluation points
+ * \param g_points evaluation points (3 x pointCount, column-major)
+ * \param g_result potential at the evaluation points [pointCount]
+ */
+__kernel void clModifiedHelmholtz3dPotential (
+	int type,
+	ValueType kre,
+	ValueType kim,
+	int quadPointCount,
+	__global const ValueType *g_quadPoints,
+	__global const ValueType *g_quadNormals,
+	__global const ComplexValue *g_densities,
+	int pointCount,
+	__global const ValueType *g_points,
+	__global ComplexValue *g_result)
+{
+    int q, i;
+    int pt = get_global_id(0);
+    ValueType x[3], d[3], r2, r, e, c, s, f;
+    ComplexValue g, dens, sum;
+    sum.re = sum.im = 0;
+
+    if (pt >= pointCount) return;
+    for (i = 0; i < 3; i++)
+        x[i] = g_points[pt*3+i];
+
+    for (q = 0; q < quadPointCount; q++) {
+        r2 = 0;
+	for (i = 0; i < 3; i++) {
+	    d[i] = g_quadPoints[q*3+i] - x[i];
+	    r2 += d[i]*d[i];
+	}
+	r = sqrt (r2);
+	e = exp (-kre*r) / (4.0*M_PI*r);
+	c = cos (kim*r);
+	s = sin (kim*r);
+	g.re = e * c;
+	g.im = -e * s;
+	if (type == DOUBLE_LAYER_TILE) {
+	    // -(d.n) / r * (k + 1/r) * g
+	    f = -(d[0]*g_quadNormals[q*3] + d[1]*g_quadNormals[q*3+1] +
+		  d[2]*g_quadNormals[q*3+2]) / r;
+	    e = kre + 1.0 / r;
+	    c = f * (e*g.re - kim*g.im);
+	    s = f * (e*g.im + kim*g.re);
+	    g.re = c;
+	    g.im = s;
+	}
+	dens = g_densities[q];
+	sum.re += g.re*dens.re - g.im*dens.im;
+	sum.im += g.re*dens.im + g.im*dens.re;
+    }
+    g_result[pt] = sum;
+}
@@ -0,0 +1,194 @@
+// -*-C++-*-
+
+/**
+ * \file regular_scalar_double_integrator.cl
+ * CL code for integrating Laplace and modified Helmholtz kernels over
+ * regular (well-separated) pairs of flat triangular elements
+ */
+
+// Kernel variants; must match the values of Fiber::KernelTileType
+#define SINGLE_LAYER_TILE 0
+#define DOUBLE_LAYER_TILE 1
+#define ADJOINT_DOUBLE_LAYER_TILE 2
+
+// Maximum number of shape functions per element
+#define MAX_DOF_COUNT 6
+
+/**
+ * \brief Geometry of a flat triangle
+ * \param origin [out] coordinates of the first vertex [3]
+ * \param edge0 [out] vector from the first to the second vertex [3]
+ * \param edge1 [out] vector from the first to the third vertex [3]
+ * \param normal [out] unit normal, oriented as in Bempp::Geometry [3]
+ * \return integration element (twice the area of the triangle)
+ */
+ValueType devTriangleGeometry (
+	MeshParam prm,
+	__global const ValueType *g_meshVtx,
+	__global const int *g_meshIdx,
+	int elIdx,
+	ValueType *origin,
+	ValueType *edge0,
+	ValueType *edge1,
+	ValueType *normal)
+{
+    int i;
+    int v0 = g_meshIdx[elIdx*prm.nidx];
+    int v1 = g_meshIdx[elIdx*prm.nidx+1];
+    int v2 = g_meshIdx[elIdx*prm.nidx+2];
+    for (i = 0; i < 3; i++) {
+        origin[i] = g_meshVtx[v0*prm.dim+i];
+	edge0[i] = g_meshVtx[v1*prm.dim+i] - origin[i];
+	edge1[i] = g_meshVtx[v2*prm.dim+i] - origin[i];
+    }
+    normal[0] = edge0[1]*edge1[2] - edge0[2]*edge1[1];
+    normal[1] = edge0[2]*edge1[0] - edge0[0]*edge1[2];
+    normal[2] = edge0[0]*edge1[1] - edge0[1]*edge1[0];
+    ValueType size = sqrt (normal[0]*normal[0] + normal[1]*normal[1] +
+			   normal[2]*normal[2]);
+    for (i = 0; i < 3; i++)
+        normal[i] /= size;
+    return size;
+}
+
+/**
+ * \brief Laplace or modified Helmholtz kernel for a single point pair
+ * \param type kernel variant (SINGLE_LAYER_TILE etc.)
+ * \param kre real part of the wave number
+ * \param kim imaginary part of the wave number
+ * \param x test point [3]
+ * \param y trial point [3]
+ * \param nx unit normal at the test point [3]
+ * \param ny unit normal at the trial point [3]
+ * \note The single-layer kernel is exp(-k r) / (4 pi r); the double-layer
+ *   kernels are its normal derivatives at y and x, respectively.
+ */
+ComplexValue devModifiedHelmholtz3dKernel (
+	int type,
+	ValueType kre,
+	ValueType kim,
+	const ValueType *x,
+	const ValueType *y,
+	const ValueType *nx,
+	const ValueType *ny)
+{
+    int i;
+    ValueType d[3], r2 = 0, r, e, f, dn = 0;
+    ComplexValue g, h;
+    for (i = 0; i < 3; i++) {
+        d[i] = y[i] - x[i];
+	r2 += d[i]*d[i];
+    }
+    r = sqrt (r2);
+    e = exp (-kre*r) / (4.0*M_PI*r);
+    g.re = e * cos (kim*r);
+    g.im = -e * sin (kim*r);
+    if (type == SINGLE_LAYER_TILE)
+        return g;
+
+    for (i = 0; i < 3; i++)
+        dn += type == DOUBLE_LAYER_TILE ? d[i]*ny[i] : -d[i]*nx[i];
+    // -(d.n) / r * (k + 1/r) * g
+    f = -dn / r;
+    kre += 1.0 / r;
+    h.re = f * (kre*g.re - kim*g.im);
+    h.im = f * (kre*g.im + kim*g.re);
+    return h;
+}
+
+/**
+ * \brief Integrate a kernel over a list of element pairs
+ *
+ * One work item handles one pair. The result for pair i is the
+ * testDofCount x trialDofCount matrix (stored column-major)
+ * sum_{p,q} w_p w_q mu_p nu_q conj(test(:,p)) K(x_p, y_q) trial(:,q).
+ *
+ * \param g_testPoints local coordinates of the test quadrature points
+ *   (2 x testPointCount, column-major)
+ * \param g_testWeights test quadrature weights [testPointCount]
+ * \param g_testValues transformed test shape functions at the quadrature
+ *   points (testDofCount x testPointCount, column-major)
+ * \param g_pairs test and trial element index of each pair [2*pairCount]
+ * \param g_result integrals [testDofCount*trialDofCount*pairCount]
+ */
+__kernel void clIntegrateRegularPairs (
+	MeshParam prm,
+	__global const ValueType *g_meshVtx,
+	__global const int *g_meshIdx,
+	__global const ValueType *g_testPoints,
+	__global const ValueType *g_testWeights,
+	int testPointCount,
+	__global const ValueType *g_trialPoints,
+	__global const ValueType *g_trialWeights,
+	int trialPointCount,
+	__global const ComplexValue *g_testValues,
+	int testDofCount,
+	__global const ComplexValue *g_trialValues,
+	int trialDofCount,
+	int kernelType,
+	ValueType waveNumberRe,
+	ValueType waveNumberIm,
+	__global const int *g_pairs,
+	int pairCount,
+	__global ComplexValue *g_result)
+{
+    int i, j, k, p, q;
+    int pair = get_global_id(0);
+    if (pair >= pairCount) return;
+
+    ValueType testOrigin[3], testEdge0[3], testEdge1[3], testNormal[3];
+    ValueType trialOrigin[3], trialEdge0[3], trialEdge1[3], trialNormal[3];
+    ValueType testIntElement = devTriangleGeometry (
+        prm, g_meshVtx, g_meshIdx, g_pairs[2*pair],
+	testOrigin, testEdge0, testEdge1, testNormal);
+    ValueType trialIntElement = devTriangleGeometry (
+        prm, g_meshVtx, g_meshIdx, g_pairs[2*pair+1],
+	trialOrigin, trialEdge0, trialEdge1, trialNormal);
+
+    ComplexValue sum[MAX_DOF_COUNT*MAX_DOF_COUNT];
+    for (i = 0; i < testDofCount*trialDofCount; i++)
+        sum[i].re = sum[i].im = 0;
+
+    ValueType x[3], y[3];
+    for (q = 0; q < trialPointCount; q++) {
+        for (k = 0; k < 3; k++)
+	    y[k] = trialOrigin[k] + g_trialPoints[2*q]*trialEdge0[k] +
+	        g_trialPoints[2*q+1]*trialEdge1[k];
+
+	// partial[i] = sum_p w_p mu_p conj(test(i,p)) K(x_p, y_q)
+	ComplexValue partial[MAX_DOF_COUNT];
+	for (i = 0; i < testDofCount; i++)
+	    partial[i].re = partial[i].im = 0;
+	for (p = 0; p < testPointCount; p++) {
+	    for (k = 0; k < 3; k++)
+	        x[k] = testOrigin[k] + g_testPoints[2*p]*testEdge0[k] +
+		    g_testPoints[2*p+1]*testEdge1[k];
+	    ComplexValue kv = devModifiedHelmholtz3dKernel (
+	        kernelType, waveNumberRe, waveNumberIm, x, y,
+		testNormal, trialNormal);
+	    ValueType w = g_testWeights[p] * testIntElement;
+	    kv.re *= w;
+	    kv.im *= w;
+	    for (i = 0; i < testDofCount; i++) {
+	        ComplexValue t = g_testValues[i + p*testDofCount];
+		partial[i].re += t.re*kv.re + t.im*kv.im;
+		partial[i].im += t.re*kv.im - t.im*kv.re;
+	    }
+	}
+
+	ValueType w = g_trialWeights[q] * trialIntElement;
+	for (j = 0; j < trialDofCount; j++) {
+	    ComplexValue t = g_trialValues[j + q*trialDofCount];
+	    t.re *= w;
+	    t.im *= w;
+	    for (i = 0; i < testDofCount; i++) {
+	        sum[i + j*testDofCount].re += partial[i].re*t.re - partial[i].im*t.im;
+		sum[i + j*testDofCount].im += partial[i].re*t.im + partial[i].im*t.re;
+	    }
+	}
+    }
+
+    int ofs = pair*testDofCount*trialDofCount;
+    for (i = 0; i < testDofCount*trialDofCount; i++)
+        g_result[ofs + i] = sum[i];
+}
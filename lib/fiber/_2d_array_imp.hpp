@@ -25,6 +25,7 @@ namespace Fiber {
 template <typename T> inline _2dArray<T>::_2dArray() {
   m_storage = 0;
   m_owns = false;
+  m_capacity = 0;
   m_extents[0] = 0;
   m_extents[1] = 0;
 }
@@ -41,6 +42,7 @@ inline _2dArray<T>::_2dArray(size_t extent0, size_t extent1, T *data) {
 #endif
   m_storage = data;
   m_owns = false;
+  m_capacity = 0;
   m_extents[0] = extent0;
   m_extents[1] = extent1;
 }
@@ -66,7 +68,7 @@ inline void _2dArray<T>::init_memory(size_t extent0, size_t extent1) {
 #ifdef FIBER_CHECK_ARRAY_BOUNDS
   check_extents(extent0, extent1);
 #endif
-  m_storage = new T[extent0 * extent1];
+  m_storage = ArrayStorage<T>::allocate(extent0 * extent1, m_capacity);
   m_owns = true;
   m_extents[0] = extent0;
   m_extents[1] = extent1;
@@ -74,8 +76,9 @@ inline void _2dArray<T>::init_memory(size_t extent0, size_t extent1) {
 
 template <typename T> inline void _2dArray<T>::free_memory() {
   if (m_owns && m_storage)
-    delete[] m_storage;
+    ArrayStorage<T>::deallocate(m_storage, m_capacity);
   m_owns = false;
+  m_capacity = 0;
   m_storage = 0;
 }
 
@@ -108,7 +111,8 @@ inline void _2dArray<T>::set_size(size_t extent0, size_t extent1) {
 #ifdef FIBER_CHECK_ARRAY_BOUNDS
   check_extents(extent0, extent1);
 #endif
-  if (extent0 * extent1 == m_extents[0] * m_extents[1]) {
+  if (extent0 * extent1 == m_extents[0] * m_extents[1] ||
+      (m_owns && ArrayStorage<T>::canReuse(extent0 * extent1, m_capacity))) {
     m_extents[0] = extent0;
     m_extents[1] = extent1;
   } else {
@@ -22,6 +22,7 @@
 #define fiber_3d_array_hpp
 
 #include "../common/common.hpp"
+#include "array_memory_pool.hpp"
 #include "boost/operators.hpp"
 
 #include <stdexcept>
@@ -96,6 +97,7 @@ private:
   size_t m_extents[3];
   bool m_owns;
   bool m_strict;
+  size_t m_capacity; // number of elements that fit into owned storage
   T *m_storage;
 };
 
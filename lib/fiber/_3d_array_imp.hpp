@@ -43,6 +43,7 @@ inline _3dArray<T>::_3dArray(size_t extent0, size_t extent1, size_t extent2,
   m_storage = data;
   m_owns = false;
   m_strict = strict;
+  m_capacity = 0;
 }
 
 template <typename T> inline _3dArray<T>::_3dArray(const _3dArray &other) {
@@ -70,7 +71,8 @@ inline void _3dArray<T>::init_memory(size_t extent0, size_t extent1,
 #ifdef FIBER_CHECK_ARRAY_BOUNDS
   check_extents(extent0, extent1, extent2);
 #endif
-  m_storage = new T[extent0 * extent1 * extent2];
+  m_storage =
+      ArrayStorage<T>::allocate(extent0 * extent1 * extent2, m_capacity);
   m_owns = true;
   m_strict = false;
   m_extents[0] = extent0;
@@ -85,12 +87,14 @@ template <typename T> inline void _3dArray<T>::init_empty() {
   m_storage = 0;
   m_owns = false;
   m_strict = false;
+  m_capacity = 0;
 }
 
 template <typename T> inline void _3dArray<T>::free_memory() {
   if (m_owns && m_storage)
-    delete[] m_storage;
+    ArrayStorage<T>::deallocate(m_storage, m_capacity);
   m_owns = false;
+  m_capacity = 0;
   m_storage = 0;
 }
 
@@ -146,8 +150,9 @@ inline _3dArray<T> &_3dArray<T>::operator*=(const T &other) {
 template <typename T>
 inline void _3dArray<T>::set_size(size_t extent0, size_t extent1,
                                   size_t extent2) {
-  if (extent0 * extent1 * extent2 ==
-      m_extents[0] * m_extents[1] * m_extents[2]) {
+  const size_t size = extent0 * extent1 * extent2;
+  if (size == m_extents[0] * m_extents[1] * m_extents[2] ||
+      (m_owns && ArrayStorage<T>::canReuse(size, m_capacity))) {
     m_extents[0] = extent0;
     m_extents[1] = extent1;
     m_extents[2] = extent2;
@@ -156,10 +161,7 @@ inline void _3dArray<T>::set_size(size_t extent0, size_t extent1,
       throw std::runtime_error("_3dArray::set_size(): Changing the total "
                                "number of elements stored in an array "
                                "created in the strict mode is not allowed");
-    if (m_owns) {
-      delete[] m_storage;
-      m_storage = 0;
-    }
+    free_memory();
     if (extent0 * extent1 * extent2 != 0)
       init_memory(extent0, extent1, extent2);
     else
@@ -22,6 +22,7 @@
 #define fiber_4d_array_hpp
 
 #include "../common/common.hpp"
+#include "array_memory_pool.hpp"
 #include "boost/operators.hpp"
 
 #include <stdexcept>
@@ -92,6 +93,7 @@ private:
 private:
   size_t m_extents[4];
   bool m_owns;
+  size_t m_capacity; // number of elements that fit into owned storage
   T *m_storage;
 };
 
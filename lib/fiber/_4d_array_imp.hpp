@@ -29,6 +29,7 @@ template <typename T> inline _4dArray<T>::_4dArray() {
   m_extents[3] = 0;
   m_storage = 0;
   m_owns = false;
+  m_capacity = 0;
 }
 
 template <typename T>
@@ -49,6 +50,7 @@ inline _4dArray<T>::_4dArray(size_t extent0, size_t extent1, size_t extent2,
   m_extents[3] = extent3;
   m_storage = data;
   m_owns = false;
+  m_capacity = 0;
 }
 
 template <typename T> inline _4dArray<T>::_4dArray(const _4dArray &other) {
@@ -75,7 +77,8 @@ inline void _4dArray<T>::init_memory(size_t extent0, size_t extent1,
 #ifdef FIBER_CHECK_ARRAY_BOUNDS
   check_extents(extent0, extent1, extent2, extent3);
 #endif
-  m_storage = new T[extent0 * extent1 * extent2 * extent3];
+  m_storage = ArrayStorage<T>::allocate(
+      extent0 * extent1 * extent2 * extent3, m_capacity);
   m_owns = true;
   m_extents[0] = extent0;
   m_extents[1] = extent1;
@@ -85,8 +88,9 @@ inline void _4dArray<T>::init_memory(size_t extent0, size_t extent1,
 
 template <typename T> inline void _4dArray<T>::free_memory() {
   if (m_owns && m_storage)
-    delete[] m_storage;
+    ArrayStorage<T>::deallocate(m_storage, m_capacity);
   m_owns = false;
+  m_capacity = 0;
   m_storage = 0;
 }
 
@@ -151,23 +155,16 @@ inline void _4dArray<T>::set_size(size_t extent0, size_t extent1,
 #ifdef FIBER_CHECK_ARRAY_BOUNDS
   check_extents(extent0, extent1, extent2, extent3);
 #endif
-  if (extent0 * extent1 * extent2 * extent3 ==
-      m_extents[0] * m_extents[1] * m_extents[2] * m_extents[3]) {
+  const size_t size = extent0 * extent1 * extent2 * extent3;
+  if (size == m_extents[0] * m_extents[1] * m_extents[2] * m_extents[3] ||
+      (m_owns && ArrayStorage<T>::canReuse(size, m_capacity))) {
     m_extents[0] = extent0;
     m_extents[1] = extent1;
     m_extents[2] = extent2;
     m_extents[3] = extent3;
   } else {
-    if (m_owns && m_storage) {
-      delete[] m_storage;
-      m_storage = 0;
-    }
-    m_extents[0] = extent0;
-    m_extents[1] = extent1;
-    m_extents[2] = extent2;
-    m_extents[3] = extent3;
-    m_storage = new T[extent0 * extent1 * extent2 * extent3];
-    m_owns = true;
+    free_memory();
+    init_memory(extent0, extent1, extent2, extent3);
   }
 }
 
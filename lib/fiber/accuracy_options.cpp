@@ -22,6 +22,7 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
 namespace Fiber {
@@ -44,14 +45,24 @@ struct Equal {
 
 } // namespace
 
-AccuracyOptionsEx::AccuracyOptionsEx() {
+AccuracyOptionsEx::AccuracyOptionsEx()
+    : m_singlePrecisionFarField(false), m_semiAnalyticNearField(false),
+      m_semiAnalyticMaxNormalizedDistance(1.),
+      m_singularKernelSplitting(false), m_smoothPartOrderIncrement(2),
+      m_adaptiveTolerance(0.),
+      m_adaptiveKernelDerivativeOrder(0), m_adaptiveWaveNumber(0.) {
   m_singleRegular.push_back(std::make_pair(
       std::numeric_limits<double>::infinity(), QuadratureOptions()));
   m_doubleRegular.push_back(std::make_pair(
       std::numeric_limits<double>::infinity(), QuadratureOptions()));
 }
 
-AccuracyOptionsEx::AccuracyOptionsEx(const AccuracyOptions &oldStyleOpts) {
+AccuracyOptionsEx::AccuracyOptionsEx(const AccuracyOptions &oldStyleOpts)
+    : m_singlePrecisionFarField(false), m_semiAnalyticNearField(false),
+      m_semiAnalyticMaxNormalizedDistance(1.),
+      m_singularKernelSplitting(false), m_smoothPartOrderIncrement(2),
+      m_adaptiveTolerance(0.),
+      m_adaptiveKernelDerivativeOrder(0), m_adaptiveWaveNumber(0.) {
   m_singleRegular.push_back(std::make_pair(
       std::numeric_limits<double>::infinity(), oldStyleOpts.singleRegular));
   m_doubleRegular.push_back(std::make_pair(
@@ -321,6 +332,127 @@ void AccuracyOptionsEx::setDoubleRegular(const t_range& input)
 void AccuracyOptionsEx::setSingleRegular(const t_range& input)
     { implementation::setRegular(m_singleRegular, input); }
 
+double AccuracyOptionsEx::singleRegularMaxNormalizedDistance() const {
+  double result = 0.;
+  for (size_t i = 0; i < m_singleRegular.size(); ++i)
+    if (m_singleRegular[i].first < std::numeric_limits<double>::infinity())
+      result = std::max(result, m_singleRegular[i].first);
+  return result;
+}
+
+void AccuracyOptionsEx::setSinglePrecisionFarField(bool value) {
+  m_singlePrecisionFarField = value;
+}
+
+bool AccuracyOptionsEx::singlePrecisionFarField() const {
+  return m_singlePrecisionFarField;
+}
+
+bool AccuracyOptionsEx::doubleRegularInSinglePrecision(
+    double normalizedDistance) const {
+  if (!m_singlePrecisionFarField)
+    return false;
+  // The far band starts at the largest finite threshold
+  bool hasFarBand = false;
+  double farBandStart = 0.;
+  for (size_t i = 0; i < m_doubleRegular.size(); ++i)
+    if (m_doubleRegular[i].first < std::numeric_limits<double>::infinity()) {
+      farBandStart =
+          hasFarBand ? std::max(farBandStart, m_doubleRegular[i].first)
+                     : m_doubleRegular[i].first;
+      hasFarBand = true;
+    }
+  return hasFarBand && normalizedDistance > farBandStart;
+}
+
+void AccuracyOptionsEx::setSemiAnalyticNearField(
+    bool value, double maxNormalizedDistance) {
+  if (maxNormalizedDistance < 0.)
+    throw std::invalid_argument(
+        "AccuracyOptionsEx::setSemiAnalyticNearField(): "
+        "maxNormalizedDistance must not be negative");
+  m_semiAnalyticNearField = value;
+  m_semiAnalyticMaxNormalizedDistance = maxNormalizedDistance;
+}
+
+bool AccuracyOptionsEx::semiAnalyticNearField() const {
+  return m_semiAnalyticNearField;
+}
+
+bool AccuracyOptionsEx::doubleIntegralSemiAnalytic(
+    double normalizedDistance) const {
+  return m_semiAnalyticNearField &&
+         normalizedDistance <= m_semiAnalyticMaxNormalizedDistance;
+}
+
+void AccuracyOptionsEx::setSingularKernelSplitting(
+    bool value, int smoothPartOrderIncrement) {
+  if (smoothPartOrderIncrement < 0)
+    throw std::invalid_argument(
+        "AccuracyOptionsEx::setSingularKernelSplitting(): "
+        "smoothPartOrderIncrement must not be negative");
+  m_singularKernelSplitting = value;
+  m_smoothPartOrderIncrement = smoothPartOrderIncrement;
+}
+
+bool AccuracyOptionsEx::singularKernelSplitting() const {
+  return m_singularKernelSplitting;
+}
+
+int AccuracyOptionsEx::smoothPartOrderIncrement() const {
+  return m_smoothPartOrderIncrement;
+}
+
+void AccuracyOptionsEx::setAdaptiveDoubleRegular(double tolerance,
+                                                 int kernelDerivativeOrder,
+                                                 double waveNumber) {
+  if (tolerance < 0. || tolerance >= 1.)
+    throw std::invalid_argument("AccuracyOptionsEx::setAdaptiveDoubleRegular(): "
+                                "tolerance must lie in [0, 1)");
+  if (kernelDerivativeOrder < 0)
+    throw std::invalid_argument("AccuracyOptionsEx::setAdaptiveDoubleRegular(): "
+                                "kernelDerivativeOrder must not be negative");
+  m_adaptiveTolerance = tolerance;
+  m_adaptiveKernelDerivativeOrder = kernelDerivativeOrder;
+  m_adaptiveWaveNumber = std::abs(waveNumber);
+}
+
+double AccuracyOptionsEx::adaptiveDoubleRegularTolerance() const {
+  return m_adaptiveTolerance;
+}
+
+int AccuracyOptionsEx::adaptiveDoubleRegularOrder(int basisOrder,
+                                                  double normalizedDistance,
+                                                  double elementSize) const {
+  if (m_adaptiveTolerance <= 0.)
+    return -1;
+  // Each point of an element lies within 2/3 of its longest edge from its
+  // centroid. If the kernel is expanded about the centroids, the remainder
+  // after the terms of degree n - 1 is bounded by C(n + m, m) q^n / (1 - q)
+  // relative to the kernel itself, where m is the number of derivatives of
+  // 1/r in the kernel and q the ratio of this radius (increased by the
+  // distance over which an oscillatory kernel changes significantly) to the
+  // distance between the centroids. A rule of order basisOrder + n - 1
+  // integrates the terms of degree n - 1 exactly. The factor 1/2 splits the
+  // tolerance between the test and the trial element.
+  const double q = 2. / 3. *
+                   (1. / normalizedDistance + m_adaptiveWaveNumber * elementSize);
+  const double maxQ = 0.5;
+  if (!(q <= maxQ))
+    return -1;
+  const int maxExtraOrder = 30;
+  const int m = m_adaptiveKernelDerivativeOrder;
+  double binomial = 1.; // C(n + m, m)
+  double power = q;     // q^n
+  for (int n = 1; n <= maxExtraOrder; ++n) {
+    binomial = binomial * (n + m) / n;
+    if (binomial * power / (1. - q) <= 0.5 * m_adaptiveTolerance)
+      return basisOrder + n - 1;
+    power *= q;
+  }
+  return -1;
+}
+
 const QuadratureOptions& AccuracyOptionsEx::doubleSingular() const
 {
     return m_doubleSingular;
@@ -208,6 +208,14 @@ public:
                           bool relativeToDefault = true);
     void setSingleRegular(const t_range& options);
 
+  /** \brief Return the largest normalized distance bounding one of the
+   *  ranges set with setSingleRegular().
+   *
+   *  singleRegular(normalizedDistance) returns singleRegular() for all
+   *  distances larger than the returned value. If the options do not depend
+   *  on the distance, 0 is returned. */
+  double singleRegularMaxNormalizedDistance() const;
+
   /** \brief Return the options controlling integration of regular functions
    *  on pairs of elements.
    *
@@ -333,6 +341,131 @@ public:
                           bool relativeToDefault = true);
     void setDoubleRegular(const t_range& options);
 
+  /** \brief Enable or disable mixed-precision evaluation of regular
+   *  integrals over distant pairs of elements.
+   *
+   *  If enabled, the kernels are evaluated in single precision for pairs of
+   *  elements lying in the outermost band of the normalized distances
+   *  passed to setDoubleRegular(), i.e. farther apart than the largest
+   *  finite \p maxNormalizedDistance. The quadrature sums are still
+   *  accumulated in the precision of the operator, and all other integrals
+   *  are evaluated as usual. If a single quadrature order is used for all
+   *  regular integrals, there is no such band and this option has no
+   *  effect.
+   *
+   *  Only kernels with a single-precision implementation (currently the
+   *  Laplace and modified Helmholtz kernels in 3D) benefit from this option;
+   *  it is meant for accuracy targets well above single-precision round-off,
+   *  such as the default ACA tolerance. Disabled by default. */
+  void setSinglePrecisionFarField(bool value = true);
+
+  /** \brief Return whether mixed-precision evaluation of regular integrals
+   *  over distant pairs of elements is enabled. */
+  bool singlePrecisionFarField() const;
+
+  /** \brief Return whether the kernels should be evaluated in single
+   *  precision in the integral over a pair of elements with normalized
+   *  distance \p normalizedDistance (see setSinglePrecisionFarField()). */
+  bool doubleRegularInSinglePrecision(double normalizedDistance) const;
+
+  /** \brief Enable or disable semi-analytic integration over singular and
+   *  nearly singular pairs of elements.
+   *
+   *  If enabled, the integrals of the Laplace single-layer kernel in 3D
+   *  over pairs of flat triangles with shape functions of order at most 1
+   *  are evaluated semi-analytically: the integral over the trial element
+   *  is calculated in closed form and only the integral over the test
+   *  element is approximated numerically. This is done for pairs sharing a
+   *  vertex, an edge or the whole element instead of using the Sauter-Schwab
+   *  rules, and for disjoint pairs whose normalized distance (see
+   *  setDoubleRegular()) does not exceed \p maxNormalizedDistance. Other
+   *  operators and shape functions are integrated as usual.
+   *
+   *  Disabled by default. */
+  void setSemiAnalyticNearField(bool value = true,
+                                double maxNormalizedDistance = 1.);
+
+  /** \brief Return whether semi-analytic integration over singular and
+   *  nearly singular pairs of elements is enabled. */
+  bool semiAnalyticNearField() const;
+
+  /** \brief Return whether the integral over a pair of elements with
+   *  normalized distance \p normalizedDistance should be evaluated
+   *  semi-analytically (see setSemiAnalyticNearField()).
+   *
+   *  Pass 0 for pairs of elements sharing a vertex, an edge or the whole
+   *  element. */
+  bool doubleIntegralSemiAnalytic(double normalizedDistance) const;
+
+  /** \brief Enable or disable splitting of kernels in the integrals over
+   *  singular pairs of elements.
+   *
+   *  If enabled, the integrals of kernels that can be written as a sum of a
+   *  singular part independent of the kernel parameters and a bounded
+   *  remainder, such as the modified Helmholtz single-layer kernel
+   *  \f$e^{-\kappa r} / (4 \pi r) = 1 / (4 \pi r) +
+   *  (e^{-\kappa r} - 1) / (4 \pi r)\f$, over pairs of elements sharing a
+   *  vertex, an edge or the whole element are evaluated separately for the
+   *  two parts. The singular part is integrated with the rules for singular
+   *  integrals; being independent of the wave number, its integrals can be
+   *  reused from a singular integral store. The remainder is integrated with
+   *  regular rules whose order on each element exceeds the order of its
+   *  shapeset by \p smoothPartOrderIncrement. Other kernels are integrated
+   *  as usual.
+   *
+   *  Disabled by default. */
+  void setSingularKernelSplitting(bool value = true,
+                                  int smoothPartOrderIncrement = 2);
+
+  /** \brief Return whether kernels are split in the integrals over singular
+   *  pairs of elements (see setSingularKernelSplitting()). */
+  bool singularKernelSplitting() const;
+
+  /** \brief Return the increase of the quadrature order above the shapeset
+   *  order used for the bounded remainder of split kernels (see
+   *  setSingularKernelSplitting()). */
+  int smoothPartOrderIncrement() const;
+
+  /** \brief Lower the quadrature orders of regular integrals over pairs of
+   *  elements to the smallest ones meeting a prescribed accuracy.
+   *
+   *  If enabled, the order of the quadrature rule on each element of a
+   *  well-separated pair is the smallest one for which an a priori estimate
+   *  of the relative quadrature error, derived from the Taylor expansion of
+   *  the kernel about the element centres, does not exceed \p tolerance.
+   *  The order chosen in this way never exceeds the one given by
+   *  setDoubleRegular(), which is also used for pairs too close to each
+   *  other for the estimate to hold.
+   *
+   *  \param[in] tolerance
+   *    Target relative accuracy of the integrals; 0 disables this option
+   *    (default).
+   *  \param[in] kernelDerivativeOrder
+   *    Order of the derivatives of 1/r contained in the kernel: 0 for
+   *    single-layer kernels, 1 for double-layer and adjoint double-layer
+   *    kernels.
+   *  \param[in] waveNumber
+   *    Magnitude of the wave number of oscillatory kernels; 0 for the
+   *    Laplace and modified Helmholtz kernels. */
+  void setAdaptiveDoubleRegular(double tolerance,
+                                int kernelDerivativeOrder = 0,
+                                double waveNumber = 0.);
+
+  /** \brief Return the tolerance passed to setAdaptiveDoubleRegular(), or 0
+   *  if adaptive selection of quadrature orders is disabled. */
+  double adaptiveDoubleRegularTolerance() const;
+
+  /** \brief Return the smallest quadrature order on an element with a
+   *  shapeset of order \p basisOrder meeting the tolerance set with
+   *  setAdaptiveDoubleRegular().
+   *
+   *  \p normalizedDistance is the distance between the centres of the two
+   *  elements divided by \p elementSize, the length of the longest edge of
+   *  the larger one. Return -1 if adaptive selection is disabled or the
+   *  elements are too close for the error estimate to be valid. */
+  int adaptiveDoubleRegularOrder(int basisOrder, double normalizedDistance,
+                                 double elementSize) const;
+
   /** \brief Return the options controlling integration of singular functions
    *  on pairs of elements. */
   const QuadratureOptions &doubleSingular() const;
@@ -352,6 +485,14 @@ private:
     t_range m_singleRegular;
     t_range m_doubleRegular;
     QuadratureOptions m_doubleSingular;
+    bool m_singlePrecisionFarField;
+    bool m_semiAnalyticNearField;
+    double m_semiAnalyticMaxNormalizedDistance;
+    bool m_singularKernelSplitting;
+    int m_smoothPartOrderIncrement;
+    double m_adaptiveTolerance;
+    int m_adaptiveKernelDerivativeOrder;
+    double m_adaptiveWaveNumber;
     /** \endcond */
 };
 
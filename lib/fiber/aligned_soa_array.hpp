@@ -0,0 +1,100 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_aligned_soa_array_hpp
+#define fiber_aligned_soa_array_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "_3d_array.hpp"
+
+#include <cstddef>
+
+#ifndef NDEBUG
+#define FIBER_CHECK_ARRAY_BOUNDS
+#endif
+
+namespace Fiber {
+
+/** \brief Structure-of-arrays storage of a vector or tensor quantity at a
+ *  set of points.
+
+The values of each component at all points are stored contiguously, starting
+at an address aligned to \p alignment bytes. The number of points per
+component is padded to a multiple of <tt>alignment / sizeof(T)</tt> (i.e. to
+whole SIMD packs) and the padding repeats the values at the last point, so
+that vectorised loops can run over paddedPointCount() points without a
+scalar remainder.
+
+Bound checking can optionally be activated by defining the symbol
+FIBER_CHECK_ARRAY_BOUNDS. */
+template <typename T> class AlignedSoaArray {
+public:
+  enum { alignment = 64 }; // cache line and AVX-512 register size in bytes
+
+  AlignedSoaArray();
+  AlignedSoaArray(const AlignedSoaArray &other);
+  AlignedSoaArray &operator=(const AlignedSoaArray &rhs);
+  ~AlignedSoaArray();
+
+  T &operator()(size_t component, size_t point);
+  const T &operator()(size_t component, size_t point) const;
+
+  /** \brief Values of the given component at all (padded) points. */
+  T *component(size_t component);
+  const T *component(size_t component) const;
+
+  size_t componentCount() const;
+  size_t pointCount() const;
+  size_t paddedPointCount() const;
+  bool is_empty() const;
+
+  void set_size(size_t componentCount, size_t pointCount);
+  void clear();
+
+  /** \brief Copy a dim x pointCount matrix (columns are points). */
+  void assign(const arma::Mat<T> &values);
+  /** \brief Copy an extent0 x extent1 x pointCount array; component
+   *  (i, j) has the index i + extent0 * j. */
+  void assign(const _3dArray<T> &values);
+
+private:
+  void init_memory(size_t componentCount, size_t pointCount);
+  void free_memory();
+  void pad();
+
+#ifdef FIBER_CHECK_ARRAY_BOUNDS
+  void check_indices(size_t component, size_t point) const;
+#endif
+
+private:
+  size_t m_componentCount;
+  size_t m_pointCount;
+  size_t m_paddedPointCount;
+  char *m_buffer;
+  T *m_storage; // aligned start of m_buffer
+};
+
+} // namespace Fiber
+
+#include "aligned_soa_array_imp.hpp"
+
+#endif
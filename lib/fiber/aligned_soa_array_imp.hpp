@@ -0,0 +1,179 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Fiber {
+
+template <typename T>
+inline AlignedSoaArray<T>::AlignedSoaArray()
+    : m_componentCount(0), m_pointCount(0), m_paddedPointCount(0),
+      m_buffer(0), m_storage(0) {}
+
+template <typename T>
+inline AlignedSoaArray<T>::AlignedSoaArray(const AlignedSoaArray &other)
+    : m_componentCount(0), m_pointCount(0), m_paddedPointCount(0),
+      m_buffer(0), m_storage(0) {
+  *this = other;
+}
+
+template <typename T>
+inline AlignedSoaArray<T> &AlignedSoaArray<T>::
+operator=(const AlignedSoaArray &rhs) {
+  if (&rhs != this) {
+    set_size(rhs.m_componentCount, rhs.m_pointCount);
+    std::copy(rhs.m_storage, rhs.m_storage + m_componentCount *
+                                                 m_paddedPointCount,
+              m_storage);
+  }
+  return *this;
+}
+
+template <typename T> inline AlignedSoaArray<T>::~AlignedSoaArray() {
+  free_memory();
+}
+
+template <typename T>
+inline void AlignedSoaArray<T>::init_memory(size_t componentCount,
+                                            size_t pointCount) {
+  const size_t packSize = alignment / sizeof(T);
+  m_componentCount = componentCount;
+  m_pointCount = pointCount;
+  m_paddedPointCount = (pointCount + packSize - 1) / packSize * packSize;
+  const size_t size = componentCount * m_paddedPointCount;
+  if (size == 0)
+    return;
+  m_buffer = new char[size * sizeof(T) + alignment];
+  const size_t misalignment =
+      reinterpret_cast<size_t>(m_buffer) % alignment;
+  m_storage = reinterpret_cast<T *>(
+      m_buffer + (misalignment ? alignment - misalignment : 0));
+}
+
+template <typename T> inline void AlignedSoaArray<T>::free_memory() {
+  delete[] m_buffer;
+  m_buffer = 0;
+  m_storage = 0;
+  m_componentCount = 0;
+  m_pointCount = 0;
+  m_paddedPointCount = 0;
+}
+
+template <typename T> inline void AlignedSoaArray<T>::pad() {
+  if (m_pointCount == 0)
+    return;
+  for (size_t c = 0; c < m_componentCount; ++c) {
+    T *values = component(c);
+    std::fill(values + m_pointCount, values + m_paddedPointCount,
+              values[m_pointCount - 1]);
+  }
+}
+
+template <typename T>
+inline T &AlignedSoaArray<T>::operator()(size_t component, size_t point) {
+#ifdef FIBER_CHECK_ARRAY_BOUNDS
+  check_indices(component, point);
+#endif
+  return m_storage[component * m_paddedPointCount + point];
+}
+
+template <typename T>
+inline const T &AlignedSoaArray<T>::operator()(size_t component,
+                                               size_t point) const {
+#ifdef FIBER_CHECK_ARRAY_BOUNDS
+  check_indices(component, point);
+#endif
+  return m_storage[component * m_paddedPointCount + point];
+}
+
+template <typename T>
+inline T *AlignedSoaArray<T>::component(size_t component) {
+  return m_storage + component * m_paddedPointCount;
+}
+
+template <typename T>
+inline const T *AlignedSoaArray<T>::component(size_t component) const {
+  return m_storage + component * m_paddedPointCount;
+}
+
+template <typename T>
+inline size_t AlignedSoaArray<T>::componentCount() const {
+  return m_componentCount;
+}
+
+template <typename T> inline size_t AlignedSoaArray<T>::pointCount() const {
+  return m_pointCount;
+}
+
+template <typename T>
+inline size_t AlignedSoaArray<T>::paddedPointCount() const {
+  return m_paddedPointCount;
+}
+
+template <typename T> inline bool AlignedSoaArray<T>::is_empty() const {
+  return m_componentCount == 0 || m_pointCount == 0;
+}
+
+template <typename T>
+inline void AlignedSoaArray<T>::set_size(size_t componentCount,
+                                         size_t pointCount) {
+  if (componentCount == m_componentCount && pointCount == m_pointCount)
+    return;
+  free_memory();
+  init_memory(componentCount, pointCount);
+}
+
+template <typename T> inline void AlignedSoaArray<T>::clear() {
+  free_memory();
+}
+
+template <typename T>
+inline void AlignedSoaArray<T>::assign(const arma::Mat<T> &values) {
+  set_size(values.n_rows, values.n_cols);
+  for (size_t p = 0; p < m_pointCount; ++p)
+    for (size_t c = 0; c < m_componentCount; ++c)
+      m_storage[c * m_paddedPointCount + p] = values(c, p);
+  pad();
+}
+
+template <typename T>
+inline void AlignedSoaArray<T>::assign(const _3dArray<T> &values) {
+  const size_t rowCount = values.extent(0);
+  const size_t colCount = values.extent(1);
+  set_size(rowCount * colCount, values.extent(2));
+  for (size_t p = 0; p < m_pointCount; ++p)
+    for (size_t j = 0; j < colCount; ++j)
+      for (size_t i = 0; i < rowCount; ++i)
+        m_storage[(i + rowCount * j) * m_paddedPointCount + p] =
+            values(i, j, p);
+  pad();
+}
+
+#ifdef FIBER_CHECK_ARRAY_BOUNDS
+template <typename T>
+inline void AlignedSoaArray<T>::check_indices(size_t component,
+                                              size_t point) const {
+  if (component >= m_componentCount || point >= m_paddedPointCount)
+    throw std::invalid_argument("Invalid index");
+}
+#endif
+
+} // namespace Fiber
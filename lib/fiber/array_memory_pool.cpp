@@ -0,0 +1,162 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "array_memory_pool.hpp"
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/spin_mutex.h>
+
+#include <cstdint>
+#include <new>
+
+namespace Fiber {
+
+namespace {
+
+// Size classes are the powers of two from alignment to maxPooledBlockSize
+const int classCount = 19;
+static_assert((ArrayMemoryPool::alignment << (classCount - 1)) ==
+                  ArrayMemoryPool::maxPooledBlockSize,
+              "classCount does not match maxPooledBlockSize");
+
+int sizeClass(size_t bytes) {
+  int cls = 0;
+  size_t classSize = ArrayMemoryPool::alignment;
+  while (classSize < bytes) {
+    classSize <<= 1;
+    ++cls;
+  }
+  return cls;
+}
+
+size_t classSize(int cls) {
+  return static_cast<size_t>(ArrayMemoryPool::alignment) << cls;
+}
+
+// The address returned by operator new is stored just before the aligned
+// block
+void *alignedAllocate(size_t bytes) {
+  const size_t alignment = ArrayMemoryPool::alignment;
+  char *raw = static_cast<char *>(::operator new(bytes + alignment));
+  const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw);
+  char *block = raw + (alignment - address % alignment);
+  reinterpret_cast<void **>(block)[-1] = raw;
+  return block;
+}
+
+void alignedFree(void *block) {
+  ::operator delete(reinterpret_cast<void **>(block)[-1]);
+}
+
+// The free lists are singly linked through the first word of the blocks.
+// The mutex is only contended while releaseCachedBlocks() runs.
+struct ThreadCache {
+  ThreadCache() : bytes(0) {
+    std::fill(freeLists, freeLists + classCount, static_cast<void *>(0));
+  }
+
+  tbb::spin_mutex mutex;
+  void *freeLists[classCount];
+  size_t bytes;
+};
+
+typedef tbb::enumerable_thread_specific<ThreadCache> ThreadCaches;
+
+// Never destroyed, so that arrays destroyed during static destruction can
+// still return their storage
+ThreadCaches &threadCaches() {
+  static ThreadCaches *caches = new ThreadCaches;
+  return *caches;
+}
+
+size_t releaseBlocks(ThreadCache &cache) {
+  tbb::spin_mutex::scoped_lock lock(cache.mutex);
+  for (int cls = 0; cls < classCount; ++cls)
+    while (void *block = cache.freeLists[cls]) {
+      cache.freeLists[cls] = *static_cast<void **>(block);
+      alignedFree(block);
+    }
+  const size_t released = cache.bytes;
+  cache.bytes = 0;
+  return released;
+}
+
+} // namespace
+
+void *ArrayMemoryPool::allocate(size_t bytes, size_t &capacity) {
+  if (bytes > static_cast<size_t>(maxPooledBlockSize)) {
+    capacity = (bytes + alignment - 1) / alignment * alignment;
+    return alignedAllocate(capacity);
+  }
+  const int cls = sizeClass(bytes);
+  capacity = classSize(cls);
+  ThreadCache &cache = threadCaches().local();
+  {
+    tbb::spin_mutex::scoped_lock lock(cache.mutex);
+    if (void *block = cache.freeLists[cls]) {
+      cache.freeLists[cls] = *static_cast<void **>(block);
+      cache.bytes -= capacity;
+      return block;
+    }
+  }
+  return alignedAllocate(capacity);
+}
+
+void ArrayMemoryPool::deallocate(void *block, size_t capacity) {
+  if (!block)
+    return;
+  if (capacity > static_cast<size_t>(maxPooledBlockSize)) {
+    alignedFree(block);
+    return;
+  }
+  ThreadCache &cache = threadCaches().local();
+  {
+    tbb::spin_mutex::scoped_lock lock(cache.mutex);
+    if (cache.bytes + capacity <=
+        static_cast<size_t>(maxCachedBytesPerThread)) {
+      const int cls = sizeClass(capacity);
+      *static_cast<void **>(block) = cache.freeLists[cls];
+      cache.freeLists[cls] = block;
+      cache.bytes += capacity;
+      return;
+    }
+  }
+  alignedFree(block);
+}
+
+size_t ArrayMemoryPool::cachedBytes() {
+  size_t total = 0;
+  ThreadCaches &caches = threadCaches();
+  for (ThreadCaches::iterator it = caches.begin(); it != caches.end(); ++it) {
+    tbb::spin_mutex::scoped_lock lock(it->mutex);
+    total += it->bytes;
+  }
+  return total;
+}
+
+size_t ArrayMemoryPool::releaseCachedBlocks() {
+  size_t total = 0;
+  ThreadCaches &caches = threadCaches();
+  for (ThreadCaches::iterator it = caches.begin(); it != caches.end(); ++it)
+    total += releaseBlocks(*it);
+  return total;
+}
+
+} // namespace Fiber
@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_array_memory_pool_hpp
+#define fiber_array_memory_pool_hpp
+
+#include "../common/common.hpp"
+
+#include <boost/type_traits/is_complex.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace Fiber {
+
+/** \brief Per-thread pool of 64-byte aligned memory blocks.
+
+The multidimensional arrays of Fiber (_2dArray, _3dArray, _4dArray and hence
+their collections) take their storage from this pool if their elements are
+numbers. Block sizes are rounded up to powers of two, and a freed block is
+put on a free list of the calling thread, from which the next allocation of
+the same size class on that thread is served. Integrators that resize their
+work arrays for every batch of elements therefore do not touch the heap
+once the free lists are populated. Blocks larger than maxPooledBlockSize,
+and blocks that would make the free lists of a thread exceed
+maxCachedBytesPerThread, are returned to the heap. */
+class ArrayMemoryPool {
+public:
+  enum {
+    alignment = 64, // cache line size in bytes
+    maxPooledBlockSize = 1 << 24,
+    maxCachedBytesPerThread = 1 << 26
+  };
+
+  /** \brief Return a block of at least \p bytes bytes aligned to
+   *  \p alignment bytes; its actual size is written to \p capacity. */
+  static void *allocate(size_t bytes, size_t &capacity);
+
+  /** \brief Return a block obtained from allocate() to the pool. */
+  static void deallocate(void *block, size_t capacity);
+
+  /** \brief Total size of the blocks held in the free lists of all
+   *  threads. */
+  static size_t cachedBytes();
+
+  /** \brief Free the blocks held in the free lists of all threads and return
+   *  their total size.
+   *
+   *  This should not be called while threads that have not used the pool
+   *  before allocate arrays, e.g. during an assembly. */
+  static size_t releaseCachedBlocks();
+};
+
+/** \brief Allocation policy of the storage of the multidimensional arrays.
+
+Arrays of numbers are allocated from the ArrayMemoryPool. Their storage is
+reused by set_size() as long as it is large enough ("reserve, then reuse").
+Arrays of other types, e.g. of shared pointers, are allocated with new[] and
+only reused for the same number of elements, so that no stale objects are
+kept alive. */
+template <typename T> class ArrayStorage {
+public:
+  typedef std::integral_constant<bool, std::is_arithmetic<T>::value ||
+                                           boost::is_complex<T>::value>
+      IsPooled;
+
+  /** \brief Allocate storage for \p size elements; the number of elements
+   *  that fit into it is written to \p capacity. */
+  static T *allocate(size_t size, size_t &capacity) {
+    return allocate(size, capacity, IsPooled());
+  }
+
+  static void deallocate(T *storage, size_t capacity) {
+    deallocate(storage, capacity, IsPooled());
+  }
+
+  /** \brief Return true if storage of the given capacity can hold
+   *  \p size elements. */
+  static bool canReuse(size_t size, size_t capacity) {
+    return IsPooled::value ? size <= capacity : size == capacity;
+  }
+
+private:
+  static T *allocate(size_t size, size_t &capacity, std::true_type) {
+    size_t bytes = 0;
+    T *storage = static_cast<T *>(
+        ArrayMemoryPool::allocate(size * sizeof(T), bytes));
+    capacity = bytes / sizeof(T);
+    // new T[] would have value-initialised complex numbers
+    if (boost::is_complex<T>::value)
+      std::fill(storage, storage + size, T());
+    return storage;
+  }
+
+  static T *allocate(size_t size, size_t &capacity, std::false_type) {
+    capacity = size;
+    return new T[size];
+  }
+
+  static void deallocate(T *storage, size_t capacity, std::true_type) {
+    ArrayMemoryPool::deallocate(storage, capacity * sizeof(T));
+  }
+
+  static void deallocate(T *storage, size_t, std::false_type) {
+    delete[] storage;
+  }
+};
+
+} // namespace Fiber
+
+#endif
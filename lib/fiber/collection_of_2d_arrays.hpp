@@ -57,6 +57,7 @@ private:
 
 private:
   size_t m_size;
+  size_t m_capacity; // number of arrays allocated
   boost::scoped_array<_2dArray<T>> m_arrays;
 };
 
@@ -26,18 +26,19 @@ namespace Fiber {
 
 template <typename T>
 inline CollectionOf2dArrays<T>::CollectionOf2dArrays()
-    : m_size(0) {}
+    : m_size(0), m_capacity(0) {}
 
 template <typename T>
 inline CollectionOf2dArrays<T>::CollectionOf2dArrays(size_t size)
-    : m_size(size), m_arrays(new _2dArray<T>[size]) {
+    : m_size(size), m_capacity(size), m_arrays(new _2dArray<T>[size]) {
   // should we initialise to 0?
 }
 
 template <typename T>
 inline CollectionOf2dArrays<T>::CollectionOf2dArrays(
     const CollectionOf2dArrays &other)
-    : m_size(other.m_size), m_arrays(new _2dArray<T>[other.m_size]) {
+    : m_size(other.m_size), m_capacity(other.m_size),
+      m_arrays(new _2dArray<T>[other.m_size]) {
   for (size_t a = 0; a < m_size; ++a)
     m_arrays[a] = other.array(a);
 }
@@ -57,8 +58,17 @@ template <typename T>
 inline void CollectionOf2dArrays<T>::set_size(size_t new_size) {
   if (new_size == m_size)
     return;
-  m_arrays.reset(new_size == 0 ? 0 : new _2dArray<T>[new_size]);
+  // Keep the arrays, and hence their storage, for later use when the
+  // collection shrinks
+  if (new_size <= m_capacity) {
+    for (size_t a = m_size; a < new_size; ++a)
+      m_arrays[a].set_size(0, 0);
+    m_size = new_size;
+    return;
+  }
+  m_arrays.reset(new _2dArray<T>[new_size]);
   m_size = new_size;
+  m_capacity = new_size;
 }
 
 template <typename T> inline size_t CollectionOf2dArrays<T>::size() const {
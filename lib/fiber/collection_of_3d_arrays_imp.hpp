@@ -26,11 +26,11 @@ namespace Fiber {
 
 template <typename T>
 inline CollectionOf3dArrays<T>::CollectionOf3dArrays()
-    : m_size(0) {}
+    : m_size(0), m_capacity(0) {}
 
 template <typename T>
 inline CollectionOf3dArrays<T>::CollectionOf3dArrays(size_t size)
-    : m_size(size), m_arrays(new _3dArray<T>[size]) {
+    : m_size(size), m_capacity(size), m_arrays(new _3dArray<T>[size]) {
   // should we initialise to 0?
 }
 
@@ -38,8 +38,17 @@ template <typename T>
 inline void CollectionOf3dArrays<T>::set_size(size_t new_size) {
   if (new_size == m_size)
     return;
-  m_arrays.reset(new_size == 0 ? 0 : new _3dArray<T>[new_size]);
+  // Keep the arrays, and hence their storage, for later use when the
+  // collection shrinks
+  if (new_size <= m_capacity) {
+    for (size_t a = m_size; a < new_size; ++a)
+      m_arrays[a].set_size(0, 0, 0);
+    m_size = new_size;
+    return;
+  }
+  m_arrays.reset(new _3dArray<T>[new_size]);
   m_size = new_size;
+  m_capacity = new_size;
 }
 
 template <typename T> inline size_t CollectionOf3dArrays<T>::size() const {
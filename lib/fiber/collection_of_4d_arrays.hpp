@@ -71,6 +71,7 @@ private:
 
 private:
   size_t m_size;
+  size_t m_capacity; // number of arrays allocated
   boost::scoped_array<_4dArray<T>> m_arrays;
 };
 
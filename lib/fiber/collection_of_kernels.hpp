@@ -23,9 +23,12 @@
 
 #include "../common/common.hpp"
 
+#include "kernel_tile_type.hpp"
 #include "scalar_traits.hpp"
 
+#include <complex>
 #include <utility>
+#include <vector>
 
 namespace Fiber {
 
@@ -139,12 +142,104 @@ public:
                  const GeometricalData<CoordinateType> &trialGeomData,
                  CollectionOf4dArrays<ValueType> &result) const = 0;
 
+  /** \brief Evaluate the kernels on the grids of test and trial points of
+   *  several element pairs.
+   *
+   *  Equivalent to calling evaluateOnGrid(*testGeomData[i],
+   *  *trialGeomData[i], *result[i]) for each i, which is what the default
+   *  implementation does. DefaultCollectionOfKernels overrides it so that
+   *  the kernels of a whole batch of element pairs are evaluated with a
+   *  single virtual call. */
+  virtual void evaluateBatchOnGrid(
+      const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+      const std::vector<const GeometricalData<CoordinateType> *> &
+          trialGeomData,
+      const std::vector<CollectionOf4dArrays<ValueType> *> &result) const {
+    for (size_t i = 0; i < result.size(); ++i)
+      evaluateOnGrid(*testGeomData[i], *trialGeomData[i], *result[i]);
+  }
+
+  /** \brief Evaluate kernels on a grid of test and trial points, possibly
+   *  in single precision.
+   *
+   *  Like evaluateOnGrid(), but an implementation may compute the kernel
+   *  values in single precision before storing them in \p result. This is
+   *  used for regular integrals over distant element pairs if requested
+   *  by AccuracyOptionsEx::setSinglePrecisionFarField(). The default
+   *  implementation calls evaluateOnGrid(). */
+  virtual void evaluateOnGridInSinglePrecision(
+      const GeometricalData<CoordinateType> &testGeomData,
+      const GeometricalData<CoordinateType> &trialGeomData,
+      CollectionOf4dArrays<ValueType> &result) const {
+    evaluateOnGrid(testGeomData, trialGeomData, result);
+  }
+
   /** \brief Currently unused. */
   virtual std::pair<const char *, int> evaluateClCode() const {
     throw std::runtime_error("CollectionOfKernels::evaluateClCode(): "
                              "not implemented");
   }
 
+  /** \brief Identify the kernel as a member of the modified Helmholtz
+   *  family.
+   *
+   *  If the collection consists of a single Laplace or modified Helmholtz
+   *  kernel in 3D, an implementation should set \p type to its variant and
+   *  \p waveNumber to its wave number (0 for the Laplace kernels) and
+   *  return true. This allows integrators with a hard-coded implementation
+   *  of these kernels, such as the OpenCL regular-pair integrator, to be
+   *  used. The default implementation returns false. */
+  virtual bool
+  describeModifiedHelmholtz3dKernel(KernelTileType &type,
+                                    std::complex<double> &waveNumber) const {
+    return false;
+  }
+
+  /** \brief Return the wave number of the oscillations of the kernels.
+   *
+   *  For kernels containing a factor \f$\exp(-\kappa r)\f$ this is the
+   *  absolute value of the imaginary part of \f$\kappa\f$, i.e. the
+   *  physical wave number of Helmholtz and Maxwell kernels. Assemblers use
+   *  it to adapt the block structure of H-matrices to high frequencies. The
+   *  default implementation returns 0 (no oscillations). */
+  virtual CoordinateType oscillationWaveNumber() const { return 0; }
+
+  /** \brief Return true if the kernels are far-field kernels, i.e. depend on
+   *  the test point only through a direction \f$\hat x\f$ as in
+   *  \f$\exp(-\kappa \hat x \cdot y)\f$. The default implementation
+   *  returns false. */
+  virtual bool isFarFieldKernel() const { return false; }
+
+  /** \brief Return true if all kernels vanish whenever the test and trial
+   *  points lie in a common plane, as the double-layer kernels
+   *  \f$\partial G(x, y) / \partial n(y)\f$ do.
+   *
+   *  Assemblers use it to skip pairs of coplanar elements and, in H-matrix
+   *  assembly, blocks whose test and trial DOFs lie on one plane. The
+   *  default implementation returns false. */
+  virtual bool vanishesOnCoplanarElements() const { return false; }
+
+  /** \brief Return the singular part of a splitting of the kernels into a
+   *  singular part and a bounded remainder returned by smoothPart(), or a
+   *  null pointer if the kernels offer no such splitting.
+   *
+   *  The singular part does not depend on the kernel parameters, such as the
+   *  wave number, and has real values, so that its singular integrals are
+   *  cheaper to evaluate and can be reused; the remainder can be integrated
+   *  with regular quadrature rules also on adjacent elements. The default
+   *  implementation returns a null pointer. */
+  virtual shared_ptr<const CollectionOfKernels<CoordinateType>>
+  singularPart() const {
+    return shared_ptr<const CollectionOfKernels<CoordinateType>>();
+  }
+
+  /** \brief Return the bounded remainder of the kernels after subtraction of
+   *  singularPart(), or a null pointer if the kernels offer no such
+   *  splitting. The default implementation returns a null pointer. */
+  virtual shared_ptr<const CollectionOfKernels<ValueType>> smoothPart() const {
+    return shared_ptr<const CollectionOfKernels<ValueType>>();
+  }
+
   virtual CoordinateType
   estimateRelativeScale(CoordinateType distance) const = 0;
 };
@@ -78,6 +78,57 @@ namespace Fiber {
         // defined, the kernel behaves as if its estimated magnitude was 1
         // everywhere.
         CoordinateType estimateRelativeScale(CoordinateType distance) const;
+
+        // (Optional)
+        // Evaluate the kernels at all pairs of test and trial points at once.
+        // The (j, k)th element of the value of i'th kernel at the test point
+        // p and trial point q should be written to result[i](j, k, p, q);
+        // result has already been resized. If this function is defined, it
+        // replaces the calls to evaluate() in evaluateOnGrid(). It may return
+        // false without touching result to fall back to evaluate(), e.g. if
+        // the library is not compiled for a SIMD instruction set (see the
+        // CMake option SIMD_INSTRUCTION_SET). See
+        // evaluateModifiedHelmholtz3dOnGrid().
+        bool evaluateOnGrid(
+                const GeometricalData<CoordinateType>& testGeomData,
+                const GeometricalData<CoordinateType>& trialGeomData,
+                CollectionOf4dArrays<ValueType>& result) const;
+
+        // (Optional)
+        // If the functor represents a single Laplace or modified Helmholtz
+        // kernel, set type and waveNumber accordingly and return true (see
+        // CollectionOfKernels::describeModifiedHelmholtz3dKernel()). The
+        // kernel can then also be evaluated in single precision by
+        // evaluateOnGridInSinglePrecision().
+        bool describeModifiedHelmholtz3dKernel(
+                KernelTileType& type, std::complex<double>& waveNumber) const;
+
+        // (Optional)
+        // Return the wave number kappa of kernels containing exp(-kappa r).
+        // Its imaginary part is returned by oscillationWaveNumber().
+        ValueType waveNumber() const;
+
+        // (Optional)
+        // Return true if the functor represents far-field kernels (see
+        // CollectionOfKernels::isFarFieldKernel()).
+        bool isFarFieldKernel() const;
+
+        // (Optional)
+        // Return true if the kernels vanish whenever the test and trial
+        // points lie in a common plane (see
+        // CollectionOfKernels::vanishesOnCoplanarElements()).
+        bool vanishesOnCoplanarElements() const;
+
+        // (Optional)
+        // Split the kernels into real singular kernels independent of the
+        // kernel parameters and a bounded remainder (see
+        // CollectionOfKernels::singularPart()). Both functor types must be
+        // defined together with the functions returning them; the values of
+        // SingularPartFunctor are of type CoordinateType.
+        typedef ... SingularPartFunctor;
+        typedef ... SmoothPartFunctor;
+        SingularPartFunctor singularPart() const;
+        SmoothPartFunctor smoothPart() const;
     };
     \endcode
 
@@ -113,8 +164,34 @@ public:
                  const GeometricalData<CoordinateType> &trialGeomData,
                  CollectionOf4dArrays<ValueType> &result) const;
 
+  virtual void evaluateBatchOnGrid(
+      const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+      const std::vector<const GeometricalData<CoordinateType> *> &
+          trialGeomData,
+      const std::vector<CollectionOf4dArrays<ValueType> *> &result) const;
+
+  virtual void evaluateOnGridInSinglePrecision(
+      const GeometricalData<CoordinateType> &testGeomData,
+      const GeometricalData<CoordinateType> &trialGeomData,
+      CollectionOf4dArrays<ValueType> &result) const;
+
   virtual std::pair<const char *, int> evaluateClCode() const;
 
+  virtual bool
+  describeModifiedHelmholtz3dKernel(KernelTileType &type,
+                                    std::complex<double> &waveNumber) const;
+
+  virtual CoordinateType oscillationWaveNumber() const;
+
+  virtual bool isFarFieldKernel() const;
+
+  virtual bool vanishesOnCoplanarElements() const;
+
+  virtual shared_ptr<const CollectionOfKernels<CoordinateType>>
+  singularPart() const;
+
+  virtual shared_ptr<const Base> smoothPart() const;
+
   virtual CoordinateType estimateRelativeScale(CoordinateType distance) const;
 
 private:
@@ -23,26 +23,31 @@
 
 #include "default_collection_of_kernels.hpp"
 
+#include "../common/complex_aux.hpp"
 #include "collection_of_3d_arrays.hpp"
 #include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
+#include "has_mem_func.hpp"
+#include "kernel_tiles_3d.hpp"
+#include "profiler.hpp"
+#include "simd_pack.hpp"
 
+#include <boost/make_shared.hpp>
+#include <boost/mpl/has_xxx.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <stdexcept>
 
-#define FIBER_HAS_MEM_FUNC(func, name)                                         \
-  template <typename T, typename Sign> struct name {                           \
-    typedef char yes[1];                                                       \
-    typedef char no[2];                                                        \
-    template <typename U, U> struct type_check;                                \
-    template <typename _1> static yes &chk(type_check<Sign, &_1::func> *);     \
-    template <typename> static no &chk(...);                                   \
-    static bool const value = sizeof(chk<T>(0)) == sizeof(yes);                \
-  }
-
 namespace Fiber {
 
 FIBER_HAS_MEM_FUNC(estimateRelativeScale, hasEstimateRelativeScale);
+FIBER_HAS_MEM_FUNC(evaluateOnGrid, hasEvaluateOnGrid);
+FIBER_HAS_MEM_FUNC(describeModifiedHelmholtz3dKernel,
+                   hasDescribeModifiedHelmholtz3dKernel);
+FIBER_HAS_MEM_FUNC(waveNumber, hasWaveNumber);
+FIBER_HAS_MEM_FUNC(isFarFieldKernel, hasIsFarFieldKernel);
+FIBER_HAS_MEM_FUNC(vanishesOnCoplanarElements, hasVanishesOnCoplanarElements);
+BOOST_MPL_HAS_XXX_TRAIT_DEF(SingularPartFunctor)
+BOOST_MPL_HAS_XXX_TRAIT_DEF(SmoothPartFunctor)
 
 // template <class Type>
 // class TypeHasEstimateRelativeScale
@@ -116,6 +121,160 @@ estimateRelativeScaleInternal(const Functor &functor,
 //   return 1.;
 //}
 
+// Use the batched evaluateOnGrid() of a functor if it has one. Return false if
+// the functor has none or declined to fill the result.
+
+template <typename Functor>
+typename boost::enable_if<
+    hasEvaluateOnGrid<
+        Functor,
+        bool (Functor::*)(
+            const GeometricalData<typename Functor::CoordinateType> &,
+            const GeometricalData<typename Functor::CoordinateType> &,
+            CollectionOf4dArrays<typename Functor::ValueType> &) const>,
+    bool>::type
+evaluateOnGridInternal(
+    const Functor &functor,
+    const GeometricalData<typename Functor::CoordinateType> &testGeomData,
+    const GeometricalData<typename Functor::CoordinateType> &trialGeomData,
+    CollectionOf4dArrays<typename Functor::ValueType> &result) {
+  return functor.evaluateOnGrid(testGeomData, trialGeomData, result);
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    hasEvaluateOnGrid<
+        Functor,
+        bool (Functor::*)(
+            const GeometricalData<typename Functor::CoordinateType> &,
+            const GeometricalData<typename Functor::CoordinateType> &,
+            CollectionOf4dArrays<typename Functor::ValueType> &) const>,
+    bool>::type
+evaluateOnGridInternal(
+    const Functor &functor,
+    const GeometricalData<typename Functor::CoordinateType> &testGeomData,
+    const GeometricalData<typename Functor::CoordinateType> &trialGeomData,
+    CollectionOf4dArrays<typename Functor::ValueType> &result) {
+  return false;
+}
+
+// Forward describeModifiedHelmholtz3dKernel() to the functor if it has it.
+
+template <typename Functor>
+typename boost::enable_if<
+    hasDescribeModifiedHelmholtz3dKernel<
+        Functor, bool (Functor::*)(KernelTileType &, std::complex<double> &)
+                     const>,
+    bool>::type
+describeModifiedHelmholtz3dKernelInternal(const Functor &functor,
+                                          KernelTileType &type,
+                                          std::complex<double> &waveNumber) {
+  return functor.describeModifiedHelmholtz3dKernel(type, waveNumber);
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    hasDescribeModifiedHelmholtz3dKernel<
+        Functor, bool (Functor::*)(KernelTileType &, std::complex<double> &)
+                     const>,
+    bool>::type
+describeModifiedHelmholtz3dKernelInternal(const Functor &functor,
+                                          KernelTileType &type,
+                                          std::complex<double> &waveNumber) {
+  return false;
+}
+
+// Take the oscillation wave number from the functor's waveNumber() if it has
+// one.
+
+template <typename Functor>
+typename boost::enable_if<
+    hasWaveNumber<Functor, typename Functor::ValueType (Functor::*)() const>,
+    typename Functor::CoordinateType>::type
+oscillationWaveNumberInternal(const Functor &functor) {
+  return std::abs(imagPart(functor.waveNumber()));
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    hasWaveNumber<Functor, typename Functor::ValueType (Functor::*)() const>,
+    typename Functor::CoordinateType>::type
+oscillationWaveNumberInternal(const Functor &functor) {
+  return 0.;
+}
+
+template <typename Functor>
+typename boost::enable_if<
+    hasIsFarFieldKernel<Functor, bool (Functor::*)() const>, bool>::type
+isFarFieldKernelInternal(const Functor &functor) {
+  return functor.isFarFieldKernel();
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    hasIsFarFieldKernel<Functor, bool (Functor::*)() const>, bool>::type
+isFarFieldKernelInternal(const Functor &functor) {
+  return false;
+}
+
+template <typename Functor>
+typename boost::enable_if<
+    hasVanishesOnCoplanarElements<Functor, bool (Functor::*)() const>,
+    bool>::type
+vanishesOnCoplanarElementsInternal(const Functor &functor) {
+  return functor.vanishesOnCoplanarElements();
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    hasVanishesOnCoplanarElements<Functor, bool (Functor::*)() const>,
+    bool>::type
+vanishesOnCoplanarElementsInternal(const Functor &functor) {
+  return false;
+}
+
+// Wrap the parts of a kernel splitting in kernel collections if the functor
+// defines one.
+
+template <typename Functor>
+typename boost::enable_if<
+    has_SingularPartFunctor<Functor>,
+    shared_ptr<const CollectionOfKernels<typename Functor::CoordinateType>>>::
+    type
+singularPartInternal(const Functor &functor) {
+  typedef typename Functor::SingularPartFunctor PartFunctor;
+  return boost::make_shared<DefaultCollectionOfKernels<PartFunctor>>(
+      functor.singularPart());
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    has_SingularPartFunctor<Functor>,
+    shared_ptr<const CollectionOfKernels<typename Functor::CoordinateType>>>::
+    type
+singularPartInternal(const Functor &functor) {
+  return shared_ptr<
+      const CollectionOfKernels<typename Functor::CoordinateType>>();
+}
+
+template <typename Functor>
+typename boost::enable_if<
+    has_SmoothPartFunctor<Functor>,
+    shared_ptr<const CollectionOfKernels<typename Functor::ValueType>>>::type
+smoothPartInternal(const Functor &functor) {
+  typedef typename Functor::SmoothPartFunctor PartFunctor;
+  return boost::make_shared<DefaultCollectionOfKernels<PartFunctor>>(
+      functor.smoothPart());
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    has_SmoothPartFunctor<Functor>,
+    shared_ptr<const CollectionOfKernels<typename Functor::ValueType>>>::type
+smoothPartInternal(const Functor &functor) {
+  return shared_ptr<const CollectionOfKernels<typename Functor::ValueType>>();
+}
+
 template <typename Functor>
 void DefaultCollectionOfKernels<Functor>::addGeometricalDependencies(
     size_t &testGeomDeps, size_t &trialGeomDeps) const {
@@ -135,6 +294,7 @@ void DefaultCollectionOfKernels<Functor>::evaluateAtPointPairs(
   for (size_t k = 0; k < kernelCount; ++k)
     result[k].set_size(m_functor.kernelRowCount(k), m_functor.kernelColCount(k),
                        pointCount);
+  Profiler::addCount(ProfileCounter::KERNEL_EVALUATIONS, pointCount);
 
   for (size_t p = 0; p < pointCount; ++p)
     m_functor.evaluate(testGeomData.const_slice(p),
@@ -153,6 +313,11 @@ void DefaultCollectionOfKernels<Functor>::evaluateOnGrid(
   for (size_t k = 0; k < kernelCount; ++k)
     result[k].set_size(m_functor.kernelRowCount(k), m_functor.kernelColCount(k),
                        testPointCount, trialPointCount);
+  Profiler::addCount(ProfileCounter::KERNEL_EVALUATIONS,
+                     testPointCount * trialPointCount);
+
+  if (evaluateOnGridInternal(m_functor, testGeomData, trialGeomData, result))
+    return;
 
 #pragma ivdep
   for (size_t trialIndex = 0; trialIndex < trialPointCount; ++trialIndex)
@@ -162,6 +327,40 @@ void DefaultCollectionOfKernels<Functor>::evaluateOnGrid(
                          result.slice(testIndex, trialIndex).self());
 }
 
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateBatchOnGrid(
+    const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+    const std::vector<const GeometricalData<CoordinateType> *> &trialGeomData,
+    const std::vector<CollectionOf4dArrays<ValueType> *> &result) const {
+  // The qualified call is bound statically, so the evaluation of the functor
+  // is inlined into the loop over the pairs
+  for (size_t i = 0; i < result.size(); ++i)
+    DefaultCollectionOfKernels::evaluateOnGrid(*testGeomData[i],
+                                               *trialGeomData[i], *result[i]);
+}
+
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateOnGridInSinglePrecision(
+    const GeometricalData<CoordinateType> &testGeomData,
+    const GeometricalData<CoordinateType> &trialGeomData,
+    CollectionOf4dArrays<ValueType> &result) const {
+  KernelTileType type;
+  std::complex<double> waveNumber;
+  if (describeModifiedHelmholtz3dKernel(type, waveNumber)) {
+    result.set_size(1);
+    result[0].set_size(1, 1, testGeomData.pointCount(),
+                       trialGeomData.pointCount());
+    if (evaluateModifiedHelmholtz3dOnGridInSinglePrecision(
+            type, waveNumber, testGeomData, trialGeomData, result[0])) {
+      Profiler::addCount(ProfileCounter::KERNEL_EVALUATIONS,
+                         testGeomData.pointCount() *
+                             trialGeomData.pointCount());
+      return;
+    }
+  }
+  evaluateOnGrid(testGeomData, trialGeomData, result);
+}
+
 template <typename Functor>
 std::pair<const char *, int>
 DefaultCollectionOfKernels<Functor>::evaluateClCode() const {
@@ -169,6 +368,42 @@ DefaultCollectionOfKernels<Functor>::evaluateClCode() const {
                            "not implemented yet");
 }
 
+template <typename Functor>
+bool DefaultCollectionOfKernels<Functor>::describeModifiedHelmholtz3dKernel(
+    KernelTileType &type, std::complex<double> &waveNumber) const {
+  return describeModifiedHelmholtz3dKernelInternal(m_functor, type,
+                                                   waveNumber);
+}
+
+template <typename Functor>
+typename DefaultCollectionOfKernels<Functor>::CoordinateType
+DefaultCollectionOfKernels<Functor>::oscillationWaveNumber() const {
+  return oscillationWaveNumberInternal(m_functor);
+}
+
+template <typename Functor>
+bool DefaultCollectionOfKernels<Functor>::isFarFieldKernel() const {
+  return isFarFieldKernelInternal(m_functor);
+}
+
+template <typename Functor>
+bool DefaultCollectionOfKernels<Functor>::vanishesOnCoplanarElements() const {
+  return vanishesOnCoplanarElementsInternal(m_functor);
+}
+
+template <typename Functor>
+shared_ptr<const CollectionOfKernels<
+    typename DefaultCollectionOfKernels<Functor>::CoordinateType>>
+DefaultCollectionOfKernels<Functor>::singularPart() const {
+  return singularPartInternal(m_functor);
+}
+
+template <typename Functor>
+shared_ptr<const typename DefaultCollectionOfKernels<Functor>::Base>
+DefaultCollectionOfKernels<Functor>::smoothPart() const {
+  return smoothPartInternal(m_functor);
+}
+
 template <typename Functor>
 typename DefaultCollectionOfKernels<Functor>::CoordinateType
 DefaultCollectionOfKernels<Functor>::estimateRelativeScale(
@@ -30,6 +30,8 @@
 #include "quadrature_options.hpp"
 
 #include "../common/armadillo_fwd.hpp"
+#include "../common/lazy.hpp"
+#include <memory>
 #include <vector>
 
 namespace Fiber {
@@ -43,9 +45,12 @@ template <typename BasisFunctionType, typename KernelType, typename ResultType>
 class KernelTrialIntegral;
 template <typename CoordinateType> class RawGridGeometry;
 class OpenClHandler;
+class OpenClPotentialEvaluator;
 template <typename BasisFunctionType>
 class QuadratureDescriptorSelectorForPotentialOperators;
 template <typename CoordinateType> class SingleQuadratureRuleFamily;
+template <typename CoordinateType> class ElementBoundingVolumeHierarchy;
+template <typename ValueType> class BasisData;
 /** \endcond */
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -78,13 +83,34 @@ public:
 
   virtual void evaluate(Region region, const arma::Mat<CoordinateType> &points,
                         arma::Mat<ResultType> &result) const;
+  virtual void evaluate(Region region, const CoordinateType *points,
+                        size_t pointCount, ResultType *result) const;
+
+  virtual int worldDimension() const;
+  virtual int resultDimension() const;
 
 private:
+  typedef typename GeometryFactory::Geometry Geometry;
+
+  // Number of points whose near-field corrections are grouped together
+  enum { NEAR_FIELD_CHUNK_SIZE = 256 };
+
   void cacheTrialData();
+  void makeOpenClFarFieldEvaluator();
   void calcTrialData(Region region, int kernelTrialGeomDeps,
                      GeometricalData<CoordinateType> &trialGeomData,
                      CollectionOf2dArrays<ResultType> &trialExprValues,
                      std::vector<CoordinateType> &weights) const;
+  void calcTrialDataOnElement(
+      int element, size_t basisDeps, size_t trialGeomDeps,
+      const BasisData<BasisFunctionType> &basisData,
+      const arma::Mat<CoordinateType> &localQuadPoints,
+      const std::vector<CoordinateType> &quadWeights, Geometry &geometry,
+      GeometricalData<CoordinateType> &geomData,
+      CollectionOf2dArrays<ResultType> &trialTransfValues,
+      std::vector<CoordinateType> &weights) const;
+  void addNearFieldCorrections(const arma::Mat<CoordinateType> &points,
+                               ResultType *result) const;
 
 private:
   const shared_ptr<const GeometryFactory> m_geometryFactory;
@@ -105,12 +131,17 @@ private:
   const shared_ptr<const SingleQuadratureRuleFamily<CoordinateType>>
   m_quadRuleFamily;
 
-  Fiber::GeometricalData<CoordinateType> m_nearFieldTrialGeomData;
+  size_t m_kernelTrialGeomDeps;
   Fiber::GeometricalData<CoordinateType> m_farFieldTrialGeomData;
-  CollectionOf2dArrays<ResultType> m_nearFieldTrialTransfValues;
   CollectionOf2dArrays<ResultType> m_farFieldTrialTransfValues;
-  std::vector<CoordinateType> m_nearFieldWeights;
   std::vector<CoordinateType> m_farFieldWeights;
+  // Sums the far field on the OpenCL device if the kernel and integral
+  // are of a form it supports; null otherwise
+  shared_ptr<const OpenClPotentialEvaluator> m_openClFarField;
+
+  // Built on the first evaluation in the near field
+  Bempp::Lazy<std::unique_ptr<const ElementBoundingVolumeHierarchy<
+      CoordinateType>>> m_elementHierarchy;
 };
 
 } // namespace Fiber
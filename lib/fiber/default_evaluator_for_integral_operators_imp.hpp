@@ -29,16 +29,23 @@
 #include "collection_of_2d_arrays.hpp"
 #include "collection_of_3d_arrays.hpp"
 #include "collection_of_4d_arrays.hpp"
+#include "element_bounding_volume_hierarchy.hpp"
 #include "kernel_trial_integral.hpp"
 #include "numerical_quadrature.hpp"
 #include "opencl_handler.hpp"
+#include "opencl_potential_evaluator.hpp"
+#include "quadrature_descriptor_selector_for_potential_operators.hpp"
 #include "raw_grid_geometry.hpp"
 #include "serial_blas_region.hpp"
 #include "shapeset.hpp"
+#include "task_arena_cache.hpp"
+
+#include "../common/boost_make_shared_fwd.hpp"
+#include "../common/complex_aux.hpp"
 
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
 
+#include <algorithm>
 #include <assert.h>
 
 namespace Fiber {
@@ -57,12 +64,12 @@ public:
                      const CollectionOfKernels<KernelType> &kernels,
                      const KernelTrialIntegral<BasisFunctionType, KernelType,
                                                ResultType> &integral,
-                     arma::Mat<ResultType> &result)
+                     size_t outputComponentCount, ResultType *result)
       : m_chunkSize(chunkSize), m_points(points),
         m_trialGeomData(trialGeomData), m_trialTransfValues(trialTransfValues),
         m_weights(weights), m_kernels(kernels), m_integral(integral),
-        m_result(result), m_pointCount(result.n_cols),
-        m_outputComponentCount(result.n_rows) {}
+        m_result(result), m_pointCount(points.n_cols),
+        m_outputComponentCount(outputComponentCount) {}
 
   void operator()(const tbb::blocked_range<size_t> &r) const {
     CollectionOf4dArrays<KernelType> kernelValues;
@@ -75,7 +82,8 @@ public:
                                kernelValues);
       // View into the current chunk of the "result" array
       _2dArray<ResultType> resultChunk(m_outputComponentCount, end - start,
-                                       m_result.colptr(start));
+                                       m_result +
+                                           start * m_outputComponentCount);
       m_integral.evaluate(m_trialGeomData, kernelValues, m_trialTransfValues,
                           m_weights, resultChunk);
     }
@@ -90,7 +98,7 @@ private:
   const CollectionOfKernels<KernelType> &m_kernels;
   const KernelTrialIntegral<BasisFunctionType, KernelType, ResultType> &
   m_integral;
-  arma::Mat<ResultType> &m_result;
+  ResultType *m_result;
   size_t m_pointCount;
   size_t m_outputComponentCount;
 };
@@ -154,24 +162,51 @@ void DefaultEvaluatorForIntegralOperators<
     GeometryFactory>::evaluate(Region region,
                                const arma::Mat<CoordinateType> &points,
                                arma::Mat<ResultType> &result) const {
-  const size_t pointCount = points.n_cols;
-  const int outputComponentCount = m_integral->resultDimension();
+  result.set_size(resultDimension(), points.n_cols);
+  evaluate(region, points.memptr(), points.n_cols, result.memptr());
+}
 
-  result.set_size(outputComponentCount, pointCount);
-  result.fill(0.);
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::evaluate(Region region, const CoordinateType *points,
+                               size_t pointCount, ResultType *result) const {
+  const int outputComponentCount = m_integral->resultDimension();
+  std::fill(result, result + outputComponentCount * pointCount,
+            static_cast<ResultType>(0.));
+  // View into the caller's array of points
+  const arma::Mat<CoordinateType> pointView(
+      const_cast<CoordinateType *>(points), worldDimension(), pointCount,
+      false /* copy_aux_mem */);
+
+  if (m_openClFarField) {
+    // The far field is summed on the device and only the near-field
+    // corrections are computed on the CPU
+    arma::Mat<double> devicePoints =
+        arma::conv_to<arma::Mat<double>>::from(pointView);
+    arma::Mat<std::complex<double>> deviceResult(1, pointCount);
+    m_openClFarField->evaluate(devicePoints.memptr(), pointCount,
+                               deviceResult.memptr());
+    // For real result types only the real part is kept
+    const arma::Mat<ResultType> hostResult =
+        arma::conv_to<arma::Mat<ResultType>>::from(deviceResult);
+    std::copy(hostResult.begin(), hostResult.end(), result);
+    if (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) {
+      Fiber::SerialBlasRegion region;
+      executeInTaskArena(m_parallelizationOptions.maxThreadCount(),
+                         [&] { addNearFieldCorrections(pointView, result); });
+    }
+    return;
+  }
 
+  // In the near field, the far-field result is corrected afterwards for the
+  // elements lying close to the points
   const GeometricalData<CoordinateType> &trialGeomData =
-      (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD)
-          ? m_nearFieldTrialGeomData
-          : m_farFieldTrialGeomData;
+      m_farFieldTrialGeomData;
   const CollectionOf2dArrays<ResultType> &trialTransfValues =
-      (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD)
-          ? m_nearFieldTrialTransfValues
-          : m_farFieldTrialTransfValues;
-  const std::vector<CoordinateType> &weights =
-      (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD)
-          ? m_nearFieldWeights
-          : m_farFieldWeights;
+      m_farFieldTrialTransfValues;
+  const std::vector<CoordinateType> &weights = m_farFieldWeights;
 
   // Do things in chunks -- in order to avoid creating
   // too large arrays of kernel values
@@ -185,20 +220,19 @@ void DefaultEvaluatorForIntegralOperators<
   const size_t chunkCount = (pointCount + chunkSize - 1) / chunkSize;
 
   int maxThreadCount = 1;
-  if (!m_parallelizationOptions.isOpenClEnabled()) {
-    if (m_parallelizationOptions.maxThreadCount() ==
-        ParallelizationOptions::AUTO)
-      maxThreadCount = tbb::task_scheduler_init::automatic;
-    else
-      maxThreadCount = m_parallelizationOptions.maxThreadCount();
-  }
-  tbb::task_scheduler_init scheduler(maxThreadCount);
+  if (!m_parallelizationOptions.isOpenClEnabled())
+    maxThreadCount = m_parallelizationOptions.maxThreadCount();
   typedef EvaluationLoopBody<BasisFunctionType, KernelType, ResultType> Body;
   {
     Fiber::SerialBlasRegion region;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount),
-                      Body(chunkSize, points, trialGeomData, trialTransfValues,
-                           weights, *m_kernels, *m_integral, result));
+    executeInTaskArena(maxThreadCount, [&] {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount),
+                        Body(chunkSize, pointView, trialGeomData,
+                             trialTransfValues, weights, *m_kernels,
+                             *m_integral, outputComponentCount, result));
+      if (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD)
+        addNearFieldCorrections(pointView, result);
+    });
   }
 
   //    // Old serial version
@@ -221,6 +255,24 @@ void DefaultEvaluatorForIntegralOperators<
   //    }
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+int DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+                                         ResultType,
+                                         GeometryFactory>::worldDimension()
+    const {
+  return m_rawGeometry->worldDimension();
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+int DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+                                         ResultType,
+                                         GeometryFactory>::resultDimension()
+    const {
+  return m_integral->resultDimension();
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 void
@@ -234,13 +286,46 @@ DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType, ResultType,
         "potentials cannot contain kernels that depend on other test data "
         "than global coordinates");
 
+  m_kernelTrialGeomDeps = trialGeomDeps;
   calcTrialData(EvaluatorForIntegralOperators<ResultType>::FAR_FIELD,
                 trialGeomDeps, m_farFieldTrialGeomData,
                 m_farFieldTrialTransfValues, m_farFieldWeights);
-  // near field is currently not treated in any special way
-  calcTrialData(EvaluatorForIntegralOperators<ResultType>::FAR_FIELD,
-                trialGeomDeps, m_nearFieldTrialGeomData,
-                m_nearFieldTrialTransfValues, m_nearFieldWeights);
+  makeOpenClFarFieldEvaluator();
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::makeOpenClFarFieldEvaluator() {
+  if (!m_parallelizationOptions.isOpenClEnabled() || !m_openClHandler ||
+      !m_openClHandler->UseOpenCl())
+    return;
+  KernelTileType type;
+  std::complex<double> waveNumber;
+  if (worldDimension() != 3 || m_integral->resultDimension() != 1 ||
+      !m_integral->isScalarKernelTrialProduct() ||
+      !m_kernels->describeModifiedHelmholtz3dKernel(type, waveNumber) ||
+      (type != SINGLE_LAYER_TILE && type != DOUBLE_LAYER_TILE) ||
+      m_farFieldTrialTransfValues.size() != 1 ||
+      m_farFieldTrialTransfValues[0].extent(0) != 1)
+    return;
+
+  const size_t quadPointCount = m_farFieldWeights.size();
+  std::vector<std::complex<double>> densities(quadPointCount);
+  for (size_t q = 0; q < quadPointCount; ++q) {
+    const ResultType value =
+        m_farFieldWeights[q] * m_farFieldTrialTransfValues[0](0, q);
+    densities[q] = std::complex<double>(realPart(value), imagPart(value));
+  }
+  arma::Mat<double> quadPoints =
+      arma::conv_to<arma::Mat<double>>::from(m_farFieldTrialGeomData.globals);
+  arma::Mat<double> quadNormals;
+  if (type == DOUBLE_LAYER_TILE)
+    quadNormals =
+        arma::conv_to<arma::Mat<double>>::from(m_farFieldTrialGeomData.normals);
+  m_openClFarField = boost::make_shared<OpenClPotentialEvaluator>(
+      m_openClHandler, type, waveNumber, quadPoints, quadNormals, densities);
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -269,9 +354,9 @@ void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
   m_trialTransformations->addDependencies(basisDeps, trialGeomDeps);
   trialGeomDeps |= INTEGRATION_ELEMENTS;
 
-  // Initialise the geometry factory
-  typedef typename GeometryFactory::Geometry Geometry;
-  std::unique_ptr<Geometry> geometry(m_geometryFactory->make());
+  int maxThreadCount = 1;
+  if (!m_parallelizationOptions.isOpenClEnabled())
+    maxThreadCount = m_parallelizationOptions.maxThreadCount();
 
   // Find all unique trial shapesets
   // Set of unique quadrature variants
@@ -322,101 +407,36 @@ void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
     BasisData<BasisFunctionType> basisData;
     activeShapeset.evaluate(basisDeps, localQuadPoints, ALL_DOFS, basisData);
 
-    BasisData<ResultType> argumentData;
-    if (basisDeps & VALUES)
-      argumentData.values.set_size(basisData.values.extent(0),
-                                   1, // just one function
-                                   basisData.values.extent(2));
-    if (basisDeps & DERIVATIVES)
-      argumentData.derivatives.set_size(basisData.derivatives.extent(0),
-                                        basisData.derivatives.extent(1),
-                                        1, // just one function
-                                        basisData.derivatives.extent(3));
-
-    // Loop over elements and process those that use the active shapeset
-    CollectionOf3dArrays<ResultType> trialValues;
-    for (int e = 0; e < elementCount; ++e) {
-      if ((*m_trialShapesets)[e] != &activeShapeset)
-        continue;
-
-      // Local coefficients of the argument in the current element
-      const std::vector<ResultType> &localCoefficients =
-          (*m_argumentLocalCoefficients)[e];
-
-      // Calculate the argument function's values and/or derivatives
-      // at quadrature points in the current element
-      if (basisDeps & VALUES) {
-        std::fill(argumentData.values.begin(), argumentData.values.end(), 0.);
-        assert(localCoefficients.size() == basisData.values.extent(1));
-        for (size_t point = 0; point < basisData.values.extent(2); ++point)
-          for (size_t dim = 0; dim < basisData.values.extent(0); ++dim)
-            for (size_t fun = 0; fun < basisData.values.extent(1); ++fun)
-              argumentData.values(dim, 0, point) +=
-                  basisData.values(dim, fun, point) * localCoefficients[fun];
-      }
-      if (basisDeps & DERIVATIVES) {
-        std::fill(argumentData.derivatives.begin(),
-                  argumentData.derivatives.end(), 0.);
-        assert(localCoefficients.size() == basisData.derivatives.extent(2));
-        for (size_t point = 0; point < basisData.derivatives.extent(3); ++point)
-          for (size_t dim = 0; dim < basisData.derivatives.extent(1); ++dim)
-            for (size_t comp = 0; comp < basisData.derivatives.extent(0);
-                 ++comp)
-              for (size_t fun = 0; fun < basisData.derivatives.extent(2); ++fun)
-                argumentData.derivatives(comp, dim, 0, point) +=
-                    basisData.derivatives(comp, dim, fun, point) *
-                    localCoefficients[fun];
+    // Elements that use the active shapeset
+    std::vector<int> activeElements;
+    for (int e = 0; e < elementCount; ++e)
+      if ((*m_trialShapesets)[e] == &activeShapeset)
+        activeElements.push_back(e);
+    const size_t localQuadPointCount = quadWeights.size();
+
+    // Process these elements in parallel; each range has its own geometry
+    // and writes only to the entries of its elements
+    auto processElements = [&](const tbb::blocked_range<size_t> &r) {
+      std::unique_ptr<Geometry> geometry(m_geometryFactory->make());
+      for (size_t i = r.begin(); i != r.end(); ++i) {
+        const int e = activeElements[i];
+        calcTrialDataOnElement(e, basisDeps, trialGeomDeps, basisData,
+                               localQuadPoints, quadWeights, *geometry,
+                               geomDataPerElement[e],
+                               trialTransfValuesPerElement[e],
+                               weightsPerElement[e]);
       }
-
-      // Get geometrical data
-      m_rawGeometry->setupGeometry(e, *geometry);
-      geometry->getData(trialGeomDeps, localQuadPoints, geomDataPerElement[e]);
-      if (trialGeomDeps & Fiber::DOMAIN_INDEX)
-        geomDataPerElement[e].domainIndex = m_rawGeometry->domainIndex(e);
-
-      m_trialTransformations->evaluate(argumentData, geomDataPerElement[e],
-                                       trialValues);
-
-      //            weightedTrialTransfValuesPerElement[e].set_size(transformationCount);
-      //            for (int transf = 0; transf < transformationCount; ++transf)
-      //            {
-      //                const size_t dimCount = trialValues[transf].extent(0);
-      //                const size_t quadPointCount =
-      // trialValues[transf].extent(2);
-      //                weightedTrialTransfValuesPerElement[e][transf].set_size(
-      //                            dimCount, quadPointCount);
-      //                for (size_t point = 0; point < quadPointCount; ++point)
-      //                    for (size_t dim = 0; dim < dimCount; ++dim)
-      //                        weightedTrialTransfValuesPerElement[e][transf](dim,
-      // point) =
-      //                                trialValues[transf](dim, 0, point) *
-      //                                geomDataPerElement[e].integrationElements(point)
-      // *
-      //                                quadWeights[point];
-      //            } // end of loop over transformations
-
-      const size_t localQuadPointCount = quadWeights.size();
-
-      trialTransfValuesPerElement[e].set_size(transformationCount);
-      for (int transf = 0; transf < transformationCount; ++transf) {
-        const size_t dimCount = trialValues[transf].extent(0);
-        assert(trialValues[transf].extent(2) == localQuadPointCount);
-        trialTransfValuesPerElement[e][transf]
-            .set_size(dimCount, localQuadPointCount);
-        for (size_t point = 0; point < localQuadPointCount; ++point)
-          for (size_t dim = 0; dim < dimCount; ++dim)
-            trialTransfValuesPerElement[e][transf](dim, point) =
-                trialValues[transf](dim, 0, point);
-      } // end of loop over transformations
-
-      weightsPerElement[e].resize(localQuadPointCount);
-      for (size_t point = 0; point < localQuadPointCount; ++point)
-        weightsPerElement[e][point] =
-            quadWeights[point] *
-            geomDataPerElement[e].integrationElements(point);
-
-      quadPointCount += quadWeights.size();
-    } // end of loop over elements
+    };
+
+    {
+      Fiber::SerialBlasRegion region;
+      executeInTaskArena(maxThreadCount, [&] {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, activeElements.size()),
+            processElements);
+      });
+    }
+    quadPointCount += activeElements.size() * localQuadPointCount;
   }   // end of loop over unique shapesets
 
   // In the following, weightedTrialExprValuesPerElement[e][transf].extent(1) is
@@ -497,4 +517,222 @@ void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
   }
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+                                          ResultType, GeometryFactory>::
+    calcTrialDataOnElement(int element, size_t basisDeps, size_t trialGeomDeps,
+                           const BasisData<BasisFunctionType> &basisData,
+                           const arma::Mat<CoordinateType> &localQuadPoints,
+                           const std::vector<CoordinateType> &quadWeights,
+                           Geometry &geometry,
+                           GeometricalData<CoordinateType> &geomData,
+                           CollectionOf2dArrays<ResultType> &trialTransfValues,
+                           std::vector<CoordinateType> &weights) const {
+  const int transformationCount = m_trialTransformations->transformationCount();
+  const size_t localQuadPointCount = quadWeights.size();
+
+  // Local coefficients of the argument in the current element
+  const std::vector<ResultType> &localCoefficients =
+      (*m_argumentLocalCoefficients)[element];
+
+  // Calculate the argument function's values and/or derivatives
+  // at quadrature points in the current element
+  BasisData<ResultType> argumentData;
+  if (basisDeps & VALUES) {
+    argumentData.values.set_size(basisData.values.extent(0),
+                                 1, // just one function
+                                 basisData.values.extent(2));
+    std::fill(argumentData.values.begin(), argumentData.values.end(), 0.);
+    assert(localCoefficients.size() == basisData.values.extent(1));
+    for (size_t point = 0; point < basisData.values.extent(2); ++point)
+      for (size_t dim = 0; dim < basisData.values.extent(0); ++dim)
+        for (size_t fun = 0; fun < basisData.values.extent(1); ++fun)
+          argumentData.values(dim, 0, point) +=
+              basisData.values(dim, fun, point) * localCoefficients[fun];
+  }
+  if (basisDeps & DERIVATIVES) {
+    argumentData.derivatives.set_size(basisData.derivatives.extent(0),
+                                      basisData.derivatives.extent(1),
+                                      1, // just one function
+                                      basisData.derivatives.extent(3));
+    std::fill(argumentData.derivatives.begin(), argumentData.derivatives.end(),
+              0.);
+    assert(localCoefficients.size() == basisData.derivatives.extent(2));
+    for (size_t point = 0; point < basisData.derivatives.extent(3); ++point)
+      for (size_t dim = 0; dim < basisData.derivatives.extent(1); ++dim)
+        for (size_t comp = 0; comp < basisData.derivatives.extent(0); ++comp)
+          for (size_t fun = 0; fun < basisData.derivatives.extent(2); ++fun)
+            argumentData.derivatives(comp, dim, 0, point) +=
+                basisData.derivatives(comp, dim, fun, point) *
+                localCoefficients[fun];
+  }
+
+  // Get geometrical data
+  m_rawGeometry->setupGeometry(element, geometry);
+  geometry.getData(trialGeomDeps, localQuadPoints, geomData);
+  if (trialGeomDeps & Fiber::DOMAIN_INDEX)
+    geomData.domainIndex = m_rawGeometry->domainIndex(element);
+
+  CollectionOf3dArrays<ResultType> trialValues;
+  m_trialTransformations->evaluate(argumentData, geomData, trialValues);
+
+  trialTransfValues.set_size(transformationCount);
+  for (int transf = 0; transf < transformationCount; ++transf) {
+    const size_t dimCount = trialValues[transf].extent(0);
+    assert(trialValues[transf].extent(2) == localQuadPointCount);
+    trialTransfValues[transf].set_size(dimCount, localQuadPointCount);
+    for (size_t point = 0; point < localQuadPointCount; ++point)
+      for (size_t dim = 0; dim < dimCount; ++dim)
+        trialTransfValues[transf](dim, point) =
+            trialValues[transf](dim, 0, point);
+  } // end of loop over transformations
+
+  weights.resize(localQuadPointCount);
+  for (size_t point = 0; point < localQuadPointCount; ++point)
+    weights[point] = quadWeights[point] * geomData.integrationElements(point);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+                                          ResultType, GeometryFactory>::
+    addNearFieldCorrections(const arma::Mat<CoordinateType> &points,
+                            ResultType *result) const {
+  // Contributions of elements whose quadrature descriptor at a point differs
+  // from the far-field one are recalculated with the near-field rule; the
+  // candidate elements are looked up in a bounding volume hierarchy
+  const CoordinateType nearFieldDistance =
+      m_quadDescSelector->nearFieldDistance();
+  if (!(nearFieldDistance > 0.) || points.n_cols == 0)
+    return;
+  typedef ElementBoundingVolumeHierarchy<CoordinateType> Hierarchy;
+  const Hierarchy &elementHierarchy = *m_elementHierarchy.get([&]() {
+    return std::unique_ptr<const Hierarchy>(new Hierarchy(
+        m_rawGeometry->vertices(), m_rawGeometry->elementCornerIndices()));
+  });
+
+  size_t basisDeps = 0;
+  size_t trialGeomDeps = m_kernelTrialGeomDeps;
+  m_trialTransformations->addDependencies(basisDeps, trialGeomDeps);
+  trialGeomDeps |= INTEGRATION_ELEMENTS;
+  const int outputComponentCount = m_integral->resultDimension();
+  const int worldDim = points.n_rows;
+
+  // (element, near-field rule, point) triple needing a correction
+  struct NearFieldEntry {
+    int element;
+    SingleQuadratureDescriptor desc;
+    size_t point;
+    bool operator<(const NearFieldEntry &other) const {
+      if (element != other.element)
+        return element < other.element;
+      if (desc != other.desc)
+        return desc < other.desc;
+      return point < other.point;
+    }
+  };
+
+  // Each chunk of points first collects the list of its near-field entries
+  // and sorts it by element and rule. The trial data of an element are then
+  // calculated once per rule and the kernel is evaluated at all points of
+  // the chunk sharing them in a single call.
+  const size_t chunkSize = NEAR_FIELD_CHUNK_SIZE;
+  const size_t chunkCount = (points.n_cols + chunkSize - 1) / chunkSize;
+  tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk) {
+    const size_t chunkBegin = chunk * chunkSize;
+    const size_t chunkEnd =
+        std::min<size_t>(chunkBegin + chunkSize, points.n_cols);
+
+    std::vector<NearFieldEntry> entries;
+    std::vector<int> elements;
+    for (size_t pt = chunkBegin; pt != chunkEnd; ++pt) {
+      elementHierarchy.elementsWithinDistance(points.colptr(pt),
+                                              nearFieldDistance, elements);
+      if (elements.empty())
+        continue;
+      const arma::Col<CoordinateType> point = points.col(pt);
+      for (size_t i = 0; i < elements.size(); ++i) {
+        const int e = elements[i];
+        NearFieldEntry entry;
+        entry.element = e;
+        entry.desc = m_quadDescSelector->quadratureDescriptor(point, e, -1.);
+        entry.point = pt;
+        if (entry.desc != m_quadDescSelector->farFieldQuadratureDescriptor(
+                              *(*m_trialShapesets)[e],
+                              m_rawGeometry->elementCornerCount(e)))
+          entries.push_back(entry);
+      }
+    }
+    if (entries.empty())
+      return;
+    std::sort(entries.begin(), entries.end());
+
+    std::unique_ptr<Geometry> geometry(m_geometryFactory->make());
+    arma::Mat<CoordinateType> localQuadPoints;
+    std::vector<CoordinateType> quadWeights;
+    BasisData<BasisFunctionType> basisData;
+    GeometricalData<CoordinateType> nearGeomData, farGeomData;
+    CollectionOf2dArrays<ResultType> nearTransfValues, farTransfValues;
+    std::vector<CoordinateType> nearWeights, farWeights;
+    GeometricalData<CoordinateType> evalPointGeomData;
+    CollectionOf4dArrays<KernelType> kernelValues;
+    _2dArray<ResultType> nearContribution, farContribution;
+
+    auto calcElementData = [&](int e, const SingleQuadratureDescriptor &desc,
+                               GeometricalData<CoordinateType> &geomData,
+                               CollectionOf2dArrays<ResultType> &transfValues,
+                               std::vector<CoordinateType> &weights) {
+      m_quadRuleFamily->fillQuadraturePointsAndWeights(desc, localQuadPoints,
+                                                       quadWeights);
+      (*m_trialShapesets)[e]->evaluate(basisDeps, localQuadPoints, ALL_DOFS,
+                                       basisData);
+      calcTrialDataOnElement(e, basisDeps, trialGeomDeps, basisData,
+                             localQuadPoints, quadWeights, *geometry,
+                             geomData, transfValues, weights);
+    };
+
+    for (size_t first = 0; first < entries.size();) {
+      const int e = entries[first].element;
+      calcElementData(e, m_quadDescSelector->farFieldQuadratureDescriptor(
+                             *(*m_trialShapesets)[e],
+                             m_rawGeometry->elementCornerCount(e)),
+                      farGeomData, farTransfValues, farWeights);
+      // Loop over the rules used for this element
+      while (first < entries.size() && entries[first].element == e) {
+        size_t last = first;
+        while (last < entries.size() && entries[last].element == e &&
+               entries[last].desc == entries[first].desc)
+          ++last;
+
+        evalPointGeomData.globals.set_size(worldDim, last - first);
+        for (size_t i = first; i < last; ++i)
+          evalPointGeomData.globals.col(i - first) =
+              points.col(entries[i].point);
+
+        // Add the near-field contributions and subtract the far-field ones
+        calcElementData(e, entries[first].desc, nearGeomData,
+                        nearTransfValues, nearWeights);
+        m_kernels->evaluateOnGrid(evalPointGeomData, nearGeomData,
+                                  kernelValues);
+        m_integral->evaluate(nearGeomData, kernelValues, nearTransfValues,
+                             nearWeights, nearContribution);
+        m_kernels->evaluateOnGrid(evalPointGeomData, farGeomData,
+                                  kernelValues);
+        m_integral->evaluate(farGeomData, kernelValues, farTransfValues,
+                             farWeights, farContribution);
+        // The points of a chunk are only written to by this task
+        for (size_t i = first; i < last; ++i) {
+          ResultType *pointResult =
+              result + entries[i].point * outputComponentCount;
+          for (int dim = 0; dim < outputComponentCount; ++dim)
+            pointResult[dim] += nearContribution(dim, i - first) -
+                                farContribution(dim, i - first);
+        }
+        first = last;
+      }
+    }
+  });
+}
+
 } // namespace Fiber
@@ -47,6 +47,8 @@ public:
 
   virtual void addGeometricalDependencies(size_t &trialGeomDeps) const;
 
+  virtual bool isScalarKernelTrialProduct() const;
+
   virtual void
   evaluate(const GeometricalData<CoordinateType> &trialGeomData,
            const CollectionOf4dArrays<KernelType> &kernels,
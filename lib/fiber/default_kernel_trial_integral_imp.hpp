@@ -24,8 +24,10 @@
 #include "default_kernel_trial_integral.hpp"
 
 #include "geometrical_data.hpp"
+#include "has_mem_func.hpp"
 
 #include <algorithm>
+#include <boost/utility/enable_if.hpp>
 
 namespace Fiber {
 
@@ -58,6 +60,33 @@ void DefaultKernelTrialIntegral<IntegrandFunctor>::addGeometricalDependencies(
   m_functor.addGeometricalDependencies(trialGeomDeps);
 }
 
+FIBER_HAS_MEM_FUNC(isScalarKernelTrialProduct, hasIsScalarKernelTrialProduct);
+
+// Functors without an isScalarKernelTrialProduct() member are not assumed to
+// have the simple form.
+
+template <typename Functor>
+typename boost::enable_if<
+    hasIsScalarKernelTrialProduct<Functor, bool (Functor::*)() const>,
+    bool>::type
+isScalarKernelTrialProductInternal(const Functor &functor) {
+  return functor.isScalarKernelTrialProduct();
+}
+
+template <typename Functor>
+typename boost::disable_if<
+    hasIsScalarKernelTrialProduct<Functor, bool (Functor::*)() const>,
+    bool>::type
+isScalarKernelTrialProductInternal(const Functor &functor) {
+  return false;
+}
+
+template <typename IntegrandFunctor>
+bool DefaultKernelTrialIntegral<
+    IntegrandFunctor>::isScalarKernelTrialProduct() const {
+  return isScalarKernelTrialProductInternal(m_functor);
+}
+
 template <typename IntegrandFunctor>
 int DefaultKernelTrialIntegral<IntegrandFunctor>::resultDimension() const {
   return m_functor.resultDimension();
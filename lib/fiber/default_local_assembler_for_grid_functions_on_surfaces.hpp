@@ -30,6 +30,7 @@
 #include "scalar_traits.hpp"
 
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/mutex.h>
 #include <map>
 #include <vector>
 
@@ -98,6 +99,7 @@ private:
   shared_ptr<const SingleQuadratureRuleFamily<CoordinateType>> m_quadRuleFamily;
 
   IntegratorMap m_testFunctionIntegrators;
+  mutable tbb::mutex m_integratorCreationMutex;
 };
 
 } // namespace Fiber
@@ -148,14 +148,16 @@ const TestFunctionIntegrator<BasisFunctionType, ResultType> &
 DefaultLocalAssemblerForGridFunctionsOnSurfaces<
     BasisFunctionType, UserFunctionType, ResultType,
     GeometryFactory>::getIntegrator(const SingleQuadratureDescriptor &desc) {
+  // Lock-free on the read path; see
+  // DefaultLocalAssemblerForIntegralOperatorsOnSurfaces::getIntegrator()
   typename IntegratorMap::iterator it = m_testFunctionIntegrators.find(desc);
-  if (it != m_testFunctionIntegrators.end()) {
-    // std::cout << "getIntegrator(: " << index << "): integrator found" <<
-    // std::endl;
+  if (it != m_testFunctionIntegrators.end())
     return *it->second;
-  }
-  // std::cout << "getIntegrator(: " << index << "): integrator not found" <<
-  // std::endl;
+
+  tbb::mutex::scoped_lock lock(m_integratorCreationMutex);
+  it = m_testFunctionIntegrators.find(desc);
+  if (it != m_testFunctionIntegrators.end())
+    return *it->second; // created by another thread in the meantime
 
   // Integrator doesn't exist yet and must be created.
   arma::Mat<CoordinateType> points;
@@ -169,20 +171,9 @@ DefaultLocalAssemblerForGridFunctionsOnSurfaces<
       points, weights, *m_geometryFactory, *m_rawGeometry,
       *m_testTransformations, *m_function, *m_openClHandler));
 
-  // Attempt to insert the newly created integrator into the map
-  std::pair<typename IntegratorMap::iterator, bool> result =
-      m_testFunctionIntegrators.insert(std::make_pair(desc, integrator));
-  if (result.second)
-    // Insertion succeeded. The newly created integrator will be deleted in
-    // our own destructor
-    ;
-  else
-    // Insertion failed -- another thread was faster. Delete the newly
-    // created integrator.
-    delete integrator;
-
-  // Return pointer to the integrator that ended up in the map.
-  return *result.first->second;
+  // The newly created integrator will be deleted in our own destructor
+  return *m_testFunctionIntegrators.insert(std::make_pair(desc, integrator))
+              .first->second;
 }
 
 } // namespace Fiber
@@ -29,18 +29,22 @@
 #include "accuracy_options.hpp"
 #include "default_local_assembler_for_operators_on_surfaces_utilities.hpp"
 #include "element_pair_topology.hpp"
+#include "memory_registry.hpp"
 #include "numerical_quadrature.hpp"
 #include "parallelization_options.hpp"
 #include "shared_ptr.hpp"
+#include "singular_integral_store.hpp"
 #include "test_kernel_trial_integrator.hpp"
 #include "verbosity_level.hpp"
 
 #include <boost/static_assert.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/mutex.h>
 #include <cstring>
 #include <climits>
+#include <map>
 #include <set>
 #include <utility>
 #include <vector>
@@ -90,7 +94,9 @@ public:
       const shared_ptr<const QuadratureDescriptorSelectorForIntegralOperators<
           CoordinateType>> &quadDescSelector,
       const shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType>> &
-          quadRuleFamily);
+          quadRuleFamily,
+      const shared_ptr<const SingularIntegralStore> &singularIntegralStore =
+          shared_ptr<const SingularIntegralStore>());
   virtual ~DefaultLocalAssemblerForIntegralOperatorsOnSurfaces();
 
 public:
@@ -109,8 +115,21 @@ public:
 
   virtual CoordinateType estimateRelativeScale(CoordinateType minDist) const;
 
+  virtual CoordinateType oscillationWaveNumber() const;
+
+  virtual bool vanishesOnCoplanarElements() const;
+
+  virtual LocalAssemblyStatistics statistics() const;
+
+  virtual void setMemoryOwner(const std::string &owner);
+
 private:
   /** \cond PRIVATE */
+  // The singular parts of split kernels are cached by an assembler for real
+  // kernels, whose cache is read by cacheSplitLocalWeakForms()
+  template <typename, typename, typename, typename>
+  friend class DefaultLocalAssemblerForIntegralOperatorsOnSurfaces;
+
   typedef TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType>
   Integrator;
   typedef typename Integrator::ElementIndexPair ElementIndexPair;
@@ -154,13 +173,54 @@ private:
   void cacheSingularLocalWeakForms();
   void findPairsOfAdjacentElements(ElementIndexPairSet &pairs) const;
   void cacheLocalWeakForms(const ElementIndexPairSet &elementIndexPairs);
+  void cacheSplitLocalWeakForms(
+      const ElementIndexPairSet &elementIndexPairs,
+      const shared_ptr<const CollectionOfKernels<CoordinateType>> &
+          singularKernels,
+      const shared_ptr<const TestKernelTrialIntegral<
+          BasisFunctionType, CoordinateType, BasisFunctionType>> &
+          singularIntegral,
+      const shared_ptr<const CollectionOfKernels<KernelType>> &smoothKernels);
+  void integrateElementPairs(const ElementIndexPairSet &elementIndexPairs,
+                             const std::vector<const Integrator *> &integrators,
+                             std::vector<arma::Mat<ResultType>> &results) const;
+  uint64_t singularIntegralKey(const ElementIndexPairSet &elementIndexPairs);
+  bool loadLocalWeakForms(uint64_t key);
+  void saveLocalWeakForms(uint64_t key) const;
+  void recordCacheMemory();
 
   const Integrator &selectIntegrator(int testElementIndex,
                                      int trialElementIndex,
                                      CoordinateType nominalDistance = -1.);
 
+  /** \brief Integrators used for the combinations of test and trial
+   *  shapesets met in a block of separated elements. */
+  typedef std::vector<boost::tuples::tuple<
+      const Shapeset<BasisFunctionType> *, const Shapeset<BasisFunctionType> *,
+      const Integrator *>> BlockIntegrators;
+
+  /** \brief Return the integrator for a pair of elements of a block whose
+   *  clusters are \p nominalDistance > 0 apart.
+   *
+   *  The integrator is looked up in \p blockIntegrators by the shapesets
+   *  of the elements and only selected by the quadrature descriptor
+   *  selector for shapesets not met before in the block. */
+  const Integrator &selectBlockIntegrator(int testElementIndex,
+                                          int trialElementIndex,
+                                          CoordinateType nominalDistance,
+                                          BlockIntegrators &blockIntegrators);
+
   const Integrator &getIntegrator(const DoubleQuadratureDescriptor &index);
 
+  /** \brief Return true if the test element lies in the plane of the trial
+   *  element. Only used if m_vanishesOnCoplanarElements is set. */
+  bool elementsAreCoplanar(int testElementIndex, int trialElementIndex) const;
+
+  /** \brief Return the cached local weak form for the given pair of
+   *  elements, or 0 if it is not in the singular integral cache. */
+  const arma::Mat<ResultType> *cachedLocalWeakForm(int testElementIndex,
+                                                   int trialElementIndex) const;
+
 private:
   shared_ptr<const GeometryFactory> m_testGeometryFactory;
   shared_ptr<const GeometryFactory> m_trialGeometryFactory;
@@ -183,27 +243,48 @@ private:
   shared_ptr<const QuadratureDescriptorSelectorForIntegralOperators<
       CoordinateType>> m_quadDescSelector;
   shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType>> m_quadRuleFamily;
+  shared_ptr<const SingularIntegralStore> m_singularIntegralStore;
+  // True if the kernels vanish on coplanar elements and both grids are
+  // surfaces in 3D, so that coplanar element pairs can be skipped
+  bool m_vanishesOnCoplanarElements;
 
   typedef tbb::concurrent_unordered_map<DoubleQuadratureDescriptor,
                                         Integrator *> IntegratorMap;
   IntegratorMap m_testKernelTrialIntegrators;
   mutable tbb::mutex m_integratorCreationMutex;
 
-  enum {
-    INVALID_INDEX = INT_MAX
-  };
-  typedef _2dArray<std::pair<int, arma::Mat<ResultType>>> Cache;
   /** \brief Singular integral cache.
    *
    *  This cache stores the preevaluated local weak forms expressed by
-   *  singular integrals. A particular item it stored in r'th row and c'th
-   *  column stores, in its second member, the local weak form calculated for
-   *  the test element with index it.first and the trial element with index
-   *  c. In each column, the items are sorted after increasing test element
-   *  index. At the end of each column there can be unused items with test
-   *  element index set to INVALID_INDEX (= INT_MAX, so that the sorting is
-   *  preserved). */
-  Cache m_cache;
+   *  singular integrals in compressed sparse column format. The forms
+   *  calculated for the trial element with index c are the items
+   *  m_cacheColumnStarts[c] to m_cacheColumnStarts[c + 1] - 1 of
+   *  m_cachedLocalWeakForms; m_cacheTestElementIndices holds the
+   *  corresponding test element indices, sorted increasingly within each
+   *  column. A lookup only searches the neighbours of one trial element,
+   *  and a trial element without cached neighbours is rejected at once.
+   *
+   *  If the forms were loaded from a SingularIntegralStore, they use the
+   *  memory of the file mapping m_singularIntegralFile. */
+  shared_ptr<const SingularIntegralFile> m_singularIntegralFile;
+  std::vector<size_t> m_cacheColumnStarts;
+  std::vector<int> m_cacheTestElementIndices;
+  std::vector<arma::Mat<ResultType>> m_cachedLocalWeakForms;
+  /** \brief Size of the singular integral cache, recorded in the
+   *  MemoryRegistry. */
+  MemoryAllocation m_cacheMemory;
+
+  /** \brief Numbers of element pairs integrated with each integrator and of
+   *  cache hits, counted separately by each thread. */
+  struct UsageCounts {
+    UsageCounts() : cacheHitCount(0) {}
+    std::map<const Integrator *, size_t> elementPairCounts;
+    size_t cacheHitCount;
+  };
+  tbb::enumerable_thread_specific<UsageCounts> m_usageCounts;
+  /** \brief Numbers of precalculated element pairs and the time spent on
+   *  them. */
+  LocalAssemblyStatistics m_cachingStatistics;
   /** \endcond */
 };
 
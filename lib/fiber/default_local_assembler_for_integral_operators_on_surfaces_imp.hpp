@@ -23,14 +23,24 @@
 // Keep IDEs happy
 #include "default_local_assembler_for_integral_operators_on_surfaces.hpp"
 
+#include "collection_of_kernels.hpp"
 #include "double_quadrature_rule_family.hpp"
+#include "element_adjacency.hpp"
 #include "nonseparable_numerical_test_kernel_trial_integrator.hpp"
+#include "profiler.hpp"
 #include "quadrature_descriptor_selector_for_integral_operators.hpp"
+#include "semi_analytic_laplace_3d_single_layer_integrator.hpp"
 #include "separable_numerical_test_kernel_trial_integrator.hpp"
 #include "serial_blas_region.hpp"
-
+#include "task_arena_cache.hpp"
+#include "test_kernel_trial_integral.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <stdexcept>
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
 
 #include "../common/auto_timer.hpp"
 
@@ -105,7 +115,8 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
         const shared_ptr<const QuadratureDescriptorSelectorForIntegralOperators<
             CoordinateType>> &quadDescSelector,
         const shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType>> &
-            quadRuleFamily)
+            quadRuleFamily,
+        const shared_ptr<const SingularIntegralStore> &singularIntegralStore)
     : m_testGeometryFactory(testGeometryFactory),
       m_trialGeometryFactory(trialGeometryFactory),
       m_testRawGeometry(testRawGeometry), m_trialRawGeometry(trialRawGeometry),
@@ -115,12 +126,24 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
       m_openClHandler(openClHandler),
       m_parallelizationOptions(parallelizationOptions),
       m_verbosityLevel(verbosityLevel), m_quadDescSelector(quadDescSelector),
-      m_quadRuleFamily(quadRuleFamily) {
+      m_quadRuleFamily(quadRuleFamily),
+      m_singularIntegralStore(singularIntegralStore),
+      m_vanishesOnCoplanarElements(false),
+      m_cacheMemory(MemoryCategory::SINGULAR_INTEGRAL_CACHES) {
   Utilities::checkConsistencyOfGeometryAndShapesets(*testRawGeometry,
                                                     *testShapesets);
   Utilities::checkConsistencyOfGeometryAndShapesets(*trialRawGeometry,
                                                     *trialShapesets);
 
+  m_vanishesOnCoplanarElements =
+      kernels->vanishesOnCoplanarElements() &&
+      testRawGeometry->gridDimension() == 2 &&
+      testRawGeometry->worldDimension() == 3 &&
+      trialRawGeometry->gridDimension() == 2 &&
+      trialRawGeometry->worldDimension() == 3 &&
+      static_cast<int>(trialRawGeometry->normals().n_cols) ==
+          trialRawGeometry->elementCount();
+
   if (cacheSingularIntegrals)
     cacheSingularLocalWeakForms();
 }
@@ -177,29 +200,25 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   typedef std::pair<const Integrator *, const Shapeset *> QuadVariant;
   const QuadVariant CACHED(0, 0);
   std::vector<QuadVariant> quadVariants(elementACount);
+  size_t cacheHitCount = 0;
+  // Coplanar pairs with vanishing local weak forms
+  size_t zeroCount = 0;
+  std::vector<int> uncachedIndicesA;
+  uncachedIndicesA.reserve(elementACount);
+  // Elements of blocks a positive distance apart share no vertices, and
+  // their quadrature rules only depend on the shapesets
+  const bool farBlock = nominalDistance > 0.;
+  BlockIntegrators blockIntegrators;
   for (int i = 0; i < elementACount; ++i) {
     // Try to find matrix in cache
-    const arma::Mat<ResultType> *cachedLocalWeakForm = 0;
-    if (callVariant == TEST_TRIAL) {
-      const int testElementIndex = elementIndicesA[i];
-      const int trialElementIndex = elementIndexB;
-      for (size_t n = 0; n < m_cache.extent(0); ++n)
-        if (m_cache(n, trialElementIndex).first == testElementIndex) {
-          cachedLocalWeakForm = &m_cache(n, trialElementIndex).second;
-          break;
-        }
-    } else {
-      const int testElementIndex = elementIndexB;
-      const int trialElementIndex = elementIndicesA[i];
-      for (size_t n = 0; n < m_cache.extent(0); ++n)
-        if (m_cache(n, trialElementIndex).first == testElementIndex) {
-          cachedLocalWeakForm = &m_cache(n, trialElementIndex).second;
-          break;
-        }
-    }
+    const arma::Mat<ResultType> *cachedLocalWeakForm =
+        callVariant == TEST_TRIAL
+            ? this->cachedLocalWeakForm(elementIndicesA[i], elementIndexB)
+            : this->cachedLocalWeakForm(elementIndexB, elementIndicesA[i]);
 
     if (cachedLocalWeakForm) { // Matrix found in cache
       quadVariants[i] = CACHED;
+      ++cacheHitCount;
       if (localDofIndexB == ALL_DOFS)
         result[i] = *cachedLocalWeakForm;
       else {
@@ -208,60 +227,77 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
         else
           result[i] = cachedLocalWeakForm->row(localDofIndexB);
       }
+    } else if (m_vanishesOnCoplanarElements &&
+               (callVariant == TEST_TRIAL
+                    ? elementsAreCoplanar(elementIndicesA[i], elementIndexB)
+                    : elementsAreCoplanar(elementIndexB,
+                                          elementIndicesA[i]))) {
+      quadVariants[i] = CACHED;
+      ++zeroCount;
+      const int dofCountA = basesA[i]->size();
+      const int dofCountB = localDofIndexB == ALL_DOFS ? basisB.size() : 1;
+      if (callVariant == TEST_TRIAL)
+        result[i].zeros(dofCountA, dofCountB);
+      else
+        result[i].zeros(dofCountB, dofCountA);
     } else {
+      const int testElementIndex =
+          callVariant == TEST_TRIAL ? elementIndicesA[i] : elementIndexB;
+      const int trialElementIndex =
+          callVariant == TEST_TRIAL ? elementIndexB : elementIndicesA[i];
       const Integrator *integrator =
-          callVariant == TEST_TRIAL
-              ? &selectIntegrator(elementIndicesA[i], elementIndexB,
-                                  nominalDistance)
-              : &selectIntegrator(elementIndexB, elementIndicesA[i],
-                                  nominalDistance);
+          farBlock ? &selectBlockIntegrator(testElementIndex,
+                                            trialElementIndex,
+                                            nominalDistance, blockIntegrators)
+                   : &selectIntegrator(testElementIndex, trialElementIndex,
+                                       nominalDistance);
       quadVariants[i] = QuadVariant(integrator, basesA[i]);
+      uncachedIndicesA.push_back(i);
     }
   }
+  Profiler::addCount(ProfileCounter::CACHE_HITS, cacheHitCount);
+  Profiler::addCount(ProfileCounter::INTEGRALS,
+                     elementACount - cacheHitCount - zeroCount);
+  UsageCounts &usageCounts = m_usageCounts.local();
+  usageCounts.cacheHitCount += cacheHitCount;
 
   // Integration will proceed in batches of test elements having the same
-  // "quadrature variant", i.e. integrator and shapeset
-
-  // Find all the unique quadrature variants present
-  typedef std::set<QuadVariant> QuadVariantSet;
-  // Set of unique quadrature variants
-  QuadVariantSet uniqueQuadVariants(quadVariants.begin(), quadVariants.end());
+  // "quadrature variant", i.e. integrator and shapeset; sorting the
+  // elements by variant makes each batch contiguous
+  std::stable_sort(uncachedIndicesA.begin(), uncachedIndicesA.end(),
+                   [&quadVariants](int a, int b) {
+    return quadVariants[a] < quadVariants[b];
+  });
 
   std::vector<int> activeElementIndicesA;
-  activeElementIndicesA.reserve(elementACount);
+  activeElementIndicesA.reserve(uncachedIndicesA.size());
   std::vector<arma::Mat<ResultType> *> activeLocalResults;
-  activeLocalResults.reserve(elementACount);
+  activeLocalResults.reserve(uncachedIndicesA.size());
 
-  // Now loop over unique quadrature variants
-  for (typename QuadVariantSet::const_iterator it = uniqueQuadVariants.begin();
-       it != uniqueQuadVariants.end(); ++it) {
-    const QuadVariant activeQuadVariant = *it;
-    if (activeQuadVariant == CACHED)
-      continue;
-    const Integrator &activeIntegrator = *it->first;
-    const Shapeset &activeBasisA = *it->second;
+  // Now loop over batches of equal quadrature variants
+  for (size_t begin = 0, end = 0; begin < uncachedIndicesA.size();
+       begin = end) {
+    const QuadVariant activeQuadVariant = quadVariants[uncachedIndicesA[begin]];
+    const Integrator &activeIntegrator = *activeQuadVariant.first;
+    const Shapeset &activeBasisA = *activeQuadVariant.second;
 
-    // Find all the test elements for which quadrature should proceed
-    // according to the current quadrature variant
     activeElementIndicesA.clear();
     activeLocalResults.clear();
-    for (int indexA = 0; indexA < elementACount; ++indexA)
-      if (quadVariants[indexA] == activeQuadVariant) {
-        activeElementIndicesA.push_back(elementIndicesA[indexA]);
-        activeLocalResults.push_back(&result[indexA]);
-      }
+    for (end = begin; end < uncachedIndicesA.size() &&
+                      quadVariants[uncachedIndicesA[end]] == activeQuadVariant;
+         ++end) {
+      const int indexA = uncachedIndicesA[end];
+      activeElementIndicesA.push_back(elementIndicesA[indexA]);
+      activeLocalResults.push_back(&result[indexA]);
+    }
+
+    usageCounts.elementPairCounts[&activeIntegrator] +=
+        activeElementIndicesA.size();
 
     // Integrate!
     activeIntegrator.integrate(callVariant, activeElementIndicesA,
                                elementIndexB, activeBasisA, basisB,
                                localDofIndexB, activeLocalResults);
-
-    // // Distribute the just calculated integrals into the result array
-    // // that will be returned to caller
-    // int i = 0;
-    // for (int indexA = 0; indexA < elementACount; ++indexA)
-    //     if (quadVariants[indexA] == activeQuadVariant)
-    //         result[indexA] = localResult.slice(i++);
   }
 }
 
@@ -285,79 +321,101 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   const QuadVariant CACHED(0, 0, 0);
   Fiber::_2dArray<QuadVariant> quadVariants(testElementCount,
                                             trialElementCount);
+  size_t cacheHitCount = 0;
+  // Coplanar pairs with vanishing local weak forms
+  size_t zeroCount = 0;
+  // Positions (test index, trial index) of the pairs to be integrated
+  std::vector<std::pair<int, int>> uncachedPairs;
+  uncachedPairs.reserve(testElementCount * trialElementCount);
+  // Elements of blocks a positive distance apart share no vertices, and
+  // their quadrature rules only depend on the shapesets
+  const bool farBlock = nominalDistance > 0.;
+  BlockIntegrators blockIntegrators;
 
   for (int trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
     for (int testIndex = 0; testIndex < testElementCount; ++testIndex) {
       const int activeTestElementIndex = testElementIndices[testIndex];
       const int activeTrialElementIndex = trialElementIndices[trialIndex];
       // Try to find matrix in cache
-      const arma::Mat<ResultType> *cachedLocalWeakForm = 0;
-      for (size_t n = 0; n < m_cache.extent(0); ++n)
-        if (m_cache(n, activeTrialElementIndex).first ==
-            activeTestElementIndex) {
-          cachedLocalWeakForm = &m_cache(n, activeTrialElementIndex).second;
-          break;
-        }
+      const arma::Mat<ResultType> *cachedLocalWeakForm =
+          this->cachedLocalWeakForm(activeTestElementIndex,
+                                    activeTrialElementIndex);
 
       if (cachedLocalWeakForm) { // Matrix found in cache
         quadVariants(testIndex, trialIndex) = CACHED;
         result(testIndex, trialIndex) = *cachedLocalWeakForm;
+        ++cacheHitCount;
+      } else if (m_vanishesOnCoplanarElements &&
+                 elementsAreCoplanar(activeTestElementIndex,
+                                     activeTrialElementIndex)) {
+        quadVariants(testIndex, trialIndex) = CACHED;
+        result(testIndex, trialIndex)
+            .zeros((*m_testShapesets)[activeTestElementIndex]->size(),
+                   (*m_trialShapesets)[activeTrialElementIndex]->size());
+        ++zeroCount;
       } else {
         const Integrator *integrator =
-            &selectIntegrator(activeTestElementIndex, activeTrialElementIndex,
-                              nominalDistance);
+            farBlock ? &selectBlockIntegrator(
+                           activeTestElementIndex, activeTrialElementIndex,
+                           nominalDistance, blockIntegrators)
+                     : &selectIntegrator(activeTestElementIndex,
+                                         activeTrialElementIndex,
+                                         nominalDistance);
         quadVariants(testIndex, trialIndex) =
             QuadVariant(integrator, (*m_testShapesets)[activeTestElementIndex],
                         (*m_trialShapesets)[activeTrialElementIndex]);
+        uncachedPairs.push_back(std::make_pair(testIndex, trialIndex));
       }
     }
+  Profiler::addCount(ProfileCounter::CACHE_HITS, cacheHitCount);
+  Profiler::addCount(ProfileCounter::INTEGRALS,
+                     testElementCount * trialElementCount - cacheHitCount -
+                         zeroCount);
+  UsageCounts &usageCounts = m_usageCounts.local();
+  usageCounts.cacheHitCount += cacheHitCount;
 
   // Integration will proceed in batches of element pairs having the same
-  // "quadrature variant", i.e. integrator, test shapeset and trial shapeset
-
-  // Find all the unique quadrature variants present
-  typedef std::set<QuadVariant> QuadVariantSet;
-  // Set of unique quadrature variants
-  QuadVariantSet uniqueQuadVariants(quadVariants.begin(), quadVariants.end());
+  // "quadrature variant", i.e. integrator, test shapeset and trial
+  // shapeset; sorting the pairs by variant makes each batch contiguous
+  std::stable_sort(
+      uncachedPairs.begin(), uncachedPairs.end(),
+      [&quadVariants](const std::pair<int, int> &a,
+                      const std::pair<int, int> &b) {
+        return quadVariants(a.first, a.second) <
+               quadVariants(b.first, b.second);
+      });
 
   std::vector<ElementIndexPair> activeElementPairs;
   std::vector<arma::Mat<ResultType> *> activeLocalResults;
-  activeElementPairs.reserve(testElementCount * trialElementCount);
-  activeLocalResults.reserve(testElementCount * trialElementCount);
+  activeElementPairs.reserve(uncachedPairs.size());
+  activeLocalResults.reserve(uncachedPairs.size());
 
-  // Now loop over unique quadrature variants
-  for (typename QuadVariantSet::const_iterator it = uniqueQuadVariants.begin();
-       it != uniqueQuadVariants.end(); ++it) {
-    const QuadVariant activeQuadVariant = *it;
-    if (activeQuadVariant == CACHED)
-      continue;
-    const Integrator &activeIntegrator = *it->template get<0>();
-    const Shapeset &activeTestShapeset = *it->template get<1>();
-    const Shapeset &activeTrialShapeset = *it->template get<2>();
+  // Now loop over batches of equal quadrature variants
+  for (size_t begin = 0, end = 0; begin < uncachedPairs.size(); begin = end) {
+    const QuadVariant activeQuadVariant =
+        quadVariants(uncachedPairs[begin].first, uncachedPairs[begin].second);
+    const Integrator &activeIntegrator = *activeQuadVariant.template get<0>();
+    const Shapeset &activeTestShapeset = *activeQuadVariant.template get<1>();
+    const Shapeset &activeTrialShapeset = *activeQuadVariant.template get<2>();
 
-    // Find all the element pairs for which quadrature should proceed
-    // according to the current quadrature variant
     activeElementPairs.clear();
     activeLocalResults.clear();
-    for (int trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
-      for (int testIndex = 0; testIndex < testElementCount; ++testIndex)
-        if (quadVariants(testIndex, trialIndex) == activeQuadVariant) {
-          activeElementPairs.push_back(ElementIndexPair(
-              testElementIndices[testIndex], trialElementIndices[trialIndex]));
-          activeLocalResults.push_back(&result(testIndex, trialIndex));
-        }
+    for (end = begin; end < uncachedPairs.size(); ++end) {
+      const int testIndex = uncachedPairs[end].first;
+      const int trialIndex = uncachedPairs[end].second;
+      if (!(quadVariants(testIndex, trialIndex) == activeQuadVariant))
+        break;
+      activeElementPairs.push_back(ElementIndexPair(
+          testElementIndices[testIndex], trialElementIndices[trialIndex]));
+      activeLocalResults.push_back(&result(testIndex, trialIndex));
+    }
+
+    usageCounts.elementPairCounts[&activeIntegrator] +=
+        activeElementPairs.size();
 
     // Integrate!
     activeIntegrator.integrate(activeElementPairs, activeTestShapeset,
                                activeTrialShapeset, activeLocalResults);
-
-    // // Distribute the just calculated integrals into the result array
-    // // that will be returned to caller
-    // int i = 0;
-    // for (int trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
-    //     for (int testIndex = 0; testIndex < testElementCount; ++testIndex)
-    //         if (quadVariants(testIndex, trialIndex) == activeQuadVariant)
-    //             result(testIndex, trialIndex) = localResult.slice(i++);
   }
 }
 
@@ -371,6 +429,86 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   return m_kernels->estimateRelativeScale(minDist);
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+typename DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::CoordinateType
+DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::oscillationWaveNumber() const {
+  return m_kernels->oscillationWaveNumber();
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+bool DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::vanishesOnCoplanarElements() const {
+  return m_vanishesOnCoplanarElements;
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+bool DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+    elementsAreCoplanar(int testElementIndex, int trialElementIndex) const {
+  // The elements are flat, so the test element lies in the plane of the
+  // trial element if its corners do. The tolerance is relative to the size
+  // of the trial element.
+  const arma::Mat<CoordinateType> &testVertices =
+      m_testRawGeometry->vertices();
+  const arma::Mat<int> &testCorners =
+      m_testRawGeometry->elementCornerIndices();
+  const CoordinateType *normal =
+      m_trialRawGeometry->normals().colptr(trialElementIndex);
+  const CoordinateType *origin = m_trialRawGeometry->vertices().colptr(
+      m_trialRawGeometry->elementCornerIndices()(0, trialElementIndex));
+  const CoordinateType tolerance =
+      std::sqrt(std::numeric_limits<CoordinateType>::epsilon() *
+                m_trialRawGeometry->integrationElements()[trialElementIndex]);
+
+  for (size_t corner = 0; corner < testCorners.n_rows; ++corner) {
+    const int vertex = testCorners(corner, testElementIndex);
+    if (vertex < 0)
+      break;
+    const CoordinateType *x = testVertices.colptr(vertex);
+    CoordinateType distance = 0;
+    for (int dim = 0; dim < 3; ++dim)
+      distance += (x[dim] - origin[dim]) * normal[dim];
+    if (std::abs(distance) > tolerance)
+      return false;
+  }
+  return true;
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+LocalAssemblyStatistics DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::statistics()
+    const {
+  LocalAssemblyStatistics result = m_cachingStatistics;
+  std::map<const Integrator *, size_t> elementPairCounts;
+  for (typename tbb::enumerable_thread_specific<UsageCounts>::const_iterator
+           it = m_usageCounts.begin();
+       it != m_usageCounts.end(); ++it) {
+    result.cacheHitCount += it->cacheHitCount;
+    for (typename std::map<const Integrator *, size_t>::const_iterator count =
+             it->elementPairCounts.begin();
+         count != it->elementPairCounts.end(); ++count)
+      elementPairCounts[count->first] += count->second;
+  }
+  // Integrators are created only once per quadrature descriptor
+  for (typename IntegratorMap::const_iterator it =
+           m_testKernelTrialIntegrators.begin();
+       it != m_testKernelTrialIntegrators.end(); ++it) {
+    typename std::map<const Integrator *, size_t>::const_iterator count =
+        elementPairCounts.find(it->second);
+    if (count != elementPairCounts.end())
+      result.elementPairCounts[it->first] += count->second;
+  }
+  return result;
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
@@ -395,36 +533,13 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
     return; // we assume that nonidentical grids are always disjoint
 
   const RawGridGeometry<CoordinateType> &rawGeometry = *m_testRawGeometry;
-
-  const arma::Mat<CoordinateType> &vertices = rawGeometry.vertices();
-  const arma::Mat<int> &elementCornerIndices =
-      rawGeometry.elementCornerIndices();
-
-  const int vertexCount = vertices.n_cols;
-  const int elementCount = elementCornerIndices.n_cols;
-  const int maxCornerCount = elementCornerIndices.n_rows;
-
-  typedef std::vector<int> ElementIndexVector;
-  // ith entry: set of elements sharing vertex number i
-  std::vector<ElementIndexVector> elementsAdjacentToVertex(vertexCount);
-
-  for (int e = 0; e < elementCount; ++e)
-    for (int v = 0; v < maxCornerCount; ++v) {
-      const int index = elementCornerIndices(v, e);
-      if (index >= 0)
-        elementsAdjacentToVertex[index].push_back(e);
-    }
-
-  // Loop over vertex indices
-  for (int v = 0; v < vertexCount; ++v) {
-    const ElementIndexVector &adjacentElements = elementsAdjacentToVertex[v];
-    // Add to pairs each pair of elements adjacent to vertex v
-    const int adjacentElementCount = adjacentElements.size();
-    for (int e1 = 0; e1 < adjacentElementCount; ++e1)
-      for (int e2 = 0; e2 < adjacentElementCount; ++e2)
-        pairs.insert(
-            ElementIndexPair(adjacentElements[e1], adjacentElements[e2]));
-  }
+  const ElementAdjacency adjacency(rawGeometry.elementCornerIndices(),
+                                   rawGeometry.vertices().n_cols);
+  std::vector<ElementIndexPair> adjacentPairs;
+  adjacency.findPairsOfAdjacentElements(adjacentPairs);
+  // adjacentPairs is already sorted in the order of ElementIndexPairSet
+  for (size_t i = 0; i < adjacentPairs.size(); ++i)
+    pairs.insert(pairs.end(), adjacentPairs[i]);
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -434,6 +549,7 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
     GeometryFactory>::cacheLocalWeakForms(const ElementIndexPairSet &
                                               elementIndexPairs) {
   tbb::tick_count start = tbb::tick_count::now();
+  const std::clock_t cpuStart = std::clock();
 
   if (elementIndexPairs.empty())
     return;
@@ -441,32 +557,175 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
     std::cout << "Precalculating singular integrals..." << std::endl;
 
-  // Get the maximum number of neighbours a trial element can have.
-  // This will be used to allocate a cache of correct size.
-  // This loops assumes that elementIndexPairs are sorted after the trial
-  // element index first.
-  size_t maxNeighbourCount = 0;
+  // Build the column structure of the cache. Since elementIndexPairs are
+  // sorted after the trial element index first and the test element index
+  // second, the position of a pair in the set is its position in the cache.
+  size_t trialElementCount = m_trialRawGeometry->elementCount();
+  m_cacheColumnStarts.assign(trialElementCount + 1, 0);
+  m_cacheTestElementIndices.clear();
+  m_cacheTestElementIndices.reserve(elementIndexPairs.size());
   for (typename ElementIndexPairSet::const_iterator it =
            elementIndexPairs.begin();
-       it != elementIndexPairs.end(); /* nothing */) {
-    int curTrialElementIndex = it->second;
-    size_t neighbourCount = 1;
-    for (++it;
-         it != elementIndexPairs.end() && it->second == curTrialElementIndex;
-         ++it) {
-      ++neighbourCount;
+       it != elementIndexPairs.end(); ++it) {
+    ++m_cacheColumnStarts[it->second + 1];
+    m_cacheTestElementIndices.push_back(it->first);
+  }
+  for (size_t trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
+    m_cacheColumnStarts[trialIndex + 1] += m_cacheColumnStarts[trialIndex];
+  m_cachedLocalWeakForms.clear();
+  m_cachedLocalWeakForms.resize(elementIndexPairs.size());
+  m_singularIntegralFile.reset();
+
+  shared_ptr<const CollectionOfKernels<CoordinateType>> singularKernels;
+  shared_ptr<const TestKernelTrialIntegral<BasisFunctionType, CoordinateType,
+                                           BasisFunctionType>>
+      singularIntegral;
+  shared_ptr<const CollectionOfKernels<KernelType>> smoothKernels;
+  if (m_quadDescSelector->splitsSingularKernels()) {
+    singularKernels = m_kernels->singularPart();
+    singularIntegral = m_integral->realKernelIntegral();
+    smoothKernels = m_kernels->smoothPart();
+  }
+  if (singularKernels && singularIntegral && smoothKernels) {
+    cacheSplitLocalWeakForms(elementIndexPairs, singularKernels,
+                             singularIntegral, smoothKernels);
+    recordCacheMemory();
+    tbb::tick_count end = tbb::tick_count::now();
+    m_cachingStatistics.singularCachingWallTime = (end - start).seconds();
+    m_cachingStatistics.singularCachingCpuTime =
+        double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
+      std::cout << "Precalculation of split singular integrals took "
+                << (end - start).seconds() << " s" << std::endl;
+    return;
+  }
+
+  uint64_t storeKey = 0;
+  if (m_singularIntegralStore) {
+    storeKey = singularIntegralKey(elementIndexPairs);
+    if (loadLocalWeakForms(storeKey)) {
+      recordCacheMemory();
+      tbb::tick_count end = tbb::tick_count::now();
+      m_cachingStatistics.singularCachingWallTime = (end - start).seconds();
+      m_cachingStatistics.singularCachingCpuTime =
+          double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+      if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
+        std::cout << "Loading singular integrals from "
+                  << m_singularIntegralStore->fileName(storeKey) << " took "
+                  << (end - start).seconds() << " s" << std::endl;
+      return;
     }
-    maxNeighbourCount = std::max(maxNeighbourCount, neighbourCount);
   }
 
-  // Allocate cache and initialize all test element indices to INVALID_INDEX
-  size_t trialElementCount = m_trialRawGeometry->elementCount();
-  m_cache.set_size(maxNeighbourCount, trialElementCount);
-  for (size_t trialIndex = 0; trialIndex < trialElementCount; ++trialIndex)
-    for (size_t nborIndex = 0; nborIndex < maxNeighbourCount; ++nborIndex)
-      m_cache(nborIndex, trialIndex).first = INVALID_INDEX;
+  // Select integrators to calculate the cached matrices
+  std::vector<const Integrator *> integrators;
+  integrators.reserve(elementIndexPairs.size());
+  for (typename ElementIndexPairSet::const_iterator it =
+           elementIndexPairs.begin();
+       it != elementIndexPairs.end(); ++it) {
+    const DoubleQuadratureDescriptor desc =
+        m_quadDescSelector->quadratureDescriptor(it->first, it->second, -1.);
+    ++m_cachingStatistics.cachedElementPairCounts[desc];
+    integrators.push_back(&getIntegrator(desc));
+  }
+  integrateElementPairs(elementIndexPairs, integrators,
+                        m_cachedLocalWeakForms);
 
-  // Find cached matrices; select integrators to calculate non-cached ones
+  recordCacheMemory();
+  tbb::tick_count end = tbb::tick_count::now();
+  m_cachingStatistics.singularCachingWallTime = (end - start).seconds();
+  m_cachingStatistics.singularCachingCpuTime =
+      double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
+    std::cout << "Precalculation of singular integrals took "
+              << (end - start).seconds() << " s" << std::endl;
+
+  if (m_singularIntegralStore)
+    saveLocalWeakForms(storeKey);
+}
+
+/** \brief Fill the singular integral cache, whose column structure has
+    already been built, with the sums of the integrals of \p singularKernels
+    and \p smoothKernels.
+
+    The singular part has real values and is cached, in real arithmetic
+    unless the basis functions are complex, by an assembler for real kernels
+    integrating \p singularIntegral. That assembler also loads the part from
+    or saves it to the singular integral store; since it does not depend on
+    the kernel parameters, it is reused by operators differing only in, e.g.,
+    the wave number. The bounded part is integrated with the regular rules
+    chosen by the smoothPartQuadratureDescriptor() method of the quadrature
+    descriptor selector, and the singular part is promoted to ResultType when
+    it is added. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+    cacheSplitLocalWeakForms(
+        const ElementIndexPairSet &elementIndexPairs,
+        const shared_ptr<const CollectionOfKernels<CoordinateType>> &
+            singularKernels,
+        const shared_ptr<const TestKernelTrialIntegral<
+            BasisFunctionType, CoordinateType, BasisFunctionType>> &
+            singularIntegral,
+        const shared_ptr<const CollectionOfKernels<KernelType>> &
+            smoothKernels) {
+  typedef DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+      BasisFunctionType, CoordinateType, BasisFunctionType, GeometryFactory>
+  SingularPartAssembler;
+  const SingularPartAssembler singularAssembler(
+      m_testGeometryFactory, m_trialGeometryFactory, m_testRawGeometry,
+      m_trialRawGeometry, m_testShapesets, m_trialShapesets,
+      m_testTransformations, singularKernels, m_trialTransformations,
+      singularIntegral, m_openClHandler, m_parallelizationOptions,
+      m_verbosityLevel, true /* cacheSingularIntegrals */, m_quadDescSelector,
+      m_quadRuleFamily, m_singularIntegralStore);
+  if (singularAssembler.m_cacheColumnStarts != m_cacheColumnStarts ||
+      singularAssembler.m_cacheTestElementIndices != m_cacheTestElementIndices)
+    throw std::runtime_error(
+        "DefaultLocalAssemblerForIntegralOperatorsOnSurfaces::"
+        "cacheSplitLocalWeakForms(): singular part cached for different "
+        "element pairs");
+  m_cachingStatistics.cachedElementPairCounts =
+      singularAssembler.m_cachingStatistics.cachedElementPairCounts;
+
+  DefaultLocalAssemblerForIntegralOperatorsOnSurfaces smoothAssembler(
+      m_testGeometryFactory, m_trialGeometryFactory, m_testRawGeometry,
+      m_trialRawGeometry, m_testShapesets, m_trialShapesets,
+      m_testTransformations, smoothKernels, m_trialTransformations,
+      m_integral, m_openClHandler, m_parallelizationOptions, m_verbosityLevel,
+      false /* cacheSingularIntegrals */, m_quadDescSelector,
+      m_quadRuleFamily);
+  std::vector<const Integrator *> integrators;
+  integrators.reserve(elementIndexPairs.size());
+  for (typename ElementIndexPairSet::const_iterator it =
+           elementIndexPairs.begin();
+       it != elementIndexPairs.end(); ++it) {
+    const DoubleQuadratureDescriptor desc =
+        m_quadDescSelector->smoothPartQuadratureDescriptor(it->first,
+                                                           it->second);
+    ++m_cachingStatistics.cachedElementPairCounts[desc];
+    integrators.push_back(&smoothAssembler.getIntegrator(desc));
+  }
+  integrateElementPairs(elementIndexPairs, integrators,
+                        m_cachedLocalWeakForms);
+  // The forms of the singular part may use the memory of a file mapping and
+  // are only read
+  for (size_t i = 0; i < m_cachedLocalWeakForms.size(); ++i)
+    m_cachedLocalWeakForms[i] += arma::conv_to<arma::Mat<ResultType>>::from(
+        singularAssembler.m_cachedLocalWeakForms[i]);
+}
+
+/** \brief Integrate over the pairs of elements \p elementIndexPairs, the
+    i-th of them with <tt>integrators[i]</tt>, and store the local weak forms
+    in \p results. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+    integrateElementPairs(const ElementIndexPairSet &elementIndexPairs,
+                          const std::vector<const Integrator *> &integrators,
+                          std::vector<arma::Mat<ResultType>> &results) const {
   typedef Fiber::Shapeset<BasisFunctionType> Shapeset;
   typedef boost::tuples::tuple<const Integrator *, const Shapeset *,
                                const Shapeset *> QuadVariant;
@@ -478,14 +737,10 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   {
     ElementIndexPairIterator pairIt = elementIndexPairs.begin();
     QuadVariantIterator qvIt = quadVariants.begin();
-    for (; pairIt != elementIndexPairs.end(); ++pairIt, ++qvIt) {
-      const int testElementIndex = pairIt->first;
-      const int trialElementIndex = pairIt->second;
-      const Integrator *integrator =
-          &selectIntegrator(testElementIndex, trialElementIndex);
-      *qvIt = QuadVariant(integrator, (*m_testShapesets)[testElementIndex],
-                          (*m_trialShapesets)[trialElementIndex]);
-    }
+    for (size_t i = 0; pairIt != elementIndexPairs.end();
+         ++pairIt, ++qvIt, ++i)
+      *qvIt = QuadVariant(integrators[i], (*m_testShapesets)[pairIt->first],
+                          (*m_trialShapesets)[pairIt->second]);
   }
 
   // Integration will proceed in batches of element pairs having the same
@@ -500,18 +755,10 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   std::vector<arma::Mat<ResultType> *> activeLocalResults;
   activeElementPairs.reserve(elementPairCount);
   activeLocalResults.reserve(elementPairCount);
-  // m_cache.rehash(int(elementIndexPairs.size() / m_cache.max_load_factor() +
-  // 1));
 
   int maxThreadCount = 1;
-  if (!m_parallelizationOptions.isOpenClEnabled()) {
-    if (m_parallelizationOptions.maxThreadCount() ==
-        ParallelizationOptions::AUTO)
-      maxThreadCount = tbb::task_scheduler_init::automatic;
-    else
-      maxThreadCount = m_parallelizationOptions.maxThreadCount();
-  }
-  tbb::task_scheduler_init scheduler(maxThreadCount);
+  if (!m_parallelizationOptions.isOpenClEnabled())
+    maxThreadCount = m_parallelizationOptions.maxThreadCount();
 
   // Now loop over unique quadrature variants
   for (typename QuadVariantSet::const_iterator it = uniqueQuadVariants.begin();
@@ -528,23 +775,12 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
     {
       ElementIndexPairIterator pairIt = elementIndexPairs.begin();
       QuadVariantIterator qvIt = quadVariants.begin();
-      size_t neighbourIndex = 0;                    // Cache row index
-      size_t curTrialElementIndex = pairIt->second; // Cache column index
-      for (; pairIt != elementIndexPairs.end(); ++pairIt, ++qvIt) {
-        if (pairIt->second != curTrialElementIndex) {
-          // Go to the next column of cache
-          curTrialElementIndex = pairIt->second;
-          neighbourIndex = 0;
-        }
+      size_t cacheIndex = 0;
+      for (; pairIt != elementIndexPairs.end(); ++pairIt, ++qvIt, ++cacheIndex)
         if (*qvIt == activeQuadVariant) {
           activeElementPairs.push_back(*pairIt);
-          m_cache(neighbourIndex, curTrialElementIndex).first = pairIt->first;
-          activeLocalResults.push_back(
-              &m_cache(neighbourIndex, curTrialElementIndex).second);
+          activeLocalResults.push_back(&results[cacheIndex]);
         }
-        // Increment cache row index
-        ++neighbourIndex;
-      }
     }
 
     // Integrate!
@@ -556,16 +792,159 @@ void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
                                                ResultType> Body;
     {
       Fiber::SerialBlasRegion region;
-      tbb::parallel_for(
-          tbb::blocked_range<size_t>(0, activeElementPairs.size()),
-          Body(activeIntegrator, activeElementPairs, activeTestShapeset,
-               activeTrialShapeset, activeLocalResults));
+      executeInTaskArena(maxThreadCount, [&] {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, activeElementPairs.size()),
+            Body(activeIntegrator, activeElementPairs, activeTestShapeset,
+                 activeTrialShapeset, activeLocalResults));
+      });
     }
   }
-  tbb::tick_count end = tbb::tick_count::now();
-  if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
-    std::cout << "Precalculation of singular integrals took "
-              << (end - start).seconds() << " s" << std::endl;
+}
+
+/** \brief Return the key identifying the cached singular integrals in a
+    SingularIntegralStore.
+
+    The key covers the mesh, the shapesets and the quadrature descriptors of
+    all element pairs. The kernel (including its parameters, e.g. the wave
+    number), the shapeset transformations, the integral and the quadrature
+    rule family are not directly accessible, so they are covered by the local
+    weak forms of one element pair of each topology, evaluated here. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+uint64_t DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+    singularIntegralKey(const ElementIndexPairSet &elementIndexPairs) {
+  SingularIntegralKey key;
+  key.add(singularIntegralValueTypeId<ResultType>());
+
+  // Pairs are only cached for identical test and trial grids
+  key.add(m_testRawGeometry->vertices());
+  key.add(m_testRawGeometry->elementCornerIndices());
+  const size_t elementCount = m_testRawGeometry->elementCount();
+  for (size_t e = 0; e < elementCount; ++e) {
+    key.add((*m_testShapesets)[e]->size());
+    key.add((*m_testShapesets)[e]->order());
+    key.add((*m_trialShapesets)[e]->size());
+    key.add((*m_trialShapesets)[e]->order());
+  }
+
+  bool topologySampled[ElementPairTopology::Coincident + 1] = {};
+  for (typename ElementIndexPairSet::const_iterator it =
+           elementIndexPairs.begin();
+       it != elementIndexPairs.end(); ++it) {
+    const DoubleQuadratureDescriptor desc =
+        m_quadDescSelector->quadratureDescriptor(it->first, it->second, -1.);
+    // Add the members one by one, the structures contain padding
+    const ElementPairTopology &topology = desc.topology;
+    key.add(static_cast<int>(topology.type));
+    key.add(topology.testVertexCount);
+    key.add(topology.trialVertexCount);
+    key.add(topology.testSharedVertex0);
+    key.add(topology.testSharedVertex1);
+    key.add(topology.trialSharedVertex0);
+    key.add(topology.trialSharedVertex1);
+    key.add(desc.testOrder);
+    key.add(desc.trialOrder);
+    key.add(static_cast<int>(desc.semiAnalytic));
+
+    if (!topologySampled[topology.type]) {
+      topologySampled[topology.type] = true;
+      std::vector<ElementIndexPair> samplePairs(1, *it);
+      arma::Mat<ResultType> sample;
+      std::vector<arma::Mat<ResultType> *> sampleResults(1, &sample);
+      getIntegrator(desc).integrate(samplePairs,
+                                    *(*m_testShapesets)[it->first],
+                                    *(*m_trialShapesets)[it->second],
+                                    sampleResults);
+      key.add(sample);
+    }
+  }
+  return key.value();
+}
+
+/** \brief Replace the singular integral cache with the one stored under
+    \p key, if it exists and matches the current element pairs. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+bool DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::loadLocalWeakForms(uint64_t key) {
+  std::vector<size_t> columnStarts;
+  std::vector<int> testElementIndices;
+  std::vector<arma::Mat<ResultType>> localWeakForms;
+  shared_ptr<const SingularIntegralFile> file = m_singularIntegralStore->load(
+      key, columnStarts, testElementIndices, localWeakForms);
+  if (!file || columnStarts != m_cacheColumnStarts ||
+      testElementIndices != m_cacheTestElementIndices)
+    return false;
+  m_cachedLocalWeakForms.swap(localWeakForms);
+  m_singularIntegralFile = file;
+  return true;
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::saveLocalWeakForms(uint64_t key) const {
+  // Failing to store the integrals should not abort the assembly
+  try {
+    m_singularIntegralStore->save(key, m_cacheColumnStarts,
+                                  m_cacheTestElementIndices,
+                                  m_cachedLocalWeakForms);
+  } catch (std::exception &e) {
+    if (m_verbosityLevel >= VerbosityLevel::DEFAULT)
+      std::cout << "Warning: singular integrals could not be stored: "
+                << e.what() << std::endl;
+  }
+}
+
+/** \brief Record the size of the singular integral cache in the memory
+    registry. Local weak forms loaded from a SingularIntegralStore are counted
+    as well, although they may be backed by a file mapping. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::recordCacheMemory() {
+  size_t bytes = m_cacheColumnStarts.capacity() * sizeof(size_t) +
+                 m_cacheTestElementIndices.capacity() * sizeof(int) +
+                 m_cachedLocalWeakForms.capacity() *
+                     sizeof(arma::Mat<ResultType>);
+  for (size_t i = 0; i < m_cachedLocalWeakForms.size(); ++i)
+    bytes += m_cachedLocalWeakForms[i].n_elem * sizeof(ResultType);
+  m_cacheMemory.resize(bytes);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::setMemoryOwner(const std::string &owner) {
+  m_cacheMemory.setOwner(owner);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+const arma::Mat<ResultType> *
+DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::cachedLocalWeakForm(int testElementIndex,
+                                          int trialElementIndex) const {
+  if (m_cacheColumnStarts.empty())
+    return 0;
+  const size_t start = m_cacheColumnStarts[trialElementIndex];
+  const size_t end = m_cacheColumnStarts[trialElementIndex + 1];
+  if (start == end || testElementIndex < m_cacheTestElementIndices[start] ||
+      testElementIndex > m_cacheTestElementIndices[end - 1])
+    return 0;
+  std::vector<int>::const_iterator it = std::lower_bound(
+      m_cacheTestElementIndices.begin() + start,
+      m_cacheTestElementIndices.begin() + end, testElementIndex);
+  if (*it != testElementIndex)
+    return 0;
+  return &m_cachedLocalWeakForms[it - m_cacheTestElementIndices.begin()];
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -581,15 +960,43 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
   return getIntegrator(desc);
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+const TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType> &
+DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+    selectBlockIntegrator(int testElementIndex, int trialElementIndex,
+                          CoordinateType nominalDistance,
+                          BlockIntegrators &blockIntegrators) {
+  const Shapeset<BasisFunctionType> *testShapeset =
+      (*m_testShapesets)[testElementIndex];
+  const Shapeset<BasisFunctionType> *trialShapeset =
+      (*m_trialShapesets)[trialElementIndex];
+  // A block seldom contains more than a few combinations of shapesets
+  for (size_t i = 0; i < blockIntegrators.size(); ++i)
+    if (blockIntegrators[i].template get<0>() == testShapeset &&
+        blockIntegrators[i].template get<1>() == trialShapeset)
+      return *blockIntegrators[i].template get<2>();
+  DoubleQuadratureDescriptor desc =
+      m_quadDescSelector->blockQuadratureDescriptor(
+          testElementIndex, trialElementIndex, nominalDistance);
+  const Integrator &integrator = getIntegrator(desc);
+  blockIntegrators.push_back(boost::tuples::make_tuple(
+      testShapeset, trialShapeset, &integrator));
+  return integrator;
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 const TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType> &
 DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
     BasisFunctionType, KernelType, ResultType,
     GeometryFactory>::getIntegrator(const DoubleQuadratureDescriptor &desc) {
+  // The read path is lock-free: concurrent_unordered_map supports find()
+  // concurrently with insert(), and insertion invalidates no iterators
+  // (including end()). The mutex is only taken to create a missing
+  // integrator, so that it is created once even if several threads miss it.
   typename IntegratorMap::iterator it = m_testKernelTrialIntegrators.find(desc);
-  // Note: as far as I understand TBB's docs, .end() keeps pointing to the
-  // same element even if another thread inserts a new element into the map
   if (it == m_testKernelTrialIntegrators.end()) {
     tbb::mutex::scoped_lock lock(m_integratorCreationMutex);
     it = m_testKernelTrialIntegrators.find(desc);
@@ -602,6 +1009,9 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
       bool isTensor;
       m_quadRuleFamily->fillQuadraturePointsAndWeights(
           desc, testPoints, trialPoints, testWeights, trialWeights, isTensor);
+      typedef SemiAnalyticLaplace3dSingleLayerIntegrator<
+          BasisFunctionType, KernelType, ResultType>
+      SemiAnalyticIntegrator;
       Integrator *integrator = 0;
       if (isTensor) {
         typedef SeparableNumericalTestKernelTrialIntegrator<
@@ -611,7 +1021,8 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
             testPoints, trialPoints, testWeights, trialWeights,
             *m_testGeometryFactory, *m_trialGeometryFactory, *m_testRawGeometry,
             *m_trialRawGeometry, *m_testTransformations, *m_kernels,
-            *m_trialTransformations, *m_integral, *m_openClHandler);
+            *m_trialTransformations, *m_integral, *m_openClHandler,
+            true /* cacheGeometricalData */, desc.singlePrecisionKernels);
       } else {
         typedef NonseparableNumericalTestKernelTrialIntegrator<
             BasisFunctionType, KernelType, ResultType, GeometryFactory>
@@ -622,6 +1033,18 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<
             *m_testTransformations, *m_kernels, *m_trialTransformations,
             *m_integral, *m_openClHandler);
       }
+      if (desc.semiAnalytic &&
+          SemiAnalyticIntegrator::isApplicable(
+              *m_testTransformations, *m_kernels, *m_trialTransformations,
+              *m_integral)) {
+        // The numerical integrator handles the element pairs the
+        // semi-analytic one cannot, e.g. those with quadratic elements
+        const int pointCountIn1d =
+            std::max(desc.testOrder, desc.trialOrder) + 2;
+        integrator = new SemiAnalyticIntegrator(
+            *m_testRawGeometry, *m_trialRawGeometry, pointCountIn1d,
+            std::unique_ptr<const Integrator>(integrator));
+      }
 
       // Attempt to insert the newly created integrator into the map
       std::pair<typename IntegratorMap::iterator, bool> result =
@@ -30,12 +30,13 @@
 #include "shared_ptr.hpp"
 
 #include "../common/armadillo_fwd.hpp"
-#include "../common/boost_ptr_map_fwd.hpp"
 #include <cstring>
 #include <iostream>
 #include <map>
 #include <set>
 #include <utility>
+#include <tbb/concurrent_unordered_map.h>
+#include <tbb/mutex.h>
 #include <vector>
 
 namespace Fiber {
@@ -73,7 +74,11 @@ public:
           CoordinateType>> &quadDescSelector,
       const shared_ptr<const SingleQuadratureRuleFamily<CoordinateType>> &
           quadRuleFamily);
+  virtual ~DefaultLocalAssemblerForLocalOperatorsOnSurfaces();
 
+  /** \brief Assemble local weak forms.
+   *
+   *  This function may be called concurrently from several threads. */
   virtual void
   evaluateLocalWeakForms(const std::vector<int> &elementIndices,
                          std::vector<arma::Mat<ResultType>> &result);
@@ -87,9 +92,9 @@ private:
   getIntegrator(const SingleQuadratureDescriptor &desc);
 
 private:
-  typedef boost::ptr_map<SingleQuadratureDescriptor,
-                         TestTrialIntegrator<BasisFunctionType, ResultType>>
-  IntegratorMap;
+  typedef tbb::concurrent_unordered_map<
+      SingleQuadratureDescriptor,
+      TestTrialIntegrator<BasisFunctionType, ResultType> *> IntegratorMap;
   typedef DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
       BasisFunctionType> Utilities;
 
@@ -111,6 +116,7 @@ private:
   shared_ptr<const SingleQuadratureRuleFamily<CoordinateType>> m_quadRuleFamily;
 
   IntegratorMap m_testTrialIntegrators;
+  mutable tbb::mutex m_integratorCreationMutex;
   /** \endcond */
 };
 
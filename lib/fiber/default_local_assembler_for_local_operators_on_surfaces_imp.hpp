@@ -60,6 +60,21 @@ DefaultLocalAssemblerForLocalOperatorsOnSurfaces<BasisFunctionType, ResultType,
       m_openClHandler(openClHandler), m_quadDescSelector(quadDescSelector),
       m_quadRuleFamily(quadRuleFamily) {}
 
+template <typename BasisFunctionType, typename ResultType,
+          typename GeometryFactory>
+DefaultLocalAssemblerForLocalOperatorsOnSurfaces<
+    BasisFunctionType, ResultType,
+    GeometryFactory>::~DefaultLocalAssemblerForLocalOperatorsOnSurfaces() {
+  // Note: obviously the destructor is assumed to be called only after
+  // all threads have ceased using the assembler!
+
+  for (typename IntegratorMap::const_iterator it =
+           m_testTrialIntegrators.begin();
+       it != m_testTrialIntegrators.end(); ++it)
+    delete it->second;
+  m_testTrialIntegrators.clear();
+}
+
 template <typename BasisFunctionType, typename ResultType,
           typename GeometryFactory>
 void DefaultLocalAssemblerForLocalOperatorsOnSurfaces<
@@ -140,14 +155,16 @@ const TestTrialIntegrator<BasisFunctionType, ResultType> &
 DefaultLocalAssemblerForLocalOperatorsOnSurfaces<
     BasisFunctionType, ResultType,
     GeometryFactory>::getIntegrator(const SingleQuadratureDescriptor &desc) {
+  // Lock-free on the read path; see
+  // DefaultLocalAssemblerForIntegralOperatorsOnSurfaces::getIntegrator()
   typename IntegratorMap::iterator it = m_testTrialIntegrators.find(desc);
-  if (it != m_testTrialIntegrators.end()) {
-    //            std::cout << "getIntegrator(: " << index << "): integrator
-    // found" << std::endl;
+  if (it != m_testTrialIntegrators.end())
     return *it->second;
-  }
-  //        std::cout << "getIntegrator(: " << index << "): integrator not
-  // found" << std::endl;
+
+  tbb::mutex::scoped_lock lock(m_integratorCreationMutex);
+  it = m_testTrialIntegrators.find(desc);
+  if (it != m_testTrialIntegrators.end())
+    return *it->second; // created by another thread in the meantime
 
   // Integrator doesn't exist yet and must be created.
   arma::Mat<CoordinateType> points;
@@ -156,13 +173,13 @@ DefaultLocalAssemblerForLocalOperatorsOnSurfaces<
 
   typedef NumericalTestTrialIntegrator<BasisFunctionType, ResultType,
                                        GeometryFactory> Integrator;
-  std::unique_ptr<TestTrialIntegrator<BasisFunctionType, ResultType>>
-  integrator(new Integrator(points, weights, *m_geometryFactory, *m_rawGeometry,
-                            *m_testTransformations, *m_trialTransformations,
-                            *m_integral, *m_openClHandler));
+  TestTrialIntegrator<BasisFunctionType, ResultType> *integrator(
+      new Integrator(points, weights, *m_geometryFactory, *m_rawGeometry,
+                     *m_testTransformations, *m_trialTransformations,
+                     *m_integral, *m_openClHandler));
 
-  SingleQuadratureDescriptor key(desc);
-  return *m_testTrialIntegrators.insert(key, integrator.release())
+  // The newly created integrator will be deleted in our own destructor
+  return *m_testTrialIntegrators.insert(std::make_pair(desc, integrator))
               .first->second;
 }
 
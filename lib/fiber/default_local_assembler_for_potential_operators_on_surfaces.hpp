@@ -38,6 +38,7 @@
 #include <boost/static_assert.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/mutex.h>
 #include <cstring>
 #include <climits>
 #include <set>
@@ -107,6 +108,10 @@ public:
 
   virtual CoordinateType estimateRelativeScale(CoordinateType minDist) const;
 
+  virtual CoordinateType oscillationWaveNumber() const;
+
+  virtual bool isFarFieldOperator() const;
+
 private:
   /** \cond PRIVATE */
   typedef KernelTrialIntegrator<BasisFunctionType, KernelType, ResultType>
@@ -148,6 +153,7 @@ private:
   typedef tbb::concurrent_unordered_map<SingleQuadratureDescriptor,
                                         Integrator *> IntegratorMap;
   IntegratorMap m_kernelTrialIntegrators;
+  mutable tbb::mutex m_integratorCreationMutex;
 
   enum {
     INVALID_INDEX = INT_MAX
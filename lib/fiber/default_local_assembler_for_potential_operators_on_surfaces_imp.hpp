@@ -31,7 +31,6 @@
 
 #include <cassert>
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
 
 #include "../common/auto_timer.hpp"
 
@@ -301,6 +300,24 @@ DefaultLocalAssemblerForPotentialOperatorsOnSurfaces<
   return m_kernels->estimateRelativeScale(minDist);
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+typename DefaultLocalAssemblerForPotentialOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::CoordinateType
+DefaultLocalAssemblerForPotentialOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::oscillationWaveNumber() const {
+  return m_kernels->oscillationWaveNumber();
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+bool DefaultLocalAssemblerForPotentialOperatorsOnSurfaces<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::isFarFieldOperator() const {
+  return m_kernels->isFarFieldKernel();
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 const KernelTrialIntegrator<BasisFunctionType, KernelType, ResultType> &
@@ -321,20 +338,19 @@ const KernelTrialIntegrator<BasisFunctionType, KernelType, ResultType> &
 DefaultLocalAssemblerForPotentialOperatorsOnSurfaces<
     BasisFunctionType, KernelType, ResultType,
     GeometryFactory>::getIntegrator(const SingleQuadratureDescriptor &desc) {
+  // Lock-free on the read path; see
+  // DefaultLocalAssemblerForIntegralOperatorsOnSurfaces::getIntegrator()
   typename IntegratorMap::const_iterator it =
       m_kernelTrialIntegrators.find(desc);
-  // Note: as far as I understand TBB's docs, .end() keeps pointing to the
-  // same element even if another thread inserts a new element into the map
-  if (it != m_kernelTrialIntegrators.end()) {
-    // std::cout << "getIntegrator(: " << desc << "): integrator found" <<
-    // std::endl;
+  if (it != m_kernelTrialIntegrators.end())
     return *it->second;
-  }
-  // std::cout << "getIntegrator(: " << desc << "): integrator not found" <<
-  // std::endl;
+
+  tbb::mutex::scoped_lock lock(m_integratorCreationMutex);
+  it = m_kernelTrialIntegrators.find(desc);
+  if (it != m_kernelTrialIntegrators.end())
+    return *it->second; // created by another thread in the meantime
 
   // Integrator doesn't exist yet and must be created.
-  Integrator *integrator = 0;
   // Create a quadrature rule
   arma::Mat<CoordinateType> trialPoints;
   std::vector<CoordinateType> trialWeights;
@@ -344,31 +360,13 @@ DefaultLocalAssemblerForPotentialOperatorsOnSurfaces<
   typedef NumericalKernelTrialIntegrator<BasisFunctionType, KernelType,
                                          ResultType,
                                          GeometryFactory> ConcreteIntegrator;
-  integrator = new ConcreteIntegrator(
+  Integrator *integrator = new ConcreteIntegrator(
       trialPoints, trialWeights, m_points, *m_geometryFactory, *m_rawGeometry,
       *m_kernels, *m_trialTransformations, *m_integral);
 
-  // Attempt to insert the newly created integrator into the map
-  std::pair<typename IntegratorMap::iterator, bool> result =
-      m_kernelTrialIntegrators.insert(std::make_pair(desc, integrator));
-  if (result.second)
-    // Insertion succeeded. The newly created integrator will be deleted in
-    // our own destructor
-    ;
-  else
-    // Insertion failed -- another thread was faster. Delete the newly
-    // created integrator.
-    delete integrator;
-
-  //    if (result.second)
-  //        std::cout << "getIntegrator(: " << desc << "): insertion succeeded"
-  // << std::endl;
-  //    else
-  //        std::cout << "getIntegrator(: " << desc << "): insertion failed" <<
-  // std::endl;
-
-  // Return pointer to the integrator that ended up in the map.
-  return *result.first->second;
+  // The newly created integrator will be deleted in our own destructor
+  return *m_kernelTrialIntegrators.insert(std::make_pair(desc, integrator))
+              .first->second;
 }
 
 } // namespace Fiber
@@ -85,38 +85,97 @@ DefaultQuadratureDescriptorSelectorForIntegralOperators<
                                              CoordinateType nominalDistance)
     const {
   DoubleQuadratureDescriptor desc;
+  desc.singlePrecisionKernels = false;
+  desc.semiAnalytic = false;
 
-  // Get corner indices of the specified elements
-  arma::Col<int> testElementCornerIndices =
-      m_testRawGeometry->elementCornerIndices(testElementIndex);
-  arma::Col<int> trialElementCornerIndices =
-      m_trialRawGeometry->elementCornerIndices(trialElementIndex);
+  // Compare the corner indices of the specified elements in place, without
+  // copying them
+  const int testCornerCount =
+      m_testRawGeometry->elementCornerCount(testElementIndex);
+  const int trialCornerCount =
+      m_trialRawGeometry->elementCornerCount(trialElementIndex);
   if (testAndTrialGridsAreIdentical()) {
-    desc.topology = determineElementPairTopologyIn3D(testElementCornerIndices,
-                                                     trialElementCornerIndices);
+    const arma::Mat<int> &cornerIndices =
+        m_testRawGeometry->elementCornerIndices();
+    desc.topology = determineElementPairTopologyIn3D(
+        cornerIndices.colptr(testElementIndex), testCornerCount,
+        cornerIndices.colptr(trialElementIndex), trialCornerCount);
   } else {
-    desc.topology.testVertexCount = testElementCornerIndices.n_rows;
-    desc.topology.trialVertexCount = trialElementCornerIndices.n_rows;
+    desc.topology.testVertexCount = testCornerCount;
+    desc.topology.trialVertexCount = trialCornerCount;
     desc.topology.type = ElementPairTopology::Disjoint;
   }
 
   if (desc.topology.type == ElementPairTopology::Disjoint) {
     getRegularOrders(testElementIndex, trialElementIndex, desc.testOrder,
-                     desc.trialOrder, nominalDistance);
+                     desc.trialOrder, desc.singlePrecisionKernels,
+                     desc.semiAnalytic, nominalDistance);
   } else { // singular integral
     desc.testOrder = singularOrder(testElementIndex, TEST);
     desc.trialOrder = singularOrder(trialElementIndex, TRIAL);
+    desc.semiAnalytic = m_accuracyOptions.doubleIntegralSemiAnalytic(0.);
   }
 
   return desc;
 }
 
+template <typename BasisFunctionType>
+DoubleQuadratureDescriptor
+DefaultQuadratureDescriptorSelectorForIntegralOperators<BasisFunctionType>::
+    blockQuadratureDescriptor(int testElementIndex, int trialElementIndex,
+                              CoordinateType nominalDistance) const {
+  if (nominalDistance < 0.)
+    return quadratureDescriptor(testElementIndex, trialElementIndex,
+                                nominalDistance);
+
+  // With a nominal distance the regular orders only depend on the
+  // shapesets, and the elements are known not to touch
+  DoubleQuadratureDescriptor desc;
+  desc.topology.testVertexCount =
+      m_testRawGeometry->elementCornerCount(testElementIndex);
+  desc.topology.trialVertexCount =
+      m_trialRawGeometry->elementCornerCount(trialElementIndex);
+  desc.topology.type = ElementPairTopology::Disjoint;
+  getRegularOrders(testElementIndex, trialElementIndex, desc.testOrder,
+                   desc.trialOrder, desc.singlePrecisionKernels,
+                   desc.semiAnalytic, nominalDistance);
+  return desc;
+}
+
+template <typename BasisFunctionType>
+bool DefaultQuadratureDescriptorSelectorForIntegralOperators<
+    BasisFunctionType>::splitsSingularKernels() const {
+  return m_accuracyOptions.singularKernelSplitting();
+}
+
+template <typename BasisFunctionType>
+DoubleQuadratureDescriptor
+DefaultQuadratureDescriptorSelectorForIntegralOperators<BasisFunctionType>::
+    smoothPartQuadratureDescriptor(int testElementIndex,
+                                   int trialElementIndex) const {
+  DoubleQuadratureDescriptor desc;
+  desc.topology.testVertexCount =
+      m_testRawGeometry->elementCornerCount(testElementIndex);
+  desc.topology.trialVertexCount =
+      m_trialRawGeometry->elementCornerCount(trialElementIndex);
+  // The bounded remainder is smooth enough for low-order regular rules
+  const int increment = m_accuracyOptions.smoothPartOrderIncrement();
+  desc.testOrder = (*m_testShapesets)[testElementIndex]->order() + increment;
+  desc.trialOrder =
+      (*m_trialShapesets)[trialElementIndex]->order() + increment;
+  desc.singlePrecisionKernels = false;
+  desc.semiAnalytic = false;
+  return desc;
+}
+
 template <typename BasisFunctionType>
 void DefaultQuadratureDescriptorSelectorForIntegralOperators<
     BasisFunctionType>::getRegularOrders(int testElementIndex,
                                          int trialElementIndex,
                                          int &testQuadOrder,
                                          int &trialQuadOrder,
+                                         bool &singlePrecisionKernels,
+                                         bool &semiAnalytic,
                                          CoordinateType nominalDistance) const {
   // TODO:
   // 1. Check the size of elements and the distance between them
@@ -131,6 +190,7 @@ void DefaultQuadratureDescriptorSelectorForIntegralOperators<
   trialQuadOrder = trialBasisOrder;
 
   CoordinateType normalisedDistance;
+  CoordinateType elementSize;
   if (nominalDistance < 0.) {
     CoordinateType testElementSizeSquared =
         m_testElementSizesSquared[testElementIndex];
@@ -138,17 +198,37 @@ void DefaultQuadratureDescriptorSelectorForIntegralOperators<
         m_trialElementSizesSquared[trialElementIndex];
     CoordinateType distanceSquared =
         elementDistanceSquared(testElementIndex, trialElementIndex);
-    CoordinateType normalisedDistanceSquared =
-        distanceSquared /
+    CoordinateType maxElementSizeSquared =
         std::max(testElementSizeSquared, trialElementSizeSquared);
+    CoordinateType normalisedDistanceSquared =
+        distanceSquared / maxElementSizeSquared;
     normalisedDistance = sqrt(normalisedDistanceSquared);
-  } else
+    elementSize = sqrt(maxElementSizeSquared);
+  } else {
     normalisedDistance = nominalDistance / m_averageElementSize;
+    elementSize = m_averageElementSize;
+  }
 
   const QuadratureOptions &options =
       m_accuracyOptions.doubleRegular(normalisedDistance);
   testQuadOrder = options.quadratureOrder(testQuadOrder);
   trialQuadOrder = options.quadratureOrder(trialQuadOrder);
+
+  // Don't integrate more accurately than requested
+  const int adaptiveTestQuadOrder =
+      m_accuracyOptions.adaptiveDoubleRegularOrder(
+          testBasisOrder, normalisedDistance, elementSize);
+  if (adaptiveTestQuadOrder >= 0)
+    testQuadOrder = std::min(testQuadOrder, adaptiveTestQuadOrder);
+  const int adaptiveTrialQuadOrder =
+      m_accuracyOptions.adaptiveDoubleRegularOrder(
+          trialBasisOrder, normalisedDistance, elementSize);
+  if (adaptiveTrialQuadOrder >= 0)
+    trialQuadOrder = std::min(trialQuadOrder, adaptiveTrialQuadOrder);
+  singlePrecisionKernels =
+      m_accuracyOptions.doubleRegularInSinglePrecision(normalisedDistance);
+  semiAnalytic =
+      m_accuracyOptions.doubleIntegralSemiAnalytic(normalisedDistance);
 }
 
 template <typename BasisFunctionType>
@@ -59,6 +59,16 @@ public:
   quadratureDescriptor(int testElementIndex, int trialElementIndex,
                        CoordinateType nominalDistance) const;
 
+  virtual DoubleQuadratureDescriptor
+  blockQuadratureDescriptor(int testElementIndex, int trialElementIndex,
+                            CoordinateType nominalDistance) const;
+
+  virtual bool splitsSingularKernels() const;
+
+  virtual DoubleQuadratureDescriptor
+  smoothPartQuadratureDescriptor(int testElementIndex,
+                                 int trialElementIndex) const;
+
 private:
   /** \cond PRIVATE */
   typedef DefaultLocalAssemblerForOperatorsOnSurfacesUtilities<
@@ -73,6 +83,7 @@ private:
   void precalculateElementSizesAndCenters();
   void getRegularOrders(int testElementIndex, int trialElementIndex,
                         int &testQuadOrder, int &trialQuadOrder,
+                        bool &singlePrecisionKernels, bool &semiAnalytic,
                         CoordinateType nominalDistance) const;
   int singularOrder(int elementIndex, ElementType elementType) const;
   CoordinateType elementDistanceSquared(int testElementIndex,
@@ -26,6 +26,8 @@
 #include "raw_grid_geometry.hpp"
 #include "shapeset.hpp"
 
+#include <algorithm>
+
 namespace Fiber {
 
 template <typename BasisFunctionType>
@@ -118,6 +120,23 @@ DefaultQuadratureDescriptorSelectorForPotentialOperators<BasisFunctionType>::
   return desc;
 }
 
+template <typename BasisFunctionType>
+typename DefaultQuadratureDescriptorSelectorForPotentialOperators<
+    BasisFunctionType>::CoordinateType
+DefaultQuadratureDescriptorSelectorForPotentialOperators<
+    BasisFunctionType>::nearFieldDistance() const {
+  // order() compares the distance between the point and the centre of an
+  // element, divided by the size of the element, with the ranges of the
+  // accuracy options
+  const double maxNormalizedDistance =
+      m_accuracyOptions.singleRegularMaxNormalizedDistance();
+  if (maxNormalizedDistance <= 0. || m_elementSizesSquared.empty())
+    return 0.;
+  const CoordinateType maxElementSizeSquared = *std::max_element(
+      m_elementSizesSquared.begin(), m_elementSizesSquared.end());
+  return maxNormalizedDistance * sqrt(maxElementSizeSquared);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(
     DefaultQuadratureDescriptorSelectorForPotentialOperators);
 
@@ -64,6 +64,8 @@ public:
   farFieldQuadratureDescriptor(const Shapeset<BasisFunctionType> &trialShapeset,
                                int trialElementCornerCount) const;
 
+  virtual CoordinateType nearFieldDistance() const;
+
 private:
   /** \cond PRIVATE */
   void precalculateElementSizesAndCenters();
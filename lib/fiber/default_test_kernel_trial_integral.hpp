@@ -63,6 +63,13 @@ testValues,
 trialValues,
             const CollectionOf2dSlicesOfConstNdArrays<KernelType>& kernelValues)
 const;
+
+    // (Optional)
+    // The same integrand for kernels with real values, of type
+    // CoordinateType, and result type BasisFunctionType (see
+    // TestKernelTrialIntegral::realKernelIntegral()).
+    typedef ... RealKernelFunctor;
+    RealKernelFunctor realKernelFunctor() const;
 };
   \endcode
 
@@ -116,6 +123,7 @@ public:
   typedef typename Base::BasisFunctionType BasisFunctionType;
   typedef typename Base::KernelType KernelType;
   typedef typename Base::ResultType ResultType;
+  typedef typename Base::RealKernelIntegral RealKernelIntegral;
 
   explicit DefaultTestKernelTrialIntegral(const IntegrandFunctor &functor)
       : m_functor(functor) {}
@@ -123,6 +131,8 @@ public:
   virtual void addGeometricalDependencies(size_t &testGeomDeps,
                                           size_t &trialGeomDeps) const;
 
+  virtual shared_ptr<const RealKernelIntegral> realKernelIntegral() const;
+
   virtual void evaluateWithTensorQuadratureRule(
       const GeometricalData<CoordinateType> &testGeomData,
       const GeometricalData<CoordinateType> &trialGeomData,
@@ -133,6 +143,19 @@ public:
       const std::vector<CoordinateType> &trialQuadWeights,
       arma::Mat<ResultType> &result) const;
 
+  virtual void evaluateBatchWithTensorQuadratureRule(
+      const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+      const std::vector<const GeometricalData<CoordinateType> *> &
+          trialGeomData,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          testTransformations,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          trialTransformations,
+      const std::vector<const CollectionOf4dArrays<KernelType> *> &kernels,
+      const std::vector<CoordinateType> &testQuadWeights,
+      const std::vector<CoordinateType> &trialQuadWeights,
+      const std::vector<arma::Mat<ResultType> *> &result) const;
+
   virtual void evaluateWithNontensorQuadratureRule(
       const GeometricalData<CoordinateType> &testGeomData,
       const GeometricalData<CoordinateType> &trialGeomData,
@@ -25,10 +25,39 @@
 
 #include "geometrical_data.hpp"
 
+#include <boost/make_shared.hpp>
+#include <boost/mpl/has_xxx.hpp>
+#include <boost/utility/enable_if.hpp>
 #include <cassert>
 
 namespace Fiber {
 
+BOOST_MPL_HAS_XXX_TRAIT_DEF(RealKernelFunctor)
+
+// Wrap the real-kernel counterpart of an integrand in an integral if the
+// functor defines one.
+
+template <typename IntegrandFunctor>
+typename boost::enable_if<
+    has_RealKernelFunctor<IntegrandFunctor>,
+    shared_ptr<const typename DefaultTestKernelTrialIntegral<
+        IntegrandFunctor>::RealKernelIntegral>>::type
+realKernelIntegralInternal(const IntegrandFunctor &functor) {
+  typedef typename IntegrandFunctor::RealKernelFunctor RealFunctor;
+  return boost::make_shared<DefaultTestKernelTrialIntegral<RealFunctor>>(
+      functor.realKernelFunctor());
+}
+
+template <typename IntegrandFunctor>
+typename boost::disable_if<
+    has_RealKernelFunctor<IntegrandFunctor>,
+    shared_ptr<const typename DefaultTestKernelTrialIntegral<
+        IntegrandFunctor>::RealKernelIntegral>>::type
+realKernelIntegralInternal(const IntegrandFunctor &functor) {
+  return shared_ptr<const typename DefaultTestKernelTrialIntegral<
+      IntegrandFunctor>::RealKernelIntegral>();
+}
+
 template <typename IntegrandFunctor>
 void
 DefaultTestKernelTrialIntegral<IntegrandFunctor>::addGeometricalDependencies(
@@ -39,6 +68,13 @@ DefaultTestKernelTrialIntegral<IntegrandFunctor>::addGeometricalDependencies(
   m_functor.addGeometricalDependencies(testGeomDeps, trialGeomDeps);
 }
 
+template <typename IntegrandFunctor>
+shared_ptr<const typename DefaultTestKernelTrialIntegral<
+    IntegrandFunctor>::RealKernelIntegral>
+DefaultTestKernelTrialIntegral<IntegrandFunctor>::realKernelIntegral() const {
+  return realKernelIntegralInternal(m_functor);
+}
+
 template <typename IntegrandFunctor>
 void DefaultTestKernelTrialIntegral<IntegrandFunctor>::
     evaluateWithTensorQuadratureRule(
@@ -100,6 +136,30 @@ void DefaultTestKernelTrialIntegral<IntegrandFunctor>::
     }
 }
 
+template <typename IntegrandFunctor>
+void DefaultTestKernelTrialIntegral<IntegrandFunctor>::
+    evaluateBatchWithTensorQuadratureRule(
+        const std::vector<const GeometricalData<CoordinateType> *> &
+            testGeomData,
+        const std::vector<const GeometricalData<CoordinateType> *> &
+            trialGeomData,
+        const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+            testTransformations,
+        const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+            trialTransformations,
+        const std::vector<const CollectionOf4dArrays<KernelType> *> &kernels,
+        const std::vector<CoordinateType> &testQuadWeights,
+        const std::vector<CoordinateType> &trialQuadWeights,
+        const std::vector<arma::Mat<ResultType> *> &result) const {
+  // The qualified call is bound statically, so the integrand functor is
+  // inlined into the loop over the pairs
+  for (size_t i = 0; i < result.size(); ++i)
+    DefaultTestKernelTrialIntegral::evaluateWithTensorQuadratureRule(
+        *testGeomData[i], *trialGeomData[i], *testTransformations[i],
+        *trialTransformations[i], *kernels[i], testQuadWeights,
+        trialQuadWeights, *result[i]);
+}
+
 template <typename IntegrandFunctor>
 void DefaultTestKernelTrialIntegral<IntegrandFunctor>::
     evaluateWithNontensorQuadratureRule(
@@ -41,16 +41,26 @@ struct DoubleQuadratureDescriptor {
   /** \brief Degree of accuracy of the quadrature rule used on the trial
    *  element. */
   int trialOrder;
+  /** \brief Whether the kernels may be evaluated in single precision
+   *  (see AccuracyOptionsEx::setSinglePrecisionFarField()). */
+  bool singlePrecisionKernels;
+  /** \brief Whether the integral should be evaluated semi-analytically if
+   *  possible (see AccuracyOptionsEx::setSemiAnalyticNearField()). */
+  bool semiAnalytic;
 
   bool operator<(const DoubleQuadratureDescriptor &other) const {
     using boost::tuples::make_tuple;
-    return make_tuple(topology, testOrder, trialOrder) <
-           make_tuple(other.topology, other.testOrder, other.trialOrder);
+    return make_tuple(topology, testOrder, trialOrder,
+                      singlePrecisionKernels, semiAnalytic) <
+           make_tuple(other.topology, other.testOrder, other.trialOrder,
+                      other.singlePrecisionKernels, other.semiAnalytic);
   }
 
   bool operator==(const DoubleQuadratureDescriptor &other) const {
     return topology == other.topology && testOrder == other.testOrder &&
-           trialOrder == other.trialOrder;
+           trialOrder == other.trialOrder &&
+           singlePrecisionKernels == other.singlePrecisionKernels &&
+           semiAnalytic == other.semiAnalytic;
   }
 
   bool operator!=(const DoubleQuadratureDescriptor &other) const {
@@ -60,6 +70,10 @@ struct DoubleQuadratureDescriptor {
   friend std::ostream &operator<<(std::ostream &dest,
                                   const DoubleQuadratureDescriptor &obj) {
     dest << obj.topology << " " << obj.testOrder << " " << obj.trialOrder;
+    if (obj.singlePrecisionKernels)
+      dest << " (single precision)";
+    if (obj.semiAnalytic)
+      dest << " (semi-analytic)";
     return dest;
   }
 };
@@ -72,7 +86,11 @@ inline size_t tbb_hasher(const DoubleQuadratureDescriptor &d) {
                    4 * (t.trialSharedVertex0 +
                         4 * (t.testSharedVertex1 +
                              4 * (t.trialSharedVertex1 +
-                                  4 * (d.testOrder + 256 * d.trialOrder))))));
+                                  4 * (d.testOrder +
+                                       256 * (d.trialOrder +
+                                              256 * (d.singlePrecisionKernels +
+                                                     2 * d.semiAnalytic))
+                                       ))))));
 }
 
 } // namespace Fiber
@@ -0,0 +1,120 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "element_adjacency.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace Fiber {
+
+namespace {
+
+class AdjacentElementsLoopBody {
+public:
+  AdjacentElementsLoopBody(const arma::Mat<int> &elementCornerIndices,
+                           const ElementAdjacency &adjacency,
+                           std::vector<std::vector<int>> &neighbours)
+      : m_elementCornerIndices(elementCornerIndices), m_adjacency(adjacency),
+        m_neighbours(neighbours) {}
+
+  void operator()(const tbb::blocked_range<int> &r) const {
+    const int maxCornerCount = m_elementCornerIndices.n_rows;
+    for (int e = r.begin(); e != r.end(); ++e) {
+      std::vector<int> &neighbours = m_neighbours[e];
+      for (int c = 0; c < maxCornerCount; ++c) {
+        const int v = m_elementCornerIndices(c, e);
+        if (v < 0)
+          break;
+        const int *elements = m_adjacency.adjacentElements(v);
+        neighbours.insert(neighbours.end(), elements,
+                          elements + m_adjacency.adjacentElementCount(v));
+      }
+      std::sort(neighbours.begin(), neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                       neighbours.end());
+    }
+  }
+
+private:
+  const arma::Mat<int> &m_elementCornerIndices;
+  const ElementAdjacency &m_adjacency;
+  std::vector<std::vector<int>> &m_neighbours;
+};
+
+} // namespace
+
+ElementAdjacency::ElementAdjacency(const arma::Mat<int> &elementCornerIndices,
+                                   int vertexCount)
+    : m_elementCornerIndices(elementCornerIndices),
+      m_vertexElementStarts(vertexCount + 1, 0) {
+  const int elementCount = elementCornerIndices.n_cols;
+  const int maxCornerCount = elementCornerIndices.n_rows;
+
+  // Count the elements adjacent to each vertex...
+  for (int e = 0; e < elementCount; ++e)
+    for (int c = 0; c < maxCornerCount; ++c) {
+      const int v = elementCornerIndices(c, e);
+      if (v < 0)
+        break;
+      if (v >= vertexCount)
+        throw std::invalid_argument("ElementAdjacency::ElementAdjacency(): "
+                                    "invalid vertex index");
+      ++m_vertexElementStarts[v + 1];
+    }
+  for (int v = 0; v < vertexCount; ++v)
+    m_vertexElementStarts[v + 1] += m_vertexElementStarts[v];
+
+  // ... and store them. Looping over elements in ascending order keeps the
+  // element list of each vertex sorted.
+  m_vertexElements.resize(m_vertexElementStarts[vertexCount]);
+  std::vector<int> positions(m_vertexElementStarts.begin(),
+                             m_vertexElementStarts.end() - 1);
+  for (int e = 0; e < elementCount; ++e)
+    for (int c = 0; c < maxCornerCount; ++c) {
+      const int v = elementCornerIndices(c, e);
+      if (v < 0)
+        break;
+      m_vertexElements[positions[v]++] = e;
+    }
+}
+
+void ElementAdjacency::findPairsOfAdjacentElements(
+    std::vector<std::pair<int, int>> &pairs) const {
+  const int elementCount = m_elementCornerIndices.n_cols;
+  std::vector<std::vector<int>> neighbours(elementCount);
+  tbb::parallel_for(tbb::blocked_range<int>(0, elementCount),
+                    AdjacentElementsLoopBody(m_elementCornerIndices, *this,
+                                             neighbours));
+
+  size_t pairCount = 0;
+  for (int e = 0; e < elementCount; ++e)
+    pairCount += neighbours[e].size();
+  pairs.clear();
+  pairs.reserve(pairCount);
+  for (int trialElement = 0; trialElement < elementCount; ++trialElement)
+    for (size_t i = 0; i < neighbours[trialElement].size(); ++i)
+      pairs.push_back(
+          std::make_pair(neighbours[trialElement][i], trialElement));
+}
+
+} // namespace Fiber
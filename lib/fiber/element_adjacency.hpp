@@ -0,0 +1,88 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_adjacency_hpp
+#define fiber_element_adjacency_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <utility>
+#include <vector>
+
+namespace Fiber {
+
+/** \brief Vertex-to-element adjacency of a grid.
+ *
+ *  The elements adjacent to each vertex are stored in compressed sparse row
+ *  format, so that the neighbours of an element can be found without
+ *  searching. Pairs of elements sharing an edge are those sharing two
+ *  vertices; their precise configuration is determined by
+ *  determineElementPairTopologyIn3D(). */
+class ElementAdjacency {
+public:
+  /** \brief Constructor.
+   *
+   *  \param[in] elementCornerIndices
+   *    Matrix whose ith column contains the indices of the corners of the
+   *    ith element, padded with negative numbers (see
+   *    RawGridGeometry::elementCornerIndices()).
+   *  \param[in] vertexCount
+   *    Number of vertices of the grid. */
+  ElementAdjacency(const arma::Mat<int> &elementCornerIndices,
+                   int vertexCount);
+
+  /** \brief Number of vertices. */
+  int vertexCount() const { return m_vertexElementStarts.size() - 1; }
+
+  /** \brief Number of elements adjacent to vertex \p vertexIndex. */
+  int adjacentElementCount(int vertexIndex) const {
+    return m_vertexElementStarts[vertexIndex + 1] -
+           m_vertexElementStarts[vertexIndex];
+  }
+
+  /** \brief Indices of the elements adjacent to vertex \p vertexIndex, in
+   *  ascending order. The array has adjacentElementCount(vertexIndex)
+   *  entries. */
+  const int *adjacentElements(int vertexIndex) const {
+    return &m_vertexElements[m_vertexElementStarts[vertexIndex]];
+  }
+
+  /** \brief Fill \p pairs with all pairs (test element, trial element) of
+   *  elements sharing at least one vertex, including the pairs of identical
+   *  elements.
+   *
+   *  The pairs are sorted by the trial element index first and the test
+   *  element index second. The neighbours of different elements are found
+   *  in parallel. */
+  void findPairsOfAdjacentElements(
+      std::vector<std::pair<int, int>> &pairs) const;
+
+private:
+  /** \cond PRIVATE */
+  const arma::Mat<int> &m_elementCornerIndices;
+  std::vector<int> m_vertexElementStarts;
+  std::vector<int> m_vertexElements;
+  /** \endcond */
+};
+
+} // namespace Fiber
+
+#endif
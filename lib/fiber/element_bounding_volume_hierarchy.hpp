@@ -0,0 +1,162 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_bounding_volume_hierarchy_hpp
+#define fiber_element_bounding_volume_hierarchy_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace Fiber {
+
+/** \ingroup fiber
+ *  \brief Bounding volume hierarchy over the elements of a grid.
+ *
+ *  The hierarchy is a binary tree of axis-aligned bounding boxes, built by
+ *  recursive median splits along the longest axis of the element centroids.
+ *  Large subtrees are built in parallel.
+ *
+ *  Elements are treated as flat: triangles are used as they are,
+ *  quadrilaterals are split into two triangles and elements with two corners
+ *  (the elements of 1D grids) are treated as segments. Grids embedded in
+ *  spaces of dimension lower than 3 are padded with zero coordinates.
+ *
+ *  All queries may be called concurrently; the overloads taking matrices of
+ *  points process the points in parallel. Elements are identified by the
+ *  column indices of the \p elementCornerIndices matrix passed to the
+ *  constructor, i.e. by the element indices used by RawGridGeometry and
+ *  Bempp::GridView::getRawElementData(). */
+template <typename CoordinateType> class ElementBoundingVolumeHierarchy {
+public:
+  /** \brief Constructor.
+   *
+   *  \param[in] vertices
+   *    Matrix whose columns are the coordinates of the grid vertices.
+   *  \param[in] elementCornerIndices
+   *    Matrix whose columns are the indices of the corners of the elements;
+   *    unused corners are marked with negative indices. */
+  ElementBoundingVolumeHierarchy(const arma::Mat<CoordinateType> &vertices,
+                                 const arma::Mat<int> &elementCornerIndices);
+
+  /** \brief Number of coordinates of the points passed to the queries. */
+  int worldDimension() const;
+
+  /** \brief Number of elements stored in the hierarchy. */
+  int elementCount() const;
+
+  /** \brief Return the index of the element nearest to \p point.
+   *
+   *  The distance between the point and the element is stored in
+   *  \p distance. If the hierarchy is empty, -1 is returned. */
+  int nearestElement(const CoordinateType *point,
+                     CoordinateType &distance) const;
+
+  /** \brief Find the elements lying at most \p radius from \p point.
+   *
+   *  The indices of these elements are stored, in ascending order, in
+   *  \p elements. */
+  void elementsWithinDistance(const CoordinateType *point,
+                              CoordinateType radius,
+                              std::vector<int> &elements) const;
+
+  /** \brief Find the first element hit by a ray.
+   *
+   *  The ray starts at \p origin and goes in the direction \p direction.
+   *  Returns the index of the first element hit by the ray, or -1 if there
+   *  is none, and stores in \p t the ray parameter of the intersection, i.e.
+   *  the intersection lies at <tt>origin + t * direction</tt>. */
+  int firstRayIntersection(const CoordinateType *origin,
+                           const CoordinateType *direction,
+                           CoordinateType &t) const;
+
+  /** \brief Batched version of nearestElement().
+   *
+   *  \p points is a matrix whose columns are the query points. */
+  void nearestElements(const arma::Mat<CoordinateType> &points,
+                       std::vector<int> &elements,
+                       std::vector<CoordinateType> &distances) const;
+
+  /** \brief Batched version of elementsWithinDistance().
+   *
+   *  \p points is a matrix whose columns are the query points. */
+  void elementsWithinDistance(const arma::Mat<CoordinateType> &points,
+                              CoordinateType radius,
+                              std::vector<std::vector<int>> &elements) const;
+
+  /** \brief Batched version of firstRayIntersection().
+   *
+   *  The columns of \p origins and \p directions define the rays. */
+  void firstRayIntersections(const arma::Mat<CoordinateType> &origins,
+                             const arma::Mat<CoordinateType> &directions,
+                             std::vector<int> &elements,
+                             std::vector<CoordinateType> &t) const;
+
+private:
+  /** \cond PRIVATE */
+  // Triangle or segment (if cornerCount == 2) belonging to an element
+  struct Primitive {
+    CoordinateType corners[3][3];
+    int cornerCount;
+    int element;
+    CoordinateType centroid(int dim) const;
+  };
+
+  // Leaves have rightChild == 0; the left child of an inner node is always
+  // the node following it
+  struct Node {
+    CoordinateType lower[3];
+    CoordinateType upper[3];
+    size_t begin, end; // range of primitives
+    size_t rightChild;
+  };
+
+  enum { LEAF_SIZE = 4, PARALLEL_BUILD_THRESHOLD = 4096 };
+
+  static size_t subtreeNodeCount(size_t primitiveCount);
+  void build(size_t node, size_t begin, size_t end);
+
+  void toPoint(const CoordinateType *in, CoordinateType *out) const;
+  static CoordinateType boxDistanceSquared(const Node &node,
+                                           const CoordinateType *point);
+  static CoordinateType primitiveDistanceSquared(const Primitive &primitive,
+                                                 const CoordinateType *point);
+  static bool rayIntersectsBox(const Node &node, const CoordinateType *origin,
+                               const CoordinateType *direction,
+                               CoordinateType tMax);
+  static bool rayIntersectsPrimitive(const Primitive &primitive,
+                                     const CoordinateType *origin,
+                                     const CoordinateType *direction,
+                                     CoordinateType &t);
+
+  int m_worldDim;
+  int m_elementCount;
+  std::vector<Primitive> m_primitives;
+  std::vector<Node> m_nodes;
+  /** \endcond */
+};
+
+} // namespace Fiber
+
+#include "element_bounding_volume_hierarchy_imp.hpp"
+
+#endif
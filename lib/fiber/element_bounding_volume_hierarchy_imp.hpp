@@ -0,0 +1,518 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_bounding_volume_hierarchy_imp_hpp
+#define fiber_element_bounding_volume_hierarchy_imp_hpp
+
+#include "element_bounding_volume_hierarchy.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+namespace Fiber {
+
+namespace {
+
+template <typename CoordinateType>
+inline CoordinateType dot3(const CoordinateType *a, const CoordinateType *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+template <typename CoordinateType>
+inline void subtract3(const CoordinateType *a, const CoordinateType *b,
+                      CoordinateType *result) {
+  for (int dim = 0; dim < 3; ++dim)
+    result[dim] = a[dim] - b[dim];
+}
+
+template <typename CoordinateType>
+inline void cross3(const CoordinateType *a, const CoordinateType *b,
+                   CoordinateType *result) {
+  result[0] = a[1] * b[2] - a[2] * b[1];
+  result[1] = a[2] * b[0] - a[0] * b[2];
+  result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Squared distance between point p and segment ab
+template <typename CoordinateType>
+CoordinateType pointSegmentDistanceSquared(const CoordinateType *p,
+                                           const CoordinateType *a,
+                                           const CoordinateType *b) {
+  CoordinateType ab[3], ap[3];
+  subtract3(b, a, ab);
+  subtract3(p, a, ap);
+  const CoordinateType abab = dot3(ab, ab);
+  CoordinateType s = abab > 0 ? dot3(ap, ab) / abab : 0;
+  s = std::min<CoordinateType>(std::max<CoordinateType>(s, 0), 1);
+  CoordinateType diff[3];
+  for (int dim = 0; dim < 3; ++dim)
+    diff[dim] = ap[dim] - s * ab[dim];
+  return dot3(diff, diff);
+}
+
+// Squared distance between point p and triangle abc, computed by locating the
+// Voronoi region of the triangle containing p (see C. Ericson, "Real-Time
+// Collision Detection", section 5.1.5)
+template <typename CoordinateType>
+CoordinateType pointTriangleDistanceSquared(const CoordinateType *p,
+                                            const CoordinateType *a,
+                                            const CoordinateType *b,
+                                            const CoordinateType *c) {
+  CoordinateType ab[3], ac[3], ap[3], bp[3], cp[3];
+  subtract3(b, a, ab);
+  subtract3(c, a, ac);
+  subtract3(p, a, ap);
+  const CoordinateType d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+  if (d1 <= 0 && d2 <= 0)
+    return dot3(ap, ap);
+  subtract3(p, b, bp);
+  const CoordinateType d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+  if (d3 >= 0 && d4 <= d3)
+    return dot3(bp, bp);
+  const CoordinateType vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    return pointSegmentDistanceSquared(p, a, b);
+  subtract3(p, c, cp);
+  const CoordinateType d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+  if (d6 >= 0 && d5 <= d6)
+    return dot3(cp, cp);
+  const CoordinateType vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    return pointSegmentDistanceSquared(p, a, c);
+  const CoordinateType va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    return pointSegmentDistanceSquared(p, b, c);
+  const CoordinateType denom = va + vb + vc;
+  if (!(denom > 0)) // degenerate triangle
+    return std::min(pointSegmentDistanceSquared(p, a, b),
+                    std::min(pointSegmentDistanceSquared(p, a, c),
+                             pointSegmentDistanceSquared(p, b, c)));
+  const CoordinateType v = vb / denom, w = vc / denom;
+  CoordinateType diff[3];
+  for (int dim = 0; dim < 3; ++dim)
+    diff[dim] = ap[dim] - v * ab[dim] - w * ac[dim];
+  return dot3(diff, diff);
+}
+
+} // namespace
+
+template <typename CoordinateType>
+CoordinateType
+ElementBoundingVolumeHierarchy<CoordinateType>::Primitive::centroid(
+    int dim) const {
+  CoordinateType sum = 0;
+  for (int corner = 0; corner < cornerCount; ++corner)
+    sum += corners[corner][dim];
+  return sum / cornerCount;
+}
+
+template <typename CoordinateType>
+ElementBoundingVolumeHierarchy<CoordinateType>::ElementBoundingVolumeHierarchy(
+    const arma::Mat<CoordinateType> &vertices,
+    const arma::Mat<int> &elementCornerIndices)
+    : m_worldDim(vertices.n_rows), m_elementCount(elementCornerIndices.n_cols) {
+  if (m_worldDim < 1 || m_worldDim > 3)
+    throw std::invalid_argument(
+        "ElementBoundingVolumeHierarchy::ElementBoundingVolumeHierarchy(): "
+        "vertices must have between 1 and 3 coordinates");
+
+  m_primitives.reserve(m_elementCount);
+  for (int e = 0; e < m_elementCount; ++e) {
+    int cornerCount = 0;
+    while (cornerCount < int(elementCornerIndices.n_rows) &&
+           elementCornerIndices(cornerCount, e) >= 0)
+      ++cornerCount;
+    if (cornerCount < 2 || cornerCount > 4)
+      throw std::invalid_argument(
+          "ElementBoundingVolumeHierarchy::ElementBoundingVolumeHierarchy(): "
+          "elements must have between 2 and 4 corners");
+    // Quadrilaterals are split into the triangles (0, 1, 2) and (2, 3, 0)
+    const int triangleCorners[2][3] = {{0, 1, 2}, {2, 3, 0}};
+    for (int part = 0; part < (cornerCount == 4 ? 2 : 1); ++part) {
+      Primitive primitive;
+      primitive.cornerCount = std::min(cornerCount, 3);
+      primitive.element = e;
+      for (int corner = 0; corner < 3; ++corner)
+        for (int dim = 0; dim < 3; ++dim)
+          primitive.corners[corner][dim] = 0;
+      for (int corner = 0; corner < primitive.cornerCount; ++corner) {
+        const int vertex =
+            elementCornerIndices(triangleCorners[part][corner], e);
+        for (int dim = 0; dim < m_worldDim; ++dim)
+          primitive.corners[corner][dim] = vertices(dim, vertex);
+      }
+      m_primitives.push_back(primitive);
+    }
+  }
+
+  if (m_primitives.empty())
+    return;
+  m_nodes.resize(subtreeNodeCount(m_primitives.size()));
+  build(0, 0, m_primitives.size());
+}
+
+template <typename CoordinateType>
+size_t ElementBoundingVolumeHierarchy<CoordinateType>::subtreeNodeCount(
+    size_t primitiveCount) {
+  if (primitiveCount <= LEAF_SIZE)
+    return 1;
+  const size_t leftCount = primitiveCount / 2;
+  return 1 + subtreeNodeCount(leftCount) +
+         subtreeNodeCount(primitiveCount - leftCount);
+}
+
+template <typename CoordinateType>
+void ElementBoundingVolumeHierarchy<CoordinateType>::build(size_t node,
+                                                           size_t begin,
+                                                           size_t end) {
+  Node &n = m_nodes[node];
+  n.begin = begin;
+  n.end = end;
+  n.rightChild = 0;
+  CoordinateType centroidLower[3], centroidUpper[3];
+  for (int dim = 0; dim < 3; ++dim) {
+    n.lower[dim] = centroidLower[dim] =
+        std::numeric_limits<CoordinateType>::max();
+    n.upper[dim] = centroidUpper[dim] =
+        -std::numeric_limits<CoordinateType>::max();
+  }
+  for (size_t i = begin; i < end; ++i) {
+    const Primitive &primitive = m_primitives[i];
+    for (int dim = 0; dim < 3; ++dim) {
+      for (int corner = 0; corner < primitive.cornerCount; ++corner) {
+        n.lower[dim] = std::min(n.lower[dim], primitive.corners[corner][dim]);
+        n.upper[dim] = std::max(n.upper[dim], primitive.corners[corner][dim]);
+      }
+      const CoordinateType centroid = primitive.centroid(dim);
+      centroidLower[dim] = std::min(centroidLower[dim], centroid);
+      centroidUpper[dim] = std::max(centroidUpper[dim], centroid);
+    }
+  }
+  if (end - begin <= LEAF_SIZE)
+    return;
+
+  int axis = 0;
+  for (int dim = 1; dim < 3; ++dim)
+    if (centroidUpper[dim] - centroidLower[dim] >
+        centroidUpper[axis] - centroidLower[axis])
+      axis = dim;
+  const size_t middle = begin + (end - begin) / 2;
+  std::nth_element(m_primitives.begin() + begin, m_primitives.begin() + middle,
+                   m_primitives.begin() + end,
+                   [axis](const Primitive &a, const Primitive &b) {
+                     return a.centroid(axis) < b.centroid(axis);
+                   });
+
+  const size_t leftChild = node + 1;
+  n.rightChild = leftChild + subtreeNodeCount(middle - begin);
+  const size_t rightChild = n.rightChild;
+  if (end - begin > PARALLEL_BUILD_THRESHOLD)
+    tbb::parallel_invoke([&] { build(leftChild, begin, middle); },
+                         [&] { build(rightChild, middle, end); });
+  else {
+    build(leftChild, begin, middle);
+    build(rightChild, middle, end);
+  }
+}
+
+template <typename CoordinateType>
+int ElementBoundingVolumeHierarchy<CoordinateType>::worldDimension() const {
+  return m_worldDim;
+}
+
+template <typename CoordinateType>
+int ElementBoundingVolumeHierarchy<CoordinateType>::elementCount() const {
+  return m_elementCount;
+}
+
+template <typename CoordinateType>
+void ElementBoundingVolumeHierarchy<CoordinateType>::toPoint(
+    const CoordinateType *in, CoordinateType *out) const {
+  for (int dim = 0; dim < 3; ++dim)
+    out[dim] = dim < m_worldDim ? in[dim] : 0;
+}
+
+template <typename CoordinateType>
+CoordinateType ElementBoundingVolumeHierarchy<CoordinateType>::
+    boxDistanceSquared(const Node &node, const CoordinateType *point) {
+  CoordinateType result = 0;
+  for (int dim = 0; dim < 3; ++dim) {
+    const CoordinateType d =
+        std::max<CoordinateType>(std::max(node.lower[dim] - point[dim],
+                                          point[dim] - node.upper[dim]),
+                                 0);
+    result += d * d;
+  }
+  return result;
+}
+
+template <typename CoordinateType>
+CoordinateType ElementBoundingVolumeHierarchy<CoordinateType>::
+    primitiveDistanceSquared(const Primitive &primitive,
+                             const CoordinateType *point) {
+  if (primitive.cornerCount == 2)
+    return pointSegmentDistanceSquared(point, primitive.corners[0],
+                                       primitive.corners[1]);
+  return pointTriangleDistanceSquared(point, primitive.corners[0],
+                                      primitive.corners[1],
+                                      primitive.corners[2]);
+}
+
+template <typename CoordinateType>
+bool ElementBoundingVolumeHierarchy<CoordinateType>::rayIntersectsBox(
+    const Node &node, const CoordinateType *origin,
+    const CoordinateType *direction, CoordinateType tMax) {
+  // Slab test
+  CoordinateType tMin = 0;
+  for (int dim = 0; dim < 3; ++dim) {
+    if (direction[dim] == 0) {
+      if (origin[dim] < node.lower[dim] || origin[dim] > node.upper[dim])
+        return false;
+      continue;
+    }
+    CoordinateType t0 = (node.lower[dim] - origin[dim]) / direction[dim];
+    CoordinateType t1 = (node.upper[dim] - origin[dim]) / direction[dim];
+    if (t0 > t1)
+      std::swap(t0, t1);
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+    if (tMin > tMax)
+      return false;
+  }
+  return true;
+}
+
+template <typename CoordinateType>
+bool ElementBoundingVolumeHierarchy<CoordinateType>::rayIntersectsPrimitive(
+    const Primitive &primitive, const CoordinateType *origin,
+    const CoordinateType *direction, CoordinateType &t) {
+  const CoordinateType eps =
+      10 * std::numeric_limits<CoordinateType>::epsilon();
+  CoordinateType e1[3], s[3];
+  subtract3(primitive.corners[1], primitive.corners[0], e1);
+  subtract3(origin, primitive.corners[0], s);
+  if (primitive.cornerCount == 2) {
+    // Segment in the xy plane: solve origin + t * direction = v0 + u * e1
+    const CoordinateType det = e1[0] * direction[1] - e1[1] * direction[0];
+    if (std::abs(det) <= eps * (std::abs(e1[0]) + std::abs(e1[1])) *
+                             (std::abs(direction[0]) + std::abs(direction[1])))
+      return false;
+    const CoordinateType u = (s[0] * direction[1] - s[1] * direction[0]) / det;
+    if (u < 0 || u > 1)
+      return false;
+    t = (s[0] * e1[1] - s[1] * e1[0]) / det;
+    return t >= 0;
+  }
+  // Moeller-Trumbore algorithm
+  CoordinateType e2[3], h[3], q[3];
+  subtract3(primitive.corners[2], primitive.corners[0], e2);
+  cross3(direction, e2, h);
+  const CoordinateType a = dot3(e1, h);
+  if (std::abs(a) <= eps * std::sqrt(dot3(e1, e1) * dot3(e2, e2) *
+                                     dot3(direction, direction)))
+    return false; // ray parallel to the triangle
+  const CoordinateType f = 1 / a;
+  const CoordinateType u = f * dot3(s, h);
+  if (u < 0 || u > 1)
+    return false;
+  cross3(s, e1, q);
+  const CoordinateType v = f * dot3(direction, q);
+  if (v < 0 || u + v > 1)
+    return false;
+  t = f * dot3(e2, q);
+  return t >= 0;
+}
+
+template <typename CoordinateType>
+int ElementBoundingVolumeHierarchy<CoordinateType>::nearestElement(
+    const CoordinateType *point, CoordinateType &distance) const {
+  distance = std::numeric_limits<CoordinateType>::infinity();
+  if (m_nodes.empty())
+    return -1;
+  CoordinateType p[3];
+  toPoint(point, p);
+
+  int result = -1;
+  CoordinateType best = std::numeric_limits<CoordinateType>::infinity();
+  std::vector<size_t> stack(1, 0);
+  while (!stack.empty()) {
+    const size_t index = stack.back();
+    const Node &node = m_nodes[index];
+    stack.pop_back();
+    if (boxDistanceSquared(node, p) > best)
+      continue;
+    if (node.rightChild == 0) {
+      for (size_t i = node.begin; i < node.end; ++i) {
+        const CoordinateType d = primitiveDistanceSquared(m_primitives[i], p);
+        if (d < best || (d == best && m_primitives[i].element < result)) {
+          best = d;
+          result = m_primitives[i].element;
+        }
+      }
+      continue;
+    }
+    // Visit the nearer child first
+    const size_t left = index + 1, right = node.rightChild;
+    if (boxDistanceSquared(m_nodes[left], p) <
+        boxDistanceSquared(m_nodes[right], p)) {
+      stack.push_back(right);
+      stack.push_back(left);
+    } else {
+      stack.push_back(left);
+      stack.push_back(right);
+    }
+  }
+  distance = std::sqrt(best);
+  return result;
+}
+
+template <typename CoordinateType>
+void ElementBoundingVolumeHierarchy<CoordinateType>::elementsWithinDistance(
+    const CoordinateType *point, CoordinateType radius,
+    std::vector<int> &elements) const {
+  elements.clear();
+  if (m_nodes.empty() || radius < 0)
+    return;
+  CoordinateType p[3];
+  toPoint(point, p);
+  const CoordinateType radiusSquared = radius * radius;
+
+  std::vector<size_t> stack(1, 0);
+  while (!stack.empty()) {
+    const size_t index = stack.back();
+    const Node &node = m_nodes[index];
+    stack.pop_back();
+    if (boxDistanceSquared(node, p) > radiusSquared)
+      continue;
+    if (node.rightChild == 0) {
+      for (size_t i = node.begin; i < node.end; ++i)
+        if (primitiveDistanceSquared(m_primitives[i], p) <= radiusSquared)
+          elements.push_back(m_primitives[i].element);
+    } else {
+      stack.push_back(node.rightChild);
+      stack.push_back(index + 1);
+    }
+  }
+  // Quadrilaterals may have been found twice
+  std::sort(elements.begin(), elements.end());
+  elements.erase(std::unique(elements.begin(), elements.end()),
+                 elements.end());
+}
+
+template <typename CoordinateType>
+int ElementBoundingVolumeHierarchy<CoordinateType>::firstRayIntersection(
+    const CoordinateType *origin, const CoordinateType *direction,
+    CoordinateType &t) const {
+  t = std::numeric_limits<CoordinateType>::infinity();
+  if (m_nodes.empty())
+    return -1;
+  CoordinateType o[3], d[3];
+  toPoint(origin, o);
+  toPoint(direction, d);
+
+  int result = -1;
+  std::vector<size_t> stack(1, 0);
+  while (!stack.empty()) {
+    const size_t index = stack.back();
+    const Node &node = m_nodes[index];
+    stack.pop_back();
+    if (!rayIntersectsBox(node, o, d, t))
+      continue;
+    if (node.rightChild == 0) {
+      for (size_t i = node.begin; i < node.end; ++i) {
+        CoordinateType tPrimitive;
+        if (rayIntersectsPrimitive(m_primitives[i], o, d, tPrimitive) &&
+            (tPrimitive < t ||
+             (tPrimitive == t && m_primitives[i].element < result))) {
+          t = tPrimitive;
+          result = m_primitives[i].element;
+        }
+      }
+    } else {
+      stack.push_back(node.rightChild);
+      stack.push_back(index + 1);
+    }
+  }
+  return result;
+}
+
+template <typename CoordinateType>
+void ElementBoundingVolumeHierarchy<CoordinateType>::nearestElements(
+    const arma::Mat<CoordinateType> &points, std::vector<int> &elements,
+    std::vector<CoordinateType> &distances) const {
+  if (int(points.n_rows) != m_worldDim)
+    throw std::invalid_argument(
+        "ElementBoundingVolumeHierarchy::nearestElements(): "
+        "points have an incorrect number of coordinates");
+  elements.resize(points.n_cols);
+  distances.resize(points.n_cols);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, points.n_cols),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      elements[i] = nearestElement(points.colptr(i), distances[i]);
+  });
+}
+
+template <typename CoordinateType>
+void ElementBoundingVolumeHierarchy<CoordinateType>::elementsWithinDistance(
+    const arma::Mat<CoordinateType> &points, CoordinateType radius,
+    std::vector<std::vector<int>> &elements) const {
+  if (int(points.n_rows) != m_worldDim)
+    throw std::invalid_argument(
+        "ElementBoundingVolumeHierarchy::elementsWithinDistance(): "
+        "points have an incorrect number of coordinates");
+  elements.resize(points.n_cols);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, points.n_cols),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      elementsWithinDistance(points.colptr(i), radius, elements[i]);
+  });
+}
+
+template <typename CoordinateType>
+void ElementBoundingVolumeHierarchy<CoordinateType>::firstRayIntersections(
+    const arma::Mat<CoordinateType> &origins,
+    const arma::Mat<CoordinateType> &directions, std::vector<int> &elements,
+    std::vector<CoordinateType> &t) const {
+  if (int(origins.n_rows) != m_worldDim ||
+      directions.n_rows != origins.n_rows ||
+      directions.n_cols != origins.n_cols)
+    throw std::invalid_argument(
+        "ElementBoundingVolumeHierarchy::firstRayIntersections(): "
+        "origins and directions must be matrices of identical size with "
+        "one row per coordinate");
+  elements.resize(origins.n_cols);
+  t.resize(origins.n_cols);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, origins.n_cols),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      elements[i] =
+          firstRayIntersection(origins.colptr(i), directions.colptr(i), t[i]);
+  });
+}
+
+} // namespace Fiber
+
+#endif
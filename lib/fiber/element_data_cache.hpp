@@ -0,0 +1,124 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_data_cache_hpp
+#define fiber_element_data_cache_hpp
+
+#include "../common/common.hpp"
+
+#include "collection_of_3d_arrays.hpp"
+#include "geometrical_data.hpp"
+
+#include <algorithm>
+#include <boost/scoped_array.hpp>
+#include <boost/utility.hpp>
+
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class Shapeset;
+/** \endcond */
+
+/** \brief Bounded cache of the geometrical data and transformed shape
+ *  function values of single elements.
+ *
+ *  Integrators keep one cache per thread and side (test or trial), so that
+ *  an element taking part in many element pairs has its data evaluated once
+ *  rather than for every pair. The quadrature points are fixed by the
+ *  integrator, hence entries are identified by the element index and the
+ *  shapeset only.
+ *
+ *  The cache is direct-mapped: element \p e occupies slot <tt>e %
+ *  capacity</tt>. A contiguous range of element indices, as assembled
+ *  together for a block of an H-matrix, therefore never evicts itself.
+ *
+ *  References returned by lookup() stay valid until the slot is given to
+ *  another element. Callers holding several of them at once can check
+ *  conflicts() first, which reports slots looked up since the last call to
+ *  releaseSlots(). */
+template <typename BasisFunctionType, typename CoordinateType>
+class ElementDataCache : boost::noncopyable {
+public:
+  struct Entry {
+    Entry() : elementIndex(-1), shapeset(0), stamp(0) {}
+
+    int elementIndex;
+    const Shapeset<BasisFunctionType> *shapeset;
+    // Left empty if the integrator keeps the geometrical data of all elements
+    GeometricalData<CoordinateType> geomData;
+    CollectionOf3dArrays<BasisFunctionType> values;
+    size_t stamp;
+  };
+
+  enum { DEFAULT_CAPACITY = 256 };
+
+  explicit ElementDataCache(size_t capacity = DEFAULT_CAPACITY)
+      : m_capacity(std::max<size_t>(capacity, 1)),
+        m_entries(new Entry[m_capacity]), m_stamp(1) {}
+
+  size_t capacity() const { return m_capacity; }
+
+  /** \brief Return the slot of the element \p elementIndex.
+   *
+   *  If the slot already holds the data of this element and shapeset, \p hit
+   *  is set to true. Otherwise the slot is assigned to the element and \p hit
+   *  is set to false; the caller must then fill in its data. */
+  Entry &lookup(int elementIndex, const Shapeset<BasisFunctionType> &shapeset,
+                bool &hit) {
+    Entry &entry = m_entries[size_t(elementIndex) % m_capacity];
+    hit = entry.elementIndex == elementIndex && entry.shapeset == &shapeset;
+    if (!hit) {
+      entry.elementIndex = elementIndex;
+      entry.shapeset = &shapeset;
+    }
+    entry.stamp = m_stamp;
+    return entry;
+  }
+
+  /** \brief Return true if a call to lookup() for the element \p elementIndex
+   *  would evict the data of another element looked up since the last call
+   *  to releaseSlots(). */
+  bool conflicts(int elementIndex,
+                 const Shapeset<BasisFunctionType> &shapeset) const {
+    const Entry &entry = m_entries[size_t(elementIndex) % m_capacity];
+    return entry.stamp == m_stamp &&
+           (entry.elementIndex != elementIndex || entry.shapeset != &shapeset);
+  }
+
+  /** \brief Forget which slots have been looked up; see conflicts(). */
+  void releaseSlots() { ++m_stamp; }
+
+  /** \brief Mark the slot of the element \p elementIndex as empty.
+   *
+   *  To be called if filling in the data of a slot returned by lookup()
+   *  failed. */
+  void invalidate(int elementIndex) {
+    m_entries[size_t(elementIndex) % m_capacity].elementIndex = -1;
+  }
+
+private:
+  size_t m_capacity;
+  boost::scoped_array<Entry> m_entries;
+  size_t m_stamp;
+};
+
+} // namespace Fiber
+
+#endif
@@ -32,6 +32,12 @@ template <typename ResultType> class EvaluatorForIntegralOperators {
 public:
   typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
 
+  /** \brief Treatment of the elements lying close to the points.
+   *
+   *  In the FAR_FIELD mode, the contributions of all elements are integrated
+   *  with the far-field quadrature rules. In the NEAR_FIELD mode, those of
+   *  elements close to the evaluation points are integrated with the rules
+   *  selected for the particular point-element pairs. */
   enum Region {
     NEAR_FIELD,
     FAR_FIELD
@@ -41,6 +47,22 @@ public:
 
   virtual void evaluate(Region region, const arma::Mat<CoordinateType> &points,
                         arma::Mat<ResultType> &result) const = 0;
+
+  /** \brief Evaluate the potential at \p pointCount points and write it to a
+   *  caller-provided buffer.
+   *
+   *  \p points stores the coordinates of the points column by column
+   *  (worldDimension() per point); \p result must have room for
+   *  resultDimension() * \p pointCount values, which are stored in the same
+   *  layout. The data cached by the evaluator are reused, so that points can
+   *  be streamed through it in batches of arbitrary size. */
+  virtual void evaluate(Region region, const CoordinateType *points,
+                        size_t pointCount, ResultType *result) const = 0;
+
+  /** \brief Number of coordinates of each evaluation point. */
+  virtual int worldDimension() const = 0;
+  /** \brief Number of components of the potential. */
+  virtual int resultDimension() const = 0;
 };
 
 } // namespace Fiber
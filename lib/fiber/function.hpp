@@ -23,6 +23,7 @@
 
 #include "../common/common.hpp"
 
+#include "has_mem_func.hpp"
 #include "scalar_traits.hpp"
 
 #include "../common/armadillo_fwd.hpp"
@@ -70,8 +71,9 @@ public:
   /** \brief Evaluate the function at a list of points.
    *
    *  \param[in] geomData
-   *    Geometrical data related to \f$n \geq 0\f$ points on an element of a
-   *    grid. The number of points, \f$n\f$, can be obtained by calling
+   *    Geometrical data related to \f$n \geq 0\f$ points on one or more
+   *    elements of a grid, all lying in the same domain. The number of
+   *    points, \f$n\f$, can be obtained by calling
    *    <tt>geomData.pointCount()</tt>.
    *  \param[out] result
    *    A 2-dimensional array intended to store the function
@@ -88,6 +90,12 @@ public:
                         arma::Mat<ValueType> &result) const = 0;
 };
 
+/** \cond PRIVATE */
+// True if a functor used to construct one of the Function subclasses has a
+// batched evaluateAtPoints() member of the given signature
+FIBER_HAS_MEM_FUNC(evaluateAtPoints, hasEvaluateAtPoints);
+/** \endcond */
+
 } // namespace Fiber
 
 #endif
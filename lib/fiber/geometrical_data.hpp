@@ -25,6 +25,7 @@
 
 #include "../common/armadillo_fwd.hpp"
 #include "_3d_array.hpp"
+#include "aligned_soa_array.hpp"
 
 #include <cassert>
 
@@ -37,7 +38,10 @@ enum GeometricalDataType {
   NORMALS = 0x0004,
   JACOBIANS_TRANSPOSED = 0x0008,
   JACOBIAN_INVERSES_TRANSPOSED = 0x0010,
-  DOMAIN_INDEX = 0x0020
+  DOMAIN_INDEX = 0x0020,
+  // Not a quantity: request the structure-of-arrays copies of the
+  // globals, normals and Jacobians in addition to the default layout
+  SOA_LAYOUT = 0x0040
 };
 
 /** \cond FORWARD_DECL */
@@ -48,6 +52,11 @@ template <typename CoordinateType> class ConstGeometricalDataSlice;
  *
  *  \see Bempp::Geometry for a description of the data format (in particular,
  *  array ordering).
+ *
+ *  If SOA_LAYOUT is among the requested data, Bempp::Geometry::getData()
+ *  also fills \p globalsSoa, \p normalsSoa and \p jacobiansTransposedSoa
+ *  (see AlignedSoaArray), which let vectorised kernels stream each
+ *  coordinate contiguously.
  */
 template <typename CoordinateType> class GeometricalData {
 public:
@@ -58,6 +67,27 @@ public:
   arma::Mat<CoordinateType> normals;
   int domainIndex;
 
+  AlignedSoaArray<CoordinateType> globalsSoa;
+  AlignedSoaArray<CoordinateType> normalsSoa;
+  AlignedSoaArray<CoordinateType> jacobiansTransposedSoa;
+
+  /** \brief Copy the globals, normals and Jacobians into the
+   *  structure-of-arrays members. Empty quantities stay empty. */
+  void updateSoaLayout() {
+    if (globals.is_empty())
+      globalsSoa.clear();
+    else
+      globalsSoa.assign(globals);
+    if (normals.is_empty())
+      normalsSoa.clear();
+    else
+      normalsSoa.assign(normals);
+    if (jacobiansTransposed.is_empty())
+      jacobiansTransposedSoa.clear();
+    else
+      jacobiansTransposedSoa.assign(jacobiansTransposed);
+  }
+
   // For the time being, I (somewhat dangerously) assume that
   // integrationElements or globals or normals are always used
   int pointCount() const {
@@ -0,0 +1,160 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hardware_counters.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Fiber {
+
+const char *HardwareCounter::name(int counter) {
+  static const char *names[COUNTER_COUNT] = {
+      "cycles", "instructions", "stalledCycles", "cacheMisses",
+      "floatingPointOperations"};
+  return names[counter];
+}
+
+#ifdef __linux__
+
+namespace {
+
+int openCounter(uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // The calling thread on any CPU
+  return static_cast<int>(
+      syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+
+HardwareCounters::HardwareCounters() {
+  m_fds[HardwareCounter::CYCLES] =
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  m_fds[HardwareCounter::INSTRUCTIONS] =
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  m_fds[HardwareCounter::STALLED_CYCLES] =
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+  m_fds[HardwareCounter::CACHE_MISSES] =
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  m_fds[HardwareCounter::FLOATING_POINT_OPERATIONS] = -1;
+  const char *flopEvent = std::getenv("BEMPP_PERF_FLOP_EVENT");
+  if (flopEvent && *flopEvent) {
+    char *end = 0;
+    const unsigned long long config = std::strtoull(flopEvent, &end, 16);
+    if (*end == '\0')
+      m_fds[HardwareCounter::FLOATING_POINT_OPERATIONS] =
+          openCounter(PERF_TYPE_RAW, config);
+  }
+}
+
+HardwareCounters::~HardwareCounters() {
+  for (int c = 0; c < HardwareCounter::COUNTER_COUNT; ++c)
+    if (m_fds[c] >= 0)
+      close(m_fds[c]);
+}
+
+void HardwareCounters::read(
+    uint64_t values[HardwareCounter::COUNTER_COUNT]) const {
+  for (int c = 0; c < HardwareCounter::COUNTER_COUNT; ++c) {
+    values[c] = 0;
+    // Value, time enabled and time running
+    uint64_t data[3];
+    if (m_fds[c] < 0 ||
+        ::read(m_fds[c], data, sizeof(data)) != sizeof(data))
+      continue;
+    if (data[2] == 0)
+      continue;
+    values[c] = data[2] < data[1]
+                    ? static_cast<uint64_t>(double(data[0]) * data[1] /
+                                            data[2])
+                    : data[0];
+  }
+}
+
+#else // __linux__
+
+HardwareCounters::HardwareCounters() {
+  std::fill(m_fds, m_fds + HardwareCounter::COUNTER_COUNT, -1);
+}
+
+HardwareCounters::~HardwareCounters() {}
+
+void HardwareCounters::read(
+    uint64_t values[HardwareCounter::COUNTER_COUNT]) const {
+  std::fill(values, values + HardwareCounter::COUNTER_COUNT, 0);
+}
+
+#endif // __linux__
+
+unsigned HardwareCounters::availabilityMask() const {
+  unsigned mask = 0;
+  for (int c = 0; c < HardwareCounter::COUNTER_COUNT; ++c)
+    if (m_fds[c] >= 0)
+      mask |= 1u << c;
+  return mask;
+}
+
+HardwareCounterRates::HardwareCounterRates(
+    const uint64_t values[HardwareCounter::COUNTER_COUNT], unsigned mask,
+    double seconds, double flops, int cacheLineSize)
+    : instructionsPerCycle(-1.), stalledCycleFraction(-1.), bandwidth(-1.),
+      flopRate(-1.), arithmeticIntensity(-1.) {
+  const uint64_t cycles = values[HardwareCounter::CYCLES];
+  const bool hasCycles = (mask & (1u << HardwareCounter::CYCLES)) && cycles;
+  if (hasCycles && (mask & (1u << HardwareCounter::INSTRUCTIONS)))
+    instructionsPerCycle =
+        double(values[HardwareCounter::INSTRUCTIONS]) / cycles;
+  if (hasCycles && (mask & (1u << HardwareCounter::STALLED_CYCLES)))
+    stalledCycleFraction =
+        double(values[HardwareCounter::STALLED_CYCLES]) / cycles;
+  if (flops < 0. &&
+      (mask & (1u << HardwareCounter::FLOATING_POINT_OPERATIONS)))
+    flops = double(values[HardwareCounter::FLOATING_POINT_OPERATIONS]);
+  const double bytes =
+      (mask & (1u << HardwareCounter::CACHE_MISSES))
+          ? double(values[HardwareCounter::CACHE_MISSES]) * cacheLineSize
+          : -1.;
+  if (seconds > 0.) {
+    if (bytes >= 0.)
+      bandwidth = bytes / seconds;
+    if (flops >= 0.)
+      flopRate = flops / seconds;
+  }
+  if (flops >= 0. && bytes > 0.)
+    arithmeticIntensity = flops / bytes;
+}
+
+} // namespace Fiber
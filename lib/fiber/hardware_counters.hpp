@@ -0,0 +1,126 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_hardware_counters_hpp
+#define fiber_hardware_counters_hpp
+
+#include "../common/common.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+
+namespace Fiber {
+
+/** \ingroup fiber
+ *  \brief Hardware events counted by HardwareCounters. */
+struct HardwareCounter {
+  enum Type {
+    /** \brief CPU cycles. */
+    CYCLES,
+    /** \brief Retired instructions. */
+    INSTRUCTIONS,
+    /** \brief Cycles in which the back end of the pipeline was stalled,
+     *  e.g. waiting for memory. */
+    STALLED_CYCLES,
+    /** \brief Misses of the last-level cache; each of them transfers one
+     *  cache line from memory. */
+    CACHE_MISSES,
+    /** \brief Floating-point operations. There is no portable event
+     *  counting them; it is only available if the environment variable
+     *  BEMPP_PERF_FLOP_EVENT holds the raw code of such an event of the
+     *  processor (as passed to <tt>perf stat -e rNNNN</tt>). */
+    FLOATING_POINT_OPERATIONS,
+    COUNTER_COUNT
+  };
+
+  /** \brief Return the name of \p counter used in reports, e.g.
+   *  "cacheMisses". */
+  static const char *name(int counter);
+};
+
+/** \ingroup fiber
+ *  \brief Hardware performance counters of the calling thread.
+
+  The counters are opened with the perf_event interface of Linux when the
+  object is constructed and count the events caused by the thread that
+  constructed it, in user space only, until it is destroyed. Counters that
+  the processor, the kernel or its settings (see
+  /proc/sys/kernel/perf_event_paranoid) do not provide are unavailable and
+  read as 0; on other systems all counters are unavailable.
+
+  If the kernel multiplexes more events than the processor can count at
+  once, the values are extrapolated from the time each event was counted. */
+class HardwareCounters : boost::noncopyable {
+public:
+  HardwareCounters();
+  ~HardwareCounters();
+
+  /** \brief Return true if \p counter is counted. */
+  bool isAvailable(HardwareCounter::Type counter) const {
+    return m_fds[counter] >= 0;
+  }
+
+  /** \brief Return the bit mask of the available counters, bit i
+   *  corresponding to HardwareCounter::Type i. */
+  unsigned availabilityMask() const;
+
+  /** \brief Store the current values of the counters in \p values. */
+  void read(uint64_t values[HardwareCounter::COUNTER_COUNT]) const;
+
+private:
+  int m_fds[HardwareCounter::COUNTER_COUNT];
+};
+
+/** \ingroup fiber
+ *  \brief Rates derived from hardware counter values accumulated over a
+ *  period of time, which place the measured code in a roofline model.
+ *
+ *  Rates that cannot be derived because a counter is unavailable are
+ *  negative. */
+struct HardwareCounterRates {
+  /** \brief Constructor.
+   *
+   *  \param[in] values Counter values accumulated over \p seconds.
+   *  \param[in] mask Availability mask of the counters (see
+   *    HardwareCounters::availabilityMask()).
+   *  \param[in] seconds Duration of the measurement.
+   *  \param[in] flops Number of floating-point operations known by other
+   *    means, e.g. counted by hand; if negative, the
+   *    FLOATING_POINT_OPERATIONS counter is used.
+   *  \param[in] cacheLineSize Number of bytes transferred from memory per
+   *    cache miss. */
+  HardwareCounterRates(const uint64_t values[HardwareCounter::COUNTER_COUNT],
+                       unsigned mask, double seconds, double flops = -1.,
+                       int cacheLineSize = 64);
+
+  double instructionsPerCycle;
+  double stalledCycleFraction;
+  /** \brief Bytes per second transferred from memory. */
+  double bandwidth;
+  /** \brief Floating-point operations per second. */
+  double flopRate;
+  /** \brief Floating-point operations per byte transferred from
+   *  memory. */
+  double arithmeticIntensity;
+};
+
+} // namespace Fiber
+
+#endif
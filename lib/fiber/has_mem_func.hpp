@@ -0,0 +1,42 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_has_mem_func_hpp
+#define fiber_has_mem_func_hpp
+
+/** \cond PRIVATE */
+
+// FIBER_HAS_MEM_FUNC(func, name) defines a trait template name<T, Sign>
+// whose member value is true if T has a member function func of type Sign
+// (a pointer to member function). It is used to call optional members of
+// user-supplied functors.
+#define FIBER_HAS_MEM_FUNC(func, name)                                         \
+  template <typename T, typename Sign> struct name {                           \
+    typedef char yes[1];                                                       \
+    typedef char no[2];                                                        \
+    template <typename U, U> struct type_check;                                \
+    template <typename _1> static yes &chk(type_check<Sign, &_1::func> *);     \
+    template <typename> static no &chk(...);                                   \
+    static bool const value = sizeof(chk<T>(0)) == sizeof(yes);                \
+  }
+
+/** \endcond */
+
+#endif
@@ -4,6 +4,7 @@
 #include "../common/common.hpp"
 #include "scalar_traits.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <vector>
@@ -14,10 +15,12 @@ template <typename ValueType> class HermiteInterpolator {
 public:
   typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
 
-  HermiteInterpolator() : m_start(0.), m_end(0.), m_n(0), m_interval(0.) {}
+  HermiteInterpolator()
+      : m_start(0.), m_end(0.), m_n(0), m_interval(0.), m_inverseInterval(0.) {
+  }
 
-  CoordinateType rangeStart() { return m_start; }
-  CoordinateType rangeEnd() { return m_end; }
+  CoordinateType rangeStart() const { return m_start; }
+  CoordinateType rangeEnd() const { return m_end; }
 
   void initialize(CoordinateType start, CoordinateType end,
                   const std::vector<ValueType> &values,
@@ -36,22 +39,29 @@ public:
     m_end = end;
     m_n = values.size();
     m_interval = (end - start) / (m_n - 1);
-    m_values = values;
-    m_derivatives = derivatives;
+    m_inverseInterval = 1. / m_interval;
+    // Store the value and the scaled derivative of each node next to each
+    // other, so that an evaluation reads one contiguous block
+    m_nodes.resize(2 * m_n);
+    for (int i = 0; i < m_n; ++i) {
+      m_nodes[2 * i] = values[i];
+      m_nodes[2 * i + 1] = derivatives[i] * m_interval;
+    }
   }
 
   ValueType evaluate(CoordinateType x) const {
     assert(x >= m_start && x <= m_end);
-    CoordinateType fpn;
-    const CoordinateType t = std::modf((x - m_start) / m_interval, &fpn);
-    const int n = int(fpn);
-    assert(n >= 0 && n < m_n);
-    assert(t >= 0 && t <= 1);
+    const CoordinateType s = (x - m_start) * m_inverseInterval;
+    // x == m_end belongs to the last interval
+    const int n = std::min(int(s), m_n - 2);
+    const CoordinateType t = s - n;
+    assert(n >= 0 && t >= 0 && t <= 1 + 1e-6);
     // Adapted from the chfev routine from SLATEC
-    const ValueType f_1 = m_values[n];
-    const ValueType f_2 = m_values[n + 1];
-    const ValueType d_1 = m_derivatives[n] * m_interval;
-    const ValueType d_2 = m_derivatives[n + 1] * m_interval;
+    const ValueType *node = &m_nodes[2 * n];
+    const ValueType f_1 = node[0];
+    const ValueType d_1 = node[1];
+    const ValueType f_2 = node[2];
+    const ValueType d_2 = node[3];
     const ValueType Delta = f_2 - f_1;
     const ValueType Delta_1 = d_1 - Delta;
     const ValueType Delta_2 = d_2 - Delta;
@@ -60,13 +70,20 @@ public:
     return f_1 + t * (d_1 + t * (c_2 + t * c_3));
   }
 
+  /** \brief Evaluate the interpolant at the \p count points \p x and store
+   *  the results in \p result. */
+  void evaluate(const CoordinateType *x, ValueType *result,
+                size_t count) const {
+    for (size_t i = 0; i < count; ++i)
+      result[i] = evaluate(x[i]);
+  }
+
 private:
   /** \cond PRIVATE */
   CoordinateType m_start, m_end;
   int m_n;
-  CoordinateType m_interval;
-  std::vector<ValueType> m_values;
-  std::vector<ValueType> m_derivatives;
+  CoordinateType m_interval, m_inverseInterval;
+  std::vector<ValueType> m_nodes;
   /** \endcond */
 };
 
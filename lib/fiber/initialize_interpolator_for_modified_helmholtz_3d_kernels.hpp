@@ -3,6 +3,7 @@
 
 #include "../common/common.hpp"
 #include "hermite_interpolator.hpp"
+#include "shared_ptr.hpp"
 
 namespace Fiber {
 
@@ -11,6 +12,20 @@ void initializeInterpolatorForModifiedHelmholtz3dKernels(
     ValueType waveNumber, typename ScalarTraits<ValueType>::RealType maxDist,
     int interpPtsPerWavelength, HermiteInterpolator<ValueType> &interpolator);
 
+/** \brief Return an interpolator of exp(-waveNumber * r) for r in [0,
+ *  maxDist], initialized as by
+ *  initializeInterpolatorForModifiedHelmholtz3dKernels().
+ *
+ *  Interpolators are cached, so that all kernels with the same parameters,
+ *  e.g. the operators of a Calderon projector, share one table. A table is
+ *  freed when the last kernel using it is destroyed. This function is
+ *  thread-safe. */
+template <typename ValueType>
+shared_ptr<const HermiteInterpolator<ValueType>>
+sharedInterpolatorForModifiedHelmholtz3dKernels(
+    ValueType waveNumber, typename ScalarTraits<ValueType>::RealType maxDist,
+    int interpPtsPerWavelength);
+
 } // namespace Fiber
 
 #endif
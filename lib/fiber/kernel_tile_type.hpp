@@ -0,0 +1,40 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_kernel_tile_type_hpp
+#define fiber_kernel_tile_type_hpp
+
+namespace Fiber {
+
+/** \brief Kernels of the Laplace and modified Helmholtz equations in 3D that
+ *  can be evaluated by evaluateModifiedHelmholtz3dTile() and by the OpenCL
+ *  regular-pair integrator.
+ *
+ *  The numeric values are shared with the OpenCL code
+ *  (CL/regular_scalar_double_integrator.cl) and must not be changed. */
+enum KernelTileType {
+  SINGLE_LAYER_TILE = 0,        // exp(-k r) / (4 pi r)
+  DOUBLE_LAYER_TILE = 1,        // its normal derivative at the trial point
+  ADJOINT_DOUBLE_LAYER_TILE = 2 // its normal derivative at the test point
+};
+
+} // namespace Fiber
+
+#endif
@@ -0,0 +1,570 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_kernel_tiles_3d_hpp
+#define fiber_kernel_tiles_3d_hpp
+
+#include "../common/common.hpp"
+
+#include "_4d_array.hpp"
+#include "aligned_soa_array.hpp"
+#include "geometrical_data.hpp"
+#include "hermite_interpolator.hpp"
+#include "kernel_tile_type.hpp"
+#include "scalar_traits.hpp"
+#include "simd_pack.hpp"
+
+#include "../common/complex_aux.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+namespace Fiber {
+
+/** \brief View of the coordinates (and optionally normals) of a set of
+ *  points in 3D, stored as a structure of arrays.
+ *
+ *  Each array can be read at paddedSize() >= size() positions, so that the
+ *  tiles can run over whole SIMD packs. */
+template <typename CoordinateType> class PointBlock3d {
+public:
+  /** \brief Use the structure-of-arrays copies of \p geomData if it has
+   *  them (see SOA_LAYOUT), otherwise make such copies. */
+  void assign(const GeometricalData<CoordinateType> &geomData,
+              bool withNormals) {
+    const AlignedSoaArray<CoordinateType> *globals = &geomData.globalsSoa;
+    if (globals->is_empty()) {
+      m_globals.assign(geomData.globals);
+      globals = &m_globals;
+    }
+    x = globals->component(0);
+    y = globals->component(1);
+    z = globals->component(2);
+    m_size = globals->pointCount();
+    m_paddedSize = globals->paddedPointCount();
+    nx = ny = nz = 0;
+    if (!withNormals)
+      return;
+    const AlignedSoaArray<CoordinateType> *normals = &geomData.normalsSoa;
+    if (normals->is_empty()) {
+      m_normals.assign(geomData.normals);
+      normals = &m_normals;
+    }
+    nx = normals->component(0);
+    ny = normals->component(1);
+    nz = normals->component(2);
+  }
+
+  /** \brief Make copies of the points of \p other, converted to
+   *  CoordinateType and shifted by -\p origin, and of their normals if
+   *  \p other has them.
+   *
+   *  Shifting the points to a local origin before the conversion keeps the
+   *  relative precision of their distances when CoordinateType is
+   *  narrower than OtherCoordinateType. */
+  template <typename OtherCoordinateType>
+  void assignConverted(const PointBlock3d<OtherCoordinateType> &other,
+                       const OtherCoordinateType *origin) {
+    const OtherCoordinateType zero[3] = {0, 0, 0};
+    convert(other.x, other.y, other.z, other.size(), origin, m_globals);
+    x = m_globals.component(0);
+    y = m_globals.component(1);
+    z = m_globals.component(2);
+    m_size = m_globals.pointCount();
+    m_paddedSize = m_globals.paddedPointCount();
+    nx = ny = nz = 0;
+    if (!other.nx)
+      return;
+    convert(other.nx, other.ny, other.nz, other.size(), zero, m_normals);
+    nx = m_normals.component(0);
+    ny = m_normals.component(1);
+    nz = m_normals.component(2);
+  }
+
+  size_t size() const { return m_size; }
+  size_t paddedSize() const { return m_paddedSize; }
+
+  const CoordinateType *x, *y, *z;
+  const CoordinateType *nx, *ny, *nz; // null if normals are not needed
+
+private:
+  template <typename OtherCoordinateType>
+  static void convert(const OtherCoordinateType *x,
+                      const OtherCoordinateType *y,
+                      const OtherCoordinateType *z, size_t size,
+                      const OtherCoordinateType *origin,
+                      AlignedSoaArray<CoordinateType> &dest) {
+    dest.set_size(3, size);
+    const OtherCoordinateType *src[3] = {x, y, z};
+    const size_t paddedSize = dest.paddedPointCount();
+    for (int c = 0; c < 3; ++c) {
+      CoordinateType *values = dest.component(c);
+      for (size_t p = 0; p < paddedSize; ++p)
+        values[p] = static_cast<CoordinateType>(
+            src[c][std::min(p, size - 1)] - origin[c]);
+    }
+  }
+
+private:
+  size_t m_size, m_paddedSize;
+  AlignedSoaArray<CoordinateType> m_globals, m_normals;
+};
+
+/** \brief Geometrical dependencies to add for the tiles: SOA_LAYOUT if the
+ *  library is compiled for a vector instruction set, otherwise nothing
+ *  (the point-pair loop is used in that case). */
+template <typename CoordinateType> inline size_t tileGeometricalDependencies() {
+  return Simd::NativePack<CoordinateType>::type::width > 1 ? SOA_LAYOUT : 0;
+}
+
+namespace Simd {
+
+// Multiply the real prefactor value by exp(-k r) and, if derivative is true,
+// by k + 1/r, and store the result
+template <bool derivative, bool decaying, bool oscillatory, typename Pack>
+inline void storeModifiedHelmholtz3dPack(Pack value, Pack distance,
+                                         Pack inverseDistance,
+                                         typename Pack::Scalar waveRe,
+                                         typename Pack::Scalar waveIm,
+                                         typename Pack::Scalar *resultRe,
+                                         typename Pack::Scalar *resultIm) {
+  typedef typename Pack::Scalar T;
+  if (decaying)
+    value = value * exp(Pack(-waveRe) * distance);
+
+  Pack factorRe = Pack(waveRe) + inverseDistance;
+  if (!oscillatory) {
+    if (derivative)
+      value = value * factorRe;
+    value.store(resultRe);
+    return;
+  }
+
+  // exp(-i Im(k) r) = cos - i sin
+  Pack s, c;
+  sincos(Pack(waveIm) * distance, s, c);
+  if (!derivative) {
+    (value * c).store(resultRe);
+    (Pack(static_cast<T>(0)) - value * s).store(resultIm);
+  } else {
+    // (a + i b) (c - i s) = a c + b s + i (b c - a s)
+    Pack b(waveIm);
+    (value * mulAdd(factorRe, c, b * s)).store(resultRe);
+    (value * (b * c - factorRe * s)).store(resultIm);
+  }
+}
+
+template <KernelTileType type, bool decaying, bool oscillatory, typename Pack>
+inline void evaluateModifiedHelmholtz3dPack(
+    typename Pack::Scalar waveRe, typename Pack::Scalar waveIm,
+    const PointBlock3d<typename Pack::Scalar> &test, size_t testIndex,
+    const PointBlock3d<typename Pack::Scalar> &trial, size_t trialIndex,
+    typename Pack::Scalar *resultRe, typename Pack::Scalar *resultIm) {
+  typedef typename Pack::Scalar T;
+
+  // d = trial - test
+  Pack dx = Pack(trial.x[trialIndex]) - Pack::load(test.x + testIndex);
+  Pack dy = Pack(trial.y[trialIndex]) - Pack::load(test.y + testIndex);
+  Pack dz = Pack(trial.z[trialIndex]) - Pack::load(test.z + testIndex);
+  Pack distanceSq = mulAdd(dx, dx, mulAdd(dy, dy, dz * dz));
+  Pack inverseDistance = rsqrt(distanceSq);
+  Pack distance = distanceSq * inverseDistance;
+
+  const Pack factor(static_cast<T>(1. / (4. * M_PI)));
+  Pack value;
+  if (type == SINGLE_LAYER_TILE)
+    value = factor * inverseDistance;
+  else {
+    Pack numerator;
+    if (type == DOUBLE_LAYER_TILE)
+      numerator = mulAdd(dx, Pack(trial.nx[trialIndex]),
+                         mulAdd(dy, Pack(trial.ny[trialIndex]),
+                                dz * Pack(trial.nz[trialIndex])));
+    else // test - trial = -d
+      numerator = Pack(static_cast<T>(0)) -
+                  mulAdd(dx, Pack::load(test.nx + testIndex),
+                         mulAdd(dy, Pack::load(test.ny + testIndex),
+                                dz * Pack::load(test.nz + testIndex)));
+    value = (Pack(static_cast<T>(0)) - numerator) * factor * inverseDistance *
+            inverseDistance;
+  }
+  storeModifiedHelmholtz3dPack<type != SINGLE_LAYER_TILE, decaying,
+                               oscillatory>(
+      value, distance, inverseDistance, waveRe, waveIm, resultRe + testIndex,
+      oscillatory ? resultIm + testIndex : 0);
+}
+
+// Evaluate F = -(k + 1/r) exp(-k r) / (4 pi r^2), the factor such that the
+// gradient of the kernel with respect to the test point x is F (x - y)
+template <bool decaying, bool oscillatory, typename Pack>
+inline void evaluateModifiedHelmholtz3dGradientFactorPack(
+    typename Pack::Scalar waveRe, typename Pack::Scalar waveIm,
+    const PointBlock3d<typename Pack::Scalar> &test, size_t testIndex,
+    const PointBlock3d<typename Pack::Scalar> &trial, size_t trialIndex,
+    typename Pack::Scalar *resultRe, typename Pack::Scalar *resultIm) {
+  typedef typename Pack::Scalar T;
+
+  Pack dx = Pack(trial.x[trialIndex]) - Pack::load(test.x + testIndex);
+  Pack dy = Pack(trial.y[trialIndex]) - Pack::load(test.y + testIndex);
+  Pack dz = Pack(trial.z[trialIndex]) - Pack::load(test.z + testIndex);
+  Pack distanceSq = mulAdd(dx, dx, mulAdd(dy, dy, dz * dz));
+  Pack inverseDistance = rsqrt(distanceSq);
+  Pack distance = distanceSq * inverseDistance;
+
+  const Pack factor(static_cast<T>(-1. / (4. * M_PI)));
+  Pack value = factor * inverseDistance * inverseDistance;
+  storeModifiedHelmholtz3dPack<true, decaying, oscillatory>(
+      value, distance, inverseDistance, waveRe, waveIm, resultRe + testIndex,
+      oscillatory ? resultIm + testIndex : 0);
+}
+
+template <KernelTileType type, bool decaying, bool oscillatory, typename T>
+void evaluateModifiedHelmholtz3dTile(T waveRe, T waveIm,
+                                     const PointBlock3d<T> &test,
+                                     const PointBlock3d<T> &trial,
+                                     T *resultRe, T *resultIm) {
+  typedef typename NativePack<T>::type Pack;
+  const size_t testCount = test.paddedSize();
+  const size_t packedTestCount = testCount - testCount % Pack::width;
+  for (size_t trialIndex = 0; trialIndex < trial.size(); ++trialIndex) {
+    T *re = resultRe + trialIndex * testCount;
+    T *im = oscillatory ? resultIm + trialIndex * testCount : 0;
+    size_t testIndex = 0;
+    for (; testIndex < packedTestCount; testIndex += Pack::width)
+      evaluateModifiedHelmholtz3dPack<type, decaying, oscillatory, Pack>(
+          waveRe, waveIm, test, testIndex, trial, trialIndex, re, im);
+    for (; testIndex < testCount; ++testIndex)
+      evaluateModifiedHelmholtz3dPack<type, decaying, oscillatory,
+                                      ScalarPack<T>>(
+          waveRe, waveIm, test, testIndex, trial, trialIndex, re, im);
+  }
+}
+
+template <bool decaying, bool oscillatory, typename T>
+void evaluateModifiedHelmholtz3dGradientFactorTile(T waveRe, T waveIm,
+                                                   const PointBlock3d<T> &test,
+                                                   const PointBlock3d<T> &trial,
+                                                   T *resultRe, T *resultIm) {
+  typedef typename NativePack<T>::type Pack;
+  const size_t testCount = test.paddedSize();
+  const size_t packedTestCount = testCount - testCount % Pack::width;
+  for (size_t trialIndex = 0; trialIndex < trial.size(); ++trialIndex) {
+    T *re = resultRe + trialIndex * testCount;
+    T *im = oscillatory ? resultIm + trialIndex * testCount : 0;
+    size_t testIndex = 0;
+    for (; testIndex < packedTestCount; testIndex += Pack::width)
+      evaluateModifiedHelmholtz3dGradientFactorPack<decaying, oscillatory,
+                                                    Pack>(
+          waveRe, waveIm, test, testIndex, trial, trialIndex, re, im);
+    for (; testIndex < testCount; ++testIndex)
+      evaluateModifiedHelmholtz3dGradientFactorPack<decaying, oscillatory,
+                                                    ScalarPack<T>>(
+          waveRe, waveIm, test, testIndex, trial, trialIndex, re, im);
+  }
+}
+
+template <typename ValueType> struct TileValue {
+  static ValueType make(ValueType re, ValueType /* im */) { return re; }
+};
+
+template <typename T> struct TileValue<std::complex<T>> {
+  static std::complex<T> make(T re, T im) { return std::complex<T>(re, im); }
+};
+
+} // namespace Simd
+
+/** \brief Evaluate a Laplace or modified Helmholtz kernel on a tile of test
+ *  points x trial points.
+ *
+ *  The value at (testIndex, trialIndex) is written to
+ *  resultRe[testIndex + trialIndex * test.paddedSize()] and, if the wave
+ *  number \p waveRe + i \p waveIm is not real, its imaginary part to the
+ *  same position of \p resultIm; the values at padding positions are
+ *  meaningless. The inner loop runs over test points in SIMD packs (see
+ *  NativePack). */
+template <typename T>
+void evaluateModifiedHelmholtz3dTile(KernelTileType type, T waveRe, T waveIm,
+                                     const PointBlock3d<T> &test,
+                                     const PointBlock3d<T> &trial,
+                                     T *resultRe, T *resultIm) {
+  using namespace Simd;
+  const bool decaying = waveRe != 0;
+  const bool oscillatory = waveIm != 0;
+
+#define FIBER_EVALUATE_TILE(TYPE)                                              \
+  if (decaying && oscillatory)                                                 \
+    evaluateModifiedHelmholtz3dTile<TYPE, true, true>(                         \
+        waveRe, waveIm, test, trial, resultRe, resultIm);                      \
+  else if (decaying)                                                           \
+    evaluateModifiedHelmholtz3dTile<TYPE, true, false>(                        \
+        waveRe, waveIm, test, trial, resultRe, resultIm);                      \
+  else if (oscillatory)                                                        \
+    evaluateModifiedHelmholtz3dTile<TYPE, false, true>(                        \
+        waveRe, waveIm, test, trial, resultRe, resultIm);                      \
+  else                                                                         \
+    evaluateModifiedHelmholtz3dTile<TYPE, false, false>(                       \
+        waveRe, waveIm, test, trial, resultRe, resultIm);
+
+  switch (type) {
+  case SINGLE_LAYER_TILE:
+    FIBER_EVALUATE_TILE(SINGLE_LAYER_TILE);
+    break;
+  case DOUBLE_LAYER_TILE:
+    FIBER_EVALUATE_TILE(DOUBLE_LAYER_TILE);
+    break;
+  case ADJOINT_DOUBLE_LAYER_TILE:
+    FIBER_EVALUATE_TILE(ADJOINT_DOUBLE_LAYER_TILE);
+    break;
+  }
+#undef FIBER_EVALUATE_TILE
+}
+
+/** \brief Evaluate a tile and store its values at the test x trial points
+ *  contiguously (test index fastest) in \p values, converting them to
+ *  ValueType. */
+template <typename ValueType, typename T>
+void evaluateModifiedHelmholtz3dTileValues(KernelTileType type, T waveRe,
+                                           T waveIm,
+                                           const PointBlock3d<T> &test,
+                                           const PointBlock3d<T> &trial,
+                                           ValueType *values) {
+  const size_t testCount = test.size();
+  const size_t stride = test.paddedSize();
+  const size_t valueCount = stride * trial.size();
+  std::vector<T> re(valueCount);
+  std::vector<T> im(waveIm != 0 ? valueCount : 0);
+  evaluateModifiedHelmholtz3dTile(type, waveRe, waveIm, test, trial, &re[0],
+                                  im.empty() ? 0 : &im[0]);
+
+  typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+  for (size_t j = 0; j < trial.size(); ++j)
+    if (im.empty())
+      for (size_t i = 0; i < testCount; ++i)
+        values[i + j * testCount] =
+            static_cast<ValueType>(static_cast<CoordinateType>(
+                re[i + j * stride]));
+    else
+      for (size_t i = 0; i < testCount; ++i)
+        values[i + j * testCount] = Simd::TileValue<ValueType>::make(
+            static_cast<CoordinateType>(re[i + j * stride]),
+            static_cast<CoordinateType>(im[i + j * stride]));
+}
+
+/** \brief Evaluate a Laplace or modified Helmholtz kernel with the wave
+ *  number \p waveNumber on the grid of test x trial points and store it in
+ *  the 1 x 1 x testPointCount x trialPointCount array \p result.
+ *
+ *  This implements the batched evaluateOnGrid() of the Laplace and modified
+ *  Helmholtz kernel functors. Return false, without doing anything, if the
+ *  library is not compiled for a vector instruction set; the point-pair
+ *  loop is faster then. */
+template <typename ValueType>
+bool evaluateModifiedHelmholtz3dOnGrid(
+    KernelTileType type, ValueType waveNumber,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &testGeomData,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &trialGeomData,
+    _4dArray<ValueType> &result) {
+  typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+  if (Simd::NativePack<CoordinateType>::type::width == 1)
+    return false;
+  assert(testGeomData.dimWorld() == 3);
+  assert(result.extent(0) == 1 && result.extent(1) == 1);
+
+  PointBlock3d<CoordinateType> test, trial;
+  test.assign(testGeomData, type == ADJOINT_DOUBLE_LAYER_TILE);
+  trial.assign(trialGeomData, type == DOUBLE_LAYER_TILE);
+
+  evaluateModifiedHelmholtz3dTileValues(type, realPart(waveNumber),
+                                        imagPart(waveNumber), test, trial,
+                                        result.begin());
+  return true;
+}
+
+/** \brief Evaluate the gradient with respect to the test point of the
+ *  modified Helmholtz kernel with the wave number \p waveNumber on the grid of
+ *  test x trial points and store it in the 3 x 1 x testPointCount x
+ *  trialPointCount array \p result.
+ *
+ *  This implements the batched evaluateOnGrid() of the kernel functors of
+ *  the modified Maxwell double-layer operators. The scalar factor common to
+ *  the three components is evaluated in SIMD packs. Return false, without
+ *  doing anything, if the library is not compiled for a vector instruction
+ *  set. */
+template <typename ValueType>
+bool evaluateModifiedHelmholtz3dGradientOnGrid(
+    ValueType waveNumber,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &testGeomData,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &trialGeomData,
+    _4dArray<ValueType> &result) {
+  typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+  if (Simd::NativePack<CoordinateType>::type::width == 1)
+    return false;
+  assert(testGeomData.dimWorld() == 3);
+  assert(result.extent(0) == 3 && result.extent(1) == 1);
+
+  PointBlock3d<CoordinateType> test, trial;
+  test.assign(testGeomData, false);
+  trial.assign(trialGeomData, false);
+
+  const CoordinateType waveRe = realPart(waveNumber);
+  const CoordinateType waveIm = imagPart(waveNumber);
+  const bool decaying = waveRe != 0;
+  const bool oscillatory = waveIm != 0;
+  const size_t testCount = test.size();
+  const size_t stride = test.paddedSize();
+  const size_t valueCount = stride * trial.size();
+  std::vector<CoordinateType> re(valueCount);
+  std::vector<CoordinateType> im(oscillatory ? valueCount : 0);
+  CoordinateType *resultRe = re.empty() ? 0 : &re[0];
+  CoordinateType *resultIm = im.empty() ? 0 : &im[0];
+  using namespace Simd;
+  if (decaying && oscillatory)
+    evaluateModifiedHelmholtz3dGradientFactorTile<true, true>(
+        waveRe, waveIm, test, trial, resultRe, resultIm);
+  else if (decaying)
+    evaluateModifiedHelmholtz3dGradientFactorTile<true, false>(
+        waveRe, waveIm, test, trial, resultRe, resultIm);
+  else if (oscillatory)
+    evaluateModifiedHelmholtz3dGradientFactorTile<false, true>(
+        waveRe, waveIm, test, trial, resultRe, resultIm);
+  else
+    evaluateModifiedHelmholtz3dGradientFactorTile<false, false>(
+        waveRe, waveIm, test, trial, resultRe, resultIm);
+
+  ValueType *values = result.begin();
+  for (size_t j = 0; j < trial.size(); ++j)
+    for (size_t i = 0; i < testCount; ++i) {
+      const size_t k = i + j * stride;
+      const ValueType factor = TileValue<ValueType>::make(
+          re[k], oscillatory ? im[k] : CoordinateType(0));
+      ValueType *value = values + 3 * (i + j * testCount);
+      value[0] = factor * (test.x[i] - trial.x[j]);
+      value[1] = factor * (test.y[i] - trial.y[j]);
+      value[2] = factor * (test.z[i] - trial.z[j]);
+    }
+  return true;
+}
+
+/** \brief Evaluate a Laplace or modified Helmholtz kernel on the grid of
+ *  test x trial points like evaluateModifiedHelmholtz3dOnGrid(), but in
+ *  single precision.
+ *
+ *  The points are shifted so that the first test point lies at the origin
+ *  and converted to float; the kernel values are converted back to
+ *  ValueType. Return false, without doing anything, if ValueType is
+ *  already a single-precision type or the library is not compiled for a
+ *  vector instruction set. */
+template <typename ValueType>
+bool evaluateModifiedHelmholtz3dOnGridInSinglePrecision(
+    KernelTileType type, std::complex<double> waveNumber,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &testGeomData,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &trialGeomData,
+    _4dArray<ValueType> &result) {
+  typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+  if (sizeof(CoordinateType) <= sizeof(float) ||
+      Simd::NativePack<float>::type::width == 1)
+    return false;
+  assert(testGeomData.dimWorld() == 3);
+  assert(result.extent(0) == 1 && result.extent(1) == 1);
+  if (testGeomData.pointCount() == 0 || trialGeomData.pointCount() == 0)
+    return true;
+
+  PointBlock3d<CoordinateType> test, trial;
+  test.assign(testGeomData, type == ADJOINT_DOUBLE_LAYER_TILE);
+  trial.assign(trialGeomData, type == DOUBLE_LAYER_TILE);
+  const CoordinateType origin[3] = {test.x[0], test.y[0], test.z[0]};
+  PointBlock3d<float> singleTest, singleTrial;
+  singleTest.assignConverted(test, origin);
+  singleTrial.assignConverted(trial, origin);
+
+  evaluateModifiedHelmholtz3dTileValues(
+      type, static_cast<float>(waveNumber.real()),
+      static_cast<float>(waveNumber.imag()), singleTest, singleTrial, result.begin());
+  return true;
+}
+
+/** \brief Evaluate a modified Helmholtz kernel on the grid of test x trial
+ *  points like evaluateModifiedHelmholtz3dOnGrid(), taking exp(-k r) from
+ *  \p interpolator.
+ *
+ *  The distances of one trial point to all test points are calculated
+ *  first and then interpolated together. */
+template <typename ValueType>
+void evaluateInterpolatedModifiedHelmholtz3dOnGrid(
+    KernelTileType type, ValueType waveNumber,
+    const HermiteInterpolator<ValueType> &interpolator,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &testGeomData,
+    const GeometricalData<typename ScalarTraits<ValueType>::RealType>
+        &trialGeomData,
+    _4dArray<ValueType> &result) {
+  typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+  assert(testGeomData.dimWorld() == 3);
+  assert(result.extent(0) == 1 && result.extent(1) == 1);
+
+  PointBlock3d<CoordinateType> test, trial;
+  test.assign(testGeomData, type == ADJOINT_DOUBLE_LAYER_TILE);
+  trial.assign(trialGeomData, type == DOUBLE_LAYER_TILE);
+
+  const size_t testCount = test.size();
+  std::vector<CoordinateType> distances(testCount);
+  std::vector<CoordinateType> numerators(
+      type == SINGLE_LAYER_TILE ? 0 : testCount);
+  std::vector<ValueType> exponentials(testCount);
+  const CoordinateType factor = static_cast<CoordinateType>(1. / (4. * M_PI));
+  ValueType *values = result.begin();
+  for (size_t j = 0; j < trial.size(); ++j) {
+    // d = trial - test
+    for (size_t i = 0; i < testCount; ++i) {
+      const CoordinateType dx = trial.x[j] - test.x[i];
+      const CoordinateType dy = trial.y[j] - test.y[i];
+      const CoordinateType dz = trial.z[j] - test.z[i];
+      distances[i] = sqrt(dx * dx + dy * dy + dz * dz);
+      if (type == DOUBLE_LAYER_TILE)
+        numerators[i] = dx * trial.nx[j] + dy * trial.ny[j] + dz * trial.nz[j];
+      else if (type == ADJOINT_DOUBLE_LAYER_TILE) // test - trial = -d
+        numerators[i] = -(dx * test.nx[i] + dy * test.ny[i] + dz * test.nz[i]);
+    }
+    interpolator.evaluate(&distances[0], &exponentials[0], testCount);
+
+    ValueType *column = values + j * testCount;
+    if (type == SINGLE_LAYER_TILE)
+      for (size_t i = 0; i < testCount; ++i)
+        column[i] = factor / distances[i] * exponentials[i];
+    else
+      for (size_t i = 0; i < testCount; ++i) {
+        const CoordinateType r = distances[i];
+        column[i] = -factor * numerators[i] / (r * r * r) *
+                    (waveNumber * r + static_cast<CoordinateType>(1.)) *
+                    exponentials[i];
+      }
+  }
+}
+
+} // namespace Fiber
+
+#endif
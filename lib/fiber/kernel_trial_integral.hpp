@@ -51,6 +51,14 @@ public:
 
   virtual void addGeometricalDependencies(size_t &trialGeomDeps) const = 0;
 
+  /** \brief Return true if the integrand is a scalar kernel times the
+   *  first trial function transformation, with no other factors.
+   *
+   *  Evaluators that sum such integrands without calling evaluate(), e.g.
+   *  on a GPU, use this function to decide whether they may do so. The
+   *  default implementation returns false. */
+  virtual bool isScalarKernelTrialProduct() const { return false; }
+
   // Note: 'weights' are assumed to be the products of "raw" quadrature
   // weights and integration elements.
   virtual void
@@ -28,7 +28,14 @@
 #include "basis_data.hpp"
 #include "dune_basis_helper.hpp"
 
+#include "../common/complex_aux.hpp"
+#include "../common/lazy.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <boost/functional/hash.hpp>
 #include <dune/localfunctions/lagrange/pk2d/pk2dlocalbasis.hh>
+#include <tbb/concurrent_unordered_map.h>
+#include <vector>
 
 namespace Fiber {
 
@@ -50,7 +57,16 @@ public:
 };
 
 /** \brief Shapeset composed of the Lagrange polynomials up to a specified
- * order. */
+ *  order.
+ *
+ *  The shape functions are evaluated as linear combinations of the products
+ *  of Legendre polynomials \f$P_a(2x - 1) P_b(2y - 1)\f$, \f$a + b \le p\f$:
+ *  the coefficients are obtained once, by inverting the Vandermonde matrix
+ *  of these polynomials at the Lagrange nodes, so that the values and
+ *  derivatives at a set of points are given by small matrix products. The
+ *  tables of values and derivatives are moreover cached for the point sets
+ *  passed to evaluate(), which are in practice the points of a handful of
+ *  quadrature rules. */
 template <int elementVertexCount, typename ValueType, int polynomialOrder>
 class LagrangeScalarShapeset : public Basis<ValueType> {
 public:
@@ -74,15 +90,180 @@ public:
         (localDofIndex < 0 || size() <= localDofIndex))
       throw std::invalid_argument("LagrangeScalarShapeset::"
                                   "evaluate(): Invalid localDofIndex");
+    if (points.n_rows != 2)
+      throw std::invalid_argument("LagrangeScalarShapeset::"
+                                  "evaluate(): points must have two rows");
+    if (!(what & (VALUES | DERIVATIVES)))
+      return;
+
+    shared_ptr<const Tables> cached = tables(points);
+    const size_t pointCount = points.n_cols;
+    if (what & VALUES) {
+      if (localDofIndex == ALL_DOFS)
+        data.values = cached->values;
+      else {
+        data.values.set_size(1, 1, pointCount);
+        for (size_t p = 0; p < pointCount; ++p)
+          data.values(0, 0, p) = cached->values(0, localDofIndex, p);
+      }
+    }
+    if (what & DERIVATIVES) {
+      if (localDofIndex == ALL_DOFS)
+        data.derivatives = cached->derivatives;
+      else {
+        data.derivatives.set_size(1, 2, 1, pointCount);
+        for (size_t p = 0; p < pointCount; ++p)
+          for (int dim = 0; dim < 2; ++dim)
+            data.derivatives(0, dim, 0, p) =
+                cached->derivatives(0, dim, localDofIndex, p);
+      }
+    }
+  }
+
+private:
+  /** \cond PRIVATE */
+  // Values and derivatives of all shape functions at a set of points
+  struct Tables {
+    _3dArray<ValueType> values;
+    _4dArray<ValueType> derivatives;
+  };
+
+  struct PointsHash {
+    size_t operator()(const std::vector<CoordinateType> &points) const {
+      return boost::hash_range(points.begin(), points.end());
+    }
+  };
+
+  // Point sets beyond this number are evaluated without being cached
+  enum { MAX_CACHED_POINT_SETS = 256 };
+
+  static int polynomialCount() {
+    return (polynomialOrder + 1) * (polynomialOrder + 2) / 2;
+  }
+
+  // Legendre polynomials P_0 ... P_order at t and their derivatives
+  static void legendre(double t, double *values, double *derivatives) {
+    values[0] = 1.;
+    derivatives[0] = 0.;
+    if (polynomialOrder == 0)
+      return;
+    values[1] = t;
+    derivatives[1] = 1.;
+    for (int n = 1; n < polynomialOrder; ++n) {
+      values[n + 1] =
+          ((2 * n + 1) * t * values[n] - n * values[n - 1]) / (n + 1);
+      derivatives[n + 1] = derivatives[n - 1] + (2 * n + 1) * values[n];
+    }
+  }
+
+  // Values (and derivatives with respect to x and y) of the polynomials
+  // P_a(2x - 1) P_b(2y - 1), a + b <= order, at the given points, one row
+  // per point. Unlike monomials, they give well-conditioned Vandermonde
+  // matrices up to high orders.
+  static void evaluatePolynomials(const arma::Mat<double> &points,
+                                  arma::Mat<double> &values,
+                                  arma::Mat<double> *dx = 0,
+                                  arma::Mat<double> *dy = 0) {
+    const size_t pointCount = points.n_cols;
+    values.set_size(pointCount, polynomialCount());
+    if (dx)
+      dx->set_size(pointCount, polynomialCount());
+    if (dy)
+      dy->set_size(pointCount, polynomialCount());
+    double px[polynomialOrder + 1], dpx[polynomialOrder + 1];
+    double py[polynomialOrder + 1], dpy[polynomialOrder + 1];
+    for (size_t p = 0; p < pointCount; ++p) {
+      legendre(2. * points(0, p) - 1., px, dpx);
+      legendre(2. * points(1, p) - 1., py, dpy);
+      for (int b = 0, m = 0; b <= polynomialOrder; ++b)
+        for (int a = 0; a + b <= polynomialOrder; ++a, ++m) {
+          values(p, m) = px[a] * py[b];
+          if (dx)
+            (*dx)(p, m) = 2. * dpx[a] * py[b];
+          if (dy)
+            (*dy)(p, m) = 2. * px[a] * dpy[b];
+        }
+    }
+  }
 
-    if (what & VALUES)
-      evaluateShapeFunctionsWithDune<CoordinateType, ValueType, DuneBasis>(
-          points, localDofIndex, data.values, m_duneBasis);
-    if (what & DERIVATIVES)
-      evaluateShapeFunctionDerivativesWithDune<
-          CoordinateType, ValueType, DuneBasis>(points, localDofIndex,
-                                                data.derivatives, m_duneBasis);
+  // Coefficients of the shape functions (columns) in the basis of
+  // evaluatePolynomials() (rows), found by interpolation at the Lagrange
+  // nodes
+  arma::Mat<double> computeCoefficients() const {
+    const int n = size();
+    arma::Mat<double> nodes(2, n);
+    const double h = polynomialOrder == 0 ? 0. : 1. / polynomialOrder;
+    for (int j = 0, i = 0; j <= polynomialOrder; ++j)
+      for (int l = 0; l + j <= polynomialOrder; ++l, ++i) {
+        nodes(0, i) = l * h;
+        nodes(1, i) = j * h;
+      }
+    if (polynomialOrder == 0)
+      nodes.fill(1. / 3.);
+
+    _3dArray<ValueType> duneValues;
+    evaluateShapeFunctionsWithDune<CoordinateType, ValueType, DuneBasis>(
+        arma::conv_to<arma::Mat<CoordinateType>>::from(nodes), ALL_DOFS,
+        duneValues, m_duneBasis);
+    arma::Mat<double> nodalValues(n, n);
+    for (int f = 0; f < n; ++f)
+      for (int i = 0; i < n; ++i)
+        nodalValues(i, f) = realPart(duneValues(0, f, i));
+
+    arma::Mat<double> vandermonde;
+    evaluatePolynomials(nodes, vandermonde);
+    arma::Mat<double> coefficients;
+    if (!arma::solve(coefficients, vandermonde, nodalValues))
+      throw std::runtime_error("LagrangeScalarShapeset::"
+                               "computeCoefficients(): singular "
+                               "Vandermonde matrix");
+    return coefficients;
   }
+
+  shared_ptr<const Tables>
+  computeTables(const arma::Mat<CoordinateType> &points) const {
+    const arma::Mat<double> &coefficients = m_coefficients.get(
+        [this]() { return computeCoefficients(); });
+    arma::Mat<double> polynomials, dx, dy;
+    evaluatePolynomials(arma::conv_to<arma::Mat<double>>::from(points),
+                        polynomials, &dx, &dy);
+    const arma::Mat<double> values = polynomials * coefficients;
+    const arma::Mat<double> xDerivatives = dx * coefficients;
+    const arma::Mat<double> yDerivatives = dy * coefficients;
+
+    const size_t pointCount = points.n_cols;
+    const int n = size();
+    shared_ptr<Tables> result(new Tables);
+    result->values.set_size(1, n, pointCount);
+    result->derivatives.set_size(1, 2, n, pointCount);
+    for (size_t p = 0; p < pointCount; ++p)
+      for (int f = 0; f < n; ++f) {
+        result->values(0, f, p) = values(p, f);
+        result->derivatives(0, 0, f, p) = xDerivatives(p, f);
+        result->derivatives(0, 1, f, p) = yDerivatives(p, f);
+      }
+    return result;
+  }
+
+  shared_ptr<const Tables>
+  tables(const arma::Mat<CoordinateType> &points) const {
+    std::vector<CoordinateType> key(points.begin(), points.end());
+    typename TableMap::const_iterator it = m_tables.find(key);
+    if (it != m_tables.end())
+      return it->second;
+    shared_ptr<const Tables> result = computeTables(points);
+    if (m_tables.size() < MAX_CACHED_POINT_SETS)
+      // If another thread got there first, its tables are kept
+      return m_tables.insert(std::make_pair(key, result)).first->second;
+    return result;
+  }
+
+  typedef tbb::concurrent_unordered_map<std::vector<CoordinateType>,
+                                        shared_ptr<const Tables>, PointsHash>
+  TableMap;
+  Bempp::Lazy<arma::Mat<double>> m_coefficients;
+  mutable TableMap m_tables;
+  /** \endcond */
 };
 
 } // namespace Fiber
@@ -23,7 +23,9 @@
 
 #include "../common/common.hpp"
 
+#include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
+#include "kernel_tiles_3d.hpp"
 #include "scalar_traits.hpp"
 
 namespace Fiber {
@@ -53,6 +55,8 @@ public:
                                   size_t &trialGeomDeps) const {
     testGeomDeps |= GLOBALS;
     trialGeomDeps |= GLOBALS;
+    testGeomDeps |= tileGeometricalDependencies<CoordinateType>();
+    trialGeomDeps |= tileGeometricalDependencies<CoordinateType>();
   }
 
   template <template <typename T> class CollectionOf2dSlicesOfNdArrays>
@@ -71,6 +75,23 @@ public:
     }
     result[0](0, 0) = static_cast<CoordinateType>(1. / (4. * M_PI)) / sqrt(sum);
   }
+
+  /** \brief Evaluate the kernel on the grid of all test x trial points
+   *  with SIMD instructions (see evaluateModifiedHelmholtz3dOnGrid()). */
+  bool evaluateOnGrid(const GeometricalData<CoordinateType> &testGeomData,
+                      const GeometricalData<CoordinateType> &trialGeomData,
+                      CollectionOf4dArrays<ValueType> &result) const {
+    return evaluateModifiedHelmholtz3dOnGrid(SINGLE_LAYER_TILE, ValueType(0.),
+                                             testGeomData, trialGeomData,
+                                             result[0]);
+  }
+
+  bool describeModifiedHelmholtz3dKernel(
+      KernelTileType &type, std::complex<double> &waveNumber) const {
+    type = SINGLE_LAYER_TILE;
+    waveNumber = 0.;
+    return true;
+  }
 };
 
 } // namespace Fiber
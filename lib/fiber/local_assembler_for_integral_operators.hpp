@@ -24,9 +24,11 @@
 #include "../common/common.hpp"
 
 #include "_2d_array.hpp"
+#include "local_assembly_statistics.hpp"
 #include "scalar_traits.hpp"
 #include "types.hpp"
 
+#include <string>
 #include <vector>
 
 namespace Fiber {
@@ -68,7 +70,10 @@ public:
   If \p nominalDistance is nonnegative, it is taken as the distance between
   all element pairs for the purposes of selecting the quadrature method.
   Otherwise the interelement distance is calculated separately for each
-  element pair. */
+  element pair. A positive \p nominalDistance also guarantees that no two
+  elements share a vertex, as for the clusters of admissible blocks, so
+  that the quadrature rule is selected once per combination of shapesets
+  instead of once per element pair. */
   virtual void
   evaluateLocalWeakForms(CallVariant callVariant,
                          const std::vector<int> &elementIndicesA,
@@ -89,7 +94,10 @@ public:
   If \p nominalDistance is nonnegative, it is taken as the distance between
   all element pairs for the purposes of selecting the quadrature method.
   Otherwise the interelement distance is calculated separately for each
-  element pair. */
+  element pair. A positive \p nominalDistance also guarantees that no two
+  elements share a vertex, as for the clusters of admissible blocks, so
+  that the quadrature rule is selected once per combination of shapesets
+  instead of once per element pair. */
   virtual void
   evaluateLocalWeakForms(const std::vector<int> &testElementIndices,
                          const std::vector<int> &trialElementIndices,
@@ -111,6 +119,34 @@ public:
    *  with 0. */
   virtual CoordinateType
   estimateRelativeScale(CoordinateType minDist) const = 0;
+
+  /** \brief Return the wave number of the oscillations of the kernel of
+   *  this operator, or 0 if it does not oscillate.
+   *
+   *  \see CollectionOfKernels::oscillationWaveNumber() */
+  virtual CoordinateType oscillationWaveNumber() const { return 0; }
+
+  /** \brief Return true if the local weak forms of all pairs of coplanar
+   *  test and trial elements are zero, which evaluateLocalWeakForms() then
+   *  returns without integrating.
+   *
+   *  \see CollectionOfKernels::vanishesOnCoplanarElements() */
+  virtual bool vanishesOnCoplanarElements() const { return false; }
+
+  /** \brief Return the numbers of element pairs integrated so far with each
+   *  quadrature rule, the number of cache hits and the time spent on
+   *  precalculating singular integrals.
+   *
+   *  The default implementation returns empty statistics. */
+  virtual LocalAssemblyStatistics statistics() const {
+    return LocalAssemblyStatistics();
+  }
+
+  /** \brief Set the name under which the memory held by the caches of this
+   *  assembler is listed by the MemoryRegistry.
+   *
+   *  The default implementation does nothing. */
+  virtual void setMemoryOwner(const std::string & /* owner */) {}
 };
 
 } // namespace Fiber
@@ -97,6 +97,18 @@ public:
 
   virtual CoordinateType
   estimateRelativeScale(CoordinateType minDist) const = 0;
+
+  /** \brief Return the wave number of the oscillations of the kernel of
+   *  this operator, or 0 if it does not oscillate.
+   *
+   *  \see CollectionOfKernels::oscillationWaveNumber() */
+  virtual CoordinateType oscillationWaveNumber() const { return 0; }
+
+  /** \brief Return true if the evaluation points of this operator are
+   *  directions of a far-field pattern.
+   *
+   *  \see CollectionOfKernels::isFarFieldKernel() */
+  virtual bool isFarFieldOperator() const { return false; }
 };
 
 } // namespace Fiber
@@ -0,0 +1,58 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_local_assembly_statistics_hpp
+#define fiber_local_assembly_statistics_hpp
+
+#include "../common/common.hpp"
+
+#include "double_quadrature_descriptor.hpp"
+
+#include <cstddef>
+#include <map>
+
+namespace Fiber {
+
+/** \ingroup fiber
+ *  \brief Work done by a local assembler for integral operators.
+ *
+ *  Returned by LocalAssemblerForIntegralOperators::statistics(). */
+struct LocalAssemblyStatistics {
+  LocalAssemblyStatistics()
+      : cacheHitCount(0), singularCachingWallTime(0),
+        singularCachingCpuTime(0) {}
+
+  // Numbers of element pairs integrated on demand with each quadrature rule
+  std::map<DoubleQuadratureDescriptor, std::size_t> elementPairCounts;
+  // Numbers of element pairs whose integrals were precalculated when the
+  // assembler was constructed (singular integral caching)
+  std::map<DoubleQuadratureDescriptor, std::size_t> cachedElementPairCounts;
+  // Number of local weak forms taken from the cache of precalculated
+  // integrals
+  std::size_t cacheHitCount;
+  // Wall-clock and CPU (summed over all threads) time in seconds spent on
+  // precalculating the cached integrals
+  double singularCachingWallTime;
+  double singularCachingCpuTime;
+};
+
+} // namespace Fiber
+
+#endif
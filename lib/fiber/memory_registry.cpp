@@ -0,0 +1,303 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "memory_registry.hpp"
+
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <tbb/mutex.h>
+#include <tbb/recursive_mutex.h>
+
+namespace Fiber {
+
+namespace {
+
+struct OwnerRecord {
+  OwnerRecord() : bytes(0), allocationCount(0) {}
+
+  std::size_t bytes;
+  std::size_t allocationCount;
+};
+
+struct HandlerRecord {
+  int id;
+  bool active;
+  MemoryRegistry::EvictionHandler handler;
+};
+
+struct RegistryState {
+  RegistryState() : liveBytes(0), peakBytes(0), nextHandlerId(0) {
+    for (int i = 0; i < MemoryCategory::CATEGORY_COUNT; ++i)
+      categoryBytes[i] = 0;
+  }
+
+  // Protects everything except the handlers
+  tbb::mutex mutex;
+  std::size_t liveBytes;
+  std::size_t peakBytes;
+  std::size_t categoryBytes[MemoryCategory::CATEGORY_COUNT];
+  std::map<std::pair<int, std::string>, OwnerRecord> owners;
+
+  // Held during evictions, so that handlers may not be removed while they
+  // run; recursive since handlers may free memory and hence call record()
+  // or even evict()
+  tbb::recursive_mutex handlersMutex;
+  std::vector<std::shared_ptr<HandlerRecord>> handlers;
+  int nextHandlerId;
+};
+
+// Never destroyed, since allocations may be released during static
+// destruction
+RegistryState &state() {
+  static RegistryState *state = new RegistryState;
+  return *state;
+}
+
+std::size_t difference(std::size_t before, std::size_t after) {
+  return before > after ? before - after : 0;
+}
+
+void writeJsonString(std::ostream &os, const std::string &s) {
+  os << '"';
+  for (std::size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '"' || s[i] == '\\')
+      os << '\\' << s[i];
+    else if (static_cast<unsigned char>(s[i]) < 0x20)
+      os << ' ';
+    else
+      os << s[i];
+  }
+  os << '"';
+}
+
+} // namespace
+
+const char *MemoryCategory::name(Type category) {
+  static const char *names[CATEGORY_COUNT] = {
+      "denseMatrices", "hMatrices", "acaMatrices", "singularIntegralCaches",
+      "localDofListsCaches"};
+  return names[category];
+}
+
+MemoryAllocation::MemoryAllocation(MemoryCategory::Type category,
+                                   std::size_t bytes,
+                                   const std::string &owner)
+    : m_category(category), m_bytes(bytes), m_owner(owner) {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  MemoryRegistry::record(m_category, m_owner, m_bytes, 1);
+}
+
+MemoryAllocation::~MemoryAllocation() {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  MemoryRegistry::record(m_category, m_owner,
+                         -static_cast<std::ptrdiff_t>(m_bytes), -1);
+}
+
+std::size_t MemoryAllocation::bytes() const {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  return m_bytes;
+}
+
+std::string MemoryAllocation::owner() const {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  return m_owner;
+}
+
+void MemoryAllocation::resize(std::size_t bytes) {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  MemoryRegistry::record(m_category, m_owner,
+                         static_cast<std::ptrdiff_t>(bytes) -
+                             static_cast<std::ptrdiff_t>(m_bytes),
+                         0);
+  m_bytes = bytes;
+}
+
+void MemoryAllocation::grow(std::size_t bytes) {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  MemoryRegistry::record(m_category, m_owner, bytes, 0);
+  m_bytes += bytes;
+}
+
+void MemoryAllocation::setOwner(const std::string &owner) {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  if (owner == m_owner)
+    return;
+  MemoryRegistry::record(m_category, m_owner,
+                         -static_cast<std::ptrdiff_t>(m_bytes), -1);
+  m_owner = owner;
+  MemoryRegistry::record(m_category, m_owner, m_bytes, 1);
+}
+
+void MemoryRegistry::record(MemoryCategory::Type category,
+                            const std::string &owner, std::ptrdiff_t bytes,
+                            int allocations) {
+  RegistryState &s = state();
+  s.liveBytes += bytes;
+  s.categoryBytes[category] += bytes;
+  if (s.liveBytes > s.peakBytes)
+    s.peakBytes = s.liveBytes;
+
+  const std::pair<int, std::string> key(category, owner);
+  OwnerRecord &record = s.owners[key];
+  record.bytes += bytes;
+  record.allocationCount += allocations;
+  if (record.allocationCount == 0)
+    s.owners.erase(key);
+}
+
+std::size_t MemoryRegistry::liveBytes() {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  return state().liveBytes;
+}
+
+std::size_t MemoryRegistry::liveBytes(MemoryCategory::Type category) {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  return state().categoryBytes[category];
+}
+
+std::size_t MemoryRegistry::peakBytes() {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  return state().peakBytes;
+}
+
+void MemoryRegistry::resetPeak() {
+  tbb::mutex::scoped_lock lock(state().mutex);
+  state().peakBytes = state().liveBytes;
+}
+
+MemoryUsage MemoryRegistry::usage() {
+  RegistryState &s = state();
+  tbb::mutex::scoped_lock lock(s.mutex);
+  MemoryUsage result;
+  result.liveBytes = s.liveBytes;
+  result.peakBytes = s.peakBytes;
+  for (int i = 0; i < MemoryCategory::CATEGORY_COUNT; ++i)
+    result.categoryBytes[i] = s.categoryBytes[i];
+  result.owners.reserve(s.owners.size());
+  for (std::map<std::pair<int, std::string>, OwnerRecord>::const_iterator it =
+           s.owners.begin();
+       it != s.owners.end(); ++it) {
+    MemoryOwnerUsage owner;
+    owner.owner = it->first.second;
+    owner.category = static_cast<MemoryCategory::Type>(it->first.first);
+    owner.bytes = it->second.bytes;
+    owner.allocationCount = it->second.allocationCount;
+    result.owners.push_back(owner);
+  }
+  return result;
+}
+
+int MemoryRegistry::addEvictionHandler(const EvictionHandler &handler) {
+  RegistryState &s = state();
+  tbb::recursive_mutex::scoped_lock lock(s.handlersMutex);
+  std::shared_ptr<HandlerRecord> record(new HandlerRecord);
+  record->id = s.nextHandlerId++;
+  record->active = true;
+  record->handler = handler;
+  s.handlers.push_back(record);
+  return record->id;
+}
+
+void MemoryRegistry::removeEvictionHandler(int id) {
+  RegistryState &s = state();
+  tbb::recursive_mutex::scoped_lock lock(s.handlersMutex);
+  for (std::size_t i = 0; i < s.handlers.size(); ++i)
+    if (s.handlers[i]->id == id) {
+      // The record may still be referenced by an evict() loop running in
+      // this thread, e.g. if a handler destroys a cache it evicts from
+      s.handlers[i]->active = false;
+      s.handlers.erase(s.handlers.begin() + i);
+      return;
+    }
+}
+
+std::size_t MemoryRegistry::evict(std::size_t bytes) {
+  RegistryState &s = state();
+  tbb::recursive_mutex::scoped_lock lock(s.handlersMutex);
+  const std::size_t before = liveBytes();
+  // Copy, since handlers may be removed by the handlers themselves
+  const std::vector<std::shared_ptr<HandlerRecord>> handlers(s.handlers);
+  for (std::size_t i = 0; i < handlers.size(); ++i) {
+    const std::size_t released = difference(before, liveBytes());
+    if (released >= bytes)
+      break;
+    if (handlers[i]->active)
+      handlers[i]->handler(bytes - released);
+  }
+  return difference(before, liveBytes());
+}
+
+bool MemoryRegistry::makeRoom(std::size_t bytes, std::size_t budget) {
+  if (budget == 0)
+    return true;
+  const std::size_t live = liveBytes();
+  if (live + bytes > budget)
+    evict(live + bytes - budget);
+  return liveBytes() + bytes <= budget;
+}
+
+std::ostream &operator<<(std::ostream &os, const MemoryUsage &usage) {
+  const double mb = 1024. * 1024.;
+  os << "Memory: " << usage.liveBytes / mb << " MB live, "
+     << usage.peakBytes / mb << " MB peak";
+  for (int i = 0; i < MemoryCategory::CATEGORY_COUNT; ++i)
+    if (usage.categoryBytes[i] > 0)
+      os << "\n  "
+         << std::setw(24) << std::left
+         << MemoryCategory::name(static_cast<MemoryCategory::Type>(i))
+         << std::right << usage.categoryBytes[i] / mb << " MB";
+  for (std::size_t i = 0; i < usage.owners.size(); ++i) {
+    const MemoryOwnerUsage &owner = usage.owners[i];
+    if (owner.owner.empty())
+      continue;
+    os << "\n    " << owner.owner << " ("
+       << MemoryCategory::name(owner.category) << "): " << owner.bytes / mb
+       << " MB";
+  }
+  return os;
+}
+
+void writeJson(std::ostream &os, const MemoryUsage &usage) {
+  os << "{\n"
+     << "  \"liveBytes\": " << usage.liveBytes << ",\n"
+     << "  \"peakBytes\": " << usage.peakBytes << ",\n"
+     << "  \"categories\": {";
+  for (int i = 0; i < MemoryCategory::CATEGORY_COUNT; ++i)
+    os << (i > 0 ? "," : "") << "\n    \""
+       << MemoryCategory::name(static_cast<MemoryCategory::Type>(i))
+       << "\": " << usage.categoryBytes[i];
+  os << "\n  },\n"
+     << "  \"owners\": [";
+  for (std::size_t i = 0; i < usage.owners.size(); ++i) {
+    const MemoryOwnerUsage &owner = usage.owners[i];
+    os << (i > 0 ? "," : "") << "\n    {\"owner\": ";
+    writeJsonString(os, owner.owner);
+    os << ", \"category\": \"" << MemoryCategory::name(owner.category)
+       << "\", \"bytes\": " << owner.bytes
+       << ", \"allocationCount\": " << owner.allocationCount << "}";
+  }
+  os << "\n  ]\n"
+     << "}\n";
+}
+
+} // namespace Fiber
@@ -0,0 +1,184 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_memory_registry_hpp
+#define fiber_memory_registry_hpp
+
+#include "../common/common.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Fiber {
+
+/** \ingroup fiber
+ *  \brief Categories of memory tracked by the MemoryRegistry. */
+struct MemoryCategory {
+  enum Type {
+    /** \brief Entries of dense discrete operators. */
+    DENSE_MATRICES,
+    /** \brief Blocks of H- and H2-matrices. */
+    HMATRICES,
+    /** \brief Blocks of H-matrices assembled with AHMED. */
+    ACA_MATRICES,
+    /** \brief Local weak forms of singular element pairs cached by local
+     *  assemblers. */
+    SINGULAR_INTEGRAL_CACHES,
+    /** \brief DOF lists cached by LocalDofListsCache. */
+    LOCAL_DOF_LISTS_CACHES,
+    CATEGORY_COUNT
+  };
+
+  /** \brief Return the name of \p category, e.g. "denseMatrices". */
+  static const char *name(Type category);
+};
+
+/** \ingroup fiber
+ *  \brief Block of memory recorded in the MemoryRegistry.
+
+  The memory is accounted for from construction to destruction of this
+  object, which is typically a member of the object holding the memory. Its
+  size and owner (e.g. the label of a boundary operator) can be updated at
+  any time. All member functions are thread-safe. */
+class MemoryAllocation : boost::noncopyable {
+public:
+  explicit MemoryAllocation(MemoryCategory::Type category,
+                            std::size_t bytes = 0,
+                            const std::string &owner = std::string());
+  ~MemoryAllocation();
+
+  MemoryCategory::Type category() const { return m_category; }
+  std::size_t bytes() const;
+  std::string owner() const;
+
+  /** \brief Set the size of the memory block to \p bytes. */
+  void resize(std::size_t bytes);
+  /** \brief Add \p bytes to the size of the memory block. */
+  void grow(std::size_t bytes);
+  void setOwner(const std::string &owner);
+
+private:
+  const MemoryCategory::Type m_category;
+  std::size_t m_bytes;
+  std::string m_owner;
+};
+
+/** \ingroup fiber
+ *  \brief Memory recorded for one owner in one category. */
+struct MemoryOwnerUsage {
+  std::string owner;
+  MemoryCategory::Type category;
+  std::size_t bytes;
+  std::size_t allocationCount;
+};
+
+/** \ingroup fiber
+ *  \brief Snapshot of the memory recorded in the MemoryRegistry. */
+struct MemoryUsage {
+  MemoryUsage() : liveBytes(0), peakBytes(0) {
+    for (int i = 0; i < MemoryCategory::CATEGORY_COUNT; ++i)
+      categoryBytes[i] = 0;
+  }
+
+  std::size_t liveBytes;
+  std::size_t peakBytes;
+  std::size_t categoryBytes[MemoryCategory::CATEGORY_COUNT];
+  // Sorted by category, then by owner
+  std::vector<MemoryOwnerUsage> owners;
+};
+
+/** \ingroup fiber
+ *  \brief Process-wide record of the memory held by discrete operators and
+ *  caches.
+
+  Components holding large amounts of memory record it with
+  MemoryAllocation objects; the registry keeps the live total per category
+  and per owner. Components holding memory that can be released at any time
+  (e.g. the weak-form cache of a Context) register eviction handlers, which
+  are invoked by evict() and makeRoom() to keep the recorded total under a
+  memory budget.
+
+  The registry only knows about the memory recorded in it; memory used
+  temporarily during assembly, e.g. by quadrature, is not included. */
+class MemoryRegistry {
+public:
+  /** \brief Function releasing (at least) the given number of bytes, if
+   *  possible. */
+  typedef std::function<void(std::size_t)> EvictionHandler;
+
+  /** \brief Return the total number of live bytes. */
+  static std::size_t liveBytes();
+
+  /** \brief Return the number of live bytes in \p category. */
+  static std::size_t liveBytes(MemoryCategory::Type category);
+
+  /** \brief Return the highest total number of live bytes since program
+   *  start or the last call of resetPeak(). */
+  static std::size_t peakBytes();
+
+  /** \brief Set the peak to the current total. */
+  static void resetPeak();
+
+  /** \brief Return a snapshot of the recorded memory. */
+  static MemoryUsage usage();
+
+  /** \brief Register \p handler; return an identifier to be passed to
+   *  removeEvictionHandler(). */
+  static int addEvictionHandler(const EvictionHandler &handler);
+
+  /** \brief Unregister a handler. Waits for evictions in progress in other
+   *  threads, so that the handler is not called after this function
+   *  returns. */
+  static void removeEvictionHandler(int id);
+
+  /** \brief Invoke the eviction handlers, in the order of registration,
+   *  until \p bytes have been released; return the number of bytes
+   *  released. */
+  static std::size_t evict(std::size_t bytes);
+
+  /** \brief Make room for \p bytes more in a budget of \p budget bytes.
+   *
+   *  Evicts cached data if the live total plus \p bytes exceeds \p budget.
+   *  Returns true if the result fits in the budget. A \p budget of 0 means
+   *  no budget; true is then returned immediately. */
+  static bool makeRoom(std::size_t bytes, std::size_t budget);
+
+private:
+  friend class MemoryAllocation;
+  // Must be called with the registry mutex held
+  static void record(MemoryCategory::Type category, const std::string &owner,
+                     std::ptrdiff_t bytes, int allocations);
+};
+
+/** \relates MemoryUsage
+ *  \brief Write a human-readable summary of \p usage. */
+std::ostream &operator<<(std::ostream &os, const MemoryUsage &usage);
+
+/** \relates MemoryUsage
+ *  \brief Write \p usage in JSON format. */
+void writeJson(std::ostream &os, const MemoryUsage &usage);
+
+} // namespace Fiber
+
+#endif
@@ -23,7 +23,9 @@
 
 #include "../common/common.hpp"
 
+#include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
+#include "kernel_tiles_3d.hpp"
 #include "scalar_traits.hpp"
 
 #include "../common/complex_aux.hpp"
@@ -62,6 +64,8 @@ public:
                                   size_t &trialGeomDeps) const {
     testGeomDeps |= GLOBALS | NORMALS;
     trialGeomDeps |= GLOBALS;
+    testGeomDeps |= tileGeometricalDependencies<CoordinateType>();
+    trialGeomDeps |= tileGeometricalDependencies<CoordinateType>();
   }
 
   ValueType waveNumber() const { return m_waveNumber; }
@@ -87,6 +91,27 @@ public:
         exp(-m_waveNumber * distance);
   }
 
+  /** \brief Evaluate the kernel on the grid of all test x trial points
+   *  with SIMD instructions (see evaluateModifiedHelmholtz3dOnGrid()). */
+  bool evaluateOnGrid(const GeometricalData<CoordinateType> &testGeomData,
+                      const GeometricalData<CoordinateType> &trialGeomData,
+                      CollectionOf4dArrays<ValueType> &result) const {
+    return evaluateModifiedHelmholtz3dOnGrid(
+        ADJOINT_DOUBLE_LAYER_TILE, m_waveNumber, testGeomData, trialGeomData, result[0]);
+  }
+
+  bool describeModifiedHelmholtz3dKernel(
+      KernelTileType &type, std::complex<double> &waveNumber) const {
+    type = ADJOINT_DOUBLE_LAYER_TILE;
+    waveNumber = std::complex<double>(realPart(m_waveNumber),
+                                      imagPart(m_waveNumber));
+    return true;
+  }
+
+  /** \brief The kernel is proportional to \f$(x - y) \cdot n(x)\f$ and
+   *  hence vanishes if x and y lie in a common plane. */
+  bool vanishesOnCoplanarElements() const { return true; }
+
   CoordinateType estimateRelativeScale(CoordinateType distance) const {
     return exp(-realPart(m_waveNumber) * distance);
   }
@@ -23,9 +23,11 @@
 
 #include "../common/common.hpp"
 
+#include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
 #include "hermite_interpolator.hpp"
 #include "initialize_interpolator_for_modified_helmholtz_3d_kernels.hpp"
+#include "kernel_tiles_3d.hpp"
 #include "scalar_traits.hpp"
 
 #include "../common/complex_aux.hpp"
@@ -56,10 +58,9 @@ public:
 
   ModifiedHelmholtz3dAdjointDoubleLayerPotentialKernelInterpolatedFunctor(
       ValueType waveNumber, CoordinateType maxDist, int interpPtsPerWavelength)
-      : m_waveNumber(waveNumber) {
-    initializeInterpolatorForModifiedHelmholtz3dKernels(
-        waveNumber, maxDist, interpPtsPerWavelength, m_interpolator);
-  }
+      : m_waveNumber(waveNumber),
+        m_interpolator(sharedInterpolatorForModifiedHelmholtz3dKernels(
+            waveNumber, maxDist, interpPtsPerWavelength)) {}
 
   int kernelCount() const { return 1; }
   int kernelRowCount(int /* kernelIndex */) const { return 1; }
@@ -69,6 +70,8 @@ public:
                                   size_t &trialGeomDeps) const {
     testGeomDeps |= GLOBALS | NORMALS;
     trialGeomDeps |= GLOBALS;
+    testGeomDeps |= tileGeometricalDependencies<CoordinateType>();
+    trialGeomDeps |= tileGeometricalDependencies<CoordinateType>();
   }
 
   ValueType waveNumber() const { return m_waveNumber; }
@@ -87,13 +90,38 @@ public:
       numeratorSum += diff * testGeomData.normal(coordIndex);
     }
     CoordinateType dist = sqrt(distSq);
-    ValueType v = m_interpolator.evaluate(dist);
+    ValueType v = m_interpolator->evaluate(dist);
     result[0](0, 0) =
         numeratorSum /
         (static_cast<CoordinateType>(-4.0 * M_PI) * distSq * dist) *
         (m_waveNumber * dist + static_cast<CoordinateType>(1.0)) * v;
   }
 
+  bool evaluateOnGrid(const GeometricalData<CoordinateType> &testGeomData,
+                      const GeometricalData<CoordinateType> &trialGeomData,
+                      CollectionOf4dArrays<ValueType> &result) const {
+    // In SIMD builds the exact kernel is cheaper than the table lookups
+    if (!evaluateModifiedHelmholtz3dOnGrid(ADJOINT_DOUBLE_LAYER_TILE,
+                                           m_waveNumber, testGeomData,
+                                           trialGeomData, result[0]))
+      evaluateInterpolatedModifiedHelmholtz3dOnGrid(
+          ADJOINT_DOUBLE_LAYER_TILE, m_waveNumber, *m_interpolator,
+          testGeomData, trialGeomData, result[0]);
+    return true;
+  }
+
+  bool describeModifiedHelmholtz3dKernel(
+      KernelTileType &type, std::complex<double> &waveNumber) const {
+    type = ADJOINT_DOUBLE_LAYER_TILE;
+    waveNumber = std::complex<double>(realPart(m_waveNumber),
+                                      imagPart(m_waveNumber));
+    return true;
+  }
+
+  /** \brief The kernel is proportional to \f$(x - y) \cdot n(x)\f$ and
+   *  hence vanishes if x and y lie in a common plane. */
+  bool vanishesOnCoplanarElements() const { return true; }
+
   CoordinateType estimateRelativeScale(CoordinateType distance) const {
     // This function is called rarely, invoking exp() here does little harm.
     return exp(-realPart(m_waveNumber) * distance);
@@ -102,7 +130,7 @@ public:
 private:
   /** \cond PRIVATE */
   ValueType m_waveNumber;
-  HermiteInterpolator<ValueType> m_interpolator;
+  shared_ptr<const HermiteInterpolator<ValueType>> m_interpolator;
   /** \endcond */
 };
 
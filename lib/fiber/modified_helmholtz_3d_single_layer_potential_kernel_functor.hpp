@@ -23,7 +23,11 @@
 
 #include "../common/common.hpp"
 
+#include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
+#include "kernel_tiles_3d.hpp"
+#include "laplace_3d_single_layer_potential_kernel_functor.hpp"
+#include "modified_helmholtz_3d_single_layer_potential_smooth_part_kernel_functor.hpp"
 #include "scalar_traits.hpp"
 
 #include "../common/complex_aux.hpp"
@@ -61,10 +65,25 @@ public:
                                   size_t &trialGeomDeps) const {
     testGeomDeps |= GLOBALS;
     trialGeomDeps |= GLOBALS;
+    testGeomDeps |= tileGeometricalDependencies<CoordinateType>();
+    trialGeomDeps |= tileGeometricalDependencies<CoordinateType>();
   }
 
   ValueType waveNumber() const { return m_waveNumber; }
 
+  /** \brief Splitting of the kernel into the wave-number-independent,
+   *  real singular Laplace kernel and a bounded remainder
+   *  (see CollectionOfKernels::singularPart()). */
+  typedef Laplace3dSingleLayerPotentialKernelFunctor<CoordinateType>
+  SingularPartFunctor;
+  typedef ModifiedHelmholtz3dSingleLayerPotentialSmoothPartKernelFunctor<
+      ValueType> SmoothPartFunctor;
+
+  SingularPartFunctor singularPart() const { return SingularPartFunctor(); }
+  SmoothPartFunctor smoothPart() const {
+    return SmoothPartFunctor(m_waveNumber);
+  }
+
   template <template <typename T> class CollectionOf2dSlicesOfNdArrays>
   void evaluate(const ConstGeometricalDataSlice<CoordinateType> &testGeomData,
                 const ConstGeometricalDataSlice<CoordinateType> &trialGeomData,
@@ -82,6 +101,24 @@ public:
                       distance * exp(-m_waveNumber * distance);
   }
 
+  /** \brief Evaluate the kernel on the grid of all test x trial points
+   *  with SIMD instructions (see evaluateModifiedHelmholtz3dOnGrid()). */
+  bool evaluateOnGrid(const GeometricalData<CoordinateType> &testGeomData,
+                      const GeometricalData<CoordinateType> &trialGeomData,
+                      CollectionOf4dArrays<ValueType> &result) const {
+    return evaluateModifiedHelmholtz3dOnGrid(SINGLE_LAYER_TILE, m_waveNumber,
+                                             testGeomData, trialGeomData,
+                                             result[0]);
+  }
+
+  bool describeModifiedHelmholtz3dKernel(
+      KernelTileType &type, std::complex<double> &waveNumber) const {
+    type = SINGLE_LAYER_TILE;
+    waveNumber = std::complex<double>(realPart(m_waveNumber),
+                                      imagPart(m_waveNumber));
+    return true;
+  }
+
   CoordinateType estimateRelativeScale(CoordinateType distance) const {
     return exp(-realPart(m_waveNumber) * distance);
   }
@@ -23,9 +23,13 @@
 
 #include "../common/common.hpp"
 
+#include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
 #include "hermite_interpolator.hpp"
 #include "initialize_interpolator_for_modified_helmholtz_3d_kernels.hpp"
+#include "kernel_tiles_3d.hpp"
+#include "laplace_3d_single_layer_potential_kernel_functor.hpp"
+#include "modified_helmholtz_3d_single_layer_potential_smooth_part_kernel_functor.hpp"
 #include "scalar_traits.hpp"
 
 #include "../common/complex_aux.hpp"
@@ -55,10 +59,9 @@ public:
 
   ModifiedHelmholtz3dSingleLayerPotentialKernelInterpolatedFunctor(
       ValueType waveNumber, CoordinateType maxDist, int interpPtsPerWavelength)
-      : m_waveNumber(waveNumber) {
-    initializeInterpolatorForModifiedHelmholtz3dKernels(
-        waveNumber, maxDist, interpPtsPerWavelength, m_interpolator);
-  }
+      : m_waveNumber(waveNumber),
+        m_interpolator(sharedInterpolatorForModifiedHelmholtz3dKernels(
+            waveNumber, maxDist, interpPtsPerWavelength)) {}
 
   int kernelCount() const { return 1; }
   int kernelRowCount(int /* kernelIndex */) const { return 1; }
@@ -68,10 +71,25 @@ public:
                                   size_t &trialGeomDeps) const {
     testGeomDeps |= GLOBALS;
     trialGeomDeps |= GLOBALS;
+    testGeomDeps |= tileGeometricalDependencies<CoordinateType>();
+    trialGeomDeps |= tileGeometricalDependencies<CoordinateType>();
   }
 
   ValueType waveNumber() const { return m_waveNumber; }
 
+  /** \brief Splitting of the kernel into the wave-number-independent,
+   *  real singular Laplace kernel and a bounded remainder
+   *  (see CollectionOfKernels::singularPart()). */
+  typedef Laplace3dSingleLayerPotentialKernelFunctor<CoordinateType>
+  SingularPartFunctor;
+  typedef ModifiedHelmholtz3dSingleLayerPotentialSmoothPartKernelFunctor<
+      ValueType> SmoothPartFunctor;
+
+  SingularPartFunctor singularPart() const { return SingularPartFunctor(); }
+  SmoothPartFunctor smoothPart() const {
+    return SmoothPartFunctor(m_waveNumber);
+  }
+
   template <template <typename T> class CollectionOf2dSlicesOfNdArrays>
   void evaluate(const ConstGeometricalDataSlice<CoordinateType> &testGeomData,
                 const ConstGeometricalDataSlice<CoordinateType> &trialGeomData,
@@ -85,11 +103,32 @@ public:
       sum += diff * diff;
     }
     CoordinateType distance = sqrt(sum);
-    ValueType v = m_interpolator.evaluate(distance);
+    ValueType v = m_interpolator->evaluate(distance);
     result[0](0, 0) =
         static_cast<CoordinateType>(1.0 / (4.0 * M_PI)) / distance * v;
   }
 
+  bool evaluateOnGrid(const GeometricalData<CoordinateType> &testGeomData,
+                      const GeometricalData<CoordinateType> &trialGeomData,
+                      CollectionOf4dArrays<ValueType> &result) const {
+    // In SIMD builds the exact kernel is cheaper than the table lookups
+    if (!evaluateModifiedHelmholtz3dOnGrid(SINGLE_LAYER_TILE, m_waveNumber,
+                                           testGeomData, trialGeomData,
+                                           result[0]))
+      evaluateInterpolatedModifiedHelmholtz3dOnGrid(
+          SINGLE_LAYER_TILE, m_waveNumber, *m_interpolator, testGeomData,
+          trialGeomData, result[0]);
+    return true;
+  }
+
+  bool describeModifiedHelmholtz3dKernel(
+      KernelTileType &type, std::complex<double> &waveNumber) const {
+    type = SINGLE_LAYER_TILE;
+    waveNumber = std::complex<double>(realPart(m_waveNumber),
+                                      imagPart(m_waveNumber));
+    return true;
+  }
+
   CoordinateType estimateRelativeScale(CoordinateType distance) const {
     // This function is called rarely, invoking exp() here does little harm.
     return exp(-realPart(m_waveNumber) * distance);
@@ -98,7 +137,7 @@ public:
 private:
   /** \cond PRIVATE */
   ValueType m_waveNumber;
-  HermiteInterpolator<ValueType> m_interpolator;
+  shared_ptr<const HermiteInterpolator<ValueType>> m_interpolator;
   /** \endcond */
 };
 
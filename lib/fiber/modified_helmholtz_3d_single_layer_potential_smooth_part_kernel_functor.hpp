@@ -0,0 +1,109 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_modified_helmholtz_3d_single_layer_potential_smooth_part_kernel_functor_hpp
+#define fiber_modified_helmholtz_3d_single_layer_potential_smooth_part_kernel_functor_hpp
+
+#include "../common/common.hpp"
+
+#include "geometrical_data.hpp"
+#include "scalar_traits.hpp"
+
+#include "../common/complex_aux.hpp"
+
+#include <cmath>
+
+namespace Fiber {
+
+/** \ingroup modified_helmholtz_3d
+ *  \ingroup functors
+ *  \brief Difference between the single-layer-potential kernels of the
+ *  modified Helmholtz and the Laplace equation in 3D.
+ *
+ *  The kernel \f$(e^{-\kappa r} - 1) / (4 \pi r)\f$ is bounded, its value at
+ *  \f$r = 0\f$ being \f$-\kappa / (4 \pi)\f$, so that it can be integrated
+ *  with regular quadrature rules also on adjacent elements. For small
+ *  \f$|\kappa r|\f$ it is evaluated from its Taylor series to avoid
+ *  cancellation.
+ *
+ *  \tparam ValueType Type used to represent the values of the kernel. It can
+ *  be one of: \c float, \c double, <tt>std::complex<float></tt> and
+ *  <tt>std::complex<double></tt>.
+ *
+ *  \see ModifiedHelmholtz3dSingleLayerPotentialKernelFunctor
+ */
+
+template <typename ValueType_>
+class ModifiedHelmholtz3dSingleLayerPotentialSmoothPartKernelFunctor {
+public:
+  typedef ValueType_ ValueType;
+  typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+  explicit ModifiedHelmholtz3dSingleLayerPotentialSmoothPartKernelFunctor(
+      ValueType waveNumber)
+      : m_waveNumber(waveNumber) {}
+
+  int kernelCount() const { return 1; }
+  int kernelRowCount(int /* kernelIndex */) const { return 1; }
+  int kernelColCount(int /* kernelIndex */) const { return 1; }
+
+  void addGeometricalDependencies(size_t &testGeomDeps,
+                                  size_t &trialGeomDeps) const {
+    testGeomDeps |= GLOBALS;
+    trialGeomDeps |= GLOBALS;
+  }
+
+  ValueType waveNumber() const { return m_waveNumber; }
+
+  template <template <typename T> class CollectionOf2dSlicesOfNdArrays>
+  void evaluate(const ConstGeometricalDataSlice<CoordinateType> &testGeomData,
+                const ConstGeometricalDataSlice<CoordinateType> &trialGeomData,
+                CollectionOf2dSlicesOfNdArrays<ValueType> &result) const {
+    const int coordCount = 3;
+
+    CoordinateType sum = 0;
+    for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+      CoordinateType diff =
+          testGeomData.global(coordIndex) - trialGeomData.global(coordIndex);
+      sum += diff * diff;
+    }
+    const CoordinateType distance = sqrt(sum);
+    const ValueType x = -m_waveNumber * distance;
+    const CoordinateType factor =
+        static_cast<CoordinateType>(1.0 / (4.0 * M_PI));
+    if (std::abs(x) < static_cast<CoordinateType>(0.1)) {
+      // (e^x - 1) / x = 1 + x/2 + x^2/6 + ..., truncated after x^6
+      ValueType series = static_cast<CoordinateType>(1.);
+      for (int n = 7; n >= 2; --n)
+        series = static_cast<CoordinateType>(1.) +
+                 x * series / static_cast<CoordinateType>(n);
+      result[0](0, 0) = -factor * m_waveNumber * series;
+    } else
+      result[0](0, 0) =
+          factor * (exp(x) - static_cast<CoordinateType>(1.)) / distance;
+  }
+
+private:
+  ValueType m_waveNumber;
+};
+
+} // namespace Fiber
+
+#endif
@@ -62,6 +62,8 @@ public:
 
   ValueType waveNumber() const { return m_waveNumber; }
 
+  bool isFarFieldKernel() const { return true; }
+
   template <template <typename T> class CollectionOf2dSlicesOfNdArrays>
   void evaluate(const ConstGeometricalDataSlice<CoordinateType> &testGeomData,
                 const ConstGeometricalDataSlice<CoordinateType> &trialGeomData,
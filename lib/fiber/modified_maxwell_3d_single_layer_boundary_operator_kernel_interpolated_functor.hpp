@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 #include "../common/complex_aux.hpp"
 
+#include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
 #include "scalar_traits.hpp"
 
@@ -78,6 +79,28 @@ public:
     result[0](0, 0) *= m_slpKernel.waveNumber();
   }
 
+  /** \brief Evaluate both kernels on the grid of all test x trial points,
+   *  running the single-layer kernel once for the whole grid (see
+   *  ModifiedHelmholtz3dSingleLayerPotentialKernelInterpolatedFunctor). */
+  bool evaluateOnGrid(const GeometricalData<CoordinateType> &testGeomData,
+                      const GeometricalData<CoordinateType> &trialGeomData,
+                      CollectionOf4dArrays<ValueType> &result) const {
+    // This will put the values of the SLP kernel in result[0]
+    if (!m_slpKernel.evaluateOnGrid(testGeomData, trialGeomData, result))
+      return false;
+    const ValueType waveNumber = m_slpKernel.waveNumber();
+    const ValueType inverseWaveNumber = static_cast<CoordinateType>(1.) /
+                                        waveNumber;
+    ValueType *values0 = result[0].begin();
+    ValueType *values1 = result[1].begin();
+    const size_t valueCount = result[0].end() - values0;
+    for (size_t i = 0; i < valueCount; ++i) {
+      values1[i] = values0[i] * inverseWaveNumber;
+      values0[i] *= waveNumber;
+    }
+    return true;
+  }
+
   CoordinateType estimateRelativeScale(CoordinateType distance) const {
     return m_slpKernel.estimateRelativeScale(distance);
   }
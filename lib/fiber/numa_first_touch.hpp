@@ -0,0 +1,79 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_numa_first_touch_hpp
+#define fiber_numa_first_touch_hpp
+
+#include "../common/common.hpp"
+
+#include "task_arena_cache.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <algorithm>
+#include <cstddef>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+
+namespace Fiber {
+
+/** \brief Call \p f(firstColumn, lastColumn) for consecutive blocks of the
+ *  column range [0, \p columnCount) in parallel, in taskArena(\p
+ *  maxThreadCount).
+ *
+ *  The blocks are handed out by tbb::static_partitioner, so two calls with
+ *  the same column count and thread count assign the same columns to the
+ *  same thread of the arena. Initialising a matrix with this function and
+ *  later multiplying with it the same way makes every thread read only the
+ *  pages it touched first, which under the first-touch policy of the
+ *  operating system are placed on the NUMA node it runs on. */
+template <typename Functor>
+void forEachColumnBlock(size_t columnCount, int maxThreadCount,
+                        const Functor &f) {
+  executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, columnCount),
+                      [&f](const tbb::blocked_range<size_t> &r) {
+                        f(r.begin(), r.end());
+                      },
+                      tbb::static_partitioner());
+  });
+}
+
+/** \brief Resize \p mat to \p rowCount x \p columnCount and fill it with
+ *  zeros in the column blocks of forEachColumnBlock().
+ *
+ *  Armadillo does not initialise the memory of large matrices, so the
+ *  pages of \p mat are first touched by the threads that zero them. */
+template <typename ValueType>
+void firstTouchZeros(arma::Mat<ValueType> &mat, size_t rowCount,
+                     size_t columnCount, int maxThreadCount) {
+  mat.set_size(rowCount, columnCount);
+  forEachColumnBlock(columnCount, maxThreadCount,
+                     [&mat, rowCount](size_t first, size_t last) {
+                       std::fill(mat.colptr(first),
+                                 mat.colptr(first) + rowCount * (last - first),
+                                 static_cast<ValueType>(0.));
+                     });
+}
+
+} // namespace Fiber
+
+#endif
@@ -26,6 +26,11 @@
 #include "quadrature/galerkinduffy.hpp"
 #include "quadrature/quadrature.hpp"
 
+#include "shared_ptr.hpp"
+
+#include <map>
+#include <tbb/mutex.h>
+
 namespace Fiber {
 
 // Helper functions in anonymous namespace
@@ -242,27 +247,8 @@ inline void reallyFillPointsAndWeightsSingular(
   }
 }
 
-} // namespace
-
-// User-callable functions
-
 template <typename ValueType>
-void fillSingleQuadraturePointsAndWeights(int elementCornerCount,
-                                          int accuracyOrder,
-                                          arma::Mat<ValueType> &points,
-                                          std::vector<ValueType> &weights) {
-  if (elementCornerCount == 3)
-    reallyFillPointsAndWeightsRegular<TRIANGLE>(accuracyOrder, points, weights);
-  else if (elementCornerCount == 4)
-    return reallyFillPointsAndWeightsRegular<QUADRANGLE>(accuracyOrder, points,
-                                                         weights);
-  else
-    throw std::invalid_argument("fillSingleQuadraturePointsAndWeights(): "
-                                "elementCornerCount must be either 3 or 4");
-}
-
-template <typename ValueType>
-void fillDoubleSingularQuadraturePointsAndWeights(
+void computeDoubleSingularQuadraturePointsAndWeights(
     const DoubleQuadratureDescriptor &desc, arma::Mat<ValueType> &testPoints,
     arma::Mat<ValueType> &trialPoints, std::vector<ValueType> &weights) {
   const ElementPairTopology &topology = desc.topology;
@@ -278,7 +264,7 @@ void fillDoubleSingularQuadraturePointsAndWeights(
           desc, testPoints, trialPoints, weights);
     else
       throw std::invalid_argument(
-          "fillDoubleSingularQuadraturePointsAndWeights(): "
+          "computeDoubleSingularQuadraturePointsAndWeights(): "
           "Invalid element configuration");
   } else if (topology.testVertexCount == 4 && topology.trialVertexCount == 4) {
     if (topology.type == ElementPairTopology::SharedVertex)
@@ -292,15 +278,107 @@ void fillDoubleSingularQuadraturePointsAndWeights(
           desc, testPoints, trialPoints, weights);
     else
       throw std::invalid_argument(
-          "fillDoubleSingularQuadraturePointsAndWeights(): "
+          "computeDoubleSingularQuadraturePointsAndWeights(): "
           "Invalid element configuration");
   } else
     throw std::invalid_argument(
-        "fillDoubleSingularQuadraturePointsAndWeights(): "
+        "computeDoubleSingularQuadraturePointsAndWeights(): "
         "Singular quadrature rules for mixed "
         "meshes are not implemented yet.");
 }
 
+template <typename ValueType> struct DoubleSingularQuadratureRule {
+  arma::Mat<ValueType> testPoints, trialPoints;
+  std::vector<ValueType> weights;
+};
+
+} // namespace
+
+// User-callable functions
+
+template <typename ValueType>
+void fillSingleQuadraturePointsAndWeights(int elementCornerCount,
+                                          int accuracyOrder,
+                                          arma::Mat<ValueType> &points,
+                                          std::vector<ValueType> &weights) {
+  if (elementCornerCount == 3)
+    reallyFillPointsAndWeightsRegular<TRIANGLE>(accuracyOrder, points, weights);
+  else if (elementCornerCount == 4)
+    return reallyFillPointsAndWeightsRegular<QUADRANGLE>(accuracyOrder, points,
+                                                         weights);
+  else
+    throw std::invalid_argument("fillSingleQuadraturePointsAndWeights(): "
+                                "elementCornerCount must be either 3 or 4");
+}
+
+template <typename ValueType>
+void fillDoubleSingularQuadraturePointsAndWeights(
+    const DoubleQuadratureDescriptor &desc, arma::Mat<ValueType> &testPoints,
+    arma::Mat<ValueType> &trialPoints, std::vector<ValueType> &weights) {
+  typedef DoubleSingularQuadratureRule<ValueType> Rule;
+  typedef std::map<DoubleQuadratureDescriptor, shared_ptr<const Rule>> Cache;
+  static Cache cache;
+  static tbb::mutex mutex;
+
+  // The rules depend only on the topology and the larger of the two orders
+  DoubleQuadratureDescriptor key = desc;
+  key.testOrder = key.trialOrder = std::max(desc.testOrder, desc.trialOrder);
+  key.singlePrecisionKernels = false;
+
+  shared_ptr<const Rule> rule;
+  {
+    tbb::mutex::scoped_lock lock(mutex);
+    shared_ptr<const Rule> &cachedRule = cache[key];
+    if (!cachedRule) {
+      shared_ptr<Rule> newRule(new Rule);
+      computeDoubleSingularQuadraturePointsAndWeights(
+          key, newRule->testPoints, newRule->trialPoints, newRule->weights);
+      cachedRule = newRule;
+    }
+    rule = cachedRule;
+  }
+  testPoints = rule->testPoints;
+  trialPoints = rule->trialPoints;
+  weights = rule->weights;
+}
+
+template <typename ValueType>
+void fillGradedTriangleQuadraturePointsAndWeights(
+    int pointCountIn1d, arma::Mat<ValueType> &points,
+    std::vector<ValueType> &weights) {
+  const int elementDim = 2;
+  // Points on [0, 1]^2
+  const QuadratureRule<QUADRANGLE, GAUSS> rule(std::max(pointCountIn1d, 1));
+  const int rulePointCount = rule.getNumPoints();
+  const int subtriangleCount = 3;
+  const ValueType corners[subtriangleCount][elementDim] = {
+      {0., 0.}, {1., 0.}, {0., 1.}};
+  const ValueType centroid[elementDim] = {1. / 3., 1. / 3.};
+  // Twice the area of each subtriangle
+  const ValueType subtriangleJacobian = 1. / 3.;
+
+  points.set_size(elementDim, subtriangleCount * rulePointCount);
+  weights.resize(subtriangleCount * rulePointCount);
+  for (int t = 0; t < subtriangleCount; ++t) {
+    const ValueType *a = corners[t];
+    const ValueType *b = corners[(t + 1) % subtriangleCount];
+    for (int i = 0; i < rulePointCount; ++i) {
+      const Point2 point = rule.getPoint(i);
+      // s runs along the edge ab, u from the edge to the centroid; the
+      // substitution t = u^2 grades the points towards the edge
+      const ValueType s = point[0], u = point[1];
+      const ValueType tt = u * u;
+      const int col = t * rulePointCount + i;
+      for (int dim = 0; dim < elementDim; ++dim) {
+        const ValueType p = a[dim] + s * (b[dim] - a[dim]);
+        points(dim, col) = p + tt * (centroid[dim] - p);
+      }
+      weights[col] =
+          rule.getWeight(i) * 2. * u * (1. - tt) * subtriangleJacobian;
+    }
+  }
+}
+
 #ifdef ENABLE_SINGLE_PRECISION
 template void fillSingleQuadraturePointsAndWeights<float>(
     int elementCornerCount, int accuracyOrder, arma::Mat<float> &points,
@@ -308,6 +386,8 @@ template void fillSingleQuadraturePointsAndWeights<float>(
 template void fillDoubleSingularQuadraturePointsAndWeights<float>(
     const DoubleQuadratureDescriptor &desc, arma::Mat<float> &testPoints,
     arma::Mat<float> &trialPoints, std::vector<float> &weights);
+template void fillGradedTriangleQuadraturePointsAndWeights<float>(
+    int pointCountIn1d, arma::Mat<float> &points, std::vector<float> &weights);
 #endif
 #ifdef ENABLE_DOUBLE_PRECISION
 template void fillSingleQuadraturePointsAndWeights<double>(
@@ -316,6 +396,9 @@ template void fillSingleQuadraturePointsAndWeights<double>(
 template void fillDoubleSingularQuadraturePointsAndWeights<double>(
     const DoubleQuadratureDescriptor &desc, arma::Mat<double> &testPoints,
     arma::Mat<double> &trialPoints, std::vector<double> &weights);
+template void fillGradedTriangleQuadraturePointsAndWeights<double>(
+    int pointCountIn1d, arma::Mat<double> &points,
+    std::vector<double> &weights);
 #endif
 
 } // namespace Fiber
@@ -50,11 +50,48 @@ void fillSingleQuadraturePointsAndWeights(int elementCornerCount,
                                           arma::Mat<ValueType> &points,
                                           std::vector<ValueType> &weights);
 
+/** \brief Retrieve points and weights for a non-tensor-product quadrature
+ *  rule over a pair of elements sharing a vertex, an edge or the whole
+ *  element.
+ *
+ *  The rules are obtained by Duffy transformations (Sauter and Schwab,
+ *  "Boundary Element Methods", Springer 2011). Each rule is computed once
+ *  per element-pair topology (including the positions of the shared
+ *  vertices) and order and then kept in a process-wide, thread-safe cache.
+ *
+ *  \param[in] desc
+ *    Descriptor of the element pair and the quadrature orders.
+ *  \param[out] testPoints, trialPoints
+ *    Quadrature points on the test and trial element.
+ *  \param[out] weights
+ *    Quadrature weights. */
 template <typename ValueType>
 void fillDoubleSingularQuadraturePointsAndWeights(
     const DoubleQuadratureDescriptor &desc, arma::Mat<ValueType> &testPoints,
     arma::Mat<ValueType> &trialPoints, std::vector<ValueType> &weights);
 
+/** \brief Retrieve points and weights for a quadrature rule on the reference
+ *  triangle graded towards its edges.
+ *
+ *  The triangle is split into three subtriangles with a common apex at its
+ *  centroid. On each subtriangle a tensor-product Gauss rule is used, with
+ *  the coordinate running from the edge to the apex stretched quadratically,
+ *  so that the points cluster near the edges of the triangle. The rule is
+ *  suited to integrands with logarithmic singularities in their derivatives
+ *  on the edges, such as potentials of layers supported on the triangle or
+ *  on its neighbours.
+ *
+ *  \param[in] pointCountIn1d
+ *    Number of Gauss points in each direction of each subtriangle.
+ *  \param[out] points
+ *    Quadrature points (2 x 3 * pointCountIn1d^2).
+ *  \param[out] weights
+ *    Quadrature weights; they sum up to 1/2. */
+template <typename ValueType>
+void fillGradedTriangleQuadraturePointsAndWeights(
+    int pointCountIn1d, arma::Mat<ValueType> &points,
+    std::vector<ValueType> &weights);
+
 } // namespace Fiber
 
 #endif
@@ -32,6 +32,7 @@ namespace Fiber {
 template <typename BasisFunctionType> class QuadratureDescriptorSelectorFactory;
 template <typename CoordinateType> class DoubleQuadratureRuleFamily;
 template <typename CoordinateType> class SingleQuadratureRuleFamily;
+class SingularIntegralStore;
 
 /** \ingroup quadrature
  *  \brief Base class for NumericalQuadratureStrategy.
@@ -96,6 +97,17 @@ public:
       const shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType>> &
           doubleQuadratureRuleFamily);
 
+  /** \brief Keep the singular integrals of integral operators in an on-disk
+   *  store.
+   *
+   *  If \p store is not null, local assemblers for integral operators
+   *  created by this object look up their precalculated singular integrals
+   *  in \p store before calculating them, and put newly calculated ones
+   *  into it. This only has an effect if singular integral caching is
+   *  enabled. By default, no store is used. */
+  void setSingularIntegralStore(
+      const shared_ptr<const SingularIntegralStore> &store);
+
 public:
   virtual std::unique_ptr<LocalAssemblerForLocalOperators<ResultType>>
   makeAssemblerForIdentityOperators(
@@ -199,6 +211,7 @@ protected:
   singleQuadratureRuleFamily() const;
   shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType>>
   doubleQuadratureRuleFamily() const;
+  shared_ptr<const SingularIntegralStore> singularIntegralStore() const;
 
 private:
   shared_ptr<const QuadratureDescriptorSelectorFactory<BasisFunctionType>>
@@ -207,6 +220,7 @@ private:
   m_singleQuadratureRuleFamily;
   shared_ptr<const DoubleQuadratureRuleFamily<CoordinateType>>
   m_doubleQuadratureRuleFamily;
+  shared_ptr<const SingularIntegralStore> m_singularIntegralStore;
 };
 
 // Complex ResultType
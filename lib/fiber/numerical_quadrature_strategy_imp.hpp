@@ -58,6 +58,15 @@ NumericalQuadratureStrategyBase<BasisFunctionType, ResultType, GeometryFactory,
       m_singleQuadratureRuleFamily(singleQuadratureRuleFamily),
       m_doubleQuadratureRuleFamily(doubleQuadratureRuleFamily) {}
 
+template <typename BasisFunctionType, typename ResultType,
+          typename GeometryFactory, typename Enable>
+void NumericalQuadratureStrategyBase<BasisFunctionType, ResultType,
+                                     GeometryFactory, Enable>::
+    setSingularIntegralStore(
+        const shared_ptr<const SingularIntegralStore> &store) {
+  m_singularIntegralStore = store;
+}
+
 template <typename BasisFunctionType, typename ResultType,
           typename GeometryFactory, typename Enable>
 std::unique_ptr<LocalAssemblerForLocalOperators<ResultType>>
@@ -158,7 +167,8 @@ NumericalQuadratureStrategyBase<BasisFunctionType, ResultType, GeometryFactory,
               ->makeQuadratureDescriptorSelectorForIntegralOperators(
                     testRawGeometry, trialRawGeometry, testShapesets,
                     trialShapesets),
-          this->doubleQuadratureRuleFamily()));
+          this->doubleQuadratureRuleFamily(),
+          this->singularIntegralStore()));
 }
 
 template <typename BasisFunctionType, typename ResultType,
@@ -277,6 +287,14 @@ NumericalQuadratureStrategyBase<BasisFunctionType, ResultType, GeometryFactory,
   return m_doubleQuadratureRuleFamily;
 }
 
+template <typename BasisFunctionType, typename ResultType,
+          typename GeometryFactory, typename Enable>
+shared_ptr<const SingularIntegralStore>
+NumericalQuadratureStrategyBase<BasisFunctionType, ResultType, GeometryFactory,
+                                Enable>::singularIntegralStore() const {
+  return m_singularIntegralStore;
+}
+
 template <typename BasisFunctionType, typename ResultType,
           typename GeometryFactory, typename Enable>
 shared_ptr<
@@ -384,7 +402,8 @@ NumericalQuadratureStrategy<BasisFunctionType, ResultType, GeometryFactory,
               ->makeQuadratureDescriptorSelectorForIntegralOperators(
                     testRawGeometry, trialRawGeometry, testShapesets,
                     trialShapesets),
-          this->doubleQuadratureRuleFamily()));
+          this->doubleQuadratureRuleFamily(),
+          this->singularIntegralStore()));
 }
 
 template <typename BasisFunctionType, typename ResultType,
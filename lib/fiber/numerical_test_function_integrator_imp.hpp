@@ -34,9 +34,67 @@
 
 #include <stdexcept>
 #include <memory>
+#include <vector>
 
 namespace Fiber {
 
+namespace {
+
+// Join the data of types geomDeps of the elements [start, end) of geomData
+// into the single object result; all elements must have the same number of
+// points and contain integration elements
+template <typename CoordinateType>
+void concatenateGeometricalData(
+    const std::vector<GeometricalData<CoordinateType>> &geomData,
+    size_t start, size_t end, size_t geomDeps,
+    GeometricalData<CoordinateType> &result) {
+  const GeometricalData<CoordinateType> &first = geomData[start];
+  const size_t elementPointCount = first.integrationElements.n_elem;
+  const size_t pointCount = (end - start) * elementPointCount;
+  if (geomDeps & GLOBALS)
+    result.globals.set_size(first.globals.n_rows, pointCount);
+  if (geomDeps & NORMALS)
+    result.normals.set_size(first.normals.n_rows, pointCount);
+  if (geomDeps & INTEGRATION_ELEMENTS)
+    result.integrationElements.set_size(pointCount);
+  if (geomDeps & JACOBIANS_TRANSPOSED)
+    result.jacobiansTransposed.set_size(first.jacobiansTransposed.extent(0),
+                                        first.jacobiansTransposed.extent(1),
+                                        pointCount);
+  if (geomDeps & JACOBIAN_INVERSES_TRANSPOSED)
+    result.jacobianInversesTransposed.set_size(
+        first.jacobianInversesTransposed.extent(0),
+        first.jacobianInversesTransposed.extent(1), pointCount);
+  result.domainIndex = first.domainIndex;
+
+  for (size_t e = start; e < end; ++e) {
+    const GeometricalData<CoordinateType> &data = geomData[e];
+    const size_t offset = (e - start) * elementPointCount;
+    const size_t last = offset + elementPointCount - 1;
+    if (geomDeps & GLOBALS)
+      result.globals.cols(offset, last) = data.globals;
+    if (geomDeps & NORMALS)
+      result.normals.cols(offset, last) = data.normals;
+    if (geomDeps & INTEGRATION_ELEMENTS)
+      result.integrationElements.cols(offset, last) = data.integrationElements;
+    for (size_t point = 0; point < elementPointCount; ++point) {
+      if (geomDeps & JACOBIANS_TRANSPOSED)
+        for (size_t j = 0; j < data.jacobiansTransposed.extent(1); ++j)
+          for (size_t i = 0; i < data.jacobiansTransposed.extent(0); ++i)
+            result.jacobiansTransposed(i, j, offset + point) =
+                data.jacobiansTransposed(i, j, point);
+      if (geomDeps & JACOBIAN_INVERSES_TRANSPOSED)
+        for (size_t j = 0; j < data.jacobianInversesTransposed.extent(1); ++j)
+          for (size_t i = 0; i < data.jacobianInversesTransposed.extent(0);
+               ++i)
+            result.jacobianInversesTransposed(i, j, offset + point) =
+                data.jacobianInversesTransposed(i, j, point);
+    }
+  }
+}
+
+} // namespace
+
 template <typename BasisFunctionType, typename UserFunctionType,
           typename ResultType, typename GeometryFactory>
 NumericalTestFunctionIntegrator<BasisFunctionType, UserFunctionType, ResultType,
@@ -91,42 +149,68 @@ void NumericalTestFunctionIntegrator<
                              "must have the same number of components");
 
   BasisData<BasisFunctionType> testBasisData;
-  GeometricalData<CoordinateType> geomData;
 
   size_t testBasisDeps = 0;
   size_t geomDeps = INTEGRATION_ELEMENTS;
+  size_t functionGeomDeps = 0;
 
   m_testTransformations.addDependencies(testBasisDeps, geomDeps);
-  m_function.addGeometricalDependencies(geomDeps);
+  m_function.addGeometricalDependencies(functionGeomDeps);
+  geomDeps |= functionGeomDeps;
 
   typedef typename GeometryFactory::Geometry Geometry;
   std::unique_ptr<Geometry> geometry(m_geometryFactory.make());
 
   Fiber::CollectionOf3dArrays<BasisFunctionType> testValues;
-  arma::Mat<UserFunctionType> functionValues;
 
   result.set_size(testDofCount, elementCount);
 
   testShapeset.evaluate(testBasisDeps, m_localQuadPoints, ALL_DOFS,
                         testBasisData);
 
-  // Iterate over the elements
+  std::vector<GeometricalData<CoordinateType>> geomData(elementCount);
   for (size_t e = 0; e < elementCount; ++e) {
     const int elementIndex = elementIndices[e];
     m_rawGeometry.setupGeometry(elementIndex, *geometry);
-    geometry->getData(geomDeps, m_localQuadPoints, geomData);
-    if (geomDeps & DOMAIN_INDEX)
-      geomData.domainIndex = m_rawGeometry.domainIndex(elementIndex);
-    m_testTransformations.evaluate(testBasisData, geomData, testValues);
-    m_function.evaluate(geomData, functionValues);
+    geometry->getData(geomDeps, m_localQuadPoints, geomData[e]);
+    geomData[e].domainIndex = (geomDeps & DOMAIN_INDEX)
+                                  ? m_rawGeometry.domainIndex(elementIndex)
+                                  : 0;
+  }
+
+  // Evaluate the function at the quadrature points of all elements at once,
+  // so that functors with a batched interface are called as rarely as
+  // possible; only elements of different domains are kept apart
+  arma::Mat<UserFunctionType> functionValues(componentCount,
+                                             elementCount * pointCount);
+  {
+    GeometricalData<CoordinateType> batchGeomData;
+    arma::Mat<UserFunctionType> batchValues;
+    for (size_t start = 0, end = 0; start < elementCount; start = end) {
+      end = start + 1;
+      while (end < elementCount &&
+             geomData[end].domainIndex == geomData[start].domainIndex)
+        ++end;
+      concatenateGeometricalData(geomData, start, end, functionGeomDeps,
+                                 batchGeomData);
+      m_function.evaluate(batchGeomData, batchValues);
+      functionValues.cols(start * pointCount, end * pointCount - 1) =
+          batchValues;
+    }
+  }
+
+  // Iterate over the elements
+  for (size_t e = 0; e < elementCount; ++e) {
+    m_testTransformations.evaluate(testBasisData, geomData[e], testValues);
 
     for (int testDof = 0; testDof < testDofCount; ++testDof) {
       ResultType sum = 0.;
       for (size_t point = 0; point < pointCount; ++point)
         for (int dim = 0; dim < componentCount; ++dim)
-          sum += m_quadWeights[point] * geomData.integrationElements(point) *
+          sum += m_quadWeights[point] *
+                 geomData[e].integrationElements(point) *
                  conjugate(testValues[0](dim, testDof, point)) *
-                 functionValues(dim, point);
+                 functionValues(dim, e * pointCount + point);
       result(testDof, e) = sum;
     }
   }
@@ -42,6 +42,8 @@ OpenClHandler::OpenClHandler(const OpenClOptions &options) {
   cl_int err;
   useOpenCl = options.useOpenCl;
   nProgBuf = 0;
+  if (!useOpenCl)
+    return;
 
   std::vector<cl::Platform> platforms;
   cl::Platform::get(&platforms);
@@ -84,25 +86,24 @@ OpenClHandler::~OpenClHandler() {
 const std::pair<const char *, int> OpenClHandler::typedefStr() const {
   static const char *str = "#pragma OPENCL EXTENSION cl_khr_fp64 : "
                            "enable\ntypedef double ValueType;\n";
-  static int len = strlen(str);
+  static const int len = strlen(str);
   return std::make_pair(str, len);
 }
 
 const std::pair<const char *, int> OpenClHandler::initStr() const {
   CALLECHO();
 
-  static std::pair<char *, int> str;
-  static bool need_setup = true;
-
-  if (need_setup) {
+  // Initialised once, also if several threads create their kernels at the
+  // same time
+  static const std::pair<const char *, int> str = [this]() {
     std::pair<const char *, int> tdef = typedefStr();
-    str.first = new char[tdef.second + commontypes_h_len + 1];
-    strcpy(str.first, tdef.first);
-    strncpy(str.first + tdef.second, commontypes_h, commontypes_h_len);
-    str.first[tdef.second + commontypes_h_len] = '\0';
-    str.second = tdef.second + commontypes_h_len;
-    need_setup = false;
-  }
+    char *buffer = new char[tdef.second + commontypes_h_len + 1];
+    strcpy(buffer, tdef.first);
+    strncpy(buffer + tdef.second, commontypes_h, commontypes_h_len);
+    buffer[tdef.second + commontypes_h_len] = '\0';
+    return std::pair<const char *, int>(buffer,
+                                        tdef.second + commontypes_h_len);
+  }();
   return str;
 }
 
@@ -137,7 +138,6 @@ void OpenClHandler::loadProgramFromString(std::string strSource) {
             << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(devices[0])
             << std::endl;
 #endif
-  std::cout << "x11" << std::endl;
 }
 
 void OpenClHandler::loadProgramFromStringArray(cl::Program::Sources strSources)
@@ -342,6 +342,15 @@ void OpenClHandler::pullVector(const cl::Buffer &clbuf,
   queue.enqueueReadBuffer(clbuf, CL_TRUE, 0, bufsize, vecptr, NULL, &event);
 }
 
+template <typename BufferType>
+void OpenClHandler::pullBuffer(const cl::Buffer &clbuf, BufferType *buf,
+                               int size) const {
+  CALLECHO();
+
+  size_t bufsize = size * sizeof(BufferType);
+  queue.enqueueReadBuffer(clbuf, CL_TRUE, 0, bufsize, buf, NULL, &event);
+}
+
 template <typename BufferType>
 void OpenClHandler::pullCube(const cl::Buffer &clbuf,
                              arma::Cube<BufferType> &cube) const {
@@ -388,6 +397,10 @@ template void OpenClHandler::pullVector<double>(const cl::Buffer &clbuf,
                                                 int size) const;
 template void OpenClHandler::pullCube<double>(const cl::Buffer &clbuf,
                                               arma::Cube<double> &cube) const;
+template cl::Buffer *OpenClHandler::pushBuffer<double>(const double *buf,
+                                                       int size) const;
+template void OpenClHandler::pullBuffer<double>(const cl::Buffer &clbuf,
+                                                double *buf, int size) const;
 
 // Single-precision complex instantiations
 template cl::Buffer *
@@ -412,6 +425,10 @@ template void OpenClHandler::pullVector<std::complex<double>>(
     int size) const;
 template void OpenClHandler::pullCube<std::complex<double>>(
     const cl::Buffer &clbuf, arma::Cube<std::complex<double>> &cube) const;
+template cl::Buffer *OpenClHandler::pushBuffer<std::complex<double>>(
+    const std::complex<double> *buf, int size) const;
+template void OpenClHandler::pullBuffer<std::complex<double>>(
+    const cl::Buffer &clbuf, std::complex<double> *buf, int size) const;
 
 } // namespace Fiber
 
@@ -34,6 +34,7 @@
 
 #ifdef WITH_OPENCL
 #include "CL/cl.hpp"
+#include <tbb/mutex.h>
 #endif
 
 // TODO: rewrite the constructor of OpenClHandler.
@@ -167,6 +168,12 @@ public:
   void pullVector(const cl::Buffer &clbuf, std::vector<BufferType> &vec,
                   int size) const;
 
+  /**
+   * \brief Copy the first \p size elements of an OpenCL buffer to \p buf
+   */
+  template <typename BufferType>
+  void pullBuffer(const cl::Buffer &clbuf, BufferType *buf, int size) const;
+
   template <typename BufferType>
   void pullCube(const cl::Buffer &clbuf, arma::Cube<BufferType> &cube) const;
 
@@ -183,6 +190,15 @@ public:
 
   const MeshGeom &meshGeom() const { return meshgeom; }
 
+  /**
+   * \brief Mutex serialising access to the handler.
+   *
+   * The handler stores the current program and kernel, so a sequence of
+   * calls from loadProgramFromStringArray() to the last pullVector() must
+   * not be interleaved with calls made by other threads.
+   */
+  tbb::mutex &mutex() const { return m_mutex; }
+
 private:
   const std::pair<const char *, int> typedefStr() const;
 
@@ -199,6 +215,8 @@ private:
 
   mutable const char **progBuf;
   mutable int nProgBuf;
+
+  mutable tbb::mutex m_mutex;
 };
 
 #else
@@ -0,0 +1,146 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_opencl.hpp"
+
+#include "opencl_potential_evaluator.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+#ifdef WITH_OPENCL
+#include "CL/modified_helmholtz_3d_potential.cl.str"
+#endif
+
+#include <algorithm>
+#include <armadillo>
+#include <stdexcept>
+
+namespace Fiber {
+
+OpenClPotentialEvaluator::OpenClPotentialEvaluator(
+    const shared_ptr<const OpenClHandler> &openClHandler, KernelTileType type,
+    std::complex<double> waveNumber, const arma::Mat<double> &quadPoints,
+    const arma::Mat<double> &quadNormals,
+    const std::vector<std::complex<double>> &weightedDensities)
+    : m_openClHandler(openClHandler), m_type(type), m_waveNumber(waveNumber),
+      m_quadPointCount(static_cast<int>(weightedDensities.size()))
+#ifdef WITH_OPENCL
+      ,
+      m_clQuadPoints(0), m_clQuadNormals(0), m_clDensities(0)
+#endif
+{
+  if (!m_openClHandler)
+    throw std::invalid_argument("OpenClPotentialEvaluator::"
+                                "OpenClPotentialEvaluator(): "
+                                "null OpenCL handler");
+  if (type != SINGLE_LAYER_TILE && type != DOUBLE_LAYER_TILE)
+    throw std::invalid_argument("OpenClPotentialEvaluator::"
+                                "OpenClPotentialEvaluator(): "
+                                "unsupported kernel type");
+  if (quadPoints.n_rows != 3 || quadPoints.n_cols != weightedDensities.size())
+    throw std::invalid_argument("OpenClPotentialEvaluator::"
+                                "OpenClPotentialEvaluator(): "
+                                "incompatible quadrature point array");
+  if (type == DOUBLE_LAYER_TILE && (quadNormals.n_rows != 3 ||
+                                    quadNormals.n_cols != quadPoints.n_cols))
+    throw std::invalid_argument("OpenClPotentialEvaluator::"
+                                "OpenClPotentialEvaluator(): "
+                                "incompatible normal array");
+#ifdef WITH_OPENCL
+  if (!isOnDevice() || m_quadPointCount == 0)
+    return;
+  tbb::mutex::scoped_lock lock(m_openClHandler->mutex());
+  m_clQuadPoints = m_openClHandler->pushBuffer<double>(quadPoints.memptr(),
+                                                       quadPoints.n_elem);
+  // The kernel does not read the normals of the single layer, but OpenCL
+  // does not accept a null buffer argument
+  const arma::Mat<double> &normals =
+      type == DOUBLE_LAYER_TILE ? quadNormals : quadPoints;
+  m_clQuadNormals =
+      m_openClHandler->pushBuffer<double>(normals.memptr(), normals.n_elem);
+  m_clDensities = m_openClHandler->pushBuffer<std::complex<double>>(
+      &weightedDensities[0], m_quadPointCount);
+#endif
+}
+
+OpenClPotentialEvaluator::~OpenClPotentialEvaluator() {
+#ifdef WITH_OPENCL
+  delete m_clDensities;
+  delete m_clQuadNormals;
+  delete m_clQuadPoints;
+#endif
+}
+
+bool OpenClPotentialEvaluator::isOnDevice() const {
+  return m_openClHandler->UseOpenCl();
+}
+
+void OpenClPotentialEvaluator::evaluate(const double *points,
+                                        size_t pointCount,
+                                        std::complex<double> *result) const {
+  if (!isOnDevice())
+    throw std::runtime_error("OpenClPotentialEvaluator::evaluate(): "
+                             "OpenCL is not in use");
+  if (pointCount == 0)
+    return;
+  if (m_quadPointCount == 0) {
+    std::fill(result, result + pointCount, std::complex<double>(0.));
+    return;
+  }
+#ifdef WITH_OPENCL
+  const OpenClHandler &handler = *m_openClHandler;
+  tbb::mutex::scoped_lock lock(handler.mutex());
+
+  cl::Program::Sources sources;
+  sources.push_back(handler.initStr());
+  sources.push_back(std::make_pair(modified_helmholtz_3d_potential_cl,
+                                   modified_helmholtz_3d_potential_cl_len));
+  handler.loadProgramFromStringArray(sources);
+  cl::Kernel &clKernel = handler.setKernel("clModifiedHelmholtz3dPotential");
+
+  const size_t batchSize = std::min<size_t>(POINT_BATCH_SIZE, pointCount);
+  cl::Buffer *clResult = handler.createBuffer<std::complex<double>>(
+      batchSize, CL_MEM_WRITE_ONLY);
+  for (size_t start = 0; start < pointCount; start += batchSize) {
+    const int count =
+        static_cast<int>(std::min(batchSize, pointCount - start));
+    cl::Buffer *clPoints =
+        handler.pushBuffer<double>(points + 3 * start, 3 * count);
+    int argIdx = 0;
+    clKernel.setArg(argIdx++, int(m_type));
+    clKernel.setArg(argIdx++, m_waveNumber.real());
+    clKernel.setArg(argIdx++, m_waveNumber.imag());
+    clKernel.setArg(argIdx++, m_quadPointCount);
+    clKernel.setArg(argIdx++, *m_clQuadPoints);
+    clKernel.setArg(argIdx++, *m_clQuadNormals);
+    clKernel.setArg(argIdx++, *m_clDensities);
+    clKernel.setArg(argIdx++, count);
+    clKernel.setArg(argIdx++, *clPoints);
+    clKernel.setArg(argIdx++, *clResult);
+    handler.enqueueKernel(cl::NDRange(count));
+    handler.pullBuffer<std::complex<double>>(*clResult, result + start,
+                                             count);
+    delete clPoints;
+  }
+  delete clResult;
+#endif
+}
+
+} // namespace Fiber
@@ -0,0 +1,101 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_opencl.hpp"
+
+#ifndef fiber_opencl_potential_evaluator_hpp
+#define fiber_opencl_potential_evaluator_hpp
+
+#include "../common/common.hpp"
+
+#include "kernel_tile_type.hpp"
+#include "opencl_handler.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <complex>
+#include <vector>
+
+namespace Fiber {
+
+/** \brief Far-field evaluation of Laplace and modified Helmholtz single-
+ *  and double-layer potentials on an OpenCL device.
+ *
+ *  The trial quadrature points, their normals and the densities multiplied
+ *  by the quadrature weights are uploaded once, on construction. evaluate()
+ *  then streams the evaluation points to the device in batches and sums
+ *  the kernel times the weighted density over all quadrature points, one
+ *  point per work item. Near-field corrections are left to the caller.
+ *
+ *  The device computes in double precision. If BEM++ has been compiled
+ *  without OpenCL support or the handler does not use OpenCL, isOnDevice()
+ *  returns false and evaluate() must not be called. */
+class OpenClPotentialEvaluator {
+public:
+  /** \brief Constructor.
+   *
+   *  \param[in] openClHandler Handler of the device.
+   *  \param[in] type Kernel; SINGLE_LAYER_TILE or DOUBLE_LAYER_TILE.
+   *  \param[in] waveNumber Wave number k of the kernel exp(-k r) / (4 pi r);
+   *    0 for the Laplace kernel.
+   *  \param[in] quadPoints Trial quadrature points (3 x n).
+   *  \param[in] quadNormals Unit normals at the trial quadrature points
+   *    (3 x n); only used by the double layer.
+   *  \param[in] weightedDensities Density values multiplied by the
+   *    quadrature weights and integration elements (n). */
+  OpenClPotentialEvaluator(
+      const shared_ptr<const OpenClHandler> &openClHandler,
+      KernelTileType type, std::complex<double> waveNumber,
+      const arma::Mat<double> &quadPoints,
+      const arma::Mat<double> &quadNormals,
+      const std::vector<std::complex<double>> &weightedDensities);
+
+  ~OpenClPotentialEvaluator();
+
+  OpenClPotentialEvaluator(const OpenClPotentialEvaluator &) = delete;
+  OpenClPotentialEvaluator &
+  operator=(const OpenClPotentialEvaluator &) = delete;
+
+  bool isOnDevice() const;
+
+  /** \brief Evaluate the potential at the \p pointCount points stored
+   *  column by column in \p points (3 x pointCount) and store the values
+   *  in \p result. */
+  void evaluate(const double *points, size_t pointCount,
+                std::complex<double> *result) const;
+
+private:
+  // Number of points transferred to the device at a time
+  enum { POINT_BATCH_SIZE = 65536 };
+
+  shared_ptr<const OpenClHandler> m_openClHandler;
+  KernelTileType m_type;
+  std::complex<double> m_waveNumber;
+  int m_quadPointCount;
+#ifdef WITH_OPENCL
+  cl::Buffer *m_clQuadPoints;
+  cl::Buffer *m_clQuadNormals;
+  cl::Buffer *m_clDensities;
+#endif
+};
+
+} // namespace Fiber
+
+#endif
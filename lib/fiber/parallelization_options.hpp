@@ -37,7 +37,10 @@ public:
   /** \brief Constructor. */
   ParallelizationOptions();
 
-  /** \brief Enable GPU-based calculations (currently broken). */
+  /** \brief Enable GPU-based calculations.
+   *
+   *  Only regular integrals of selected kernels are evaluated on the GPU,
+   *  see SeparableNumericalTestKernelTrialIntegrator. */
   void enableOpenCl(const OpenClOptions &openClOptions);
   /** \brief Disable GPU-based calculations. */
   void disableOpenCl();
@@ -0,0 +1,364 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "profiler.hpp"
+
+#include "hardware_counters.hpp"
+#include "shared_ptr.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/mutex.h>
+#include <tbb/tick_count.h>
+
+namespace Fiber {
+
+namespace {
+
+const char *counterName(int counter) {
+  static const char *names[ProfileCounter::COUNTER_COUNT] = {
+      "integrals", "kernelEvaluations", "cacheHits"};
+  return names[counter];
+}
+
+struct ProfileEvent {
+  const char *name;
+  double start; // seconds since the epoch of the profiler
+  double end;   // negative while the region is open
+  int parent;   // index of the enclosing event, -1 if none
+  // Index of the hardware counter values of the event, -1 if none
+  int hardwareIndex;
+};
+
+struct HardwareCounts {
+  uint64_t values[HardwareCounter::COUNTER_COUNT];
+};
+
+struct ThreadProfile {
+  ThreadProfile();
+
+  int threadIndex;
+  std::vector<ProfileEvent> events;
+  std::vector<int> openEvents;
+  std::size_t counters[ProfileCounter::COUNTER_COUNT];
+  // Opened by the first region recording hardware counters on the thread
+  shared_ptr<HardwareCounters> hardwareCounters;
+  // Values at the start of open events, increments over closed ones
+  std::vector<HardwareCounts> hardwareCounts;
+};
+
+struct ProfilerState {
+  ProfilerState() : epoch(tbb::tick_count::now()) {
+    threadCount = 0;
+    hardwareCounterMask = 0;
+  }
+
+  double now() const { return (tbb::tick_count::now() - epoch).seconds(); }
+
+  tbb::tick_count epoch;
+  tbb::atomic<int> threadCount;
+  tbb::enumerable_thread_specific<ThreadProfile> threads;
+  // Copies of the names of regions passed as std::string
+  std::set<std::string> names;
+  tbb::mutex namesMutex;
+  // Name of the file written at exit, set from BEMPP_PROFILE
+  std::string traceFileName;
+  // Hardware counters available on this machine
+  tbb::atomic<unsigned> hardwareCounterMask;
+};
+
+// Never destroyed, so that it can still be used by the exit handler
+ProfilerState &state() {
+  static ProfilerState *state = new ProfilerState;
+  return *state;
+}
+
+ThreadProfile::ThreadProfile() : threadIndex(state().threadCount++) {
+  std::fill(counters, counters + ProfileCounter::COUNTER_COUNT, 0);
+}
+
+void writeJsonString(std::ostream &os, const char *s) {
+  os << '"';
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      os << '\\' << *s;
+    else if (static_cast<unsigned char>(*s) < 0x20)
+      os << ' ';
+    else
+      os << *s;
+  }
+  os << '"';
+}
+
+// Write the hardware counters in values that are available, preceded by
+// separator
+void writeHardwareCounts(std::ostream &os, const uint64_t *values,
+                         unsigned mask, const char *separator) {
+  for (int c = 0; c < HardwareCounter::COUNTER_COUNT; ++c)
+    if (mask & (1u << c)) {
+      os << separator << '"' << HardwareCounter::name(c)
+         << "\": " << values[c];
+      separator = ", ";
+    }
+}
+
+void writeTraceAtExit() {
+  std::ofstream file(state().traceFileName.c_str());
+  if (file)
+    Profiler::writeChromeTrace(file);
+}
+
+} // namespace
+
+tbb::atomic<bool> Profiler::s_enabled;
+tbb::atomic<bool> Profiler::s_hardwareCountersEnabled;
+
+namespace {
+
+// Enables the profiler during static initialization of the library if
+// BEMPP_PROFILE is set
+struct EnvironmentInitializer {
+  EnvironmentInitializer() {
+    const char *fileName = std::getenv("BEMPP_PROFILE");
+    if (!fileName || !*fileName)
+      return;
+    state().traceFileName = fileName;
+    std::atexit(writeTraceAtExit);
+    const char *counters = std::getenv("BEMPP_PROFILE_COUNTERS");
+    if (counters && std::string(counters) == "1")
+      Profiler::enableHardwareCounters();
+    Profiler::enable();
+  }
+} s_environmentInitializer;
+
+} // namespace
+
+void Profiler::enable(bool enable) {
+  state(); // start the clock before the first region
+  s_enabled = enable;
+}
+
+void Profiler::enableHardwareCounters(bool enable) {
+  s_hardwareCountersEnabled = enable;
+}
+
+void Profiler::reset() {
+  ProfilerState &st = state();
+  for (tbb::enumerable_thread_specific<ThreadProfile>::iterator it =
+           st.threads.begin();
+       it != st.threads.end(); ++it) {
+    it->events.clear();
+    it->openEvents.clear();
+    it->hardwareCounts.clear();
+    std::fill(it->counters, it->counters + ProfileCounter::COUNTER_COUNT, 0);
+  }
+  st.epoch = tbb::tick_count::now();
+}
+
+void Profiler::beginRegion(const char *name) {
+  ProfilerState &st = state();
+  ThreadProfile &thread = st.threads.local();
+  ProfileEvent event;
+  event.name = name;
+  event.start = st.now();
+  event.end = -1.;
+  event.parent = thread.openEvents.empty() ? -1 : thread.openEvents.back();
+  event.hardwareIndex = -1;
+  if (s_hardwareCountersEnabled) {
+    if (!thread.hardwareCounters) {
+      thread.hardwareCounters.reset(new HardwareCounters);
+      st.hardwareCounterMask = thread.hardwareCounters->availabilityMask();
+    }
+    event.hardwareIndex = thread.hardwareCounts.size();
+    thread.hardwareCounts.push_back(HardwareCounts());
+  }
+  thread.openEvents.push_back(thread.events.size());
+  thread.events.push_back(event);
+  // Read last, so that the bookkeeping above is not counted
+  if (event.hardwareIndex >= 0)
+    thread.hardwareCounters->read(
+        thread.hardwareCounts[event.hardwareIndex].values);
+}
+
+void Profiler::beginRegion(const std::string &name) {
+  ProfilerState &st = state();
+  const char *storedName;
+  {
+    tbb::mutex::scoped_lock lock(st.namesMutex);
+    storedName = st.names.insert(name).first->c_str();
+  }
+  beginRegion(storedName);
+}
+
+void Profiler::endRegion() {
+  ProfilerState &st = state();
+  ThreadProfile &thread = st.threads.local();
+  // The region may have been discarded by reset()
+  if (thread.openEvents.empty())
+    return;
+  ProfileEvent &event = thread.events[thread.openEvents.back()];
+  if (event.hardwareIndex >= 0) {
+    uint64_t now[HardwareCounter::COUNTER_COUNT];
+    thread.hardwareCounters->read(now);
+    uint64_t *values = thread.hardwareCounts[event.hardwareIndex].values;
+    for (int c = 0; c < HardwareCounter::COUNTER_COUNT; ++c)
+      values[c] = now[c] - values[c];
+  }
+  event.end = st.now();
+  thread.openEvents.pop_back();
+}
+
+void Profiler::addCountImpl(ProfileCounter::Type counter, std::size_t n) {
+  state().threads.local().counters[counter] += n;
+}
+
+void Profiler::writeChromeTrace(std::ostream &os) {
+  ProfilerState &st = state();
+  const double now = st.now();
+  bool first = true;
+  os << "{\"traceEvents\": [";
+  for (tbb::enumerable_thread_specific<ThreadProfile>::const_iterator it =
+           st.threads.begin();
+       it != st.threads.end(); ++it) {
+    for (std::size_t i = 0; i < it->events.size(); ++i) {
+      const ProfileEvent &event = it->events[i];
+      const double end = event.end < 0 ? now : event.end;
+      os << (first ? "" : ",") << "\n  {\"name\": ";
+      writeJsonString(os, event.name);
+      os << ", \"ph\": \"X\", \"pid\": 0, \"tid\": " << it->threadIndex
+         << ", \"ts\": " << 1e6 * event.start
+         << ", \"dur\": " << 1e6 * (end - event.start);
+      if (event.hardwareIndex >= 0 && event.end >= 0) {
+        os << ", \"args\": {";
+        writeHardwareCounts(os, it->hardwareCounts[event.hardwareIndex].values,
+                            st.hardwareCounterMask, "");
+        os << "}";
+      }
+      os << "}";
+      first = false;
+    }
+    os << (first ? "" : ",") << "\n  {\"name\": \"counters\", \"ph\": \"C\", "
+       << "\"pid\": 0, \"tid\": " << it->threadIndex
+       << ", \"ts\": " << 1e6 * now << ", \"args\": {";
+    for (int c = 0; c < ProfileCounter::COUNTER_COUNT; ++c)
+      os << (c > 0 ? ", " : "") << '"' << counterName(c)
+         << "\": " << it->counters[c];
+    os << "}}";
+    first = false;
+  }
+  os << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+void Profiler::writeJson(std::ostream &os) {
+  struct RegionTotals {
+    RegionTotals() : calls(0), time(0), childTime(0), hardwareTime(0) {
+      std::fill(hardware, hardware + HardwareCounter::COUNTER_COUNT, 0);
+    }
+    std::size_t calls;
+    double time;
+    double childTime;
+    // Totals over the calls that recorded hardware counters
+    uint64_t hardware[HardwareCounter::COUNTER_COUNT];
+    double hardwareTime;
+  };
+
+  ProfilerState &st = state();
+  const double now = st.now();
+  std::map<std::string, RegionTotals> regions;
+  std::size_t totals[ProfileCounter::COUNTER_COUNT] = {};
+  for (tbb::enumerable_thread_specific<ThreadProfile>::const_iterator it =
+           st.threads.begin();
+       it != st.threads.end(); ++it) {
+    // Parents precede their children, so their paths are already known
+    std::vector<std::string> paths(it->events.size());
+    for (std::size_t i = 0; i < it->events.size(); ++i) {
+      const ProfileEvent &event = it->events[i];
+      const double time = (event.end < 0 ? now : event.end) - event.start;
+      if (event.parent >= 0) {
+        paths[i] = paths[event.parent] + "/" + event.name;
+        regions[paths[event.parent]].childTime += time;
+      } else
+        paths[i] = event.name;
+      RegionTotals &totalsOfPath = regions[paths[i]];
+      ++totalsOfPath.calls;
+      totalsOfPath.time += time;
+      if (event.hardwareIndex >= 0 && event.end >= 0) {
+        const uint64_t *values = it->hardwareCounts[event.hardwareIndex].values;
+        for (int c = 0; c < HardwareCounter::COUNTER_COUNT; ++c)
+          totalsOfPath.hardware[c] += values[c];
+        totalsOfPath.hardwareTime += time;
+      }
+    }
+    for (int c = 0; c < ProfileCounter::COUNTER_COUNT; ++c)
+      totals[c] += it->counters[c];
+  }
+
+  os << "{\n  \"regions\": [";
+  for (std::map<std::string, RegionTotals>::const_iterator it =
+           regions.begin();
+       it != regions.end(); ++it) {
+    os << (it == regions.begin() ? "" : ",") << "\n    {\"path\": ";
+    writeJsonString(os, it->first.c_str());
+    os << ", \"calls\": " << it->second.calls
+       << ", \"time\": " << it->second.time << ", \"selfTime\": "
+       << std::max(0., it->second.time - it->second.childTime);
+    const unsigned mask = st.hardwareCounterMask;
+    if (it->second.hardwareTime > 0. && mask) {
+      const HardwareCounterRates rates(it->second.hardware, mask,
+                                       it->second.hardwareTime);
+      os << ", \"hardwareCounters\": {";
+      writeHardwareCounts(os, it->second.hardware, mask, "");
+      const char *rateNames[] = {"instructionsPerCycle",
+                                 "stalledCycleFraction", "bandwidth",
+                                 "flopRate", "arithmeticIntensity"};
+      const double rateValues[] = {
+          rates.instructionsPerCycle, rates.stalledCycleFraction,
+          rates.bandwidth, rates.flopRate, rates.arithmeticIntensity};
+      for (int r = 0; r < 5; ++r)
+        if (rateValues[r] >= 0.)
+          os << ", \"" << rateNames[r] << "\": " << rateValues[r];
+      os << "}";
+    }
+    os << "}";
+  }
+  os << "\n  ],\n  \"threads\": [";
+  for (tbb::enumerable_thread_specific<ThreadProfile>::const_iterator it =
+           st.threads.begin();
+       it != st.threads.end(); ++it) {
+    os << (it == st.threads.begin() ? "" : ",")
+       << "\n    {\"thread\": " << it->threadIndex;
+    for (int c = 0; c < ProfileCounter::COUNTER_COUNT; ++c)
+      os << ", \"" << counterName(c) << "\": " << it->counters[c];
+    os << "}";
+  }
+  os << "\n  ],\n  \"counters\": {";
+  for (int c = 0; c < ProfileCounter::COUNTER_COUNT; ++c)
+    os << (c > 0 ? ", " : "") << '"' << counterName(c) << "\": " << totals[c];
+  os << "}\n}\n";
+}
+
+} // namespace Fiber
@@ -0,0 +1,166 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_profiler_hpp
+#define fiber_profiler_hpp
+
+#include "../common/common.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include <tbb/atomic.h>
+
+namespace Fiber {
+
+/** \ingroup fiber
+ *  \brief Counters recorded by the Profiler for each thread. */
+struct ProfileCounter {
+  enum Type {
+    /** \brief Local weak forms (element-pair integrals) computed by
+     *  integrators. */
+    INTEGRALS,
+    /** \brief Kernel values evaluated at pairs of points. */
+    KERNEL_EVALUATIONS,
+    /** \brief Local weak forms found in a cache instead of being
+     *  integrated. */
+    CACHE_HITS,
+    COUNTER_COUNT
+  };
+};
+
+/** \ingroup fiber
+ *  \brief Low-overhead profiler of named, nested regions of code.
+
+  The profiler is compiled in, but disabled by default; while it is disabled,
+  ProfileRegion and addCount() cost a single atomic load. It is enabled
+  either by enable() or by setting the environment variable BEMPP_PROFILE to
+  the name of a file, to which a Chrome trace (see writeChromeTrace()) is
+  written at program exit.
+
+  Optionally, the regions also record the hardware counters (see
+  HardwareCounters) of their thread: cycles, instructions, stalled cycles,
+  last-level cache misses and, where configured, floating-point operations.
+  This is switched on by enableHardwareCounters() or by setting
+  BEMPP_PROFILE_COUNTERS to 1, and costs a few system calls per region.
+
+  Regions and counters are recorded in separate buffers for each thread.
+  A region is nested in the innermost region open on the same thread; the
+  regions of TBB tasks spawned within a region thus appear as top-level
+  regions of the threads running the tasks. */
+class Profiler {
+public:
+  /** \brief Enable or disable recording. Recorded data are kept. */
+  static void enable(bool enable = true);
+
+  /** \brief Return true if recording is enabled. */
+  static bool isEnabled() { return s_enabled; }
+
+  /** \brief Enable or disable recording of hardware counters by the regions
+   *  opened afterwards. */
+  static void enableHardwareCounters(bool enable = true);
+
+  /** \brief Return true if regions record hardware counters. */
+  static bool hardwareCountersEnabled() { return s_hardwareCountersEnabled; }
+
+  /** \brief Discard all recorded regions and counters, and restart the
+   *  clock. Must not be called while other threads are recording. */
+  static void reset();
+
+  /** \brief Add \p n to a counter of the calling thread. */
+  static void addCount(ProfileCounter::Type counter, std::size_t n = 1) {
+    if (s_enabled)
+      addCountImpl(counter, n);
+  }
+
+  /** \brief Write all recorded regions and counters in the Chrome trace
+   *  event format (viewable in chrome://tracing or Perfetto).
+   *
+   *  This function and writeJson() should be called while no other thread
+   *  is recording. */
+  static void writeChromeTrace(std::ostream &os);
+
+  /** \brief Write a JSON summary: call count, total and self time of each
+   *  region, identified by its path of enclosing regions, aggregated over
+   *  all threads, followed by the counters of each thread.
+   *
+   *  Regions that recorded hardware counters also list their totals and the
+   *  derived rates placing the region in a roofline model: instructions per
+   *  cycle, fraction of stalled cycles, memory bandwidth (one cache line of
+   *  64 bytes per cache miss), floating-point rate and arithmetic intensity
+   *  (operations per byte transferred from memory). */
+  static void writeJson(std::ostream &os);
+
+  /** \cond HIDDEN_INTERNAL */
+  static void beginRegion(const char *name);
+  static void beginRegion(const std::string &name);
+  static void endRegion();
+  /** \endcond */
+
+private:
+  static void addCountImpl(ProfileCounter::Type counter, std::size_t n);
+
+  static tbb::atomic<bool> s_enabled;
+  static tbb::atomic<bool> s_hardwareCountersEnabled;
+};
+
+/** \ingroup fiber
+ *  \brief Region of code recorded by the Profiler from construction to
+ *  destruction.
+
+  \code
+  {
+    ProfileRegion region("HMatrix assembly");
+    ...
+  }
+  \endcode */
+class ProfileRegion {
+public:
+  /** \brief Constructor. \p name must remain valid until program exit,
+   *  e.g. be a string literal. */
+  explicit ProfileRegion(const char *name)
+      : m_active(Profiler::isEnabled()) {
+    if (m_active)
+      Profiler::beginRegion(name);
+  }
+
+  /** \brief Constructor. \p name is copied. */
+  explicit ProfileRegion(const std::string &name)
+      : m_active(Profiler::isEnabled()) {
+    if (m_active)
+      Profiler::beginRegion(name);
+  }
+
+  ~ProfileRegion() {
+    if (m_active)
+      Profiler::endRegion();
+  }
+
+private:
+  ProfileRegion(const ProfileRegion &);
+  ProfileRegion &operator=(const ProfileRegion &);
+
+  bool m_active;
+};
+
+} // namespace Fiber
+
+#endif
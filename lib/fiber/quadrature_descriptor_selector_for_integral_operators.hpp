@@ -53,6 +53,54 @@ public:
   virtual DoubleQuadratureDescriptor
   quadratureDescriptor(int testElementIndex, int trialElementIndex,
                        CoordinateType nominalDistance) const = 0;
+
+  /** \brief Return the descriptor of the quadrature rule to be used for
+   *  the pairs of elements of a block known to be separated.
+   *
+   *  The assemblers call this function instead of quadratureDescriptor()
+   *  for pairs of elements belonging to clusters whose bounding boxes are
+   *  \p nominalDistance > 0 apart, e.g. in the admissible blocks of
+   *  H-matrices. Such elements share no vertices, so their topology need
+   *  not be determined. The returned descriptor is reused for all pairs of
+   *  the block whose test and trial elements have the same shapesets as
+   *  the specified ones; it must therefore not depend on any other
+   *  property of the elements.
+   *
+   *  The default implementation returns quadratureDescriptor() for the
+   *  pair. */
+  virtual DoubleQuadratureDescriptor
+  blockQuadratureDescriptor(int testElementIndex, int trialElementIndex,
+                            CoordinateType nominalDistance) const {
+    return quadratureDescriptor(testElementIndex, trialElementIndex,
+                                nominalDistance);
+  }
+
+  /** \brief Return true if kernels offering a splitting into a singular
+   *  and a bounded part (see CollectionOfKernels::singularPart()) should be
+   *  split in the integrals over singular pairs of elements.
+   *
+   *  The default implementation returns false. */
+  virtual bool splitsSingularKernels() const { return false; }
+
+  /** \brief Return the descriptor of the regular quadrature rule used to
+   *  integrate the bounded part of a split kernel over a pair of elements
+   *  sharing a vertex, an edge or the whole element.
+   *
+   *  The default implementation uses the orders chosen by
+   *  quadratureDescriptor() for the pair. */
+  virtual DoubleQuadratureDescriptor
+  smoothPartQuadratureDescriptor(int testElementIndex,
+                                 int trialElementIndex) const {
+    DoubleQuadratureDescriptor desc =
+        quadratureDescriptor(testElementIndex, trialElementIndex, -1.);
+    const int testVertexCount = desc.topology.testVertexCount;
+    const int trialVertexCount = desc.topology.trialVertexCount;
+    desc.topology = ElementPairTopology();
+    desc.topology.testVertexCount = testVertexCount;
+    desc.topology.trialVertexCount = trialVertexCount;
+    desc.semiAnalytic = false;
+    return desc;
+  }
 };
 
 } // namespace Fiber
@@ -27,6 +27,8 @@
 #include "scalar_traits.hpp"
 #include "single_quadrature_descriptor.hpp"
 
+#include <limits>
+
 namespace Fiber {
 
 template <typename BasisFunctionType> class Shapeset;
@@ -75,6 +77,18 @@ public:
   virtual SingleQuadratureDescriptor
   farFieldQuadratureDescriptor(const Shapeset<BasisFunctionType> &trialShapeset,
                                int trialElementCornerCount) const = 0;
+
+  /** \brief Return the distance from an element beyond which
+   *  quadratureDescriptor() always returns the far-field descriptor.
+   *
+   *  Evaluators of potentials use this distance to find the elements whose
+   *  contributions at a given point require a quadrature rule other than
+   *  the far-field one. If it is 0, the far-field rules are used
+   *  everywhere. The default implementation returns infinity, so that all
+   *  elements are considered. */
+  virtual CoordinateType nearFieldDistance() const {
+    return std::numeric_limits<CoordinateType>::infinity();
+  }
 };
 
 } // namespace Fiber
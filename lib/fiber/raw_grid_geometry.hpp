@@ -25,6 +25,9 @@
 
 #include "../common/armadillo_fwd.hpp"
 
+#include <cmath>
+#include <tbb/parallel_for.h>
+
 namespace Fiber {
 
 template <typename CoordinateType> class RawGridGeometry {
@@ -75,6 +78,88 @@ public:
     return m_domainIndices[elementIndex];
   }
 
+  /** \brief Jacobians of the elements.
+
+    Column \p e contains the (worldDimension() x gridDimension()) Jacobian
+    of the map from the reference element to element \p e, evaluated at the
+    element centre and stored in column-major order. Empty unless
+    computeElementGeometry() has been called. */
+  const arma::Mat<CoordinateType> &jacobians() const { return m_jacobians; }
+
+  /** \brief Integration elements of the elements, evaluated at their
+   *  centres. Empty unless computeElementGeometry() has been called. */
+  const std::vector<CoordinateType> &integrationElements() const {
+    return m_integrationElements;
+  }
+
+  /** \brief Unit normals of the elements, evaluated at their centres.
+
+    Column \p e contains the normal to element \p e. Empty unless
+    computeElementGeometry() has been called and gridDimension() is
+    worldDimension() - 1. */
+  const arma::Mat<CoordinateType> &normals() const { return m_normals; }
+
+  /** \brief Precompute the Jacobians, integration elements and normals of
+    all elements.
+
+    The vertices and element corner indices must already be set up. The
+    values are exact for segments and triangles; for quadrilaterals they
+    refer to the element centre. Elements are processed in parallel. */
+  void computeElementGeometry() {
+    const int elementCount = this->elementCount();
+    const bool hasNormals = (m_gridDim == m_worldDim - 1);
+    m_jacobians.set_size(m_worldDim * m_gridDim, elementCount);
+    m_integrationElements.resize(elementCount);
+    if (hasNormals)
+      m_normals.set_size(m_worldDim, elementCount);
+    else
+      m_normals.reset();
+    if (m_gridDim == 0)
+      return;
+
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, elementCount),
+        [&](const tbb::blocked_range<int> &r) {
+          for (int e = r.begin(); e != r.end(); ++e) {
+            CoordinateType *jac = m_jacobians.colptr(e);
+            computeJacobian(e, jac);
+            const CoordinateType *t0 = jac;
+            const CoordinateType *t1 = jac + m_worldDim;
+
+            CoordinateType g00 = 0, g01 = 0, g11 = 0;
+            for (int i = 0; i < m_worldDim; ++i)
+              g00 += t0[i] * t0[i];
+            if (m_gridDim == 2)
+              for (int i = 0; i < m_worldDim; ++i) {
+                g01 += t0[i] * t1[i];
+                g11 += t1[i] * t1[i];
+              }
+            m_integrationElements[e] =
+                m_gridDim == 1 ? std::sqrt(g00)
+                               : std::sqrt(g00 * g11 - g01 * g01);
+
+            if (!hasNormals)
+              continue;
+            // Same conventions as ConcreteGeometry::calculateNormals()
+            CoordinateType *n = m_normals.colptr(e);
+            if (m_worldDim == 3) {
+              n[0] = t0[1] * t1[2] - t0[2] * t1[1];
+              n[1] = t0[2] * t1[0] - t0[0] * t1[2];
+              n[2] = t0[0] * t1[1] - t0[1] * t1[0];
+            } else if (m_worldDim == 2) {
+              n[0] = t0[1];
+              n[1] = t0[0];
+            }
+            CoordinateType sum = 0;
+            for (int i = 0; i < m_worldDim; ++i)
+              sum += n[i] * n[i];
+            const CoordinateType invLength = 1. / std::sqrt(sum);
+            for (int i = 0; i < m_worldDim; ++i)
+              n[i] *= invLength;
+          }
+        });
+  }
+
   // Non-const accessors (currently needed for construction)
 
   arma::Mat<CoordinateType> &vertices() { return m_vertices; }
@@ -102,12 +187,41 @@ public:
   }
 
 private:
+  void computeJacobian(int elementIndex, CoordinateType *jac) const {
+    const int cornerCount = elementCornerCount(elementIndex);
+    const CoordinateType *v[4];
+    for (int i = 0; i < cornerCount && i < 4; ++i)
+      v[i] = m_vertices.colptr(m_elementCornerIndices(i, elementIndex));
+    CoordinateType *t0 = jac;
+    CoordinateType *t1 = jac + m_worldDim;
+    if (cornerCount == 4) {
+      // Bilinear quadrilateral with corners in lexicographic order
+      for (int i = 0; i < m_worldDim; ++i) {
+        t0[i] = 0.5 * ((v[1][i] - v[0][i]) + (v[3][i] - v[2][i]));
+        t1[i] = 0.5 * ((v[2][i] - v[0][i]) + (v[3][i] - v[1][i]));
+      }
+    } else if (m_gridDim == 2 && cornerCount == 3) {
+      for (int i = 0; i < m_worldDim; ++i) {
+        t0[i] = v[1][i] - v[0][i];
+        t1[i] = v[2][i] - v[0][i];
+      }
+    } else if (m_gridDim == 1 && cornerCount == 2) {
+      for (int i = 0; i < m_worldDim; ++i)
+        t0[i] = v[1][i] - v[0][i];
+    } else
+      throw std::runtime_error("RawGridGeometry::computeElementGeometry(): "
+                               "unsupported element type");
+  }
+
   int m_gridDim;
   int m_worldDim;
   arma::Mat<CoordinateType> m_vertices;
   arma::Mat<int> m_elementCornerIndices;
   arma::Mat<char> m_auxData;
   std::vector<int> m_domainIndices;
+  arma::Mat<CoordinateType> m_jacobians;
+  std::vector<CoordinateType> m_integrationElements;
+  arma::Mat<CoordinateType> m_normals;
 };
 
 } // namespace Fiber
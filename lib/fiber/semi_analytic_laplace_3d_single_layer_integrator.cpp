@@ -0,0 +1,393 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "semi_analytic_laplace_3d_single_layer_integrator.hpp"
+
+#include "basis_data.hpp"
+#include "collection_of_kernels.hpp"
+#include "collection_of_shapeset_transformations.hpp"
+#include "conjugate.hpp"
+#include "explicit_instantiation.hpp"
+#include "kernel_tile_type.hpp"
+#include "numerical_quadrature.hpp"
+#include "raw_grid_geometry.hpp"
+#include "shapeset.hpp"
+#include "test_kernel_trial_integral.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace Fiber {
+
+namespace {
+
+// The Hyena tables contain Gauss rules with up to this number of points
+const int MAX_POINT_COUNT_IN_1D = 20;
+
+template <typename T> inline T dot3(const T *a, const T *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+template <typename T> inline void cross3(const T *a, const T *b, T *c) {
+  c[0] = a[1] * b[2] - a[2] * b[1];
+  c[1] = a[2] * b[0] - a[0] * b[2];
+  c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+template <typename T> inline T distance3(const T *a, const T *b) {
+  const T d[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+  return std::sqrt(dot3(d, d));
+}
+
+/** Calculate the integrals i0 = int_T 1/|x-y| dy and
+ *  i1 = int_T (y - rho)/|x-y| dy over the flat triangle T with vertices
+ *  v[0], v[1], v[2] and unit normal n, where rho is the projection of x on
+ *  the plane of T.
+ *
+ *  The integrals are reduced to sums of closed-form contributions of the
+ *  edges of T, see e.g. Graglia, "On the numerical integration of the linear
+ *  shape functions times the 3-D Green's function or its gradient on a plane
+ *  triangle", IEEE Trans. Antennas Propag. 41 (1993) 1448. */
+template <typename T>
+void laplacePotentialsOfTriangle(const T (*v)[3], const T *n, const T *x,
+                                 T &i0, T *i1) {
+  const T xv[3] = {x[0] - v[0][0], x[1] - v[0][1], x[2] - v[0][2]};
+  const T h = dot3(n, xv);
+  const T absH = std::abs(h);
+  const T rho[3] = {x[0] - h * n[0], x[1] - h * n[1], x[2] - h * n[2]};
+
+  i0 = 0.;
+  i1[0] = i1[1] = i1[2] = 0.;
+  for (int e = 0; e < 3; ++e) {
+    const T *pm = v[e];
+    const T *pp = v[(e + 1) % 3];
+    T l[3] = {pp[0] - pm[0], pp[1] - pm[1], pp[2] - pm[2]};
+    const T length = std::sqrt(dot3(l, l));
+    for (int d = 0; d < 3; ++d)
+      l[d] /= length;
+    // Outward normal to the edge, lying in the plane of the triangle
+    T u[3];
+    cross3(l, n, u);
+
+    const T pmRho[3] = {pm[0] - rho[0], pm[1] - rho[1], pm[2] - rho[2]};
+    const T ppRho[3] = {pp[0] - rho[0], pp[1] - rho[1], pp[2] - rho[2]};
+    const T t0 = dot3(pmRho, u);
+    const T sm = dot3(pmRho, l), sp = dot3(ppRho, l);
+    const T rm = distance3(x, pm), rp = distance3(x, pp);
+    const T r0Squared = t0 * t0 + h * h;
+
+    // f = log((rp + sp) / (rm + sm)), written so as to avoid cancellation.
+    // If x lies on the line of the edge, f is multiplied by zero below.
+    T f = 0.;
+    const T eps = std::numeric_limits<T>::epsilon();
+    if (r0Squared > eps * eps * length * length) {
+      if (sm >= 0.)
+        f = std::log((rp + sp) / (rm + sm));
+      else if (sp <= 0.)
+        f = std::log((rm - sm) / (rp - sp));
+      else
+        f = std::log((rp + sp) * (rm - sm) / r0Squared);
+    }
+    const T beta = std::atan2(t0 * sp, r0Squared + absH * rp) -
+                   std::atan2(t0 * sm, r0Squared + absH * rm);
+
+    i0 += t0 * f - absH * beta;
+    const T c = 0.5 * (r0Squared * f + sp * rp - sm * rm);
+    for (int d = 0; d < 3; ++d)
+      i1[d] += c * u[d];
+  }
+}
+
+} // namespace
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+SemiAnalyticLaplace3dSingleLayerIntegrator<BasisFunctionType, KernelType,
+                                           ResultType>::
+    SemiAnalyticLaplace3dSingleLayerIntegrator(
+        const RawGridGeometry<CoordinateType> &testRawGeometry,
+        const RawGridGeometry<CoordinateType> &trialRawGeometry,
+        int pointCountIn1d, std::unique_ptr<const Base> fallbackIntegrator)
+    : m_testRawGeometry(testRawGeometry), m_trialRawGeometry(trialRawGeometry),
+      m_fallbackIntegrator(std::move(fallbackIntegrator)) {
+  if (!m_fallbackIntegrator)
+    throw std::invalid_argument(
+        "SemiAnalyticLaplace3dSingleLayerIntegrator::"
+        "SemiAnalyticLaplace3dSingleLayerIntegrator(): "
+        "fallbackIntegrator must not be null");
+  pointCountIn1d = std::min(std::max(pointCountIn1d, 1), MAX_POINT_COUNT_IN_1D);
+  fillGradedTriangleQuadraturePointsAndWeights(
+      pointCountIn1d, m_localTestQuadPoints, m_testQuadWeights);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+SemiAnalyticLaplace3dSingleLayerIntegrator<
+    BasisFunctionType, KernelType,
+    ResultType>::~SemiAnalyticLaplace3dSingleLayerIntegrator() {}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+bool SemiAnalyticLaplace3dSingleLayerIntegrator<
+    BasisFunctionType, KernelType, ResultType>::
+    isApplicable(const CollectionOfShapesetTransformations<CoordinateType> &
+                     testTransformations,
+                 const CollectionOfKernels<KernelType> &kernels,
+                 const CollectionOfShapesetTransformations<CoordinateType> &
+                     trialTransformations,
+                 const TestKernelTrialIntegral<BasisFunctionType, KernelType,
+                                               ResultType> &integral) {
+  KernelTileType kernelType = SINGLE_LAYER_TILE;
+  std::complex<double> waveNumber = 0.;
+  size_t testBasisDeps = 0, trialBasisDeps = 0;
+  size_t testGeomDeps = 0, trialGeomDeps = 0;
+  testTransformations.addDependencies(testBasisDeps, testGeomDeps);
+  trialTransformations.addDependencies(trialBasisDeps, trialGeomDeps);
+  return kernels.describeModifiedHelmholtz3dKernel(kernelType, waveNumber) &&
+         kernelType == SINGLE_LAYER_TILE && waveNumber == 0. &&
+         integral.isTestScalarKernelTrialProduct() &&
+         testTransformations.transformationCount() == 1 &&
+         testTransformations.argumentDimension() == 1 &&
+         testTransformations.resultDimension(0) == 1 &&
+         trialTransformations.transformationCount() == 1 &&
+         trialTransformations.argumentDimension() == 1 &&
+         trialTransformations.resultDimension(0) == 1 &&
+         testBasisDeps == VALUES && trialBasisDeps == VALUES &&
+         testGeomDeps == 0 && trialGeomDeps == 0;
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void SemiAnalyticLaplace3dSingleLayerIntegrator<
+    BasisFunctionType, KernelType, ResultType>::
+    integrate(CallVariant callVariant, const std::vector<int> &elementIndicesA,
+              int elementIndexB, const Shapeset<BasisFunctionType> &basisA,
+              const Shapeset<BasisFunctionType> &basisB,
+              LocalDofIndex localDofIndexB,
+              const std::vector<arma::Mat<ResultType> *> &result) const {
+  if (result.size() != elementIndicesA.size())
+    throw std::invalid_argument(
+        "SemiAnalyticLaplace3dSingleLayerIntegrator::integrate(): "
+        "arrays 'result' and 'elementIndicesA' must have the same number "
+        "of elements");
+
+  const Shapeset<BasisFunctionType> &testShapeset =
+      callVariant == TEST_TRIAL ? basisA : basisB;
+  const Shapeset<BasisFunctionType> &trialShapeset =
+      callVariant == TEST_TRIAL ? basisB : basisA;
+  std::vector<ElementIndexPair> elementIndexPairs(elementIndicesA.size());
+  for (size_t i = 0; i < elementIndicesA.size(); ++i)
+    elementIndexPairs[i] =
+        callVariant == TEST_TRIAL
+            ? ElementIndexPair(elementIndicesA[i], elementIndexB)
+            : ElementIndexPair(elementIndexB, elementIndicesA[i]);
+  if (!canIntegrate(elementIndexPairs, testShapeset, trialShapeset)) {
+    m_fallbackIntegrator->integrate(callVariant, elementIndicesA,
+                                    elementIndexB, basisA, basisB,
+                                    localDofIndexB, result);
+    return;
+  }
+
+  integrate(elementIndexPairs, testShapeset, trialShapeset, result);
+  if (localDofIndexB == ALL_DOFS)
+    return;
+  for (size_t i = 0; i < result.size(); ++i) {
+    assert(result[i]);
+    arma::Mat<ResultType> &matrix = *result[i];
+    if (callVariant == TEST_TRIAL)
+      matrix = arma::Mat<ResultType>(matrix.col(localDofIndexB));
+    else
+      matrix = arma::Mat<ResultType>(matrix.row(localDofIndexB));
+  }
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void SemiAnalyticLaplace3dSingleLayerIntegrator<
+    BasisFunctionType, KernelType, ResultType>::
+    integrate(const std::vector<ElementIndexPair> &elementIndexPairs,
+              const Shapeset<BasisFunctionType> &testShapeset,
+              const Shapeset<BasisFunctionType> &trialShapeset,
+              const std::vector<arma::Mat<ResultType> *> &result) const {
+  if (result.size() != elementIndexPairs.size())
+    throw std::invalid_argument(
+        "SemiAnalyticLaplace3dSingleLayerIntegrator::integrate(): "
+        "arrays 'result' and 'elementIndexPairs' must have the same number "
+        "of elements");
+  if (!canIntegrate(elementIndexPairs, testShapeset, trialShapeset)) {
+    m_fallbackIntegrator->integrate(elementIndexPairs, testShapeset,
+                                    trialShapeset, result);
+    return;
+  }
+  if (elementIndexPairs.empty())
+    return;
+
+  // Values of the test functions at the quadrature points
+  BasisData<BasisFunctionType> testBasisData;
+  testShapeset.evaluate(VALUES, m_localTestQuadPoints, ALL_DOFS,
+                        testBasisData);
+  const int testDofCount = testShapeset.size();
+  const int pointCount = m_localTestQuadPoints.n_cols;
+  arma::Mat<BasisFunctionType> testValues(testDofCount, pointCount);
+  for (int point = 0; point < pointCount; ++point)
+    for (int dof = 0; dof < testDofCount; ++dof)
+      testValues(dof, point) = testBasisData.values(0, dof, point);
+
+  // The trial functions are (at most) linear, hence determined by their
+  // values at the vertices of the reference triangle
+  arma::Mat<CoordinateType> localVertices(2, 3);
+  localVertices.fill(0.);
+  localVertices(0, 1) = 1.;
+  localVertices(1, 2) = 1.;
+  BasisData<BasisFunctionType> trialBasisData;
+  trialShapeset.evaluate(VALUES, localVertices, ALL_DOFS, trialBasisData);
+  const int trialDofCount = trialShapeset.size();
+  arma::Mat<BasisFunctionType> trialNodalValues(trialDofCount, 3);
+  for (int vertex = 0; vertex < 3; ++vertex)
+    for (int dof = 0; dof < trialDofCount; ++dof)
+      trialNodalValues(dof, vertex) = trialBasisData.values(0, dof, vertex);
+
+  for (size_t i = 0; i < elementIndexPairs.size(); ++i) {
+    assert(result[i]);
+    integrateTrianglePair(elementIndexPairs[i].first,
+                          elementIndexPairs[i].second, testValues,
+                          trialNodalValues, *result[i]);
+  }
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+bool SemiAnalyticLaplace3dSingleLayerIntegrator<
+    BasisFunctionType, KernelType, ResultType>::
+    canIntegrate(const std::vector<ElementIndexPair> &elementIndexPairs,
+                 const Shapeset<BasisFunctionType> &testShapeset,
+                 const Shapeset<BasisFunctionType> &trialShapeset) const {
+  if (trialShapeset.order() > 1 || m_testRawGeometry.worldDimension() != 3 ||
+      m_trialRawGeometry.worldDimension() != 3)
+    return false;
+  for (size_t i = 0; i < elementIndexPairs.size(); ++i)
+    if (m_testRawGeometry.elementCornerCount(elementIndexPairs[i].first) != 3 ||
+        m_trialRawGeometry.elementCornerCount(elementIndexPairs[i].second) != 3)
+      return false;
+  return true;
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void SemiAnalyticLaplace3dSingleLayerIntegrator<
+    BasisFunctionType, KernelType, ResultType>::
+    integrateTrianglePair(int testElementIndex, int trialElementIndex,
+                          const arma::Mat<BasisFunctionType> &testValues,
+                          const arma::Mat<BasisFunctionType> &trialNodalValues,
+                          arma::Mat<ResultType> &result) const {
+  const int dimWorld = 3;
+  CoordinateType a[3][dimWorld], b[3][dimWorld];
+  {
+    const arma::Mat<CoordinateType> &testVertices =
+        m_testRawGeometry.vertices();
+    const arma::Mat<int> &testCorners =
+        m_testRawGeometry.elementCornerIndices();
+    const arma::Mat<CoordinateType> &trialVertices =
+        m_trialRawGeometry.vertices();
+    const arma::Mat<int> &trialCorners =
+        m_trialRawGeometry.elementCornerIndices();
+    for (int k = 0; k < 3; ++k)
+      for (int d = 0; d < dimWorld; ++d) {
+        a[k][d] = testVertices(d, testCorners(k, testElementIndex));
+        b[k][d] = trialVertices(d, trialCorners(k, trialElementIndex));
+      }
+  }
+
+  CoordinateType testEdge1[3], testEdge2[3], trialEdge1[3], trialEdge2[3];
+  for (int d = 0; d < dimWorld; ++d) {
+    testEdge1[d] = a[1][d] - a[0][d];
+    testEdge2[d] = a[2][d] - a[0][d];
+    trialEdge1[d] = b[1][d] - b[0][d];
+    trialEdge2[d] = b[2][d] - b[0][d];
+  }
+  CoordinateType testNormal[3], trialNormal[3];
+  cross3(testEdge1, testEdge2, testNormal);
+  cross3(trialEdge1, trialEdge2, trialNormal);
+  const CoordinateType testIntegrationElement =
+      std::sqrt(dot3(testNormal, testNormal));
+  const CoordinateType trialIntegrationElement =
+      std::sqrt(dot3(trialNormal, trialNormal));
+  for (int d = 0; d < dimWorld; ++d)
+    trialNormal[d] /= trialIntegrationElement;
+
+  // Gradients of the barycentric coordinates of the trial triangle
+  CoordinateType gradients[3][dimWorld];
+  for (int k = 0; k < 3; ++k) {
+    const CoordinateType *p = b[(k + 1) % 3];
+    const CoordinateType *q = b[(k + 2) % 3];
+    const CoordinateType edge[3] = {q[0] - p[0], q[1] - p[1], q[2] - p[2]};
+    cross3(trialNormal, edge, gradients[k]);
+    for (int d = 0; d < dimWorld; ++d)
+      gradients[k][d] /= trialIntegrationElement;
+  }
+
+  // Integrals of the kernel times the barycentric coordinates of the trial
+  // triangle, multiplied by the test quadrature weights
+  const int pointCount = m_localTestQuadPoints.n_cols;
+  const CoordinateType factor = testIntegrationElement / (4. * M_PI);
+  arma::Mat<CoordinateType> weightedPotentials(3, pointCount);
+  for (int point = 0; point < pointCount; ++point) {
+    const CoordinateType xi = m_localTestQuadPoints(0, point);
+    const CoordinateType eta = m_localTestQuadPoints(1, point);
+    CoordinateType x[3];
+    for (int d = 0; d < dimWorld; ++d)
+      x[d] = a[0][d] + xi * testEdge1[d] + eta * testEdge2[d];
+    CoordinateType i0, i1[3];
+    laplacePotentialsOfTriangle(b, trialNormal, x, i0, i1);
+    const CoordinateType weight = m_testQuadWeights[point] * factor;
+    for (int k = 0; k < 3; ++k) {
+      // The barycentric coordinate is affine, so its value at y equals
+      // its value at the projection rho of x plus its gradient times y - rho
+      const CoordinateType *p = b[(k + 1) % 3];
+      const CoordinateType xp[3] = {x[0] - p[0], x[1] - p[1], x[2] - p[2]};
+      weightedPotentials(k, point) =
+          weight * (dot3(gradients[k], xp) * i0 + dot3(gradients[k], i1));
+    }
+  }
+
+  const int testDofCount = testValues.n_rows;
+  const int trialDofCount = trialNodalValues.n_rows;
+  arma::Mat<BasisFunctionType> weightedTrialValues(trialDofCount, pointCount);
+  for (int point = 0; point < pointCount; ++point)
+    for (int trialDof = 0; trialDof < trialDofCount; ++trialDof) {
+      BasisFunctionType value = 0.;
+      for (int k = 0; k < 3; ++k)
+        value += trialNodalValues(trialDof, k) * weightedPotentials(k, point);
+      weightedTrialValues(trialDof, point) = value;
+    }
+
+  result.set_size(testDofCount, trialDofCount);
+  for (int trialDof = 0; trialDof < trialDofCount; ++trialDof)
+    for (int testDof = 0; testDof < testDofCount; ++testDof) {
+      ResultType sum = 0.;
+      for (int point = 0; point < pointCount; ++point)
+        sum += conjugate(testValues(testDof, point)) *
+               weightedTrialValues(trialDof, point);
+      result(testDof, trialDof) = sum;
+    }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_KERNEL_AND_RESULT(
+    SemiAnalyticLaplace3dSingleLayerIntegrator);
+
+} // namespace Fiber
@@ -0,0 +1,126 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_semi_analytic_laplace_3d_single_layer_integrator_hpp
+#define fiber_semi_analytic_laplace_3d_single_layer_integrator_hpp
+
+#include "../common/common.hpp"
+
+#include "test_kernel_trial_integrator.hpp"
+
+#include <memory>
+
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename CoordinateType> class CollectionOfShapesetTransformations;
+template <typename ValueType> class CollectionOfKernels;
+template <typename CoordinateType> class RawGridGeometry;
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+class TestKernelTrialIntegral;
+/** \endcond */
+
+/** \brief Semi-analytic integration of the Laplace single-layer kernel in 3D
+ *  over pairs of flat triangles.
+ *
+ *  The integral of the kernel \f$1/(4\pi |x-y|)\f$ multiplied by a trial
+ *  shape function of order at most 1 over the trial triangle is evaluated in
+ *  closed form, using the expressions for the potentials of uniform and
+ *  linear layers on a polygon. Only the integral over the test triangle is
+ *  done numerically, with the rule given by
+ *  fillGradedTriangleQuadraturePointsAndWeights(), whose points cluster
+ *  near the edges where the potential is least smooth. This avoids the
+ *  four-dimensional Sauter-Schwab rules for pairs of elements sharing a
+ *  vertex, an edge or the whole element and stays accurate for disjoint
+ *  pairs lying very close to each other.
+ *
+ *  Element pairs with quadrilaterals or shape functions of higher order are
+ *  passed on to the integrator given in the constructor. */
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+class SemiAnalyticLaplace3dSingleLayerIntegrator
+    : public TestKernelTrialIntegrator<BasisFunctionType, KernelType,
+                                       ResultType> {
+public:
+  typedef TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType>
+  Base;
+  typedef typename Base::CoordinateType CoordinateType;
+  typedef typename Base::ElementIndexPair ElementIndexPair;
+
+  /** \brief Constructor.
+   *
+   *  \param[in] testRawGeometry, trialRawGeometry
+   *    Geometries of the test and trial grids.
+   *  \param[in] pointCountIn1d
+   *    Number of points in each direction of the test-element rule (see
+   *    fillGradedTriangleQuadraturePointsAndWeights()).
+   *  \param[in] fallbackIntegrator
+   *    Integrator used for the element pairs that cannot be integrated
+   *    semi-analytically. The new object takes ownership of it. */
+  SemiAnalyticLaplace3dSingleLayerIntegrator(
+      const RawGridGeometry<CoordinateType> &testRawGeometry,
+      const RawGridGeometry<CoordinateType> &trialRawGeometry,
+      int pointCountIn1d, std::unique_ptr<const Base> fallbackIntegrator);
+  virtual ~SemiAnalyticLaplace3dSingleLayerIntegrator();
+
+  /** \brief Return true if the weak form defined by the given objects is
+   *  that of the Laplace single-layer operator in 3D with scalar test and
+   *  trial functions, i.e. if it can be integrated by this class. */
+  static bool isApplicable(
+      const CollectionOfShapesetTransformations<CoordinateType> &
+          testTransformations,
+      const CollectionOfKernels<KernelType> &kernels,
+      const CollectionOfShapesetTransformations<CoordinateType> &
+          trialTransformations,
+      const TestKernelTrialIntegral<BasisFunctionType, KernelType, ResultType> &
+          integral);
+
+  virtual void
+  integrate(CallVariant callVariant, const std::vector<int> &elementIndicesA,
+            int elementIndexB, const Shapeset<BasisFunctionType> &basisA,
+            const Shapeset<BasisFunctionType> &basisB,
+            LocalDofIndex localDofIndexB,
+            const std::vector<arma::Mat<ResultType> *> &result) const;
+
+  virtual void
+  integrate(const std::vector<ElementIndexPair> &elementIndexPairs,
+            const Shapeset<BasisFunctionType> &testShapeset,
+            const Shapeset<BasisFunctionType> &trialShapeset,
+            const std::vector<arma::Mat<ResultType> *> &result) const;
+
+private:
+  bool canIntegrate(const std::vector<ElementIndexPair> &elementIndexPairs,
+                    const Shapeset<BasisFunctionType> &testShapeset,
+                    const Shapeset<BasisFunctionType> &trialShapeset) const;
+  void
+  integrateTrianglePair(int testElementIndex, int trialElementIndex,
+                        const arma::Mat<BasisFunctionType> &testValues,
+                        const arma::Mat<BasisFunctionType> &trialNodalValues,
+                        arma::Mat<ResultType> &result) const;
+
+  const RawGridGeometry<CoordinateType> &m_testRawGeometry;
+  const RawGridGeometry<CoordinateType> &m_trialRawGeometry;
+  arma::Mat<CoordinateType> m_localTestQuadPoints;
+  std::vector<CoordinateType> m_testQuadWeights;
+  std::unique_ptr<const Base> m_fallbackIntegrator;
+};
+
+} // namespace Fiber
+
+#endif
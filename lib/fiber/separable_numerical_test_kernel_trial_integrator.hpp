@@ -25,9 +25,18 @@
 
 #include "bempp/common/config_opencl.hpp"
 
+#ifdef WITH_OPENCL
+#include "opencl_handler.hpp"
+#endif
+
+#include "element_data_cache.hpp"
+#include "kernel_tile_type.hpp"
 #include "test_kernel_trial_integrator.hpp"
 
+#include <boost/scoped_array.hpp>
+#include <complex>
 #include <tbb/enumerable_thread_specific.h>
+#include <vector>
 
 namespace Fiber {
 
@@ -35,12 +44,22 @@ namespace Fiber {
 class OpenClHandler;
 template <typename CoordinateType> class CollectionOfShapesetTransformations;
 template <typename ValueType> class CollectionOfKernels;
+template <typename T> class CollectionOf4dArrays;
 template <typename CoordinateType> class RawGridGeometry;
+template <typename ValueType> class BasisData;
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
 class TestKernelTrialIntegral;
 /** \endcond */
 
-/** \brief Integration over pairs of elements on tensor-product point grids. */
+/** \brief Integration over pairs of elements on tensor-product point grids.
+ *
+ *  If OpenCL is enabled, the integrals are evaluated on the GPU provided
+ *  that the kernel is a Laplace or modified Helmholtz kernel (see
+ *  CollectionOfKernels::describeModifiedHelmholtz3dKernel()), the integral
+ *  is the product of a test function value, the kernel and a trial function
+ *  value, the shape function transformations depend only on the shape
+ *  function values, the elements are flat triangles and CoordinateType is
+ *  \p double. In all other cases the CPU code path is used. */
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 class SeparableNumericalTestKernelTrialIntegrator
@@ -68,7 +87,8 @@ public:
           trialTransformations,
       const TestKernelTrialIntegral<BasisFunctionType, KernelType, ResultType> &
           integral,
-      const OpenClHandler &openClHandler, bool cacheGeometricalData = true);
+      const OpenClHandler &openClHandler, bool cacheGeometricalData = true,
+      bool singlePrecisionKernels = false);
 
   virtual ~SeparableNumericalTestKernelTrialIntegrator();
 
@@ -110,6 +130,75 @@ private:
                    const Shapeset<BasisFunctionType> &trialShapeset,
                    const std::vector<arma::Mat<ResultType> *> &result) const;
 
+  typedef ElementDataCache<BasisFunctionType, CoordinateType> ElementCache;
+
+  /** \cond PRIVATE */
+  // Element pairs waiting to be integrated together. The kernels of all the
+  // pairs are evaluated by a single call to
+  // CollectionOfKernels::evaluateBatchOnGrid() and the results passed to
+  // TestKernelTrialIntegral::evaluateBatchWithTensorQuadratureRule()
+  struct PairBatch {
+    enum { CAPACITY = 32 };
+
+    PairBatch()
+        : kernelValueStorage(new CollectionOf4dArrays<KernelType>[CAPACITY]) {}
+
+    bool full() const { return result.size() == CAPACITY; }
+    void clear() {
+      testGeomData.clear();
+      trialGeomData.clear();
+      testValues.clear();
+      trialValues.clear();
+      kernelResults.clear();
+      kernelValues.clear();
+      result.clear();
+    }
+    void add(const GeometricalData<CoordinateType> *testGeom,
+             const GeometricalData<CoordinateType> *trialGeom,
+             const CollectionOf3dArrays<BasisFunctionType> *testVals,
+             const CollectionOf3dArrays<BasisFunctionType> *trialVals,
+             arma::Mat<ResultType> *res) {
+      kernelResults.push_back(&kernelValueStorage[result.size()]);
+      kernelValues.push_back(kernelResults.back());
+      testGeomData.push_back(testGeom);
+      trialGeomData.push_back(trialGeom);
+      testValues.push_back(testVals);
+      trialValues.push_back(trialVals);
+      result.push_back(res);
+    }
+
+    boost::scoped_array<CollectionOf4dArrays<KernelType>> kernelValueStorage;
+    std::vector<const GeometricalData<CoordinateType> *> testGeomData,
+        trialGeomData;
+    std::vector<const CollectionOf3dArrays<BasisFunctionType> *> testValues,
+        trialValues;
+    std::vector<CollectionOf4dArrays<KernelType> *> kernelResults;
+    std::vector<const CollectionOf4dArrays<KernelType> *> kernelValues;
+    std::vector<arma::Mat<ResultType> *> result;
+  };
+  /** \endcond */
+
+  /** \brief Integrate over the element pairs in \p batch and empty it. */
+  void evaluateBatch(PairBatch &batch) const;
+
+  /** \brief Evaluate the kernels of all the element pairs in \p batch on
+   *  the grids of test x trial quadrature points, in single precision if the
+   *  integrator was constructed with singlePrecisionKernels = true. */
+  void evaluateKernels(PairBatch &batch) const;
+
+  /** \brief Return the transformed shape function values of a test or trial
+   *  element and set \p geomData to its geometrical data.
+   *
+   *  The values are taken from the cache of the current thread if possible.
+   *  \p geometry is used to evaluate the geometrical data if they are not
+   *  precalculated. */
+  const CollectionOf3dArrays<BasisFunctionType> &
+  elementData(bool test, int elementIndex,
+              const Shapeset<BasisFunctionType> &shapeset,
+              const BasisData<BasisFunctionType> &basisData, size_t geomDeps,
+              typename GeometryFactory::Geometry *geometry,
+              const GeometricalData<CoordinateType> *&geomData) const;
+
   void precalculateGeometricalData();
   void precalculateGeometricalDataOnSingleGrid(
       const arma::Mat<CoordinateType> &localQuadPoints,
@@ -117,11 +206,33 @@ private:
       const RawGridGeometry<CoordinateType> &rawGeometry, size_t geomDeps,
       std::vector<GeometricalData<CoordinateType>> &geomData);
 
+#ifdef WITH_OPENCL
+  /** \brief Integrate over \p elementIndexPairs on the GPU.
+   *
+   *  Returns false, leaving \p result untouched, if the shapesets are not
+   *  supported by the GPU code path. */
+  bool integrateRegularPairsCl(
+      const std::vector<ElementIndexPair> &elementIndexPairs,
+      const Shapeset<BasisFunctionType> &testShapeset,
+      const Shapeset<BasisFunctionType> &trialShapeset,
+      const std::vector<arma::Mat<ResultType> *> &result) const;
+
+  /** \brief Evaluate the transformed shape functions of \p shapeset at
+   *  \p localQuadPoints, stored as a (dofCount x pointCount) column-major
+   *  array. */
+  void evaluateClShapeFunctionValues(
+      const Shapeset<BasisFunctionType> &shapeset,
+      const arma::Mat<CoordinateType> &localQuadPoints,
+      const CollectionOfShapesetTransformations<CoordinateType> &
+          transformations,
+      std::vector<std::complex<double>> &values) const;
+
   /**
-   * \brief Returns an OpenCL code snippet containing the clIntegrate
-   *   kernel function for integrating a single row or column
+   * \brief Returns an OpenCL code snippet containing the
+   *   clIntegrateRegularPairs kernel function
    */
-  const std::pair<const char *, int> clStrIntegrateRowOrCol() const;
+  const std::pair<const char *, int> clStrIntegrateRegularPairs() const;
+#endif
 
   arma::Mat<CoordinateType> m_localTestQuadPoints;
   arma::Mat<CoordinateType> m_localTrialQuadPoints;
@@ -143,13 +254,21 @@ private:
 
   const OpenClHandler &m_openClHandler;
   bool m_cacheGeometricalData;
+  bool m_singlePrecisionKernels;
 
   std::vector<GeometricalData<CoordinateType>> m_cachedTestGeomData;
   std::vector<GeometricalData<CoordinateType>> m_cachedTrialGeomData;
   mutable tbb::enumerable_thread_specific<GeometricalData<CoordinateType>>
   m_testGeomData, m_trialGeomData;
+  mutable tbb::enumerable_thread_specific<ElementCache> m_testElementCache,
+      m_trialElementCache;
+  mutable tbb::enumerable_thread_specific<PairBatch> m_pairBatch;
 
 #ifdef WITH_OPENCL
+  bool m_clRegularIntegration;
+  KernelTileType m_clKernelType;
+  std::complex<double> m_clWaveNumber;
+
   cl::Buffer *clTestQuadPoints;
   cl::Buffer *clTrialQuadPoints;
   cl::Buffer *clTestQuadWeights;
@@ -31,6 +31,7 @@
 #include "shapeset.hpp"
 #include "basis_data.hpp"
 #include "conjugate.hpp"
+#include "collection_of_4d_arrays.hpp"
 #include "collection_of_shapeset_transformations.hpp"
 #include "geometrical_data.hpp"
 #include "collection_of_kernels.hpp"
@@ -38,15 +39,41 @@
 #include "raw_grid_geometry.hpp"
 #include "test_kernel_trial_integral.hpp"
 #include "types.hpp"
-#include "CL/separable_numerical_double_integrator.cl.str"
+#include "CL/regular_scalar_double_integrator.cl.str"
 
 #include "../common/auto_timer.hpp"
 
+#include <boost/type_traits/is_same.hpp>
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
 namespace Fiber {
 
+#ifdef WITH_OPENCL
+namespace {
+
+// Integrals computed by the GPU code path are complex; operators with real
+// kernels and shape functions take only their real parts.
+inline void setClResult(const std::complex<double> &value, double &result) {
+  result = value.real();
+}
+
+inline void setClResult(const std::complex<double> &value,
+                        std::complex<double> &result) {
+  result = value;
+}
+
+template <typename ResultType>
+inline void setClResult(const std::complex<double> &value,
+                        ResultType &result) {
+  throw std::logic_error("SeparableNumericalTestKernelTrialIntegrator::"
+                         "integrateRegularPairsCl(): unsupported result type");
+}
+
+} // namespace
+#endif // WITH_OPENCL
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
@@ -67,7 +94,8 @@ SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
             trialTransformations,
         const TestKernelTrialIntegral<BasisFunctionType, KernelType,
                                       ResultType> &integral,
-        const OpenClHandler &openClHandler, bool cacheGeometricalData)
+        const OpenClHandler &openClHandler, bool cacheGeometricalData,
+        bool singlePrecisionKernels)
     : m_localTestQuadPoints(localTestQuadPoints),
       m_localTrialQuadPoints(localTrialQuadPoints),
       m_testQuadWeights(testQuadWeights), m_trialQuadWeights(trialQuadWeights),
@@ -77,7 +105,8 @@ SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
       m_testTransformations(testTransformations), m_kernels(kernels),
       m_trialTransformations(trialTransformations), m_integral(integral),
       m_openClHandler(openClHandler),
-      m_cacheGeometricalData(cacheGeometricalData) {
+      m_cacheGeometricalData(cacheGeometricalData),
+      m_singlePrecisionKernels(singlePrecisionKernels) {
   if (localTestQuadPoints.n_cols != testQuadWeights.size())
     throw std::invalid_argument(
         "SeparableNumericalTestKernelTrialIntegrator::"
@@ -90,7 +119,31 @@ SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
         "numbers of trial points and weights do not match");
 
 #ifdef WITH_OPENCL
+  m_clRegularIntegration = false;
+  m_clKernelType = SINGLE_LAYER_TILE;
   if (openClHandler.UseOpenCl()) {
+    size_t testBasisDeps = 0, trialBasisDeps = 0;
+    size_t testGeomDeps = 0, trialGeomDeps = 0;
+    testTransformations.addDependencies(testBasisDeps, testGeomDeps);
+    trialTransformations.addDependencies(trialBasisDeps, trialGeomDeps);
+    const OpenClHandler::MeshGeom::MeshDims &size =
+        openClHandler.meshGeom().size;
+    m_clRegularIntegration =
+        boost::is_same<CoordinateType, double>::value && size.dim == 3 &&
+        size.nidx == 3 && localTestQuadPoints.n_rows == 2 &&
+        localTrialQuadPoints.n_rows == 2 &&
+        kernels.describeModifiedHelmholtz3dKernel(m_clKernelType,
+                                                   m_clWaveNumber) &&
+        integral.isTestScalarKernelTrialProduct() &&
+        testTransformations.transformationCount() == 1 &&
+        testTransformations.argumentDimension() == 1 &&
+        testTransformations.resultDimension(0) == 1 &&
+        trialTransformations.transformationCount() == 1 &&
+        trialTransformations.argumentDimension() == 1 &&
+        trialTransformations.resultDimension(0) == 1 &&
+        testBasisDeps == VALUES && trialBasisDeps == VALUES &&
+        testGeomDeps == 0 && trialGeomDeps == 0;
+
     // push integration points to CL device
     clTestQuadPoints =
         openClHandler.pushMatrix<CoordinateType>(localTestQuadPoints);
@@ -164,6 +217,83 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
   }
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+const CollectionOf3dArrays<BasisFunctionType> &
+SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
+                                            ResultType, GeometryFactory>::
+    elementData(bool test, int elementIndex,
+                const Shapeset<BasisFunctionType> &shapeset,
+                const BasisData<BasisFunctionType> &basisData,
+                size_t geomDeps, typename GeometryFactory::Geometry *geometry,
+                const GeometricalData<CoordinateType> *&geomData) const {
+  ElementCache &cache =
+      test ? m_testElementCache.local() : m_trialElementCache.local();
+  bool hit;
+  typename ElementCache::Entry &entry =
+      cache.lookup(elementIndex, shapeset, hit);
+  if (m_cacheGeometricalData)
+    geomData = test ? &m_cachedTestGeomData[elementIndex]
+                    : &m_cachedTrialGeomData[elementIndex];
+  else
+    geomData = &entry.geomData;
+  if (hit)
+    return entry.values;
+
+  try {
+    if (!m_cacheGeometricalData) {
+      const RawGridGeometry<CoordinateType> &rawGeometry =
+          test ? m_testRawGeometry : m_trialRawGeometry;
+      rawGeometry.setupGeometry(elementIndex, *geometry);
+      geometry->getData(geomDeps,
+                        test ? m_localTestQuadPoints : m_localTrialQuadPoints,
+                        entry.geomData);
+      if (geomDeps & DOMAIN_INDEX)
+        entry.geomData.domainIndex = rawGeometry.domainIndex(elementIndex);
+    }
+    if (test)
+      m_testTransformations.evaluate(basisData, *geomData, entry.values);
+    else
+      m_trialTransformations.evaluate(basisData, *geomData, entry.values);
+  } catch (...) {
+    cache.invalidate(elementIndex);
+    throw;
+  }
+  return entry.values;
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void SeparableNumericalTestKernelTrialIntegrator<
+    BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+    evaluateKernels(PairBatch &batch) const {
+  if (m_singlePrecisionKernels) {
+    for (size_t i = 0; i < batch.result.size(); ++i)
+      m_kernels.evaluateOnGridInSinglePrecision(
+          *batch.testGeomData[i], *batch.trialGeomData[i],
+          *batch.kernelResults[i]);
+  } else
+    m_kernels.evaluateBatchOnGrid(batch.testGeomData, batch.trialGeomData,
+                                  batch.kernelResults);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void SeparableNumericalTestKernelTrialIntegrator<
+    BasisFunctionType, KernelType, ResultType,
+    GeometryFactory>::evaluateBatch(PairBatch &batch) const {
+  if (!batch.result.empty()) {
+    evaluateKernels(batch);
+    m_integral.evaluateBatchWithTensorQuadratureRule(
+        batch.testGeomData, batch.trialGeomData, batch.testValues,
+        batch.trialValues, batch.kernelValues, m_testQuadWeights,
+        m_trialQuadWeights, batch.result);
+  }
+  batch.clear();
+  m_testElementCache.local().releaseSlots();
+  m_trialElementCache.local().releaseSlots();
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
@@ -229,23 +359,20 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
 
   typedef typename GeometryFactory::Geometry Geometry;
   std::unique_ptr<Geometry> geometryA, geometryB;
-  const RawGridGeometry<CoordinateType> *rawGeometryA = 0, *rawGeometryB = 0;
+  const RawGridGeometry<CoordinateType> *rawGeometryB = 0;
   if (!m_cacheGeometricalData) {
     if (callVariant == TEST_TRIAL) {
       geometryA = m_testGeometryFactory.make();
       geometryB = m_trialGeometryFactory.make();
-      rawGeometryA = &m_testRawGeometry;
       rawGeometryB = &m_trialRawGeometry;
     } else {
       geometryA = m_trialGeometryFactory.make();
       geometryB = m_testGeometryFactory.make();
-      rawGeometryA = &m_trialRawGeometry;
       rawGeometryB = &m_testRawGeometry;
     }
   }
 
   CollectionOf3dArrays<BasisFunctionType> testValues, trialValues;
-  CollectionOf4dArrays<KernelType> kernelValues;
 
   for (size_t i = 0; i < result.size(); ++i) {
     assert(result[i]);
@@ -284,40 +411,35 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
                                    testValues);
   }
 
-  // Iterate over the elements
+  // Iterate over the elements and integrate in batches. The data of the
+  // elements A are shared by many calls and are taken from the element
+  // cache; a batch is closed early before its cached data would be evicted.
+  const bool elementsAAreTest = callVariant == TEST_TRIAL;
+  ElementCache &cacheA = elementsAAreTest ? m_testElementCache.local()
+                                          : m_trialElementCache.local();
+  PairBatch &batch = m_pairBatch.local();
+  batch.clear();
   for (int indexA = 0; indexA < elementACount; ++indexA) {
     const int elementIndexA = elementIndicesA[indexA];
-    if (!m_cacheGeometricalData)
-      rawGeometryA->setupGeometry(elementIndexA, *geometryA);
-    if (callVariant == TEST_TRIAL) {
-      if (m_cacheGeometricalData)
-        constTestGeomData = &m_cachedTestGeomData[elementIndicesA[indexA]];
-      else {
-        geometryA->getData(testGeomDeps, m_localTestQuadPoints, *testGeomData);
-        if (testGeomDeps & DOMAIN_INDEX)
-          testGeomData->domainIndex = rawGeometryA->domainIndex(elementIndexA);
-      }
-      m_testTransformations.evaluate(testBasisData, *constTestGeomData,
-                                     testValues);
+    if (batch.full() || cacheA.conflicts(elementIndexA, basisA))
+      evaluateBatch(batch);
+    if (elementsAAreTest) {
+      const GeometricalData<CoordinateType> *geomDataA = 0;
+      const CollectionOf3dArrays<BasisFunctionType> &valuesA =
+          elementData(true, elementIndexA, basisA, testBasisData,
+                      testGeomDeps, geometryA.get(), geomDataA);
+      batch.add(geomDataA, constTrialGeomData, &valuesA, &trialValues,
+                result[indexA]);
     } else {
-      if (m_cacheGeometricalData)
-        constTrialGeomData = &m_cachedTrialGeomData[elementIndicesA[indexA]];
-      else {
-        geometryA->getData(trialGeomDeps, m_localTrialQuadPoints,
-                           *trialGeomData);
-        if (trialGeomDeps & DOMAIN_INDEX)
-          trialGeomData->domainIndex = rawGeometryA->domainIndex(elementIndexA);
-      }
-      m_trialTransformations.evaluate(trialBasisData, *constTrialGeomData,
-                                      trialValues);
+      const GeometricalData<CoordinateType> *geomDataA = 0;
+      const CollectionOf3dArrays<BasisFunctionType> &valuesA =
+          elementData(false, elementIndexA, basisA, trialBasisData,
+                      trialGeomDeps, geometryA.get(), geomDataA);
+      batch.add(constTestGeomData, geomDataA, &testValues, &valuesA,
+                result[indexA]);
     }
-
-    m_kernels.evaluateOnGrid(*constTestGeomData, *constTrialGeomData,
-                             kernelValues);
-    m_integral.evaluateWithTensorQuadratureRule(
-        *constTestGeomData, *constTrialGeomData, testValues, trialValues,
-        kernelValues, m_testQuadWeights, m_trialQuadWeights, *result[indexA]);
   }
+  evaluateBatch(batch);
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -330,348 +452,48 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
                 const Shapeset<BasisFunctionType> &basisB,
                 LocalDofIndex localDofIndexB,
                 const std::vector<arma::Mat<ResultType> *> &result) const {
-  //#ifdef WITH_OPENCL
-  //  // DEBUG: test latency
-  //  {
-  //    int bufsize = 10;
-  //    std::vector<ResultType> buf(bufsize);
-  //    tbb::tick_count t0 = tbb::tick_count::now();
-  //    cl::Buffer *clbuf = m_openClHandler.pushVector<ResultType> (buf);
-  //    tbb::tick_count::interval_t dt1 = tbb::tick_count::now()-t0;
-
-  //    t0 = tbb::tick_count::now();
-  //    m_openClHandler.pullVector<ResultType> (*clbuf, buf, bufsize);
-  //    tbb::tick_count::interval_t dt2 = tbb::tick_count::now()-t0;
-
-  //    static int callcount = 0;
-  //    std::cout << callcount++ << "\tpush: " << dt1.seconds() << "\tpull: " <<
-  // dt2.seconds() << std::endl;
-  //  }
-
-  //  //    tbb::tick_count t_start, t_end, t0, t1;
-  //  //    tbb::tick_count::interval_t dt_buf, dt_kern, dt_prog, dt_pull;
-
-  //  //    t_start = tbb::tick_count::now();
-
-  //    // Temporary code. TODO: add support for multiple-term expressions.
-  //    if (!m_testTransformation.isTrivial() ||
-  // !m_trialTransformation.isTrivial())
-  //        throw
-  // std::runtime_error("SeparableNumericalTestKernelTrialIntegrator::"
-  //                                 "integrateCl(): multiple-term expression
-  // lists are "
-  //                                 "not supported in the OpenCL mode yet");
-  //    const Expression<CoordinateType>& m_testExpression =
-  // m_testTransformation.term(0);
-  //    const Expression<CoordinateType>& m_trialExpression =
-  // m_trialTransformation.term(0);
-
-  //    const int testPointCount = m_localTestQuadPoints.n_cols;
-  //    const int trialPointCount = m_localTrialQuadPoints.n_cols;
-  //    const int elementACount = elementIndicesA.size();
-  //    const int pointDim = m_localTestQuadPoints.n_rows;
-  //    const int meshDim = m_openClHandler.meshGeom().size.dim;
-
-  //    if (testPointCount == 0 || trialPointCount == 0 || elementACount == 0)
-  //        return;
-  //    // TODO: in the (pathological) case that pointCount == 0 but
-  //    // geometryCount != 0, set elements of result to 0.
-
-  //    // Evaluate constants
-  //    const int testComponentCount = m_testExpression.codomainDimension();
-  //    const int trialComponentCount = m_trialExpression.codomainDimension();
-  //    const int dofCountA = basisA.size();
-  //    const int dofCountB = localDofIndexB == ALL_DOFS ? basisB.size() : 1;
-  //    const int testDofCount = callVariant == TEST_TRIAL ? dofCountA :
-  // dofCountB;
-  //    const int trialDofCount = callVariant == TEST_TRIAL ? dofCountB :
-  // dofCountA;
-
-  //    const int kernelRowCount = m_kernels.codomainDimension();
-  //    const int kernelColCount = m_kernels.domainDimension();
-
-  //    // Assert that the kernel tensor dimensions are compatible
-  //    // with the number of components of the functions
-
-  //    // TODO: This will need to be modified once we allow scalar-valued
-  // kernels
-  //    // (treated as if they were multiplied by the unit tensor) with
-  //    // vector-valued functions
-  //    assert(testComponentCount == kernelRowCount);
-  //    assert(kernelColCount == trialComponentCount);
-
-  //    int argIdx;
-  //    int testBasisDeps = 0, trialBasisDeps = 0;
-  //    int testGeomDeps = INTEGRATION_ELEMENTS;
-  //    int trialGeomDeps = INTEGRATION_ELEMENTS;
-
-  //    cl::Buffer *clElementIndicesA;
-  //    cl::Buffer *clGlobalTrialPoints;
-  //    cl::Buffer *clGlobalTestPoints;
-  //    cl::Buffer *clGlobalTrialNormals;
-  //    cl::Buffer *clTrialValues;
-  //    cl::Buffer *clTestValues;
-  //    cl::Buffer *clTrialIntegrationElements;
-  //    cl::Buffer *clTestIntegrationElements;
-  //    cl::Buffer *clResult;
-
-  //    m_testExpression.addDependencies(testBasisDeps, testGeomDeps);
-  //    m_trialExpression.addDependencies(trialBasisDeps, trialGeomDeps);
-  //    m_kernels.addGeometricalDependencies(testGeomDeps, trialGeomDeps);
-
-  //    result.set_size(testDofCount, trialDofCount, elementACount);
-
-  //    //    t0 = tbb::tick_count::now();
-  //    clElementIndicesA = m_openClHandler.pushVector<int> (elementIndicesA);
-  //    clResult = m_openClHandler.createBuffer<ResultType>
-  // (testDofCount*trialDofCount*elementACount,
-  //							 CL_MEM_WRITE_ONLY);
-  //    //    dt_buf += tbb::tick_count::now()-t0;
-
-  //    // Build the OpenCL program
-  //    //    t0 = tbb::tick_count::now();
-  //    cl::Program::Sources sources;
-  //    sources.push_back (m_openClHandler.initStr());
-  //    sources.push_back (basisA.clCodeString(true));
-  //    sources.push_back (basisB.clCodeString(false));
-  //    sources.push_back (m_kernels.evaluateClCode());
-  //    sources.push_back (clStrIntegrateRowOrCol());
-  //    m_openClHandler.loadProgramFromStringArray (sources);
-  //    //    dt_prog += tbb::tick_count::now()-t0;
-
-  //    // Call the CL kernels to map the trial and test quadrature points
-  //    if (callVariant == TEST_TRIAL)
-  //    {
-  //        //        t0 = tbb::tick_count::now();
-  //        clGlobalTestPoints = m_openClHandler.createBuffer<CoordinateType>(
-  //            elementACount*testPointCount*meshDim, CL_MEM_READ_WRITE);
-  //	clTestIntegrationElements =
-  //m_openClHandler.createBuffer<CoordinateType>(
-  //	    elementACount*testPointCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clMapTest = m_openClHandler.setKernel
-  //("clMapPointsToElements");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clMapTest, 0);
-  //	clMapTest.setArg (argIdx++, *clTestQuadPoints);
-  //	clMapTest.setArg (argIdx++, testPointCount);
-  //	clMapTest.setArg (argIdx++, pointDim);
-  //	clMapTest.setArg (argIdx++, *clElementIndicesA);
-  //	clMapTest.setArg (argIdx++, elementACount);
-  //	clMapTest.setArg (argIdx++, *clGlobalTestPoints);
-  //	clMapTest.setArg (argIdx++, *clTestIntegrationElements);
-
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(elementACount,
-  //testPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-
-  //	//        t0 = tbb::tick_count::now();
-  //        clGlobalTrialPoints = m_openClHandler.createBuffer<CoordinateType> (
-  //	    trialPointCount*meshDim, CL_MEM_READ_WRITE);
-  //        clGlobalTrialNormals = m_openClHandler.createBuffer<CoordinateType>
-  // (
-  //	    trialPointCount*meshDim, CL_MEM_READ_WRITE);
-  //	clTrialIntegrationElements =
-  //m_openClHandler.createBuffer<CoordinateType>(
-  //	    trialPointCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clMapTrial = m_openClHandler.setKernel
-  //("clMapPointsAndNormalsToElement");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clMapTrial, 0);
-  //	clMapTrial.setArg (argIdx++, *clTestQuadPoints);
-  //	clMapTrial.setArg (argIdx++, trialPointCount);
-  //	clMapTrial.setArg (argIdx++, pointDim);
-  //	clMapTrial.setArg (argIdx++, elementIndexB);
-  //	clMapTrial.setArg (argIdx++, *clGlobalTrialPoints);
-  //	clMapTrial.setArg (argIdx++, *clGlobalTrialNormals);
-  //	clMapTrial.setArg (argIdx++, *clTrialIntegrationElements);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(trialPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-
-  //	//        t0 = tbb::tick_count::now();
-  //	clTestValues = m_openClHandler.createBuffer<BasisFunctionType> (
-  //	    elementACount*testPointCount*testDofCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clBasisTest = m_openClHandler.setKernel
-  //("clBasisfAElements");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clBasisTest, 0);
-  //	clBasisTest.setArg (argIdx++, *clElementIndicesA);
-  //	clBasisTest.setArg (argIdx++, elementACount);
-  //	clBasisTest.setArg (argIdx++, *clTestQuadPoints);
-  //	clBasisTest.setArg (argIdx++, testPointCount);
-  //	clBasisTest.setArg (argIdx++, pointDim);
-  //	clBasisTest.setArg (argIdx++, testDofCount);
-  //	clBasisTest.setArg (argIdx++, *clTestValues);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(elementACount,
-  //testPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-
-  //	//        t0 = tbb::tick_count::now();
-  //	clTrialValues = m_openClHandler.createBuffer<BasisFunctionType> (
-  //	    trialPointCount*trialDofCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clBasisTrial = m_openClHandler.setKernel
-  //("clBasisfBElement");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clBasisTrial, 0);
-  //	clBasisTrial.setArg (argIdx++, elementIndexB);
-  //	clBasisTrial.setArg (argIdx++, *clTrialQuadPoints);
-  //	clBasisTrial.setArg (argIdx++, trialPointCount);
-  //	clBasisTrial.setArg (argIdx++, pointDim);
-  //	clBasisTrial.setArg (argIdx++, trialDofCount);
-  //	clBasisTrial.setArg (argIdx++, localDofIndexB);
-  //	clBasisTrial.setArg (argIdx++, *clTrialValues);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(trialPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-  //    }
-  //    else
-  //    {
-  //      //        t0 = tbb::tick_count::now();
-  //        clGlobalTrialPoints = m_openClHandler.createBuffer<CoordinateType> (
-  //	    elementACount*trialPointCount*meshDim, CL_MEM_READ_WRITE);
-  //        clGlobalTrialNormals = m_openClHandler.createBuffer<CoordinateType>
-  // (
-  //	    elementACount*trialPointCount*meshDim, CL_MEM_READ_WRITE);
-  //	clTrialIntegrationElements =
-  //m_openClHandler.createBuffer<CoordinateType> (
-  //	    elementACount*trialPointCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clMapTrial = m_openClHandler.setKernel
-  //("clMapPointsAndNormalsToElements");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clMapTrial, 0);
-  //	clMapTrial.setArg (argIdx++, *clTrialQuadPoints);
-  //	clMapTrial.setArg (argIdx++, trialPointCount);
-  //	clMapTrial.setArg (argIdx++, pointDim);
-  //	clMapTrial.setArg (argIdx++, *clElementIndicesA);
-  //	clMapTrial.setArg (argIdx++, elementACount);
-  //	clMapTrial.setArg (argIdx++, *clGlobalTrialPoints);
-  //	clMapTrial.setArg (argIdx++, *clGlobalTrialNormals);
-  //	clMapTrial.setArg (argIdx++, *clTrialIntegrationElements);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(elementACount,
-  //trialPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-
-  //	//        t0 = tbb::tick_count::now();
-  //	clGlobalTestPoints = m_openClHandler.createBuffer<CoordinateType> (
-  //            testPointCount*meshDim, CL_MEM_READ_WRITE);
-  //	clTestIntegrationElements = m_openClHandler.createBuffer<CoordinateType>
-  //(
-  //	    testPointCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clMapTest = m_openClHandler.setKernel
-  //("clMapPointsToElement");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clMapTest, 0);
-  //	clMapTest.setArg (argIdx++, *clTestQuadPoints);
-  //	clMapTest.setArg (argIdx++, testPointCount);
-  //	clMapTest.setArg (argIdx++, pointDim);
-  //	clMapTest.setArg (argIdx++, elementIndexB);
-  //	clMapTest.setArg (argIdx++, *clGlobalTestPoints);
-  //	clMapTest.setArg (argIdx++, *clTestIntegrationElements);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(testPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-
-  //	//        t0 = tbb::tick_count::now();
-  //	clTrialValues = m_openClHandler.createBuffer<BasisFunctionType> (
-  //	    elementACount*trialPointCount*trialDofCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clBasisTrial = m_openClHandler.setKernel
-  //("clBasisfAElements");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clBasisTrial, 0);
-  //	clBasisTrial.setArg (argIdx++, *clElementIndicesA);
-  //	clBasisTrial.setArg (argIdx++, elementACount);
-  //	clBasisTrial.setArg (argIdx++, *clTrialQuadPoints);
-  //	clBasisTrial.setArg (argIdx++, trialPointCount);
-  //	clBasisTrial.setArg (argIdx++, pointDim);
-  //	clBasisTrial.setArg (argIdx++, trialDofCount);
-  //	clBasisTrial.setArg (argIdx++, *clTrialValues);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(elementACount,
-  //trialPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-
-  //	//        t0 = tbb::tick_count::now();
-  //	clTestValues = m_openClHandler.createBuffer<BasisFunctionType> (
-  //	    testPointCount*testDofCount, CL_MEM_READ_WRITE);
-  //	//	dt_buf += tbb::tick_count::now()-t0;
-  //	cl::Kernel &clBasisTest = m_openClHandler.setKernel
-  //("clBasisfBElement");
-  //	argIdx = m_openClHandler.SetGeometryArgs (clBasisTest, 0);
-  //	clBasisTest.setArg (argIdx++, elementIndexB);
-  //	clBasisTest.setArg (argIdx++, *clTestQuadPoints);
-  //	clBasisTest.setArg (argIdx++, testPointCount);
-  //	clBasisTest.setArg (argIdx++, pointDim);
-  //	clBasisTest.setArg (argIdx++, testDofCount);
-  //	clBasisTest.setArg (argIdx++, localDofIndexB);
-  //	clBasisTest.setArg (argIdx++, *clTestValues);
-  //	//        t0 = tbb::tick_count::now();
-  //	m_openClHandler.enqueueKernel (cl::NDRange(testPointCount));
-  //	//	dt_kern += tbb::tick_count::now()-t0;
-  //    }
-
-  //    // Build the OpenCL kernel
-  //    cl::Kernel &clKernel = m_openClHandler.setKernel ("clIntegrate");
-
-  //    // Set kernel arguments
-  //    argIdx = m_openClHandler.SetGeometryArgs (clKernel, 0);
-  //    clKernel.setArg (argIdx++, *clGlobalTrialPoints);
-  //    clKernel.setArg (argIdx++, *clGlobalTestPoints);
-  //    clKernel.setArg (argIdx++, *clGlobalTrialNormals);
-  //    clKernel.setArg (argIdx++, *clTrialIntegrationElements);
-  //    clKernel.setArg (argIdx++, *clTestIntegrationElements);
-  //    clKernel.setArg (argIdx++, *clTrialValues);
-  //    clKernel.setArg (argIdx++, *clTestValues);
-  //    clKernel.setArg (argIdx++, *clTrialQuadWeights);
-  //    clKernel.setArg (argIdx++, *clTestQuadWeights);
-  //    clKernel.setArg (argIdx++, trialPointCount);
-  //    clKernel.setArg (argIdx++, testPointCount);
-  //    clKernel.setArg (argIdx++, trialComponentCount);
-  //    clKernel.setArg (argIdx++, testComponentCount);
-  //    clKernel.setArg (argIdx++, trialDofCount);
-  //    clKernel.setArg (argIdx++, testDofCount);
-  //    clKernel.setArg (argIdx++, elementACount);
-  //    clKernel.setArg (argIdx++, callVariant == TEST_TRIAL ? 1:0);
-  //    clKernel.setArg (argIdx++, *clElementIndicesA);
-  //    clKernel.setArg (argIdx++, elementIndexB);
-  //    clKernel.setArg (argIdx++, *clResult);
-
-  //    // Run the CL kernel
-  //    //    t0 = tbb::tick_count::now();
-  //    m_openClHandler.enqueueKernel (cl::NDRange(elementACount));
-  //    //    dt_kern += tbb::tick_count::now()-t0;
-
-  //    // Copy results back
-  //    //    t0 = tbb::tick_count::now();
-  //    m_openClHandler.pullCube<ResultType> (*clResult, result);
-  //    //  dt_pull += tbb::tick_count::now()-t0;
-
-  //    // Clean up local device buffers
-  //    delete clElementIndicesA;
-  //    delete clGlobalTrialPoints;
-  //    delete clGlobalTestPoints;
-  //    delete clGlobalTrialNormals;
-  //    delete clTestValues;
-  //    delete clTrialValues;
-  //    delete clTrialIntegrationElements;
-  //    delete clTestIntegrationElements;
-  //    delete clResult;
-
-  //    //  t_end = tbb::tick_count::now();
-  //    //  static int callcount = 0;
-  //    //  std::cout << callcount++ << '\t' << (t_end-t_start).seconds()
-  //    //	      << "\tprog=" << dt_prog.seconds()
-  //    //	      << "\tbuf=" << dt_buf.seconds()
-  //    //	      << "\tkern=" << dt_kern.seconds()
-  //    //	      << "\tpull=" << dt_pull.seconds()
-  //    //	      << std::endl;
-
-  //#else
-  //    throw std::runtime_error ("Trying to call OpenCL method without OpenCL
-  // support");
-  //#endif // WITH_OPENCL
+#ifdef WITH_OPENCL
+  if (m_clRegularIntegration) {
+    if (result.size() != elementIndicesA.size())
+      throw std::invalid_argument(
+          "SeparableNumericalTestKernelTrialIntegrator::integrate(): "
+          "arrays 'result' and 'elementIndicesA' must have the same number "
+          "of elements");
+
+    // Integrate over all DOFs of element B and pick the requested one
+    std::vector<ElementIndexPair> pairs(elementIndicesA.size());
+    for (size_t i = 0; i < elementIndicesA.size(); ++i)
+      pairs[i] = callVariant == TEST_TRIAL
+                     ? ElementIndexPair(elementIndicesA[i], elementIndexB)
+                     : ElementIndexPair(elementIndexB, elementIndicesA[i]);
+    const Shapeset<BasisFunctionType> &testShapeset =
+        callVariant == TEST_TRIAL ? basisA : basisB;
+    const Shapeset<BasisFunctionType> &trialShapeset =
+        callVariant == TEST_TRIAL ? basisB : basisA;
+    if (localDofIndexB == ALL_DOFS) {
+      if (integrateRegularPairsCl(pairs, testShapeset, trialShapeset, result))
+        return;
+    } else {
+      std::vector<arma::Mat<ResultType>> fullResultStorage(result.size());
+      std::vector<arma::Mat<ResultType> *> fullResult(result.size());
+      for (size_t i = 0; i < result.size(); ++i)
+        fullResult[i] = &fullResultStorage[i];
+      if (integrateRegularPairsCl(pairs, testShapeset, trialShapeset,
+                                  fullResult)) {
+        for (size_t i = 0; i < result.size(); ++i) {
+          assert(result[i]);
+          if (callVariant == TEST_TRIAL)
+            *result[i] = fullResultStorage[i].col(localDofIndexB);
+          else
+            *result[i] = fullResultStorage[i].row(localDofIndexB);
+        }
+        return;
+      }
+    }
+  }
+#endif // WITH_OPENCL
+  integrateCpu(callVariant, elementIndicesA, elementIndexB, basisA, basisB,
+               localDofIndexB, result);
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -717,10 +539,8 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
   const int trialDofCount = trialShapeset.size();
 
   BasisData<BasisFunctionType> testBasisData, trialBasisData;
-  GeometricalData<CoordinateType> *testGeomData = &m_testGeomData.local();
-  GeometricalData<CoordinateType> *trialGeomData = &m_trialGeomData.local();
-  const GeometricalData<CoordinateType> *constTestGeomData = testGeomData;
-  const GeometricalData<CoordinateType> *constTrialGeomData = trialGeomData;
+  const GeometricalData<CoordinateType> *constTestGeomData = 0;
+  const GeometricalData<CoordinateType> *constTrialGeomData = 0;
 
   size_t testBasisDeps = 0, trialBasisDeps = 0;
   size_t testGeomDeps = 0, trialGeomDeps = 0;
@@ -738,9 +558,6 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
     trialGeometry = m_trialGeometryFactory.make();
   }
 
-  CollectionOf3dArrays<BasisFunctionType> testValues, trialValues;
-  CollectionOf4dArrays<KernelType> kernelValues;
-
   for (size_t i = 0; i < result.size(); ++i) {
     assert(result[i]);
     result[i]->set_size(testDofCount, trialDofCount);
@@ -751,38 +568,28 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
   trialShapeset.evaluate(trialBasisDeps, m_localTrialQuadPoints, ALL_DOFS,
                          trialBasisData);
 
-  // Iterate over the elements
+  // Iterate over the element pairs and integrate in batches. A batch is
+  // closed early before the cached data of its elements would be evicted.
+  ElementCache &testCache = m_testElementCache.local();
+  ElementCache &trialCache = m_trialElementCache.local();
+  PairBatch &batch = m_pairBatch.local();
+  batch.clear();
   for (int pairIndex = 0; pairIndex < geometryPairCount; ++pairIndex) {
     const int testElementIndex = elementIndexPairs[pairIndex].first;
     const int trialElementIndex = elementIndexPairs[pairIndex].second;
-    if (m_cacheGeometricalData) {
-      constTestGeomData = &m_cachedTestGeomData[testElementIndex];
-      constTrialGeomData = &m_cachedTrialGeomData[trialElementIndex];
-    } else {
-      m_testRawGeometry.setupGeometry(testElementIndex, *testGeometry);
-      m_trialRawGeometry.setupGeometry(trialElementIndex, *trialGeometry);
-      testGeometry->getData(testGeomDeps, m_localTestQuadPoints, *testGeomData);
-      if (testGeomDeps & DOMAIN_INDEX)
-        testGeomData->domainIndex =
-            m_testRawGeometry.domainIndex(testElementIndex);
-      trialGeometry->getData(trialGeomDeps, m_localTrialQuadPoints,
-                             *trialGeomData);
-      if (trialGeomDeps & DOMAIN_INDEX)
-        trialGeomData->domainIndex =
-            m_trialRawGeometry.domainIndex(trialElementIndex);
-    }
-    m_testTransformations.evaluate(testBasisData, *constTestGeomData,
-                                   testValues);
-    m_trialTransformations.evaluate(trialBasisData, *constTrialGeomData,
-                                    trialValues);
-
-    m_kernels.evaluateOnGrid(*constTestGeomData, *constTrialGeomData,
-                             kernelValues);
-    m_integral.evaluateWithTensorQuadratureRule(
-        *constTestGeomData, *constTrialGeomData, testValues, trialValues,
-        kernelValues, m_testQuadWeights, m_trialQuadWeights,
-        *result[pairIndex]);
+    if (batch.full() || testCache.conflicts(testElementIndex, testShapeset) ||
+        trialCache.conflicts(trialElementIndex, trialShapeset))
+      evaluateBatch(batch);
+    const CollectionOf3dArrays<BasisFunctionType> &testValues =
+        elementData(true, testElementIndex, testShapeset, testBasisData,
+                    testGeomDeps, testGeometry.get(), constTestGeomData);
+    const CollectionOf3dArrays<BasisFunctionType> &trialValues =
+        elementData(false, trialElementIndex, trialShapeset, trialBasisData,
+                    trialGeomDeps, trialGeometry.get(), constTrialGeomData);
+    batch.add(constTestGeomData, constTrialGeomData, &testValues,
+              &trialValues, result[pairIndex]);
   }
+  evaluateBatch(batch);
 }
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
@@ -793,220 +600,161 @@ void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
                 const Shapeset<BasisFunctionType> &testShapeset,
                 const Shapeset<BasisFunctionType> &trialShapeset,
                 const std::vector<arma::Mat<ResultType> *> &result) const {
-  //#ifdef WITH_OPENCL
-  //    const int testPointCount = m_localTestQuadPoints.n_cols;
-  //    const int trialPointCount = m_localTrialQuadPoints.n_cols;
-  //    const int geometryPairCount = elementIndexPairs.size();
-  //    const int pointDim = m_localTestQuadPoints.n_rows;
-  //    const int meshDim = m_openClHandler.meshGeom().size.dim;
-
-  //    if (testPointCount == 0 || trialPointCount == 0 || geometryPairCount ==
-  // 0)
-  //        return;
-  //    // TODO: in the (pathological) case that pointCount == 0 but
-  //    // geometryPairCount != 0, set elements of result to 0.
-
-  //    // TODO: add support for multiple-term expressions.
-  //    if (!m_testTransformation.isTrivial() ||
-  // !m_trialTransformation.isTrivial())
-  //        throw
-  // std::runtime_error("SeparableNumericalTestKernelTrialIntegrator::"
-  //                                 "integrateCl(): multiple-term expression
-  // lists are "
-  //                                 "not supported in the OpenCL mode yet");
-  //    const Expression<CoordinateType>& m_testExpression =
-  // m_testTransformation.term(0);
-  //    const Expression<CoordinateType>& m_trialExpression =
-  // m_trialTransformation.term(0);
-
-  //    // Evaluate constants
-  //    const int testComponentCount = m_testExpression.codomainDimension();
-  //    const int trialComponentCount = m_trialExpression.codomainDimension();
-  //    const int testDofCount = testShapeset.size();
-  //    const int trialDofCount = trialShapeset.size();
-
-  //    const int kernelRowCount = m_kernels.codomainDimension();
-  //    const int kernelColCount = m_kernels.domainDimension();
-
-  //    // Assert that the kernel tensor dimensions are compatible
-  //    // with the number of components of the functions
-
-  //    const bool scalarKernel = (kernelRowCount == 1 && kernelColCount == 1);
-  //    if (scalarKernel)
-  //        assert(testComponentCount == trialComponentCount);
-  //    else
-  //    {
-  //        assert(testComponentCount == kernelRowCount);
-  //        assert(kernelColCount == trialComponentCount);
-  //    }
-
-  //    result.set_size(testDofCount, trialDofCount, geometryPairCount);
-
-  //    int argIdx;
-
-  //    // define device buffers
-  //    cl::Buffer *clElementIndexA;
-  //    cl::Buffer *clElementIndexB;
-  //    cl::Buffer *clGlobalTrialPoints;
-  //    cl::Buffer *clGlobalTestPoints;
-  //    cl::Buffer *clGlobalTrialNormals;
-  //    cl::Buffer *clTrialIntegrationElements;
-  //    cl::Buffer *clTestIntegrationElements;
-  //    cl::Buffer *clTrialValues;
-  //    cl::Buffer *clTestValues;
-  //    cl::Buffer *clResult;
-
-  //    // Build the OpenCL program
-  //    //std::vector<std::string> sources;
-  //    cl::Program::Sources sources;
-  //    sources.push_back (m_openClHandler.initStr());
-  //    sources.push_back (testShapeset.clCodeString(true));
-  //    sources.push_back (trialShapeset.clCodeString(false));
-  //    sources.push_back (m_kernels.evaluateClCode());
-  //    sources.push_back (clStrIntegrateRowOrCol());
-  //    m_openClHandler.loadProgramFromStringArray (sources);
-
-  //    // we need to separate the two index lists
-  //    std::vector<int> elementIndexA(geometryPairCount);
-  //    std::vector<int> elementIndexB(geometryPairCount);
-  //    for (int i = 0; i < geometryPairCount; i++) {
-  //        elementIndexA[i] = elementIndexPairs[i].first;
-  //	elementIndexB[i] = elementIndexPairs[i].second;
-  //    }
-
-  //    // push the element index pairs
-  //    clElementIndexA = m_openClHandler.pushVector<int> (elementIndexA);
-  //    clElementIndexB = m_openClHandler.pushVector<int> (elementIndexB);
-  //    clGlobalTestPoints = m_openClHandler.createBuffer<CoordinateType> (
-  //        geometryPairCount*testPointCount*meshDim, CL_MEM_READ_WRITE);
-  //    clGlobalTrialPoints = m_openClHandler.createBuffer<CoordinateType> (
-  //        geometryPairCount*trialPointCount*meshDim, CL_MEM_READ_WRITE);
-  //    clGlobalTrialNormals = m_openClHandler.createBuffer<CoordinateType> (
-  //	geometryPairCount*trialPointCount*meshDim, CL_MEM_READ_WRITE);
-  //    clTestIntegrationElements = m_openClHandler.createBuffer<CoordinateType>
-  // (
-  //        geometryPairCount*testPointCount, CL_MEM_READ_WRITE);
-  //    clTrialIntegrationElements =
-  // m_openClHandler.createBuffer<CoordinateType> (
-  //        geometryPairCount*trialPointCount, CL_MEM_READ_WRITE);
-  //    clTestValues = m_openClHandler.createBuffer<BasisFunctionType> (
-  //	geometryPairCount*testPointCount*testDofCount, CL_MEM_READ_WRITE);
-  //    clTrialValues = m_openClHandler.createBuffer<BasisFunctionType> (
-  //	geometryPairCount*trialPointCount*trialDofCount, CL_MEM_READ_WRITE);
-  //    clResult = m_openClHandler.createBuffer<ResultType>
-  // (testDofCount*trialDofCount*geometryPairCount,
-  //        CL_MEM_WRITE_ONLY);
-
-  //    // Call the CL kernels to map the trial and test quadrature points
-  //    cl::Kernel &clMapTest = m_openClHandler.setKernel
-  // ("clMapPointsToElements");
-  //    argIdx = m_openClHandler.SetGeometryArgs (clMapTest, 0);
-  //    clMapTest.setArg (argIdx++, *clTestQuadPoints);
-  //    clMapTest.setArg (argIdx++, testPointCount);
-  //    clMapTest.setArg (argIdx++, pointDim);
-  //    clMapTest.setArg (argIdx++, *clElementIndexA);
-  //    clMapTest.setArg (argIdx++, geometryPairCount);
-  //    clMapTest.setArg (argIdx++, *clGlobalTestPoints);
-  //    clMapTest.setArg (argIdx++, *clTestIntegrationElements);
-  //    m_openClHandler.enqueueKernel (cl::NDRange(geometryPairCount,
-  // testPointCount));
-
-  //    cl::Kernel &clMapTrial = m_openClHandler.setKernel
-  // ("clMapPointsAndNormalsToElements");
-  //    argIdx = m_openClHandler.SetGeometryArgs (clMapTrial, 0);
-  //    clMapTrial.setArg (argIdx++, *clTrialQuadPoints);
-  //    clMapTrial.setArg (argIdx++, trialPointCount);
-  //    clMapTrial.setArg (argIdx++, pointDim);
-  //    clMapTrial.setArg (argIdx++, *clElementIndexB);
-  //    clMapTrial.setArg (argIdx++, *clGlobalTrialPoints);
-  //    clMapTrial.setArg (argIdx++, *clGlobalTrialNormals);
-  //    clMapTrial.setArg (argIdx++, *clTrialIntegrationElements);
-  //    m_openClHandler.enqueueKernel (cl::NDRange(geometryPairCount,
-  // trialPointCount));
-
-  //    cl::Kernel &clBasisTest = m_openClHandler.setKernel
-  // ("clBasisAElements");
-  //    argIdx = m_openClHandler.SetGeometryArgs (clBasisTest, 0);
-  //    clBasisTest.setArg (argIdx++, *clElementIndexA);
-  //    clBasisTest.setArg (argIdx++, geometryPairCount);
-  //    clBasisTest.setArg (argIdx++, *clTestQuadPoints);
-  //    clBasisTest.setArg (argIdx++, testPointCount);
-  //    clBasisTest.setArg (argIdx++, pointDim);
-  //    clBasisTest.setArg (argIdx++, testDofCount);
-  //    clBasisTest.setArg (argIdx++, *clTestValues);
-  //    m_openClHandler.enqueueKernel (cl::NDRange(geometryPairCount,
-  // testPointCount));
-
-  //    cl::Kernel &clBasisTrial = m_openClHandler.setKernel
-  // ("clBasisBElements");
-  //    argIdx = m_openClHandler.SetGeometryArgs (clBasisTrial, 0);
-  //    clBasisTest.setArg (argIdx++, *clElementIndexB);
-  //    clBasisTest.setArg (argIdx++, geometryPairCount);
-  //    clBasisTest.setArg (argIdx++, *clTrialQuadPoints);
-  //    clBasisTest.setArg (argIdx++, trialPointCount);
-  //    clBasisTest.setArg (argIdx++, pointDim);
-  //    clBasisTest.setArg (argIdx++, trialDofCount);
-  //    clBasisTest.setArg (argIdx++, *clTrialValues);
-  //    m_openClHandler.enqueueKernel (cl::NDRange(geometryPairCount,
-  // trialPointCount));
-
-  //    // Build the OpenCL kernel
-  //    cl::Kernel &clKernel = m_openClHandler.setKernel (scalarKernel ?
-  //        "clIntegratePairsScalar" : "clIntegratePairs");
-
-  //    // Set kernel arguments
-  //    argIdx = m_openClHandler.SetGeometryArgs (clKernel, 0);
-  //    clKernel.setArg (argIdx++, *clGlobalTrialPoints);
-  //    clKernel.setArg (argIdx++, *clGlobalTestPoints);
-  //    clKernel.setArg (argIdx++, *clGlobalTrialNormals);
-  //    clKernel.setArg (argIdx++, *clTrialIntegrationElements);
-  //    clKernel.setArg (argIdx++, *clTestIntegrationElements);
-  //    clKernel.setArg (argIdx++, *clTrialValues);
-  //    clKernel.setArg (argIdx++, *clTestValues);
-  //    clKernel.setArg (argIdx++, *clTrialQuadWeights);
-  //    clKernel.setArg (argIdx++, *clTestQuadWeights);
-  //    clKernel.setArg (argIdx++, trialPointCount);
-  //    clKernel.setArg (argIdx++, testPointCount);
-  //    clKernel.setArg (argIdx++, trialComponentCount);
-  //    clKernel.setArg (argIdx++, testComponentCount);
-  //    clKernel.setArg (argIdx++, trialDofCount);
-  //    clKernel.setArg (argIdx++, testDofCount);
-  //    clKernel.setArg (argIdx++, geometryPairCount);
-  //    clKernel.setArg (argIdx++, *clElementIndexA);
-  //    clKernel.setArg (argIdx++, *clElementIndexB);
-  //    clKernel.setArg (argIdx++, *clResult);
-
-  //    // Run the CL kernel
-  //    m_openClHandler.enqueueKernel (cl::NDRange(geometryPairCount));
-
-  //    // Copy results back
-  //    m_openClHandler.pullCube<ResultType> (*clResult, result);
-
-  //    // clean up local device buffers
-  //    delete clElementIndexA;
-  //    delete clElementIndexB;
-  //    delete clGlobalTestPoints;
-  //    delete clGlobalTrialPoints;
-  //    delete clGlobalTrialNormals;
-  //    delete clTrialIntegrationElements;
-  //    delete clTestIntegrationElements;
-  //    delete clTestValues;
-  //    delete clTrialValues;
-  //    delete clResult;
-
-  //#else
-  //    throw std::runtime_error ("Trying to call OpenCL method without OpenCL
-  // support");
-  //#endif // WITH_OPENCL
+#ifdef WITH_OPENCL
+  if (m_clRegularIntegration &&
+      integrateRegularPairsCl(elementIndexPairs, testShapeset, trialShapeset,
+                              result))
+    return;
+#endif // WITH_OPENCL
+  integrateCpu(elementIndexPairs, testShapeset, trialShapeset, result);
+}
+
+#ifdef WITH_OPENCL
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+void SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
+                                                 ResultType, GeometryFactory>::
+    evaluateClShapeFunctionValues(
+        const Shapeset<BasisFunctionType> &shapeset,
+        const arma::Mat<CoordinateType> &localQuadPoints,
+        const CollectionOfShapesetTransformations<CoordinateType> &
+            transformations,
+        std::vector<std::complex<double>> &values) const {
+  // The transformations depend only on the shape function values (this was
+  // checked in the constructor), so they need no geometrical data
+  BasisData<BasisFunctionType> basisData;
+  GeometricalData<CoordinateType> geomData;
+  CollectionOf3dArrays<BasisFunctionType> transformedValues;
+  shapeset.evaluate(VALUES, localQuadPoints, ALL_DOFS, basisData);
+  transformations.evaluate(basisData, geomData, transformedValues);
+
+  const _3dArray<BasisFunctionType> &v = transformedValues[0];
+  const int dofCount = v.extent(1);
+  const int pointCount = v.extent(2);
+  values.resize(dofCount * pointCount);
+  for (int point = 0; point < pointCount; ++point)
+    for (int dof = 0; dof < dofCount; ++dof)
+      values[dof + point * dofCount] = v(0, dof, point);
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType,
+          typename GeometryFactory>
+bool SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType, KernelType,
+                                                 ResultType, GeometryFactory>::
+    integrateRegularPairsCl(
+        const std::vector<ElementIndexPair> &elementIndexPairs,
+        const Shapeset<BasisFunctionType> &testShapeset,
+        const Shapeset<BasisFunctionType> &trialShapeset,
+        const std::vector<arma::Mat<ResultType> *> &result) const {
+  // Must match MAX_DOF_COUNT in CL/regular_scalar_double_integrator.cl
+  const int maxDofCount = 6;
+  // Number of pairs sent to the device at once
+  const int maxBlockSize = 16384;
+
+  const int testPointCount = m_localTestQuadPoints.n_cols;
+  const int trialPointCount = m_localTrialQuadPoints.n_cols;
+  const int geometryPairCount = elementIndexPairs.size();
+  const int testDofCount = testShapeset.size();
+  const int trialDofCount = trialShapeset.size();
+
+  if (testDofCount > maxDofCount || trialDofCount > maxDofCount)
+    return false;
+  if (result.size() != elementIndexPairs.size())
+    throw std::invalid_argument(
+        "SeparableNumericalTestKernelTrialIntegrator::integrate(): "
+        "arrays 'result' and 'elementIndexPairs' must have the same number "
+        "of elements");
+  if (testPointCount == 0 || trialPointCount == 0 || geometryPairCount == 0)
+    return true;
+
+  std::vector<std::complex<double>> testValues, trialValues;
+  evaluateClShapeFunctionValues(testShapeset, m_localTestQuadPoints,
+                                m_testTransformations, testValues);
+  evaluateClShapeFunctionValues(trialShapeset, m_localTrialQuadPoints,
+                                m_trialTransformations, trialValues);
+
+  for (size_t i = 0; i < result.size(); ++i) {
+    assert(result[i]);
+    result[i]->set_size(testDofCount, trialDofCount);
+  }
+
+  tbb::mutex::scoped_lock lock(m_openClHandler.mutex());
+
+  cl::Program::Sources sources;
+  sources.push_back(m_openClHandler.initStr());
+  sources.push_back(clStrIntegrateRegularPairs());
+  m_openClHandler.loadProgramFromStringArray(sources);
+  cl::Kernel &clKernel = m_openClHandler.setKernel("clIntegrateRegularPairs");
+
+  cl::Buffer *clTestValues =
+      m_openClHandler.pushVector<std::complex<double>>(testValues);
+  cl::Buffer *clTrialValues =
+      m_openClHandler.pushVector<std::complex<double>>(trialValues);
+
+  const int blockSize = std::min(geometryPairCount, maxBlockSize);
+  const int dofPairCount = testDofCount * trialDofCount;
+  std::vector<int> pairs(2 * blockSize);
+  std::vector<std::complex<double>> blockResult(blockSize * dofPairCount);
+  cl::Buffer *clResult = m_openClHandler.createBuffer<std::complex<double>>(
+      blockSize * dofPairCount, CL_MEM_WRITE_ONLY);
+
+  int argIdx = m_openClHandler.SetGeometryArgs(clKernel, 0);
+  clKernel.setArg(argIdx++, *clTestQuadPoints);
+  clKernel.setArg(argIdx++, *clTestQuadWeights);
+  clKernel.setArg(argIdx++, testPointCount);
+  clKernel.setArg(argIdx++, *clTrialQuadPoints);
+  clKernel.setArg(argIdx++, *clTrialQuadWeights);
+  clKernel.setArg(argIdx++, trialPointCount);
+  clKernel.setArg(argIdx++, *clTestValues);
+  clKernel.setArg(argIdx++, testDofCount);
+  clKernel.setArg(argIdx++, *clTrialValues);
+  clKernel.setArg(argIdx++, trialDofCount);
+  clKernel.setArg(argIdx++, int(m_clKernelType));
+  clKernel.setArg(argIdx++, m_clWaveNumber.real());
+  clKernel.setArg(argIdx++, m_clWaveNumber.imag());
+  const int pairsArgIdx = argIdx;
+
+  for (int start = 0; start < geometryPairCount; start += blockSize) {
+    const int pairCount = std::min(blockSize, geometryPairCount - start);
+    for (int i = 0; i < pairCount; ++i) {
+      pairs[2 * i] = elementIndexPairs[start + i].first;
+      pairs[2 * i + 1] = elementIndexPairs[start + i].second;
+    }
+    cl::Buffer *clPairs = m_openClHandler.pushVector<int>(pairs);
+    argIdx = pairsArgIdx;
+    clKernel.setArg(argIdx++, *clPairs);
+    clKernel.setArg(argIdx++, pairCount);
+    clKernel.setArg(argIdx++, *clResult);
+    m_openClHandler.enqueueKernel(cl::NDRange(pairCount));
+    m_openClHandler.pullVector<std::complex<double>>(
+        *clResult, blockResult, pairCount * dofPairCount);
+    delete clPairs;
+
+    for (int i = 0; i < pairCount; ++i) {
+      arma::Mat<ResultType> &r = *result[start + i];
+      for (int dof = 0; dof < dofPairCount; ++dof)
+        setClResult(blockResult[i * dofPairCount + dof], r[dof]);
+    }
+  }
+
+  delete clResult;
+  delete clTrialValues;
+  delete clTestValues;
+  return true;
 }
 
+#endif // WITH_OPENCL
+
+#ifdef WITH_OPENCL
 template <typename BasisFunctionType, typename KernelType, typename ResultType,
           typename GeometryFactory>
 const std::pair<const char *, int> SeparableNumericalTestKernelTrialIntegrator<
     BasisFunctionType, KernelType, ResultType,
-    GeometryFactory>::clStrIntegrateRowOrCol() const {
-  return std::make_pair(separable_numerical_double_integrator_cl,
-                        separable_numerical_double_integrator_cl_len);
+    GeometryFactory>::clStrIntegrateRegularPairs() const {
+  return std::make_pair(regular_scalar_double_integrator_cl,
+                        regular_scalar_double_integrator_cl_len);
 }
+#endif // WITH_OPENCL
 
 } // namespace Fiber
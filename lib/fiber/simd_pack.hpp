@@ -0,0 +1,464 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_simd_pack_hpp
+#define fiber_simd_pack_hpp
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Fiber {
+
+/** \brief SIMD packs used by the batched kernel functors.
+ *
+ *  The functions live in their own namespace so that their overloads of
+ *  sqrt(), exp() etc. do not hide the scalar ones in namespace Fiber. */
+namespace Simd {
+
+/** \brief Pack of SIMD lanes holding a single value.
+ *
+ *  All pack types provide the same interface: load(), store(), broadcast
+ *  construction, the arithmetic operators and the free functions sqrt(),
+ *  rsqrt(), min(), max(), round(), floor(), mulAdd() and scale().
+ *  NativePack<T>::type is the widest pack supported by the instruction set
+ *  the library is compiled for (see the CMake option SIMD_INSTRUCTION_SET);
+ *  it is ScalarPack<T> if no vector instruction set is enabled. */
+template <typename T> struct ScalarPack {
+  typedef T Scalar;
+  enum { width = 1 };
+
+  ScalarPack() {}
+  ScalarPack(T value) : v(value) {}
+
+  static ScalarPack load(const T *p) { return ScalarPack(*p); }
+  void store(T *p) const { *p = v; }
+
+  T v;
+};
+
+template <typename T>
+inline ScalarPack<T> operator+(ScalarPack<T> a, ScalarPack<T> b) {
+  return a.v + b.v;
+}
+template <typename T>
+inline ScalarPack<T> operator-(ScalarPack<T> a, ScalarPack<T> b) {
+  return a.v - b.v;
+}
+template <typename T>
+inline ScalarPack<T> operator*(ScalarPack<T> a, ScalarPack<T> b) {
+  return a.v * b.v;
+}
+template <typename T>
+inline ScalarPack<T> operator/(ScalarPack<T> a, ScalarPack<T> b) {
+  return a.v / b.v;
+}
+template <typename T> inline ScalarPack<T> sqrt(ScalarPack<T> a) {
+  return std::sqrt(a.v);
+}
+template <typename T> inline ScalarPack<T> rsqrt(ScalarPack<T> a) {
+  return T(1) / std::sqrt(a.v);
+}
+template <typename T>
+inline ScalarPack<T> min(ScalarPack<T> a, ScalarPack<T> b) {
+  return a.v < b.v ? a.v : b.v;
+}
+template <typename T>
+inline ScalarPack<T> max(ScalarPack<T> a, ScalarPack<T> b) {
+  return a.v > b.v ? a.v : b.v;
+}
+template <typename T> inline ScalarPack<T> round(ScalarPack<T> a) {
+  return std::nearbyint(a.v);
+}
+template <typename T> inline ScalarPack<T> floor(ScalarPack<T> a) {
+  return std::floor(a.v);
+}
+/** \brief a * b + c */
+template <typename T>
+inline ScalarPack<T> mulAdd(ScalarPack<T> a, ScalarPack<T> b,
+                            ScalarPack<T> c) {
+  return a.v * b.v + c.v;
+}
+/** \brief a * 2^n for integral n within the exponent range of T */
+template <typename T>
+inline ScalarPack<T> scale(ScalarPack<T> a, ScalarPack<T> n) {
+  return std::ldexp(a.v, static_cast<int>(n.v));
+}
+/** \brief Exponential; the scalar version is exact to the last bit of the
+ *  standard library. */
+template <typename T> inline ScalarPack<T> exp(ScalarPack<T> a) {
+  return std::exp(a.v);
+}
+template <typename T>
+inline void sincos(ScalarPack<T> a, ScalarPack<T> &s, ScalarPack<T> &c) {
+  s.v = std::sin(a.v);
+  c.v = std::cos(a.v);
+}
+
+#if defined(__AVX512F__)
+
+struct AvxPackDouble {
+  typedef double Scalar;
+  enum { width = 8 };
+
+  AvxPackDouble() {}
+  AvxPackDouble(__m512d value) : v(value) {}
+  AvxPackDouble(double value) : v(_mm512_set1_pd(value)) {}
+
+  static AvxPackDouble load(const double *p) { return _mm512_loadu_pd(p); }
+  void store(double *p) const { _mm512_storeu_pd(p, v); }
+
+  __m512d v;
+};
+
+struct AvxPackFloat {
+  typedef float Scalar;
+  enum { width = 16 };
+
+  AvxPackFloat() {}
+  AvxPackFloat(__m512 value) : v(value) {}
+  AvxPackFloat(float value) : v(_mm512_set1_ps(value)) {}
+
+  static AvxPackFloat load(const float *p) { return _mm512_loadu_ps(p); }
+  void store(float *p) const { _mm512_storeu_ps(p, v); }
+
+  __m512 v;
+};
+
+inline AvxPackDouble operator+(AvxPackDouble a, AvxPackDouble b) {
+  return _mm512_add_pd(a.v, b.v);
+}
+inline AvxPackDouble operator-(AvxPackDouble a, AvxPackDouble b) {
+  return _mm512_sub_pd(a.v, b.v);
+}
+inline AvxPackDouble operator*(AvxPackDouble a, AvxPackDouble b) {
+  return _mm512_mul_pd(a.v, b.v);
+}
+inline AvxPackDouble operator/(AvxPackDouble a, AvxPackDouble b) {
+  return _mm512_div_pd(a.v, b.v);
+}
+inline AvxPackDouble sqrt(AvxPackDouble a) { return _mm512_sqrt_pd(a.v); }
+inline AvxPackDouble rsqrt(AvxPackDouble a) {
+  // 14-bit estimate refined by two Newton steps
+  const __m512d half = _mm512_set1_pd(0.5);
+  const __m512d threeHalves = _mm512_set1_pd(1.5);
+  const __m512d halfA = _mm512_mul_pd(half, a.v);
+  __m512d y = _mm512_rsqrt14_pd(a.v);
+  for (int i = 0; i < 2; ++i)
+    y = _mm512_mul_pd(
+        y, _mm512_fnmadd_pd(halfA, _mm512_mul_pd(y, y), threeHalves));
+  return y;
+}
+inline AvxPackDouble min(AvxPackDouble a, AvxPackDouble b) {
+  return _mm512_min_pd(a.v, b.v);
+}
+inline AvxPackDouble max(AvxPackDouble a, AvxPackDouble b) {
+  return _mm512_max_pd(a.v, b.v);
+}
+inline AvxPackDouble round(AvxPackDouble a) {
+  return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEAREST_INT);
+}
+inline AvxPackDouble floor(AvxPackDouble a) {
+  return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF);
+}
+inline AvxPackDouble mulAdd(AvxPackDouble a, AvxPackDouble b,
+                            AvxPackDouble c) {
+  return _mm512_fmadd_pd(a.v, b.v, c.v);
+}
+inline AvxPackDouble scale(AvxPackDouble a, AvxPackDouble n) {
+  return _mm512_scalef_pd(a.v, n.v);
+}
+
+inline AvxPackFloat operator+(AvxPackFloat a, AvxPackFloat b) {
+  return _mm512_add_ps(a.v, b.v);
+}
+inline AvxPackFloat operator-(AvxPackFloat a, AvxPackFloat b) {
+  return _mm512_sub_ps(a.v, b.v);
+}
+inline AvxPackFloat operator*(AvxPackFloat a, AvxPackFloat b) {
+  return _mm512_mul_ps(a.v, b.v);
+}
+inline AvxPackFloat operator/(AvxPackFloat a, AvxPackFloat b) {
+  return _mm512_div_ps(a.v, b.v);
+}
+inline AvxPackFloat sqrt(AvxPackFloat a) { return _mm512_sqrt_ps(a.v); }
+inline AvxPackFloat rsqrt(AvxPackFloat a) {
+  // 14-bit estimate refined by one Newton step
+  const __m512 halfA = _mm512_mul_ps(_mm512_set1_ps(0.5f), a.v);
+  __m512 y = _mm512_rsqrt14_ps(a.v);
+  return _mm512_mul_ps(y, _mm512_fnmadd_ps(halfA, _mm512_mul_ps(y, y),
+                                           _mm512_set1_ps(1.5f)));
+}
+inline AvxPackFloat min(AvxPackFloat a, AvxPackFloat b) {
+  return _mm512_min_ps(a.v, b.v);
+}
+inline AvxPackFloat max(AvxPackFloat a, AvxPackFloat b) {
+  return _mm512_max_ps(a.v, b.v);
+}
+inline AvxPackFloat round(AvxPackFloat a) {
+  return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT);
+}
+inline AvxPackFloat floor(AvxPackFloat a) {
+  return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF);
+}
+inline AvxPackFloat mulAdd(AvxPackFloat a, AvxPackFloat b, AvxPackFloat c) {
+  return _mm512_fmadd_ps(a.v, b.v, c.v);
+}
+inline AvxPackFloat scale(AvxPackFloat a, AvxPackFloat n) {
+  return _mm512_scalef_ps(a.v, n.v);
+}
+
+#elif defined(__AVX2__)
+
+struct AvxPackDouble {
+  typedef double Scalar;
+  enum { width = 4 };
+
+  AvxPackDouble() {}
+  AvxPackDouble(__m256d value) : v(value) {}
+  AvxPackDouble(double value) : v(_mm256_set1_pd(value)) {}
+
+  static AvxPackDouble load(const double *p) { return _mm256_loadu_pd(p); }
+  void store(double *p) const { _mm256_storeu_pd(p, v); }
+
+  __m256d v;
+};
+
+struct AvxPackFloat {
+  typedef float Scalar;
+  enum { width = 8 };
+
+  AvxPackFloat() {}
+  AvxPackFloat(__m256 value) : v(value) {}
+  AvxPackFloat(float value) : v(_mm256_set1_ps(value)) {}
+
+  static AvxPackFloat load(const float *p) { return _mm256_loadu_ps(p); }
+  void store(float *p) const { _mm256_storeu_ps(p, v); }
+
+  __m256 v;
+};
+
+inline AvxPackDouble operator+(AvxPackDouble a, AvxPackDouble b) {
+  return _mm256_add_pd(a.v, b.v);
+}
+inline AvxPackDouble operator-(AvxPackDouble a, AvxPackDouble b) {
+  return _mm256_sub_pd(a.v, b.v);
+}
+inline AvxPackDouble operator*(AvxPackDouble a, AvxPackDouble b) {
+  return _mm256_mul_pd(a.v, b.v);
+}
+inline AvxPackDouble operator/(AvxPackDouble a, AvxPackDouble b) {
+  return _mm256_div_pd(a.v, b.v);
+}
+inline AvxPackDouble sqrt(AvxPackDouble a) { return _mm256_sqrt_pd(a.v); }
+inline AvxPackDouble rsqrt(AvxPackDouble a) {
+  // AVX2 has no double-precision estimate
+  return _mm256_div_pd(_mm256_set1_pd(1.), _mm256_sqrt_pd(a.v));
+}
+inline AvxPackDouble min(AvxPackDouble a, AvxPackDouble b) {
+  return _mm256_min_pd(a.v, b.v);
+}
+inline AvxPackDouble max(AvxPackDouble a, AvxPackDouble b) {
+  return _mm256_max_pd(a.v, b.v);
+}
+inline AvxPackDouble round(AvxPackDouble a) {
+  return _mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+inline AvxPackDouble floor(AvxPackDouble a) { return _mm256_floor_pd(a.v); }
+inline AvxPackDouble mulAdd(AvxPackDouble a, AvxPackDouble b,
+                            AvxPackDouble c) {
+#ifdef __FMA__
+  return _mm256_fmadd_pd(a.v, b.v, c.v);
+#else
+  return _mm256_add_pd(_mm256_mul_pd(a.v, b.v), c.v);
+#endif
+}
+inline AvxPackDouble scale(AvxPackDouble a, AvxPackDouble n) {
+  // Build 2^n in the exponent field: the low bits of n + 1023 + 2^52 hold
+  // the biased exponent as an integer
+  const __m256d magic = _mm256_set1_pd(4503599627370496. + 1023.);
+  __m256i bits = _mm256_slli_epi64(
+      _mm256_castpd_si256(_mm256_add_pd(n.v, magic)), 52);
+  return _mm256_mul_pd(a.v, _mm256_castsi256_pd(bits));
+}
+
+inline AvxPackFloat operator+(AvxPackFloat a, AvxPackFloat b) {
+  return _mm256_add_ps(a.v, b.v);
+}
+inline AvxPackFloat operator-(AvxPackFloat a, AvxPackFloat b) {
+  return _mm256_sub_ps(a.v, b.v);
+}
+inline AvxPackFloat operator*(AvxPackFloat a, AvxPackFloat b) {
+  return _mm256_mul_ps(a.v, b.v);
+}
+inline AvxPackFloat operator/(AvxPackFloat a, AvxPackFloat b) {
+  return _mm256_div_ps(a.v, b.v);
+}
+inline AvxPackFloat sqrt(AvxPackFloat a) { return _mm256_sqrt_ps(a.v); }
+inline AvxPackFloat rsqrt(AvxPackFloat a) {
+  // 12-bit estimate refined by one Newton step
+  const __m256 halfA = _mm256_mul_ps(_mm256_set1_ps(0.5f), a.v);
+  __m256 y = _mm256_rsqrt_ps(a.v);
+  return _mm256_mul_ps(
+      y, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+                       _mm256_mul_ps(halfA, _mm256_mul_ps(y, y))));
+}
+inline AvxPackFloat min(AvxPackFloat a, AvxPackFloat b) {
+  return _mm256_min_ps(a.v, b.v);
+}
+inline AvxPackFloat max(AvxPackFloat a, AvxPackFloat b) {
+  return _mm256_max_ps(a.v, b.v);
+}
+inline AvxPackFloat round(AvxPackFloat a) {
+  return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+inline AvxPackFloat floor(AvxPackFloat a) { return _mm256_floor_ps(a.v); }
+inline AvxPackFloat mulAdd(AvxPackFloat a, AvxPackFloat b, AvxPackFloat c) {
+#ifdef __FMA__
+  return _mm256_fmadd_ps(a.v, b.v, c.v);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v);
+#endif
+}
+inline AvxPackFloat scale(AvxPackFloat a, AvxPackFloat n) {
+  __m256i bits = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(a.v, _mm256_castsi256_ps(bits));
+}
+
+#endif
+
+template <typename T> struct NativePack { typedef ScalarPack<T> type; };
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+template <> struct NativePack<double> { typedef AvxPackDouble type; };
+template <> struct NativePack<float> { typedef AvxPackFloat type; };
+#endif
+
+/** \brief Constants of the polynomial approximations in exp() and
+ *  sincos(). */
+template <typename T> struct PackMathConstants;
+
+template <> struct PackMathConstants<double> {
+  enum { expDegree = 13, sinDegree = 15, cosDegree = 16 };
+  static double expMin() { return -708.; }
+  static double expMax() { return 709.; }
+  static double ln2Hi() { return 6.93145751953125E-1; }
+  static double ln2Lo() { return 1.42860682030941723212E-6; }
+  static double piOver2Hi() { return 1.57079632673412561417E+0; }
+  static double piOver2Mid() { return 6.07710050630396597660E-11; }
+  static double piOver2Lo() { return 2.02226624879595063154E-21; }
+};
+
+template <> struct PackMathConstants<float> {
+  enum { expDegree = 7, sinDegree = 9, cosDegree = 10 };
+  static float expMin() { return -87.f; }
+  static float expMax() { return 88.f; }
+  static float ln2Hi() { return 0.693359375f; }
+  static float ln2Lo() { return -2.12194440E-4f; }
+  static float piOver2Hi() { return 1.5703125f; }
+  static float piOver2Mid() { return 4.837512969970703125E-4f; }
+  static float piOver2Lo() { return 7.54978995489188216E-8f; }
+};
+
+/** \brief Vectorised exponential.
+ *
+ *  The argument is reduced to r = x - n ln 2 with |r| <= ln(2)/2, exp(r) is
+ *  evaluated by its Taylor polynomial and scaled by 2^n. Arguments are
+ *  clamped to the range in which the result is a normal number. */
+template <typename Pack> inline Pack exp(Pack x) {
+  typedef typename Pack::Scalar T;
+  typedef PackMathConstants<T> C;
+
+  x = min(max(x, Pack(C::expMin())), Pack(C::expMax()));
+  Pack n = round(x * Pack(static_cast<T>(1.44269504088896340736)));
+  Pack r = mulAdd(n, Pack(-C::ln2Hi()), x);
+  r = mulAdd(n, Pack(-C::ln2Lo()), r);
+
+  T coefficient = 1;
+  for (int k = 2; k <= C::expDegree; ++k)
+    coefficient /= k;
+  Pack p(coefficient);
+  for (int k = C::expDegree; k > 0; --k) {
+    coefficient *= k;
+    p = mulAdd(p, r, Pack(coefficient));
+  }
+  return scale(p, n);
+}
+
+/** \brief Vectorised sine and cosine.
+ *
+ *  The argument is reduced by multiples n of pi/2 with a three-term
+ *  Cody-Waite splitting, which is accurate for |x| up to about 1E5 (double)
+ *  or 1E3 (float). The quadrant is selected arithmetically so that the
+ *  packs need no lane masks. */
+template <typename Pack> inline void sincos(Pack x, Pack &s, Pack &c) {
+  typedef typename Pack::Scalar T;
+  typedef PackMathConstants<T> C;
+
+  Pack n = round(x * Pack(static_cast<T>(0.63661977236758134308)));
+  Pack r = mulAdd(n, Pack(-C::piOver2Hi()), x);
+  r = mulAdd(n, Pack(-C::piOver2Mid()), r);
+  r = mulAdd(n, Pack(-C::piOver2Lo()), r);
+  Pack r2 = r * r;
+
+  // sin r = r (1 - r^2/3! + r^4/5! - ...), cos r = 1 - r^2/2! + ...
+  T sinCoefficient = (C::sinDegree / 2) % 2 ? -1 : 1;
+  for (int k = 2; k <= C::sinDegree; ++k)
+    sinCoefficient /= k;
+  Pack sinR(sinCoefficient);
+  for (int k = C::sinDegree; k > 1; k -= 2) {
+    sinCoefficient *= -k * (k - 1);
+    sinR = mulAdd(sinR, r2, Pack(sinCoefficient));
+  }
+  sinR = sinR * r;
+
+  T cosCoefficient = (C::cosDegree / 2) % 2 ? -1 : 1;
+  for (int k = 2; k <= C::cosDegree; ++k)
+    cosCoefficient /= k;
+  Pack cosR(cosCoefficient);
+  for (int k = C::cosDegree; k > 0; k -= 2) {
+    cosCoefficient *= -k * (k - 1);
+    cosR = mulAdd(cosR, r2, Pack(cosCoefficient));
+  }
+
+  // Quadrant q = n mod 4: (sin, cos) = (s, c), (c, -s), (-s, -c), (-c, s)
+  const Pack one(static_cast<T>(1));
+  const Pack two(static_cast<T>(2));
+  const Pack half(static_cast<T>(0.5));
+  const Pack quarter(static_cast<T>(0.25));
+  Pack q = n - Pack(static_cast<T>(4)) * floor(n * quarter);
+  Pack upperHalf = floor(q * half);
+  Pack swap = q - two * upperHalf;
+  Pack qNext = q + one;
+  Pack cosNegative =
+      floor((qNext - Pack(static_cast<T>(4)) * floor(qNext * quarter)) * half);
+  s = (one - two * upperHalf) * mulAdd(swap, cosR - sinR, sinR);
+  c = (one - two * cosNegative) * mulAdd(swap, sinR - cosR, cosR);
+}
+
+} // namespace Simd
+
+} // namespace Fiber
+
+#endif
@@ -46,6 +46,8 @@ public:
 
   int resultDimension() const { return 1; }
 
+  bool isScalarKernelTrialProduct() const { return true; }
+
   // It is possible that this function could be generalised to
   // multiple shapeset transformations or kernels and that the additional
   // loops could be optimised away by the compiler.
@@ -94,6 +94,14 @@ public:
   typedef ResultType_ ResultType;
   typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
 
+  /** \brief The same integrand for kernels with real values
+   *  (see TestKernelTrialIntegral::realKernelIntegral()). */
+  typedef SimpleTestScalarKernelTrialIntegrandFunctorExt<
+      BasisFunctionType, CoordinateType, BasisFunctionType, transformationDim>
+  RealKernelFunctor;
+
+  RealKernelFunctor realKernelFunctor() const { return RealKernelFunctor(); }
+
   void addGeometricalDependencies(size_t &testGeomDeps,
                                   size_t &trialGeomDeps) const {
     // do nothing
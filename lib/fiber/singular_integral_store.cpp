@@ -0,0 +1,217 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "singular_integral_store.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Fiber {
+
+namespace {
+
+const char SINGULAR_INTEGRAL_FILE_MAGIC[8] = {'B', 'E', 'M', 'P',
+                                              'P', 'S', 'I', '\0'};
+const uint32_t SINGULAR_INTEGRAL_FILE_VERSION = 1;
+const uint64_t SINGULAR_INTEGRAL_FILE_ALIGNMENT = 64;
+
+size_t valueSize(uint32_t valueTypeId) {
+  switch (valueTypeId) {
+  case 1:
+    return sizeof(float);
+  case 2:
+    return sizeof(double);
+  case 3:
+    return sizeof(std::complex<float>);
+  case 4:
+    return sizeof(std::complex<double>);
+  default:
+    return 0;
+  }
+}
+
+uint64_t indexSectionsEnd(const SingularIntegralFileHeader &header) {
+  return sizeof(SingularIntegralFileHeader) +
+         (header.columnCount + 1) * sizeof(uint64_t) +
+         header.pairCount * (sizeof(int32_t) + 2 * sizeof(uint32_t));
+}
+
+} // namespace
+
+SingularIntegralFile::SingularIntegralFile(const std::string &fileName)
+    : m_data(0), m_size(0) {
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("SingularIntegralFile::SingularIntegralFile(): "
+                             "cannot open file " +
+                             fileName);
+  struct stat fileStatus;
+  if (::fstat(fd, &fileStatus) != 0 || fileStatus.st_size == 0) {
+    ::close(fd);
+    throw std::runtime_error("SingularIntegralFile::SingularIntegralFile(): "
+                             "cannot determine the size of file " +
+                             fileName);
+  }
+  m_size = fileStatus.st_size;
+  void *data = ::mmap(0, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    throw std::runtime_error("SingularIntegralFile::SingularIntegralFile(): "
+                             "cannot map file " +
+                             fileName);
+  m_data = static_cast<const char *>(data);
+}
+
+SingularIntegralFile::~SingularIntegralFile() {
+  if (m_data)
+    ::munmap(const_cast<char *>(m_data), m_size);
+}
+
+SingularIntegralStore::SingularIntegralStore(const std::string &directory)
+    : m_directory(directory) {
+  struct stat status;
+  if (directory.empty() || ::stat(directory.c_str(), &status) != 0 ||
+      !S_ISDIR(status.st_mode))
+    throw std::invalid_argument("SingularIntegralStore::"
+                                "SingularIntegralStore(): directory '" +
+                                directory + "' does not exist");
+}
+
+std::string SingularIntegralStore::fileName(uint64_t key) const {
+  char name[64];
+  std::snprintf(name, sizeof(name), "singular-integrals-%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return m_directory + "/" + name;
+}
+
+SingularIntegralFileHeader
+SingularIntegralStore::makeHeader(uint32_t valueTypeId) {
+  SingularIntegralFileHeader header = SingularIntegralFileHeader();
+  std::memcpy(header.magic, SINGULAR_INTEGRAL_FILE_MAGIC,
+              sizeof(header.magic));
+  header.version = SINGULAR_INTEGRAL_FILE_VERSION;
+  header.valueTypeId = valueTypeId;
+  return header;
+}
+
+shared_ptr<const SingularIntegralFile>
+SingularIntegralStore::mapFile(uint64_t key, uint32_t valueTypeId,
+                               const SingularIntegralFileHeader *&header)
+    const {
+  const std::string name = fileName(key);
+  struct stat status;
+  if (::stat(name.c_str(), &status) != 0)
+    return shared_ptr<const SingularIntegralFile>();
+
+  shared_ptr<const SingularIntegralFile> file;
+  try {
+    file.reset(new SingularIntegralFile(name));
+  } catch (std::runtime_error &) {
+    return shared_ptr<const SingularIntegralFile>();
+  }
+
+  // Treat files of other versions or value types and damaged files as
+  // missing; they will be overwritten
+  if (file->size() < sizeof(SingularIntegralFileHeader))
+    return shared_ptr<const SingularIntegralFile>();
+  header = reinterpret_cast<const SingularIntegralFileHeader *>(file->data());
+  const size_t size = valueSize(valueTypeId);
+  if (std::memcmp(header->magic, SINGULAR_INTEGRAL_FILE_MAGIC,
+                  sizeof(header->magic)) != 0 ||
+      header->version != SINGULAR_INTEGRAL_FILE_VERSION ||
+      header->valueTypeId != valueTypeId || header->key != key ||
+      header->fileSize != file->size() || size == 0 ||
+      header->dataOffset % SINGULAR_INTEGRAL_FILE_ALIGNMENT != 0 ||
+      header->pairCount > file->size() ||
+      header->columnCount > file->size() ||
+      indexSectionsEnd(*header) > header->dataOffset ||
+      header->dataOffset > file->size() ||
+      header->valueCount > (file->size() - header->dataOffset) / size)
+    return shared_ptr<const SingularIntegralFile>();
+
+  const uint64_t *starts = reinterpret_cast<const uint64_t *>(
+      file->data() + sizeof(SingularIntegralFileHeader));
+  if (starts[0] != 0 || starts[header->columnCount] != header->pairCount)
+    return shared_ptr<const SingularIntegralFile>();
+  for (uint64_t c = 0; c < header->columnCount; ++c)
+    if (starts[c + 1] < starts[c])
+      return shared_ptr<const SingularIntegralFile>();
+  return file;
+}
+
+void SingularIntegralStore::writeFile(
+    uint64_t key, SingularIntegralFileHeader header,
+    const std::vector<size_t> &columnStarts,
+    const std::vector<int> &testElementIndices,
+    const std::vector<uint32_t> &shapes, const std::vector<const char *> &data,
+    const std::vector<size_t> &dataSizes) const {
+  const uint64_t indexEnd = indexSectionsEnd(header);
+  header.dataOffset = (indexEnd + SINGULAR_INTEGRAL_FILE_ALIGNMENT - 1) /
+                      SINGULAR_INTEGRAL_FILE_ALIGNMENT *
+                      SINGULAR_INTEGRAL_FILE_ALIGNMENT;
+  header.fileSize =
+      header.dataOffset + header.valueCount * valueSize(header.valueTypeId);
+
+  const std::string name = fileName(key);
+  std::ostringstream tempName;
+  tempName << name << ".tmp." << ::getpid();
+
+  {
+    std::ofstream stream(tempName.str().c_str(),
+                         std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (size_t c = 0; c < columnStarts.size(); ++c) {
+      const uint64_t start = columnStarts[c];
+      stream.write(reinterpret_cast<const char *>(&start), sizeof(start));
+    }
+    for (size_t i = 0; i < testElementIndices.size(); ++i) {
+      const int32_t index = testElementIndices[i];
+      stream.write(reinterpret_cast<const char *>(&index), sizeof(index));
+    }
+    if (!shapes.empty())
+      stream.write(reinterpret_cast<const char *>(&shapes[0]),
+                   shapes.size() * sizeof(uint32_t));
+    const char zeros[SINGULAR_INTEGRAL_FILE_ALIGNMENT] = {};
+    stream.write(zeros, header.dataOffset - indexEnd);
+    for (size_t i = 0; i < data.size(); ++i)
+      stream.write(data[i], dataSizes[i]);
+    stream.close();
+    if (!stream) {
+      std::remove(tempName.str().c_str());
+      throw std::runtime_error("SingularIntegralStore::save(): "
+                               "cannot write file " +
+                               tempName.str());
+    }
+  }
+  if (std::rename(tempName.str().c_str(), name.c_str()) != 0) {
+    std::remove(tempName.str().c_str());
+    throw std::runtime_error("SingularIntegralStore::save(): "
+                             "cannot rename " +
+                             tempName.str() + " to " + name);
+  }
+}
+
+} // namespace Fiber
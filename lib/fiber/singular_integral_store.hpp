@@ -0,0 +1,262 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_singular_integral_store_hpp
+#define fiber_singular_integral_store_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "shared_ptr.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <complex>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Fiber {
+
+/** \brief 64-bit FNV-1a hash identifying a set of singular integrals.
+ *
+ *  Everything the integrals depend on is fed into the key by
+ *  DefaultLocalAssemblerForIntegralOperatorsOnSurfaces before the store is
+ *  searched. */
+class SingularIntegralKey {
+public:
+  SingularIntegralKey() : m_value(14695981039346656037ULL) {}
+
+  void add(const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      m_value ^= bytes[i];
+      m_value *= 1099511628211ULL;
+    }
+  }
+
+  template <typename T> void add(const T &value) { add(&value, sizeof(T)); }
+
+  template <typename T> void add(const arma::Mat<T> &matrix) {
+    add(matrix.n_rows);
+    add(matrix.n_cols);
+    add(matrix.memptr(), matrix.n_elem * sizeof(T));
+  }
+
+  uint64_t value() const { return m_value; }
+
+private:
+  uint64_t m_value;
+};
+
+/** \brief Header of the files written by SingularIntegralStore.
+ *
+ *  The header is followed by the column starts (uint64_t, columnCount + 1
+ *  entries), the test element indices (int32_t, pairCount entries), the
+ *  numbers of rows and columns of the local weak forms (uint32_t, 2 *
+ *  pairCount entries) and, from dataOffset on, the entries of all local
+ *  weak forms in column-major order. The data offset is a multiple of 64
+ *  bytes. All data is stored in native byte order. */
+struct SingularIntegralFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t valueTypeId;
+  uint64_t key;
+  uint64_t columnCount;
+  uint64_t pairCount;
+  uint64_t valueCount;
+  uint64_t dataOffset;
+  uint64_t fileSize;
+};
+
+/** \brief Read-only memory mapping of a file written by
+ *  SingularIntegralStore. */
+class SingularIntegralFile : boost::noncopyable {
+public:
+  /** \brief Map the file; throw std::runtime_error on failure. */
+  explicit SingularIntegralFile(const std::string &fileName);
+  ~SingularIntegralFile();
+
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  const char *m_data;
+  size_t m_size;
+};
+
+/** \brief On-disk store of precalculated singular integrals.
+ *
+ *  The store keeps the local weak forms cached by
+ *  DefaultLocalAssemblerForIntegralOperatorsOnSurfaces in one file per key
+ *  in a directory, so that they need not be recalculated when the same
+ *  operator is assembled again on the same mesh, possibly by another
+ *  process. Files are memory-mapped read-only when loaded, so that all
+ *  processes on a node share one copy of the integrals in the page cache.
+ *  Files are written under a temporary name and renamed when complete, so
+ *  concurrent processes never see partially written files. */
+class SingularIntegralStore {
+public:
+  /** \brief Constructor.
+   *
+   *  \param[in] directory Directory holding the store. It must exist. */
+  explicit SingularIntegralStore(const std::string &directory);
+
+  /** \brief Return the directory holding the store. */
+  const std::string &directory() const { return m_directory; }
+
+  /** \brief Look up the singular integrals stored under \p key.
+   *
+   *  If a matching file exists, fill \p columnStarts, \p testElementIndices
+   *  and \p localWeakForms with its contents and return the mapping of the
+   *  file. The matrices in \p localWeakForms use the mapped memory, which
+   *  stays valid as long as the returned object exists; they must not be
+   *  modified. Otherwise return a null pointer and leave the arguments
+   *  unchanged. */
+  template <typename ValueType>
+  shared_ptr<const SingularIntegralFile>
+  load(uint64_t key, std::vector<size_t> &columnStarts,
+       std::vector<int> &testElementIndices,
+       std::vector<arma::Mat<ValueType>> &localWeakForms) const;
+
+  /** \brief Store singular integrals under \p key.
+   *
+   *  The arguments have the layout described in load(). Throw
+   *  std::runtime_error if the file cannot be written. */
+  template <typename ValueType>
+  void save(uint64_t key, const std::vector<size_t> &columnStarts,
+            const std::vector<int> &testElementIndices,
+            const std::vector<arma::Mat<ValueType>> &localWeakForms) const;
+
+  /** \brief Return the name of the file holding the integrals stored under
+   *  \p key. */
+  std::string fileName(uint64_t key) const;
+
+private:
+  /** \cond PRIVATE */
+  shared_ptr<const SingularIntegralFile>
+  mapFile(uint64_t key, uint32_t valueTypeId,
+          const SingularIntegralFileHeader *&header) const;
+  void writeFile(uint64_t key, SingularIntegralFileHeader header,
+                 const std::vector<size_t> &columnStarts,
+                 const std::vector<int> &testElementIndices,
+                 const std::vector<uint32_t> &shapes,
+                 const std::vector<const char *> &data,
+                 const std::vector<size_t> &dataSizes) const;
+  static SingularIntegralFileHeader makeHeader(uint32_t valueTypeId);
+
+  std::string m_directory;
+  /** \endcond */
+};
+
+/** \cond PRIVATE */
+template <typename ValueType> uint32_t singularIntegralValueTypeId();
+template <> inline uint32_t singularIntegralValueTypeId<float>() { return 1; }
+template <> inline uint32_t singularIntegralValueTypeId<double>() { return 2; }
+template <>
+inline uint32_t singularIntegralValueTypeId<std::complex<float>>() {
+  return 3;
+}
+template <>
+inline uint32_t singularIntegralValueTypeId<std::complex<double>>() {
+  return 4;
+}
+/** \endcond */
+
+template <typename ValueType>
+shared_ptr<const SingularIntegralFile> SingularIntegralStore::load(
+    uint64_t key, std::vector<size_t> &columnStarts,
+    std::vector<int> &testElementIndices,
+    std::vector<arma::Mat<ValueType>> &localWeakForms) const {
+  const SingularIntegralFileHeader *header = 0;
+  shared_ptr<const SingularIntegralFile> file =
+      mapFile(key, singularIntegralValueTypeId<ValueType>(), header);
+  if (!file)
+    return file;
+
+  // mapFile() has checked that all sections lie within the file
+  const char *position = file->data() + sizeof(SingularIntegralFileHeader);
+  const uint64_t *starts = reinterpret_cast<const uint64_t *>(position);
+  position += (header->columnCount + 1) * sizeof(uint64_t);
+  const int32_t *indices = reinterpret_cast<const int32_t *>(position);
+  position += header->pairCount * sizeof(int32_t);
+  const uint32_t *shapes = reinterpret_cast<const uint32_t *>(position);
+  ValueType *values = reinterpret_cast<ValueType *>(
+      const_cast<char *>(file->data() + header->dataOffset));
+
+  std::vector<arma::Mat<ValueType>> forms(header->pairCount);
+  uint64_t valueCount = 0;
+  for (size_t i = 0; i < header->pairCount; ++i) {
+    const uint64_t rows = shapes[2 * i], cols = shapes[2 * i + 1];
+    if (rows * cols > header->valueCount - valueCount)
+      return shared_ptr<const SingularIntegralFile>();
+    // Use the mapped memory without copying; strict, so never reallocated
+    arma::Mat<ValueType> form(values + valueCount, rows, cols,
+                              false /* copy_aux_mem */, true /* strict */);
+    forms[i].swap(form);
+    valueCount += rows * cols;
+  }
+  if (valueCount != header->valueCount)
+    return shared_ptr<const SingularIntegralFile>();
+
+  columnStarts.assign(starts, starts + header->columnCount + 1);
+  testElementIndices.assign(indices, indices + header->pairCount);
+  localWeakForms.swap(forms);
+  return file;
+}
+
+template <typename ValueType>
+void SingularIntegralStore::save(
+    uint64_t key, const std::vector<size_t> &columnStarts,
+    const std::vector<int> &testElementIndices,
+    const std::vector<arma::Mat<ValueType>> &localWeakForms) const {
+  if (columnStarts.empty() ||
+      testElementIndices.size() != localWeakForms.size() ||
+      columnStarts.back() != localWeakForms.size())
+    throw std::invalid_argument("SingularIntegralStore::save(): "
+                                "inconsistent cache layout");
+
+  SingularIntegralFileHeader header =
+      makeHeader(singularIntegralValueTypeId<ValueType>());
+  header.key = key;
+  header.columnCount = columnStarts.size() - 1;
+  header.pairCount = localWeakForms.size();
+  header.valueCount = 0;
+
+  std::vector<uint32_t> shapes(2 * localWeakForms.size());
+  std::vector<const char *> data(localWeakForms.size());
+  std::vector<size_t> dataSizes(localWeakForms.size());
+  for (size_t i = 0; i < localWeakForms.size(); ++i) {
+    const arma::Mat<ValueType> &form = localWeakForms[i];
+    shapes[2 * i] = form.n_rows;
+    shapes[2 * i + 1] = form.n_cols;
+    data[i] = reinterpret_cast<const char *>(form.memptr());
+    dataSizes[i] = form.n_elem * sizeof(ValueType);
+    header.valueCount += form.n_elem;
+  }
+  writeFile(key, header, columnStarts, testElementIndices, shapes, data,
+            dataSizes);
+}
+
+} // namespace Fiber
+
+#endif
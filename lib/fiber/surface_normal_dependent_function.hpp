@@ -26,6 +26,8 @@
 #include "function.hpp"
 #include "geometrical_data.hpp"
 
+#include <type_traits>
+
 namespace Fiber {
 
 /** \brief %Function intended to be evaluated on a boundary-element grid,
@@ -57,6 +59,17 @@ namespace Fiber {
       void evaluate(const arma::Col<CoordinateType>& point,
                     const arma::Col<CoordinateType>& normal,
                     arma::Col<ValueType>& result) const;
+
+      // (Optional)
+      // Evaluate the function at all points (columns of "points", with
+      // normals in the columns of "normals") at once and store the values in
+      // the columns of "result", which will be preinitialised to correct
+      // dimensions. If this function is defined, it is called instead of
+      // evaluate(), which may then be omitted. The points may come from
+      // several elements.
+      void evaluateAtPoints(const arma::Mat<CoordinateType>& points,
+                            const arma::Mat<CoordinateType>& normals,
+                            arma::Mat<ValueType>& result) const;
   };
   \endcode
 */
@@ -81,7 +94,6 @@ public:
   virtual void evaluate(const GeometricalData<CoordinateType> &geomData,
                         arma::Mat<ValueType> &result) const {
     const arma::Mat<CoordinateType> &points = geomData.globals;
-    const arma::Mat<CoordinateType> &normals = geomData.normals;
 
 #ifndef NDEBUG
     if ((int)points.n_rows != worldDimension())
@@ -91,14 +103,33 @@ public:
 
     const size_t pointCount = points.n_cols;
     result.set_size(codomainDimension(), pointCount);
-    for (size_t i = 0; i < pointCount; ++i) {
+    evaluateImpl(geomData, result,
+                 std::integral_constant<bool, HasBatchedEvaluate::value>());
+  }
+
+private:
+  typedef hasEvaluateAtPoints<
+      Functor, void (Functor::*)(const arma::Mat<CoordinateType> &,
+                                 const arma::Mat<CoordinateType> &,
+                                 arma::Mat<ValueType> &) const>
+  HasBatchedEvaluate;
+
+  void evaluateImpl(const GeometricalData<CoordinateType> &geomData,
+                    arma::Mat<ValueType> &result, std::true_type) const {
+    m_functor.evaluateAtPoints(geomData.globals, geomData.normals, result);
+  }
+
+  void evaluateImpl(const GeometricalData<CoordinateType> &geomData,
+                    arma::Mat<ValueType> &result, std::false_type) const {
+    const arma::Mat<CoordinateType> &points = geomData.globals;
+    const arma::Mat<CoordinateType> &normals = geomData.normals;
+    for (size_t i = 0; i < points.n_cols; ++i) {
       arma::Col<ValueType> activeResultColumn = result.unsafe_col(i);
       m_functor.evaluate(points.unsafe_col(i), normals.unsafe_col(i),
                          activeResultColumn);
     }
   }
 
-private:
   Functor m_functor;
 };
 
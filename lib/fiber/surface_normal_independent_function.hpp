@@ -26,6 +26,8 @@
 #include "function.hpp"
 #include "geometrical_data.hpp"
 
+#include <type_traits>
+
 namespace Fiber {
 
 /** \brief %Function intended to be evaluated on a boundary-element grid,
@@ -56,6 +58,15 @@ namespace Fiber {
       // dimensions.
       void evaluate(const arma::Col<CoordinateType>& point,
                     arma::Col<ValueType>& result) const;
+
+      // (Optional)
+      // Evaluate the function at all points (columns of "points") at once
+      // and store the values in the columns of "result", which will be
+      // preinitialised to correct dimensions. If this function is defined,
+      // it is called instead of evaluate(), which may then be omitted.
+      // The points may come from several elements.
+      void evaluateAtPoints(const arma::Mat<CoordinateType>& points,
+                            arma::Mat<ValueType>& result) const;
   };
   \endcode
   */
@@ -91,13 +102,30 @@ public:
 
     const size_t pointCount = points.n_cols;
     result.set_size(codomainDimension(), pointCount);
-    for (size_t i = 0; i < pointCount; ++i) {
+    evaluateImpl(geomData, result,
+                 std::integral_constant<bool, HasBatchedEvaluate::value>());
+  }
+
+private:
+  typedef hasEvaluateAtPoints<
+      Functor, void (Functor::*)(const arma::Mat<CoordinateType> &,
+                                 arma::Mat<ValueType> &) const>
+  HasBatchedEvaluate;
+
+  void evaluateImpl(const GeometricalData<CoordinateType> &geomData,
+                    arma::Mat<ValueType> &result, std::true_type) const {
+    m_functor.evaluateAtPoints(geomData.globals, result);
+  }
+
+  void evaluateImpl(const GeometricalData<CoordinateType> &geomData,
+                    arma::Mat<ValueType> &result, std::false_type) const {
+    const arma::Mat<CoordinateType> &points = geomData.globals;
+    for (size_t i = 0; i < points.n_cols; ++i) {
       arma::Col<ValueType> activeResultColumn = result.unsafe_col(i);
       m_functor.evaluate(points.unsafe_col(i), activeResultColumn);
     }
   }
 
-private:
   Functor m_functor;
 };
 
@@ -0,0 +1,71 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "task_arena_cache.hpp"
+
+#include "parallelization_options.hpp"
+
+#include <map>
+#include <tbb/mutex.h>
+
+namespace Fiber {
+
+namespace {
+
+// The arenas are never destroyed: worker threads may still be attached to
+// them while static objects are being torn down at program exit.
+typedef std::map<int, tbb::task_arena *> ArenaMap;
+
+ArenaMap &arenaMap() {
+  static ArenaMap arenas;
+  return arenas;
+}
+
+tbb::mutex &arenaMapMutex() {
+  static tbb::mutex mutex;
+  return mutex;
+}
+
+} // namespace
+
+tbb::task_arena &taskArena(int maxThreadCount) {
+  if (maxThreadCount == ParallelizationOptions::AUTO || maxThreadCount < 1)
+    maxThreadCount = tbb::task_arena::automatic;
+
+  tbb::mutex::scoped_lock lock(arenaMapMutex());
+  ArenaMap &arenas = arenaMap();
+  ArenaMap::iterator it = arenas.find(maxThreadCount);
+  if (it == arenas.end()) {
+    tbb::task_arena *arena = new tbb::task_arena(maxThreadCount);
+    arena->initialize();
+    it = arenas.insert(std::make_pair(maxThreadCount, arena)).first;
+  }
+  return *it->second;
+}
+
+tbb::task_arena &asyncTaskArena() {
+  // Never destroyed, like the arenas above
+  static tbb::task_arena *arena =
+      new tbb::task_arena(tbb::task_arena::automatic,
+                          0 /* reserved_for_masters */);
+  return *arena;
+}
+
+} // namespace Fiber
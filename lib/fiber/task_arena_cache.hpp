@@ -0,0 +1,64 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_task_arena_cache_hpp
+#define fiber_task_arena_cache_hpp
+
+#include "../common/common.hpp"
+
+#include <tbb/task_arena.h>
+
+namespace Fiber {
+
+/** \brief Return the process-wide TBB task arena limited to \p maxThreadCount
+ *  threads.
+ *
+ *  \p maxThreadCount should be a positive number or ParallelizationOptions::
+ *  AUTO, in which case the arena uses the default number of threads chosen
+ *  by TBB. Arenas are created on first use and then reused by all later
+ *  calls with the same thread count, so that parallel loops do not pay for
+ *  starting the scheduler every time and nest correctly inside arenas
+ *  created by the application. */
+tbb::task_arena &taskArena(int maxThreadCount);
+
+/** \brief Execute the functor \p f in taskArena(\p maxThreadCount) and wait
+ *  for its completion. */
+template <typename Functor>
+void executeInTaskArena(int maxThreadCount, const Functor &f) {
+  taskArena(maxThreadCount).execute(f);
+}
+
+/** \brief Return the process-wide TBB task arena running asynchronous jobs,
+ *  such as those started by Bempp::Solver::solveAsync().
+ *
+ *  Unlike the arenas returned by taskArena(), this arena reserves no slot
+ *  for application threads, so that jobs enqueued into it are always picked
+ *  up by the TBB worker threads, which it shares with all other arenas. */
+tbb::task_arena &asyncTaskArena();
+
+/** \brief Enqueue the functor \p f in asyncTaskArena() and return
+ *  immediately. */
+template <typename Functor> void enqueueInTaskArena(const Functor &f) {
+  asyncTaskArena().enqueue(f);
+}
+
+} // namespace Fiber
+
+#endif
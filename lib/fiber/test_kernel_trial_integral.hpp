@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 
 #include "scalar_traits.hpp"
+#include "shared_ptr.hpp"
 
 #include "../common/armadillo_fwd.hpp"
 #include <vector>
@@ -72,6 +73,9 @@ public:
   typedef KernelType_ KernelType;
   typedef ResultType_ ResultType;
   typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+  /** \brief Type of the same integral for kernels with real values. */
+  typedef TestKernelTrialIntegral<BasisFunctionType, CoordinateType,
+                                  BasisFunctionType> RealKernelIntegral;
 
   /** \brief Destructor. */
   virtual ~TestKernelTrialIntegral() {}
@@ -107,6 +111,28 @@ public:
   virtual void addGeometricalDependencies(size_t &testGeomDeps,
                                           size_t &trialGeomDeps) const = 0;
 
+  /** \brief Return true if the integrand is the sum over transformations of
+   *  the complex conjugate of the test function transformation times a
+   *  scalar kernel times the trial function transformation, with no other
+   *  factors.
+   *
+   *  This is the form assumed by TypicalTestScalarKernelTrialIntegral.
+   *  Integrators that evaluate such integrals without calling
+   *  evaluateWithTensorQuadratureRule(), e.g. on a GPU, use this function to
+   *  decide whether they may do so. The default implementation returns
+   *  false. */
+  virtual bool isTestScalarKernelTrialProduct() const { return false; }
+
+  /** \brief Return the same integral for the kernels with real values,
+   *  or a null pointer if it is not available.
+   *
+   *  This integral is used to evaluate the real singular parts of split
+   *  kernels (see CollectionOfKernels::singularPart()) in real arithmetic.
+   *  The default implementation returns a null pointer. */
+  virtual shared_ptr<const RealKernelIntegral> realKernelIntegral() const {
+    return shared_ptr<const RealKernelIntegral>();
+  }
+
   /** \brief Evaluate the integral using a tensor-product quadrature rule.
    *
    *  This function should evaluate the integral using a quadrature rule of the
@@ -177,6 +203,37 @@ public:
       const std::vector<CoordinateType> &trialQuadWeights,
       arma::Mat<ResultType> &result) const = 0;
 
+  /** \brief Evaluate the integrals over several pairs of elements using the
+   *  same tensor-product quadrature rule.
+   *
+   *  The parameters have the same meaning as in
+   *  evaluateWithTensorQuadratureRule(), except that \p testGeomData, \p
+   *  trialGeomData, \p testTransformations, \p trialTransformations, \p
+   *  kernels and \p result contain one entry per element pair. All pairs
+   *  must involve the same shapesets.
+   *
+   *  The default implementation calls evaluateWithTensorQuadratureRule() for
+   *  each pair. Subclasses may override it to share work between the pairs.
+   */
+  virtual void evaluateBatchWithTensorQuadratureRule(
+      const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+      const std::vector<const GeometricalData<CoordinateType> *> &
+          trialGeomData,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          testTransformations,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          trialTransformations,
+      const std::vector<const CollectionOf4dArrays<KernelType> *> &kernels,
+      const std::vector<CoordinateType> &testQuadWeights,
+      const std::vector<CoordinateType> &trialQuadWeights,
+      const std::vector<arma::Mat<ResultType> *> &result) const {
+    for (size_t i = 0; i < result.size(); ++i)
+      evaluateWithTensorQuadratureRule(
+          *testGeomData[i], *trialGeomData[i], *testTransformations[i],
+          *trialTransformations[i], *kernels[i], testQuadWeights,
+          trialQuadWeights, *result[i]);
+  }
+
   /** \brief Evaluate the integral using a non-tensor-product quadrature rule.
    *
    *  This function should evaluate the integral using a quadrature rule of the
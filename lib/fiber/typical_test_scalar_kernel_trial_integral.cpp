@@ -29,6 +29,7 @@
 #include "../common/acc.hpp"
 #include "../common/complex_aux.hpp"
 
+#include <boost/make_shared.hpp>
 #include <cassert>
 #include <iostream>
 #include <tbb/scalable_allocator.h>
@@ -239,6 +240,165 @@ void evaluateWithNontensorQuadratureRuleStandardImpl(
   }
 }
 
+// Fixed-size version of evaluateWithTensorQuadratureRuleImpl() for a single
+// scalar transformation, as used by the P0 and P1 spaces. testWeights and
+// trialWeights are the quadrature weights multiplied by the integration
+// elements. With the sizes known at compile time, the loops can be unrolled
+// and the partial sums kept in registers.
+template <int TestDofCount, int TrialDofCount, int TestPointCount,
+          int TrialPointCount, typename BasisFunctionType, typename KernelType,
+          typename ResultType>
+void evaluateFixedSizeTensorQuadratureKernel(
+    const BasisFunctionType *testValues, const BasisFunctionType *trialValues,
+    const KernelType *kernelValues,
+    const typename ScalarTraits<ResultType>::RealType *testWeights,
+    const typename ScalarTraits<ResultType>::RealType *trialWeights,
+    ResultType *result) {
+  ResultType sums[TestDofCount][TrialDofCount] = {};
+  for (int trialPoint = 0; trialPoint < TrialPointCount; ++trialPoint) {
+    // partialSums[i] = sum_p conj(test_i(p)) kernel(p, q)
+    ResultType partialSums[TestDofCount] = {};
+    for (int testPoint = 0; testPoint < TestPointCount; ++testPoint) {
+      const KernelType kernel =
+          kernelValues[testPoint + TestPointCount * trialPoint] *
+          testWeights[testPoint];
+      for (int testDof = 0; testDof < TestDofCount; ++testDof)
+        partialSums[testDof] +=
+            conj(testValues[testDof + TestDofCount * testPoint]) * kernel;
+    }
+    for (int trialDof = 0; trialDof < TrialDofCount; ++trialDof) {
+      const BasisFunctionType trial =
+          trialValues[trialDof + TrialDofCount * trialPoint] *
+          trialWeights[trialPoint];
+      for (int testDof = 0; testDof < TestDofCount; ++testDof)
+        sums[testDof][trialDof] += partialSums[testDof] * trial;
+    }
+  }
+  for (int trialDof = 0; trialDof < TrialDofCount; ++trialDof)
+    for (int testDof = 0; testDof < TestDofCount; ++testDof)
+      result[testDof + TestDofCount * trialDof] = sums[testDof][trialDof];
+}
+
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+struct FixedSizeTensorQuadratureKernel {
+  typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+  typedef void (*Type)(const BasisFunctionType *, const BasisFunctionType *,
+                       const KernelType *, const CoordinateType *,
+                       const CoordinateType *, ResultType *);
+};
+
+template <int TestDofCount, int TrialDofCount, int TestPointCount,
+          typename BasisFunctionType, typename KernelType, typename ResultType>
+typename FixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                         ResultType>::Type
+selectOnTrialPointCount(size_t trialPointCount) {
+  switch (trialPointCount) {
+  case 3:
+    return &evaluateFixedSizeTensorQuadratureKernel<
+        TestDofCount, TrialDofCount, TestPointCount, 3, BasisFunctionType,
+        KernelType, ResultType>;
+  case 4:
+    return &evaluateFixedSizeTensorQuadratureKernel<
+        TestDofCount, TrialDofCount, TestPointCount, 4, BasisFunctionType,
+        KernelType, ResultType>;
+  case 6:
+    return &evaluateFixedSizeTensorQuadratureKernel<
+        TestDofCount, TrialDofCount, TestPointCount, 6, BasisFunctionType,
+        KernelType, ResultType>;
+  default:
+    return 0;
+  }
+}
+
+template <int TestDofCount, int TrialDofCount, typename BasisFunctionType,
+          typename KernelType, typename ResultType>
+typename FixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                         ResultType>::Type
+selectOnPointCounts(size_t testPointCount, size_t trialPointCount) {
+  switch (testPointCount) {
+  case 3:
+    return selectOnTrialPointCount<TestDofCount, TrialDofCount, 3,
+                                   BasisFunctionType, KernelType, ResultType>(
+        trialPointCount);
+  case 4:
+    return selectOnTrialPointCount<TestDofCount, TrialDofCount, 4,
+                                   BasisFunctionType, KernelType, ResultType>(
+        trialPointCount);
+  case 6:
+    return selectOnTrialPointCount<TestDofCount, TrialDofCount, 6,
+                                   BasisFunctionType, KernelType, ResultType>(
+        trialPointCount);
+  default:
+    return 0;
+  }
+}
+
+// Return the fixed-size kernel for the given arrays if the shapesets have 1
+// or 3 scalar functions (P0 and P1 on triangles) and the quadrature rules
+// have 3, 4 or 6 points (Gauss triangle rules of orders 2-4, the default
+// orders of regular integrals for these shapesets), otherwise 0.
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+typename FixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                         ResultType>::Type
+selectFixedSizeTensorQuadratureKernel(
+    const CollectionOf3dArrays<BasisFunctionType> &testValues,
+    const CollectionOf3dArrays<BasisFunctionType> &trialValues,
+    const CollectionOf4dArrays<KernelType> &kernelValues,
+    size_t testPointCount, size_t trialPointCount) {
+  if (testValues.size() != 1 || testValues[0].extent(0) != 1 ||
+      kernelValues.size() != 1)
+    return 0;
+  const size_t testDofCount = testValues[0].extent(1);
+  const size_t trialDofCount = trialValues[0].extent(1);
+  if (testDofCount == 1 && trialDofCount == 1)
+    return selectOnPointCounts<1, 1, BasisFunctionType, KernelType,
+                               ResultType>(testPointCount, trialPointCount);
+  if (testDofCount == 1 && trialDofCount == 3)
+    return selectOnPointCounts<1, 3, BasisFunctionType, KernelType,
+                               ResultType>(testPointCount, trialPointCount);
+  if (testDofCount == 3 && trialDofCount == 1)
+    return selectOnPointCounts<3, 1, BasisFunctionType, KernelType,
+                               ResultType>(testPointCount, trialPointCount);
+  if (testDofCount == 3 && trialDofCount == 3)
+    return selectOnPointCounts<3, 3, BasisFunctionType, KernelType,
+                               ResultType>(testPointCount, trialPointCount);
+  return 0;
+}
+
+// Evaluate the integral with a kernel returned by
+// selectFixedSizeTensorQuadratureKernel().
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void evaluateWithFixedSizeTensorQuadratureRule(
+    typename FixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                             ResultType>::Type kernel,
+    const GeometricalData<typename ScalarTraits<ResultType>::RealType> &
+        testGeomData,
+    const GeometricalData<typename ScalarTraits<ResultType>::RealType> &
+        trialGeomData,
+    const CollectionOf3dArrays<BasisFunctionType> &testValues,
+    const CollectionOf3dArrays<BasisFunctionType> &trialValues,
+    const CollectionOf4dArrays<KernelType> &kernelValues,
+    const std::vector<typename ScalarTraits<ResultType>::RealType> &
+        testQuadWeights,
+    const std::vector<typename ScalarTraits<ResultType>::RealType> &
+        trialQuadWeights,
+    arma::Mat<ResultType> &result) {
+  typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+  const size_t maxPointCount = 6;
+  assert(testQuadWeights.size() <= maxPointCount);
+  assert(trialQuadWeights.size() <= maxPointCount);
+
+  CoordinateType testWeights[maxPointCount], trialWeights[maxPointCount];
+  for (size_t point = 0; point < testQuadWeights.size(); ++point)
+    testWeights[point] =
+        testGeomData.integrationElements(point) * testQuadWeights[point];
+  for (size_t point = 0; point < trialQuadWeights.size(); ++point)
+    trialWeights[point] =
+        trialGeomData.integrationElements(point) * trialQuadWeights[point];
+  kernel(testValues[0].begin(), trialValues[0].begin(),
+         kernelValues[0].begin(), testWeights, trialWeights, result.memptr());
+}
+
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
 void evaluateWithTensorQuadratureRuleImpl(
     const GeometricalData<typename ScalarTraits<ResultType>::RealType> &
@@ -287,6 +447,20 @@ void evaluateWithTensorQuadratureRuleImpl(
   assert(result.n_rows == testDofCount);
   assert(result.n_cols == trialDofCount);
 
+  typename FixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                           ResultType>::Type fixedSizeKernel =
+      selectFixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                            ResultType>(
+          testValues, trialValues, kernelValues, testPointCount,
+          trialPointCount);
+  if (fixedSizeKernel) {
+    evaluateWithFixedSizeTensorQuadratureRule<BasisFunctionType, KernelType,
+                                              ResultType>(
+        fixedSizeKernel, testGeomData, trialGeomData, testValues, trialValues,
+        kernelValues, testQuadWeights, trialQuadWeights, result);
+    return;
+  }
+
   // Initialize the result matrix
   result.fill(0);
 
@@ -350,6 +524,48 @@ void evaluateWithTensorQuadratureRuleImpl(
   }
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void evaluateBatchWithTensorQuadratureRuleImpl(
+    const std::vector<const GeometricalData<
+        typename ScalarTraits<ResultType>::RealType> *> &testGeomData,
+    const std::vector<const GeometricalData<
+        typename ScalarTraits<ResultType>::RealType> *> &trialGeomData,
+    const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+        testValues,
+    const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+        trialValues,
+    const std::vector<const CollectionOf4dArrays<KernelType> *> &kernelValues,
+    const std::vector<typename ScalarTraits<ResultType>::RealType> &
+        testQuadWeights,
+    const std::vector<typename ScalarTraits<ResultType>::RealType> &
+        trialQuadWeights,
+    const std::vector<arma::Mat<ResultType> *> &result) {
+  const size_t pairCount = result.size();
+  if (pairCount == 0)
+    return;
+
+  // All pairs involve the same shapesets and quadrature rules, so the
+  // fixed-size kernel, if any, is chosen once for the whole batch
+  typename FixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                           ResultType>::Type fixedSizeKernel =
+      selectFixedSizeTensorQuadratureKernel<BasisFunctionType, KernelType,
+                                            ResultType>(
+          *testValues[0], *trialValues[0], *kernelValues[0],
+          testQuadWeights.size(), trialQuadWeights.size());
+  for (size_t i = 0; i < pairCount; ++i)
+    if (fixedSizeKernel)
+      evaluateWithFixedSizeTensorQuadratureRule<BasisFunctionType, KernelType,
+                                                ResultType>(
+          fixedSizeKernel, *testGeomData[i], *trialGeomData[i],
+          *testValues[i], *trialValues[i], *kernelValues[i], testQuadWeights,
+          trialQuadWeights, *result[i]);
+    else
+      evaluateWithTensorQuadratureRuleImpl(
+          *testGeomData[i], *trialGeomData[i], *testValues[i],
+          *trialValues[i], *kernelValues[i], testQuadWeights,
+          trialQuadWeights, *result[i]);
+}
+
 } // namespace
 
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
@@ -361,6 +577,15 @@ void TypicalTestScalarKernelTrialIntegralBase<
   trialGeomDeps |= INTEGRATION_ELEMENTS;
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+shared_ptr<const typename TypicalTestScalarKernelTrialIntegralBase<
+    BasisFunctionType, KernelType, ResultType>::RealKernelIntegral>
+TypicalTestScalarKernelTrialIntegralBase<
+    BasisFunctionType, KernelType, ResultType>::realKernelIntegral() const {
+  return boost::make_shared<TypicalTestScalarKernelTrialIntegral<
+      BasisFunctionType, CoordinateType, BasisFunctionType>>();
+}
+
 template <typename BasisFunctionType_, typename ResultType_>
 void TypicalTestScalarKernelTrialIntegral<BasisFunctionType_,
                                           BasisFunctionType_, ResultType_>::
@@ -395,6 +620,29 @@ void TypicalTestScalarKernelTrialIntegral<CoordinateType_,
       testQuadWeights, trialQuadWeights, result);
 }
 
+template <typename CoordinateType_>
+void TypicalTestScalarKernelTrialIntegral<CoordinateType_,
+                                          std::complex<CoordinateType_>,
+                                          std::complex<CoordinateType_>>::
+    evaluateBatchWithTensorQuadratureRule(
+        const std::vector<const GeometricalData<CoordinateType> *> &
+            testGeomData,
+        const std::vector<const GeometricalData<CoordinateType> *> &
+            trialGeomData,
+        const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+            testValues,
+        const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+            trialValues,
+        const std::vector<const CollectionOf4dArrays<KernelType> *> &
+            kernelValues,
+        const std::vector<CoordinateType> &testQuadWeights,
+        const std::vector<CoordinateType> &trialQuadWeights,
+        const std::vector<arma::Mat<ResultType> *> &result) const {
+  evaluateBatchWithTensorQuadratureRuleImpl(
+      testGeomData, trialGeomData, testValues, trialValues, kernelValues,
+      testQuadWeights, trialQuadWeights, result);
+}
+
 template <typename CoordinateType>
 void TypicalTestScalarKernelTrialIntegral<CoordinateType,
                                           std::complex<CoordinateType>,
@@ -513,6 +761,28 @@ void TypicalTestScalarKernelTrialIntegral<BasisFunctionType_,
       testQuadWeights, trialQuadWeights, result);
 }
 
+template <typename BasisFunctionType_, typename ResultType_>
+void TypicalTestScalarKernelTrialIntegral<BasisFunctionType_,
+                                          BasisFunctionType_, ResultType_>::
+    evaluateBatchWithTensorQuadratureRule(
+        const std::vector<const GeometricalData<CoordinateType> *> &
+            testGeomData,
+        const std::vector<const GeometricalData<CoordinateType> *> &
+            trialGeomData,
+        const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+            testValues,
+        const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+            trialValues,
+        const std::vector<const CollectionOf4dArrays<KernelType> *> &
+            kernelValues,
+        const std::vector<CoordinateType> &testQuadWeights,
+        const std::vector<CoordinateType> &trialQuadWeights,
+        const std::vector<arma::Mat<ResultType> *> &result) const {
+  evaluateBatchWithTensorQuadratureRuleImpl(
+      testGeomData, trialGeomData, testValues, trialValues, kernelValues,
+      testQuadWeights, trialQuadWeights, result);
+}
+
 template <typename CoordinateType>
 TypicalTestScalarKernelTrialIntegral<
     std::complex<CoordinateType>, CoordinateType,
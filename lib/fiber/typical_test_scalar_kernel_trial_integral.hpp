@@ -43,9 +43,14 @@ public:
   typedef typename Base::BasisFunctionType BasisFunctionType;
   typedef typename Base::KernelType KernelType;
   typedef typename Base::ResultType ResultType;
+  typedef typename Base::RealKernelIntegral RealKernelIntegral;
 
   virtual void addGeometricalDependencies(size_t &testGeomDeps,
                                           size_t &trialGeomDeps) const;
+
+  virtual bool isTestScalarKernelTrialProduct() const { return true; }
+
+  virtual shared_ptr<const RealKernelIntegral> realKernelIntegral() const;
 };
 
 /** \ingroup weak_form_elements
@@ -106,6 +111,20 @@ public:
       const std::vector<CoordinateType> &trialQuadWeights,
       arma::Mat<ResultType> &result) const;
 
+  virtual void evaluateBatchWithTensorQuadratureRule(
+      const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+      const std::vector<const GeometricalData<CoordinateType> *> &
+          trialGeomData,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          testValues,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          trialValues,
+      const std::vector<const CollectionOf4dArrays<KernelType> *> &
+          kernelValues,
+      const std::vector<CoordinateType> &testQuadWeights,
+      const std::vector<CoordinateType> &trialQuadWeights,
+      const std::vector<arma::Mat<ResultType> *> &result) const;
+
   virtual void evaluateWithNontensorQuadratureRule(
       const GeometricalData<CoordinateType> &testGeomData,
       const GeometricalData<CoordinateType> &trialGeomData,
@@ -147,6 +166,20 @@ public:
       const std::vector<CoordinateType> &trialQuadWeights,
       arma::Mat<ResultType> &result) const;
 
+  virtual void evaluateBatchWithTensorQuadratureRule(
+      const std::vector<const GeometricalData<CoordinateType> *> &testGeomData,
+      const std::vector<const GeometricalData<CoordinateType> *> &
+          trialGeomData,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          testValues,
+      const std::vector<const CollectionOf3dArrays<BasisFunctionType> *> &
+          trialValues,
+      const std::vector<const CollectionOf4dArrays<KernelType> *> &
+          kernelValues,
+      const std::vector<CoordinateType> &testQuadWeights,
+      const std::vector<CoordinateType> &trialQuadWeights,
+      const std::vector<arma::Mat<ResultType> *> &result) const;
+
   virtual void evaluateWithNontensorQuadratureRule(
       const GeometricalData<CoordinateType> &testGeomData,
       const GeometricalData<CoordinateType> &trialGeomData,
@@ -41,6 +41,7 @@ namespace Bempp {
 
 /** \cond FORWARD_DECL */
 template <int dim> class ConcreteGeometryFactory;
+template <int codim> class NativeTriangularEntity;
 /** \endcond */
 
 /** \ingroup grid_internal
@@ -73,6 +74,7 @@ private:
 
   template <int mydim, typename DuneEntity> friend class ConcreteEntity;
   friend class ConcreteGeometryFactory<dim_>;
+  template <int codim> friend class NativeTriangularEntity;
 
 public:
   /** \brief Constructor from a DuneGeometry object. */
@@ -169,13 +169,14 @@ public:
   virtual std::unique_ptr<GridView> levelView(size_t level) const {
     return std::unique_ptr<GridView>(
         new ConcreteGridView<typename DuneGrid::LevelGridView>(
-            m_dune_grid->levelView(level), m_domain_index));
+            m_dune_grid->levelView(level), m_domain_index,
+            levelGeometryCache(level)));
   }
 
   virtual std::unique_ptr<GridView> leafView() const {
     return std::unique_ptr<GridView>(
         new ConcreteGridView<typename DuneGrid::LeafGridView>(
-            m_dune_grid->leafView(), m_domain_index));
+            m_dune_grid->leafView(), m_domain_index, leafGeometryCache()));
   }
 
   /** @}
@@ -254,8 +255,31 @@ private:
   // (unclear what to do with the pointer to the grid)
   ConcreteGrid(const ConcreteGrid &);
   ConcreteGrid &operator=(const ConcreteGrid &);
+
+  // The geometry caches are shared by all views of a given level (or the
+  // leaf), so that GridView::rawGeometry() is evaluated once per grid.
+  shared_ptr<GridViewGeometryCache> leafGeometryCache() const {
+    tbb::mutex::scoped_lock lock(m_geometryCacheMutex);
+    if (!m_leafGeometryCache)
+      m_leafGeometryCache = boost::make_shared<GridViewGeometryCache>();
+    return m_leafGeometryCache;
+  }
+
+  shared_ptr<GridViewGeometryCache> levelGeometryCache(size_t level) const {
+    tbb::mutex::scoped_lock lock(m_geometryCacheMutex);
+    if (m_levelGeometryCaches.size() <= level)
+      m_levelGeometryCaches.resize(level + 1);
+    if (!m_levelGeometryCaches[level])
+      m_levelGeometryCaches[level] =
+          boost::make_shared<GridViewGeometryCache>();
+    return m_levelGeometryCaches[level];
+  }
+
   mutable shared_ptr<Grid> m_barycentricGrid;
   mutable tbb::mutex m_barycentricSpaceMutex;
+  mutable shared_ptr<GridViewGeometryCache> m_leafGeometryCache;
+  mutable std::vector<shared_ptr<GridViewGeometryCache>> m_levelGeometryCaches;
+  mutable tbb::mutex m_geometryCacheMutex;
 };
 
 } // namespace Bempp
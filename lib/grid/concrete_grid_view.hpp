@@ -29,7 +29,14 @@
 #include "concrete_index_set.hpp"
 #include "concrete_range_entity_iterator.hpp"
 #include "concrete_vtk_writer.hpp"
+#include "element_connectivity.hpp"
+#include "grid_view_geometry_cache.hpp"
 #include "reverse_element_mapper.hpp"
+#include "../common/boost_make_shared_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+
+#include <mutex>
 
 namespace Bempp {
 
@@ -44,16 +51,26 @@ private:
   ConcreteElementMapper<DuneGridView> m_element_mapper;
   const DomainIndex &m_domain_index;
   mutable ReverseElementMapper m_reverse_element_mapper;
-  mutable bool m_reverse_element_mapper_is_up_to_date;
+  mutable std::once_flag m_reverse_element_mapper_flag;
+  shared_ptr<GridViewGeometryCache> m_geometry_cache;
 
 public:
-  /** \brief Constructor */
-  explicit ConcreteGridView(const DuneGridView &dune_gv,
-                            const DomainIndex &domain_index)
+  /** \brief Constructor
+
+    \param geometry_cache
+      Storage for the raw geometry and connectivity of this view, to be
+      shared with other views of the same grid level. If null, the view gets
+      its own. */
+  explicit ConcreteGridView(
+      const DuneGridView &dune_gv, const DomainIndex &domain_index,
+      const shared_ptr<GridViewGeometryCache> &geometry_cache =
+          shared_ptr<GridViewGeometryCache>())
       : m_dune_gv(dune_gv), m_index_set(&dune_gv.indexSet()),
         m_element_mapper(dune_gv), m_domain_index(domain_index),
         m_reverse_element_mapper(*this),
-        m_reverse_element_mapper_is_up_to_date(false) {}
+        m_geometry_cache(geometry_cache
+                             ? geometry_cache
+                             : boost::make_shared<GridViewGeometryCache>()) {}
 
   /** \brief Read-only access to the underlying Dune grid view object. */
   const DuneGridView &duneGridView() const { return m_dune_gv; }
@@ -96,10 +113,8 @@ public:
   }
 
   virtual const ReverseElementMapper &reverseElementMapper() const {
-    if (!m_reverse_element_mapper_is_up_to_date) {
-      m_reverse_element_mapper.update();
-      m_reverse_element_mapper_is_up_to_date = true;
-    }
+    std::call_once(m_reverse_element_mapper_flag,
+                   [&]() { m_reverse_element_mapper.update(); });
     return m_reverse_element_mapper;
   }
 
@@ -109,6 +124,8 @@ public:
         new ConcreteVtkWriter<DuneGridView>(m_dune_gv, dm));
   }
 
+  virtual shared_ptr<const ElementConnectivity> elementConnectivity() const;
+
 private:
   virtual std::unique_ptr<EntityIterator<0>> entityCodim0Iterator() const {
     return entityCodimNIterator<0>();
@@ -175,6 +192,16 @@ private:
                              arma::Mat<int> &elementCorners,
                              arma::Mat<char> &auxData,
                              std::vector<int> *domainIndices) const;
+
+  virtual shared_ptr<const Fiber::RawGridGeometry<double>>
+  rawGeometryDoubleImpl() const;
+  virtual shared_ptr<const Fiber::RawGridGeometry<float>>
+  rawGeometryFloatImpl() const;
+
+  template <typename CoordinateType>
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> rawGeometryImpl(
+      std::once_flag &flag,
+      shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &geometry) const;
 };
 
 } // namespace Bempp
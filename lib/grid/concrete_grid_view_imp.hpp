@@ -39,6 +39,81 @@ void ConcreteGridView<DuneGridView>::getRawElementDataFloatImpl(
   getRawElementDataImpl(vertices, elementCorners, auxData, domainIndices);
 }
 
+template <typename DuneGridView>
+shared_ptr<const Fiber::RawGridGeometry<double>>
+ConcreteGridView<DuneGridView>::rawGeometryDoubleImpl() const {
+  return rawGeometryImpl(m_geometry_cache->doubleFlag,
+                         m_geometry_cache->doubleGeometry);
+}
+
+template <typename DuneGridView>
+shared_ptr<const Fiber::RawGridGeometry<float>>
+ConcreteGridView<DuneGridView>::rawGeometryFloatImpl() const {
+  return rawGeometryImpl(m_geometry_cache->floatFlag,
+                         m_geometry_cache->floatGeometry);
+}
+
+template <typename DuneGridView>
+shared_ptr<const ElementConnectivity>
+ConcreteGridView<DuneGridView>::elementConnectivity() const {
+  std::call_once(m_geometry_cache->connectivityFlag, [&]() {
+    typedef typename DuneGridView::Grid DuneGrid;
+    typedef typename DuneGridView::IndexSet DuneIndexSet;
+    typedef typename DuneGridView::template Codim<0>::Iterator
+    DuneElementIterator;
+    typedef typename DuneGrid::ctype ctype;
+    const int dimGrid = DuneGrid::dimension;
+    const int codimEdge = 1;
+
+    // Vertices and domains of the elements are already available in the raw
+    // geometry; only the edges require another pass over the Dune grid
+    shared_ptr<const Fiber::RawGridGeometry<double>> geometry =
+        rawGeometry<double>();
+
+    const DuneIndexSet &indexSet = m_dune_gv.indexSet();
+    const int MAX_EDGE_COUNT = dimGrid == 1 ? 2 : 4;
+    arma::Mat<int> elementEdges(MAX_EDGE_COUNT, entityCount(0));
+    for (DuneElementIterator it = m_dune_gv.template begin<0>();
+         it != m_dune_gv.template end<0>(); ++it) {
+      const size_t index = indexSet.index(*it);
+      const Dune::GenericReferenceElement<ctype, dimGrid> &refElement =
+          Dune::GenericReferenceElements<ctype, dimGrid>::general(it->type());
+      const int edgeCount = refElement.size(codimEdge);
+      assert(edgeCount <= MAX_EDGE_COUNT);
+      for (int i = 0; i < edgeCount; ++i)
+        elementEdges(i, index) = indexSet.subIndex(*it, i, codimEdge);
+      for (int i = edgeCount; i < MAX_EDGE_COUNT; ++i)
+        elementEdges(i, index) = -1;
+    }
+
+    m_geometry_cache->connectivity = boost::make_shared<ElementConnectivity>(
+        geometry->elementCornerIndices(), elementEdges,
+        geometry->domainIndices(), entityCount(dimGrid),
+        entityCount(codimEdge));
+  });
+  return m_geometry_cache->connectivity;
+}
+
+template <typename DuneGridView>
+template <typename CoordinateType>
+shared_ptr<const Fiber::RawGridGeometry<CoordinateType>>
+ConcreteGridView<DuneGridView>::rawGeometryImpl(
+    std::once_flag &flag,
+    shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &geometry) const {
+  std::call_once(flag, [&]() {
+    typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+    shared_ptr<RawGridGeometry> newGeometry =
+        boost::make_shared<RawGridGeometry>(dim(), dimWorld());
+    getRawElementDataImpl(newGeometry->vertices(),
+                          newGeometry->elementCornerIndices(),
+                          newGeometry->auxData(),
+                          &newGeometry->domainIndices());
+    newGeometry->computeElementGeometry();
+    geometry = newGeometry;
+  });
+  return geometry;
+}
+
 template <typename DuneGridView>
 template <typename CoordinateType>
 void ConcreteGridView<DuneGridView>::getRawElementDataImpl(
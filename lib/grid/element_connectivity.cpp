@@ -0,0 +1,112 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "element_connectivity.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+namespace Bempp {
+
+namespace {
+
+// Build the inverse of the incidence relation between elements (columns of
+// subentities) and entities (entries of subentities) in compressed form.
+void invertIncidence(const arma::Mat<int> &subentities, int entityCount,
+                     std::vector<int> &offsets, std::vector<int> &elements) {
+  // An entity index in the upper and an element index in the lower half of
+  // each key: after sorting, the elements adjacent to each entity are
+  // contiguous and in increasing order
+  std::vector<unsigned long long> keys;
+  keys.reserve(subentities.n_elem);
+  for (size_t e = 0; e < subentities.n_cols; ++e)
+    for (size_t i = 0; i < subentities.n_rows; ++i) {
+      const int entity = subentities(i, e);
+      if (entity < 0)
+        continue;
+      if (entity >= entityCount)
+        throw std::invalid_argument("ElementConnectivity::"
+                                    "ElementConnectivity(): "
+                                    "entity index out of range");
+      keys.push_back((static_cast<unsigned long long>(entity) << 32) | e);
+    }
+  tbb::parallel_sort(keys.begin(), keys.end());
+
+  elements.resize(keys.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, keys.size()),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      elements[i] = int(keys[i] & 0xffffffffULL);
+  });
+  offsets.resize(entityCount + 1);
+  tbb::parallel_for(tbb::blocked_range<int>(0, entityCount + 1),
+                    [&](const tbb::blocked_range<int> &r) {
+    for (int k = r.begin(); k != r.end(); ++k)
+      offsets[k] =
+          std::lower_bound(keys.begin(), keys.end(),
+                           static_cast<unsigned long long>(k) << 32) -
+          keys.begin();
+  });
+}
+
+} // namespace
+
+ElementConnectivity::ElementConnectivity(const arma::Mat<int> &elementCorners,
+                                         const arma::Mat<int> &elementEdges,
+                                         const std::vector<int> &domainIndices,
+                                         int vertexCount, int edgeCount)
+    : m_elementCorners(elementCorners), m_elementEdges(elementEdges),
+      m_domainIndices(domainIndices) {
+  const size_t elementCount = domainIndices.size();
+  if (elementCorners.n_cols != elementCount ||
+      elementEdges.n_cols != elementCount)
+    throw std::invalid_argument("ElementConnectivity::ElementConnectivity(): "
+                                "'elementCorners', 'elementEdges' and "
+                                "'domainIndices' must have the same number "
+                                "of elements");
+  if (vertexCount < 0 || edgeCount < 0)
+    throw std::invalid_argument("ElementConnectivity::ElementConnectivity(): "
+                                "negative entity count");
+
+  invertIncidence(elementCorners, vertexCount, m_vertexElementOffsets,
+                  m_vertexElements);
+  invertIncidence(elementEdges, edgeCount, m_edgeElementOffsets,
+                  m_edgeElements);
+
+  m_elementNeighbours.set_size(elementEdges.n_rows, elementCount);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, elementCount),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t e = r.begin(); e != r.end(); ++e)
+      for (size_t i = 0; i < elementEdges.n_rows; ++i) {
+        int neighbour = -1;
+        const int edge = elementEdges(i, e);
+        if (edge >= 0 && m_edgeElementOffsets[edge + 1] -
+                                 m_edgeElementOffsets[edge] == 2) {
+          const int *adjacent = &m_edgeElements[m_edgeElementOffsets[edge]];
+          neighbour = adjacent[0] == int(e) ? adjacent[1] : adjacent[0];
+        }
+        m_elementNeighbours(i, e) = neighbour;
+      }
+  });
+}
+
+} // namespace Bempp
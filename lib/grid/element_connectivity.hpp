@@ -0,0 +1,143 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_element_connectivity_hpp
+#define bempp_element_connectivity_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <vector>
+
+namespace Bempp {
+
+/** \ingroup grid
+    \brief Connectivity of the elements of a grid view stored in contiguous
+    arrays.
+
+    This class gives access to the element-vertex, element-edge and
+    element-domain incidence of a grid view and to the inverse incidence
+    and neighbour tables derived from them. Loops over these arrays avoid
+    the virtual calls and heap allocations made by an EntityIterator and
+    can be parallelised directly. All indices agree with those returned by
+    the IndexSet of the grid view.
+
+    Here "edges" are the entities of codimension 1, i.e. the edges of a
+    two-dimensional grid and the vertices of a one-dimensional one.
+
+    Objects of this class are obtained from GridView::elementConnectivity(). */
+class ElementConnectivity {
+public:
+  /** \brief Constructor.
+
+    \param[in] elementCorners
+      2D array whose (i, j)th element is the index of the ith vertex of the
+      jth element, or -1 if the jth element has fewer than i + 1 vertices.
+    \param[in] elementEdges
+      2D array whose (i, j)th element is the index of the ith edge of the
+      jth element, or -1 if the jth element has fewer than i + 1 edges.
+    \param[in] domainIndices
+      Domain index of each element.
+    \param[in] vertexCount, edgeCount
+      Numbers of vertices and edges of the grid view.
+
+    The inverse incidence and neighbour tables are built in parallel. */
+  ElementConnectivity(const arma::Mat<int> &elementCorners,
+                      const arma::Mat<int> &elementEdges,
+                      const std::vector<int> &domainIndices, int vertexCount,
+                      int edgeCount);
+
+  /** \brief Number of elements. */
+  int elementCount() const { return m_domainIndices.size(); }
+  /** \brief Number of vertices. */
+  int vertexCount() const { return m_vertexElementOffsets.size() - 1; }
+  /** \brief Number of edges. */
+  int edgeCount() const { return m_edgeElementOffsets.size() - 1; }
+
+  /** \brief Indices of the vertices of each element.
+
+    The (i, j)th element is the index of the ith vertex of the jth element,
+    or -1 if the jth element has fewer than i + 1 vertices. */
+  const arma::Mat<int> &elementCorners() const { return m_elementCorners; }
+
+  /** \brief Number of vertices of the element with index \p element. */
+  int elementCornerCount(int element) const {
+    int count = 0;
+    while (count < int(m_elementCorners.n_rows) &&
+           m_elementCorners(count, element) >= 0)
+      ++count;
+    return count;
+  }
+
+  /** \brief Indices of the edges of each element.
+
+    The (i, j)th element is the index of the ith edge of the jth element,
+    numbered as in the Dune reference element, or -1 if the jth element has
+    fewer than i + 1 edges. */
+  const arma::Mat<int> &elementEdges() const { return m_elementEdges; }
+
+  /** \brief Domain index of each element. */
+  const std::vector<int> &domainIndices() const { return m_domainIndices; }
+
+  /** \brief Neighbours of each element.
+
+    The (i, j)th element is the index of the element sharing the ith edge
+    of the jth element, or -1 if that edge lies on the boundary of the grid,
+    is shared by more than two elements or does not exist. */
+  const arma::Mat<int> &elementNeighbours() const {
+    return m_elementNeighbours;
+  }
+
+  /** \brief Offsets into vertexElements().
+
+    The elements adjacent to vertex \p v are stored at positions
+    <tt>vertexElementOffsets()[v]</tt> to
+    <tt>vertexElementOffsets()[v + 1] - 1</tt> of vertexElements(). */
+  const std::vector<int> &vertexElementOffsets() const {
+    return m_vertexElementOffsets;
+  }
+  /** \brief Elements adjacent to each vertex, in increasing order. */
+  const std::vector<int> &vertexElements() const { return m_vertexElements; }
+
+  /** \brief Offsets into edgeElements().
+
+    The elements adjacent to edge \p e are stored at positions
+    <tt>edgeElementOffsets()[e]</tt> to
+    <tt>edgeElementOffsets()[e + 1] - 1</tt> of edgeElements(). */
+  const std::vector<int> &edgeElementOffsets() const {
+    return m_edgeElementOffsets;
+  }
+  /** \brief Elements adjacent to each edge, in increasing order. */
+  const std::vector<int> &edgeElements() const { return m_edgeElements; }
+
+private:
+  arma::Mat<int> m_elementCorners;
+  arma::Mat<int> m_elementEdges;
+  std::vector<int> m_domainIndices;
+  arma::Mat<int> m_elementNeighbours;
+  std::vector<int> m_vertexElementOffsets;
+  std::vector<int> m_vertexElements;
+  std::vector<int> m_edgeElementOffsets;
+  std::vector<int> m_edgeElements;
+};
+
+} // namespace Bempp
+
+#endif
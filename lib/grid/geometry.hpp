@@ -257,7 +257,9 @@ public:
    *
    *  \param[in]  what
    *    Superposition of zero or more flags from the enum GeometricalDataType.
-   *    The flag DOMAIN_INDEX is ignored.
+   *    The flag DOMAIN_INDEX is ignored. If SOA_LAYOUT is present, the
+   *    globals, normals and Jacobians are additionally copied into the
+   *    structure-of-arrays fields of \p data.
    *  \param[in]  local
    *    Matrix whose \f$i\f$th column contains the local coordinates of a
    *    point \f$x_i \in D\f$.
@@ -194,6 +194,8 @@ inline void Geometry::getNormals(const arma::Mat<float> &local,
 inline void Geometry::getData(size_t what, const arma::Mat<double> &local,
                               Fiber::GeometricalData<double> &data) const {
   getDataImpl(what, local, data);
+  if (what & Fiber::SOA_LAYOUT)
+    data.updateSoaLayout();
 }
 
 inline void Geometry::getData(size_t what, const arma::Mat<float> &local,
@@ -208,6 +210,8 @@ inline void Geometry::getData(size_t what, const arma::Mat<float> &local,
   convertCube(dataDouble.jacobiansTransposed, data.jacobiansTransposed);
   convertCube(dataDouble.jacobianInversesTransposed,
               data.jacobianInversesTransposed);
+  if (what & Fiber::SOA_LAYOUT)
+    data.updateSoaLayout();
 }
 
 template <typename T1, typename T2>
@@ -19,13 +19,20 @@
 // THE SOFTWARE.
 
 #include "grid.hpp"
-#include "entity.hpp"
-#include "entity_iterator.hpp"
-#include "geometry.hpp"
 #include "grid_view.hpp"
 #include "ray_triangle_intersection.hpp"
 
 #include "../common/not_implemented_error.hpp"
+#include "../fiber/element_bounding_volume_hierarchy.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
 
 namespace Bempp {
 
@@ -39,15 +46,191 @@ double max3(double x, double y, double z) {
   return std::max(x, std::max(y, z));
 }
 
-bool isNew(const arma::Col<double> &intersection,
-           const std::vector<arma::Col<double>> &intersections) {
-  const double EPSILON = 1e-10;
-  for (size_t i = 0; i < intersections.size(); ++i)
-    if (fabs(intersections[i](0) - intersection(0)) < EPSILON &&
-        fabs(intersections[i](1) - intersection(1)) < EPSILON &&
-        fabs(intersections[i](2) - intersection(2)) < EPSILON)
-      return false;
-  return true;
+// Triangles of a surface grid, bucketed by their extents in the xy plane.
+// A ray cast from a point in the z direction can only hit the triangles of
+// the bucket containing the point's x and y coordinates.
+struct TriangleBuckets {
+  // Corners of triangle i, stored as 9 consecutive coordinates
+  std::vector<double> corners;
+  // xMin, xMax, yMin, yMax of triangle i, stored as 4 consecutive values
+  std::vector<double> extents;
+  double lower[3], upper[3];
+  size_t bucketCountX, bucketCountY;
+  double bucketSizeX, bucketSizeY;
+  // Triangles of bucket (ix, iy) are bucketTriangles[k] for
+  // bucketOffsets[b] <= k < bucketOffsets[b + 1], b = ix + iy * bucketCountX
+  std::vector<size_t> bucketOffsets;
+  std::vector<size_t> bucketTriangles;
+
+  size_t triangleCount() const { return extents.size() / 4; }
+
+  size_t bucketX(double x) const {
+    return std::min<size_t>((x - lower[0]) / bucketSizeX, bucketCountX - 1);
+  }
+  size_t bucketY(double y) const {
+    return std::min<size_t>((y - lower[1]) / bucketSizeY, bucketCountY - 1);
+  }
+};
+
+void addTriangle(const arma::Mat<double> &vertices, int v0, int v1, int v2,
+                 TriangleBuckets &buckets) {
+  const int v[3] = {v0, v1, v2};
+  for (int k = 0; k < 3; ++k)
+    for (int dim = 0; dim < 3; ++dim)
+      buckets.corners.push_back(vertices(dim, v[k]));
+  for (int dim = 0; dim < 2; ++dim) {
+    buckets.extents.push_back(min3(vertices(dim, v0), vertices(dim, v1),
+                                   vertices(dim, v2)));
+    buckets.extents.push_back(max3(vertices(dim, v0), vertices(dim, v1),
+                                   vertices(dim, v2)));
+  }
+}
+
+void buildTriangleBuckets(const Grid &grid, TriangleBuckets &buckets) {
+  std::unique_ptr<GridView> view = grid.leafView();
+  arma::Mat<double> vertices;
+  arma::Mat<int> elementCorners;
+  arma::Mat<char> auxData; // unused
+  view->getRawElementData(vertices, elementCorners, auxData);
+
+  const size_t elementCount = elementCorners.n_cols;
+  buckets.corners.reserve(9 * elementCount);
+  buckets.extents.reserve(4 * elementCount);
+  for (size_t e = 0; e < elementCount; ++e) {
+    if (elementCorners.n_rows < 3 || elementCorners(2, e) < 0)
+      throw std::runtime_error("areInside(): unknown element type");
+    const int cornerCount =
+        (elementCorners.n_rows > 3 && elementCorners(3, e) >= 0) ? 4 : 3;
+    addTriangle(vertices, elementCorners(0, e), elementCorners(1, e),
+                elementCorners(2, e), buckets);
+    // Quadrilaterals are split into 2 triangles.
+    // NOTE: this won't work for concave quads.
+    if (cornerCount == 4)
+      addTriangle(vertices, elementCorners(2, e), elementCorners(3, e),
+                  elementCorners(0, e), buckets);
+  }
+
+  const size_t triangleCount = buckets.triangleCount();
+  for (int dim = 0; dim < 3; ++dim) {
+    buckets.lower[dim] = std::numeric_limits<double>::max();
+    buckets.upper[dim] = -std::numeric_limits<double>::max();
+  }
+  for (size_t i = 0; i < buckets.corners.size(); i += 3)
+    for (int dim = 0; dim < 3; ++dim) {
+      const double x = buckets.corners[i + dim];
+      buckets.lower[dim] = std::min(buckets.lower[dim], x);
+      buckets.upper[dim] = std::max(buckets.upper[dim], x);
+    }
+
+  // Aim at about one triangle per bucket, with buckets as square as the
+  // extents of the grid allow
+  const double sizeX = std::max(buckets.upper[0] - buckets.lower[0], 0.);
+  const double sizeY = std::max(buckets.upper[1] - buckets.lower[1], 0.);
+  const double bucketSize =
+      (sizeX > 0. && sizeY > 0.)
+          ? std::sqrt(sizeX * sizeY / std::max<size_t>(triangleCount, 1))
+          : std::max(sizeX, sizeY) / std::max<size_t>(triangleCount, 1);
+  buckets.bucketCountX = std::max<size_t>(
+      1, std::min<size_t>(bucketSize > 0. ? sizeX / bucketSize : 1,
+                          triangleCount));
+  buckets.bucketCountY = std::max<size_t>(
+      1, std::min<size_t>(bucketSize > 0. ? sizeY / bucketSize : 1,
+                          triangleCount));
+  buckets.bucketSizeX = sizeX > 0. ? sizeX / buckets.bucketCountX : 1.;
+  buckets.bucketSizeY = sizeY > 0. ? sizeY / buckets.bucketCountY : 1.;
+
+  // Count the triangles overlapping each bucket, then fill the buckets
+  const size_t bucketCount = buckets.bucketCountX * buckets.bucketCountY;
+  buckets.bucketOffsets.assign(bucketCount + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<size_t> positions(buckets.bucketOffsets.begin(),
+                                  buckets.bucketOffsets.end() - 1);
+    for (size_t tri = 0; tri < triangleCount; ++tri) {
+      const double *extents = &buckets.extents[4 * tri];
+      const size_t ixBegin = buckets.bucketX(extents[0]);
+      const size_t ixEnd = buckets.bucketX(extents[1]) + 1;
+      const size_t iyBegin = buckets.bucketY(extents[2]);
+      const size_t iyEnd = buckets.bucketY(extents[3]) + 1;
+      for (size_t iy = iyBegin; iy < iyEnd; ++iy)
+        for (size_t ix = ixBegin; ix < ixEnd; ++ix) {
+          const size_t b = ix + iy * buckets.bucketCountX;
+          if (pass == 0)
+            ++buckets.bucketOffsets[b + 1];
+          else
+            buckets.bucketTriangles[positions[b]++] = tri;
+        }
+    }
+    if (pass == 0) {
+      std::partial_sum(buckets.bucketOffsets.begin(),
+                       buckets.bucketOffsets.end(),
+                       buckets.bucketOffsets.begin());
+      buckets.bucketTriangles.resize(buckets.bucketOffsets.back());
+    }
+  }
+}
+
+template <typename CoordinateType>
+std::vector<bool> areInsideImpl(const Grid &grid,
+                                const arma::Mat<CoordinateType> &points) {
+  if (grid.dim() != 2 || grid.dimWorld() != 3)
+    throw NotImplementedError("areInside(): currently implemented only for"
+                              "2D grids embedded in 3D spaces");
+  if (points.n_rows != 3)
+    throw std::invalid_argument("areInside(): points must have 3 rows");
+
+  TriangleBuckets buckets;
+  buildTriangleBuckets(grid, buckets);
+
+  const size_t pointCount = points.n_cols;
+  // std::vector<bool> packs its elements into shared words, so the results
+  // are written to a byte array by the parallel loop and copied afterwards
+  std::vector<char> inside(pointCount, 0);
+  if (buckets.triangleCount() > 0)
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, pointCount),
+        [&](const tbb::blocked_range<size_t> &r) {
+          const double EPSILON = 1e-10;
+          std::vector<double> intersections;
+          double intersection[3];
+          for (size_t pt = r.begin(); pt != r.end(); ++pt) {
+            const double point[3] = {double(points(0, pt)),
+                                     double(points(1, pt)),
+                                     double(points(2, pt))};
+            bool inBoundingBox = true;
+            for (int dim = 0; dim < 3; ++dim)
+              inBoundingBox = inBoundingBox &&
+                              point[dim] >= buckets.lower[dim] &&
+                              point[dim] <= buckets.upper[dim];
+            if (!inBoundingBox)
+              continue; // point outside grid's bounding box (or NaN)
+            const size_t b = buckets.bucketX(point[0]) +
+                             buckets.bucketY(point[1]) * buckets.bucketCountX;
+            // All intersections lie on the same vertical ray, so they are
+            // told apart by their z coordinates only
+            intersections.clear();
+            for (size_t k = buckets.bucketOffsets[b];
+                 k < buckets.bucketOffsets[b + 1]; ++k) {
+              const size_t tri = buckets.bucketTriangles[k];
+              const double *extents = &buckets.extents[4 * tri];
+              if (point[0] < extents[0] || point[0] > extents[1] ||
+                  point[1] < extents[2] || point[1] > extents[3])
+                continue;
+              const double *corners = &buckets.corners[9 * tri];
+              if (zRayIntersectsTriangle(point, corners, corners + 3,
+                                         corners + 6, intersection) > 0.)
+                intersections.push_back(intersection[2]);
+            }
+            std::sort(intersections.begin(), intersections.end());
+            const size_t distinctCount =
+                std::unique(intersections.begin(), intersections.end(),
+                            [EPSILON](double a, double b) {
+                              return b - a < EPSILON;
+                            }) -
+                intersections.begin();
+            inside[pt] = distinctCount > 0;
+          }
+        });
+  return std::vector<bool>(inside.begin(), inside.end());
 }
 
 } // namespace
@@ -62,114 +245,40 @@ bool Grid::isBarycentricRepresentationOf(const Grid &other) const {
 void Grid::getBoundingBox(arma::Col<double> &lowerBound,
                           arma::Col<double> &upperBound) const {
   // In this simple implementation we assume that all elements are flat.
-  if (m_lowerBound.n_rows == dimWorld() && m_upperBound.n_rows == dimWorld()) {
-    lowerBound = m_lowerBound;
-    upperBound = m_upperBound;
-    return;
-  }
+  const arma::Mat<double> &boundingBox = m_boundingBox.get([this]() {
+    std::unique_ptr<GridView> view = leafView();
 
-  std::unique_ptr<GridView> view = leafView();
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners; // unused
+    arma::Mat<char> auxData;       // unused
+    view->getRawElementData(vertices, elementCorners, auxData);
 
-  arma::Mat<double> vertices;
-  arma::Mat<int> elementCorners; // unused
-  arma::Mat<char> auxData;       // unused
-  view->getRawElementData(vertices, elementCorners, auxData);
+    // 1 -> min. (max.) value in each row
+    return arma::Mat<double>(
+        arma::join_rows(arma::min(vertices, 1), arma::max(vertices, 1)));
+  });
+  lowerBound = boundingBox.col(0);
+  upperBound = boundingBox.col(1);
+}
 
-  m_lowerBound = lowerBound =
-      arma::min(vertices, 1); // 1 -> min. value in each row
-  m_upperBound = upperBound =
-      arma::max(vertices, 1); // 1 -> max. value in each row
+shared_ptr<const Fiber::ElementBoundingVolumeHierarchy<double>>
+Grid::elementBoundingVolumeHierarchy() const {
+  typedef Fiber::ElementBoundingVolumeHierarchy<double> Hierarchy;
+  return m_elementBoundingVolumeHierarchy.get(
+      [&]() -> shared_ptr<const Hierarchy> {
+    shared_ptr<const Fiber::RawGridGeometry<double>> geometry =
+        leafView()->rawGeometry<double>();
+    return shared_ptr<const Hierarchy>(new Hierarchy(
+        geometry->vertices(), geometry->elementCornerIndices()));
+  });
 }
 
 std::vector<bool> areInside(const Grid &grid, const arma::Mat<double> &points) {
-  if (grid.dim() != 2 || grid.dimWorld() != 3)
-    throw NotImplementedError("areInside(): currently implemented only for"
-                              "2D grids embedded in 3D spaces");
-
-  std::unique_ptr<GridView> view = grid.leafView();
-  std::unique_ptr<EntityIterator<0>> it = view->entityIterator<0>();
-
-  std::vector<arma::Mat<double>> triangles;
-  triangles.reserve(view->entityCount(0));
-
-  {
-    arma::Mat<double> triangle(grid.dimWorld(), 3);
-    arma::Mat<double> corners;
-    while (!it->finished()) {
-      const Entity<0> &element = it->entity();
-      element.geometry().getCorners(corners);
-      if (corners.n_cols == 3) // triangle
-        triangles.push_back(corners);
-      else if (corners.n_cols == 4) { // quadrilateral, split into 2 triangles
-        // NOTE: this won't work for concave quads,
-        triangle.col(0) = corners.col(0);
-        triangle.col(1) = corners.col(1);
-        triangle.col(2) = corners.col(2);
-        triangles.push_back(triangle);
-        triangle.col(0) = corners.col(2);
-        triangle.col(1) = corners.col(3);
-        triangle.col(2) = corners.col(0);
-        triangles.push_back(triangle);
-      } else
-        throw std::runtime_error("areInside(): unknown element type");
-      it->next();
-    }
-  }
-
-  const size_t triangleCount = triangles.size();
-  arma::Row<double> xMins(triangleCount);
-  arma::Row<double> xMaxs(triangleCount);
-  arma::Row<double> yMins(triangleCount);
-  arma::Row<double> yMaxs(triangleCount);
-  arma::Row<double> zMins(triangleCount);
-  arma::Row<double> zMaxs(triangleCount);
-  for (size_t i = 0; i < triangleCount; ++i) {
-    const arma::Mat<double> &triangle = triangles[i];
-    xMins(i) = min3(triangle(0, 0), triangle(0, 1), triangle(0, 2));
-    xMaxs(i) = max3(triangle(0, 0), triangle(0, 1), triangle(0, 2));
-    yMins(i) = min3(triangle(1, 0), triangle(1, 1), triangle(1, 2));
-    yMaxs(i) = max3(triangle(1, 0), triangle(1, 1), triangle(1, 2));
-    zMins(i) = min3(triangle(2, 0), triangle(2, 1), triangle(2, 2));
-    zMaxs(i) = max3(triangle(2, 0), triangle(2, 1), triangle(2, 2));
-  }
-
-  const double gridXMin = arma::min(xMins);
-  const double gridXMax = arma::max(xMaxs);
-  const double gridYMin = arma::min(yMins);
-  const double gridYMax = arma::max(yMaxs);
-  const double gridZMin = arma::min(zMins);
-  const double gridZMax = arma::max(zMaxs);
-
-  const size_t pointCount = points.n_cols;
-  std::vector<bool> result(pointCount, false);
-  std::vector<arma::Col<double>> intersections;
-  arma::Col<double> intersection(3);
-  for (size_t pt = 0; pt < pointCount; ++pt) {
-    if (points(0, pt) < gridXMin || points(0, pt) > gridXMax ||
-        points(1, pt) < gridYMin || points(1, pt) > gridYMax ||
-        points(2, pt) < gridZMin || points(2, pt) > gridZMax)
-      continue; // point outside grid's bounding box
-    intersections.clear();
-    for (size_t tri = 0; tri < triangleCount; ++tri)
-      if (points(0, pt) >= xMins(tri) && points(0, pt) <= xMaxs(tri) &&
-          points(1, pt) >= yMins(tri) && points(1, pt) <= yMaxs(tri))
-        if (zRayIntersectsTriangle(points.colptr(pt), triangles[tri].colptr(0),
-                                   triangles[tri].colptr(1),
-                                   triangles[tri].colptr(2),
-                                   intersection.colptr(0)) > 0.)
-          if (isNew(intersection, intersections))
-            intersections.push_back(intersection);
-    result[pt] = intersections.size();
-  }
-  return result;
+  return areInsideImpl(grid, points);
 }
 
 std::vector<bool> areInside(const Grid &grid, const arma::Mat<float> &points) {
-  arma::Mat<double> pointsDouble(points.n_rows, points.n_cols);
-  for (int c = 0; c < points.n_cols; ++c)
-    for (int r = 0; r < points.n_rows; ++r)
-      pointsDouble(r, c) = points(r, c);
-  return areInside(grid, pointsDouble);
+  return areInsideImpl(grid, points);
 }
 
 } // namespace Bempp
@@ -24,6 +24,7 @@
 /** \file . */
 
 #include "../common/common.hpp"
+#include "../common/lazy.hpp"
 #include "../common/shared_ptr.hpp"
 #include "grid_parameters.hpp"
 
@@ -33,6 +34,14 @@
 #include <vector>
 #include <tbb/mutex.h>
 
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename CoordinateType> class ElementBoundingVolumeHierarchy;
+/** \endcond */
+
+} // namespace Fiber
+
 namespace Bempp {
 
 /** \cond FORWARD_DECL */
@@ -113,9 +122,21 @@ public:
   void getBoundingBox(arma::Col<double> &lowerBound,
                       arma::Col<double> &upperBound) const;
 
+  /** \brief Bounding volume hierarchy over the elements of the leaf view.
+   *
+   *  The hierarchy supports nearest-element, within-distance and ray
+   *  intersection queries. It is built in parallel on the first call and
+   *  reused afterwards. Elements are identified by their indices in the
+   *  index set of the leaf view. */
+  shared_ptr<const Fiber::ElementBoundingVolumeHierarchy<double>>
+  elementBoundingVolumeHierarchy() const;
+
 private:
   /** \cond PRIVATE */
-  mutable arma::Col<double> m_lowerBound, m_upperBound;
+  // Lower and upper bound of the bounding box, one per column
+  Lazy<arma::Mat<double>> m_boundingBox;
+  Lazy<shared_ptr<const Fiber::ElementBoundingVolumeHierarchy<double>>>
+  m_elementBoundingVolumeHierarchy;
   /** \endcond */
 };
 
@@ -21,14 +21,20 @@
 #include "grid_factory.hpp"
 #include "concrete_grid.hpp"
 #include "dune.hpp"
+#include "grid_view.hpp"
+#include "native_triangular_grid.hpp"
+#include "shape_grids.hpp"
 #include "structured_grid_factory.hpp"
 
 #include "../common/to_string.hpp"
+#include "../io/gmsh.hpp"
 
 #include <dune/grid/io/file/gmshreader.hh>
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include <tbb/parallel_reduce.h>
 
 namespace Bempp {
 
@@ -89,19 +95,9 @@ shared_ptr<Grid> GridFactory::importGmshGrid(const GridParameters &params,
                                              bool insertBoundarySegments) {
   std::vector<int> boundaryId2PhysicalEntity;
   std::vector<int> elementIndex2PhysicalEntity;
-
-  if (params.topology == GridParameters::TRIANGULAR) {
-    Default2dIn3dDuneGrid *duneGrid =
-        Dune::GmshReader<Default2dIn3dDuneGrid>::read(
-            fileName, boundaryId2PhysicalEntity, elementIndex2PhysicalEntity,
-            verbose, insertBoundarySegments);
-    return shared_ptr<Grid>(new Default2dIn3dGrid(
-        duneGrid, params.topology, elementIndex2PhysicalEntity,
-        true)); // true -> owns Dune grid
-  }
-  else
-    throw std::invalid_argument("GridFactory::importGmshGrid(): "
-                                "unsupported grid topology");
+  return importGmshGrid(params, fileName, boundaryId2PhysicalEntity,
+                        elementIndex2PhysicalEntity, verbose,
+                        insertBoundarySegments);
 }
 
 shared_ptr<Grid>
@@ -111,6 +107,13 @@ GridFactory::importGmshGrid(const GridParameters &params,
                             std::vector<int> &elementIndex2PhysicalEntity,
                             bool verbose, bool insertBoundarySegments) {
   if (params.topology == GridParameters::TRIANGULAR) {
+    // Without boundary segments the grid is built straight from the
+    // connectivity arrays read from the file, which avoids the copies of the
+    // mesh kept by Dune::GmshReader
+    if (!insertBoundarySegments)
+      return Bempp::importGmshGrid(fileName, boundaryId2PhysicalEntity,
+                                   elementIndex2PhysicalEntity,
+                                   -1 /* all physical entities */, verbose);
     Default2dIn3dDuneGrid *duneGrid =
         Dune::GmshReader<Default2dIn3dDuneGrid>::read(
             fileName, boundaryId2PhysicalEntity, elementIndex2PhysicalEntity,
@@ -124,27 +127,60 @@ GridFactory::importGmshGrid(const GridParameters &params,
                                 "unsupported grid topology");
 }
 
-shared_ptr<Grid> GridFactory::createGridFromConnectivityArrays(
-    const GridParameters &params, const arma::Mat<double> &vertices,
-    const arma::Mat<int> &elementCorners,
-    const std::vector<int> &domainIndices) {
-  const int dimGrid = 2, dimWorld = 3;
+namespace {
+
+// Check the connectivity arrays passed to the GridFactory function 'caller'
+void checkConnectivityArrays(const std::string &caller,
+                             const GridParameters &params,
+                             const arma::Mat<double> &vertices,
+                             const arma::Mat<int> &elementCorners,
+                             const std::vector<int> &domainIndices) {
+  const int dimWorld = 3;
   if (params.topology != GridParameters::TRIANGULAR)
-    throw std::invalid_argument("createGridFromConnectivityArrays(): "
+    throw std::invalid_argument(caller + "(): "
                                 "unsupported grid topology");
   if (vertices.n_rows != dimWorld)
-    throw std::invalid_argument("createGridFromConnectivityArrays(): "
+    throw std::invalid_argument(caller + "(): "
                                 "the 'vertices' array "
                                 "must have exactly 3 rows");
   if (elementCorners.n_rows < 3)
-    throw std::invalid_argument("createGridFromConnectivityArrays(): "
+    throw std::invalid_argument(caller + "(): "
                                 "the 'elementCorners' array "
                                 "must have at least 3 rows");
   if (!domainIndices.empty() && domainIndices.size() != elementCorners.n_cols)
     throw std::invalid_argument(
-        "createGridFromConnectivityArrays(): "
-        "'domainIndices' must either be empty or contain as many "
-        "elements as 'elementCorners' has columns");
+        caller + "(): "
+                 "'domainIndices' must either be empty or contain as many "
+                 "elements as 'elementCorners' has columns");
+
+  // Validate the connectivity in parallel
+  const int vertexCount = vertices.n_cols;
+  const size_t elementCount = elementCorners.n_cols;
+  const size_t firstInvalidElement = tbb::parallel_reduce(
+      tbb::blocked_range<size_t>(0, elementCount), elementCount,
+      [&](const tbb::blocked_range<size_t> &r, size_t first) {
+        for (size_t i = r.begin(); i != r.end() && i < first; ++i)
+          for (int k = 0; k < 3; ++k)
+            if (elementCorners(k, i) < 0 || elementCorners(k, i) >= vertexCount)
+              return i;
+        return first;
+      },
+      [](size_t a, size_t b) { return std::min(a, b); });
+  if (firstInvalidElement < elementCount)
+    throw std::invalid_argument(caller + "(): invalid "
+                                         "vertex index in element #" +
+                                toString(firstInvalidElement));
+}
+
+} // namespace
+
+shared_ptr<Grid> GridFactory::createGridFromConnectivityArrays(
+    const GridParameters &params, const arma::Mat<double> &vertices,
+    const arma::Mat<int> &elementCorners,
+    const std::vector<int> &domainIndices) {
+  const int dimGrid = 2, dimWorld = 3;
+  checkConnectivityArrays("createGridFromConnectivityArrays", params,
+                          vertices, elementCorners, domainIndices);
 
   shared_ptr<Dune::GridFactory<Default2dIn3dDuneGrid>> factory(
          new Dune::GridFactory<Default2dIn3dDuneGrid>());
@@ -157,16 +193,12 @@ shared_ptr<Grid> GridFactory::createGridFromConnectivityArrays(
     factory->insertVertex(v);
   }
 
+  // Only the insertion into the Dune factory, which is not thread-safe,
+  // is serial
   const GeometryType type(GeometryType::simplex, dimGrid);
-  const size_t vertexCount = vertices.n_cols;
+  const size_t elementCount = elementCorners.n_cols;
   std::vector<unsigned int> corners(3);
-  for (size_t i = 0; i < elementCorners.n_cols; ++i) {
-    if (elementCorners(0, i) < 0 || elementCorners(0, i) >= vertexCount ||
-        elementCorners(1, i) < 0 || elementCorners(1, i) >= vertexCount ||
-        elementCorners(2, i) < 0 || elementCorners(2, i) >= vertexCount)
-      throw std::invalid_argument("createGridFromConnectivityArrays(): invalid "
-                                  "vertex index in element #" +
-                                  toString(i));
+  for (size_t i = 0; i < elementCount; ++i) {
     corners[0] = elementCorners(0, i);
     corners[1] = elementCorners(1, i);
     corners[2] = elementCorners(2, i);
@@ -183,4 +215,91 @@ shared_ptr<Grid> GridFactory::createGridFromConnectivityArrays(
   return result;
 }
 
+shared_ptr<Grid> GridFactory::createNativeGridFromConnectivityArrays(
+    const GridParameters &params, const arma::Mat<double> &vertices,
+    const arma::Mat<int> &elementCorners,
+    const std::vector<int> &domainIndices) {
+  checkConnectivityArrays("createNativeGridFromConnectivityArrays", params,
+                          vertices, elementCorners, domainIndices);
+  return shared_ptr<Grid>(
+      new NativeTriangularGrid(vertices, elementCorners, domainIndices));
+}
+
+shared_ptr<Grid>
+GridFactory::createRefinedGrid(const Grid &grid, GridRefinement::Type type,
+                               std::vector<int> *fatherIndices) {
+  if (grid.topology() != GridParameters::TRIANGULAR)
+    throw std::invalid_argument("GridFactory::createRefinedGrid(): "
+                                "unsupported grid topology");
+
+  arma::Mat<double> vertices;
+  arma::Mat<int> elementCorners;
+  arma::Mat<char> auxData;
+  std::vector<int> domainIndices;
+  grid.leafView()->getRawElementData(vertices, elementCorners, auxData,
+                                     domainIndices);
+
+  arma::Mat<double> newVertices;
+  arma::Mat<int> newElementCorners;
+  std::vector<int> newDomainIndices;
+  std::vector<int> insertionFatherIndices;
+  refineTriangularGrid(type, vertices, elementCorners, domainIndices,
+                       newVertices, newElementCorners, newDomainIndices,
+                       insertionFatherIndices);
+
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  // A native grid keeps the order of the elements it was given
+  if (dynamic_cast<const NativeTriangularGrid *>(&grid)) {
+    if (fatherIndices)
+      *fatherIndices = insertionFatherIndices;
+    return createNativeGridFromConnectivityArrays(
+        params, newVertices, newElementCorners, newDomainIndices);
+  }
+  shared_ptr<Grid> result = createGridFromConnectivityArrays(
+      params, newVertices, newElementCorners, newDomainIndices);
+  if (fatherIndices) {
+    // The Dune factory may renumber the elements it was given
+    const Default2dIn3dGrid &concreteGrid =
+        dynamic_cast<const Default2dIn3dGrid &>(*result);
+    *fatherIndices = permuteInsertionDomainIndices(
+        insertionFatherIndices, *concreteGrid.factory(),
+        concreteGrid.duneGrid());
+  }
+  return result;
+}
+
+shared_ptr<Grid> GridFactory::createSphereGrid(double radius,
+                                               const arma::Col<double> &origin,
+                                               double h) {
+  arma::Mat<double> vertices;
+  arma::Mat<int> elementCorners;
+  sphereConnectivityArrays(radius, origin, h, vertices, elementCorners);
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  return createGridFromConnectivityArrays(params, vertices, elementCorners);
+}
+
+shared_ptr<Grid>
+GridFactory::createEllipsoidGrid(const arma::Col<double> &radii,
+                                 const arma::Col<double> &origin, double h) {
+  arma::Mat<double> vertices;
+  arma::Mat<int> elementCorners;
+  ellipsoidConnectivityArrays(radii, origin, h, vertices, elementCorners);
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  return createGridFromConnectivityArrays(params, vertices, elementCorners);
+}
+
+shared_ptr<Grid> GridFactory::createCubeGrid(double length,
+                                             const arma::Col<double> &origin,
+                                             double h) {
+  arma::Mat<double> vertices;
+  arma::Mat<int> elementCorners;
+  cubeConnectivityArrays(length, origin, h, vertices, elementCorners);
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  return createGridFromConnectivityArrays(params, vertices, elementCorners);
+}
+
 } // namespace Bempp
@@ -24,6 +24,7 @@
 #include "../common/common.hpp"
 #include "../common/shared_ptr.hpp"
 #include "grid_parameters.hpp"
+#include "grid_refinement.hpp"
 
 #include "../common/armadillo_fwd.hpp"
 #include <memory>
@@ -79,6 +80,10 @@ public:
     \param[in] verbose  Output diagnostic information.
     \param[in] insertBoundarySegments
 
+    Unless \p insertBoundarySegments is set, the grid is imported with
+    Bempp::importGmshGrid(), which does not keep additional copies of the
+    mesh in memory; otherwise Dune::GmshReader is used.
+
     \bug Ask Dune developers about the significance of insertBoundarySegments.
     \see <a href>http://geuz.org/gmsh/</a> for information about the Gmsh file
     format.
@@ -99,6 +104,10 @@ public:
     \param[in] verbose  Output diagnostic information.
     \param[in] insertBoundarySegments
 
+    Unless \p insertBoundarySegments is set, the grid is imported with
+    Bempp::importGmshGrid(); see its documentation for the contents of
+    \p boundaryId2PhysicalEntity and \p elementIndex2PhysicalEntity.
+
     \bug Ask Dune developers about the significance of the undocumented
     parameters.
     \see <a href>http://geuz.org/gmsh/</a> for information about the Gmsh file
@@ -133,6 +142,70 @@ public:
       const GridParameters &params, const arma::Mat<double> &vertices,
       const arma::Mat<int> &elementCorners,
       const std::vector<int> &domainIndices = std::vector<int>());
+
+  /** \brief Create a native grid from connectivity arrays.
+   *
+   *  The parameters have the same meaning as in
+   *  createGridFromConnectivityArrays(), but the returned grid is a
+   *  NativeTriangularGrid, which stores the mesh in flat arrays instead of
+   *  a Dune grid. Vertices and elements keep the order in which they are
+   *  given. Native grids are faster to create and traverse and take less
+   *  memory; they have a single level and no barycentric refinement.
+   *
+   *  \note Only grids with triangular topology are supported.
+   */
+  static shared_ptr<Grid> createNativeGridFromConnectivityArrays(
+      const GridParameters &params, const arma::Mat<double> &vertices,
+      const arma::Mat<int> &elementCorners,
+      const std::vector<int> &domainIndices = std::vector<int>());
+
+  /** \brief Create a refined copy of a grid.
+   *
+   *  \param[in] grid
+   *    Grid to refine. Its leaf view is used; currently only grids with
+   *    triangular topology are supported.
+   *  \param[in] type
+   *    Type of refinement.
+   *  \param[out] fatherIndices
+   *    (Optional) If not null, on output the ith element of this vector is
+   *    the index of the element of the leaf view of \p grid containing the
+   *    element of index i of the leaf view of the returned grid.
+   *
+   *  The connectivity arrays of the refined grid are computed in parallel
+   *  by refineTriangularGrid(). The returned grid has a single level and
+   *  the elements inherit the domain indices of their fathers. It is a
+   *  NativeTriangularGrid if \p grid is one. */
+  static shared_ptr<Grid>
+  createRefinedGrid(const Grid &grid, GridRefinement::Type type,
+                    std::vector<int> *fatherIndices = 0);
+
+  /** \brief Create a triangular grid of a sphere without an external mesh
+   *  generator.
+   *
+   *  \param[in] radius Radius of the sphere.
+   *  \param[in] origin Centre of the sphere.
+   *  \param[in] h      Maximum element size.
+   *
+   *  The mesh is made by sphereConnectivityArrays() and passed to
+   *  createGridFromConnectivityArrays(). It depends only on the arguments,
+   *  so all processes of a parallel run create the same grid. */
+  static shared_ptr<Grid> createSphereGrid(double radius,
+                                           const arma::Col<double> &origin,
+                                           double h);
+
+  /** \brief Create a triangular grid of an ellipsoid with semi-axes \p radii
+   *  along the coordinate axes; see ellipsoidConnectivityArrays() and
+   *  createSphereGrid(). */
+  static shared_ptr<Grid> createEllipsoidGrid(const arma::Col<double> &radii,
+                                              const arma::Col<double> &origin,
+                                              double h);
+
+  /** \brief Create a triangular grid of the surface of an axis-aligned cube
+   *  whose corner with the smallest coordinates is \p origin; see
+   *  cubeConnectivityArrays() and createSphereGrid(). */
+  static shared_ptr<Grid> createCubeGrid(double length,
+                                         const arma::Col<double> &origin,
+                                         double h);
 };
 
 } // namespace Bempp
@@ -0,0 +1,202 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "grid_refinement.hpp"
+
+#include <armadillo>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+namespace Bempp {
+
+namespace {
+
+// Corners joined by the edges of the Dune reference triangle
+const int EDGE_CORNERS[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+
+// Number of sorted edge slots numbered by a single task
+const size_t EDGE_CHUNK_SIZE = 16384;
+
+// Pair of vertex indices packed into a sort key and element edge slot
+typedef std::pair<unsigned long long, size_t> EdgeSlot;
+
+inline bool isFirstSlotOfEdge(const std::vector<EdgeSlot> &slots, size_t i) {
+  return i == 0 || slots[i].first != slots[i - 1].first;
+}
+
+} // namespace
+
+void computeEdgeIndices(const arma::Mat<int> &elementCorners,
+                        arma::Mat<int> &elementEdges,
+                        arma::Mat<int> &edgeVertices) {
+  if (elementCorners.n_rows < 3)
+    throw std::invalid_argument("computeEdgeIndices(): "
+                                "the 'elementCorners' array "
+                                "must have at least 3 rows");
+  const size_t elementCount = elementCorners.n_cols;
+  if (elementCount > 0 && elementCorners.rows(0, 2).min() < 0)
+    throw std::invalid_argument("computeEdgeIndices(): "
+                                "negative vertex index");
+
+  // Collect the three edges of every element and sort them by their vertices
+  const size_t slotCount = 3 * elementCount;
+  std::vector<EdgeSlot> slots(slotCount);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, elementCount),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t e = r.begin(); e != r.end(); ++e)
+      for (int k = 0; k < 3; ++k) {
+        unsigned long long a = elementCorners(EDGE_CORNERS[k][0], e);
+        unsigned long long b = elementCorners(EDGE_CORNERS[k][1], e);
+        if (a > b)
+          std::swap(a, b);
+        slots[3 * e + k] = EdgeSlot((a << 32) | b, 3 * e + k);
+      }
+  });
+  tbb::parallel_sort(slots.begin(), slots.end());
+
+  // Count the edges starting in each chunk of the sorted slots...
+  const size_t chunkCount = (slotCount + EDGE_CHUNK_SIZE - 1) / EDGE_CHUNK_SIZE;
+  std::vector<int> chunkOffsets(chunkCount + 1, 0);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t c = r.begin(); c != r.end(); ++c) {
+      const size_t end = std::min(slotCount, (c + 1) * EDGE_CHUNK_SIZE);
+      int count = 0;
+      for (size_t i = c * EDGE_CHUNK_SIZE; i < end; ++i)
+        count += isFirstSlotOfEdge(slots, i);
+      chunkOffsets[c + 1] = count;
+    }
+  });
+  std::partial_sum(chunkOffsets.begin(), chunkOffsets.end(),
+                   chunkOffsets.begin());
+
+  // ... and number them
+  const int edgeCount = chunkOffsets.back();
+  elementEdges.set_size(3, elementCount);
+  edgeVertices.set_size(2, edgeCount);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t c = r.begin(); c != r.end(); ++c) {
+      const size_t end = std::min(slotCount, (c + 1) * EDGE_CHUNK_SIZE);
+      int edge = chunkOffsets[c] - 1;
+      for (size_t i = c * EDGE_CHUNK_SIZE; i < end; ++i) {
+        if (isFirstSlotOfEdge(slots, i)) {
+          ++edge;
+          edgeVertices(0, edge) = int(slots[i].first >> 32);
+          edgeVertices(1, edge) = int(slots[i].first & 0xffffffffULL);
+        }
+        elementEdges(slots[i].second % 3, slots[i].second / 3) = edge;
+      }
+    }
+  });
+}
+
+void refineTriangularGrid(GridRefinement::Type type,
+                          const arma::Mat<double> &vertices,
+                          const arma::Mat<int> &elementCorners,
+                          const std::vector<int> &domainIndices,
+                          arma::Mat<double> &newVertices,
+                          arma::Mat<int> &newElementCorners,
+                          std::vector<int> &newDomainIndices,
+                          std::vector<int> &fatherIndices) {
+  const int dimWorld = 3;
+  if (vertices.n_rows != dimWorld)
+    throw std::invalid_argument("refineTriangularGrid(): "
+                                "the 'vertices' array "
+                                "must have exactly 3 rows");
+  if (type != GridRefinement::UNIFORM && type != GridRefinement::BARYCENTRIC)
+    throw std::invalid_argument("refineTriangularGrid(): "
+                                "invalid refinement type");
+  const size_t elementCount = elementCorners.n_cols;
+  if (!domainIndices.empty() && domainIndices.size() != elementCount)
+    throw std::invalid_argument(
+        "refineTriangularGrid(): "
+        "'domainIndices' must either be empty or contain as many "
+        "elements as 'elementCorners' has columns");
+
+  arma::Mat<int> elementEdges, edgeVertices;
+  computeEdgeIndices(elementCorners, elementEdges, edgeVertices);
+  const int vertexCount = vertices.n_cols;
+  const int edgeCount = edgeVertices.n_cols;
+  if (edgeCount > 0 && edgeVertices.max() >= vertexCount)
+    throw std::invalid_argument("refineTriangularGrid(): "
+                                "invalid vertex index in 'elementCorners'");
+
+  const bool barycentric = (type == GridRefinement::BARYCENTRIC);
+  const int sonCount = barycentric ? 6 : 4;
+  const int edgeOffset = vertexCount;
+  const int centroidOffset = vertexCount + edgeCount;
+
+  // New vertices: old vertices, edge midpoints and (optionally) centroids
+  newVertices.set_size(dimWorld,
+                       centroidOffset + (barycentric ? elementCount : 0));
+  std::copy(vertices.memptr(), vertices.memptr() + vertices.n_elem,
+            newVertices.memptr());
+  tbb::parallel_for(tbb::blocked_range<int>(0, edgeCount),
+                    [&](const tbb::blocked_range<int> &r) {
+    for (int edge = r.begin(); edge != r.end(); ++edge)
+      for (int d = 0; d < dimWorld; ++d)
+        newVertices(d, edgeOffset + edge) =
+            0.5 * (vertices(d, edgeVertices(0, edge)) +
+                   vertices(d, edgeVertices(1, edge)));
+  });
+
+  // New elements, stored consecutively for each father
+  newElementCorners.set_size(3, sonCount * elementCount);
+  fatherIndices.resize(sonCount * elementCount);
+  newDomainIndices.resize(domainIndices.empty() ? 0
+                                                : sonCount * elementCount);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, elementCount),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t e = r.begin(); e != r.end(); ++e) {
+      const int c0 = elementCorners(0, e);
+      const int c1 = elementCorners(1, e);
+      const int c2 = elementCorners(2, e);
+      const int m01 = edgeOffset + elementEdges(0, e);
+      const int m02 = edgeOffset + elementEdges(1, e);
+      const int m12 = edgeOffset + elementEdges(2, e);
+      int *sons = newElementCorners.colptr(sonCount * e);
+      if (barycentric) {
+        const int g = centroidOffset + e;
+        for (int d = 0; d < dimWorld; ++d)
+          newVertices(d, g) =
+              (vertices(d, c0) + vertices(d, c1) + vertices(d, c2)) / 3.;
+        const int corners[18] = {c0, m01, g, m01, c1, g, c1, m12, g,
+                                 m12, c2, g, c2, m02, g, m02, c0, g};
+        std::copy(corners, corners + 18, sons);
+      } else {
+        const int corners[12] = {c0,  m01, m02, m01, c1,  m12,
+                                 m02, m12, c2, m01, m12, m02};
+        std::copy(corners, corners + 12, sons);
+      }
+      for (int son = 0; son < sonCount; ++son) {
+        fatherIndices[sonCount * e + son] = e;
+        if (!domainIndices.empty())
+          newDomainIndices[sonCount * e + son] = domainIndices[e];
+      }
+    }
+  });
+}
+
+} // namespace Bempp
@@ -0,0 +1,96 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_grid_refinement_hpp
+#define bempp_grid_refinement_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <vector>
+
+namespace Bempp {
+
+/** \ingroup grid
+ *  \brief Types of uniform refinement of triangular grids. */
+struct GridRefinement {
+  enum Type {
+    /** \brief Split each triangle into four by joining its edge midpoints. */
+    UNIFORM,
+    /** \brief Split each triangle into six by joining its centroid to its
+     *  corners and edge midpoints. */
+    BARYCENTRIC
+  };
+};
+
+/** \ingroup grid
+    \brief Number the edges of a triangular grid.
+
+    \param[in] elementCorners
+      2D array whose (i, j)th element contains the index of the ith vertex
+      of the jth element (only the first three rows are used).
+    \param[out] elementEdges
+      On output, a 3 x elementCount array whose (i, j)th element is the index
+      of the ith edge of the jth element. As in the Dune reference triangle,
+      edges 0, 1 and 2 join the corners (0, 1), (0, 2) and (1, 2).
+    \param[out] edgeVertices
+      On output, a 2 x edgeCount array containing the indices of the two
+      vertices of each edge, the smaller one first.
+
+    The edges are numbered in the lexicographic order of their vertex
+    indices, so the result does not depend on the number of threads. All
+    stages of the computation run in parallel. */
+void computeEdgeIndices(const arma::Mat<int> &elementCorners,
+                        arma::Mat<int> &elementEdges,
+                        arma::Mat<int> &edgeVertices);
+
+/** \ingroup grid
+    \brief Refine a triangular grid given by connectivity arrays.
+
+    \param[in] type
+      Type of refinement.
+    \param[in] vertices, elementCorners, domainIndices
+      Connectivity arrays of the grid to refine, as in
+      GridFactory::createGridFromConnectivityArrays(). \p domainIndices may
+      be empty.
+    \param[out] newVertices, newElementCorners, newDomainIndices
+      Connectivity arrays of the refined grid. The original vertices come
+      first, followed by the midpoints of the edges numbered as in
+      computeEdgeIndices() and, for barycentric refinement, by the element
+      centroids. Refined elements keep the orientation and domain index of
+      their father. \p newDomainIndices is empty if \p domainIndices is.
+    \param[out] fatherIndices
+      On output, the index of the element from which each new element was
+      created. The 4 (uniform refinement) or 6 (barycentric refinement) sons
+      of each element are stored consecutively.
+
+    The refinement is carried out in parallel. */
+void refineTriangularGrid(GridRefinement::Type type,
+                          const arma::Mat<double> &vertices,
+                          const arma::Mat<int> &elementCorners,
+                          const std::vector<int> &domainIndices,
+                          arma::Mat<double> &newVertices,
+                          arma::Mat<int> &newElementCorners,
+                          std::vector<int> &newDomainIndices,
+                          std::vector<int> &fatherIndices);
+
+} // namespace Bempp
+
+#endif
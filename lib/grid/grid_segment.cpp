@@ -29,15 +29,64 @@
 #include "grid_view.hpp"
 #include "index_set.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#include <string>
+#include <tbb/parallel_for.h>
 
 namespace Bempp {
 
 namespace {
 
+typedef std::vector<std::uint64_t> Bits;
+
+const int BITS_PER_WORD = 64;
+
+inline size_t wordCount(int bitCount) {
+  return (bitCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+inline bool testBit(const Bits &bits, int index) {
+  return (bits[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1u;
+}
+
+// Clear the unused bits of the last word, so that whole words can be
+// compared and complemented
+void clearPadding(Bits &bits, int bitCount) {
+  if (bitCount % BITS_PER_WORD)
+    bits.back() &= (std::uint64_t(1) << (bitCount % BITS_PER_WORD)) - 1;
+}
+
+Bits bitsFromSet(const std::set<int> &indices, int bitCount) {
+  Bits bits(wordCount(bitCount), 0);
+  for (std::set<int>::const_iterator it = indices.begin(); it != indices.end();
+       ++it)
+    if (*it >= 0 && *it < bitCount)
+      bits[*it / BITS_PER_WORD] |= std::uint64_t(1) << (*it % BITS_PER_WORD);
+  return bits;
+}
+
+Bits bitsFromFlags(const std::vector<bool> &flags) {
+  const int bitCount = flags.size();
+  Bits bits(wordCount(bitCount), 0);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, bits.size()),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t w = r.begin(); w != r.end(); ++w) {
+      const int begin = w * BITS_PER_WORD;
+      const int end = std::min(bitCount, begin + BITS_PER_WORD);
+      std::uint64_t word = 0;
+      for (int i = begin; i < end; ++i)
+        if (flags[i])
+          word |= std::uint64_t(1) << (i - begin);
+      bits[w] = word;
+    }
+  });
+  return bits;
+}
+
 template <int codim>
-std::set<int> entitiesWithNonpositiveX(const GridView &view) {
-  std::set<int> result;
+std::vector<bool> entitiesWithNonpositiveX(const GridView &view) {
+  std::vector<bool> result(view.entityCount(codim), false);
   std::unique_ptr<EntityIterator<codim>> it = view.entityIterator<codim>();
   const IndexSet &indexSet = view.indexSet();
   arma::Col<double> center;
@@ -45,12 +94,18 @@ std::set<int> entitiesWithNonpositiveX(const GridView &view) {
     const Entity<codim> &entity = it->entity();
     entity.geometry().getCenter(center);
     if (center(0) <= 0.)
-      result.insert(indexSet.entityIndex(entity));
+      acc(result, indexSet.entityIndex(entity)) = true;
     it->next();
   }
   return result;
 }
 
+int subEntityCount(const Entity<0> &e, int codim) {
+  return (codim == 1) ? e.subEntityCount<1>() : (codim == 2)
+                                                    ? e.subEntityCount<2>()
+                                                    : e.subEntityCount<3>();
+}
+
 } // namespace
 
 GridSegment::GridSegment(const Grid &grid,
@@ -67,10 +122,12 @@ GridSegment::GridSegment(const Grid &grid,
     view = grid.levelView(level);
   for (int i = 0; i < 4; ++i)
     m_entityCounts[i] = view->entityCount(i);
-  m_excludedEntities[0] = excludedEntitiesCodim0;
-  m_excludedEntities[1] = excludedEntitiesCodim1;
-  m_excludedEntities[2] = excludedEntitiesCodim2;
-  m_excludedEntities[3] = excludedEntitiesCodim3;
+  const std::set<int> *excludedEntities[4] = {
+      &excludedEntitiesCodim0, &excludedEntitiesCodim1,
+      &excludedEntitiesCodim2, &excludedEntitiesCodim3};
+  for (int codim = 0; codim < 4; ++codim)
+    m_excludedEntities[codim] =
+        bitsFromSet(*excludedEntities[codim], m_entityCounts[codim]);
 }
 
 GridSegment::GridSegment(int entityCountCodim0, int entityCountCodim1,
@@ -83,12 +140,26 @@ GridSegment::GridSegment(int entityCountCodim0, int entityCountCodim1,
   m_entityCounts[1] = entityCountCodim1;
   m_entityCounts[2] = entityCountCodim2;
   m_entityCounts[3] = entityCountCodim3;
-  m_excludedEntities[0] = excludedEntitiesCodim0;
-  m_excludedEntities[1] = excludedEntitiesCodim1;
-  m_excludedEntities[2] = excludedEntitiesCodim2;
-  m_excludedEntities[3] = excludedEntitiesCodim3;
+  const std::set<int> *excludedEntities[4] = {
+      &excludedEntitiesCodim0, &excludedEntitiesCodim1,
+      &excludedEntitiesCodim2, &excludedEntitiesCodim3};
+  for (int codim = 0; codim < 4; ++codim)
+    m_excludedEntities[codim] =
+        bitsFromSet(*excludedEntities[codim], m_entityCounts[codim]);
 }
 
+GridSegment::GridSegment(
+    const boost::array<std::vector<bool>, 4> &excludedEntities) {
+  for (int codim = 0; codim < 4; ++codim) {
+    m_entityCounts[codim] = excludedEntities[codim].size();
+    m_excludedEntities[codim] = bitsFromFlags(excludedEntities[codim]);
+  }
+}
+
+GridSegment::GridSegment(const boost::array<int, 4> &entityCounts,
+                         const boost::array<Bitset, 4> &excludedEntities)
+    : m_entityCounts(entityCounts), m_excludedEntities(excludedEntities) {}
+
 GridSegment GridSegment::wholeGrid(const Grid &grid, int level) {
   std::set<int> emptySet;
   return GridSegment(grid, emptySet, emptySet, emptySet, emptySet, level);
@@ -103,37 +174,26 @@ GridSegment GridSegment::openDomain(const Grid &grid, int domain, int level) {
     view = grid.levelView(level);
   const IndexSet &indexSet = view->indexSet();
 
-  boost::array<std::vector<bool>, 4> entirelyInDomain;
-  for (int codim = 1; codim <= gridDim; ++codim)
-    entirelyInDomain[codim].resize(view->entityCount(codim), true);
+  // Exclude the elements outside the domain and all their subentities
+  boost::array<std::vector<bool>, 4> excludedEntities;
+  for (int codim = 0; codim < 4; ++codim)
+    excludedEntities[codim].resize(view->entityCount(codim), false);
 
-  boost::array<std::set<int>, 4> excludedEntities;
   std::unique_ptr<EntityIterator<0>> it = view->entityIterator<0>();
   while (!it->finished()) {
     const Entity<0> &e = it->entity();
     if (e.domain() != domain) {
-      excludedEntities[0].insert(indexSet.entityIndex(e));
+      acc(excludedEntities[0], indexSet.entityIndex(e)) = true;
       for (int codim = 1; codim <= gridDim; ++codim) {
-        int subEntityCount =
-            (codim == 1) ? e.subEntityCount<1>() : (codim == 2)
-                                                       ? e.subEntityCount<2>()
-                                                       : e.subEntityCount<3>();
-        for (int i = 0; i < subEntityCount; ++i) {
-          int index = indexSet.subEntityIndex(e, i, codim);
-          acc(entirelyInDomain[codim], index) = false;
-        }
+        const int count = subEntityCount(e, codim);
+        for (int i = 0; i < count; ++i)
+          acc(excludedEntities[codim], indexSet.subEntityIndex(e, i, codim)) =
+              true;
       }
     }
     it->next();
   }
-  for (int codim = 1; codim <= gridDim; ++codim)
-    for (int index = 0; index < entirelyInDomain[codim].size(); ++index)
-      if (!acc(entirelyInDomain[codim], index))
-        excludedEntities[codim].insert(index);
-  return GridSegment(view->entityCount(0), view->entityCount(1),
-                     view->entityCount(2), view->entityCount(3),
-                     excludedEntities[0], excludedEntities[1],
-                     excludedEntities[2], excludedEntities[3]);
+  return GridSegment(excludedEntities);
 }
 
 GridSegment GridSegment::closedDomain(const Grid &grid, int domain, int level) {
@@ -145,38 +205,29 @@ GridSegment GridSegment::closedDomain(const Grid &grid, int domain, int level) {
     view = grid.levelView(level);
   const IndexSet &indexSet = view->indexSet();
 
-  boost::array<std::vector<bool>, 4> adjacentToDomain;
-  for (int codim = 1; codim <= gridDim; ++codim)
-    adjacentToDomain[codim].resize(view->entityCount(codim), false);
+  // Exclude the elements outside the domain and all subentities not
+  // adjacent to the domain
+  boost::array<std::vector<bool>, 4> excludedEntities;
+  excludedEntities[0].resize(view->entityCount(0), false);
+  for (int codim = 1; codim < 4; ++codim)
+    excludedEntities[codim].resize(view->entityCount(codim), true);
 
-  boost::array<std::set<int>, 4> excludedEntities;
   std::unique_ptr<EntityIterator<0>> it = view->entityIterator<0>();
   while (!it->finished()) {
     const Entity<0> &e = it->entity();
     if (e.domain() != domain)
-      excludedEntities[0].insert(indexSet.entityIndex(e));
+      acc(excludedEntities[0], indexSet.entityIndex(e)) = true;
     else {
       for (int codim = 1; codim <= gridDim; ++codim) {
-        int subEntityCount =
-            (codim == 1) ? e.subEntityCount<1>() : (codim == 2)
-                                                       ? e.subEntityCount<2>()
-                                                       : e.subEntityCount<3>();
-        for (int i = 0; i < subEntityCount; ++i) {
-          int index = indexSet.subEntityIndex(e, i, codim);
-          acc(adjacentToDomain[codim], index) = true;
-        }
+        const int count = subEntityCount(e, codim);
+        for (int i = 0; i < count; ++i)
+          acc(excludedEntities[codim], indexSet.subEntityIndex(e, i, codim)) =
+              false;
       }
     }
     it->next();
   }
-  for (int codim = 1; codim <= gridDim; ++codim)
-    for (int index = 0; index < adjacentToDomain[codim].size(); ++index)
-      if (!acc(adjacentToDomain[codim], index))
-        excludedEntities[codim].insert(index);
-  return GridSegment(view->entityCount(0), view->entityCount(1),
-                     view->entityCount(2), view->entityCount(3),
-                     excludedEntities[0], excludedEntities[1],
-                     excludedEntities[2], excludedEntities[3]);
+  return GridSegment(excludedEntities);
 }
 
 bool GridSegment::contains(int codim, int index) const {
@@ -184,8 +235,7 @@ bool GridSegment::contains(int codim, int index) const {
     throw std::invalid_argument("GridSegment::contains(): codim must be "
                                 "0, 1, 2 or 3");
   return index >= 0 && index < m_entityCounts[codim] &&
-         m_excludedEntities[codim].find(index) ==
-             m_excludedEntities[codim].end();
+         !testBit(m_excludedEntities[codim], index);
 }
 
 void GridSegment::markExcludedEntities(int codim, std::vector<int> &marks,
@@ -193,78 +243,88 @@ void GridSegment::markExcludedEntities(int codim, std::vector<int> &marks,
   if (codim < 0 || codim > 3)
     throw std::invalid_argument("GridSegment::begin(): codim must be "
                                 "0, 1, 2 or 3");
+  const Bitset &bits = m_excludedEntities[codim];
   marks.resize(m_entityCounts[codim]);
-  std::fill(marks.begin(), marks.end(), 0);
-  for (std::set<int>::const_iterator it = m_excludedEntities[codim].begin();
-       it != m_excludedEntities[codim].end(); ++it)
-    acc(marks, *it) = mark;
+  for (int index = 0; index < m_entityCounts[codim]; ++index)
+    marks[index] = testBit(bits, index) ? mark : 0;
+}
+
+void GridSegment::checkCompatibility(const GridSegment &other,
+                                     const char *method) const {
+  if (m_entityCounts != other.m_entityCounts)
+    throw std::invalid_argument(std::string("GridSegment::") + method +
+                                "(): the segments do not belong to grids "
+                                "with the same numbers of entities");
 }
 
 GridSegment GridSegment::complement() const {
-  boost::array<std::set<int>, 4> includedEntities;
+  boost::array<Bitset, 4> excludedEntities;
   for (int codim = 0; codim < 4; ++codim) {
-    std::set<int>::const_iterator it = m_excludedEntities[codim].begin();
-    for (int index = 0; index < m_entityCounts[codim]; ++index) {
-      if (it == m_excludedEntities[codim].end() || index < *it)
-        includedEntities[codim].insert(index);
-      else
-        ++it;
-    }
+    const Bitset &bits = m_excludedEntities[codim];
+    Bitset &result = excludedEntities[codim];
+    result.resize(bits.size());
+    for (size_t w = 0; w < bits.size(); ++w)
+      result[w] = ~bits[w];
+    clearPadding(result, m_entityCounts[codim]);
   }
-  return GridSegment(m_entityCounts[0], m_entityCounts[1], m_entityCounts[2],
-                     m_entityCounts[3], includedEntities[0],
-                     includedEntities[1], includedEntities[2],
-                     includedEntities[3]);
+  return GridSegment(m_entityCounts, excludedEntities);
 }
 
 GridSegment GridSegment::union_(const GridSegment &other) const {
-  boost::array<std::set<int>, 4> excludedEntities;
-  for (int codim = 0; codim < 4; ++codim)
-    std::set_intersection(m_excludedEntities[codim].begin(),
-                          m_excludedEntities[codim].end(),
-                          other.m_excludedEntities[codim].begin(),
-                          other.m_excludedEntities[codim].end(),
-                          std::inserter(excludedEntities[codim],
-                                        excludedEntities[codim].begin()));
-  return GridSegment(m_entityCounts[0], m_entityCounts[1], m_entityCounts[2],
-                     m_entityCounts[3], excludedEntities[0],
-                     excludedEntities[1], excludedEntities[2],
-                     excludedEntities[3]);
+  checkCompatibility(other, "union_");
+  boost::array<Bitset, 4> excludedEntities;
+  for (int codim = 0; codim < 4; ++codim) {
+    const Bitset &a = m_excludedEntities[codim];
+    const Bitset &b = other.m_excludedEntities[codim];
+    Bitset &result = excludedEntities[codim];
+    result.resize(a.size());
+    for (size_t w = 0; w < a.size(); ++w)
+      result[w] = a[w] & b[w];
+  }
+  return GridSegment(m_entityCounts, excludedEntities);
 }
 
 GridSegment GridSegment::difference(const GridSegment &other) const {
-  GridSegment otherC = other.complement();
-  return intersection(otherC);
+  checkCompatibility(other, "difference");
+  boost::array<Bitset, 4> excludedEntities;
+  for (int codim = 0; codim < 4; ++codim) {
+    const Bitset &a = m_excludedEntities[codim];
+    const Bitset &b = other.m_excludedEntities[codim];
+    Bitset &result = excludedEntities[codim];
+    result.resize(a.size());
+    for (size_t w = 0; w < a.size(); ++w)
+      result[w] = a[w] | ~b[w];
+    clearPadding(result, m_entityCounts[codim]);
+  }
+  return GridSegment(m_entityCounts, excludedEntities);
 }
 
 GridSegment GridSegment::intersection(const GridSegment &other) const {
-  boost::array<std::set<int>, 4> excludedEntities;
-  for (int codim = 0; codim < 4; ++codim)
-    std::set_union(m_excludedEntities[codim].begin(),
-                   m_excludedEntities[codim].end(),
-                   other.m_excludedEntities[codim].begin(),
-                   other.m_excludedEntities[codim].end(),
-                   std::inserter(excludedEntities[codim],
-                                 excludedEntities[codim].begin()));
-  return GridSegment(m_entityCounts[0], m_entityCounts[1], m_entityCounts[2],
-                     m_entityCounts[3], excludedEntities[0],
-                     excludedEntities[1], excludedEntities[2],
-                     excludedEntities[3]);
+  checkCompatibility(other, "intersection");
+  boost::array<Bitset, 4> excludedEntities;
+  for (int codim = 0; codim < 4; ++codim) {
+    const Bitset &a = m_excludedEntities[codim];
+    const Bitset &b = other.m_excludedEntities[codim];
+    Bitset &result = excludedEntities[codim];
+    result.resize(a.size());
+    for (size_t w = 0; w < a.size(); ++w)
+      result[w] = a[w] | b[w];
+  }
+  return GridSegment(m_entityCounts, excludedEntities);
 }
 
 GridSegment gridSegmentWithPositiveX(const Grid &grid, int level) {
-  boost::array<std::set<int>, 4> excludedEntities;
   std::unique_ptr<GridView> view;
   if (level == -1)
     view = grid.leafView();
   else
     view = grid.levelView(level);
+  boost::array<std::vector<bool>, 4> excludedEntities;
   excludedEntities[0] = entitiesWithNonpositiveX<0>(*view);
   excludedEntities[1] = entitiesWithNonpositiveX<1>(*view);
   excludedEntities[2] = entitiesWithNonpositiveX<2>(*view);
-
-  return GridSegment(grid, excludedEntities[0], excludedEntities[1],
-                     excludedEntities[2], excludedEntities[3]);
+  excludedEntities[3].resize(view->entityCount(3), false);
+  return GridSegment(excludedEntities);
 }
 
 } // namespace Bempp
@@ -25,6 +25,7 @@
 #include "../common/shared_ptr.hpp"
 
 #include <boost/array.hpp>
+#include <cstdint>
 #include <set>
 #include <vector>
 
@@ -40,7 +41,9 @@ class Grid;
  *
  *  Technically, a grid segment is defined by means of the sets of indices of
  *  entities of different codimensions (vertices, edges and elements, for 2D
- *  grids) that it contains.
+ *  grids) that it contains. These are stored as dense bitsets, so that
+ *  contains() takes constant time and the set operations work on whole
+ *  words.
  */
 class GridSegment {
 public:
@@ -94,6 +97,17 @@ public:
               const std::set<int> &excludedEntitiesCodim2,
               const std::set<int> &excludedEntitiesCodim3);
 
+  /** \brief Constructor.
+   *
+   *  Construct a new segment of a grid including all its constituent
+   *  entities except those whose elements in \p excludedEntities are set:
+   *  the entity of codimension \p codim and index \p i is excluded if
+   *  <tt>excludedEntities[codim][i]</tt> is true. The size of
+   *  <tt>excludedEntities[codim]</tt> should be equal to the number of
+   *  entities of codimension \p codim contained in the grid. */
+  explicit GridSegment(
+      const boost::array<std::vector<bool>, 4> &excludedEntities);
+
   /** \brief Return true if the segment contains the entity of codimension \p
   codim and index \p index, false otherwise. */
   bool contains(int codim, int index) const;
@@ -139,8 +153,15 @@ public:
   GridSegment intersection(const GridSegment &other) const;
 
 private:
+  typedef std::vector<std::uint64_t> Bitset;
+
+  GridSegment(const boost::array<int, 4> &entityCounts,
+              const boost::array<Bitset, 4> &excludedEntities);
+
+  void checkCompatibility(const GridSegment &other, const char *method) const;
+
   boost::array<int, 4> m_entityCounts;
-  boost::array<std::set<int>, 4> m_excludedEntities;
+  boost::array<Bitset, 4> m_excludedEntities;
 };
 
 GridSegment gridSegmentWithPositiveX(const Grid &grid, int level = 0);
@@ -21,6 +21,7 @@
 #define bempp_grid_view_hpp
 
 #include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
 
 #include "dune.hpp"
 #include "entity_iterator.hpp"
@@ -31,11 +32,20 @@
 #include <memory>
 #include <stdexcept>
 
+namespace Fiber {
+
+/** \cond FORWARD_DECL */
+template <typename CoordinateType> class RawGridGeometry;
+/** \endcond */
+
+} // namespace Fiber
+
 namespace Bempp {
 
 /** \cond FORWARD_DECL */
 template <int codim> class Entity;
 template <int codim> class EntityCache;
+class ElementConnectivity;
 class IndexSet;
 class Mapper;
 class ReverseElementMapper;
@@ -147,6 +157,30 @@ public:
                          arma::Mat<char> &auxData,
                          std::vector<int> &domainIndices) const;
 
+  /** \brief Geometry of all codim-0 entities contained in this grid view.
+
+    The returned object contains the data returned by getRawElementData()
+    together with the Jacobians, integration elements and normals of the
+    elements (see Fiber::RawGridGeometry::computeElementGeometry()). It is
+    computed on the first call and shared by all views of the same level
+    (or the leaf) of a grid, and hence by all operators defined on it. This
+    method is thread-safe.
+
+    \tparam CoordinateType Either \c float or \c double. */
+  template <typename CoordinateType>
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> rawGeometry() const;
+
+  /** \brief Connectivity of the codim-0 entities contained in this grid view.
+
+    The returned object stores the vertices, edges, domain indices and
+    neighbours of all elements, and the elements adjacent to each vertex and
+    edge, in contiguous arrays indexed as by indexSet(). Loops over
+    these arrays are much cheaper than loops using entityIterator() and are
+    easy to parallelise. Like rawGeometry(), the object is computed on the
+    first call, shared by all views of the same level (or the leaf) of a
+    grid and thread-safe. */
+  virtual shared_ptr<const ElementConnectivity> elementConnectivity() const = 0;
+
   /** \brief Mapping from codim-0 entity index to entity pointer.
 
     Note that this object is *not* updated when the grid is adapted. In that
@@ -167,7 +201,8 @@ public:
   vtkWriter(Dune::VTK::DataMode dm = Dune::VTK::conforming) const = 0;
 
   // Deferred for later implementation:
-  // * Iteration over neighbours: Dune methods ibegin() and iend().
+  // * Iteration over neighbours: Dune methods ibegin() and iend() (see
+  //   elementConnectivity() for neighbour tables).
 
 private:
   virtual void getRawElementDataDoubleImpl(
@@ -176,6 +211,10 @@ private:
   virtual void getRawElementDataFloatImpl(
       arma::Mat<float> &vertices, arma::Mat<int> &elementCorners,
       arma::Mat<char> &auxData, std::vector<int> *domainIndices) const = 0;
+  virtual shared_ptr<const Fiber::RawGridGeometry<double>>
+  rawGeometryDoubleImpl() const = 0;
+  virtual shared_ptr<const Fiber::RawGridGeometry<float>>
+  rawGeometryFloatImpl() const = 0;
 
   /** \brief Iterator over entities of codimension 0 contained in this view. */
   virtual std::unique_ptr<EntityIterator<0>> entityCodim0Iterator() const = 0;
@@ -214,6 +253,18 @@ inline void GridView::getRawElementData(arma::Mat<float> &vertices,
   getRawElementDataFloatImpl(vertices, elementCorners, auxData, &domainIndices);
 }
 
+template <>
+inline shared_ptr<const Fiber::RawGridGeometry<double>>
+GridView::rawGeometry<double>() const {
+  return rawGeometryDoubleImpl();
+}
+
+template <>
+inline shared_ptr<const Fiber::RawGridGeometry<float>>
+GridView::rawGeometry<float>() const {
+  return rawGeometryFloatImpl();
+}
+
 template <>
 inline std::unique_ptr<EntityIterator<0>> GridView::entityIterator<0>() const {
   return entityCodim0Iterator();
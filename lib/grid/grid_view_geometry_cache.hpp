@@ -0,0 +1,50 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_grid_view_geometry_cache_hpp
+#define bempp_grid_view_geometry_cache_hpp
+
+#include "../common/common.hpp"
+
+#include "element_connectivity.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+
+#include <mutex>
+
+namespace Bempp {
+
+/** \ingroup grid_internal
+ *  \brief Storage for the raw geometry and connectivity of a grid view,
+ *  shared by all views of the same level (or the leaf) of a grid.
+ *
+ *  See GridView::rawGeometry() and GridView::elementConnectivity(). */
+struct GridViewGeometryCache {
+  std::once_flag doubleFlag;
+  std::once_flag floatFlag;
+  std::once_flag connectivityFlag;
+  shared_ptr<const Fiber::RawGridGeometry<double>> doubleGeometry;
+  shared_ptr<const Fiber::RawGridGeometry<float>> floatGeometry;
+  shared_ptr<const ElementConnectivity> connectivity;
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,116 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "native_triangular_entity.hpp"
+
+#include "native_triangular_grid.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+namespace {
+
+void setUpGeometry(const NativeTriangularGrid &grid, const int *cornerIndices,
+                   int cornerCount, Geometry &geometry) {
+  const arma::Mat<double> &vertices = grid.vertices();
+  arma::Mat<double> corners(3, cornerCount);
+  for (int i = 0; i < cornerCount; ++i)
+    for (int dim = 0; dim < 3; ++dim)
+      corners(dim, i) = vertices(dim, cornerIndices[i]);
+  geometry.setup(corners, arma::Col<char>());
+}
+
+const int *cornerIndices(const NativeTriangularGrid &grid, int index,
+                         int codim) {
+  switch (codim) {
+  case 0:
+    return grid.elementCorners().colptr(index);
+  case 1:
+    return grid.edgeVertices().colptr(index);
+  default:
+    return 0; // a vertex is its own corner
+  }
+}
+
+} // namespace
+
+template <int codim>
+const Geometry &NativeTriangularEntity<codim>::geometry() const {
+  if (!m_geometry.isInitialized()) {
+    const int *corners = cornerIndices(*m_grid, m_index, codim);
+    setUpGeometry(*m_grid, corners ? corners : &m_index, 3 - codim,
+                  m_geometry);
+  }
+  return m_geometry;
+}
+
+const Geometry &NativeTriangularEntity<0>::geometry() const {
+  if (!m_geometry.isInitialized())
+    setUpGeometry(*m_grid, cornerIndices(*m_grid, m_index, 0), 3, m_geometry);
+  return m_geometry;
+}
+
+int NativeTriangularEntity<0>::subEntityIndex(size_t i, int codimSub) const {
+  if (i >= (codimSub == 0 ? 1 : 3))
+    throw std::invalid_argument(
+        "IndexSet::subEntityIndex(): subentity number out of range");
+  switch (codimSub) {
+  case 0:
+    return m_index;
+  case 1:
+    return m_grid->elementEdges()(i, m_index);
+  case 2:
+    return m_grid->elementCorners()(i, m_index);
+  default:
+    throw std::invalid_argument(
+        "IndexSet::subEntityIndex(): codimSub exceeds grid dimension");
+  }
+}
+
+std::unique_ptr<EntityIterator<0>>
+NativeTriangularEntity<0>::sonIterator(int maxlevel) const {
+  // Elements of a native grid have no sons
+  return std::unique_ptr<EntityIterator<0>>(
+      new NativeTriangularEntityIterator<0>(*m_grid, 0, 0));
+}
+
+int NativeTriangularEntity<0>::domain() const {
+  return m_grid->domainIndices()[m_index];
+}
+
+std::unique_ptr<EntityIterator<1>>
+NativeTriangularEntity<0>::subEntityCodim1Iterator() const {
+  return std::unique_ptr<EntityIterator<1>>(
+      new NativeTriangularEntityIterator<1>(
+          *m_grid, m_grid->elementEdges().colptr(m_index), 3));
+}
+
+std::unique_ptr<EntityIterator<2>>
+NativeTriangularEntity<0>::subEntityCodim2Iterator() const {
+  return std::unique_ptr<EntityIterator<2>>(
+      new NativeTriangularEntityIterator<2>(
+          *m_grid, m_grid->elementCorners().colptr(m_index), 3));
+}
+
+template class NativeTriangularEntity<1>;
+template class NativeTriangularEntity<2>;
+
+} // namespace Bempp
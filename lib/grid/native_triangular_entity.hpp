@@ -0,0 +1,207 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_native_triangular_entity_hpp
+#define bempp_native_triangular_entity_hpp
+
+#include "../common/common.hpp"
+
+#include "entity.hpp"
+#include "entity_iterator.hpp"
+#include "concrete_geometry.hpp"
+
+#include <memory>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class NativeTriangularGrid;
+template <int codim> class NativeTriangularEntityIterator;
+template <int codim> class NativeTriangularEntityPointer;
+/** \endcond */
+
+/** \ingroup grid_internal
+ *  \brief Entity of codimension \p codim (1 or 2) of a NativeTriangularGrid.
+ *
+ *  The entity is identified by its index in the flat arrays of the grid;
+ *  its geometry is set up from the coordinates of its corners on the first
+ *  call to geometry(). */
+template <int codim> class NativeTriangularEntity : public Entity<codim> {
+public:
+  NativeTriangularEntity(const NativeTriangularGrid &grid, int index)
+      : m_grid(&grid), m_index(index) {}
+
+  /** \brief Grid containing this entity. */
+  const NativeTriangularGrid &grid() const { return *m_grid; }
+
+  /** \brief Index of this entity in the arrays of the grid. */
+  int index() const { return m_index; }
+
+  virtual size_t level() const { return 0; }
+
+  virtual const Geometry &geometry() const;
+
+  virtual GeometryType type() const {
+    return GeometryType(GeometryType::simplex, 2 - codim);
+  }
+
+private:
+  friend class NativeTriangularEntityIterator<codim>;
+
+  void setIndex(int index) {
+    m_index = index;
+    m_geometry.uninitialize();
+  }
+
+  const NativeTriangularGrid *m_grid;
+  int m_index;
+  mutable ConcreteGeometry<2 - codim> m_geometry;
+};
+
+/** \ingroup grid_internal
+ *  \brief Element of a NativeTriangularGrid.
+ *
+ *  Native grids are never refined: all their elements are leaf elements of
+ *  level 0 without father or sons. */
+template <> class NativeTriangularEntity<0> : public Entity<0> {
+public:
+  NativeTriangularEntity(const NativeTriangularGrid &grid, int index)
+      : m_grid(&grid), m_index(index) {}
+
+  /** \brief Grid containing this element. */
+  const NativeTriangularGrid &grid() const { return *m_grid; }
+
+  /** \brief Index of this element in the arrays of the grid. */
+  int index() const { return m_index; }
+
+  /** \brief Index of the <tt>i</tt>th subentity of codimension \p codimSub
+   *  of this element. */
+  int subEntityIndex(size_t i, int codimSub) const;
+
+  virtual size_t level() const { return 0; }
+
+  virtual const Geometry &geometry() const;
+
+  virtual GeometryType type() const {
+    return GeometryType(GeometryType::simplex, 2);
+  }
+
+  virtual std::unique_ptr<EntityPointer<0>> father() const {
+    return std::unique_ptr<EntityPointer<0>>();
+  }
+
+  virtual bool hasFather() const { return false; }
+
+  virtual bool isLeaf() const { return true; }
+
+  virtual bool isRegular() const { return true; }
+
+  virtual std::unique_ptr<EntityIterator<0>> sonIterator(int maxlevel) const;
+
+  virtual bool isNew() const { return false; }
+
+  virtual bool mightVanish() const { return false; }
+
+  virtual int domain() const;
+
+private:
+  friend class NativeTriangularEntityIterator<0>;
+
+  void setIndex(int index) {
+    m_index = index;
+    m_geometry.uninitialize();
+  }
+
+  virtual std::unique_ptr<EntityIterator<1>> subEntityCodim1Iterator() const;
+  virtual std::unique_ptr<EntityIterator<2>> subEntityCodim2Iterator() const;
+  virtual std::unique_ptr<EntityIterator<3>> subEntityCodim3Iterator() const {
+    throw std::logic_error(
+        "Entity::subEntityIterator(): invalid subentity codimension");
+  }
+
+  virtual size_t subEntityCodim1Count() const { return 3; }
+  virtual size_t subEntityCodim2Count() const { return 3; }
+  virtual size_t subEntityCodim3Count() const { return 0; }
+
+  const NativeTriangularGrid *m_grid;
+  int m_index;
+  mutable ConcreteGeometry<2> m_geometry;
+};
+
+/** \ingroup grid_internal
+ *  \brief Pointer to an entity of codimension \p codim of a
+ *  NativeTriangularGrid. */
+template <int codim>
+class NativeTriangularEntityPointer : public EntityPointer<codim> {
+public:
+  NativeTriangularEntityPointer(const NativeTriangularGrid &grid, int index)
+      : m_entity(grid, index) {}
+
+  virtual const Entity<codim> &entity() const { return m_entity; }
+
+private:
+  NativeTriangularEntity<codim> m_entity;
+};
+
+/** \ingroup grid_internal
+ *  \brief Iterator over entities of codimension \p codim of a
+ *  NativeTriangularGrid.
+ *
+ *  If \p indices is null, the iterator visits the entities of indices 0, 1,
+ *  ..., \p count - 1; otherwise those of indices <tt>indices[0]</tt>, ...,
+ *  <tt>indices[count - 1]</tt>. The array \p indices is not copied. */
+template <int codim>
+class NativeTriangularEntityIterator : public EntityIterator<codim> {
+public:
+  NativeTriangularEntityIterator(const NativeTriangularGrid &grid,
+                                 const int *indices, int count)
+      : m_indices(indices), m_count(count), m_position(0), m_entity(grid, 0) {
+    update();
+  }
+
+  virtual void next() {
+    ++m_position;
+    update();
+  }
+
+  virtual const Entity<codim> &entity() const { return m_entity; }
+
+  virtual std::unique_ptr<EntityPointer<codim>> frozen() const {
+    return std::unique_ptr<EntityPointer<codim>>(
+        new NativeTriangularEntityPointer<codim>(m_entity.grid(),
+                                                 m_entity.index()));
+  }
+
+private:
+  void update() {
+    this->m_finished = m_position >= m_count;
+    if (!this->m_finished)
+      m_entity.setIndex(m_indices ? m_indices[m_position] : m_position);
+  }
+
+  const int *m_indices;
+  int m_count;
+  int m_position;
+  NativeTriangularEntity<codim> m_entity;
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "native_triangular_grid.hpp"
+
+#include "concrete_geometry_factory.hpp"
+#include "grid_refinement.hpp"
+#include "grid_view_geometry_cache.hpp"
+#include "native_triangular_grid_view.hpp"
+
+#include "../common/boost_make_shared_fwd.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+NativeTriangularGrid::NativeTriangularGrid(
+    const arma::Mat<double> &vertices, const arma::Mat<int> &elementCorners,
+    const std::vector<int> &domainIndices)
+    : m_vertices(vertices), m_elementCorners(3, elementCorners.n_cols),
+      m_domainIndices(domainIndices),
+      m_geometryCache(boost::make_shared<GridViewGeometryCache>()) {
+  for (size_t e = 0; e < elementCorners.n_cols; ++e)
+    for (int i = 0; i < 3; ++i)
+      m_elementCorners(i, e) = elementCorners(i, e);
+  if (m_domainIndices.empty())
+    m_domainIndices.resize(elementCorners.n_cols, 0);
+  computeEdgeIndices(m_elementCorners, m_elementEdges, m_edgeVertices);
+}
+
+NativeTriangularGrid::~NativeTriangularGrid() {}
+
+std::unique_ptr<GridView> NativeTriangularGrid::levelView(size_t level) const {
+  if (level != 0)
+    throw std::invalid_argument("NativeTriangularGrid::levelView(): "
+                                "native grids have a single level");
+  return leafView();
+}
+
+std::unique_ptr<GridView> NativeTriangularGrid::leafView() const {
+  return std::unique_ptr<GridView>(
+      new NativeTriangularGridView(*this, m_geometryCache));
+}
+
+std::unique_ptr<GeometryFactory>
+NativeTriangularGrid::elementGeometryFactory() const {
+  return std::unique_ptr<GeometryFactory>(new ConcreteGeometryFactory<2>());
+}
+
+shared_ptr<Grid> NativeTriangularGrid::barycentricGrid() const {
+  throw std::runtime_error("Barycentric Grid not implemented.");
+}
+
+} // namespace Bempp
@@ -0,0 +1,168 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_native_triangular_grid_hpp
+#define bempp_native_triangular_grid_hpp
+
+#include "../common/common.hpp"
+
+#include "grid.hpp"
+#include "native_triangular_index_set.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <armadillo>
+#include <memory>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+struct GridViewGeometryCache;
+/** \endcond */
+
+/** \ingroup grid
+ *  \brief Grid of flat triangles embedded in 3D stored in flat arrays.
+ *
+ *  Unlike ConcreteGrid, this class does not wrap a Dune grid. Vertex
+ *  coordinates, element corners, element edges and domain indices are kept
+ *  in contiguous arrays; the edges are numbered once, by
+ *  computeEdgeIndices(), when the grid is constructed. Entities are
+ *  lightweight objects referring to their index in these arrays, so index
+ *  sets need no lookups and advancing an iterator allocates no memory.
+ *  Vertices and elements are indexed in the order in which they were passed
+ *  to the constructor. Edge \e i of an element joins its corners (0, 1),
+ *  (0, 2) and (1, 2) for \e i = 0, 1 and 2, respectively, as in the Dune
+ *  reference triangle.
+ *
+ *  A native grid has a single level and cannot be refined in place; use
+ *  GridFactory::createRefinedGrid() to obtain a refined copy.
+ *
+ *  Objects of this class are normally created by
+ *  GridFactory::createNativeGridFromConnectivityArrays(). */
+class NativeTriangularGrid : public Grid {
+public:
+  /** \brief Constructor.
+   *
+   *  \param[in] vertices
+   *    3 x \e n array whose <em>j</em>th column contains the coordinates of
+   *    the <em>j</em>th vertex.
+   *  \param[in] elementCorners
+   *    Array with at least three rows whose <em>j</em>th column contains the
+   *    indices of the corners of the <em>j</em>th element. Rows beyond the
+   *    third are ignored.
+   *  \param[in] domainIndices
+   *    Domain index of each element. If empty, all elements belong to
+   *    domain 0.
+   *
+   *  The arrays are assumed to be valid; see
+   *  GridFactory::createNativeGridFromConnectivityArrays(), which checks
+   *  them. */
+  NativeTriangularGrid(const arma::Mat<double> &vertices,
+                       const arma::Mat<int> &elementCorners,
+                       const std::vector<int> &domainIndices =
+                           std::vector<int>());
+
+  virtual ~NativeTriangularGrid();
+
+  /** @name Grid parameters
+  @{ */
+
+  virtual int dim() const { return 2; }
+
+  virtual int dimWorld() const { return 3; }
+
+  virtual int maxLevel() const { return 0; }
+
+  /** @}
+  @name Views
+  @{ */
+
+  virtual std::unique_ptr<GridView> levelView(size_t level) const;
+
+  virtual std::unique_ptr<GridView> leafView() const;
+
+  /** @}
+  @name Geometry factory
+  @{ */
+
+  virtual std::unique_ptr<GeometryFactory> elementGeometryFactory() const;
+
+  /** @}
+  @name Id sets
+  @{ */
+
+  virtual const IdSet &globalIdSet() const { return m_globalIdSet; }
+
+  /** @} */
+
+  virtual GridParameters::Topology topology() const {
+    return GridParameters::TRIANGULAR;
+  }
+
+  /** @name Refinement
+  @{ */
+
+  virtual shared_ptr<Grid> barycentricGrid() const;
+
+  virtual bool hasBarycentricGrid() const { return false; }
+
+  /** @}
+  @name Flat arrays
+  @{ */
+
+  int vertexCount() const { return m_vertices.n_cols; }
+  int edgeCount() const { return m_edgeVertices.n_cols; }
+  int elementCount() const { return m_elementCorners.n_cols; }
+
+  /** \brief Coordinates of the vertices (one column per vertex). */
+  const arma::Mat<double> &vertices() const { return m_vertices; }
+
+  /** \brief Indices of the corners of the elements (3 x elementCount()). */
+  const arma::Mat<int> &elementCorners() const { return m_elementCorners; }
+
+  /** \brief Indices of the edges of the elements (3 x elementCount()). */
+  const arma::Mat<int> &elementEdges() const { return m_elementEdges; }
+
+  /** \brief Indices of the endpoints of the edges (2 x edgeCount()).
+   *
+   *  The first endpoint of each edge has the smaller index. */
+  const arma::Mat<int> &edgeVertices() const { return m_edgeVertices; }
+
+  /** \brief Domain indices of the elements. */
+  const std::vector<int> &domainIndices() const { return m_domainIndices; }
+
+  /** @} */
+
+private:
+  NativeTriangularGrid(const NativeTriangularGrid &);
+  NativeTriangularGrid &operator=(const NativeTriangularGrid &);
+
+  arma::Mat<double> m_vertices;
+  arma::Mat<int> m_elementCorners;
+  arma::Mat<int> m_elementEdges;
+  arma::Mat<int> m_edgeVertices;
+  std::vector<int> m_domainIndices;
+  NativeTriangularIdSet m_globalIdSet;
+  shared_ptr<GridViewGeometryCache> m_geometryCache;
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,248 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "native_triangular_grid_view.hpp"
+
+#include "element_connectivity.hpp"
+#include "grid_view_geometry_cache.hpp"
+#include "native_triangular_grid.hpp"
+#include "vtk_writer.hpp"
+#include "vtu_writer.hpp"
+
+#include "../common/boost_make_shared_fwd.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
+
+#include <list>
+
+namespace Bempp {
+
+namespace {
+
+// VtkWriter interface over VtuWriter. VtuWriter does not copy the fields
+// it is given, hence the copies kept here.
+class NativeTriangularVtkWriter : public VtkWriter {
+public:
+  explicit NativeTriangularVtkWriter(const GridView &view) : m_writer(view) {}
+
+  virtual void clear() {
+    m_writer.clear();
+    m_doubleData.clear();
+    m_floatData.clear();
+  }
+
+  virtual std::string write(const std::string &name, OutputType type = ASCII) {
+    return m_writer.write(name);
+  }
+
+  virtual std::string pwrite(const std::string &name, const std::string &path,
+                             const std::string &extendpath,
+                             OutputType type = ASCII) {
+    return m_writer.write(name, VtuWriter::APPENDED_RAW, 1 /* piece */, path);
+  }
+
+private:
+  virtual void addCellDataDoubleImpl(const arma::Mat<double> &data,
+                                     const std::string &name) {
+    addDataImpl(data, name, m_doubleData, false);
+  }
+
+  virtual void addCellDataFloatImpl(const arma::Mat<float> &data,
+                                    const std::string &name) {
+    addDataImpl(data, name, m_floatData, false);
+  }
+
+  virtual void addVertexDataDoubleImpl(const arma::Mat<double> &data,
+                                       const std::string &name) {
+    addDataImpl(data, name, m_doubleData, true);
+  }
+
+  virtual void addVertexDataFloatImpl(const arma::Mat<float> &data,
+                                      const std::string &name) {
+    addDataImpl(data, name, m_floatData, true);
+  }
+
+  template <typename ValueType>
+  void addDataImpl(const arma::Mat<ValueType> &data, const std::string &name,
+                   std::list<arma::Mat<ValueType>> &storage, bool onVertices) {
+    if (data.n_rows < 1)
+      return; // empty matrix
+    storage.push_back(data);
+    if (onVertices)
+      m_writer.addVertexData(storage.back(), name);
+    else
+      m_writer.addCellData(storage.back(), name);
+  }
+
+  VtuWriter m_writer;
+  std::list<arma::Mat<double>> m_doubleData;
+  std::list<arma::Mat<float>> m_floatData;
+};
+
+} // namespace
+
+NativeTriangularGridView::NativeTriangularGridView(
+    const NativeTriangularGrid &grid,
+    const shared_ptr<GridViewGeometryCache> &geometry_cache)
+    : m_grid(grid), m_elementMapper(grid.elementCount()),
+      m_reverseElementMapper(*this), m_geometryCache(geometry_cache) {}
+
+size_t NativeTriangularGridView::entityCount(int codim) const {
+  switch (codim) {
+  case 0:
+    return m_grid.elementCount();
+  case 1:
+    return m_grid.edgeCount();
+  case 2:
+    return m_grid.vertexCount();
+  default:
+    return 0;
+  }
+}
+
+size_t NativeTriangularGridView::entityCount(const GeometryType &type) const {
+  if (type.isTriangle())
+    return m_grid.elementCount();
+  if (type.isLine())
+    return m_grid.edgeCount();
+  if (type.isVertex())
+    return m_grid.vertexCount();
+  return 0;
+}
+
+shared_ptr<const ElementConnectivity>
+NativeTriangularGridView::elementConnectivity() const {
+  std::call_once(m_geometryCache->connectivityFlag, [&]() {
+    // Pad the edge array to the layout produced by ConcreteGridView
+    const int MAX_EDGE_COUNT = 4;
+    const arma::Mat<int> &edges = m_grid.elementEdges();
+    arma::Mat<int> elementEdges(MAX_EDGE_COUNT, edges.n_cols);
+    for (size_t e = 0; e < edges.n_cols; ++e) {
+      for (int i = 0; i < 3; ++i)
+        elementEdges(i, e) = edges(i, e);
+      elementEdges(3, e) = -1;
+    }
+    shared_ptr<const Fiber::RawGridGeometry<double>> geometry =
+        rawGeometry<double>();
+    m_geometryCache->connectivity = boost::make_shared<ElementConnectivity>(
+        geometry->elementCornerIndices(), elementEdges,
+        geometry->domainIndices(), m_grid.vertexCount(), m_grid.edgeCount());
+  });
+  return m_geometryCache->connectivity;
+}
+
+const ReverseElementMapper &
+NativeTriangularGridView::reverseElementMapper() const {
+  std::call_once(m_reverseElementMapperFlag,
+                 [&]() { m_reverseElementMapper.update(); });
+  return m_reverseElementMapper;
+}
+
+std::unique_ptr<VtkWriter>
+NativeTriangularGridView::vtkWriter(Dune::VTK::DataMode dm) const {
+  return std::unique_ptr<VtkWriter>(new NativeTriangularVtkWriter(*this));
+}
+
+std::unique_ptr<EntityIterator<0>>
+NativeTriangularGridView::entityCodim0Iterator() const {
+  return std::unique_ptr<EntityIterator<0>>(
+      new NativeTriangularEntityIterator<0>(m_grid, 0, m_grid.elementCount()));
+}
+
+std::unique_ptr<EntityIterator<1>>
+NativeTriangularGridView::entityCodim1Iterator() const {
+  return std::unique_ptr<EntityIterator<1>>(
+      new NativeTriangularEntityIterator<1>(m_grid, 0, m_grid.edgeCount()));
+}
+
+std::unique_ptr<EntityIterator<2>>
+NativeTriangularGridView::entityCodim2Iterator() const {
+  return std::unique_ptr<EntityIterator<2>>(
+      new NativeTriangularEntityIterator<2>(m_grid, 0, m_grid.vertexCount()));
+}
+
+void NativeTriangularGridView::getRawElementDataDoubleImpl(
+    arma::Mat<double> &vertices, arma::Mat<int> &elementCorners,
+    arma::Mat<char> &auxData, std::vector<int> *domainIndices) const {
+  getRawElementDataImpl(vertices, elementCorners, auxData, domainIndices);
+}
+
+void NativeTriangularGridView::getRawElementDataFloatImpl(
+    arma::Mat<float> &vertices, arma::Mat<int> &elementCorners,
+    arma::Mat<char> &auxData, std::vector<int> *domainIndices) const {
+  getRawElementDataImpl(vertices, elementCorners, auxData, domainIndices);
+}
+
+template <typename CoordinateType>
+void NativeTriangularGridView::getRawElementDataImpl(
+    arma::Mat<CoordinateType> &vertices, arma::Mat<int> &elementCorners,
+    arma::Mat<char> &auxData, std::vector<int> *domainIndices) const {
+  const arma::Mat<double> &gridVertices = m_grid.vertices();
+  vertices.set_size(gridVertices.n_rows, gridVertices.n_cols);
+  for (size_t i = 0; i < gridVertices.n_elem; ++i)
+    vertices[i] = gridVertices[i];
+
+  // Same layout as in ConcreteGridView: 4 rows, padded with -1
+  const int MAX_CORNER_COUNT = 4;
+  const arma::Mat<int> &corners = m_grid.elementCorners();
+  elementCorners.set_size(MAX_CORNER_COUNT, corners.n_cols);
+  for (size_t e = 0; e < corners.n_cols; ++e) {
+    for (int i = 0; i < 3; ++i)
+      elementCorners(i, e) = corners(i, e);
+    elementCorners(3, e) = -1;
+  }
+
+  auxData.set_size(0, elementCorners.n_cols);
+
+  if (domainIndices)
+    *domainIndices = m_grid.domainIndices();
+}
+
+shared_ptr<const Fiber::RawGridGeometry<double>>
+NativeTriangularGridView::rawGeometryDoubleImpl() const {
+  return rawGeometryImpl(m_geometryCache->doubleFlag,
+                         m_geometryCache->doubleGeometry);
+}
+
+shared_ptr<const Fiber::RawGridGeometry<float>>
+NativeTriangularGridView::rawGeometryFloatImpl() const {
+  return rawGeometryImpl(m_geometryCache->floatFlag,
+                         m_geometryCache->floatGeometry);
+}
+
+template <typename CoordinateType>
+shared_ptr<const Fiber::RawGridGeometry<CoordinateType>>
+NativeTriangularGridView::rawGeometryImpl(
+    std::once_flag &flag,
+    shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &geometry) const {
+  std::call_once(flag, [&]() {
+    typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+    shared_ptr<RawGridGeometry> newGeometry =
+        boost::make_shared<RawGridGeometry>(dim(), dimWorld());
+    getRawElementDataImpl(newGeometry->vertices(),
+                          newGeometry->elementCornerIndices(),
+                          newGeometry->auxData(),
+                          &newGeometry->domainIndices());
+    newGeometry->computeElementGeometry();
+    geometry = newGeometry;
+  });
+  return geometry;
+}
+
+} // namespace Bempp
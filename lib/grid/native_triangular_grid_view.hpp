@@ -0,0 +1,142 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_native_triangular_grid_view_hpp
+#define bempp_native_triangular_grid_view_hpp
+
+#include "../common/common.hpp"
+
+#include "grid_view.hpp"
+#include "native_triangular_index_set.hpp"
+#include "reverse_element_mapper.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <mutex>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class NativeTriangularGrid;
+struct GridViewGeometryCache;
+/** \endcond */
+
+/** \ingroup grid_internal
+ *  \brief View of a NativeTriangularGrid.
+ *
+ *  As the grid has a single level, its level-0 and leaf views coincide. */
+class NativeTriangularGridView : public GridView {
+public:
+  /** \brief Constructor.
+   *
+   *  \param grid Grid to be viewed. It must outlive the view.
+   *  \param geometry_cache
+   *    Storage for the raw geometry and connectivity of the grid, shared by
+   *    all its views. */
+  NativeTriangularGridView(
+      const NativeTriangularGrid &grid,
+      const shared_ptr<GridViewGeometryCache> &geometry_cache);
+
+  virtual int dim() const { return 2; }
+
+  virtual int dimWorld() const { return 3; }
+
+  virtual const IndexSet &indexSet() const { return m_indexSet; }
+
+  virtual const Mapper &elementMapper() const { return m_elementMapper; }
+
+  virtual size_t entityCount(int codim) const;
+
+  virtual size_t entityCount(const GeometryType &type) const;
+
+  virtual bool containsEntity(const Entity<0> &e) const {
+    return containsEntityCodimN(e);
+  }
+  virtual bool containsEntity(const Entity<1> &e) const {
+    return containsEntityCodimN(e);
+  }
+  virtual bool containsEntity(const Entity<2> &e) const {
+    return containsEntityCodimN(e);
+  }
+  virtual bool containsEntity(const Entity<3> &e) const {
+    throw std::logic_error(
+        "GridView::containsEntity(): invalid entity codimension");
+  }
+
+  virtual shared_ptr<const ElementConnectivity> elementConnectivity() const;
+
+  virtual const ReverseElementMapper &reverseElementMapper() const;
+
+  /** \brief Return a VTK writer for this view.
+   *
+   *  The writer is based on VtuWriter and always writes binary appended
+   *  data; the data mode \p dm is ignored, since the grid is conforming. */
+  virtual std::unique_ptr<VtkWriter>
+  vtkWriter(Dune::VTK::DataMode dm = Dune::VTK::conforming) const;
+
+private:
+  template <int codim>
+  bool containsEntityCodimN(const Entity<codim> &e) const {
+    const NativeTriangularEntity<codim> *ne =
+        dynamic_cast<const NativeTriangularEntity<codim> *>(&e);
+    return ne && &ne->grid() == &m_grid;
+  }
+
+  virtual std::unique_ptr<EntityIterator<0>> entityCodim0Iterator() const;
+  virtual std::unique_ptr<EntityIterator<1>> entityCodim1Iterator() const;
+  virtual std::unique_ptr<EntityIterator<2>> entityCodim2Iterator() const;
+  virtual std::unique_ptr<EntityIterator<3>> entityCodim3Iterator() const {
+    throw std::logic_error(
+        "GridView::entityIterator(): invalid entity codimension");
+  }
+
+  virtual void getRawElementDataDoubleImpl(
+      arma::Mat<double> &vertices, arma::Mat<int> &elementCorners,
+      arma::Mat<char> &auxData, std::vector<int> *domainIndices) const;
+  virtual void getRawElementDataFloatImpl(
+      arma::Mat<float> &vertices, arma::Mat<int> &elementCorners,
+      arma::Mat<char> &auxData, std::vector<int> *domainIndices) const;
+
+  template <typename CoordinateType>
+  void getRawElementDataImpl(arma::Mat<CoordinateType> &vertices,
+                             arma::Mat<int> &elementCorners,
+                             arma::Mat<char> &auxData,
+                             std::vector<int> *domainIndices) const;
+
+  virtual shared_ptr<const Fiber::RawGridGeometry<double>>
+  rawGeometryDoubleImpl() const;
+  virtual shared_ptr<const Fiber::RawGridGeometry<float>>
+  rawGeometryFloatImpl() const;
+
+  template <typename CoordinateType>
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> rawGeometryImpl(
+      std::once_flag &flag,
+      shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> &geometry) const;
+
+  const NativeTriangularGrid &m_grid;
+  NativeTriangularIndexSet m_indexSet;
+  NativeTriangularElementMapper m_elementMapper;
+  mutable ReverseElementMapper m_reverseElementMapper;
+  mutable std::once_flag m_reverseElementMapperFlag;
+  shared_ptr<GridViewGeometryCache> m_geometryCache;
+};
+
+} // namespace Bempp
+
+#endif
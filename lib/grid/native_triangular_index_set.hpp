@@ -0,0 +1,143 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_native_triangular_index_set_hpp
+#define bempp_native_triangular_index_set_hpp
+
+#include "../common/common.hpp"
+
+#include "id_set.hpp"
+#include "index_set.hpp"
+#include "mapper.hpp"
+#include "native_triangular_entity.hpp"
+
+#include <stdexcept>
+
+namespace Bempp {
+
+/** \ingroup grid_internal
+ *  \brief Index set of a NativeTriangularGrid.
+ *
+ *  The index of an entity is its position in the arrays of the grid, which
+ *  the entity stores, so no lookup is needed. */
+class NativeTriangularIndexSet : public IndexSet {
+public:
+  virtual IndexType entityIndex(const Entity<0> &e) const {
+    return static_cast<const NativeTriangularEntity<0> &>(e).index();
+  }
+  virtual IndexType entityIndex(const Entity<1> &e) const {
+    return static_cast<const NativeTriangularEntity<1> &>(e).index();
+  }
+  virtual IndexType entityIndex(const Entity<2> &e) const {
+    return static_cast<const NativeTriangularEntity<2> &>(e).index();
+  }
+  virtual IndexType entityIndex(const Entity<3> &e) const {
+    throw std::logic_error(
+        "IndexSet::entityIndex(): invalid entity codimension");
+  }
+
+  virtual IndexType subEntityIndex(const Entity<0> &e, size_t i,
+                                   int codimSub) const {
+    return static_cast<const NativeTriangularEntity<0> &>(e).subEntityIndex(
+        i, codimSub);
+  }
+};
+
+/** \ingroup grid_internal
+ *  \brief Global id set of a NativeTriangularGrid.
+ *
+ *  The id of an entity of codimension \e c and index \e i is 4 \e i + \e c,
+ *  so that ids are unique across all codimensions. */
+class NativeTriangularIdSet : public IdSet {
+public:
+  virtual IdType entityId(const Entity<0> &e) const {
+    return id(static_cast<const NativeTriangularEntity<0> &>(e).index(), 0);
+  }
+  virtual IdType entityId(const Entity<1> &e) const {
+    return id(static_cast<const NativeTriangularEntity<1> &>(e).index(), 1);
+  }
+  virtual IdType entityId(const Entity<2> &e) const {
+    return id(static_cast<const NativeTriangularEntity<2> &>(e).index(), 2);
+  }
+  virtual IdType entityId(const Entity<3> &e) const {
+    throw std::logic_error("IdSet::entityId(): invalid entity codimension");
+  }
+
+  virtual IdType subEntityId(const Entity<0> &e, size_t i, int codimSub) const {
+    return id(static_cast<const NativeTriangularEntity<0> &>(e).subEntityIndex(
+                  i, codimSub),
+              codimSub);
+  }
+
+private:
+  static IdType id(int index, int codim) {
+    return 4 * static_cast<IdType>(index) + codim;
+  }
+};
+
+/** \ingroup grid_internal
+ *  \brief Element mapper of a NativeTriangularGrid.
+ *
+ *  Maps the elements to their indices in the arrays of the grid. */
+class NativeTriangularElementMapper : public Mapper {
+public:
+  explicit NativeTriangularElementMapper(size_t elementCount)
+      : m_elementCount(elementCount) {}
+
+  virtual size_t size() const { return m_elementCount; }
+
+  virtual size_t entityIndex(const Entity<0> &e) const {
+    return static_cast<const NativeTriangularEntity<0> &>(e).index();
+  }
+
+  virtual size_t entityIndex(const Entity<1> &e) const {
+    throw std::logic_error("NativeTriangularElementMapper::entityIndex(): "
+                           "entities of codimension 1 do not belong to the "
+                           "managed set.");
+  }
+
+  virtual size_t entityIndex(const Entity<2> &e) const {
+    throw std::logic_error("NativeTriangularElementMapper::entityIndex(): "
+                           "entities of codimension 2 do not belong to the "
+                           "managed set.");
+  }
+
+  virtual size_t entityIndex(const Entity<3> &e) const {
+    throw std::logic_error("NativeTriangularElementMapper::entityIndex(): "
+                           "entities of codimension 3 do not belong to the "
+                           "managed set.");
+  }
+
+  virtual size_t subEntityIndex(const Entity<0> &e, size_t i,
+                                int codimSub) const {
+    if (codimSub != 0)
+      throw std::logic_error("NativeTriangularElementMapper::"
+                             "subEntityIndex(): only subentities of "
+                             "codimension 0 belong to the managed set.");
+    return entityIndex(e);
+  }
+
+private:
+  size_t m_elementCount;
+};
+
+} // namespace Bempp
+
+#endif
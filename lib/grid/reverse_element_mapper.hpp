@@ -35,6 +35,7 @@ class GridView;
     \brief Mapping from codim-0 entity indices to entity pointers. */
 class ReverseElementMapper {
   template <typename DuneGridView> friend class ConcreteGridView;
+  friend class NativeTriangularGridView;
 
 private:
   const GridView &m_view;
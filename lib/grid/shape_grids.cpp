@@ -0,0 +1,271 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "shape_grids.hpp"
+#include "grid_refinement.hpp"
+
+#include <armadillo>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+namespace Bempp {
+
+namespace {
+
+void checkOrigin(const char *function, const arma::Col<double> &origin) {
+  if (origin.n_rows != 3)
+    throw std::invalid_argument(std::string(function) +
+                                "(): 'origin' must have three components");
+}
+
+// Icosahedron inscribed in the unit sphere, oriented outwards
+void createIcosahedron(arma::Mat<double> &vertices,
+                       arma::Mat<int> &elementCorners) {
+  const double phi = 0.5 * (1. + std::sqrt(5.));
+  vertices.set_size(3, 12);
+  int vertex = 0;
+  for (int s = -1; s <= 1; s += 2)
+    for (int t = -1; t <= 1; t += 2) {
+      // Cyclic permutations of (0, s, t * phi)
+      for (int d = 0; d < 3; ++d) {
+        vertices(d, vertex) = 0.;
+        vertices((d + 1) % 3, vertex) = s;
+        vertices((d + 2) % 3, vertex) = t * phi;
+        ++vertex;
+      }
+    }
+
+  // The faces are the triples of vertices at mutual distance 2
+  std::vector<int> corners;
+  for (int i = 0; i < 12; ++i)
+    for (int j = i + 1; j < 12; ++j)
+      for (int k = j + 1; k < 12; ++k) {
+        const double dij = arma::norm(vertices.col(i) - vertices.col(j), 2);
+        const double dik = arma::norm(vertices.col(i) - vertices.col(k), 2);
+        const double djk = arma::norm(vertices.col(j) - vertices.col(k), 2);
+        if (std::abs(dij - 2.) > 1e-8 || std::abs(dik - 2.) > 1e-8 ||
+            std::abs(djk - 2.) > 1e-8)
+          continue;
+        const arma::Col<double> normal =
+            arma::cross(vertices.col(j) - vertices.col(i),
+                        vertices.col(k) - vertices.col(i));
+        const bool outwards = arma::dot(normal, vertices.col(i)) > 0.;
+        corners.push_back(i);
+        corners.push_back(outwards ? j : k);
+        corners.push_back(outwards ? k : j);
+      }
+  elementCorners = arma::Mat<int>(corners.data(), 3, corners.size() / 3);
+
+  vertices /= std::sqrt(1. + phi * phi);
+}
+
+// Length of the longest element edge after scaling the coordinates by
+// the components of scale
+double maxEdgeLength(const arma::Mat<double> &vertices,
+                     const arma::Mat<int> &elementCorners,
+                     const arma::Col<double> &scale) {
+  return tbb::parallel_reduce(
+      tbb::blocked_range<size_t>(0, elementCorners.n_cols), 0.,
+      [&](const tbb::blocked_range<size_t> &r, double result) {
+        for (size_t e = r.begin(); e != r.end(); ++e)
+          for (int i = 0; i < 3; ++i) {
+            const int a = elementCorners(i, e);
+            const int b = elementCorners((i + 1) % 3, e);
+            double length2 = 0.;
+            for (int d = 0; d < 3; ++d) {
+              const double delta =
+                  scale(d) * (vertices(d, a) - vertices(d, b));
+              length2 += delta * delta;
+            }
+            result = std::max(result, length2);
+          }
+        return result;
+      },
+      [](double a, double b) { return std::max(a, b); });
+}
+
+// Triangulate the unit sphere finely enough for the edges to be no longer
+// than h once stretched by radii, then stretch and shift it
+void stretchedSphere(const char *function, const arma::Col<double> &radii,
+                     const arma::Col<double> &origin, double h,
+                     arma::Mat<double> &vertices,
+                     arma::Mat<int> &elementCorners) {
+  checkOrigin(function, origin);
+  if (radii.n_rows != 3 || radii.min() <= 0.)
+    throw std::invalid_argument(std::string(function) +
+                                "(): the radii must be positive");
+  if (!(h > 0.))
+    throw std::invalid_argument(std::string(function) +
+                                "(): 'h' must be positive");
+
+  createIcosahedron(vertices, elementCorners);
+  const std::vector<int> noDomainIndices;
+  while (std::sqrt(maxEdgeLength(vertices, elementCorners, radii)) > h) {
+    if (elementCorners.n_cols > size_t(std::numeric_limits<int>::max() / 4))
+      throw std::invalid_argument(std::string(function) +
+                                  "(): 'h' is too small");
+    arma::Mat<double> newVertices;
+    arma::Mat<int> newElementCorners;
+    std::vector<int> newDomainIndices;
+    std::vector<int> fatherIndices;
+    refineTriangularGrid(GridRefinement::UNIFORM, vertices, elementCorners,
+                         noDomainIndices, newVertices, newElementCorners,
+                         newDomainIndices, fatherIndices);
+    // Only the new edge midpoints lie inside the sphere
+    tbb::parallel_for(tbb::blocked_range<size_t>(vertices.n_cols,
+                                                 newVertices.n_cols),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      for (size_t v = r.begin(); v != r.end(); ++v)
+        newVertices.col(v) /= arma::norm(newVertices.col(v), 2);
+    });
+    vertices.swap(newVertices);
+    elementCorners.swap(newElementCorners);
+  }
+
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.n_cols),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t v = r.begin(); v != r.end(); ++v)
+      for (int d = 0; d < 3; ++d)
+        vertices(d, v) = origin(d) + radii(d) * vertices(d, v);
+  });
+}
+
+// Numbering of the lattice points on the surface of the cube [0, n]^3:
+// the bottom layer k = 0, the rings of 4n points of the layers 0 < k < n
+// and the top layer k = n
+class CubeSurfaceLattice {
+public:
+  explicit CubeSurfaceLattice(int n) : m_n(n) {}
+
+  int pointCount() const { return 2 * layerSize() + (m_n - 1) * 4 * m_n; }
+
+  int index(int i, int j, int k) const {
+    if (k == 0)
+      return i + (m_n + 1) * j;
+    if (k == m_n)
+      return layerSize() + (m_n - 1) * 4 * m_n + i + (m_n + 1) * j;
+    return layerSize() + (k - 1) * 4 * m_n + ringPosition(i, j);
+  }
+
+private:
+  int layerSize() const { return (m_n + 1) * (m_n + 1); }
+
+  // Position counterclockwise along the boundary of the square [0, n]^2,
+  // starting at the origin
+  int ringPosition(int i, int j) const {
+    if (j == 0 && i < m_n)
+      return i;
+    if (i == m_n && j < m_n)
+      return m_n + j;
+    if (j == m_n && i > 0)
+      return 2 * m_n + (m_n - i);
+    return 3 * m_n + (m_n - j);
+  }
+
+  int m_n;
+};
+
+} // namespace
+
+void sphereConnectivityArrays(double radius, const arma::Col<double> &origin,
+                              double h, arma::Mat<double> &vertices,
+                              arma::Mat<int> &elementCorners) {
+  arma::Col<double> radii(3);
+  radii.fill(radius);
+  stretchedSphere("sphereConnectivityArrays", radii, origin, h, vertices,
+                  elementCorners);
+}
+
+void ellipsoidConnectivityArrays(const arma::Col<double> &radii,
+                                 const arma::Col<double> &origin, double h,
+                                 arma::Mat<double> &vertices,
+                                 arma::Mat<int> &elementCorners) {
+  stretchedSphere("ellipsoidConnectivityArrays", radii, origin, h, vertices,
+                  elementCorners);
+}
+
+void cubeConnectivityArrays(double length, const arma::Col<double> &origin,
+                            double h, arma::Mat<double> &vertices,
+                            arma::Mat<int> &elementCorners) {
+  checkOrigin("cubeConnectivityArrays", origin);
+  if (!(length > 0.) || !(h > 0.))
+    throw std::invalid_argument("cubeConnectivityArrays(): "
+                                "'length' and 'h' must be positive");
+  const double subdivisions = std::max(1., std::ceil(length / h));
+  if (12. * subdivisions * subdivisions > std::numeric_limits<int>::max())
+    throw std::invalid_argument("cubeConnectivityArrays(): "
+                                "'h' is too small");
+  const int n = static_cast<int>(subdivisions);
+  const CubeSurfaceLattice lattice(n);
+
+  vertices.set_size(3, lattice.pointCount());
+  tbb::parallel_for(0, n + 1, [&](int k) {
+    for (int j = 0; j <= n; ++j)
+      for (int i = 0; i <= n; ++i) {
+        if (k != 0 && k != n && i != 0 && i != n && j != 0 && j != n)
+          continue; // interior point
+        const int v = lattice.index(i, j, k);
+        vertices(0, v) = origin(0) + length * i / n;
+        vertices(1, v) = origin(1) + length * j / n;
+        vertices(2, v) = origin(2) + length * k / n;
+      }
+  });
+
+  // Lattice point of the coordinates (u, v) on each face. The face
+  // coordinates are chosen so that the cross product of their directions
+  // points outwards.
+  typedef std::function<int(int, int)> FacePoint;
+  const FacePoint faces[6] = {
+      [&](int u, int v) { return lattice.index(v, u, 0); }, // z = 0
+      [&](int u, int v) { return lattice.index(u, v, n); }, // z = 1
+      [&](int u, int v) { return lattice.index(u, 0, v); }, // y = 0
+      [&](int u, int v) { return lattice.index(v, n, u); }, // y = 1
+      [&](int u, int v) { return lattice.index(0, v, u); }, // x = 0
+      [&](int u, int v) { return lattice.index(n, u, v); }  // x = 1
+  };
+
+  elementCorners.set_size(3, 12 * n * n);
+  tbb::parallel_for(0, 6 * n, [&](int row) {
+    const FacePoint &point = faces[row / n];
+    const int v = row % n;
+    for (int u = 0; u < n; ++u) {
+      const int a = point(u, v);
+      const int b = point(u + 1, v);
+      const int c = point(u + 1, v + 1);
+      const int d = point(u, v + 1);
+      const int e = 2 * (row * n + u);
+      elementCorners(0, e) = a;
+      elementCorners(1, e) = b;
+      elementCorners(2, e) = c;
+      elementCorners(0, e + 1) = a;
+      elementCorners(1, e + 1) = c;
+      elementCorners(2, e + 1) = d;
+    }
+  });
+}
+
+} // namespace Bempp
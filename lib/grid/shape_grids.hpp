@@ -0,0 +1,86 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_shape_grids_hpp
+#define bempp_shape_grids_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+namespace Bempp {
+
+/** \ingroup grid
+    \brief Triangulate a sphere.
+
+    \param[in] radius
+      Radius of the sphere.
+    \param[in] origin
+      Centre of the sphere.
+    \param[in] h
+      Maximum element size.
+    \param[out] vertices, elementCorners
+      Connectivity arrays of the triangulation, as in
+      GridFactory::createGridFromConnectivityArrays().
+
+    An icosahedron is refined uniformly by refineTriangularGrid() and its
+    vertices are projected onto the sphere after every refinement, until the
+    edges are no longer than \p h. The elements are oriented with normals
+    pointing outwards. All stages run in parallel. */
+void sphereConnectivityArrays(double radius, const arma::Col<double> &origin,
+                              double h, arma::Mat<double> &vertices,
+                              arma::Mat<int> &elementCorners);
+
+/** \ingroup grid
+    \brief Triangulate an ellipsoid.
+
+    The triangulation of the unit sphere made by sphereConnectivityArrays()
+    is stretched by the three semi-axes \p radii along the coordinate axes
+    and shifted to \p origin. It is refined until the longest edges after
+    stretching are no longer than \p h. */
+void ellipsoidConnectivityArrays(const arma::Col<double> &radii,
+                                 const arma::Col<double> &origin, double h,
+                                 arma::Mat<double> &vertices,
+                                 arma::Mat<int> &elementCorners);
+
+/** \ingroup grid
+    \brief Triangulate the surface of a cube.
+
+    \param[in] length
+      Edge length of the cube.
+    \param[in] origin
+      Corner of the cube with the smallest coordinates; the cube is aligned
+      with the coordinate axes.
+    \param[in] h
+      Maximum length of the element edges parallel to the cube edges.
+    \param[out] vertices, elementCorners
+      Connectivity arrays of the triangulation, as in
+      GridFactory::createGridFromConnectivityArrays().
+
+    Every face is divided into a structured grid of squares, each split
+    into two triangles. The elements are oriented with normals pointing
+    outwards. The arrays are filled in parallel. */
+void cubeConnectivityArrays(double length, const arma::Col<double> &origin,
+                            double h, arma::Mat<double> &vertices,
+                            arma::Mat<int> &elementCorners);
+
+} // namespace Bempp
+
+#endif
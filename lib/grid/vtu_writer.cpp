@@ -0,0 +1,516 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "vtu_writer.hpp"
+#include "grid_view.hpp"
+
+#include "bempp/common/config_zlib.hpp"
+
+#include <armadillo>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace Bempp {
+
+namespace {
+
+// VTK cell types
+const unsigned char VTK_LINE = 3;
+const unsigned char VTK_TRIANGLE = 5;
+const unsigned char VTK_QUAD = 9;
+
+// Size in bytes of the blocks into which arrays are split for compression.
+// It is a multiple of the sizes of all scalar types, so that blocks never
+// split a value.
+const size_t blockSize = 32768;
+
+typedef unsigned long long HeaderType; // UInt64
+
+const char *byteOrder() {
+  const unsigned int one = 1;
+  return *reinterpret_cast<const unsigned char *>(&one) ? "LittleEndian"
+                                                        : "BigEndian";
+}
+
+inline float partOf(float value, int) { return value; }
+inline double partOf(double value, int) { return value; }
+template <typename T> inline T partOf(const std::complex<T> &value, int part) {
+  switch (part) {
+  case 1:
+    return value.real();
+  case 2:
+    return value.imag();
+  default:
+    return std::abs(value);
+  }
+}
+
+// Copy values first, ..., first + count - 1 of a field restricted to a piece
+// into out. The entities of the piece are entityOffset, entityOffset + 1, ...
+// or, if entities is not null, entities[0], entities[1], ...
+template <typename Source, typename Target>
+void gatherValues(const Source *data, size_t componentCount, int part,
+                  const int *entities, size_t entityOffset, size_t first,
+                  size_t count, Target *out) {
+  for (size_t k = 0; k < count; ++k) {
+    const size_t local = (first + k) / componentCount;
+    const size_t component = (first + k) % componentCount;
+    const size_t entity = entities ? entities[local] : entityOffset + local;
+    out[k] = partOf(data[entity * componentCount + component], part);
+  }
+}
+
+void compressBlock(const char *data, size_t size, std::string &result) {
+#ifdef WITH_ZLIB
+  uLongf compressedSize = compressBound(size);
+  result.resize(compressedSize);
+  if (compress2(reinterpret_cast<Bytef *>(&result[0]), &compressedSize,
+                reinterpret_cast<const Bytef *>(data), size,
+                Z_DEFAULT_COMPRESSION) != Z_OK)
+    throw std::runtime_error("VtuWriter::write(): Compression failed");
+  result.resize(compressedSize);
+#else
+  throw std::runtime_error("VtuWriter::write(): BEM++ was compiled without "
+                           "zlib support (see the WITH_ZLIB option)");
+#endif
+}
+
+template <typename T> void appendValue(std::string &s, T value) {
+  s.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+} // namespace
+
+// Data array of a piece. Values are produced on demand by fill(first, count,
+// out), so that fields are never copied as a whole.
+struct VtuWriter::Array {
+  std::string type;
+  std::string name;
+  size_t componentCount;
+  size_t valueSize;
+  size_t valueCount;
+  std::function<void(size_t, size_t, char *)> fill;
+
+  size_t byteCount() const { return valueCount * valueSize; }
+
+  // Append the array, preceded by its header, to result
+  void encode(VtuWriter::Encoding encoding, std::string &result) const {
+    const size_t bytes = byteCount();
+    if (encoding == VtuWriter::APPENDED_RAW) {
+      appendValue<HeaderType>(result, bytes);
+      const size_t begin = result.size();
+      result.resize(begin + bytes);
+      for (size_t offset = 0; offset < bytes; offset += blockSize)
+        fill(offset / valueSize,
+             std::min(blockSize, bytes - offset) / valueSize,
+             &result[begin + offset]);
+      return;
+    }
+
+    const size_t blockCount = (bytes + blockSize - 1) / blockSize;
+    std::vector<std::string> blocks(blockCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, blockCount),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      std::vector<char> buffer(blockSize);
+      for (size_t b = r.begin(); b != r.end(); ++b) {
+        const size_t size = std::min(blockSize, bytes - b * blockSize);
+        fill(b * blockSize / valueSize, size / valueSize, &buffer[0]);
+        compressBlock(&buffer[0], size, blocks[b]);
+      }
+    });
+    appendValue<HeaderType>(result, blockCount);
+    appendValue<HeaderType>(result, blockSize);
+    appendValue<HeaderType>(result, bytes % blockSize);
+    for (size_t b = 0; b < blockCount; ++b)
+      appendValue<HeaderType>(result, blocks[b].size());
+    for (size_t b = 0; b < blockCount; ++b)
+      result += blocks[b];
+  }
+
+  void writeXml(std::ostream &out, size_t offset) const {
+    out << "<DataArray type=\"" << type << "\"";
+    if (!name.empty())
+      out << " Name=\"" << name << "\"";
+    out << " NumberOfComponents=\"" << componentCount
+        << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+  }
+};
+
+VtuWriter::VtuWriter(const GridView &view) {
+  arma::Mat<double> vertices;
+  arma::Mat<int> corners;
+  arma::Mat<char> auxData;
+  view.getRawElementData(vertices, corners, auxData);
+
+  m_vertexCount = vertices.n_cols;
+  m_vertices.assign(3 * m_vertexCount, 0.);
+  for (size_t v = 0; v < m_vertexCount; ++v)
+    for (size_t dim = 0; dim < std::min<size_t>(vertices.n_rows, 3); ++dim)
+      m_vertices[3 * v + dim] = vertices(dim, v);
+
+  const size_t cellCount = corners.n_cols;
+  m_cellOffsets.resize(cellCount + 1);
+  m_cellTypes.resize(cellCount);
+  m_connectivity.reserve(corners.n_elem);
+  m_cellOffsets[0] = 0;
+  for (size_t e = 0; e < cellCount; ++e) {
+    size_t cornerCount = 0;
+    while (cornerCount < corners.n_rows && corners(cornerCount, e) >= 0)
+      ++cornerCount;
+    switch (cornerCount) {
+    case 2:
+      m_cellTypes[e] = VTK_LINE;
+      m_connectivity.push_back(corners(0, e));
+      m_connectivity.push_back(corners(1, e));
+      break;
+    case 3:
+      m_cellTypes[e] = VTK_TRIANGLE;
+      for (int i = 0; i < 3; ++i)
+        m_connectivity.push_back(corners(i, e));
+      break;
+    case 4:
+      // Dune numbers the corners of quadrilaterals lexicographically
+      m_cellTypes[e] = VTK_QUAD;
+      m_connectivity.push_back(corners(0, e));
+      m_connectivity.push_back(corners(1, e));
+      m_connectivity.push_back(corners(3, e));
+      m_connectivity.push_back(corners(2, e));
+      break;
+    default:
+      throw std::runtime_error("VtuWriter::VtuWriter(): Unsupported element "
+                               "type");
+    }
+    m_cellOffsets[e + 1] = m_connectivity.size();
+  }
+}
+
+void VtuWriter::addCellData(const arma::Mat<float> &data,
+                            const std::string &name) {
+  addField(data.memptr(), FLOAT32, data.n_rows, data.n_cols, name, false);
+}
+
+void VtuWriter::addCellData(const arma::Mat<double> &data,
+                            const std::string &name) {
+  addField(data.memptr(), FLOAT64, data.n_rows, data.n_cols, name, false);
+}
+
+void VtuWriter::addCellData(const arma::Mat<std::complex<float>> &data,
+                            const std::string &name) {
+  addField(data.memptr(), COMPLEX64, data.n_rows, data.n_cols, name, false);
+}
+
+void VtuWriter::addCellData(const arma::Mat<std::complex<double>> &data,
+                            const std::string &name) {
+  addField(data.memptr(), COMPLEX128, data.n_rows, data.n_cols, name, false);
+}
+
+void VtuWriter::addVertexData(const arma::Mat<float> &data,
+                              const std::string &name) {
+  addField(data.memptr(), FLOAT32, data.n_rows, data.n_cols, name, true);
+}
+
+void VtuWriter::addVertexData(const arma::Mat<double> &data,
+                              const std::string &name) {
+  addField(data.memptr(), FLOAT64, data.n_rows, data.n_cols, name, true);
+}
+
+void VtuWriter::addVertexData(const arma::Mat<std::complex<float>> &data,
+                              const std::string &name) {
+  addField(data.memptr(), COMPLEX64, data.n_rows, data.n_cols, name, true);
+}
+
+void VtuWriter::addVertexData(const arma::Mat<std::complex<double>> &data,
+                              const std::string &name) {
+  addField(data.memptr(), COMPLEX128, data.n_rows, data.n_cols, name, true);
+}
+
+void VtuWriter::addField(const void *data, ScalarType scalarType,
+                         size_t rowCount, size_t columnCount,
+                         const std::string &name, bool onVertices) {
+  const size_t entityCount =
+      onVertices ? m_vertexCount : m_cellTypes.size();
+  if (columnCount != entityCount)
+    throw std::invalid_argument(
+        std::string("VtuWriter::") +
+        (onVertices ? "addVertexData()" : "addCellData()") +
+        ": number of columns of 'data' does not match the number of " +
+        (onVertices ? "vertices" : "cells"));
+  if (rowCount == 0)
+    throw std::invalid_argument("VtuWriter::addField(): 'data' is empty");
+
+  Field field;
+  field.data = data;
+  field.scalarType = scalarType;
+  field.componentCount = rowCount;
+  field.onVertices = onVertices;
+  if (scalarType == FLOAT32 || scalarType == FLOAT64) {
+    field.name = name;
+    field.part = VALUE;
+    m_fields.push_back(field);
+  } else {
+    const Part parts[] = {REAL_PART, IMAG_PART, ABSOLUTE_VALUE};
+    const char *suffixes[] = {".r", ".i", ".abs"};
+    for (int i = 0; i < 3; ++i) {
+      field.name = name + suffixes[i];
+      field.part = parts[i];
+      m_fields.push_back(field);
+    }
+  }
+}
+
+void VtuWriter::clear() { m_fields.clear(); }
+
+std::string VtuWriter::write(const std::string &name, Encoding encoding,
+                             int pieceCount, const std::string &path) const {
+  if (pieceCount < 1)
+    throw std::invalid_argument("VtuWriter::write(): pieceCount must be "
+                                "positive");
+#ifndef WITH_ZLIB
+  if (encoding == APPENDED_ZLIB)
+    throw std::runtime_error("VtuWriter::write(): BEM++ was compiled without "
+                             "zlib support (see the WITH_ZLIB option)");
+#endif
+  const std::string prefix = path.empty() ? std::string() : path + "/";
+  const size_t cellCount = m_cellTypes.size();
+
+  if (pieceCount == 1) {
+    const std::string fileName = prefix + name + ".vtu";
+    writePiece(fileName, 0, cellCount, true, encoding);
+    return fileName;
+  }
+
+  std::vector<std::string> pieceFileNames(pieceCount);
+  for (int p = 0; p < pieceCount; ++p) {
+    char pieceName[32];
+    std::sprintf(pieceName, "s%04d-p%04d-", pieceCount, p);
+    pieceFileNames[p] = pieceName + name + ".vtu";
+  }
+  tbb::parallel_for(tbb::blocked_range<int>(0, pieceCount),
+                    [&](const tbb::blocked_range<int> &r) {
+    for (int p = r.begin(); p != r.end(); ++p)
+      writePiece(prefix + pieceFileNames[p], cellCount * p / pieceCount,
+                 cellCount * (p + 1) / pieceCount, false, encoding);
+  });
+  const std::string fileName = prefix + name + ".pvtu";
+  writeCollection(fileName, pieceFileNames);
+  return fileName;
+}
+
+void VtuWriter::writePiece(const std::string &fileName, size_t firstCell,
+                           size_t endCell, bool allVertices,
+                           Encoding encoding) const {
+  // Vertices of the piece and its connectivity in their local numbering
+  std::vector<int> vertices;
+  std::vector<int> connectivity(m_connectivity.begin() +
+                                    m_cellOffsets[firstCell],
+                                m_connectivity.begin() + m_cellOffsets[endCell]);
+  if (!allVertices) {
+    vertices = connectivity;
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()),
+                   vertices.end());
+    for (size_t i = 0; i < connectivity.size(); ++i)
+      connectivity[i] =
+          std::lower_bound(vertices.begin(), vertices.end(), connectivity[i]) -
+          vertices.begin();
+  }
+  const int *vertexList = allVertices ? 0 : vertices.data();
+  const size_t vertexCount = allVertices ? m_vertexCount : vertices.size();
+  const size_t cellCount = endCell - firstCell;
+
+  std::vector<Array> pointData, cellData, points, cells;
+  for (size_t f = 0; f < m_fields.size(); ++f) {
+    const Field &field = m_fields[f];
+    Array array;
+    array.name = field.name;
+    array.componentCount = field.componentCount;
+    array.valueCount = field.componentCount *
+                       (field.onVertices ? vertexCount : cellCount);
+    const size_t components = field.componentCount;
+    const int part = field.part;
+    const int *entities = field.onVertices ? vertexList : 0;
+    const size_t entityOffset = field.onVertices ? 0 : firstCell;
+    const void *data = field.data;
+    switch (field.scalarType) {
+    case FLOAT32:
+    case COMPLEX64:
+      array.type = "Float32";
+      array.valueSize = sizeof(float);
+      break;
+    default:
+      array.type = "Float64";
+      array.valueSize = sizeof(double);
+    }
+    switch (field.scalarType) {
+    case FLOAT32:
+      array.fill = [=](size_t first, size_t count, char *out) {
+        gatherValues(static_cast<const float *>(data), components, part,
+                     entities, entityOffset, first, count,
+                     reinterpret_cast<float *>(out));
+      };
+      break;
+    case FLOAT64:
+      array.fill = [=](size_t first, size_t count, char *out) {
+        gatherValues(static_cast<const double *>(data), components, part,
+                     entities, entityOffset, first, count,
+                     reinterpret_cast<double *>(out));
+      };
+      break;
+    case COMPLEX64:
+      array.fill = [=](size_t first, size_t count, char *out) {
+        gatherValues(static_cast<const std::complex<float> *>(data),
+                     components, part, entities, entityOffset, first, count,
+                     reinterpret_cast<float *>(out));
+      };
+      break;
+    case COMPLEX128:
+      array.fill = [=](size_t first, size_t count, char *out) {
+        gatherValues(static_cast<const std::complex<double> *>(data),
+                     components, part, entities, entityOffset, first, count,
+                     reinterpret_cast<double *>(out));
+      };
+      break;
+    }
+    (field.onVertices ? pointData : cellData).push_back(array);
+  }
+
+  Array array;
+  array.type = "Float64";
+  array.componentCount = 3;
+  array.valueSize = sizeof(double);
+  array.valueCount = 3 * vertexCount;
+  const double *coordinates = &m_vertices[0];
+  array.fill = [=](size_t first, size_t count, char *out) {
+    gatherValues(coordinates, 3, VALUE, vertexList, 0, first, count,
+                 reinterpret_cast<double *>(out));
+  };
+  points.push_back(array);
+
+  array.type = "Int32";
+  array.name = "connectivity";
+  array.componentCount = 1;
+  array.valueSize = sizeof(int);
+  array.valueCount = connectivity.size();
+  const int *connectivityData = connectivity.empty() ? 0 : &connectivity[0];
+  array.fill = [=](size_t first, size_t count, char *out) {
+    std::memcpy(out, connectivityData + first, count * sizeof(int));
+  };
+  cells.push_back(array);
+
+  array.name = "offsets";
+  array.valueCount = cellCount;
+  const size_t *offsets = &m_cellOffsets[firstCell];
+  array.fill = [=](size_t first, size_t count, char *out) {
+    int *values = reinterpret_cast<int *>(out);
+    for (size_t i = 0; i < count; ++i)
+      values[i] = offsets[first + i + 1] - offsets[0];
+  };
+  cells.push_back(array);
+
+  array.type = "UInt8";
+  array.name = "types";
+  array.valueSize = 1;
+  const unsigned char *types = cellCount ? &m_cellTypes[firstCell] : 0;
+  array.fill = [=](size_t first, size_t count, char *out) {
+    std::memcpy(out, types + first, count);
+  };
+  cells.push_back(array);
+
+  // Encode all arrays first, since the header stores their offsets
+  std::string appended;
+  std::ostringstream xml;
+  xml << "<?xml version=\"1.0\"?>\n"
+      << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+      << byteOrder() << "\" header_type=\"UInt64\"";
+  if (encoding == APPENDED_ZLIB)
+    xml << " compressor=\"vtkZLibDataCompressor\"";
+  xml << ">\n<UnstructuredGrid>\n<Piece NumberOfPoints=\"" << vertexCount
+      << "\" NumberOfCells=\"" << cellCount << "\">\n";
+  const std::vector<Array> *groups[] = {&pointData, &cellData, &points,
+                                        &cells};
+  const char *groupNames[] = {"PointData", "CellData", "Points", "Cells"};
+  for (int g = 0; g < 4; ++g) {
+    xml << "<" << groupNames[g] << ">\n";
+    for (size_t a = 0; a < groups[g]->size(); ++a) {
+      (*groups[g])[a].writeXml(xml, appended.size());
+      (*groups[g])[a].encode(encoding, appended);
+    }
+    xml << "</" << groupNames[g] << ">\n";
+  }
+  xml << "</Piece>\n</UnstructuredGrid>\n<AppendedData encoding=\"raw\">\n_";
+
+  std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("VtuWriter::write(): File " + fileName +
+                             " could not be opened");
+  const std::string header = xml.str();
+  out.write(header.data(), header.size());
+  out.write(appended.data(), appended.size());
+  out << "\n</AppendedData>\n</VTKFile>\n";
+  if (!out)
+    throw std::runtime_error("VtuWriter::write(): Error writing file " +
+                             fileName);
+}
+
+void VtuWriter::writeCollection(
+    const std::string &fileName,
+    const std::vector<std::string> &pieceFileNames) const {
+  std::ofstream out(fileName.c_str(), std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("VtuWriter::write(): File " + fileName +
+                             " could not be opened");
+  out << "<?xml version=\"1.0\"?>\n"
+      << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\""
+      << byteOrder() << "\" header_type=\"UInt64\">\n"
+      << "<PUnstructuredGrid GhostLevel=\"0\">\n";
+  for (int onVertices = 1; onVertices >= 0; --onVertices) {
+    out << (onVertices ? "<PPointData>\n" : "<PCellData>\n");
+    for (size_t f = 0; f < m_fields.size(); ++f) {
+      const Field &field = m_fields[f];
+      if (field.onVertices != bool(onVertices))
+        continue;
+      out << "<PDataArray type=\""
+          << ((field.scalarType == FLOAT32 || field.scalarType == COMPLEX64)
+                  ? "Float32"
+                  : "Float64") << "\" Name=\"" << field.name
+          << "\" NumberOfComponents=\"" << field.componentCount << "\"/>\n";
+    }
+    out << (onVertices ? "</PPointData>\n" : "</PCellData>\n");
+  }
+  out << "<PPoints>\n"
+      << "<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n"
+      << "</PPoints>\n";
+  for (size_t p = 0; p < pieceFileNames.size(); ++p)
+    out << "<Piece Source=\"" << pieceFileNames[p] << "\"/>\n";
+  out << "</PUnstructuredGrid>\n</VTKFile>\n";
+}
+
+} // namespace Bempp
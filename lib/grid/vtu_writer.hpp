@@ -0,0 +1,157 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_vtu_writer_hpp
+#define bempp_vtu_writer_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <complex>
+#include <string>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class GridView;
+/** \endcond */
+
+/** \ingroup grid
+ *  \brief Writer of VTK unstructured grid files with appended binary data.
+ *
+ *  Unlike VtkWriter, which wraps the Dune VTK writer, this class writes the
+ *  geometry of a grid view together with any number of fields in a single
+ *  pass. All arrays are appended to the XML header as raw or zlib-compressed
+ *  binary data. The grid can be split into several pieces, which are written
+ *  in parallel and collected in a .pvtu file.
+ *
+ *  Fields are not copied: the matrices passed to addCellData() and
+ *  addVertexData() must stay alive until write() has returned. Complex fields
+ *  are written as three real arrays with the suffixes ".r", ".i" and ".abs",
+ *  like in exportToVtk().
+ */
+class VtuWriter {
+public:
+  /** \brief How data arrays are stored in a VTU file */
+  enum Encoding {
+    //! Appended raw binary data.
+    APPENDED_RAW,
+    //! Appended zlib-compressed binary data (requires the WITH_ZLIB option).
+    APPENDED_ZLIB
+  };
+
+  /** \brief Construct a writer for the grid view \p view. */
+  explicit VtuWriter(const GridView &view);
+
+  /** \brief Add a field living on the cells of the grid view.
+   *
+   *  \param data Matrix whose (\e m, \e n)th entry contains the value of the
+   *    <em>m</em>th component of the field in the <em>n</em>th cell.
+   *  \param name Name to identify the field. */
+  void addCellData(const arma::Mat<float> &data, const std::string &name);
+  /** \overload */
+  void addCellData(const arma::Mat<double> &data, const std::string &name);
+  /** \overload */
+  void addCellData(const arma::Mat<std::complex<float>> &data,
+                   const std::string &name);
+  /** \overload */
+  void addCellData(const arma::Mat<std::complex<double>> &data,
+                   const std::string &name);
+
+  /** \brief Add a field living on the vertices of the grid view.
+   *
+   *  \param data Matrix whose (\e m, \e n)th entry contains the value of the
+   *    <em>m</em>th component of the field at the <em>n</em>th vertex.
+   *  \param name Name to identify the field. */
+  void addVertexData(const arma::Mat<float> &data, const std::string &name);
+  /** \overload */
+  void addVertexData(const arma::Mat<double> &data, const std::string &name);
+  /** \overload */
+  void addVertexData(const arma::Mat<std::complex<float>> &data,
+                     const std::string &name);
+  /** \overload */
+  void addVertexData(const arma::Mat<std::complex<double>> &data,
+                     const std::string &name);
+
+  /** \brief Clear the list of registered fields. */
+  void clear();
+
+  /** \brief Write the grid view and the registered fields.
+   *
+   *  \param name Base name of the output files. It should not contain any
+   *    directory part or filename extensions.
+   *  \param encoding How the data arrays are stored.
+   *  \param pieceCount Number of pieces the cells are split into. If it is
+   *    larger than 1, the pieces are written in parallel to the files
+   *    s####-p####-name.vtu, named as by Dune::VTKWriter, and collected in
+   *    name.pvtu.
+   *  \param path Output directory. If empty, the files are written to the
+   *    current directory.
+   *
+   *  \returns Name of the created .vtu or .pvtu file. */
+  std::string write(const std::string &name,
+                    Encoding encoding = APPENDED_RAW, int pieceCount = 1,
+                    const std::string &path = std::string()) const;
+
+private:
+  enum ScalarType {
+    FLOAT32,
+    FLOAT64,
+    COMPLEX64,
+    COMPLEX128
+  };
+
+  enum Part {
+    VALUE,
+    REAL_PART,
+    IMAG_PART,
+    ABSOLUTE_VALUE
+  };
+
+  struct Field {
+    std::string name;
+    const void *data;
+    ScalarType scalarType;
+    Part part;
+    size_t componentCount;
+    bool onVertices;
+  };
+
+  void addField(const void *data, ScalarType scalarType, size_t rowCount,
+                size_t columnCount, const std::string &name, bool onVertices);
+
+  struct Array;
+  void writePiece(const std::string &fileName, size_t firstCell,
+                  size_t endCell, bool allVertices, Encoding encoding) const;
+  void writeCollection(const std::string &fileName,
+                       const std::vector<std::string> &pieceFileNames) const;
+
+  size_t m_vertexCount;
+  std::vector<double> m_vertices; // 3 coordinates per vertex
+  std::vector<int> m_connectivity;
+  std::vector<size_t> m_cellOffsets; // cell i's corners start at m_cellOffsets[i]
+  std::vector<unsigned char> m_cellTypes;
+  std::vector<Field> m_fields;
+};
+
+} // namespace Bempp
+
+#endif
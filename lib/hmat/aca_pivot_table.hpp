@@ -0,0 +1,55 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_ACA_PIVOT_TABLE_HPP
+#define HMAT_ACA_PIVOT_TABLE_HPP
+
+#include "common.hpp"
+
+#include <vector>
+
+namespace hmat {
+
+/** \brief Pivots chosen by the ACA for the admissible leaves of a block
+ *  cluster tree.
+ *
+ *  The pivot rows and columns of a leaf are stored relative to the block,
+ *  in the order of the crosses; their number is the rank found by the ACA.
+ *  The slots are indexed by BlockClusterTreeNode::index(). Different slots
+ *  may be written concurrently, as every leaf is compressed by one task.
+ *
+ *  A table recorded by HMatrixAcaCompressor can seed the compression of
+ *  another matrix on the same tree with similar entries, e.g. at a nearby
+ *  wave number (see HMatrixAcaCompressor::setWarmStart()). */
+class AcaPivotTable {
+public:
+  explicit AcaPivotTable(std::size_t numberOfNodes);
+
+  std::size_t numberOfNodes() const;
+
+  /** \brief Return true if pivots are stored for node \p nodeIndex. */
+  bool hasPivots(std::size_t nodeIndex) const;
+
+  /** \brief Pivot rows of node \p nodeIndex; empty if none are stored. */
+  const IndexSetType &pivotRows(std::size_t nodeIndex) const;
+
+  /** \brief Pivot columns of node \p nodeIndex; empty if none are
+   *  stored. */
+  const IndexSetType &pivotColumns(std::size_t nodeIndex) const;
+
+  void setPivots(std::size_t nodeIndex, const IndexSetType &rows,
+                 const IndexSetType &columns);
+
+private:
+  struct Slot {
+    Slot() : set(false) {}
+    bool set;
+    IndexSetType rows;
+    IndexSetType columns;
+  };
+  std::vector<Slot> m_slots;
+};
+}
+
+#include "aca_pivot_table_impl.hpp"
+
+#endif
@@ -0,0 +1,41 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_ACA_PIVOT_TABLE_IMPL_HPP
+#define HMAT_ACA_PIVOT_TABLE_IMPL_HPP
+
+#include "aca_pivot_table.hpp"
+
+namespace hmat {
+
+inline AcaPivotTable::AcaPivotTable(std::size_t numberOfNodes)
+    : m_slots(numberOfNodes) {}
+
+inline std::size_t AcaPivotTable::numberOfNodes() const {
+  return m_slots.size();
+}
+
+inline bool AcaPivotTable::hasPivots(std::size_t nodeIndex) const {
+  return m_slots[nodeIndex].set;
+}
+
+inline const IndexSetType &
+AcaPivotTable::pivotRows(std::size_t nodeIndex) const {
+  return m_slots[nodeIndex].rows;
+}
+
+inline const IndexSetType &
+AcaPivotTable::pivotColumns(std::size_t nodeIndex) const {
+  return m_slots[nodeIndex].columns;
+}
+
+inline void AcaPivotTable::setPivots(std::size_t nodeIndex,
+                                     const IndexSetType &rows,
+                                     const IndexSetType &columns) {
+  Slot &slot = m_slots[nodeIndex];
+  slot.rows = rows;
+  slot.columns = columns;
+  slot.set = true;
+}
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "bounding_box.hpp"
 #include "geometry.hpp"
 #include "cluster_tree.hpp"
+#include "tree_index.hpp"
 
 namespace hmat {
 
@@ -40,6 +41,11 @@ public:
                    int maxBlockSize,
                    const AdmissibilityFunction &admissibilityFunction);
 
+  /** \brief Wrap an existing block tree built on the given cluster trees. */
+  BlockClusterTree(const shared_ptr<const ClusterTree<N>> &rowClusterTree,
+                   const shared_ptr<const ClusterTree<N>> &columnClusterTree,
+                   const shared_ptr<BlockClusterTreeNode<N>> &root);
+
 //  void writeToPdfFile(const std::string &fname, double widthInPoints,
 //                      double heightInPoints) const;
 
@@ -55,6 +61,9 @@ public:
   std::vector<shared_ptr<const BlockClusterTreeNode<N>>> leafNodes() const;
   std::vector<shared_ptr<BlockClusterTreeNode<N>>> leafNodes();
 
+  /** \brief Index-linked structure of the tree; see TreeIndex. */
+  const TreeIndex<BlockClusterTreeNodeData<N>, N * N> &treeIndex() const;
+
 private:
   void initializeBlockClusterTree(
       const AdmissibilityFunction &admissibilityFunction, int maxBlockSize);
@@ -63,6 +72,7 @@ private:
   shared_ptr<const ClusterTree<N>> m_columnClusterTree;
 
   shared_ptr<BlockClusterTreeNode<N>> m_root;
+  shared_ptr<const TreeIndex<BlockClusterTreeNodeData<N>, N * N>> m_treeIndex;
 };
 
 template <int N>
@@ -81,11 +91,62 @@ private:
   double m_eta;
 };
 
+/** \brief Weak (HODLR) admissibility condition.
+ *
+ *  A block is refused only if each bounding box contains the centre of
+ *  the other one, i.e. if row and column cluster describe essentially the
+ *  same part of the geometry. All off-diagonal blocks of a tree built on
+ *  the same cluster tree for rows and columns are therefore admissible, so
+ *  that the resulting H-matrix is hierarchically off-diagonal low-rank.
+ *  Such matrices can be factorised by HodlrDecomposition. */
 class WeakAdmissibility {
 public:
   bool operator()(const BoundingBox &box1, const BoundingBox &box2) const;
 };
 
+/** \brief Admissibility condition for oscillatory kernels.
+ *
+ *  A pair of boxes is admissible if it satisfies StandardAdmissibility and
+ *  additionally \f$\kappa \max(\mathrm{diam}_1, \mathrm{diam}_2)^2 <
+ *  \eta_{hf} \mathrm{dist}\f$. This is the parabolic admissibility of
+ *  directional H-matrices: on such blocks the Helmholtz kernel is the
+ *  product of a plane wave in the direction between the box centers and a
+ *  smooth function, so block ranks are bounded independently of the wave
+ *  number \f$\kappa\f$. The plane wave factors are diagonal unitary
+ *  scalings, which do not change the ranks, so the blocks are compressed by
+ *  ACA without modification. The additional condition only restricts
+ *  blocks whose boxes are large compared to the wavelength. */
+class HighFrequencyAdmissibility {
+public:
+  HighFrequencyAdmissibility(double eta, double waveNumber,
+                             double highFrequencyEta);
+
+  bool operator()(const BoundingBox &box1, const BoundingBox &box2) const;
+
+private:
+  double m_eta;
+  double m_waveNumber;
+  double m_highFrequencyEta;
+};
+
+/** \brief Admissibility condition for far-field operators.
+ *
+ *  The rows of a far-field operator are directions \f$\hat x\f$ and its
+ *  kernel is \f$\exp(-i\kappa \hat x \cdot y)\f$, whose rank on a pair
+ *  of boxes grows with the product of their diameters rather than with
+ *  their distance. A pair of boxes is admissible if \f$\kappa\,
+ *  \mathrm{diam}_1 \mathrm{diam}_2 < \eta\f$. */
+class FarFieldAdmissibility {
+public:
+  FarFieldAdmissibility(double waveNumber, double eta);
+
+  bool operator()(const BoundingBox &box1, const BoundingBox &box2) const;
+
+private:
+  double m_waveNumber;
+  double m_eta;
+};
+
 typedef BlockClusterTree<2> DefaultBlockClusterTreeType;
 
 }
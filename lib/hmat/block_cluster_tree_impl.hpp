@@ -27,6 +27,15 @@ BlockClusterTree<N>::BlockClusterTree(
   initializeBlockClusterTree(admissibilityFunction, maxBlockSize);
 }
 
+template <int N>
+BlockClusterTree<N>::BlockClusterTree(
+    const shared_ptr<const ClusterTree<N>> &rowClusterTree,
+    const shared_ptr<const ClusterTree<N>> &columnClusterTree,
+    const shared_ptr<BlockClusterTreeNode<N>> &root)
+    : m_rowClusterTree(rowClusterTree), m_columnClusterTree(columnClusterTree),
+      m_root(root),
+      m_treeIndex(new TreeIndex<BlockClusterTreeNodeData<N>, N * N>(root)) {}
+
 //template <int N>
 //void BlockClusterTree<N>::writeToPdfFile(const std::string &fname,
 //                                         double widthInPoints,
@@ -112,35 +121,58 @@ BlockClusterTree<N>::columnClusterTree() const {
 template <int N>
 std::vector<shared_ptr<const BlockClusterTreeNode<N>>>
 BlockClusterTree<N>::leafNodes() const {
-  return m_root->leafNodes();
+  const auto &leafNodes = m_treeIndex->leafNodes();
+  return std::vector<shared_ptr<const BlockClusterTreeNode<N>>>(
+      leafNodes.begin(), leafNodes.end());
 }
 
 template <int N>
 std::vector<shared_ptr<BlockClusterTreeNode<N>>>
 BlockClusterTree<N>::leafNodes() {
-  return m_root->leafNodes();
+  return m_treeIndex->leafNodes();
+}
+
+template <int N>
+const TreeIndex<BlockClusterTreeNodeData<N>, N * N> &
+BlockClusterTree<N>::treeIndex() const {
+  return *m_treeIndex;
 }
 
 template <int N>
 void BlockClusterTree<N>::initializeBlockClusterTree(
     const AdmissibilityFunction &admissibilityFunction, int maxBlockSize) {
 
-  std::function<void(const shared_ptr<BlockClusterTreeNode<N>> &)>
-  splittingFunction;
+  typedef TreeIndex<BlockClusterTreeNodeData<N>, N * N> TreeIndexType;
+
+  bool admissible =
+      admissibilityFunction(m_rowClusterTree->root()->data().boundingBox,
+                            m_columnClusterTree->root()->data().boundingBox);
+  m_root = shared_ptr<BlockClusterTreeNode<N>>(
+      new BlockClusterTreeNode<N>(BlockClusterTreeNodeData<N>(
+          m_rowClusterTree->root(), m_columnClusterTree->root(), admissible)));
+
+  // The tree index is filled while the tree is built
+  shared_ptr<TreeIndexType> treeIndex(new TreeIndexType(m_root, false));
+
+  std::function<void(std::size_t)> splittingFunction;
 
-  splittingFunction =
-      [this, &admissibilityFunction, &splittingFunction, &maxBlockSize](
-          const shared_ptr<BlockClusterTreeNode<N>> &node) {
+  splittingFunction = [&admissibilityFunction, &splittingFunction, &treeIndex,
+                       maxBlockSize](std::size_t nodeIndex) {
 
-    auto nodeData = node->data();
+    BlockClusterTreeNode<N> &node = treeIndex->node(nodeIndex);
+    BlockClusterTreeNodeData<N> &nodeData = node.data();
+    const ClusterTreeNode<N> &rowClusterTreeNode =
+        *nodeData.rowClusterTreeNode;
+    const ClusterTreeNode<N> &columnClusterTreeNode =
+        *nodeData.columnClusterTreeNode;
 
     // Adjust admissibility condition to only accept blocks smaller than
     // maxBlockSize
 
-    auto rowClusterTreeNodeIndexRange =
-        nodeData.rowClusterTreeNode->data().indexRange;
-    auto columnClusterTreeNodeIndexRange =
-        nodeData.columnClusterTreeNode->data().indexRange;
+    const auto &rowClusterTreeNodeIndexRange =
+        rowClusterTreeNode.data().indexRange;
+    const auto &columnClusterTreeNodeIndexRange =
+        columnClusterTreeNode.data().indexRange;
     auto rowBlockSize =
         rowClusterTreeNodeIndexRange[1] - rowClusterTreeNodeIndexRange[0];
     auto columnBlockSize =
@@ -154,40 +186,33 @@ void BlockClusterTree<N>::initializeBlockClusterTree(
     if (nodeData.admissible)
       return;
 
-    auto rowClusterData = nodeData.rowClusterTreeNode->data();
-    auto columnClusterData = nodeData.columnClusterTreeNode->data();
-
     // If row or column cluster is leaf do not refine further
 
-    if (nodeData.rowClusterTreeNode->isLeaf() ||
-        nodeData.columnClusterTreeNode->isLeaf())
+    if (rowClusterTreeNode.isLeaf() || columnClusterTreeNode.isLeaf())
       return;
 
-    // Create the block clusters
+    // Create the block clusters from the bounding boxes of the child
+    // clusters
 
     for (int rowCount = 0; rowCount < N; ++rowCount) {
-      auto rowChild = nodeData.rowClusterTreeNode->child(rowCount);
+      auto rowChild = rowClusterTreeNode.child(rowCount);
       for (int columnCount = 0; columnCount < N; ++columnCount) {
-        auto columnChild = nodeData.columnClusterTreeNode->child(columnCount);
-        auto rowBoundingBox = rowClusterData.boundingBox;
-        auto columnBoundingBox = columnClusterData.boundingBox;
-        node->addChild(
-            BlockClusterTreeNodeData<N>(
-                rowChild, columnChild,
-                admissibilityFunction(rowBoundingBox, columnBoundingBox)),
+        auto columnChild = columnClusterTreeNode.child(columnCount);
+        bool admissible = admissibilityFunction(
+            rowChild->data().boundingBox, columnChild->data().boundingBox);
+        node.addChild(
+            BlockClusterTreeNodeData<N>(rowChild, columnChild, admissible),
             N * rowCount + columnCount);
-        splittingFunction(node->child(N * rowCount + columnCount));
       }
     }
+    std::size_t firstChild = treeIndex->addChildren(nodeIndex);
+    for (int i = 0; i < N * N; ++i)
+      splittingFunction(firstChild + i);
   };
 
-  bool admissible =
-      admissibilityFunction(m_rowClusterTree->root()->data().boundingBox,
-                            m_columnClusterTree->root()->data().boundingBox);
-  m_root = shared_ptr<BlockClusterTreeNode<N>>(
-      new BlockClusterTreeNode<N>(BlockClusterTreeNodeData<N>(
-          m_rowClusterTree->root(), m_columnClusterTree->root(), admissible)));
-  splittingFunction(m_root);
+  splittingFunction(0);
+  treeIndex->finish();
+  m_treeIndex = treeIndex;
 }
 
 template <int N>
@@ -219,7 +244,46 @@ inline bool StandardAdmissibility::operator()(const BoundingBox &box1,
 inline bool WeakAdmissibility::operator()(const BoundingBox &box1,
                                           const BoundingBox &box2) const {
 
-  return box1.distance(box2) > 0;
+  const auto &bounds1 = box1.bounds();
+  const auto &bounds2 = box2.bounds();
+  bool centre1InBox2 = true;
+  bool centre2InBox1 = true;
+  for (int i = 0; i < 3; ++i) {
+    double centre1 = .5 * (bounds1[2 * i] + bounds1[2 * i + 1]);
+    double centre2 = .5 * (bounds2[2 * i] + bounds2[2 * i + 1]);
+    if (centre1 < bounds2[2 * i] || centre1 > bounds2[2 * i + 1])
+      centre1InBox2 = false;
+    if (centre2 < bounds1[2 * i] || centre2 > bounds1[2 * i + 1])
+      centre2InBox1 = false;
+  }
+  return !(centre1InBox2 && centre2InBox1);
+}
+
+inline HighFrequencyAdmissibility::HighFrequencyAdmissibility(
+    double eta, double waveNumber, double highFrequencyEta)
+    : m_eta(eta), m_waveNumber(waveNumber),
+      m_highFrequencyEta(highFrequencyEta) {}
+
+inline bool
+HighFrequencyAdmissibility::operator()(const BoundingBox &box1,
+                                       const BoundingBox &box2) const {
+  double diam1 = box1.diameter();
+  double diam2 = box2.diameter();
+  double maxDiam = std::max(diam1, diam2);
+
+  double dist = box1.distance(box2);
+
+  return std::min(diam1, diam2) < m_eta * dist &&
+         m_waveNumber * maxDiam * maxDiam < m_highFrequencyEta * dist;
+}
+
+inline FarFieldAdmissibility::FarFieldAdmissibility(double waveNumber,
+                                                    double eta)
+    : m_waveNumber(waveNumber), m_eta(eta) {}
+
+inline bool FarFieldAdmissibility::operator()(const BoundingBox &box1,
+                                              const BoundingBox &box2) const {
+  return m_waveNumber * box1.diameter() * box2.diameter() < m_eta;
 }
 }
 #endif
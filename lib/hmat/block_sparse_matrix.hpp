@@ -0,0 +1,86 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_BLOCK_SPARSE_MATRIX_HPP
+#define HMAT_BLOCK_SPARSE_MATRIX_HPP
+
+#include "common.hpp"
+#include <armadillo>
+#include <cstddef>
+#include <vector>
+
+namespace hmat {
+
+/** \brief Sparse matrix made of dense blocks of variable size.
+ *
+ *  All blocks are stored column-major in one contiguous array, sorted by
+ *  row and then by column range. The blocks are grouped into row bands,
+ *  i.e. maximal sets of blocks whose row ranges overlap, and into column
+ *  bands in the same way. Different bands write to disjoint parts of the
+ *  result, so apply() processes them in parallel without any per-thread
+ *  result buffers.
+ *
+ *  HMatrix::extractNearField() uses this class to store all inadmissible
+ *  leaves of an H-matrix. The indices refer to the H-matrix DOF ordering. */
+template <typename ValueType> class BlockSparseMatrix {
+public:
+  struct Block {
+    IndexRangeType rowRange;
+    IndexRangeType columnRange;
+    std::size_t offset; // position of the entries in values()
+  };
+
+  /** \brief Constructor.
+   *
+   *  The entries of block \p i, of size given by \p rowRanges[i] and
+   *  \p columnRanges[i], are copied from \p *blocks[i]. The blocks must
+   *  not overlap. */
+  BlockSparseMatrix(std::size_t rows, std::size_t columns,
+                    const std::vector<IndexRangeType> &rowRanges,
+                    const std::vector<IndexRangeType> &columnRanges,
+                    const std::vector<const arma::Mat<ValueType> *> &blocks);
+
+  std::size_t rows() const;
+  std::size_t columns() const;
+
+  std::size_t numberOfBlocks() const;
+  const std::vector<Block> &blocks() const;
+  const std::vector<ValueType> &values() const;
+
+  double memSizeKb() const;
+
+  /** \brief Compute <tt>Y += alpha * op(A) * X</tt>.
+   *
+   *  The rows of \p X and \p Y are in H-matrix DOF ordering. */
+  void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+             TransposeMode trans, ValueType alpha) const;
+
+private:
+  static void computeBands(const std::vector<Block> &blocks,
+                           const std::vector<std::size_t> &order,
+                           bool byColumns, std::vector<std::size_t> &bands);
+
+  template <bool conjugate>
+  void addProduct(const Block &block, const arma::Mat<ValueType> &X,
+                  arma::Mat<ValueType> &Y, ValueType alpha) const;
+  template <bool conjugate>
+  void addTransposedProduct(const Block &block, const arma::Mat<ValueType> &X,
+                            arma::Mat<ValueType> &Y, ValueType alpha) const;
+
+  std::size_t m_rows;
+  std::size_t m_columns;
+  std::vector<Block> m_blocks;
+  std::vector<ValueType> m_values;
+
+  // m_rowBands[b] is the index of the first block of row band b in
+  // m_blocks; the last element is the number of blocks.
+  std::vector<std::size_t> m_rowBands;
+  // Block indices sorted by column range, and the column bands as positions
+  // in this order
+  std::vector<std::size_t> m_columnOrder;
+  std::vector<std::size_t> m_columnBands;
+};
+}
+
+#include "block_sparse_matrix_impl.hpp"
+
+#endif
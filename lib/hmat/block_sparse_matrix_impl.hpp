@@ -0,0 +1,226 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_BLOCK_SPARSE_MATRIX_IMPL_HPP
+#define HMAT_BLOCK_SPARSE_MATRIX_IMPL_HPP
+
+#include "block_sparse_matrix.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <numeric>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+inline float conjugateValue(float x) { return x; }
+inline double conjugateValue(double x) { return x; }
+inline std::complex<float> conjugateValue(const std::complex<float> &x) {
+  return std::conj(x);
+}
+inline std::complex<double> conjugateValue(const std::complex<double> &x) {
+  return std::conj(x);
+}
+
+template <typename ValueType>
+BlockSparseMatrix<ValueType>::BlockSparseMatrix(
+    std::size_t rows, std::size_t columns,
+    const std::vector<IndexRangeType> &rowRanges,
+    const std::vector<IndexRangeType> &columnRanges,
+    const std::vector<const arma::Mat<ValueType> *> &blocks)
+    : m_rows(rows), m_columns(columns) {
+
+  if (rowRanges.size() != blocks.size() ||
+      columnRanges.size() != blocks.size())
+    throw std::invalid_argument("BlockSparseMatrix::BlockSparseMatrix(): "
+                                "Numbers of ranges and blocks differ.");
+
+  std::vector<std::size_t> order(blocks.size());
+  std::iota(begin(order), end(order), 0);
+  std::sort(begin(order), end(order), [&](std::size_t a, std::size_t b) {
+    if (rowRanges[a][0] != rowRanges[b][0])
+      return rowRanges[a][0] < rowRanges[b][0];
+    return columnRanges[a][0] < columnRanges[b][0];
+  });
+
+  m_blocks.resize(blocks.size());
+  std::size_t valueCount = 0;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    Block &block = m_blocks[i];
+    block.rowRange = rowRanges[order[i]];
+    block.columnRange = columnRanges[order[i]];
+    block.offset = valueCount;
+    std::size_t blockRows = block.rowRange[1] - block.rowRange[0];
+    std::size_t blockColumns = block.columnRange[1] - block.columnRange[0];
+    const arma::Mat<ValueType> &A = *blocks[order[i]];
+    if (A.n_rows != blockRows || A.n_cols != blockColumns ||
+        block.rowRange[1] > rows || block.columnRange[1] > columns)
+      throw std::invalid_argument("BlockSparseMatrix::BlockSparseMatrix(): "
+                                  "Block does not match its index ranges.");
+    valueCount += A.n_elem;
+  }
+
+  m_values.resize(valueCount);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const arma::Mat<ValueType> &A = *blocks[order[i]];
+    std::copy(A.memptr(), A.memptr() + A.n_elem,
+              m_values.data() + m_blocks[i].offset);
+  }
+
+  std::vector<std::size_t> rowOrder(m_blocks.size());
+  std::iota(begin(rowOrder), end(rowOrder), 0);
+  computeBands(m_blocks, rowOrder, false, m_rowBands);
+
+  m_columnOrder.resize(m_blocks.size());
+  std::iota(begin(m_columnOrder), end(m_columnOrder), 0);
+  std::stable_sort(begin(m_columnOrder), end(m_columnOrder),
+                   [this](std::size_t a, std::size_t b) {
+    return m_blocks[a].columnRange[0] < m_blocks[b].columnRange[0];
+  });
+  computeBands(m_blocks, m_columnOrder, true, m_columnBands);
+}
+
+template <typename ValueType>
+void BlockSparseMatrix<ValueType>::computeBands(
+    const std::vector<Block> &blocks, const std::vector<std::size_t> &order,
+    bool byColumns, std::vector<std::size_t> &bands) {
+
+  // The blocks are visited in order of the first index of their range; a
+  // new band starts at every block beginning behind all previous ones.
+  bands.clear();
+  std::size_t bandEnd = 0;
+  for (std::size_t k = 0; k < order.size(); ++k) {
+    const Block &block = blocks[order[k]];
+    const IndexRangeType &range = byColumns ? block.columnRange : block.rowRange;
+    if (k == 0 || range[0] >= bandEnd) {
+      bands.push_back(k);
+      bandEnd = range[1];
+    } else
+      bandEnd = std::max(bandEnd, range[1]);
+  }
+  bands.push_back(order.size());
+}
+
+template <typename ValueType>
+std::size_t BlockSparseMatrix<ValueType>::rows() const {
+  return m_rows;
+}
+
+template <typename ValueType>
+std::size_t BlockSparseMatrix<ValueType>::columns() const {
+  return m_columns;
+}
+
+template <typename ValueType>
+std::size_t BlockSparseMatrix<ValueType>::numberOfBlocks() const {
+  return m_blocks.size();
+}
+
+template <typename ValueType>
+const std::vector<typename BlockSparseMatrix<ValueType>::Block> &
+BlockSparseMatrix<ValueType>::blocks() const {
+  return m_blocks;
+}
+
+template <typename ValueType>
+const std::vector<ValueType> &BlockSparseMatrix<ValueType>::values() const {
+  return m_values;
+}
+
+template <typename ValueType>
+double BlockSparseMatrix<ValueType>::memSizeKb() const {
+  return sizeof(ValueType) * double(m_values.size()) / 1024;
+}
+
+template <typename ValueType>
+template <bool conjugate>
+void BlockSparseMatrix<ValueType>::addProduct(const Block &block,
+                                              const arma::Mat<ValueType> &X,
+                                              arma::Mat<ValueType> &Y,
+                                              ValueType alpha) const {
+  const std::size_t blockRows = block.rowRange[1] - block.rowRange[0];
+  const std::size_t blockColumns = block.columnRange[1] - block.columnRange[0];
+  const ValueType *a = m_values.data() + block.offset;
+  for (std::size_t c = 0; c < X.n_cols; ++c) {
+    const ValueType *x = X.colptr(c) + block.columnRange[0];
+    ValueType *y = Y.colptr(c) + block.rowRange[0];
+    for (std::size_t j = 0; j < blockColumns; ++j) {
+      const ValueType xj = alpha * x[j];
+      const ValueType *aj = a + j * blockRows;
+      for (std::size_t i = 0; i < blockRows; ++i)
+        y[i] += (conjugate ? conjugateValue(aj[i]) : aj[i]) * xj;
+    }
+  }
+}
+
+template <typename ValueType>
+template <bool conjugate>
+void BlockSparseMatrix<ValueType>::addTransposedProduct(
+    const Block &block, const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+    ValueType alpha) const {
+  const std::size_t blockRows = block.rowRange[1] - block.rowRange[0];
+  const std::size_t blockColumns = block.columnRange[1] - block.columnRange[0];
+  const ValueType *a = m_values.data() + block.offset;
+  for (std::size_t c = 0; c < X.n_cols; ++c) {
+    const ValueType *x = X.colptr(c) + block.rowRange[0];
+    ValueType *y = Y.colptr(c) + block.columnRange[0];
+    for (std::size_t j = 0; j < blockColumns; ++j) {
+      const ValueType *aj = a + j * blockRows;
+      ValueType sum = 0;
+      for (std::size_t i = 0; i < blockRows; ++i)
+        sum += (conjugate ? conjugateValue(aj[i]) : aj[i]) * x[i];
+      y[j] += alpha * sum;
+    }
+  }
+}
+
+template <typename ValueType>
+void BlockSparseMatrix<ValueType>::apply(const arma::Mat<ValueType> &X,
+                                         arma::Mat<ValueType> &Y,
+                                         TransposeMode trans,
+                                         ValueType alpha) const {
+
+  const bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  const bool conjugate =
+      (trans == TransposeMode::CONJ || trans == TransposeMode::CONJTRANS);
+  if (X.n_rows != (transposed ? m_rows : m_columns) ||
+      Y.n_rows != (transposed ? m_columns : m_rows) || X.n_cols != Y.n_cols)
+    throw std::invalid_argument("BlockSparseMatrix::apply(): "
+                                "Incompatible matrix dimensions.");
+  if (alpha == ValueType(0) || m_blocks.empty())
+    return;
+
+  if (!transposed) {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, m_rowBands.size() - 1),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t band = r.begin(); band != r.end(); ++band)
+            for (std::size_t k = m_rowBands[band]; k < m_rowBands[band + 1];
+                 ++k) {
+              if (conjugate)
+                addProduct<true>(m_blocks[k], X, Y, alpha);
+              else
+                addProduct<false>(m_blocks[k], X, Y, alpha);
+            }
+        });
+  } else {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, m_columnBands.size() - 1),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t band = r.begin(); band != r.end(); ++band)
+            for (std::size_t k = m_columnBands[band];
+                 k < m_columnBands[band + 1]; ++k) {
+              const Block &block = m_blocks[m_columnOrder[k]];
+              if (conjugate)
+                addTransposedProduct<true>(block, X, Y, alpha);
+              else
+                addTransposedProduct<false>(block, X, Y, alpha);
+            }
+        });
+  }
+}
+}
+
+#endif
@@ -0,0 +1,36 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_BLOCK_SPARSE_SPAI_HPP
+#define HMAT_BLOCK_SPARSE_SPAI_HPP
+
+#include "common.hpp"
+#include "block_sparse_matrix.hpp"
+
+namespace hmat {
+
+/** \brief Sparse approximate inverse (SPAI) of a block-sparse matrix.
+ *
+ *  Computes a right approximate inverse M of the square matrix \p A, e.g.
+ *  the near field of an H-matrix extracted by HMatrix::extractNearField(),
+ *  whose rows and columns are clustered alike. The columns of \p A are
+ *  split into groups, the maximal unions of overlapping column ranges of
+ *  its blocks, which in an H-matrix are the column clusters of the
+ *  inadmissible leaves. All columns of a group g share the sparsity
+ *  pattern J_g, the union of the row ranges of the blocks in these
+ *  columns, i.e. the DOFs of the neighbouring clusters. The columns of M
+ *  in group g are the minimizers of the Frobenius norm of
+ *  <tt>(A M - I)(J_g, g)</tt>, found by solving the local system
+ *  <tt>A(J_g, J_g) M(J_g, g) = I(J_g, g)</tt>; entries of A outside its
+ *  blocks count as zero. The local problems are independent and are
+ *  solved in parallel.
+ *
+ *  The returned matrix has one block per group and contiguous part of its
+ *  pattern, so it is applied as cheaply and in parallel as \p A. */
+template <typename ValueType>
+shared_ptr<BlockSparseMatrix<ValueType>>
+sparseApproximateInverse(const BlockSparseMatrix<ValueType> &A);
+}
+
+#include "block_sparse_spai_impl.hpp"
+
+#endif
@@ -0,0 +1,155 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_BLOCK_SPARSE_SPAI_IMPL_HPP
+#define HMAT_BLOCK_SPARSE_SPAI_IMPL_HPP
+
+#include "block_sparse_spai.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType>
+shared_ptr<BlockSparseMatrix<ValueType>>
+sparseApproximateInverse(const BlockSparseMatrix<ValueType> &A) {
+
+  if (A.rows() != A.columns())
+    throw std::invalid_argument("sparseApproximateInverse(): "
+                                "Matrix must be square.");
+
+  typedef typename BlockSparseMatrix<ValueType>::Block Block;
+  const std::vector<Block> &blocks = A.blocks();
+  const std::vector<ValueType> &values = A.values();
+
+  // Column groups and the blocks lying in each of them
+  std::vector<std::size_t> order(blocks.size());
+  std::iota(begin(order), end(order), 0);
+  std::sort(begin(order), end(order), [&](std::size_t i, std::size_t j) {
+    return blocks[i].columnRange[0] < blocks[j].columnRange[0];
+  });
+  std::vector<IndexRangeType> groups;
+  std::vector<std::vector<std::size_t>> groupBlocks;
+  for (std::size_t index : order) {
+    const IndexRangeType &range = blocks[index].columnRange;
+    if (groups.empty() || range[0] >= groups.back()[1]) {
+      groups.push_back(range);
+      groupBlocks.push_back(std::vector<std::size_t>());
+    } else
+      groups.back()[1] = std::max(groups.back()[1], range[1]);
+    groupBlocks.back().push_back(index);
+  }
+  const std::size_t groupCount = groups.size();
+  std::vector<std::size_t> columnGroup(A.columns(), groupCount);
+  for (std::size_t g = 0; g < groupCount; ++g)
+    std::fill(begin(columnGroup) + groups[g][0],
+              begin(columnGroup) + groups[g][1], g);
+
+  // Pattern of every group as sorted disjoint ranges, and the columns of M
+  // restricted to it
+  std::vector<std::vector<IndexRangeType>> patterns(groupCount);
+  std::vector<arma::Mat<ValueType>> solutions(groupCount);
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, groupCount, 1),
+                    [&](const tbb::blocked_range<std::size_t> &r) {
+    for (std::size_t g = r.begin(); g != r.end(); ++g) {
+      std::vector<IndexRangeType> rowRanges;
+      for (std::size_t index : groupBlocks[g])
+        rowRanges.push_back(blocks[index].rowRange);
+      std::sort(begin(rowRanges), end(rowRanges));
+      std::vector<IndexRangeType> &pattern = patterns[g];
+      for (const auto &range : rowRanges)
+        if (pattern.empty() || range[0] > pattern.back()[1])
+          pattern.push_back(range);
+        else
+          pattern.back()[1] = std::max(pattern.back()[1], range[1]);
+      std::vector<std::size_t> offsets(1, 0);
+      for (const auto &range : pattern)
+        offsets.push_back(offsets.back() + range[1] - range[0]);
+      const std::size_t size = offsets.back();
+
+      // Groups whose columns meet the pattern; they hold all blocks
+      // contributing to A(J_g, J_g)
+      std::vector<std::size_t> neighbours;
+      for (const auto &range : pattern)
+        for (std::size_t c = range[0]; c < range[1];) {
+          const std::size_t h = columnGroup[c];
+          if (h == groupCount) {
+            ++c;
+            continue;
+          }
+          if (neighbours.empty() || neighbours.back() != h)
+            neighbours.push_back(h);
+          c = groups[h][1];
+        }
+
+      arma::Mat<ValueType> local(size, size, arma::fill::zeros);
+      for (std::size_t h : neighbours)
+        for (std::size_t index : groupBlocks[h]) {
+          const Block &block = blocks[index];
+          const std::size_t blockRows = block.rowRange[1] - block.rowRange[0];
+          for (std::size_t q = 0; q < pattern.size(); ++q) {
+            const std::size_t colBegin =
+                std::max(block.columnRange[0], pattern[q][0]);
+            const std::size_t colEnd =
+                std::min(block.columnRange[1], pattern[q][1]);
+            for (std::size_t p = 0; colBegin < colEnd && p < pattern.size();
+                 ++p) {
+              const std::size_t rowBegin =
+                  std::max(block.rowRange[0], pattern[p][0]);
+              const std::size_t rowEnd =
+                  std::min(block.rowRange[1], pattern[p][1]);
+              for (std::size_t c = colBegin; c < colEnd; ++c)
+                for (std::size_t i = rowBegin; i < rowEnd; ++i)
+                  local(offsets[p] + i - pattern[p][0],
+                        offsets[q] + c - pattern[q][0]) =
+                      values[block.offset + (i - block.rowRange[0]) +
+                             (c - block.columnRange[0]) * blockRows];
+            }
+          }
+        }
+
+      // Right-hand side I(J_g, g)
+      arma::Mat<ValueType> rhs(size, groups[g][1] - groups[g][0],
+                               arma::fill::zeros);
+      for (std::size_t c = groups[g][0]; c < groups[g][1]; ++c) {
+        std::size_t p = 0;
+        while (p < pattern.size() && pattern[p][1] <= c)
+          ++p;
+        if (p == pattern.size() || pattern[p][0] > c)
+          throw std::invalid_argument("sparseApproximateInverse(): "
+                                      "Diagonal entries are missing.");
+        rhs(offsets[p] + c - pattern[p][0], c - groups[g][0]) = 1;
+      }
+      if (!arma::solve(solutions[g], local, rhs))
+        throw std::runtime_error("sparseApproximateInverse(): "
+                                 "Local system is singular.");
+    }
+  });
+
+  // One block of M per group and range of its pattern
+  std::vector<IndexRangeType> rowRanges, columnRanges;
+  std::vector<arma::Mat<ValueType>> parts;
+  for (std::size_t g = 0; g < groupCount; ++g) {
+    std::size_t offset = 0;
+    for (const auto &range : patterns[g]) {
+      const std::size_t rows = range[1] - range[0];
+      rowRanges.push_back(range);
+      columnRanges.push_back(groups[g]);
+      parts.push_back(solutions[g].rows(offset, offset + rows - 1));
+      offset += rows;
+    }
+    solutions[g].reset();
+  }
+  std::vector<const arma::Mat<ValueType> *> partPointers;
+  for (const auto &part : parts)
+    partPointers.push_back(&part);
+  return shared_ptr<BlockSparseMatrix<ValueType>>(
+      new BlockSparseMatrix<ValueType>(A.rows(), A.columns(), rowRanges,
+                                       columnRanges, partPointers));
+}
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "bounding_box.hpp"
 #include "geometry.hpp"
 #include "dof_permutation.hpp"
+#include "tree_index.hpp"
 
 namespace hmat {
 
@@ -29,6 +30,19 @@ template <int N> class ClusterTree {
 public:
   ClusterTree(const Geometry &geometry, int minBlockSize);
 
+  /** \brief Build the tree from geometry data stored by value.
+   *
+   *  The DOFs are partitioned in place in a single index array, and the
+   *  two subtrees of large clusters are built in parallel. */
+  ClusterTree(const FlatGeometry &geometry, int minBlockSize);
+
+  /** \brief Wrap an existing tree, e.g. one read back from a file.
+   *
+   *  \p hMatDofToOriginalDofMap gives the original DOF index of every
+   *  H-matrix DOF. */
+  ClusterTree(const shared_ptr<ClusterTreeNode<N>> &root,
+              const std::vector<std::size_t> &hMatDofToOriginalDofMap);
+
   const shared_ptr<const ClusterTreeNode<N>> root() const;
   const shared_ptr<ClusterTreeNode<N>> root();
 
@@ -43,15 +57,23 @@ public:
 
   std::size_t numberOfDofs() const;
 
+  /** \brief Index-linked structure of the tree; see TreeIndex. */
+  const TreeIndex<ClusterTreeNodeData, N> &treeIndex() const;
+
 private:
   shared_ptr<ClusterTreeNode<N>>
-  initializeClusterTree(const Geometry &geometry);
-  void splitClusterTreeByGeometry(const Geometry &geometry,
+  initializeClusterTree(const FlatGeometry &geometry);
+  void splitClusterTreeByGeometry(const FlatGeometry &geometry,
                                   DofPermutation &dofPermutation,
                                   int minBlockSize);
+  static void splitClusterTreeNode(
+      const shared_ptr<ClusterTreeNode<N>> &clusterTreeNode,
+      const FlatGeometry &geometry, IndexSetType &originalDofs,
+      int minBlockSize);
 
   shared_ptr<ClusterTreeNode<N>> m_root;
   DofPermutation m_dofPermutation;
+  shared_ptr<const TreeIndex<ClusterTreeNodeData, N>> m_treeIndex;
 };
 
 typedef ClusterTree<2> DefaultClusterTreeType;
@@ -11,8 +11,11 @@
 
 #include "cluster_tree.hpp"
 
-#include <functional>
+#include <algorithm>
 #include <cassert>
+#include <stdexcept>
+
+#include <tbb/parallel_invoke.h>
 
 namespace hmat {
 
@@ -22,10 +25,28 @@ inline ClusterTreeNodeData::ClusterTreeNodeData(
 
 template <int N>
 ClusterTree<N>::ClusterTree(const Geometry &geometry, int minBlockSize)
+    : ClusterTree(flattenGeometry(geometry), minBlockSize) {}
+
+template <int N>
+ClusterTree<N>::ClusterTree(const FlatGeometry &geometry, int minBlockSize)
     : m_root(initializeClusterTree(geometry)),
       m_dofPermutation(geometry.size()) {
-
   splitClusterTreeByGeometry(geometry, m_dofPermutation, minBlockSize);
+  m_treeIndex.reset(new TreeIndex<ClusterTreeNodeData, N>(m_root));
+}
+
+template <int N>
+ClusterTree<N>::ClusterTree(
+    const shared_ptr<ClusterTreeNode<N>> &root,
+    const std::vector<std::size_t> &hMatDofToOriginalDofMap)
+    : m_root(root), m_dofPermutation(hMatDofToOriginalDofMap.size()) {
+  if (numberOfDofs() != hMatDofToOriginalDofMap.size())
+    throw std::invalid_argument("ClusterTree::ClusterTree(): "
+                                "Size of the DOF map does not match the "
+                                "index range of the root node.");
+  for (std::size_t i = 0; i < hMatDofToOriginalDofMap.size(); ++i)
+    m_dofPermutation.addDofIndexPair(hMatDofToOriginalDofMap[i], i);
+  m_treeIndex.reset(new TreeIndex<ClusterTreeNodeData, N>(m_root));
 }
 
 template <int N> std::size_t ClusterTree<N>::numberOfDofs() const {
@@ -43,14 +64,14 @@ template <int N> const shared_ptr<ClusterTreeNode<N>> ClusterTree<N>::root() {
 
 template <int N>
 shared_ptr<ClusterTreeNode<N>>
-ClusterTree<N>::initializeClusterTree(const Geometry &geometry) {
+ClusterTree<N>::initializeClusterTree(const FlatGeometry &geometry) {
 
   IndexRangeType indexRange{{0, geometry.size()}};
 
   BoundingBox b;
 
   for (const auto &geometryData : geometry)
-    b.merge(geometryData->boundingBox);
+    b.merge(geometryData.boundingBox);
 
   return make_shared<ClusterTreeNode<N>>(ClusterTreeNodeData(indexRange, b));
 }
@@ -67,96 +88,98 @@ ClusterTree<N>::originalDofToHMatDofMap() const {
   return m_dofPermutation.originalDofToHMatDofMap();
 }
 
+template <>
+inline void ClusterTree<2>::splitClusterTreeNode(
+    const shared_ptr<ClusterTreeNode<2>> &clusterTreeNode,
+    const FlatGeometry &geometry, IndexSetType &originalDofs,
+    int minBlockSize) {
+
+  // Clusters at least this size build their two subtrees concurrently
+  const std::size_t parallelThreshold = 4096;
+
+  const IndexRangeType indexRange = clusterTreeNode->data().indexRange;
+  auto first = originalDofs.begin() + indexRange[0];
+  auto last = originalDofs.begin() + indexRange[1];
+  std::size_t indexSetSize = indexRange[1] - indexRange[0];
+
+  if (indexSetSize <= minBlockSize) {
+    BoundingBox b;
+    for (auto it = first; it != last; ++it)
+      b.merge(geometry[*it].boundingBox);
+    clusterTreeNode->data().boundingBox = b;
+    return;
+  }
+
+  // Halve the bounding box along its longest side until both halves contain
+  // DOFs. The stable partition preserves the original DOF order inside each
+  // half.
+  BoundingBox firstBoundingBox;
+  BoundingBox secondBoundingBox;
+  IndexSetType::iterator middle;
+  while (true) {
+    assert(clusterTreeNode->data().boundingBox.diameter() != 0);
+    auto dim = clusterTreeNode->data().boundingBox.maxDimension();
+    auto boxes = clusterTreeNode->data().boundingBox.divide(dim, .5);
+    firstBoundingBox = boxes.first;
+    secondBoundingBox = boxes.second;
+    auto ubound = firstBoundingBox.bounds()[2 * dim + 1];
+    middle = std::stable_partition(
+        first, last, [&geometry, dim, ubound](std::size_t index) {
+          return geometry[index].center[dim] < ubound;
+        });
+    if (middle == last)
+      clusterTreeNode->data().boundingBox = firstBoundingBox;
+    else if (middle == first)
+      clusterTreeNode->data().boundingBox = secondBoundingBox;
+    else
+      break;
+  }
+
+  auto pivot = middle - first;
+  IndexRangeType newRangeFirst = indexRange;
+  IndexRangeType newRangeSecond = indexRange;
+  newRangeFirst[1] = newRangeSecond[0] = newRangeFirst[0] + pivot;
+
+  clusterTreeNode->addChild(
+      ClusterTreeNodeData(newRangeFirst, firstBoundingBox), 0);
+  clusterTreeNode->addChild(
+      ClusterTreeNodeData(newRangeSecond, secondBoundingBox), 1);
+
+  // The subtrees work on disjoint parts of originalDofs
+  auto splitFirst = [&]() {
+    splitClusterTreeNode(clusterTreeNode->child(0), geometry, originalDofs,
+                         minBlockSize);
+  };
+  auto splitSecond = [&]() {
+    splitClusterTreeNode(clusterTreeNode->child(1), geometry, originalDofs,
+                         minBlockSize);
+  };
+  if (indexSetSize >= parallelThreshold)
+    tbb::parallel_invoke(splitFirst, splitSecond);
+  else {
+    splitFirst();
+    splitSecond();
+  }
+
+  clusterTreeNode->data().boundingBox =
+      clusterTreeNode->child(0)->data().boundingBox;
+  clusterTreeNode->data().boundingBox.merge(
+      clusterTreeNode->child(1)->data().boundingBox);
+}
+
 template <>
 inline void
-ClusterTree<2>::splitClusterTreeByGeometry(const Geometry &geometry,
+ClusterTree<2>::splitClusterTreeByGeometry(const FlatGeometry &geometry,
                                            DofPermutation &dofPermutation,
                                            int minBlockSize) {
 
-  std::function<void(const shared_ptr<ClusterTreeNode<2>> & clusterTreeNode,
-                     const IndexSetType & indexSet)> splittingFun;
-
-  splittingFun = [&dofPermutation, &geometry, minBlockSize, &splittingFun](
-      const shared_ptr<ClusterTreeNode<2>> &clusterTreeNode,
-      const IndexSetType &indexSet) {
-
-    std::size_t indexSetSize = indexSet.size();
-
-    assert(indexSetSize == clusterTreeNode->data().indexRange[1] -
-                               clusterTreeNode->data().indexRange[0]);
-
-    if (indexSetSize > minBlockSize) {
-
-      IndexSetType firstIndexSet;
-      IndexSetType secondIndexSet;
-
-      // Figure out the right dim
+  // Position i of originalDofs holds the original DOF that becomes H-matrix
+  // DOF i. Each cluster owns the part given by its index range.
+  IndexSetType originalDofs = fillIndexRange(0, geometry.size());
+  splitClusterTreeNode(m_root, geometry, originalDofs, minBlockSize);
 
-      assert(clusterTreeNode->data().boundingBox.diameter() != 0);
-
-      auto dim = clusterTreeNode->data().boundingBox.maxDimension();
-
-      auto bounds = clusterTreeNode->data().boundingBox.bounds();
-      auto boxes = clusterTreeNode->data().boundingBox.divide(dim, .5);
-
-      auto firstBoundingBox = boxes.first;
-      auto secondBoundingBox = boxes.second;
-
-      auto ubound = firstBoundingBox.bounds()[2 * dim + 1];
-
-      for (auto index : indexSet) {
-        auto centerValue = geometry[index]->center[dim];
-        if (centerValue < ubound)
-          firstIndexSet.push_back(index);
-        else
-          secondIndexSet.push_back(index);
-      }
-
-      if (secondIndexSet.size() == 0) {
-        clusterTreeNode->data().boundingBox = firstBoundingBox;
-        splittingFun(clusterTreeNode, indexSet);
-        return;
-      }
-      if (firstIndexSet.size() == 0) {
-        clusterTreeNode->data().boundingBox = secondBoundingBox;
-        splittingFun(clusterTreeNode, indexSet);
-        return;
-      }
-
-      auto pivot = firstIndexSet.size();
-
-      IndexRangeType newRangeFirst = clusterTreeNode->data().indexRange;
-      IndexRangeType newRangeSecond = clusterTreeNode->data().indexRange;
-
-      newRangeFirst[1] = newRangeSecond[0] = newRangeFirst[0] + pivot;
-
-      clusterTreeNode->addChild(
-          ClusterTreeNodeData(newRangeFirst, firstBoundingBox), 0);
-      clusterTreeNode->addChild(
-          ClusterTreeNodeData(newRangeSecond, secondBoundingBox), 1);
-      splittingFun(clusterTreeNode->child(0), firstIndexSet);
-      splittingFun(clusterTreeNode->child(1), secondIndexSet);
-
-      clusterTreeNode->data().boundingBox =
-          clusterTreeNode->child(0)->data().boundingBox;
-      clusterTreeNode->data().boundingBox.merge(
-          clusterTreeNode->child(1)->data().boundingBox);
-    } else {
-
-      BoundingBox b;
-      for (const auto &elem : indexSet)
-        b.merge(geometry[elem]->boundingBox);
-
-      clusterTreeNode->data().boundingBox = b;
-      int originalIndexCount = 0;
-      const auto &indexRange = clusterTreeNode->data().indexRange;
-      for (int hMatDof = indexRange[0]; hMatDof < indexRange[1]; ++hMatDof) {
-        dofPermutation.addDofIndexPair(indexSet[originalIndexCount], hMatDof);
-        ++originalIndexCount;
-      }
-    }
-  };
-  splittingFun(m_root, fillIndexRange(0, geometry.size()));
+  for (std::size_t hMatDof = 0; hMatDof < originalDofs.size(); ++hMatDof)
+    dofPermutation.addDofIndexPair(originalDofs[hMatDof], hMatDof);
 }
 
 template <int N>
@@ -175,13 +198,20 @@ template <int N>
 std::vector<shared_ptr<const ClusterTreeNode<N>>>
 ClusterTree<N>::leafNodes() const {
 
-  return m_root->leafNodes;
+  const auto &leafNodes = m_treeIndex->leafNodes();
+  return std::vector<shared_ptr<const ClusterTreeNode<N>>>(leafNodes.begin(),
+                                                           leafNodes.end());
 }
 
 template <int N>
 std::vector<shared_ptr<ClusterTreeNode<N>>> ClusterTree<N>::leafNodes() {
 
-  return m_root->leafNodes();
+  return m_treeIndex->leafNodes();
+}
+
+template <int N>
+const TreeIndex<ClusterTreeNodeData, N> &ClusterTree<N>::treeIndex() const {
+  return *m_treeIndex;
 }
 }
 #endif
@@ -6,6 +6,8 @@
 #include "shared_ptr.hpp"
 
 #include <array>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace hmat {
@@ -26,7 +28,34 @@ enum TransposeMode {
   CONJTRANS
 };
 
+// Storage scheme of an H-matrix; see HMatrix::initializeSymmetric()
+enum HMatrixSymmetry {
+  GENERAL_STORAGE,
+  SYMMETRIC_STORAGE,
+  HERMITIAN_STORAGE
+};
+
 IndexSetType fillIndexRange(std::size_t start, std::size_t stop);
+
+// Allocator for vectors of numbers whose resize() leaves the new elements
+// uninitialised, so that their memory pages are first touched (and, on NUMA
+// machines, placed) by the threads that later fill them in.
+template <typename T> class UninitializedAllocator : public std::allocator<T> {
+public:
+  template <typename U> struct rebind {
+    typedef UninitializedAllocator<U> other;
+  };
+
+  UninitializedAllocator() {}
+  template <typename U>
+  UninitializedAllocator(const UninitializedAllocator<U> &) {}
+
+  template <typename U> void construct(U *) {}
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&... args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+};
 }
 
 #include "common_impl.hpp"
@@ -15,7 +15,42 @@ public:
                      const IndexRangeType &columnIndexRange,
                      const BlockClusterTreeNode<N> &blockClusterTreeNode,
                      arma::Mat<ValueType> &data) const = 0;
+
+  /** \brief Compute several, not necessarily contiguous, rows of a block.
+   *
+   *  Row \p i of \p data receives the entries of row \p rowIndices[i] in the
+   *  columns \p columnIndexRange. Implementations can share the setup of
+   *  the evaluation between the rows; the default implementation calls
+   *  computeMatrixBlock() once per row. */
+  virtual void
+  computeMatrixRows(const IndexSetType &rowIndices,
+                    const IndexRangeType &columnIndexRange,
+                    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                    arma::Mat<ValueType> &data) const;
+
+  /** \brief Compute several, not necessarily contiguous, columns of a block.
+   *
+   *  Analogous to computeMatrixRows(). */
+  virtual void
+  computeMatrixColumns(const IndexRangeType &rowIndexRange,
+                       const IndexSetType &columnIndices,
+                       const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                       arma::Mat<ValueType> &data) const;
+
+  /** \brief Return the number of matrix entries evaluated so far, or 0 if
+   *  the accessor does not count them. */
+  virtual std::size_t accessedEntryCount() const;
+
+  /** \brief Return true if all entries of the block are known to be zero
+   *  without evaluating them.
+   *
+   *  Compressors store such blocks as zero blocks. The default
+   *  implementation returns false. */
+  virtual bool
+  isZeroBlock(const BlockClusterTreeNode<N> &blockClusterTreeNode) const;
 };
 }
 
+#include "data_accessor_impl.hpp"
+
 #endif
@@ -0,0 +1,55 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_DATA_ACCESSOR_IMPL_HPP
+#define HMAT_DATA_ACCESSOR_IMPL_HPP
+
+#include "data_accessor.hpp"
+
+namespace hmat {
+
+template <typename ValueType, int N>
+void DataAccessor<ValueType, N>::computeMatrixRows(
+    const IndexSetType &rowIndices, const IndexRangeType &columnIndexRange,
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    arma::Mat<ValueType> &data) const {
+
+  data.set_size(rowIndices.size(), columnIndexRange[1] - columnIndexRange[0]);
+  arma::Mat<ValueType> row;
+  for (std::size_t i = 0; i < rowIndices.size(); ++i) {
+    IndexRangeType rowIndexRange = {{rowIndices[i], rowIndices[i] + 1}};
+    computeMatrixBlock(rowIndexRange, columnIndexRange, blockClusterTreeNode,
+                       row);
+    data.row(i) = row;
+  }
+}
+
+template <typename ValueType, int N>
+void DataAccessor<ValueType, N>::computeMatrixColumns(
+    const IndexRangeType &rowIndexRange, const IndexSetType &columnIndices,
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    arma::Mat<ValueType> &data) const {
+
+  data.set_size(rowIndexRange[1] - rowIndexRange[0], columnIndices.size());
+  arma::Mat<ValueType> column;
+  for (std::size_t j = 0; j < columnIndices.size(); ++j) {
+    IndexRangeType columnIndexRange = {
+        {columnIndices[j], columnIndices[j] + 1}};
+    computeMatrixBlock(rowIndexRange, columnIndexRange, blockClusterTreeNode,
+                       column);
+    data.col(j) = column;
+  }
+}
+
+template <typename ValueType, int N>
+std::size_t DataAccessor<ValueType, N>::accessedEntryCount() const {
+  return 0;
+}
+
+template <typename ValueType, int N>
+bool DataAccessor<ValueType, N>::isZeroBlock(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode) const {
+  return false;
+}
+}
+
+#endif
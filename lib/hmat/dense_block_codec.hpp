@@ -0,0 +1,38 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_DENSE_BLOCK_CODEC_HPP
+#define HMAT_DENSE_BLOCK_CODEC_HPP
+
+#include "common.hpp"
+
+namespace hmat {
+
+/** \brief Number of values sharing one exponent in the dense block codec. */
+const std::size_t DENSE_BLOCK_CODEC_GROUP_SIZE = 64;
+
+/** \brief Size in bytes of \p count real values coded with
+ *  \p bitsPerValue bits each. */
+std::size_t denseBlockCodecSize(std::size_t count, int bitsPerValue);
+
+/** \brief Code real values with a fixed-rate block floating-point format.
+ *
+ *  Groups of DENSE_BLOCK_CODEC_GROUP_SIZE consecutive values share the
+ *  binary exponent of their largest magnitude, and every value is stored
+ *  as a signed integer of \p bitsPerValue bits, which must be 8, 16, 24 or
+ *  32, relative to it. The error of each decoded value is bounded by
+ *  \f$2^{2 - bitsPerValue}\f$ times the largest magnitude in its group.
+ *  The values must be finite, and \p data must hold
+ *  denseBlockCodecSize(count, bitsPerValue) bytes. */
+template <typename RealType>
+void encodeDenseBlock(const RealType *values, std::size_t count,
+                      int bitsPerValue, unsigned char *data);
+
+/** \brief Decode \p count values written by encodeDenseBlock(). */
+template <typename RealType>
+void decodeDenseBlock(const unsigned char *data, std::size_t count,
+                      int bitsPerValue, RealType *values);
+}
+
+#include "dense_block_codec_impl.hpp"
+
+#endif
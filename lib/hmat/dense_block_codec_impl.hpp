@@ -0,0 +1,95 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_DENSE_BLOCK_CODEC_IMPL_HPP
+#define HMAT_DENSE_BLOCK_CODEC_IMPL_HPP
+
+#include "dense_block_codec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace hmat {
+
+inline void checkDenseBlockCodecBits(int bitsPerValue) {
+  if (bitsPerValue != 8 && bitsPerValue != 16 && bitsPerValue != 24 &&
+      bitsPerValue != 32)
+    throw std::invalid_argument("denseBlockCodec(): "
+                                "bitsPerValue must be 8, 16, 24 or 32.");
+}
+
+inline std::size_t denseBlockCodecSize(std::size_t count, int bitsPerValue) {
+  checkDenseBlockCodecBits(bitsPerValue);
+  std::size_t groups = (count + DENSE_BLOCK_CODEC_GROUP_SIZE - 1) /
+                       DENSE_BLOCK_CODEC_GROUP_SIZE;
+  return 2 * groups + count * (bitsPerValue / 8);
+}
+
+template <typename RealType>
+void encodeDenseBlock(const RealType *values, std::size_t count,
+                      int bitsPerValue, unsigned char *data) {
+
+  checkDenseBlockCodecBits(bitsPerValue);
+  const int bytes = bitsPerValue / 8;
+  const std::int64_t maxValue = (std::int64_t(1) << (bitsPerValue - 1)) - 1;
+
+  for (std::size_t first = 0; first < count;
+       first += DENSE_BLOCK_CODEC_GROUP_SIZE) {
+    std::size_t last = std::min(count, first + DENSE_BLOCK_CODEC_GROUP_SIZE);
+
+    RealType maxAbs = 0;
+    for (std::size_t i = first; i < last; ++i)
+      maxAbs = std::max(maxAbs, RealType(std::abs(values[i])));
+    int exponent = 0;
+    if (maxAbs > 0)
+      std::frexp(maxAbs, &exponent); // maxAbs < 2^exponent
+    std::uint16_t storedExponent =
+        static_cast<std::uint16_t>(static_cast<std::int16_t>(exponent));
+    *data++ = storedExponent & 0xff;
+    *data++ = storedExponent >> 8;
+
+    for (std::size_t i = first; i < last; ++i) {
+      std::int64_t q = static_cast<std::int64_t>(
+          std::llround(std::ldexp(double(values[i]),
+                                  bitsPerValue - 1 - exponent)));
+      q = std::max(-maxValue, std::min(maxValue, q));
+      std::uint32_t u = static_cast<std::uint32_t>(q);
+      for (int b = 0; b < bytes; ++b)
+        *data++ = (u >> (8 * b)) & 0xff;
+    }
+  }
+}
+
+template <typename RealType>
+void decodeDenseBlock(const unsigned char *data, std::size_t count,
+                      int bitsPerValue, RealType *values) {
+
+  checkDenseBlockCodecBits(bitsPerValue);
+  const int bytes = bitsPerValue / 8;
+  const std::uint32_t signBit = std::uint32_t(1) << (bitsPerValue - 1);
+
+  for (std::size_t first = 0; first < count;
+       first += DENSE_BLOCK_CODEC_GROUP_SIZE) {
+    std::size_t last = std::min(count, first + DENSE_BLOCK_CODEC_GROUP_SIZE);
+
+    std::uint16_t storedExponent = data[0] | (std::uint16_t(data[1]) << 8);
+    data += 2;
+    int exponent = static_cast<std::int16_t>(storedExponent);
+    // Scale in double precision, which covers the range of any RealType
+    const double scale = std::ldexp(1.0, exponent - bitsPerValue + 1);
+
+    for (std::size_t i = first; i < last; ++i) {
+      std::uint32_t u = 0;
+      for (int b = 0; b < bytes; ++b)
+        u |= std::uint32_t(*data++) << (8 * b);
+      std::int64_t q = std::int64_t(u);
+      if (u & signBit)
+        q -= 2 * std::int64_t(signBit);
+      values[i] = static_cast<RealType>(q * scale);
+    }
+  }
+}
+}
+
+#endif
@@ -15,7 +15,12 @@ struct GeometryDataType;
 
 typedef std::vector<shared_ptr<const GeometryDataType>> Geometry;
 
+/** \brief Geometry data stored by value in one contiguous array. */
+typedef std::vector<GeometryDataType> FlatGeometry;
+
 void fillGeometry(Geometry &geometry, GeometryInterface &geometryInterface);
+void fillGeometry(FlatGeometry &geometry, GeometryInterface &geometryInterface);
+FlatGeometry flattenGeometry(const Geometry &geometry);
 
 IndexSetType sortIndexSet(const IndexSetType &IndexSet,
                           const Geometry &geometry, int dim);
@@ -4,7 +4,6 @@
 #define HMAT_GEOMETRY_DATA_TYPE_HPP
 
 #include "common.hpp"
-#include "geometry_interface.hpp"
 #include "bounding_box.hpp"
 
 #include <array>
@@ -19,6 +19,19 @@ inline void fillGeometry(Geometry &geometry,
     geometry.push_back(it);
 }
 
+inline void fillGeometry(FlatGeometry &geometry,
+                         GeometryInterface &geometryInterface) {
+  geometryInterface.fill(geometry);
+}
+
+inline FlatGeometry flattenGeometry(const Geometry &geometry) {
+  FlatGeometry result;
+  result.reserve(geometry.size());
+  for (const auto &geometryData : geometry)
+    result.push_back(*geometryData);
+  return result;
+}
+
 inline IndexSetType sortIndexSet(const IndexSetType &indexSet,
                                  const Geometry &geometry, int dim) {
 
@@ -4,17 +4,30 @@
 #define HMAT_GEOMETRY_INTERFACE_HPP
 
 #include "bounding_box.hpp"
+#include "geometry_data_type.hpp"
 #include <array>
+#include <vector>
 
 namespace hmat {
 
-struct GeometryDataType;
-
 class GeometryInterface {
 public:
   virtual shared_ptr<const GeometryDataType> next() = 0;
   virtual std::size_t numberOfEntities() const = 0;
   virtual void reset() = 0;
+
+  /** \brief Write the data of all entities into a contiguous array.
+   *
+   *  The default implementation calls next() for every entity. Derived
+   *  classes should override it to avoid one allocation per entity. */
+  virtual void fill(std::vector<GeometryDataType> &geometry) {
+    reset();
+    geometry.clear();
+    geometry.reserve(numberOfEntities());
+    shared_ptr<const GeometryDataType> it;
+    while ((it = next()))
+      geometry.push_back(*it);
+  }
 };
 }
 
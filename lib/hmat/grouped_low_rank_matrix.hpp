@@ -0,0 +1,116 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_GROUPED_LOW_RANK_MATRIX_HPP
+#define HMAT_GROUPED_LOW_RANK_MATRIX_HPP
+
+#include "common.hpp"
+#include <armadillo>
+#include <cstddef>
+#include <vector>
+
+namespace hmat {
+
+/** \brief Sum of low-rank blocks <tt>A_k * B_k</tt> whose factors are
+ *  grouped by the cluster bases they share.
+ *
+ *  The \p B factors of all blocks with the same column range are stacked
+ *  into one matrix, and the \p A factors of all blocks with the same row
+ *  range are concatenated into another one; every factor is stored once.
+ *  apply() thus forms one matrix product per column range, which yields the
+ *  coefficients of all blocks of that range at once, and one per row range,
+ *  instead of two small products per block. The row and column groups are
+ *  split into bands of overlapping ranges as in BlockSparseMatrix, so that
+ *  different bands are processed in parallel without per-thread result
+ *  buffers.
+ *
+ *  HMatrix::groupLowRankLeaves() uses this class to store all admissible
+ *  leaves of an H-matrix. The indices refer to the H-matrix DOF ordering. */
+template <typename ValueType> class GroupedLowRankMatrix {
+public:
+  struct Block {
+    IndexRangeType rowRange;
+    IndexRangeType columnRange;
+    std::size_t rank;
+  };
+
+  /** \brief Constructor.
+   *
+   *  The factors of block \p i, whose size is given by \p rowRanges[i] and
+   *  \p columnRanges[i], are copied from \p *A[i] and \p *B[i]. The blocks
+   *  must not overlap. */
+  GroupedLowRankMatrix(std::size_t rows, std::size_t columns,
+                       const std::vector<IndexRangeType> &rowRanges,
+                       const std::vector<IndexRangeType> &columnRanges,
+                       const std::vector<const arma::Mat<ValueType> *> &A,
+                       const std::vector<const arma::Mat<ValueType> *> &B);
+
+  std::size_t rows() const;
+  std::size_t columns() const;
+
+  std::size_t numberOfBlocks() const;
+  const std::vector<Block> &blocks() const;
+
+  /** \brief Number of distinct row and column ranges. */
+  std::size_t numberOfRowGroups() const;
+  std::size_t numberOfColumnGroups() const;
+
+  double memSizeKb() const;
+
+  /** \brief Compute <tt>Y += alpha * op(A) * X</tt>.
+   *
+   *  The rows of \p X and \p Y are in H-matrix DOF ordering. */
+  void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+             TransposeMode trans, ValueType alpha) const;
+
+private:
+  // Blocks sharing one row or column range. For a row group the factors
+  // are the A factors side by side, for a column group the B factors one
+  // below the other, in the order of members.
+  struct Group {
+    IndexRangeType range;
+    arma::Mat<ValueType> factors;
+    std::vector<std::size_t> members;
+  };
+  // Position of the factors of a block in its row and column group
+  struct Member {
+    std::size_t rowGroup;
+    std::size_t rowOffset;
+    std::size_t columnGroup;
+    std::size_t columnOffset;
+  };
+
+  static void computeBands(const std::vector<Group> &groups,
+                           std::vector<std::size_t> &bands);
+
+  // Coefficients op(factors of group) * X for every group of one side
+  void computeCoefficients(const std::vector<Group> &groups,
+                           const arma::Mat<ValueType> &X, bool transposed,
+                           bool conjugate,
+                           std::vector<arma::Mat<ValueType>> &coefficients)
+      const;
+  // Y += alpha * op(factors of group) * coefficients of its members for
+  // every group of the other side
+  void addProducts(const std::vector<Group> &groups,
+                   const std::vector<std::size_t> &bands,
+                   const std::vector<arma::Mat<ValueType>> &coefficients,
+                   bool transposed, bool conjugate, ValueType alpha,
+                   arma::Mat<ValueType> &Y) const;
+
+  std::size_t m_rows;
+  std::size_t m_columns;
+  std::vector<Block> m_blocks;
+  std::vector<Member> m_members; // one per block, unused for rank 0
+
+  // Groups sorted by the first index of their range, and the bands as
+  // positions of their first groups; the last element is the number of
+  // groups.
+  std::vector<Group> m_rowGroups;
+  std::vector<std::size_t> m_rowBands;
+  std::vector<Group> m_columnGroups;
+  std::vector<std::size_t> m_columnBands;
+};
+}
+
+#include "grouped_low_rank_matrix_impl.hpp"
+
+#endif
@@ -0,0 +1,255 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_GROUPED_LOW_RANK_MATRIX_IMPL_HPP
+#define HMAT_GROUPED_LOW_RANK_MATRIX_IMPL_HPP
+
+#include "grouped_low_rank_matrix.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType>
+GroupedLowRankMatrix<ValueType>::GroupedLowRankMatrix(
+    std::size_t rows, std::size_t columns,
+    const std::vector<IndexRangeType> &rowRanges,
+    const std::vector<IndexRangeType> &columnRanges,
+    const std::vector<const arma::Mat<ValueType> *> &A,
+    const std::vector<const arma::Mat<ValueType> *> &B)
+    : m_rows(rows), m_columns(columns) {
+
+  if (rowRanges.size() != A.size() || columnRanges.size() != A.size() ||
+      B.size() != A.size())
+    throw std::invalid_argument("GroupedLowRankMatrix::GroupedLowRankMatrix(): "
+                                "Numbers of ranges and factors differ.");
+
+  // Ordered maps number the groups by the first index of their range
+  std::map<IndexRangeType, std::size_t> rowGroupIndices;
+  std::map<IndexRangeType, std::size_t> columnGroupIndices;
+  m_blocks.resize(A.size());
+  for (std::size_t i = 0; i < A.size(); ++i) {
+    Block &block = m_blocks[i];
+    block.rowRange = rowRanges[i];
+    block.columnRange = columnRanges[i];
+    block.rank = A[i]->n_cols;
+    if (A[i]->n_rows != block.rowRange[1] - block.rowRange[0] ||
+        B[i]->n_cols != block.columnRange[1] - block.columnRange[0] ||
+        B[i]->n_rows != block.rank || block.rowRange[1] > rows ||
+        block.columnRange[1] > columns)
+      throw std::invalid_argument(
+          "GroupedLowRankMatrix::GroupedLowRankMatrix(): "
+          "Factors do not match their index ranges.");
+    if (block.rank == 0)
+      continue;
+    rowGroupIndices[block.rowRange] = 0;
+    columnGroupIndices[block.columnRange] = 0;
+  }
+
+  m_rowGroups.resize(rowGroupIndices.size());
+  std::size_t groupIndex = 0;
+  for (auto &elem : rowGroupIndices) {
+    m_rowGroups[groupIndex].range = elem.first;
+    elem.second = groupIndex++;
+  }
+  m_columnGroups.resize(columnGroupIndices.size());
+  groupIndex = 0;
+  for (auto &elem : columnGroupIndices) {
+    m_columnGroups[groupIndex].range = elem.first;
+    elem.second = groupIndex++;
+  }
+
+  std::vector<std::size_t> rowGroupRanks(m_rowGroups.size(), 0);
+  std::vector<std::size_t> columnGroupRanks(m_columnGroups.size(), 0);
+  m_members.resize(m_blocks.size());
+  for (std::size_t i = 0; i < m_blocks.size(); ++i) {
+    const Block &block = m_blocks[i];
+    if (block.rank == 0)
+      continue;
+    Member &member = m_members[i];
+    member.rowGroup = rowGroupIndices[block.rowRange];
+    member.rowOffset = rowGroupRanks[member.rowGroup];
+    rowGroupRanks[member.rowGroup] += block.rank;
+    m_rowGroups[member.rowGroup].members.push_back(i);
+    member.columnGroup = columnGroupIndices[block.columnRange];
+    member.columnOffset = columnGroupRanks[member.columnGroup];
+    columnGroupRanks[member.columnGroup] += block.rank;
+    m_columnGroups[member.columnGroup].members.push_back(i);
+  }
+
+  for (std::size_t g = 0; g < m_rowGroups.size(); ++g) {
+    Group &group = m_rowGroups[g];
+    group.factors.set_size(group.range[1] - group.range[0], rowGroupRanks[g]);
+    for (std::size_t i : group.members)
+      group.factors.cols(m_members[i].rowOffset,
+                         m_members[i].rowOffset + m_blocks[i].rank - 1) =
+          *A[i];
+  }
+  for (std::size_t g = 0; g < m_columnGroups.size(); ++g) {
+    Group &group = m_columnGroups[g];
+    group.factors.set_size(columnGroupRanks[g],
+                           group.range[1] - group.range[0]);
+    for (std::size_t i : group.members)
+      group.factors.rows(m_members[i].columnOffset,
+                         m_members[i].columnOffset + m_blocks[i].rank - 1) =
+          *B[i];
+  }
+
+  computeBands(m_rowGroups, m_rowBands);
+  computeBands(m_columnGroups, m_columnBands);
+}
+
+template <typename ValueType>
+void GroupedLowRankMatrix<ValueType>::computeBands(
+    const std::vector<Group> &groups, std::vector<std::size_t> &bands) {
+
+  // The groups are sorted by the first index of their range; a new band
+  // starts at every group beginning behind all previous ones.
+  bands.clear();
+  std::size_t bandEnd = 0;
+  for (std::size_t g = 0; g < groups.size(); ++g) {
+    const IndexRangeType &range = groups[g].range;
+    if (g == 0 || range[0] >= bandEnd) {
+      bands.push_back(g);
+      bandEnd = range[1];
+    } else
+      bandEnd = std::max(bandEnd, range[1]);
+  }
+  bands.push_back(groups.size());
+}
+
+template <typename ValueType>
+std::size_t GroupedLowRankMatrix<ValueType>::rows() const {
+  return m_rows;
+}
+
+template <typename ValueType>
+std::size_t GroupedLowRankMatrix<ValueType>::columns() const {
+  return m_columns;
+}
+
+template <typename ValueType>
+std::size_t GroupedLowRankMatrix<ValueType>::numberOfBlocks() const {
+  return m_blocks.size();
+}
+
+template <typename ValueType>
+const std::vector<typename GroupedLowRankMatrix<ValueType>::Block> &
+GroupedLowRankMatrix<ValueType>::blocks() const {
+  return m_blocks;
+}
+
+template <typename ValueType>
+std::size_t GroupedLowRankMatrix<ValueType>::numberOfRowGroups() const {
+  return m_rowGroups.size();
+}
+
+template <typename ValueType>
+std::size_t GroupedLowRankMatrix<ValueType>::numberOfColumnGroups() const {
+  return m_columnGroups.size();
+}
+
+template <typename ValueType>
+double GroupedLowRankMatrix<ValueType>::memSizeKb() const {
+  std::size_t elements = 0;
+  for (const auto &group : m_rowGroups)
+    elements += group.factors.n_elem;
+  for (const auto &group : m_columnGroups)
+    elements += group.factors.n_elem;
+  return sizeof(ValueType) * double(elements) / 1024;
+}
+
+template <typename ValueType>
+void GroupedLowRankMatrix<ValueType>::computeCoefficients(
+    const std::vector<Group> &groups, const arma::Mat<ValueType> &X,
+    bool transposed, bool conjugate,
+    std::vector<arma::Mat<ValueType>> &coefficients) const {
+
+  coefficients.resize(groups.size());
+  tbb::parallel_for(std::size_t(0), groups.size(), [&](std::size_t g) {
+    const Group &group = groups[g];
+    const auto x = X.rows(group.range[0], group.range[1] - 1);
+    if (!transposed && !conjugate)
+      coefficients[g] = group.factors * x;
+    else if (!transposed)
+      coefficients[g] = arma::conj(group.factors * arma::conj(x));
+    else if (!conjugate)
+      coefficients[g] = group.factors.st() * x;
+    else
+      coefficients[g] = group.factors.t() * x;
+  });
+}
+
+template <typename ValueType>
+void GroupedLowRankMatrix<ValueType>::addProducts(
+    const std::vector<Group> &groups, const std::vector<std::size_t> &bands,
+    const std::vector<arma::Mat<ValueType>> &coefficients, bool transposed,
+    bool conjugate, ValueType alpha, arma::Mat<ValueType> &Y) const {
+
+  // Without transposition the groups are row groups and the coefficients
+  // belong to the column groups, and vice versa
+  tbb::parallel_for(std::size_t(0), bands.size() - 1, [&](std::size_t band) {
+    for (std::size_t g = bands[band]; g < bands[band + 1]; ++g) {
+      const Group &group = groups[g];
+      arma::Mat<ValueType> W(transposed ? group.factors.n_rows
+                                        : group.factors.n_cols,
+                             Y.n_cols);
+      std::size_t offset = 0;
+      for (std::size_t i : group.members) {
+        const Member &member = m_members[i];
+        const std::size_t rank = m_blocks[i].rank;
+        const std::size_t source =
+            transposed ? member.rowGroup : member.columnGroup;
+        const std::size_t sourceOffset =
+            transposed ? member.rowOffset : member.columnOffset;
+        W.rows(offset, offset + rank - 1) = coefficients[source].rows(
+            sourceOffset, sourceOffset + rank - 1);
+        offset += rank;
+      }
+      auto y = Y.rows(group.range[0], group.range[1] - 1);
+      if (!transposed && !conjugate)
+        y += alpha * (group.factors * W);
+      else if (!transposed)
+        y += alpha * arma::conj(group.factors * arma::conj(W));
+      else if (!conjugate)
+        y += alpha * (group.factors.st() * W);
+      else
+        y += alpha * (group.factors.t() * W);
+    }
+  });
+}
+
+template <typename ValueType>
+void GroupedLowRankMatrix<ValueType>::apply(const arma::Mat<ValueType> &X,
+                                            arma::Mat<ValueType> &Y,
+                                            TransposeMode trans,
+                                            ValueType alpha) const {
+
+  const bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  const bool conjugate =
+      (trans == TransposeMode::CONJ || trans == TransposeMode::CONJTRANS);
+  if (X.n_rows != (transposed ? m_rows : m_columns) ||
+      Y.n_rows != (transposed ? m_columns : m_rows) || X.n_cols != Y.n_cols)
+    throw std::invalid_argument("GroupedLowRankMatrix::apply(): "
+                                "Incompatible matrix dimensions.");
+  if (alpha == ValueType(0) || m_rowGroups.empty())
+    return;
+
+  std::vector<arma::Mat<ValueType>> coefficients;
+  if (!transposed) {
+    computeCoefficients(m_columnGroups, X, false, conjugate, coefficients);
+    addProducts(m_rowGroups, m_rowBands, coefficients, false, conjugate,
+                alpha, Y);
+  } else {
+    computeCoefficients(m_rowGroups, X, true, conjugate, coefficients);
+    addProducts(m_columnGroups, m_columnBands, coefficients, true, conjugate,
+                alpha, Y);
+  }
+}
+}
+
+#endif
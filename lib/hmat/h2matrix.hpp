@@ -0,0 +1,158 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_H2MATRIX_HPP
+#define HMAT_H2MATRIX_HPP
+
+#include "common.hpp"
+#include "block_cluster_tree.hpp"
+#include "compressed_matrix.hpp"
+#include "hmatrix.hpp"
+#include <armadillo>
+#include <unordered_map>
+#include <vector>
+
+namespace hmat {
+
+/** \brief H²-matrix with nested cluster bases.
+ *
+ *  Every admissible block \f$t \times s\f$ is represented as
+ *  \f$V_t S_{ts} W_s^H\f$ with a row cluster basis \f$V_t\f$, a column
+ *  cluster basis \f$W_s\f$ and a small coupling matrix \f$S_{ts}\f$. The
+ *  bases are nested: the basis of a non-leaf cluster is given by the bases
+ *  of its sons and small transfer matrices, so only leaf clusters store
+ *  explicit bases. For bounded cluster ranks the storage is O(N) instead of
+ *  the O(N log N) of an H-matrix.
+ *
+ *  The H²-matrix is built algebraically from an assembled H-matrix on the
+ *  same block cluster tree. The bases are computed bottom-up by truncated
+ *  SVDs of the weighted low-rank factors of all blocks in which a cluster
+ *  or one of its ancestors occurs. Every block is normalized to unit norm
+ *  first, so that each one is approximated to a relative accuracy of about
+ *  \p eps. Dense leaves are copied unchanged.
+ *
+ *  Matrix-vector products use a forward transformation of the input into
+ *  basis coefficients, the coupling matrices and a backward transformation
+ *  into the output vector. */
+template <typename ValueType, int N>
+class H2Matrix : public CompressedMatrix<ValueType> {
+public:
+  /** \brief Convert an H-matrix, which must not be frozen.
+   *
+   *  \p maxThreadCount is either a positive number or -1, in which case the
+   *  number of threads is chosen automatically by TBB. */
+  H2Matrix(const HMatrix<ValueType, N> &hMatrix, double eps,
+           int maxThreadCount = -1);
+
+  std::size_t rows() const override;
+  std::size_t columns() const override;
+
+  double memSizeKb() const;
+
+  /** \brief Largest rank of all row and column cluster bases. */
+  std::size_t maxBasisRank() const;
+
+  shared_ptr<const BlockClusterTree<N>> blockClusterTree() const;
+
+  void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+             TransposeMode trans, ValueType alpha, ValueType beta) const
+      override;
+
+  /** \brief Apply the matrix to vectors given in H-matrix DOF ordering;
+   *  see HMatrix::applyPermuted(). */
+  void applyPermuted(const arma::Mat<ValueType> &xPermuted,
+                     arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+                     ValueType alpha, ValueType beta) const;
+
+  arma::Mat<ValueType> permuteMatToHMatDofs(const arma::Mat<ValueType> &mat,
+                                            RowColSelector rowOrColumn) const
+      override;
+  arma::Mat<ValueType>
+  permuteMatToOriginalDofs(const arma::Mat<ValueType> &mat,
+                           RowColSelector rowOrColumn) const override;
+
+private:
+  struct ClusterBasis {
+    IndexRangeType indexRange;
+    std::size_t index; // position of the coefficients used in apply()
+    std::size_t rank;
+    arma::Mat<ValueType> basis;                 // leaves only
+    std::vector<arma::Mat<ValueType>> transfer; // one per son
+    std::vector<shared_ptr<ClusterBasis>> sons;
+
+    // Blocks in which this cluster is the row (column) cluster of a row
+    // (column) basis
+    std::vector<std::size_t> couplingBlocks;
+    std::vector<std::size_t> denseBlocks;
+  };
+
+  struct CouplingBlock {
+    const ClusterBasis *rowBasis;
+    const ClusterBasis *columnBasis;
+    arma::Mat<ValueType> coupling;
+  };
+
+  struct DenseBlock {
+    IndexRangeType rowRange;
+    IndexRangeType columnRange;
+    arma::Mat<ValueType> data;
+  };
+
+  // Factor whose column space a cluster basis must represent (inBasis), or
+  // which only has to be projected onto the basis. Row 0 of the matrix
+  // corresponds to the index firstIndex.
+  struct Contribution {
+    const arma::Mat<ValueType> *matrix;
+    std::size_t firstIndex;
+    bool inBasis;
+  };
+
+  typedef std::unordered_map<const ClusterTreeNode<N> *,
+                             std::vector<std::size_t>> BlockListMap;
+  typedef std::unordered_map<const ClusterTreeNode<N> *, ClusterBasis *>
+  ClusterBasisMap;
+
+  shared_ptr<ClusterBasis>
+  buildClusterBasis(const shared_ptr<const ClusterTreeNode<N>> &clusterNode,
+                    const std::vector<Contribution> &inherited,
+                    const BlockListMap &ownBlocks,
+                    const std::vector<arma::Mat<ValueType>> &weights,
+                    const std::vector<arma::Mat<ValueType>> &factors,
+                    std::vector<arma::Mat<ValueType>> &projectedFactors,
+                    std::vector<arma::Mat<ValueType>> &inheritedProjections)
+      const;
+
+  arma::Mat<ValueType> truncatedBasis(const arma::Mat<ValueType> &M) const;
+
+  static void indexClusterBasis(
+      const shared_ptr<const ClusterTreeNode<N>> &clusterNode,
+      const shared_ptr<ClusterBasis> &basis, ClusterBasisMap &basisMap,
+      std::size_t &count);
+
+  void forwardTransformation(const ClusterBasis &basis,
+                             const arma::Mat<ValueType> &x,
+                             std::vector<arma::Mat<ValueType>> &xHat) const;
+  void backwardTransformation(const ClusterBasis &basis, bool adjoint,
+                              const arma::Mat<ValueType> &x,
+                              const std::vector<arma::Mat<ValueType>> &xHat,
+                              std::vector<arma::Mat<ValueType>> &yHat,
+                              arma::Mat<ValueType> &y) const;
+
+  static double memSizeKbImpl(const ClusterBasis &basis);
+  static std::size_t maxBasisRankImpl(const ClusterBasis &basis);
+
+  shared_ptr<const BlockClusterTree<N>> m_blockClusterTree;
+  double m_eps;
+
+  shared_ptr<ClusterBasis> m_rowBasis;
+  shared_ptr<ClusterBasis> m_columnBasis;
+  std::size_t m_numberOfRowBases;
+  std::size_t m_numberOfColumnBases;
+
+  std::vector<CouplingBlock> m_couplingBlocks;
+  std::vector<DenseBlock> m_denseBlocks;
+};
+}
+
+#include "h2matrix_impl.hpp"
+
+#endif
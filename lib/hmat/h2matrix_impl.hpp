@@ -0,0 +1,518 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_H2MATRIX_IMPL_HPP
+#define HMAT_H2MATRIX_IMPL_HPP
+
+#include "h2matrix.hpp"
+#include "hmatrix_data.hpp"
+#include "hmatrix_dense_data.hpp"
+#include "hmatrix_low_rank_data.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+H2Matrix<ValueType, N>::H2Matrix(const HMatrix<ValueType, N> &hMatrix,
+                                 double eps, int maxThreadCount)
+    : m_blockClusterTree(hMatrix.blockClusterTree()), m_eps(eps),
+      m_numberOfRowBases(0), m_numberOfColumnBases(0) {
+
+  if (hMatrix.isFrozen())
+    throw std::runtime_error("H2Matrix::H2Matrix(): "
+                             "Frozen H-matrices cannot be converted.");
+
+  auto leafNodes = m_blockClusterTree->leafNodes();
+
+  // Factors of the low-rank leaves and their weights, i.e. A R_B^H and
+  // B^H R_A^H with the triangular QR factors of B^H and A, scaled by the
+  // inverse norm of the block. The weights span the same spaces as the
+  // factors, but carry the singular values of the block.
+  std::vector<arma::Mat<ValueType>> rowFactors, columnFactors;
+  std::vector<arma::Mat<ValueType>> rowWeights, columnWeights;
+  BlockListMap rowBlocks, columnBlocks;
+  std::vector<std::pair<const ClusterTreeNode<N> *,
+                        const ClusterTreeNode<N> *>> lowRankClusters;
+  std::vector<std::pair<const ClusterTreeNode<N> *,
+                        const ClusterTreeNode<N> *>> denseClusters;
+
+  for (const auto &leaf : leafNodes) {
+    auto data = hMatrix.leafData(leaf);
+    const auto rowNode = leaf->data().rowClusterTreeNode.get();
+    const auto columnNode = leaf->data().columnClusterTreeNode.get();
+
+    if (auto denseData =
+            dynamic_cast<const HMatrixDenseData<ValueType> *>(data.get())) {
+      DenseBlock block;
+      block.rowRange = rowNode->data().indexRange;
+      block.columnRange = columnNode->data().indexRange;
+      block.data.set_size(denseData->rows(), denseData->cols());
+      denseData->copyValues(block.data.memptr());
+      m_denseBlocks.push_back(block);
+      denseClusters.push_back(std::make_pair(rowNode, columnNode));
+      continue;
+    }
+
+    auto lowRankData =
+        dynamic_cast<const HMatrixLowRankData<ValueType> *>(data.get());
+    if (!lowRankData)
+      throw std::runtime_error("H2Matrix::H2Matrix(): "
+                               "Unsupported type of leaf data.");
+    if (lowRankData->rank() == 0 || lowRankData->frobeniusNorm() == 0)
+      continue;
+
+    std::size_t block = rowFactors.size();
+    if (lowRankData->isSinglePrecision()) {
+      HMatrixLowRankData<ValueType> fullPrecisionData(*lowRankData);
+      fullPrecisionData.convertToFullPrecision();
+      rowFactors.push_back(fullPrecisionData.A());
+      columnFactors.push_back(fullPrecisionData.B().t());
+    } else {
+      rowFactors.push_back(lowRankData->A());
+      columnFactors.push_back(lowRankData->B().t());
+    }
+    lowRankClusters.push_back(std::make_pair(rowNode, columnNode));
+    rowBlocks[rowNode].push_back(block);
+    columnBlocks[columnNode].push_back(block);
+  }
+
+  const std::size_t numberOfLowRankBlocks = rowFactors.size();
+  rowWeights.resize(numberOfLowRankBlocks);
+  columnWeights.resize(numberOfLowRankBlocks);
+
+  // Cluster bases and the projections V_t^H A and W_s^H B^H of the factors
+  std::vector<arma::Mat<ValueType>> rowProjections(numberOfLowRankBlocks);
+  std::vector<arma::Mat<ValueType>> columnProjections(numberOfLowRankBlocks);
+  std::vector<arma::Mat<ValueType>> rootProjections;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, numberOfLowRankBlocks),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          arma::Mat<ValueType> Q, R;
+          for (std::size_t i = r.begin(); i != r.end(); ++i) {
+            arma::qr_econ(Q, R, columnFactors[i]);
+            rowWeights[i] = rowFactors[i] * R.t();
+            arma::qr_econ(Q, R, rowFactors[i]);
+            columnWeights[i] = columnFactors[i] * R.t();
+            const double norm = arma::norm(rowWeights[i], "fro");
+            rowWeights[i] /= norm;
+            columnWeights[i] /= norm;
+          }
+        });
+
+    m_rowBasis = buildClusterBasis(
+        m_blockClusterTree->rowClusterTree()->root(),
+        std::vector<Contribution>(), rowBlocks, rowWeights, rowFactors,
+        rowProjections, rootProjections);
+    m_columnBasis = buildClusterBasis(
+        m_blockClusterTree->columnClusterTree()->root(),
+        std::vector<Contribution>(), columnBlocks, columnWeights,
+        columnFactors, columnProjections, rootProjections);
+  });
+
+  ClusterBasisMap rowBasisMap, columnBasisMap;
+  indexClusterBasis(m_blockClusterTree->rowClusterTree()->root(), m_rowBasis,
+                    rowBasisMap, m_numberOfRowBases);
+  indexClusterBasis(m_blockClusterTree->columnClusterTree()->root(),
+                    m_columnBasis, columnBasisMap, m_numberOfColumnBases);
+
+  m_couplingBlocks.resize(numberOfLowRankBlocks);
+  for (std::size_t i = 0; i < numberOfLowRankBlocks; ++i) {
+    ClusterBasis *rowBasis = rowBasisMap[lowRankClusters[i].first];
+    ClusterBasis *columnBasis = columnBasisMap[lowRankClusters[i].second];
+    m_couplingBlocks[i].rowBasis = rowBasis;
+    m_couplingBlocks[i].columnBasis = columnBasis;
+    m_couplingBlocks[i].coupling = rowProjections[i] * columnProjections[i].t();
+    rowBasis->couplingBlocks.push_back(i);
+    columnBasis->couplingBlocks.push_back(i);
+  }
+
+  for (std::size_t i = 0; i < m_denseBlocks.size(); ++i) {
+    rowBasisMap[denseClusters[i].first]->denseBlocks.push_back(i);
+    columnBasisMap[denseClusters[i].second]->denseBlocks.push_back(i);
+  }
+}
+
+template <typename ValueType, int N>
+shared_ptr<typename H2Matrix<ValueType, N>::ClusterBasis>
+H2Matrix<ValueType, N>::buildClusterBasis(
+    const shared_ptr<const ClusterTreeNode<N>> &clusterNode,
+    const std::vector<Contribution> &inherited, const BlockListMap &ownBlocks,
+    const std::vector<arma::Mat<ValueType>> &weights,
+    const std::vector<arma::Mat<ValueType>> &factors,
+    std::vector<arma::Mat<ValueType>> &projectedFactors,
+    std::vector<arma::Mat<ValueType>> &inheritedProjections) const {
+
+  shared_ptr<ClusterBasis> basis(new ClusterBasis());
+  basis->indexRange = clusterNode->data().indexRange;
+  basis->index = 0;
+  const std::size_t firstIndex = basis->indexRange[0];
+  const std::size_t size = basis->indexRange[1] - basis->indexRange[0];
+
+  // Blocks of this cluster are passed on to the sons, which must represent
+  // their weights and project their factors.
+  std::vector<Contribution> contributions(inherited);
+  std::vector<std::size_t> blocks;
+  auto it = ownBlocks.find(clusterNode.get());
+  if (it != ownBlocks.end()) {
+    blocks = it->second;
+    for (std::size_t block : blocks) {
+      Contribution weight = {&weights[block], firstIndex, true};
+      Contribution factor = {&factors[block], firstIndex, false};
+      contributions.push_back(weight);
+      contributions.push_back(factor);
+    }
+  }
+
+  std::size_t basisColumns = 0;
+  for (const auto &contribution : contributions)
+    if (contribution.inBasis)
+      basisColumns += contribution.matrix->n_cols;
+
+  std::vector<arma::Mat<ValueType>> projections(contributions.size());
+
+  if (clusterNode->isLeaf()) {
+    auto restriction = [&](const Contribution &contribution) {
+      const std::size_t first = firstIndex - contribution.firstIndex;
+      return contribution.matrix->rows(first, first + size - 1);
+    };
+
+    arma::Mat<ValueType> M(size, basisColumns);
+    std::size_t column = 0;
+    for (const auto &contribution : contributions)
+      if (contribution.inBasis && contribution.matrix->n_cols > 0) {
+        M.cols(column, column + contribution.matrix->n_cols - 1) =
+            restriction(contribution);
+        column += contribution.matrix->n_cols;
+      }
+
+    basis->basis = truncatedBasis(M);
+    basis->rank = basis->basis.n_cols;
+    for (std::size_t j = 0; j < contributions.size(); ++j)
+      projections[j] = basis->basis.t() * restriction(contributions[j]);
+  } else {
+    basis->sons.resize(N);
+    std::vector<std::vector<arma::Mat<ValueType>>> sonProjections(N);
+    tbb::parallel_for(0, N, [&](int i) {
+      basis->sons[i] = buildClusterBasis(clusterNode->child(i), contributions,
+                                         ownBlocks, weights, factors,
+                                         projectedFactors, sonProjections[i]);
+    });
+
+    // The sons' projections of a contribution, stacked, represent it in the
+    // union of the son bases. The transfer matrices follow from a truncated
+    // basis of their column space.
+    std::vector<std::size_t> sonOffsets(N + 1, 0);
+    for (int i = 0; i < N; ++i)
+      sonOffsets[i + 1] = sonOffsets[i] + basis->sons[i]->rank;
+
+    std::vector<arma::Mat<ValueType>> stacked(contributions.size());
+    for (std::size_t j = 0; j < contributions.size(); ++j) {
+      stacked[j].set_size(sonOffsets[N], contributions[j].matrix->n_cols);
+      for (int i = 0; i < N; ++i)
+        if (basis->sons[i]->rank > 0)
+          stacked[j].rows(sonOffsets[i], sonOffsets[i + 1] - 1) =
+              sonProjections[i][j];
+    }
+
+    arma::Mat<ValueType> M(sonOffsets[N], basisColumns);
+    std::size_t column = 0;
+    for (std::size_t j = 0; j < contributions.size(); ++j)
+      if (contributions[j].inBasis && stacked[j].n_cols > 0) {
+        M.cols(column, column + stacked[j].n_cols - 1) = stacked[j];
+        column += stacked[j].n_cols;
+      }
+
+    arma::Mat<ValueType> E = truncatedBasis(M);
+    basis->rank = E.n_cols;
+    basis->transfer.resize(N);
+    for (int i = 0; i < N; ++i)
+      if (basis->sons[i]->rank > 0)
+        basis->transfer[i] = E.rows(sonOffsets[i], sonOffsets[i + 1] - 1);
+      else
+        basis->transfer[i].set_size(0, basis->rank);
+    for (std::size_t j = 0; j < contributions.size(); ++j)
+      projections[j] = E.t() * stacked[j];
+  }
+
+  // Every block belongs to exactly one cluster, so that the writes into
+  // projectedFactors of concurrently built sons never collide.
+  for (std::size_t k = 0; k < blocks.size(); ++k)
+    projectedFactors[blocks[k]] = projections[inherited.size() + 2 * k + 1];
+
+  projections.resize(inherited.size());
+  inheritedProjections.swap(projections);
+  return basis;
+}
+
+template <typename ValueType, int N>
+arma::Mat<ValueType>
+H2Matrix<ValueType, N>::truncatedBasis(const arma::Mat<ValueType> &M) const {
+
+  if (M.n_rows == 0 || M.n_cols == 0)
+    return arma::Mat<ValueType>(M.n_rows, 0);
+
+  arma::Mat<ValueType> U, V;
+  arma::Col<typename ScalarTraits<ValueType>::RealType> s;
+  arma::svd_econ(U, s, V, M, "left");
+
+  // Smallest rank whose discarded singular values have squared sum below
+  // eps^2. The contributions are normalized, so this bounds the relative
+  // error of each block.
+  std::size_t rank = s.n_rows;
+  double tail = 0;
+  while (rank > 0) {
+    double next = tail + double(s(rank - 1)) * double(s(rank - 1));
+    if (next > m_eps * m_eps)
+      break;
+    tail = next;
+    --rank;
+  }
+
+  if (rank == 0)
+    return arma::Mat<ValueType>(M.n_rows, 0);
+  return U.cols(0, rank - 1);
+}
+
+template <typename ValueType, int N>
+void H2Matrix<ValueType, N>::indexClusterBasis(
+    const shared_ptr<const ClusterTreeNode<N>> &clusterNode,
+    const shared_ptr<ClusterBasis> &basis, ClusterBasisMap &basisMap,
+    std::size_t &count) {
+
+  basis->index = count++;
+  basisMap[clusterNode.get()] = basis.get();
+  for (std::size_t i = 0; i < basis->sons.size(); ++i)
+    indexClusterBasis(clusterNode->child(i), basis->sons[i], basisMap, count);
+}
+
+template <typename ValueType, int N>
+std::size_t H2Matrix<ValueType, N>::rows() const {
+  return m_blockClusterTree->rows();
+}
+
+template <typename ValueType, int N>
+std::size_t H2Matrix<ValueType, N>::columns() const {
+  return m_blockClusterTree->columns();
+}
+
+template <typename ValueType, int N>
+double H2Matrix<ValueType, N>::memSizeKbImpl(const ClusterBasis &basis) {
+
+  double result = basis.basis.n_elem * sizeof(ValueType) / 1024.0;
+  for (const auto &transfer : basis.transfer)
+    result += transfer.n_elem * sizeof(ValueType) / 1024.0;
+  for (const auto &son : basis.sons)
+    result += memSizeKbImpl(*son);
+  return result;
+}
+
+template <typename ValueType, int N>
+double H2Matrix<ValueType, N>::memSizeKb() const {
+
+  double result = memSizeKbImpl(*m_rowBasis) + memSizeKbImpl(*m_columnBasis);
+  for (const auto &block : m_couplingBlocks)
+    result += block.coupling.n_elem * sizeof(ValueType) / 1024.0;
+  for (const auto &block : m_denseBlocks)
+    result += block.data.n_elem * sizeof(ValueType) / 1024.0;
+  return result;
+}
+
+template <typename ValueType, int N>
+std::size_t
+H2Matrix<ValueType, N>::maxBasisRankImpl(const ClusterBasis &basis) {
+
+  std::size_t result = basis.rank;
+  for (const auto &son : basis.sons)
+    result = std::max(result, maxBasisRankImpl(*son));
+  return result;
+}
+
+template <typename ValueType, int N>
+std::size_t H2Matrix<ValueType, N>::maxBasisRank() const {
+  return std::max(maxBasisRankImpl(*m_rowBasis),
+                  maxBasisRankImpl(*m_columnBasis));
+}
+
+template <typename ValueType, int N>
+shared_ptr<const BlockClusterTree<N>>
+H2Matrix<ValueType, N>::blockClusterTree() const {
+  return m_blockClusterTree;
+}
+
+template <typename ValueType, int N>
+void H2Matrix<ValueType, N>::forwardTransformation(
+    const ClusterBasis &basis, const arma::Mat<ValueType> &x,
+    std::vector<arma::Mat<ValueType>> &xHat) const {
+
+  if (basis.sons.empty()) {
+    xHat[basis.index] =
+        basis.basis.t() *
+        x.rows(basis.indexRange[0], basis.indexRange[1] - 1);
+    return;
+  }
+
+  tbb::parallel_for(std::size_t(0), basis.sons.size(), [&](std::size_t i) {
+    forwardTransformation(*basis.sons[i], x, xHat);
+  });
+
+  xHat[basis.index].zeros(basis.rank, x.n_cols);
+  for (std::size_t i = 0; i < basis.sons.size(); ++i)
+    if (basis.sons[i]->rank > 0)
+      xHat[basis.index] += basis.transfer[i].t() * xHat[basis.sons[i]->index];
+}
+
+template <typename ValueType, int N>
+void H2Matrix<ValueType, N>::backwardTransformation(
+    const ClusterBasis &basis, bool adjoint, const arma::Mat<ValueType> &x,
+    const std::vector<arma::Mat<ValueType>> &xHat,
+    std::vector<arma::Mat<ValueType>> &yHat, arma::Mat<ValueType> &y) const {
+
+  // yHat of this cluster already contains the contributions of the
+  // ancestors. Every task writes only into the rows of its own cluster.
+  arma::Mat<ValueType> &coefficients = yHat[basis.index];
+  for (std::size_t k : basis.couplingBlocks) {
+    const auto &block = m_couplingBlocks[k];
+    if (adjoint)
+      coefficients += block.coupling.t() * xHat[block.rowBasis->index];
+    else
+      coefficients += block.coupling * xHat[block.columnBasis->index];
+  }
+
+  for (std::size_t k : basis.denseBlocks) {
+    const auto &block = m_denseBlocks[k];
+    if (adjoint)
+      y.rows(block.columnRange[0], block.columnRange[1] - 1) +=
+          block.data.t() *
+          x.rows(block.rowRange[0], block.rowRange[1] - 1);
+    else
+      y.rows(block.rowRange[0], block.rowRange[1] - 1) +=
+          block.data *
+          x.rows(block.columnRange[0], block.columnRange[1] - 1);
+  }
+
+  if (basis.sons.empty()) {
+    if (basis.rank > 0)
+      y.rows(basis.indexRange[0], basis.indexRange[1] - 1) +=
+          basis.basis * coefficients;
+    return;
+  }
+
+  for (std::size_t i = 0; i < basis.sons.size(); ++i)
+    yHat[basis.sons[i]->index] = basis.transfer[i] * coefficients;
+
+  tbb::parallel_for(std::size_t(0), basis.sons.size(), [&](std::size_t i) {
+    backwardTransformation(*basis.sons[i], adjoint, x, xHat, yHat, y);
+  });
+}
+
+template <typename ValueType, int N>
+void H2Matrix<ValueType, N>::apply(const arma::Mat<ValueType> &X,
+                                   arma::Mat<ValueType> &Y,
+                                   TransposeMode trans, ValueType alpha,
+                                   ValueType beta) const {
+
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  RowColSelector inputSelector = transposed ? ROW : COL;
+  RowColSelector outputSelector = transposed ? COL : ROW;
+
+  arma::Mat<ValueType> xPermuted = permuteMatToHMatDofs(X, inputSelector);
+  arma::Mat<ValueType> yPermuted;
+  if (beta == ValueType(0))
+    yPermuted.zeros(Y.n_rows, Y.n_cols);
+  else
+    yPermuted = permuteMatToHMatDofs(Y, outputSelector);
+
+  applyPermuted(xPermuted, yPermuted, trans, alpha, beta);
+
+  Y = permuteMatToOriginalDofs(yPermuted, outputSelector);
+}
+
+template <typename ValueType, int N>
+void H2Matrix<ValueType, N>::applyPermuted(
+    const arma::Mat<ValueType> &xPermuted, arma::Mat<ValueType> &yPermuted,
+    TransposeMode trans, ValueType alpha, ValueType beta) const {
+
+  if (beta == ValueType(0))
+    yPermuted.zeros();
+  else if (beta != ValueType(1))
+    yPermuted *= beta;
+
+  // TRANS and CONJ are computed as CONJTRANS and NOTRANS applied to the
+  // conjugated input, with the result conjugated again.
+  const bool adjoint =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  const bool conjugate =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJ);
+
+  const ClusterBasis &inputBasis = adjoint ? *m_rowBasis : *m_columnBasis;
+  const ClusterBasis &outputBasis = adjoint ? *m_columnBasis : *m_rowBasis;
+  const std::size_t numberOfInputBases =
+      adjoint ? m_numberOfRowBases : m_numberOfColumnBases;
+  const std::size_t numberOfOutputBases =
+      adjoint ? m_numberOfColumnBases : m_numberOfRowBases;
+
+  arma::Mat<ValueType> x =
+      conjugate ? arma::Mat<ValueType>(arma::conj(xPermuted)) : xPermuted;
+  arma::Mat<ValueType> y(yPermuted.n_rows, yPermuted.n_cols, arma::fill::zeros);
+
+  std::vector<arma::Mat<ValueType>> xHat(numberOfInputBases);
+  std::vector<arma::Mat<ValueType>> yHat(numberOfOutputBases);
+  forwardTransformation(inputBasis, x, xHat);
+  yHat[outputBasis.index].zeros(outputBasis.rank, x.n_cols);
+  backwardTransformation(outputBasis, adjoint, x, xHat, yHat, y);
+
+  if (conjugate)
+    yPermuted += alpha * arma::Mat<ValueType>(arma::conj(y));
+  else
+    yPermuted += alpha * y;
+}
+
+template <typename ValueType, int N>
+arma::Mat<ValueType>
+H2Matrix<ValueType, N>::permuteMatToHMatDofs(const arma::Mat<ValueType> &mat,
+                                             RowColSelector rowOrColumn) const {
+
+  shared_ptr<const ClusterTree<N>> clusterTree =
+      (rowOrColumn == ROW) ? m_blockClusterTree->rowClusterTree()
+                           : m_blockClusterTree->columnClusterTree();
+
+  if (clusterTree->numberOfDofs() != mat.n_rows)
+    throw std::runtime_error("H2Matrix::permuteMatToHMatDofs: "
+                             "Input matrix has wrong number of rows.");
+
+  arma::Mat<ValueType> result(mat.n_rows, mat.n_cols);
+  const auto &hMatDofToOriginalDofMap = clusterTree->hMatDofToOriginalDofMap();
+  for (std::size_t j = 0; j < mat.n_cols; ++j)
+    for (std::size_t i = 0; i < mat.n_rows; ++i)
+      result(i, j) = mat(hMatDofToOriginalDofMap[i], j);
+  return result;
+}
+
+template <typename ValueType, int N>
+arma::Mat<ValueType> H2Matrix<ValueType, N>::permuteMatToOriginalDofs(
+    const arma::Mat<ValueType> &mat, RowColSelector rowOrColumn) const {
+
+  shared_ptr<const ClusterTree<N>> clusterTree =
+      (rowOrColumn == ROW) ? m_blockClusterTree->rowClusterTree()
+                           : m_blockClusterTree->columnClusterTree();
+
+  if (clusterTree->numberOfDofs() != mat.n_rows)
+    throw std::runtime_error("H2Matrix::permuteMatToOriginalDofs: "
+                             "Input matrix has wrong number of rows.");
+
+  arma::Mat<ValueType> result(mat.n_rows, mat.n_cols);
+  const auto &hMatDofToOriginalDofMap = clusterTree->hMatDofToOriginalDofMap();
+  for (std::size_t j = 0; j < mat.n_cols; ++j)
+    for (std::size_t i = 0; i < mat.n_rows; ++i)
+      result(hMatDofToOriginalDofMap[i], j) = mat(i, j);
+  return result;
+}
+}
+
+#endif
@@ -5,11 +5,23 @@
 
 #include "common.hpp"
 #include "block_cluster_tree.hpp"
+#include "block_sparse_matrix.hpp"
+#include "grouped_low_rank_matrix.hpp"
 #include "hmatrix_compressor.hpp"
 #include "data_accessor.hpp"
 #include "compressed_matrix.hpp"
+#include "hmatrix_file_format.hpp"
+#include "hmatrix_statistics.hpp"
+#include "leaf_partition.hpp"
+#include "scalar_traits.hpp"
 #include <armadillo>
+#include <cstdint>
 #include <unordered_map>
+#include <utility>
+#include <ostream>
+#include <string>
+#include <tbb/spin_mutex.h>
+#include <vector>
 
 namespace hmat {
 
@@ -18,24 +30,251 @@ template <typename ValueType, int N> class HMatrix;
 
 template <typename ValueType> using DefaultHMatrixType = HMatrix<ValueType, 2>;
 
+/** \brief Summary of an H-matrix recompression pass. */
+struct RecompressionStatistics {
+  std::size_t numberOfLowRankBlocks;
+  std::size_t totalRankBefore;
+  std::size_t totalRankAfter;
+  double memSizeKbBefore;
+  double memSizeKbAfter;
+};
+
+std::ostream &operator<<(std::ostream &os,
+                         const RecompressionStatistics &statistics);
+
 template <typename ValueType, int N>
 class HMatrix : public CompressedMatrix<ValueType> {
 public:
   HMatrix(const shared_ptr<BlockClusterTree<N>> &blockClusterTree);
   HMatrix(const shared_ptr<BlockClusterTree<N>> &blockClusterTree,
-          const HMatrixCompressor<ValueType, N> &hMatrixCompressor);
+          const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+          int maxThreadCount = -1);
+  HMatrix(const shared_ptr<BlockClusterTree<N>> &blockClusterTree,
+          const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+          const LeafPartition<N> &partition, int part,
+          int maxThreadCount = -1);
 
   std::size_t rows() const override;
   std::size_t columns() const override;
 
-  void initialize(const HMatrixCompressor<ValueType, N> &hMatrixCompressor);
+  /** \brief Compress all leaf blocks of the block cluster tree.
+   *
+   *  The leaves are compressed in parallel, largest blocks first. The
+   *  compressor must therefore be safe to call from several threads.
+   *  \p maxThreadCount is either a positive number or -1, in which case the
+   *  number of threads is chosen automatically by TBB. */
+  void initialize(const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+                  int maxThreadCount = -1);
+
+  /** \brief Compress only the leaves owned by \p part of \p partition.
+   *
+   *  The matrix then holds one part of a distributed H-matrix. apply()
+   *  skips the leaves of the other parts, so that the products of all
+   *  parts add up to the product with the whole matrix. */
+  void initialize(const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+                  const LeafPartition<N> &partition, int part,
+                  int maxThreadCount = -1);
+
+  /** \brief Compress all leaves and store their payloads in a scratch file.
+   *
+   *  The leaves are compressed in parallel in batches, whose total dense
+   *  size is at most \p bufferSizeMb megabytes (or a single leaf if that
+   *  is larger), and the payloads of every batch are appended to a file
+   *  created in \p scratchDirectory before the next batch is started. The
+   *  file is then mapped into memory, so the matrix can exceed the RAM.
+   *  The matrix is frozen; apply() reads the payloads ahead of every
+   *  thread. As in initialize(), the inadmissible
+   *  leaves are compressed first; within each group the leaves are
+   *  ordered by row and column range. The compressor must not return
+   *  low-rank blocks stored in single precision. The file is deleted when
+   *  the matrix is reset or destroyed. */
+  void initializeOutOfCore(
+      const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+      const std::string &scratchDirectory, double bufferSizeMb = 256,
+      int maxThreadCount = -1);
+  /** \brief Compress only the leaves in the lower block triangle of a
+   *  symmetric or Hermitian matrix.
+   *
+   *  The row and column cluster trees must be identical and the block
+   *  cluster tree symmetric. A leaf is stored if its row cluster does not
+   *  precede its column cluster; every other leaf is represented by the
+   *  transpose (\p SYMMETRIC_STORAGE) or the conjugate transpose
+   *  (\p HERMITIAN_STORAGE) of its mirror leaf, see mirrorLeaf(), which
+   *  apply() uses for both contributions. This halves the compression work
+   *  and the memory of the off-diagonal blocks. Such matrices cannot be
+   *  frozen, saved, merged, updated or have their near field extracted,
+   *  but can be factorized by Cholesky (HMatrixLuDecomposition). */
+  void initializeSymmetric(
+      const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+      HMatrixSymmetry symmetry, int maxThreadCount = -1);
+
+  HMatrixSymmetry symmetry() const;
+
+  /** \brief Return the stored leaf whose transpose or conjugate transpose
+   *  represents \p leaf, or \p leaf itself if it is stored.
+   *
+   *  Only leaves in the strictly upper block triangle of matrices with
+   *  symmetric storage are represented by mirror leaves. */
+  shared_ptr<const BlockClusterTreeNode<N>>
+  mirrorLeaf(const shared_ptr<const BlockClusterTreeNode<N>> &leaf) const;
+
   bool isInitialized() const;
   void reset();
 
+  /** \brief Convert the matrix to the frozen leaf layout.
+   *
+   *  The leaf blocks are moved into a contiguous array sorted by row range,
+   *  with their index ranges stored inline, and all dense and low-rank
+   *  payloads are packed into a single allocation. This removes the pointer
+   *  chasing from apply(). The per-node leaf data is released, so a frozen
+   *  matrix can only be applied or reset. */
+  void freeze();
+  bool isFrozen() const;
+
+  /** \brief Move all inadmissible dense leaves into one block-sparse matrix.
+   *
+   *  The near-field blocks are then no longer stored in the tree but in
+   *  nearField(), whose product is formed with a single pass over
+   *  contiguous memory and added to that of the remaining leaves by
+   *  apply(). Must be called before freeze(). Afterwards the matrix cannot
+   *  be saved, and leafData() only returns the admissible leaves, so it
+   *  can be neither converted to an H2-matrix nor LU-decomposed. */
+  void extractNearField();
+
+  /** \brief Return the near field moved out of the tree by
+   *  extractNearField(), or a null pointer if it has not been called. */
+  shared_ptr<const BlockSparseMatrix<ValueType>> nearField() const;
+
+  /** \brief Apply only the near field to vectors in original DOF ordering.
+   *
+   *  The near field holds the interactions of neighbouring DOFs and can be
+   *  used to build preconditioners. Requires extractNearField(). */
+  void applyNearField(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+                      TransposeMode trans, ValueType alpha,
+                      ValueType beta) const;
+
+  /** \brief Move all low-rank leaves into one matrix grouping their factors
+   *  by row and column cluster.
+   *
+   *  The leaves are then no longer stored in the tree but in
+   *  lowRankGroups(), whose product is formed with one matrix product per
+   *  row and per column cluster and added to that of the remaining leaves
+   *  by apply(). Leaves already stored in single precision stay in the
+   *  tree. Must be called before freeze(). Afterwards the matrix cannot be
+   *  saved, and leafData() only returns the remaining leaves, so it can be
+   *  neither converted to an H2-matrix nor LU-decomposed. */
+  void groupLowRankLeaves();
+
+  /** \brief Return the low-rank leaves moved out of the tree by
+   *  groupLowRankLeaves(), or a null pointer if it has not been called. */
+  shared_ptr<const GroupedLowRankMatrix<ValueType>> lowRankGroups() const;
+
+  /** \brief Recompress all low-rank blocks by truncated SVD.
+   *
+   *  The blocks are processed in parallel; see
+   *  HMatrixLowRankData::recompress(). Must be called before freeze(). */
+  RecompressionStatistics recompress(double eps);
+
+  /** \brief Store the factors of all low-rank blocks in single precision.
+   *
+   *  Halves the memory of the low-rank blocks for double precision types.
+   *  The products with the factors are formed in single precision and
+   *  accumulated in \p ValueType; see
+   *  HMatrixLowRankData::convertToSinglePrecision(). Frozen matrices keep
+   *  the storage precision of their blocks. */
+  void convertLowRankBlocksToSinglePrecision();
+
+  /** \brief Store all dense blocks with a fixed-rate lossy codec.
+   *
+   *  Every real value is coded with \p bitsPerValue bits (8, 16, 24 or 32)
+   *  relative to the largest magnitude of its group; see
+   *  HMatrixDenseData::compress(). For double precision types 16 bits
+   *  reduce the memory of the dense blocks by a factor of four at a
+   *  relative error of about \f$10^{-5}\f$ per entry. The blocks are
+   *  decoded on the fly in apply(). Freezing, saving and extracting the
+   *  near field store the decoded blocks, so the savings only persist in
+   *  the unfrozen layout. */
+  void compressDenseBlocks(int bitsPerValue);
+
+  /** \brief Write the matrix to a binary file.
+   *
+   *  The file contains the row and column cluster trees with their DOF
+   *  permutations, the block cluster tree and all leaf payloads in frozen
+   *  layout; see hmatrix_file_format.hpp. Frozen and unfrozen matrices can
+   *  be saved. */
+  void save(const std::string &fileName) const;
+
+  /** \brief Read a matrix written by save().
+   *
+   *  The returned matrix is frozen. If \p memoryMap is true, the file is
+   *  mapped into memory and the payloads are used in place; otherwise it is
+   *  read into a single heap buffer. Files written with another format
+   *  version, value type or branching factor, and files whose checksum does
+   *  not match, are rejected with an exception. */
+  static shared_ptr<HMatrix<ValueType, N>> load(const std::string &fileName,
+                                                bool memoryMap = true);
+
+  /** \brief Merge a square array of H-matrices into a single H-matrix.
+   *
+   *  \p blocks[i][j] is the block in block row \p i and block column \p j;
+   *  a null pointer stands for a zero block. The number of block rows must
+   *  be a power of \p N. All blocks of a block row (column) must be built
+   *  on the same row (column) cluster tree, and every block row and column
+   *  must contain at least one block. The cluster trees of the result join
+   *  those of the block rows and columns, and the block cluster trees of
+   *  the blocks become subtrees of the new block cluster tree, so that the
+   *  result can be LU-decomposed as a whole. The leaf data are copied, one
+   *  task per block; frozen blocks, parts of distributed matrices and
+   *  blocks with an extracted near field are rejected. */
+  static shared_ptr<HMatrix<ValueType, N>>
+  merge(const std::vector<std::vector<shared_ptr<const HMatrix<ValueType, N>>>>
+            &blocks,
+        int maxThreadCount = -1);
+
+  /** \brief Return a copy of the matrix in which the given leaves are
+   *  compressed anew.
+   *
+   *  The copy is built on the same block cluster tree. The data of all the
+   *  other leaves are shared with this matrix, so updating a few leaves
+   *  costs only their compression. The leaves are compressed as by
+   *  initialize(). Frozen matrices, parts of distributed matrices and
+   *  matrices with an extracted near field are rejected. */
+  shared_ptr<HMatrix<ValueType, N>> withUpdatedLeaves(
+      const std::vector<shared_ptr<const BlockClusterTreeNode<N>>> &leafNodes,
+      const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+      int maxThreadCount = -1) const;
+
+  shared_ptr<const BlockClusterTree<N>> blockClusterTree() const;
+
+  /** \brief Return the block structure and storage statistics.
+   *
+   *  The compression time of every block is recorded by initialize(); it is
+   *  unknown (0) for matrices read by load(). The number of accessed
+   *  entries is not known to the H-matrix and left at 0. */
+  HMatrixStatistics statistics() const;
+
+  /** \brief Return the data stored for a leaf of the block cluster tree.
+   *
+   *  Not available for frozen matrices, nor for the leaves of matrices with
+   *  symmetric storage that are represented by a mirror leaf. */
+  shared_ptr<const HMatrixData<ValueType>>
+  leafData(const shared_ptr<const BlockClusterTreeNode<N>> &leaf) const;
+
   void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
              TransposeMode trans, ValueType alpha, ValueType beta) const
       override;
 
+  /** \brief Apply the matrix to vectors given in H-matrix DOF ordering.
+   *
+   *  The rows of \p xPermuted and \p yPermuted are expected to be ordered
+   *  as the H-matrix DOFs of the respective cluster trees, so no
+   *  permutation is performed. Iterative solvers can permute the right-hand
+   *  side once with permuteMatToHMatDofs(), solve in H-matrix ordering and
+   *  permute the solution back with permuteMatToOriginalDofs(). */
+  void applyPermuted(const arma::Mat<ValueType> &xPermuted,
+                     arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+                     ValueType alpha, ValueType beta) const;
+
   arma::Mat<ValueType> permuteMatToHMatDofs(const arma::Mat<ValueType> &mat,
                                             RowColSelector rowOrColumn) const
       override;
@@ -43,10 +282,154 @@ public:
   permuteMatToOriginalDofs(const arma::Mat<ValueType> &mat,
                            RowColSelector rowOrColumn) const override;
 
+  /** \brief Versions of the permutation functions writing into an existing
+   *  matrix, whose memory is reused if it already has the right size. */
+  void permuteMatToHMatDofs(const arma::Mat<ValueType> &mat,
+                            RowColSelector rowOrColumn,
+                            arma::Mat<ValueType> &result) const;
+  void permuteMatToOriginalDofs(const arma::Mat<ValueType> &mat,
+                                RowColSelector rowOrColumn,
+                                arma::Mat<ValueType> &result) const;
+
 private:
+  typedef typename ScalarTraits<ValueType>::SinglePrecisionType
+  SinglePrecisionType;
+
+  /** \brief Permutation buffers checked out of m_applyBufferPool for the
+   *  duration of one call of apply() or applyNearField().
+   *
+   *  Threads waiting in the nested parallel loops of a product may start
+   *  another product of the same matrix, so the buffers cannot be owned by
+   *  the calling thread. */
+  class ApplyBuffers {
+  public:
+    explicit ApplyBuffers(const HMatrix &hMatrix);
+    ~ApplyBuffers();
+
+    arma::Mat<ValueType> x;
+    arma::Mat<ValueType> y;
+
+  private:
+    ApplyBuffers(const ApplyBuffers &);
+    ApplyBuffers &operator=(const ApplyBuffers &);
+
+    const HMatrix &m_hMatrix;
+  };
+
+  void compressLeaves(std::vector<shared_ptr<BlockClusterTreeNode<N>>> leafNodes,
+                      const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+                      int maxThreadCount);
+
+  struct FrozenLeaf {
+    IndexRangeType rowRange;
+    IndexRangeType columnRange;
+    bool lowRank;
+    bool singlePrecision;
+    std::size_t rank;
+    std::size_t offset; // position of the payload in m_frozenPool, or in
+                        // m_frozenSinglePrecisionPool if singlePrecision
+  };
+
+  typedef std::unordered_map<const ClusterTreeNode<N> *, std::uint64_t>
+  ClusterNodeIndexMap;
+
+  void computeFrozenLayout(
+      std::vector<FrozenLeaf> &frozenLeaves,
+      std::vector<shared_ptr<HMatrixData<ValueType>>> &leafData,
+      std::size_t &poolSize, std::size_t &singlePrecisionPoolSize) const;
+
+  static void saveClusterTree(HMatrixFileWriter &writer,
+                              const ClusterTree<N> &clusterTree,
+                              ClusterNodeIndexMap &nodeIndices);
+  static shared_ptr<const ClusterTree<N>>
+  loadClusterTree(HMatrixFileReader &reader,
+                  std::vector<shared_ptr<const ClusterTreeNode<N>>> &nodes);
+
+  typedef std::unordered_map<const ClusterTreeNode<N> *,
+                             shared_ptr<const ClusterTreeNode<N>>>
+  ClusterNodeMap;
+
+  static shared_ptr<const ClusterTree<N>>
+  mergeClusterTrees(const std::vector<shared_ptr<const ClusterTree<N>>> &
+                        clusterTrees,
+                    std::vector<ClusterNodeMap> &nodeMaps);
+
+  static std::size_t frozenPayloadSize(const FrozenLeaf &leaf);
+  static std::size_t frozenPayloadBytes(const FrozenLeaf &leaf);
+  const void *frozenPayload(const FrozenLeaf &leaf) const;
+
+  // Order in which applyFrozen() traverses the frozen leaves for one side
+  // of the output. The short leaves are sorted by the first index of their
+  // output range and split into bands of overlapping output ranges, so that
+  // different bands can write to the output in parallel; a leaf is short
+  // if it is small enough to leave a few bands per thread. Long leaves are
+  // applied one after the other, each split into chunks of output indices.
+  struct FrozenApplySchedule {
+    std::vector<std::size_t> shortLeaves;
+    // Positions in shortLeaves of the first leaf of every band, followed
+    // by the number of short leaves
+    std::vector<std::size_t> bands;
+    std::vector<std::size_t> longLeaves;
+  };
+
+  static void computeFrozenApplySchedule(
+      const std::vector<FrozenLeaf> &frozenLeaves, bool byColumns,
+      std::size_t outputSize, FrozenApplySchedule &schedule);
+  void computeFrozenApplySchedules();
+
+  void applyFrozen(const arma::Mat<ValueType> &xPermuted,
+                   arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+                   ValueType alpha) const;
+  void applyFrozenLeaf(const FrozenLeaf &leaf,
+                       const arma::Mat<ValueType> &xPermuted,
+                       arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+                       ValueType alpha) const;
+  void applyLongFrozenLeaf(const FrozenLeaf &leaf,
+                           const arma::Mat<ValueType> &xPermuted,
+                           arma::Mat<ValueType> &yPermuted,
+                           TransposeMode trans, ValueType alpha) const;
+
+  void checkGeneralStorage(const char *function) const;
+  TransposeMode mirrorTransposeMode(TransposeMode trans) const;
+
+  void applyImpl(std::size_t nodeIndex, const arma::Mat<ValueType> &xPermuted,
+                 arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+                 ValueType alpha) const;
+
   shared_ptr<BlockClusterTree<N>> m_blockClusterTree;
   std::unordered_map<shared_ptr<BlockClusterTreeNode<N>>,
                      shared_ptr<HMatrixData<ValueType>>> m_hMatrixData;
+  std::unordered_map<shared_ptr<BlockClusterTreeNode<N>>, double>
+  m_assemblyTimes; // in seconds
+  // Data of the leaves by their number in the tree index of the block
+  // cluster tree; null for non-leaves and leaves stored by other parts
+  std::vector<HMatrixData<ValueType> *> m_nodeData;
+
+  HMatrixSymmetry m_symmetry;
+  // Stored leaves representing the leaves of the strictly upper block
+  // triangle by their number in the tree index; null for all other nodes
+  // and empty for general storage
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> m_mirrorLeaves;
+
+  shared_ptr<BlockSparseMatrix<ValueType>> m_nearField;
+  shared_ptr<GroupedLowRankMatrix<ValueType>> m_lowRankGroups;
+
+  std::vector<FrozenLeaf> m_frozenLeaves;
+  FrozenApplySchedule m_frozenRowSchedule;    // for products with op(A) = A
+  FrozenApplySchedule m_frozenColumnSchedule; // and with transposes
+  shared_ptr<const void> m_frozenStorage; // owns the memory of both pools
+  const ValueType *m_frozenPool;
+  std::size_t m_frozenPoolSize;
+  const SinglePrecisionType *m_frozenSinglePrecisionPool;
+  std::size_t m_frozenSinglePrecisionPoolSize;
+  // True if the pools are file mappings whose pages apply() reads ahead
+  bool m_frozenPoolMapped;
+
+  // Permutation buffers reused between calls of apply(); a pair is only in
+  // the pool while no call uses it
+  mutable std::vector<std::pair<arma::Mat<ValueType>, arma::Mat<ValueType>>>
+  m_applyBufferPool;
+  mutable tbb::spin_mutex m_applyBufferMutex;
 };
 }
 
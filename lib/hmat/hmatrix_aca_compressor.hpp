@@ -4,39 +4,162 @@
 #define HMAT_HMATRIX_ACA_COMPRESSOR_HPP
 
 #include "common.hpp"
+#include "aca_pivot_table.hpp"
 #include "hmatrix_compressor.hpp"
 #include "hmatrix_dense_compressor.hpp"
 #include "data_accessor.hpp"
-#include <set>
+#include "scalar_traits.hpp"
+#include <vector>
+
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
 
 namespace hmat {
 
+/** \brief Pivoting strategies of the adaptive cross approximation.
+ *
+ *  ACA_PARTIAL_PIVOTING chooses each new pivot row from the largest entry of
+ *  the previously computed column. ACA_PLUS additionally tracks a reference
+ *  row and column, which guards against missing non-zero parts of a block
+ *  that the partially pivoted crosses never touch. Both strategies are
+ *  deterministic. */
+enum AcaPivoting { ACA_PARTIAL_PIVOTING, ACA_PLUS };
+
+/** \brief Treatment of blocks for which ACA reaches the maximum rank
+ *  without converging.
+ *
+ *  ACA_TRUNCATE keeps the approximation of maximum rank, whatever its
+ *  accuracy. ACA_ADAPTIVE evaluates such blocks completely and stores them
+ *  either as a truncated SVD of the rank needed for the requested accuracy
+ *  or densely, whichever takes less memory. */
+enum AcaMaxRankPolicy { ACA_TRUNCATE, ACA_ADAPTIVE };
+
+/** \brief Norm to which the accuracy \p eps of the ACA refers.
+ *
+ *  With ACA_BLOCK_NORM every block is approximated to the relative accuracy
+ *  \p eps. With ACA_MATRIX_NORM the tolerance of a block with m x n entries
+ *  is \f$\epsilon \|M\|_F \sqrt{mn/(\mathrm{rows} \cdot
+ *  \mathrm{columns})}\f$, so that the error of the whole matrix is about
+ *  \f$\epsilon \|M\|_F\f$ and blocks that contribute little to the
+ *  matrix get lower ranks. \f$\|M\|_F\f$ is estimated from the
+ *  inadmissible blocks, which HMatrix::initialize() compresses first. */
+enum AcaAccuracyReference { ACA_BLOCK_NORM, ACA_MATRIX_NORM };
+
+/** \brief Adaptive cross approximation of admissible blocks.
+ *
+ *  With partial pivoting and \p pivotBatchSize > 1, the compressor works as
+ *  a block ACA: the rows belonging to the \p pivotBatchSize largest unused
+ *  entries of a new column are evaluated together by
+ *  DataAccessor::computeMatrixRows() and then used as the next pivot rows,
+ *  after being updated with the crosses added in the meantime. */
 template <typename ValueType, int N>
 class HMatrixAcaCompressor : public HMatrixCompressor<ValueType, N> {
 public:
   HMatrixAcaCompressor(const DataAccessor<ValueType, N> &dataAccessor,
                        double eps, unsigned int maxRank,
-                       unsigned int resizeThreshold = 10);
+                       unsigned int resizeThreshold = 10,
+                       AcaPivoting pivoting = ACA_PARTIAL_PIVOTING,
+                       unsigned int pivotBatchSize = 1,
+                       AcaMaxRankPolicy maxRankPolicy = ACA_TRUNCATE,
+                       AcaAccuracyReference accuracyReference =
+                           ACA_BLOCK_NORM);
 
   void compressBlock(const BlockClusterTreeNode<N> &blockClusterTreeNode,
                      shared_ptr<HMatrixData<ValueType>> &hMatrixData) const
       override;
 
+  /** \brief Warm-start the compression with the pivots of an earlier one
+   *  and record the pivots found by this one.
+   *
+   *  With partial pivoting, the pivot rows stored in \p seedPivots for a
+   *  block, e.g. by the compression of a matrix on the same block cluster
+   *  tree at a nearby wave number, are evaluated first, in one batch, and
+   *  used as the first pivot rows; the factors are preallocated for the
+   *  rank they yielded. The pivot columns are still chosen from the new
+   *  rows and the stopping criterion is unchanged, so the accuracy does not
+   *  depend on the seed; a good seed only saves the evaluation of rows that
+   *  turn out to be poor pivots and the resizing of the factors. Seeds are
+   *  ignored by ACA+.
+   *
+   *  If \p recordedPivots is not null, the pivots chosen for every
+   *  admissible block are stored in it. Either pointer may be null. */
+  void setWarmStart(const shared_ptr<const AcaPivotTable> &seedPivots,
+                    const shared_ptr<AcaPivotTable> &recordedPivots);
+
+  /** \brief Number of admissible blocks for which ACA reached the maximum
+   *  rank without converging. */
+  std::size_t numberOfBlocksAtMaxRank() const;
+
+  /** \brief Number of those blocks that were evaluated completely because
+   *  of ACA_ADAPTIVE. */
+  std::size_t numberOfRecomputedBlocks() const;
+
 private:
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+
+  /** \brief Absolute tolerance for a block with the given number of
+   *  entries under ACA_MATRIX_NORM, or 0 if no norm estimate is available
+   *  yet. */
+  RealType matrixNormTolerance(
+      const BlockClusterTreeNode<N> &blockClusterTreeNode,
+      std::size_t numberOfEntries) const;
+
+  /** \brief Evaluate a whole block and store it as a truncated SVD or
+   *  densely, whichever is smaller. */
+  void compressBlockBySvd(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                          RealType absoluteTolerance,
+                          shared_ptr<HMatrixData<ValueType>> &hMatrixData)
+      const;
+
+  /** \brief Evaluate the given part of the residual M - A * B, where only
+   *  the first \p rank columns of \p A and rows of \p B are used. */
   void evaluateMatMinusLowRank(
       const BlockClusterTreeNode<N> &blockClusterTreeNode,
       const IndexRangeType &rowIndexRange,
       const IndexRangeType &columnIndexRange, arma::Mat<ValueType> &data,
-      const arma::Mat<ValueType> &A, const arma::Mat<ValueType> &B) const;
+      const arma::Mat<ValueType> &A, const arma::Mat<ValueType> &B,
+      std::size_t rank) const;
+
+  /** \brief Evaluate the rows \p rows (relative to the block) of the
+   *  residual M - A * B, using the first \p rank crosses. */
+  void evaluateRowsMinusLowRank(
+      const BlockClusterTreeNode<N> &blockClusterTreeNode,
+      const IndexSetType &rows, arma::Mat<ValueType> &data,
+      const arma::Mat<ValueType> &A, const arma::Mat<ValueType> &B,
+      std::size_t rank) const;
+
+  /** \brief Return the indices of the at most \p count largest entries of
+   *  \p vec in absolute value whose indices are not marked in \p used,
+   *  largest first. */
+  static IndexSetType largestUnused(const arma::Mat<ValueType> &vec,
+                                    const std::vector<bool> &used,
+                                    std::size_t count);
 
-  static std::size_t randomIndex(const IndexRangeType &range,
-                                 std::set<std::size_t> &previousIndices);
+  /** \brief Return the largest absolute value among the entries of \p vec
+   *  whose indices are not marked in \p used, and its index. Returns -1 if
+   *  all indices are used. */
+  static RealType maxAbsUnused(const arma::Mat<ValueType> &vec,
+                               const std::vector<bool> &used,
+                               std::size_t &index);
 
   const DataAccessor<ValueType, N> &m_dataAccessor;
   double m_eps;
   unsigned int m_maxRank;
   unsigned int m_resizeThreshold;
+  AcaPivoting m_pivoting;
+  unsigned int m_pivotBatchSize;
+  AcaMaxRankPolicy m_maxRankPolicy;
+  AcaAccuracyReference m_accuracyReference;
   HMatrixDenseCompressor<ValueType, N> m_hMatrixDenseCompressor;
+  shared_ptr<const AcaPivotTable> m_seedPivots;
+  shared_ptr<AcaPivotTable> m_recordedPivots;
+
+  // Squared Frobenius norm of all inadmissible blocks compressed so far
+  mutable tbb::spin_mutex m_normMutex;
+  mutable double m_inadmissibleNormSquared;
+
+  mutable tbb::atomic<std::size_t> m_numberOfBlocksAtMaxRank;
+  mutable tbb::atomic<std::size_t> m_numberOfRecomputedBlocks;
 };
 }
 
@@ -5,8 +5,8 @@
 
 #include "hmatrix_aca_compressor.hpp"
 #include "hmatrix_low_rank_data.hpp"
+#include "hmatrix_dense_data.hpp"
 #include "scalar_traits.hpp"
-#include <random>
 #include <complex>
 #include <cmath>
 #include <algorithm>
@@ -20,6 +20,11 @@ void HMatrixAcaCompressor<ValueType, N>::compressBlock(
 
   if (!blockClusterTreeNode.data().admissible) {
     m_hMatrixDenseCompressor.compressBlock(blockClusterTreeNode, hMatrixData);
+    if (m_accuracyReference == ACA_MATRIX_NORM) {
+      double norm = hMatrixData->frobeniusNorm();
+      tbb::spin_mutex::scoped_lock lock(m_normMutex);
+      m_inadmissibleNormSquared += norm * norm;
+    }
     return;
   }
 
@@ -32,101 +37,424 @@ void HMatrixAcaCompressor<ValueType, N>::compressBlock(
                                     columnClusterRange, numberOfRows,
                                     numberOfColumns);
 
-  hMatrixData.reset(new HMatrixLowRankData<ValueType>());
-
-  arma::Mat<ValueType> &A =
-      static_cast<HMatrixLowRankData<ValueType> *>(hMatrixData.get())->A();
-
-  arma::Mat<ValueType> &B =
-      static_cast<HMatrixLowRankData<ValueType> *>(hMatrixData.get())->B();
-
-  A.resize(numberOfRows, m_resizeThreshold);
-  B.resize(m_resizeThreshold, numberOfColumns);
+  if (m_dataAccessor.isZeroBlock(blockClusterTreeNode)) {
+    shared_ptr<HMatrixLowRankData<ValueType>> lowRankData(
+        new HMatrixLowRankData<ValueType>());
+    lowRankData->A().zeros(numberOfRows, 0);
+    lowRankData->B().zeros(0, numberOfColumns);
+    hMatrixData = lowRankData;
+    return;
+  }
 
-  std::set<std::size_t> previousRowIndices;
-  std::set<std::size_t> previousColumnIndices;
+  // Absolute tolerance under ACA_MATRIX_NORM; 0 means relative to the block
+  const RealType absoluteTolerance =
+      m_accuracyReference == ACA_MATRIX_NORM
+          ? matrixNormTolerance(blockClusterTreeNode,
+                                numberOfRows * numberOfColumns)
+          : RealType(0);
 
   std::size_t iterationLimit =
       std::min(static_cast<std::size_t>(m_maxRank),
                std::min(numberOfRows, numberOfColumns));
 
-  std::size_t rankCount = 0;
-
-  std::size_t sizeMultiplier = 0;
-
-  for (int i = 0; i < iterationLimit; ++i) {
-
-    std::size_t row = randomIndex(rowClusterRange, previousRowIndices);
+  // Pivot rows of an earlier compression of this block
+  const std::size_t nodeIndex = blockClusterTreeNode.index();
+  IndexSetType seedRows;
+  if (m_seedPivots && m_pivoting == ACA_PARTIAL_PIVOTING &&
+      nodeIndex < m_seedPivots->numberOfNodes())
+    for (std::size_t row : m_seedPivots->pivotRows(nodeIndex))
+      if (row < numberOfRows && seedRows.size() < iterationLimit)
+        seedRows.push_back(row);
 
-    // Compute complete row
+  hMatrixData.reset(new HMatrixLowRankData<ValueType>());
 
-    arma::Mat<ValueType> newRow;
-    arma::Mat<ValueType> newCol;
+  arma::Mat<ValueType> &A =
+      static_cast<HMatrixLowRankData<ValueType> *>(hMatrixData.get())->A();
 
-    IndexRangeType rowIndexRange = {{row, row + 1}};
-    IndexRangeType columnIndexRange = columnClusterRange;
+  arma::Mat<ValueType> &B =
+      static_cast<HMatrixLowRankData<ValueType> *>(hMatrixData.get())->B();
 
-    evaluateMatMinusLowRank(blockClusterTreeNode, rowIndexRange,
-                            columnIndexRange, newRow, A, B);
+  A.zeros(numberOfRows, seedRows.size() + m_resizeThreshold);
+  B.zeros(seedRows.size() + m_resizeThreshold, numberOfColumns);
 
-    arma::uword maxRowInd;
-    arma::uword maxColInd;
+  const RealType zeroTolerance = 1E-12;
 
-    arma::Mat<typename ScalarTraits<ValueType>::RealType> absMat =
-        arma::abs(newRow);
+  // Rows and columns (relative to the block) already used as pivots
+  std::vector<bool> rowUsed(numberOfRows, false);
+  std::vector<bool> columnUsed(numberOfColumns, false);
 
-    if (absMat.max(maxRowInd, maxColInd) < 1E-12)
-      continue; // Row is effectively zero
+  std::size_t rankCount = 0;
 
-    auto pivot = newRow(0, maxColInd);
+  // Evaluate a row or column of the residual M - A * B
+  auto evaluateRow = [&](std::size_t row, arma::Mat<ValueType> &result) {
+    IndexRangeType rowIndexRange = {
+        {rowClusterRange[0] + row, rowClusterRange[0] + row + 1}};
+    evaluateMatMinusLowRank(blockClusterTreeNode, rowIndexRange,
+                            columnClusterRange, result, A, B, rankCount);
+  };
+  auto evaluateColumn = [&](std::size_t col, arma::Mat<ValueType> &result) {
+    IndexRangeType columnIndexRange = {
+        {columnClusterRange[0] + col, columnClusterRange[0] + col + 1}};
+    evaluateMatMinusLowRank(blockClusterTreeNode, rowClusterRange,
+                            columnIndexRange, result, A, B, rankCount);
+  };
+  auto firstUnused = [](const std::vector<bool> &used, std::size_t &index) {
+    auto it = std::find(begin(used), end(used), false);
+    index = it - begin(used);
+    return it != end(used);
+  };
+
+  bool converged = false;
+
+  // Pivots of the crosses, for m_recordedPivots
+  IndexSetType pivotRows;
+  IndexSetType pivotColumns;
+
+  // Squared Frobenius norm of the current approximation A * B, updated
+  // incrementally after each new cross
+  RealType frobeniusNormSquared = 0;
+
+  // Partial pivoting: the next pivot row
+  std::size_t nextRow = 0;
+
+  // Block ACA and seeded rows: residual rows evaluated in one batch at rank
+  // batchRank
+  IndexSetType batchRows;
+  arma::Mat<ValueType> batchData;
+  std::size_t batchRank = 0;
+  auto nextUnusedBatchRow = [&](std::size_t &row) {
+    auto it = std::find_if(begin(batchRows), end(batchRows),
+                           [&rowUsed](std::size_t r) { return !rowUsed[r]; });
+    if (it == end(batchRows))
+      return false;
+    row = *it;
+    return true;
+  };
+
+  // The seeded rows form the first batch
+  if (!seedRows.empty()) {
+    batchRows = seedRows;
+    evaluateRowsMinusLowRank(blockClusterTreeNode, batchRows, batchData, A,
+                             B, rankCount);
+    nextRow = batchRows[0];
+  }
 
-    newRow = newRow / (pivot);
+  // ACA+: reference row and column of the residual
+  arma::Mat<ValueType> referenceRow;
+  arma::Mat<ValueType> referenceColumn;
+  std::size_t referenceRowIndex = 0;
+  std::size_t referenceColumnIndex = 0;
+
+  if (m_pivoting == ACA_PLUS) {
+    evaluateColumn(referenceColumnIndex, referenceColumn);
+    // Take the row in which the reference column is smallest, as it is the
+    // least likely to be covered by the first crosses
+    arma::uword minRowInd;
+    arma::uword minColInd;
+    arma::Mat<RealType> absColumn = arma::abs(referenceColumn);
+    absColumn.min(minRowInd, minColInd);
+    referenceRowIndex = minRowInd;
+    evaluateRow(referenceRowIndex, referenceRow);
+  }
 
-    // Now evaluate column
+  // Workspaces reused by all iterations, so that their memory is kept as
+  // long as their shapes do not change
+  arma::Mat<ValueType> newRow;
+  arma::Mat<ValueType> newCol;
+  arma::Mat<ValueType> newRowConj;
+  std::vector<ValueType> bProducts;
+  bProducts.reserve(A.n_cols);
+
+  for (std::size_t i = 0; i < iterationLimit; ++i) {
+
+    std::size_t pivotRow;
+    std::size_t pivotColumn;
+
+    if (m_pivoting == ACA_PARTIAL_PIVOTING) {
+
+      pivotRow = nextRow;
+      rowUsed[pivotRow] = true;
+      auto batchIt = std::find(begin(batchRows), end(batchRows), pivotRow);
+      if (batchIt != end(batchRows)) {
+        newRow = batchData.row(batchIt - begin(batchRows));
+        // Crosses added since the batch was evaluated
+        for (std::size_t k = batchRank; k < rankCount; ++k)
+          newRow -= A(pivotRow, k) * B.row(k);
+      } else
+        evaluateRow(pivotRow, newRow);
+
+      if (maxAbsUnused(newRow, columnUsed, pivotColumn) < zeroTolerance) {
+        // Row is effectively zero; try the next unused one of the batch,
+        // or else the first unused one
+        if (!nextUnusedBatchRow(nextRow) && !firstUnused(rowUsed, nextRow))
+          break;
+        continue;
+      }
+      evaluateColumn(pivotColumn, newCol);
+
+    } else {
+
+      std::size_t rowCandidate;
+      std::size_t columnCandidate;
+      RealType referenceColumnMax =
+          maxAbsUnused(referenceColumn, rowUsed, rowCandidate);
+      RealType referenceRowMax =
+          maxAbsUnused(referenceRow, columnUsed, columnCandidate);
+
+      if (std::max(referenceColumnMax, referenceRowMax) < zeroTolerance)
+        break; // Nothing left that the reference vectors can see
+
+      if (referenceRowMax > referenceColumnMax) {
+        pivotColumn = columnCandidate;
+        columnUsed[pivotColumn] = true;
+        evaluateColumn(pivotColumn, newCol);
+        if (maxAbsUnused(newCol, rowUsed, pivotRow) < zeroTolerance)
+          continue;
+        evaluateRow(pivotRow, newRow);
+      } else {
+        pivotRow = rowCandidate;
+        rowUsed[pivotRow] = true;
+        evaluateRow(pivotRow, newRow);
+        if (maxAbsUnused(newRow, columnUsed, pivotColumn) < zeroTolerance)
+          continue;
+        evaluateColumn(pivotColumn, newCol);
+      }
+    }
 
-    maxColInd += columnClusterRange[0]; // Map back to original variables
-    rowIndexRange = rowClusterRange;
-    columnIndexRange = {{maxColInd, maxColInd + 1}};
+    rowUsed[pivotRow] = true;
+    columnUsed[pivotColumn] = true;
+
+    newRow /= ValueType(newRow(0, pivotColumn));
+
+    auto newColNorm = arma::norm(newCol, 2);
+    auto newRowNorm = arma::norm(newRow, 2);
+
+    // ||S_k||^2 = ||S_{k-1}||^2 + ||a_k||^2 ||b_k||^2
+    //             + 2 Re sum_{j<k} (a_j^H a_k) (b_k b_j^H)
+
+    auto crossNormSquared = newColNorm * newColNorm * newRowNorm * newRowNorm;
+    RealType mixedTerm = 0;
+    if (rankCount > 0) {
+      // b_k b_j^H for all j < k, accumulated over the columns of B
+      newRowConj = arma::conj(newRow);
+      bProducts.assign(rankCount, ValueType(0));
+      for (std::size_t c = 0; c < numberOfColumns; ++c) {
+        const ValueType *bColumn = B.colptr(c);
+        const ValueType factor = newRowConj(0, c);
+        for (std::size_t j = 0; j < rankCount; ++j)
+          bProducts[j] += bColumn[j] * factor;
+      }
+      for (std::size_t j = 0; j < rankCount; ++j)
+        mixedTerm += 2 * std::real(std::conj(bProducts[j]) *
+                                   arma::cdot(A.col(j), newCol));
+    }
 
-    evaluateMatMinusLowRank(blockClusterTreeNode, rowIndexRange,
-                            columnIndexRange, newCol, A, B);
+    converged = newColNorm * newRowNorm <
+                (absoluteTolerance > 0
+                     ? absoluteTolerance
+                     : m_eps * std::sqrt(frobeniusNormSquared));
 
-    auto frobeniousNorm = hMatrixData->frobeniusNorm();
+    frobeniusNormSquared += crossNormSquared + mixedTerm;
 
     if (rankCount == A.n_cols) {
-      sizeMultiplier++;
-      A.insert_cols(sizeMultiplier * m_resizeThreshold, m_resizeThreshold);
-      B.insert_rows(sizeMultiplier * m_resizeThreshold, m_resizeThreshold);
+      A.insert_cols(A.n_cols, m_resizeThreshold);
+      B.insert_rows(B.n_rows, m_resizeThreshold);
     }
 
     A.col(rankCount) = newCol;
     B.row(rankCount) = newRow;
+    pivotRows.push_back(pivotRow);
+    pivotColumns.push_back(pivotColumn);
 
     rankCount++;
 
-    if (arma::norm(newCol, 2) * arma::norm(newRow, 2) < m_eps * frobeniousNorm)
+    if (converged)
       break;
+
+    if (m_pivoting == ACA_PARTIAL_PIVOTING) {
+      // Next pivot row: the next unused row of the current batch (seeded
+      // or of the block ACA). Otherwise the largest entry of the new
+      // column, or in the block ACA a new batch from the largest entries.
+      if (nextUnusedBatchRow(nextRow)) {
+        // nextRow set
+      } else if (m_pivotBatchSize > 1) {
+        batchRows = largestUnused(newCol, rowUsed, m_pivotBatchSize);
+        if (batchRows.empty())
+          break;
+        evaluateRowsMinusLowRank(blockClusterTreeNode, batchRows, batchData,
+                                 A, B, rankCount);
+        batchRank = rankCount;
+        nextRow = batchRows[0];
+      } else if (maxAbsUnused(newCol, rowUsed, nextRow) < 0)
+        break;
+    } else {
+      // Update the reference vectors and replace them once they have been
+      // used as pivots
+      referenceRow -= newCol(referenceRowIndex, 0) * newRow;
+      referenceColumn -= newCol * newRow(0, referenceColumnIndex);
+      if (rowUsed[referenceRowIndex]) {
+        if (!firstUnused(rowUsed, referenceRowIndex))
+          break;
+        evaluateRow(referenceRowIndex, referenceRow);
+      }
+      if (columnUsed[referenceColumnIndex]) {
+        if (!firstUnused(columnUsed, referenceColumnIndex))
+          break;
+        evaluateColumn(referenceColumnIndex, referenceColumn);
+      }
+    }
   }
   if (A.n_cols - rankCount > 0) {
     A.shed_cols(rankCount, A.n_cols - 1);
     B.shed_rows(rankCount, B.n_rows - 1);
   }
+  if (m_recordedPivots && nodeIndex < m_recordedPivots->numberOfNodes())
+    m_recordedPivots->setPivots(nodeIndex, pivotRows, pivotColumns);
+
+  if (!converged && rankCount == m_maxRank &&
+      m_maxRank < std::min(numberOfRows, numberOfColumns)) {
+    ++m_numberOfBlocksAtMaxRank;
+    if (m_maxRankPolicy == ACA_ADAPTIVE) {
+      ++m_numberOfRecomputedBlocks;
+      compressBlockBySvd(blockClusterTreeNode, absoluteTolerance, hMatrixData);
+    }
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrixAcaCompressor<ValueType, N>::compressBlockBySvd(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    RealType absoluteTolerance,
+    shared_ptr<HMatrixData<ValueType>> &hMatrixData) const {
+
+  IndexRangeType rowClusterRange;
+  IndexRangeType columnClusterRange;
+  std::size_t numberOfRows;
+  std::size_t numberOfColumns;
+
+  getBlockClusterTreeNodeDimensions(blockClusterTreeNode, rowClusterRange,
+                                    columnClusterRange, numberOfRows,
+                                    numberOfColumns);
+
+  shared_ptr<HMatrixDenseData<ValueType>> denseData(
+      new HMatrixDenseData<ValueType>());
+  arma::Mat<ValueType> &block = denseData->A();
+  m_dataAccessor.computeMatrixBlock(rowClusterRange, columnClusterRange,
+                                    blockClusterTreeNode, block);
+  hMatrixData = denseData;
+
+  arma::Mat<ValueType> U;
+  arma::Col<RealType> s;
+  arma::Mat<ValueType> V;
+  if (!arma::svd_econ(U, s, V, block))
+    return; // Keep the block dense
+
+  // Smallest rank for which the discarded singular values stay below the
+  // tolerance
+  const RealType tolerance =
+      absoluteTolerance > 0 ? absoluteTolerance : m_eps * arma::norm(s, 2);
+  std::size_t rank = s.n_elem;
+  RealType discardedSquared = 0;
+  while (rank > 0 &&
+         discardedSquared + s(rank - 1) * s(rank - 1) <=
+             tolerance * tolerance) {
+    discardedSquared += s(rank - 1) * s(rank - 1);
+    --rank;
+  }
+
+  if (rank * (numberOfRows + numberOfColumns) >=
+      numberOfRows * numberOfColumns)
+    return; // Dense storage is smaller
+
+  shared_ptr<HMatrixLowRankData<ValueType>> lowRankData(
+      new HMatrixLowRankData<ValueType>());
+  if (rank > 0) {
+    lowRankData->A() = U.cols(0, rank - 1) *
+                       arma::diagmat(arma::conv_to<arma::Col<ValueType>>::from(
+                           s.rows(0, rank - 1)));
+    lowRankData->B() = V.cols(0, rank - 1).t();
+  } else {
+    lowRankData->A().zeros(numberOfRows, 0);
+    lowRankData->B().zeros(0, numberOfColumns);
+  }
+  hMatrixData = lowRankData;
+}
+
+template <typename ValueType, int N>
+typename HMatrixAcaCompressor<ValueType, N>::RealType
+HMatrixAcaCompressor<ValueType, N>::matrixNormTolerance(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    std::size_t numberOfEntries) const {
+
+  double normSquared;
+  {
+    tbb::spin_mutex::scoped_lock lock(m_normMutex);
+    normSquared = m_inadmissibleNormSquared;
+  }
+  if (normSquared == 0)
+    return 0;
+
+  // The root of the block cluster tree spans the whole matrix
+  shared_ptr<const BlockClusterTreeNode<N>> node =
+      blockClusterTreeNode.root();
+  const BlockClusterTreeNode<N> *top = &blockClusterTreeNode;
+  while (node) {
+    top = node.get();
+    node = node->root();
+  }
+  IndexRangeType rowRange;
+  IndexRangeType columnRange;
+  std::size_t rows;
+  std::size_t columns;
+  getBlockClusterTreeNodeDimensions(*top, rowRange, columnRange, rows,
+                                    columns);
+
+  return static_cast<RealType>(
+      m_eps * std::sqrt(normSquared * numberOfEntries /
+                        (static_cast<double>(rows) * columns)));
+}
+
+template <typename ValueType, int N>
+void HMatrixAcaCompressor<ValueType, N>::setWarmStart(
+    const shared_ptr<const AcaPivotTable> &seedPivots,
+    const shared_ptr<AcaPivotTable> &recordedPivots) {
+  m_seedPivots = seedPivots;
+  m_recordedPivots = recordedPivots;
+}
+
+template <typename ValueType, int N>
+std::size_t
+HMatrixAcaCompressor<ValueType, N>::numberOfBlocksAtMaxRank() const {
+  return m_numberOfBlocksAtMaxRank;
+}
+
+template <typename ValueType, int N>
+std::size_t
+HMatrixAcaCompressor<ValueType, N>::numberOfRecomputedBlocks() const {
+  return m_numberOfRecomputedBlocks;
 }
 
 template <typename ValueType, int N>
 HMatrixAcaCompressor<ValueType, N>::HMatrixAcaCompressor(
     const DataAccessor<ValueType, N> &dataAccessor, double eps,
-    unsigned int maxRank, unsigned int resizeThreshold)
+    unsigned int maxRank, unsigned int resizeThreshold, AcaPivoting pivoting,
+    unsigned int pivotBatchSize, AcaMaxRankPolicy maxRankPolicy,
+    AcaAccuracyReference accuracyReference)
     : m_dataAccessor(dataAccessor), m_eps(eps), m_maxRank(maxRank),
-      m_resizeThreshold(resizeThreshold),
-      m_hMatrixDenseCompressor(dataAccessor) {}
+      m_resizeThreshold(resizeThreshold), m_pivoting(pivoting),
+      m_pivotBatchSize(pivotBatchSize), m_maxRankPolicy(maxRankPolicy),
+      m_accuracyReference(accuracyReference),
+      m_hMatrixDenseCompressor(dataAccessor), m_inadmissibleNormSquared(0) {
+  m_numberOfBlocksAtMaxRank = 0;
+  m_numberOfRecomputedBlocks = 0;
+}
 
 template <typename ValueType, int N>
 void HMatrixAcaCompressor<ValueType, N>::evaluateMatMinusLowRank(
     const BlockClusterTreeNode<N> &blockClusterTreeNode,
     const IndexRangeType &rowIndexRange, const IndexRangeType &columnIndexRange,
     arma::Mat<ValueType> &data, const arma::Mat<ValueType> &A,
-    const arma::Mat<ValueType> &B) const {
+    const arma::Mat<ValueType> &B, std::size_t rank) const {
 
   auto rowClusterRange =
       blockClusterTreeNode.data().rowClusterTreeNode->data().indexRange;
@@ -136,44 +464,90 @@ void HMatrixAcaCompressor<ValueType, N>::evaluateMatMinusLowRank(
   m_dataAccessor.computeMatrixBlock(rowIndexRange, columnIndexRange,
                                     blockClusterTreeNode, data);
 
+  if (rank == 0)
+    return;
+
   auto rowStart = rowIndexRange[0] - rowClusterRange[0];
   auto rowEnd = rowIndexRange[1] - rowClusterRange[0];
 
   auto colStart = columnIndexRange[0] - columnClusterRange[0];
   auto colEnd = columnIndexRange[1] - columnClusterRange[0];
 
-  data = data - A.submat(rowStart, 0, rowEnd - 1, A.n_cols - 1) *
-                    B.submat(0, colStart, B.n_rows - 1, colEnd - 1);
+  // The ACA loop asks for single rows and columns; subtract them one cross
+  // at a time, in place
+  if (rowEnd - rowStart == 1) {
+    for (std::size_t k = 0; k < rank; ++k)
+      data -= A(rowStart, k) * B.submat(k, colStart, k, colEnd - 1);
+  } else if (colEnd - colStart == 1) {
+    for (std::size_t k = 0; k < rank; ++k)
+      data -= B(k, colStart) * A.submat(rowStart, k, rowEnd - 1, k);
+  } else
+    data -= A.submat(rowStart, 0, rowEnd - 1, rank - 1) *
+            B.submat(0, colStart, rank - 1, colEnd - 1);
 }
 
 template <typename ValueType, int N>
-std::size_t HMatrixAcaCompressor<ValueType, N>::randomIndex(
-    const IndexRangeType &range, std::set<std::size_t> &previousIndices) {
+void HMatrixAcaCompressor<ValueType, N>::evaluateRowsMinusLowRank(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    const IndexSetType &rows, arma::Mat<ValueType> &data,
+    const arma::Mat<ValueType> &A, const arma::Mat<ValueType> &B,
+    std::size_t rank) const {
 
-  std::size_t numberOfPossibleIndices =
-      range[1] - range[0] - previousIndices.size();
-  static std::random_device generator;
-  std::uniform_int_distribution<std::size_t> distribution(
-      0, numberOfPossibleIndices - 1);
+  auto rowClusterRange =
+      blockClusterTreeNode.data().rowClusterTreeNode->data().indexRange;
+  auto columnClusterRange =
+      blockClusterTreeNode.data().columnClusterTreeNode->data().indexRange;
 
-  std::size_t ind = distribution(generator); // New random position
+  IndexSetType rowIndices(rows.size());
+  for (std::size_t i = 0; i < rows.size(); ++i)
+    rowIndices[i] = rowClusterRange[0] + rows[i];
 
-  // Turn the random position into a previously not used index in the range.
+  m_dataAccessor.computeMatrixRows(rowIndices, columnClusterRange,
+                                   blockClusterTreeNode, data);
 
-  std::size_t newIndex = range[0];
+  for (std::size_t i = 0; i < rows.size(); ++i)
+    for (std::size_t k = 0; k < rank; ++k)
+      data.row(i) -= A(rows[i], k) * B.row(k);
+}
 
-  std::size_t count = 0;
-  while (count <= ind) {
-    if (!previousIndices.count(newIndex)) {
-      count++;
-      if (count <= ind)
-        newIndex++;
+template <typename ValueType, int N>
+IndexSetType HMatrixAcaCompressor<ValueType, N>::largestUnused(
+    const arma::Mat<ValueType> &vec, const std::vector<bool> &used,
+    std::size_t count) {
+
+  IndexSetType indices;
+  for (std::size_t i = 0; i < used.size(); ++i)
+    if (!used[i])
+      indices.push_back(i);
+
+  count = std::min(count, indices.size());
+  std::partial_sort(begin(indices), begin(indices) + count, end(indices),
+                    [&vec](std::size_t a, std::size_t b) {
+    RealType absA = std::abs(vec[a]);
+    RealType absB = std::abs(vec[b]);
+    return absA > absB || (absA == absB && a < b);
+  });
+  indices.resize(count);
+  return indices;
+}
+
+template <typename ValueType, int N>
+typename HMatrixAcaCompressor<ValueType, N>::RealType
+HMatrixAcaCompressor<ValueType, N>::maxAbsUnused(
+    const arma::Mat<ValueType> &vec, const std::vector<bool> &used,
+    std::size_t &index) {
+
+  RealType maxValue = -1;
+  for (std::size_t i = 0; i < used.size(); ++i) {
+    if (used[i])
       continue;
+    RealType value = std::abs(vec[i]);
+    if (value > maxValue) {
+      maxValue = value;
+      index = i;
     }
-    newIndex++;
   }
-  previousIndices.insert(newIndex);
-  return newIndex;
+  return maxValue;
 }
 }
 
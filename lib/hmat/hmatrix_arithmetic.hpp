@@ -0,0 +1,144 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_ARITHMETIC_HPP
+#define HMAT_HMATRIX_ARITHMETIC_HPP
+
+#include "common.hpp"
+#include "hmatrix.hpp"
+#include "hmatrix_dense_data.hpp"
+#include "hmatrix_low_rank_data.hpp"
+#include "cluster_tree.hpp"
+#include <armadillo>
+
+namespace hmat {
+
+/** \brief Formatted arithmetic on a modifiable copy of the blocks of
+ *  H-matrices.
+ *
+ *  Sums and products are accumulated in the block structure of the
+ *  target, and every low-rank result is truncated by SVD to the relative
+ *  accuracy \p eps. Blocks are copied from and converted back to HMatrix
+ *  objects by copyBlock() and toHMatrix(). Used by HMatrixLuDecomposition
+ *  and by formattedAddition() and formattedMultiplication(). */
+template <typename ValueType, int N> class HMatrixArithmetic {
+public:
+  struct Block {
+    IndexRangeType rowRange;
+    IndexRangeType columnRange;
+    shared_ptr<HMatrixDenseData<ValueType>> dense;
+    shared_ptr<HMatrixLowRankData<ValueType>> lowRank;
+    std::vector<shared_ptr<Block>> children; // N * N children or none
+
+    // Factors of diagonal leaves of an LU decomposition:
+    // P * A = lower * upper
+    arma::Mat<ValueType> lower;
+    arma::Mat<ValueType> upper;
+    arma::Mat<ValueType> pivots; // empty for Cholesky factors
+  };
+
+  explicit HMatrixArithmetic(double eps);
+
+  static std::size_t blockRows(const Block &block, bool conjTrans);
+  static std::size_t blockColumns(const Block &block, bool conjTrans);
+  static const IndexRangeType &outputRange(const Block &block,
+                                           bool conjTrans);
+  static const IndexRangeType &inputRange(const Block &block, bool conjTrans);
+  static const Block &child(const Block &block, bool conjTrans, int i, int j);
+
+  /** \brief Copy the leaves of \p hMatrix below \p node. */
+  shared_ptr<Block>
+  copyBlock(const HMatrix<ValueType, N> &hMatrix,
+            const shared_ptr<const BlockClusterTreeNode<N>> &node) const;
+
+  /** \brief Return a zero block with the structure of the subtree of
+   *  \p node: admissible leaves get rank 0, inadmissible ones zero dense
+   *  blocks. */
+  shared_ptr<Block>
+  zeroBlock(const shared_ptr<const BlockClusterTreeNode<N>> &node) const;
+
+  /** \brief Return an H-matrix on \p blockClusterTree with the leaves of
+   *  \p root, which must have the structure of the tree. */
+  shared_ptr<HMatrix<ValueType, N>>
+  toHMatrix(const Block &root,
+            const shared_ptr<const BlockClusterTree<N>> &blockClusterTree,
+            int maxThreadCount = -1) const;
+
+  void truncate(arma::Mat<ValueType> &A, arma::Mat<ValueType> &B) const;
+
+  void applyBlock(const Block &x, bool conjTrans,
+                  const arma::Mat<ValueType> &in, arma::Mat<ValueType> &out,
+                  ValueType alpha) const;
+  arma::Mat<ValueType> toDense(const Block &x, bool conjTrans) const;
+  void toLowRank(const Block &x, arma::Mat<ValueType> &A,
+                 arma::Mat<ValueType> &B) const;
+
+  void addDense(Block &c, const arma::Mat<ValueType> &M) const;
+  void addLowRank(Block &c, const arma::Mat<ValueType> &A,
+                  const arma::Mat<ValueType> &B) const;
+
+  /** \brief c += alpha * x for blocks of the same index ranges. */
+  void add(Block &c, const Block &x, ValueType alpha) const;
+
+  /** \brief c += alpha * op(x) * op(y). */
+  void multiplyAdd(Block &c, const Block &x, bool xConjTrans, const Block &y,
+                   bool yConjTrans, ValueType alpha) const;
+
+  /** \brief Return true if the two trees are the same object or have the
+   *  same DOF permutation, in which case they have the same clusters. */
+  static bool sameClusterTree(const ClusterTree<N> &tree1,
+                              const ClusterTree<N> &tree2);
+
+private:
+  class LeafDataCompressor : public HMatrixCompressor<ValueType, N> {
+  public:
+    explicit LeafDataCompressor(
+        const std::vector<shared_ptr<HMatrixData<ValueType>>> &leafData);
+    void compressBlock(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                       shared_ptr<HMatrixData<ValueType>> &hMatrixData) const
+        override;
+
+  private:
+    const std::vector<shared_ptr<HMatrixData<ValueType>>> &m_leafData;
+  };
+
+  void collectLeaves(
+      const Block &block,
+      const shared_ptr<const BlockClusterTreeNode<N>> &node,
+      std::vector<shared_ptr<HMatrixData<ValueType>>> &leafData) const;
+
+  double m_eps;
+};
+
+/** \brief Return alpha * x + beta * y, truncated to the relative accuracy
+ *  \p eps.
+ *
+ *  \p x and \p y must be built on the same block cluster tree, which the
+ *  result shares. Neither of them may be frozen or have its near field
+ *  extracted. */
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>>
+formattedAddition(const HMatrix<ValueType, N> &x,
+                  const HMatrix<ValueType, N> &y, double eps,
+                  ValueType alpha = 1, ValueType beta = 1,
+                  int maxThreadCount = -1);
+
+/** \brief Return alpha * x * y, truncated to the relative accuracy \p eps.
+ *
+ *  The column cluster tree of \p x must be the row cluster tree of \p y.
+ *  The product is formed in the block structure of \p resultTree, whose
+ *  row (column) cluster tree must be that of \p x (\p y). If \p resultTree
+ *  is null, the block cluster tree of \p x or \p y is used if it fits,
+ *  which is the case for square matrices on the same cluster tree.
+ *  Neither factor may be frozen or have its near field extracted. */
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>> formattedMultiplication(
+    const HMatrix<ValueType, N> &x, const HMatrix<ValueType, N> &y,
+    double eps, ValueType alpha = 1,
+    const shared_ptr<const BlockClusterTree<N>> &resultTree =
+        shared_ptr<const BlockClusterTree<N>>(),
+    int maxThreadCount = -1);
+}
+
+#include "hmatrix_arithmetic_impl.hpp"
+
+#endif
@@ -0,0 +1,589 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_ARITHMETIC_IMPL_HPP
+#define HMAT_HMATRIX_ARITHMETIC_IMPL_HPP
+
+#include "hmatrix_arithmetic.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+HMatrixArithmetic<ValueType, N>::HMatrixArithmetic(double eps)
+    : m_eps(eps) {}
+
+template <typename ValueType, int N>
+std::size_t HMatrixArithmetic<ValueType, N>::blockRows(const Block &block,
+                                                       bool conjTrans) {
+  const IndexRangeType &range = outputRange(block, conjTrans);
+  return range[1] - range[0];
+}
+
+template <typename ValueType, int N>
+std::size_t
+HMatrixArithmetic<ValueType, N>::blockColumns(const Block &block,
+                                              bool conjTrans) {
+  const IndexRangeType &range = inputRange(block, conjTrans);
+  return range[1] - range[0];
+}
+
+template <typename ValueType, int N>
+const IndexRangeType &
+HMatrixArithmetic<ValueType, N>::outputRange(const Block &block,
+                                             bool conjTrans) {
+  return conjTrans ? block.columnRange : block.rowRange;
+}
+
+template <typename ValueType, int N>
+const IndexRangeType &
+HMatrixArithmetic<ValueType, N>::inputRange(const Block &block,
+                                            bool conjTrans) {
+  return conjTrans ? block.rowRange : block.columnRange;
+}
+
+template <typename ValueType, int N>
+const typename HMatrixArithmetic<ValueType, N>::Block &
+HMatrixArithmetic<ValueType, N>::child(const Block &block, bool conjTrans,
+                                       int i, int j) {
+  return conjTrans ? *block.children[N * j + i] : *block.children[N * i + j];
+}
+
+template <typename ValueType, int N>
+shared_ptr<typename HMatrixArithmetic<ValueType, N>::Block>
+HMatrixArithmetic<ValueType, N>::copyBlock(
+    const HMatrix<ValueType, N> &hMatrix,
+    const shared_ptr<const BlockClusterTreeNode<N>> &node) const {
+
+  auto block = make_shared<Block>();
+  block->rowRange = node->data().rowClusterTreeNode->data().indexRange;
+  block->columnRange = node->data().columnClusterTreeNode->data().indexRange;
+
+  if (node->isLeaf()) {
+    // Leaves of the upper block triangle of matrices with symmetric storage
+    // are the transposes or adjoints of their mirror leaves
+    auto mirror = hMatrix.mirrorLeaf(node);
+    const bool mirrored = (mirror != node);
+    const bool hermitian = (hMatrix.symmetry() == HERMITIAN_STORAGE);
+    auto data = hMatrix.leafData(mirror);
+    if (auto dense =
+            dynamic_cast<const HMatrixDenseData<ValueType> *>(data.get())) {
+      block->dense = make_shared<HMatrixDenseData<ValueType>>(*dense);
+      block->dense->decompress();
+      if (mirrored)
+        block->dense->A() =
+            hermitian ? arma::Mat<ValueType>(block->dense->A().t())
+                      : arma::Mat<ValueType>(block->dense->A().st());
+    } else if (auto lowRank =
+                   dynamic_cast<const HMatrixLowRankData<ValueType> *>(
+                       data.get())) {
+      block->lowRank = make_shared<HMatrixLowRankData<ValueType>>(*lowRank);
+      block->lowRank->convertToFullPrecision();
+      if (mirrored) {
+        // (A B)^T = B^T A^T
+        const arma::Mat<ValueType> &oldA = block->lowRank->A();
+        const arma::Mat<ValueType> &oldB = block->lowRank->B();
+        arma::Mat<ValueType> A = hermitian ? arma::Mat<ValueType>(oldB.t())
+                                           : arma::Mat<ValueType>(oldB.st());
+        arma::Mat<ValueType> B = hermitian ? arma::Mat<ValueType>(oldA.t())
+                                           : arma::Mat<ValueType>(oldA.st());
+        block->lowRank->A().swap(A);
+        block->lowRank->B().swap(B);
+      }
+    } else
+      throw std::runtime_error("HMatrixArithmetic::copyBlock(): "
+                               "Unknown type of leaf data.");
+    return block;
+  }
+
+  block->children.resize(N * N);
+  for (int i = 0; i < N * N; ++i)
+    block->children[i] = copyBlock(hMatrix, node->child(i));
+  return block;
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::truncate(
+    arma::Mat<ValueType> &A, arma::Mat<ValueType> &B) const {
+
+  HMatrixLowRankData<ValueType> lowRankData;
+  lowRankData.A().swap(A);
+  lowRankData.B().swap(B);
+  lowRankData.recompress(m_eps);
+  lowRankData.A().swap(A);
+  lowRankData.B().swap(B);
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::applyBlock(
+    const Block &x, bool conjTrans, const arma::Mat<ValueType> &in,
+    arma::Mat<ValueType> &out, ValueType alpha) const {
+
+  TransposeMode trans = conjTrans ? CONJTRANS : NOTRANS;
+
+  if (x.dense) {
+    x.dense->apply(in, out, trans, alpha, 1);
+    return;
+  }
+  if (x.lowRank) {
+    if (x.lowRank->rank() > 0)
+      x.lowRank->apply(in, out, trans, alpha, 1);
+    return;
+  }
+
+  // Children in the same block row of op(x) write to the same rows of out
+  // and are processed by the same task.
+  const std::size_t inputOffset = inputRange(x, conjTrans)[0];
+  const std::size_t outputOffset = outputRange(x, conjTrans)[0];
+  tbb::parallel_for(0, N, [&](int i) {
+    const IndexRangeType &rowRange =
+        outputRange(child(x, conjTrans, i, 0), conjTrans);
+    arma::Mat<ValueType> outSub = out.rows(rowRange[0] - outputOffset,
+                                           rowRange[1] - 1 - outputOffset);
+    for (int j = 0; j < N; ++j) {
+      const Block &c = child(x, conjTrans, i, j);
+      const IndexRangeType &columnRange = inputRange(c, conjTrans);
+      arma::Mat<ValueType> inSub = in.rows(columnRange[0] - inputOffset,
+                                           columnRange[1] - 1 - inputOffset);
+      applyBlock(c, conjTrans, inSub, outSub, alpha);
+    }
+    out.rows(rowRange[0] - outputOffset, rowRange[1] - 1 - outputOffset) =
+        outSub;
+  });
+}
+
+template <typename ValueType, int N>
+arma::Mat<ValueType>
+HMatrixArithmetic<ValueType, N>::toDense(const Block &x,
+                                         bool conjTrans) const {
+
+  if (x.dense)
+    return conjTrans ? arma::Mat<ValueType>(x.dense->A().t())
+                     : x.dense->A();
+
+  arma::Mat<ValueType> result(blockRows(x, conjTrans),
+                              blockColumns(x, conjTrans), arma::fill::zeros);
+  if (x.lowRank) {
+    if (x.lowRank->rank() > 0)
+      result = conjTrans ? arma::Mat<ValueType>(x.lowRank->B().t() *
+                                                x.lowRank->A().t())
+                         : arma::Mat<ValueType>(x.lowRank->A() *
+                                                x.lowRank->B());
+    return result;
+  }
+
+  const std::size_t rowOffset = outputRange(x, conjTrans)[0];
+  const std::size_t columnOffset = inputRange(x, conjTrans)[0];
+  for (const auto &c : x.children) {
+    const IndexRangeType &rowRange = outputRange(*c, conjTrans);
+    const IndexRangeType &columnRange = inputRange(*c, conjTrans);
+    result.submat(rowRange[0] - rowOffset, columnRange[0] - columnOffset,
+                  rowRange[1] - 1 - rowOffset,
+                  columnRange[1] - 1 - columnOffset) = toDense(*c, conjTrans);
+  }
+  return result;
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::toLowRank(
+    const Block &x, arma::Mat<ValueType> &A, arma::Mat<ValueType> &B) const {
+
+  if (x.lowRank) {
+    A = x.lowRank->A();
+    B = x.lowRank->B();
+    return;
+  }
+  if (x.dense) {
+    A = x.dense->A();
+    B = arma::eye<arma::Mat<ValueType>>(A.n_cols, A.n_cols);
+    truncate(A, B);
+    return;
+  }
+
+  // Agglomerate the children into one low-rank block
+  std::vector<arma::Mat<ValueType>> childA(x.children.size());
+  std::vector<arma::Mat<ValueType>> childB(x.children.size());
+  std::size_t totalRank = 0;
+  for (std::size_t i = 0; i < x.children.size(); ++i) {
+    toLowRank(*x.children[i], childA[i], childB[i]);
+    totalRank += childA[i].n_cols;
+  }
+
+  A.zeros(blockRows(x, false), totalRank);
+  B.zeros(totalRank, blockColumns(x, false));
+  std::size_t rankOffset = 0;
+  for (std::size_t i = 0; i < x.children.size(); ++i) {
+    std::size_t rank = childA[i].n_cols;
+    if (rank == 0)
+      continue;
+    const Block &c = *x.children[i];
+    A.submat(c.rowRange[0] - x.rowRange[0], rankOffset,
+             c.rowRange[1] - 1 - x.rowRange[0], rankOffset + rank - 1) =
+        childA[i];
+    B.submat(rankOffset, c.columnRange[0] - x.columnRange[0],
+             rankOffset + rank - 1, c.columnRange[1] - 1 - x.columnRange[0]) =
+        childB[i];
+    rankOffset += rank;
+  }
+  if (totalRank > 0)
+    truncate(A, B);
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::addDense(
+    Block &c, const arma::Mat<ValueType> &M) const {
+
+  if (c.dense) {
+    c.dense->A() += M;
+    return;
+  }
+  if (c.lowRank) {
+    arma::Mat<ValueType> A = arma::join_rows(c.lowRank->A(), M);
+    arma::Mat<ValueType> B = arma::join_cols(
+        c.lowRank->B(), arma::eye<arma::Mat<ValueType>>(M.n_cols, M.n_cols));
+    truncate(A, B);
+    c.lowRank->A().swap(A);
+    c.lowRank->B().swap(B);
+    return;
+  }
+  for (const auto &d : c.children)
+    addDense(*d, M.submat(d->rowRange[0] - c.rowRange[0],
+                          d->columnRange[0] - c.columnRange[0],
+                          d->rowRange[1] - 1 - c.rowRange[0],
+                          d->columnRange[1] - 1 - c.columnRange[0]));
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::addLowRank(
+    Block &c, const arma::Mat<ValueType> &A,
+    const arma::Mat<ValueType> &B) const {
+
+  if (A.n_cols == 0)
+    return;
+  if (c.dense) {
+    c.dense->A() += A * B;
+    return;
+  }
+  if (c.lowRank) {
+    arma::Mat<ValueType> newA = arma::join_rows(c.lowRank->A(), A);
+    arma::Mat<ValueType> newB = arma::join_cols(c.lowRank->B(), B);
+    truncate(newA, newB);
+    c.lowRank->A().swap(newA);
+    c.lowRank->B().swap(newB);
+    return;
+  }
+  for (const auto &d : c.children)
+    addLowRank(*d, A.rows(d->rowRange[0] - c.rowRange[0],
+                          d->rowRange[1] - 1 - c.rowRange[0]),
+               B.cols(d->columnRange[0] - c.columnRange[0],
+                      d->columnRange[1] - 1 - c.columnRange[0]));
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::multiplyAdd(
+    Block &c, const Block &x, bool xConjTrans, const Block &y,
+    bool yConjTrans, ValueType alpha) const {
+
+  // c += alpha * op(x) * op(y)
+
+  if (x.lowRank) {
+    if (x.lowRank->rank() == 0)
+      return;
+    // op(x) * op(y) = P * (Q * op(y)) = P * (op(y)^H * Q^H)^H
+    arma::Mat<ValueType> P = xConjTrans
+                                 ? arma::Mat<ValueType>(x.lowRank->B().t())
+                                 : x.lowRank->A();
+    arma::Mat<ValueType> QH = xConjTrans
+                                  ? x.lowRank->A()
+                                  : arma::Mat<ValueType>(x.lowRank->B().t());
+    arma::Mat<ValueType> WH(blockColumns(c, false), QH.n_cols,
+                            arma::fill::zeros);
+    applyBlock(y, !yConjTrans, QH, WH, 1);
+    addLowRank(c, alpha * P, WH.t());
+    return;
+  }
+
+  if (y.lowRank) {
+    if (y.lowRank->rank() == 0)
+      return;
+    // op(x) * op(y) = (op(x) * P) * Q
+    arma::Mat<ValueType> P = yConjTrans
+                                 ? arma::Mat<ValueType>(y.lowRank->B().t())
+                                 : y.lowRank->A();
+    arma::Mat<ValueType> Q = yConjTrans
+                                 ? arma::Mat<ValueType>(y.lowRank->A().t())
+                                 : y.lowRank->B();
+    arma::Mat<ValueType> V(blockRows(c, false), P.n_cols, arma::fill::zeros);
+    applyBlock(x, xConjTrans, P, V, alpha);
+    addLowRank(c, V, Q);
+    return;
+  }
+
+  if (c.dense || y.dense) {
+    arma::Mat<ValueType> M(blockRows(c, false), blockColumns(c, false),
+                           arma::fill::zeros);
+    applyBlock(x, xConjTrans, toDense(y, yConjTrans), M, alpha);
+    addDense(c, M);
+    return;
+  }
+
+  if (x.dense) {
+    // op(x) * op(y) = (op(y)^H * op(x)^H)^H
+    arma::Mat<ValueType> MH(blockColumns(c, false), blockRows(c, false),
+                            arma::fill::zeros);
+    applyBlock(y, !yConjTrans, toDense(x, !xConjTrans), MH, 1);
+    addDense(c, alpha * MH.t());
+    return;
+  }
+
+  // Both factors are subdivided
+
+  if (c.lowRank) {
+    // Collect the product in a subdivided block of zero-rank children and
+    // agglomerate it afterwards.
+    Block product;
+    product.rowRange = c.rowRange;
+    product.columnRange = c.columnRange;
+    product.children.resize(N * N);
+    for (int i = 0; i < N; ++i)
+      for (int j = 0; j < N; ++j) {
+        auto d = make_shared<Block>();
+        d->rowRange = outputRange(child(x, xConjTrans, i, 0), xConjTrans);
+        d->columnRange = inputRange(child(y, yConjTrans, 0, j), yConjTrans);
+        d->lowRank = make_shared<HMatrixLowRankData<ValueType>>();
+        d->lowRank->A().zeros(blockRows(*d, false), 0);
+        d->lowRank->B().zeros(0, blockColumns(*d, false));
+        product.children[N * i + j] = d;
+      }
+    multiplyAdd(product, x, xConjTrans, y, yConjTrans, alpha);
+    arma::Mat<ValueType> A, B;
+    toLowRank(product, A, B);
+    addLowRank(c, A, B);
+    return;
+  }
+
+  // Different children of c can be updated concurrently
+  tbb::parallel_for(0, N * N, [&](int index) {
+    int i = index / N;
+    int j = index % N;
+    for (int k = 0; k < N; ++k)
+      multiplyAdd(*c.children[index], child(x, xConjTrans, i, k), xConjTrans,
+                  child(y, yConjTrans, k, j), yConjTrans, alpha);
+  });
+}
+
+template <typename ValueType, int N>
+shared_ptr<typename HMatrixArithmetic<ValueType, N>::Block>
+HMatrixArithmetic<ValueType, N>::zeroBlock(
+    const shared_ptr<const BlockClusterTreeNode<N>> &node) const {
+
+  auto block = make_shared<Block>();
+  block->rowRange = node->data().rowClusterTreeNode->data().indexRange;
+  block->columnRange = node->data().columnClusterTreeNode->data().indexRange;
+
+  if (node->isLeaf()) {
+    if (node->data().admissible) {
+      block->lowRank = make_shared<HMatrixLowRankData<ValueType>>();
+      block->lowRank->A().zeros(blockRows(*block, false), 0);
+      block->lowRank->B().zeros(0, blockColumns(*block, false));
+    } else {
+      block->dense = make_shared<HMatrixDenseData<ValueType>>();
+      block->dense->A().zeros(blockRows(*block, false),
+                              blockColumns(*block, false));
+    }
+    return block;
+  }
+
+  block->children.resize(N * N);
+  for (int i = 0; i < N * N; ++i)
+    block->children[i] = zeroBlock(node->child(i));
+  return block;
+}
+
+template <typename ValueType, int N>
+HMatrixArithmetic<ValueType, N>::LeafDataCompressor::LeafDataCompressor(
+    const std::vector<shared_ptr<HMatrixData<ValueType>>> &leafData)
+    : m_leafData(leafData) {}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::LeafDataCompressor::compressBlock(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    shared_ptr<HMatrixData<ValueType>> &hMatrixData) const {
+  hMatrixData = m_leafData[blockClusterTreeNode.index()];
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::collectLeaves(
+    const Block &block, const shared_ptr<const BlockClusterTreeNode<N>> &node,
+    std::vector<shared_ptr<HMatrixData<ValueType>>> &leafData) const {
+
+  if (block.rowRange != node->data().rowClusterTreeNode->data().indexRange ||
+      block.columnRange !=
+          node->data().columnClusterTreeNode->data().indexRange ||
+      block.children.empty() != node->isLeaf())
+    throw std::invalid_argument("HMatrixArithmetic::toHMatrix(): "
+                                "Block structure does not match the block "
+                                "cluster tree.");
+  if (node->isLeaf()) {
+    if (block.dense)
+      leafData[node->index()] = block.dense;
+    else
+      leafData[node->index()] = block.lowRank;
+    return;
+  }
+  for (int i = 0; i < N * N; ++i)
+    collectLeaves(*block.children[i], node->child(i), leafData);
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>> HMatrixArithmetic<ValueType, N>::toHMatrix(
+    const Block &root,
+    const shared_ptr<const BlockClusterTree<N>> &blockClusterTree,
+    int maxThreadCount) const {
+
+  std::vector<shared_ptr<HMatrixData<ValueType>>> leafData(
+      blockClusterTree->treeIndex().numberOfNodes());
+  collectLeaves(root, blockClusterTree->root(), leafData);
+  LeafDataCompressor compressor(leafData);
+  return make_shared<HMatrix<ValueType, N>>(
+      boost::const_pointer_cast<BlockClusterTree<N>>(blockClusterTree),
+      compressor, maxThreadCount);
+}
+
+template <typename ValueType, int N>
+void HMatrixArithmetic<ValueType, N>::add(Block &c, const Block &x,
+                                          ValueType alpha) const {
+
+  if (c.rowRange != x.rowRange || c.columnRange != x.columnRange)
+    throw std::invalid_argument("HMatrixArithmetic::add(): "
+                                "Blocks have different index ranges.");
+
+  if (x.dense) {
+    addDense(c, alpha * x.dense->A());
+    return;
+  }
+  if (x.lowRank) {
+    if (x.lowRank->rank() > 0)
+      addLowRank(c, alpha * x.lowRank->A(), x.lowRank->B());
+    return;
+  }
+  if (c.dense) {
+    addDense(c, alpha * toDense(x, false));
+    return;
+  }
+  if (c.lowRank) {
+    arma::Mat<ValueType> A, B;
+    toLowRank(x, A, B);
+    addLowRank(c, alpha * A, B);
+    return;
+  }
+
+  // Different children of c can be updated concurrently
+  tbb::parallel_for(0, N * N, [&](int i) {
+    add(*c.children[i], *x.children[i], alpha);
+  });
+}
+
+template <typename ValueType, int N>
+bool HMatrixArithmetic<ValueType, N>::sameClusterTree(
+    const ClusterTree<N> &tree1, const ClusterTree<N> &tree2) {
+  return &tree1 == &tree2 ||
+         tree1.hMatDofToOriginalDofMap() == tree2.hMatDofToOriginalDofMap();
+}
+
+template <typename ValueType, int N>
+void checkArithmeticOperand(const HMatrix<ValueType, N> &hMatrix,
+                            const char *function) {
+  if (!hMatrix.isInitialized() || hMatrix.isFrozen() ||
+      hMatrix.nearField() || hMatrix.lowRankGroups())
+    throw std::invalid_argument(
+        std::string(function) +
+        "(): H-matrices must be initialized, not frozen and hold their near "
+        "field and low-rank leaves.");
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>>
+formattedAddition(const HMatrix<ValueType, N> &x,
+                  const HMatrix<ValueType, N> &y, double eps,
+                  ValueType alpha, ValueType beta, int maxThreadCount) {
+
+  checkArithmeticOperand(x, "formattedAddition");
+  checkArithmeticOperand(y, "formattedAddition");
+  const auto blockClusterTree = x.blockClusterTree();
+  if (blockClusterTree != y.blockClusterTree())
+    throw std::invalid_argument("formattedAddition(): "
+                                "H-matrices must share their block cluster "
+                                "tree.");
+
+  HMatrixArithmetic<ValueType, N> arithmetic(eps);
+  shared_ptr<typename HMatrixArithmetic<ValueType, N>::Block> sum;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    sum = arithmetic.zeroBlock(blockClusterTree->root());
+    arithmetic.add(*sum, *arithmetic.copyBlock(x, blockClusterTree->root()),
+                   alpha);
+    arithmetic.add(*sum, *arithmetic.copyBlock(y, blockClusterTree->root()),
+                   beta);
+  });
+  return arithmetic.toHMatrix(*sum, blockClusterTree, maxThreadCount);
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>> formattedMultiplication(
+    const HMatrix<ValueType, N> &x, const HMatrix<ValueType, N> &y,
+    double eps, ValueType alpha,
+    const shared_ptr<const BlockClusterTree<N>> &resultTree,
+    int maxThreadCount) {
+
+  typedef HMatrixArithmetic<ValueType, N> Arithmetic;
+
+  checkArithmeticOperand(x, "formattedMultiplication");
+  checkArithmeticOperand(y, "formattedMultiplication");
+  const auto xTree = x.blockClusterTree();
+  const auto yTree = y.blockClusterTree();
+  if (!Arithmetic::sameClusterTree(*xTree->columnClusterTree(),
+                                   *yTree->rowClusterTree()))
+    throw std::invalid_argument("formattedMultiplication(): "
+                                "The column cluster tree of the first "
+                                "factor must be the row cluster tree of the "
+                                "second one.");
+
+  shared_ptr<const BlockClusterTree<N>> tree = resultTree;
+  if (!tree) {
+    if (Arithmetic::sameClusterTree(*xTree->columnClusterTree(),
+                                    *yTree->columnClusterTree()))
+      tree = xTree;
+    else if (Arithmetic::sameClusterTree(*xTree->rowClusterTree(),
+                                         *yTree->rowClusterTree()))
+      tree = yTree;
+    else
+      throw std::invalid_argument("formattedMultiplication(): "
+                                  "Neither block cluster tree fits the "
+                                  "product; pass one explicitly.");
+  } else if (!Arithmetic::sameClusterTree(*tree->rowClusterTree(),
+                                          *xTree->rowClusterTree()) ||
+             !Arithmetic::sameClusterTree(*tree->columnClusterTree(),
+                                          *yTree->columnClusterTree()))
+    throw std::invalid_argument("formattedMultiplication(): "
+                                "The block cluster tree of the result must "
+                                "be built on the row cluster tree of the "
+                                "first and the column cluster tree of the "
+                                "second factor.");
+
+  Arithmetic arithmetic(eps);
+  shared_ptr<typename Arithmetic::Block> product;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    product = arithmetic.zeroBlock(tree->root());
+    arithmetic.multiplyAdd(*product, *arithmetic.copyBlock(x, xTree->root()),
+                           false, *arithmetic.copyBlock(y, yTree->root()),
+                           false, alpha);
+  });
+  return arithmetic.toHMatrix(*product, tree, maxThreadCount);
+}
+}
+
+#endif
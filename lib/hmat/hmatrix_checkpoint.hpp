@@ -0,0 +1,116 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_CHECKPOINT_HPP
+#define HMAT_HMATRIX_CHECKPOINT_HPP
+
+#include "common.hpp"
+#include "block_cluster_tree.hpp"
+#include "hmatrix_compressor.hpp"
+#include "hmatrix_data.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <tbb/mutex.h>
+#include <tbb/tick_count.h>
+
+namespace hmat {
+
+/** \brief Checkpoint file of the leaves of an H-matrix under compression.
+ *
+ *  The leaves passed to record() are appended to the file in the format
+ *  described by HMatrixCheckpointHeader, batch by batch whenever \p
+ *  interval seconds have passed since the last write, and on flush() and
+ *  destruction. If the file already exists and was written for the same
+ *  block cluster tree, value type and \p signature, its leaves are read by
+ *  the constructor and handed out by restore(), so that an interrupted
+ *  compression can be resumed. Otherwise the file is started anew.
+ *
+ *  The signature is chosen by the caller and should change whenever the
+ *  entries of the compressed matrix or the accuracy of the compression
+ *  change. restore() and record() may be called concurrently for
+ *  different leaves. */
+template <typename ValueType, int N> class HMatrixCheckpoint {
+public:
+  HMatrixCheckpoint(const std::string &fileName,
+                    const shared_ptr<const BlockClusterTree<N>> &
+                        blockClusterTree,
+                    std::uint64_t signature, double interval);
+
+  /** \brief Write the pending leaves; errors are ignored. */
+  ~HMatrixCheckpoint();
+
+  HMatrixCheckpoint(const HMatrixCheckpoint &) = delete;
+  HMatrixCheckpoint &operator=(const HMatrixCheckpoint &) = delete;
+
+  /** \brief Number of leaves read from an existing file. */
+  std::size_t restoredLeafCount() const;
+
+  /** \brief The data of the leaf read from the file, or a null pointer if
+   *  the file holds no data for it.
+   *
+   *  The checkpoint releases the data, so that every leaf is restored at
+   *  most once. */
+  shared_ptr<HMatrixData<ValueType>>
+  restore(const BlockClusterTreeNode<N> &blockClusterTreeNode);
+
+  /** \brief Append a compressed leaf to the file.
+   *
+   *  Low-rank blocks stored in single precision are not recorded. */
+  void record(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+              const HMatrixData<ValueType> &hMatrixData);
+
+  /** \brief Write all pending leaves to the file. */
+  void flush();
+
+private:
+  std::uint64_t treeChecksum() const;
+  void readFile(std::uint64_t signature);
+  void flushPending();
+
+  std::string m_fileName;
+  shared_ptr<const BlockClusterTree<N>> m_blockClusterTree;
+  double m_interval;
+
+  std::vector<shared_ptr<HMatrixData<ValueType>>> m_restoredData;
+  std::size_t m_restoredLeafCount;
+
+  tbb::mutex m_mutex;
+  std::ofstream m_stream;
+  std::vector<char> m_pending;
+  tbb::tick_count m_lastWrite;
+};
+
+/** \brief Compressor taking the leaves found in an HMatrixCheckpoint from
+ *  it and recording all others there after compressing them with another
+ *  compressor.
+ *
+ *  The wrapped compressor should produce the leaves in their final
+ *  accuracy but before any conversion of their storage, so that restored
+ *  leaves are post-processed like new ones. If \p restoreInadmissibleLeaves
+ *  is false, inadmissible leaves are always compressed again, e.g. because
+ *  the wrapped compressor derives its accuracy from their norms. */
+template <typename ValueType, int N>
+class HMatrixCheckpointingCompressor : public HMatrixCompressor<ValueType, N> {
+public:
+  HMatrixCheckpointingCompressor(
+      const HMatrixCompressor<ValueType, N> &compressor,
+      HMatrixCheckpoint<ValueType, N> &checkpoint,
+      bool restoreInadmissibleLeaves = true);
+
+  void compressBlock(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                     shared_ptr<HMatrixData<ValueType>> &hMatrixData) const
+      override;
+
+private:
+  const HMatrixCompressor<ValueType, N> &m_compressor;
+  HMatrixCheckpoint<ValueType, N> &m_checkpoint;
+  bool m_restoreInadmissibleLeaves;
+};
+}
+
+#include "hmatrix_checkpoint_impl.hpp"
+
+#endif
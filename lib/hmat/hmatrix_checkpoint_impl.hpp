@@ -0,0 +1,292 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_CHECKPOINT_IMPL_HPP
+#define HMAT_HMATRIX_CHECKPOINT_IMPL_HPP
+
+#include "hmatrix_checkpoint.hpp"
+#include "hmatrix_dense_data.hpp"
+#include "hmatrix_file_format.hpp"
+#include "hmatrix_low_rank_data.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+HMatrixCheckpoint<ValueType, N>::HMatrixCheckpoint(
+    const std::string &fileName,
+    const shared_ptr<const BlockClusterTree<N>> &blockClusterTree,
+    std::uint64_t signature, double interval)
+    : m_fileName(fileName), m_blockClusterTree(blockClusterTree),
+      m_interval(interval), m_restoredLeafCount(0),
+      m_lastWrite(tbb::tick_count::now()) {
+
+  if (fileName.empty())
+    throw std::invalid_argument("HMatrixCheckpoint::HMatrixCheckpoint(): "
+                                "File name is empty.");
+  m_restoredData.resize(blockClusterTree->treeIndex().numberOfNodes());
+  readFile(signature);
+}
+
+template <typename ValueType, int N>
+HMatrixCheckpoint<ValueType, N>::~HMatrixCheckpoint() {
+  try {
+    flush();
+  } catch (...) {
+  }
+}
+
+template <typename ValueType, int N>
+std::size_t HMatrixCheckpoint<ValueType, N>::restoredLeafCount() const {
+  return m_restoredLeafCount;
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrixData<ValueType>> HMatrixCheckpoint<ValueType, N>::restore(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode) {
+  shared_ptr<HMatrixData<ValueType>> result;
+  std::size_t index = blockClusterTreeNode.index();
+  if (index < m_restoredData.size())
+    result.swap(m_restoredData[index]);
+  return result;
+}
+
+template <typename ValueType, int N>
+void HMatrixCheckpoint<ValueType, N>::record(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    const HMatrixData<ValueType> &hMatrixData) {
+
+  IndexRangeType rowRange;
+  IndexRangeType columnRange;
+  std::size_t rows;
+  std::size_t cols;
+  getBlockClusterTreeNodeDimensions(blockClusterTreeNode, rowRange,
+                                    columnRange, rows, cols);
+
+  HMatrixCheckpointRecord record = HMatrixCheckpointRecord();
+  record.blockIndex = blockClusterTreeNode.index();
+  record.rowRange[0] = rowRange[0];
+  record.rowRange[1] = rowRange[1];
+  record.columnRange[0] = columnRange[0];
+  record.columnRange[1] = columnRange[1];
+
+  // The record is serialised before the lock is taken
+  std::vector<char> buffer;
+  auto append = [&buffer](const void *data, std::size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  };
+  std::vector<ValueType> values;
+  const ValueType *payload[2] = {nullptr, nullptr};
+  std::size_t payloadSize[2] = {0, 0};
+  if (auto lowRankData =
+          dynamic_cast<const HMatrixLowRankData<ValueType> *>(&hMatrixData)) {
+    if (lowRankData->isSinglePrecision())
+      return;
+    record.lowRank = 1;
+    record.rank = lowRankData->rank();
+    payload[0] = lowRankData->A().memptr();
+    payloadSize[0] = lowRankData->A().n_elem * sizeof(ValueType);
+    payload[1] = lowRankData->B().memptr();
+    payloadSize[1] = lowRankData->B().n_elem * sizeof(ValueType);
+  } else {
+    auto denseData =
+        dynamic_cast<const HMatrixDenseData<ValueType> *>(&hMatrixData);
+    if (!denseData)
+      return;
+    values.resize(rows * cols);
+    denseData->copyValues(values.data());
+    payload[0] = values.data();
+    payloadSize[0] = values.size() * sizeof(ValueType);
+  }
+  record.checksum = hMatrixFileChecksum(
+      reinterpret_cast<const char *>(payload[1]), payloadSize[1],
+      hMatrixFileChecksum(reinterpret_cast<const char *>(payload[0]),
+                          payloadSize[0]));
+  buffer.reserve(sizeof(record) + payloadSize[0] + payloadSize[1]);
+  append(&record, sizeof(record));
+  append(payload[0], payloadSize[0]);
+  append(payload[1], payloadSize[1]);
+
+  tbb::mutex::scoped_lock lock(m_mutex);
+  m_pending.insert(m_pending.end(), buffer.begin(), buffer.end());
+  if ((tbb::tick_count::now() - m_lastWrite).seconds() >= m_interval)
+    flushPending();
+}
+
+template <typename ValueType, int N>
+void HMatrixCheckpoint<ValueType, N>::flush() {
+  tbb::mutex::scoped_lock lock(m_mutex);
+  flushPending();
+}
+
+template <typename ValueType, int N>
+void HMatrixCheckpoint<ValueType, N>::flushPending() {
+  m_lastWrite = tbb::tick_count::now();
+  if (m_pending.empty())
+    return;
+  m_stream.write(m_pending.data(), m_pending.size());
+  m_stream.flush();
+  if (!m_stream)
+    throw std::runtime_error("HMatrixCheckpoint::flush(): "
+                             "Writing the checkpoint file " +
+                             m_fileName + " failed.");
+  std::vector<char>().swap(m_pending);
+}
+
+template <typename ValueType, int N>
+std::uint64_t HMatrixCheckpoint<ValueType, N>::treeChecksum() const {
+  const auto &treeIndex = m_blockClusterTree->treeIndex();
+  std::uint64_t checksum = hMatrixFileChecksum(nullptr, 0);
+  for (std::size_t i = 0; i < treeIndex.numberOfNodes(); ++i) {
+    const auto &data = treeIndex.node(i).data();
+    const IndexRangeType &rowRange = data.rowClusterTreeNode->data().indexRange;
+    const IndexRangeType &columnRange =
+        data.columnClusterTreeNode->data().indexRange;
+    const std::uint64_t values[6] = {rowRange[0],    rowRange[1],
+                                     columnRange[0], columnRange[1],
+                                     data.admissible, treeIndex.isLeaf(i)};
+    checksum = hMatrixFileChecksum(reinterpret_cast<const char *>(values),
+                                   sizeof(values), checksum);
+  }
+  return checksum;
+}
+
+template <typename ValueType, int N>
+void HMatrixCheckpoint<ValueType, N>::readFile(std::uint64_t signature) {
+
+  HMatrixCheckpointHeader header = HMatrixCheckpointHeader();
+  std::memcpy(header.magic, HMATRIX_CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.version = HMATRIX_CHECKPOINT_VERSION;
+  header.byteOrderMark = HMATRIX_FILE_BYTE_ORDER_MARK;
+  header.valueTypeId = hMatrixFileValueTypeId<ValueType>();
+  header.branchingFactor = N;
+  header.rows = m_blockClusterTree->rows();
+  header.columns = m_blockClusterTree->columns();
+  header.numberOfBlockNodes = m_restoredData.size();
+  header.treeChecksum = treeChecksum();
+  header.signature = signature;
+
+  // 64-bit words keep the payloads suitably aligned
+  std::vector<std::uint64_t> buffer;
+  std::size_t size = 0;
+  {
+    std::ifstream stream(m_fileName.c_str(), std::ios::binary | std::ios::ate);
+    if (stream) {
+      size = stream.tellg();
+      buffer.resize((size + sizeof(std::uint64_t) - 1) /
+                    sizeof(std::uint64_t));
+      stream.seekg(0);
+      stream.read(reinterpret_cast<char *>(buffer.data()), size);
+      if (!stream)
+        size = 0;
+    }
+  }
+  const char *data = reinterpret_cast<const char *>(buffer.data());
+
+  // A file written for another matrix is discarded
+  std::size_t validSize = 0;
+  if (size >= sizeof(header) && !std::memcmp(data, &header, sizeof(header))) {
+    validSize = sizeof(header);
+    const auto &treeIndex = m_blockClusterTree->treeIndex();
+    while (size - validSize >= sizeof(HMatrixCheckpointRecord)) {
+      HMatrixCheckpointRecord record;
+      std::memcpy(&record, data + validSize, sizeof(record));
+      if (record.blockIndex >= m_restoredData.size() ||
+          !treeIndex.isLeaf(record.blockIndex))
+        break;
+      IndexRangeType rowRange;
+      IndexRangeType columnRange;
+      std::size_t rows;
+      std::size_t cols;
+      getBlockClusterTreeNodeDimensions(treeIndex.node(record.blockIndex),
+                                        rowRange, columnRange, rows, cols);
+      if (record.rowRange[0] != rowRange[0] ||
+          record.rowRange[1] != rowRange[1] ||
+          record.columnRange[0] != columnRange[0] ||
+          record.columnRange[1] != columnRange[1] ||
+          (record.lowRank && record.rank > std::min(rows, cols)))
+        break;
+      const std::size_t elements =
+          record.lowRank ? (rows + cols) * record.rank : rows * cols;
+      const std::size_t payloadSize = elements * sizeof(ValueType);
+      const std::size_t payloadOffset = validSize + sizeof(record);
+      if ((size - payloadOffset) < payloadSize ||
+          hMatrixFileChecksum(data + payloadOffset, payloadSize) !=
+              record.checksum)
+        break;
+
+      // Records and payloads are multiples of the size of the values, so
+      // the payload is aligned
+      const ValueType *payload =
+          reinterpret_cast<const ValueType *>(data + payloadOffset);
+      shared_ptr<HMatrixData<ValueType>> &leafData =
+          m_restoredData[record.blockIndex];
+      if (!leafData)
+        ++m_restoredLeafCount;
+      if (record.lowRank) {
+        shared_ptr<HMatrixLowRankData<ValueType>> lowRankData(
+            new HMatrixLowRankData<ValueType>());
+        lowRankData->A() = arma::Mat<ValueType>(payload, rows, record.rank);
+        lowRankData->B() =
+            arma::Mat<ValueType>(payload + rows * record.rank, record.rank,
+                                 cols);
+        leafData = lowRankData;
+      } else {
+        shared_ptr<HMatrixDenseData<ValueType>> denseData(
+            new HMatrixDenseData<ValueType>());
+        denseData->A() = arma::Mat<ValueType>(payload, rows, cols);
+        leafData = denseData;
+      }
+      validSize = payloadOffset + payloadSize;
+    }
+  }
+  std::vector<std::uint64_t>().swap(buffer);
+
+  // An incomplete tail is cut off before new records are appended
+  if (validSize > 0) {
+    if (validSize < size && ::truncate(m_fileName.c_str(), validSize) != 0)
+      throw std::runtime_error("HMatrixCheckpoint::HMatrixCheckpoint(): "
+                               "Cannot truncate the checkpoint file " +
+                               m_fileName + ".");
+    m_stream.open(m_fileName.c_str(), std::ios::binary | std::ios::app);
+  } else {
+    m_stream.open(m_fileName.c_str(), std::ios::binary | std::ios::trunc);
+    m_stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_stream.flush();
+  }
+  if (!m_stream)
+    throw std::runtime_error("HMatrixCheckpoint::HMatrixCheckpoint(): "
+                             "Cannot open the checkpoint file " +
+                             m_fileName + " for writing.");
+}
+
+template <typename ValueType, int N>
+HMatrixCheckpointingCompressor<ValueType, N>::HMatrixCheckpointingCompressor(
+    const HMatrixCompressor<ValueType, N> &compressor,
+    HMatrixCheckpoint<ValueType, N> &checkpoint,
+    bool restoreInadmissibleLeaves)
+    : m_compressor(compressor), m_checkpoint(checkpoint),
+      m_restoreInadmissibleLeaves(restoreInadmissibleLeaves) {}
+
+template <typename ValueType, int N>
+void HMatrixCheckpointingCompressor<ValueType, N>::compressBlock(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    shared_ptr<HMatrixData<ValueType>> &hMatrixData) const {
+
+  const bool restore =
+      m_restoreInadmissibleLeaves || blockClusterTreeNode.data().admissible;
+  if (restore) {
+    hMatrixData = m_checkpoint.restore(blockClusterTreeNode);
+    if (hMatrixData)
+      return;
+  }
+  m_compressor.compressBlock(blockClusterTreeNode, hMatrixData);
+  if (restore)
+    m_checkpoint.record(blockClusterTreeNode, *hMatrixData);
+}
+}
+
+#endif
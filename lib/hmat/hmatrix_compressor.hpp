@@ -11,6 +11,11 @@ namespace hmat {
 
 template <typename ValueType> class HMatrixData;
 
+/** \brief Interface for the compression of a single H-matrix block.
+ *
+ *  HMatrix::initialize calls compressBlock concurrently for different leaves,
+ *  so implementations must be thread-safe. All inadmissible leaves are
+ *  compressed before the first admissible one. */
 template <typename ValueType, int N> class HMatrixCompressor {
 public:
   virtual void
@@ -29,8 +29,12 @@ void HMatrixDenseCompressor<ValueType, N>::compressBlock(
   arma::Mat<ValueType> &A =
       static_cast<HMatrixDenseData<ValueType> *>(hMatrixData.get())->A();
 
-  m_dataAccessor.computeMatrixBlock(rowIndexRange, columnIndexRange,
-                                    blockClusterTreeNode, A);
+  if (m_dataAccessor.isZeroBlock(blockClusterTreeNode))
+    A.zeros(rowIndexRange[1] - rowIndexRange[0],
+            columnIndexRange[1] - columnIndexRange[0]);
+  else
+    m_dataAccessor.computeMatrixBlock(rowIndexRange, columnIndexRange,
+                                      blockClusterTreeNode, A);
 }
 }
 
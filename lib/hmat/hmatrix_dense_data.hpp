@@ -6,12 +6,15 @@
 #include "common.hpp"
 #include "hmatrix_data.hpp"
 #include <armadillo>
+#include <vector>
 
 namespace hmat {
 
 template <typename ValueType>
 class HMatrixDenseData : public HMatrixData<ValueType> {
 public:
+  HMatrixDenseData();
+
   void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
              TransposeMode trans, ValueType alpha, ValueType beta) const
       override;
@@ -20,6 +23,7 @@ public:
              TransposeMode trans, ValueType alpha, ValueType beta) const
       override;
 
+  /** \brief The block. Empty once compressed. */
   const arma::Mat<ValueType> &A() const;
   arma::Mat<ValueType> &A();
 
@@ -31,8 +35,36 @@ public:
 
   double memSizeKb() const override;
 
+  /** \brief Store the block with the fixed-rate codec of
+   *  encodeDenseBlock(), using \p bitsPerValue bits per real value.
+   *
+   *  The full-precision block is released. Afterwards apply() decodes the
+   *  block into a buffer of the calling thread before each product. Does
+   *  nothing if the block already is compressed. */
+  void compress(int bitsPerValue);
+
+  /** \brief Decode a compressed block back into A(). */
+  void decompress();
+
+  bool isCompressed() const;
+
+  /** \brief Write the rows() * cols() values of the block in column-major
+   *  order to \p target, decoding them if the block is compressed. */
+  void copyValues(ValueType *target) const;
+
 private:
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+
+  void applyImpl(const arma::Mat<ValueType> &A,
+                 const arma::subview<ValueType> &X, arma::subview<ValueType> &Y,
+                 TransposeMode trans, ValueType alpha, ValueType beta) const;
+
   arma::Mat<ValueType> m_A;
+
+  int m_bitsPerValue; // 0 if the block is not compressed
+  arma::uword m_compressedRows;
+  arma::uword m_compressedCols;
+  std::vector<unsigned char> m_compressedA;
 };
 }
 
@@ -7,9 +7,17 @@
 #include <armadillo>
 
 #include "hmatrix_dense_data.hpp"
+#include "dense_block_codec.hpp"
+
+#include <algorithm>
+#include <tbb/enumerable_thread_specific.h>
 
 namespace hmat {
 
+template <typename ValueType>
+HMatrixDenseData<ValueType>::HMatrixDenseData()
+    : m_bitsPerValue(0), m_compressedRows(0), m_compressedCols(0) {}
+
 template <typename ValueType>
 void HMatrixDenseData<ValueType>::apply(const arma::Mat<ValueType> &X,
                                         arma::Mat<ValueType> &Y,
@@ -27,6 +35,29 @@ void HMatrixDenseData<ValueType>::apply(const arma::subview<ValueType> &X,
                                         arma::subview<ValueType> &Y,
                                         TransposeMode trans, ValueType alpha,
                                         ValueType beta) const {
+  if (!m_bitsPerValue) {
+    applyImpl(m_A, X, Y, trans, alpha, beta);
+    return;
+  }
+
+  // Decoding buffers grow to the largest compressed block a thread applies
+  static tbb::enumerable_thread_specific<std::vector<ValueType>> buffers;
+  std::vector<ValueType> &buffer = buffers.local();
+  if (buffer.size() < m_compressedRows * m_compressedCols)
+    buffer.resize(m_compressedRows * m_compressedCols);
+  copyValues(buffer.data());
+  const arma::Mat<ValueType> A(buffer.data(), m_compressedRows,
+                               m_compressedCols, false, true);
+  applyImpl(A, X, Y, trans, alpha, beta);
+}
+
+template <typename ValueType>
+void HMatrixDenseData<ValueType>::applyImpl(const arma::Mat<ValueType> &A,
+                                            const arma::subview<ValueType> &X,
+                                            arma::subview<ValueType> &Y,
+                                            TransposeMode trans,
+                                            ValueType alpha,
+                                            ValueType beta) const {
   if (beta == ValueType(0))
     Y.zeros();
   if (alpha == ValueType(0)) {
@@ -35,13 +66,13 @@ void HMatrixDenseData<ValueType>::apply(const arma::subview<ValueType> &X,
   }
 
   if (trans == TransposeMode::NOTRANS)
-    Y = alpha * m_A * X + beta * Y;
+    Y = alpha * A * X + beta * Y;
   else if (trans == TransposeMode::TRANS)
-    Y = alpha * m_A.st() * X + beta * Y;
+    Y = alpha * A.st() * X + beta * Y;
   else if (trans == TransposeMode::CONJ)
-    Y = alpha * arma::conj(m_A) * X + beta * Y;
+    Y = alpha * arma::conj(A) * X + beta * Y;
   else
-    Y = alpha * m_A.t() * X + beta * Y;
+    Y = alpha * A.t() * X + beta * Y;
 }
 
 template <typename ValueType>
@@ -55,26 +86,86 @@ arma::Mat<ValueType> &HMatrixDenseData<ValueType>::A() {
 }
 
 template <typename ValueType> int HMatrixDenseData<ValueType>::rows() const {
-  return m_A.n_rows;
+  return m_bitsPerValue ? m_compressedRows : m_A.n_rows;
 }
 
 template <typename ValueType> int HMatrixDenseData<ValueType>::cols() const {
-  return m_A.n_cols;
+  return m_bitsPerValue ? m_compressedCols : m_A.n_cols;
 }
 
 template <typename ValueType> int HMatrixDenseData<ValueType>::rank() const {
-  return m_A.n_cols;
+  return this->cols();
 }
 
 template <typename ValueType>
 typename ScalarTraits<ValueType>::RealType
 HMatrixDenseData<ValueType>::frobeniusNorm() const {
+
+  if (m_bitsPerValue) {
+    HMatrixDenseData<ValueType> decompressed(*this);
+    decompressed.decompress();
+    return decompressed.frobeniusNorm();
+  }
   return norm(m_A, "fro");
 }
 
 template <typename ValueType>
 double HMatrixDenseData<ValueType>::memSizeKb() const {
+  if (m_bitsPerValue)
+    return m_compressedA.size() / (1.0 * 1024);
   return sizeof(ValueType) * (this->rows()) * (this->cols()) / (1.0 * 1024);
 }
+
+template <typename ValueType>
+void HMatrixDenseData<ValueType>::compress(int bitsPerValue) {
+
+  if (m_bitsPerValue)
+    return;
+
+  // Complex values are coded as pairs of real values
+  const std::size_t realCount =
+      m_A.n_elem * (sizeof(ValueType) / sizeof(RealType));
+  std::vector<unsigned char> compressedA(
+      denseBlockCodecSize(realCount, bitsPerValue));
+  encodeDenseBlock(reinterpret_cast<const RealType *>(m_A.memptr()),
+                   realCount, bitsPerValue, compressedA.data());
+  m_compressedA.swap(compressedA);
+  m_compressedRows = m_A.n_rows;
+  m_compressedCols = m_A.n_cols;
+  m_bitsPerValue = bitsPerValue;
+  m_A.reset();
+}
+
+template <typename ValueType>
+void HMatrixDenseData<ValueType>::decompress() {
+
+  if (!m_bitsPerValue)
+    return;
+
+  m_A.set_size(m_compressedRows, m_compressedCols);
+  copyValues(m_A.memptr());
+  std::vector<unsigned char>().swap(m_compressedA);
+  m_compressedRows = 0;
+  m_compressedCols = 0;
+  m_bitsPerValue = 0;
+}
+
+template <typename ValueType>
+bool HMatrixDenseData<ValueType>::isCompressed() const {
+  return m_bitsPerValue != 0;
+}
+
+template <typename ValueType>
+void HMatrixDenseData<ValueType>::copyValues(ValueType *target) const {
+
+  if (!m_bitsPerValue) {
+    std::copy(m_A.memptr(), m_A.memptr() + m_A.n_elem, target);
+    return;
+  }
+  decodeDenseBlock(m_compressedA.data(),
+                   m_compressedRows * m_compressedCols *
+                       (sizeof(ValueType) / sizeof(RealType)),
+                   m_bitsPerValue, reinterpret_cast<RealType *>(target));
+}
 }
 #endif
@@ -0,0 +1,340 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_FILE_FORMAT_HPP
+#define HMAT_HMATRIX_FILE_FORMAT_HPP
+
+#include "common.hpp"
+
+#include <cerrno>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hmat {
+
+/** \brief Header of the binary files written by HMatrix::save().
+ *
+ *  The header is followed by the row cluster tree, the column cluster
+ *  tree, the block cluster tree, the frozen leaf table, the payload pool
+ *  and the pool of low-rank factors stored in single precision. Every
+ *  section starts at a multiple of HMATRIX_FILE_ALIGNMENT bytes, so that a
+ *  memory-mapped pool can be used in place. All data is stored in native
+ *  byte order. */
+struct HMatrixFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrderMark;
+  std::uint32_t valueTypeId;
+  std::uint32_t branchingFactor;
+  std::uint64_t rows;
+  std::uint64_t columns;
+  std::uint64_t rowClusterTreeOffset;
+  std::uint64_t columnClusterTreeOffset;
+  std::uint64_t blockClusterTreeOffset;
+  std::uint64_t leafOffset;
+  std::uint64_t poolOffset;
+  std::uint64_t singlePrecisionPoolOffset;
+  std::uint64_t fileSize;
+  std::uint64_t checksum; // FNV-1a of all bytes following the header
+};
+
+struct HMatrixFileClusterNode {
+  std::uint64_t indexRange[2];
+  double bounds[6];
+  std::uint64_t isLeaf;
+};
+
+struct HMatrixFileBlockNode {
+  std::uint64_t rowClusterNode;    // preorder index in the row tree
+  std::uint64_t columnClusterNode; // preorder index in the column tree
+  std::uint64_t admissible;
+  std::uint64_t isLeaf;
+};
+
+struct HMatrixFileLeaf {
+  std::uint64_t rowRange[2];
+  std::uint64_t columnRange[2];
+  std::uint64_t lowRank;
+  std::uint64_t singlePrecision; // factors in the single precision pool
+  std::uint64_t rank;
+  std::uint64_t offset;
+};
+
+const char HMATRIX_FILE_MAGIC[8] = {'B', 'E', 'M', 'P', 'P', 'H', 'M', '\0'};
+const std::uint32_t HMATRIX_FILE_VERSION = 2;
+const std::uint32_t HMATRIX_FILE_BYTE_ORDER_MARK = 0x01020304;
+const std::size_t HMATRIX_FILE_ALIGNMENT = 64;
+
+/** \brief Header of the checkpoint files of HMatrixCheckpoint.
+ *
+ *  The header is followed by a sequence of leaf records, each directly
+ *  followed by its payload: the columns of a dense block, or the factors A
+ *  and B of a low-rank block, in the value type of the H-matrix. Records
+ *  are only appended, so a file cut short by an interrupted write ends
+ *  with at most one incomplete record, which is dropped when the file is
+ *  read. All data is stored in native byte order. */
+struct HMatrixCheckpointHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrderMark;
+  std::uint32_t valueTypeId;
+  std::uint32_t branchingFactor;
+  std::uint64_t rows;
+  std::uint64_t columns;
+  std::uint64_t numberOfBlockNodes;
+  std::uint64_t treeChecksum; // FNV-1a of the block cluster tree structure
+  std::uint64_t signature;    // identifies the operator and its parameters
+};
+
+struct HMatrixCheckpointRecord {
+  std::uint64_t blockIndex; // number of the leaf in the block tree index
+  std::uint64_t rowRange[2];
+  std::uint64_t columnRange[2];
+  std::uint64_t lowRank;
+  std::uint64_t rank;
+  std::uint64_t checksum; // FNV-1a of the payload
+};
+
+const char HMATRIX_CHECKPOINT_MAGIC[8] = {'B', 'E', 'M', 'P', 'P', 'H', 'C',
+                                          '\0'};
+const std::uint32_t HMATRIX_CHECKPOINT_VERSION = 1;
+
+template <typename ValueType> std::uint32_t hMatrixFileValueTypeId();
+template <> inline std::uint32_t hMatrixFileValueTypeId<float>() { return 1; }
+template <> inline std::uint32_t hMatrixFileValueTypeId<double>() { return 2; }
+template <>
+inline std::uint32_t hMatrixFileValueTypeId<std::complex<float>>() {
+  return 3;
+}
+template <>
+inline std::uint32_t hMatrixFileValueTypeId<std::complex<double>>() {
+  return 4;
+}
+
+inline std::uint64_t hMatrixFileChecksum(const char *data, std::size_t size,
+                                         std::uint64_t hash =
+                                             14695981039346656037ULL) {
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/** \brief Sequential writer keeping track of the position and checksum. */
+class HMatrixFileWriter {
+public:
+  explicit HMatrixFileWriter(const std::string &fileName)
+      : m_stream(fileName.c_str(), std::ios::binary | std::ios::trunc),
+        m_position(0), m_checksum(hMatrixFileChecksum(nullptr, 0)) {
+    if (!m_stream)
+      throw std::runtime_error("HMatrixFileWriter::HMatrixFileWriter(): "
+                               "Cannot open file " +
+                               fileName + " for writing.");
+    // Placeholder, overwritten by finish()
+    HMatrixFileHeader header = HMatrixFileHeader();
+    m_stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_position = sizeof(header);
+  }
+
+  void write(const void *data, std::size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    m_stream.write(bytes, size);
+    m_checksum = hMatrixFileChecksum(bytes, size, m_checksum);
+    m_position += size;
+  }
+
+  template <typename T> void write(const T &value) {
+    write(&value, sizeof(T));
+  }
+
+  /** \brief Pad with zeros up to the next aligned position and return it. */
+  std::uint64_t align() {
+    static const char zeros[HMATRIX_FILE_ALIGNMENT] = {};
+    std::size_t padding =
+        (HMATRIX_FILE_ALIGNMENT - m_position % HMATRIX_FILE_ALIGNMENT) %
+        HMATRIX_FILE_ALIGNMENT;
+    write(zeros, padding);
+    return m_position;
+  }
+
+  void finish(HMatrixFileHeader header) {
+    header.fileSize = m_position;
+    header.checksum = m_checksum;
+    m_stream.seekp(0);
+    m_stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_stream.close();
+    if (!m_stream)
+      throw std::runtime_error("HMatrixFileWriter::finish(): "
+                               "Writing the file failed.");
+  }
+
+private:
+  std::ofstream m_stream;
+  std::uint64_t m_position;
+  std::uint64_t m_checksum;
+};
+
+/** \brief Sequential reader of an in-memory file image.
+ *
+ *  Returns pointers into the image; every read is checked against the
+ *  image size. */
+class HMatrixFileReader {
+public:
+  HMatrixFileReader(const char *data, std::size_t size, std::uint64_t offset)
+      : m_data(data), m_size(size), m_position(offset) {}
+
+  template <typename T> const T *read(std::uint64_t count) {
+    if (m_position > m_size || count > (m_size - m_position) / sizeof(T))
+      throw std::runtime_error("HMatrixFileReader::read(): "
+                               "File is truncated or corrupt.");
+    const T *result = reinterpret_cast<const T *>(m_data + m_position);
+    m_position += count * sizeof(T);
+    return result;
+  }
+
+private:
+  const char *m_data;
+  std::size_t m_size;
+  std::uint64_t m_position;
+};
+
+/** \brief Read-only memory mapping of a whole file. */
+class HMatrixMappedFile {
+public:
+  explicit HMatrixMappedFile(const std::string &fileName)
+      : m_data(nullptr), m_size(0) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("HMatrixMappedFile::HMatrixMappedFile(): "
+                               "Cannot open file " +
+                               fileName + ".");
+    struct stat fileStatus;
+    if (::fstat(fd, &fileStatus) != 0 || fileStatus.st_size == 0) {
+      ::close(fd);
+      throw std::runtime_error("HMatrixMappedFile::HMatrixMappedFile(): "
+                               "Cannot determine the size of file " +
+                               fileName + ".");
+    }
+    m_size = fileStatus.st_size;
+    void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+      throw std::runtime_error("HMatrixMappedFile::HMatrixMappedFile(): "
+                               "Cannot map file " +
+                               fileName + ".");
+    m_data = static_cast<const char *>(data);
+  }
+
+  ~HMatrixMappedFile() {
+    if (m_data)
+      ::munmap(const_cast<char *>(m_data), m_size);
+  }
+
+  HMatrixMappedFile(const HMatrixMappedFile &) = delete;
+  HMatrixMappedFile &operator=(const HMatrixMappedFile &) = delete;
+
+  const char *data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+
+private:
+  const char *m_data;
+  std::size_t m_size;
+};
+
+/** \brief Scratch file holding the payloads of an out-of-core H-matrix.
+ *
+ *  The file is created in the given directory and unlinked at once, so
+ *  that it disappears with the object. Data are appended by append();
+ *  map() then maps the whole file read-only, so that its pages are read
+ *  on demand and can be evicted by the kernel. */
+class HMatrixScratchFile {
+public:
+  explicit HMatrixScratchFile(const std::string &directory)
+      : m_fd(-1), m_data(nullptr), m_size(0) {
+    std::string path = directory + "/bempp_hmatrix_XXXXXX";
+    std::vector<char> pathBuffer(path.begin(), path.end());
+    pathBuffer.push_back('\0');
+    m_fd = ::mkstemp(&pathBuffer[0]);
+    if (m_fd < 0)
+      throw std::runtime_error("HMatrixScratchFile::HMatrixScratchFile(): "
+                               "Cannot create a scratch file in " +
+                               directory + ".");
+    ::unlink(&pathBuffer[0]);
+  }
+
+  ~HMatrixScratchFile() {
+    if (m_data)
+      ::munmap(const_cast<char *>(m_data), m_size);
+    if (m_fd >= 0)
+      ::close(m_fd);
+  }
+
+  HMatrixScratchFile(const HMatrixScratchFile &) = delete;
+  HMatrixScratchFile &operator=(const HMatrixScratchFile &) = delete;
+
+  void append(const void *data, std::size_t size) {
+    if (m_fd < 0)
+      throw std::logic_error("HMatrixScratchFile::append(): "
+                             "File is already mapped.");
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+      ssize_t written = ::write(m_fd, bytes, size);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        throw std::runtime_error("HMatrixScratchFile::append(): "
+                                 "Writing the scratch file failed.");
+      }
+      bytes += written;
+      size -= written;
+      m_size += written;
+    }
+  }
+
+  /** \brief Map the file; no data can be appended afterwards. An empty
+   *  file is not mapped and data() returns a null pointer. */
+  void map() {
+    if (m_size > 0) {
+      void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+      if (data == MAP_FAILED)
+        throw std::runtime_error("HMatrixScratchFile::map(): "
+                                 "Cannot map the scratch file.");
+      m_data = static_cast<const char *>(data);
+    }
+    ::close(m_fd);
+    m_fd = -1;
+  }
+
+  const char *data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+
+private:
+  int m_fd;
+  const char *m_data;
+  std::size_t m_size;
+};
+
+/** \brief Ask the kernel to read the pages of a file mapping covering
+ *  [data, data + size) in the background. */
+inline void prefetchMappedRange(const void *data, std::size_t size) {
+  if (size == 0)
+    return;
+  static const std::uintptr_t pageSize = ::sysconf(_SC_PAGESIZE);
+  std::uintptr_t begin =
+      reinterpret_cast<std::uintptr_t>(data) / pageSize * pageSize;
+  std::uintptr_t end = reinterpret_cast<std::uintptr_t>(data) + size;
+  ::madvise(reinterpret_cast<void *>(begin), end - begin, MADV_WILLNEED);
+}
+}
+
+#endif
@@ -6,22 +6,49 @@
 #include "hmatrix.hpp"
 #include "hmatrix_data.hpp"
 #include "hmatrix_dense_data.hpp"
+#include "hmatrix_low_rank_data.hpp"
+#include "../fiber/task_arena_cache.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/concurrent_queue.h>
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tick_count.h>
 
 namespace hmat {
 
 template <typename ValueType, int N>
 HMatrix<ValueType, N>::HMatrix(
     const shared_ptr<BlockClusterTree<N>> &blockClusterTree)
-    : m_blockClusterTree(blockClusterTree) {}
+    : m_blockClusterTree(blockClusterTree), m_symmetry(GENERAL_STORAGE),
+      m_frozenPool(nullptr), m_frozenPoolSize(0),
+      m_frozenSinglePrecisionPool(nullptr),
+      m_frozenSinglePrecisionPoolSize(0), m_frozenPoolMapped(false) {}
+
+template <typename ValueType, int N>
+HMatrix<ValueType, N>::HMatrix(
+    const shared_ptr<BlockClusterTree<N>> &blockClusterTree,
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    int maxThreadCount)
+    : HMatrix<ValueType, N>(blockClusterTree) {
+  initialize(hMatrixCompressor, maxThreadCount);
+}
 
 template <typename ValueType, int N>
 HMatrix<ValueType, N>::HMatrix(
     const shared_ptr<BlockClusterTree<N>> &blockClusterTree,
-    const HMatrixCompressor<ValueType, N> &hMatrixCompressor)
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    const LeafPartition<N> &partition, int part, int maxThreadCount)
     : HMatrix<ValueType, N>(blockClusterTree) {
-  initialize(hMatrixCompressor);
+  initialize(hMatrixCompressor, partition, part, maxThreadCount);
 }
 
 template <typename ValueType, int N>
@@ -36,23 +63,1467 @@ std::size_t HMatrix<ValueType, N>::columns() const {
 
 template <typename ValueType, int N>
 void HMatrix<ValueType, N>::initialize(
-    const HMatrixCompressor<ValueType, N> &hMatrixCompressor) {
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    int maxThreadCount) {
+
+  reset();
+  compressLeaves(m_blockClusterTree->leafNodes(), hMatrixCompressor,
+                 maxThreadCount);
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::initialize(
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    const LeafPartition<N> &partition, int part, int maxThreadCount) {
+
+  reset();
+
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> ownedLeafNodes;
+  for (const auto &leaf : m_blockClusterTree->leafNodes())
+    if (partition.owner(*leaf) == part)
+      ownedLeafNodes.push_back(leaf);
+  compressLeaves(ownedLeafNodes, hMatrixCompressor, maxThreadCount);
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::initializeSymmetric(
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    HMatrixSymmetry symmetry, int maxThreadCount) {
+
+  reset();
+  if (symmetry == GENERAL_STORAGE) {
+    compressLeaves(m_blockClusterTree->leafNodes(), hMatrixCompressor,
+                   maxThreadCount);
+    return;
+  }
+
+  const ClusterTree<N> &rowClusterTree =
+      *m_blockClusterTree->rowClusterTree();
+  const ClusterTree<N> &columnClusterTree =
+      *m_blockClusterTree->columnClusterTree();
+  if (&rowClusterTree != &columnClusterTree &&
+      rowClusterTree.hMatDofToOriginalDofMap() !=
+          columnClusterTree.hMatDofToOriginalDofMap())
+    throw std::invalid_argument("HMatrix::initializeSymmetric(): "
+                                "Row and column cluster trees differ.");
+
+  // Leaves are identified by the first row and column of their block, which
+  // are unique since the leaves do not overlap
+  std::map<std::pair<std::size_t, std::size_t>,
+           shared_ptr<BlockClusterTreeNode<N>>> lowerLeaves;
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> upperLeaves;
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> storedLeaves;
+  for (const auto &leaf : m_blockClusterTree->leafNodes()) {
+    const IndexRangeType &rowRange =
+        leaf->data().rowClusterTreeNode->data().indexRange;
+    const IndexRangeType &columnRange =
+        leaf->data().columnClusterTreeNode->data().indexRange;
+    if (rowRange[0] < columnRange[0])
+      upperLeaves.push_back(leaf);
+    else {
+      storedLeaves.push_back(leaf);
+      lowerLeaves[std::make_pair(rowRange[0], columnRange[0])] = leaf;
+    }
+  }
+
+  m_mirrorLeaves.assign(m_blockClusterTree->treeIndex().numberOfNodes(),
+                        shared_ptr<BlockClusterTreeNode<N>>());
+  for (const auto &leaf : upperLeaves) {
+    const IndexRangeType &rowRange =
+        leaf->data().rowClusterTreeNode->data().indexRange;
+    const IndexRangeType &columnRange =
+        leaf->data().columnClusterTreeNode->data().indexRange;
+    auto it = lowerLeaves.find(std::make_pair(columnRange[0], rowRange[0]));
+    if (it == lowerLeaves.end() ||
+        it->second->data().rowClusterTreeNode->data().indexRange !=
+            columnRange ||
+        it->second->data().columnClusterTreeNode->data().indexRange !=
+            rowRange) {
+      m_mirrorLeaves.clear();
+      throw std::invalid_argument("HMatrix::initializeSymmetric(): "
+                                  "The block cluster tree is not "
+                                  "symmetric.");
+    }
+    m_mirrorLeaves[leaf->index()] = it->second;
+  }
+  m_symmetry = symmetry;
+  compressLeaves(storedLeaves, hMatrixCompressor, maxThreadCount);
+}
+
+template <typename ValueType, int N>
+HMatrixSymmetry HMatrix<ValueType, N>::symmetry() const {
+  return m_symmetry;
+}
+
+template <typename ValueType, int N>
+shared_ptr<const BlockClusterTreeNode<N>> HMatrix<ValueType, N>::mirrorLeaf(
+    const shared_ptr<const BlockClusterTreeNode<N>> &leaf) const {
+  if (!m_mirrorLeaves.empty() && m_mirrorLeaves[leaf->index()])
+    return m_mirrorLeaves[leaf->index()];
+  return leaf;
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::checkGeneralStorage(const char *function) const {
+  if (m_symmetry != GENERAL_STORAGE)
+    throw std::runtime_error(std::string("HMatrix::") + function +
+                             "(): Not supported for H-matrices with "
+                             "symmetric storage.");
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::compressLeaves(
+    std::vector<shared_ptr<BlockClusterTreeNode<N>>> leafNodes,
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    int maxThreadCount) {
+
+  // Compress the inadmissible blocks before the admissible ones, so that
+  // compressors can relate the accuracy of admissible blocks to the norm of
+  // the near field (see AcaAccuracyReference). Within each group compress
+  // the largest blocks first so that the last tasks to be picked up by the
+  // scheduler are cheap ones.
+
+  auto blockSize = [](const shared_ptr<BlockClusterTreeNode<N>> &node) {
+    IndexRangeType rowClusterRange;
+    IndexRangeType columnClusterRange;
+    std::size_t numberOfRows;
+    std::size_t numberOfColumns;
+    getBlockClusterTreeNodeDimensions(*node, rowClusterRange,
+                                      columnClusterRange, numberOfRows,
+                                      numberOfColumns);
+    return numberOfRows * numberOfColumns;
+  };
+
+  std::stable_sort(begin(leafNodes), end(leafNodes),
+                   [&blockSize](const shared_ptr<BlockClusterTreeNode<N>> &a,
+                                const shared_ptr<BlockClusterTreeNode<N>> &b) {
+    return blockSize(a) > blockSize(b);
+  });
+  const std::size_t numberOfInadmissibleLeaves =
+      std::stable_partition(begin(leafNodes), end(leafNodes),
+                            [](const shared_ptr<BlockClusterTreeNode<N>> &a) {
+                              return !a->data().admissible;
+                            }) -
+      begin(leafNodes);
+
+  // Every task writes only into its own slot of leafData.
+
+  std::vector<shared_ptr<HMatrixData<ValueType>>> leafData(leafNodes.size());
+  std::vector<double> assemblyTimes(leafNodes.size());
+
+  auto compressRange = [&leafNodes, &leafData, &assemblyTimes,
+                        &hMatrixCompressor](std::size_t first,
+                                            std::size_t last) {
+    tbb::concurrent_queue<std::size_t> leafIndexQueue;
+    for (std::size_t i = first; i < last; ++i)
+      leafIndexQueue.push(i);
+
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(first, last),
+        [&leafIndexQueue, &leafNodes, &leafData, &assemblyTimes,
+         &hMatrixCompressor](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t i = r.begin(); i != r.end(); ++i) {
+            std::size_t leafIndex;
+            if (!leafIndexQueue.try_pop(leafIndex))
+              continue;
+            tbb::tick_count start = tbb::tick_count::now();
+            hMatrixCompressor.compressBlock(*leafNodes[leafIndex],
+                                            leafData[leafIndex]);
+            assemblyTimes[leafIndex] =
+                (tbb::tick_count::now() - start).seconds();
+          }
+        });
+  };
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    compressRange(0, numberOfInadmissibleLeaves);
+    compressRange(numberOfInadmissibleLeaves, leafNodes.size());
+  });
+
+  // Keep the data of leaves compressed earlier (see withUpdatedLeaves())
+  const std::size_t numberOfNodes =
+      m_blockClusterTree->treeIndex().numberOfNodes();
+  if (m_nodeData.size() != numberOfNodes)
+    m_nodeData.assign(numberOfNodes, nullptr);
+  for (std::size_t i = 0; i < leafNodes.size(); ++i) {
+    m_hMatrixData[leafNodes[i]] = leafData[i];
+    m_assemblyTimes[leafNodes[i]] = assemblyTimes[i];
+    m_nodeData[leafNodes[i]->index()] = leafData[i].get();
+  }
+}
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::initializeOutOfCore(
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    const std::string &scratchDirectory, double bufferSizeMb,
+    int maxThreadCount) {
 
   reset();
 
-  for (auto node : m_blockClusterTree->leafNodes()) {
-    shared_ptr<HMatrixData<ValueType>> nodeData;
-    hMatrixCompressor.compressBlock(*node, nodeData);
-    m_hMatrixData[node] = nodeData;
+  auto blockSize = [](const BlockClusterTreeNode<N> &node) {
+    IndexRangeType rowClusterRange;
+    IndexRangeType columnClusterRange;
+    std::size_t numberOfRows;
+    std::size_t numberOfColumns;
+    getBlockClusterTreeNodeDimensions(node, rowClusterRange,
+                                      columnClusterRange, numberOfRows,
+                                      numberOfColumns);
+    return numberOfRows * numberOfColumns;
+  };
+
+  // Within the inadmissible and the admissible leaves, the payloads are
+  // written in the order of the row ranges, in which applyFrozen()
+  // traverses the leaves of its row bands, so that every thread reads the
+  // file in few sequential streams.
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> leafNodes =
+      m_blockClusterTree->leafNodes();
+  std::stable_sort(begin(leafNodes), end(leafNodes),
+                   [](const shared_ptr<BlockClusterTreeNode<N>> &a,
+                      const shared_ptr<BlockClusterTreeNode<N>> &b) {
+    if (a->data().admissible != b->data().admissible)
+      return !a->data().admissible;
+    const auto &rowRangeA = a->data().rowClusterTreeNode->data().indexRange;
+    const auto &rowRangeB = b->data().rowClusterTreeNode->data().indexRange;
+    if (rowRangeA[0] != rowRangeB[0])
+      return rowRangeA[0] < rowRangeB[0];
+    return a->data().columnClusterTreeNode->data().indexRange[0] <
+           b->data().columnClusterTreeNode->data().indexRange[0];
+  });
+
+  auto scratchFile = make_shared<HMatrixScratchFile>(scratchDirectory);
+  std::vector<FrozenLeaf> frozenLeaves(leafNodes.size());
+  std::vector<shared_ptr<HMatrixData<ValueType>>> leafData(leafNodes.size());
+  std::vector<double> assemblyTimes(leafNodes.size());
+  std::size_t poolSize = 0;
+
+  const double bufferSize = bufferSizeMb * 1024 * 1024 / sizeof(ValueType);
+  std::size_t first = 0;
+  while (first < leafNodes.size()) {
+    std::size_t last = first;
+    double batchSize = 0;
+    while (last < leafNodes.size() &&
+           (last == first ||
+            batchSize + blockSize(*leafNodes[last]) <= bufferSize))
+      batchSize += blockSize(*leafNodes[last++]);
+
+    Fiber::executeInTaskArena(maxThreadCount, [&] {
+      tbb::parallel_for(first, last, [&](std::size_t i) {
+        tbb::tick_count start = tbb::tick_count::now();
+        hMatrixCompressor.compressBlock(*leafNodes[i], leafData[i]);
+        assemblyTimes[i] = (tbb::tick_count::now() - start).seconds();
+      });
+    });
+
+    for (std::size_t i = first; i < last; ++i) {
+      FrozenLeaf &leaf = frozenLeaves[i];
+      const BlockClusterTreeNodeData<N> &nodeData = leafNodes[i]->data();
+      leaf.rowRange = nodeData.rowClusterTreeNode->data().indexRange;
+      leaf.columnRange = nodeData.columnClusterTreeNode->data().indexRange;
+      auto lowRankData =
+          dynamic_cast<HMatrixLowRankData<ValueType> *>(leafData[i].get());
+      if (lowRankData && lowRankData->isSinglePrecision())
+        throw std::invalid_argument("HMatrix::initializeOutOfCore(): "
+                                    "Low-rank blocks in single precision "
+                                    "cannot be stored out of core.");
+      leaf.lowRank = (lowRankData != nullptr);
+      leaf.singlePrecision = false;
+      leaf.rank = leafData[i]->rank();
+      leaf.offset = poolSize;
+      if (lowRankData) {
+        const arma::Mat<ValueType> &A = lowRankData->A();
+        const arma::Mat<ValueType> &B = lowRankData->B();
+        scratchFile->append(A.memptr(), A.n_elem * sizeof(ValueType));
+        scratchFile->append(B.memptr(), B.n_elem * sizeof(ValueType));
+      } else {
+        auto denseData =
+            static_cast<HMatrixDenseData<ValueType> *>(leafData[i].get());
+        denseData->decompress();
+        const arma::Mat<ValueType> &A = denseData->A();
+        scratchFile->append(A.memptr(), A.n_elem * sizeof(ValueType));
+      }
+      poolSize += frozenPayloadSize(leaf);
+      leafData[i].reset();
+      m_assemblyTimes[leafNodes[i]] = assemblyTimes[i];
+    }
+    first = last;
   }
+  scratchFile->map();
+
+  m_frozenLeaves.swap(frozenLeaves);
+  computeFrozenApplySchedules();
+  m_frozenPool = reinterpret_cast<const ValueType *>(scratchFile->data());
+  m_frozenPoolSize = poolSize;
+  m_frozenSinglePrecisionPool = nullptr;
+  m_frozenSinglePrecisionPoolSize = 0;
+  m_frozenPoolMapped = true;
+  m_frozenStorage = scratchFile;
 }
+
 template <typename ValueType, int N> void HMatrix<ValueType, N>::reset() {
   m_hMatrixData.clear();
+  m_assemblyTimes.clear();
+  m_nodeData.clear();
+  m_symmetry = GENERAL_STORAGE;
+  m_mirrorLeaves.clear();
+  m_frozenLeaves.clear();
+  m_frozenRowSchedule = FrozenApplySchedule();
+  m_frozenColumnSchedule = FrozenApplySchedule();
+  m_frozenStorage.reset();
+  m_frozenPool = nullptr;
+  m_frozenPoolSize = 0;
+  m_frozenSinglePrecisionPool = nullptr;
+  m_frozenSinglePrecisionPoolSize = 0;
+  m_frozenPoolMapped = false;
+  m_nearField.reset();
+  m_lowRankGroups.reset();
 }
 
 template <typename ValueType, int N>
 bool HMatrix<ValueType, N>::isInitialized() const {
-  return (!m_hMatrixData.empty());
+  return (!m_hMatrixData.empty() || !m_frozenLeaves.empty() || m_nearField ||
+          m_lowRankGroups);
+}
+
+template <typename ValueType, int N>
+bool HMatrix<ValueType, N>::isFrozen() const {
+  return !m_frozenLeaves.empty();
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::extractNearField() {
+
+  checkGeneralStorage("extractNearField");
+  if (isFrozen())
+    throw std::runtime_error("HMatrix::extractNearField(): "
+                             "The near field of frozen H-matrices cannot be "
+                             "extracted.");
+  if (m_nearField)
+    return;
+
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> nearFieldNodes;
+  std::vector<IndexRangeType> rowRanges;
+  std::vector<IndexRangeType> columnRanges;
+  std::vector<const arma::Mat<ValueType> *> blocks;
+  std::deque<arma::Mat<ValueType>> decompressedBlocks;
+  for (const auto &elem : m_hMatrixData) {
+    if (elem.first->data().admissible)
+      continue;
+    auto denseData =
+        dynamic_cast<const HMatrixDenseData<ValueType> *>(elem.second.get());
+    if (!denseData)
+      continue;
+    nearFieldNodes.push_back(elem.first);
+    rowRanges.push_back(
+        elem.first->data().rowClusterTreeNode->data().indexRange);
+    columnRanges.push_back(
+        elem.first->data().columnClusterTreeNode->data().indexRange);
+    if (denseData->isCompressed()) {
+      decompressedBlocks.emplace_back(denseData->rows(), denseData->cols());
+      denseData->copyValues(decompressedBlocks.back().memptr());
+      blocks.push_back(&decompressedBlocks.back());
+    } else
+      blocks.push_back(&denseData->A());
+  }
+
+  m_nearField = make_shared<BlockSparseMatrix<ValueType>>(
+      rows(), columns(), rowRanges, columnRanges, blocks);
+
+  for (const auto &node : nearFieldNodes) {
+    m_nodeData[node->index()] = nullptr;
+    m_hMatrixData.erase(node);
+  }
+}
+
+template <typename ValueType, int N>
+shared_ptr<const BlockSparseMatrix<ValueType>>
+HMatrix<ValueType, N>::nearField() const {
+  return m_nearField;
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::groupLowRankLeaves() {
+
+  checkGeneralStorage("groupLowRankLeaves");
+  if (isFrozen())
+    throw std::runtime_error("HMatrix::groupLowRankLeaves(): "
+                             "The low-rank leaves of frozen H-matrices cannot "
+                             "be grouped.");
+  if (m_lowRankGroups)
+    return;
+
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> lowRankNodes;
+  std::vector<IndexRangeType> rowRanges;
+  std::vector<IndexRangeType> columnRanges;
+  std::vector<const arma::Mat<ValueType> *> A;
+  std::vector<const arma::Mat<ValueType> *> B;
+  for (const auto &elem : m_hMatrixData) {
+    auto lowRankData =
+        dynamic_cast<const HMatrixLowRankData<ValueType> *>(elem.second.get());
+    if (!lowRankData || lowRankData->isSinglePrecision())
+      continue;
+    lowRankNodes.push_back(elem.first);
+    rowRanges.push_back(
+        elem.first->data().rowClusterTreeNode->data().indexRange);
+    columnRanges.push_back(
+        elem.first->data().columnClusterTreeNode->data().indexRange);
+    A.push_back(&lowRankData->A());
+    B.push_back(&lowRankData->B());
+  }
+
+  m_lowRankGroups = make_shared<GroupedLowRankMatrix<ValueType>>(
+      rows(), columns(), rowRanges, columnRanges, A, B);
+
+  for (const auto &node : lowRankNodes) {
+    m_nodeData[node->index()] = nullptr;
+    m_hMatrixData.erase(node);
+  }
+}
+
+template <typename ValueType, int N>
+shared_ptr<const GroupedLowRankMatrix<ValueType>>
+HMatrix<ValueType, N>::lowRankGroups() const {
+  return m_lowRankGroups;
+}
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const RecompressionStatistics &statistics) {
+  os << "Recompressed " << statistics.numberOfLowRankBlocks
+     << " low-rank blocks. Total rank: " << statistics.totalRankBefore
+     << " -> " << statistics.totalRankAfter
+     << ", memory: " << statistics.memSizeKbBefore << " KB -> "
+     << statistics.memSizeKbAfter << " KB";
+  return os;
+}
+
+template <typename ValueType, int N>
+RecompressionStatistics HMatrix<ValueType, N>::recompress(double eps) {
+
+  if (isFrozen())
+    throw std::runtime_error("HMatrix::recompress(): "
+                             "Frozen H-matrices cannot be recompressed.");
+
+  std::vector<HMatrixLowRankData<ValueType> *> lowRankBlocks;
+  RecompressionStatistics statistics = {0, 0, 0, 0, 0};
+
+  for (const auto &elem : m_hMatrixData) {
+    auto lowRankData =
+        dynamic_cast<HMatrixLowRankData<ValueType> *>(elem.second.get());
+    if (!lowRankData)
+      continue;
+    lowRankBlocks.push_back(lowRankData);
+    statistics.totalRankBefore += lowRankData->rank();
+    statistics.memSizeKbBefore += lowRankData->memSizeKb();
+  }
+  statistics.numberOfLowRankBlocks = lowRankBlocks.size();
+
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, lowRankBlocks.size()),
+                    [&lowRankBlocks, eps](
+                        const tbb::blocked_range<std::size_t> &r) {
+    for (std::size_t i = r.begin(); i != r.end(); ++i)
+      lowRankBlocks[i]->recompress(eps);
+  });
+
+  for (const auto &lowRankData : lowRankBlocks) {
+    statistics.totalRankAfter += lowRankData->rank();
+    statistics.memSizeKbAfter += lowRankData->memSizeKb();
+  }
+
+  return statistics;
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::convertLowRankBlocksToSinglePrecision() {
+
+  if (isFrozen())
+    throw std::runtime_error("HMatrix::convertLowRankBlocksToSinglePrecision(): "
+                             "Frozen H-matrices cannot be converted.");
+
+  std::vector<HMatrixLowRankData<ValueType> *> lowRankBlocks;
+  for (const auto &elem : m_hMatrixData)
+    if (auto lowRankData =
+            dynamic_cast<HMatrixLowRankData<ValueType> *>(elem.second.get()))
+      lowRankBlocks.push_back(lowRankData);
+
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, lowRankBlocks.size()),
+                    [&lowRankBlocks](const tbb::blocked_range<std::size_t> &r) {
+    for (std::size_t i = r.begin(); i != r.end(); ++i)
+      lowRankBlocks[i]->convertToSinglePrecision();
+  });
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::compressDenseBlocks(int bitsPerValue) {
+
+  if (isFrozen())
+    throw std::runtime_error("HMatrix::compressDenseBlocks(): "
+                             "Frozen H-matrices cannot be compressed.");
+
+  std::vector<HMatrixDenseData<ValueType> *> denseBlocks;
+  for (const auto &elem : m_hMatrixData)
+    if (auto denseData =
+            dynamic_cast<HMatrixDenseData<ValueType> *>(elem.second.get()))
+      denseBlocks.push_back(denseData);
+
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, denseBlocks.size()),
+                    [&](const tbb::blocked_range<std::size_t> &r) {
+    for (std::size_t i = r.begin(); i != r.end(); ++i)
+      denseBlocks[i]->compress(bitsPerValue);
+  });
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>> HMatrix<ValueType, N>::withUpdatedLeaves(
+    const std::vector<shared_ptr<const BlockClusterTreeNode<N>>> &leafNodes,
+    const HMatrixCompressor<ValueType, N> &hMatrixCompressor,
+    int maxThreadCount) const {
+
+  checkGeneralStorage("withUpdatedLeaves");
+  if (isFrozen() || m_nearField || m_lowRankGroups ||
+      m_hMatrixData.size() != m_blockClusterTree->leafNodes().size())
+    throw std::invalid_argument(
+        "HMatrix::withUpdatedLeaves(): The matrix must hold all its leaves "
+        "and can be neither frozen nor have its near field extracted or its "
+        "low-rank leaves grouped.");
+
+  auto result = make_shared<HMatrix<ValueType, N>>(m_blockClusterTree);
+  result->m_hMatrixData = m_hMatrixData;
+  result->m_assemblyTimes = m_assemblyTimes;
+  result->m_nodeData = m_nodeData;
+
+  std::vector<shared_ptr<BlockClusterTreeNode<N>>> updatedLeafNodes;
+  updatedLeafNodes.reserve(leafNodes.size());
+  for (const auto &leaf : leafNodes) {
+    auto it = m_hMatrixData.find(
+        boost::const_pointer_cast<BlockClusterTreeNode<N>>(leaf));
+    if (it == m_hMatrixData.end())
+      throw std::invalid_argument("HMatrix::withUpdatedLeaves(): "
+                                  "Every node must be a leaf of the block "
+                                  "cluster tree of the matrix.");
+    updatedLeafNodes.push_back(it->first);
+  }
+  result->compressLeaves(updatedLeafNodes, hMatrixCompressor, maxThreadCount);
+  return result;
+}
+
+template <typename ValueType, int N>
+shared_ptr<const BlockClusterTree<N>>
+HMatrix<ValueType, N>::blockClusterTree() const {
+  return m_blockClusterTree;
+}
+
+template <typename ValueType, int N>
+shared_ptr<const HMatrixData<ValueType>> HMatrix<ValueType, N>::leafData(
+    const shared_ptr<const BlockClusterTreeNode<N>> &leaf) const {
+
+  if (isFrozen())
+    throw std::runtime_error("HMatrix::leafData(): "
+                             "Leaf data of frozen H-matrices is not "
+                             "accessible.");
+  auto it = m_hMatrixData.find(
+      boost::const_pointer_cast<BlockClusterTreeNode<N>>(leaf));
+  if (it == m_hMatrixData.end()) {
+    if (mirrorLeaf(leaf) != leaf)
+      throw std::invalid_argument("HMatrix::leafData(): "
+                                  "Leaf is represented by its mirror leaf; "
+                                  "see HMatrix::mirrorLeaf().");
+    throw std::invalid_argument("HMatrix::leafData(): "
+                                "Node is not a leaf of this H-matrix.");
+  }
+  return it->second;
+}
+
+template <typename ValueType, int N>
+HMatrixStatistics HMatrix<ValueType, N>::statistics() const {
+
+  HMatrixStatistics statistics = HMatrixStatistics();
+  statistics.rows = rows();
+  statistics.columns = columns();
+  statistics.denseMemSizeKb =
+      sizeof(ValueType) * double(rows()) * columns() / 1024;
+
+  // Frozen leaves are identified by the first row and column of their
+  // block, which are unique since the leaves do not overlap.
+  std::map<std::pair<std::size_t, std::size_t>, const FrozenLeaf *>
+      frozenLeaves;
+  for (const auto &leaf : m_frozenLeaves)
+    frozenLeaves[std::make_pair(leaf.rowRange[0], leaf.columnRange[0])] =
+        &leaf;
+  std::map<std::pair<std::size_t, std::size_t>,
+           const typename BlockSparseMatrix<ValueType>::Block *>
+      nearFieldBlocks;
+  if (m_nearField)
+    for (const auto &nearFieldBlock : m_nearField->blocks())
+      nearFieldBlocks[std::make_pair(nearFieldBlock.rowRange[0],
+                                     nearFieldBlock.columnRange[0])] =
+          &nearFieldBlock;
+  std::map<std::pair<std::size_t, std::size_t>, std::size_t> groupedRanks;
+  if (m_lowRankGroups)
+    for (const auto &groupedBlock : m_lowRankGroups->blocks())
+      groupedRanks[std::make_pair(groupedBlock.rowRange[0],
+                                  groupedBlock.columnRange[0])] =
+          groupedBlock.rank;
+
+  std::function<void(const shared_ptr<BlockClusterTreeNode<N>> &,
+                     std::size_t)> addNode;
+  addNode = [&](const shared_ptr<BlockClusterTreeNode<N>> &node,
+                std::size_t level) {
+    if (!node->isLeaf()) {
+      for (int i = 0; i < N * N; ++i)
+        if (node->child(i))
+          addNode(node->child(i), level + 1);
+      return;
+    }
+
+    HMatrixBlockStatistics block;
+    block.rowRange = node->data().rowClusterTreeNode->data().indexRange;
+    block.columnRange = node->data().columnClusterTreeNode->data().indexRange;
+    block.level = level;
+    block.admissible = node->data().admissible;
+
+    auto nearFieldIt = nearFieldBlocks.find(
+        std::make_pair(block.rowRange[0], block.columnRange[0]));
+    auto groupedIt = groupedRanks.find(
+        std::make_pair(block.rowRange[0], block.columnRange[0]));
+    if (nearFieldIt != nearFieldBlocks.end()) {
+      block.lowRank = false;
+      block.rank = 0;
+      block.memSizeKb = sizeof(ValueType) *
+                        double(block.rowRange[1] - block.rowRange[0]) *
+                        (block.columnRange[1] - block.columnRange[0]) / 1024;
+    } else if (groupedIt != groupedRanks.end()) {
+      block.lowRank = true;
+      block.rank = groupedIt->second;
+      block.memSizeKb = sizeof(ValueType) *
+                        double(block.rowRange[1] - block.rowRange[0] +
+                               block.columnRange[1] - block.columnRange[0]) *
+                        block.rank / 1024;
+    } else if (isFrozen()) {
+      auto it = frozenLeaves.find(
+          std::make_pair(block.rowRange[0], block.columnRange[0]));
+      if (it == frozenLeaves.end())
+        return; // leaf of another part of a distributed matrix
+      const FrozenLeaf &leaf = *it->second;
+      std::size_t elementSize = leaf.singlePrecision
+                                    ? sizeof(SinglePrecisionType)
+                                    : sizeof(ValueType);
+      std::size_t numberOfRows = leaf.rowRange[1] - leaf.rowRange[0];
+      std::size_t numberOfColumns = leaf.columnRange[1] - leaf.columnRange[0];
+      block.lowRank = leaf.lowRank;
+      block.rank = leaf.lowRank ? leaf.rank : 0;
+      block.memSizeKb =
+          elementSize *
+          (leaf.lowRank ? (numberOfRows + numberOfColumns) * leaf.rank
+                        : numberOfRows * numberOfColumns) /
+          (1.0 * 1024);
+    } else {
+      auto it = m_hMatrixData.find(node);
+      if (it == m_hMatrixData.end())
+        return; // leaf of another part of a distributed matrix
+      block.lowRank = (dynamic_cast<const HMatrixLowRankData<ValueType> *>(
+                           it->second.get()) != nullptr);
+      block.rank = block.lowRank ? it->second->rank() : 0;
+      block.memSizeKb = it->second->memSizeKb();
+    }
+    auto timeIt = m_assemblyTimes.find(node);
+    block.assemblyTime =
+        (timeIt == m_assemblyTimes.end()) ? 0. : timeIt->second;
+
+    if (statistics.levels.size() <= level)
+      statistics.levels.resize(level + 1, HMatrixLevelStatistics());
+    HMatrixLevelStatistics &levelStatistics = statistics.levels[level];
+    if (block.lowRank) {
+      ++statistics.numberOfLowRankBlocks;
+      ++levelStatistics.numberOfLowRankBlocks;
+      statistics.maxRank = std::max(statistics.maxRank, block.rank);
+      if (statistics.rankHistogram.size() <= block.rank)
+        statistics.rankHistogram.resize(block.rank + 1, 0);
+      ++statistics.rankHistogram[block.rank];
+    } else {
+      ++statistics.numberOfDenseBlocks;
+      ++levelStatistics.numberOfDenseBlocks;
+    }
+    levelStatistics.memSizeKb += block.memSizeKb;
+    statistics.memSizeKb += block.memSizeKb;
+    statistics.assemblyTime += block.assemblyTime;
+    statistics.blocks.push_back(block);
+  };
+  addNode(m_blockClusterTree->root(), 0);
+
+  return statistics;
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::computeFrozenLayout(
+    std::vector<FrozenLeaf> &frozenLeaves,
+    std::vector<shared_ptr<HMatrixData<ValueType>>> &leafData,
+    std::size_t &poolSize, std::size_t &singlePrecisionPoolSize) const {
+
+  typedef std::pair<shared_ptr<BlockClusterTreeNode<N>>,
+                    shared_ptr<HMatrixData<ValueType>>> LeafPair;
+  std::vector<LeafPair> leaves(begin(m_hMatrixData), end(m_hMatrixData));
+
+  std::sort(begin(leaves), end(leaves),
+            [](const LeafPair &a, const LeafPair &b) {
+    const auto &rowRangeA = a.first->data().rowClusterTreeNode->data().indexRange;
+    const auto &rowRangeB = b.first->data().rowClusterTreeNode->data().indexRange;
+    if (rowRangeA[0] != rowRangeB[0])
+      return rowRangeA[0] < rowRangeB[0];
+    return a.first->data().columnClusterTreeNode->data().indexRange[0] <
+           b.first->data().columnClusterTreeNode->data().indexRange[0];
+  });
+
+  frozenLeaves.resize(leaves.size());
+  leafData.resize(leaves.size());
+
+  poolSize = 0;
+  singlePrecisionPoolSize = 0;
+  for (std::size_t i = 0; i < leaves.size(); ++i) {
+    FrozenLeaf &leaf = frozenLeaves[i];
+    leaf.rowRange = leaves[i].first->data().rowClusterTreeNode->data().indexRange;
+    leaf.columnRange =
+        leaves[i].first->data().columnClusterTreeNode->data().indexRange;
+    auto lowRankData =
+        dynamic_cast<HMatrixLowRankData<ValueType> *>(leaves[i].second.get());
+    leaf.lowRank = (lowRankData != nullptr);
+    leaf.singlePrecision = leaf.lowRank && lowRankData->isSinglePrecision();
+    leaf.rank = leaves[i].second->rank();
+    std::size_t rows = leaf.rowRange[1] - leaf.rowRange[0];
+    std::size_t cols = leaf.columnRange[1] - leaf.columnRange[0];
+    if (leaf.singlePrecision) {
+      leaf.offset = singlePrecisionPoolSize;
+      singlePrecisionPoolSize += (rows + cols) * leaf.rank;
+    } else {
+      leaf.offset = poolSize;
+      poolSize += leaf.lowRank ? (rows + cols) * leaf.rank : rows * cols;
+    }
+    leafData[i] = leaves[i].second;
+  }
+}
+
+template <typename ValueType, int N> void HMatrix<ValueType, N>::freeze() {
+
+  if (isFrozen())
+    return;
+  checkGeneralStorage("freeze");
+
+  std::vector<FrozenLeaf> frozenLeaves;
+  std::vector<shared_ptr<HMatrixData<ValueType>>> leafData;
+  std::size_t poolSize;
+  std::size_t singlePrecisionPoolSize;
+  computeFrozenLayout(frozenLeaves, leafData, poolSize,
+                      singlePrecisionPoolSize);
+
+  typedef std::vector<ValueType, UninitializedAllocator<ValueType>> Pool;
+  typedef std::vector<SinglePrecisionType,
+                      UninitializedAllocator<SinglePrecisionType>>
+  SinglePrecisionPool;
+  typedef std::pair<Pool, SinglePrecisionPool> Pools;
+  auto pools = make_shared<Pools>();
+  Pool &pool = pools->first;
+  SinglePrecisionPool &singlePrecisionPool = pools->second;
+  pool.resize(poolSize);
+  singlePrecisionPool.resize(singlePrecisionPoolSize);
+
+  auto copyLeaf = [&](std::size_t i) {
+    ValueType *target = pool.data() + frozenLeaves[i].offset;
+    if (frozenLeaves[i].singlePrecision) {
+      auto lowRankData = static_cast<HMatrixLowRankData<ValueType> *>(
+          leafData[i].get());
+      const auto &A = lowRankData->singlePrecisionA();
+      const auto &B = lowRankData->singlePrecisionB();
+      SinglePrecisionType *singlePrecisionTarget =
+          singlePrecisionPool.data() + frozenLeaves[i].offset;
+      std::copy(A.memptr(), A.memptr() + A.n_elem,
+                singlePrecisionTarget);
+      std::copy(B.memptr(), B.memptr() + B.n_elem,
+                singlePrecisionTarget + A.n_elem);
+    } else if (frozenLeaves[i].lowRank) {
+      auto lowRankData = static_cast<HMatrixLowRankData<ValueType> *>(
+          leafData[i].get());
+      const arma::Mat<ValueType> &A = lowRankData->A();
+      const arma::Mat<ValueType> &B = lowRankData->B();
+      std::copy(A.memptr(), A.memptr() + A.n_elem, target);
+      std::copy(B.memptr(), B.memptr() + B.n_elem, target + A.n_elem);
+    } else {
+      auto denseData =
+          static_cast<HMatrixDenseData<ValueType> *>(leafData[i].get());
+      denseData->copyValues(target);
+    }
+  };
+
+  // The short leaves are copied with the same static partitioning of the
+  // row bands as in applyFrozen(), so that every thread first touches, and
+  // on NUMA machines places on its own node, the part of the pools it later
+  // reads. The long leaves are read by all threads anyway.
+  FrozenApplySchedule rowSchedule;
+  computeFrozenApplySchedule(frozenLeaves, false, m_blockClusterTree->rows(),
+                             rowSchedule);
+  tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, rowSchedule.bands.size() - 1),
+      [&](const tbb::blocked_range<std::size_t> &r) {
+        for (std::size_t k = rowSchedule.bands[r.begin()];
+             k != rowSchedule.bands[r.end()]; ++k)
+          copyLeaf(rowSchedule.shortLeaves[k]);
+      },
+      tbb::static_partitioner());
+  tbb::parallel_for(std::size_t(0), rowSchedule.longLeaves.size(),
+                    [&](std::size_t k) {
+    copyLeaf(rowSchedule.longLeaves[k]);
+  });
+
+  m_frozenLeaves.swap(frozenLeaves);
+  m_frozenRowSchedule = rowSchedule;
+  computeFrozenApplySchedule(m_frozenLeaves, true,
+                             m_blockClusterTree->columns(),
+                             m_frozenColumnSchedule);
+  m_frozenPool = pool.data();
+  m_frozenPoolSize = poolSize;
+  m_frozenSinglePrecisionPool = singlePrecisionPool.data();
+  m_frozenSinglePrecisionPoolSize = singlePrecisionPoolSize;
+  m_frozenPoolMapped = false;
+  m_frozenStorage = pools;
+  m_hMatrixData.clear();
+  m_nodeData.clear();
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::saveClusterTree(HMatrixFileWriter &writer,
+                                            const ClusterTree<N> &clusterTree,
+                                            ClusterNodeIndexMap &nodeIndices) {
+
+  std::vector<shared_ptr<const ClusterTreeNode<N>>> nodes;
+  std::function<void(const shared_ptr<const ClusterTreeNode<N>> &)> collect =
+      [&nodes, &nodeIndices, &collect](
+          const shared_ptr<const ClusterTreeNode<N>> &node) {
+    nodeIndices[node.get()] = nodes.size();
+    nodes.push_back(node);
+    if (!node->isLeaf())
+      for (int i = 0; i < N; ++i)
+        collect(node->child(i));
+  };
+  collect(clusterTree.root());
+
+  const std::uint64_t counts[2] = {nodes.size(), clusterTree.numberOfDofs()};
+  writer.write(counts, sizeof(counts));
+
+  for (const auto &node : nodes) {
+    HMatrixFileClusterNode record;
+    record.indexRange[0] = node->data().indexRange[0];
+    record.indexRange[1] = node->data().indexRange[1];
+    const auto &bounds = node->data().boundingBox.bounds();
+    std::copy(bounds.begin(), bounds.end(), record.bounds);
+    record.isLeaf = node->isLeaf();
+    writer.write(record);
+  }
+
+  const auto &hMatDofToOriginalDofMap = clusterTree.hMatDofToOriginalDofMap();
+  std::vector<std::uint64_t> dofMap(begin(hMatDofToOriginalDofMap),
+                                    end(hMatDofToOriginalDofMap));
+  writer.write(dofMap.data(), dofMap.size() * sizeof(std::uint64_t));
+}
+
+template <typename ValueType, int N>
+shared_ptr<const ClusterTree<N>> HMatrix<ValueType, N>::loadClusterTree(
+    HMatrixFileReader &reader,
+    std::vector<shared_ptr<const ClusterTreeNode<N>>> &nodes) {
+
+  const std::uint64_t *counts = reader.read<std::uint64_t>(2);
+  const std::uint64_t numberOfNodes = counts[0];
+  const std::uint64_t numberOfDofs = counts[1];
+  const HMatrixFileClusterNode *records =
+      reader.read<HMatrixFileClusterNode>(numberOfNodes);
+  const std::uint64_t *dofMap = reader.read<std::uint64_t>(numberOfDofs);
+
+  if (numberOfNodes == 0)
+    throw std::runtime_error("HMatrix::load(): Cluster tree is empty.");
+
+  auto nodeData = [](const HMatrixFileClusterNode &record) {
+    IndexRangeType indexRange{{record.indexRange[0], record.indexRange[1]}};
+    std::array<double, 6> bounds;
+    std::copy(record.bounds, record.bounds + 6, bounds.begin());
+    return ClusterTreeNodeData(indexRange, BoundingBox(bounds));
+  };
+
+  std::function<void(const shared_ptr<ClusterTreeNode<N>> &)> build =
+      [&nodes, &build, &nodeData, records, numberOfNodes](
+          const shared_ptr<ClusterTreeNode<N>> &node) {
+    const HMatrixFileClusterNode &record = records[nodes.size()];
+    nodes.push_back(node);
+    if (record.isLeaf)
+      return;
+    for (int i = 0; i < N; ++i) {
+      if (nodes.size() >= numberOfNodes)
+        throw std::runtime_error("HMatrix::load(): "
+                                 "Cluster tree is truncated.");
+      node->addChild(nodeData(records[nodes.size()]), i);
+      build(node->child(i));
+    }
+  };
+
+  auto root = make_shared<ClusterTreeNode<N>>(nodeData(records[0]));
+  build(root);
+
+  if (nodes.size() != numberOfNodes)
+    throw std::runtime_error("HMatrix::load(): "
+                             "Inconsistent number of cluster tree nodes.");
+
+  std::vector<std::size_t> hMatDofToOriginalDofMap(dofMap,
+                                                   dofMap + numberOfDofs);
+  for (auto dof : hMatDofToOriginalDofMap)
+    if (dof >= numberOfDofs)
+      throw std::runtime_error("HMatrix::load(): "
+                               "DOF permutation is out of range.");
+
+  return make_shared<ClusterTree<N>>(root, hMatDofToOriginalDofMap);
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::save(const std::string &fileName) const {
+
+  if (!isInitialized())
+    throw std::runtime_error("HMatrix::save(): "
+                             "H-matrix is not initialized.");
+  checkGeneralStorage("save");
+  if (m_nearField || m_lowRankGroups)
+    throw std::runtime_error("HMatrix::save(): "
+                             "H-matrices with an extracted near field or "
+                             "grouped low-rank leaves cannot be saved.");
+
+  std::vector<FrozenLeaf> frozenLeaves;
+  std::vector<shared_ptr<HMatrixData<ValueType>>> leafData;
+  std::size_t poolSize;
+  std::size_t singlePrecisionPoolSize;
+  if (isFrozen()) {
+    frozenLeaves = m_frozenLeaves;
+    poolSize = m_frozenPoolSize;
+    singlePrecisionPoolSize = m_frozenSinglePrecisionPoolSize;
+  } else
+    computeFrozenLayout(frozenLeaves, leafData, poolSize,
+                        singlePrecisionPoolSize);
+
+  HMatrixFileHeader header = HMatrixFileHeader();
+  std::memcpy(header.magic, HMATRIX_FILE_MAGIC, sizeof(header.magic));
+  header.version = HMATRIX_FILE_VERSION;
+  header.byteOrderMark = HMATRIX_FILE_BYTE_ORDER_MARK;
+  header.valueTypeId = hMatrixFileValueTypeId<ValueType>();
+  header.branchingFactor = N;
+  header.rows = rows();
+  header.columns = columns();
+
+  HMatrixFileWriter writer(fileName);
+
+  // A cluster tree shared by rows and columns is stored only once
+  auto rowClusterTree = m_blockClusterTree->rowClusterTree();
+  auto columnClusterTree = m_blockClusterTree->columnClusterTree();
+  ClusterNodeIndexMap rowNodeIndices;
+  ClusterNodeIndexMap columnNodeIndices;
+
+  header.rowClusterTreeOffset = writer.align();
+  saveClusterTree(writer, *rowClusterTree, rowNodeIndices);
+  if (columnClusterTree == rowClusterTree) {
+    header.columnClusterTreeOffset = header.rowClusterTreeOffset;
+    columnNodeIndices = rowNodeIndices;
+  } else {
+    header.columnClusterTreeOffset = writer.align();
+    saveClusterTree(writer, *columnClusterTree, columnNodeIndices);
+  }
+
+  header.blockClusterTreeOffset = writer.align();
+  std::vector<HMatrixFileBlockNode> blockNodes;
+  std::function<void(const shared_ptr<const BlockClusterTreeNode<N>> &)>
+  collect = [&blockNodes, &rowNodeIndices, &columnNodeIndices, &collect](
+      const shared_ptr<const BlockClusterTreeNode<N>> &node) {
+    HMatrixFileBlockNode record;
+    record.rowClusterNode =
+        rowNodeIndices.at(node->data().rowClusterTreeNode.get());
+    record.columnClusterNode =
+        columnNodeIndices.at(node->data().columnClusterTreeNode.get());
+    record.admissible = node->data().admissible;
+    record.isLeaf = node->isLeaf();
+    blockNodes.push_back(record);
+    if (!node->isLeaf())
+      for (int i = 0; i < N * N; ++i)
+        collect(node->child(i));
+  };
+  collect(m_blockClusterTree->root());
+  writer.write(static_cast<std::uint64_t>(blockNodes.size()));
+  writer.write(blockNodes.data(),
+               blockNodes.size() * sizeof(HMatrixFileBlockNode));
+
+  header.leafOffset = writer.align();
+  const std::uint64_t counts[3] = {frozenLeaves.size(), poolSize,
+                                   singlePrecisionPoolSize};
+  writer.write(counts, sizeof(counts));
+  for (const auto &leaf : frozenLeaves) {
+    HMatrixFileLeaf record;
+    record.rowRange[0] = leaf.rowRange[0];
+    record.rowRange[1] = leaf.rowRange[1];
+    record.columnRange[0] = leaf.columnRange[0];
+    record.columnRange[1] = leaf.columnRange[1];
+    record.lowRank = leaf.lowRank;
+    record.singlePrecision = leaf.singlePrecision;
+    record.rank = leaf.rank;
+    record.offset = leaf.offset;
+    writer.write(record);
+  }
+
+  // The payloads are written in offset order, so no pool needs to be
+  // assembled for unfrozen matrices.
+  header.poolOffset = writer.align();
+  if (isFrozen())
+    writer.write(m_frozenPool, poolSize * sizeof(ValueType));
+  else
+    for (std::size_t i = 0; i < frozenLeaves.size(); ++i) {
+      if (frozenLeaves[i].singlePrecision)
+        continue;
+      if (frozenLeaves[i].lowRank) {
+        auto lowRankData =
+            static_cast<HMatrixLowRankData<ValueType> *>(leafData[i].get());
+        writer.write(lowRankData->A().memptr(),
+                     lowRankData->A().n_elem * sizeof(ValueType));
+        writer.write(lowRankData->B().memptr(),
+                     lowRankData->B().n_elem * sizeof(ValueType));
+      } else {
+        auto denseData =
+            static_cast<HMatrixDenseData<ValueType> *>(leafData[i].get());
+        std::vector<ValueType> values(denseData->rows() * denseData->cols());
+        denseData->copyValues(values.data());
+        writer.write(values.data(), values.size() * sizeof(ValueType));
+      }
+    }
+
+  header.singlePrecisionPoolOffset = writer.align();
+  if (isFrozen())
+    writer.write(m_frozenSinglePrecisionPool,
+                 singlePrecisionPoolSize * sizeof(SinglePrecisionType));
+  else
+    for (std::size_t i = 0; i < frozenLeaves.size(); ++i) {
+      if (!frozenLeaves[i].singlePrecision)
+        continue;
+      auto lowRankData =
+          static_cast<HMatrixLowRankData<ValueType> *>(leafData[i].get());
+      writer.write(lowRankData->singlePrecisionA().memptr(),
+                   lowRankData->singlePrecisionA().n_elem *
+                       sizeof(SinglePrecisionType));
+      writer.write(lowRankData->singlePrecisionB().memptr(),
+                   lowRankData->singlePrecisionB().n_elem *
+                       sizeof(SinglePrecisionType));
+    }
+
+  writer.finish(header);
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>>
+HMatrix<ValueType, N>::load(const std::string &fileName, bool memoryMap) {
+
+  shared_ptr<const void> storage;
+  const char *data;
+  std::size_t size;
+
+  if (memoryMap) {
+    shared_ptr<HMatrixMappedFile> mappedFile(new HMatrixMappedFile(fileName));
+    data = mappedFile->data();
+    size = mappedFile->size();
+    storage = mappedFile;
+  } else {
+    std::ifstream stream(fileName.c_str(), std::ios::binary | std::ios::ate);
+    if (!stream)
+      throw std::runtime_error("HMatrix::load(): Cannot open file " +
+                               fileName + ".");
+    size = stream.tellg();
+    // 64-bit words keep the payloads suitably aligned
+    auto buffer = make_shared<std::vector<std::uint64_t>>(
+        (size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    stream.seekg(0);
+    stream.read(reinterpret_cast<char *>(buffer->data()), size);
+    if (!stream)
+      throw std::runtime_error("HMatrix::load(): Cannot read file " +
+                               fileName + ".");
+    data = reinterpret_cast<const char *>(buffer->data());
+    storage = buffer;
+  }
+
+  if (size < sizeof(HMatrixFileHeader))
+    throw std::runtime_error("HMatrix::load(): File " + fileName +
+                             " is too short.");
+  HMatrixFileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.magic, HMATRIX_FILE_MAGIC, sizeof(header.magic)))
+    throw std::runtime_error("HMatrix::load(): File " + fileName +
+                             " is not an H-matrix file.");
+  if (header.version != HMATRIX_FILE_VERSION)
+    throw std::runtime_error("HMatrix::load(): File " + fileName +
+                             " has an unsupported format version.");
+  if (header.byteOrderMark != HMATRIX_FILE_BYTE_ORDER_MARK)
+    throw std::runtime_error("HMatrix::load(): File " + fileName +
+                             " was written with a different byte order.");
+  if (header.valueTypeId != hMatrixFileValueTypeId<ValueType>() ||
+      header.branchingFactor != N)
+    throw std::runtime_error("HMatrix::load(): File " + fileName +
+                             " stores an H-matrix of a different type.");
+  if (header.fileSize != size ||
+      header.checksum !=
+          hMatrixFileChecksum(data + sizeof(header), size - sizeof(header)))
+    throw std::runtime_error("HMatrix::load(): File " + fileName +
+                             " is truncated or corrupt.");
+
+  std::vector<shared_ptr<const ClusterTreeNode<N>>> rowNodes;
+  std::vector<shared_ptr<const ClusterTreeNode<N>>> columnNodes;
+
+  HMatrixFileReader rowReader(data, size, header.rowClusterTreeOffset);
+  auto rowClusterTree = loadClusterTree(rowReader, rowNodes);
+  shared_ptr<const ClusterTree<N>> columnClusterTree;
+  if (header.columnClusterTreeOffset == header.rowClusterTreeOffset) {
+    columnClusterTree = rowClusterTree;
+    columnNodes = rowNodes;
+  } else {
+    HMatrixFileReader columnReader(data, size,
+                                   header.columnClusterTreeOffset);
+    columnClusterTree = loadClusterTree(columnReader, columnNodes);
+  }
+
+  HMatrixFileReader blockReader(data, size, header.blockClusterTreeOffset);
+  const std::uint64_t numberOfBlockNodes =
+      *blockReader.read<std::uint64_t>(1);
+  const HMatrixFileBlockNode *blockRecords =
+      blockReader.read<HMatrixFileBlockNode>(numberOfBlockNodes);
+  if (numberOfBlockNodes == 0)
+    throw std::runtime_error("HMatrix::load(): Block cluster tree is empty.");
+
+  std::size_t blockIndex = 0;
+  auto blockNodeData = [&rowNodes, &columnNodes, blockRecords,
+                        numberOfBlockNodes](std::size_t index) {
+    if (index >= numberOfBlockNodes)
+      throw std::runtime_error("HMatrix::load(): "
+                               "Block cluster tree is truncated.");
+    const HMatrixFileBlockNode &record = blockRecords[index];
+    if (record.rowClusterNode >= rowNodes.size() ||
+        record.columnClusterNode >= columnNodes.size())
+      throw std::runtime_error("HMatrix::load(): "
+                               "Block cluster tree node is out of range.");
+    return BlockClusterTreeNodeData<N>(rowNodes[record.rowClusterNode],
+                                       columnNodes[record.columnClusterNode],
+                                       record.admissible);
+  };
+  std::function<void(const shared_ptr<BlockClusterTreeNode<N>> &)> build =
+      [&blockIndex, &build, &blockNodeData, blockRecords](
+          const shared_ptr<BlockClusterTreeNode<N>> &node) {
+    if (blockRecords[blockIndex++].isLeaf)
+      return;
+    for (int i = 0; i < N * N; ++i) {
+      node->addChild(blockNodeData(blockIndex), i);
+      build(node->child(i));
+    }
+  };
+  auto blockRoot = make_shared<BlockClusterTreeNode<N>>(blockNodeData(0));
+  build(blockRoot);
+  if (blockIndex != numberOfBlockNodes)
+    throw std::runtime_error("HMatrix::load(): "
+                             "Inconsistent number of block cluster tree "
+                             "nodes.");
+
+  auto blockClusterTree = make_shared<BlockClusterTree<N>>(
+      rowClusterTree, columnClusterTree, blockRoot);
+  if (blockClusterTree->rows() != header.rows ||
+      blockClusterTree->columns() != header.columns)
+    throw std::runtime_error("HMatrix::load(): "
+                             "Inconsistent matrix dimensions.");
+
+  HMatrixFileReader leafReader(data, size, header.leafOffset);
+  const std::uint64_t *counts = leafReader.read<std::uint64_t>(3);
+  const std::uint64_t numberOfLeaves = counts[0];
+  const std::uint64_t poolSize = counts[1];
+  const std::uint64_t singlePrecisionPoolSize = counts[2];
+  const HMatrixFileLeaf *leafRecords =
+      leafReader.read<HMatrixFileLeaf>(numberOfLeaves);
+
+  HMatrixFileReader poolReader(data, size, header.poolOffset);
+  const ValueType *pool = poolReader.read<ValueType>(poolSize);
+  HMatrixFileReader singlePrecisionPoolReader(data, size,
+                                              header.singlePrecisionPoolOffset);
+  const SinglePrecisionType *singlePrecisionPool =
+      singlePrecisionPoolReader.read<SinglePrecisionType>(
+          singlePrecisionPoolSize);
+
+  auto hMatrix = make_shared<HMatrix<ValueType, N>>(blockClusterTree);
+  hMatrix->m_frozenLeaves.resize(numberOfLeaves);
+  for (std::size_t i = 0; i < numberOfLeaves; ++i) {
+    const HMatrixFileLeaf &record = leafRecords[i];
+    FrozenLeaf &leaf = hMatrix->m_frozenLeaves[i];
+    if (record.rowRange[0] > record.rowRange[1] ||
+        record.rowRange[1] > header.rows ||
+        record.columnRange[0] > record.columnRange[1] ||
+        record.columnRange[1] > header.columns)
+      throw std::runtime_error("HMatrix::load(): "
+                               "Leaf index range is out of bounds.");
+    leaf.rowRange = {{record.rowRange[0], record.rowRange[1]}};
+    leaf.columnRange = {{record.columnRange[0], record.columnRange[1]}};
+    leaf.lowRank = record.lowRank;
+    leaf.singlePrecision = leaf.lowRank && record.singlePrecision;
+    leaf.rank = record.rank;
+    leaf.offset = record.offset;
+    std::size_t rows = leaf.rowRange[1] - leaf.rowRange[0];
+    std::size_t cols = leaf.columnRange[1] - leaf.columnRange[0];
+    std::size_t payload = leaf.lowRank ? (rows + cols) * leaf.rank : rows * cols;
+    std::size_t available =
+        leaf.singlePrecision ? singlePrecisionPoolSize : poolSize;
+    if (leaf.offset > available || payload > available - leaf.offset)
+      throw std::runtime_error("HMatrix::load(): "
+                               "Leaf payload is out of bounds.");
+  }
+
+  hMatrix->computeFrozenApplySchedules();
+  hMatrix->m_frozenStorage = storage;
+  hMatrix->m_frozenPool = pool;
+  hMatrix->m_frozenPoolSize = poolSize;
+  hMatrix->m_frozenSinglePrecisionPool = singlePrecisionPool;
+  hMatrix->m_frozenSinglePrecisionPoolSize = singlePrecisionPoolSize;
+  hMatrix->m_frozenPoolMapped = memoryMap;
+  return hMatrix;
+}
+
+template <typename ValueType, int N>
+shared_ptr<const ClusterTree<N>> HMatrix<ValueType, N>::mergeClusterTrees(
+    const std::vector<shared_ptr<const ClusterTree<N>>> &clusterTrees,
+    std::vector<ClusterNodeMap> &nodeMaps) {
+
+  const std::size_t treeCount = clusterTrees.size();
+  std::vector<std::size_t> offsets(treeCount + 1, 0);
+  for (std::size_t k = 0; k < treeCount; ++k)
+    offsets[k + 1] = offsets[k] + clusterTrees[k]->numberOfDofs();
+
+  // Copy the trees with their index ranges shifted by the DOFs of the
+  // preceding trees, remembering the copy of every node
+
+  std::vector<shared_ptr<ClusterTreeNode<N>>> roots(treeCount);
+  nodeMaps.assign(treeCount, ClusterNodeMap());
+  std::vector<std::size_t> hMatDofToOriginalDofMap(offsets[treeCount]);
+  tbb::parallel_for(std::size_t(0), treeCount, [&](std::size_t k) {
+    const std::size_t offset = offsets[k];
+    auto shifted = [offset](const ClusterTreeNodeData &data) {
+      IndexRangeType indexRange{
+          {data.indexRange[0] + offset, data.indexRange[1] + offset}};
+      return ClusterTreeNodeData(indexRange, data.boundingBox);
+    };
+    ClusterNodeMap &nodeMap = nodeMaps[k];
+    typedef shared_ptr<ClusterTreeNode<N>> NodePtr;
+    std::function<void(const ClusterTreeNode<N> &, const NodePtr &)> copy =
+        [&copy, &shifted, &nodeMap](const ClusterTreeNode<N> &source,
+                                    const NodePtr &dest) {
+      nodeMap[&source] = dest;
+      if (source.isLeaf())
+        return;
+      for (int i = 0; i < N; ++i) {
+        dest->addChild(shifted(source.child(i)->data()), i);
+        copy(*source.child(i), dest->child(i));
+      }
+    };
+    const auto &sourceRoot = *clusterTrees[k]->root();
+    roots[k] = make_shared<ClusterTreeNode<N>>(shifted(sourceRoot.data()));
+    copy(sourceRoot, roots[k]);
+
+    const auto &dofMap = clusterTrees[k]->hMatDofToOriginalDofMap();
+    for (std::size_t i = 0; i < dofMap.size(); ++i)
+      hMatDofToOriginalDofMap[offset + i] = offset + dofMap[i];
+  });
+
+  // Join the copies by new nodes above them, splitting the trees into N
+  // equal groups at every level
+
+  std::function<shared_ptr<ClusterTreeNode<N>>(std::size_t, std::size_t)>
+      join = [&join, &roots, &offsets](std::size_t first, std::size_t last)
+                 -> shared_ptr<ClusterTreeNode<N>> {
+    if (last - first == 1)
+      return roots[first];
+    IndexRangeType indexRange{{offsets[first], offsets[last]}};
+    BoundingBox boundingBox = roots[first]->data().boundingBox;
+    for (std::size_t k = first + 1; k < last; ++k)
+      boundingBox.merge(roots[k]->data().boundingBox);
+    auto node = make_shared<ClusterTreeNode<N>>(
+        ClusterTreeNodeData(indexRange, boundingBox));
+    const std::size_t groupSize = (last - first) / N;
+    for (int i = 0; i < N; ++i) {
+      auto child = join(first + i * groupSize, first + (i + 1) * groupSize);
+      node->addSubTree(child, i);
+    }
+    return node;
+  };
+
+  return make_shared<ClusterTree<N>>(join(0, treeCount),
+                                     hMatDofToOriginalDofMap);
+}
+
+template <typename ValueType, int N>
+shared_ptr<HMatrix<ValueType, N>> HMatrix<ValueType, N>::merge(
+    const std::vector<std::vector<shared_ptr<const HMatrix<ValueType, N>>>> &
+        blocks,
+    int maxThreadCount) {
+
+  const std::size_t blockCount = blocks.size();
+  std::size_t power = 1;
+  while (power < blockCount)
+    power *= N;
+  if (power != blockCount)
+    throw std::invalid_argument("HMatrix::merge(): The number of block rows "
+                                "must be a power of the branching factor.");
+
+  std::vector<shared_ptr<const ClusterTree<N>>> rowClusterTrees(blockCount);
+  std::vector<shared_ptr<const ClusterTree<N>>> columnClusterTrees(
+      blockCount);
+  for (std::size_t i = 0; i < blockCount; ++i) {
+    if (blocks[i].size() != blockCount)
+      throw std::invalid_argument("HMatrix::merge(): "
+                                  "The array of blocks must be square.");
+    for (std::size_t j = 0; j < blockCount; ++j) {
+      const auto &block = blocks[i][j];
+      if (!block)
+        continue;
+      block->checkGeneralStorage("merge");
+      if (block->isFrozen() || block->m_nearField || block->m_lowRankGroups ||
+          block->m_hMatrixData.size() !=
+              block->m_blockClusterTree->leafNodes().size())
+        throw std::invalid_argument(
+            "HMatrix::merge(): Every block must hold all its leaves and can "
+            "be neither frozen nor have its near field extracted or its "
+            "low-rank leaves grouped.");
+      const auto &rowClusterTree = block->m_blockClusterTree->rowClusterTree();
+      const auto &columnClusterTree =
+          block->m_blockClusterTree->columnClusterTree();
+      if (!rowClusterTrees[i])
+        rowClusterTrees[i] = rowClusterTree;
+      if (!columnClusterTrees[j])
+        columnClusterTrees[j] = columnClusterTree;
+      if (rowClusterTrees[i] != rowClusterTree ||
+          columnClusterTrees[j] != columnClusterTree)
+        throw std::invalid_argument(
+            "HMatrix::merge(): The blocks of a block row (column) must share "
+            "their row (column) cluster tree.");
+    }
+  }
+  for (std::size_t k = 0; k < blockCount; ++k)
+    if (!rowClusterTrees[k] || !columnClusterTrees[k])
+      throw std::invalid_argument("HMatrix::merge(): "
+                                  "Every block row and column must contain "
+                                  "at least one block.");
+
+  std::vector<ClusterNodeMap> rowNodeMaps, columnNodeMaps;
+  auto rowClusterTree = mergeClusterTrees(rowClusterTrees, rowNodeMaps);
+  auto columnClusterTree =
+      mergeClusterTrees(columnClusterTrees, columnNodeMaps);
+
+  // Build the levels of the block cluster tree above the blocks. Since the
+  // number of blocks is a power of N, the row and column clusters of every
+  // node split simultaneously, and the blocks sit at the same level.
+
+  typedef shared_ptr<BlockClusterTreeNode<N>> BlockNodePtr;
+  std::vector<BlockNodePtr> blockRoots(blockCount * blockCount);
+  std::function<void(const BlockNodePtr &, std::size_t, std::size_t,
+                     std::size_t)> split =
+      [&](const BlockNodePtr &node, std::size_t firstRow,
+          std::size_t firstColumn, std::size_t count) {
+    if (count == 1) {
+      blockRoots[firstRow * blockCount + firstColumn] = node;
+      return;
+    }
+    const auto &data = node->data();
+    const std::size_t groupSize = count / N;
+    for (int i = 0; i < N; ++i)
+      for (int j = 0; j < N; ++j) {
+        node->addChild(BlockClusterTreeNodeData<N>(
+                           data.rowClusterTreeNode->child(i),
+                           data.columnClusterTreeNode->child(j), false),
+                       N * i + j);
+        split(node->child(N * i + j), firstRow + i * groupSize,
+              firstColumn + j * groupSize, groupSize);
+      }
+  };
+  auto root = make_shared<BlockClusterTreeNode<N>>(BlockClusterTreeNodeData<N>(
+      rowClusterTree->root(), columnClusterTree->root(), false));
+  split(root, 0, 0, blockCount);
+
+  // Copy the block cluster trees and the leaf data of the blocks, one task
+  // per block. Missing blocks become admissible leaves of rank 0.
+
+  typedef std::pair<BlockNodePtr, shared_ptr<HMatrixData<ValueType>>> Leaf;
+  std::vector<std::vector<Leaf>> blockLeaves(blockCount * blockCount);
+  std::vector<std::vector<double>> blockAssemblyTimes(blockCount * blockCount);
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, blockCount * blockCount, 1),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t b = r.begin(); b != r.end(); ++b) {
+            const std::size_t i = b / blockCount, j = b % blockCount;
+            const BlockNodePtr &blockRoot = blockRoots[b];
+            std::vector<Leaf> &leaves = blockLeaves[b];
+            std::vector<double> &assemblyTimes = blockAssemblyTimes[b];
+            const auto &block = blocks[i][j];
+            if (!block) {
+              blockRoot->data().admissible = true;
+              auto zero = make_shared<HMatrixLowRankData<ValueType>>();
+              zero->A().zeros(rowClusterTrees[i]->numberOfDofs(), 0);
+              zero->B().zeros(0, columnClusterTrees[j]->numberOfDofs());
+              leaves.push_back(Leaf(blockRoot, zero));
+              assemblyTimes.push_back(0);
+              continue;
+            }
+            const ClusterNodeMap &rowNodeMap = rowNodeMaps[i];
+            const ClusterNodeMap &columnNodeMap = columnNodeMaps[j];
+            std::function<void(const shared_ptr<BlockClusterTreeNode<N>> &,
+                               const BlockNodePtr &)> copy =
+                [&](const shared_ptr<BlockClusterTreeNode<N>> &source,
+                    const BlockNodePtr &dest) {
+              dest->data().admissible = source->data().admissible;
+              if (source->isLeaf()) {
+                const auto &data = block->m_hMatrixData.at(source);
+                shared_ptr<HMatrixData<ValueType>> copiedData;
+                if (auto dense =
+                        dynamic_cast<const HMatrixDenseData<ValueType> *>(
+                            data.get()))
+                  copiedData = make_shared<HMatrixDenseData<ValueType>>(*dense);
+                else if (auto lowRank = dynamic_cast<
+                             const HMatrixLowRankData<ValueType> *>(
+                             data.get()))
+                  copiedData =
+                      make_shared<HMatrixLowRankData<ValueType>>(*lowRank);
+                else
+                  throw std::runtime_error("HMatrix::merge(): "
+                                           "Unknown type of leaf data.");
+                leaves.push_back(Leaf(dest, copiedData));
+                auto time = block->m_assemblyTimes.find(source);
+                assemblyTimes.push_back(
+                    time == block->m_assemblyTimes.end() ? 0. : time->second);
+                return;
+              }
+              for (int k = 0; k < N * N; ++k) {
+                const auto &sourceChild = source->child(k);
+                const auto &childData = sourceChild->data();
+                dest->addChild(
+                    BlockClusterTreeNodeData<N>(
+                        rowNodeMap.at(childData.rowClusterTreeNode.get()),
+                        columnNodeMap.at(childData.columnClusterTreeNode.get()),
+                        false),
+                    k);
+                copy(sourceChild, dest->child(k));
+              }
+            };
+            copy(block->m_blockClusterTree->root(), blockRoot);
+          }
+        });
+  });
+
+  auto blockClusterTree = make_shared<BlockClusterTree<N>>(
+      rowClusterTree, columnClusterTree, root);
+  auto hMatrix = make_shared<HMatrix<ValueType, N>>(blockClusterTree);
+  hMatrix->m_nodeData.assign(blockClusterTree->treeIndex().numberOfNodes(),
+                             nullptr);
+  for (std::size_t b = 0; b < blockLeaves.size(); ++b)
+    for (std::size_t l = 0; l < blockLeaves[b].size(); ++l) {
+      const Leaf &leaf = blockLeaves[b][l];
+      hMatrix->m_hMatrixData[leaf.first] = leaf.second;
+      hMatrix->m_assemblyTimes[leaf.first] = blockAssemblyTimes[b][l];
+      hMatrix->m_nodeData[leaf.first->index()] = leaf.second.get();
+    }
+  return hMatrix;
 }
 
 template <typename ValueType, int N>
@@ -60,7 +1531,24 @@ arma::Mat<ValueType>
 HMatrix<ValueType, N>::permuteMatToHMatDofs(const arma::Mat<ValueType> &mat,
                                             RowColSelector rowOrColumn) const {
 
-  arma::Mat<ValueType> permutedDofs(mat.n_rows, mat.n_cols);
+  arma::Mat<ValueType> permutedDofs;
+  permuteMatToHMatDofs(mat, rowOrColumn, permutedDofs);
+  return permutedDofs;
+}
+
+template <typename ValueType, int N>
+arma::Mat<ValueType> HMatrix<ValueType, N>::permuteMatToOriginalDofs(
+    const arma::Mat<ValueType> &mat, RowColSelector rowOrColumn) const {
+
+  arma::Mat<ValueType> originalDofs;
+  permuteMatToOriginalDofs(mat, rowOrColumn, originalDofs);
+  return originalDofs;
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::permuteMatToHMatDofs(
+    const arma::Mat<ValueType> &mat, RowColSelector rowOrColumn,
+    arma::Mat<ValueType> &result) const {
 
   shared_ptr<const ClusterTree<N>> clusterTree;
 
@@ -73,20 +1561,22 @@ HMatrix<ValueType, N>::permuteMatToHMatDofs(const arma::Mat<ValueType> &mat,
     throw std::runtime_error("HMatrix::permuteMatToHMatDofs: "
                              "Input matrix has wrong number of rows.");
 
-  for (std::size_t i = 0; i < mat.n_rows; ++i) {
-    auto permutedIndex = clusterTree->mapOriginalDofToHMatDof(i);
-    for (std::size_t j = 0; j < mat.n_cols; ++j)
-      permutedDofs(permutedIndex, j) = mat(i, j);
-  }
+  result.set_size(mat.n_rows, mat.n_cols);
 
-  return permutedDofs;
+  // Gather so that the writes are sequential
+  const auto &hMatDofToOriginalDofMap = clusterTree->hMatDofToOriginalDofMap();
+  for (std::size_t j = 0; j < mat.n_cols; ++j) {
+    const ValueType *source = mat.colptr(j);
+    ValueType *target = result.colptr(j);
+    for (std::size_t i = 0; i < mat.n_rows; ++i)
+      target[i] = source[hMatDofToOriginalDofMap[i]];
+  }
 }
 
 template <typename ValueType, int N>
-arma::Mat<ValueType> HMatrix<ValueType, N>::permuteMatToOriginalDofs(
-    const arma::Mat<ValueType> &mat, RowColSelector rowOrColumn) const {
-
-  arma::Mat<ValueType> originalDofs(mat.n_rows, mat.n_cols);
+void HMatrix<ValueType, N>::permuteMatToOriginalDofs(
+    const arma::Mat<ValueType> &mat, RowColSelector rowOrColumn,
+    arma::Mat<ValueType> &result) const {
 
   shared_ptr<const ClusterTree<N>> clusterTree;
 
@@ -99,13 +1589,36 @@ arma::Mat<ValueType> HMatrix<ValueType, N>::permuteMatToOriginalDofs(
     throw std::runtime_error("HMatrix::permuteMatToOriginalDofs: "
                              "Input matrix has wrong number of rows.");
 
-  for (std::size_t i = 0; i < mat.n_rows; ++i) {
-    auto originalIndex = clusterTree->mapHMatDofToOriginalDof(i);
-    for (std::size_t j = 0; j < mat.n_cols; ++j)
-      originalDofs(originalIndex, j) = mat(i, j);
+  result.set_size(mat.n_rows, mat.n_cols);
+
+  const auto &originalDofToHMatDofMap = clusterTree->originalDofToHMatDofMap();
+  for (std::size_t j = 0; j < mat.n_cols; ++j) {
+    const ValueType *source = mat.colptr(j);
+    ValueType *target = result.colptr(j);
+    for (std::size_t i = 0; i < mat.n_rows; ++i)
+      target[i] = source[originalDofToHMatDofMap[i]];
   }
+}
 
-  return originalDofs;
+template <typename ValueType, int N>
+HMatrix<ValueType, N>::ApplyBuffers::ApplyBuffers(const HMatrix &hMatrix)
+    : m_hMatrix(hMatrix) {
+  tbb::spin_mutex::scoped_lock lock(m_hMatrix.m_applyBufferMutex);
+  auto &pool = m_hMatrix.m_applyBufferPool;
+  if (!pool.empty()) {
+    x.swap(pool.back().first);
+    y.swap(pool.back().second);
+    pool.pop_back();
+  }
+}
+
+template <typename ValueType, int N>
+HMatrix<ValueType, N>::ApplyBuffers::~ApplyBuffers() {
+  tbb::spin_mutex::scoped_lock lock(m_hMatrix.m_applyBufferMutex);
+  auto &pool = m_hMatrix.m_applyBufferPool;
+  pool.emplace_back();
+  pool.back().first.swap(x);
+  pool.back().second.swap(y);
 }
 
 template <typename ValueType, int N>
@@ -113,47 +1626,445 @@ void HMatrix<ValueType, N>::apply(const arma::Mat<ValueType> &X,
                                   arma::Mat<ValueType> &Y, TransposeMode trans,
                                   ValueType alpha, ValueType beta) const {
 
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  RowColSelector inputSelector = transposed ? ROW : COL;
+  RowColSelector outputSelector = transposed ? COL : ROW;
+
+  ApplyBuffers buffers(*this);
+  arma::Mat<ValueType> &xPermuted = buffers.x;
+  arma::Mat<ValueType> &yPermuted = buffers.y;
+
+  permuteMatToHMatDofs(X, inputSelector, xPermuted);
   if (beta == ValueType(0))
-    Y.zeros();
+    yPermuted.zeros(Y.n_rows, Y.n_cols);
   else
-    Y *= beta;
+    permuteMatToHMatDofs(Y, outputSelector, yPermuted);
+
+  applyPermuted(xPermuted, yPermuted, trans, alpha, beta);
+
+  permuteMatToOriginalDofs(yPermuted, outputSelector, Y);
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::applyPermuted(const arma::Mat<ValueType> &xPermuted,
+                                          arma::Mat<ValueType> &yPermuted,
+                                          TransposeMode trans, ValueType alpha,
+                                          ValueType beta) const {
+
+  if (beta == ValueType(0))
+    yPermuted.zeros();
+  else if (beta != ValueType(1))
+    yPermuted *= beta;
+
+  if (isFrozen())
+    applyFrozen(xPermuted, yPermuted, trans, alpha);
+  else if (!m_nodeData.empty())
+    applyImpl(0, xPermuted, yPermuted, trans, alpha);
+  if (m_nearField)
+    m_nearField->apply(xPermuted, yPermuted, trans, alpha);
+  if (m_lowRankGroups)
+    m_lowRankGroups->apply(xPermuted, yPermuted, trans, alpha);
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::applyNearField(const arma::Mat<ValueType> &X,
+                                           arma::Mat<ValueType> &Y,
+                                           TransposeMode trans,
+                                           ValueType alpha,
+                                           ValueType beta) const {
+
+  if (!m_nearField)
+    throw std::runtime_error("HMatrix::applyNearField(): "
+                             "The near field has not been extracted.");
+
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  RowColSelector inputSelector = transposed ? ROW : COL;
+  RowColSelector outputSelector = transposed ? COL : ROW;
+
+  ApplyBuffers buffers(*this);
+  arma::Mat<ValueType> &xPermuted = buffers.x;
+  arma::Mat<ValueType> &yPermuted = buffers.y;
 
-  arma::Mat<ValueType> xPermuted;
-  arma::Mat<ValueType> yPermuted;
+  permuteMatToHMatDofs(X, inputSelector, xPermuted);
+  if (beta == ValueType(0))
+    yPermuted.zeros(Y.n_rows, Y.n_cols);
+  else {
+    permuteMatToHMatDofs(Y, outputSelector, yPermuted);
+    if (beta != ValueType(1))
+      yPermuted *= beta;
+  }
+
+  m_nearField->apply(xPermuted, yPermuted, trans, alpha);
 
-  if (trans == TransposeMode::NOTRANS) {
+  permuteMatToOriginalDofs(yPermuted, outputSelector, Y);
+}
 
-    xPermuted = permuteMatToHMatDofs(X, COL);
-    yPermuted = permuteMatToHMatDofs(Y, ROW);
+template <typename ValueType, int N>
+std::size_t
+HMatrix<ValueType, N>::frozenPayloadSize(const FrozenLeaf &leaf) {
+  std::size_t rows = leaf.rowRange[1] - leaf.rowRange[0];
+  std::size_t cols = leaf.columnRange[1] - leaf.columnRange[0];
+  return leaf.lowRank ? (rows + cols) * leaf.rank : rows * cols;
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::computeFrozenApplySchedule(
+    const std::vector<FrozenLeaf> &frozenLeaves, bool byColumns,
+    std::size_t outputSize, FrozenApplySchedule &schedule) {
+
+  auto outputRange = [&](std::size_t i) -> const IndexRangeType & {
+    return byColumns ? frozenLeaves[i].columnRange : frozenLeaves[i].rowRange;
+  };
+
+  // Leaves longer than this would make too few bands to keep the threads
+  // busy
+  const std::size_t maxShortLength =
+      std::max<std::size_t>(1, outputSize / (4 * tbb::task_scheduler_init::
+                                                     default_num_threads()));
+  schedule = FrozenApplySchedule();
+  for (std::size_t i = 0; i < frozenLeaves.size(); ++i) {
+    const IndexRangeType &range = outputRange(i);
+    if (range[1] - range[0] > maxShortLength)
+      schedule.longLeaves.push_back(i);
+    else
+      schedule.shortLeaves.push_back(i);
+  }
+
+  // Stable, so that the leaves of a band keep the order of their payloads
+  std::stable_sort(begin(schedule.shortLeaves), end(schedule.shortLeaves),
+                   [&](std::size_t a, std::size_t b) {
+    return outputRange(a)[0] < outputRange(b)[0];
+  });
+  std::size_t bandEnd = 0;
+  for (std::size_t k = 0; k < schedule.shortLeaves.size(); ++k) {
+    const IndexRangeType &range = outputRange(schedule.shortLeaves[k]);
+    if (k == 0 || range[0] >= bandEnd) {
+      schedule.bands.push_back(k);
+      bandEnd = range[1];
+    } else
+      bandEnd = std::max<std::size_t>(bandEnd, range[1]);
+  }
+  schedule.bands.push_back(schedule.shortLeaves.size());
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::computeFrozenApplySchedules() {
+  computeFrozenApplySchedule(m_frozenLeaves, false, m_blockClusterTree->rows(),
+                             m_frozenRowSchedule);
+  computeFrozenApplySchedule(m_frozenLeaves, true,
+                             m_blockClusterTree->columns(),
+                             m_frozenColumnSchedule);
+}
+
+template <typename ValueType, int N>
+const void *
+HMatrix<ValueType, N>::frozenPayload(const FrozenLeaf &leaf) const {
+  if (leaf.singlePrecision)
+    return m_frozenSinglePrecisionPool + leaf.offset;
+  return m_frozenPool + leaf.offset;
+}
+
+template <typename ValueType, int N>
+std::size_t HMatrix<ValueType, N>::frozenPayloadBytes(const FrozenLeaf &leaf) {
+  return frozenPayloadSize(leaf) * (leaf.singlePrecision
+                                        ? sizeof(SinglePrecisionType)
+                                        : sizeof(ValueType));
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::applyFrozenLeaf(
+    const FrozenLeaf &leaf, const arma::Mat<ValueType> &xPermuted,
+    arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+    ValueType alpha) const {
+
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  std::size_t rows = leaf.rowRange[1] - leaf.rowRange[0];
+  std::size_t cols = leaf.columnRange[1] - leaf.columnRange[0];
+  const IndexRangeType &inputRange =
+      transposed ? leaf.rowRange : leaf.columnRange;
+  const IndexRangeType &outputRange =
+      transposed ? leaf.columnRange : leaf.rowRange;
+
+  // The matrices below only alias the memory pool
+  ValueType *data = leaf.singlePrecision
+                        ? nullptr
+                        : const_cast<ValueType *>(m_frozenPool + leaf.offset);
+
+  auto x = xPermuted.rows(inputRange[0], inputRange[1] - 1);
+  auto y = yPermuted.rows(outputRange[0], outputRange[1] - 1);
+
+  if (leaf.singlePrecision) {
+    SinglePrecisionType *singlePrecisionData =
+        const_cast<SinglePrecisionType *>(m_frozenSinglePrecisionPool +
+                                          leaf.offset);
+    const arma::Mat<SinglePrecisionType> A(singlePrecisionData, rows,
+                                           leaf.rank, false, true);
+    const arma::Mat<SinglePrecisionType> B(
+        singlePrecisionData + rows * leaf.rank, leaf.rank, cols, false, true);
+    y += alpha * applySinglePrecisionFactors(A, B, x, trans);
+  } else if (leaf.lowRank) {
+    const arma::Mat<ValueType> A(data, rows, leaf.rank, false, true);
+    const arma::Mat<ValueType> B(data + rows * leaf.rank, leaf.rank, cols,
+                                 false, true);
+    if (trans == TransposeMode::NOTRANS)
+      y += alpha * A * (B * x);
+    else if (trans == TransposeMode::TRANS)
+      y += alpha * B.st() * (A.st() * x);
+    else if (trans == TransposeMode::CONJ)
+      y += alpha * arma::conj(A) * (arma::conj(B) * x);
+    else
+      y += alpha * B.t() * (A.t() * x);
   } else {
-    xPermuted = permuteMatToHMatDofs(X, ROW);
-    yPermuted = permuteMatToHMatDofs(Y, COL);
+    const arma::Mat<ValueType> A(data, rows, cols, false, true);
+    if (trans == TransposeMode::NOTRANS)
+      y += alpha * A * x;
+    else if (trans == TransposeMode::TRANS)
+      y += alpha * A.st() * x;
+    else if (trans == TransposeMode::CONJ)
+      y += alpha * arma::conj(A) * x;
+    else
+      y += alpha * A.t() * x;
   }
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::applyLongFrozenLeaf(
+    const FrozenLeaf &leaf, const arma::Mat<ValueType> &xPermuted,
+    arma::Mat<ValueType> &yPermuted, TransposeMode trans,
+    ValueType alpha) const {
 
-  std::for_each(begin(m_hMatrixData), end(m_hMatrixData),
-                [trans, alpha, beta, &xPermuted, &yPermuted, this](
-                    const std::pair<shared_ptr<BlockClusterTreeNode<N>>,
-                                    shared_ptr<HMatrixData<ValueType>>>
-                        elem) {
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  bool conjugated =
+      (trans == TransposeMode::CONJ || trans == TransposeMode::CONJTRANS);
+  std::size_t rows = leaf.rowRange[1] - leaf.rowRange[0];
+  std::size_t cols = leaf.columnRange[1] - leaf.columnRange[0];
+  const IndexRangeType &inputRange =
+      transposed ? leaf.rowRange : leaf.columnRange;
+  const IndexRangeType &outputRange =
+      transposed ? leaf.columnRange : leaf.rowRange;
 
-    IndexRangeType inputRange;
-    IndexRangeType outputRange;
-    if (trans == TransposeMode::NOTRANS) {
-      inputRange = elem.first->data().columnClusterTreeNode->data().indexRange;
-      outputRange = elem.first->data().rowClusterTreeNode->data().indexRange;
-    } else {
-      inputRange = elem.first->data().rowClusterTreeNode->data().indexRange;
-      outputRange = elem.first->data().columnClusterTreeNode->data().indexRange;
+  if (m_frozenPoolMapped)
+    prefetchMappedRange(frozenPayload(leaf), frozenPayloadBytes(leaf));
+
+  ValueType *data = leaf.singlePrecision
+                        ? nullptr
+                        : const_cast<ValueType *>(m_frozenPool + leaf.offset);
+  SinglePrecisionType *singlePrecisionData =
+      leaf.singlePrecision ? const_cast<SinglePrecisionType *>(
+                                 m_frozenSinglePrecisionPool + leaf.offset)
+                           : nullptr;
+  const auto x = xPermuted.rows(inputRange[0], inputRange[1] - 1);
+
+  // The factor applied to x first is small and applied once; the other
+  // factor, or the dense block, is split into chunks of output indices
+  // computed in parallel.
+  arma::Mat<ValueType> coefficients;
+  arma::Mat<SinglePrecisionType> singlePrecisionCoefficients;
+  if (leaf.singlePrecision) {
+    const arma::Mat<SinglePrecisionType> A(singlePrecisionData, rows,
+                                           leaf.rank, false, true);
+    const arma::Mat<SinglePrecisionType> B(
+        singlePrecisionData + rows * leaf.rank, leaf.rank, cols, false, true);
+    const arma::Mat<SinglePrecisionType> xSingle =
+        arma::conv_to<arma::Mat<SinglePrecisionType>>::from(x);
+    if (trans == TransposeMode::NOTRANS)
+      singlePrecisionCoefficients = B * xSingle;
+    else if (trans == TransposeMode::TRANS)
+      singlePrecisionCoefficients = A.st() * xSingle;
+    else if (trans == TransposeMode::CONJ)
+      singlePrecisionCoefficients = arma::conj(B) * xSingle;
+    else
+      singlePrecisionCoefficients = A.t() * xSingle;
+  } else if (leaf.lowRank) {
+    const arma::Mat<ValueType> A(data, rows, leaf.rank, false, true);
+    const arma::Mat<ValueType> B(data + rows * leaf.rank, leaf.rank, cols,
+                                 false, true);
+    if (trans == TransposeMode::NOTRANS)
+      coefficients = B * x;
+    else if (trans == TransposeMode::TRANS)
+      coefficients = A.st() * x;
+    else if (trans == TransposeMode::CONJ)
+      coefficients = arma::conj(B) * x;
+    else
+      coefficients = A.t() * x;
+  }
+
+  const std::size_t chunkSize = 256;
+  tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, outputRange[1] - outputRange[0],
+                                      chunkSize),
+      [&](const tbb::blocked_range<std::size_t> &r) {
+        const std::size_t first = r.begin(), last = r.end() - 1;
+        auto y = yPermuted.rows(outputRange[0] + first, outputRange[0] + last);
+        if (leaf.singlePrecision) {
+          // Rows first..last of op(A), or of op(B) if transposed
+          const arma::Mat<SinglePrecisionType> A(singlePrecisionData, rows,
+                                                 leaf.rank, false, true);
+          const arma::Mat<SinglePrecisionType> B(
+              singlePrecisionData + rows * leaf.rank, leaf.rank, cols, false,
+              true);
+          arma::Mat<SinglePrecisionType> product;
+          if (trans == TransposeMode::NOTRANS)
+            product = A.rows(first, last) * singlePrecisionCoefficients;
+          else if (trans == TransposeMode::TRANS)
+            product = B.cols(first, last).st() * singlePrecisionCoefficients;
+          else if (trans == TransposeMode::CONJ)
+            product =
+                arma::conj(A.rows(first, last)) * singlePrecisionCoefficients;
+          else
+            product = B.cols(first, last).t() * singlePrecisionCoefficients;
+          y += alpha * arma::conv_to<arma::Mat<ValueType>>::from(product);
+        } else if (leaf.lowRank) {
+          const arma::Mat<ValueType> A(data, rows, leaf.rank, false, true);
+          const arma::Mat<ValueType> B(data + rows * leaf.rank, leaf.rank,
+                                       cols, false, true);
+          if (trans == TransposeMode::NOTRANS)
+            y += alpha * A.rows(first, last) * coefficients;
+          else if (trans == TransposeMode::TRANS)
+            y += alpha * B.cols(first, last).st() * coefficients;
+          else if (trans == TransposeMode::CONJ)
+            y += alpha * arma::conj(A.rows(first, last)) * coefficients;
+          else
+            y += alpha * B.cols(first, last).t() * coefficients;
+        } else {
+          const arma::Mat<ValueType> A(data, rows, cols, false, true);
+          if (!transposed && !conjugated)
+            y += alpha * A.rows(first, last) * x;
+          else if (!transposed)
+            y += alpha * arma::conj(A.rows(first, last)) * x;
+          else if (!conjugated)
+            y += alpha * A.cols(first, last).st() * x;
+          else
+            y += alpha * A.cols(first, last).t() * x;
+        }
+      });
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::applyFrozen(const arma::Mat<ValueType> &xPermuted,
+                                        arma::Mat<ValueType> &yPermuted,
+                                        TransposeMode trans,
+                                        ValueType alpha) const {
+
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  const FrozenApplySchedule &schedule =
+      transposed ? m_frozenColumnSchedule : m_frozenRowSchedule;
+
+  // The bands of short leaves have disjoint output ranges, so the threads
+  // add their products to yPermuted directly. Each thread gets a contiguous
+  // range of bands and reads their payloads in order.
+  const std::size_t readAheadBytes = 8 << 20; // per thread
+  tbb::parallel_for(
+      tbb::blocked_range<std::size_t>(0, schedule.bands.size() - 1),
+      [&](const tbb::blocked_range<std::size_t> &r) {
+        const std::size_t first = schedule.bands[r.begin()];
+        const std::size_t last = schedule.bands[r.end()];
+
+        // Payloads of mapped pools are read ahead of the current leaf, so
+        // that the thread does not wait for every page it touches
+        std::size_t nextPrefetched = first;
+        std::size_t prefetchedBytes = 0;
+
+        for (std::size_t k = first; k != last; ++k) {
+          const FrozenLeaf &leaf = m_frozenLeaves[schedule.shortLeaves[k]];
+          if (m_frozenPoolMapped) {
+            while (nextPrefetched != last &&
+                   (nextPrefetched <= k || prefetchedBytes < readAheadBytes)) {
+              const FrozenLeaf &next =
+                  m_frozenLeaves[schedule.shortLeaves[nextPrefetched++]];
+              prefetchMappedRange(frozenPayload(next),
+                                  frozenPayloadBytes(next));
+              prefetchedBytes += frozenPayloadBytes(next);
+            }
+            prefetchedBytes -= frozenPayloadBytes(leaf);
+          }
+          applyFrozenLeaf(leaf, xPermuted, yPermuted, trans, alpha);
+        }
+      },
+      tbb::static_partitioner());
+
+  // Long leaves overlap many bands and are split into chunks of their own
+  // output range instead
+  for (std::size_t i : schedule.longLeaves)
+    applyLongFrozenLeaf(m_frozenLeaves[i], xPermuted, yPermuted, trans, alpha);
+}
+
+template <typename ValueType, int N>
+TransposeMode
+HMatrix<ValueType, N>::mirrorTransposeMode(TransposeMode trans) const {
+  // op(A_ij) for A_ij = A_ji^T or A_ji^H as an operation on the mirror A_ji
+  const bool hermitian = (m_symmetry == HERMITIAN_STORAGE);
+  switch (trans) {
+  case NOTRANS:
+    return hermitian ? CONJTRANS : TRANS;
+  case TRANS:
+    return hermitian ? CONJ : NOTRANS;
+  case CONJ:
+    return hermitian ? TRANS : CONJTRANS;
+  default: // CONJTRANS
+    return hermitian ? NOTRANS : CONJ;
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrix<ValueType, N>::applyImpl(std::size_t nodeIndex,
+                                      const arma::Mat<ValueType> &xPermuted,
+                                      arma::Mat<ValueType> &yPermuted,
+                                      TransposeMode trans,
+                                      ValueType alpha) const {
+
+  bool transposed =
+      (trans == TransposeMode::TRANS || trans == TransposeMode::CONJTRANS);
+  const auto &treeIndex = m_blockClusterTree->treeIndex();
+
+  if (treeIndex.isLeaf(nodeIndex)) {
+
+    // Leaves of other parts of a distributed matrix are not stored, and
+    // those of the upper block triangle of matrices with symmetric storage
+    // are applied through their mirror leaves
+    const HMatrixData<ValueType> *data = m_nodeData[nodeIndex];
+    TransposeMode leafTrans = trans;
+    if (!m_mirrorLeaves.empty() && m_mirrorLeaves[nodeIndex]) {
+      data = m_nodeData[m_mirrorLeaves[nodeIndex]->index()];
+      leafTrans = mirrorTransposeMode(trans);
     }
+    if (!data)
+      return;
+
+    const auto &nodeData = treeIndex.node(nodeIndex).data();
+    const IndexRangeType &rowRange =
+        nodeData.rowClusterTreeNode->data().indexRange;
+    const IndexRangeType &columnRange =
+        nodeData.columnClusterTreeNode->data().indexRange;
+    const IndexRangeType &inputRange = transposed ? rowRange : columnRange;
+    const IndexRangeType &outputRange = transposed ? columnRange : rowRange;
 
-    arma::subview<ValueType> xData =
+    const arma::subview<ValueType> xData =
         xPermuted.rows(inputRange[0], inputRange[1] - 1);
     arma::subview<ValueType> yData =
         yPermuted.rows(outputRange[0], outputRange[1] - 1);
-    elem.second->apply(xData, yData, trans, alpha, 1);
-  });
+    data->apply(xData, yData, leafTrans, alpha, 1);
+    return;
+  }
+
+  // Children with different output clusters write to disjoint parts of
+  // yPermuted and can be processed concurrently. Children sharing an output
+  // cluster are processed one after the other by the same task.
 
-  Y = this->permuteMatToOriginalDofs(yPermuted, ROW);
+  tbb::parallel_for(0, N, [nodeIndex, &treeIndex, &xPermuted, &yPermuted,
+                           trans, alpha, transposed, this](int outputIndex) {
+    for (int inputIndex = 0; inputIndex < N; ++inputIndex) {
+      int childIndex = transposed ? N * inputIndex + outputIndex
+                                  : N * outputIndex + inputIndex;
+      applyImpl(treeIndex.child(nodeIndex, childIndex), xPermuted, yPermuted,
+                trans, alpha);
+    }
+  });
 }
 }
 
@@ -0,0 +1,53 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_INTERPOLATION_COMPRESSOR_HPP
+#define HMAT_HMATRIX_INTERPOLATION_COMPRESSOR_HPP
+
+#include "common.hpp"
+#include "block_cluster_tree.hpp"
+#include "hmatrix_compressor.hpp"
+#include "hmatrix_dense_compressor.hpp"
+#include "data_accessor.hpp"
+#include "interpolation_data_accessor.hpp"
+#include <vector>
+
+namespace hmat {
+
+/** \brief Compression of admissible blocks by interpolation of the kernel.
+ *
+ *  Inadmissible blocks are evaluated by the DataAccessor. An admissible
+ *  block (t, s) gets the factors A = U_t^T K_ts and B = V_s described in
+ *  InterpolationDataAccessor, so no matrix entries are sampled. The moment
+ *  matrices of all clusters occurring in admissible blocks of \p
+ *  blockClusterTree are computed in parallel by the constructor. The rank
+ *  of the factors, the number of interpolation nodes, is then reduced by
+ *  HMatrixLowRankData::recompress() to the relative accuracy \p eps; blocks
+ *  for which the factors would still take more memory than the dense
+ *  block are stored densely. */
+template <typename ValueType, int N>
+class HMatrixInterpolationCompressor : public HMatrixCompressor<ValueType, N> {
+public:
+  HMatrixInterpolationCompressor(
+      const BlockClusterTree<N> &blockClusterTree,
+      const DataAccessor<ValueType, N> &dataAccessor,
+      const InterpolationDataAccessor<ValueType, N> &interpolationDataAccessor,
+      double eps);
+
+  void compressBlock(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                     shared_ptr<HMatrixData<ValueType>> &hMatrixData) const
+      override;
+
+private:
+  const InterpolationDataAccessor<ValueType, N> &m_interpolationDataAccessor;
+  double m_eps;
+  HMatrixDenseCompressor<ValueType, N> m_hMatrixDenseCompressor;
+  // Moment matrices indexed by the cluster node numbers (see TreeIndex);
+  // empty for clusters without admissible blocks
+  std::vector<arma::Mat<ValueType>> m_rowMoments;
+  std::vector<arma::Mat<ValueType>> m_columnMoments;
+};
+}
+
+#include "hmatrix_interpolation_compressor_impl.hpp"
+
+#endif
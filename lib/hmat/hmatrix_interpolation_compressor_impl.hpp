@@ -0,0 +1,100 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_INTERPOLATION_COMPRESSOR_IMPL_HPP
+#define HMAT_HMATRIX_INTERPOLATION_COMPRESSOR_IMPL_HPP
+
+#include "hmatrix_interpolation_compressor.hpp"
+#include "hmatrix_dense_data.hpp"
+#include "hmatrix_low_rank_data.hpp"
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+HMatrixInterpolationCompressor<ValueType, N>::HMatrixInterpolationCompressor(
+    const BlockClusterTree<N> &blockClusterTree,
+    const DataAccessor<ValueType, N> &dataAccessor,
+    const InterpolationDataAccessor<ValueType, N> &interpolationDataAccessor,
+    double eps)
+    : m_interpolationDataAccessor(interpolationDataAccessor), m_eps(eps),
+      m_hMatrixDenseCompressor(dataAccessor) {
+
+  const auto &rowTreeIndex = blockClusterTree.rowClusterTree()->treeIndex();
+  const auto &columnTreeIndex =
+      blockClusterTree.columnClusterTree()->treeIndex();
+  m_rowMoments.resize(rowTreeIndex.numberOfNodes());
+  m_columnMoments.resize(columnTreeIndex.numberOfNodes());
+
+  // Clusters of the admissible blocks, each listed once
+  std::vector<bool> rowNeeded(m_rowMoments.size(), false);
+  std::vector<bool> columnNeeded(m_columnMoments.size(), false);
+  for (const auto &leaf : blockClusterTree.leafNodes())
+    if (leaf->data().admissible) {
+      rowNeeded[leaf->data().rowClusterTreeNode->index()] = true;
+      columnNeeded[leaf->data().columnClusterTreeNode->index()] = true;
+    }
+  std::vector<std::pair<RowColSelector, std::size_t>> clusters;
+  for (std::size_t i = 0; i < rowNeeded.size(); ++i)
+    if (rowNeeded[i])
+      clusters.push_back(std::make_pair(ROW, i));
+  for (std::size_t i = 0; i < columnNeeded.size(); ++i)
+    if (columnNeeded[i])
+      clusters.push_back(std::make_pair(COL, i));
+
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, clusters.size()),
+                    [&](const tbb::blocked_range<std::size_t> &r) {
+    for (std::size_t k = r.begin(); k != r.end(); ++k) {
+      const RowColSelector side = clusters[k].first;
+      const std::size_t node = clusters[k].second;
+      if (side == ROW)
+        m_interpolationDataAccessor.computeClusterMoments(
+            ROW, rowTreeIndex.node(node), m_rowMoments[node]);
+      else
+        m_interpolationDataAccessor.computeClusterMoments(
+            COL, columnTreeIndex.node(node), m_columnMoments[node]);
+    }
+  });
+}
+
+template <typename ValueType, int N>
+void HMatrixInterpolationCompressor<ValueType, N>::compressBlock(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    shared_ptr<HMatrixData<ValueType>> &hMatrixData) const {
+
+  if (!blockClusterTreeNode.data().admissible) {
+    m_hMatrixDenseCompressor.compressBlock(blockClusterTreeNode, hMatrixData);
+    return;
+  }
+
+  const arma::Mat<ValueType> &rowMoments =
+      m_rowMoments[blockClusterTreeNode.data().rowClusterTreeNode->index()];
+  const arma::Mat<ValueType> &columnMoments =
+      m_columnMoments[blockClusterTreeNode.data()
+                          .columnClusterTreeNode->index()];
+
+  arma::Mat<ValueType> coupling;
+  m_interpolationDataAccessor.computeCouplingMatrix(blockClusterTreeNode,
+                                                    coupling);
+
+  shared_ptr<HMatrixLowRankData<ValueType>> lowRankData(
+      new HMatrixLowRankData<ValueType>());
+  lowRankData->A() = rowMoments.st() * coupling;
+  lowRankData->B() = columnMoments;
+  lowRankData->recompress(m_eps);
+
+  const std::size_t rows = rowMoments.n_cols;
+  const std::size_t columns = columnMoments.n_cols;
+  if (static_cast<std::size_t>(lowRankData->rank()) * (rows + columns) >=
+      rows * columns) {
+    // Dense storage is smaller
+    shared_ptr<HMatrixDenseData<ValueType>> denseData(
+        new HMatrixDenseData<ValueType>());
+    denseData->A() = lowRankData->A() * lowRankData->B();
+    hMatrixData = denseData;
+  } else
+    hMatrixData = lowRankData;
+}
+}
+
+#endif
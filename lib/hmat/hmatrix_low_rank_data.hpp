@@ -9,10 +9,25 @@
 
 namespace hmat {
 
+/** \brief Return op(A * B) * X for factors stored in single precision.
+ *
+ *  The products are formed in single precision and the result is returned
+ *  in \p ValueType, so that it can be accumulated at full precision. */
+template <typename ValueType>
+arma::Mat<ValueType> applySinglePrecisionFactors(
+    const arma::Mat<typename ScalarTraits<ValueType>::SinglePrecisionType> &A,
+    const arma::Mat<typename ScalarTraits<ValueType>::SinglePrecisionType> &B,
+    const arma::subview<ValueType> &X, TransposeMode trans);
+
 template <typename ValueType>
 class HMatrixLowRankData : public HMatrixData<ValueType> {
 
 public:
+  typedef typename ScalarTraits<ValueType>::SinglePrecisionType
+  SinglePrecisionType;
+
+  HMatrixLowRankData();
+
   void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
              TransposeMode trans, ValueType alpha, ValueType beta) const
       override;
@@ -21,6 +36,9 @@ public:
              TransposeMode trans, ValueType alpha, ValueType beta) const
       override;
 
+  /** \brief Factors at full precision.
+   *
+   *  Empty once the block has been converted to single precision. */
   const arma::Mat<ValueType> &A() const;
   arma::Mat<ValueType> &A();
 
@@ -35,9 +53,39 @@ public:
 
   double memSizeKb() const override;
 
+  /** \brief Reduce the rank of the block by SVD truncation.
+   *
+   *  Computes QR decompositions of \p A and of the conjugate transpose of
+   *  \p B, followed by an SVD of the small core matrix, and drops all
+   *  singular values whose combined contribution to the Frobenius norm of
+   *  the block is below \p eps times its norm. Returns the new rank.
+   *  Single precision blocks are recompressed at full precision and
+   *  converted back afterwards. */
+  int recompress(double eps);
+
+  /** \brief Convert the factors to single precision storage.
+   *
+   *  The full-precision factors are released. Afterwards apply() forms the
+   *  products with the factors in single precision and accumulates them in
+   *  \p ValueType. Does nothing if \p ValueType already is a single
+   *  precision type. */
+  void convertToSinglePrecision();
+
+  /** \brief Convert single precision factors back to \p ValueType. */
+  void convertToFullPrecision();
+
+  bool isSinglePrecision() const;
+
+  const arma::Mat<SinglePrecisionType> &singlePrecisionA() const;
+  const arma::Mat<SinglePrecisionType> &singlePrecisionB() const;
+
 private:
   arma::Mat<ValueType> m_A;
   arma::Mat<ValueType> m_B;
+
+  bool m_singlePrecision;
+  arma::Mat<SinglePrecisionType> m_singlePrecisionA;
+  arma::Mat<SinglePrecisionType> m_singlePrecisionB;
 };
 }
 
@@ -5,8 +5,37 @@
 
 #include "hmatrix_low_rank_data.hpp"
 
+#include <type_traits>
+
 namespace hmat {
 
+template <typename ValueType>
+arma::Mat<ValueType> applySinglePrecisionFactors(
+    const arma::Mat<typename ScalarTraits<ValueType>::SinglePrecisionType> &A,
+    const arma::Mat<typename ScalarTraits<ValueType>::SinglePrecisionType> &B,
+    const arma::subview<ValueType> &X, TransposeMode trans) {
+
+  typedef typename ScalarTraits<ValueType>::SinglePrecisionType
+  SinglePrecisionType;
+
+  arma::Mat<SinglePrecisionType> x =
+      arma::conv_to<arma::Mat<SinglePrecisionType>>::from(X);
+  arma::Mat<SinglePrecisionType> y;
+  if (trans == TransposeMode::NOTRANS)
+    y = A * (B * x);
+  else if (trans == TransposeMode::TRANS)
+    y = B.st() * (A.st() * x);
+  else if (trans == TransposeMode::CONJ)
+    y = arma::conj(A) * (arma::conj(B) * x);
+  else
+    y = B.t() * (A.t() * x);
+  return arma::conv_to<arma::Mat<ValueType>>::from(y);
+}
+
+template <typename ValueType>
+HMatrixLowRankData<ValueType>::HMatrixLowRankData()
+    : m_singlePrecision(false) {}
+
 template <typename ValueType>
 const arma::Mat<ValueType> &HMatrixLowRankData<ValueType>::A() const {
   return m_A;
@@ -28,26 +57,75 @@ arma::Mat<ValueType> &HMatrixLowRankData<ValueType>::B() {
 }
 
 template <typename ValueType> int HMatrixLowRankData<ValueType>::rows() const {
-  return m_A.n_rows;
+  return m_singlePrecision ? m_singlePrecisionA.n_rows : m_A.n_rows;
 }
 
 template <typename ValueType> int HMatrixLowRankData<ValueType>::cols() const {
 
-  return m_B.n_cols;
+  return m_singlePrecision ? m_singlePrecisionB.n_cols : m_B.n_cols;
 }
 
 template <typename ValueType> int HMatrixLowRankData<ValueType>::rank() const {
 
-  return m_A.n_cols;
+  return m_singlePrecision ? m_singlePrecisionA.n_cols : m_A.n_cols;
+}
+
+template <typename ValueType>
+void HMatrixLowRankData<ValueType>::convertToSinglePrecision() {
+
+  if (m_singlePrecision || std::is_same<ValueType, SinglePrecisionType>::value)
+    return;
+
+  m_singlePrecisionA = arma::conv_to<arma::Mat<SinglePrecisionType>>::from(m_A);
+  m_singlePrecisionB = arma::conv_to<arma::Mat<SinglePrecisionType>>::from(m_B);
+  m_A.reset();
+  m_B.reset();
+  m_singlePrecision = true;
+}
+
+template <typename ValueType>
+void HMatrixLowRankData<ValueType>::convertToFullPrecision() {
+
+  if (!m_singlePrecision)
+    return;
+
+  m_A = arma::conv_to<arma::Mat<ValueType>>::from(m_singlePrecisionA);
+  m_B = arma::conv_to<arma::Mat<ValueType>>::from(m_singlePrecisionB);
+  m_singlePrecisionA.reset();
+  m_singlePrecisionB.reset();
+  m_singlePrecision = false;
+}
+
+template <typename ValueType>
+bool HMatrixLowRankData<ValueType>::isSinglePrecision() const {
+  return m_singlePrecision;
+}
+
+template <typename ValueType>
+const arma::Mat<typename HMatrixLowRankData<ValueType>::SinglePrecisionType> &
+HMatrixLowRankData<ValueType>::singlePrecisionA() const {
+  return m_singlePrecisionA;
+}
+
+template <typename ValueType>
+const arma::Mat<typename HMatrixLowRankData<ValueType>::SinglePrecisionType> &
+HMatrixLowRankData<ValueType>::singlePrecisionB() const {
+  return m_singlePrecisionB;
 }
 
 template <typename ValueType>
 typename ScalarTraits<ValueType>::RealType
 HMatrixLowRankData<ValueType>::frobeniusNorm() const {
 
+  if (m_singlePrecision) {
+    HMatrixLowRankData<ValueType> fullPrecision(*this);
+    fullPrecision.convertToFullPrecision();
+    return fullPrecision.frobeniusNorm();
+  }
+
   auto aHa = m_A.t() * m_A;
 
-  arma::Mat<ValueType> result(1, 1);
+  arma::Mat<ValueType> result(1, 1, arma::fill::zeros);
 
   for (int i = 0; i < m_B.n_cols; ++i) {
     auto col = m_B.col(i);
@@ -60,10 +138,64 @@ HMatrixLowRankData<ValueType>::frobeniusNorm() const {
 template <typename ValueType>
 double HMatrixLowRankData<ValueType>::memSizeKb() const {
 
-  return sizeof(ValueType) * (this->rows() + this->cols()) * this->rank() /
+  std::size_t elementSize =
+      m_singlePrecision ? sizeof(SinglePrecisionType) : sizeof(ValueType);
+  return elementSize * (this->rows() + this->cols()) * this->rank() /
          (1.0 * 1024);
 }
 
+template <typename ValueType>
+int HMatrixLowRankData<ValueType>::recompress(double eps) {
+
+  if (m_singlePrecision) {
+    convertToFullPrecision();
+    int newRank = recompress(eps);
+    convertToSinglePrecision();
+    return newRank;
+  }
+
+  if (m_A.n_cols == 0)
+    return 0;
+
+  arma::Mat<ValueType> QA, RA, QB, RB;
+  arma::qr_econ(QA, RA, m_A);
+  arma::qr_econ(QB, RB, arma::Mat<ValueType>(m_B.t()));
+
+  // A * B = QA * (RA * RB^H) * QB^H
+  arma::Mat<ValueType> U, V;
+  arma::Col<typename ScalarTraits<ValueType>::RealType> sigma;
+  if (!arma::svd(U, sigma, V, arma::Mat<ValueType>(RA * RB.t())))
+    return m_A.n_cols; // Keep the original factors
+
+  // Find the smallest rank whose truncation error is below eps * norm
+  typename ScalarTraits<ValueType>::RealType total = arma::accu(sigma % sigma);
+  typename ScalarTraits<ValueType>::RealType tail = 0;
+  std::size_t newRank = sigma.n_rows;
+  while (newRank > 0) {
+    auto s = sigma(newRank - 1);
+    if (tail + s * s > eps * eps * total)
+      break;
+    tail += s * s;
+    --newRank;
+  }
+
+  if (newRank >= m_A.n_cols)
+    return m_A.n_cols;
+
+  if (newRank == 0) {
+    m_A.set_size(m_A.n_rows, 0);
+    m_B.set_size(0, m_B.n_cols);
+    return 0;
+  }
+
+  arma::Mat<ValueType> newA =
+      QA * U.cols(0, newRank - 1) * arma::diagmat(sigma.rows(0, newRank - 1));
+  arma::Mat<ValueType> newB = V.cols(0, newRank - 1).t() * QB.t();
+  m_A = newA;
+  m_B = newB;
+  return newRank;
+}
+
 template <typename ValueType>
 void HMatrixLowRankData<ValueType>::apply(const arma::Mat<ValueType> &X,
                                           arma::Mat<ValueType> &Y,
@@ -87,7 +219,11 @@ void HMatrixLowRankData<ValueType>::apply(const arma::subview<ValueType> &X,
     return;
   }
 
-  if (trans == TransposeMode::NOTRANS)
+  if (m_singlePrecision)
+    Y = alpha * applySinglePrecisionFactors(m_singlePrecisionA,
+                                            m_singlePrecisionB, X, trans) +
+        beta * Y;
+  else if (trans == TransposeMode::NOTRANS)
     Y = alpha * m_A * (m_B * X) + beta * Y;
   else if (trans == TransposeMode::TRANS)
     Y = alpha * m_B.st() * (m_A.st() * X) + beta * Y;
@@ -0,0 +1,83 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_LU_DECOMPOSITION_HPP
+#define HMAT_HMATRIX_LU_DECOMPOSITION_HPP
+
+#include "common.hpp"
+#include "hmatrix.hpp"
+#include "hmatrix_arithmetic.hpp"
+#include "hmatrix_dense_data.hpp"
+#include "hmatrix_low_rank_data.hpp"
+#include "cluster_tree.hpp"
+#include <armadillo>
+
+namespace hmat {
+
+/** \brief Hierarchical LU or Cholesky decomposition of an H-matrix.
+ *
+ *  The decomposition is computed block-recursively on a copy of the block
+ *  structure of the H-matrix. Off-diagonal blocks are obtained by
+ *  hierarchical triangular solves, and the Schur complement updates use
+ *  the formatted H-matrix multiplication and addition of
+ *  HMatrixArithmetic, in which every low-rank result is truncated by SVD
+ *  to the relative accuracy \p eps. Dense diagonal leaves are factorized
+ *  with partial pivoting.
+ *
+ *  If \p symmetric is true the matrix must be Hermitian positive definite,
+ *  and the Cholesky factorization \f$A = LL^H\f$ is computed instead. Only
+ *  the lower triangle of the block structure is then kept.
+ *
+ *  The row and column cluster trees of the H-matrix must be identical,
+ *  which is the case if the test and trial spaces are equal. */
+template <typename ValueType, int N>
+class HMatrixLuDecomposition : private HMatrixArithmetic<ValueType, N> {
+public:
+  HMatrixLuDecomposition(const HMatrix<ValueType, N> &hMatrix, double eps,
+                         bool symmetric = false, int maxThreadCount = -1);
+
+  std::size_t rows() const;
+  std::size_t columns() const;
+  bool isSymmetric() const;
+  double memSizeKb() const;
+
+  /** \brief Solve op(A) X = B with B and X in original DOF ordering. */
+  void solve(const arma::Mat<ValueType> &B, arma::Mat<ValueType> &X,
+             TransposeMode trans = NOTRANS) const;
+
+  /** \brief Overwrite \p X, given in H-matrix DOF ordering, with
+   *  op(A)^{-1} X. */
+  void solvePermuted(arma::Mat<ValueType> &X,
+                     TransposeMode trans = NOTRANS) const;
+
+private:
+  typedef HMatrixArithmetic<ValueType, N> Arithmetic;
+  typedef typename Arithmetic::Block Block;
+  using Arithmetic::copyBlock;
+  using Arithmetic::applyBlock;
+  using Arithmetic::multiplyAdd;
+
+  enum Triangle {
+    LOWER,
+    UPPER
+  };
+
+  const Block &factorBlock(const Block &d, Triangle triangle, int i, int j,
+                           bool &conjTrans) const;
+  void solveDense(const Block &d, Triangle triangle, bool conjTrans,
+                  arma::Mat<ValueType> &X) const;
+  void solveLeft(const Block &d, Triangle triangle, Block &t) const;
+  void solveRight(const Block &d, Triangle triangle, Block &t) const;
+  void factorize(Block &d) const;
+
+  double memSizeKbImpl(const Block &block) const;
+
+  bool m_symmetric;
+  shared_ptr<const ClusterTree<N>> m_rowClusterTree;
+  shared_ptr<const ClusterTree<N>> m_columnClusterTree;
+  shared_ptr<Block> m_root;
+};
+}
+
+#include "hmatrix_lu_decomposition_impl.hpp"
+
+#endif
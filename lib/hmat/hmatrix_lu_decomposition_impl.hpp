@@ -0,0 +1,327 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_LU_DECOMPOSITION_IMPL_HPP
+#define HMAT_HMATRIX_LU_DECOMPOSITION_IMPL_HPP
+
+#include "hmatrix_lu_decomposition.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+HMatrixLuDecomposition<ValueType, N>::HMatrixLuDecomposition(
+    const HMatrix<ValueType, N> &hMatrix, double eps, bool symmetric,
+    int maxThreadCount)
+    : HMatrixArithmetic<ValueType, N>(eps), m_symmetric(symmetric),
+      m_rowClusterTree(hMatrix.blockClusterTree()->rowClusterTree()),
+      m_columnClusterTree(hMatrix.blockClusterTree()->columnClusterTree()) {
+
+  if (hMatrix.rows() != hMatrix.columns())
+    throw std::invalid_argument("HMatrixLuDecomposition::"
+                                "HMatrixLuDecomposition(): "
+                                "H-matrix must be square.");
+  if (!hMatrix.isInitialized() || hMatrix.isFrozen())
+    throw std::invalid_argument("HMatrixLuDecomposition::"
+                                "HMatrixLuDecomposition(): "
+                                "H-matrix must be initialized and not "
+                                "frozen.");
+
+  m_root = copyBlock(hMatrix, hMatrix.blockClusterTree()->root());
+
+  Fiber::executeInTaskArena(maxThreadCount, [&] { factorize(*m_root); });
+}
+
+template <typename ValueType, int N>
+std::size_t HMatrixLuDecomposition<ValueType, N>::rows() const {
+  return m_rowClusterTree->numberOfDofs();
+}
+
+template <typename ValueType, int N>
+std::size_t HMatrixLuDecomposition<ValueType, N>::columns() const {
+  return m_columnClusterTree->numberOfDofs();
+}
+
+template <typename ValueType, int N>
+bool HMatrixLuDecomposition<ValueType, N>::isSymmetric() const {
+  return m_symmetric;
+}
+
+template <typename ValueType, int N>
+double HMatrixLuDecomposition<ValueType, N>::memSizeKb() const {
+  return memSizeKbImpl(*m_root);
+}
+
+template <typename ValueType, int N>
+void HMatrixLuDecomposition<ValueType, N>::solve(
+    const arma::Mat<ValueType> &B, arma::Mat<ValueType> &X,
+    TransposeMode trans) const {
+
+  if (B.n_rows != rows())
+    throw std::invalid_argument("HMatrixLuDecomposition::solve(): "
+                                "Right-hand side has wrong number of rows.");
+
+  bool transposed = (trans == TRANS || trans == CONJTRANS);
+  const auto &inputTree = transposed ? m_columnClusterTree : m_rowClusterTree;
+  const auto &outputTree =
+      transposed ? m_rowClusterTree : m_columnClusterTree;
+
+  arma::Mat<ValueType> permuted(B.n_rows, B.n_cols);
+  const auto &hMatDofToOriginalDofMap = inputTree->hMatDofToOriginalDofMap();
+  for (std::size_t j = 0; j < B.n_cols; ++j)
+    for (std::size_t i = 0; i < B.n_rows; ++i)
+      permuted(i, j) = B(hMatDofToOriginalDofMap[i], j);
+
+  solvePermuted(permuted, trans);
+
+  X.set_size(B.n_rows, B.n_cols);
+  const auto &originalDofToHMatDofMap = outputTree->originalDofToHMatDofMap();
+  for (std::size_t j = 0; j < B.n_cols; ++j)
+    for (std::size_t i = 0; i < B.n_rows; ++i)
+      X(i, j) = permuted(originalDofToHMatDofMap[i], j);
+}
+
+template <typename ValueType, int N>
+void HMatrixLuDecomposition<ValueType, N>::solvePermuted(
+    arma::Mat<ValueType> &X, TransposeMode trans) const {
+
+  if (X.n_rows != rows())
+    throw std::invalid_argument("HMatrixLuDecomposition::solvePermuted(): "
+                                "Input matrix has wrong number of rows.");
+
+  // A = L * U, so A^{-1} = U^{-1} L^{-1} and A^{-H} = L^{-H} U^{-H}.
+  // The (non-conjugated) transpose is reduced to the conjugate transpose.
+  if (trans == CONJ || trans == TRANS)
+    X = arma::conj(X);
+  if (trans == NOTRANS || trans == CONJ) {
+    solveDense(*m_root, LOWER, false, X);
+    solveDense(*m_root, UPPER, false, X);
+  } else {
+    solveDense(*m_root, UPPER, true, X);
+    solveDense(*m_root, LOWER, true, X);
+  }
+  if (trans == CONJ || trans == TRANS)
+    X = arma::conj(X);
+}
+
+template <typename ValueType, int N>
+const typename HMatrixLuDecomposition<ValueType, N>::Block &
+HMatrixLuDecomposition<ValueType, N>::factorBlock(const Block &d,
+                                                  Triangle triangle, int i,
+                                                  int j,
+                                                  bool &conjTrans) const {
+
+  // For Cholesky factors the upper triangle is U = L^H
+  conjTrans = (triangle == UPPER && i < j && m_symmetric);
+  return conjTrans ? *d.children[N * j + i] : *d.children[N * i + j];
+}
+
+template <typename ValueType, int N>
+void HMatrixLuDecomposition<ValueType, N>::solveDense(
+    const Block &d, Triangle triangle, bool conjTrans,
+    arma::Mat<ValueType> &X) const {
+
+  // X := op(T)^{-1} X, where T is the lower or upper factor of d
+
+  if (d.children.empty()) {
+    if (triangle == LOWER) {
+      if (!conjTrans) {
+        if (!d.pivots.is_empty())
+          X = d.pivots * X;
+        X = arma::solve(arma::trimatl(d.lower), X);
+      } else {
+        X = arma::solve(arma::trimatu(d.lower.t()), X);
+        if (!d.pivots.is_empty())
+          X = d.pivots.t() * X;
+      }
+    } else {
+      if (!conjTrans)
+        X = arma::solve(arma::trimatu(d.upper), X);
+      else
+        X = arma::solve(arma::trimatl(d.upper.t()), X);
+    }
+    return;
+  }
+
+  // Block forward or backward substitution
+  const bool forward = ((triangle == LOWER) != conjTrans);
+  const std::size_t offset = d.rowRange[0];
+  for (int step = 0; step < N; ++step) {
+    int i = forward ? step : N - 1 - step;
+    const IndexRangeType &rangeI = d.children[N * i + i]->rowRange;
+    arma::Mat<ValueType> Xi =
+        X.rows(rangeI[0] - offset, rangeI[1] - 1 - offset);
+    for (int previous = 0; previous < step; ++previous) {
+      int k = forward ? previous : N - 1 - previous;
+      bool blockConjTrans;
+      const Block &b = conjTrans ? factorBlock(d, triangle, k, i, blockConjTrans)
+                                 : factorBlock(d, triangle, i, k, blockConjTrans);
+      const IndexRangeType &rangeK = d.children[N * k + k]->rowRange;
+      applyBlock(b, blockConjTrans != conjTrans,
+                 X.rows(rangeK[0] - offset, rangeK[1] - 1 - offset), Xi, -1);
+    }
+    solveDense(*d.children[N * i + i], triangle, conjTrans, Xi);
+    X.rows(rangeI[0] - offset, rangeI[1] - 1 - offset) = Xi;
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrixLuDecomposition<ValueType, N>::solveLeft(const Block &d,
+                                                     Triangle triangle,
+                                                     Block &t) const {
+
+  // t := T^{-1} t
+
+  if (t.lowRank) {
+    if (t.lowRank->rank() > 0)
+      solveDense(d, triangle, false, t.lowRank->A());
+    return;
+  }
+  if (t.dense) {
+    solveDense(d, triangle, false, t.dense->A());
+    return;
+  }
+  if (d.children.empty())
+    throw std::runtime_error("HMatrixLuDecomposition::solveLeft(): "
+                             "Inconsistent block structure.");
+
+  const bool forward = (triangle == LOWER);
+  tbb::parallel_for(0, N, [&](int j) {
+    for (int step = 0; step < N; ++step) {
+      int i = forward ? step : N - 1 - step;
+      for (int previous = 0; previous < step; ++previous) {
+        int k = forward ? previous : N - 1 - previous;
+        bool conjTrans;
+        const Block &b = factorBlock(d, triangle, i, k, conjTrans);
+        multiplyAdd(*t.children[N * i + j], b, conjTrans,
+                    *t.children[N * k + j], false, -1);
+      }
+      solveLeft(*d.children[N * i + i], triangle, *t.children[N * i + j]);
+    }
+  });
+}
+
+template <typename ValueType, int N>
+void HMatrixLuDecomposition<ValueType, N>::solveRight(const Block &d,
+                                                      Triangle triangle,
+                                                      Block &t) const {
+
+  // t := t * T^{-1}, i.e. t^H := T^{-H} * t^H
+
+  if (t.lowRank) {
+    if (t.lowRank->rank() > 0) {
+      arma::Mat<ValueType> BH = t.lowRank->B().t();
+      solveDense(d, triangle, true, BH);
+      t.lowRank->B() = BH.t();
+    }
+    return;
+  }
+  if (t.dense) {
+    arma::Mat<ValueType> MH = t.dense->A().t();
+    solveDense(d, triangle, true, MH);
+    t.dense->A() = MH.t();
+    return;
+  }
+  if (d.children.empty())
+    throw std::runtime_error("HMatrixLuDecomposition::solveRight(): "
+                             "Inconsistent block structure.");
+
+  const bool forward = (triangle == UPPER);
+  tbb::parallel_for(0, N, [&](int i) {
+    for (int step = 0; step < N; ++step) {
+      int j = forward ? step : N - 1 - step;
+      for (int previous = 0; previous < step; ++previous) {
+        int k = forward ? previous : N - 1 - previous;
+        bool conjTrans;
+        const Block &b = factorBlock(d, triangle, k, j, conjTrans);
+        multiplyAdd(*t.children[N * i + j], *t.children[N * i + k], false, b,
+                    conjTrans, -1);
+      }
+      solveRight(*d.children[N * j + j], triangle, *t.children[N * i + j]);
+    }
+  });
+}
+
+template <typename ValueType, int N>
+void HMatrixLuDecomposition<ValueType, N>::factorize(Block &d) const {
+
+  if (d.rowRange != d.columnRange)
+    throw std::runtime_error("HMatrixLuDecomposition::factorize(): "
+                             "Row and column cluster trees differ.");
+
+  if (d.lowRank)
+    throw std::runtime_error("HMatrixLuDecomposition::factorize(): "
+                             "Diagonal block is low-rank.");
+
+  if (d.dense) {
+    if (m_symmetric) {
+      if (!arma::chol(d.upper, d.dense->A()))
+        throw std::runtime_error("HMatrixLuDecomposition::factorize(): "
+                                 "Cholesky factorization failed. The matrix "
+                                 "is not positive definite.");
+      d.lower = d.upper.t();
+    } else {
+      if (!arma::lu(d.lower, d.upper, d.pivots, d.dense->A()))
+        throw std::runtime_error("HMatrixLuDecomposition::factorize(): "
+                                 "LU factorization failed.");
+    }
+    d.dense.reset();
+    return;
+  }
+
+  // Only the lower triangle is needed for Cholesky factors
+  if (m_symmetric)
+    for (int i = 0; i < N; ++i)
+      for (int j = i + 1; j < N; ++j)
+        d.children[N * i + j].reset();
+
+  for (int k = 0; k < N; ++k) {
+    Block &diagonal = *d.children[N * k + k];
+    factorize(diagonal);
+
+    // U_kj = L_kk^{-1} A_kj and L_ik = A_ik U_kk^{-1}
+    if (!m_symmetric)
+      tbb::parallel_for(k + 1, N, [&](int j) {
+        solveLeft(diagonal, LOWER, *d.children[N * k + j]);
+      });
+    tbb::parallel_for(k + 1, N, [&](int i) {
+      solveRight(diagonal, UPPER, *d.children[N * i + k]);
+    });
+
+    // Schur complement A_ij -= L_ik U_kj
+    const int remaining = N - k - 1;
+    tbb::parallel_for(0, remaining * remaining, [&](int index) {
+      int i = k + 1 + index / remaining;
+      int j = k + 1 + index % remaining;
+      if (m_symmetric) {
+        if (j <= i)
+          multiplyAdd(*d.children[N * i + j], *d.children[N * i + k], false,
+                      *d.children[N * j + k], true, -1);
+      } else
+        multiplyAdd(*d.children[N * i + j], *d.children[N * i + k], false,
+                    *d.children[N * k + j], false, -1);
+    });
+  }
+}
+
+template <typename ValueType, int N>
+double
+HMatrixLuDecomposition<ValueType, N>::memSizeKbImpl(const Block &block) const {
+
+  double result = sizeof(ValueType) *
+                  (block.lower.n_elem + block.upper.n_elem) / (1.0 * 1024);
+  if (block.dense)
+    result += block.dense->memSizeKb();
+  if (block.lowRank)
+    result += block.lowRank->memSizeKb();
+  for (const auto &c : block.children)
+    if (c)
+      result += memSizeKbImpl(*c);
+  return result;
+}
+}
+
+#endif
@@ -0,0 +1,78 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_SKETCHING_COMPRESSOR_HPP
+#define HMAT_HMATRIX_SKETCHING_COMPRESSOR_HPP
+
+#include "common.hpp"
+#include "block_cluster_tree.hpp"
+#include "hmatrix_compressor.hpp"
+#include "matvec_accessor.hpp"
+#include <vector>
+
+namespace hmat {
+
+/** \brief Construction of an H-matrix from products with random vectors.
+ *
+ *  The constructor recovers all leaves of \p blockClusterTree by peeling,
+ *  level by level from the root, using only the products of
+ *  MatVecAccessor. The contributions of the leaves found on coarser levels
+ *  are subtracted from every product. The blocks of a level are coloured so
+ *  that the blocks probed together do not share a row (column) cluster
+ *  neighbouring another probed column (row) cluster, so each of them can
+ *  be read off the product of one block of vectors:
+ *
+ *  - an admissible leaf (t, s) is sampled with \p sampleCount random
+ *    vectors supported on s. This gives an orthonormal basis Q of its
+ *    range, and a product of the adjoint with Q supported on t gives
+ *    B = Q^H A_ts. The factors are recompressed to the relative accuracy
+ *    \p eps and stored densely if that is smaller;
+ *  - an inadmissible leaf is sampled with the unit vectors of s.
+ *
+ *  The number of products grows with the number of colours of every level,
+ *  i.e. with the sparsity of the block cluster tree, and with the depth of
+ *  the tree, but not with the number of blocks. The block ranks are
+ *  limited by \p sampleCount, which should exceed the expected ranks by a
+ *  few oversampling vectors. compressBlock() returns the stored leaf data,
+ *  so the compressor can initialize one H-matrix on \p blockClusterTree. */
+template <typename ValueType, int N>
+class HMatrixSketchingCompressor : public HMatrixCompressor<ValueType, N> {
+public:
+  HMatrixSketchingCompressor(const BlockClusterTree<N> &blockClusterTree,
+                             const MatVecAccessor<ValueType> &matVecAccessor,
+                             int sampleCount, double eps);
+
+  void compressBlock(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                     shared_ptr<HMatrixData<ValueType>> &hMatrixData) const
+      override;
+
+  /** \brief Number of products with blocks of vectors done by the
+   *  constructor. */
+  std::size_t numberOfMatVecs() const;
+
+private:
+  void colourBlocks(const std::vector<std::size_t> &blocks,
+                    const std::vector<std::size_t> &levelBlocks,
+                    RowColSelector side, bool shareProbes,
+                    std::vector<std::vector<std::size_t>> &groups) const;
+  void applyRemainder(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+                      TransposeMode trans);
+  void sampleDenseBlocks(const std::vector<std::size_t> &blocks,
+                         const std::vector<std::size_t> &levelBlocks);
+  void sampleLowRankBlocks(const std::vector<std::size_t> &blocks,
+                           const std::vector<std::size_t> &levelBlocks);
+
+  const BlockClusterTree<N> &m_blockClusterTree;
+  const MatVecAccessor<ValueType> &m_matVecAccessor;
+  int m_sampleCount;
+  double m_eps;
+  std::size_t m_numberOfMatVecs;
+  // Leaf data indexed by the block cluster tree node numbers
+  std::vector<shared_ptr<HMatrixData<ValueType>>> m_leafData;
+  // Leaves already recovered, whose products are subtracted
+  std::vector<std::size_t> m_knownLeaves;
+};
+}
+
+#include "hmatrix_sketching_compressor_impl.hpp"
+
+#endif
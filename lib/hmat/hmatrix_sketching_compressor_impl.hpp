@@ -0,0 +1,307 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_SKETCHING_COMPRESSOR_IMPL_HPP
+#define HMAT_HMATRIX_SKETCHING_COMPRESSOR_IMPL_HPP
+
+#include "hmatrix_sketching_compressor.hpp"
+#include "hmatrix_dense_data.hpp"
+#include "hmatrix_low_rank_data.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+HMatrixSketchingCompressor<ValueType, N>::HMatrixSketchingCompressor(
+    const BlockClusterTree<N> &blockClusterTree,
+    const MatVecAccessor<ValueType> &matVecAccessor, int sampleCount,
+    double eps)
+    : m_blockClusterTree(blockClusterTree), m_matVecAccessor(matVecAccessor),
+      m_sampleCount(sampleCount), m_eps(eps), m_numberOfMatVecs(0) {
+
+  if (sampleCount < 1)
+    throw std::invalid_argument("HMatrixSketchingCompressor::"
+                                "HMatrixSketchingCompressor(): "
+                                "sampleCount must be positive");
+
+  const auto &treeIndex = blockClusterTree.treeIndex();
+  m_leafData.resize(treeIndex.numberOfNodes());
+
+  std::vector<std::vector<std::size_t>> levels;
+  for (std::size_t i = 0; i < treeIndex.numberOfNodes(); ++i) {
+    const std::size_t level = treeIndex.level(i);
+    if (level >= levels.size())
+      levels.resize(level + 1);
+    levels[level].push_back(i);
+  }
+
+  for (const auto &levelBlocks : levels) {
+    std::vector<std::size_t> denseBlocks, lowRankBlocks;
+    for (std::size_t block : levelBlocks)
+      if (treeIndex.isLeaf(block)) {
+        if (treeIndex.node(block).data().admissible)
+          lowRankBlocks.push_back(block);
+        else
+          denseBlocks.push_back(block);
+      }
+    sampleDenseBlocks(denseBlocks, levelBlocks);
+    sampleLowRankBlocks(lowRankBlocks, levelBlocks);
+    m_knownLeaves.insert(m_knownLeaves.end(), denseBlocks.begin(),
+                         denseBlocks.end());
+    m_knownLeaves.insert(m_knownLeaves.end(), lowRankBlocks.begin(),
+                         lowRankBlocks.end());
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrixSketchingCompressor<ValueType, N>::compressBlock(
+    const BlockClusterTreeNode<N> &blockClusterTreeNode,
+    shared_ptr<HMatrixData<ValueType>> &hMatrixData) const {
+  hMatrixData = m_leafData[blockClusterTreeNode.index()];
+  if (!hMatrixData)
+    throw std::invalid_argument(
+        "HMatrixSketchingCompressor::compressBlock(): "
+        "block is not a leaf of the block cluster tree");
+}
+
+template <typename ValueType, int N>
+std::size_t HMatrixSketchingCompressor<ValueType, N>::numberOfMatVecs() const {
+  return m_numberOfMatVecs;
+}
+
+template <typename ValueType, int N>
+void HMatrixSketchingCompressor<ValueType, N>::colourBlocks(
+    const std::vector<std::size_t> &blocks,
+    const std::vector<std::size_t> &levelBlocks, RowColSelector side,
+    bool shareProbes, std::vector<std::vector<std::size_t>> &groups) const {
+
+  // A probe supported on the cluster of \p side of a block reaches all
+  // clusters of the other side that form a block of this level with it.
+  // These blocks are not known yet, so two probes reaching the same
+  // cluster must get different colours.
+  const auto &treeIndex = m_blockClusterTree.treeIndex();
+  auto probedCluster = [&](std::size_t block) {
+    const auto &data = treeIndex.node(block).data();
+    return side == ROW ? data.rowClusterTreeNode->index()
+                       : data.columnClusterTreeNode->index();
+  };
+  auto reachedCluster = [&](std::size_t block) {
+    const auto &data = treeIndex.node(block).data();
+    return side == ROW ? data.columnClusterTreeNode->index()
+                       : data.rowClusterTreeNode->index();
+  };
+
+  std::unordered_map<std::size_t, std::vector<std::size_t>> reached;
+  for (std::size_t block : levelBlocks)
+    reached[probedCluster(block)].push_back(reachedCluster(block));
+
+  std::unordered_map<std::size_t, std::vector<bool>> usedColours;
+  std::unordered_map<std::size_t, std::size_t> probeColours;
+  groups.clear();
+  for (std::size_t block : blocks) {
+    const std::size_t probe = probedCluster(block);
+    auto it = probeColours.find(probe);
+    std::size_t colour = 0;
+    if (shareProbes && it != probeColours.end())
+      colour = it->second;
+    else {
+      const std::vector<std::size_t> &clusters = reached[probe];
+      for (;; ++colour) {
+        bool free = true;
+        for (std::size_t cluster : clusters) {
+          const std::vector<bool> &used = usedColours[cluster];
+          if (colour < used.size() && used[colour]) {
+            free = false;
+            break;
+          }
+        }
+        if (free)
+          break;
+      }
+      for (std::size_t cluster : clusters) {
+        std::vector<bool> &used = usedColours[cluster];
+        if (colour >= used.size())
+          used.resize(colour + 1, false);
+        used[colour] = true;
+      }
+      probeColours[probe] = colour;
+    }
+    if (colour >= groups.size())
+      groups.resize(colour + 1);
+    groups[colour].push_back(block);
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrixSketchingCompressor<ValueType, N>::applyRemainder(
+    const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+    TransposeMode trans) {
+
+  m_matVecAccessor.apply(X, Y, trans);
+  ++m_numberOfMatVecs;
+
+  // Rows of X that are not zero, as prefix sums for range queries
+  std::vector<std::size_t> support(X.n_rows + 1, 0);
+  for (std::size_t i = 0; i < X.n_rows; ++i) {
+    bool nonZero = false;
+    for (std::size_t j = 0; j < X.n_cols && !nonZero; ++j)
+      nonZero = X(i, j) != ValueType(0);
+    support[i + 1] = support[i] + (nonZero ? 1 : 0);
+  }
+
+  const auto &treeIndex = m_blockClusterTree.treeIndex();
+  for (std::size_t leaf : m_knownLeaves) {
+    const auto &data = treeIndex.node(leaf).data();
+    const IndexRangeType &rowRange = data.rowClusterTreeNode->data().indexRange;
+    const IndexRangeType &columnRange =
+        data.columnClusterTreeNode->data().indexRange;
+    const IndexRangeType &inputRange =
+        trans == NOTRANS ? columnRange : rowRange;
+    const IndexRangeType &outputRange =
+        trans == NOTRANS ? rowRange : columnRange;
+    if (support[inputRange[1]] == support[inputRange[0]])
+      continue;
+    const arma::subview<ValueType> xData =
+        X.rows(inputRange[0], inputRange[1] - 1);
+    arma::subview<ValueType> yData = Y.rows(outputRange[0], outputRange[1] - 1);
+    m_leafData[leaf]->apply(xData, yData, trans, ValueType(-1), 1);
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrixSketchingCompressor<ValueType, N>::sampleDenseBlocks(
+    const std::vector<std::size_t> &blocks,
+    const std::vector<std::size_t> &levelBlocks) {
+
+  std::vector<std::vector<std::size_t>> groups;
+  colourBlocks(blocks, levelBlocks, COL, true, groups);
+
+  const auto &treeIndex = m_blockClusterTree.treeIndex();
+  for (const auto &group : groups) {
+    std::size_t width = 0;
+    for (std::size_t block : group) {
+      const IndexRangeType &columnRange =
+          treeIndex.node(block).data().columnClusterTreeNode->data().indexRange;
+      width = std::max(width, columnRange[1] - columnRange[0]);
+    }
+
+    arma::Mat<ValueType> X(m_blockClusterTree.columns(), width,
+                           arma::fill::zeros);
+    for (std::size_t block : group) {
+      const IndexRangeType &columnRange =
+          treeIndex.node(block).data().columnClusterTreeNode->data().indexRange;
+      for (std::size_t j = columnRange[0]; j < columnRange[1]; ++j)
+        X(j, j - columnRange[0]) = 1;
+    }
+    arma::Mat<ValueType> Y;
+    applyRemainder(X, Y, NOTRANS);
+
+    for (std::size_t block : group) {
+      const auto &data = treeIndex.node(block).data();
+      const IndexRangeType &rowRange =
+          data.rowClusterTreeNode->data().indexRange;
+      const IndexRangeType &columnRange =
+          data.columnClusterTreeNode->data().indexRange;
+      shared_ptr<HMatrixDenseData<ValueType>> denseData(
+          new HMatrixDenseData<ValueType>());
+      denseData->A() = Y.submat(rowRange[0], 0, rowRange[1] - 1,
+                                columnRange[1] - columnRange[0] - 1);
+      m_leafData[block] = denseData;
+    }
+  }
+}
+
+template <typename ValueType, int N>
+void HMatrixSketchingCompressor<ValueType, N>::sampleLowRankBlocks(
+    const std::vector<std::size_t> &blocks,
+    const std::vector<std::size_t> &levelBlocks) {
+
+  const auto &treeIndex = m_blockClusterTree.treeIndex();
+
+  // Range bases Q of all blocks from random probes of their columns
+  std::vector<std::vector<std::size_t>> groups;
+  colourBlocks(blocks, levelBlocks, COL, true, groups);
+  std::unordered_map<std::size_t, arma::Mat<ValueType>> bases;
+  for (const auto &group : groups) {
+    arma::Mat<ValueType> X(m_blockClusterTree.columns(), m_sampleCount,
+                           arma::fill::zeros);
+    std::vector<std::size_t> probedClusters;
+    for (std::size_t block : group) {
+      const auto &columnCluster =
+          *treeIndex.node(block).data().columnClusterTreeNode;
+      // Blocks sharing the column cluster share the probe
+      if (std::find(probedClusters.begin(), probedClusters.end(),
+                    columnCluster.index()) != probedClusters.end())
+        continue;
+      probedClusters.push_back(columnCluster.index());
+      const IndexRangeType &columnRange = columnCluster.data().indexRange;
+      arma::Mat<ValueType> probe(columnRange[1] - columnRange[0],
+                                 m_sampleCount);
+      probe.randn();
+      X.rows(columnRange[0], columnRange[1] - 1) = probe;
+    }
+    arma::Mat<ValueType> Y;
+    applyRemainder(X, Y, NOTRANS);
+
+    for (std::size_t block : group) {
+      const IndexRangeType &rowRange =
+          treeIndex.node(block).data().rowClusterTreeNode->data().indexRange;
+      arma::Mat<ValueType> Q, R;
+      arma::qr_econ(Q, R, Y.rows(rowRange[0], rowRange[1] - 1));
+      bases[block].swap(Q);
+    }
+  }
+
+  // B = Q^H A_ts from adjoint products with the bases; blocks sharing the
+  // row cluster have different bases and are probed separately
+  colourBlocks(blocks, levelBlocks, ROW, false, groups);
+  for (const auto &group : groups) {
+    std::size_t width = 0;
+    for (std::size_t block : group)
+      width = std::max<std::size_t>(width, bases[block].n_cols);
+
+    arma::Mat<ValueType> X(m_blockClusterTree.rows(), width,
+                           arma::fill::zeros);
+    for (std::size_t block : group) {
+      const IndexRangeType &rowRange =
+          treeIndex.node(block).data().rowClusterTreeNode->data().indexRange;
+      const arma::Mat<ValueType> &Q = bases[block];
+      X.submat(rowRange[0], 0, rowRange[1] - 1, Q.n_cols - 1) = Q;
+    }
+    arma::Mat<ValueType> Z;
+    applyRemainder(X, Z, CONJTRANS);
+
+    for (std::size_t block : group) {
+      const auto &data = treeIndex.node(block).data();
+      const IndexRangeType &rowRange =
+          data.rowClusterTreeNode->data().indexRange;
+      const IndexRangeType &columnRange =
+          data.columnClusterTreeNode->data().indexRange;
+      arma::Mat<ValueType> &Q = bases[block];
+
+      shared_ptr<HMatrixLowRankData<ValueType>> lowRankData(
+          new HMatrixLowRankData<ValueType>());
+      lowRankData->B() =
+          Z.submat(columnRange[0], 0, columnRange[1] - 1, Q.n_cols - 1).t();
+      lowRankData->A().swap(Q);
+      lowRankData->recompress(m_eps);
+
+      const std::size_t rows = rowRange[1] - rowRange[0];
+      const std::size_t columns = columnRange[1] - columnRange[0];
+      if (static_cast<std::size_t>(lowRankData->rank()) * (rows + columns) >=
+          rows * columns) {
+        // Dense storage is smaller
+        shared_ptr<HMatrixDenseData<ValueType>> denseData(
+            new HMatrixDenseData<ValueType>());
+        denseData->A() = lowRankData->A() * lowRankData->B();
+        m_leafData[block] = denseData;
+      } else
+        m_leafData[block] = lowRankData;
+    }
+  }
+}
+}
+
+#endif
@@ -0,0 +1,134 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HMATRIX_STATISTICS_HPP
+#define HMAT_HMATRIX_STATISTICS_HPP
+
+#include "common.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace hmat {
+
+/** \brief Description of a single leaf of an H-matrix. */
+struct HMatrixBlockStatistics {
+  IndexRangeType rowRange;    // in H-matrix DOF ordering
+  IndexRangeType columnRange; // in H-matrix DOF ordering
+  std::size_t level;          // depth in the block cluster tree
+  bool admissible;
+  bool lowRank;
+  std::size_t rank; // 0 for dense blocks
+  double memSizeKb;
+  double assemblyTime; // seconds spent in the compressor, 0 if unknown
+};
+
+/** \brief Totals of all leaves on one level of the block cluster tree. */
+struct HMatrixLevelStatistics {
+  std::size_t numberOfDenseBlocks;
+  std::size_t numberOfLowRankBlocks;
+  double memSizeKb;
+};
+
+/** \brief Block structure and storage of an H-matrix.
+ *
+ *  Returned by HMatrix::statistics(). Only the leaves stored by the matrix
+ *  are counted, i.e. for one part of a distributed H-matrix only the
+ *  leaves of that part. */
+struct HMatrixStatistics {
+  std::size_t rows;
+  std::size_t columns;
+  std::size_t numberOfDenseBlocks;
+  std::size_t numberOfLowRankBlocks;
+  std::size_t maxRank;
+
+  // rankHistogram[k] is the number of low-rank blocks of rank k
+  std::vector<std::size_t> rankHistogram;
+  std::vector<HMatrixLevelStatistics> levels;
+  std::vector<HMatrixBlockStatistics> blocks;
+
+  double memSizeKb;
+  double denseMemSizeKb; // memory of the uncompressed matrix
+  double assemblyTime;   // sum of the compression times of all blocks
+
+  // Number of matrix entries evaluated during the assembly. The H-matrix
+  // does not know it; it is set by the assembler, and 0 if unknown.
+  std::size_t accessedEntryCount;
+
+  double compressionRatio() const {
+    return denseMemSizeKb > 0 ? memSizeKb / denseMemSizeKb : 0;
+  }
+
+  double accessedEntryFraction() const {
+    return (rows > 0 && columns > 0)
+               ? double(accessedEntryCount) / (double(rows) * columns)
+               : 0;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const HMatrixStatistics &statistics) {
+  os << "H-matrix " << statistics.rows << " x " << statistics.columns << ": "
+     << statistics.numberOfDenseBlocks << " dense and "
+     << statistics.numberOfLowRankBlocks
+     << " low-rank blocks, maximum rank: " << statistics.maxRank
+     << ", memory: " << statistics.memSizeKb << " KB ("
+     << 100. * statistics.compressionRatio() << "% of dense)";
+  if (statistics.accessedEntryCount > 0)
+    os << ", accessed entries: " << 100. * statistics.accessedEntryFraction()
+       << "%";
+  os << ", assembly time: " << statistics.assemblyTime << " s";
+  return os;
+}
+
+/** \brief Write the statistics as a JSON object. */
+inline void writeJson(std::ostream &os, const HMatrixStatistics &statistics) {
+  os << "{\n"
+     << "  \"rows\": " << statistics.rows << ",\n"
+     << "  \"columns\": " << statistics.columns << ",\n"
+     << "  \"numberOfDenseBlocks\": " << statistics.numberOfDenseBlocks
+     << ",\n"
+     << "  \"numberOfLowRankBlocks\": " << statistics.numberOfLowRankBlocks
+     << ",\n"
+     << "  \"maxRank\": " << statistics.maxRank << ",\n"
+     << "  \"memSizeKb\": " << statistics.memSizeKb << ",\n"
+     << "  \"denseMemSizeKb\": " << statistics.denseMemSizeKb << ",\n"
+     << "  \"compressionRatio\": " << statistics.compressionRatio() << ",\n"
+     << "  \"accessedEntryCount\": " << statistics.accessedEntryCount << ",\n"
+     << "  \"accessedEntryFraction\": " << statistics.accessedEntryFraction()
+     << ",\n"
+     << "  \"assemblyTime\": " << statistics.assemblyTime << ",\n";
+
+  os << "  \"rankHistogram\": [";
+  for (std::size_t k = 0; k < statistics.rankHistogram.size(); ++k)
+    os << (k > 0 ? ", " : "") << statistics.rankHistogram[k];
+  os << "],\n";
+
+  os << "  \"levels\": [";
+  for (std::size_t l = 0; l < statistics.levels.size(); ++l) {
+    const HMatrixLevelStatistics &level = statistics.levels[l];
+    os << (l > 0 ? "," : "") << "\n    {\"level\": " << l
+       << ", \"numberOfDenseBlocks\": " << level.numberOfDenseBlocks
+       << ", \"numberOfLowRankBlocks\": " << level.numberOfLowRankBlocks
+       << ", \"memSizeKb\": " << level.memSizeKb << "}";
+  }
+  os << "\n  ],\n";
+
+  os << "  \"blocks\": [";
+  for (std::size_t i = 0; i < statistics.blocks.size(); ++i) {
+    const HMatrixBlockStatistics &block = statistics.blocks[i];
+    os << (i > 0 ? "," : "") << "\n    {\"rowRange\": ["
+       << block.rowRange[0] << ", " << block.rowRange[1]
+       << "], \"columnRange\": [" << block.columnRange[0] << ", "
+       << block.columnRange[1] << "], \"level\": " << block.level
+       << ", \"admissible\": " << (block.admissible ? "true" : "false")
+       << ", \"lowRank\": " << (block.lowRank ? "true" : "false")
+       << ", \"rank\": " << block.rank << ", \"memSizeKb\": "
+       << block.memSizeKb << ", \"assemblyTime\": " << block.assemblyTime
+       << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+}
+
+#endif
@@ -0,0 +1,97 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HODLR_DECOMPOSITION_HPP
+#define HMAT_HODLR_DECOMPOSITION_HPP
+
+#include "common.hpp"
+#include "hmatrix.hpp"
+#include "hmatrix_arithmetic.hpp"
+#include "cluster_tree.hpp"
+#include <armadillo>
+
+namespace hmat {
+
+/** \brief Direct solver for hierarchically off-diagonal low-rank (HODLR)
+ *  matrices.
+ *
+ *  On every level of the block cluster tree the matrix is split into its
+ *  diagonal blocks D and the low-rank off-diagonal blocks
+ *  \f$U_p V_p\f$, and the inverse is applied by the Sherman-Morrison-
+ *  Woodbury formula
+ *  \f[ (D + UV)^{-1} = D^{-1} - D^{-1} U (I + V D^{-1} U)^{-1} V D^{-1}, \f]
+ *  where the diagonal blocks are inverted recursively and the dense leaves
+ *  on the diagonal are factorized with partial pivoting. The factorization
+ *  stores \f$D^{-1} U\f$ and the LU factors of the small coupling matrix
+ *  \f$I + V D^{-1} U\f$ on every level; it takes
+ *  \f$O(k^2 n \log^2 n)\f$ operations for off-diagonal ranks k, and a solve
+ *  \f$O(k n \log n)\f$.
+ *
+ *  The structure is that of H-matrices built with WeakAdmissibility. Other
+ *  H-matrices are accepted as well: off-diagonal blocks that are not
+ *  low-rank are converted to low-rank form, truncated by SVD to the
+ *  relative accuracy \p eps, which is only efficient if their ranks are
+ *  small.
+ *
+ *  The row and column cluster trees of the H-matrix must be identical,
+ *  which is the case if the test and trial spaces are equal. */
+template <typename ValueType, int N>
+class HodlrDecomposition : private HMatrixArithmetic<ValueType, N> {
+public:
+  HodlrDecomposition(const HMatrix<ValueType, N> &hMatrix, double eps,
+                     int maxThreadCount = -1);
+
+  std::size_t rows() const;
+  std::size_t columns() const;
+  double memSizeKb() const;
+
+  /** \brief Solve A X = B with B and X in original DOF ordering. */
+  void solve(const arma::Mat<ValueType> &B, arma::Mat<ValueType> &X) const;
+
+  /** \brief Overwrite \p X, given in H-matrix DOF ordering, with
+   *  A^{-1} X. */
+  void solvePermuted(arma::Mat<ValueType> &X) const;
+
+private:
+  typedef HMatrixArithmetic<ValueType, N> Arithmetic;
+  typedef typename Arithmetic::Block Block;
+  using Arithmetic::copyBlock;
+  using Arithmetic::toLowRank;
+
+  // Off-diagonal block (row, column) = U * V of a node, with W = D^{-1} U
+  struct Coupling {
+    int row;
+    int column;
+    arma::Mat<ValueType> V;
+    arma::Mat<ValueType> W;
+  };
+
+  struct Node {
+    IndexRangeType range;
+    std::vector<shared_ptr<Node>> children; // N diagonal children or none
+
+    // Factors of dense leaves: P * A = lower * upper
+    arma::Mat<ValueType> lower;
+    arma::Mat<ValueType> upper;
+    arma::Mat<ValueType> pivots;
+
+    std::vector<Coupling> couplings;
+    // Factors of the coupling matrix I + V D^{-1} U
+    arma::Mat<ValueType> couplingLower;
+    arma::Mat<ValueType> couplingUpper;
+    arma::Mat<ValueType> couplingPivots;
+  };
+
+  shared_ptr<Node> factorize(const Block &block) const;
+  void solveNode(const Node &node, arma::Mat<ValueType> &X) const;
+
+  double memSizeKbImpl(const Node &node) const;
+
+  shared_ptr<const ClusterTree<N>> m_rowClusterTree;
+  shared_ptr<const ClusterTree<N>> m_columnClusterTree;
+  shared_ptr<Node> m_root;
+};
+}
+
+#include "hodlr_decomposition_impl.hpp"
+
+#endif
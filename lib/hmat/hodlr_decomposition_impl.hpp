@@ -0,0 +1,229 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_HODLR_DECOMPOSITION_IMPL_HPP
+#define HMAT_HODLR_DECOMPOSITION_IMPL_HPP
+
+#include "hodlr_decomposition.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
+namespace hmat {
+
+template <typename ValueType, int N>
+HodlrDecomposition<ValueType, N>::HodlrDecomposition(
+    const HMatrix<ValueType, N> &hMatrix, double eps, int maxThreadCount)
+    : HMatrixArithmetic<ValueType, N>(eps),
+      m_rowClusterTree(hMatrix.blockClusterTree()->rowClusterTree()),
+      m_columnClusterTree(hMatrix.blockClusterTree()->columnClusterTree()) {
+
+  if (hMatrix.rows() != hMatrix.columns())
+    throw std::invalid_argument("HodlrDecomposition::HodlrDecomposition(): "
+                                "H-matrix must be square.");
+  if (!hMatrix.isInitialized() || hMatrix.isFrozen())
+    throw std::invalid_argument("HodlrDecomposition::HodlrDecomposition(): "
+                                "H-matrix must be initialized and not "
+                                "frozen.");
+  if (!Arithmetic::sameClusterTree(*m_rowClusterTree, *m_columnClusterTree))
+    throw std::invalid_argument("HodlrDecomposition::HodlrDecomposition(): "
+                                "Row and column cluster trees differ.");
+
+  // The copy of the blocks is released once the factors are computed
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    m_root =
+        factorize(*copyBlock(hMatrix, hMatrix.blockClusterTree()->root()));
+  });
+}
+
+template <typename ValueType, int N>
+std::size_t HodlrDecomposition<ValueType, N>::rows() const {
+  return m_rowClusterTree->numberOfDofs();
+}
+
+template <typename ValueType, int N>
+std::size_t HodlrDecomposition<ValueType, N>::columns() const {
+  return m_columnClusterTree->numberOfDofs();
+}
+
+template <typename ValueType, int N>
+double HodlrDecomposition<ValueType, N>::memSizeKb() const {
+  return memSizeKbImpl(*m_root);
+}
+
+template <typename ValueType, int N>
+void HodlrDecomposition<ValueType, N>::solve(const arma::Mat<ValueType> &B,
+                                             arma::Mat<ValueType> &X) const {
+
+  if (B.n_rows != rows())
+    throw std::invalid_argument("HodlrDecomposition::solve(): "
+                                "Right-hand side has wrong number of rows.");
+
+  arma::Mat<ValueType> permuted(B.n_rows, B.n_cols);
+  const auto &hMatDofToOriginalDofMap =
+      m_rowClusterTree->hMatDofToOriginalDofMap();
+  for (std::size_t j = 0; j < B.n_cols; ++j)
+    for (std::size_t i = 0; i < B.n_rows; ++i)
+      permuted(i, j) = B(hMatDofToOriginalDofMap[i], j);
+
+  solvePermuted(permuted);
+
+  X.set_size(B.n_rows, B.n_cols);
+  const auto &originalDofToHMatDofMap =
+      m_columnClusterTree->originalDofToHMatDofMap();
+  for (std::size_t j = 0; j < B.n_cols; ++j)
+    for (std::size_t i = 0; i < B.n_rows; ++i)
+      X(i, j) = permuted(originalDofToHMatDofMap[i], j);
+}
+
+template <typename ValueType, int N>
+void HodlrDecomposition<ValueType, N>::solvePermuted(
+    arma::Mat<ValueType> &X) const {
+
+  if (X.n_rows != rows())
+    throw std::invalid_argument("HodlrDecomposition::solvePermuted(): "
+                                "Input matrix has wrong number of rows.");
+  solveNode(*m_root, X);
+}
+
+template <typename ValueType, int N>
+shared_ptr<typename HodlrDecomposition<ValueType, N>::Node>
+HodlrDecomposition<ValueType, N>::factorize(const Block &block) const {
+
+  if (block.rowRange != block.columnRange)
+    throw std::runtime_error("HodlrDecomposition::factorize(): "
+                             "Row and column cluster trees differ.");
+  if (block.lowRank)
+    throw std::runtime_error("HodlrDecomposition::factorize(): "
+                             "Diagonal block is low-rank.");
+
+  shared_ptr<Node> node(new Node);
+  node->range = block.rowRange;
+
+  if (block.dense) {
+    if (!arma::lu(node->lower, node->upper, node->pivots, block.dense->A()))
+      throw std::runtime_error("HodlrDecomposition::factorize(): "
+                               "LU factorization failed.");
+    return node;
+  }
+
+  // The diagonal blocks are independent of each other
+  node->children.resize(N);
+  tbb::parallel_for(0, N, [&](int i) {
+    node->children[i] = factorize(*block.children[N * i + i]);
+  });
+
+  // Off-diagonal blocks U_p V_p with W_p = D_ii^{-1} U_p
+  std::vector<Coupling> couplings(N * N);
+  tbb::parallel_for(0, N * N, [&](int index) {
+    int i = index / N;
+    int j = index % N;
+    if (i == j)
+      return;
+    arma::Mat<ValueType> U;
+    Coupling &coupling = couplings[index];
+    toLowRank(*block.children[index], U, coupling.V);
+    if (U.n_cols == 0)
+      return;
+    coupling.row = i;
+    coupling.column = j;
+    solveNode(*node->children[i], U);
+    coupling.W.swap(U);
+  });
+  std::size_t totalRank = 0;
+  for (auto &coupling : couplings)
+    if (!coupling.W.is_empty()) {
+      totalRank += coupling.V.n_rows;
+      node->couplings.push_back(Coupling());
+      node->couplings.back().row = coupling.row;
+      node->couplings.back().column = coupling.column;
+      node->couplings.back().V.swap(coupling.V);
+      node->couplings.back().W.swap(coupling.W);
+    }
+  if (totalRank == 0)
+    return node;
+
+  // Coupling matrix I + V D^{-1} U; the block (p, q) is nonzero only if the
+  // columns of block p are the rows of block q
+  arma::Mat<ValueType> K =
+      arma::eye<arma::Mat<ValueType>>(totalRank, totalRank);
+  std::size_t offsetP = 0;
+  for (const auto &p : node->couplings) {
+    std::size_t offsetQ = 0;
+    for (const auto &q : node->couplings) {
+      if (p.column == q.row)
+        K.submat(offsetP, offsetQ, offsetP + p.V.n_rows - 1,
+                 offsetQ + q.V.n_rows - 1) += p.V * q.W;
+      offsetQ += q.V.n_rows;
+    }
+    offsetP += p.V.n_rows;
+  }
+  if (!arma::lu(node->couplingLower, node->couplingUpper,
+                node->couplingPivots, K))
+    throw std::runtime_error("HodlrDecomposition::factorize(): "
+                             "LU factorization of the coupling matrix "
+                             "failed.");
+  return node;
+}
+
+template <typename ValueType, int N>
+void HodlrDecomposition<ValueType, N>::solveNode(
+    const Node &node, arma::Mat<ValueType> &X) const {
+
+  if (node.children.empty()) {
+    X = node.pivots * X;
+    X = arma::solve(arma::trimatl(node.lower), X);
+    X = arma::solve(arma::trimatu(node.upper), X);
+    return;
+  }
+
+  // Y = D^{-1} X
+  const std::size_t offset = node.range[0];
+  tbb::parallel_for(0, N, [&](int i) {
+    const IndexRangeType &range = node.children[i]->range;
+    arma::Mat<ValueType> Xi = X.rows(range[0] - offset, range[1] - 1 - offset);
+    solveNode(*node.children[i], Xi);
+    X.rows(range[0] - offset, range[1] - 1 - offset) = Xi;
+  });
+  if (node.couplings.empty())
+    return;
+
+  // z = (I + V D^{-1} U)^{-1} V Y and Y -= D^{-1} U z
+  arma::Mat<ValueType> z(node.couplingLower.n_rows, X.n_cols);
+  std::size_t rankOffset = 0;
+  for (const auto &coupling : node.couplings) {
+    const IndexRangeType &range = node.children[coupling.column]->range;
+    z.rows(rankOffset, rankOffset + coupling.V.n_rows - 1) =
+        coupling.V * X.rows(range[0] - offset, range[1] - 1 - offset);
+    rankOffset += coupling.V.n_rows;
+  }
+  z = node.couplingPivots * z;
+  z = arma::solve(arma::trimatl(node.couplingLower), z);
+  z = arma::solve(arma::trimatu(node.couplingUpper), z);
+  rankOffset = 0;
+  for (const auto &coupling : node.couplings) {
+    const IndexRangeType &range = node.children[coupling.row]->range;
+    X.rows(range[0] - offset, range[1] - 1 - offset) -=
+        coupling.W * z.rows(rankOffset, rankOffset + coupling.V.n_rows - 1);
+    rankOffset += coupling.V.n_rows;
+  }
+}
+
+template <typename ValueType, int N>
+double
+HodlrDecomposition<ValueType, N>::memSizeKbImpl(const Node &node) const {
+
+  std::size_t elements = node.lower.n_elem + node.upper.n_elem +
+                         node.couplingLower.n_elem +
+                         node.couplingUpper.n_elem;
+  for (const auto &coupling : node.couplings)
+    elements += coupling.V.n_elem + coupling.W.n_elem;
+  double result = sizeof(ValueType) * elements / (1.0 * 1024);
+  for (const auto &c : node.children)
+    result += memSizeKbImpl(*c);
+  return result;
+}
+}
+
+#endif
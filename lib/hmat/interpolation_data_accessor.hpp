@@ -0,0 +1,44 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_INTERPOLATION_DATA_ACCESSOR_HPP
+#define HMAT_INTERPOLATION_DATA_ACCESSOR_HPP
+
+#include "common.hpp"
+#include "block_cluster_tree.hpp"
+#include "cluster_tree.hpp"
+#include <armadillo>
+
+namespace hmat {
+
+/** \brief Access to a separable approximation of the kernel obtained by
+ *  interpolating it in the boxes of the clusters.
+ *
+ *  An admissible block (t, s) is approximated by U_t^T K_ts V_s. Column j of
+ *  the moment matrix U_t (V_s) holds the integrals of the interpolants of
+ *  the box of the row (column) cluster t (s) against the basis function of
+ *  its j-th DOF, conjugated for row clusters; K_ts holds the kernel at the
+ *  interpolation nodes of both boxes. The moment matrices only depend on
+ *  the cluster, so they are computed once and shared by all blocks of the
+ *  cluster. Implementations must be thread-safe. */
+template <typename ValueType, int N> class InterpolationDataAccessor {
+public:
+  virtual ~InterpolationDataAccessor() {}
+
+  /** \brief Compute the moment matrix of a row (\p side = ROW) or column
+   *  (\p side = COL) cluster.
+   *
+   *  \p moments has one row per interpolation node and one column per DOF
+   *  of \p clusterTreeNode, in H-matrix ordering. */
+  virtual void computeClusterMoments(RowColSelector side,
+                                     const ClusterTreeNode<N> &clusterTreeNode,
+                                     arma::Mat<ValueType> &moments) const = 0;
+
+  /** \brief Compute the kernel at the interpolation nodes of the row
+   *  cluster (rows) and of the column cluster (columns) of a block. */
+  virtual void
+  computeCouplingMatrix(const BlockClusterTreeNode<N> &blockClusterTreeNode,
+                        arma::Mat<ValueType> &coupling) const = 0;
+};
+}
+
+#endif
@@ -0,0 +1,69 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_LEAF_PARTITION_HPP
+#define HMAT_LEAF_PARTITION_HPP
+
+#include "common.hpp"
+#include "block_cluster_tree.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace hmat {
+
+/** \brief Assignment of the leaves of a block cluster tree to several
+ *  processes, balanced by cost.
+ *
+ *  The leaves are ordered by their row and then column ranges and split
+ *  into contiguous chunks of about equal total cost, so that the leaves of
+ *  one part cover a narrow band of rows. Every part is also the owner of a
+ *  contiguous range of rows, starting at the row cluster of its first leaf,
+ *  into which the partial products of all parts are reduced. */
+template <int N> class LeafPartition {
+public:
+  /** \brief Partition with the given leaf costs.
+   *
+   *  \p leafCosts is ordered like BlockClusterTree::leafNodes(). It can be
+   *  taken from an earlier assembly, e.g. from the memSizeKb() of the leaf
+   *  data of an H-matrix on the same tree. */
+  LeafPartition(const BlockClusterTree<N> &blockClusterTree,
+                int numberOfParts, const std::vector<double> &leafCosts);
+
+  /** \brief Partition with the costs of estimatedLeafCosts(). */
+  LeafPartition(const BlockClusterTree<N> &blockClusterTree,
+                int numberOfParts, unsigned int rankEstimate);
+
+  /** \brief Estimated compression cost of every leaf, ordered like
+   *  BlockClusterTree::leafNodes().
+   *
+   *  The cost of a dense block is its size, that of an admissible block
+   *  the size of rank \p rankEstimate factors, but at most its size. */
+  static std::vector<double>
+  estimatedLeafCosts(const BlockClusterTree<N> &blockClusterTree,
+                     unsigned int rankEstimate);
+
+  int numberOfParts() const;
+
+  /** \brief Part owning the given leaf. */
+  int owner(const BlockClusterTreeNode<N> &leaf) const;
+
+  /** \brief Total cost of the leaves of a part. */
+  double cost(int part) const;
+
+  /** \brief Rows, in H-matrix ordering, whose results a part owns. */
+  const IndexRangeType &rowRange(int part) const;
+
+private:
+  void initialize(const BlockClusterTree<N> &blockClusterTree,
+                  const std::vector<double> &leafCosts);
+
+  int m_numberOfParts;
+  std::unordered_map<const BlockClusterTreeNode<N> *, int> m_owners;
+  std::vector<double> m_costs;
+  std::vector<IndexRangeType> m_rowRanges;
+};
+}
+
+#include "leaf_partition_impl.hpp"
+
+#endif
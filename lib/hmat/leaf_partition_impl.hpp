@@ -0,0 +1,138 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_LEAF_PARTITION_IMPL_HPP
+#define HMAT_LEAF_PARTITION_IMPL_HPP
+
+#include "leaf_partition.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace hmat {
+
+template <int N>
+LeafPartition<N>::LeafPartition(const BlockClusterTree<N> &blockClusterTree,
+                                int numberOfParts,
+                                const std::vector<double> &leafCosts)
+    : m_numberOfParts(numberOfParts) {
+  initialize(blockClusterTree, leafCosts);
+}
+
+template <int N>
+LeafPartition<N>::LeafPartition(const BlockClusterTree<N> &blockClusterTree,
+                                int numberOfParts, unsigned int rankEstimate)
+    : m_numberOfParts(numberOfParts) {
+  initialize(blockClusterTree,
+             estimatedLeafCosts(blockClusterTree, rankEstimate));
+}
+
+template <int N>
+std::vector<double> LeafPartition<N>::estimatedLeafCosts(
+    const BlockClusterTree<N> &blockClusterTree, unsigned int rankEstimate) {
+
+  auto leafNodes = blockClusterTree.leafNodes();
+  std::vector<double> costs(leafNodes.size());
+  for (std::size_t i = 0; i < leafNodes.size(); ++i) {
+    IndexRangeType rowClusterRange;
+    IndexRangeType columnClusterRange;
+    std::size_t numberOfRows;
+    std::size_t numberOfColumns;
+    getBlockClusterTreeNodeDimensions(*leafNodes[i], rowClusterRange,
+                                      columnClusterRange, numberOfRows,
+                                      numberOfColumns);
+    double size = double(numberOfRows) * numberOfColumns;
+    costs[i] = leafNodes[i]->data().admissible
+                   ? std::min(size, double(numberOfRows + numberOfColumns) *
+                                        rankEstimate)
+                   : size;
+  }
+  return costs;
+}
+
+template <int N>
+void LeafPartition<N>::initialize(const BlockClusterTree<N> &blockClusterTree,
+                                  const std::vector<double> &leafCosts) {
+
+  if (m_numberOfParts < 1)
+    throw std::invalid_argument("LeafPartition::LeafPartition(): "
+                                "The number of parts must be positive.");
+
+  auto leafNodes = blockClusterTree.leafNodes();
+  if (leafCosts.size() != leafNodes.size())
+    throw std::invalid_argument("LeafPartition::LeafPartition(): "
+                                "Wrong number of leaf costs.");
+
+  auto rowStart = [&leafNodes](std::size_t i) {
+    return leafNodes[i]->data().rowClusterTreeNode->data().indexRange[0];
+  };
+  auto columnStart = [&leafNodes](std::size_t i) {
+    return leafNodes[i]->data().columnClusterTreeNode->data().indexRange[0];
+  };
+
+  std::vector<std::size_t> order(leafNodes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&rowStart, &columnStart](std::size_t a, std::size_t b) {
+    return rowStart(a) < rowStart(b) ||
+           (rowStart(a) == rowStart(b) && columnStart(a) < columnStart(b));
+  });
+
+  double totalCost = std::accumulate(leafCosts.begin(), leafCosts.end(), 0.);
+
+  // A leaf goes to the part into whose share of the total cost the middle
+  // of its own cost falls.
+  m_costs.assign(m_numberOfParts, 0.);
+  std::vector<std::size_t> partStarts(m_numberOfParts + 1,
+                                      blockClusterTree.rows());
+  partStarts[0] = 0;
+  double costBefore = 0;
+  int previousPart = 0;
+  for (std::size_t k = 0; k < order.size(); ++k) {
+    std::size_t i = order[k];
+    double position = (totalCost > 0)
+                          ? (costBefore + leafCosts[i] / 2) / totalCost
+                          : (k + 0.5) / order.size();
+    int part = std::min(m_numberOfParts - 1,
+                        static_cast<int>(position * m_numberOfParts));
+    part = std::max(part, previousPart);
+    for (int p = previousPart + 1; p <= part; ++p)
+      partStarts[p] = rowStart(i);
+    previousPart = part;
+
+    m_owners[leafNodes[i].get()] = part;
+    m_costs[part] += leafCosts[i];
+    costBefore += leafCosts[i];
+  }
+
+  m_rowRanges.resize(m_numberOfParts);
+  for (int p = 0; p < m_numberOfParts; ++p) {
+    m_rowRanges[p][0] = partStarts[p];
+    m_rowRanges[p][1] = partStarts[p + 1];
+  }
+}
+
+template <int N> int LeafPartition<N>::numberOfParts() const {
+  return m_numberOfParts;
+}
+
+template <int N>
+int LeafPartition<N>::owner(const BlockClusterTreeNode<N> &leaf) const {
+  auto it = m_owners.find(&leaf);
+  if (it == m_owners.end())
+    throw std::invalid_argument("LeafPartition::owner(): "
+                                "Node is not a leaf of the partitioned tree.");
+  return it->second;
+}
+
+template <int N> double LeafPartition<N>::cost(int part) const {
+  return m_costs.at(part);
+}
+
+template <int N>
+const IndexRangeType &LeafPartition<N>::rowRange(int part) const {
+  return m_rowRanges.at(part);
+}
+}
+
+#endif
@@ -0,0 +1,28 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_MATVEC_ACCESSOR_HPP
+#define HMAT_MATVEC_ACCESSOR_HPP
+
+#include "common.hpp"
+#include <armadillo>
+
+namespace hmat {
+
+/** \brief Access to a matrix through products with blocks of vectors only.
+ *
+ *  Used to build H-matrices of operators without entry access; see
+ *  HMatrixSketchingCompressor. The vectors are given in H-matrix DOF
+ *  ordering of the column (row) cluster tree for \p trans = NOTRANS
+ *  (CONJTRANS), and \p Y in that of the other tree. */
+template <typename ValueType> class MatVecAccessor {
+public:
+  virtual ~MatVecAccessor() {}
+
+  /** \brief Set \p Y to op(A) * \p X, where op is the identity for
+   *  \p trans = NOTRANS and the adjoint for \p trans = CONJTRANS. */
+  virtual void apply(const arma::Mat<ValueType> &X, arma::Mat<ValueType> &Y,
+                     TransposeMode trans) const = 0;
+};
+}
+
+#endif
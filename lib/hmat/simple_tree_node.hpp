@@ -8,6 +8,9 @@
 #include <memory>
 
 namespace hmat {
+
+template <typename T, int N> class TreeIndex;
+
 template <typename T, int N>
 class SimpleTreeNode : public enable_shared_from_this<SimpleTreeNode<T, N>> {
 public:
@@ -15,7 +18,7 @@ public:
   SimpleTreeNode(const shared_ptr<SimpleTreeNode<T, N>> &root, const T &data);
   const shared_ptr<const SimpleTreeNode<T, N>> root() const;
   const shared_ptr<const SimpleTreeNode<T, N>> child(int i) const;
-  const shared_ptr<SimpleTreeNode<T, N>> child(int i);
+  const shared_ptr<SimpleTreeNode<T, N>> &child(int i);
 
   const T &data() const;
   T &data();
@@ -28,9 +31,16 @@ public:
   const std::vector<shared_ptr<const SimpleTreeNode<T, N>>> leafNodes() const;
   const std::vector<shared_ptr<SimpleTreeNode<T, N>>> leafNodes();
 
+  /** \brief Number of the node in the TreeIndex of its tree, or 0 if no
+   *  index has been built. */
+  std::size_t index() const;
+
 private:
+  friend class TreeIndex<T, N>;
+
   std::array<shared_ptr<SimpleTreeNode<T, N>>, N> m_children;
   weak_ptr<SimpleTreeNode<T, N>> m_root;
+  std::size_t m_index;
 
   T m_data;
 };
@@ -14,12 +14,12 @@
 namespace hmat {
 template <typename T, int N>
 SimpleTreeNode<T, N>::SimpleTreeNode(const T &data)
-    : m_root(shared_ptr<SimpleTreeNode<T, N>>()), m_data(data) {};
+    : m_root(shared_ptr<SimpleTreeNode<T, N>>()), m_index(0), m_data(data) {};
 
 template <typename T, int N>
 SimpleTreeNode<T, N>::SimpleTreeNode(
     const shared_ptr<SimpleTreeNode<T, N>> &root, const T &data)
-    : m_root(root), m_data(data) {};
+    : m_root(root), m_index(0), m_data(data) {};
 
 template <typename T, int N>
 const shared_ptr<const SimpleTreeNode<T, N>>
@@ -37,7 +37,7 @@ SimpleTreeNode<T, N>::child(int i) const {
 }
 
 template <typename T, int N>
-const shared_ptr<SimpleTreeNode<T, N>> SimpleTreeNode<T, N>::child(int i) {
+const shared_ptr<SimpleTreeNode<T, N>> &SimpleTreeNode<T, N>::child(int i) {
   assert(i < N);
   assert(m_children[i]);
 
@@ -69,7 +69,7 @@ void SimpleTreeNode<T, N>::addSubTree(shared_ptr<SimpleTreeNode<T, N>> &subTree,
 
 template <typename T, int N> bool SimpleTreeNode<T, N>::isLeaf() const {
 
-  for (auto child : m_children)
+  for (const auto &child : m_children)
     if (child)
       return false;
 
@@ -80,20 +80,22 @@ template <typename T, int N>
 const std::vector<shared_ptr<const SimpleTreeNode<T, N>>>
 SimpleTreeNode<T, N>::leafNodes() const {
 
-  std::function<void(SimpleTreeNode<T, N> &)> getLeafsImpl;
+  std::function<void(const SimpleTreeNode<T, N> &)> getLeafsImpl;
 
   std::vector<shared_ptr<const SimpleTreeNode<T, N>>> leafVector;
 
-  getLeafsImpl = [&leafVector, &getLeafsImpl](SimpleTreeNode<T, N> &node) {
+  getLeafsImpl = [&leafVector, &getLeafsImpl](
+      const SimpleTreeNode<T, N> &node) {
 
     if (node.isLeaf())
-      leafVector.push_back(node);
+      leafVector.push_back(node.shared_from_this());
     else
       for (int i = 0; i < N; ++i)
         getLeafsImpl(*(node.child(i)));
   };
 
   getLeafsImpl(*this);
+  return leafVector;
 }
 
 template <typename T, int N>
@@ -116,5 +118,9 @@ SimpleTreeNode<T, N>::leafNodes() {
   getLeafsImpl(*this);
   return leafVector;
 }
+
+template <typename T, int N> std::size_t SimpleTreeNode<T, N>::index() const {
+  return m_index;
+}
 }
 #endif
@@ -0,0 +1,79 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_TREE_INDEX_HPP
+#define HMAT_TREE_INDEX_HPP
+
+#include "common.hpp"
+#include "simple_tree_node.hpp"
+
+#include <vector>
+
+namespace hmat {
+
+/** \brief Index-linked description of the structure of a tree.
+ *
+ *  Every node gets a number (see SimpleTreeNode::index()) such that the N
+ *  children of a node have consecutive numbers. Parents, children and
+ *  levels are then plain array lookups, per-node data can be kept in
+ *  vectors instead of hash maps, and traversals based on the index neither
+ *  chase the nodes' shared_ptrs nor touch their reference counts. The
+ *  leaves are listed once, in depth-first order.
+ *
+ *  Every node must have either no or all N children. The index has to be
+ *  rebuilt if the tree changes. */
+template <typename T, int N> class TreeIndex {
+public:
+  typedef SimpleTreeNode<T, N> NodeType;
+
+  /** \brief Index the tree below \p root.
+   *
+   *  If \p indexSubtree is false, only the root is registered and the index
+   *  is filled while the tree is built: addChildren() must be called for
+   *  every node once all its children have been added, and finish() once
+   *  the tree is complete. This saves a separate traversal of a large
+   *  tree. */
+  explicit TreeIndex(const shared_ptr<NodeType> &root,
+                     bool indexSubtree = true);
+
+  /** \brief Number the children of node \p index; returns the number of
+   *  the first child. */
+  std::size_t addChildren(std::size_t index);
+
+  /** \brief Collect the leaves after the last call of addChildren(). */
+  void finish();
+
+  std::size_t numberOfNodes() const;
+
+  NodeType &node(std::size_t index) const;
+  bool isLeaf(std::size_t index) const;
+
+  /** \brief Number of the \p i-th child of a non-leaf node. */
+  std::size_t child(std::size_t index, int i) const;
+
+  /** \brief Number of the parent of a node; the root is its own parent. */
+  std::size_t parent(std::size_t index) const;
+  std::size_t level(std::size_t index) const;
+
+  /** \brief Numbers of all leaves in depth-first order. */
+  const std::vector<std::size_t> &leaves() const;
+
+  /** \brief All leaves in depth-first order. */
+  const std::vector<shared_ptr<NodeType>> &leafNodes() const;
+
+private:
+  struct Entry {
+    NodeType *node;
+    std::size_t firstChild; // 0 for leaves
+    std::size_t parent;
+    std::size_t level;
+  };
+
+  std::vector<Entry> m_entries;
+  std::vector<std::size_t> m_leaves;
+  std::vector<shared_ptr<NodeType>> m_leafNodes;
+};
+}
+
+#include "tree_index_impl.hpp"
+
+#endif
@@ -0,0 +1,115 @@
+// vi: set et ts=4 sw=2 sts=2:
+
+#ifndef HMAT_TREE_INDEX_IMPL_HPP
+#define HMAT_TREE_INDEX_IMPL_HPP
+
+#include "tree_index.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace hmat {
+
+template <typename T, int N>
+TreeIndex<T, N>::TreeIndex(const shared_ptr<NodeType> &root,
+                           bool indexSubtree) {
+
+  Entry rootEntry = {root.get(), 0, 0, 0};
+  m_entries.push_back(rootEntry);
+  root->m_index = 0;
+  if (!indexSubtree)
+    return;
+
+  // Breadth-first: the children of entry i are appended when it is visited
+  for (std::size_t i = 0; i < m_entries.size(); ++i)
+    if (!m_entries[i].node->isLeaf())
+      addChildren(i);
+  finish();
+}
+
+template <typename T, int N>
+std::size_t TreeIndex<T, N>::addChildren(std::size_t index) {
+
+  NodeType &node = *m_entries[index].node;
+  std::size_t firstChild = m_entries.size();
+  std::size_t level = m_entries[index].level + 1;
+  for (int k = 0; k < N; ++k) {
+    NodeType *child = node.m_children[k].get();
+    if (!child)
+      throw std::invalid_argument("TreeIndex::addChildren(): "
+                                  "Every node must have either no or all "
+                                  "children.");
+    child->m_index = m_entries.size();
+    Entry entry = {child, 0, index, level};
+    m_entries.push_back(entry);
+  }
+  m_entries[index].firstChild = firstChild;
+  return firstChild;
+}
+
+template <typename T, int N> void TreeIndex<T, N>::finish() {
+
+  m_leaves.clear();
+  m_leafNodes.clear();
+  std::vector<std::size_t> stack(1, 0);
+  while (!stack.empty()) {
+    std::size_t index = stack.back();
+    stack.pop_back();
+    if (isLeaf(index)) {
+      m_leaves.push_back(index);
+      continue;
+    }
+    for (int k = N - 1; k >= 0; --k)
+      stack.push_back(m_entries[index].firstChild + k);
+  }
+
+  m_leafNodes.reserve(m_leaves.size());
+  for (std::size_t index : m_leaves)
+    m_leafNodes.push_back(m_entries[index].node->shared_from_this());
+}
+
+template <typename T, int N>
+std::size_t TreeIndex<T, N>::numberOfNodes() const {
+  return m_entries.size();
+}
+
+template <typename T, int N>
+typename TreeIndex<T, N>::NodeType &
+TreeIndex<T, N>::node(std::size_t index) const {
+  return *m_entries[index].node;
+}
+
+template <typename T, int N>
+bool TreeIndex<T, N>::isLeaf(std::size_t index) const {
+  return m_entries[index].firstChild == 0;
+}
+
+template <typename T, int N>
+std::size_t TreeIndex<T, N>::child(std::size_t index, int i) const {
+  assert(!isLeaf(index) && i < N);
+  return m_entries[index].firstChild + i;
+}
+
+template <typename T, int N>
+std::size_t TreeIndex<T, N>::parent(std::size_t index) const {
+  return m_entries[index].parent;
+}
+
+template <typename T, int N>
+std::size_t TreeIndex<T, N>::level(std::size_t index) const {
+  return m_entries[index].level;
+}
+
+template <typename T, int N>
+const std::vector<std::size_t> &TreeIndex<T, N>::leaves() const {
+  return m_leaves;
+}
+
+template <typename T, int N>
+const std::vector<shared_ptr<typename TreeIndex<T, N>::NodeType>> &
+TreeIndex<T, N>::leafNodes() const {
+  return m_leafNodes;
+}
+}
+
+#endif
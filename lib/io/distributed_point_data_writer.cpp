@@ -0,0 +1,188 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "distributed_point_data_writer.hpp"
+
+#ifdef WITH_MPI
+
+#include "../common/scalar_traits.hpp"
+
+#include <armadillo>
+
+#include <complex>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace Bempp {
+
+namespace {
+
+void check(int status, const std::string &what) {
+  if (status != MPI_SUCCESS)
+    throw std::runtime_error("writeDistributedPointData(): " + what +
+                             " failed");
+}
+
+std::string xdmfBinaryDataItem(size_t rowCount, size_t columnCount,
+                               const std::string &fileName,
+                               unsigned long long seek) {
+  std::ostringstream out;
+  out << "<DataItem Dimensions=\"" << rowCount << " " << columnCount
+      << "\" NumberType=\"Float\" Precision=\"8\" Format=\"Binary\" "
+         "Endian=\"Native\" Seek=\"" << seek << "\">" << fileName
+      << "</DataItem>\n";
+  return out.str();
+}
+
+} // namespace
+
+template <typename CoordinateType, typename ValueType>
+void writeDistributedPointData(const arma::Mat<CoordinateType> &localPoints,
+                               const arma::Mat<ValueType> &localValues,
+                               const std::string &dataLabel,
+                               const std::string &name,
+                               const std::string &path, MPI_Comm comm) {
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  const bool isComplex = !std::is_same<ValueType, RealType>::value;
+
+  if (localPoints.n_rows > 3)
+    throw std::invalid_argument("writeDistributedPointData(): points must "
+                                "have at most three coordinates");
+  if (localValues.n_cols != localPoints.n_cols)
+    throw std::invalid_argument("writeDistributedPointData(): localPoints "
+                                "and localValues must have the same number "
+                                "of columns");
+
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+  // Processes without points may pass arrays without rows
+  unsigned long long localCount = localPoints.n_cols, offset = 0,
+                     totalCount = 0, componentCount = localValues.n_rows;
+  check(MPI_Exscan(&localCount, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+                   comm),
+        "computing the offsets");
+  if (rank == 0)
+    offset = 0;
+  check(MPI_Allreduce(&localCount, &totalCount, 1, MPI_UNSIGNED_LONG_LONG,
+                      MPI_SUM, comm),
+        "counting the points");
+  check(MPI_Allreduce(MPI_IN_PLACE, &componentCount, 1,
+                      MPI_UNSIGNED_LONG_LONG, MPI_MAX, comm),
+        "counting the components");
+  if (localCount > 0 && localValues.n_rows != componentCount)
+    throw std::invalid_argument("writeDistributedPointData(): all processes "
+                                "must pass the same number of components");
+
+  // Sections of the file: the coordinates, padded with zeros to three, and
+  // one array per part of the field
+  const int partCount = isComplex ? 3 : 1;
+  std::vector<std::vector<double>> sections(partCount + 1);
+  sections[0].assign(3 * localCount, 0.);
+  for (size_t j = 0; j < localCount; ++j)
+    for (size_t i = 0; i < localPoints.n_rows; ++i)
+      sections[0][3 * j + i] = localPoints(i, j);
+  for (int part = 0; part < partCount; ++part) {
+    std::vector<double> &section = sections[part + 1];
+    section.resize(localValues.n_elem);
+    for (size_t k = 0; k < localValues.n_elem; ++k) {
+      const ValueType value = localValues[k];
+      section[k] = part == 0 ? std::real(value)
+                             : part == 1 ? std::imag(value) : std::abs(value);
+    }
+  }
+
+  const std::string prefix = path.empty() ? std::string() : path + "/";
+  const std::string binName = name + ".bin";
+  const std::string binPath = prefix + binName;
+  MPI_File file;
+  check(MPI_File_open(comm, const_cast<char *>(binPath.c_str()),
+                      MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                      &file),
+        "opening " + binPath);
+  std::vector<unsigned long long> seeks(partCount + 1);
+  try {
+    check(MPI_File_set_size(file, 0), "truncating " + binPath);
+    unsigned long long sectionStart = 0;
+    for (int s = 0; s <= partCount; ++s) {
+      const unsigned long long width = s == 0 ? 3 : componentCount;
+      seeks[s] = sectionStart;
+      const MPI_Offset byteOffset =
+          (sectionStart + offset * width) * sizeof(double);
+      MPI_Status status;
+      double *data = sections[s].empty() ? 0 : &sections[s][0];
+      check(MPI_File_write_at_all(file, byteOffset, data,
+                                  static_cast<int>(sections[s].size()),
+                                  MPI_DOUBLE, &status),
+            "writing " + binPath);
+      sectionStart += totalCount * width * sizeof(double);
+    }
+  } catch (...) {
+    MPI_File_close(&file);
+    throw;
+  }
+  check(MPI_File_close(&file), "closing " + binPath);
+  if (rank != 0)
+    return;
+
+  std::ostringstream out;
+  out << "<?xml version=\"1.0\" ?>\n"
+      << "<Xdmf Version=\"3.0\">\n<Domain>\n"
+      << "<Grid Name=\"" << name << "\" GridType=\"Uniform\">\n"
+      << "<Topology TopologyType=\"Polyvertex\" NumberOfElements=\""
+      << totalCount << "\"/>\n"
+      << "<Geometry GeometryType=\"XYZ\">\n"
+      << xdmfBinaryDataItem(totalCount, 3, binName, seeks[0])
+      << "</Geometry>\n";
+  static const char *suffixes[] = {".r", ".i", ".abs"};
+  for (int part = 0; part < partCount; ++part)
+    out << "<Attribute Name=\"" << dataLabel
+        << (isComplex ? suffixes[part] : "") << "\" AttributeType=\""
+        << (componentCount == 1 ? "Scalar"
+                                : componentCount == 3 ? "Vector" : "Matrix")
+        << "\" Center=\"Node\">\n"
+        << xdmfBinaryDataItem(totalCount, componentCount, binName,
+                              seeks[part + 1]) << "</Attribute>\n";
+  out << "</Grid>\n</Domain>\n</Xdmf>\n";
+
+  const std::string xdmfPath = prefix + name + ".xdmf";
+  std::ofstream xdmfFile(xdmfPath.c_str(), std::ios::trunc);
+  xdmfFile << out.str();
+  if (!xdmfFile)
+    throw std::runtime_error("writeDistributedPointData(): Error writing "
+                             "file " + xdmfPath);
+}
+
+#define INSTANTIATE_WRITER(COORDINATE, VALUE)                                  \
+  template void writeDistributedPointData(                                     \
+      const arma::Mat<COORDINATE> &localPoints,                                \
+      const arma::Mat<VALUE> &localValues, const std::string &dataLabel,       \
+      const std::string &name, const std::string &path, MPI_Comm comm)
+
+INSTANTIATE_WRITER(float, float);
+INSTANTIATE_WRITER(float, std::complex<float>);
+INSTANTIATE_WRITER(double, double);
+INSTANTIATE_WRITER(double, std::complex<double>);
+
+} // namespace Bempp
+
+#endif // WITH_MPI
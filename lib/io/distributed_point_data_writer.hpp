@@ -0,0 +1,70 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_distributed_point_data_writer_hpp
+#define bempp_distributed_point_data_writer_hpp
+
+#include "bempp/common/config_mpi.hpp"
+
+#ifdef WITH_MPI
+
+#include "../common/common.hpp"
+#include "../common/armadillo_fwd.hpp"
+
+#include <mpi.h>
+#include <string>
+
+namespace Bempp {
+
+/** \brief Write point data distributed over the processes of an MPI
+ *  communicator collectively to a single file.
+ *
+ *  Every process passes its own points and the values of a field at these
+ *  points, e.g. the local results of
+ *  PotentialOperator::evaluateAtPointsDistributed(). The <tt>(i, j)</tt>th
+ *  element of \p localPoints is the <em>i</em>th coordinate of the
+ *  <em>j</em>th local point and the <tt>(i, j)</tt>th element of \p
+ *  localValues the <em>i</em>th component of the field at that point. The
+ *  points of all processes are concatenated in the order of their ranks.
+ *
+ *  The data are written with collective MPI-IO, each process at its own
+ *  offset, to the raw binary file \c name.bin in the directory \p path (the
+ *  current directory if it is empty); no process gathers the data of the
+ *  others. Coordinates and values are stored in double precision. Process 0
+ *  afterwards writes the XDMF file \c name.xdmf describing the points as a
+ *  polyvertex grid with the field \p dataLabel, which ParaView can open
+ *  directly. As in VtuWriter, complex fields are stored as three real
+ *  arrays named dataLabel.r, dataLabel.i and dataLabel.abs. Existing files
+ *  are overwritten.
+ *
+ *  The function must be called by all processes of \p comm. */
+template <typename CoordinateType, typename ValueType>
+void writeDistributedPointData(const arma::Mat<CoordinateType> &localPoints,
+                               const arma::Mat<ValueType> &localValues,
+                               const std::string &dataLabel,
+                               const std::string &name,
+                               const std::string &path = std::string(),
+                               MPI_Comm comm = MPI_COMM_WORLD);
+
+} // namespace Bempp
+
+#endif // WITH_MPI
+
+#endif
@@ -20,6 +20,11 @@
 
 #include "gmsh.hpp"
 #include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
@@ -45,6 +50,15 @@
 #include "../common/complex_aux.hpp"
 #include "../common/acc.hpp"
 
+#include <tbb/parallel_for.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace {
 
 typedef std::vector<std::string> StringVector;
@@ -61,6 +75,941 @@ StringVector stringTokens(std::string input) {
   return result;
 }
 
+// Number of lines (ASCII) or records (binary) of the $Nodes and $Elements
+// sections parsed by a single task
+const size_t linesPerTask = 4096;
+
+// Contents of a mesh file. Files are mapped into memory where possible;
+// otherwise, and for streams, they are copied into a string.
+class FileBuffer {
+public:
+  explicit FileBuffer(const std::string &fileName);
+  explicit FileBuffer(std::istream &input);
+  ~FileBuffer();
+
+  const char *begin() const { return m_begin; }
+  const char *end() const { return m_end; }
+
+private:
+  FileBuffer(const FileBuffer &);
+  FileBuffer &operator=(const FileBuffer &);
+
+  void copyStream(std::istream &input);
+
+  std::string m_contents;
+  void *m_map;
+  size_t m_mapSize;
+  const char *m_begin;
+  const char *m_end;
+};
+
+FileBuffer::FileBuffer(const std::string &fileName)
+    : m_map(0), m_mapSize(0), m_begin(0), m_end(0) {
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw std::runtime_error("GmshData::read(): File " + fileName +
+                             " could not be opened.");
+  struct stat status;
+  if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+    void *map =
+        ::mmap(0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      m_map = map;
+      m_mapSize = status.st_size;
+#ifdef MADV_SEQUENTIAL
+      ::madvise(map, m_mapSize, MADV_SEQUENTIAL);
+#endif
+    }
+  }
+  ::close(fd);
+  if (m_map) {
+    m_begin = static_cast<const char *>(m_map);
+    m_end = m_begin + m_mapSize;
+    return;
+  }
+#endif
+  std::ifstream input(fileName.c_str(), std::ios::binary);
+  if (!input)
+    throw std::runtime_error("GmshData::read(): File " + fileName +
+                             " could not be opened.");
+  copyStream(input);
+}
+
+FileBuffer::FileBuffer(std::istream &input)
+    : m_map(0), m_mapSize(0), m_begin(0), m_end(0) {
+  copyStream(input);
+}
+
+FileBuffer::~FileBuffer() {
+#if defined(__unix__) || defined(__APPLE__)
+  if (m_map)
+    ::munmap(m_map, m_mapSize);
+#endif
+}
+
+void FileBuffer::copyStream(std::istream &input) {
+  std::ostringstream contents;
+  contents << input.rdbuf();
+  m_contents = contents.str();
+  m_begin = m_contents.data();
+  m_end = m_begin + m_contents.size();
+}
+
+inline const char *lineEnd(const char *begin, const char *end) {
+  const char *p = static_cast<const char *>(
+      std::memchr(begin, '\n', end - begin));
+  return p ? p : end;
+}
+
+inline const char *nextLine(const char *begin, const char *end) {
+  const char *p = lineEnd(begin, end);
+  return p == end ? end : p + 1;
+}
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Whitespace-separated values on a single line of an ASCII section
+class LineTokens {
+public:
+  LineTokens(const char *begin, const char *end) : m_pos(begin), m_end(end) {}
+
+  bool finished() {
+    skipSpaces();
+    return m_pos == m_end;
+  }
+
+  long long integer() {
+    skipSpaces();
+    const char *p = m_pos;
+    bool negative = false;
+    if (p != m_end && (*p == '-' || *p == '+'))
+      negative = (*p++ == '-');
+    if (p == m_end || *p < '0' || *p > '9')
+      throw std::runtime_error(
+          "GmshData::read(): Integer expected but not found.");
+    long long value = 0;
+    while (p != m_end && *p >= '0' && *p <= '9')
+      value = 10 * value + (*p++ - '0');
+    m_pos = p;
+    return negative ? -value : value;
+  }
+
+  int integer32() {
+    long long value = integer();
+    if (value > std::numeric_limits<int>::max() ||
+        value < std::numeric_limits<int>::min())
+      throw std::runtime_error(
+          "GmshData::read(): Integer value out of range.");
+    return static_cast<int>(value);
+  }
+
+  double real() {
+    // strtod() needs a null-terminated string, which a mapped file need not
+    // provide, so the token is copied first
+    skipSpaces();
+    char token[64];
+    size_t n = 0;
+    while (m_pos + n != m_end && n + 1 < sizeof(token) && !isSpace(m_pos[n])) {
+      token[n] = m_pos[n];
+      ++n;
+    }
+    token[n] = '\0';
+    char *tokenEnd;
+    double value = std::strtod(token, &tokenEnd);
+    if (n == 0 || tokenEnd == token)
+      throw std::runtime_error(
+          "GmshData::read(): Real number expected but not found.");
+    m_pos += tokenEnd - token;
+    return value;
+  }
+
+  std::string rest() {
+    skipSpaces();
+    const char *end = m_end;
+    while (end != m_pos && isSpace(end[-1]))
+      --end;
+    std::string result(m_pos, end);
+    m_pos = m_end;
+    return result;
+  }
+
+private:
+  void skipSpaces() {
+    while (m_pos != m_end && isSpace(*m_pos))
+      ++m_pos;
+  }
+
+  const char *m_pos;
+  const char *m_end;
+};
+
+// Sequential reader of a mesh file held in memory
+class Cursor {
+public:
+  Cursor(const char *begin, const char *end) : m_pos(begin), m_end(end) {}
+
+  bool finished() const { return m_pos == m_end; }
+  const char *position() const { return m_pos; }
+  const char *end() const { return m_end; }
+  void setPosition(const char *pos) { m_pos = pos; }
+
+  // Return the next line without its line break; false at the end of input
+  bool nextLine(std::string &line) {
+    if (m_pos == m_end)
+      return false;
+    const char *e = lineEnd(m_pos, m_end);
+    const char *next = (e == m_end) ? m_end : e + 1;
+    if (e != m_pos && e[-1] == '\r')
+      --e;
+    line.assign(m_pos, e);
+    m_pos = next;
+    return true;
+  }
+
+  std::string line() {
+    std::string result;
+    if (!nextLine(result))
+      throw std::runtime_error("GmshData::read(): Unexpected end of file.");
+    return result;
+  }
+
+  LineTokens tokens() {
+    if (m_pos == m_end)
+      throw std::runtime_error("GmshData::read(): Unexpected end of file.");
+    const char *begin = m_pos;
+    const char *e = lineEnd(m_pos, m_end);
+    m_pos = (e == m_end) ? m_end : e + 1;
+    return LineTokens(begin, e);
+  }
+
+  // Skip the given number of bytes of binary data and return their start
+  const char *skipBytes(size_t count) {
+    if (size_t(m_end - m_pos) < count)
+      throw std::runtime_error("GmshData::read(): Unexpected end of file.");
+    const char *begin = m_pos;
+    m_pos += count;
+    return begin;
+  }
+
+  template <typename T> T binary() {
+    T value;
+    std::memcpy(&value, skipBytes(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  // Read the line closing a section, skipping the line break that follows
+  // binary data
+  void expectLine(const std::string &marker, const char *section) {
+    std::string line;
+    while (nextLine(line) && line.empty())
+      ;
+    if (line != marker)
+      throw std::runtime_error(std::string("GmshData::read(): Error reading ") +
+                               section + " section.");
+  }
+
+  // Move past the next line equal to marker
+  void skipPast(const std::string &marker) {
+    std::string line;
+    while (nextLine(line))
+      if (line == marker)
+        return;
+    throw std::runtime_error("GmshData::read(): " + marker + " not found.");
+  }
+
+private:
+  const char *m_pos;
+  const char *m_end;
+};
+
+template <typename T> inline T readValue(const char *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+int checkedTag(long long tag) {
+  if (tag < 0 || tag > std::numeric_limits<int>::max())
+    throw std::runtime_error("GmshData::read(): Tag out of range.");
+  return static_cast<int>(tag);
+}
+
+// Number of nodes of the Gmsh element types 1 to 31; 0 if unsupported
+int nodesPerElementType(int type) {
+  static const int counts[] = {0,  2,  3,  4,  4,  8,  6,  5,  3,  6,  9,
+                               10, 27, 18, 14, 1,  8,  20, 15, 13, 9,  10,
+                               12, 15, 15, 21, 4,  5,  6,  20, 35, 56};
+  if (type < 1 || type >= int(sizeof(counts) / sizeof(counts[0])))
+    return 0;
+  return counts[type];
+}
+
+// Nodes read from a $Nodes section
+struct StagedNodes {
+  std::vector<int> tags;
+  std::vector<double> coordinates; // 3 per node
+};
+
+struct ElementRecord {
+  int index;
+  int type;
+  int physicalEntity;
+  int elementaryEntity;
+  int nodeCount;
+  int partitionCount;
+};
+
+// Elements read from a part of an $Elements section; the nodes and
+// partitions of each record follow each other in values
+struct StagedElements {
+  std::vector<ElementRecord> records;
+  std::vector<int> values;
+};
+
+// Filter applied to the elements being read
+struct ElementFilter {
+  int elementType;
+  int physicalEntity;
+  // Elements of this type are kept regardless of their physical entity
+  int additionalType;
+
+  bool accepts(int type, int physical) const {
+    return ((elementType == -1 || type == elementType) &&
+            (physicalEntity == -1 || physical == physicalEntity)) ||
+           type == additionalType;
+  }
+};
+
+// Call f(chunk, begin, count) in parallel for consecutive chunks of count
+// lines starting at begin, which together cover the next lineCount lines of
+// the cursor
+template <typename F>
+void parseLinesInParallel(Cursor &cursor, size_t lineCount, size_t firstChunk,
+                          std::vector<std::pair<const char *, size_t>> &chunks,
+                          const F &f) {
+  for (size_t line = 0; line < lineCount; line += linesPerTask) {
+    const size_t count = std::min(linesPerTask, lineCount - line);
+    const char *begin = cursor.position();
+    const char *p = begin;
+    for (size_t i = 0; i < count; ++i) {
+      if (p == cursor.end())
+        throw std::runtime_error("GmshData::read(): Unexpected end of file.");
+      p = nextLine(p, cursor.end());
+    }
+    cursor.setPosition(p);
+    chunks.push_back(std::make_pair(begin, count));
+  }
+  tbb::parallel_for(tbb::blocked_range<size_t>(firstChunk, chunks.size()),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t chunk = r.begin(); chunk != r.end(); ++chunk)
+      f(chunk, chunks[chunk].first, chunks[chunk].second);
+  });
+}
+
+// Contents of a $MeshFormat section
+struct MeshFormat {
+  std::string versionNumber;
+  int version; // 2 or 4
+  int fileType;
+  int dataSize;
+  bool binary;
+};
+
+void readMeshFormat(Cursor &cursor, MeshFormat &format) {
+  StringVector tokens = stringTokens(cursor.line());
+  if (tokens.size() != 3)
+    throw std::runtime_error("GmshData::read(): Wrong format of MeshFormat");
+  if (tokens[0] == "2" || tokens[0] == "2.2")
+    format.version = 2;
+  else if (tokens[0] == "4.1")
+    format.version = 4;
+  else
+    throw std::runtime_error(
+        "GmshData::read(): Version of MSH file not supported.");
+  format.versionNumber = tokens[0];
+  format.fileType = boost::lexical_cast<int>(tokens[1]);
+  if (format.fileType != 0 && format.fileType != 1)
+    throw std::runtime_error("GmshData::read(): File Type not supported.");
+  format.binary = (format.fileType == 1);
+  format.dataSize = boost::lexical_cast<int>(tokens[2]);
+  if (format.dataSize != sizeof(double) ||
+      (format.version == 4 && format.dataSize != sizeof(size_t)))
+    throw std::runtime_error("MeshFormat::read(): Data size not supported.");
+  if (format.binary && cursor.binary<int>() != 1)
+    throw std::runtime_error(
+        "GmshData::read(): Byte order of binary MSH file not supported.");
+  cursor.expectLine("$EndMeshFormat", "MeshFormat");
+}
+
+void readNodesV2(Cursor &cursor, bool binary, StagedNodes &nodes) {
+  const long long count = cursor.tokens().integer();
+  if (count < 0)
+    throw std::runtime_error("GmshData::read(): Error reading Nodes section.");
+  nodes.tags.resize(count);
+  nodes.coordinates.resize(3 * count);
+
+  if (binary) {
+    const size_t recordSize = sizeof(int) + 3 * sizeof(double);
+    const char *data = cursor.skipBytes(count * recordSize);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, linesPerTask),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      for (size_t i = r.begin(); i != r.end(); ++i) {
+        const char *record = data + i * recordSize;
+        nodes.tags[i] = readValue<int>(record);
+        std::memcpy(&nodes.coordinates[3 * i], record + sizeof(int),
+                    3 * sizeof(double));
+      }
+    });
+  } else {
+    std::vector<std::pair<const char *, size_t>> chunks;
+    parseLinesInParallel(cursor, count, 0, chunks,
+                         [&](size_t chunk, const char *begin, size_t n) {
+      const char *p = begin;
+      for (size_t i = chunk * linesPerTask; i < chunk * linesPerTask + n;
+           ++i) {
+        const char *e = lineEnd(p, cursor.end());
+        LineTokens tokens(p, e);
+        nodes.tags[i] = checkedTag(tokens.integer());
+        for (int dim = 0; dim < 3; ++dim)
+          nodes.coordinates[3 * i + dim] = tokens.real();
+        if (!tokens.finished())
+          throw std::runtime_error(
+              "GmshData::read(): Wrong format of node definition detected.");
+        p = (e == cursor.end()) ? e : e + 1;
+      }
+    });
+  }
+  cursor.expectLine("$EndNodes", "Nodes");
+}
+
+void readElementsV2(Cursor &cursor, bool binary, const ElementFilter &filter,
+                    std::vector<StagedElements> &elements) {
+  const long long count = cursor.tokens().integer();
+  if (count < 0)
+    throw std::runtime_error(
+        "GmshData::read(): Error reading Elements section.");
+
+  if (binary) {
+    // Blocks of elements of the same type with the same number of tags
+    struct Block {
+      const char *data;
+      size_t first;
+      size_t count;
+      int type;
+      int tagCount;
+      int nodeCount;
+    };
+    std::vector<Block> blocks;
+    for (long long read = 0; read < count;) {
+      Block block;
+      block.type = cursor.binary<int>();
+      const int following = cursor.binary<int>();
+      block.tagCount = cursor.binary<int>();
+      block.nodeCount = nodesPerElementType(block.type);
+      if (block.nodeCount == 0 || following < 0 || block.tagCount < 0 ||
+          read + following > count)
+        throw std::runtime_error(
+            "GmshData::read(): Error reading Elements section.");
+      const size_t recordSize =
+          (1 + block.tagCount + block.nodeCount) * sizeof(int);
+      block.data = cursor.skipBytes(following * recordSize);
+      for (size_t first = 0; first < size_t(following);
+           first += linesPerTask) {
+        block.first = first;
+        block.count = std::min(linesPerTask, following - first);
+        blocks.push_back(block);
+      }
+      read += following;
+    }
+    elements.resize(blocks.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, blocks.size()),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      std::vector<int> record;
+      for (size_t b = r.begin(); b != r.end(); ++b) {
+        const Block &block = blocks[b];
+        const size_t recordLength = 1 + block.tagCount + block.nodeCount;
+        record.resize(recordLength);
+        StagedElements &staged = elements[b];
+        for (size_t i = block.first; i < block.first + block.count; ++i) {
+          std::memcpy(&record[0],
+                      block.data + i * recordLength * sizeof(int),
+                      recordLength * sizeof(int));
+          const int *tags = &record[1];
+          ElementRecord element;
+          element.index = record[0];
+          element.type = block.type;
+          element.physicalEntity = block.tagCount > 0 ? tags[0] : 0;
+          element.elementaryEntity = block.tagCount > 1 ? tags[1] : 0;
+          element.nodeCount = block.nodeCount;
+          element.partitionCount = block.tagCount > 2 ? tags[2] : 0;
+          if (element.partitionCount < 0 ||
+              element.partitionCount > block.tagCount - 3)
+            element.partitionCount = 0;
+          if (!filter.accepts(element.type, element.physicalEntity))
+            continue;
+          staged.records.push_back(element);
+          const int *nodes = tags + block.tagCount;
+          staged.values.insert(staged.values.end(), nodes,
+                               nodes + element.nodeCount);
+          staged.values.insert(staged.values.end(), tags + 3,
+                               tags + 3 + element.partitionCount);
+        }
+      }
+    });
+  } else {
+    std::vector<std::pair<const char *, size_t>> chunks;
+    elements.resize((count + linesPerTask - 1) / linesPerTask);
+    parseLinesInParallel(cursor, count, 0, chunks,
+                         [&](size_t chunk, const char *begin, size_t n) {
+      StagedElements &staged = elements[chunk];
+      std::vector<int> tags;
+      const char *p = begin;
+      for (size_t i = 0; i < n; ++i) {
+        const char *e = lineEnd(p, cursor.end());
+        LineTokens tokens(p, e);
+        ElementRecord element;
+        element.index = checkedTag(tokens.integer());
+        element.type = tokens.integer32();
+        const int tagCount = tokens.integer32();
+        tags.resize(std::max(tagCount, 0));
+        for (int j = 0; j < tagCount; ++j)
+          tags[j] = tokens.integer32();
+        element.physicalEntity = tagCount > 0 ? tags[0] : 0;
+        element.elementaryEntity = tagCount > 1 ? tags[1] : 0;
+        element.partitionCount = tagCount > 2 ? tags[2] : 0;
+        if (element.partitionCount < 0 ||
+            element.partitionCount > tagCount - 3)
+          element.partitionCount = 0;
+        p = (e == cursor.end()) ? e : e + 1;
+        if (!filter.accepts(element.type, element.physicalEntity))
+          continue;
+        const size_t valueCount = staged.values.size();
+        while (!tokens.finished())
+          staged.values.push_back(tokens.integer32());
+        element.nodeCount = staged.values.size() - valueCount;
+        staged.values.insert(staged.values.end(), tags.begin() + 3,
+                             tags.begin() + 3 + element.partitionCount);
+        staged.records.push_back(element);
+      }
+    });
+  }
+  cursor.expectLine("$EndElements", "Elements");
+}
+
+// Physical tags of the entities of each dimension, indexed by entity tag
+typedef std::vector<std::map<int, std::vector<int>>> EntityPhysicalTags;
+
+void readEntitiesV4(Cursor &cursor, bool binary,
+                    EntityPhysicalTags &physicalTags) {
+  physicalTags.assign(4, std::map<int, std::vector<int>>());
+  size_t counts[4];
+  if (binary) {
+    for (int dim = 0; dim < 4; ++dim)
+      counts[dim] = cursor.binary<size_t>();
+  } else {
+    LineTokens tokens = cursor.tokens();
+    for (int dim = 0; dim < 4; ++dim)
+      counts[dim] = tokens.integer();
+  }
+  for (int dim = 0; dim < 4; ++dim)
+    for (size_t i = 0; i < counts[dim]; ++i) {
+      // Points store their coordinates, other entities a bounding box and
+      // their bounding entities
+      const int coordinateCount = (dim == 0) ? 3 : 6;
+      if (binary) {
+        const int tag = cursor.binary<int>();
+        cursor.skipBytes(coordinateCount * sizeof(double));
+        std::vector<int> &tags = physicalTags[dim][tag];
+        tags.resize(cursor.binary<size_t>());
+        for (size_t j = 0; j < tags.size(); ++j)
+          tags[j] = cursor.binary<int>();
+        if (dim > 0)
+          cursor.skipBytes(cursor.binary<size_t>() * sizeof(int));
+      } else {
+        LineTokens tokens = cursor.tokens();
+        const int tag = tokens.integer32();
+        for (int j = 0; j < coordinateCount; ++j)
+          tokens.real();
+        std::vector<int> &tags = physicalTags[dim][tag];
+        tags.resize(tokens.integer());
+        for (size_t j = 0; j < tags.size(); ++j)
+          tags[j] = tokens.integer32();
+      }
+    }
+  cursor.expectLine("$EndEntities", "Entities");
+}
+
+void readNodesV4(Cursor &cursor, bool binary, StagedNodes &nodes) {
+  size_t blockCount, count;
+  if (binary) {
+    blockCount = cursor.binary<size_t>();
+    count = cursor.binary<size_t>();
+    cursor.skipBytes(2 * sizeof(size_t)); // minimum and maximum tags
+  } else {
+    LineTokens tokens = cursor.tokens();
+    blockCount = tokens.integer();
+    count = tokens.integer();
+  }
+  nodes.tags.resize(count);
+  nodes.coordinates.resize(3 * count);
+
+  size_t offset = 0;
+  std::vector<std::pair<const char *, size_t>> tagChunks, coordinateChunks;
+  for (size_t b = 0; b < blockCount; ++b) {
+    int entityDim, parametric;
+    size_t blockSize;
+    if (binary) {
+      entityDim = cursor.binary<int>();
+      cursor.binary<int>(); // entity tag
+      parametric = cursor.binary<int>();
+      blockSize = cursor.binary<size_t>();
+    } else {
+      LineTokens tokens = cursor.tokens();
+      entityDim = tokens.integer32();
+      tokens.integer32(); // entity tag
+      parametric = tokens.integer32();
+      blockSize = tokens.integer();
+    }
+    if (offset + blockSize > count)
+      throw std::runtime_error(
+          "GmshData::read(): Error reading Nodes section.");
+    // Parametric coordinates follow x, y and z and are not stored
+    const size_t valueCount = 3 + (parametric ? entityDim : 0);
+
+    if (binary) {
+      const char *tags = cursor.skipBytes(blockSize * sizeof(size_t));
+      const char *coordinates =
+          cursor.skipBytes(blockSize * valueCount * sizeof(double));
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, blockSize, linesPerTask),
+                        [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          nodes.tags[offset + i] =
+              checkedTag(readValue<size_t>(tags + i * sizeof(size_t)));
+          std::memcpy(&nodes.coordinates[3 * (offset + i)],
+                      coordinates + i * valueCount * sizeof(double),
+                      3 * sizeof(double));
+        }
+      });
+    } else {
+      const size_t tagChunk = tagChunks.size();
+      parseLinesInParallel(cursor, blockSize, tagChunk, tagChunks,
+                           [&](size_t chunk, const char *begin, size_t n) {
+        const size_t first = offset + (chunk - tagChunk) * linesPerTask;
+        const char *p = begin;
+        for (size_t i = first; i < first + n; ++i) {
+          const char *e = lineEnd(p, cursor.end());
+          nodes.tags[i] = checkedTag(LineTokens(p, e).integer());
+          p = (e == cursor.end()) ? e : e + 1;
+        }
+      });
+      const size_t coordinateChunk = coordinateChunks.size();
+      parseLinesInParallel(cursor, blockSize, coordinateChunk,
+                           coordinateChunks,
+                           [&](size_t chunk, const char *begin, size_t n) {
+        const size_t first = offset + (chunk - coordinateChunk) * linesPerTask;
+        const char *p = begin;
+        for (size_t i = first; i < first + n; ++i) {
+          const char *e = lineEnd(p, cursor.end());
+          LineTokens tokens(p, e);
+          for (int dim = 0; dim < 3; ++dim)
+            nodes.coordinates[3 * i + dim] = tokens.real();
+          p = (e == cursor.end()) ? e : e + 1;
+        }
+      });
+    }
+    offset += blockSize;
+  }
+  if (offset != count)
+    throw std::runtime_error("GmshData::read(): Error reading Nodes section.");
+  cursor.expectLine("$EndNodes", "Nodes");
+}
+
+void readElementsV4(Cursor &cursor, bool binary,
+                    const EntityPhysicalTags &physicalTags,
+                    const ElementFilter &filter,
+                    std::vector<StagedElements> &elements) {
+  size_t blockCount, count;
+  if (binary) {
+    blockCount = cursor.binary<size_t>();
+    count = cursor.binary<size_t>();
+    cursor.skipBytes(2 * sizeof(size_t)); // minimum and maximum tags
+  } else {
+    LineTokens tokens = cursor.tokens();
+    blockCount = tokens.integer();
+    count = tokens.integer();
+  }
+
+  // Parts of blocks of elements of the same type and entity
+  struct Block {
+    const char *data;
+    size_t count;
+    int type;
+    int nodeCount;
+    int entityTag;
+    int physicalEntity;
+  };
+  std::vector<Block> blocks;
+  size_t read = 0;
+  for (size_t b = 0; b < blockCount; ++b) {
+    int entityDim, entityTag, type;
+    size_t blockSize;
+    if (binary) {
+      entityDim = cursor.binary<int>();
+      entityTag = cursor.binary<int>();
+      type = cursor.binary<int>();
+      blockSize = cursor.binary<size_t>();
+    } else {
+      LineTokens tokens = cursor.tokens();
+      entityDim = tokens.integer32();
+      entityTag = tokens.integer32();
+      type = tokens.integer32();
+      blockSize = tokens.integer();
+    }
+    Block block;
+    block.type = type;
+    block.nodeCount = nodesPerElementType(type);
+    block.entityTag = entityTag;
+    if (block.nodeCount == 0 || entityDim < 0 || entityDim > 3 ||
+        read + blockSize > count)
+      throw std::runtime_error(
+          "GmshData::read(): Error reading Elements section.");
+    read += blockSize;
+
+    // MSH 4 assigns physical tags to entities rather than elements. If a
+    // physical entity is requested, elements of entities carrying it are
+    // kept; otherwise the first physical tag of the entity (if any) is used.
+    block.physicalEntity = 0;
+    std::map<int, std::vector<int>>::const_iterator entity =
+        physicalTags[entityDim].find(entityTag);
+    if (entity != physicalTags[entityDim].end() && !entity->second.empty())
+      block.physicalEntity = entity->second.front();
+    if (filter.physicalEntity != -1) {
+      bool found = false;
+      if (entity != physicalTags[entityDim].end())
+        found = std::find(entity->second.begin(), entity->second.end(),
+                          filter.physicalEntity) != entity->second.end();
+      block.physicalEntity = found ? filter.physicalEntity : -1;
+    }
+    const bool skip = !filter.accepts(type, block.physicalEntity);
+
+    if (binary) {
+      const size_t recordSize = (1 + block.nodeCount) * sizeof(size_t);
+      const char *data = cursor.skipBytes(blockSize * recordSize);
+      for (size_t first = 0; first < blockSize && !skip;
+           first += linesPerTask) {
+        block.data = data + first * recordSize;
+        block.count = std::min(linesPerTask, blockSize - first);
+        blocks.push_back(block);
+      }
+    } else {
+      for (size_t first = 0; first < blockSize; first += linesPerTask) {
+        block.data = cursor.position();
+        block.count = std::min(linesPerTask, blockSize - first);
+        const char *p = block.data;
+        for (size_t i = 0; i < block.count; ++i) {
+          if (p == cursor.end())
+            throw std::runtime_error(
+                "GmshData::read(): Unexpected end of file.");
+          p = nextLine(p, cursor.end());
+        }
+        cursor.setPosition(p);
+        if (!skip)
+          blocks.push_back(block);
+      }
+    }
+  }
+  if (read != count)
+    throw std::runtime_error(
+        "GmshData::read(): Error reading Elements section.");
+
+  elements.resize(blocks.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, blocks.size()),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t b = r.begin(); b != r.end(); ++b) {
+      const Block &block = blocks[b];
+      StagedElements &staged = elements[b];
+      staged.records.resize(block.count);
+      staged.values.resize(block.count * block.nodeCount);
+      const char *p = block.data;
+      for (size_t i = 0; i < block.count; ++i) {
+        ElementRecord &element = staged.records[i];
+        element.type = block.type;
+        element.physicalEntity = block.physicalEntity;
+        element.elementaryEntity = block.entityTag;
+        element.nodeCount = block.nodeCount;
+        element.partitionCount = 0;
+        int *nodes = &staged.values[i * block.nodeCount];
+        if (binary) {
+          element.index = checkedTag(readValue<size_t>(p));
+          for (int j = 0; j < block.nodeCount; ++j)
+            nodes[j] =
+                checkedTag(readValue<size_t>(p + (1 + j) * sizeof(size_t)));
+          p += (1 + block.nodeCount) * sizeof(size_t);
+        } else {
+          const char *e = lineEnd(p, cursor.end());
+          LineTokens tokens(p, e);
+          element.index = checkedTag(tokens.integer());
+          for (int j = 0; j < block.nodeCount; ++j)
+            nodes[j] = checkedTag(tokens.integer());
+          p = (e == cursor.end()) ? e : e + 1;
+        }
+      }
+    }
+  });
+  cursor.expectLine("$EndElements", "Elements");
+}
+
+// Tags preceding the values of a $NodeData, $ElementData or
+// $ElementNodeData section
+struct DataHeader {
+  std::vector<std::string> stringTags;
+  std::vector<double> realTags;
+  int timeStep;
+  int numberOfFieldComponents;
+  int count;
+  int partition;
+};
+
+void readDataHeader(Cursor &cursor, DataHeader &header) {
+  const long long numberOfStringTags = cursor.tokens().integer();
+  header.stringTags.clear();
+  for (long long i = 0; i < numberOfStringTags; ++i) {
+    std::string line = cursor.line();
+    line.erase(std::remove(line.begin(), line.end(), '\"'), line.end());
+    header.stringTags.push_back(line);
+  }
+
+  // Real tags
+  const long long numberOfRealTags = cursor.tokens().integer();
+  header.realTags.clear();
+  for (long long i = 0; i < numberOfRealTags; ++i)
+    header.realTags.push_back(cursor.tokens().real());
+
+  // Integer tags
+  const long long numberOfIntegerTags = cursor.tokens().integer();
+  if (numberOfIntegerTags < 3)
+    throw std::runtime_error(
+        "GmshData::read(): At least 3 integer tags required.");
+  std::vector<int> integerTags;
+  for (long long i = 0; i < numberOfIntegerTags; ++i)
+    integerTags.push_back(cursor.tokens().integer32());
+  header.timeStep = integerTags[0];
+  header.numberOfFieldComponents = integerTags[1];
+  header.count = integerTags[2];
+  header.partition = 0;
+  if (integerTags.size() > 3)
+    header.partition = integerTags[3];
+}
+
+// Split the componentCount values of each of entityCount entities, stored
+// contiguously, into one vector per entity
+void unflatten(const double *values, size_t entityCount, int componentCount,
+               std::vector<std::vector<double>> &result) {
+  result.resize(entityCount);
+  for (size_t i = 0; i < entityCount; ++i)
+    result[i].assign(values + i * componentCount,
+                     values + (i + 1) * componentCount);
+}
+
+// Append count values in their native representation to buffer
+template <typename T>
+void appendBinary(std::string &buffer, const T *values, size_t count) {
+  buffer.append(reinterpret_cast<const char *>(values), count * sizeof(T));
+}
+
+// Write the binary records collected in buffer, terminated by a newline
+void flushBinary(std::ostream &output, std::string &buffer) {
+  output.write(buffer.data(), buffer.size());
+  output << std::endl;
+  buffer.clear();
+}
+
+// Number of tags of an element in MSH 2 files
+int elementTagCount(int partitionCount) {
+  return partitionCount ? 3 + partitionCount : 2;
+}
+
+// Write the tags of a $NodeData, $ElementData or $ElementNodeData section
+// describing count records
+template <typename DataSet>
+void writeDataHeader(std::ostream &output, const DataSet &dataSet,
+                     size_t count) {
+  output << dataSet.stringTags.size() << std::endl;
+  for (size_t i = 0; i < dataSet.stringTags.size(); ++i)
+    output << '\"' + dataSet.stringTags[i] + '\"' << std::endl;
+  output << dataSet.realTags.size() << std::endl;
+  for (size_t i = 0; i < dataSet.realTags.size(); ++i)
+    output << boost::lexical_cast<std::string>(dataSet.realTags[i])
+           << std::endl;
+  output << 4 << std::endl; // Number of integer tags
+  output << dataSet.timeStep << std::endl;
+  output << dataSet.numberOfFieldComponents << std::endl;
+  output << count << std::endl;
+  output << dataSet.partition << std::endl;
+}
+
+// Write the records of a data section. Each record consists of an entity
+// index, for element-node data the number of nodes (nodeCounts), and the
+// componentCount values of each node.
+void writeEntityValues(std::ostream &output, const std::vector<int> &indices,
+                       const std::vector<int> *nodeCounts,
+                       const std::vector<double> &values, int componentCount,
+                       bool binary) {
+  const double *entityValues = values.data();
+  if (binary) {
+    std::string buffer;
+    buffer.reserve(indices.size() * (2 * sizeof(int)) +
+                   values.size() * sizeof(double));
+    for (size_t i = 0; i < indices.size(); ++i) {
+      const int nodeCount = nodeCounts ? (*nodeCounts)[i] : 1;
+      appendBinary(buffer, &indices[i], 1);
+      if (nodeCounts)
+        appendBinary(buffer, &nodeCount, 1);
+      appendBinary(buffer, entityValues, size_t(nodeCount) * componentCount);
+      entityValues += size_t(nodeCount) * componentCount;
+    }
+    flushBinary(output, buffer);
+    return;
+  }
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const int nodeCount = nodeCounts ? (*nodeCounts)[i] : 1;
+    output << indices[i];
+    if (nodeCounts)
+      output << " " << nodeCount;
+    for (size_t j = 0; j < size_t(nodeCount) * componentCount; ++j)
+      output << " " << boost::lexical_cast<std::string>(entityValues[j]);
+    output << std::endl;
+    entityValues += size_t(nodeCount) * componentCount;
+  }
+}
+
+// Parts of complex values exported by exportToGmsh()
+enum ComplexPart {
+  REAL_PART,
+  IMAG_PART,
+  ABSOLUTE_VALUE
+};
+
+template <typename T>
+void takePart(const T *values, size_t count, ComplexPart part,
+              double *result) {
+  for (size_t i = 0; i < count; ++i)
+    result[i] = part == REAL_PART
+                    ? Fiber::realPart(values[i])
+                    : part == IMAG_PART ? Fiber::imagPart(values[i])
+                                        : std::abs(values[i]);
+}
+
+// Entity tags of binary data records are int in MSH 2 and size_t in MSH 4
+int readBinaryTag(Cursor &cursor, int version) {
+  if (version == 4)
+    return checkedTag(cursor.binary<size_t>());
+  return cursor.binary<int>();
+}
+
 } // namespace
 
 namespace Bempp {
@@ -98,16 +1047,20 @@ int GmshData::numberOfInterpolationSchemeSets() const {
 
 void GmshData::addNode(int index, double x, double y, double z) {
 
-  if (index >= m_nodes.size())
-    m_nodes.resize(index + 1);
-  if (!m_nodes[index]) {
-    m_nodes[index] = shared_ptr<Node>(new Node());
+  if (index < 0)
+    throw std::runtime_error("GmshData::addNode(): Negative index.");
+  if (index >= m_nodeDefined.size()) {
+    m_nodeDefined.resize(index + 1, 0);
+    m_nodeCoordinates.resize(3 * (index + 1));
+  }
+  if (!m_nodeDefined[index]) {
+    m_nodeDefined[index] = 1;
     ++m_numberOfNodes;
   }
 
-  m_nodes[index]->x = x;
-  m_nodes[index]->y = y;
-  m_nodes[index]->z = z;
+  m_nodeCoordinates[3 * index] = x;
+  m_nodeCoordinates[3 * index + 1] = y;
+  m_nodeCoordinates[3 * index + 2] = z;
 }
 
 void GmshData::addElement(int index, int elementType,
@@ -115,18 +1068,44 @@ void GmshData::addElement(int index, int elementType,
                           int elementaryEntity,
                           const std::vector<int> &partitions) {
 
-  if (index >= m_elements.size())
-    m_elements.resize(index + 1);
-  if (!m_elements[index]) {
-    m_elements[index] = shared_ptr<Element>(new Element());
-    ++m_numberOfElements;
+  addElement(index, elementType, nodes.empty() ? 0 : &nodes[0], nodes.size(),
+             physicalEntity, elementaryEntity,
+             partitions.empty() ? 0 : &partitions[0], partitions.size());
+}
+
+void GmshData::addElement(int index, int elementType, const int *nodes,
+                          int nodeCount, int physicalEntity,
+                          int elementaryEntity, const int *partitions,
+                          int partitionCount) {
+
+  if (index < 0)
+    throw std::runtime_error("GmshData::addElement(): Negative index.");
+  if (elementType <= 0)
+    throw std::runtime_error("GmshData::addElement(): Invalid element type.");
+  if (index >= m_elements.size()) {
+    Element undefined = {};
+    m_elements.resize(index + 1, undefined);
   }
+  Element &element = m_elements[index];
+  if (element.type == 0)
+    ++m_numberOfElements;
+
+  element.type = elementType;
+  element.physicalEntity = physicalEntity;
+  element.elementaryEntity = elementaryEntity;
+  element.nodeCount = nodeCount;
+  element.nodeOffset = m_elementNodes.size();
+  m_elementNodes.insert(m_elementNodes.end(), nodes, nodes + nodeCount);
+  element.partitionCount = partitionCount;
+  element.partitionOffset = m_elementPartitions.size();
+  m_elementPartitions.insert(m_elementPartitions.end(), partitions,
+                             partitions + partitionCount);
+}
 
-  m_elements[index]->type = elementType;
-  m_elements[index]->physicalEntity = physicalEntity;
-  m_elements[index]->elementaryEntity = elementaryEntity;
-  m_elements[index]->nodes = nodes;
-  m_elements[index]->partitions = partitions;
+bool GmshData::hasElement(int index) const {
+
+  return index >= 0 && index < m_elements.size() &&
+         m_elements[index].type != 0;
 }
 
 void GmshData::addPeriodicEntity(int dimension, int slaveEntityTag,
@@ -171,7 +1150,7 @@ void GmshData::addNodeDataSet(const std::vector<std::string> &stringTags,
   data.numberOfFieldComponents = numberOfFieldComponents;
   data.partition = partition;
   data.nodeIndices.reserve(capacity);
-  data.values.reserve(capacity);
+  data.values.reserve(size_t(capacity) * numberOfFieldComponents);
 }
 void GmshData::addElementDataSet(const std::vector<std::string> &stringTags,
                                  const std::vector<double> &realTags,
@@ -187,7 +1166,7 @@ void GmshData::addElementDataSet(const std::vector<std::string> &stringTags,
   data.numberOfFieldComponents = numberOfFieldComponents;
   data.partition = partition;
   data.elementIndices.reserve(capacity);
-  data.values.reserve(capacity);
+  data.values.reserve(size_t(capacity) * numberOfFieldComponents);
 }
 void GmshData::addElementNodeDataSet(const std::vector<std::string> &stringTags,
                                      const std::vector<double> &realTags,
@@ -204,22 +1183,25 @@ void GmshData::addElementNodeDataSet(const std::vector<std::string> &stringTags,
   data.numberOfFieldComponents = numberOfFieldComponents;
   data.partition = partition;
   data.elementIndices.reserve(capacity);
-  data.values.reserve(capacity);
+  data.nodeCounts.reserve(capacity);
 }
 
 void GmshData::addNodeData(int dataSetIndex, int node,
                            const std::vector<double> &values) {
 
-  NodeDataSet &nodeDataSet = *m_nodeDataSets.at(dataSetIndex);
-  nodeDataSet.nodeIndices.push_back(node);
-  nodeDataSet.values.push_back(values);
+  if (values.size() != m_nodeDataSets.at(dataSetIndex)->numberOfFieldComponents)
+    throw std::runtime_error(
+        "GmshData::addNodeData(): Wrong number of values.");
+  addNodeData(dataSetIndex, node, values.data());
 }
 void GmshData::addElementData(int dataSetIndex, int element,
                               const std::vector<double> &values) {
 
-  ElementDataSet &elementDataSet = *m_elementDataSets.at(dataSetIndex);
-  elementDataSet.elementIndices.push_back(element);
-  elementDataSet.values.push_back(values);
+  if (values.size() !=
+      m_elementDataSets.at(dataSetIndex)->numberOfFieldComponents)
+    throw std::runtime_error(
+        "GmshData::addElementData(): Wrong number of values.");
+  addElementData(dataSetIndex, element, values.data());
 }
 void
 GmshData::addElementNodeData(int dataSetIndex, int element,
@@ -227,8 +1209,46 @@ GmshData::addElementNodeData(int dataSetIndex, int element,
 
   ElementNodeDataSet &elementNodeDataSet =
       *m_elementNodeDataSets.at(dataSetIndex);
+  const size_t componentCount = elementNodeDataSet.numberOfFieldComponents;
+  elementNodeDataSet.elementIndices.push_back(element);
+  elementNodeDataSet.nodeCounts.push_back(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i].size() != componentCount)
+      throw std::runtime_error(
+          "GmshData::addElementNodeData(): Wrong number of values.");
+    elementNodeDataSet.values.insert(elementNodeDataSet.values.end(),
+                                     values[i].begin(), values[i].end());
+  }
+}
+
+void GmshData::addNodeData(int dataSetIndex, int node, const double *values) {
+
+  NodeDataSet &nodeDataSet = *m_nodeDataSets.at(dataSetIndex);
+  nodeDataSet.nodeIndices.push_back(node);
+  nodeDataSet.values.insert(nodeDataSet.values.end(), values,
+                            values + nodeDataSet.numberOfFieldComponents);
+}
+void GmshData::addElementData(int dataSetIndex, int element,
+                              const double *values) {
+
+  ElementDataSet &elementDataSet = *m_elementDataSets.at(dataSetIndex);
+  elementDataSet.elementIndices.push_back(element);
+  elementDataSet.values.insert(elementDataSet.values.end(), values,
+                               values + elementDataSet.numberOfFieldComponents);
+}
+void GmshData::addElementNodeData(int dataSetIndex, int element,
+                                  int nodeCount, const double *values) {
+
+  ElementNodeDataSet &elementNodeDataSet =
+      *m_elementNodeDataSets.at(dataSetIndex);
+  if (nodeCount < 0)
+    throw std::runtime_error(
+        "GmshData::addElementNodeData(): Negative number of nodes.");
   elementNodeDataSet.elementIndices.push_back(element);
-  elementNodeDataSet.values.push_back(values);
+  elementNodeDataSet.nodeCounts.push_back(nodeCount);
+  elementNodeDataSet.values.insert(
+      elementNodeDataSet.values.end(), values,
+      values + size_t(nodeCount) * elementNodeDataSet.numberOfFieldComponents);
 }
 
 void GmshData::addInterpolationSchemeSet(std::string name, int topology) {
@@ -253,8 +1273,8 @@ void GmshData::getNodeIndices(std::vector<int> &indices) const {
 
   indices.clear();
   indices.reserve(m_numberOfNodes);
-  for (int i = 0; i < m_nodes.size(); i++)
-    if (m_nodes[i])
+  for (int i = 0; i < m_nodeDefined.size(); i++)
+    if (m_nodeDefined[i])
       indices.push_back(i);
 }
 
@@ -263,37 +1283,35 @@ void GmshData::getElementIndices(std::vector<int> &indices) const {
   indices.clear();
   indices.reserve(m_numberOfElements);
   for (int i = 0; i < m_elements.size(); i++)
-    if (m_elements[i])
+    if (m_elements[i].type != 0)
       indices.push_back(i);
 }
 
 void GmshData::getNode(int index, double &x, double &y, double &z) const {
 
-  if (index >= m_nodes.size())
-    throw std::runtime_error("GmshData::getNode(): Index does not exist.");
-  if (m_nodes[index]) {
-    x = m_nodes[index]->x;
-    y = m_nodes[index]->y;
-    z = m_nodes[index]->z;
-  } else
+  if (index < 0 || index >= m_nodeDefined.size() || !m_nodeDefined[index])
     throw std::runtime_error("GmshData::getNode(): Index does not exist.");
+  x = m_nodeCoordinates[3 * index];
+  y = m_nodeCoordinates[3 * index + 1];
+  z = m_nodeCoordinates[3 * index + 2];
 }
 
 void GmshData::getElement(int index, int &elementType, std::vector<int> &nodes,
                           int &physicalEntity, int &elementaryEntity,
                           std::vector<int> &partitions) const {
 
-  if (index >= m_elements.size())
+  if (!hasElement(index))
     throw std::runtime_error("GmshData::getElement(): Index does not exist.");
 
-  if (m_elements[index]) {
-    elementType = m_elements[index]->type;
-    nodes = m_elements[index]->nodes;
-    physicalEntity = m_elements[index]->physicalEntity;
-    elementaryEntity = m_elements[index]->elementaryEntity;
-    partitions = m_elements[index]->partitions;
-  } else
-    throw std::runtime_error("GmshData::getElement(): Index does not exist.");
+  const Element &element = m_elements[index];
+  elementType = element.type;
+  nodes.assign(m_elementNodes.begin() + element.nodeOffset,
+               m_elementNodes.begin() + element.nodeOffset + element.nodeCount);
+  physicalEntity = element.physicalEntity;
+  elementaryEntity = element.elementaryEntity;
+  partitions.assign(m_elementPartitions.begin() + element.partitionOffset,
+                    m_elementPartitions.begin() + element.partitionOffset +
+                        element.partitionCount);
 }
 void GmshData::getElement(int index, int &elementType, std::vector<int> &nodes,
                           int &physicalEntity, int &elementaryEntity) const {
@@ -351,7 +1369,9 @@ void GmshData::getNodeDataSet(int index, std::vector<std::string> &stringTags,
     realTags = m_nodeDataSets[index]->realTags;
     numberOfFieldComponents = m_nodeDataSets[index]->numberOfFieldComponents;
     nodeIndices = m_nodeDataSets[index]->nodeIndices;
-    values = m_nodeDataSets[index]->values;
+    unflatten(m_nodeDataSets[index]->values.data(),
+              m_nodeDataSets[index]->nodeIndices.size(),
+              numberOfFieldComponents, values);
     timeStep = m_nodeDataSets[index]->timeStep;
     partition = m_nodeDataSets[index]->partition;
   } else
@@ -381,7 +1401,9 @@ void GmshData::getElementDataSet(int index,
     realTags = m_elementDataSets[index]->realTags;
     numberOfFieldComponents = m_elementDataSets[index]->numberOfFieldComponents;
     elementIndices = m_elementDataSets[index]->elementIndices;
-    values = m_elementDataSets[index]->values;
+    unflatten(m_elementDataSets[index]->values.data(),
+              m_elementDataSets[index]->elementIndices.size(),
+              numberOfFieldComponents, values);
     timeStep = m_elementDataSets[index]->timeStep;
     partition = m_elementDataSets[index]->partition;
   } else
@@ -412,8 +1434,15 @@ void GmshData::getElementNodeDataSet(
     realTags = m_elementNodeDataSets[index]->realTags;
     numberOfFieldComponents =
         m_elementNodeDataSets[index]->numberOfFieldComponents;
-    elementIndices = m_elementNodeDataSets[index]->elementIndices;
-    values = m_elementNodeDataSets[index]->values;
+    const ElementNodeDataSet &dataSet = *m_elementNodeDataSets[index];
+    elementIndices = dataSet.elementIndices;
+    values.resize(dataSet.nodeCounts.size());
+    const double *elementValues = dataSet.values.data();
+    for (size_t i = 0; i < values.size(); ++i) {
+      unflatten(elementValues, dataSet.nodeCounts[i], numberOfFieldComponents,
+                values[i]);
+      elementValues += dataSet.nodeCounts[i] * numberOfFieldComponents;
+    }
     timeStep = m_elementNodeDataSets[index]->timeStep;
     partition = m_elementNodeDataSets[index]->partition;
   } else
@@ -448,31 +1477,49 @@ void GmshData::getInterpolationSchemeSet(
         "Gmsh::getInterpolationSchemeSet(): Index does not exist.");
 }
 
-void GmshData::reserveNumberOfNodes(int n) { m_nodes.reserve(n + 1); }
+void GmshData::reserveNumberOfNodes(int n) {
+  m_nodeDefined.reserve(n + 1);
+  m_nodeCoordinates.reserve(3 * (n + 1));
+}
 void GmshData::reserveNumberOfElements(int n) { m_elements.reserve(n + 1); }
 
-void GmshData::write(std::ostream &output) const {
+void GmshData::write(std::ostream &output, GmshFileFormat::Type format) const {
 
+  const bool binary = (format == GmshFileFormat::BINARY);
   output << "$MeshFormat" << std::endl;
   output << "2.2"
-         << " " << 0 << " " << sizeof(double) << std::endl;
+         << " " << (binary ? 1 : 0) << " " << sizeof(double) << std::endl;
+  if (binary) {
+    // Lets readers detect the byte order
+    const int one = 1;
+    output.write(reinterpret_cast<const char *>(&one), sizeof(int));
+    output << std::endl;
+  }
   output << "$EndMeshFormat" << std::endl;
 
+  std::string buffer;
   if (m_numberOfNodes > 0) {
     std::vector<int> nodeIndices;
     getNodeIndices(nodeIndices);
 
     output << "$Nodes" << std::endl;
     output << m_numberOfNodes << std::endl;
-    for (int i = 0; i < m_numberOfNodes; i++) {
-      output << nodeIndices[i] << " "
-             << boost::lexical_cast<std::string>(m_nodes[nodeIndices[i]]->x)
-             << " "
-             << boost::lexical_cast<std::string>(m_nodes[nodeIndices[i]]->y)
-             << " "
-             << boost::lexical_cast<std::string>(m_nodes[nodeIndices[i]]->z)
-             << std::endl;
-    }
+    if (binary) {
+      buffer.reserve(m_numberOfNodes * (sizeof(int) + 3 * sizeof(double)));
+      for (int i = 0; i < m_numberOfNodes; i++) {
+        appendBinary(buffer, &nodeIndices[i], 1);
+        appendBinary(buffer, &m_nodeCoordinates[3 * nodeIndices[i]], 3);
+      }
+      flushBinary(output, buffer);
+    } else
+      for (int i = 0; i < m_numberOfNodes; i++) {
+        const double *coordinates = &m_nodeCoordinates[3 * nodeIndices[i]];
+        output << nodeIndices[i] << " "
+               << boost::lexical_cast<std::string>(coordinates[0]) << " "
+               << boost::lexical_cast<std::string>(coordinates[1]) << " "
+               << boost::lexical_cast<std::string>(coordinates[2])
+               << std::endl;
+      }
     output << "$EndNodes" << std::endl;
   }
 
@@ -481,21 +1528,53 @@ void GmshData::write(std::ostream &output) const {
     getElementIndices(elementIndices);
     output << "$Elements" << std::endl;
     output << m_numberOfElements << std::endl;
-    for (int i = 0; i < m_numberOfElements; i++) {
-      Element &element = *m_elements[elementIndices[i]];
-      int ntags;
-      if (element.partitions.size())
-        ntags = 3 + element.partitions.size();
-      else
-        ntags = 2;
-      output << elementIndices[i] << " " << element.type << " " << ntags << " "
-             << element.physicalEntity << " " << element.elementaryEntity;
-      for (int j = 0; j < element.partitions.size(); j++)
-        output << " " << element.partitions[j];
-      for (int j = 0; j < element.nodes.size(); j++)
-        output << " " << element.nodes[j];
-      output << std::endl;
-    }
+    if (binary) {
+      // Consecutive elements of the same type with the same number of tags
+      // form one block of records
+      for (int i = 0; i < m_numberOfElements;) {
+        const Element &first = m_elements[elementIndices[i]];
+        if (first.nodeCount != nodesPerElementType(first.type))
+          throw std::runtime_error("GmshData::write(): Element type " +
+                                   boost::lexical_cast<std::string>(
+                                       first.type) +
+                                   " cannot be written in binary format.");
+        int end = i + 1;
+        while (end < m_numberOfElements &&
+               m_elements[elementIndices[end]].type == first.type &&
+               m_elements[elementIndices[end]].partitionCount ==
+                   first.partitionCount)
+          ++end;
+        const int header[3] = {first.type, end - i,
+                               elementTagCount(first.partitionCount)};
+        appendBinary(buffer, header, 3);
+        for (; i < end; ++i) {
+          const Element &element = m_elements[elementIndices[i]];
+          const int tags[4] = {elementIndices[i], element.physicalEntity,
+                               element.elementaryEntity,
+                               element.partitionCount};
+          appendBinary(buffer, tags, element.partitionCount ? 4 : 3);
+          appendBinary(buffer,
+                       m_elementPartitions.data() + element.partitionOffset,
+                       element.partitionCount);
+          appendBinary(buffer, m_elementNodes.data() + element.nodeOffset,
+                       element.nodeCount);
+        }
+      }
+      flushBinary(output, buffer);
+    } else
+      for (int i = 0; i < m_numberOfElements; i++) {
+        const Element &element = m_elements[elementIndices[i]];
+        output << elementIndices[i] << " " << element.type << " "
+               << elementTagCount(element.partitionCount) << " "
+               << element.physicalEntity << " " << element.elementaryEntity;
+        if (element.partitionCount)
+          output << " " << element.partitionCount;
+        for (int j = 0; j < element.partitionCount; j++)
+          output << " " << m_elementPartitions[element.partitionOffset + j];
+        for (int j = 0; j < element.nodeCount; j++)
+          output << " " << m_elementNodes[element.nodeOffset + j];
+        output << std::endl;
+      }
     output << "$EndElements" << std::endl;
   }
 
@@ -518,6 +1597,7 @@ void GmshData::write(std::ostream &output) const {
 
   if (m_physicalNames.size() > 0) {
     output << "$PhysicalNames" << std::endl;
+    output << m_physicalNames.size() << std::endl;
     for (int i = 0; i < m_physicalNames.size(); ++i) {
       output << m_physicalNames[i].dimension << " " << m_physicalNames[i].number
              << " " << m_physicalNames[i].name << std::endl;
@@ -525,99 +1605,37 @@ void GmshData::write(std::ostream &output) const {
     output << "$EndPhysicalNames" << std::endl;
   }
 
-  if (m_nodeDataSets.size() > 0) {
-    for (int i = 0; i < m_nodeDataSets.size(); ++i) {
-
-      NodeDataSet &nodeDataSet = *m_nodeDataSets[i];
-      output << "$NodeData" << std::endl;
-      output << nodeDataSet.stringTags.size() << std::endl;
-      for (int i = 0; i < nodeDataSet.stringTags.size(); ++i) {
-        output << '\"' + nodeDataSet.stringTags[i] + '\"' << std::endl;
-      }
-      output << nodeDataSet.realTags.size() << std::endl;
-      for (int i = 0; i < nodeDataSet.realTags.size(); ++i) {
-        output << boost::lexical_cast<std::string>(nodeDataSet.realTags[i])
-               << std::endl;
-      }
-      output << 4 << std::endl; // Number of integer tags
-      output << nodeDataSet.timeStep << std::endl;
-      output << nodeDataSet.numberOfFieldComponents << std::endl;
-      output << nodeDataSet.values.size() << std::endl;
-      output << nodeDataSet.partition << std::endl;
-      for (int i = 0; i < nodeDataSet.values.size(); ++i) {
-        output << nodeDataSet.nodeIndices[i];
-        for (int j = 0; j < nodeDataSet.values[i].size(); ++j) {
-          output << " "
-                 << boost::lexical_cast<std::string>(nodeDataSet.values[i][j]);
-        }
-        output << std::endl;
-      }
-      output << "$EndNodeData" << std::endl;
-    }
+  for (int i = 0; i < m_nodeDataSets.size(); ++i) {
+    const NodeDataSet &nodeDataSet = *m_nodeDataSets[i];
+    output << "$NodeData" << std::endl;
+    writeDataHeader(output, nodeDataSet, nodeDataSet.nodeIndices.size());
+    writeEntityValues(output, nodeDataSet.nodeIndices, 0,
+                      nodeDataSet.values, nodeDataSet.numberOfFieldComponents,
+                      binary);
+    output << "$EndNodeData" << std::endl;
   }
 
-  if (m_elementDataSets.size() > 0) {
-    for (int i = 0; i < m_elementDataSets.size(); ++i) {
-
-      ElementDataSet &elementDataSet = *m_elementDataSets[i];
-      output << "$ElementData" << std::endl;
-      output << elementDataSet.stringTags.size() << std::endl;
-      for (int i = 0; i < elementDataSet.stringTags.size(); ++i) {
-        output << '\"' + elementDataSet.stringTags[i] + '\"' << std::endl;
-      }
-      output << elementDataSet.realTags.size() << std::endl;
-      for (int i = 0; i < elementDataSet.realTags.size(); ++i) {
-        output << boost::lexical_cast<std::string>(elementDataSet.realTags[i])
-               << std::endl;
-      }
-      output << 4 << std::endl; // Number of integer tags
-      output << elementDataSet.timeStep << std::endl;
-      output << elementDataSet.numberOfFieldComponents << std::endl;
-      output << elementDataSet.values.size() << std::endl;
-      output << elementDataSet.partition << std::endl;
-      for (int i = 0; i < elementDataSet.values.size(); ++i) {
-        output << elementDataSet.elementIndices[i];
-        for (int j = 0; j < elementDataSet.values[i].size(); ++j) {
-          output << " " << boost::lexical_cast<std::string>(
-                               elementDataSet.values[i][j]);
-        }
-        output << std::endl;
-      }
-      output << "$EndElementData" << std::endl;
-    }
+  for (int i = 0; i < m_elementDataSets.size(); ++i) {
+    const ElementDataSet &elementDataSet = *m_elementDataSets[i];
+    output << "$ElementData" << std::endl;
+    writeDataHeader(output, elementDataSet,
+                    elementDataSet.elementIndices.size());
+    writeEntityValues(output, elementDataSet.elementIndices, 0,
+                      elementDataSet.values,
+                      elementDataSet.numberOfFieldComponents, binary);
+    output << "$EndElementData" << std::endl;
   }
 
-  if (m_elementNodeDataSets.size() > 0) {
-    for (int i = 0; i < m_elementNodeDataSets.size(); ++i) {
-
-      ElementNodeDataSet &elementNodeDataSet = *m_elementNodeDataSets[i];
-      output << "$ElementNodeData" << std::endl;
-      output << elementNodeDataSet.stringTags.size() << std::endl;
-      for (int i = 0; i < elementNodeDataSet.stringTags.size(); ++i) {
-        output << '\"' + elementNodeDataSet.stringTags[i] + '\"' << std::endl;
-      }
-      output << elementNodeDataSet.realTags.size() << std::endl;
-      for (int i = 0; i < elementNodeDataSet.realTags.size(); ++i) {
-        output << boost::lexical_cast<std::string>(
-                      elementNodeDataSet.realTags[i]) << std::endl;
-      }
-      output << 4 << std::endl; // Number of integer tags
-      output << elementNodeDataSet.timeStep << std::endl;
-      output << elementNodeDataSet.numberOfFieldComponents << std::endl;
-      output << elementNodeDataSet.values.size() << std::endl;
-      output << elementNodeDataSet.partition << std::endl;
-      for (int i = 0; i < elementNodeDataSet.values.size(); ++i) {
-        output << elementNodeDataSet.elementIndices[i] << " "
-               << elementNodeDataSet.values[i].size();
-        for (int j = 0; j < elementNodeDataSet.values[i].size(); ++j) {
-          for (int k = 0; k < elementNodeDataSet.values[i][j].size(); ++k)
-            output << " " << boost::lexical_cast<std::string>(
-                                 elementNodeDataSet.values[i][j][k]);
-        }
-        output << std::endl;
-      }
-      output << "$EndElementNodeData" << std::endl;
-    }
+  for (int i = 0; i < m_elementNodeDataSets.size(); ++i) {
+    const ElementNodeDataSet &elementNodeDataSet = *m_elementNodeDataSets[i];
+    output << "$ElementNodeData" << std::endl;
+    writeDataHeader(output, elementNodeDataSet,
+                    elementNodeDataSet.elementIndices.size());
+    writeEntityValues(output, elementNodeDataSet.elementIndices,
+                      &elementNodeDataSet.nodeCounts,
+                      elementNodeDataSet.values,
+                      elementNodeDataSet.numberOfFieldComponents, binary);
+    output << "$EndElementNodeData" << std::endl;
   }
 
   for (int i = 0; i < m_interpolationSchemeSets.size(); ++i) {
@@ -643,16 +1661,17 @@ void GmshData::write(std::ostream &output) const {
     output << "$EndInterpolationScheme" << std::endl;
   }
 }
-void GmshData::write(const std::string &fileName) const {
+void GmshData::write(const std::string &fileName,
+                     GmshFileFormat::Type format) const {
 
   std::ofstream out;
-  out.open(fileName.c_str(), std::ios::trunc);
-  write(out);
+  out.open(fileName.c_str(), std::ios::trunc | std::ios::binary);
+  write(out, format);
   out.close();
 }
 
-GmshData GmshData::read(std::istream &input, int elementType,
-                        int physicalEntity) {
+void GmshData::readBuffer(const char *begin, const char *end, int elementType,
+                          int physicalEntity) {
 
   bool haveMeshFormat = false;
   bool haveNodes = false;
@@ -660,402 +1679,291 @@ GmshData GmshData::read(std::istream &input, int elementType,
   bool havePeriodic = false;
   bool havePhysicalNames = false;
 
-  GmshData gmshData;
+  int version = 2;
+  bool binary = false;
+  ElementFilter filter = {elementType, physicalEntity, -1};
+  EntityPhysicalTags entityPhysicalTags;
 
+  Cursor cursor(begin, end);
   std::string line;
-  while (std::getline(input, line)) {
+  while (cursor.nextLine(line)) {
 
     if (line == "$MeshFormat") {
       if (haveMeshFormat)
         throw std::runtime_error(
             "GmshData::read(): MeshFormat Section appears more than once.");
       std::cout << "Reading MeshFormat..." << std::endl;
-      std::getline(input, line);
-      StringVector tokens = stringTokens(line);
-      if (tokens.size() != 3)
-        throw std::runtime_error(
-            "GmshData::read(): Wrong format of MeshFormat");
-      if (tokens[0] != "2" & tokens[0] != "2.2")
-        throw std::runtime_error(
-            "GmshData::read(): Version of MSH file not supported.");
-      if (boost::lexical_cast<int>(tokens[1]) != 0)
-        throw std::runtime_error("GmshData::read(): File Type not supported.");
-      int dataSize = boost::lexical_cast<int>(tokens[2]);
-      if (dataSize != sizeof(double))
-        throw std::runtime_error(
-            "MeshFormat::read(): Data size not supported.");
-      std::getline(input, line);
-      if (line != "$EndMeshFormat")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading MeshFormat section.");
+      MeshFormat format;
+      readMeshFormat(cursor, format);
+      version = format.version;
+      binary = format.binary;
+      m_versionNumber = format.versionNumber;
+      m_fileType = format.fileType;
+      m_dataSize = format.dataSize;
       haveMeshFormat = true;
 
+    } else if (line == "$Entities" && version == 4) {
+      std::cout << "Reading Entities..." << std::endl;
+      readEntitiesV4(cursor, binary, entityPhysicalTags);
+
     } else if (line == "$Nodes") {
       if (haveNodes)
         throw std::runtime_error(
             "GmshData::read(): Nodes section appears more than once. ");
       std::cout << "Reading Nodes..." << std::endl;
-      std::getline(input, line);
-      int numberOfNodes = boost::lexical_cast<int>(line);
-      gmshData.reserveNumberOfNodes(numberOfNodes);
-      for (int i = 0; i < numberOfNodes; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        if (tokens.size() != 4)
-          throw std::runtime_error(
-              "GmshData::read(): Wrong format of node definition detected.");
-        int index = boost::lexical_cast<int>(tokens[0]);
-        double x = boost::lexical_cast<double>(tokens[1]);
-        double y = boost::lexical_cast<double>(tokens[2]);
-        double z = boost::lexical_cast<double>(tokens[3]);
-        gmshData.addNode(index, x, y, z);
-      }
-      std::getline(input, line);
-      if (line != "$EndNodes")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading Nodes section. ");
+      StagedNodes nodes;
+      if (version == 4)
+        readNodesV4(cursor, binary, nodes);
+      else
+        readNodesV2(cursor, binary, nodes);
+      reserveNumberOfNodes(
+          nodes.tags.empty()
+              ? 0
+              : *std::max_element(nodes.tags.begin(), nodes.tags.end()));
+      for (size_t i = 0; i < nodes.tags.size(); ++i)
+        addNode(nodes.tags[i], nodes.coordinates[3 * i],
+                nodes.coordinates[3 * i + 1], nodes.coordinates[3 * i + 2]);
       haveNodes = true;
+
     } else if (line == "$Elements") {
       if (haveElements)
         throw std::runtime_error(
             "GmshData::read(): Elements section appears more than once.");
       std::cout << "Reading Elements..." << std::endl;
-      std::getline(input, line);
-      int numberOfElements = boost::lexical_cast<int>(line);
-      for (int i = 0; i < numberOfElements; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        int index = boost::lexical_cast<int>(tokens.at(0));
-        int currentElementType = boost::lexical_cast<int>(tokens.at(1));
-        int ntags = boost::lexical_cast<int>(tokens.at(2));
-        int currentPhysicalEntity = boost::lexical_cast<int>(tokens.at(3));
-        int elementaryEntity = boost::lexical_cast<int>(tokens.at(4));
-        int npartitions = 0;
-        if (ntags > 5)
-          npartitions = boost::lexical_cast<int>(tokens.at(5));
-        std::vector<int> partitions;
-        for (int i = 0; i < npartitions; ++i)
-          partitions.push_back(boost::lexical_cast<int>(tokens.at(6 + i)));
-        std::vector<int> nodes;
-        for (int i = 3 + ntags; i < tokens.size(); ++i)
-          nodes.push_back(boost::lexical_cast<int>(tokens.at(i)));
-        if ((elementType == -1 || currentElementType == elementType) &&
-            (physicalEntity == -1 || currentPhysicalEntity == physicalEntity)) {
-          gmshData.addElement(index, currentElementType, nodes, physicalEntity,
-                              elementaryEntity, partitions);
-          gmshData.m_elementIndices.insert(index);
+      std::vector<StagedElements> elements;
+      if (version == 4)
+        readElementsV4(cursor, binary, entityPhysicalTags, filter, elements);
+      else
+        readElementsV2(cursor, binary, filter, elements);
+      for (size_t chunk = 0; chunk < elements.size(); ++chunk) {
+        const StagedElements &staged = elements[chunk];
+        const int *values = staged.values.empty() ? 0 : &staged.values[0];
+        for (size_t i = 0; i < staged.records.size(); ++i) {
+          const ElementRecord &record = staged.records[i];
+          addElement(record.index, record.type, values, record.nodeCount,
+                     record.physicalEntity, record.elementaryEntity,
+                     values + record.nodeCount, record.partitionCount);
+          values += record.nodeCount + record.partitionCount;
         }
       }
-      std::getline(input, line);
-      if (line != "$EndElements")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading Elements section. ");
       haveElements = true;
 
+    } else if (line == "$Periodic" && version == 4) {
+      // Periodicity information of MSH 4 files is not stored
+      cursor.skipPast("$EndPeriodic");
+
     } else if (line == "$Periodic") {
       if (havePeriodic)
         throw std::runtime_error(
             "GmshData::read(): Periodic section appears more than once.");
       std::cout << "Reading Periodic..." << std::endl;
-      std::getline(input, line);
-      int numberOfPeriodicEntities = boost::lexical_cast<int>(line);
+      int numberOfPeriodicEntities = cursor.tokens().integer32();
       for (int i = 0; i < numberOfPeriodicEntities; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
+        StringVector tokens = stringTokens(cursor.line());
         if (tokens.size() != 3)
           throw std::runtime_error(
               "GmshData::read(): Wrong format for periodic entities.");
         int dimension = boost::lexical_cast<int>(tokens[0]);
         int slaveTag = boost::lexical_cast<int>(tokens[1]);
         int masterTag = boost::lexical_cast<int>(tokens[2]);
-        gmshData.addPeriodicEntity(dimension, slaveTag, masterTag);
+        addPeriodicEntity(dimension, slaveTag, masterTag);
       }
 
-      std::getline(input, line);
-      int numberOfPeriodicNodes = boost::lexical_cast<int>(line);
+      int numberOfPeriodicNodes = cursor.tokens().integer32();
       for (int i = 0; i < numberOfPeriodicNodes; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
+        StringVector tokens = stringTokens(cursor.line());
         if (tokens.size() != 2)
           throw std::runtime_error(
               "GmshData::read(): Wrong format for periodic nodes.");
         int slaveNode = boost::lexical_cast<int>(tokens[0]);
         int masterNode = boost::lexical_cast<int>(tokens[1]);
-        gmshData.addPeriodicNode(slaveNode, masterNode);
+        addPeriodicNode(slaveNode, masterNode);
       }
-      std::getline(input, line);
-      if (line != "$EndPeriodic")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading Periodic section.");
+      cursor.expectLine("$EndPeriodic", "Periodic");
       havePeriodic = true;
+
     } else if (line == "$PhysicalNames") {
       if (havePhysicalNames)
         throw std::runtime_error(
             "GmshData::read(): PhysicalNames section appears more than once.");
       std::cout << "Reading PhysicalNames..." << std::endl;
-      std::getline(input, line);
-      int numberOfPhysicalNames = boost::lexical_cast<int>(line);
+      int numberOfPhysicalNames = cursor.tokens().integer32();
       for (int i = 0; i < numberOfPhysicalNames; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        if (tokens.size() != 3)
+        LineTokens tokens = cursor.tokens();
+        int dimension = tokens.integer32();
+        int number = tokens.integer32();
+        std::string name = tokens.rest();
+        if (name.empty())
           throw std::runtime_error(
               "PhysicalNamesSet::read(): Wrong format for physical names.");
-        int dimension = boost::lexical_cast<int>(tokens[0]);
-        int number = boost::lexical_cast<int>(tokens[1]);
-        std::string name = tokens[2];
-        gmshData.addPhysicalName(dimension, number, name);
+        addPhysicalName(dimension, number, name);
       }
-      std::getline(input, line);
-      if (line != "$EndPhysicalNames")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading PhysicalNames section.");
+      cursor.expectLine("$EndPhysicalNames", "PhysicalNames");
       havePhysicalNames = true;
 
     } else if (line == "$NodeData") {
 
       std::cout << "Reading NodeData..." << std::endl;
-      std::getline(input, line);
-      int numberOfStringTags = boost::lexical_cast<int>(line);
-      std::vector<std::string> stringTags;
-      for (int i = 0; i < numberOfStringTags; ++i) {
-        std::getline(input, line);
-        line.erase(std::remove(line.begin(), line.end(), '\"'), line.end());
-        stringTags.push_back(line);
-      }
-
-      // Real tags
-      std::getline(input, line);
-      int numberOfRealTags = boost::lexical_cast<int>(line);
-      std::vector<double> realTags;
-      for (int i = 0; i < numberOfRealTags; ++i) {
-        std::getline(input, line);
-        realTags.push_back(boost::lexical_cast<double>(line));
-      }
-
-      // Integer tags
-      std::getline(input, line);
-      int numberOfIntegerTags = boost::lexical_cast<int>(line);
-      if (numberOfIntegerTags < 3)
-        throw std::runtime_error(
-            "GmshData::read(): At least 3 integer tags required.");
-      std::vector<int> integerTags;
-      for (int i = 0; i < numberOfIntegerTags; ++i) {
-        std::getline(input, line);
-        integerTags.push_back(boost::lexical_cast<int>(line));
-      }
-      int timeStep = integerTags[0];
-      int numberOfFieldComponents = integerTags[1];
-      int numberOfNodes = integerTags[2];
-      int partition = 0;
-      if (integerTags.size() > 3)
-        partition = integerTags[3];
-      int dataSetIndex = gmshData.numberOfNodeDataSets();
-      gmshData.addNodeDataSet(stringTags, realTags, numberOfFieldComponents,
-                              numberOfNodes, timeStep, partition);
-
-      for (int i = 0; i < numberOfNodes; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        if (tokens.size() != 1 + numberOfFieldComponents)
-          throw std::runtime_error("GmshData::read(): Data has wrong format.");
-        int index = boost::lexical_cast<int>(tokens[0]);
-        std::vector<double> values;
-        for (int j = 1; j < tokens.size(); ++j) {
-          values.push_back(boost::lexical_cast<double>(tokens[j]));
+      DataHeader header;
+      readDataHeader(cursor, header);
+      int dataSetIndex = numberOfNodeDataSets();
+      addNodeDataSet(header.stringTags, header.realTags,
+                     header.numberOfFieldComponents, header.count,
+                     header.timeStep, header.partition);
+
+      std::vector<double> values(header.numberOfFieldComponents);
+      for (int i = 0; i < header.count; ++i) {
+        int index;
+        if (binary) {
+          index = readBinaryTag(cursor, version);
+          for (int j = 0; j < header.numberOfFieldComponents; ++j)
+            values[j] = cursor.binary<double>();
+        } else {
+          LineTokens tokens = cursor.tokens();
+          index = checkedTag(tokens.integer());
+          for (int j = 0; j < header.numberOfFieldComponents; ++j)
+            values[j] = tokens.real();
+          if (!tokens.finished())
+            throw std::runtime_error(
+                "GmshData::read(): Data has wrong format.");
         }
-        gmshData.addNodeData(dataSetIndex, index, values);
+        addNodeData(dataSetIndex, index, values.data());
       }
-
-      std::getline(input, line);
-      if (line != "$EndNodeData")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading NodeData section.");
+      cursor.expectLine("$EndNodeData", "NodeData");
 
     } else if (line == "$ElementData") {
 
       std::cout << "Reading ElementData..." << std::endl;
-      std::getline(input, line);
-      int numberOfStringTags = boost::lexical_cast<int>(line);
-      std::vector<std::string> stringTags;
-      for (int i = 0; i < numberOfStringTags; ++i) {
-        std::getline(input, line);
-        line.erase(std::remove(line.begin(), line.end(), '\"'), line.end());
-        stringTags.push_back(line);
-      }
-
-      // Real tags
-      std::getline(input, line);
-      int numberOfRealTags = boost::lexical_cast<int>(line);
-      std::vector<double> realTags;
-      for (int i = 0; i < numberOfRealTags; ++i) {
-        std::getline(input, line);
-        realTags.push_back(boost::lexical_cast<double>(line));
-      }
-
-      // Integer tags
-      std::getline(input, line);
-      int numberOfIntegerTags = boost::lexical_cast<int>(line);
-      if (numberOfIntegerTags < 3)
-        throw std::runtime_error(
-            "GmshData::read(): At least 3 integer tags required.");
-      std::vector<int> integerTags;
-      for (int i = 0; i < numberOfIntegerTags; ++i) {
-        std::getline(input, line);
-        integerTags.push_back(boost::lexical_cast<int>(line));
-      }
-      int timeStep = integerTags[0];
-      int numberOfFieldComponents = integerTags[1];
-      int numberOfElements = integerTags[2];
-      int partition = 0;
-      if (integerTags.size() > 3)
-        partition = integerTags[3];
-      int dataSetIndex = gmshData.numberOfElementDataSets();
-      gmshData.addElementDataSet(stringTags, realTags, numberOfFieldComponents,
-                                 numberOfElements, timeStep, partition);
-
-      for (int i = 0; i < numberOfElements; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        if (tokens.size() != 1 + numberOfFieldComponents)
-          throw std::runtime_error("GmshData::read(): Data has wrong format.");
-        int index = boost::lexical_cast<int>(tokens[0]);
-        std::vector<double> values;
-        for (int j = 1; j < tokens.size(); ++j) {
-          values.push_back(boost::lexical_cast<double>(tokens[j]));
+      DataHeader header;
+      readDataHeader(cursor, header);
+      int dataSetIndex = numberOfElementDataSets();
+      addElementDataSet(header.stringTags, header.realTags,
+                        header.numberOfFieldComponents, header.count,
+                        header.timeStep, header.partition);
+
+      std::vector<double> values(header.numberOfFieldComponents);
+      for (int i = 0; i < header.count; ++i) {
+        int index;
+        if (binary) {
+          index = readBinaryTag(cursor, version);
+          for (int j = 0; j < header.numberOfFieldComponents; ++j)
+            values[j] = cursor.binary<double>();
+        } else {
+          LineTokens tokens = cursor.tokens();
+          index = checkedTag(tokens.integer());
+          for (int j = 0; j < header.numberOfFieldComponents; ++j)
+            values[j] = tokens.real();
+          if (!tokens.finished())
+            throw std::runtime_error(
+                "GmshData::read(): Data has wrong format.");
         }
-        if (gmshData.m_elementIndices.find(index) !=
-            gmshData.m_elementIndices.end())
-          gmshData.addElementData(dataSetIndex, index, values);
+        if (hasElement(index))
+          addElementData(dataSetIndex, index, values.data());
       }
-
-      std::getline(input, line);
-      if (line != "$EndElementData")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading ElementData section.");
+      cursor.expectLine("$EndElementData", "ElementData");
 
     } else if (line == "$ElementNodeData") {
 
       std::cout << "Reading ElementNodeData..." << std::endl;
-      std::getline(input, line);
-      int numberOfStringTags = boost::lexical_cast<int>(line);
-      std::vector<std::string> stringTags;
-      for (int i = 0; i < numberOfStringTags; ++i) {
-        std::getline(input, line);
-        line.erase(std::remove(line.begin(), line.end(), '\"'), line.end());
-        stringTags.push_back(line);
-      }
-
-      // Real tags
-      std::getline(input, line);
-      int numberOfRealTags = boost::lexical_cast<int>(line);
-      std::vector<double> realTags;
-      for (int i = 0; i < numberOfRealTags; ++i) {
-        std::getline(input, line);
-        realTags.push_back(boost::lexical_cast<double>(line));
-      }
-
-      // Integer tags
-      std::getline(input, line);
-      int numberOfIntegerTags = boost::lexical_cast<int>(line);
-      if (numberOfIntegerTags < 3)
-        throw std::runtime_error(
-            "GmshData::read(): At least 3 integer tags required.");
-      std::vector<int> integerTags;
-      for (int i = 0; i < numberOfIntegerTags; ++i) {
-        std::getline(input, line);
-        integerTags.push_back(boost::lexical_cast<int>(line));
-      }
-      int timeStep = integerTags[0];
-      int numberOfFieldComponents = integerTags[1];
-      int numberOfElements = integerTags[2];
-      int partition = 0;
-      if (integerTags.size() > 3)
-        partition = integerTags[3];
-      int dataSetIndex = gmshData.numberOfElementDataSets();
-      gmshData.addElementNodeDataSet(stringTags, realTags,
-                                     numberOfFieldComponents, numberOfElements,
-                                     timeStep, partition);
-
-      for (int i = 0; i < numberOfElements; ++i) {
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        if (tokens.size() < 2)
-          throw std::runtime_error("GmshData::read(): Data has wrong format.");
-        int numberOfNodes = boost::lexical_cast<int>(tokens[1]);
-        if (tokens.size() != 2 + numberOfFieldComponents * numberOfNodes)
-          throw std::runtime_error("GmshData::read(): Data has wrong format.");
-        int index = boost::lexical_cast<int>(tokens[0]);
-        std::vector<std::vector<double>> values;
-        for (int j = 0; j < numberOfNodes; ++j) {
-          values.push_back(std::vector<double>());
-          for (int k = 0; k < numberOfFieldComponents; ++k)
-            values[j].push_back(boost::lexical_cast<double>(
-                tokens[2 + j * numberOfFieldComponents + k]));
+      DataHeader header;
+      readDataHeader(cursor, header);
+      int dataSetIndex = numberOfElementNodeDataSets();
+      addElementNodeDataSet(header.stringTags, header.realTags,
+                            header.numberOfFieldComponents, header.count,
+                            header.timeStep, header.partition);
+
+      std::vector<double> values;
+      for (int i = 0; i < header.count; ++i) {
+        int index;
+        int numberOfNodes;
+        if (binary) {
+          index = readBinaryTag(cursor, version);
+          numberOfNodes = cursor.binary<int>();
+          if (numberOfNodes < 0)
+            throw std::runtime_error(
+                "GmshData::read(): Data has wrong format.");
+          values.resize(size_t(numberOfNodes) * header.numberOfFieldComponents);
+          for (size_t j = 0; j < values.size(); ++j)
+            values[j] = cursor.binary<double>();
+        } else {
+          LineTokens tokens = cursor.tokens();
+          index = checkedTag(tokens.integer());
+          numberOfNodes = tokens.integer32();
+          if (numberOfNodes < 0)
+            throw std::runtime_error(
+                "GmshData::read(): Data has wrong format.");
+          values.resize(size_t(numberOfNodes) * header.numberOfFieldComponents);
+          for (size_t j = 0; j < values.size(); ++j)
+            values[j] = tokens.real();
+          if (!tokens.finished())
+            throw std::runtime_error(
+                "GmshData::read(): Data has wrong format.");
         }
-        if (gmshData.m_elementIndices.find(index) !=
-            gmshData.m_elementIndices.end())
-          gmshData.addElementNodeData(dataSetIndex, index, values);
+        if (hasElement(index))
+          addElementNodeData(dataSetIndex, index, numberOfNodes,
+                             values.data());
       }
+      cursor.expectLine("$EndElementNodeData", "ElementNodeData");
 
-      std::getline(input, line);
-      if (line != "$EndElementNodeData")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading ElementNodeData section.");
-
-    } else if (line == "$InterpolationSchemeSet") {
+    } else if (line == "$InterpolationScheme" ||
+               line == "$InterpolationSchemeSet") {
 
       std::cout << "Reading InterpolationSchemSet..." << std::endl;
-      std::getline(input, line);
-      line.erase(std::remove(line.begin(), line.end(), '\"'), line.end());
-      std::string name = line;
-      std::getline(input, line);
-      if (boost::lexical_cast<int>(line) != 1)
+      std::string name = cursor.line();
+      name.erase(std::remove(name.begin(), name.end(), '\"'), name.end());
+      if (cursor.tokens().integer() != 1)
         throw std::runtime_error(
             "GmshData::read(): Only one topology is currently supported.");
-      std::getline(input, line);
-      int topology = boost::lexical_cast<int>(line);
-      int dataSetIndex = gmshData.numberOfInterpolationSchemeSets();
-      gmshData.addInterpolationSchemeSet(name, topology);
-      std::getline(input, line);
-      int numberOfInterpolationMatrices = boost::lexical_cast<int>(line);
+      int topology = cursor.tokens().integer32();
+      int dataSetIndex = numberOfInterpolationSchemeSets();
+      addInterpolationSchemeSet(name, topology);
+      int numberOfInterpolationMatrices = cursor.tokens().integer32();
       for (int i = 0; i < numberOfInterpolationMatrices; ++i) {
         std::vector<double> matrix;
-        std::getline(input, line);
-        StringVector tokens = stringTokens(line);
-        if (tokens.size() != 2)
+        LineTokens size = cursor.tokens();
+        int nrows = size.integer32();
+        int ncols = size.integer32();
+        if (nrows < 0 || ncols < 0 || !size.finished())
           throw std::runtime_error(
               "GmshData::read(): Wrong format of interpolation matrices.");
-        int nrows = boost::lexical_cast<int>(tokens[0]);
-        int ncols = boost::lexical_cast<int>(tokens[1]);
         matrix.reserve(nrows * ncols);
         for (int j = 0; j < nrows; ++j) {
-          std::getline(input, line);
-          StringVector tokens = stringTokens(line);
-          if (tokens.size() != ncols)
+          LineTokens tokens = cursor.tokens();
+          for (int k = 0; k < ncols; ++k)
+            matrix.push_back(tokens.real());
+          if (!tokens.finished())
             throw std::runtime_error(
                 "GmshData::read(): Wrong format of interpolation matrices.");
-          for (int k = 0; k < ncols; ++k)
-            matrix.push_back(boost::lexical_cast<double>(tokens[k]));
         }
-        gmshData.addInterpolationMatrix(dataSetIndex, nrows, ncols, matrix);
+        addInterpolationMatrix(dataSetIndex, nrows, ncols, matrix);
       }
-      std::getline(input, line);
-      if (line != "$EndInterpolationSchemeSet")
-        throw std::runtime_error(
-            "GmshData::read(): Error reading InterpolationSchemeSet section.");
+      cursor.expectLine("$End" + line.substr(1), "InterpolationSchemeSet");
+
+    } else if (line.size() > 1 && line[0] == '$' &&
+               line.compare(0, 4, "$End") != 0) {
+      // Skip sections not stored by GmshData, e.g. $PartitionedEntities
+      cursor.skipPast("$End" + line.substr(1));
     }
   }
+}
+
+GmshData GmshData::read(std::istream &input, int elementType,
+                        int physicalEntity) {
+
+  FileBuffer buffer(input);
+  GmshData gmshData;
+  gmshData.readBuffer(buffer.begin(), buffer.end(), elementType,
+                      physicalEntity);
   return gmshData;
 }
 
 GmshData GmshData::read(const std::string &fileName, int elementType,
                         int physicalEntity) {
 
-  std::ifstream(input);
-  input.open(fileName.c_str());
-  GmshData gmshData = read(input, elementType, physicalEntity);
-  input.close();
+  FileBuffer buffer(fileName);
+  GmshData gmshData;
+  gmshData.readBuffer(buffer.begin(), buffer.end(), elementType,
+                      physicalEntity);
   return gmshData;
 }
 
@@ -1240,7 +2148,9 @@ const GmshData &GmshIo::gmshData() const { return m_gmshData; }
 
 GmshData &GmshIo::gmshData() { return m_gmshData; }
 
-void GmshIo::write(std::string fileName) const { m_gmshData.write(fileName); }
+void GmshIo::write(std::string fileName, GmshFileFormat::Type format) const {
+  m_gmshData.write(fileName, format);
+}
 
 void GmshIo::resetNodeDataSets() { m_gmshData.resetNodeDataSets(); }
 
@@ -1252,6 +2162,131 @@ void GmshIo::resetElementNodeDataSets() {
 
 void GmshIo::resetDataSets() { m_gmshData.resetDataSets(); }
 
+shared_ptr<Grid> importGmshGrid(const std::string &fileName,
+                                std::vector<int> &boundaryId2PhysicalEntity,
+                                std::vector<int> &elementIndex2PhysicalEntity,
+                                int physicalEntity, bool verbose) {
+
+  boundaryId2PhysicalEntity.clear();
+  elementIndex2PhysicalEntity.clear();
+
+  FileBuffer buffer(fileName);
+  Cursor cursor(buffer.begin(), buffer.end());
+  MeshFormat format;
+  format.version = 2;
+  format.binary = false;
+  // Triangles of the requested physical entity and all lines, whose physical
+  // entities are reported as boundary ids
+  ElementFilter filter = {2, physicalEntity, 1};
+  EntityPhysicalTags entityPhysicalTags;
+
+  // Coordinates of the nodes in file order, the position of each node tag in
+  // this order (or -1) and the corners of the triangles, given as node tags
+  std::vector<double> coordinates;
+  std::vector<int> nodePositions;
+  std::vector<int> corners;
+  bool haveNodes = false;
+
+  std::string line;
+  while (cursor.nextLine(line)) {
+    if (line == "$MeshFormat") {
+      readMeshFormat(cursor, format);
+    } else if (line == "$Entities" && format.version == 4) {
+      readEntitiesV4(cursor, format.binary, entityPhysicalTags);
+    } else if (line == "$Nodes") {
+      if (verbose)
+        std::cout << "Reading Nodes..." << std::endl;
+      StagedNodes nodes;
+      if (format.version == 4)
+        readNodesV4(cursor, format.binary, nodes);
+      else
+        readNodesV2(cursor, format.binary, nodes);
+      const int maxTag =
+          nodes.tags.empty()
+              ? -1
+              : *std::max_element(nodes.tags.begin(), nodes.tags.end());
+      nodePositions.assign(maxTag + 1, -1);
+      for (size_t i = 0; i < nodes.tags.size(); ++i)
+        nodePositions[nodes.tags[i]] = i;
+      coordinates.swap(nodes.coordinates);
+      haveNodes = true;
+    } else if (line == "$Elements") {
+      if (verbose)
+        std::cout << "Reading Elements..." << std::endl;
+      std::vector<StagedElements> elements;
+      if (format.version == 4)
+        readElementsV4(cursor, format.binary, entityPhysicalTags, filter,
+                       elements);
+      else
+        readElementsV2(cursor, format.binary, filter, elements);
+      size_t triangleCount = 0;
+      for (size_t chunk = 0; chunk < elements.size(); ++chunk)
+        for (size_t i = 0; i < elements[chunk].records.size(); ++i)
+          triangleCount += (elements[chunk].records[i].type == 2);
+      corners.reserve(3 * triangleCount);
+      elementIndex2PhysicalEntity.reserve(triangleCount);
+      for (size_t chunk = 0; chunk < elements.size(); ++chunk) {
+        const StagedElements &staged = elements[chunk];
+        const int *values = staged.values.empty() ? 0 : &staged.values[0];
+        for (size_t i = 0; i < staged.records.size(); ++i) {
+          const ElementRecord &record = staged.records[i];
+          if (record.type == 2) {
+            corners.insert(corners.end(), values, values + 3);
+            elementIndex2PhysicalEntity.push_back(record.physicalEntity);
+          } else
+            boundaryId2PhysicalEntity.push_back(record.physicalEntity);
+          values += record.nodeCount + record.partitionCount;
+        }
+        // Release each chunk as soon as it has been consumed
+        std::vector<ElementRecord>().swap(elements[chunk].records);
+        std::vector<int>().swap(elements[chunk].values);
+      }
+    } else if (line.size() > 1 && line[0] == '$' &&
+               line.compare(0, 4, "$End") != 0) {
+      cursor.skipPast("$End" + line.substr(1));
+    }
+  }
+  if (!haveNodes || corners.empty())
+    throw std::runtime_error("importGmshGrid(): File " + fileName +
+                             " contains no triangles.");
+
+  // Keep only the nodes used by triangles, in file order, compacting the
+  // coordinate array in place
+  const size_t nodeCount = coordinates.size() / 3;
+  std::vector<int> vertexIndices(nodeCount, -1);
+  for (size_t i = 0; i < corners.size(); ++i) {
+    const int tag = corners[i];
+    if (tag < 0 || tag >= nodePositions.size() || nodePositions[tag] == -1)
+      throw std::runtime_error("importGmshGrid(): Element refers to a node "
+                               "missing from file " + fileName + ".");
+    vertexIndices[nodePositions[tag]] = 0;
+  }
+  int vertexCount = 0;
+  for (size_t i = 0; i < nodeCount; ++i)
+    if (vertexIndices[i] == 0) {
+      std::copy(&coordinates[3 * i], &coordinates[3 * i] + 3,
+                &coordinates[3 * vertexCount]);
+      vertexIndices[i] = vertexCount++;
+    }
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, corners.size()),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      corners[i] = vertexIndices[nodePositions[corners[i]]];
+  });
+  std::vector<int>().swap(nodePositions);
+  std::vector<int>().swap(vertexIndices);
+
+  // The connectivity arrays are passed without copying
+  const arma::Mat<double> vertices(&coordinates[0], 3, vertexCount,
+                                   false /* copy_aux_mem */);
+  const arma::Mat<int> elementCorners(&corners[0], 3, corners.size() / 3,
+                                      false /* copy_aux_mem */);
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  return GridFactory::createGridFromConnectivityArrays(
+      params, vertices, elementCorners, elementIndex2PhysicalEntity);
+}
+
 template <typename BasisFunctionType, typename ResultType>
 GridFunction<BasisFunctionType, ResultType> gridFunctionFromGmsh(
     const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
@@ -1422,6 +2457,10 @@ void exportToGmsh(GridFunction<BasisFunctionType, ResultType> gridFunction,
 
     return;
   }
+  const ComplexPart part =
+      complexMode == "real" ? REAL_PART
+                            : complexMode == "imag" ? IMAG_PART
+                                                    : ABSOLUTE_VALUE;
 
   GmshData &gmshData = gmshIo.gmshData();
 
@@ -1503,44 +2542,26 @@ void exportToGmsh(GridFunction<BasisFunctionType, ResultType> gridFunction,
   if (gmshPostDataType == GmshPostData::NODE) {
 
     const std::vector<int> &nodePermutation = gmshIo.nodePermutation();
-    arma::Mat<ResultType> values;
     gridFunction.evaluateAtSpecialPoints(VtkWriter::VERTEX_DATA, values);
-    arma::Mat<CoordinateType> modifiedValues;
-    if (complexMode == "real")
-      modifiedValues = arma::real(values);
-    else if (complexMode == "imag")
-      modifiedValues = arma::imag(values);
-    else if (complexMode == "abs")
-      modifiedValues = arma::abs(values);
     int dataSetIndex = gmshData.numberOfNodeDataSets();
     gmshData.addNodeDataSet(stringTags, realTags, values.n_rows, numberOfNodes);
+    std::vector<double> vals(values.n_rows);
     for (int i = 0; i < numberOfNodes; ++i) {
-      std::vector<double> vals(values.n_rows);
-      for (int j = 0; j < values.n_rows; ++j)
-        vals[j] = modifiedValues(j, i);
-      gmshData.addNodeData(dataSetIndex, nodePermutation[i], vals);
+      takePart(values.colptr(i), values.n_rows, part, &vals[0]);
+      gmshData.addNodeData(dataSetIndex, nodePermutation[i], &vals[0]);
     }
 
   } else if (gmshPostDataType == GmshPostData::ELEMENT) {
 
     const std::vector<int> &elementPermutation = gmshIo.elementPermutation();
-    arma::Mat<ResultType> values;
     gridFunction.evaluateAtSpecialPoints(VtkWriter::CELL_DATA, values);
-    arma::Mat<CoordinateType> modifiedValues;
-    if (complexMode == "real")
-      modifiedValues = arma::real(values);
-    else if (complexMode == "imag")
-      modifiedValues = arma::imag(values);
-    else if (complexMode == "abs")
-      modifiedValues = arma::abs(values);
     int dataSetIndex = gmshData.numberOfElementDataSets();
     gmshData.addElementDataSet(stringTags, realTags, values.n_rows,
                                numberOfElements);
+    std::vector<double> vals(values.n_rows);
     for (int i = 0; i < numberOfElements; ++i) {
-      std::vector<double> vals(values.n_rows);
-      for (int j = 0; j < values.n_rows; ++j)
-        vals[j] = modifiedValues(j, i);
-      gmshData.addElementData(dataSetIndex, elementPermutation[i], vals);
+      takePart(values.colptr(i), values.n_rows, part, &vals[0]);
+      gmshData.addElementData(dataSetIndex, elementPermutation[i], &vals[0]);
     }
 
   } else if (gmshPostDataType == GmshPostData::ELEMENT_NODE) {
@@ -1551,28 +2572,17 @@ void exportToGmsh(GridFunction<BasisFunctionType, ResultType> gridFunction,
     int dataSetIndex = gmshData.numberOfElementNodeDataSets();
     gmshData.addElementNodeDataSet(
         stringTags, realTags, gridFunction.componentCount(), numberOfElements);
+    std::vector<double> vals;
     while (!it->finished()) {
 
       const Entity<0> &element = it->entity();
       int elementIndex = indexSet.entityIndex(element);
-      arma::Mat<ResultType> values;
-      arma::Mat<CoordinateType> modifiedValues;
       gridFunction.evaluate(element, localCoordsOnTriangles[0], values);
-      if (complexMode == "real")
-        modifiedValues = arma::real(values);
-      else if (complexMode == "imag")
-        modifiedValues = arma::imag(values);
-      else if (complexMode == "abs")
-        modifiedValues = arma::abs(values);
-
-      std::vector<std::vector<double>> vals(values.n_cols);
-      for (int j = 0; j < values.n_cols; ++j) {
-        vals[j].reserve(values.n_rows);
-        for (int i = 0; i < values.n_rows; ++i)
-          vals[j].push_back(modifiedValues(i, j));
-      }
+      vals.resize(values.n_elem);
+      takePart(values.memptr(), values.n_elem, part, &vals[0]);
       gmshData.addElementNodeData(dataSetIndex,
-                                  elementPermutation[elementIndex], vals);
+                                  elementPermutation[elementIndex],
+                                  values.n_cols, &vals[0]);
       it->next();
     }
   }
@@ -1582,11 +2592,11 @@ template <typename BasisFunctionType, typename ResultType>
 void exportToGmsh(GridFunction<BasisFunctionType, ResultType> gridFunction,
                   const char *dataLabel, const char *fileName,
                   GmshPostData::Type gmshPostDataType,
-                  std::string complexMode) {
+                  std::string complexMode, GmshFileFormat::Type fileFormat) {
 
   GmshIo gmshIo(gridFunction.grid());
   exportToGmsh(gridFunction, dataLabel, gmshIo, gmshPostDataType, complexMode);
-  gmshIo.write(fileName);
+  gmshIo.write(fileName, fileFormat);
 }
 
 // template <typename BasisFunctionType, typename ResultType>
@@ -1737,7 +2747,8 @@ void exportToGmsh(GridFunction<BasisFunctionType, ResultType> gridFunction,
   template void exportToGmsh(GridFunction<BASIS, RESULT> gridFunction,         \
                              const char *dataLabel, const char *fileName,      \
                              GmshPostData::Type gmshPostDataType,              \
-                             std::string complexMode);                         \
+                             std::string complexMode,                          \
+                             GmshFileFormat::Type fileFormat);                 \
   template void exportToGmsh(GridFunction<BASIS, RESULT> gridFunction,         \
                              const char *dataLabel, GmshIo &gmshIo,            \
                              GmshPostData::Type gmshPostDataType,              \
@@ -26,7 +26,6 @@
 #include <iostream>
 #include <string>
 #include <memory>
-#include <set>
 #include "../common/shared_ptr.hpp"
 #include "../assembly/grid_function.hpp"
 #include <armadillo>
@@ -47,6 +46,14 @@ struct GmshPostData {
   };
 };
 
+struct GmshFileFormat {
+
+  enum Type {
+    ASCII,
+    BINARY
+  };
+};
+
 class GmshData {
 
 public:
@@ -98,6 +105,13 @@ public:
   void addElementNodeData(int dataSetIndex, int element,
                           const std::vector<std::vector<double>> &values);
 
+  // The overloads below take the numberOfFieldComponents values of an entity
+  // (node by node for element-node data) from a contiguous array
+  void addNodeData(int dataSetIndex, int node, const double *values);
+  void addElementData(int dataSetIndex, int element, const double *values);
+  void addElementNodeData(int dataSetIndex, int element, int nodeCount,
+                          const double *values);
+
   void addInterpolationSchemeSet(std::string name, int topology);
   void addInterpolationMatrix(int dataSetIndex, int nrows, int ncols,
                               const std::vector<double> &values);
@@ -164,14 +178,39 @@ public:
 
   void resetDataSets();
 
-  void write(std::ostream &output) const;
-  void write(const std::string &fileName) const;
+  /** \brief Write the data in version 2.2 of the MSH format.
+   *
+   *  In binary files, the node coordinates, the element connectivity and
+   *  the values of the data sets are stored as raw native-endian ints and
+   *  doubles; section headers and data-set tags remain ASCII. */
+  void write(std::ostream &output,
+             GmshFileFormat::Type format = GmshFileFormat::ASCII) const;
+  void write(const std::string &fileName,
+             GmshFileFormat::Type format = GmshFileFormat::ASCII) const;
+
+  /** \brief Read a mesh in the MSH format.
+   *
+   *  ASCII and binary files of versions 2.2 and 4.1 of the format are
+   *  supported. Only the elements of type \p elementType (all elements if
+   *  it is -1) belonging to the physical entity \p physicalEntity (all
+   *  entities if it is -1) are kept. The $Nodes and $Elements sections are
+   *  parsed in parallel.
+   *
+   *  The overload taking a file name maps the file into memory and parses it
+   *  in place. */
   static GmshData read(std::istream &input, int elementType = 2,
                        int physicalEntity = -1);
   static GmshData read(const std::string &fileName, int elementType = 2,
                        int physicalEntity = -1);
 
 private:
+  void readBuffer(const char *begin, const char *end, int elementType,
+                  int physicalEntity);
+  void addElement(int index, int elementType, const int *nodes, int nodeCount,
+                  int physicalEntity, int elementaryEntity,
+                  const int *partitions, int partitionCount);
+  bool hasElement(int index) const;
+
   struct NodeDataSet {
 
     std::vector<std::string> stringTags;
@@ -182,7 +221,8 @@ private:
     int partition;
 
     std::vector<int> nodeIndices;
-    std::vector<std::vector<double>> values;
+    // numberOfFieldComponents values per entity
+    std::vector<double> values;
   };
 
   struct ElementDataSet {
@@ -195,7 +235,8 @@ private:
     int partition;
 
     std::vector<int> elementIndices;
-    std::vector<std::vector<double>> values;
+    // numberOfFieldComponents values per entity
+    std::vector<double> values;
   };
 
   struct ElementNodeDataSet {
@@ -208,7 +249,10 @@ private:
     int partition;
 
     std::vector<int> elementIndices;
-    std::vector<std::vector<std::vector<double>>> values;
+    // nodeCounts[i] * numberOfFieldComponents values per element, stored
+    // node by node
+    std::vector<int> nodeCounts;
+    std::vector<double> values;
   };
 
   struct InterpolationSchemeSet {
@@ -222,18 +266,16 @@ private:
     int topology;
   };
 
-  struct Node {
-    double x;
-    double y;
-    double z;
-  };
-
+  // The nodes and partitions of an element are stored in m_elementNodes and
+  // m_elementPartitions; elements of type 0 are undefined
   struct Element {
     int type;
     int physicalEntity;
     int elementaryEntity;
-    std::vector<int> nodes;
-    std::vector<int> partitions;
+    int nodeCount;
+    int partitionCount;
+    size_t nodeOffset;
+    size_t partitionOffset;
   };
 
   struct PeriodicEntity {
@@ -259,10 +301,13 @@ private:
   int m_numberOfNodes;
   int m_numberOfElements;
 
-  std::vector<shared_ptr<Node>> m_nodes;
-  std::vector<shared_ptr<Element>> m_elements;
-
-  std::set<int> m_elementIndices;
+  // Nodes and elements are indexed by their Gmsh numbers. The coordinates
+  // of node i are m_nodeCoordinates[3 * i], ..., m_nodeCoordinates[3 * i + 2].
+  std::vector<double> m_nodeCoordinates;
+  std::vector<char> m_nodeDefined;
+  std::vector<Element> m_elements;
+  std::vector<int> m_elementNodes;
+  std::vector<int> m_elementPartitions;
 
   std::vector<PeriodicEntity> m_periodicEntities;
   std::vector<PeriodicNode> m_periodicNodes;
@@ -289,7 +334,8 @@ public:
   const std::vector<int> &inverseNodePermutation() const;
   const std::vector<int> &inverseElementPermutation() const;
   const GmshData &gmshData() const;
-  void write(std::string fileName) const;
+  void write(std::string fileName,
+             GmshFileFormat::Type format = GmshFileFormat::ASCII) const;
   GmshData &gmshData();
 
   void resetNodeDataSets();
@@ -307,6 +353,25 @@ private:
   mutable shared_ptr<const Grid> m_grid;
 };
 
+/** \brief Import a triangular grid from a Gmsh file.
+ *
+ *  Unlike GmshIo, this function does not store the contents of the file in a
+ *  GmshData object. The file is mapped into memory and its nodes and
+ *  triangles are parsed straight into the connectivity arrays passed to
+ *  GridFactory::createGridFromConnectivityArrays(); parser buffers are
+ *  released as soon as they have been consumed. Only the triangles of the
+ *  physical entity \p physicalEntity (all triangles if it is -1) and the
+ *  nodes they use are imported; nodes keep their order in the file.
+ *
+ *  On output, \p elementIndex2PhysicalEntity contains the physical entity of
+ *  each element of the grid and \p boundaryId2PhysicalEntity the physical
+ *  entities of the line elements of the file, in file order. The formats
+ *  supported by GmshData::read() are accepted. */
+shared_ptr<Grid> importGmshGrid(const std::string &fileName,
+                                std::vector<int> &boundaryId2PhysicalEntity,
+                                std::vector<int> &elementIndex2PhysicalEntity,
+                                int physicalEntity = -1, bool verbose = false);
+
 template <typename BasisFunctionType, typename ResultType>
 GridFunction<BasisFunctionType, ResultType> gridFunctionFromGmsh(
     const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
@@ -326,7 +391,8 @@ void exportToGmsh(GridFunction<BasisFunctionType, ResultType> gridFunction,
                   const char *dataLabel, const char *fileName,
                   GmshPostData::Type gmshPostDataType =
                       GmshPostData::ELEMENT_NODE,
-                  std::string complexMode = "real");
+                  std::string complexMode = "real",
+                  GmshFileFormat::Type fileFormat = GmshFileFormat::ASCII);
 
 } // namespace
 #endif
@@ -0,0 +1,460 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "xdmf_writer.hpp"
+
+#ifdef WITH_HDF5
+
+#include "../assembly/grid_function.hpp"
+#include "../common/scalar_traits.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../grid/grid_view.hpp"
+
+#include <armadillo>
+#include <hdf5.h>
+
+#include <algorithm>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace Bempp {
+
+namespace {
+
+// Target size in bytes of the chunks of HDF5 data sets
+const size_t chunkBytes = 1 << 20;
+
+// XDMF codes of the cell types in mixed topologies
+const int XDMF_POLYLINE = 2;
+const int XDMF_TRIANGLE = 4;
+const int XDMF_QUADRILATERAL = 5;
+
+void check(herr_t status, const std::string &what) {
+  if (status < 0)
+    throw std::runtime_error("XdmfWriter: " + what + " failed");
+}
+
+// HDF5 object closed when going out of scope
+class ScopedHandle : boost::noncopyable {
+public:
+  ScopedHandle(hid_t id, herr_t (*close)(hid_t), const std::string &what)
+      : m_id(id), m_close(close) {
+    if (id < 0)
+      throw std::runtime_error("XdmfWriter: " + what + " failed");
+  }
+  ~ScopedHandle() { m_close(m_id); }
+  operator hid_t() const { return m_id; }
+
+private:
+  hid_t m_id;
+  herr_t (*m_close)(hid_t);
+};
+
+template <typename T> hid_t nativeType();
+template <> hid_t nativeType<int>() { return H5T_NATIVE_INT; }
+template <> hid_t nativeType<float>() { return H5T_NATIVE_FLOAT; }
+template <> hid_t nativeType<double>() { return H5T_NATIVE_DOUBLE; }
+
+std::string xdmfDataItem(const std::string &dimensions, hid_t type,
+                         const std::string &location) {
+  std::ostringstream out;
+  out << "<DataItem Dimensions=\"" << dimensions << "\" NumberType=\""
+      << (H5Tget_class(type) == H5T_INTEGER ? "Int" : "Float")
+      << "\" Precision=\"" << H5Tget_size(type) << "\" Format=\"HDF\">"
+      << location << "</DataItem>\n";
+  return out.str();
+}
+
+} // namespace
+
+XdmfWriter::XdmfWriter(const GridView &view, const std::string &name,
+                       const std::string &path, int compressionLevel)
+    : m_name(name), m_prefix(path.empty() ? std::string() : path + "/"),
+      m_compressionLevel(compressionLevel), m_file(-1), m_stepGroup(-1) {
+  if (compressionLevel < 0 || compressionLevel > 9)
+    throw std::invalid_argument("XdmfWriter::XdmfWriter(): compressionLevel "
+                                "must lie between 0 and 9");
+
+  arma::Mat<double> vertices;
+  arma::Mat<int> corners;
+  arma::Mat<char> auxData;
+  view.getRawElementData(vertices, corners, auxData);
+
+  m_vertexCount = vertices.n_cols;
+  std::vector<double> coordinates(3 * m_vertexCount, 0.);
+  for (size_t v = 0; v < m_vertexCount; ++v)
+    for (size_t dim = 0; dim < std::min<size_t>(vertices.n_rows, 3); ++dim)
+      coordinates[3 * v + dim] = vertices(dim, v);
+
+  // Cells are stored in a mixed topology, each preceded by its type, unless
+  // they are all of the same type
+  m_cellCount = corners.n_cols;
+  std::vector<int> connectivity;
+  connectivity.reserve(corners.n_elem + 2 * m_cellCount);
+  size_t uniformCornerCount = 0;
+  bool uniform = true;
+  for (size_t e = 0; e < m_cellCount; ++e) {
+    size_t cornerCount = 0;
+    while (cornerCount < corners.n_rows && corners(cornerCount, e) >= 0)
+      ++cornerCount;
+    if (e == 0)
+      uniformCornerCount = cornerCount;
+    uniform = uniform && cornerCount == uniformCornerCount;
+    switch (cornerCount) {
+    case 2:
+      connectivity.push_back(XDMF_POLYLINE);
+      connectivity.push_back(2);
+      connectivity.push_back(corners(0, e));
+      connectivity.push_back(corners(1, e));
+      break;
+    case 3:
+      connectivity.push_back(XDMF_TRIANGLE);
+      for (int i = 0; i < 3; ++i)
+        connectivity.push_back(corners(i, e));
+      break;
+    case 4:
+      // Dune numbers the corners of quadrilaterals lexicographically
+      connectivity.push_back(XDMF_QUADRILATERAL);
+      connectivity.push_back(corners(0, e));
+      connectivity.push_back(corners(1, e));
+      connectivity.push_back(corners(3, e));
+      connectivity.push_back(corners(2, e));
+      break;
+    default:
+      throw std::runtime_error("XdmfWriter::XdmfWriter(): Unsupported "
+                               "element type");
+    }
+  }
+
+  size_t connectivityRows = connectivity.size();
+  size_t connectivityColumns = 1;
+  std::ostringstream topology, dimensions;
+  if (uniform && m_cellCount > 0) {
+    // Drop the cell types and node counts
+    const size_t skipped = uniformCornerCount == 2 ? 2 : 1;
+    const size_t recordSize = skipped + uniformCornerCount;
+    size_t out = 0;
+    for (size_t i = 0; i < connectivity.size(); ++i)
+      if (i % recordSize >= skipped)
+        connectivity[out++] = connectivity[i];
+    connectivity.resize(out);
+    connectivityRows = m_cellCount;
+    connectivityColumns = uniformCornerCount;
+    topology << "TopologyType=\""
+             << (uniformCornerCount == 2
+                     ? "Polyline\" NodesPerElement=\"2"
+                     : uniformCornerCount == 3 ? "Triangle" : "Quadrilateral")
+             << "\"";
+    dimensions << m_cellCount << " " << uniformCornerCount;
+  } else {
+    topology << "TopologyType=\"Mixed\"";
+    dimensions << connectivity.size();
+  }
+  topology << " NumberOfElements=\"" << m_cellCount << "\"";
+  m_topology = topology.str();
+  m_connectivityDimensions = dimensions.str();
+
+  const std::string fileName = m_prefix + m_name + ".h5";
+  m_file = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (m_file < 0)
+    throw std::runtime_error("XdmfWriter::XdmfWriter(): File " + fileName +
+                             " could not be created");
+  try {
+    ScopedHandle grid(H5Gcreate2(m_file, "grid", H5P_DEFAULT, H5P_DEFAULT,
+                                 H5P_DEFAULT),
+                      H5Gclose, "creating group grid");
+    writeDataSet(grid, "vertices", nativeType<double>(), m_vertexCount, 3, 0,
+                 coordinates.data());
+    writeDataSet(grid, "connectivity", nativeType<int>(), connectivityRows,
+                 connectivityColumns, 0, connectivity.data());
+    ScopedHandle steps(H5Gcreate2(m_file, "steps", H5P_DEFAULT, H5P_DEFAULT,
+                                  H5P_DEFAULT),
+                       H5Gclose, "creating group steps");
+    writeXdmf();
+  } catch (...) {
+    H5Fclose(m_file);
+    throw;
+  }
+}
+
+XdmfWriter::~XdmfWriter() {
+  try {
+    writeXdmf();
+  } catch (...) {
+  }
+  if (m_stepGroup >= 0)
+    H5Gclose(m_stepGroup);
+  H5Fclose(m_file);
+}
+
+void XdmfWriter::beginStep(double value) {
+  if (m_stepGroup >= 0) {
+    H5Gclose(m_stepGroup);
+    m_stepGroup = -1;
+  }
+  char groupName[32];
+  std::sprintf(groupName, "steps/%d", stepCount());
+  m_stepGroup =
+      H5Gcreate2(m_file, groupName, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (m_stepGroup < 0)
+    throw std::runtime_error("XdmfWriter::beginStep(): Group " +
+                             std::string(groupName) + " could not be created");
+
+  ScopedHandle space(H5Screate(H5S_SCALAR), H5Sclose, "creating dataspace");
+  ScopedHandle attribute(H5Acreate2(m_stepGroup, "value", H5T_NATIVE_DOUBLE,
+                                    space, H5P_DEFAULT, H5P_DEFAULT),
+                         H5Aclose, "creating attribute value");
+  check(H5Awrite(attribute, H5T_NATIVE_DOUBLE, &value),
+        "writing attribute value");
+
+  Step step;
+  step.value = value;
+  m_steps.push_back(step);
+}
+
+int XdmfWriter::stepCount() const { return m_steps.size(); }
+
+template <typename ValueType>
+void XdmfWriter::addCellData(const arma::Mat<ValueType> &data,
+                             const std::string &name) {
+  addField(data, name, false);
+}
+
+template <typename ValueType>
+void XdmfWriter::addVertexData(const arma::Mat<ValueType> &data,
+                               const std::string &name) {
+  addField(data, name, true);
+}
+
+template <typename ValueType>
+void XdmfWriter::addField(const arma::Mat<ValueType> &data,
+                          const std::string &name, bool onVertices) {
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  const char *caller = onVertices ? "addVertexData()" : "addCellData()";
+  const Handle group = currentStepGroup(caller);
+  if (data.n_cols != (onVertices ? m_vertexCount : m_cellCount))
+    throw std::invalid_argument(
+        std::string("XdmfWriter::") + caller +
+        ": number of columns of 'data' does not match the number of " +
+        (onVertices ? "vertices" : "cells"));
+  if (data.n_rows == 0)
+    throw std::invalid_argument(std::string("XdmfWriter::") + caller +
+                                ": 'data' is empty");
+
+  Attribute attribute;
+  attribute.onVertices = onVertices;
+  attribute.componentCount = data.n_rows;
+  attribute.precision = sizeof(RealType);
+  if (sizeof(ValueType) == sizeof(RealType)) {
+    attribute.name = name;
+    writeDataSet(group, name, nativeType<RealType>(), data.n_cols,
+                 data.n_rows, 0, data.memptr());
+    m_steps.back().attributes.push_back(attribute);
+    return;
+  }
+
+  // The real and imaginary parts are written straight from data
+  const char *suffixes[] = {".r", ".i"};
+  for (int part = 1; part <= 2; ++part) {
+    attribute.name = name + suffixes[part - 1];
+    writeDataSet(group, attribute.name, nativeType<RealType>(), data.n_cols,
+                 data.n_rows, part, data.memptr());
+    m_steps.back().attributes.push_back(attribute);
+  }
+  const arma::Mat<RealType> absoluteValues = arma::abs(data);
+  attribute.name = name + ".abs";
+  writeDataSet(group, attribute.name, nativeType<RealType>(), data.n_cols,
+               data.n_rows, 0, absoluteValues.memptr());
+  m_steps.back().attributes.push_back(attribute);
+}
+
+template <typename ValueType>
+void XdmfWriter::addCoefficients(const arma::Col<ValueType> &coefficients,
+                                 const std::string &name) {
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  const Handle step = currentStepGroup("addCoefficients()");
+  const bool exists = H5Lexists(step, "coefficients", H5P_DEFAULT) > 0;
+  ScopedHandle group(
+      exists ? H5Gopen2(step, "coefficients", H5P_DEFAULT)
+             : H5Gcreate2(step, "coefficients", H5P_DEFAULT, H5P_DEFAULT,
+                          H5P_DEFAULT),
+      H5Gclose, "opening group coefficients");
+  writeDataSet(group, name, nativeType<RealType>(), coefficients.n_rows,
+               sizeof(ValueType) / sizeof(RealType), 0,
+               coefficients.memptr());
+}
+
+void XdmfWriter::flush() {
+  check(H5Fflush(m_file, H5F_SCOPE_GLOBAL), "flushing the HDF5 file");
+  writeXdmf();
+}
+
+void XdmfWriter::writeDataSet(Handle group, const std::string &name,
+                              Handle type, size_t rowCount,
+                              size_t columnCount, int part,
+                              const void *data) const {
+  const std::string what = "writing data set " + name;
+  const hsize_t dimensions[2] = {rowCount, columnCount};
+  ScopedHandle fileSpace(H5Screate_simple(2, dimensions, 0), H5Sclose, what);
+  ScopedHandle properties(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, what);
+  if (rowCount > 0) {
+    const size_t rowBytes = H5Tget_size(type) * columnCount;
+    const hsize_t chunk[2] = {
+        std::max<size_t>(1, std::min(rowCount, chunkBytes / rowBytes)),
+        columnCount};
+    check(H5Pset_chunk(properties, 2, chunk), what);
+    if (m_compressionLevel > 0 && H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0) {
+      check(H5Pset_shuffle(properties), what);
+      check(H5Pset_deflate(properties, m_compressionLevel), what);
+    }
+  }
+  ScopedHandle dataSet(H5Dcreate2(group, name.c_str(), type, fileSpace,
+                                  H5P_DEFAULT, properties, H5P_DEFAULT),
+                       H5Dclose, what);
+  if (rowCount == 0)
+    return;
+
+  // Parts of complex values are every other value of data, starting at the
+  // real (part 1) or imaginary (part 2) part of the first value
+  if (part == 0) {
+    check(H5Dwrite(dataSet, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data), what);
+  } else {
+    const hsize_t valueCount = 2 * rowCount * columnCount;
+    ScopedHandle memorySpace(H5Screate_simple(1, &valueCount, 0), H5Sclose,
+                             what);
+    const hsize_t start = part - 1, stride = 2, count = valueCount / 2;
+    check(H5Sselect_hyperslab(memorySpace, H5S_SELECT_SET, &start, &stride,
+                              &count, 0),
+          what);
+    check(H5Dwrite(dataSet, type, memorySpace, H5S_ALL, H5P_DEFAULT, data),
+          what);
+  }
+}
+
+XdmfWriter::Handle XdmfWriter::currentStepGroup(const char *caller) const {
+  if (m_stepGroup < 0)
+    throw std::runtime_error(std::string("XdmfWriter::") + caller +
+                             ": beginStep() has not been called");
+  return m_stepGroup;
+}
+
+void XdmfWriter::writeXdmf() const {
+  const std::string h5Name = m_name + ".h5:";
+  std::ostringstream mesh;
+  mesh << "<Topology " << m_topology << ">\n"
+       << xdmfDataItem(m_connectivityDimensions, nativeType<int>(),
+                       h5Name + "/grid/connectivity")
+       << "</Topology>\n"
+       << "<Geometry GeometryType=\"XYZ\">\n";
+  std::ostringstream vertexDimensions;
+  vertexDimensions << m_vertexCount << " 3";
+  mesh << xdmfDataItem(vertexDimensions.str(), nativeType<double>(),
+                       h5Name + "/grid/vertices")
+       << "</Geometry>\n";
+
+  std::ostringstream out;
+  out.precision(std::numeric_limits<double>::digits10 + 2);
+  out << "<?xml version=\"1.0\" ?>\n"
+      << "<Xdmf Version=\"3.0\">\n<Domain>\n";
+  if (m_steps.empty())
+    out << "<Grid Name=\"" << m_name << "\" GridType=\"Uniform\">\n"
+        << mesh.str() << "</Grid>\n";
+  else
+    out << "<Grid Name=\"" << m_name
+        << "\" GridType=\"Collection\" CollectionType=\"Temporal\">\n";
+  for (size_t s = 0; s < m_steps.size(); ++s) {
+    const Step &step = m_steps[s];
+    out << "<Grid Name=\"step " << s << "\" GridType=\"Uniform\">\n"
+        << "<Time Value=\"" << step.value << "\"/>\n" << mesh.str();
+    for (size_t a = 0; a < step.attributes.size(); ++a) {
+      const Attribute &attribute = step.attributes[a];
+      const size_t entityCount =
+          attribute.onVertices ? m_vertexCount : m_cellCount;
+      std::ostringstream dimensions, location;
+      dimensions << entityCount << " " << attribute.componentCount;
+      location << h5Name << "/steps/" << s << "/" << attribute.name;
+      out << "<Attribute Name=\"" << attribute.name << "\" AttributeType=\""
+          << (attribute.componentCount == 1
+                  ? "Scalar"
+                  : attribute.componentCount == 3 ? "Vector" : "Matrix")
+          << "\" Center=\"" << (attribute.onVertices ? "Node" : "Cell")
+          << "\">\n"
+          << xdmfDataItem(dimensions.str(),
+                          attribute.precision == sizeof(float)
+                              ? nativeType<float>()
+                              : nativeType<double>(),
+                          location.str()) << "</Attribute>\n";
+    }
+    out << "</Grid>\n";
+  }
+  if (!m_steps.empty())
+    out << "</Grid>\n";
+  out << "</Domain>\n</Xdmf>\n";
+
+  const std::string fileName = m_prefix + m_name + ".xdmf";
+  std::ofstream file(fileName.c_str(), std::ios::trunc);
+  file << out.str();
+  if (!file)
+    throw std::runtime_error("XdmfWriter: Error writing file " + fileName);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void exportToXdmf(
+    const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+    const char *dataLabel, XdmfWriter &writer, VtkWriter::DataType dataType) {
+  if (!gridFunction.space())
+    throw std::runtime_error("exportToXdmf(): gridFunction must not be "
+                             "an uninitialized GridFunction object");
+  arma::Mat<ResultType> data;
+  gridFunction.evaluateAtSpecialPoints(dataType, data);
+  if (dataType == VtkWriter::CELL_DATA)
+    writer.addCellData(data, dataLabel);
+  else // VERTEX_DATA
+    writer.addVertexData(data, dataLabel);
+  writer.addCoefficients(gridFunction.coefficients(), dataLabel);
+}
+
+#define INSTANTIATE_MEMBER_TEMPLATES(VALUE)                                    \
+  template void XdmfWriter::addCellData(const arma::Mat<VALUE> &data,          \
+                                        const std::string &name);              \
+  template void XdmfWriter::addVertexData(const arma::Mat<VALUE> &data,        \
+                                          const std::string &name);            \
+  template void XdmfWriter::addCoefficients(                                   \
+      const arma::Col<VALUE> &coefficients, const std::string &name)
+
+INSTANTIATE_MEMBER_TEMPLATES(float);
+INSTANTIATE_MEMBER_TEMPLATES(double);
+INSTANTIATE_MEMBER_TEMPLATES(std::complex<float>);
+INSTANTIATE_MEMBER_TEMPLATES(std::complex<double>);
+
+#define INSTANTIATE_FREE_FUNCTIONS(BASIS, RESULT)                              \
+  template void exportToXdmf(const GridFunction<BASIS, RESULT> &gridFunction,  \
+                             const char *dataLabel, XdmfWriter &writer,        \
+                             VtkWriter::DataType dataType)
+
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_FREE_FUNCTIONS)
+
+} // namespace Bempp
+
+#endif // WITH_HDF5
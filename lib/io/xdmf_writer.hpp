@@ -0,0 +1,162 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_xdmf_writer_hpp
+#define bempp_xdmf_writer_hpp
+
+#include "bempp/common/config_hdf5.hpp"
+
+#ifdef WITH_HDF5
+
+#include "../common/common.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include "../grid/vtk_writer.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+class GridView;
+template <typename BasisFunctionType, typename ResultType> class GridFunction;
+/** \endcond */
+
+/** \brief Writer of grids and grid data in the HDF5/XDMF format.
+ *
+ *  The grid view is stored once, in the HDF5 file \c name.h5. Data are
+ *  organised in steps, e.g. the time steps of a time series or the
+ *  frequencies of a sweep: each call to beginStep() starts a new step, to
+ *  which cell data, vertex data and raw coefficient vectors can then be
+ *  added. All data sets are chunked and compressed with the deflate filter
+ *  if the HDF5 library provides it, and the HDF5 file stays open for the
+ *  lifetime of the writer, so appending a step is cheap.
+ *
+ *  The XDMF file \c name.xdmf describes the cell and vertex data of all
+ *  steps as a temporal collection that ParaView can open directly.
+ *  Coefficient vectors are stored in the HDF5 file only. The XDMF file is
+ *  rewritten by flush() and by the destructor.
+ *
+ *  As in VtuWriter, complex fields are stored as three real arrays named
+ *  name.r, name.i and name.abs. Complex coefficient vectors are stored as
+ *  arrays with two columns holding their real and imaginary parts. */
+class XdmfWriter : boost::noncopyable {
+public:
+  /** \brief Create the files \p name.h5 and \p name.xdmf in the directory
+   *  \p path (the current directory if it is empty) and store the grid view
+   *  \p view in them. Existing files are overwritten.
+   *
+   *  \p compressionLevel is the deflate level, from 0 (no compression) to
+   *  9. */
+  XdmfWriter(const GridView &view, const std::string &name,
+             const std::string &path = std::string(),
+             int compressionLevel = 4);
+
+  /** \brief Write the XDMF file and close the HDF5 file. */
+  ~XdmfWriter();
+
+  /** \brief Start a new step.
+   *
+   *  \p value is the time or parameter, e.g. the frequency, of the step. */
+  void beginStep(double value);
+
+  /** \brief Number of steps started so far. */
+  int stepCount() const;
+
+  /** \brief Add cell data to the current step.
+   *
+   *  The <tt>(i, j)</tt>th element of \p data is the <em>i</em>th component
+   *  of the field on the <em>j</em>th cell. */
+  template <typename ValueType>
+  void addCellData(const arma::Mat<ValueType> &data, const std::string &name);
+
+  /** \brief Add vertex data to the current step.
+   *
+   *  The <tt>(i, j)</tt>th element of \p data is the <em>i</em>th component
+   *  of the field at the <em>j</em>th vertex. */
+  template <typename ValueType>
+  void addVertexData(const arma::Mat<ValueType> &data,
+                     const std::string &name);
+
+  /** \brief Add a coefficient vector to the current step.
+   *
+   *  The vector is stored in the group coefficients of the step. */
+  template <typename ValueType>
+  void addCoefficients(const arma::Col<ValueType> &coefficients,
+                       const std::string &name);
+
+  /** \brief Flush the HDF5 file and rewrite the XDMF file. */
+  void flush();
+
+private:
+  typedef std::int64_t Handle; // hid_t
+
+  struct Attribute {
+    std::string name;
+    bool onVertices;
+    size_t componentCount;
+    size_t precision;
+  };
+
+  struct Step {
+    double value;
+    std::vector<Attribute> attributes;
+  };
+
+  template <typename ValueType>
+  void addField(const arma::Mat<ValueType> &data, const std::string &name,
+                bool onVertices);
+  void writeDataSet(Handle group, const std::string &name, Handle type,
+                    size_t rowCount, size_t columnCount, int part,
+                    const void *data) const;
+  Handle currentStepGroup(const char *caller) const;
+  void writeXdmf() const;
+
+  std::string m_name;
+  std::string m_prefix;
+  int m_compressionLevel;
+  size_t m_vertexCount;
+  size_t m_cellCount;
+  std::string m_topology;
+  std::string m_connectivityDimensions;
+  std::vector<Step> m_steps;
+  Handle m_file;
+  Handle m_stepGroup;
+};
+
+/** \relates XdmfWriter
+ *  \brief Add the values and the coefficients of a grid function to the
+ *  current step of an XdmfWriter.
+ *
+ *  The values at vertices or cells, depending on \p dataType, are stored as
+ *  \p dataLabel; the coefficient vector is stored under the same name. */
+template <typename BasisFunctionType, typename ResultType>
+void exportToXdmf(
+    const GridFunction<BasisFunctionType, ResultType> &gridFunction,
+    const char *dataLabel, XdmfWriter &writer,
+    VtkWriter::DataType dataType = VtkWriter::VERTEX_DATA);
+
+} // namespace Bempp
+
+#endif // WITH_HDF5
+
+#endif
@@ -46,81 +46,79 @@ namespace Bempp {
 // Overloaded template helper functions
 namespace {
 
+template <typename MagnitudeType>
+Teuchos::RCP<Thyra::BelosLinearOpWithSolveFactory<MagnitudeType>>
+makeSolverFactory(const Teuchos::RCP<Teuchos::ParameterList> &paramList) {
+  Teuchos::RCP<Teuchos::FancyOStream> out =
+      Teuchos::VerboseObjectBase::getDefaultOStream();
+
+  Teuchos::RCP<Thyra::BelosLinearOpWithSolveFactory<MagnitudeType>>
+  invertibleOpFactory(
+      new Thyra::BelosLinearOpWithSolveFactory<MagnitudeType>);
+  invertibleOpFactory->setParameterList(paramList);
+  invertibleOpFactory->setOStream(out);
+  invertibleOpFactory->setVerbLevel(Teuchos::VERB_DEFAULT);
+  return invertibleOpFactory;
+}
+
+// (Re)initialize op for the operator linOp. If op has been initialized
+// before, Thyra reuses its Belos solver manager, together with any subspace
+// it has recycled.
+
 // Real ValueType
 template <typename ValueType>
 typename boost::enable_if<
     boost::is_same<ValueType, typename ScalarTraits<ValueType>::RealType>,
-    Teuchos::RCP<Thyra::LinearOpWithSolveBase<
-        typename ScalarTraits<ValueType>::RealType>>>::type
-makeOperatorWithSolve(
-    const Teuchos::RCP<Teuchos::ParameterList> &paramList,
+    void>::type
+initializeOperatorWithSolve(
+    const Thyra::BelosLinearOpWithSolveFactory<ValueType> &invertibleOpFactory,
     const Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> &linOp,
     const Teuchos::RCP<const Thyra::PreconditionerBase<ValueType>> &
-        preconditioner) {
-  Teuchos::RCP<Teuchos::FancyOStream> out =
-      Teuchos::VerboseObjectBase::getDefaultOStream();
-
-  Thyra::BelosLinearOpWithSolveFactory<ValueType> invertibleOpFactory;
-  invertibleOpFactory.setParameterList(paramList);
-  invertibleOpFactory.setOStream(out);
-  invertibleOpFactory.setVerbLevel(Teuchos::VERB_DEFAULT);
-
-  Teuchos::RCP<Thyra::LinearOpWithSolveBase<ValueType>> result;
+        preconditioner,
+    Thyra::LinearOpWithSolveBase<ValueType> &op) {
+  Teuchos::RCP<const Thyra::LinearOpSourceBase<ValueType>> linOpSourcePtr(
+      new Thyra::DefaultLinearOpSource<ValueType>(linOp));
   if (preconditioner.is_null())
     // No preconditioner
-    result = Thyra::linearOpWithSolve(invertibleOpFactory, linOp);
-  else {
+    invertibleOpFactory.initializeOp(linOpSourcePtr, &op,
+                                     Thyra::SUPPORT_SOLVE_UNSPECIFIED);
+  else
     // Preconditioner defined
-    result = invertibleOpFactory.createOp();
-    Teuchos::RCP<const Thyra::LinearOpSourceBase<ValueType>> linOpSourcePtr(
-        new Thyra::DefaultLinearOpSource<ValueType>(linOp));
     invertibleOpFactory.initializePreconditionedOp(
-        linOpSourcePtr, preconditioner, result.get(),
-        Thyra::SUPPORT_SOLVE_UNSPECIFIED);
-  }
-  return result;
+        linOpSourcePtr, preconditioner, &op, Thyra::SUPPORT_SOLVE_UNSPECIFIED);
 }
 
 // Complex ValueType
 template <typename ValueType>
 typename boost::disable_if<
     boost::is_same<ValueType, typename ScalarTraits<ValueType>::RealType>,
-    Teuchos::RCP<Thyra::LinearOpWithSolveBase<
-        typename ScalarTraits<ValueType>::RealType>>>::type
-makeOperatorWithSolve(
-    const Teuchos::RCP<Teuchos::ParameterList> &paramList,
+    void>::type
+initializeOperatorWithSolve(
+    const Thyra::BelosLinearOpWithSolveFactory<
+        typename ScalarTraits<ValueType>::RealType> &invertibleOpFactory,
     const Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> &linOp,
     const Teuchos::RCP<const Thyra::PreconditionerBase<ValueType>> &
-        preconditioner) {
+        preconditioner,
+    Thyra::LinearOpWithSolveBase<typename ScalarTraits<ValueType>::RealType> &
+        op) {
   typedef typename ScalarTraits<ValueType>::RealType RealType;
 
-  Teuchos::RCP<Teuchos::FancyOStream> out =
-      Teuchos::VerboseObjectBase::getDefaultOStream();
-
-  Thyra::BelosLinearOpWithSolveFactory<RealType> invertibleOpFactory;
-  invertibleOpFactory.setParameterList(paramList);
-  invertibleOpFactory.setOStream(out);
-  invertibleOpFactory.setVerbLevel(Teuchos::VERB_DEFAULT);
-
   Teuchos::RCP<const Thyra::LinearOpBase<RealType>> realLinOp(
       new RealWrapperOfComplexThyraLinearOperator<RealType>(linOp));
-
-  Teuchos::RCP<Thyra::LinearOpWithSolveBase<RealType>> result;
+  Teuchos::RCP<const Thyra::LinearOpSourceBase<RealType>> realLinOpSourcePtr(
+      new Thyra::DefaultLinearOpSource<RealType>(realLinOp));
   if (preconditioner.is_null())
     // No preconditioner
-    result = Thyra::linearOpWithSolve(invertibleOpFactory, realLinOp);
+    invertibleOpFactory.initializeOp(realLinOpSourcePtr, &op,
+                                     Thyra::SUPPORT_SOLVE_UNSPECIFIED);
   else {
     // Preconditioner defined
-    result = invertibleOpFactory.createOp();
-    Teuchos::RCP<const Thyra::LinearOpSourceBase<RealType>> realLinOpSourcePtr(
-        new Thyra::DefaultLinearOpSource<RealType>(realLinOp));
     Teuchos::RCP<const Thyra::PreconditionerBase<RealType>> realPreconditioner(
         new RealWrapperOfComplexThyraPreconditioner<RealType>(preconditioner));
     invertibleOpFactory.initializePreconditionedOp(
-        realLinOpSourcePtr, realPreconditioner, result.get(),
+        realLinOpSourcePtr, realPreconditioner, &op,
         Thyra::SUPPORT_SOLVE_UNSPECIFIED);
   }
-  return result;
 }
 
 // Real ValueType
@@ -225,8 +223,19 @@ void BelosSolverWrapper<ValueType>::setPreconditioner(const Teuchos::RCP<
 template <typename ValueType>
 void BelosSolverWrapper<ValueType>::initializeSolver(
     const Teuchos::RCP<Teuchos::ParameterList> &paramList) {
-  m_linOpWithSolve =
-      makeOperatorWithSolve(paramList, m_linOp, m_preconditioner);
+  m_solverFactory = makeSolverFactory<MagnitudeType>(paramList);
+  m_linOpWithSolve = m_solverFactory->createOp();
+  initializeOperatorWithSolve(*m_solverFactory, m_linOp, m_preconditioner,
+                              *m_linOpWithSolve);
+}
+
+template <typename ValueType>
+void BelosSolverWrapper<ValueType>::setLinearOperator(
+    const Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> &linOp) {
+  m_linOp = linOp;
+  if (!m_linOpWithSolve.is_null())
+    initializeOperatorWithSolve(*m_solverFactory, m_linOp, m_preconditioner,
+                                *m_linOpWithSolve);
 }
 
 template <typename ValueType>
@@ -272,6 +281,37 @@ Teuchos::RCP<Teuchos::ParameterList> inline defaultCgParameterListInternal(
   return paramList;
 }
 
+template <typename MagnitudeType>
+Teuchos::RCP<Teuchos::ParameterList> inline defaultGcrodrParameterListInternal(
+    MagnitudeType tol, int maxIterationCount, int recycledBlockCount) {
+  Teuchos::RCP<Teuchos::ParameterList> paramList(
+      new Teuchos::ParameterList("DefaultParameters"));
+  paramList->set("Solver Type", "GCRODR");
+  Teuchos::ParameterList &solverTypesList = paramList->sublist("Solver Types");
+  Teuchos::ParameterList &gcrodrList = solverTypesList.sublist("GCRODR");
+  gcrodrList.set("Convergence Tolerance", tol);
+  gcrodrList.set("Maximum Iterations", maxIterationCount);
+  gcrodrList.set("Num Recycled Blocks", recycledBlockCount);
+  return paramList;
+}
+
+template <typename MagnitudeType>
+Teuchos::RCP<Teuchos::ParameterList> inline
+defaultPipelinedGmresParameterListInternal(MagnitudeType tol,
+                                           int maxIterationCount,
+                                           int restart) {
+  Teuchos::RCP<Teuchos::ParameterList> paramList(
+      new Teuchos::ParameterList("DefaultParameters"));
+  paramList->set("Solver Type", "Pipelined GMRES");
+  Teuchos::ParameterList &solverTypesList = paramList->sublist("Solver Types");
+  Teuchos::ParameterList &pipelinedGmresList =
+      solverTypesList.sublist("Pipelined GMRES");
+  pipelinedGmresList.set("Convergence Tolerance", tol);
+  pipelinedGmresList.set("Maximum Iterations", maxIterationCount);
+  pipelinedGmresList.set("Num Blocks", restart);
+  return paramList;
+}
+
 } // namespace
 
 Teuchos::RCP<Teuchos::ParameterList>
@@ -294,6 +334,34 @@ defaultCgParameterList(float tol, int maxIterationCount) {
   return defaultCgParameterListInternal(tol, maxIterationCount);
 }
 
+Teuchos::RCP<Teuchos::ParameterList>
+defaultGcrodrParameterList(double tol, int maxIterationCount,
+                           int recycledBlockCount) {
+  return defaultGcrodrParameterListInternal(tol, maxIterationCount,
+                                            recycledBlockCount);
+}
+
+Teuchos::RCP<Teuchos::ParameterList>
+defaultGcrodrParameterList(float tol, int maxIterationCount,
+                           int recycledBlockCount) {
+  return defaultGcrodrParameterListInternal(tol, maxIterationCount,
+                                            recycledBlockCount);
+}
+
+Teuchos::RCP<Teuchos::ParameterList>
+defaultPipelinedGmresParameterList(double tol, int maxIterationCount,
+                                   int restart) {
+  return defaultPipelinedGmresParameterListInternal(tol, maxIterationCount,
+                                                    restart);
+}
+
+Teuchos::RCP<Teuchos::ParameterList>
+defaultPipelinedGmresParameterList(float tol, int maxIterationCount,
+                                   int restart) {
+  return defaultPipelinedGmresParameterListInternal(tol, maxIterationCount,
+                                                    restart);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(BelosSolverWrapper);
 
 } // namespace Bempp
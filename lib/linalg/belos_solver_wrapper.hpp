@@ -30,6 +30,7 @@ namespace Thyra {
 /** \cond FORWARD_DECL */
 template <typename ValueType> class PreconditionerBase;
 template <typename ValueType> class LinearOpWithSolveBase;
+template <typename ValueType> class BelosLinearOpWithSolveFactory;
 /** \endcond */
 }
 
@@ -49,6 +50,14 @@ public:
 
   void initializeSolver(const Teuchos::RCP<Teuchos::ParameterList> &paramList);
 
+  /** \brief Replace the operator of the linear system.
+
+    If the solver has already been initialized, it is reinitialized with
+    the new operator without discarding the state of the underlying Belos
+    solver, in particular the recycled subspace of GCRODR. */
+  void setLinearOperator(
+      const Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> &linOp);
+
   Thyra::SolveStatus<MagnitudeType>
   solve(const Thyra::EOpTransp trans,
         const Thyra::MultiVectorBase<ValueType> &rhs,
@@ -57,8 +66,9 @@ public:
 private:
   Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> m_linOp;
   Teuchos::RCP<const Thyra::PreconditionerBase<ValueType>> m_preconditioner;
-  Teuchos::RCP<const Thyra::LinearOpWithSolveBase<MagnitudeType>>
-  m_linOpWithSolve;
+  Teuchos::RCP<Thyra::BelosLinearOpWithSolveFactory<MagnitudeType>>
+  m_solverFactory;
+  Teuchos::RCP<Thyra::LinearOpWithSolveBase<MagnitudeType>> m_linOpWithSolve;
 };
 
 } // namespace Bempp
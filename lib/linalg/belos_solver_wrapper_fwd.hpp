@@ -23,6 +23,36 @@ defaultGmresParameterList(float tol, int maxIterationCount = 1000);
 Teuchos::RCP<Teuchos::ParameterList>
 defaultCgParameterList(float tol, int maxIterationCount = 1000);
 
+/** \brief Parameter list selecting the GCRODR solver of Belos.
+ *
+ *  GCRODR keeps a subspace of \p recycledBlockCount approximate eigenvectors
+ *  of the operator between successive solves with the same solver and uses
+ *  it to deflate the following systems. This pays off in sequences of
+ *  related solves, e.g. with DefaultIterativeSolver::setBoundaryOperator().
+ */
+Teuchos::RCP<Teuchos::ParameterList>
+defaultGcrodrParameterList(double tol, int maxIterationCount = 1000,
+                           int recycledBlockCount = 10);
+Teuchos::RCP<Teuchos::ParameterList>
+defaultGcrodrParameterList(float tol, int maxIterationCount = 1000,
+                           int recycledBlockCount = 10);
+
+/** \brief Parameter list selecting the pipelined GMRES solver.
+ *
+ *  This solver is not part of Belos; DefaultIterativeSolver runs
+ *  pipelinedGmres() instead, restarted every \p restart iterations. It
+ *  overlaps each operator application with the orthogonalisation of the
+ *  previous Krylov vector, which pays off for distributed operators whose
+ *  application ends with a global reduction. Only right preconditioners
+ *  are supported.
+ */
+Teuchos::RCP<Teuchos::ParameterList>
+defaultPipelinedGmresParameterList(double tol, int maxIterationCount = 1000,
+                                   int restart = 30);
+Teuchos::RCP<Teuchos::ParameterList>
+defaultPipelinedGmresParameterList(float tol, int maxIterationCount = 1000,
+                                   int restart = 30);
+
 } // namespace Bempp
 
 #endif // WITH_TRILINOS
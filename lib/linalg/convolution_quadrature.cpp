@@ -0,0 +1,413 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_mpi.hpp"
+
+#include "convolution_quadrature.hpp"
+
+#include "../assembly/context.hpp"
+#include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/elementary_integral_operator_base.hpp"
+#include "../assembly/modified_helmholtz_3d_single_layer_boundary_operator.hpp"
+#include "../common/complex_aux.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/task_arena_cache.hpp"
+
+#ifdef WITH_MPI
+#include "../common/mpi_datatype.hpp"
+#endif
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Bempp {
+
+namespace {
+
+// Discrete Fourier transforms of a fixed length n, computed in place by
+// the radix-2 algorithm if n is a power of two and by Bluestein's
+// algorithm, i.e. as a convolution of twice the length rounded up to a
+// power of two, otherwise
+template <typename CoordinateType> class FourierTransform {
+public:
+  typedef std::complex<CoordinateType> ComplexType;
+
+  explicit FourierTransform(std::size_t n) : m_n(n) {
+    m_paddedSize = 1;
+    while (m_paddedSize < n)
+      m_paddedSize <<= 1;
+    if (m_paddedSize == n)
+      return;
+
+    // Chirp w_k = exp(i pi k^2 / n); k^2 is reduced modulo 2n to keep the
+    // angles accurate
+    m_paddedSize = 1;
+    while (m_paddedSize < 2 * n - 1)
+      m_paddedSize <<= 1;
+    m_chirp.resize(n);
+    for (std::size_t k = 0; k < n; ++k) {
+      const std::size_t k2 = (k * k) % (2 * n);
+      m_chirp[k] = std::polar(CoordinateType(1.),
+                              CoordinateType(M_PI * double(k2) / double(n)));
+    }
+    m_forwardKernel.assign(m_paddedSize, ComplexType(0.));
+    m_forwardKernel[0] = m_chirp[0];
+    for (std::size_t k = 1; k < n; ++k)
+      m_forwardKernel[k] = m_forwardKernel[m_paddedSize - k] = m_chirp[k];
+    m_backwardKernel.resize(m_paddedSize);
+    for (std::size_t k = 0; k < m_paddedSize; ++k)
+      m_backwardKernel[k] = std::conj(m_forwardKernel[k]);
+    radix2(m_forwardKernel, -1);
+    radix2(m_backwardKernel, -1);
+  }
+
+  std::size_t size() const { return m_n; }
+
+  // x_l <- sum_k x_k exp(sign 2 pi i k l / n), with sign = -1 or 1;
+  // work is scratch space
+  void apply(std::vector<ComplexType> &x, int sign,
+             std::vector<ComplexType> &work) const {
+    if (m_chirp.empty()) {
+      radix2(x, sign);
+      return;
+    }
+    // kl = (k^2 + l^2 - (l - k)^2) / 2
+    work.assign(m_paddedSize, ComplexType(0.));
+    for (std::size_t k = 0; k < m_n; ++k)
+      work[k] = x[k] * chirp(k, sign);
+    radix2(work, -1);
+    const std::vector<ComplexType> &kernel =
+        sign < 0 ? m_forwardKernel : m_backwardKernel;
+    for (std::size_t k = 0; k < m_paddedSize; ++k)
+      work[k] *= kernel[k];
+    radix2(work, 1);
+    const CoordinateType scale = CoordinateType(1.) / m_paddedSize;
+    for (std::size_t l = 0; l < m_n; ++l)
+      x[l] = work[l] * chirp(l, sign) * scale;
+  }
+
+private:
+  // exp(sign i pi k^2 / n)
+  ComplexType chirp(std::size_t k, int sign) const {
+    return sign > 0 ? m_chirp[k] : std::conj(m_chirp[k]);
+  }
+
+  static void radix2(std::vector<ComplexType> &x, int sign) {
+    const std::size_t n = x.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+      std::size_t bit = n >> 1;
+      for (; j & bit; bit >>= 1)
+        j ^= bit;
+      j ^= bit;
+      if (i < j)
+        std::swap(x[i], x[j]);
+    }
+    for (std::size_t length = 2; length <= n; length <<= 1) {
+      const std::size_t half = length / 2;
+      for (std::size_t j = 0; j < half; ++j) {
+        const ComplexType w = std::polar(
+            CoordinateType(1.),
+            CoordinateType(sign * 2. * M_PI * double(j) / double(length)));
+        for (std::size_t i = 0; i < n; i += length) {
+          const ComplexType u = x[i + j];
+          const ComplexType v = x[i + j + half] * w;
+          x[i + j] = u + v;
+          x[i + j + half] = u - v;
+        }
+      }
+    }
+  }
+
+  std::size_t m_n;
+  std::size_t m_paddedSize;
+  std::vector<ComplexType> m_chirp;
+  // Transforms of the chirp arranged for the cyclic convolution
+  std::vector<ComplexType> m_forwardKernel;
+  std::vector<ComplexType> m_backwardKernel;
+};
+
+// Transform each row of data in place, in parallel
+template <typename CoordinateType>
+void transformRows(const FourierTransform<CoordinateType> &transform,
+                   int sign, int maxThreadCount,
+                   arma::Mat<std::complex<CoordinateType>> &data) {
+  typedef std::complex<CoordinateType> ComplexType;
+  Fiber::executeInTaskArena(maxThreadCount, [&] {
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, data.n_rows),
+        [&](const tbb::blocked_range<std::size_t> &r) {
+          std::vector<ComplexType> row(data.n_cols), work;
+          for (std::size_t i = r.begin(); i != r.end(); ++i) {
+            for (std::size_t j = 0; j < data.n_cols; ++j)
+              row[j] = data(i, j);
+            transform.apply(row, sign, work);
+            for (std::size_t j = 0; j < data.n_cols; ++j)
+              data(i, j) = row[j];
+          }
+        });
+  });
+}
+
+} // namespace
+
+template <typename BasisFunctionType>
+ConvolutionQuadrature<BasisFunctionType>::ConvolutionQuadrature(
+    std::size_t timeStepCount, CoordinateType timeStep,
+    const ConvolutionQuadratureOptions &options)
+    : m_timeStep(timeStep), m_options(options) {
+  if (timeStepCount == 0)
+    throw std::invalid_argument("ConvolutionQuadrature::"
+                                "ConvolutionQuadrature(): "
+                                "timeStepCount must be positive");
+  if (!(timeStep > 0))
+    throw std::invalid_argument("ConvolutionQuadrature::"
+                                "ConvolutionQuadrature(): "
+                                "timeStep must be positive");
+  if (options.radius < 0. || options.radius >= 1.)
+    throw std::invalid_argument("ConvolutionQuadrature::"
+                                "ConvolutionQuadrature(): "
+                                "radius must lie in [0, 1)");
+  if (options.batchSize < 1)
+    throw std::invalid_argument("ConvolutionQuadrature::"
+                                "ConvolutionQuadrature(): "
+                                "batchSize must be positive");
+
+  m_radius = options.radius > 0.
+                 ? CoordinateType(options.radius)
+                 : std::pow(std::numeric_limits<CoordinateType>::epsilon(),
+                            CoordinateType(0.5) / timeStepCount);
+  m_laplaceParameters.resize(timeStepCount);
+  for (std::size_t l = 0; l < timeStepCount; ++l) {
+    const ResultType z = std::polar(
+        m_radius, CoordinateType(-2. * M_PI * double(l) /
+                                 double(timeStepCount)));
+    const ResultType gamma =
+        options.method == ConvolutionQuadratureOptions::BDF1
+            ? CoordinateType(1.) - z
+            : (CoordinateType(1.) - z) +
+                  CoordinateType(0.5) * (CoordinateType(1.) - z) *
+                      (CoordinateType(1.) - z);
+    m_laplaceParameters[l] = gamma / timeStep;
+  }
+}
+
+template <typename BasisFunctionType>
+arma::Mat<typename ConvolutionQuadrature<BasisFunctionType>::CoordinateType>
+ConvolutionQuadrature<BasisFunctionType>::solve(
+    const OperatorFactory &makeOperator,
+    const arma::Mat<CoordinateType> &rhs) const {
+  typedef ElementaryIntegralOperatorBase<BasisFunctionType, ResultType>
+  ElementaryOp;
+
+  const std::size_t M = timeStepCount();
+  if (rhs.n_cols != M)
+    throw std::invalid_argument("ConvolutionQuadrature::solve(): "
+                                "rhs must have one column per time step");
+  const int maxThreadCount = m_options.sweepOptions.maxThreadCount;
+
+  // Scale by radius^n and transform to the frequency domain
+  arma::Mat<ResultType> data(rhs.n_rows, M);
+  CoordinateType scale = 1.;
+  for (std::size_t n = 0; n < M; ++n, scale *= m_radius)
+    for (std::size_t i = 0; i < rhs.n_rows; ++i)
+      data(i, n) = scale * rhs(i, n);
+  FourierTransform<CoordinateType> transform(M);
+  transformRows(transform, -1, maxThreadCount, data);
+
+  // Solve for the parameters l = 0, ..., M / 2; the solutions for the
+  // others are their complex conjugates. Column l of data is replaced by
+  // the solution once it has been computed.
+  const std::size_t parameterCount = M / 2 + 1;
+  const std::size_t batchSize = m_options.batchSize;
+  const std::size_t batchCount = (parameterCount + batchSize - 1) / batchSize;
+  auto storeSolutions = [&](std::size_t batch,
+                            const arma::Mat<ResultType> &solutions) {
+    for (std::size_t i = 0; i < solutions.n_cols; ++i) {
+      const std::size_t l = batch * batchSize + i;
+      data.col(l) = solutions.col(i);
+      if (l > 0 && M - l != l)
+        data.col(M - l) = arma::conj(solutions.col(i));
+    }
+  };
+
+  // With MPI, the batches are dealt out to the processes cyclically
+  std::size_t rank = 0, rankCount = 1;
+#ifdef WITH_MPI
+  int initialized = 0;
+  MPI_Initialized(&initialized);
+  if (initialized) {
+    int mpiRank, mpiSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+    rank = mpiRank;
+    rankCount = mpiSize;
+  }
+#endif
+  auto localBatchCount = [&](std::size_t r) {
+    return batchCount > r ? (batchCount - r - 1) / rankCount + 1 : 0;
+  };
+  auto batchRange = [&](std::size_t batch) {
+    return std::make_pair(batch * batchSize,
+                          std::min((batch + 1) * batchSize, parameterCount));
+  };
+
+  FrequencySweep sweep(m_options.sweepOptions);
+  sweep.run(
+      localBatchCount(rank),
+      [&](std::size_t localBatch) {
+        const std::size_t batch = rank + localBatch * rankCount;
+        const std::size_t begin = batchRange(batch).first;
+        const std::size_t end = batchRange(batch).second;
+
+        std::vector<BoundaryOperator<BasisFunctionType, ResultType>> ops;
+        std::vector<const ElementaryOp *> elementaryOps;
+        bool jointly = end - begin > 1;
+        for (std::size_t l = begin; l < end; ++l) {
+          ops.push_back(makeOperator(m_laplaceParameters[l]));
+          if (!ops.back().isInitialized())
+            throw std::invalid_argument("ConvolutionQuadrature::solve(): "
+                                        "the operator factory returned an "
+                                        "uninitialized operator");
+          const ElementaryOp *op = dynamic_cast<const ElementaryOp *>(
+              ops.back().abstractOperator().get());
+          jointly = jointly && op && ops.back().context() == ops[0].context();
+          elementaryOps.push_back(op);
+        }
+        std::vector<shared_ptr<const DiscreteBoundaryOperator<ResultType>>>
+            weakForms;
+        if (jointly) {
+          std::vector<shared_ptr<DiscreteBoundaryOperator<ResultType>>>
+              assembled =
+                  ElementaryOp::assembleWeakForms(elementaryOps,
+                                                  *ops[0].context());
+          weakForms.assign(assembled.begin(), assembled.end());
+        } else
+          for (std::size_t i = 0; i < ops.size(); ++i)
+            weakForms.push_back(ops[i].weakForm());
+        ops.clear();
+
+        arma::Mat<ResultType> solutions(data.n_rows, end - begin);
+        for (std::size_t i = 0; i < weakForms.size(); ++i) {
+          if (weakForms[i]->rowCount() != data.n_rows)
+            throw std::invalid_argument(
+                "ConvolutionQuadrature::solve(): the number of rows of rhs "
+                "must be equal to the dimension of the dual space to the "
+                "range of the operators");
+          arma::Mat<ResultType> x = data.col(begin + i);
+          DenseLuDecomposition<ResultType>(*weakForms[i], m_options.luOptions)
+              .solve(x);
+          weakForms[i].reset();
+          solutions.col(i) = x;
+        }
+        return solutions;
+      },
+      [&](std::size_t localBatch, const arma::Mat<ResultType> &solutions) {
+        storeSolutions(rank + localBatch * rankCount, solutions);
+      });
+
+#ifdef WITH_MPI
+  // Every process needs all solutions for the inverse transform
+  if (rankCount > 1) {
+    std::vector<int> counts(rankCount, 0), displacements(rankCount, 0);
+    for (std::size_t r = 0; r < rankCount; ++r) {
+      for (std::size_t k = 0; k < localBatchCount(r); ++k) {
+        const std::pair<std::size_t, std::size_t> range =
+            batchRange(r + k * rankCount);
+        counts[r] +=
+            static_cast<int>((range.second - range.first) * data.n_rows);
+      }
+      if (r > 0)
+        displacements[r] = displacements[r - 1] + counts[r - 1];
+    }
+    std::vector<ResultType> local;
+    local.reserve(counts[rank]);
+    for (std::size_t k = 0; k < localBatchCount(rank); ++k) {
+      const std::pair<std::size_t, std::size_t> range =
+          batchRange(rank + k * rankCount);
+      local.insert(local.end(), data.colptr(range.first),
+                   data.colptr(range.first) +
+                       (range.second - range.first) * data.n_rows);
+    }
+    std::vector<ResultType> all(displacements.back() + counts.back());
+    MPI_Allgatherv(local.data(), counts[rank], mpiDatatype<ResultType>(),
+                   all.data(), counts.data(), displacements.data(),
+                   mpiDatatype<ResultType>(), MPI_COMM_WORLD);
+    for (std::size_t r = 0; r < rankCount; ++r) {
+      std::size_t position = displacements[r];
+      for (std::size_t k = 0; k < localBatchCount(r); ++k) {
+        const std::size_t batch = r + k * rankCount;
+        const std::pair<std::size_t, std::size_t> range = batchRange(batch);
+        const arma::Mat<ResultType> solutions(
+            all.data() + position, data.n_rows, range.second - range.first);
+        storeSolutions(batch, solutions);
+        position += solutions.n_elem;
+      }
+    }
+  }
+#endif
+
+  // Transform back and undo the scaling
+  transformRows(transform, 1, maxThreadCount, data);
+  arma::Mat<CoordinateType> result(data.n_rows, M);
+  scale = CoordinateType(1.) / M;
+  for (std::size_t n = 0; n < M; ++n, scale /= m_radius)
+    for (std::size_t i = 0; i < data.n_rows; ++i)
+      result(i, n) = scale * realPart(data(i, n));
+  return result;
+}
+
+template <typename BasisFunctionType>
+typename ConvolutionQuadrature<BasisFunctionType>::OperatorFactory
+modifiedHelmholtz3dSingleLayerOperatorFactory(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange) {
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType ResultType;
+  return [=](ResultType s) {
+    return modifiedHelmholtz3dSingleLayerBoundaryOperator<
+        BasisFunctionType, ResultType, ResultType>(context, domain, range,
+                                                   dualToRange, s);
+  };
+}
+
+#define INSTANTIATE_FACTORY(BASIS)                                             \
+  template ConvolutionQuadrature<BASIS>::OperatorFactory                       \
+  modifiedHelmholtz3dSingleLayerOperatorFactory(                               \
+      const shared_ptr<                                                        \
+          const Context<BASIS, ScalarTraits<BASIS>::ComplexType>> &,           \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &,                                  \
+      const shared_ptr<const Space<BASIS>> &)
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(ConvolutionQuadrature);
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_FACTORY);
+
+} // namespace Bempp
@@ -0,0 +1,183 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_convolution_quadrature_hpp
+#define bempp_convolution_quadrature_hpp
+
+#include "../common/common.hpp"
+
+#include "dense_lu_decomposition.hpp"
+
+#include "../assembly/boundary_operator.hpp"
+#include "../assembly/frequency_sweep.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType> class Context;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup linalg
+ *  \brief Options controlling a ConvolutionQuadrature. */
+struct ConvolutionQuadratureOptions {
+  enum Method {
+    /** \brief Backward Euler, first order. */
+    BDF1,
+    /** \brief Second-order backward differentiation formula. */
+    BDF2
+  };
+
+  ConvolutionQuadratureOptions() : method(BDF2), radius(0.), batchSize(1) {}
+
+  Method method;
+  /** \brief Radius of the circle on which the generating functions are
+   *  sampled. If 0, it is chosen such that <tt>radius^M</tt> is the square
+   *  root of the machine epsilon of the coordinate type, where \p M is the
+   *  number of time steps, which balances the aliasing and round-off
+   *  errors. */
+  double radius;
+  /** \brief Number of Laplace parameters whose operators are created and
+   *  assembled together. Batches of elementary integral operators are
+   *  assembled by ElementaryIntegralOperatorBase::assembleWeakForms(). */
+  int batchSize;
+  /** \brief Options of the sweep over the batches. */
+  FrequencySweepOptions sweepOptions;
+  /** \brief Options of the LU decompositions of the weak forms. */
+  DenseLuOptions luOptions;
+};
+
+/** \ingroup linalg
+ *  \brief Solver of time-domain boundary integral equations discretised by
+ *  convolution quadrature.
+ *
+ *  Given an operator family \f$K(s)\f$ depending on the Laplace parameter
+ *  \f$s\f$, e.g. the modified Helmholtz single-layer operator with wave
+ *  number \f$s\f$ for the retarded single-layer potential of the wave
+ *  equation, solve() computes \f$\phi_0, \dots, \phi_{M-1}\f$ such that
+ *  \f[
+ *    \sum_{j=0}^n \omega_{n-j}(K)\, \phi_j = g_n, \quad n = 0, \dots, M-1,
+ *  \f]
+ *  where the convolution weights \f$\omega_n(K)\f$ are the coefficients of
+ *  \f$K(\gamma(z)/\Delta t) = \sum_n \omega_n(K) z^n\f$ and \f$\gamma\f$
+ *  is the generating function of the method.
+ *
+ *  The equations decouple after a scaled discrete Fourier transform in
+ *  time: the transformed right-hand sides are obtained by a fast Fourier
+ *  transform, one frequency-domain problem with the operator \f$K(s_l)\f$
+ *  is solved for each Laplace parameter \f$s_l\f$ (see
+ *  laplaceParameters()), and the solutions are transformed back. Since the
+ *  data are real and \f$K(\bar s) = \overline{K(s)}\f$, only the parameters
+ *  with nonnegative imaginary part are needed, i.e. about half of them.
+ *
+ *  The frequency-domain problems are processed by a FrequencySweep, so
+ *  that several of them run concurrently within the memory budget of the
+ *  sweep options. Each operator and its LU decomposition are released as
+ *  soon as its solution is stored, so that only the operators in flight
+ *  are held in memory. The operator factory should create all operators
+ *  with a single Context, so that their block cluster trees are built only
+ *  once.
+ *
+ *  If BEM++ is built with MPI and MPI has been initialised, the batches of
+ *  Laplace parameters are dealt out cyclically to the processes of
+ *  MPI_COMM_WORLD, each of which runs its own sweep, and the solutions are
+ *  gathered on all processes before the inverse transform. solve() must
+ *  then be called collectively with the same arguments on all processes;
+ *  the operators are assembled by each process on its own, so they should
+ *  not be distributed operators. */
+template <typename BasisFunctionType> class ConvolutionQuadrature {
+public:
+  typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+  typedef typename ScalarTraits<BasisFunctionType>::ComplexType ResultType;
+  /** \brief Function returning the operator \f$K(s)\f$. Called
+   *  concurrently for different parameters. */
+  typedef std::function<BoundaryOperator<BasisFunctionType, ResultType>(
+      ResultType)> OperatorFactory;
+
+  /** \brief Constructor.
+   *
+   *  \param[in] timeStepCount  Number \p M of time steps, including the
+   *                            initial one at time 0.
+   *  \param[in] timeStep       Length of the time steps.
+   *  \param[in] options        Further options. */
+  ConvolutionQuadrature(
+      std::size_t timeStepCount, CoordinateType timeStep,
+      const ConvolutionQuadratureOptions &options =
+          ConvolutionQuadratureOptions());
+
+  std::size_t timeStepCount() const { return m_laplaceParameters.size(); }
+  CoordinateType timeStep() const { return m_timeStep; }
+  const ConvolutionQuadratureOptions &options() const { return m_options; }
+
+  /** \brief Laplace parameters \f$s_l = \gamma(\lambda
+   *  e^{-2\pi\mathrm{i}l/M})/\Delta t\f$, \f$l = 0, \dots, M-1\f$, at
+   *  which the operator family is evaluated; \f$\lambda\f$ is the radius. */
+  const std::vector<ResultType> &laplaceParameters() const {
+    return m_laplaceParameters;
+  }
+
+  /** \brief Solve the time-domain problem.
+   *
+   *  Column \p n of \p rhs holds the projections of the right-hand side at
+   *  time \f$n\Delta t\f$ on the basis functions of the dual space to the
+   *  range of the operators; on output, column \p n of the returned matrix
+   *  holds the coefficients of \f$\phi_n\f$ in the domain of the
+   *  operators. \p makeOperator is called once for each Laplace parameter
+   *  with nonnegative imaginary part, on the process its batch is assigned
+   *  to. */
+  arma::Mat<CoordinateType>
+  solve(const OperatorFactory &makeOperator,
+        const arma::Mat<CoordinateType> &rhs) const;
+
+private:
+  /** \cond PRIVATE */
+  CoordinateType m_timeStep;
+  CoordinateType m_radius;
+  ConvolutionQuadratureOptions m_options;
+  std::vector<ResultType> m_laplaceParameters;
+  /** \endcond */
+};
+
+/** \relates ConvolutionQuadrature
+ *  \brief Return the factory of modified Helmholtz single-layer operators
+ *  with wave number equal to the Laplace parameter.
+ *
+ *  These are the Laplace transforms of the retarded single-layer operator
+ *  of the wave equation with unit wave speed. */
+template <typename BasisFunctionType>
+typename ConvolutionQuadrature<BasisFunctionType>::OperatorFactory
+modifiedHelmholtz3dSingleLayerOperatorFactory(
+    const shared_ptr<const Context<
+        BasisFunctionType,
+        typename ScalarTraits<BasisFunctionType>::ComplexType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &range,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange);
+
+} // namespace Bempp
+
+#endif
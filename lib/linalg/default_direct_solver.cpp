@@ -20,40 +20,123 @@
 
 #include "default_direct_solver.hpp"
 
+#include "bempp/common/config_scalapack.hpp"
+
 #include "../assembly/abstract_boundary_operator.hpp"
 #include "../assembly/blocked_boundary_operator.hpp"
 #include "../assembly/boundary_operator.hpp"
 #include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/discrete_hmat_boundary_operator.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../hmat/hodlr_decomposition.hpp"
+#include "distributed_dense_lu_decomposition.hpp"
+
+#ifdef WITH_SCALAPACK
+#include "../assembly/discrete_distributed_dense_boundary_operator.hpp"
+#endif
 
 #include <boost/variant.hpp>
 
+#include <memory>
+#include <mutex>
+
 namespace Bempp {
 
 /** \cond HIDDEN_INTERNAL */
 
 template <typename BasisFunctionType, typename ResultType>
 struct DefaultDirectSolver<BasisFunctionType, ResultType>::Impl {
-  Impl(const BoundaryOperator<BasisFunctionType, ResultType> &op_) : op(op_) {}
+  Impl(const BoundaryOperator<BasisFunctionType, ResultType> &op_,
+       const DenseLuOptions &options_)
+      : op(op_), options(options_) {}
 
-  Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType> &op_)
-      : op(op_) {}
+  Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType> &op_,
+       const DenseLuOptions &options_)
+      : op(op_), options(options_) {}
+
+  // Overwrite x with the solution, decomposing the weak form on first use.
+  // If control cancels the factorization, it is restarted by the next call.
+  template <typename BoundaryOp>
+  void solve(const BoundaryOp &boundaryOp, const SolveControl &control,
+             arma::Mat<ResultType> &x) const {
+    std::call_once(luFlag, [&]() {
+      control.checkpoint(SolveProgress());
+      shared_ptr<const DiscreteBoundaryOperator<ResultType>> weakForm =
+          boundaryOp.weakForm();
+      if (options.hodlrEps > 0) {
+        shared_ptr<const DiscreteHMatBoundaryOperator<ResultType>> hMatOp =
+            boost::dynamic_pointer_cast<
+                const DiscreteHMatBoundaryOperator<ResultType>>(weakForm);
+        if (hMatOp && !hMatOp->nearFieldOnly()) {
+          hodlr.reset(new hmat::HodlrDecomposition<ResultType, 2>(
+              *hMatOp->hMatrix(), options.hodlrEps));
+          hMatDofOrdering = hMatOp->hMatDofOrdering();
+          return;
+        }
+      }
+#ifdef WITH_SCALAPACK
+      // Distributed dense weak forms are factorized without gathering them
+      shared_ptr<const DiscreteDistributedDenseBoundaryOperator<ResultType>>
+          distributedOp = boost::dynamic_pointer_cast<
+              const DiscreteDistributedDenseBoundaryOperator<ResultType>>(
+              weakForm);
+      if (distributedOp) {
+        distributedLu.reset(
+            new DistributedDenseLuDecomposition<ResultType>(*distributedOp));
+        return;
+      }
+#endif
+      // The callback is only used during the construction of lu
+      DenseLuOptions luOptions = options;
+      luOptions.progressCallback = [&control](double fraction) {
+        SolveProgress progress;
+        progress.fraction = fraction;
+        control.checkpoint(progress);
+      };
+      lu.reset(new DenseLuDecomposition<ResultType>(*weakForm, luOptions));
+    });
+#ifdef WITH_SCALAPACK
+    if (distributedLu) {
+      distributedLu->solve(x);
+      return;
+    }
+#endif
+    if (!hodlr)
+      lu->solve(x);
+    else if (hMatDofOrdering)
+      hodlr->solvePermuted(x);
+    else {
+      arma::Mat<ResultType> rhs = x;
+      hodlr->solve(rhs, x);
+    }
+  }
 
   boost::variant<BoundaryOperator<BasisFunctionType, ResultType>,
                  BlockedBoundaryOperator<BasisFunctionType, ResultType>> op;
+  DenseLuOptions options;
+  mutable std::once_flag luFlag;
+  mutable std::unique_ptr<DenseLuDecomposition<ResultType>> lu;
+  mutable std::unique_ptr<hmat::HodlrDecomposition<ResultType, 2>> hodlr;
+#ifdef WITH_SCALAPACK
+  mutable std::unique_ptr<DistributedDenseLuDecomposition<ResultType>>
+      distributedLu;
+#endif
+  mutable bool hMatDofOrdering = false;
 };
 
 /** \endcond */
 
 template <typename BasisFunctionType, typename ResultType>
 DefaultDirectSolver<BasisFunctionType, ResultType>::DefaultDirectSolver(
-    const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp)
-    : m_impl(new Impl(boundaryOp)) {}
+    const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+    const DenseLuOptions &options)
+    : m_impl(new Impl(boundaryOp, options)) {}
 
 template <typename BasisFunctionType, typename ResultType>
 DefaultDirectSolver<BasisFunctionType, ResultType>::DefaultDirectSolver(
-    const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp)
-    : m_impl(new Impl(boundaryOp)) {}
+    const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+    const DenseLuOptions &options)
+    : m_impl(new Impl(boundaryOp, options)) {}
 
 template <typename BasisFunctionType, typename ResultType>
 DefaultDirectSolver<BasisFunctionType, ResultType>::~DefaultDirectSolver() {}
@@ -62,6 +145,15 @@ template <typename BasisFunctionType, typename ResultType>
 Solution<BasisFunctionType, ResultType>
 DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
     const GridFunction<BasisFunctionType, ResultType> &rhs) const {
+  return solveImplNonblockedWithControl(rhs, SolveControl());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Solution<BasisFunctionType, ResultType>
+DefaultDirectSolver<BasisFunctionType, ResultType>::
+    solveImplNonblockedWithControl(
+        const GridFunction<BasisFunctionType, ResultType> &rhs,
+        const SolveControl &control) const {
   typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
 
   const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
@@ -74,8 +166,8 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
       *boundaryOp, rhs, ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
 
   arma::Col<ResultType> armaSolution =
-      arma::solve(boundaryOp->weakForm()->asMatrix(),
-                  rhs.projections(boundaryOp->dualToRange()));
+      rhs.projections(boundaryOp->dualToRange());
+  m_impl->solve(*boundaryOp, control, armaSolution);
 
   return Solution<BasisFunctionType, ResultType>(
       GridFunction<BasisFunctionType, ResultType>(
@@ -85,10 +177,56 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
       "Solver finished");
 }
 
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType>>
+DefaultDirectSolver<BasisFunctionType, ResultType>::
+    solveImplNonblockedMultipleRhs(
+        const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+        const {
+  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+
+  const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
+  if (!boundaryOp)
+    throw std::logic_error(
+        "DefaultDirectSolver::solve(): for solvers constructed "
+        "from a BlockedBoundaryOperator the other solve() overload "
+        "must be used");
+  for (size_t i = 0; i < rhs.size(); ++i)
+    Solver<BasisFunctionType, ResultType>::checkConsistency(
+        *boundaryOp, rhs[i],
+        ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+
+  arma::Mat<ResultType> armaSolution(
+      boundaryOp->dualToRange()->globalDofCount(), rhs.size());
+  for (size_t i = 0; i < rhs.size(); ++i)
+    armaSolution.col(i) = rhs[i].projections(boundaryOp->dualToRange());
+  m_impl->solve(*boundaryOp, SolveControl(), armaSolution);
+
+  std::vector<Solution<BasisFunctionType, ResultType>> solutions;
+  solutions.reserve(rhs.size());
+  for (size_t i = 0; i < rhs.size(); ++i)
+    solutions.push_back(Solution<BasisFunctionType, ResultType>(
+        GridFunction<BasisFunctionType, ResultType>(
+            boundaryOp->context(), boundaryOp->domain(),
+            arma::Col<ResultType>(armaSolution.col(i))),
+        SolutionStatus::CONVERGED,
+        SolutionBase<BasisFunctionType, ResultType>::unknownTolerance(),
+        "Solver finished"));
+  return solutions;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 BlockedSolution<BasisFunctionType, ResultType>
 DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
     const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs) const {
+  return solveImplBlockedWithControl(rhs, SolveControl());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlockedWithControl(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+    const SolveControl &control) const {
   typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
 
   const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
@@ -118,13 +256,12 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
   }
 
   // Solve
-  arma::Col<ResultType> armaSolution =
-      arma::solve(boundaryOp->weakForm()->asMatrix(), armaRhs);
+  m_impl->solve(*boundaryOp, control, armaRhs);
 
   // Convert chunks of the solution vector into grid functions
   std::vector<GridFunction<BasisFunctionType, ResultType>> solutionFunctions;
   Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
-      armaSolution, *boundaryOp, solutionFunctions);
+      armaRhs, *boundaryOp, solutionFunctions);
 
   // Return solution
   return BlockedSolution<BasisFunctionType, ResultType>(
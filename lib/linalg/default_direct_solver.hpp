@@ -23,6 +23,8 @@
 
 #include "solver.hpp"
 
+#include "dense_lu_decomposition.hpp"
+
 #include <boost/scoped_ptr.hpp>
 
 namespace Bempp {
@@ -32,6 +34,15 @@ namespace Bempp {
   *
   * This class can be used to solve boundary integral equations using standard
   * dense LU decomposition.
+  *
+  * The weak form of the operator is decomposed by a DenseLuDecomposition on
+  * the first call to solve(); the decomposition is kept and reused for all
+  * subsequent right-hand sides.
+  *
+  * If DenseLuOptions::hodlrEps is positive and the weak form of a
+  * non-blocked operator is stored as an H-matrix, it is factorized by
+  * hmat::HodlrDecomposition instead, which is fast for H-matrices assembled
+  * with the "weak" admissibility condition.
   */
 template <typename BasisFunctionType, typename ResultType>
 class DefaultDirectSolver : public Solver<BasisFunctionType, ResultType> {
@@ -40,18 +51,34 @@ public:
 
   /** \brief Construct a solver for a non-blocked boundary operator. */
   DefaultDirectSolver(
-      const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp);
+      const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+      const DenseLuOptions &options = DenseLuOptions());
   /** \brief Construct a solver for a blocked boundary operator. */
   DefaultDirectSolver(
-      const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp);
+      const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+      const DenseLuOptions &options = DenseLuOptions());
   ~DefaultDirectSolver();
 
 private:
   virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
       const GridFunction<BasisFunctionType, ResultType> &rhs) const;
+  virtual std::vector<Solution<BasisFunctionType, ResultType>>
+  solveImplNonblockedMultipleRhs(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
   virtual BlockedSolution<BasisFunctionType, ResultType> solveImplBlocked(
       const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
       const;
+  /** \brief Solve, checking \p control after each panel of the LU
+    * decomposition. */
+  virtual Solution<BasisFunctionType, ResultType>
+  solveImplNonblockedWithControl(
+      const GridFunction<BasisFunctionType, ResultType> &rhs,
+      const SolveControl &control) const;
+  virtual BlockedSolution<BasisFunctionType, ResultType>
+  solveImplBlockedWithControl(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const SolveControl &control) const;
 
 private:
   struct Impl;
@@ -27,6 +27,7 @@
 #include "belos_solver_wrapper.hpp"
 #include "solution.hpp"
 #include "blocked_solution.hpp"
+#include "pipelined_gmres.hpp"
 #include "../assembly/abstract_boundary_operator.hpp"
 #include "../assembly/abstract_boundary_operator_pseudoinverse.hpp"
 #include "../assembly/blocked_boundary_operator.hpp"
@@ -37,15 +38,25 @@
 #include "../assembly/identity_operator.hpp"
 #include "../assembly/vector.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/profiler.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../space/space.hpp"
 
 #include <Teuchos_RCPBoostSharedPtrConversions.hpp>
+#include <Thyra_DefaultSpmdMultiVector.hpp>
+#include <Thyra_DefaultPreconditioner.hpp>
 #include <Thyra_DefaultSpmdVectorSpace.hpp>
+#include <Thyra_DetachedMultiVectorView.hpp>
+#include <Thyra_LinearOpDefaultBase.hpp>
+
+#include <tbb/tick_count.h>
 
 #include <boost/make_shared.hpp>
 #include <boost/variant.hpp>
 
-#include <tbb/task_scheduler_init.h>
+#include <algorithm>
+#include <functional>
+#include <string>
 
 namespace Bempp {
 
@@ -61,6 +72,178 @@ wrapInTrilinosVector(arma::Col<ValueType> &col) {
                          trilinosArray, 1 /* stride */));
 }
 
+template <typename ValueType>
+Teuchos::RCP<Thyra::DefaultSpmdMultiVector<ValueType>>
+wrapInTrilinosMultiVector(arma::Mat<ValueType> &mat) {
+  Teuchos::ArrayRCP<ValueType> trilinosArray =
+      Teuchos::arcp(mat.memptr(), 0 /* lowerOffset */, mat.n_elem,
+                    false /* doesn't own memory */);
+  typedef Thyra::DefaultSpmdMultiVector<ValueType> TrilinosMultiVector;
+  return Teuchos::RCP<TrilinosMultiVector>(new TrilinosMultiVector(
+      Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_rows),
+      Thyra::defaultSpmdVectorSpace<ValueType>(mat.n_cols), trilinosArray,
+      mat.n_rows /* leadingDim */));
+}
+
+namespace {
+
+// Collects the statistics of a solve from the calls of TimedLinearOp and
+// passes the iteration boundaries to the SolveControl of the solve
+class SolverStatisticsRecorder {
+public:
+  enum Kind {
+    OPERATOR,
+    PRECONDITIONER
+  };
+
+  SolverStatisticsRecorder() : m_active(false), m_control(0) {}
+
+  void start(const SolverIterationCallback &callback,
+             const SolveControl &control) {
+    m_statistics = SolverStatistics();
+    m_callback = callback;
+    m_control = &control;
+    m_start = tbb::tick_count::now();
+    openIteration(m_start);
+    m_active = true;
+  }
+
+  // Called before each application. An operator application begins a new
+  // iteration, except for the first one, which belongs to the iteration
+  // opened by start(); this is where a cancelled solve stops.
+  tbb::tick_count beginApplication(Kind kind) {
+    const tbb::tick_count begin = tbb::tick_count::now();
+    if (m_active && kind == OPERATOR && m_current.operatorApplyCount > 0) {
+      closeIteration(begin);
+      openIteration(begin);
+      SolveProgress progress;
+      progress.iteration = m_statistics.iterations.size();
+      m_control->checkpoint(progress);
+    }
+    return begin;
+  }
+
+  void endApplication(Kind kind, const tbb::tick_count &begin,
+                      std::size_t vectorCount) {
+    if (!m_active)
+      return;
+    const double seconds = (tbb::tick_count::now() - begin).seconds();
+    if (kind == OPERATOR) {
+      m_current.operatorTime += seconds;
+      m_current.operatorApplyCount += vectorCount;
+    } else {
+      m_current.preconditionerTime += seconds;
+      m_current.preconditionerApplyCount += vectorCount;
+    }
+  }
+
+  const SolverStatistics &finish(double residual) {
+    m_current.residual = residual;
+    const tbb::tick_count end = tbb::tick_count::now();
+    closeIteration(end);
+    m_statistics.time = (end - m_start).seconds();
+    m_statistics.residual = residual;
+    m_active = false;
+    m_control = 0;
+    return m_statistics;
+  }
+
+  // Called if the solve throws
+  void abort() {
+    m_active = false;
+    m_control = 0;
+  }
+
+private:
+  void openIteration(const tbb::tick_count &begin) {
+    m_current = SolverIterationStatistics();
+    m_current.iteration = m_statistics.iterations.size() + 1;
+    m_current.time = 0;
+    m_current.operatorTime = 0;
+    m_current.preconditionerTime = 0;
+    m_current.operatorApplyCount = 0;
+    m_current.preconditionerApplyCount = 0;
+    m_current.residual = -1;
+    m_iterationStart = begin;
+  }
+
+  void closeIteration(const tbb::tick_count &end) {
+    m_current.time = (end - m_iterationStart).seconds();
+    m_statistics.iterations.push_back(m_current);
+    m_statistics.operatorTime += m_current.operatorTime;
+    m_statistics.preconditionerTime += m_current.preconditionerTime;
+    m_statistics.operatorApplyCount += m_current.operatorApplyCount;
+    m_statistics.preconditionerApplyCount +=
+        m_current.preconditionerApplyCount;
+    if (m_callback)
+      m_callback(m_current);
+  }
+
+  bool m_active;
+  SolverIterationCallback m_callback;
+  const SolveControl *m_control;
+  SolverStatistics m_statistics;
+  SolverIterationStatistics m_current;
+  tbb::tick_count m_start;
+  tbb::tick_count m_iterationStart;
+};
+
+// Operator passing the time spent in each application to a recorder
+template <typename ValueType>
+class TimedLinearOp : public Thyra::LinearOpDefaultBase<ValueType> {
+public:
+  TimedLinearOp(const Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> &op,
+                const shared_ptr<SolverStatisticsRecorder> &recorder,
+                SolverStatisticsRecorder::Kind kind)
+      : m_op(op), m_recorder(recorder), m_kind(kind) {}
+
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+  domain() const {
+    return m_op->domain();
+  }
+
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+  range() const {
+    return m_op->range();
+  }
+
+protected:
+  virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const {
+    return Thyra::opSupported(*m_op, M_trans);
+  }
+
+  virtual void
+  applyImpl(const Thyra::EOpTransp M_trans,
+            const Thyra::MultiVectorBase<ValueType> &X_in,
+            const Teuchos::Ptr<Thyra::MultiVectorBase<ValueType>> &Y_inout,
+            const ValueType alpha, const ValueType beta) const {
+    Fiber::ProfileRegion region(m_kind == SolverStatisticsRecorder::OPERATOR
+                                    ? "Operator application"
+                                    : "Preconditioner application");
+    const tbb::tick_count begin = m_recorder->beginApplication(m_kind);
+    Thyra::apply(*m_op, M_trans, X_in, Y_inout, alpha, beta);
+    m_recorder->endApplication(m_kind, begin, X_in.domain()->dim());
+  }
+
+private:
+  Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> m_op;
+  shared_ptr<SolverStatisticsRecorder> m_recorder;
+  SolverStatisticsRecorder::Kind m_kind;
+};
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::LinearOpBase<ValueType>>
+timedLinearOp(const Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> &op,
+              const shared_ptr<SolverStatisticsRecorder> &recorder,
+              SolverStatisticsRecorder::Kind kind) {
+  if (op.is_null())
+    return Teuchos::null;
+  return Teuchos::rcp<const Thyra::LinearOpBase<ValueType>>(
+      new TimedLinearOp<ValueType>(op, recorder, kind));
+}
+
+} // namespace
+
 /** \cond HIDDEN_INTERNAL */
 
 template <typename BasisFunctionType, typename ResultType>
@@ -69,10 +252,29 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl {
   // Constructor for non-blocked operators
   Impl(const BoundaryOperator<BasisFunctionType, ResultType> &op_,
        ConvergenceTestMode::Mode mode_)
-      : op(op_), mode(mode_) {
+      : op(op_), mode(mode_), warmStart(false), pipelined(false),
+        collectStatistics(false),
+        recorder(boost::make_shared<SolverStatisticsRecorder>()) {
+    linOp = makeLinearOperator(op_);
+    solverWrapper.reset(new BelosSolverWrapper<ResultType>(
+        timedLinearOp(linOp, recorder, SolverStatisticsRecorder::OPERATOR)));
+  }
+
+  // Constructor for blocked operators
+  Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType> &op_,
+       ConvergenceTestMode::Mode mode_)
+      : op(op_), mode(mode_), warmStart(false), pipelined(false),
+        collectStatistics(false),
+        recorder(boost::make_shared<SolverStatisticsRecorder>()) {
+    linOp = makeLinearOperator(op_);
+    solverWrapper.reset(new BelosSolverWrapper<ResultType>(
+        timedLinearOp(linOp, recorder, SolverStatisticsRecorder::OPERATOR)));
+  }
+
+  // Return the operator passed to Belos and update pinvId if necessary
+  Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> makeLinearOperator(
+      const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp) {
     typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-    typedef Solver<BasisFunctionType, ResultType> Solver_;
-    const BoundaryOp &boundaryOp = boost::get<BoundaryOp>(op);
     if (!boundaryOp.isInitialized())
       throw std::invalid_argument("DefaultIterativeSolver::Impl::Impl(): "
                                   "boundary operator must be initialized");
@@ -83,9 +285,8 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl {
         throw std::invalid_argument("DefaultIterativeSolver::Impl::Impl(): "
                                     "non-square system provided");
 
-      solverWrapper.reset(new BelosSolverWrapper<ResultType>(
-          Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
-              boundaryOp.weakForm())));
+      return Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
+          boundaryOp.weakForm());
     } else if (mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_RANGE) {
       if (boundaryOp.domain()->globalDofCount() !=
           boundaryOp.range()->globalDofCount())
@@ -100,31 +301,26 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl {
       shared_ptr<DiscreteBoundaryOperator<ResultType>> totalBoundaryOp =
           boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType>>(
               boost::get<BoundaryOp>(pinvId).weakForm(), boundaryOp.weakForm());
-      solverWrapper.reset(new BelosSolverWrapper<ResultType>(
-          Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
-              totalBoundaryOp)));
+      return Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
+          totalBoundaryOp);
     } else
       throw std::invalid_argument(
           "DefaultIterativeSolver::DefaultIterativeSolver(): "
           "invalid convergence test mode");
   }
 
-  // Constructor for blocked operators
-  Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType> &op_,
-       ConvergenceTestMode::Mode mode_)
-      : op(op_), mode(mode_) {
+  Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> makeLinearOperator(
+      const BlockedBoundaryOperator<BasisFunctionType, ResultType> &
+          boundaryOp) {
     typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-    typedef Solver<BasisFunctionType, ResultType> Solver_;
-    const BoundaryOp &boundaryOp = boost::get<BoundaryOp>(op);
 
     if (mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE) {
       if (boundaryOp.totalGlobalDofCountInDomains() !=
           boundaryOp.totalGlobalDofCountInDualsToRanges())
         throw std::invalid_argument("DefaultIterativeSolver::Impl::Impl(): "
                                     "non-square system provided");
-      solverWrapper.reset(new BelosSolverWrapper<ResultType>(
-          Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
-              boundaryOp.weakForm())));
+      return Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
+          boundaryOp.weakForm());
     } else if (mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_RANGE) {
       if (boundaryOp.totalGlobalDofCountInDomains() !=
           boundaryOp.totalGlobalDofCountInRanges())
@@ -157,21 +353,189 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl {
       shared_ptr<DiscreteBoundaryOperator<ResultType>> totalBoundaryOp =
           boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType>>(
               boost::get<BoundaryOp>(pinvId).weakForm(), boundaryOp.weakForm());
-      solverWrapper.reset(new BelosSolverWrapper<ResultType>(
-          Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
-              totalBoundaryOp)));
+      return Teuchos::rcp<const Thyra::LinearOpBase<ResultType>>(
+          totalBoundaryOp);
     } else
       throw std::invalid_argument(
           "DefaultIterativeSolver::DefaultIterativeSolver(): "
           "invalid convergence test mode");
   }
 
+  // Fill solution with the initial guess for a solve with
+  // solution.n_cols right-hand sides
+  void initializeSolution(arma::Mat<ResultType> &solution) const {
+    if (warmStart && previousSolution.n_rows == solution.n_rows &&
+        previousSolution.n_cols == solution.n_cols)
+      solution = previousSolution;
+    else
+      solution.fill(static_cast<ResultType>(0.));
+  }
+
+  // Pass the operator to Belos, wrapped for timing and cancellation
+  void setLinearOperator(
+      const Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> &linOp_) {
+    linOp = linOp_;
+    solverWrapper->setLinearOperator(
+        timedLinearOp(linOp, recorder, SolverStatisticsRecorder::OPERATOR));
+  }
+
+  void setPreconditioner(
+      const Teuchos::RCP<const Thyra::PreconditionerBase<ResultType>> &
+          preconditioner_) {
+    preconditioner = preconditioner_;
+    if (preconditioner.is_null()) {
+      solverWrapper->setPreconditioner(preconditioner);
+      return;
+    }
+    const SolverStatisticsRecorder::Kind kind =
+        SolverStatisticsRecorder::PRECONDITIONER;
+    Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> unspecifiedPrecOp =
+        preconditioner->getUnspecifiedPrecOp();
+    if (!unspecifiedPrecOp.is_null())
+      solverWrapper->setPreconditioner(Thyra::unspecifiedPrec(
+          timedLinearOp(unspecifiedPrecOp, recorder, kind)));
+    else
+      solverWrapper->setPreconditioner(
+          Teuchos::rcp(new Thyra::DefaultPreconditioner<ResultType>(
+              timedLinearOp(preconditioner->getLeftPrecOp(), recorder, kind),
+              timedLinearOp(preconditioner->getRightPrecOp(), recorder,
+                            kind))));
+  }
+
+  // Use the native pipelined GMRES solver if the parameter list selects it
+  // (see defaultPipelinedGmresParameterList()), Belos otherwise
+  void initializeSolver(const Teuchos::RCP<Teuchos::ParameterList> &paramList) {
+    pipelined = !paramList.is_null() &&
+                paramList->get<std::string>("Solver Type", "") ==
+                    "Pipelined GMRES";
+    if (!pipelined) {
+      solverWrapper->initializeSolver(paramList);
+      return;
+    }
+    Teuchos::ParameterList &list =
+        paramList->sublist("Solver Types").sublist("Pipelined GMRES");
+    pipelinedOptions = PipelinedGmresOptions();
+    if (list.isType<double>("Convergence Tolerance"))
+      pipelinedOptions.tolerance = list.get<double>("Convergence Tolerance");
+    else if (list.isType<float>("Convergence Tolerance"))
+      pipelinedOptions.tolerance = list.get<float>("Convergence Tolerance");
+    pipelinedOptions.maxIterationCount = list.get<int>(
+        "Maximum Iterations", pipelinedOptions.maxIterationCount);
+    pipelinedOptions.restart =
+        list.get<int>("Num Blocks", pipelinedOptions.restart);
+  }
+
+  // Solve with pipelinedGmres(), one right-hand side after another
+  Thyra::SolveStatus<typename ScalarTraits<ResultType>::RealType>
+  solvePipelined(const Thyra::MultiVectorBase<ResultType> &rhs,
+                 const Teuchos::Ptr<Thyra::MultiVectorBase<ResultType>> &sol)
+      const {
+    typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
+    typedef std::function<void(const arma::Col<ResultType> &,
+                               arma::Col<ResultType> &)> Application;
+
+    const SolverStatisticsRecorder::Kind kind =
+        SolverStatisticsRecorder::PRECONDITIONER;
+    Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> precOp;
+    if (!preconditioner.is_null()) {
+      if (!preconditioner->getLeftPrecOp().is_null())
+        throw std::invalid_argument(
+            "DefaultIterativeSolver::solve(): the pipelined GMRES solver "
+            "supports only right preconditioners");
+      precOp = preconditioner->getUnspecifiedPrecOp();
+      if (precOp.is_null())
+        precOp = preconditioner->getRightPrecOp();
+    }
+    const Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> timedOp =
+        timedLinearOp(linOp, recorder, SolverStatisticsRecorder::OPERATOR);
+    const Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> timedPrecOp =
+        timedLinearOp(precOp, recorder, kind);
+    auto makeApplication = [](
+        const Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> &op) {
+      return Application([op](const arma::Col<ResultType> &x,
+                              arma::Col<ResultType> &y) {
+        y.set_size(op->range()->dim());
+        Thyra::apply(*op, Thyra::NOTRANS,
+                     *wrapInTrilinosVector(
+                         const_cast<arma::Col<ResultType> &>(x)),
+                     wrapInTrilinosVector(y).ptr());
+      });
+    };
+    const Application applyOperator = makeApplication(timedOp);
+    const Application applyPreconditioner =
+        timedPrecOp.is_null() ? Application() : makeApplication(timedPrecOp);
+
+    const Thyra::ConstDetachedMultiVectorView<ResultType> rhsView(
+        Teuchos::rcpFromRef(rhs));
+    Thyra::DetachedMultiVectorView<ResultType> solView(
+        Teuchos::rcpFromPtr(sol));
+    Thyra::SolveStatus<MagnitudeType> status;
+    status.solveStatus = Thyra::SOLVE_STATUS_CONVERGED;
+    status.achievedTol = 0;
+    for (int col = 0; col < rhsView.numSubCols(); ++col) {
+      arma::Col<ResultType> b(rhsView.subDim()), x(solView.subDim());
+      for (int row = 0; row < rhsView.subDim(); ++row) {
+        b(row) = rhsView(row, col);
+        x(row) = solView(row, col);
+      }
+      const PipelinedGmresStatus<MagnitudeType> columnStatus = pipelinedGmres(
+          applyOperator, applyPreconditioner, b, x, pipelinedOptions);
+      for (int row = 0; row < solView.subDim(); ++row)
+        solView(row, col) = x(row);
+      if (!columnStatus.converged)
+        status.solveStatus = Thyra::SOLVE_STATUS_UNCONVERGED;
+      status.achievedTol =
+          std::max(status.achievedTol, columnStatus.relativeResidual);
+    }
+    return status;
+  }
+
+  // Solve in a task arena with maxThreadCount threads, so that all
+  // matrix-vector multiplications share its threads
+  Thyra::SolveStatus<typename ScalarTraits<ResultType>::RealType>
+  solve(int maxThreadCount, const Thyra::MultiVectorBase<ResultType> &rhs,
+        const Teuchos::Ptr<Thyra::MultiVectorBase<ResultType>> &sol,
+        const SolveControl &control) const {
+    Fiber::ProfileRegion region("Iterative solve");
+    Thyra::SolveStatus<typename ScalarTraits<ResultType>::RealType> status;
+    recorder->start(collectStatistics ? callback : SolverIterationCallback(),
+                    control);
+    try {
+      Fiber::executeInTaskArena(maxThreadCount, [&] {
+        status = pipelined ? solvePipelined(rhs, sol)
+                           : solverWrapper->solve(Thyra::NOTRANS, rhs, sol);
+      });
+    } catch (...) {
+      recorder->abort();
+      throw;
+    }
+    const SolverStatistics &newStatistics =
+        recorder->finish(status.achievedTol);
+    if (collectStatistics)
+      statistics = newStatistics;
+    return status;
+  }
+
   boost::variant<BoundaryOperator<BasisFunctionType, ResultType>,
                  BlockedBoundaryOperator<BasisFunctionType, ResultType>> op;
   ConvergenceTestMode::Mode mode;
   boost::scoped_ptr<BelosSolverWrapper<ResultType>> solverWrapper;
   boost::variant<BoundaryOperator<BasisFunctionType, ResultType>,
                  BlockedBoundaryOperator<BasisFunctionType, ResultType>> pinvId;
+  bool warmStart;
+  bool pipelined;
+  PipelinedGmresOptions pipelinedOptions;
+  // Solution of the last solve, used as the initial guess of the next one
+  // if warmStart is set
+  mutable arma::Mat<ResultType> previousSolution;
+  // Operator and preconditioner before wrapping
+  Teuchos::RCP<const Thyra::LinearOpBase<ResultType>> linOp;
+  Teuchos::RCP<const Thyra::PreconditionerBase<ResultType>> preconditioner;
+  bool collectStatistics;
+  SolverIterationCallback callback;
+  shared_ptr<SolverStatisticsRecorder> recorder;
+  // Statistics of the last solve
+  mutable SolverStatistics statistics;
 };
 
 /** \endcond */
@@ -195,27 +559,95 @@ DefaultIterativeSolver<BasisFunctionType,
 template <typename BasisFunctionType, typename ResultType>
 void DefaultIterativeSolver<BasisFunctionType, ResultType>::setPreconditioner(
     const Preconditioner<ResultType> &preconditioner) {
-  m_impl->solverWrapper->setPreconditioner(preconditioner.get());
+  m_impl->setPreconditioner(preconditioner.get());
 }
 
 template <typename BasisFunctionType, typename ResultType>
 void DefaultIterativeSolver<BasisFunctionType, ResultType>::initializeSolver(
     const Teuchos::RCP<Teuchos::ParameterList> &paramList) {
-  m_impl->solverWrapper->initializeSolver(paramList);
+  m_impl->initializeSolver(paramList);
 }
 
 template <typename BasisFunctionType, typename ResultType>
 void DefaultIterativeSolver<BasisFunctionType, ResultType>::initializeSolver(
     const Teuchos::RCP<Teuchos::ParameterList> &paramList,
     const Preconditioner<ResultType> &preconditioner) {
-  m_impl->solverWrapper->setPreconditioner(preconditioner.get());
-  m_impl->solverWrapper->initializeSolver(paramList);
+  m_impl->setPreconditioner(preconditioner.get());
+  m_impl->initializeSolver(paramList);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultIterativeSolver<BasisFunctionType, ResultType>::setBoundaryOperator(
+    const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp) {
+  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+  const BoundaryOp *oldOp = boost::get<BoundaryOp>(&m_impl->op);
+  if (!oldOp)
+    throw std::logic_error(
+        "DefaultIterativeSolver::setBoundaryOperator(): the operator of a "
+        "solver constructed from a BlockedBoundaryOperator must be replaced "
+        "by a BlockedBoundaryOperator");
+  if (boundaryOp.isInitialized() &&
+      boundaryOp.domain()->globalDofCount() !=
+          oldOp->domain()->globalDofCount())
+    throw std::invalid_argument(
+        "DefaultIterativeSolver::setBoundaryOperator(): the new operator "
+        "must have the same size as the old one");
+  m_impl->setLinearOperator(m_impl->makeLinearOperator(boundaryOp));
+  m_impl->op = boundaryOp;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultIterativeSolver<BasisFunctionType, ResultType>::setBoundaryOperator(
+    const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp) {
+  typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+  const BoundaryOp *oldOp = boost::get<BoundaryOp>(&m_impl->op);
+  if (!oldOp)
+    throw std::logic_error(
+        "DefaultIterativeSolver::setBoundaryOperator(): the operator of a "
+        "solver constructed from a (non-blocked) BoundaryOperator must be "
+        "replaced by a BoundaryOperator");
+  if (boundaryOp.totalGlobalDofCountInDomains() !=
+      oldOp->totalGlobalDofCountInDomains())
+    throw std::invalid_argument(
+        "DefaultIterativeSolver::setBoundaryOperator(): the new operator "
+        "must have the same size as the old one");
+  m_impl->setLinearOperator(m_impl->makeLinearOperator(boundaryOp));
+  m_impl->op = boundaryOp;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultIterativeSolver<BasisFunctionType, ResultType>::setWarmStart(
+    bool warmStart) {
+  m_impl->warmStart = warmStart;
+  if (!warmStart)
+    m_impl->previousSolution.reset();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultIterativeSolver<BasisFunctionType, ResultType>::collectStatistics(
+    bool collect, const SolverIterationCallback &callback) {
+  m_impl->collectStatistics = collect;
+  m_impl->callback = callback;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+const SolverStatistics &
+DefaultIterativeSolver<BasisFunctionType, ResultType>::statistics() const {
+  return m_impl->statistics;
 }
 
 template <typename BasisFunctionType, typename ResultType>
 Solution<BasisFunctionType, ResultType>
 DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
     const GridFunction<BasisFunctionType, ResultType> &rhs) const {
+  return solveImplNonblockedWithControl(rhs, SolveControl());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Solution<BasisFunctionType, ResultType> DefaultIterativeSolver<
+    BasisFunctionType, ResultType>::solveImplNonblockedWithControl(
+    const GridFunction<BasisFunctionType, ResultType> &rhs,
+    const SolveControl &control) const {
   typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
   typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
   typedef Thyra::MultiVectorBase<ResultType> TrilinosVector;
@@ -244,7 +676,7 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
 
   // Construct solution vector
   arma::Col<ResultType> armaSolution(rhsVector->range()->dim());
-  armaSolution.fill(static_cast<ResultType>(0.));
+  m_impl->initializeSolution(armaSolution);
   Teuchos::RCP<TrilinosVector> solutionVector =
       wrapInTrilinosVector(armaSolution);
 
@@ -252,22 +684,15 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
   Fiber::ParallelizationOptions parallelOptions =
       boundaryOp->context()->assemblyOptions().parallelizationOptions();
   int maxThreadCount = 1;
-  if (!parallelOptions.isOpenClEnabled()) {
-    if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-      maxThreadCount = tbb::task_scheduler_init::automatic;
-    else
-      maxThreadCount = parallelOptions.maxThreadCount();
-  }
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
 
   // Solve
-  Thyra::SolveStatus<MagnitudeType> status;
-  {
-    // Initialize TBB threads here (to prevent their construction and
-    // destruction on every matrix-vector multiplication)
-    tbb::task_scheduler_init scheduler(maxThreadCount);
-    status = m_impl->solverWrapper->solve(Thyra::NOTRANS, *rhsVector,
-                                          solutionVector.ptr());
-  }
+  Thyra::SolveStatus<MagnitudeType> status =
+      m_impl->solve(maxThreadCount, *rhsVector, solutionVector.ptr(), control);
+
+  if (m_impl->warmStart)
+    m_impl->previousSolution = armaSolution;
 
   // Construct grid function and return
   return Solution<BasisFunctionType, ResultType>(
@@ -276,10 +701,94 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
       status);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType>>
+DefaultIterativeSolver<BasisFunctionType, ResultType>::
+    solveImplNonblockedMultipleRhs(
+        const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+        const {
+  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+  typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
+  typedef Thyra::MultiVectorBase<ResultType> TrilinosMultiVector;
+
+  const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
+  if (!boundaryOp)
+    throw std::logic_error(
+        "DefaultIterativeSolver::solveMultipleRhs(): this function is only "
+        "available for solvers constructed from a (non-blocked) "
+        "BoundaryOperator");
+  for (size_t i = 0; i < rhs.size(); ++i)
+    Solver<BasisFunctionType, ResultType>::checkConsistency(
+        *boundaryOp, rhs[i], m_impl->mode);
+
+  std::vector<Solution<BasisFunctionType, ResultType>> solutions;
+  if (rhs.empty())
+    return solutions;
+  const size_t rhsCount = rhs.size();
+
+  // Construct the block of rhs vectors
+  arma::Mat<ResultType> armaProjections(
+      boundaryOp->dualToRange()->globalDofCount(), rhsCount);
+  for (size_t i = 0; i < rhsCount; ++i)
+    armaProjections.col(i) = rhs[i].projections(boundaryOp->dualToRange());
+  Teuchos::RCP<TrilinosMultiVector> rhsVectors =
+      wrapInTrilinosMultiVector(armaProjections);
+  arma::Mat<ResultType> armaRangeRhs;
+  if (m_impl->mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_RANGE) {
+    armaRangeRhs.set_size(boundaryOp->range()->globalDofCount(), rhsCount);
+    Teuchos::RCP<TrilinosMultiVector> rangeRhsVectors =
+        wrapInTrilinosMultiVector(armaRangeRhs);
+    boost::get<BoundaryOp>(m_impl->pinvId).weakForm()->apply(
+        Thyra::NOTRANS, *rhsVectors, rangeRhsVectors.ptr(), 1., 0.);
+    rhsVectors = rangeRhsVectors;
+  }
+
+  // Construct the block of solution vectors
+  arma::Mat<ResultType> armaSolutions(boundaryOp->domain()->globalDofCount(),
+                                      rhsCount);
+  m_impl->initializeSolution(armaSolutions);
+  Teuchos::RCP<TrilinosMultiVector> solutionVectors =
+      wrapInTrilinosMultiVector(armaSolutions);
+
+  // Get number of threads
+  Fiber::ParallelizationOptions parallelOptions =
+      boundaryOp->context()->assemblyOptions().parallelizationOptions();
+  int maxThreadCount = 1;
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
+
+  // Solve
+  Thyra::SolveStatus<MagnitudeType> status =
+      m_impl->solve(maxThreadCount, *rhsVectors, solutionVectors.ptr(),
+                    SolveControl());
+
+  if (m_impl->warmStart)
+    m_impl->previousSolution = armaSolutions;
+
+  // Construct grid functions and return
+  solutions.reserve(rhsCount);
+  for (size_t i = 0; i < rhsCount; ++i)
+    solutions.push_back(Solution<BasisFunctionType, ResultType>(
+        GF(boundaryOp->context(), boundaryOp->domain(),
+           arma::Col<ResultType>(armaSolutions.col(i))),
+        status));
+  return solutions;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 BlockedSolution<BasisFunctionType, ResultType>
 DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
     const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs) const {
+  return solveImplBlockedWithControl(rhs, SolveControl());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+DefaultIterativeSolver<BasisFunctionType, ResultType>::
+    solveImplBlockedWithControl(
+        const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+        const SolveControl &control) const {
   typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
   typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
   typedef Thyra::MultiVectorBase<ResultType> TrilinosVector;
@@ -326,7 +835,7 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
   for (size_t i = 0; i < canonicalRhs.size(); ++i)
     solutionSize += boundaryOp->domain(i)->globalDofCount();
   arma::Col<ResultType> armaSolution(solutionSize);
-  armaSolution.fill(static_cast<ResultType>(0.));
+  m_impl->initializeSolution(armaSolution);
   Teuchos::RCP<TrilinosVector> solutionVector =
       wrapInTrilinosVector(armaSolution);
 
@@ -344,22 +853,15 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
   Fiber::ParallelizationOptions parallelOptions =
       context->assemblyOptions().parallelizationOptions();
   int maxThreadCount = 1;
-  if (!parallelOptions.isOpenClEnabled()) {
-    if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-      maxThreadCount = tbb::task_scheduler_init::automatic;
-    else
-      maxThreadCount = parallelOptions.maxThreadCount();
-  }
+  if (!parallelOptions.isOpenClEnabled())
+    maxThreadCount = parallelOptions.maxThreadCount();
 
   // Solve
-  Thyra::SolveStatus<MagnitudeType> status;
-  {
-    // Initialize TBB threads here (to prevent their construction and
-    // destruction on every matrix-vector multiplication)
-    tbb::task_scheduler_init scheduler(maxThreadCount);
-    status = m_impl->solverWrapper->solve(Thyra::NOTRANS, *rhsVector,
-                                          solutionVector.ptr());
-  }
+  Thyra::SolveStatus<MagnitudeType> status =
+      m_impl->solve(maxThreadCount, *rhsVector, solutionVector.ptr(), control);
+
+  if (m_impl->warmStart)
+    m_impl->previousSolution = armaSolution;
 
   // Convert chunks of the solution vector into grid functions
   std::vector<GridFunction<BasisFunctionType, ResultType>> solutionFunctions;
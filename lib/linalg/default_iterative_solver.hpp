@@ -30,6 +30,7 @@
 
 #include "belos_solver_wrapper_fwd.hpp" // for default parameter lists
 #include "preconditioner.hpp"
+#include "solver_statistics.hpp"
 
 #include "../common/deprecated.hpp"
 
@@ -112,7 +113,9 @@ public:
     * \param[in] paramList
     *   Parameter lists can be read in from XML files or defined in code. Use
     *   defaultGmresParameterList() and defaultCgParameterList() to construct
-    *   default parameter lists for the GMRES and CG solvers.
+    *   default parameter lists for the GMRES and CG solvers. A list made by
+    *   defaultPipelinedGmresParameterList() selects the native pipelined
+    *   GMRES solver instead of Belos.
     */
   void initializeSolver(const Teuchos::RCP<Teuchos::ParameterList> &paramList);
 
@@ -128,12 +131,89 @@ public:
   void initializeSolver(const Teuchos::RCP<Teuchos::ParameterList> &paramList,
                         const Preconditioner<ResultType> &preconditioner);
 
+  /** \brief Replace the boundary operator of the equation.
+    *
+    * This is meant for sequences of related systems, e.g. in frequency
+    * sweeps or optimisation loops. The Belos solver is reinitialized with
+    * the new operator, but keeps its internal state: with the GCRODR solver
+    * (see defaultGcrodrParameterList()) the subspace recycled from the
+    * previous solves is used to deflate the new system. The preconditioner
+    * is not changed.
+    *
+    * \param[in] boundaryOp
+    *   Non-blocked boundary operator of the same size as the one passed to
+    *   the constructor.
+    */
+  void setBoundaryOperator(
+      const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp);
+
+  /** \brief Replace the blocked boundary operator of the equation.
+    *
+    * See the other overload for details.
+    */
+  void setBoundaryOperator(
+      const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp);
+
+  /** \brief Use the previous solution as the initial guess.
+    *
+    * If \p warmStart is true, each solve starts from the solution of the
+    * previous one (provided that it had the same size and number of
+    * right-hand sides) instead of zero. Default: false.
+    */
+  void setWarmStart(bool warmStart);
+
+  /** \brief Collect timings and operator application counts of each solve.
+    *
+    * If \p collect is true, the time spent in each application of the
+    * operator and the preconditioner during a solve is recorded; the
+    * statistics of the last solve are returned by statistics(). The
+    * overhead is two clock reads per application.
+    *
+    * \param[in] collect
+    *   Whether to collect statistics. Default: false.
+    * \param[in] callback
+    *   If not empty, called with the statistics of each iteration as soon
+    *   as it is complete, e.g. to monitor long solves.
+    */
+  void collectStatistics(
+      bool collect,
+      const SolverIterationCallback &callback = SolverIterationCallback());
+
+  /** \brief Statistics of the last solve.
+    *
+    * Empty if collectStatistics() has not been enabled. Use writeJson() to
+    * export them. */
+  const SolverStatistics &statistics() const;
+
 private:
   virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
       const GridFunction<BasisFunctionType, ResultType> &rhs) const;
   virtual BlockedSolution<BasisFunctionType, ResultType> solveImplBlocked(
       const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
       const;
+  /** \brief Solve, checking \p control before each iteration but the
+    * first.
+    *
+    * Iterations are delimited by applications of the operator, as in
+    * SolverIterationStatistics. */
+  virtual Solution<BasisFunctionType, ResultType>
+  solveImplNonblockedWithControl(
+      const GridFunction<BasisFunctionType, ResultType> &rhs,
+      const SolveControl &control) const;
+  virtual BlockedSolution<BasisFunctionType, ResultType>
+  solveImplBlockedWithControl(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const SolveControl &control) const;
+  /** \brief Solve for all right-hand sides at once.
+    *
+    * The right-hand sides are passed to Belos as a single multivector, so
+    * the (pseudo-)block solvers apply the operator to all of them in each
+    * iteration. All returned Solution objects share the status of the whole
+    * block solve. */
+  virtual std::vector<Solution<BasisFunctionType, ResultType>>
+  solveImplNonblockedMultipleRhs(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
 
 private:
   struct Impl;
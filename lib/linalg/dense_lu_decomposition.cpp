@@ -0,0 +1,313 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "dense_lu_decomposition.hpp"
+
+#include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/discrete_dense_boundary_operator.hpp"
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/profiler.hpp"
+#include "../fiber/serial_blas_region.hpp"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Bempp {
+
+template <typename ValueType>
+DenseLuDecomposition<ValueType>::DenseLuDecomposition(
+    const DiscreteBoundaryOperator<ValueType> &op,
+    const DenseLuOptions &options)
+    : m_options(options), m_size(0), m_data(0), m_mapping(0),
+      m_mappingSize(0) {
+  if (m_options.tileSize < 1)
+    throw std::invalid_argument("DenseLuDecomposition::"
+                                "DenseLuDecomposition(): "
+                                "tile size must be positive");
+  if (op.rowCount() != op.columnCount())
+    throw std::invalid_argument("DenseLuDecomposition::"
+                                "DenseLuDecomposition(): "
+                                "non-square matrix provided");
+  allocate(op.rowCount());
+  try {
+    fill(op);
+    factorize();
+  } catch (...) {
+    // The destructor is not called if the constructor throws
+    release();
+    throw;
+  }
+}
+
+template <typename ValueType>
+DenseLuDecomposition<ValueType>::DenseLuDecomposition(
+    arma::Mat<ValueType> &matrix, const DenseLuOptions &options)
+    : m_options(options), m_size(0), m_data(0), m_mapping(0),
+      m_mappingSize(0) {
+  if (m_options.tileSize < 1)
+    throw std::invalid_argument("DenseLuDecomposition::"
+                                "DenseLuDecomposition(): "
+                                "tile size must be positive");
+  if (m_options.outOfCore)
+    throw std::invalid_argument("DenseLuDecomposition::"
+                                "DenseLuDecomposition(): "
+                                "in-place decomposition of a matrix is not "
+                                "available in out-of-core mode");
+  if (matrix.n_rows != matrix.n_cols)
+    throw std::invalid_argument("DenseLuDecomposition::"
+                                "DenseLuDecomposition(): "
+                                "non-square matrix provided");
+  m_inCoreData.swap(matrix);
+  matrix.reset();
+  m_size = m_inCoreData.n_rows;
+  m_data = m_inCoreData.memptr();
+  factorize();
+}
+
+template <typename ValueType>
+DenseLuDecomposition<ValueType>::~DenseLuDecomposition() {
+  release();
+}
+
+template <typename ValueType>
+void DenseLuDecomposition<ValueType>::release() {
+  if (m_mapping)
+    ::munmap(m_mapping, m_mappingSize);
+  m_mapping = 0;
+  m_data = 0;
+}
+
+template <typename ValueType>
+void DenseLuDecomposition<ValueType>::allocate(size_t size) {
+  m_size = size;
+  if (!m_options.outOfCore || size == 0) {
+    m_inCoreData.set_size(size, size);
+    m_data = m_inCoreData.memptr();
+    return;
+  }
+
+  std::string directory = m_options.scratchDirectory;
+  if (directory.empty()) {
+    const char *tmpDir = std::getenv("TMPDIR");
+    directory = tmpDir ? tmpDir : "/tmp";
+  }
+  std::string path = directory + "/bempp_dense_lu_XXXXXX";
+  std::vector<char> pathBuffer(path.begin(), path.end());
+  pathBuffer.push_back('\0');
+  int fd = ::mkstemp(&pathBuffer[0]);
+  if (fd < 0)
+    throw std::runtime_error("DenseLuDecomposition::allocate(): "
+                             "cannot create a scratch file in " +
+                             directory);
+  // The file disappears as soon as the mapping is released
+  ::unlink(&pathBuffer[0]);
+  m_mappingSize = size * size * sizeof(ValueType);
+  if (::ftruncate(fd, m_mappingSize) != 0) {
+    ::close(fd);
+    throw std::runtime_error("DenseLuDecomposition::allocate(): "
+                             "cannot resize the scratch file in " +
+                             directory);
+  }
+  void *data = ::mmap(0, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    throw std::runtime_error("DenseLuDecomposition::allocate(): "
+                             "cannot map the scratch file into memory");
+  m_mapping = data;
+  m_data = static_cast<ValueType *>(data);
+}
+
+template <typename ValueType>
+void DenseLuDecomposition<ValueType>::fill(
+    const DiscreteBoundaryOperator<ValueType> &op) {
+  Fiber::ProfileRegion region("Dense LU: matrix formation");
+  const size_t n = m_size;
+  const size_t tileSize = m_options.tileSize;
+  const size_t panelCount = (n + tileSize - 1) / tileSize;
+
+  const DiscreteDenseBoundaryOperator<ValueType> *denseOp =
+      dynamic_cast<const DiscreteDenseBoundaryOperator<ValueType> *>(&op);
+  if (denseOp) {
+    std::vector<int> rows(n);
+    std::iota(rows.begin(), rows.end(), 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, panelCount),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      for (size_t panel = r.begin(); panel != r.end(); ++panel) {
+        const size_t j0 = panel * tileSize;
+        const size_t width = std::min(tileSize, n - j0);
+        std::vector<int> cols(width);
+        std::iota(cols.begin(), cols.end(), j0);
+        arma::Mat<ValueType> block(column(j0), n, width,
+                                   false /* copy_aux_mem */, true /* strict */);
+        block.fill(0.);
+        denseOp->addBlock(rows, cols, 1., block);
+      }
+    });
+  } else {
+    // The operator parallelizes its own application, so the panels are
+    // formed one after another
+    for (size_t j0 = 0; j0 < n; j0 += tileSize) {
+      const size_t width = std::min(tileSize, n - j0);
+      arma::Mat<ValueType> unitVectors(n, width);
+      unitVectors.fill(0.);
+      for (size_t c = 0; c < width; ++c)
+        unitVectors(j0 + c, c) = 1.;
+      arma::Mat<ValueType> block(column(j0), n, width,
+                                 false /* copy_aux_mem */, true /* strict */);
+      op.apply(NO_TRANSPOSE, unitVectors, block, 1., 0.);
+    }
+  }
+}
+
+template <typename ValueType>
+void DenseLuDecomposition<ValueType>::factorize() {
+  Fiber::ProfileRegion region("Dense LU: factorization");
+  const size_t n = m_size;
+  const size_t tileSize = m_options.tileSize;
+  const size_t tileCount = (n + tileSize - 1) / tileSize;
+  m_pivots.resize(n);
+  if (n == 0)
+    return;
+
+  // Tiles are processed by concurrent tasks, each calling BLAS
+  Fiber::SerialBlasRegion region;
+  arma::blas_int lda = n;
+
+  for (size_t k0 = 0; k0 < n; k0 += tileSize) {
+    const size_t k1 = std::min(k0 + tileSize, n);
+    const size_t kTile = k0 / tileSize;
+
+    // Factorize the panel of columns k0...k1-1
+    arma::blas_int panelRowCount = n - k0;
+    arma::blas_int panelColCount = k1 - k0;
+    arma::blas_int info = 0;
+    arma::lapack::getrf(&panelRowCount, &panelColCount, column(k0) + k0, &lda,
+                        &m_pivots[k0], &info);
+    if (info != 0)
+      throw std::runtime_error("DenseLuDecomposition::"
+                               "DenseLuDecomposition(): "
+                               "LU decomposition failed, the matrix is "
+                               "singular");
+    for (size_t i = k0; i < k1; ++i)
+      m_pivots[i] += k0;
+
+    // Unit lower triangle of the diagonal tile, used to compute U12
+    arma::Mat<ValueType> l11(k1 - k0, k1 - k0);
+    for (size_t j = 0; j < k1 - k0; ++j)
+      for (size_t i = 0; i < k1 - k0; ++i)
+        l11(i, j) = i > j ? column(k0 + j)[k0 + i]
+                          : ValueType(i == j ? 1. : 0.);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, tileCount),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      for (size_t jTile = r.begin(); jTile != r.end(); ++jTile) {
+        if (jTile == kTile)
+          continue;
+        const size_t j0 = jTile * tileSize;
+        const size_t j1 = std::min(j0 + tileSize, n);
+
+        // Apply the row interchanges of the panel
+        for (size_t j = j0; j < j1; ++j) {
+          ValueType *col = column(j);
+          for (size_t i = k0; i < k1; ++i) {
+            const size_t p = m_pivots[i] - 1;
+            if (p != i)
+              std::swap(col[i], col[p]);
+          }
+        }
+        if (jTile < kTile)
+          continue;
+
+        // U12 = L11^{-1} A12
+        arma::Mat<ValueType> u12(k1 - k0, j1 - j0);
+        for (size_t j = j0; j < j1; ++j)
+          std::copy(column(j) + k0, column(j) + k1, u12.colptr(j - j0));
+        u12 = arma::solve(arma::trimatl(l11), u12);
+        for (size_t j = j0; j < j1; ++j)
+          std::copy(u12.colptr(j - j0), u12.colptr(j - j0) + (k1 - k0),
+                    column(j) + k0);
+
+        // A22 -= L21 U12, tile by tile
+        tbb::parallel_for(tbb::blocked_range<size_t>(kTile + 1, tileCount),
+                          [&](const tbb::blocked_range<size_t> &s) {
+          for (size_t iTile = s.begin(); iTile != s.end(); ++iTile) {
+            const size_t i0 = iTile * tileSize;
+            const size_t i1 = std::min(i0 + tileSize, n);
+            char trans = 'N';
+            arma::blas_int m = i1 - i0, cols = j1 - j0, k = k1 - k0;
+            ValueType alpha = -1., beta = 1.;
+            arma::blas::gemm(&trans, &trans, &m, &cols, &k, &alpha,
+                             column(k0) + i0, &lda, column(j0) + k0, &lda,
+                             &beta, column(j0) + i0, &lda);
+          }
+        });
+      }
+    });
+
+    // The work left is proportional to the cube of the order of the
+    // trailing submatrix
+    if (m_options.progressCallback) {
+      const double remaining = double(n - k1) / n;
+      m_options.progressCallback(1. - remaining * remaining * remaining);
+    }
+  }
+}
+
+template <typename ValueType>
+void DenseLuDecomposition<ValueType>::solve(arma::Mat<ValueType> &x,
+                                            TranspositionMode trans) const {
+  if (x.n_rows != m_size)
+    throw std::invalid_argument("DenseLuDecomposition::solve(): "
+                                "incorrect number of rows of the "
+                                "right-hand side");
+  if (m_size == 0 || x.n_cols == 0)
+    return;
+
+  // conj(A)^{-1} x = conj(A^{-1} conj(x))
+  const bool conjugate = trans == CONJUGATE;
+  if (conjugate)
+    x = arma::conj(x);
+  char transChar = trans == TRANSPOSE ? 'T'
+                   : trans == CONJUGATE_TRANSPOSE ? 'C' : 'N';
+  arma::blas_int n = m_size;
+  arma::blas_int rhsCount = x.n_cols;
+  arma::blas_int info = 0;
+  arma::lapack::getrs(&transChar, &n, &rhsCount, m_data, &n, &m_pivots[0],
+                      x.memptr(), &n, &info);
+  if (info != 0)
+    throw std::runtime_error("DenseLuDecomposition::solve(): "
+                             "triangular solve failed");
+  if (conjugate)
+    x = arma::conj(x);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DenseLuDecomposition);
+
+} // namespace Bempp
@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_dense_lu_decomposition_hpp
+#define bempp_dense_lu_decomposition_hpp
+
+#include "../common/common.hpp"
+
+#include "../assembly/transposition_mode.hpp"
+#include "../common/armadillo_fwd.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteBoundaryOperator;
+/** \endcond */
+
+/** \ingroup linalg
+ *  \brief Options controlling a DenseLuDecomposition. */
+struct DenseLuOptions {
+  DenseLuOptions() : tileSize(256), outOfCore(false), hodlrEps(0.) {}
+
+  /** \brief Order of the square tiles processed by individual tasks. */
+  int tileSize;
+  /** \brief If true, store the matrix in a scratch file mapped into memory
+   *  rather than in RAM, so that only the tiles being processed need to be
+   *  resident. */
+  bool outOfCore;
+  /** \brief Directory of the scratch file used in out-of-core mode. If
+   *  empty, the directory given by the TMPDIR environment variable, or
+   *  /tmp, is used. */
+  std::string scratchDirectory;
+  /** \brief If set, called after the factorization of each panel with the
+   *  completed fraction of the work. It may throw to abort the
+   *  decomposition. */
+  std::function<void(double)> progressCallback;
+  /** \brief If positive, DefaultDirectSolver factorizes non-blocked
+   *  operators whose weak form is stored as an H-matrix by
+   *  hmat::HodlrDecomposition, truncating to this relative accuracy,
+   *  instead of converting them to a dense matrix. This is intended for
+   *  H-matrices assembled with the "weak" admissibility condition (see the
+   *  "admissibility" H-matrix parameter). Not used by
+   *  DenseLuDecomposition itself. */
+  double hodlrEps;
+};
+
+/** \ingroup linalg
+ *  \brief LU decomposition with partial pivoting of a dense square matrix.
+
+  The matrix is decomposed by a right-looking tile algorithm: after the
+  factorization of each panel of DenseLuOptions::tileSize columns, the row
+  interchanges, the triangular solves and the Schur complement updates of
+  the remaining tiles are performed by parallel TBB tasks. The factors are
+  stored in LAPACK format in place of the matrix, so that the decomposition
+  takes no more memory than the matrix itself, and can be reused for any
+  number of right-hand sides. */
+template <typename ValueType> class DenseLuDecomposition {
+public:
+  /** \brief Decompose the matrix of a discrete operator.
+
+    The matrix is copied panel by panel directly into the storage of the
+    decomposition, without forming another copy of it. Dense operators are
+    read through DiscreteBoundaryOperator::addBlock(); other operators are
+    applied to blocks of unit vectors. */
+  explicit DenseLuDecomposition(const DiscreteBoundaryOperator<ValueType> &op,
+                                const DenseLuOptions &options =
+                                    DenseLuOptions());
+
+  /** \brief Decompose \p matrix in place.
+
+    The memory of \p matrix is taken over by the decomposition; on output
+    \p matrix is empty. Not available in out-of-core mode. */
+  explicit DenseLuDecomposition(arma::Mat<ValueType> &matrix,
+                                const DenseLuOptions &options =
+                                    DenseLuOptions());
+
+  ~DenseLuDecomposition();
+
+  DenseLuDecomposition(const DenseLuDecomposition &) = delete;
+  DenseLuDecomposition &operator=(const DenseLuDecomposition &) = delete;
+
+  /** \brief Order of the decomposed matrix. */
+  size_t size() const { return m_size; }
+
+  /** \brief Overwrite \p x with op(A)^{-1} x, where A is the decomposed
+   *  matrix. */
+  void solve(arma::Mat<ValueType> &x,
+             TranspositionMode trans = NO_TRANSPOSE) const;
+
+private:
+  void allocate(size_t size);
+  void fill(const DiscreteBoundaryOperator<ValueType> &op);
+  void factorize();
+  void release();
+  ValueType *column(size_t j) const { return m_data + j * m_size; }
+
+  DenseLuOptions m_options;
+  size_t m_size;
+  ValueType *m_data;
+  arma::Mat<ValueType> m_inCoreData;
+  void *m_mapping;
+  size_t m_mappingSize;
+  std::vector<arma::blas_int> m_pivots;
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,218 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "distributed_dense_lu_decomposition.hpp"
+
+#ifdef WITH_SCALAPACK
+
+#include "../assembly/discrete_distributed_dense_boundary_operator.hpp"
+#include "../common/mpi_datatype.hpp"
+#include "../common/to_string.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+
+extern "C" {
+int Csys2blacs_handle(MPI_Comm comm);
+void Cblacs_gridinit(int *context, const char *order, int rows, int columns);
+void Cblacs_gridexit(int context);
+void descinit_(int *desc, const int *m, const int *n, const int *mb,
+               const int *nb, const int *irsrc, const int *icsrc,
+               const int *context, const int *lld, int *info);
+void psgetrf_(const int *m, const int *n, float *a, const int *ia,
+              const int *ja, const int *desca, int *ipiv, int *info);
+void pdgetrf_(const int *m, const int *n, double *a, const int *ia,
+              const int *ja, const int *desca, int *ipiv, int *info);
+void pcgetrf_(const int *m, const int *n, std::complex<float> *a,
+              const int *ia, const int *ja, const int *desca, int *ipiv,
+              int *info);
+void pzgetrf_(const int *m, const int *n, std::complex<double> *a,
+              const int *ia, const int *ja, const int *desca, int *ipiv,
+              int *info);
+void psgetrs_(const char *trans, const int *n, const int *nrhs,
+              const float *a, const int *ia, const int *ja, const int *desca,
+              const int *ipiv, float *b, const int *ib, const int *jb,
+              const int *descb, int *info);
+void pdgetrs_(const char *trans, const int *n, const int *nrhs,
+              const double *a, const int *ia, const int *ja,
+              const int *desca, const int *ipiv, double *b, const int *ib,
+              const int *jb, const int *descb, int *info);
+void pcgetrs_(const char *trans, const int *n, const int *nrhs,
+              const std::complex<float> *a, const int *ia, const int *ja,
+              const int *desca, const int *ipiv, std::complex<float> *b,
+              const int *ib, const int *jb, const int *descb, int *info);
+void pzgetrs_(const char *trans, const int *n, const int *nrhs,
+              const std::complex<double> *a, const int *ia, const int *ja,
+              const int *desca, const int *ipiv, std::complex<double> *b,
+              const int *ib, const int *jb, const int *descb, int *info);
+} // extern "C"
+
+namespace Bempp {
+
+namespace {
+
+void getrf(int n, float *a, const int *desc, int *ipiv, int *info) {
+  const int one = 1;
+  psgetrf_(&n, &n, a, &one, &one, desc, ipiv, info);
+}
+void getrf(int n, double *a, const int *desc, int *ipiv, int *info) {
+  const int one = 1;
+  pdgetrf_(&n, &n, a, &one, &one, desc, ipiv, info);
+}
+void getrf(int n, std::complex<float> *a, const int *desc, int *ipiv,
+           int *info) {
+  const int one = 1;
+  pcgetrf_(&n, &n, a, &one, &one, desc, ipiv, info);
+}
+void getrf(int n, std::complex<double> *a, const int *desc, int *ipiv,
+           int *info) {
+  const int one = 1;
+  pzgetrf_(&n, &n, a, &one, &one, desc, ipiv, info);
+}
+
+void getrs(int n, int nrhs, const float *a, const int *desca,
+           const int *ipiv, float *b, const int *descb, int *info) {
+  const int one = 1;
+  psgetrs_("N", &n, &nrhs, a, &one, &one, desca, ipiv, b, &one, &one, descb,
+           info);
+}
+void getrs(int n, int nrhs, const double *a, const int *desca,
+           const int *ipiv, double *b, const int *descb, int *info) {
+  const int one = 1;
+  pdgetrs_("N", &n, &nrhs, a, &one, &one, desca, ipiv, b, &one, &one, descb,
+           info);
+}
+void getrs(int n, int nrhs, const std::complex<float> *a, const int *desca,
+           const int *ipiv, std::complex<float> *b, const int *descb,
+           int *info) {
+  const int one = 1;
+  pcgetrs_("N", &n, &nrhs, a, &one, &one, desca, ipiv, b, &one, &one, descb,
+           info);
+}
+void getrs(int n, int nrhs, const std::complex<double> *a, const int *desca,
+           const int *ipiv, std::complex<double> *b, const int *descb,
+           int *info) {
+  const int one = 1;
+  pzgetrs_("N", &n, &nrhs, a, &one, &one, desca, ipiv, b, &one, &one, descb,
+           info);
+}
+
+// Descriptor of a matrix distributed with blocks of the given order over
+// the BLACS grid, starting at process (0, 0)
+void describe(int *desc, int rows, int columns, int blockSize,
+              int blacsContext, int localRows) {
+  const int zero = 0;
+  const int lld = std::max(1, localRows);
+  int info = 0;
+  descinit_(desc, &rows, &columns, &blockSize, &blockSize, &zero, &zero,
+            &blacsContext, &lld, &info);
+  if (info != 0)
+    throw std::runtime_error("DistributedDenseLuDecomposition: "
+                             "descinit failed with info = " +
+                             toString(info));
+}
+
+} // namespace
+
+template <typename ValueType>
+DistributedDenseLuDecomposition<ValueType>::DistributedDenseLuDecomposition(
+    const DiscreteDistributedDenseBoundaryOperator<ValueType> &op)
+    : m_layout(op.layout()), m_comm(op.communicator()),
+      m_factors(op.localMatrix()) {
+  if (m_layout.rows() != m_layout.columns())
+    throw std::invalid_argument("DistributedDenseLuDecomposition::"
+                                "DistributedDenseLuDecomposition(): "
+                                "matrix must be square");
+  // The processes of the layout are numbered row by row
+  m_blacsContext = Csys2blacs_handle(m_comm);
+  Cblacs_gridinit(&m_blacsContext, "Row", m_layout.processRows(),
+                  m_layout.processColumns());
+  const int n = static_cast<int>(m_layout.rows());
+  describe(m_descriptor, n, n, m_layout.blockSize(), m_blacsContext,
+           static_cast<int>(m_layout.localRows()));
+
+  m_pivots.resize(m_layout.localRows() + m_layout.blockSize());
+  int info = 0;
+  getrf(n, m_factors.memptr(), m_descriptor, m_pivots.data(), &info);
+  if (info != 0) {
+    Cblacs_gridexit(m_blacsContext);
+    throw std::runtime_error("DistributedDenseLuDecomposition::"
+                             "DistributedDenseLuDecomposition(): "
+                             "factorization failed with info = " +
+                             toString(info));
+  }
+}
+
+template <typename ValueType>
+DistributedDenseLuDecomposition<ValueType>::~DistributedDenseLuDecomposition() {
+  Cblacs_gridexit(m_blacsContext);
+}
+
+template <typename ValueType>
+void DistributedDenseLuDecomposition<ValueType>::solve(
+    arma::Mat<ValueType> &x) const {
+  if (x.n_rows != m_layout.rows())
+    throw std::invalid_argument("DistributedDenseLuDecomposition::solve(): "
+                                "right-hand side has wrong number of rows");
+  if (m_layout.rows() == 0 || x.n_cols == 0)
+    return;
+
+  // The right-hand sides are distributed in the same way as the matrix
+  int processCount = 0, rank = 0;
+  MPI_Comm_size(m_comm, &processCount);
+  MPI_Comm_rank(m_comm, &rank);
+  const BlockCyclicLayout rhsLayout(x.n_rows, x.n_cols, processCount, rank,
+                                    m_layout.blockSize(),
+                                    m_layout.processRows());
+  arma::Mat<ValueType> localRhs(rhsLayout.localRows(),
+                                rhsLayout.localColumns());
+  for (size_t j = 0; j < localRhs.n_cols; ++j)
+    for (size_t i = 0; i < localRhs.n_rows; ++i)
+      localRhs(i, j) = x(rhsLayout.globalRow(i), rhsLayout.globalColumn(j));
+
+  const int n = static_cast<int>(m_layout.rows());
+  const int rhsCount = static_cast<int>(x.n_cols);
+  int rhsDescriptor[9];
+  describe(rhsDescriptor, n, rhsCount, m_layout.blockSize(), m_blacsContext,
+           static_cast<int>(rhsLayout.localRows()));
+  int info = 0;
+  getrs(n, rhsCount, m_factors.memptr(), m_descriptor, m_pivots.data(),
+        localRhs.memptr(), rhsDescriptor, &info);
+  if (info != 0)
+    throw std::runtime_error("DistributedDenseLuDecomposition::solve(): "
+                             "triangular solve failed with info = " +
+                             toString(info));
+
+  // Replicate the solution
+  x.zeros();
+  for (size_t j = 0; j < localRhs.n_cols; ++j)
+    for (size_t i = 0; i < localRhs.n_rows; ++i)
+      x(rhsLayout.globalRow(i), rhsLayout.globalColumn(j)) = localRhs(i, j);
+  MPI_Allreduce(MPI_IN_PLACE, x.memptr(), static_cast<int>(x.n_elem),
+                mpiDatatype<ValueType>(), MPI_SUM, m_comm);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DistributedDenseLuDecomposition);
+
+} // namespace Bempp
+
+#endif // WITH_SCALAPACK
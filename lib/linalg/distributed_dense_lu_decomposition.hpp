@@ -0,0 +1,84 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_distributed_dense_lu_decomposition_hpp
+#define bempp_distributed_dense_lu_decomposition_hpp
+
+#include "bempp/common/config_scalapack.hpp"
+
+#ifdef WITH_SCALAPACK
+
+#include "../common/common.hpp"
+
+#include "../assembly/block_cyclic_layout.hpp"
+#include "../common/armadillo_fwd.hpp"
+
+#include <mpi.h>
+#include <vector>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteDistributedDenseBoundaryOperator;
+/** \endcond */
+
+/** \ingroup linalg
+ *  \brief LU decomposition with partial pivoting of a dense matrix
+ *  distributed block-cyclically over the processes of an MPI communicator.
+
+  The local matrices of a DiscreteDistributedDenseBoundaryOperator are
+  copied and factorized in place by ScaLAPACK (p?getrf) on a BLACS grid
+  matching the layout of the operator. Right-hand sides and solutions are
+  replicated on all processes, like the vectors the operator is applied
+  to. The constructor and solve() must be called collectively by all
+  processes of the communicator. */
+template <typename ValueType> class DistributedDenseLuDecomposition {
+public:
+  explicit DistributedDenseLuDecomposition(
+      const DiscreteDistributedDenseBoundaryOperator<ValueType> &op);
+
+  ~DistributedDenseLuDecomposition();
+
+  DistributedDenseLuDecomposition(const DistributedDenseLuDecomposition &) =
+      delete;
+  DistributedDenseLuDecomposition &
+  operator=(const DistributedDenseLuDecomposition &) = delete;
+
+  /** \brief Order of the decomposed matrix. */
+  size_t size() const { return m_layout.rows(); }
+
+  /** \brief Overwrite \p x with A^{-1} x, where A is the decomposed
+   *  matrix. */
+  void solve(arma::Mat<ValueType> &x) const;
+
+private:
+  BlockCyclicLayout m_layout;
+  MPI_Comm m_comm;
+  int m_blacsContext;
+  int m_descriptor[9];
+  arma::Mat<ValueType> m_factors;
+  std::vector<int> m_pivots;
+};
+
+} // namespace Bempp
+
+#endif // WITH_SCALAPACK
+
+#endif
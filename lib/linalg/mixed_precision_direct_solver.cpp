@@ -0,0 +1,309 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "mixed_precision_direct_solver.hpp"
+
+#include "../assembly/abstract_boundary_operator.hpp"
+#include "../assembly/blocked_boundary_operator.hpp"
+#include "../assembly/boundary_operator.hpp"
+#include "../assembly/discrete_boundary_operator.hpp"
+#include "../common/to_string.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <boost/variant.hpp>
+
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+#include <string>
+
+namespace Bempp {
+
+namespace {
+
+template <typename ValueType> struct SinglePrecision {
+  typedef ValueType Type;
+};
+template <> struct SinglePrecision<double> { typedef float Type; };
+template <> struct SinglePrecision<std::complex<double>> {
+  typedef std::complex<float> Type;
+};
+
+// A refinement step must reduce the residual at least by this factor
+const double MIN_RESIDUAL_REDUCTION = 0.5;
+
+} // namespace
+
+/** \cond HIDDEN_INTERNAL */
+
+template <typename BasisFunctionType, typename ResultType>
+struct MixedPrecisionDirectSolver<BasisFunctionType, ResultType>::Impl {
+  typedef typename SinglePrecision<ResultType>::Type FactorType;
+
+  template <typename BoundaryOp>
+  Impl(const BoundaryOp &op_, MagnitudeType tolerance_,
+       int maxIterationCount_)
+      : op(op_), weakForm(op_.weakForm()), tolerance(tolerance_),
+        maxIterationCount(maxIterationCount_) {
+    if (tolerance <= 0)
+      throw std::invalid_argument("MixedPrecisionDirectSolver::"
+                                  "MixedPrecisionDirectSolver(): "
+                                  "tolerance must be positive");
+    if (weakForm->rowCount() != weakForm->columnCount())
+      throw std::invalid_argument("MixedPrecisionDirectSolver::"
+                                  "MixedPrecisionDirectSolver(): "
+                                  "non-square system provided");
+    factorize();
+  }
+
+  // LU-decompose the weak form in single precision, overwriting the
+  // rounded matrix with its factors
+  void factorize() {
+    lu = arma::conv_to<arma::Mat<FactorType>>::from(weakForm->asMatrix());
+    arma::blas_int n = lu.n_rows;
+    arma::blas_int info = 0;
+    pivots.set_size(n);
+    if (n > 0)
+      arma::lapack::getrf(&n, &n, lu.memptr(), &n, pivots.memptr(), &info);
+    if (info != 0)
+      throw std::runtime_error("MixedPrecisionDirectSolver::"
+                               "MixedPrecisionDirectSolver(): "
+                               "LU decomposition failed, the matrix is "
+                               "singular in single precision");
+  }
+
+  // Overwrite x with the solution of (LU) x = x
+  void solveFactorized(arma::Mat<FactorType> &x) const {
+    char trans = 'N';
+    arma::blas_int n = lu.n_rows;
+    arma::blas_int rhsCount = x.n_cols;
+    arma::blas_int info = 0;
+    arma::lapack::getrs(&trans, &n, &rhsCount, lu.memptr(), &n,
+                        pivots.memptr(), x.memptr(), &n, &info);
+    if (info != 0)
+      throw std::runtime_error("MixedPrecisionDirectSolver::solve(): "
+                               "triangular solve failed");
+  }
+
+  // Solve A X = B by iterative refinement. Return the number of refinement
+  // steps and set relResidual to the largest relative residual of the
+  // columns of X.
+  int solve(const arma::Mat<ResultType> &b, arma::Mat<ResultType> &x,
+            MagnitudeType &relResidual) const {
+    const size_t n = b.n_rows;
+    x.zeros(n, b.n_cols);
+    relResidual = 0;
+    if (n == 0 || b.n_cols == 0)
+      return 0;
+
+    arma::Row<MagnitudeType> rhsNorms(b.n_cols);
+    for (size_t j = 0; j < b.n_cols; ++j) {
+      rhsNorms(j) = arma::norm(b.col(j), 2);
+      if (rhsNorms(j) == 0)
+        rhsNorms(j) = 1; // x(:, j) is zero and stays so
+    }
+
+    arma::Mat<ResultType> r = b;
+    arma::Mat<FactorType> correction;
+    MagnitudeType previousRelResidual = 0;
+    int iteration = 0;
+    for (;; ++iteration) {
+      relResidual = 0;
+      for (size_t j = 0; j < r.n_cols; ++j)
+        relResidual =
+            std::max(relResidual, arma::norm(r.col(j), 2) / rhsNorms(j));
+      if (relResidual <= tolerance || iteration == maxIterationCount ||
+          (iteration > 0 &&
+           relResidual > MIN_RESIDUAL_REDUCTION * previousRelResidual))
+        break;
+      previousRelResidual = relResidual;
+
+      // Compute the correction in single precision, scaling the residual
+      // to avoid underflow once it gets small
+      arma::Mat<ResultType> scaledR = r;
+      arma::Row<MagnitudeType> scales(r.n_cols);
+      for (size_t j = 0; j < r.n_cols; ++j) {
+        scales(j) = arma::norm(r.col(j), 2);
+        if (scales(j) > 0)
+          scaledR.col(j) /= scales(j);
+      }
+      correction = arma::conv_to<arma::Mat<FactorType>>::from(scaledR);
+      solveFactorized(correction);
+      for (size_t j = 0; j < r.n_cols; ++j)
+        x.col(j) += scales(j) * arma::conv_to<arma::Col<ResultType>>::from(
+                                    correction.col(j));
+
+      // Residual in working precision
+      r = b;
+      weakForm->apply(NO_TRANSPOSE, x, r, -1., 1.);
+    }
+    return iteration;
+  }
+
+  Solution<BasisFunctionType, ResultType>
+  makeSolution(const GridFunction<BasisFunctionType, ResultType> &function,
+               int iterationCount, MagnitudeType relResidual) const {
+    return Solution<BasisFunctionType, ResultType>(
+        function, relResidual <= tolerance ? SolutionStatus::CONVERGED
+                                           : SolutionStatus::UNCONVERGED,
+        relResidual, message(iterationCount, relResidual));
+  }
+
+  std::string message(int iterationCount, MagnitudeType relResidual) const {
+    return std::string(relResidual <= tolerance ? "Solver converged"
+                                                : "Solver did not converge") +
+           " after " + toString(iterationCount) + " refinement step(s)";
+  }
+
+  boost::variant<BoundaryOperator<BasisFunctionType, ResultType>,
+                 BlockedBoundaryOperator<BasisFunctionType, ResultType>> op;
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> weakForm;
+  MagnitudeType tolerance;
+  int maxIterationCount;
+  arma::Mat<FactorType> lu;
+  arma::Col<arma::blas_int> pivots;
+};
+
+/** \endcond */
+
+template <typename BasisFunctionType, typename ResultType>
+MixedPrecisionDirectSolver<BasisFunctionType, ResultType>::
+    MixedPrecisionDirectSolver(
+        const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+        MagnitudeType tolerance, int maxIterationCount)
+    : m_impl(new Impl(boundaryOp, tolerance, maxIterationCount)) {}
+
+template <typename BasisFunctionType, typename ResultType>
+MixedPrecisionDirectSolver<BasisFunctionType, ResultType>::
+    MixedPrecisionDirectSolver(
+        const BlockedBoundaryOperator<BasisFunctionType, ResultType> &
+            boundaryOp,
+        MagnitudeType tolerance, int maxIterationCount)
+    : m_impl(new Impl(boundaryOp, tolerance, maxIterationCount)) {}
+
+template <typename BasisFunctionType, typename ResultType>
+MixedPrecisionDirectSolver<BasisFunctionType,
+                           ResultType>::~MixedPrecisionDirectSolver() {}
+
+template <typename BasisFunctionType, typename ResultType>
+Solution<BasisFunctionType, ResultType>
+MixedPrecisionDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
+    const GridFunction<BasisFunctionType, ResultType> &rhs) const {
+  std::vector<Solution<BasisFunctionType, ResultType>> solutions =
+      solveImplNonblockedMultipleRhs(
+          std::vector<GridFunction<BasisFunctionType, ResultType>>(1, rhs));
+  return solutions[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType>>
+MixedPrecisionDirectSolver<BasisFunctionType, ResultType>::
+    solveImplNonblockedMultipleRhs(
+        const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+        const {
+  typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+  typedef GridFunction<BasisFunctionType, ResultType> GF;
+
+  const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
+  if (!boundaryOp)
+    throw std::logic_error(
+        "MixedPrecisionDirectSolver::solve(): for solvers constructed "
+        "from a BlockedBoundaryOperator the other solve() overload "
+        "must be used");
+  for (size_t i = 0; i < rhs.size(); ++i)
+    Solver<BasisFunctionType, ResultType>::checkConsistency(
+        *boundaryOp, rhs[i],
+        ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+
+  arma::Mat<ResultType> armaRhs(boundaryOp->dualToRange()->globalDofCount(),
+                                rhs.size());
+  for (size_t i = 0; i < rhs.size(); ++i)
+    armaRhs.col(i) = rhs[i].projections(boundaryOp->dualToRange());
+
+  // Solve
+  arma::Mat<ResultType> armaSolution;
+  MagnitudeType relResidual;
+  const int iterationCount = m_impl->solve(armaRhs, armaSolution, relResidual);
+
+  std::vector<Solution<BasisFunctionType, ResultType>> solutions;
+  solutions.reserve(rhs.size());
+  for (size_t i = 0; i < rhs.size(); ++i)
+    solutions.push_back(m_impl->makeSolution(
+        GF(boundaryOp->context(), boundaryOp->domain(),
+           arma::Col<ResultType>(armaSolution.col(i))),
+        iterationCount, relResidual));
+  return solutions;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+MixedPrecisionDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs) const {
+  typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+
+  const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
+  if (!boundaryOp)
+    throw std::logic_error(
+        "MixedPrecisionDirectSolver::solve(): for solvers constructed "
+        "from a (non-blocked) BoundaryOperator the other solve() overload "
+        "must be used");
+  std::vector<GridFunction<BasisFunctionType, ResultType>> canonicalRhs =
+      Solver<BasisFunctionType, ResultType>::canonicalizeBlockedRhs(
+          *boundaryOp, rhs,
+          ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+  // Shouldn't be needed, but better safe than sorry...
+  Solver<BasisFunctionType, ResultType>::checkConsistency(
+      *boundaryOp, canonicalRhs,
+      ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+
+  // Construct the right-hand size vector
+  arma::Col<ResultType> armaRhs(
+      boundaryOp->totalGlobalDofCountInDualsToRanges());
+  for (size_t i = 0, start = 0; i < canonicalRhs.size(); ++i) {
+    const arma::Col<ResultType> &chunkProjections =
+        canonicalRhs[i].projections(boundaryOp->dualToRange(i));
+    size_t chunkSize = chunkProjections.n_rows;
+    armaRhs.rows(start, start + chunkSize - 1) = chunkProjections;
+    start += chunkSize;
+  }
+
+  // Solve
+  arma::Mat<ResultType> armaSolution;
+  MagnitudeType relResidual;
+  const int iterationCount = m_impl->solve(armaRhs, armaSolution, relResidual);
+
+  // Convert chunks of the solution vector into grid functions
+  std::vector<GridFunction<BasisFunctionType, ResultType>> solutionFunctions;
+  Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
+      arma::Col<ResultType>(armaSolution.col(0)), *boundaryOp,
+      solutionFunctions);
+
+  // Return solution
+  return BlockedSolution<BasisFunctionType, ResultType>(
+      solutionFunctions,
+      relResidual <= m_impl->tolerance ? SolutionStatus::CONVERGED
+                                       : SolutionStatus::UNCONVERGED,
+      relResidual, m_impl->message(iterationCount, relResidual));
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
+    MixedPrecisionDirectSolver);
+
+} // namespace Bempp
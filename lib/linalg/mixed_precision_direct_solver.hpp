@@ -0,0 +1,101 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_mixed_precision_direct_solver_hpp
+#define bempp_mixed_precision_direct_solver_hpp
+
+#include "solver.hpp"
+
+#include "../common/scalar_traits.hpp"
+
+#include <boost/scoped_ptr.hpp>
+
+namespace Bempp {
+
+/** \ingroup linalg
+  * \brief Dense direct solver using a single-precision LU decomposition and
+  * iterative refinement.
+  *
+  * The weak form of the boundary operator is converted to a dense matrix,
+  * rounded to single precision and LU-decomposed. Each solve then performs
+  * mixed-precision iterative refinement: the residual is computed in the
+  * working precision by applying the original discrete operator, and the
+  * single-precision LU decomposition is used to compute the correction.
+  * Compared with DefaultDirectSolver, this halves the memory taken by the
+  * factors and roughly doubles the speed of the decomposition, while
+  * reaching the same accuracy for reasonably conditioned systems.
+  *
+  * Refinement stops when the relative residual of every right-hand side
+  * drops below the given tolerance, when the maximum number of steps is
+  * reached or when the residual stops decreasing (which happens if the
+  * system is too ill-conditioned for single precision). In the latter two
+  * cases the solution is marked as unconverged.
+  *
+  * For <tt>ResultType</tt> equal to <tt>float</tt> or
+  * <tt>complex<float></tt> the decomposition and the refinement are both
+  * done in single precision.
+  */
+template <typename BasisFunctionType, typename ResultType>
+class MixedPrecisionDirectSolver
+    : public Solver<BasisFunctionType, ResultType> {
+public:
+  typedef Solver<BasisFunctionType, ResultType> Base;
+  typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
+
+  /** \brief Construct a solver for a non-blocked boundary operator.
+    *
+    * \param[in] boundaryOp
+    *   Non-blocked boundary operator.
+    * \param[in] tolerance
+    *   Relative residual to be reached by iterative refinement.
+    * \param[in] maxIterationCount
+    *   Maximum number of refinement steps.
+    */
+  MixedPrecisionDirectSolver(
+      const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+      MagnitudeType tolerance = 1e-10, int maxIterationCount = 30);
+  /** \brief Construct a solver for a blocked boundary operator.
+    *
+    * See the other constructor for the description of the parameters.
+    */
+  MixedPrecisionDirectSolver(
+      const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+      MagnitudeType tolerance = 1e-10, int maxIterationCount = 30);
+  ~MixedPrecisionDirectSolver();
+
+private:
+  virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
+      const GridFunction<BasisFunctionType, ResultType> &rhs) const;
+  virtual BlockedSolution<BasisFunctionType, ResultType> solveImplBlocked(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
+  virtual std::vector<Solution<BasisFunctionType, ResultType>>
+  solveImplNonblockedMultipleRhs(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
+
+private:
+  struct Impl;
+  boost::scoped_ptr<Impl> m_impl;
+};
+
+} // namespace Bempp
+
+#endif
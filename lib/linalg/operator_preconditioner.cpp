@@ -0,0 +1,235 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_trilinos.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "operator_preconditioner.hpp"
+
+#include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/discrete_inverse_sparse_boundary_operator.hpp"
+#include "../assembly/identity_operator.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <boost/make_shared.hpp>
+#include <boost/weak_ptr.hpp>
+#include <tbb/mutex.h>
+
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace Bempp {
+
+namespace {
+
+TranspositionMode transposed(TranspositionMode trans) {
+  switch (trans) {
+  case NO_TRANSPOSE:
+    return TRANSPOSE;
+  case CONJUGATE:
+    return CONJUGATE_TRANSPOSE;
+  case TRANSPOSE:
+    return NO_TRANSPOSE;
+  default:
+    return CONJUGATE;
+  }
+}
+
+// Discrete operator C = L B R. L and R are inverses of Gram matrices; R may
+// be missing, in which case the transpose of L is used in its place.
+template <typename ValueType>
+class FusedOperatorPreconditioner
+    : public DiscreteBoundaryOperator<ValueType> {
+  typedef DiscreteBoundaryOperator<ValueType> Base;
+
+public:
+  FusedOperatorPreconditioner(const shared_ptr<const Base> &leftInverse,
+                              const shared_ptr<const Base> &op,
+                              const shared_ptr<const Base> &rightInverse)
+      : m_leftInverse(leftInverse), m_op(op), m_rightInverse(rightInverse) {}
+
+  virtual unsigned int rowCount() const { return m_leftInverse->rowCount(); }
+
+  virtual unsigned int columnCount() const {
+    return m_rightInverse ? m_rightInverse->columnCount()
+                          : m_leftInverse->rowCount();
+  }
+
+  virtual void addBlock(const std::vector<int> &rows,
+                        const std::vector<int> &cols, const ValueType alpha,
+                        arma::Mat<ValueType> &block) const {
+    throw std::runtime_error("FusedOperatorPreconditioner::addBlock(): "
+                             "not implemented");
+  }
+
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>>
+  domain() const {
+    return m_rightInverse ? m_rightInverse->domain() : m_leftInverse->range();
+  }
+
+  virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType>> range() const {
+    return m_leftInverse->range();
+  }
+
+protected:
+  virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const {
+    return m_leftInverse->opSupported(M_trans) &&
+           m_op->opSupported(M_trans) &&
+           (m_rightInverse ? m_rightInverse->opSupported(M_trans)
+                           : m_leftInverse->opSupported(
+                                 Thyra::trans_trans(M_trans, Thyra::TRANS)));
+  }
+
+private:
+  virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                const arma::Col<ValueType> &x_in,
+                                arma::Col<ValueType> &y_inout,
+                                const ValueType alpha,
+                                const ValueType beta) const {
+    const Base &right = m_rightInverse ? *m_rightInverse : *m_leftInverse;
+    const TranspositionMode rightTrans =
+        m_rightInverse ? trans : transposed(trans);
+    if (trans == NO_TRANSPOSE || trans == CONJUGATE) {
+      arma::Col<ValueType> tmp1(m_op->columnCount());
+      right.apply(rightTrans, x_in, tmp1, 1., 0.);
+      arma::Col<ValueType> tmp2(m_op->rowCount());
+      m_op->apply(trans, tmp1, tmp2, 1., 0.);
+      m_leftInverse->apply(trans, tmp2, y_inout, alpha, beta);
+    } else {
+      arma::Col<ValueType> tmp1(m_op->rowCount());
+      m_leftInverse->apply(trans, x_in, tmp1, 1., 0.);
+      arma::Col<ValueType> tmp2(m_op->columnCount());
+      m_op->apply(trans, tmp1, tmp2, 1., 0.);
+      right.apply(rightTrans, tmp2, y_inout, alpha, beta);
+    }
+  }
+
+private:
+  shared_ptr<const Base> m_leftInverse;
+  shared_ptr<const Base> m_op;
+  shared_ptr<const Base> m_rightInverse;
+};
+
+// Return the inverse of the Gram matrix of the bases of domain and
+// dualToRange. Inverses are cached per pair of spaces as long as they are in
+// use, so that all preconditioners built on the same spaces share a single
+// decomposition.
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>> gramInverse(
+    const shared_ptr<const Context<BasisFunctionType, ResultType>> &context,
+    const shared_ptr<const Space<BasisFunctionType>> &domain,
+    const shared_ptr<const Space<BasisFunctionType>> &dualToRange) {
+  typedef Space<BasisFunctionType> SpaceType;
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+  typedef std::pair<const SpaceType *, const SpaceType *> Key;
+  // The spaces are stored with the entry, so that it is not reused for
+  // spaces that merely happen to live at the addresses of destroyed ones
+  struct Entry {
+    boost::weak_ptr<const SpaceType> domain;
+    boost::weak_ptr<const SpaceType> dualToRange;
+    boost::weak_ptr<const DiscreteOp> inverse;
+  };
+  static tbb::mutex mutex;
+  static std::map<Key, Entry> cache;
+
+  tbb::mutex::scoped_lock lock(mutex);
+  for (typename std::map<Key, Entry>::iterator it = cache.begin();
+       it != cache.end();)
+    if (it->second.inverse.expired())
+      cache.erase(it++);
+    else
+      ++it;
+
+  Entry &entry = cache[Key(domain.get(), dualToRange.get())];
+  shared_ptr<const DiscreteOp> inverse = entry.inverse.lock();
+  if (inverse && entry.domain.lock() == domain &&
+      entry.dualToRange.lock() == dualToRange)
+    return inverse;
+
+  inverse = discreteSparseInverse(
+      identityOperator(context, domain, domain, dualToRange).weakForm());
+  entry.domain = domain;
+  entry.dualToRange = dualToRange;
+  entry.inverse = inverse;
+  return inverse;
+}
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+discreteOperatorPreconditioner(
+    const BoundaryOperator<BasisFunctionType, ResultType> &op,
+    const BoundaryOperator<BasisFunctionType, ResultType> &preconditionerOp) {
+  typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+
+  if (!op.isInitialized() || !preconditionerOp.isInitialized())
+    throw std::invalid_argument("discreteOperatorPreconditioner(): "
+                                "operators must be initialized");
+  if (preconditionerOp.domain()->globalDofCount() !=
+          op.dualToRange()->globalDofCount() ||
+      preconditionerOp.dualToRange()->globalDofCount() !=
+          op.domain()->globalDofCount())
+    throw std::invalid_argument("discreteOperatorPreconditioner(): "
+                                "spaces of the preconditioning operator do "
+                                "not match those of the operator to be "
+                                "preconditioned");
+
+  // Gram matrix of the domain of op and the dual to range of the
+  // preconditioner
+  shared_ptr<const DiscreteOp> leftInverse =
+      gramInverse(op.context(), op.domain(), preconditionerOp.dualToRange());
+
+  // Gram matrix of the domain of the preconditioner and the dual to range
+  // of op; if both operators act on a single space, it is the transpose of
+  // the previous one
+  shared_ptr<const DiscreteOp> rightInverse;
+  if (op.domain() != op.dualToRange() ||
+      preconditionerOp.domain() != preconditionerOp.dualToRange())
+    rightInverse = gramInverse(op.context(), preconditionerOp.domain(),
+                               op.dualToRange());
+
+  return boost::make_shared<FusedOperatorPreconditioner<ResultType>>(
+      leftInverse, preconditionerOp.weakForm(), rightInverse);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Preconditioner<ResultType> operatorPreconditioner(
+    const BoundaryOperator<BasisFunctionType, ResultType> &op,
+    const BoundaryOperator<BasisFunctionType, ResultType> &preconditionerOp) {
+  return discreteOperatorToPreconditioner(
+      discreteOperatorPreconditioner(op, preconditionerOp));
+}
+
+#define INSTANTIATE_FREE_FUNCTIONS(BASIS, RESULT)                              \
+  template shared_ptr<const DiscreteBoundaryOperator<RESULT>>                  \
+  discreteOperatorPreconditioner(const BoundaryOperator<BASIS, RESULT> &,      \
+                                 const BoundaryOperator<BASIS, RESULT> &);     \
+  template Preconditioner<RESULT> operatorPreconditioner(                      \
+      const BoundaryOperator<BASIS, RESULT> &,                                 \
+      const BoundaryOperator<BASIS, RESULT> &);
+
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_FREE_FUNCTIONS);
+
+} // namespace Bempp
+
+#endif // WITH_TRILINOS
@@ -0,0 +1,88 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_operator_preconditioner_hpp
+#define bempp_operator_preconditioner_hpp
+
+#include "../common/common.hpp"
+
+#include "bempp/common/config_trilinos.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "preconditioner.hpp"
+
+#include "../assembly/boundary_operator.hpp"
+#include "../common/shared_ptr.hpp"
+
+namespace Bempp {
+
+/** \ingroup linalg
+ *  \brief Construct the discrete form of an operator preconditioner.
+
+  Given an operator \f$A\f$ with domain \f$X\f$ and dual to range \f$Y\f$
+  and a preconditioning operator \f$B\f$ with domain \f$Y'\f$ and dual to
+  range \f$X'\f$, this function returns the discrete operator
+
+  \f[ C = M_X^{-1} B M_Y^{-1}, \f]
+
+  where \f$M_X\f$ is the Gram matrix of the bases of \f$X\f$ and \f$X'\f$
+  and \f$M_Y\f$ that of \f$Y'\f$ and \f$Y\f$. A typical example is the
+  Calderon preconditioning of the hypersingular operator on a space of
+  continuous functions by the single-layer operator on the barycentric dual
+  space of piecewise constants.
+
+  The weak form of \p preconditionerOp is assembled (according to the
+  assembly options of its context, so possibly as an H-matrix) and the Gram
+  matrices are decomposed when this function is called (see
+  DiscreteInverseSparseBoundaryOperator). The decompositions are shared by
+  all preconditioners built on the same pairs of spaces, as long as any of
+  them is alive. If \p op and \p preconditionerOp each act on a single
+  space, \f$M_Y = M_X^T\f$ and a single decomposition is used. The returned
+  operator applies the three factors in turn, without constructing
+  intermediate composite operators.
+
+  \param[in] op Operator to be preconditioned.
+  \param[in] preconditionerOp Preconditioning operator \f$B\f$. The number of
+    DOFs in its domain must be the same as in the dual to range of \p op and
+    the number of DOFs in its dual to range the same as in the domain of
+    \p op. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+discreteOperatorPreconditioner(
+    const BoundaryOperator<BasisFunctionType, ResultType> &op,
+    const BoundaryOperator<BasisFunctionType, ResultType> &preconditionerOp);
+
+/** \ingroup linalg
+ *  \brief Construct an operator preconditioner for use with
+ *  DefaultIterativeSolver.
+
+  This is a convenience function wrapping the result of
+  discreteOperatorPreconditioner() in a Preconditioner object. */
+template <typename BasisFunctionType, typename ResultType>
+Preconditioner<ResultType> operatorPreconditioner(
+    const BoundaryOperator<BasisFunctionType, ResultType> &op,
+    const BoundaryOperator<BasisFunctionType, ResultType> &preconditionerOp);
+
+} // namespace Bempp
+
+#endif // WITH_TRILINOS
+
+#endif
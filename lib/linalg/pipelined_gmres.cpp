@@ -0,0 +1,223 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "pipelined_gmres.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/complex_aux.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <tbb/parallel_invoke.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace Bempp {
+
+namespace {
+
+// Complex Givens rotation [c, s; -conj(s), c] with real c
+template <typename ValueType> struct GivensRotation {
+  typedef typename ScalarTraits<ValueType>::RealType MagnitudeType;
+
+  MagnitudeType c;
+  ValueType s;
+
+  void apply(ValueType &x, ValueType &y) const {
+    const ValueType t = c * x + s * y;
+    y = -conj(s) * x + c * y;
+    x = t;
+  }
+
+  // Choose the rotation annihilating y
+  void compute(ValueType x, ValueType y) {
+    const MagnitudeType absX = std::abs(x);
+    const MagnitudeType absY = std::abs(y);
+    const MagnitudeType norm = std::sqrt(absX * absX + absY * absY);
+    if (absX == 0) {
+      c = 0;
+      s = 1;
+    } else {
+      c = absX / norm;
+      s = (x / absX) * conj(y) / norm;
+    }
+  }
+};
+
+} // namespace
+
+template <typename ValueType>
+PipelinedGmresStatus<typename ScalarTraits<ValueType>::RealType>
+pipelinedGmres(
+    const std::function<void(const arma::Col<ValueType> &,
+                             arma::Col<ValueType> &)> &applyOperator,
+    const std::function<void(const arma::Col<ValueType> &,
+                             arma::Col<ValueType> &)> &applyPreconditioner,
+    const arma::Col<ValueType> &rhs, arma::Col<ValueType> &solution,
+    const PipelinedGmresOptions &options) {
+  typedef typename ScalarTraits<ValueType>::RealType MagnitudeType;
+
+  if (!applyOperator)
+    throw std::invalid_argument("pipelinedGmres(): "
+                                "applyOperator must not be empty");
+  if (options.restart < 1)
+    throw std::invalid_argument("pipelinedGmres(): "
+                                "restart must be positive");
+  if (solution.n_rows != rhs.n_rows)
+    throw std::invalid_argument("pipelinedGmres(): "
+                                "solution and rhs must have the same size");
+
+  // Product with the right-preconditioned matrix
+  arma::Col<ValueType> preconditioned;
+  auto applyMatrix = [&](const arma::Col<ValueType> &x,
+                         arma::Col<ValueType> &y) {
+    if (applyPreconditioner) {
+      applyPreconditioner(x, preconditioned);
+      applyOperator(preconditioned, y);
+    } else
+      applyOperator(x, y);
+  };
+
+  PipelinedGmresStatus<MagnitudeType> status;
+  status.converged = false;
+  status.iterationCount = 0;
+  const MagnitudeType rhsNorm = arma::norm(rhs, 2);
+  if (rhsNorm == 0) {
+    solution.zeros();
+    status.converged = true;
+    status.relativeResidual = 0;
+    return status;
+  }
+  const MagnitudeType tolerance = options.tolerance;
+  const int n = rhs.n_rows;
+  const int m = options.restart;
+
+  arma::Mat<ValueType> V(n, m + 1), Z(n, m + 1);
+  // Hessenberg matrix of the Arnoldi relation and its triangular factor
+  arma::Mat<ValueType> H(m + 1, m), R(m + 1, m);
+  std::vector<GivensRotation<ValueType>> rotations(m);
+  arma::Col<ValueType> g(m + 1);
+  arma::Col<ValueType> residual, w, nextW;
+
+  while (true) {
+    // Recompute the residual in full
+    applyOperator(solution, residual);
+    residual = rhs - residual;
+    const MagnitudeType residualNorm = arma::norm(residual, 2);
+    status.relativeResidual = residualNorm / rhsNorm;
+    if (status.relativeResidual <= tolerance) {
+      status.converged = true;
+      break;
+    }
+    if (status.iterationCount >= options.maxIterationCount)
+      break;
+
+    const int cycleLength =
+        std::min(m, options.maxIterationCount - status.iterationCount);
+    H.zeros();
+    g.zeros();
+    g(0) = residualNorm;
+    V.col(0) = residual / residualNorm;
+    Z.col(0) = V.col(0);
+    applyMatrix(Z.col(0), w);
+
+    // In iteration i, w = A z_i. The vectors v_i and z_{i + 1} are first
+    // computed scaled by h(i, i - 1), whose value is only known at the end
+    // of the iteration, and normalised at the beginning of the next one;
+    // the same holds for the last column of H.
+    int dimension = 0;
+    for (int i = 0; i <= cycleLength; ++i) {
+      if (i > 1) {
+        const ValueType h = H(i - 1, i - 2);
+        V.col(i - 1) /= h;
+        Z.col(i) /= h;
+        w /= h;
+        H(arma::span(0, i - 2), i - 1) /= h;
+        H(i - 1, i - 1) /= h * h;
+      }
+      if (i < cycleLength) {
+        Z.col(i + 1) = w;
+        if (i > 0)
+          Z.col(i + 1) -= Z.cols(1, i) * H(arma::span(0, i - 1), i - 1);
+      }
+
+      bool done = false;
+      tbb::parallel_invoke(
+          [&] {
+            if (i < cycleLength)
+              applyMatrix(Z.col(i + 1), nextW);
+          },
+          [&] {
+            if (i > 0) {
+              // Orthogonalise v_i and complete column i - 1 of H
+              V.col(i) = Z.col(i) - V.cols(0, i - 1) *
+                                        H(arma::span(0, i - 1), i - 1);
+              H(i, i - 1) = arma::norm(V.col(i), 2);
+              const int c = i - 1;
+              R.col(c) = H.col(c);
+              for (int k = 0; k < c; ++k)
+                rotations[k].apply(R(k, c), R(k + 1, c));
+              rotations[c].compute(R(c, c), R(c + 1, c));
+              rotations[c].apply(R(c, c), R(c + 1, c));
+              rotations[c].apply(g(c), g(c + 1));
+              dimension = i;
+              done = std::abs(g(i)) <= tolerance * rhsNorm ||
+                     H(i, i - 1) == MagnitudeType(0);
+            }
+            if (i < cycleLength && !done)
+              H(arma::span(0, i), i) = V.cols(0, i).t() * Z.col(i + 1);
+          });
+      if (done || i == cycleLength)
+        break;
+      w.swap(nextW);
+    }
+    status.iterationCount += dimension;
+
+    // Update the solution
+    arma::Col<ValueType> y = g.rows(0, dimension - 1);
+    for (int j = dimension - 1; j >= 0; --j) {
+      for (int k = j + 1; k < dimension; ++k)
+        y(j) -= R(j, k) * y(k);
+      y(j) /= R(j, j);
+    }
+    arma::Col<ValueType> update = V.cols(0, dimension - 1) * y;
+    if (applyPreconditioner) {
+      applyPreconditioner(update, preconditioned);
+      solution += preconditioned;
+    } else
+      solution += update;
+  }
+  return status;
+}
+
+#define INSTANTIATE_PIPELINED_GMRES(VALUE)                                     \
+  template PipelinedGmresStatus<ScalarTraits<VALUE>::RealType>                 \
+  pipelinedGmres(                                                              \
+      const std::function<void(const arma::Col<VALUE> &, arma::Col<VALUE> &)>  \
+          &applyOperator,                                                      \
+      const std::function<void(const arma::Col<VALUE> &, arma::Col<VALUE> &)>  \
+          &applyPreconditioner,                                                \
+      const arma::Col<VALUE> &rhs, arma::Col<VALUE> &solution,                 \
+      const PipelinedGmresOptions &options)
+FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_PIPELINED_GMRES);
+
+} // namespace Bempp
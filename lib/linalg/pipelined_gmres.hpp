@@ -0,0 +1,91 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_pipelined_gmres_hpp
+#define bempp_pipelined_gmres_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/scalar_traits.hpp"
+
+#include <functional>
+
+namespace Bempp {
+
+/** \ingroup linalg
+ *  \brief Options controlling pipelinedGmres(). */
+struct PipelinedGmresOptions {
+  PipelinedGmresOptions()
+      : tolerance(1e-5), restart(30), maxIterationCount(1000) {}
+
+  /** \brief Relative residual to be reached. */
+  double tolerance;
+  /** \brief Number of iterations of a restart cycle. */
+  int restart;
+  /** \brief Maximum total number of iterations. */
+  int maxIterationCount;
+};
+
+/** \ingroup linalg
+ *  \brief Outcome of pipelinedGmres(). */
+template <typename MagnitudeType> struct PipelinedGmresStatus {
+  bool converged;
+  int iterationCount;
+  /** \brief Norm of the residual divided by the norm of the right-hand
+   *  side. */
+  MagnitudeType relativeResidual;
+};
+
+/** \ingroup linalg
+ *  \brief Solve a linear system by the pipelined GMRES method p(1)-GMRES.
+ *
+ *  In standard GMRES the Gram-Schmidt reductions of each iteration need the
+ *  result of the matrix-vector product of that iteration, and the next
+ *  product needs the orthonormalised vector. p(1)-GMRES (P. Ghysels et al.,
+ *  SIAM J. Sci. Comput. 35 (2013) C48) builds an auxiliary basis \f$z_i\f$
+ *  spanning the same Krylov space, whose next vector is obtained from the
+ *  previous product by a recurrence, and normalises the basis vectors one
+ *  iteration late. The product with \f$z_{i+1}\f$ therefore runs
+ *  concurrently with the orthogonalisation of \f$v_i\f$ and the single
+ *  block of scalar products of the iteration, which hides the global
+ *  reduction of a distributed operator behind local work and vice versa.
+ *  Like the monomial Krylov basis, the recurrence loses accuracy over long
+ *  cycles; the residual is therefore recomputed at the end of every restart
+ *  cycle and decides about convergence.
+ *
+ *  \p applyOperator(x, y) must store the product of the matrix with \p x in
+ *  \p y. If \p applyPreconditioner is not empty, it is used in the same way
+ *  as a right preconditioner. \p solution holds the initial guess on input.
+ *  The operator may be applied concurrently with BLAS calls of the solver,
+ *  but never concurrently with itself or the preconditioner. */
+template <typename ValueType>
+PipelinedGmresStatus<typename ScalarTraits<ValueType>::RealType>
+pipelinedGmres(
+    const std::function<void(const arma::Col<ValueType> &,
+                             arma::Col<ValueType> &)> &applyOperator,
+    const std::function<void(const arma::Col<ValueType> &,
+                             arma::Col<ValueType> &)> &applyPreconditioner,
+    const arma::Col<ValueType> &rhs, arma::Col<ValueType> &solution,
+    const PipelinedGmresOptions &options = PipelinedGmresOptions());
+
+} // namespace Bempp
+
+#endif
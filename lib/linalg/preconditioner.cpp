@@ -25,8 +25,19 @@
 
 #include "preconditioner.hpp"
 
+#include "../assembly/discrete_block_gauss_seidel_operator.hpp"
 #include "../assembly/discrete_blocked_boundary_operator.hpp"
 #include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/discrete_hmat_boundary_operator.hpp"
+#include "../assembly/hmat_approximate_lu_inverse.hpp"
+#include "../assembly/hmat_near_field_spai.hpp"
+#include "../assembly/discrete_sparse_boundary_operator.hpp"
+#include "../assembly/level_transfer.hpp"
+#include "../grid/grid.hpp"
+#include "../space/space.hpp"
+#ifdef WITH_AHMED
+#include "../assembly/discrete_aca_boundary_operator.hpp"
+#endif
 #include "../fiber/_2d_array.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/scalar_traits.hpp"
@@ -37,8 +48,37 @@
 #include <Thyra_PreconditionerBase.hpp>
 #include <Thyra_DefaultPreconditioner.hpp>
 
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_Vector.h>
+
+#include <tbb/parallel_for.h>
+
+#include <cmath>
+
 namespace Bempp {
 
+namespace {
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType>>
+approximateLuInverse(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op,
+    double eps) {
+  if (boost::dynamic_pointer_cast<
+          const DiscreteHMatBoundaryOperator<ValueType>>(op))
+    return hMatOperatorApproximateLuInverse(op, eps);
+#ifdef WITH_AHMED
+  if (boost::dynamic_pointer_cast<
+          const DiscreteAcaBoundaryOperator<ValueType>>(op))
+    return acaOperatorApproximateLuInverse(op, eps);
+#endif
+  throw std::invalid_argument("approximateBlockDiagonalPreconditioner(): "
+                              "diagonal blocks must be stored as "
+                              "H-matrices");
+}
+
+} // namespace
+
 template <typename ValueType>
 Preconditioner<ValueType>::Preconditioner(TeuchosPreconditionerPtr precPtr)
     : m_precPtr(precPtr) {}
@@ -89,17 +129,121 @@ Preconditioner<ValueType> discreteBlockDiagonalPreconditioner(const std::vector<
   return Preconditioner<ValueType>(precOp);
 }
 
+template <typename ValueType>
+Preconditioner<ValueType> approximateBlockDiagonalPreconditioner(
+    const std::vector<shared_ptr<const DiscreteBoundaryOperator<ValueType>>> &
+        diagonalBlocks,
+    double eps) {
+  typedef typename Preconditioner<ValueType>::DiscreteBoundaryOperatorPtr
+      DiscreteBoundaryOperatorPtr;
+
+  if (diagonalBlocks.empty())
+    throw std::runtime_error("approximateBlockDiagonalPreconditioner: "
+                             "Input array must not be empty");
+
+  // The blocks are independent, so they are factorized concurrently; each
+  // block is a task of its own since their sizes may differ widely
+  std::vector<DiscreteBoundaryOperatorPtr> inverses(diagonalBlocks.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, diagonalBlocks.size(), 1),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      inverses[i] = approximateLuInverse(diagonalBlocks[i], eps);
+  });
+  return discreteBlockDiagonalPreconditioner(inverses);
+}
+
+template <typename ValueType>
+Preconditioner<ValueType> blockGaussSeidelPreconditioner(
+    const shared_ptr<const DiscreteBlockedBoundaryOperator<ValueType>> &op,
+    double eps, bool symmetric) {
+  typedef typename Preconditioner<ValueType>::DiscreteBoundaryOperatorPtr
+      DiscreteBoundaryOperatorPtr;
+
+  if (!op || op->blockRowCount() == 0 ||
+      op->blockRowCount() != op->blockColumnCount())
+    throw std::invalid_argument("blockGaussSeidelPreconditioner(): "
+                                "op must be a non-empty square blocked "
+                                "operator");
+
+  const size_t n = op->blockRowCount();
+  std::vector<DiscreteBoundaryOperatorPtr> inverses(n);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, n, 1),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      inverses[i] = approximateLuInverse(op->getComponent(i, i), eps);
+  });
+  DiscreteBoundaryOperatorPtr sweep(
+      new DiscreteBlockGaussSeidelOperator<ValueType>(op, inverses,
+                                                      symmetric));
+  return discreteOperatorToPreconditioner(sweep);
+}
+
+template <typename ValueType>
+Preconditioner<ValueType> nearFieldSpaiPreconditioner(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op) {
+  return discreteOperatorToPreconditioner(hMatOperatorNearFieldSpai(op));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Preconditioner<ResultType> multilevelPreconditioner(
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    int operatorOrder) {
+  typedef shared_ptr<const DiscreteBoundaryOperator<ResultType>>
+      DiscreteBoundaryOperatorPtr;
+
+  if (!space)
+    throw std::invalid_argument("multilevelPreconditioner(): "
+                                "space must not be null");
+
+  // Every level contributes Q_l Q_l^T with Q_l = T_l D_l^{-1/2}
+  DiscreteBoundaryOperatorPtr result;
+  const double exponent = -0.5 * (space->grid()->dim() - operatorOrder);
+  for (int level = 0; level <= space->grid()->maxLevel(); ++level) {
+    std::vector<double> meshSizes;
+    shared_ptr<Epetra_CrsMatrix> transfer =
+        levelTransferMatrix(*space, level, &meshSizes);
+    Epetra_Vector scaling(transfer->DomainMap());
+    for (size_t i = 0; i < meshSizes.size(); ++i)
+      scaling[i] = std::pow(meshSizes[i], exponent);
+    transfer->RightScale(scaling);
+    DiscreteBoundaryOperatorPtr q(
+        new DiscreteSparseBoundaryOperator<ResultType>(transfer));
+    DiscreteBoundaryOperatorPtr qt = transpose(q);
+    DiscreteBoundaryOperatorPtr term = q * qt;
+    if (result)
+      result = result + term;
+    else
+      result = term;
+  }
+  return discreteOperatorToPreconditioner(result);
+}
+
 #define INSTANTIATE_FREE_FUNCTIONS(VALUE)                                      \
   template Preconditioner<VALUE> discreteOperatorToPreconditioner(             \
       const shared_ptr<const DiscreteBoundaryOperator<VALUE>> &                \
           discreteOperator);                                                   \
   template Preconditioner<VALUE> discreteBlockDiagonalPreconditioner(          \
       const std::vector<shared_ptr<const DiscreteBoundaryOperator<VALUE>>> &   \
-          opVector);
+          opVector);                                                           \
+  template Preconditioner<VALUE> approximateBlockDiagonalPreconditioner(       \
+      const std::vector<shared_ptr<const DiscreteBoundaryOperator<VALUE>>> &   \
+          diagonalBlocks,                                                      \
+      double eps);                                                             \
+  template Preconditioner<VALUE> blockGaussSeidelPreconditioner(               \
+      const shared_ptr<const DiscreteBlockedBoundaryOperator<VALUE>> &op,      \
+      double eps, bool symmetric);                                             \
+  template Preconditioner<VALUE> nearFieldSpaiPreconditioner(                  \
+      const shared_ptr<const DiscreteBoundaryOperator<VALUE>> &op);
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(Preconditioner);
 FIBER_ITERATE_OVER_VALUE_TYPES(INSTANTIATE_FREE_FUNCTIONS);
 
+#define INSTANTIATE_MULTILEVEL_PRECONDITIONER(BASIS, RESULT)                   \
+  template Preconditioner<RESULT> multilevelPreconditioner(                    \
+      const shared_ptr<const Space<BASIS>> &space, int operatorOrder)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(
+    INSTANTIATE_MULTILEVEL_PRECONDITIONER);
+
 } // namespace Bempp
 
 #endif // WITH_TRILINOS
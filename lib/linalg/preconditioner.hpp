@@ -39,6 +39,10 @@
 
 namespace Bempp {
 
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
 /** \ingroup linalg
  *  \brief A simple container class to hold pointers to preconditioners.
  *
@@ -72,6 +76,81 @@ template <typename ValueType>
 Preconditioner<ValueType> discreteBlockDiagonalPreconditioner(const std::vector<
     shared_ptr<const DiscreteBoundaryOperator<ValueType>>> &opVector);
 
+/** \brief Create a block-diagonal preconditioner from approximate LU
+  * inverses of the diagonal blocks of an operator.
+  *
+  * The inverses of the blocks are computed concurrently. Blocks stored as
+  * native H-matrices (DiscreteHMatBoundaryOperator) are inverted by
+  * hMatOperatorApproximateLuInverse(), blocks stored as AHMED H-matrices by
+  * acaOperatorApproximateLuInverse(). Like that of any blocked operator, the
+  * application of the preconditioner processes the blocks in parallel.
+  *
+  * \param[in] diagonalBlocks Diagonal blocks of the operator.
+  * \param[in] eps Relative accuracy of the approximate inverses.
+  */
+template <typename ValueType>
+Preconditioner<ValueType> approximateBlockDiagonalPreconditioner(
+    const std::vector<shared_ptr<const DiscreteBoundaryOperator<ValueType>>> &
+        diagonalBlocks,
+    double eps);
+
+/** \brief Create a block Gauss-Seidel preconditioner for a blocked
+  * operator, e.g. the multitrace operator of a multi-domain problem.
+  *
+  * The diagonal blocks are inverted approximately and concurrently as in
+  * approximateBlockDiagonalPreconditioner(); unlike the block-diagonal
+  * preconditioner, the application also accounts for the coupling between
+  * the subdomains through the off-diagonal blocks. See
+  * DiscreteBlockGaussSeidelOperator. The preconditioner is not symmetric
+  * unless \p symmetric is true, so it should be used with GMRES.
+  *
+  * \param[in] op Square blocked operator whose diagonal blocks are stored
+  * as H-matrices.
+  * \param[in] eps Relative accuracy of the approximate inverses.
+  * \param[in] symmetric If true, apply a forward and a backward sweep.
+  */
+template <typename ValueType>
+Preconditioner<ValueType> blockGaussSeidelPreconditioner(
+    const shared_ptr<const DiscreteBlockedBoundaryOperator<ValueType>> &op,
+    double eps, bool symmetric = false);
+
+/** \brief Create a sparse approximate inverse (SPAI) preconditioner from
+  * the near field of an operator stored as a native H-matrix.
+  *
+  * The preconditioner is built from the inadmissible leaves of the H-matrix
+  * only; see HMatNearFieldSpai. The near field must have been extracted
+  * during assembly (HMat parameter "blockSparseNearField") and the test and
+  * trial spaces of the operator must be equal.
+  *
+  * \param[in] op Operator of type DiscreteHMatBoundaryOperator.
+  */
+template <typename ValueType>
+Preconditioner<ValueType> nearFieldSpaiPreconditioner(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType>> &op);
+
+/** \brief Create an additive multilevel (BPX-type) preconditioner from the
+  * level hierarchy of a grid.
+  *
+  * The preconditioner is
+  * \f[ B = \sum_{l=0}^{L} T_l D_l^{-1} T_l^T, \f]
+  * where \f$T_l\f$ is the sparse matrix returned by levelTransferMatrix()
+  * for level \f$l\f$ of <tt>space->grid()</tt>, \f$L\f$ its maximum
+  * level, and the diagonal \f$D_l\f$ holds \f$h_{l,i}^{2 - s}\f$, the
+  * scaling of the diagonal entries of an operator of order \f$s\f$ on
+  * nodal basis functions of local mesh size \f$h_{l,i}\f$. Use \f$s = 1\f$
+  * for the hypersingular and \f$s = -1\f$ for the single-layer operator.
+  * It needs no entries of the operator, and applying it costs
+  * \f$O(N L)\f$ operations for \f$N\f$ DOFs.
+  *
+  * \param[in] space PiecewiseLinearContinuousScalarSpace on the leaf view,
+  * which must be both the domain and the dual to range of the operator.
+  * \param[in] operatorOrder Order \f$s\f$ of the operator.
+  */
+template <typename BasisFunctionType, typename ResultType>
+Preconditioner<ResultType> multilevelPreconditioner(
+    const shared_ptr<const Space<BasisFunctionType>> &space,
+    int operatorOrder);
+
 } // namespace Bempp
 
 #endif /* WITH_TRILINOS */
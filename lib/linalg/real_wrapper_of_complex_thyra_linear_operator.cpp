@@ -23,8 +23,10 @@
 
 #include "../fiber/explicit_instantiation.hpp"
 
+#include <Teuchos_ArrayRCP.hpp>
 #include <Thyra_DetachedMultiVectorView.hpp>
 #include <Thyra_DefaultSpmdVectorSpace.hpp>
+#include <Thyra_SpmdMultiVectorBase.hpp>
 #include <Thyra_VectorSpaceBase.hpp>
 
 namespace Bempp {
@@ -71,61 +73,94 @@ void RealWrapperOfComplexThyraLinearOperator<ValueType>::applyImpl(
   const Teuchos::Ordinal rowCount_X_in = X_in.range()->dim();
   assert(rowCount_X_in % 2 == 0); // each complex number has two parts
   const Teuchos::Ordinal colCount_X_in = X_in.domain()->dim();
-
-  Teuchos::ArrayRCP<const ComplexValueType> complexArray_X_in;
-  RTOpPack::ConstSubMultiVectorView<ComplexValueType> complexView_X_in;
-  Teuchos::RCP<const Thyra::MultiVectorBase<ComplexValueType>> complex_X_in;
-
-  Thyra::ConstDetachedMultiVectorView<ValueType> view_X_in(
-      Teuchos::rcpFromRef(X_in));
-  if (view_X_in.leadingDim() == rowCount_X_in) {
-    // contiguous vector
-    const ComplexValueType *complexData_X_in =
-        reinterpret_cast<const ComplexValueType *>(view_X_in.values());
-    complexArray_X_in = Teuchos::arcp(complexData_X_in, 0, // lowerOffset
-                                      (rowCount_X_in / 2) * colCount_X_in,
-                                      false);         // doesn't own
-    complexView_X_in.initialize(0,                    // globalOffset
-                                rowCount_X_in / 2, 0, // colOffset
-                                colCount_X_in, complexArray_X_in,
-                                rowCount_X_in / 2); // leadingDim
-    complex_X_in =
-        Thyra::createMembersView(m_complexOperator->domain(), complexView_X_in);
-  } else
-    throw std::runtime_error("RealWrapperOfComplexThyraLinearOperator::"
-                             "applyImpl(): discontiguous multivectors are not "
-                             "supported yet");
-
   const Teuchos::Ordinal rowCount_Y_inout = Y_inout->range()->dim();
   assert(rowCount_Y_inout % 2 == 0);
   const Teuchos::Ordinal colCount_Y_inout = Y_inout->domain()->dim();
 
+  // A real SPMD multivector with contiguous columns is reinterpreted as a
+  // complex one sharing its storage; any other multivector is copied to
+  // (and from) contiguous storage
+  Teuchos::ArrayRCP<const ComplexValueType> complexArray_X_in;
+  const Thyra::SpmdMultiVectorBase<ValueType> *spmd_X_in =
+      dynamic_cast<const Thyra::SpmdMultiVectorBase<ValueType> *>(&X_in);
+  if (spmd_X_in) {
+    Teuchos::ArrayRCP<const ValueType> values;
+    Teuchos::Ordinal leadingDim = 0;
+    spmd_X_in->getLocalData(Teuchos::outArg(values),
+                            Teuchos::outArg(leadingDim));
+    if (leadingDim == rowCount_X_in)
+      complexArray_X_in =
+          Teuchos::arcp_reinterpret_cast<const ComplexValueType>(values);
+  }
+  if (complexArray_X_in.is_null()) {
+    Thyra::ConstDetachedMultiVectorView<ValueType> view_X_in(
+        Teuchos::rcpFromRef(X_in));
+    Teuchos::ArrayRCP<ComplexValueType> copy =
+        Teuchos::arcp<ComplexValueType>((rowCount_X_in / 2) * colCount_X_in);
+    for (Teuchos::Ordinal c = 0, i = 0; c < colCount_X_in; ++c)
+      for (Teuchos::Ordinal r = 0; r < rowCount_X_in; r += 2, ++i)
+        copy[i] = ComplexValueType(view_X_in(r, c), view_X_in(r + 1, c));
+    complexArray_X_in = copy.getConst();
+  }
+  RTOpPack::ConstSubMultiVectorView<ComplexValueType> complexView_X_in(
+      0,                                // globalOffset
+      rowCount_X_in / 2, 0,             // colOffset
+      colCount_X_in, complexArray_X_in, // values
+      rowCount_X_in / 2);               // leadingDim
+  Teuchos::RCP<const Thyra::MultiVectorBase<ComplexValueType>> complex_X_in =
+      Thyra::createMembersView(m_complexOperator->domain(), complexView_X_in);
+
   Teuchos::ArrayRCP<ComplexValueType> complexArray_Y_inout;
-  RTOpPack::SubMultiVectorView<ComplexValueType> complexView_Y_inout;
-  Teuchos::RCP<Thyra::MultiVectorBase<ComplexValueType>> complex_Y_inout;
+  Thyra::SpmdMultiVectorBase<ValueType> *spmd_Y_inout =
+      dynamic_cast<Thyra::SpmdMultiVectorBase<ValueType> *>(Y_inout.get());
+  if (spmd_Y_inout) {
+    Teuchos::ArrayRCP<ValueType> values;
+    Teuchos::Ordinal leadingDim = 0;
+    spmd_Y_inout->getNonconstLocalData(Teuchos::outArg(values),
+                                       Teuchos::outArg(leadingDim));
+    if (leadingDim == rowCount_Y_inout)
+      complexArray_Y_inout =
+          Teuchos::arcp_reinterpret_cast<ComplexValueType>(values);
+  }
+  if (!complexArray_Y_inout.is_null()) {
+    RTOpPack::SubMultiVectorView<ComplexValueType> complexView_Y_inout(
+        0,                                      // globalOffset
+        rowCount_Y_inout / 2, 0,                // colOffset
+        colCount_Y_inout, complexArray_Y_inout, // values
+        rowCount_Y_inout / 2);                  // leadingDim
+    Teuchos::RCP<Thyra::MultiVectorBase<ComplexValueType>> complex_Y_inout =
+        Thyra::createMembersView(m_complexOperator->range(),
+                                 complexView_Y_inout);
+    m_complexOperator->apply(M_trans, *complex_X_in, complex_Y_inout.ptr(),
+                             alpha, beta);
+    return;
+  }
 
   Thyra::DetachedMultiVectorView<ValueType> view_Y_inout(
       Teuchos::rcpFromRef(*Y_inout));
-  if (view_Y_inout.leadingDim() == rowCount_Y_inout) {
-    // contiguous vector
-    ComplexValueType *complexData_Y_inout =
-        reinterpret_cast<ComplexValueType *>(view_Y_inout.values());
-    complexArray_Y_inout = Teuchos::arcp(
-        complexData_Y_inout, 0,                             // lowerOffset
-        (rowCount_Y_inout / 2) * colCount_Y_inout, false);  // doesn't own
-    complexView_Y_inout.initialize(0,                       // globalOffset
-                                   rowCount_Y_inout / 2, 0, // colOffset
-                                   colCount_Y_inout, complexArray_Y_inout,
-                                   rowCount_Y_inout / 2); // leadingDim
-    complex_Y_inout = Thyra::createMembersView(m_complexOperator->range(),
-                                               complexView_Y_inout);
-  } else
-    throw std::runtime_error("RealWrapperOfComplexThyraLinearOperator::"
-                             "applyImpl(): discontiguous multivectors are not "
-                             "supported yet");
-
-  return m_complexOperator->apply(M_trans, *complex_X_in, complex_Y_inout.ptr(),
-                                  alpha, beta);
+  complexArray_Y_inout =
+      Teuchos::arcp<ComplexValueType>((rowCount_Y_inout / 2) *
+                                      colCount_Y_inout);
+  for (Teuchos::Ordinal c = 0, i = 0; c < colCount_Y_inout; ++c)
+    for (Teuchos::Ordinal r = 0; r < rowCount_Y_inout; r += 2, ++i)
+      complexArray_Y_inout[i] =
+          ComplexValueType(view_Y_inout(r, c), view_Y_inout(r + 1, c));
+  RTOpPack::SubMultiVectorView<ComplexValueType> complexView_Y_inout(
+      0,                                      // globalOffset
+      rowCount_Y_inout / 2, 0,                // colOffset
+      colCount_Y_inout, complexArray_Y_inout, // values
+      rowCount_Y_inout / 2);                  // leadingDim
+  Teuchos::RCP<Thyra::MultiVectorBase<ComplexValueType>> complex_Y_inout =
+      Thyra::createMembersView(m_complexOperator->range(),
+                               complexView_Y_inout);
+  m_complexOperator->apply(M_trans, *complex_X_in, complex_Y_inout.ptr(),
+                           alpha, beta);
+  complex_Y_inout = Teuchos::null;
+  for (Teuchos::Ordinal c = 0, i = 0; c < colCount_Y_inout; ++c)
+    for (Teuchos::Ordinal r = 0; r < rowCount_Y_inout; r += 2, ++i) {
+      view_Y_inout(r, c) = complexArray_Y_inout[i].real();
+      view_Y_inout(r + 1, c) = complexArray_Y_inout[i].imag();
+    }
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT_REAL_ONLY(
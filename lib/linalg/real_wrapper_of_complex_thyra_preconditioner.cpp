@@ -27,6 +27,21 @@
 
 namespace Bempp {
 
+namespace {
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> realWrapper(
+    const Teuchos::RCP<const Thyra::LinearOpBase<std::complex<ValueType>>> &
+        complexOp) {
+  if (complexOp.is_null())
+    return Teuchos::null;
+  else
+    return Teuchos::rcp<const Thyra::LinearOpBase<ValueType>>(
+        new RealWrapperOfComplexThyraLinearOperator<ValueType>(complexOp));
+}
+
+} // namespace
+
 template <typename ValueType>
 RealWrapperOfComplexThyraPreconditioner<ValueType>::
     RealWrapperOfComplexThyraPreconditioner(
@@ -36,6 +51,12 @@ RealWrapperOfComplexThyraPreconditioner<ValueType>::
     throw std::invalid_argument("RealWrapperOfComplexThyraPreconditioner::"
                                 "RealWrapperOfComplexThyraPreconditioner(): "
                                 "argument must not be null");
+  m_leftPrecOp =
+      realWrapper<ValueType>(m_complexPreconditioner->getLeftPrecOp());
+  m_rightPrecOp =
+      realWrapper<ValueType>(m_complexPreconditioner->getRightPrecOp());
+  m_unspecifiedPrecOp =
+      realWrapper<ValueType>(m_complexPreconditioner->getUnspecifiedPrecOp());
 }
 
 template <typename ValueType>
@@ -55,13 +76,7 @@ RealWrapperOfComplexThyraPreconditioner<ValueType>::getNonconstLeftPrecOp() {
 template <typename ValueType>
 Teuchos::RCP<const Thyra::LinearOpBase<ValueType>>
 RealWrapperOfComplexThyraPreconditioner<ValueType>::getLeftPrecOp() const {
-  Teuchos::RCP<const Thyra::LinearOpBase<ComplexValueType>> complexPrecOp =
-      m_complexPreconditioner->getLeftPrecOp();
-  if (complexPrecOp.is_null())
-    return Teuchos::null;
-  else
-    return Teuchos::rcp<const Thyra::LinearOpBase<ValueType>>(
-        new RealWrapperOfComplexThyraLinearOperator<ValueType>(complexPrecOp));
+  return m_leftPrecOp;
 }
 
 template <typename ValueType>
@@ -81,13 +96,7 @@ RealWrapperOfComplexThyraPreconditioner<ValueType>::getNonconstRightPrecOp() {
 template <typename ValueType>
 Teuchos::RCP<const Thyra::LinearOpBase<ValueType>>
 RealWrapperOfComplexThyraPreconditioner<ValueType>::getRightPrecOp() const {
-  Teuchos::RCP<const Thyra::LinearOpBase<ComplexValueType>> complexPrecOp =
-      m_complexPreconditioner->getRightPrecOp();
-  if (complexPrecOp.is_null())
-    return Teuchos::null;
-  else
-    return Teuchos::rcp<const Thyra::LinearOpBase<ValueType>>(
-        new RealWrapperOfComplexThyraLinearOperator<ValueType>(complexPrecOp));
+  return m_rightPrecOp;
 }
 
 template <typename ValueType>
@@ -110,13 +119,7 @@ template <typename ValueType>
 Teuchos::RCP<const Thyra::LinearOpBase<ValueType>>
 RealWrapperOfComplexThyraPreconditioner<ValueType>::getUnspecifiedPrecOp()
     const {
-  Teuchos::RCP<const Thyra::LinearOpBase<ComplexValueType>> complexPrecOp =
-      m_complexPreconditioner->getUnspecifiedPrecOp();
-  if (complexPrecOp.is_null())
-    return Teuchos::null;
-  else
-    return Teuchos::rcp<const Thyra::LinearOpBase<ValueType>>(
-        new RealWrapperOfComplexThyraLinearOperator<ValueType>(complexPrecOp));
+  return m_unspecifiedPrecOp;
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT_REAL_ONLY(
@@ -107,6 +107,10 @@ public:
 
 private:
   Teuchos::RCP<const ComplexPreconditioner> m_complexPreconditioner;
+  // Real wrappers of the complex preconditioner operators, created once
+  Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> m_leftPrecOp;
+  Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> m_rightPrecOp;
+  Teuchos::RCP<const Thyra::LinearOpBase<ValueType>> m_unspecifiedPrecOp;
 };
 
 } // namespace Bempp
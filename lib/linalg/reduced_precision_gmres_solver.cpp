@@ -0,0 +1,432 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "reduced_precision_gmres_solver.hpp"
+
+#include "../assembly/abstract_boundary_operator.hpp"
+#include "../assembly/blocked_boundary_operator.hpp"
+#include "../assembly/boundary_operator.hpp"
+#include "../assembly/discrete_boundary_operator.hpp"
+#include "../common/to_string.hpp"
+#include "../fiber/conjugate.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <boost/variant.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <string>
+
+namespace Bempp {
+
+namespace {
+
+template <typename ValueType> struct SinglePrecision {
+  typedef ValueType Type;
+};
+template <> struct SinglePrecision<double> { typedef float Type; };
+template <> struct SinglePrecision<std::complex<double>> {
+  typedef std::complex<float> Type;
+};
+
+// Number of rows of the basis converted to the working precision at a time;
+// the converted block should stay in cache while it is used
+const size_t BASIS_ROW_BLOCK_SIZE = 2048;
+
+// Call f(first, last) for consecutive blocks of rows of a vector of n rows
+template <typename Function>
+void forEachRowBlock(size_t n, const Function &f) {
+  for (size_t first = 0; first < n; first += BASIS_ROW_BLOCK_SIZE)
+    f(first, std::min(first + BASIS_ROW_BLOCK_SIZE, n) - 1);
+}
+
+// Rows first to last of the first k basis vectors in working precision
+template <typename ValueType, typename BasisType>
+arma::Mat<ValueType> basisRows(const arma::Mat<BasisType> &basis,
+                               size_t first, size_t last, size_t k) {
+  return arma::conv_to<arma::Mat<ValueType>>::from(
+      basis.submat(first, 0, last, k - 1));
+}
+
+// Compute the Givens rotation [c s; -conj(s) c] mapping (a, b) to (r, 0)
+template <typename ValueType>
+void makeRotation(ValueType a, ValueType b,
+                  typename ScalarTraits<ValueType>::RealType &c,
+                  ValueType &s) {
+  typedef typename ScalarTraits<ValueType>::RealType MagnitudeType;
+  const MagnitudeType absA = std::abs(a);
+  const MagnitudeType absB = std::abs(b);
+  if (absB == 0) {
+    c = 1;
+    s = 0;
+  } else if (absA == 0) {
+    c = 0;
+    s = Fiber::conjugate(b) / absB;
+  } else {
+    const MagnitudeType norm = std::hypot(absA, absB);
+    c = absA / norm;
+    s = (a / absA) * Fiber::conjugate(b) / norm;
+  }
+}
+
+} // namespace
+
+/** \cond HIDDEN_INTERNAL */
+
+template <typename BasisFunctionType, typename ResultType>
+struct ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::Impl {
+  typedef typename SinglePrecision<ResultType>::Type BasisType;
+
+  template <typename BoundaryOp>
+  Impl(const BoundaryOp &op_, MagnitudeType tolerance_, int restart_,
+       int maxIterationCount_)
+      : op(op_), weakForm(op_.weakForm()), tolerance(tolerance_),
+        restart(restart_), maxIterationCount(maxIterationCount_) {
+    if (tolerance <= 0)
+      throw std::invalid_argument("ReducedPrecisionGmresSolver::"
+                                  "ReducedPrecisionGmresSolver(): "
+                                  "tolerance must be positive");
+    if (restart <= 0)
+      throw std::invalid_argument("ReducedPrecisionGmresSolver::"
+                                  "ReducedPrecisionGmresSolver(): "
+                                  "restart must be positive");
+    if (weakForm->rowCount() != weakForm->columnCount())
+      throw std::invalid_argument("ReducedPrecisionGmresSolver::"
+                                  "ReducedPrecisionGmresSolver(): "
+                                  "non-square system provided");
+  }
+
+  // y = A M x
+  void applyOperator(const arma::Col<ResultType> &x,
+                     arma::Col<ResultType> &y) const {
+    y.set_size(weakForm->rowCount());
+    if (preconditioner) {
+      arma::Col<ResultType> z(preconditioner->rowCount());
+      preconditioner->apply(NO_TRANSPOSE, x, z, 1., 0.);
+      weakForm->apply(NO_TRANSPOSE, z, y, 1., 0.);
+    } else
+      weakForm->apply(NO_TRANSPOSE, x, y, 1., 0.);
+  }
+
+  // Orthogonalise w against the first k basis vectors by classical
+  // Gram-Schmidt with one reorthogonalisation and store the coefficients
+  // in the first k entries of h
+  void orthogonalize(const arma::Mat<BasisType> &basis, size_t k,
+                     arma::Col<ResultType> &w,
+                     arma::Col<ResultType> &h) const {
+    const size_t n = w.n_rows;
+    arma::Col<ResultType> h1(k, arma::fill::zeros);
+    arma::Col<ResultType> h2(k, arma::fill::zeros);
+    forEachRowBlock(n, [&](size_t first, size_t last) {
+      h1 += basisRows<ResultType>(basis, first, last, k).t() *
+            w.rows(first, last);
+    });
+    // First update and second projection in one pass over the basis
+    forEachRowBlock(n, [&](size_t first, size_t last) {
+      const arma::Mat<ResultType> block =
+          basisRows<ResultType>(basis, first, last, k);
+      w.rows(first, last) -= block * h1;
+      h2 += block.t() * w.rows(first, last);
+    });
+    forEachRowBlock(n, [&](size_t first, size_t last) {
+      w.rows(first, last) -=
+          basisRows<ResultType>(basis, first, last, k) * h2;
+    });
+    h.head(k) = h1 + h2;
+  }
+
+  // Solve A x = b. Return the number of iterations and set relResidual to
+  // the relative residual of x. If control is not null, its checkpoint()
+  // is called before each iteration but the first.
+  int solve(const arma::Col<ResultType> &b, arma::Col<ResultType> &x,
+            MagnitudeType &relResidual, const SolveControl *control) const {
+    const size_t n = b.n_rows;
+    x.zeros(n);
+    relResidual = 0;
+    const MagnitudeType bNorm = arma::norm(b, 2);
+    if (n == 0 || bNorm == 0)
+      return 0;
+
+    const int m = restart;
+    arma::Mat<BasisType> basis(n, m + 1);
+    arma::Mat<ResultType> hessenberg(m + 1, m);
+    arma::Col<MagnitudeType> cosines(m);
+    arma::Col<ResultType> sines(m);
+    arma::Col<ResultType> g(m + 1);
+    arma::Col<ResultType> w, h;
+    arma::Col<ResultType> r = b;
+    int iteration = 0;
+    for (;;) {
+      // The residual computed in working precision decides about
+      // convergence
+      const MagnitudeType beta = arma::norm(r, 2);
+      relResidual = beta / bNorm;
+      if (relResidual <= tolerance || iteration >= maxIterationCount)
+        break;
+
+      basis.col(0) = arma::conv_to<arma::Col<BasisType>>::from(r / beta);
+      hessenberg.zeros();
+      g.zeros();
+      g(0) = beta;
+      int j = 0;
+      while (j < m && iteration < maxIterationCount) {
+        if (control && iteration > 0) {
+          SolveProgress progress;
+          progress.iteration = iteration;
+          control->checkpoint(progress);
+        }
+        applyOperator(
+            arma::conv_to<arma::Col<ResultType>>::from(basis.col(j)), w);
+        h.zeros(j + 2);
+        orthogonalize(basis, j + 1, w, h);
+        const MagnitudeType wNorm = arma::norm(w, 2);
+        h(j + 1) = wNorm;
+        if (wNorm > 0)
+          basis.col(j + 1) =
+              arma::conv_to<arma::Col<BasisType>>::from(w / wNorm);
+
+        for (int i = 0; i < j; ++i) {
+          const ResultType temp = cosines(i) * h(i) + sines(i) * h(i + 1);
+          h(i + 1) =
+              -Fiber::conjugate(sines(i)) * h(i) + cosines(i) * h(i + 1);
+          h(i) = temp;
+        }
+        makeRotation(h(j), h(j + 1), cosines(j), sines(j));
+        h(j) = cosines(j) * h(j) + sines(j) * h(j + 1);
+        h(j + 1) = 0;
+        g(j + 1) = -Fiber::conjugate(sines(j)) * g(j);
+        g(j) = cosines(j) * g(j);
+        hessenberg.submat(0, j, j + 1, j) = h;
+        ++j;
+        ++iteration;
+        if (std::abs(g(j)) <= tolerance * bNorm || wNorm == 0)
+          break;
+      }
+
+      // x += M V y, where H y = g
+      const arma::Col<ResultType> y =
+          arma::solve(arma::trimatu(hessenberg.submat(0, 0, j - 1, j - 1)),
+                      g.head(j));
+      arma::Col<ResultType> update(n);
+      forEachRowBlock(n, [&](size_t first, size_t last) {
+        update.rows(first, last) =
+            basisRows<ResultType>(basis, first, last, j) * y;
+      });
+      if (preconditioner) {
+        arma::Col<ResultType> z(n);
+        preconditioner->apply(NO_TRANSPOSE, update, z, 1., 0.);
+        x += z;
+      } else
+        x += update;
+      r = b;
+      weakForm->apply(NO_TRANSPOSE, x, r, -1., 1.);
+    }
+    return iteration;
+  }
+
+  std::vector<Solution<BasisFunctionType, ResultType>> solveNonblocked(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const SolveControl *control) const {
+    typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+    typedef GridFunction<BasisFunctionType, ResultType> GF;
+
+    const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&op);
+    if (!boundaryOp)
+      throw std::logic_error(
+          "ReducedPrecisionGmresSolver::solve(): for solvers constructed "
+          "from a BlockedBoundaryOperator the other solve() overload "
+          "must be used");
+    for (size_t i = 0; i < rhs.size(); ++i)
+      Solver<BasisFunctionType, ResultType>::checkConsistency(
+          *boundaryOp, rhs[i],
+          ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+
+    std::vector<Solution<BasisFunctionType, ResultType>> solutions;
+    solutions.reserve(rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i) {
+      arma::Col<ResultType> armaSolution;
+      MagnitudeType relResidual;
+      const int iterationCount =
+          solve(rhs[i].projections(boundaryOp->dualToRange()), armaSolution,
+                relResidual, control);
+      solutions.push_back(makeSolution(
+          GF(boundaryOp->context(), boundaryOp->domain(), armaSolution),
+          iterationCount, relResidual));
+    }
+    return solutions;
+  }
+
+  BlockedSolution<BasisFunctionType, ResultType> solveBlocked(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const SolveControl *control) const {
+    typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
+
+    const BoundaryOp *boundaryOp = boost::get<BoundaryOp>(&op);
+    if (!boundaryOp)
+      throw std::logic_error(
+          "ReducedPrecisionGmresSolver::solve(): for solvers constructed "
+          "from a (non-blocked) BoundaryOperator the other solve() "
+          "overload must be used");
+    std::vector<GridFunction<BasisFunctionType, ResultType>> canonicalRhs =
+        Solver<BasisFunctionType, ResultType>::canonicalizeBlockedRhs(
+            *boundaryOp, rhs,
+            ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+    Solver<BasisFunctionType, ResultType>::checkConsistency(
+        *boundaryOp, canonicalRhs,
+        ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+
+    arma::Col<ResultType> armaRhs(
+        boundaryOp->totalGlobalDofCountInDualsToRanges());
+    for (size_t i = 0, start = 0; i < canonicalRhs.size(); ++i) {
+      const arma::Col<ResultType> &chunkProjections =
+          canonicalRhs[i].projections(boundaryOp->dualToRange(i));
+      size_t chunkSize = chunkProjections.n_rows;
+      armaRhs.rows(start, start + chunkSize - 1) = chunkProjections;
+      start += chunkSize;
+    }
+
+    arma::Col<ResultType> armaSolution;
+    MagnitudeType relResidual;
+    const int iterationCount =
+        solve(armaRhs, armaSolution, relResidual, control);
+
+    std::vector<GridFunction<BasisFunctionType, ResultType>> solutionFunctions;
+    Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
+        armaSolution, *boundaryOp, solutionFunctions);
+    return BlockedSolution<BasisFunctionType, ResultType>(
+        solutionFunctions, status(relResidual), relResidual,
+        message(iterationCount, relResidual));
+  }
+
+  SolutionStatus::Status status(MagnitudeType relResidual) const {
+    return relResidual <= tolerance ? SolutionStatus::CONVERGED
+                                    : SolutionStatus::UNCONVERGED;
+  }
+
+  Solution<BasisFunctionType, ResultType>
+  makeSolution(const GridFunction<BasisFunctionType, ResultType> &function,
+               int iterationCount, MagnitudeType relResidual) const {
+    return Solution<BasisFunctionType, ResultType>(
+        function, status(relResidual), relResidual,
+        message(iterationCount, relResidual));
+  }
+
+  std::string message(int iterationCount, MagnitudeType relResidual) const {
+    return std::string(relResidual <= tolerance ? "Solver converged"
+                                                : "Solver did not converge") +
+           " after " + toString(iterationCount) + " iteration(s)";
+  }
+
+  boost::variant<BoundaryOperator<BasisFunctionType, ResultType>,
+                 BlockedBoundaryOperator<BasisFunctionType, ResultType>> op;
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> weakForm;
+  shared_ptr<const DiscreteBoundaryOperator<ResultType>> preconditioner;
+  MagnitudeType tolerance;
+  int restart;
+  int maxIterationCount;
+};
+
+/** \endcond */
+
+template <typename BasisFunctionType, typename ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    ReducedPrecisionGmresSolver(
+        const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+        MagnitudeType tolerance, int restart, int maxIterationCount)
+    : m_impl(new Impl(boundaryOp, tolerance, restart, maxIterationCount)) {}
+
+template <typename BasisFunctionType, typename ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    ReducedPrecisionGmresSolver(
+        const BlockedBoundaryOperator<BasisFunctionType, ResultType> &
+            boundaryOp,
+        MagnitudeType tolerance, int restart, int maxIterationCount)
+    : m_impl(new Impl(boundaryOp, tolerance, restart, maxIterationCount)) {}
+
+template <typename BasisFunctionType, typename ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType,
+                            ResultType>::~ReducedPrecisionGmresSolver() {}
+
+template <typename BasisFunctionType, typename ResultType>
+void ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    setPreconditioner(
+        const shared_ptr<const DiscreteBoundaryOperator<ResultType>> &
+            preconditioner) {
+  if (preconditioner &&
+      (preconditioner->rowCount() != m_impl->weakForm->columnCount() ||
+       preconditioner->columnCount() != m_impl->weakForm->rowCount()))
+    throw std::invalid_argument("ReducedPrecisionGmresSolver::"
+                                "setPreconditioner(): preconditioner has "
+                                "wrong dimensions");
+  m_impl->preconditioner = preconditioner;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Solution<BasisFunctionType, ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    solveImplNonblocked(
+        const GridFunction<BasisFunctionType, ResultType> &rhs) const {
+  return m_impl->solveNonblocked(
+      std::vector<GridFunction<BasisFunctionType, ResultType>>(1, rhs),
+      0)[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType>>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    solveImplNonblockedMultipleRhs(
+        const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+        const {
+  return m_impl->solveNonblocked(rhs, 0);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::solveImplBlocked(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs) const {
+  return m_impl->solveBlocked(rhs, 0);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Solution<BasisFunctionType, ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    solveImplNonblockedWithControl(
+        const GridFunction<BasisFunctionType, ResultType> &rhs,
+        const SolveControl &control) const {
+  return m_impl->solveNonblocked(
+      std::vector<GridFunction<BasisFunctionType, ResultType>>(1, rhs),
+      &control)[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+ReducedPrecisionGmresSolver<BasisFunctionType, ResultType>::
+    solveImplBlockedWithControl(
+        const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+        const SolveControl &control) const {
+  return m_impl->solveBlocked(rhs, &control);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
+    ReducedPrecisionGmresSolver);
+
+} // namespace Bempp
@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_reduced_precision_gmres_solver_hpp
+#define bempp_reduced_precision_gmres_solver_hpp
+
+#include "solver.hpp"
+
+#include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <boost/scoped_ptr.hpp>
+
+namespace Bempp {
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteBoundaryOperator;
+/** \endcond */
+
+/** \ingroup linalg
+  * \brief Restarted GMRES storing its Krylov basis in single precision.
+  *
+  * With long restart cycles on large problems the Krylov basis dominates
+  * the memory of GMRES, and the orthogonalisation of each new vector
+  * against it is limited by memory bandwidth. This solver stores the basis
+  * vectors, which have unit norm, rounded to single precision, halving
+  * their memory and the traffic of the orthogonalisation. All arithmetic
+  * is done in the working precision: the basis is converted back block of
+  * rows by block of rows while it is read. Each vector is orthogonalised
+  * by classical Gram-Schmidt with one reorthogonalisation, whose second
+  * projection is fused with the first update, so the basis is read three
+  * times per iteration.
+  *
+  * The rounding of the basis only perturbs the Arnoldi relation at the
+  * level of single precision. The residual is therefore recomputed in the
+  * working precision at the end of every restart cycle, and decides about
+  * convergence; like iterative refinement, the restarts then reach
+  * tolerances well below single precision.
+  *
+  * The solver is right-preconditioned, so the residual tested is that of
+  * the original system. Convergence is tested in the dual space to the
+  * range. Multiple right-hand sides are solved one after the other.
+  *
+  * For <tt>ResultType</tt> equal to <tt>float</tt> or
+  * <tt>complex<float></tt> the basis is stored in working precision.
+  */
+template <typename BasisFunctionType, typename ResultType>
+class ReducedPrecisionGmresSolver
+    : public Solver<BasisFunctionType, ResultType> {
+public:
+  typedef Solver<BasisFunctionType, ResultType> Base;
+  typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
+
+  /** \brief Construct a solver for a non-blocked boundary operator.
+    *
+    * \param[in] boundaryOp
+    *   Non-blocked boundary operator.
+    * \param[in] tolerance
+    *   Relative residual to be reached.
+    * \param[in] restart
+    *   Number of iterations of a restart cycle, i.e. number of stored
+    *   basis vectors.
+    * \param[in] maxIterationCount
+    *   Maximum total number of iterations.
+    */
+  ReducedPrecisionGmresSolver(
+      const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+      MagnitudeType tolerance = 1e-5, int restart = 200,
+      int maxIterationCount = 1000);
+  /** \brief Construct a solver for a blocked boundary operator.
+    *
+    * See the other constructor for the description of the parameters.
+    */
+  ReducedPrecisionGmresSolver(
+      const BlockedBoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
+      MagnitudeType tolerance = 1e-5, int restart = 200,
+      int maxIterationCount = 1000);
+  ~ReducedPrecisionGmresSolver();
+
+  /** \brief Set a right preconditioner, i.e. an approximate inverse of the
+    * weak form, or remove it if \p preconditioner is null. */
+  void setPreconditioner(
+      const shared_ptr<const DiscreteBoundaryOperator<ResultType>> &
+          preconditioner);
+
+private:
+  virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
+      const GridFunction<BasisFunctionType, ResultType> &rhs) const;
+  virtual BlockedSolution<BasisFunctionType, ResultType> solveImplBlocked(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
+  virtual std::vector<Solution<BasisFunctionType, ResultType>>
+  solveImplNonblockedMultipleRhs(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
+  virtual Solution<BasisFunctionType, ResultType>
+  solveImplNonblockedWithControl(
+      const GridFunction<BasisFunctionType, ResultType> &rhs,
+      const SolveControl &control) const;
+  virtual BlockedSolution<BasisFunctionType, ResultType>
+  solveImplBlockedWithControl(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const SolveControl &control) const;
+
+private:
+  struct Impl;
+  boost::scoped_ptr<Impl> m_impl;
+};
+
+} // namespace Bempp
+
+#endif
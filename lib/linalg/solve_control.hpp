@@ -0,0 +1,99 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_solve_control_hpp
+#define bempp_solve_control_hpp
+
+#include "../common/common.hpp"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tbb/atomic.h>
+
+namespace Bempp {
+
+/** \ingroup linalg
+ *  \brief Exception thrown by a solve cancelled with SolveControl::cancel().
+ */
+class SolveCancelledError : public std::runtime_error {
+public:
+  explicit SolveCancelledError(const std::string &msg)
+      : std::runtime_error(msg) {}
+};
+
+/** \ingroup linalg
+ *  \brief Progress of a solve, passed to the callback of a SolveControl. */
+struct SolveProgress {
+  SolveProgress() : iteration(0), fraction(-1) {}
+
+  // Number of completed iterations of an iterative solver, 0 for direct
+  // solvers
+  int iteration;
+  // Completed fraction of the work of a direct solver, -1 if unknown
+  double fraction;
+};
+
+/** \ingroup linalg
+ *  \brief Cooperative cancellation and progress reporting of a solve.
+
+  A SolveControl is passed to Solver::solveAsync(). The solver calls
+  checkpoint() between iterations (iterative solvers) or between panels of
+  the factorization (direct solvers); cancel() may be called from any thread
+  and makes the next checkpoint throw SolveCancelledError, which is then
+  stored in the future returned by solveAsync(). */
+class SolveControl {
+public:
+  typedef std::function<void(const SolveProgress &)> ProgressCallback;
+
+  /** \brief Constructor.
+
+    \param[in] callback
+      If not empty, called at each checkpoint. It is called from the thread
+      running the solve, and should return quickly. */
+  explicit SolveControl(const ProgressCallback &callback = ProgressCallback())
+      : m_callback(callback) {
+    m_cancelled = false;
+  }
+
+  /** \brief Request cancellation of the solve. */
+  void cancel() { m_cancelled = true; }
+
+  /** \brief Return true if cancel() has been called. */
+  bool isCancelled() const { return m_cancelled; }
+
+  /** \brief Report \p progress and throw SolveCancelledError if the solve
+   *  has been cancelled. */
+  void checkpoint(const SolveProgress &progress) const {
+    if (m_cancelled)
+      throw SolveCancelledError("SolveControl::checkpoint(): "
+                                "solve cancelled");
+    if (m_callback)
+      m_callback(progress);
+  }
+
+private:
+  tbb::atomic<bool> m_cancelled;
+  ProgressCallback m_callback;
+};
+
+} // namespace Bempp
+
+#endif
@@ -21,17 +21,106 @@
 #include "solver.hpp"
 
 #include "../assembly/grid_function.hpp"
+#include "../assembly/multi_grid_function.hpp"
 #include "../assembly/boundary_operator.hpp"
 #include "../assembly/blocked_boundary_operator.hpp"
 #include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/task_arena_cache.hpp"
 #include "../space/space.hpp"
 
+#include <boost/make_shared.hpp>
+
 namespace Bempp {
 
 template <typename BasisFunctionType, typename ResultType>
 Solver<BasisFunctionType, ResultType>::~Solver() {}
 
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType>>
+Solver<BasisFunctionType, ResultType>::solveImplNonblockedMultipleRhs(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+    const {
+  std::vector<Solution<BasisFunctionType, ResultType>> solutions;
+  solutions.reserve(rhs.size());
+  for (size_t i = 0; i < rhs.size(); ++i)
+    solutions.push_back(solveImplNonblocked(rhs[i]));
+  return solutions;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType>>
+Solver<BasisFunctionType, ResultType>::solveMultipleRhs(
+    const MultiGridFunction<BasisFunctionType, ResultType> &rhs) const {
+  if (!rhs.isInitialized())
+    throw std::invalid_argument("Solver::solveMultipleRhs(): "
+                                "rhs must be initialized");
+  return solveImplNonblockedMultipleRhs(rhs.columns());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::future<Solution<BasisFunctionType, ResultType>>
+Solver<BasisFunctionType, ResultType>::solveAsync(
+    const GridFunction<BasisFunctionType, ResultType> &rhs,
+    const shared_ptr<const SolveControl> &control) const {
+  typedef Solution<BasisFunctionType, ResultType> Sol;
+  // The promise is shared, since TBB copies the enqueued functor
+  shared_ptr<std::promise<Sol>> promise =
+      boost::make_shared<std::promise<Sol>>();
+  shared_ptr<const SolveControl> actualControl =
+      control ? control : boost::make_shared<SolveControl>();
+  const Solver *self = this;
+  Fiber::enqueueInTaskArena([self, rhs, actualControl, promise]() {
+    try {
+      promise->set_value(
+          self->solveImplNonblockedWithControl(rhs, *actualControl));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return promise->get_future();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::future<BlockedSolution<BasisFunctionType, ResultType>>
+Solver<BasisFunctionType, ResultType>::solveAsync(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+    const shared_ptr<const SolveControl> &control) const {
+  typedef BlockedSolution<BasisFunctionType, ResultType> Sol;
+  shared_ptr<std::promise<Sol>> promise =
+      boost::make_shared<std::promise<Sol>>();
+  shared_ptr<const SolveControl> actualControl =
+      control ? control : boost::make_shared<SolveControl>();
+  const Solver *self = this;
+  Fiber::enqueueInTaskArena([self, rhs, actualControl, promise]() {
+    try {
+      promise->set_value(
+          self->solveImplBlockedWithControl(rhs, *actualControl));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return promise->get_future();
+}
+
+template <typename BasisFunctionType, typename ResultType>
+Solution<BasisFunctionType, ResultType>
+Solver<BasisFunctionType, ResultType>::solveImplNonblockedWithControl(
+    const GridFunction<BasisFunctionType, ResultType> &rhs,
+    const SolveControl &control) const {
+  control.checkpoint(SolveProgress());
+  return solveImplNonblocked(rhs);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+Solver<BasisFunctionType, ResultType>::solveImplBlockedWithControl(
+    const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+    const SolveControl &control) const {
+  control.checkpoint(SolveProgress());
+  return solveImplBlocked(rhs);
+}
+
 template <typename BasisFunctionType, typename ResultType>
 void Solver<BasisFunctionType, ResultType>::checkConsistency(
     const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
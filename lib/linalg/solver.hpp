@@ -23,9 +23,12 @@
 
 #include "../common/common.hpp"
 
+#include "../common/shared_ptr.hpp"
 #include "solution.hpp"
 #include "blocked_solution.hpp"
+#include "solve_control.hpp"
 
+#include <future>
 #include <vector>
 
 namespace Bempp {
@@ -36,6 +39,8 @@ class BoundaryOperator;
 template <typename BasisFunctionType, typename ResultType>
 class BlockedBoundaryOperator;
 template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType, typename ResultType>
+class MultiGridFunction;
 /** \endcond */
 
 struct ConvergenceTestMode {
@@ -92,6 +97,72 @@ public:
     return solveImplBlocked(rhs);
   }
 
+  /** \brief Solve a standard (non-blocked) boundary integral equation for
+    * several right-hand sides.
+    *
+    * The default implementation calls solve() for each element of \p rhs.
+    * Iterative solvers override it to solve for all right-hand sides at
+    * once, applying the operator to the whole block of vectors in each
+    * iteration.
+    *
+    * \param[in] rhs
+    *   <tt>vector</tt> of GridFunction objects representing the right-hand
+    *   sides of the boundary integral equation.
+    *
+    * \return A <tt>vector</tt> of new Solution objects, one for each
+    * right-hand side.
+    */
+  std::vector<Solution<BasisFunctionType, ResultType>> solveMultipleRhs(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const {
+    return solveImplNonblockedMultipleRhs(rhs);
+  }
+
+  /** \brief Solve a standard (non-blocked) boundary integral equation for
+    * all the right-hand sides stored in \p rhs.
+    *
+    * Equivalent to <tt>solveMultipleRhs(rhs.columns())</tt>. The i'th
+    * returned Solution corresponds to the i'th column of \p rhs; the
+    * solutions can be gathered back into a MultiGridFunction with its
+    * constructor taking a vector of grid functions. */
+  std::vector<Solution<BasisFunctionType, ResultType>> solveMultipleRhs(
+      const MultiGridFunction<BasisFunctionType, ResultType> &rhs) const;
+
+  /** \brief Start solving a standard (non-blocked) boundary integral
+    * equation and return immediately.
+    *
+    * The solve runs as a task on the worker threads of the library (see
+    * Fiber::asyncTaskArena()), so that concurrent solves share the cores
+    * instead of oversubscribing them. If the solve throws, e.g. because it
+    * was cancelled through \p control, the exception is rethrown by
+    * <tt>get()</tt> of the returned future.
+    *
+    * The solver must stay alive, and must not be used for other solves,
+    * until the future is ready.
+    *
+    * \param[in] rhs
+    *   GridFunction representing the right-hand side function of the boundary
+    *   integral equation.
+    * \param[in] control
+    *   Optional object used to cancel the solve and receive progress
+    *   reports.
+    */
+  std::future<Solution<BasisFunctionType, ResultType>>
+  solveAsync(const GridFunction<BasisFunctionType, ResultType> &rhs,
+             const shared_ptr<const SolveControl> &control =
+                 shared_ptr<const SolveControl>()) const;
+
+  /** \brief Start solving a block-operator system of boundary integral
+    * equations and return immediately.
+    *
+    * See the other overload for details.
+    */
+  std::future<BlockedSolution<BasisFunctionType, ResultType>>
+  solveAsync(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const shared_ptr<const SolveControl> &control =
+          shared_ptr<const SolveControl>()) const;
+
 protected:
   static void checkConsistency(
       const BoundaryOperator<BasisFunctionType, ResultType> &boundaryOp,
@@ -119,6 +190,22 @@ private:
   virtual BlockedSolution<BasisFunctionType, ResultType> solveImplBlocked(
       const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
       const = 0;
+  virtual std::vector<Solution<BasisFunctionType, ResultType>>
+  solveImplNonblockedMultipleRhs(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs)
+      const;
+  /** \brief Solve, calling control.checkpoint() regularly.
+    *
+    * Used by solveAsync(). The default implementation only checks for
+    * cancellation before calling solveImplNonblocked(). */
+  virtual Solution<BasisFunctionType, ResultType>
+  solveImplNonblockedWithControl(
+      const GridFunction<BasisFunctionType, ResultType> &rhs,
+      const SolveControl &control) const;
+  virtual BlockedSolution<BasisFunctionType, ResultType>
+  solveImplBlockedWithControl(
+      const std::vector<GridFunction<BasisFunctionType, ResultType>> &rhs,
+      const SolveControl &control) const;
 };
 
 } // namespace Bempp
@@ -0,0 +1,137 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_solver_statistics_hpp
+#define bempp_solver_statistics_hpp
+
+#include "../common/common.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+namespace Bempp {
+
+/** \ingroup linalg
+ *  \brief Measurements taken during one iteration of an iterative solver.
+ *
+ *  Iterations are delimited by applications of the system operator: the
+ *  k'th record covers the time from the k'th operator application (from the
+ *  start of the solve for k = 1) to the next one (or to the end of the
+ *  solve). All times are wall-clock times in seconds. Applications to
+ *  multivectors count once per column. */
+struct SolverIterationStatistics {
+  int iteration;
+  double time;
+  double operatorTime;
+  double preconditionerTime;
+  std::size_t operatorApplyCount;
+  std::size_t preconditionerApplyCount;
+  // Relative residual reported by the solver at the end of the iteration,
+  // -1 if unknown. Belos only reports it at the end of the solve, so it is
+  // only set in the last record.
+  double residual;
+
+  // Time spent neither in the operator nor in the preconditioner, i.e. in
+  // orthogonalisation and other work of the solver itself
+  double otherTime() const {
+    const double other = time - operatorTime - preconditionerTime;
+    return other > 0 ? other : 0;
+  }
+};
+
+/** \ingroup linalg
+ *  \brief Function called by an iterative solver after each iteration. */
+typedef std::function<void(const SolverIterationStatistics &)>
+    SolverIterationCallback;
+
+/** \ingroup linalg
+ *  \brief Timings, operator application counts and residual history of a
+ *  solve.
+ *
+ *  Returned by DefaultIterativeSolver::statistics() if statistics
+ *  collection was enabled with DefaultIterativeSolver::collectStatistics().
+ */
+struct SolverStatistics {
+  SolverStatistics()
+      : time(0), operatorTime(0), preconditionerTime(0),
+        operatorApplyCount(0), preconditionerApplyCount(0), residual(-1) {}
+
+  std::vector<SolverIterationStatistics> iterations;
+
+  double time;
+  double operatorTime;
+  double preconditionerTime;
+  std::size_t operatorApplyCount;
+  std::size_t preconditionerApplyCount;
+  double residual; // achieved relative residual, -1 if unknown
+
+  double otherTime() const {
+    const double other = time - operatorTime - preconditionerTime;
+    return other > 0 ? other : 0;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const SolverStatistics &statistics) {
+  os << "Solve: " << statistics.iterations.size() << " iterations, "
+     << statistics.operatorApplyCount << " operator and "
+     << statistics.preconditionerApplyCount
+     << " preconditioner applications, time: " << statistics.time
+     << " s (operator: " << statistics.operatorTime
+     << " s, preconditioner: " << statistics.preconditionerTime
+     << " s, other: " << statistics.otherTime() << " s)";
+  if (statistics.residual >= 0)
+    os << ", residual: " << statistics.residual;
+  return os;
+}
+
+/** \brief Write the statistics as a JSON object. */
+inline void writeJson(std::ostream &os, const SolverStatistics &statistics) {
+  os << "{\n"
+     << "  \"iterationCount\": " << statistics.iterations.size() << ",\n"
+     << "  \"time\": " << statistics.time << ",\n"
+     << "  \"operatorTime\": " << statistics.operatorTime << ",\n"
+     << "  \"preconditionerTime\": " << statistics.preconditionerTime
+     << ",\n"
+     << "  \"otherTime\": " << statistics.otherTime() << ",\n"
+     << "  \"operatorApplyCount\": " << statistics.operatorApplyCount << ",\n"
+     << "  \"preconditionerApplyCount\": "
+     << statistics.preconditionerApplyCount << ",\n"
+     << "  \"residual\": " << statistics.residual << ",\n";
+
+  os << "  \"iterations\": [";
+  for (std::size_t i = 0; i < statistics.iterations.size(); ++i) {
+    const SolverIterationStatistics &it = statistics.iterations[i];
+    os << (i > 0 ? "," : "") << "\n    {\"iteration\": " << it.iteration
+       << ", \"time\": " << it.time << ", \"operatorTime\": "
+       << it.operatorTime << ", \"preconditionerTime\": "
+       << it.preconditionerTime << ", \"otherTime\": " << it.otherTime()
+       << ", \"operatorApplyCount\": " << it.operatorApplyCount
+       << ", \"preconditionerApplyCount\": " << it.preconditionerApplyCount
+       << ", \"residual\": " << it.residual << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,125 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_compressed_dof_table_hpp
+#define bempp_compressed_dof_table_hpp
+
+#include "../common/common.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <tbb/parallel_for.h>
+
+namespace Bempp {
+
+/** \ingroup space
+ *  \brief Table of rows of varying length stored in compressed-row form.
+ *
+ *  All rows are kept in a single contiguous array and located by 32-bit
+ *  offsets. For tables with many short rows, such as the local-to-global
+ *  and global-to-local DOF maps of high-order spaces, this needs much less
+ *  memory than <tt>std::vector<std::vector<T>></tt> and avoids one heap
+ *  allocation per row.
+ *
+ *  The read interface mirrors that of <tt>std::vector<std::vector<T>></tt>:
+ *  <tt>table[i]</tt> returns a lightweight view of the <em>i</em>th row
+ *  providing size(), operator[], begin() and end(). */
+template <typename T> class CompressedDofTable {
+public:
+  typedef unsigned int OffsetType;
+
+  /** \brief View of a single row of a CompressedDofTable. */
+  class Row {
+  public:
+    Row(const T *begin, const T *end) : m_begin(begin), m_end(end) {}
+
+    size_t size() const { return m_end - m_begin; }
+    bool empty() const { return m_begin == m_end; }
+    const T &operator[](size_t i) const {
+      assert(i < size());
+      return m_begin[i];
+    }
+    const T *begin() const { return m_begin; }
+    const T *end() const { return m_end; }
+
+  private:
+    const T *m_begin;
+    const T *m_end;
+  };
+
+  /** \brief Construct an empty table. */
+  CompressedDofTable() : m_offsets(1, 0) {}
+
+  /** \brief Construct a table with the same rows as \p rows.
+   *
+   *  The rows are copied in parallel. An exception is thrown if the total
+   *  number of values does not fit into OffsetType. */
+  explicit CompressedDofTable(const std::vector<std::vector<T>> &rows)
+      : m_offsets(rows.size() + 1) {
+    size_t valueCount = 0;
+    m_offsets[0] = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      valueCount += rows[i].size();
+      if (valueCount > std::numeric_limits<OffsetType>::max())
+        throw std::length_error("CompressedDofTable::CompressedDofTable(): "
+                                "too many values for 32-bit offsets");
+      m_offsets[i + 1] = valueCount;
+    }
+    m_values.resize(valueCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, rows.size()),
+                      [&](const tbb::blocked_range<size_t> &r) {
+      for (size_t i = r.begin(); i != r.end(); ++i)
+        std::copy(rows[i].begin(), rows[i].end(),
+                  m_values.begin() + m_offsets[i]);
+    });
+  }
+
+  /** \brief Number of rows. */
+  size_t size() const { return m_offsets.size() - 1; }
+
+  /** \brief Total number of values in all rows. */
+  size_t valueCount() const { return m_values.size(); }
+
+  /** \brief View of the <em>i</em>th row. */
+  Row operator[](size_t i) const {
+    assert(i < size());
+    return Row(m_values.data() + m_offsets[i],
+               m_values.data() + m_offsets[i + 1]);
+  }
+
+  /** \brief Copy the <em>i</em>th row into \p row. */
+  void getRow(size_t i, std::vector<T> &row) const {
+    Row r = (*this)[i];
+    row.assign(r.begin(), r.end());
+  }
+
+private:
+  std::vector<OffsetType> m_offsets;
+  std::vector<T> m_values;
+};
+
+} // namespace Bempp
+
+#endif
@@ -28,7 +28,12 @@ namespace Bempp {
 enum DofAssignmentMode {
   EDGE_ON_SEGMENT = 1,
   ELEMENT_ON_SEGMENT = 2,
-  REFERENCE_POINT_ON_SEGMENT = 4
+  REFERENCE_POINT_ON_SEGMENT = 4,
+  /** \brief Number the global DOFs along a space-filling (Morton) curve
+   *  through their reference positions instead of in the order of the grid
+   *  index set, so that DOFs with neighbouring indices lie close to each
+   *  other. */
+  SPACE_FILLING_CURVE_ORDER = 8
 };
 
 } // namespace Bempp
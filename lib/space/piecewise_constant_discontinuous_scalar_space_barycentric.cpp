@@ -268,24 +268,16 @@ template <typename BasisFunctionType>
 void PiecewiseConstantDiscontinuousScalarSpaceBarycentric<BasisFunctionType>::
     getGlobalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
 void PiecewiseConstantDiscontinuousScalarSpaceBarycentric<BasisFunctionType>::
     getFlatLocalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getFlatLocalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->flatLocalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
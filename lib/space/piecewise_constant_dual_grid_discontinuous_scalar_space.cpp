@@ -224,24 +224,16 @@ template <typename BasisFunctionType>
 void PiecewiseConstantDualGridDiscontinuousScalarSpace<BasisFunctionType>::
     getGlobalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
 void PiecewiseConstantDualGridDiscontinuousScalarSpace<BasisFunctionType>::
     getFlatLocalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getFlatLocalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->flatLocalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
@@ -257,47 +249,9 @@ template <typename BasisFunctionType>
 void PiecewiseConstantDualGridDiscontinuousScalarSpace<BasisFunctionType>::
     getFlatLocalDofBoundingBoxes(
         std::vector<BoundingBox<CoordinateType>> &bboxes) const {
-  // TODO: extract this loop into a private function
-  const IndexSet &indexSet = this->gridView().indexSet();
-  const int elementCount = this->gridView().entityCount(0);
-
-  std::vector<arma::Mat<CoordinateType>> elementCorners(elementCount);
-  std::unique_ptr<EntityIterator<0>> it =
-      this->gridView().template entityIterator<0>();
-  while (!it->finished()) {
-    const Entity<0> &e = it->entity();
-    int index = indexSet.entityIndex(e);
-    const Geometry &geo = e.geometry();
-    geo.getCorners(acc(elementCorners, index));
-    it->next();
-  }
-
-  BoundingBox<CoordinateType> model;
-  const CoordinateType maxCoord = std::numeric_limits<CoordinateType>::max();
-  model.lbound.x = model.lbound.y = model.lbound.z = maxCoord;
-  model.ubound.x = model.ubound.y = model.ubound.z = -maxCoord;
-
-  const int flatLocalDofCount_ = m_flatLocal2localDofs.size();
-  bboxes.resize(flatLocalDofCount_, model);
-  for (int i = 0; i < flatLocalDofCount_; ++i) {
-    const LocalDof &localDof = acc(m_flatLocal2localDofs, i);
-    BoundingBox<CoordinateType> &bbox = acc(bboxes, i);
-    extendBoundingBox(bbox, acc(elementCorners, localDof.entityIndex));
-    setBoundingBoxReference<CoordinateType>(
-        bbox, acc(elementCorners, localDof.entityIndex).col(localDof.dofIndex));
-  }
-
-#ifndef NDEBUG
-  const int globalDofCount_ = globalDofCount();
-  for (size_t i = 0; i < globalDofCount_; ++i) {
-    assert(bboxes[i].reference.x >= bboxes[i].lbound.x);
-    assert(bboxes[i].reference.y >= bboxes[i].lbound.y);
-    assert(bboxes[i].reference.z >= bboxes[i].lbound.z);
-    assert(bboxes[i].reference.x <= bboxes[i].ubound.x);
-    assert(bboxes[i].reference.y <= bboxes[i].ubound.y);
-    assert(bboxes[i].reference.z <= bboxes[i].ubound.z);
-  }
-#endif // NDEBUG
+  SpaceHelper<BasisFunctionType>::
+      getFlatLocalDofBoundingBoxes_defaultImplementation(
+          this->gridView(), m_flatLocal2localDofs, bboxes);
 }
 
 template <typename BasisFunctionType>
@@ -29,10 +29,10 @@
 #include "../common/types.hpp"
 #include "../fiber/constant_scalar_shapeset.hpp"
 #include "../common/shared_ptr.hpp"
+#include "../common/lazy.hpp"
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -138,8 +138,7 @@ private:
   std::vector<LocalDof> m_flatLocal2localDofs;
   Fiber::ConstantScalarShapeset<BasisFunctionType> m_basis;
   shared_ptr<const Grid> m_originalGrid;
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
   /** \endcond */
 };
 
@@ -36,21 +36,28 @@
 #include "../grid/mapper.hpp"
 #include "../grid/vtk_writer.hpp"
 
+#include <stdexcept>
+
 namespace Bempp {
 
 template <typename BasisFunctionType>
 PiecewiseConstantScalarSpace<BasisFunctionType>::PiecewiseConstantScalarSpace(
     const shared_ptr<const Grid> &grid)
     : ScalarSpace<BasisFunctionType>(grid), m_view(grid->leafView()),
-      m_segment(GridSegment::wholeGrid(*grid)) {
+      m_segment(GridSegment::wholeGrid(*grid)), m_dofMode(0) {
   assignDofsImpl(m_segment);
 }
 
 template <typename BasisFunctionType>
 PiecewiseConstantScalarSpace<BasisFunctionType>::PiecewiseConstantScalarSpace(
-    const shared_ptr<const Grid> &grid, const GridSegment &segment)
+    const shared_ptr<const Grid> &grid, const GridSegment &segment,
+    int dofMode)
     : ScalarSpace<BasisFunctionType>(grid), m_view(grid->leafView()),
-      m_segment(segment) {
+      m_segment(segment), m_dofMode(dofMode) {
+  if (dofMode & ~SPACE_FILLING_CURVE_ORDER)
+    throw std::invalid_argument("PiecewiseConstantScalarSpace::"
+                                "PiecewiseConstantScalarSpace(): "
+                                "invalid dofMode");
   assignDofsImpl(m_segment);
 }
 
@@ -104,9 +111,17 @@ bool PiecewiseConstantScalarSpace<BasisFunctionType>::spaceIsCompatible(
     const Space<BasisFunctionType> &other) const {
 
   if (other.grid().get() == this->grid().get()) {
-    return (other.spaceIdentifier() == this->spaceIdentifier());
+    if (other.spaceIdentifier() != this->spaceIdentifier())
+      return false;
+    // Spaces with differently ordered global DOFs are not interchangeable
+    const PiecewiseConstantScalarSpace *otherSpace =
+        dynamic_cast<const PiecewiseConstantScalarSpace *>(&other);
+    return !otherSpace ||
+           (otherSpace->m_dofMode & SPACE_FILLING_CURVE_ORDER) ==
+               (m_dofMode & SPACE_FILLING_CURVE_ORDER);
   } else {
-    if (other.spaceIdentifier() == PIECEWISE_CONSTANT_SCALAR_BARYCENTRIC) {
+    if (other.spaceIdentifier() == PIECEWISE_CONSTANT_SCALAR_BARYCENTRIC &&
+        !(m_dofMode & SPACE_FILLING_CURVE_ORDER)) {
       // Check if the other grid is the barycentric version of this grid
       return other.grid()->isBarycentricRepresentationOf(*(this->grid()));
     } else {
@@ -120,14 +135,16 @@ shared_ptr<const Space<BasisFunctionType>>
 PiecewiseConstantScalarSpace<BasisFunctionType>::barycentricSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
 
-  if (!m_barycentricSpace) {
-    tbb::mutex::scoped_lock lock(m_barycentricSpaceMutex);
-    typedef PiecewiseConstantScalarSpaceBarycentric<BasisFunctionType>
-    BarycentricSpace;
-    if (!m_barycentricSpace)
-      m_barycentricSpace.reset(new BarycentricSpace(this->grid(), m_segment));
-  }
-  return m_barycentricSpace;
+  if (m_dofMode & SPACE_FILLING_CURVE_ORDER)
+    throw std::runtime_error(
+        "PiecewiseConstantScalarSpace::barycentricSpace(): "
+        "not supported for spaces with DOFs in space-filling curve order");
+  typedef PiecewiseConstantScalarSpaceBarycentric<BasisFunctionType>
+  BarycentricSpace;
+  return m_barycentricSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new BarycentricSpace(this->grid(), m_segment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -175,6 +192,16 @@ void PiecewiseConstantScalarSpace<BasisFunctionType>::assignDofsImpl(
     m_local2globalDofs[index] = globalDofs;
     it->next();
   }
+
+  if (m_dofMode & SPACE_FILLING_CURVE_ORDER) {
+    std::vector<BoundingBox<CoordinateType>> bboxes;
+    PiecewiseConstantScalarSpace::getGlobalDofBoundingBoxes(bboxes);
+    std::vector<Point3D<CoordinateType>> positions;
+    SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+        bboxes, positions);
+    SpaceHelper<BasisFunctionType>::sortGlobalDofsAlongSpaceFillingCurve(
+        positions, m_local2globalDofs, m_global2localDofs);
+  }
 }
 
 template <typename BasisFunctionType>
@@ -234,12 +261,8 @@ void PiecewiseConstantScalarSpace<BasisFunctionType>::
 template <typename BasisFunctionType>
 void PiecewiseConstantScalarSpace<BasisFunctionType>::getGlobalDofPositions(
     std::vector<Point3D<CoordinateType>> &positions) const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
@@ -25,13 +25,14 @@
 
 #include "../grid/grid_view.hpp"
 #include "../grid/grid_segment.hpp"
+#include "dof_assignment_mode.hpp"
 #include "scalar_space.hpp"
 #include "../common/types.hpp"
 #include "../fiber/constant_scalar_shapeset.hpp"
+#include "../common/lazy.hpp"
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -61,10 +62,16 @@ public:
    *  Construct a space of piecewise constant scalar functions defined on the
    *  elements of the grid \p grid belonging to the segment \p segment.
    *
-   *  An exception is thrown if \p grid is a null pointer.
+   *  \p dofMode can be set to 0 or SPACE_FILLING_CURVE_ORDER. In the latter
+   *  case the global DOFs are numbered along a space-filling curve through
+   *  the element centres rather than in the order of the element indices.
+   *  The barycentric counterpart of such a space is not available.
+   *
+   *  An exception is thrown if \p grid is a null pointer or \p dofMode is
+   *  invalid.
    */
   PiecewiseConstantScalarSpace(const shared_ptr<const Grid> &grid,
-                               const GridSegment &segment);
+                               const GridSegment &segment, int dofMode = 0);
 
   virtual shared_ptr<const Space<BasisFunctionType>> discontinuousSpace(
       const shared_ptr<const Space<BasisFunctionType>> &self) const;
@@ -142,11 +149,11 @@ private:
 private:
   std::unique_ptr<GridView> m_view;
   GridSegment m_segment;
+  int m_dofMode;
   Fiber::ConstantScalarShapeset<BasisFunctionType> m_shapeset;
   std::vector<std::vector<GlobalDofIndex>> m_local2globalDofs;
   std::vector<std::vector<LocalDof>> m_global2localDofs;
-  mutable shared_ptr<Space<BasisFunctionType>> m_barycentricSpace;
-  mutable tbb::mutex m_barycentricSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_barycentricSpace;
 };
 
 } // namespace Bempp
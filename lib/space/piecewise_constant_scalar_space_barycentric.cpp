@@ -59,15 +59,12 @@ template <typename BasisFunctionType>
 shared_ptr<const Space<BasisFunctionType>>
 PiecewiseConstantScalarSpaceBarycentric<BasisFunctionType>::discontinuousSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
-  if (!m_discontinuousSpace) {
-    tbb::mutex::scoped_lock lock(m_discontinuousSpaceMutex);
-    typedef PiecewiseConstantDiscontinuousScalarSpaceBarycentric<
-        BasisFunctionType> DiscontinuousSpace;
-    if (!m_discontinuousSpace)
-      m_discontinuousSpace.reset(
-          new DiscontinuousSpace(m_originalGrid, m_segment));
-  }
-  return m_discontinuousSpace;
+  typedef PiecewiseConstantDiscontinuousScalarSpaceBarycentric<
+      BasisFunctionType> DiscontinuousSpace;
+  return m_discontinuousSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new DiscontinuousSpace(m_originalGrid, m_segment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -280,24 +277,16 @@ template <typename BasisFunctionType>
 void PiecewiseConstantScalarSpaceBarycentric<BasisFunctionType>::
     getGlobalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
 void PiecewiseConstantScalarSpaceBarycentric<BasisFunctionType>::
     getFlatLocalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getFlatLocalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->flatLocalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
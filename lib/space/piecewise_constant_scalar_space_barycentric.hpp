@@ -28,8 +28,8 @@
 #include "../common/types.hpp"
 #include "../fiber/constant_scalar_shapeset.hpp"
 #include "../grid/grid_segment.hpp"
+#include "../common/lazy.hpp"
 
-#include <tbb/mutex.h>
 
 #include <map>
 #include <memory>
@@ -149,8 +149,7 @@ private:
   std::vector<LocalDof> m_flatLocal2localDofs;
   GridSegment m_segment;
   shared_ptr<const Grid> m_originalGrid;
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
 };
 
 } // namespace Bempp
@@ -33,6 +33,7 @@
 #include "../common/bounding_box_helpers.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../grid/entity.hpp"
+#include "../grid/element_connectivity.hpp"
 #include "../grid/entity_iterator.hpp"
 #include "../grid/geometry.hpp"
 #include "../grid/grid.hpp"
@@ -43,13 +44,16 @@
 #include <stdexcept>
 #include <iostream>
 
+#include <tbb/parallel_for.h>
+
 namespace Bempp {
 
 template <typename BasisFunctionType>
 PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::
     PiecewiseLinearContinuousScalarSpace(const shared_ptr<const Grid> &grid)
     : PiecewiseLinearScalarSpace<BasisFunctionType>(grid),
-      m_segment(GridSegment::wholeGrid(*grid)), m_strictlyOnSegment(false) {
+      m_segment(GridSegment::wholeGrid(*grid)), m_strictlyOnSegment(false),
+      m_dofMode(0) {
   initialize();
 }
 
@@ -57,9 +61,13 @@ template <typename BasisFunctionType>
 PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::
     PiecewiseLinearContinuousScalarSpace(const shared_ptr<const Grid> &grid,
                                          const GridSegment &segment,
-                                         bool strictlyOnSegment)
+                                         bool strictlyOnSegment, int dofMode)
     : PiecewiseLinearScalarSpace<BasisFunctionType>(grid), m_segment(segment),
-      m_strictlyOnSegment(strictlyOnSegment) {
+      m_strictlyOnSegment(strictlyOnSegment), m_dofMode(dofMode) {
+  if (dofMode & ~SPACE_FILLING_CURVE_ORDER)
+    throw std::invalid_argument("PiecewiseLinearContinuousScalarSpace::"
+                                "PiecewiseLinearContinuousScalarSpace(): "
+                                "invalid dofMode");
   initialize();
 }
 
@@ -82,15 +90,12 @@ template <typename BasisFunctionType>
 shared_ptr<const Space<BasisFunctionType>>
 PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::discontinuousSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
-  if (!m_discontinuousSpace) {
-    tbb::mutex::scoped_lock lock(m_discontinuousSpaceMutex);
-    typedef PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType>
-    DiscontinuousSpace;
-    if (!m_discontinuousSpace)
-      m_discontinuousSpace.reset(
-          new DiscontinuousSpace(this->grid(), m_segment, m_strictlyOnSegment));
-  }
-  return m_discontinuousSpace;
+  typedef PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType>
+  DiscontinuousSpace;
+  return m_discontinuousSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new DiscontinuousSpace(this->grid(), m_segment, m_strictlyOnSegment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -98,15 +103,16 @@ shared_ptr<const Space<BasisFunctionType>>
 PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::barycentricSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
 
-  if (!m_barycentricSpace) {
-    tbb::mutex::scoped_lock lock(m_barycentricSpaceMutex);
-    typedef PiecewiseLinearContinuousScalarSpaceBarycentric<BasisFunctionType>
-    BarycentricSpace;
-    if (!m_barycentricSpace)
-      m_barycentricSpace.reset(
-          new BarycentricSpace(this->grid(), m_segment, m_strictlyOnSegment));
-  }
-  return m_barycentricSpace;
+  if (m_dofMode & SPACE_FILLING_CURVE_ORDER)
+    throw std::runtime_error(
+        "PiecewiseLinearContinuousScalarSpace::barycentricSpace(): "
+        "not supported for spaces with DOFs in space-filling curve order");
+  typedef PiecewiseLinearContinuousScalarSpaceBarycentric<BasisFunctionType>
+  BarycentricSpace;
+  return m_barycentricSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new BarycentricSpace(this->grid(), m_segment, m_strictlyOnSegment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -120,10 +126,18 @@ bool PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::spaceIsCompatible(
     const Space<BasisFunctionType> &other) const {
 
   if (other.grid().get() == this->grid().get()) {
-    return (other.spaceIdentifier() == this->spaceIdentifier());
+    if (other.spaceIdentifier() != this->spaceIdentifier())
+      return false;
+    // Spaces with differently ordered global DOFs are not interchangeable
+    const PiecewiseLinearContinuousScalarSpace *otherSpace =
+        dynamic_cast<const PiecewiseLinearContinuousScalarSpace *>(&other);
+    return !otherSpace ||
+           (otherSpace->m_dofMode & SPACE_FILLING_CURVE_ORDER) ==
+               (m_dofMode & SPACE_FILLING_CURVE_ORDER);
   } else {
     if (other.spaceIdentifier() ==
-        PIECEWISE_LINEAR_CONTINUOUS_SCALAR_BARYCENTRIC) {
+            PIECEWISE_LINEAR_CONTINUOUS_SCALAR_BARYCENTRIC &&
+        !(m_dofMode & SPACE_FILLING_CURVE_ORDER)) {
       // Check if the other grid is the barycentric version of this grid
       return other.grid()->isBarycentricRepresentationOf(*(this->grid()));
     } else {
@@ -137,8 +151,13 @@ void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
   const int gridDim = this->domainDimension();
   const int elementCodim = 0;
 
-  const Mapper &elementMapper = m_view->elementMapper();
-  const IndexSet &indexSet = m_view->indexSet();
+  // The connectivity arrays let us avoid iterating over the entities
+  shared_ptr<const ElementConnectivity> connectivity =
+      m_view->elementConnectivity();
+  const arma::Mat<int> &elementCorners = connectivity->elementCorners();
+  const std::vector<int> &vertexElementOffsets =
+      connectivity->vertexElementOffsets();
+  const std::vector<int> &vertexElements = connectivity->vertexElements();
 
   int elementCount = m_view->entityCount(0);
   int vertexCount = m_view->entityCount(gridDim);
@@ -147,81 +166,85 @@ void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
   // the selected grid segment)
   std::vector<int> globalDofIndices(vertexCount, 0);
   m_segment.markExcludedEntities(gridDim, globalDofIndices);
-  std::vector<bool> segmentContainsElement;
+  std::vector<char> segmentContainsElement;
   if (m_strictlyOnSegment) {
-    std::vector<bool> noAdjacentElementsInsideSegment(vertexCount, true);
     segmentContainsElement.resize(elementCount);
-    std::unique_ptr<EntityIterator<0>> it = m_view->entityIterator<0>();
-    while (!it->finished()) {
-      const Entity<0> &element = it->entity();
-      EntityIndex elementIndex = elementMapper.entityIndex(element);
-      bool elementContained = m_segment.contains(elementCodim, elementIndex);
-      acc(segmentContainsElement, elementIndex) = elementContained;
-
-      int cornerCount;
-      if (gridDim == 1)
-        cornerCount = element.template subEntityCount<1>();
-      else // gridDim == 2
-        cornerCount = element.template subEntityCount<2>();
-      if (elementContained)
-        for (int i = 0; i < cornerCount; ++i) {
-          int vertexIndex = indexSet.subEntityIndex(element, i, gridDim);
-          acc(noAdjacentElementsInsideSegment, vertexIndex) = false;
-        }
-      it->next();
-    }
+    for (int e = 0; e < elementCount; ++e)
+      segmentContainsElement[e] = m_segment.contains(elementCodim, e);
     // Remove all DOFs associated with vertices lying next to no element
     // belonging to the grid segment
-    for (size_t i = 0; i < vertexCount; ++i)
-      if (acc(noAdjacentElementsInsideSegment, i))
-        acc(globalDofIndices, i) = -1;
+    for (int v = 0; v < vertexCount; ++v) {
+      bool adjacentElementInsideSegment = false;
+      for (int k = vertexElementOffsets[v]; k < vertexElementOffsets[v + 1];
+           ++k)
+        if (segmentContainsElement[vertexElements[k]])
+          adjacentElementInsideSegment = true;
+      if (!adjacentElementInsideSegment)
+        acc(globalDofIndices, v) = -1;
+    }
   }
   int globalDofCount_ = 0;
+  std::vector<int> dofVertices;
   for (int vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex)
-    if (acc(globalDofIndices, vertexIndex) == 0) // not excluded
+    if (acc(globalDofIndices, vertexIndex) == 0) { // not excluded
       acc(globalDofIndices, vertexIndex) = globalDofCount_++;
+      dofVertices.push_back(vertexIndex);
+    }
 
   // (Re)initialise DOF maps
   m_local2globalDofs.clear();
   m_local2globalDofs.resize(elementCount);
   m_global2localDofs.clear();
   m_global2localDofs.resize(globalDofCount_);
-  // TODO: consider calling reserve(x) for each element of m_global2localDofs
-  // with x being the typical number of elements adjacent to a vertex in a
-  // grid of dimension gridDim
 
-  // Iterate over elements
-  std::unique_ptr<EntityIterator<0>> it = m_view->entityIterator<0>();
-  int flatLocalDofCount_ = 0;
-  while (!it->finished()) {
-    const Entity<0> &element = it->entity();
-    EntityIndex elementIndex = elementMapper.entityIndex(element);
-    bool elementContained =
-        m_strictlyOnSegment ? acc(segmentContainsElement, elementIndex) : true;
-
-    int cornerCount;
-    if (gridDim == 1)
-      cornerCount = element.template subEntityCount<1>();
-    else // gridDim == 2
-      cornerCount = element.template subEntityCount<2>();
-
-    // List of global DOF indices corresponding to the local DOFs of the
-    // current element
-    std::vector<GlobalDofIndex> &globalDofs =
-        acc(m_local2globalDofs, elementIndex);
-    globalDofs.resize(cornerCount);
-    for (int i = 0; i < cornerCount; ++i) {
-      int vertexIndex = indexSet.subEntityIndex(element, i, gridDim);
-      int globalDofIndex =
-          elementContained ? acc(globalDofIndices, vertexIndex) : -1;
-      acc(globalDofs, i) = globalDofIndex;
-      if (globalDofIndex >= 0) {
-        acc(m_global2localDofs, globalDofIndex)
-            .push_back(LocalDof(elementIndex, i));
-        ++flatLocalDofCount_;
+  // List the global DOF indices corresponding to the local DOFs of each
+  // element...
+  tbb::parallel_for(tbb::blocked_range<int>(0, elementCount),
+                    [&](const tbb::blocked_range<int> &r) {
+    for (int e = r.begin(); e != r.end(); ++e) {
+      bool elementContained =
+          m_strictlyOnSegment ? segmentContainsElement[e] : true;
+      const int cornerCount = connectivity->elementCornerCount(e);
+      std::vector<GlobalDofIndex> &globalDofs = m_local2globalDofs[e];
+      globalDofs.resize(cornerCount);
+      for (int i = 0; i < cornerCount; ++i)
+        globalDofs[i] =
+            elementContained ? globalDofIndices[elementCorners(i, e)] : -1;
+    }
+  });
+
+  // ... and the local DOFs corresponding to each global DOF, using the
+  // elements adjacent to its vertex
+  tbb::parallel_for(tbb::blocked_range<int>(0, globalDofCount_),
+                    [&](const tbb::blocked_range<int> &r) {
+    for (int g = r.begin(); g != r.end(); ++g) {
+      const int v = dofVertices[g];
+      std::vector<LocalDof> &localDofs = m_global2localDofs[g];
+      localDofs.reserve(vertexElementOffsets[v + 1] - vertexElementOffsets[v]);
+      for (int k = vertexElementOffsets[v]; k < vertexElementOffsets[v + 1];
+           ++k) {
+        const int e = vertexElements[k];
+        const std::vector<GlobalDofIndex> &globalDofs = m_local2globalDofs[e];
+        for (size_t i = 0; i < globalDofs.size(); ++i)
+          if (globalDofs[i] == g)
+            localDofs.push_back(LocalDof(e, i));
       }
     }
-    it->next();
+  });
+  int flatLocalDofCount_ = 0;
+  for (int g = 0; g < globalDofCount_; ++g)
+    flatLocalDofCount_ += m_global2localDofs[g].size();
+
+  if (m_dofMode & SPACE_FILLING_CURVE_ORDER) {
+    std::vector<BoundingBox<CoordinateType>> bboxes;
+    SpaceHelper<BasisFunctionType>::
+        getGlobalDofBoundingBoxes_defaultImplementation(
+            *m_view, m_global2localDofs, bboxes);
+    std::vector<Point3D<CoordinateType>> positions;
+    SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+        bboxes, positions);
+    SpaceHelper<BasisFunctionType>::sortGlobalDofsAlongSpaceFillingCurve(
+        positions, m_local2globalDofs, m_global2localDofs);
   }
 
   // Initialize the container mapping the flat local dof indices to
@@ -274,24 +297,16 @@ template <typename BasisFunctionType>
 void
 PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::getGlobalDofPositions(
     std::vector<Point3D<CoordinateType>> &positions) const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::
     getFlatLocalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getFlatLocalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->flatLocalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
@@ -307,46 +322,9 @@ template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::
     getFlatLocalDofBoundingBoxes(
         std::vector<BoundingBox<CoordinateType>> &bboxes) const {
-  // TODO: extract this loop into a private function
-  const IndexSet &indexSet = m_view->indexSet();
-  const int elementCount = m_view->entityCount(0);
-
-  std::vector<arma::Mat<CoordinateType>> elementCorners(elementCount);
-  std::unique_ptr<EntityIterator<0>> it = m_view->entityIterator<0>();
-  while (!it->finished()) {
-    const Entity<0> &e = it->entity();
-    int index = indexSet.entityIndex(e);
-    const Geometry &geo = e.geometry();
-    geo.getCorners(acc(elementCorners, index));
-    it->next();
-  }
-
-  BoundingBox<CoordinateType> model;
-  const CoordinateType maxCoord = std::numeric_limits<CoordinateType>::max();
-  model.lbound.x = model.lbound.y = model.lbound.z = maxCoord;
-  model.ubound.x = model.ubound.y = model.ubound.z = -maxCoord;
-
-  const int flatLocalDofCount_ = m_flatLocal2localDofs.size();
-  bboxes.resize(flatLocalDofCount_, model);
-  for (int i = 0; i < flatLocalDofCount_; ++i) {
-    const LocalDof &localDof = acc(m_flatLocal2localDofs, i);
-    BoundingBox<CoordinateType> &bbox = acc(bboxes, i);
-    extendBoundingBox(bbox, acc(elementCorners, localDof.entityIndex));
-    setBoundingBoxReference<CoordinateType>(
-        bbox, acc(elementCorners, localDof.entityIndex).col(localDof.dofIndex));
-  }
-
-#ifndef NDEBUG
-  const int globalDofCount_ = globalDofCount();
-  for (size_t i = 0; i < globalDofCount_; ++i) {
-    assert(bboxes[i].reference.x >= bboxes[i].lbound.x);
-    assert(bboxes[i].reference.y >= bboxes[i].lbound.y);
-    assert(bboxes[i].reference.z >= bboxes[i].lbound.z);
-    assert(bboxes[i].reference.x <= bboxes[i].ubound.x);
-    assert(bboxes[i].reference.y <= bboxes[i].ubound.y);
-    assert(bboxes[i].reference.z <= bboxes[i].ubound.z);
-  }
-#endif // NDEBUG
+  SpaceHelper<BasisFunctionType>::
+      getFlatLocalDofBoundingBoxes_defaultImplementation(
+          *m_view, m_flatLocal2localDofs, bboxes);
 }
 
 template <typename BasisFunctionType>
@@ -23,16 +23,17 @@
 
 #include "../common/common.hpp"
 
+#include "dof_assignment_mode.hpp"
 #include "piecewise_linear_scalar_space.hpp"
 
 #include "../grid/grid_segment.hpp"
 #include "../grid/grid_view.hpp"
 #include "../common/types.hpp"
 #include "../fiber/piecewise_linear_continuous_scalar_basis.hpp"
+#include "../common/lazy.hpp"
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -72,11 +73,18 @@ public:
    *  although the basis functions will be continuous when considered on the
    *  chosen grid segment.
    *
-   *  An exception is thrown if \p grid is a null pointer.
+   *  \p dofMode can be set to 0 or SPACE_FILLING_CURVE_ORDER. In the latter
+   *  case the global DOFs are numbered along a space-filling curve through
+   *  the grid vertices rather than in the order of the vertex indices. The
+   *  barycentric counterpart of such a space is not available.
+   *
+   *  An exception is thrown if \p grid is a null pointer or \p dofMode is
+   *  invalid.
    */
   PiecewiseLinearContinuousScalarSpace(const shared_ptr<const Grid> &grid,
                                        const GridSegment &segment,
-                                       bool strictlyOnSegment = false);
+                                       bool strictlyOnSegment = false,
+                                       int dofMode = 0);
   virtual ~PiecewiseLinearContinuousScalarSpace();
 
   virtual shared_ptr<const Space<BasisFunctionType>> discontinuousSpace(
@@ -137,14 +145,13 @@ private:
   /** \cond PRIVATE */
   GridSegment m_segment;
   bool m_strictlyOnSegment;
+  int m_dofMode;
   std::unique_ptr<GridView> m_view;
   std::vector<std::vector<GlobalDofIndex>> m_local2globalDofs;
   std::vector<std::vector<LocalDof>> m_global2localDofs;
   std::vector<LocalDof> m_flatLocal2localDofs;
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable shared_ptr<Space<BasisFunctionType>> m_barycentricSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
-  mutable tbb::mutex m_barycentricSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_barycentricSpace;
   /** \endcond */
 };
 
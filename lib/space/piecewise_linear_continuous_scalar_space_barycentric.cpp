@@ -88,15 +88,12 @@ shared_ptr<const Space<BasisFunctionType>>
 PiecewiseLinearContinuousScalarSpaceBarycentric<BasisFunctionType>::
     discontinuousSpace(const shared_ptr<const Space<BasisFunctionType>> &self)
     const {
-  if (!m_discontinuousSpace) {
-    tbb::mutex::scoped_lock lock(m_discontinuousSpaceMutex);
-    typedef PiecewiseLinearDiscontinuousScalarSpaceBarycentric<
-        BasisFunctionType> DiscontinuousSpace;
-    if (!m_discontinuousSpace)
-      m_discontinuousSpace.reset(new DiscontinuousSpace(
-          m_originalGrid, m_segment, m_strictlyOnSegment));
-  }
-  return m_discontinuousSpace;
+  typedef PiecewiseLinearDiscontinuousScalarSpaceBarycentric<
+      BasisFunctionType> DiscontinuousSpace;
+  return m_discontinuousSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new DiscontinuousSpace(m_originalGrid, m_segment, m_strictlyOnSegment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -369,24 +366,16 @@ template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpaceBarycentric<BasisFunctionType>::
     getGlobalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpaceBarycentric<BasisFunctionType>::
     getFlatLocalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getFlatLocalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->flatLocalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
@@ -402,46 +391,9 @@ template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpaceBarycentric<BasisFunctionType>::
     getFlatLocalDofBoundingBoxes(
         std::vector<BoundingBox<CoordinateType>> &bboxes) const {
-  // TODO: extract this loop into a private function
-  const IndexSet &indexSet = m_view->indexSet();
-  const int elementCount = m_view->entityCount(0);
-
-  std::vector<arma::Mat<CoordinateType>> elementCorners(elementCount);
-  std::unique_ptr<EntityIterator<0>> it = m_view->entityIterator<0>();
-  while (!it->finished()) {
-    const Entity<0> &e = it->entity();
-    int index = indexSet.entityIndex(e);
-    const Geometry &geo = e.geometry();
-    geo.getCorners(acc(elementCorners, index));
-    it->next();
-  }
-
-  BoundingBox<CoordinateType> model;
-  const CoordinateType maxCoord = std::numeric_limits<CoordinateType>::max();
-  model.lbound.x = model.lbound.y = model.lbound.z = maxCoord;
-  model.ubound.x = model.ubound.y = model.ubound.z = -maxCoord;
-
-  const int flatLocalDofCount_ = m_flatLocal2localDofs.size();
-  bboxes.resize(flatLocalDofCount_, model);
-  for (int i = 0; i < flatLocalDofCount_; ++i) {
-    const LocalDof &localDof = acc(m_flatLocal2localDofs, i);
-    BoundingBox<CoordinateType> &bbox = acc(bboxes, i);
-    extendBoundingBox(bbox, acc(elementCorners, localDof.entityIndex));
-    setBoundingBoxReference<CoordinateType>(
-        bbox, acc(elementCorners, localDof.entityIndex).col(localDof.dofIndex));
-  }
-
-#ifndef NDEBUG
-  const int globalDofCount_ = globalDofCount();
-  for (size_t i = 0; i < globalDofCount_; ++i) {
-    assert(bboxes[i].reference.x >= bboxes[i].lbound.x);
-    assert(bboxes[i].reference.y >= bboxes[i].lbound.y);
-    assert(bboxes[i].reference.z >= bboxes[i].lbound.z);
-    assert(bboxes[i].reference.x <= bboxes[i].ubound.x);
-    assert(bboxes[i].reference.y <= bboxes[i].ubound.y);
-    assert(bboxes[i].reference.z <= bboxes[i].ubound.z);
-  }
-#endif // NDEBUG
+  SpaceHelper<BasisFunctionType>::
+      getFlatLocalDofBoundingBoxes_defaultImplementation(
+          *m_view, m_flatLocal2localDofs, bboxes);
 }
 
 template <typename BasisFunctionType>
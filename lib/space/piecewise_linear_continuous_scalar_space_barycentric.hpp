@@ -29,10 +29,10 @@
 #include "../grid/grid_view.hpp"
 #include "../common/types.hpp"
 #include "../fiber/linear_scalar_shapeset_barycentric.hpp"
+#include "../common/lazy.hpp"
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -168,8 +168,7 @@ private:
 
   std::vector<typename Shapeset::BasisType> m_elementIndex2Type;
 
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
   /** \endcond */
 };
 
@@ -102,15 +102,12 @@ shared_ptr<const Space<BasisFunctionType>>
 PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType>::barycentricSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
 
-  if (!m_barycentricSpace) {
-    tbb::mutex::scoped_lock lock(m_barycentricSpaceMutex);
-    typedef PiecewiseLinearDiscontinuousScalarSpaceBarycentric<
-        BasisFunctionType> BarycentricSpace;
-    if (!m_barycentricSpace)
-      m_barycentricSpace.reset(
-          new BarycentricSpace(this->grid(), m_segment, m_strictlyOnSegment));
-  }
-  return m_barycentricSpace;
+  typedef PiecewiseLinearDiscontinuousScalarSpaceBarycentric<
+      BasisFunctionType> BarycentricSpace;
+  return m_barycentricSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new BarycentricSpace(this->grid(), m_segment, m_strictlyOnSegment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -226,12 +223,8 @@ template <typename BasisFunctionType>
 void PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType>::
     getGlobalDofPositions(std::vector<Point3D<CoordinateType>> &positions)
     const {
-  std::vector<BoundingBox<CoordinateType>> bboxes;
-  getGlobalDofBoundingBoxes(bboxes);
-
-  positions.resize(bboxes.size());
-  for (int i = 0; i < positions.size(); ++i)
-    positions[i] = bboxes[i].reference;
+  SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+      this->globalDofBoundingBoxes(), positions);
 }
 
 template <typename BasisFunctionType>
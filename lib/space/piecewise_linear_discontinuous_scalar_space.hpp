@@ -29,10 +29,10 @@
 #include "../common/types.hpp"
 // The name is absurd. Change to linear_scalar_basis.hpp
 #include "../fiber/piecewise_linear_continuous_scalar_basis.hpp"
+#include "../common/lazy.hpp"
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -148,8 +148,7 @@ private:
   std::vector<std::vector<GlobalDofIndex>> m_local2globalDofs;
   std::vector<std::vector<LocalDof>> m_global2localDofs;
   std::vector<LocalDof> m_flatLocal2localDofs;
-  mutable shared_ptr<Space<BasisFunctionType>> m_barycentricSpace;
-  mutable tbb::mutex m_barycentricSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_barycentricSpace;
   /** \endcond */
 };
 
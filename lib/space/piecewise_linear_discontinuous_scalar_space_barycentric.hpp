@@ -32,7 +32,6 @@
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -162,8 +161,6 @@ private:
 
   std::vector<typename Shapeset::BasisType> m_elementIndex2Type;
 
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
   /** \endcond */
 };
 
@@ -194,15 +194,12 @@ template <typename BasisFunctionType>
 shared_ptr<const Space<BasisFunctionType>>
 PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::discontinuousSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
-  if (!m_discontinuousSpace) {
-    tbb::mutex::scoped_lock lock(m_discontinuousSpaceMutex);
-    typedef PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>
-    DiscontinuousSpace;
-    if (!m_discontinuousSpace)
-      m_discontinuousSpace.reset(
-          new DiscontinuousSpace(this->grid(), m_polynomialOrder, m_segment));
-  }
-  return m_discontinuousSpace;
+  typedef PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>
+  DiscontinuousSpace;
+  return m_discontinuousSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new DiscontinuousSpace(this->grid(), m_polynomialOrder, m_segment));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -331,14 +328,12 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
   // Initialise DOF maps
   const int localDofCountPerTriangle =
       (m_polynomialOrder + 1) * (m_polynomialOrder + 2) / 2;
-  m_local2globalDofs.clear();
+  // They are built as nested vectors and compressed once complete.
   std::vector<GlobalDofIndex> prototypeGlobalDofs;
   prototypeGlobalDofs.reserve(localDofCountPerTriangle);
-  m_local2globalDofs.resize(elementCount, prototypeGlobalDofs);
-  m_global2localDofs.clear();
-  // std::vector<LocalDof> prototypeLocalDofs;
-  // prototypeLocalDofs.reserve(localDofCountPerTriangle);
-  m_global2localDofs.resize(globalDofCount_ /*, prototypeLocalDofs*/);
+  std::vector<std::vector<GlobalDofIndex>> local2globalDofs(
+      elementCount, prototypeGlobalDofs);
+  std::vector<std::vector<LocalDof>> global2localDofs(globalDofCount_);
 
   // Initialise bounding-box caches
   BoundingBox<CoordinateType> model;
@@ -369,7 +364,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
     // List of global DOF indices corresponding to the local DOFs of the
     // current element
     std::vector<GlobalDofIndex> &globalDofs =
-        acc(m_local2globalDofs, elementIndex);
+        acc(local2globalDofs, elementIndex);
     if (vertexCount == 3) {
       std::vector<int> ldofAccessCounts(localDofCountPerTriangle, 0);
       boost::array<int, 3> vertexIndices;
@@ -388,7 +383,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
           gdof = -1;
         if (gdof >= 0) {
           acc(globalDofs, ldof) = gdof;
-          acc(m_global2localDofs, gdof).push_back(LocalDof(elementIndex, ldof));
+          acc(global2localDofs, gdof).push_back(LocalDof(elementIndex, ldof));
           ++acc(gdofAccessCounts, gdof);
           extendBoundingBox(acc(m_globalDofBoundingBoxes, gdof), vertices);
           setBoundingBoxReference<CoordinateType>(
@@ -405,7 +400,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
           gdof = -1;
         if (gdof >= 0) {
           acc(globalDofs, ldof) = gdof;
-          acc(m_global2localDofs, gdof).push_back(LocalDof(elementIndex, ldof));
+          acc(global2localDofs, gdof).push_back(LocalDof(elementIndex, ldof));
           ++acc(gdofAccessCounts, gdof);
           extendBoundingBox(acc(m_globalDofBoundingBoxes, gdof), vertices);
           setBoundingBoxReference<CoordinateType>(
@@ -422,7 +417,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
           gdof = -1;
         if (gdof >= 0) {
           acc(globalDofs, ldof) = gdof;
-          acc(m_global2localDofs, gdof).push_back(LocalDof(elementIndex, ldof));
+          acc(global2localDofs, gdof).push_back(LocalDof(elementIndex, ldof));
           ++acc(gdofAccessCounts, gdof);
           extendBoundingBox(acc(m_globalDofBoundingBoxes, gdof), vertices);
           setBoundingBoxReference<CoordinateType>(
@@ -452,7 +447,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
           }
           for (int ldof = 1, gdof = start; gdof != end; ++ldof, gdof += step) {
             acc(globalDofs, ldof) = gdof;
-            acc(m_global2localDofs, gdof)
+            acc(global2localDofs, gdof)
                 .push_back(LocalDof(elementIndex, ldof));
             ++acc(ldofAccessCounts, ldof);
             ++acc(gdofAccessCounts, gdof);
@@ -484,7 +479,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
             int ldof =
                 ldofy * (m_polynomialOrder + 1) - ldofy * (ldofy - 1) / 2;
             acc(globalDofs, ldof) = gdof;
-            acc(m_global2localDofs, gdof)
+            acc(global2localDofs, gdof)
                 .push_back(LocalDof(elementIndex, ldof));
             ++acc(ldofAccessCounts, ldof);
             ++acc(gdofAccessCounts, gdof);
@@ -518,7 +513,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
             int ldof = ldofy * (m_polynomialOrder + 1) -
                        ldofy * (ldofy - 1) / 2 + (m_polynomialOrder - ldofy);
             acc(globalDofs, ldof) = gdof;
-            acc(m_global2localDofs, gdof)
+            acc(global2localDofs, gdof)
                 .push_back(LocalDof(elementIndex, ldof));
             ++acc(ldofAccessCounts, ldof);
             ++acc(gdofAccessCounts, gdof);
@@ -549,7 +544,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
                        ldofy * (ldofy - 1) / 2 + ldofx;
             if (useDofs) {
               acc(globalDofs, ldof) = gdof;
-              acc(m_global2localDofs, gdof)
+              acc(global2localDofs, gdof)
                   .push_back(LocalDof(elementIndex, ldof));
               ++acc(gdofAccessCounts, gdof);
               extendBoundingBox(acc(m_globalDofBoundingBoxes, gdof), vertices);
@@ -589,7 +584,10 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::assignDofsImpl() {
   // Initialize the container mapping the flat local dof indices to
   // local dof indices
   SpaceHelper<BasisFunctionType>::initializeLocal2FlatLocalDofMap(
-      m_flatLocalDofCount, m_local2globalDofs, m_flatLocal2localDofs);
+      m_flatLocalDofCount, local2globalDofs, m_flatLocal2localDofs);
+
+  m_local2globalDofs = CompressedDofTable<GlobalDofIndex>(local2globalDofs);
+  m_global2localDofs = CompressedDofTable<LocalDof>(global2localDofs);
 }
 
 template <typename BasisFunctionType>
@@ -611,7 +609,7 @@ void PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::getGlobalDofs(
     const Entity<0> &element, std::vector<GlobalDofIndex> &dofs) const {
   const Mapper &mapper = m_view->elementMapper();
   EntityIndex index = mapper.entityIndex(element);
-  dofs = m_local2globalDofs[index];
+  m_local2globalDofs.getRow(index, dofs);
 }
 
 template <typename BasisFunctionType>
@@ -621,7 +619,7 @@ PiecewisePolynomialContinuousScalarSpace<BasisFunctionType>::global2localDofs(
     std::vector<std::vector<LocalDof>> &localDofs) const {
   localDofs.resize(globalDofs.size());
   for (size_t i = 0; i < globalDofs.size(); ++i)
-    localDofs[i] = m_global2localDofs[globalDofs[i]];
+    m_global2localDofs.getRow(globalDofs[i], localDofs[i]);
 }
 
 template <typename BasisFunctionType>
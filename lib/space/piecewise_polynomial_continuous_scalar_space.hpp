@@ -24,12 +24,13 @@
 #include "../common/common.hpp"
 #include "../common/types.hpp"
 #include "../grid/grid_segment.hpp"
+#include "../common/lazy.hpp"
 
+#include "compressed_dof_table.hpp"
 #include "scalar_space.hpp"
 
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -151,13 +152,12 @@ private:
   bool m_strictlyOnSegment;
   boost::scoped_ptr<Fiber::Shapeset<BasisFunctionType>> m_triangleShapeset;
   std::unique_ptr<GridView> m_view;
-  std::vector<std::vector<GlobalDofIndex>> m_local2globalDofs;
-  std::vector<std::vector<LocalDof>> m_global2localDofs;
+  CompressedDofTable<GlobalDofIndex> m_local2globalDofs;
+  CompressedDofTable<LocalDof> m_global2localDofs;
   std::vector<LocalDof> m_flatLocal2localDofs;
   size_t m_flatLocalDofCount;
   std::vector<BoundingBox<CoordinateType>> m_globalDofBoundingBoxes;
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
   /** \endcond */
 };
 
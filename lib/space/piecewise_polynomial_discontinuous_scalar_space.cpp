@@ -238,12 +238,12 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
   model.ubound.z = -std::numeric_limits<CoordinateType>::max();
   m_globalDofBoundingBoxes.reserve(localDofCountPerQuad * elementCount);
 
-  // (Re)initialise DOF maps
-  m_local2globalDofs.clear();
-  m_local2globalDofs.resize(elementCount);
-  m_global2localDofs.clear();
+  // (Re)initialise DOF maps. They are built as nested vectors and
+  // compressed once complete.
+  std::vector<std::vector<GlobalDofIndex>> local2globalDofs(elementCount);
+  std::vector<std::vector<LocalDof>> global2localDofs;
   // estimated number of global DOFs
-  m_global2localDofs.reserve(localDofCountPerQuad * elementCount);
+  global2localDofs.reserve(localDofCountPerQuad * elementCount);
 
   // Fill in global<->local dof maps
   std::unique_ptr<EntityIterator<0>> it = m_view->entityIterator<0>();
@@ -264,13 +264,13 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
 
     // List of global DOF indices corresponding to the local DOFs of the
     // current element
-    std::vector<GlobalDofIndex> &globalDofs = m_local2globalDofs[elementIndex];
+    std::vector<GlobalDofIndex> &globalDofs = local2globalDofs[elementIndex];
     globalDofs.resize(localDofCount);
     // GlobalDofIndex gdofStart = globalDofCount;
     // for (int i = 0; i < localDofCount; ++i) {
     //     globalDofs.push_back(globalDofCount);
     //     std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, i));
-    //     m_global2localDofs.push_back(localDofs);
+    //     global2localDofs.push_back(localDofs);
     //     ++globalDofCount;
     // }
     // GlobalDofIndex gdofEnd = globalDofCount;
@@ -289,7 +289,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
         if (segment.contains(0, elementIndex)) {
           acc(globalDofs, ldof) = globalDofCount;
           std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-          m_global2localDofs.push_back(localDofs);
+          global2localDofs.push_back(localDofs);
           m_globalDofBoundingBoxes.push_back(bbox);
           setBoundingBoxReference<CoordinateType>(
               acc(m_globalDofBoundingBoxes, globalDofCount),
@@ -306,7 +306,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
              segment.contains(vertexCodim, subEntityIndex))) {
           acc(globalDofs, ldof) = globalDofCount;
           std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-          m_global2localDofs.push_back(localDofs);
+          global2localDofs.push_back(localDofs);
           m_globalDofBoundingBoxes.push_back(bbox);
           setBoundingBoxReference<CoordinateType>(
               acc(m_globalDofBoundingBoxes, globalDofCount), vertices.col(0));
@@ -321,7 +321,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
              segment.contains(vertexCodim, subEntityIndex))) {
           acc(globalDofs, ldof) = globalDofCount;
           std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-          m_global2localDofs.push_back(localDofs);
+          global2localDofs.push_back(localDofs);
           m_globalDofBoundingBoxes.push_back(bbox);
           setBoundingBoxReference<CoordinateType>(
               acc(m_globalDofBoundingBoxes, globalDofCount), vertices.col(1));
@@ -336,7 +336,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
              segment.contains(vertexCodim, subEntityIndex))) {
           acc(globalDofs, ldof) = globalDofCount;
           std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-          m_global2localDofs.push_back(localDofs);
+          global2localDofs.push_back(localDofs);
           m_globalDofBoundingBoxes.push_back(bbox);
           setBoundingBoxReference<CoordinateType>(
               acc(m_globalDofBoundingBoxes, globalDofCount), vertices.col(2));
@@ -355,7 +355,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
             for (int ldof = 1; ldof < m_polynomialOrder; ++ldof) {
               acc(globalDofs, ldof) = globalDofCount;
               std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-              m_global2localDofs.push_back(localDofs);
+              global2localDofs.push_back(localDofs);
               m_globalDofBoundingBoxes.push_back(bbox);
               setBoundingBoxReference<CoordinateType>(
                   acc(m_globalDofBoundingBoxes, globalDofCount), dofPosition);
@@ -376,7 +376,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
                   ldofy * (m_polynomialOrder + 1) - ldofy * (ldofy - 1) / 2;
               acc(globalDofs, ldof) = globalDofCount;
               std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-              m_global2localDofs.push_back(localDofs);
+              global2localDofs.push_back(localDofs);
               m_globalDofBoundingBoxes.push_back(bbox);
               setBoundingBoxReference<CoordinateType>(
                   acc(m_globalDofBoundingBoxes, globalDofCount), dofPosition);
@@ -399,7 +399,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
                          ldofy * (ldofy - 1) / 2 + (m_polynomialOrder - ldofy);
               acc(globalDofs, ldof) = globalDofCount;
               std::vector<LocalDof> localDofs(1, LocalDof(elementIndex, ldof));
-              m_global2localDofs.push_back(localDofs);
+              global2localDofs.push_back(localDofs);
               m_globalDofBoundingBoxes.push_back(bbox);
               setBoundingBoxReference<CoordinateType>(
                   acc(m_globalDofBoundingBoxes, globalDofCount), dofPosition);
@@ -447,7 +447,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
                 acc(globalDofs, ldof) = globalDofCount;
                 std::vector<LocalDof> localDofs(1,
                                                 LocalDof(elementIndex, ldof));
-                m_global2localDofs.push_back(localDofs);
+                global2localDofs.push_back(localDofs);
                 m_globalDofBoundingBoxes.push_back(bbox);
                 setBoundingBoxReference<CoordinateType>(
                     acc(m_globalDofBoundingBoxes, globalDofCount), dofPosition);
@@ -481,11 +481,12 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::assignDofsImpl(
 
   // Initialize the container mapping the flat local dof indices to
   // local dof indices
+  m_flatLocalDofCount = global2localDofs.size();
   SpaceHelper<BasisFunctionType>::initializeLocal2FlatLocalDofMap(
-      m_flatLocalDofCount, m_local2globalDofs, m_flatLocal2localDofs);
-
-  m_flatLocalDofCount = m_global2localDofs.size();
+      m_flatLocalDofCount, local2globalDofs, m_flatLocal2localDofs);
 
+  m_local2globalDofs = CompressedDofTable<GlobalDofIndex>(local2globalDofs);
+  m_global2localDofs = CompressedDofTable<LocalDof>(global2localDofs);
 
 #ifndef NDEBUG
   for (size_t i = 0; i < m_globalDofBoundingBoxes.size(); ++i) {
@@ -520,7 +521,7 @@ PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::getGlobalDofs(
     const Entity<0> &element, std::vector<GlobalDofIndex> &dofs) const {
   const Mapper &mapper = m_view->elementMapper();
   EntityIndex index = mapper.entityIndex(element);
-  dofs = m_local2globalDofs[index];
+  m_local2globalDofs.getRow(index, dofs);
 }
 
 template <typename BasisFunctionType>
@@ -529,7 +530,7 @@ void PiecewisePolynomialDiscontinuousScalarSpace<BasisFunctionType>::
                      std::vector<std::vector<LocalDof>> &localDofs) const {
   localDofs.resize(globalDofs.size());
   for (size_t i = 0; i < globalDofs.size(); ++i)
-    localDofs[i] = m_global2localDofs[globalDofs[i]];
+    m_global2localDofs.getRow(globalDofs[i], localDofs[i]);
 }
 
 template <typename BasisFunctionType>
@@ -25,6 +25,7 @@
 #include "../common/types.hpp"
 #include "../fiber/lagrange_scalar_basis.hpp"
 
+#include "compressed_dof_table.hpp"
 #include "scalar_space.hpp"
 #include "dof_assignment_mode.hpp"
 
@@ -156,8 +157,8 @@ private:
   int m_polynomialOrder;
   boost::scoped_ptr<Fiber::Shapeset<BasisFunctionType>> m_triangleShapeset;
   std::unique_ptr<GridView> m_view;
-  std::vector<std::vector<GlobalDofIndex>> m_local2globalDofs;
-  std::vector<std::vector<LocalDof>> m_global2localDofs;
+  CompressedDofTable<GlobalDofIndex> m_local2globalDofs;
+  CompressedDofTable<LocalDof> m_global2localDofs;
   std::vector<LocalDof> m_flatLocal2localDofs;
   size_t m_flatLocalDofCount;
   std::vector<BoundingBox<CoordinateType>> m_globalDofBoundingBoxes;
@@ -104,14 +104,12 @@ template <typename BasisFunctionType>
 shared_ptr<const Space<BasisFunctionType>>
 RaviartThomas0VectorSpace<BasisFunctionType>::discontinuousSpace(
     const shared_ptr<const Space<BasisFunctionType>> &self) const {
-  if (!m_discontinuousSpace) {
-    tbb::mutex::scoped_lock lock(m_discontinuousSpaceMutex);
-    typedef PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType>
-    DiscontinuousSpace;
-    if (!m_discontinuousSpace)
-      m_discontinuousSpace.reset(new DiscontinuousSpace(this->grid()));
-  }
-  return m_discontinuousSpace;
+  typedef PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType>
+  DiscontinuousSpace;
+  return m_discontinuousSpace.get([&]() {
+    return shared_ptr<Space<BasisFunctionType>>(
+        new DiscontinuousSpace(this->grid()));
+  });
 }
 
 template <typename BasisFunctionType>
@@ -31,11 +31,11 @@
 #include "../grid/grid_view.hpp"
 #include "../common/types.hpp"
 #include "../fiber/raviart_thomas_0_shapeset.hpp"
+#include "../common/lazy.hpp"
 
 #include <boost/scoped_ptr.hpp>
 #include <map>
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp {
 
@@ -148,8 +148,7 @@ private:
   std::vector<std::vector<LocalDof>> m_global2localDofs;
   std::vector<LocalDof> m_flatLocal2localDofs;
   std::vector<BoundingBox<CoordinateType>> m_globalDofBoundingBoxes;
-  mutable shared_ptr<Space<BasisFunctionType>> m_discontinuousSpace;
-  mutable tbb::mutex m_discontinuousSpaceMutex;
+  Lazy<shared_ptr<Space<BasisFunctionType>>> m_discontinuousSpace;
   /** \endcond */
 };
 
@@ -36,6 +36,8 @@
 #include "../grid/mapper.hpp"
 #include "../grid/geometry_factory.hpp"
 
+#include <mutex>
+
 #ifdef WITH_TRILINOS
 #include <Epetra_CrsMatrix.h>
 #include <Epetra_LocalMap.h>
@@ -129,11 +131,28 @@ shared_ptr<Epetra_CrsMatrix> constructGlobalToFlatLocalDofsMappingEpetraMatrix(
 
 } // namespace
 
+template <typename BasisFunctionType>
+struct Space<BasisFunctionType>::DofBoundingBoxCache {
+  std::once_flag globalDofFlag;
+  std::once_flag flatLocalDofFlag;
+  std::vector<BoundingBox<CoordinateType>> globalDofBoundingBoxes;
+  std::vector<BoundingBox<CoordinateType>> flatLocalDofBoundingBoxes;
+};
+
+template <typename BasisFunctionType>
+struct Space<BasisFunctionType>::DofTableCache {
+  std::once_flag globalDofFlag;
+  std::once_flag flatLocalDofFlag;
+  GlobalToLocalDofTable globalToLocalDofs;
+  std::vector<LocalDof> flatLocalToLocalDofs;
+};
+
 template <typename BasisFunctionType>
 Space<BasisFunctionType>::Space(const shared_ptr<const Grid> &grid)
     : m_grid(grid),
       m_elementGeometryFactory(grid->elementGeometryFactory().release()),
-      m_view(grid->leafView()) {
+      m_view(grid->leafView()), m_dofBoundingBoxCache(new DofBoundingBoxCache),
+      m_dofTableCache(new DofTableCache) {
   if (!grid)
     throw std::invalid_argument("Space::Space(): grid must not be a null "
                                 "pointer");
@@ -143,7 +162,9 @@ template <typename BasisFunctionType>
 Space<BasisFunctionType>::Space(const Space<BasisFunctionType> &other)
     : m_grid(other.m_grid),
       m_elementGeometryFactory(other.m_elementGeometryFactory),
-      m_view(other.m_grid->levelView(other.m_level)) {}
+      m_view(other.m_grid->levelView(other.m_level)),
+      m_dofBoundingBoxCache(new DofBoundingBoxCache),
+      m_dofTableCache(new DofTableCache) {}
 template <typename BasisFunctionType> Space<BasisFunctionType>::~Space() {}
 
 template <typename BasisFunctionType>
@@ -152,9 +173,76 @@ operator=(const Space<BasisFunctionType> &other) {
   m_grid = other.m_grid;
   m_view = m_grid->levelView(m_level);
   m_elementGeometryFactory = other.m_elementGeometryFactory;
+  m_dofBoundingBoxCache.reset(new DofBoundingBoxCache);
+  m_dofTableCache.reset(new DofTableCache);
   return *this;
 }
 
+template <typename BasisFunctionType>
+const std::vector<
+    BoundingBox<typename Space<BasisFunctionType>::CoordinateType>> &
+Space<BasisFunctionType>::globalDofBoundingBoxes() const {
+  DofBoundingBoxCache &cache = *m_dofBoundingBoxCache;
+  std::call_once(cache.globalDofFlag, [&]() {
+    getGlobalDofBoundingBoxes(cache.globalDofBoundingBoxes);
+  });
+  return cache.globalDofBoundingBoxes;
+}
+
+template <typename BasisFunctionType>
+const std::vector<
+    BoundingBox<typename Space<BasisFunctionType>::CoordinateType>> &
+Space<BasisFunctionType>::flatLocalDofBoundingBoxes() const {
+  DofBoundingBoxCache &cache = *m_dofBoundingBoxCache;
+  std::call_once(cache.flatLocalDofFlag, [&]() {
+    getFlatLocalDofBoundingBoxes(cache.flatLocalDofBoundingBoxes);
+  });
+  return cache.flatLocalDofBoundingBoxes;
+}
+
+template <typename BasisFunctionType>
+const typename Space<BasisFunctionType>::GlobalToLocalDofTable &
+Space<BasisFunctionType>::globalToLocalDofTable() const {
+  DofTableCache &cache = *m_dofTableCache;
+  std::call_once(cache.globalDofFlag, [&]() {
+    std::vector<GlobalDofIndex> globalDofs(globalDofCount());
+    for (size_t i = 0; i < globalDofs.size(); ++i)
+      globalDofs[i] = i;
+    std::vector<std::vector<LocalDof>> localDofs;
+    std::vector<std::vector<BasisFunctionType>> localDofWeights;
+    global2localDofs(globalDofs, localDofs, localDofWeights);
+
+    GlobalToLocalDofTable &table = cache.globalToLocalDofs;
+    table.offsets.resize(globalDofs.size() + 1);
+    table.offsets[0] = 0;
+    for (size_t i = 0; i < globalDofs.size(); ++i)
+      table.offsets[i + 1] = table.offsets[i] + localDofs[i].size();
+    table.localDofs.reserve(table.offsets.back());
+    table.localDofWeights.reserve(table.offsets.back());
+    for (size_t i = 0; i < globalDofs.size(); ++i) {
+      table.localDofs.insert(table.localDofs.end(), localDofs[i].begin(),
+                             localDofs[i].end());
+      table.localDofWeights.insert(table.localDofWeights.end(),
+                                   localDofWeights[i].begin(),
+                                   localDofWeights[i].end());
+    }
+  });
+  return cache.globalToLocalDofs;
+}
+
+template <typename BasisFunctionType>
+const std::vector<LocalDof> &
+Space<BasisFunctionType>::flatLocalToLocalDofTable() const {
+  DofTableCache &cache = *m_dofTableCache;
+  std::call_once(cache.flatLocalDofFlag, [&]() {
+    std::vector<FlatLocalDofIndex> flatLocalDofs(flatLocalDofCount());
+    for (size_t i = 0; i < flatLocalDofs.size(); ++i)
+      flatLocalDofs[i] = i;
+    flatLocal2localDofs(flatLocalDofs, cache.flatLocalToLocalDofs);
+  });
+  return cache.flatLocalToLocalDofs;
+}
+
 template <typename BasisFunctionType>
 void Space<BasisFunctionType>::assignDofs() {}
 
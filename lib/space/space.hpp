@@ -154,6 +154,9 @@ public:
      *
      *  2. The support of each basis function \f$g_m\f$ is a single element.
      *
+     *  Implementations may construct the returned space on the first call; this
+     *  function must nevertheless be safe to call from several threads.
+     *
      *  \param[in] self This must be a shared pointer to <tt>*this</tt>.
      */
     virtual shared_ptr<const Space<BasisFunctionType> > discontinuousSpace(
@@ -386,6 +389,34 @@ public:
             const std::vector<FlatLocalDofIndex>& flatLocalDofs,
             std::vector<LocalDof>& localDofs) const = 0;
 
+    /** \brief Table of the local degrees of freedom of all global ones, in
+     *  compressed sparse row format.
+     *
+     *  The local DOFs mapped to the global DOF \p g and their weights are the
+     *  entries offsets[g], ..., offsets[g + 1] - 1 of localDofs and
+     *  localDofWeights. */
+    struct GlobalToLocalDofTable {
+        std::vector<int> offsets;
+        std::vector<LocalDof> localDofs;
+        std::vector<BasisFunctionType> localDofWeights;
+    };
+
+    /** \brief Return the local degrees of freedom of all global ones.
+     *
+     *  The table is filled by a single call of global2localDofs() for all
+     *  global DOFs on the first call and cached, so that code translating
+     *  many small sets of DOFs, such as the H-matrix assembly helpers, only
+     *  needs to look up array slices. This function may be called
+     *  concurrently from several threads. */
+    const GlobalToLocalDofTable& globalToLocalDofTable() const;
+
+    /** \brief Return the local degrees of freedom ordered by their flat
+     *  index.
+     *
+     *  This is the cached counterpart of flatLocal2localDofs() called for all
+     *  flat local DOFs; see globalToLocalDofTable(). */
+    const std::vector<LocalDof>& flatLocalToLocalDofTable() const;
+
     /** @}
         @name Function interpolation
         @} */
@@ -490,6 +521,23 @@ public:
                                  "implementation missing");
     }
 
+    /** \brief Return the bounding boxes of global degrees of freedom.
+     *
+     *  The bounding boxes are computed by getGlobalDofBoundingBoxes() on the
+     *  first call and cached, so that building cluster trees for several
+     *  operators defined on this space does not repeat the loop over elements.
+     *  This function may be called concurrently from several threads. */
+    const std::vector<BoundingBox<CoordinateType> >&
+    globalDofBoundingBoxes() const;
+
+    /** \brief Return the bounding boxes of local degrees of freedom ordered by
+     *  their flat index.
+     *
+     *  This is the cached counterpart of getFlatLocalDofBoundingBoxes(); see
+     *  globalDofBoundingBoxes(). */
+    const std::vector<BoundingBox<CoordinateType> >&
+    flatLocalDofBoundingBoxes() const;
+
     /** \brief Retrieve the reference positions of global degrees of freedom.
      *
      *  \param[out] positions
@@ -595,10 +643,15 @@ public:
     /** @} */
 private:
   /** \cond PRIVATE */
+  struct DofBoundingBoxCache;
+  struct DofTableCache;
+
   shared_ptr<const Grid> m_grid;
   shared_ptr<GeometryFactory> m_elementGeometryFactory;
   unsigned int m_level;
   std::unique_ptr<GridView> m_view;
+  std::unique_ptr<DofBoundingBoxCache> m_dofBoundingBoxCache;
+  std::unique_ptr<DofTableCache> m_dofTableCache;
   /** \endcond */
 };
 
@@ -20,10 +20,13 @@
 
 #include "space_helper.hpp"
 
+#include "compressed_dof_table.hpp"
+
 #include "../common/acc.hpp"
 #include "../common/boost_make_shared_fwd.hpp"
 #include "../common/bounding_box_helpers.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/raw_grid_geometry.hpp"
 #include "../grid/entity.hpp"
 #include "../grid/entity_iterator.hpp"
 #include "../grid/geometry.hpp"
@@ -32,8 +35,144 @@
 #include "../grid/mapper.hpp"
 #include "space.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+
 namespace Bempp {
 
+namespace {
+
+// Fill corners[e] with the coordinates of the corners of the element with
+// index e, reading the cached raw geometry of the grid view instead of
+// constructing a Geometry object per element.
+template <typename CoordinateType>
+void getElementCorners(const GridView &view,
+                       std::vector<arma::Mat<CoordinateType>> &corners) {
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> rawGeometry =
+      view.rawGeometry<CoordinateType>();
+  const arma::Mat<CoordinateType> &vertices = rawGeometry->vertices();
+  const arma::Mat<int> &cornerIndices = rawGeometry->elementCornerIndices();
+
+  corners.resize(cornerIndices.n_cols);
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, cornerIndices.n_cols),
+      [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t e = r.begin(); e != r.end(); ++e) {
+          int cornerCount = 0;
+          while (cornerCount < cornerIndices.n_rows &&
+                 cornerIndices(cornerCount, e) >= 0)
+            ++cornerCount;
+          arma::Mat<CoordinateType> &elementCorners = corners[e];
+          elementCorners.set_size(vertices.n_rows, cornerCount);
+          for (int i = 0; i < cornerCount; ++i)
+            elementCorners.col(i) = vertices.col(cornerIndices(i, e));
+        }
+      });
+}
+
+template <typename CoordinateType>
+BoundingBox<CoordinateType> emptyBoundingBox() {
+  BoundingBox<CoordinateType> bbox;
+  const CoordinateType maxCoord = std::numeric_limits<CoordinateType>::max();
+  bbox.lbound.x = bbox.lbound.y = bbox.lbound.z = maxCoord;
+  bbox.ubound.x = bbox.ubound.y = bbox.ubound.z = -maxCoord;
+  return bbox;
+}
+
+template <typename CoordinateType>
+void checkBoundingBoxReferences(
+    const std::vector<BoundingBox<CoordinateType>> &bboxes) {
+#ifndef NDEBUG
+  for (size_t i = 0; i < bboxes.size(); ++i) {
+    assert(bboxes[i].reference.x >= bboxes[i].lbound.x);
+    assert(bboxes[i].reference.y >= bboxes[i].lbound.y);
+    assert(bboxes[i].reference.z >= bboxes[i].lbound.z);
+    assert(bboxes[i].reference.x <= bboxes[i].ubound.x);
+    assert(bboxes[i].reference.y <= bboxes[i].ubound.y);
+    assert(bboxes[i].reference.z <= bboxes[i].ubound.z);
+  }
+#endif // NDEBUG
+}
+
+// Interleave the lowest 21 bits of x, y and z into a 63-bit Morton key.
+inline uint64_t mortonKey(uint64_t x, uint64_t y, uint64_t z) {
+  uint64_t key = 0;
+  for (int bit = 20; bit >= 0; --bit)
+    key = (key << 3) | (((x >> bit) & 1) << 2) | (((y >> bit) & 1) << 1) |
+          ((z >> bit) & 1);
+  return key;
+}
+
+// The DOF maps may be stored either as nested vectors or as
+// CompressedDofTable objects, which provide the same read interface.
+template <typename CoordinateType, typename Global2LocalDofs>
+void getGlobalDofNormalsImpl(const GridView &view,
+                             const Global2LocalDofs &global2localDofs,
+                             std::vector<Point3D<CoordinateType>> &normals) {
+  const int gridDim = view.dim();
+  const int globalDofCount_ = global2localDofs.size();
+  normals.resize(globalDofCount_);
+
+  // Note: we assume here that elements are flat and so the position at which
+  // the normal is calculated does not matter.
+  shared_ptr<const Fiber::RawGridGeometry<CoordinateType>> rawGeometry =
+      view.rawGeometry<CoordinateType>();
+  const arma::Mat<CoordinateType> &elementNormals = rawGeometry->normals();
+  if (elementNormals.n_cols != view.entityCount(0))
+    throw std::runtime_error("getGlobalDofNormals(): "
+                             "element normals are only defined for grids of "
+                             "codimension 1");
+
+  if (gridDim == 1)
+    for (size_t g = 0; g < globalDofCount_; ++g) {
+      const auto &ldofs = global2localDofs[g];
+      normals[g].x = 0.;
+      normals[g].y = 0.;
+      for (size_t l = 0; l < ldofs.size(); ++l) {
+        normals[g].x += elementNormals(0, ldofs[l].entityIndex);
+        normals[g].y += elementNormals(1, ldofs[l].entityIndex);
+      }
+      normals[g].x /= ldofs.size();
+      normals[g].y /= ldofs.size();
+    }
+  else // gridDim == 2
+    for (size_t g = 0; g < globalDofCount_; ++g) {
+      const auto &ldofs = global2localDofs[g];
+      normals[g].x = 0.;
+      normals[g].y = 0.;
+      normals[g].z = 0.;
+      for (size_t l = 0; l < ldofs.size(); ++l) {
+        normals[g].x += elementNormals(0, ldofs[l].entityIndex);
+        normals[g].y += elementNormals(1, ldofs[l].entityIndex);
+        normals[g].z += elementNormals(2, ldofs[l].entityIndex);
+      }
+      normals[g].x /= ldofs.size();
+      normals[g].y /= ldofs.size();
+      normals[g].z /= ldofs.size();
+    }
+}
+
+template <typename Local2GlobalDofs>
+void initializeLocal2FlatLocalDofMapImpl(
+    size_t flatLocalDofCount, const Local2GlobalDofs &local2globalDofs,
+    std::vector<LocalDof> &flatLocal2localDofs) {
+  flatLocal2localDofs.clear();
+  flatLocal2localDofs.reserve(flatLocalDofCount);
+  for (size_t e = 0; e < local2globalDofs.size(); ++e) {
+    const auto &globalDofs = local2globalDofs[e];
+    for (size_t dof = 0; dof < globalDofs.size(); ++dof)
+      if (globalDofs[dof] >= 0)
+        flatLocal2localDofs.push_back(LocalDof(e, dof));
+  }
+}
+
+} // namespace
+
 template <typename BasisFunctionType>
 void SpaceHelper<BasisFunctionType>::
     getGlobalDofInterpolationPoints_defaultImplementation(
@@ -80,48 +219,66 @@ SpaceHelper<BasisFunctionType>::getGlobalDofBoundingBoxes_defaultImplementation(
     const GridView &view,
     const std::vector<std::vector<LocalDof>> &global2localDofs,
     std::vector<BoundingBox<CoordinateType>> &bboxes) {
-  const IndexSet &indexSet = view.indexSet();
-  const int elementCount = view.entityCount(0);
-
-  std::vector<arma::Mat<CoordinateType>> elementCorners(elementCount);
-  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
-  while (!it->finished()) {
-    const Entity<0> &e = it->entity();
-    int index = indexSet.entityIndex(e);
-    const Geometry &geo = e.geometry();
-    geo.getCorners(acc(elementCorners, index));
-    it->next();
-  }
+  std::vector<arma::Mat<CoordinateType>> elementCorners;
+  getElementCorners(view, elementCorners);
 
-  BoundingBox<CoordinateType> model;
-  const CoordinateType maxCoord = std::numeric_limits<CoordinateType>::max();
-  model.lbound.x = model.lbound.y = model.lbound.z = maxCoord;
-  model.ubound.x = model.ubound.y = model.ubound.z = -maxCoord;
+  const size_t globalDofCount_ = global2localDofs.size();
+  bboxes.resize(globalDofCount_);
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, globalDofCount_),
+      [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          const std::vector<LocalDof> &localDofs = acc(global2localDofs, i);
+          BoundingBox<CoordinateType> &bbox = acc(bboxes, i);
+          bbox = emptyBoundingBox<CoordinateType>();
+          for (int j = 0; j < localDofs.size(); ++j)
+            extendBoundingBox(
+                bbox, acc(elementCorners, acc(localDofs, j).entityIndex));
+          assert(!localDofs.empty());
+          setBoundingBoxReference<CoordinateType>(
+              bbox, acc(elementCorners, localDofs[0].entityIndex)
+                        .col(localDofs[0].dofIndex));
+        }
+      });
 
-  const int globalDofCount_ = global2localDofs.size();
-  bboxes.resize(globalDofCount_, model);
-  for (int i = 0; i < globalDofCount_; ++i) {
-    const std::vector<LocalDof> &localDofs = acc(global2localDofs, i);
-    BoundingBox<CoordinateType> &bbox = acc(bboxes, i);
-    for (int j = 0; j < localDofs.size(); ++j)
-      extendBoundingBox(bbox,
-                        acc(elementCorners, acc(localDofs, j).entityIndex));
-    assert(!localDofs.empty());
-    setBoundingBoxReference<CoordinateType>(
-        bbox, acc(elementCorners, localDofs[0].entityIndex)
-                  .col(localDofs[0].dofIndex));
-  }
+  checkBoundingBoxReferences(bboxes);
+}
 
-#ifndef NDEBUG
-  for (size_t i = 0; i < globalDofCount_; ++i) {
-    assert(bboxes[i].reference.x >= bboxes[i].lbound.x);
-    assert(bboxes[i].reference.y >= bboxes[i].lbound.y);
-    assert(bboxes[i].reference.z >= bboxes[i].lbound.z);
-    assert(bboxes[i].reference.x <= bboxes[i].ubound.x);
-    assert(bboxes[i].reference.y <= bboxes[i].ubound.y);
-    assert(bboxes[i].reference.z <= bboxes[i].ubound.z);
-  }
-#endif // NDEBUG
+template <typename BasisFunctionType>
+void SpaceHelper<BasisFunctionType>::
+    getFlatLocalDofBoundingBoxes_defaultImplementation(
+        const GridView &view, const std::vector<LocalDof> &flatLocal2localDofs,
+        std::vector<BoundingBox<CoordinateType>> &bboxes) {
+  std::vector<arma::Mat<CoordinateType>> elementCorners;
+  getElementCorners(view, elementCorners);
+
+  const size_t flatLocalDofCount_ = flatLocal2localDofs.size();
+  bboxes.resize(flatLocalDofCount_);
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, flatLocalDofCount_),
+      [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          const LocalDof &localDof = acc(flatLocal2localDofs, i);
+          const arma::Mat<CoordinateType> &corners =
+              acc(elementCorners, localDof.entityIndex);
+          BoundingBox<CoordinateType> &bbox = acc(bboxes, i);
+          bbox = emptyBoundingBox<CoordinateType>();
+          extendBoundingBox(bbox, corners);
+          setBoundingBoxReference<CoordinateType>(
+              bbox, corners.col(localDof.dofIndex));
+        }
+      });
+
+  checkBoundingBoxReferences(bboxes);
+}
+
+template <typename BasisFunctionType>
+void SpaceHelper<BasisFunctionType>::getDofPositions_defaultImplementation(
+    const std::vector<BoundingBox<CoordinateType>> &bboxes,
+    std::vector<Point3D<CoordinateType>> &positions) {
+  positions.resize(bboxes.size());
+  for (size_t i = 0; i < positions.size(); ++i)
+    positions[i] = bboxes[i].reference;
 }
 
 template <typename BasisFunctionType>
@@ -129,57 +286,75 @@ void SpaceHelper<BasisFunctionType>::getGlobalDofNormals_defaultImplementation(
     const GridView &view,
     const std::vector<std::vector<LocalDof>> &global2localDofs,
     std::vector<Point3D<CoordinateType>> &normals) {
-  const int gridDim = view.dim();
-  const int globalDofCount_ = global2localDofs.size();
-  const int worldDim = view.dimWorld();
-  normals.resize(globalDofCount_);
+  getGlobalDofNormalsImpl(view, global2localDofs, normals);
+}
+
+template <typename BasisFunctionType>
+void SpaceHelper<BasisFunctionType>::getGlobalDofNormals_defaultImplementation(
+    const GridView &view, const CompressedDofTable<LocalDof> &global2localDofs,
+    std::vector<Point3D<CoordinateType>> &normals) {
+  getGlobalDofNormalsImpl(view, global2localDofs, normals);
+}
 
-  const IndexSet &indexSet = view.indexSet();
-  int elementCount = view.entityCount(0);
+template <typename BasisFunctionType>
+void SpaceHelper<BasisFunctionType>::sortGlobalDofsAlongSpaceFillingCurve(
+    const std::vector<Point3D<CoordinateType>> &positions,
+    std::vector<std::vector<GlobalDofIndex>> &local2globalDofs,
+    std::vector<std::vector<LocalDof>> &global2localDofs) {
+  const size_t globalDofCount_ = global2localDofs.size();
+  if (positions.size() != globalDofCount_)
+    throw std::invalid_argument(
+        "SpaceHelper::sortGlobalDofsAlongSpaceFillingCurve(): "
+        "the number of positions must match the number of global DOFs");
+  if (globalDofCount_ == 0)
+    return;
 
-  arma::Mat<CoordinateType> elementNormals(worldDim, elementCount);
-  std::unique_ptr<EntityIterator<0>> it = view.entityIterator<0>();
-  arma::Col<CoordinateType> center(gridDim);
-  // Note: we assume here that elements are flat and so the position at which
-  // the normal is calculated does not matter.
-  center.fill(0.5);
-  arma::Col<CoordinateType> normal;
-  while (!it->finished()) {
-    const Entity<0> &e = it->entity();
-    int index = indexSet.entityIndex(e);
-    e.geometry().getNormals(center, normal);
-
-    for (int dim = 0; dim < worldDim; ++dim)
-      elementNormals(dim, index) = normal(dim);
-    it->next();
+  // Quantise the positions on a grid of 2^21 points per direction spanning
+  // the bounding box of all DOFs
+  Point3D<CoordinateType> lbound = positions[0], ubound = positions[0];
+  for (size_t i = 1; i < globalDofCount_; ++i) {
+    lbound.x = std::min(lbound.x, positions[i].x);
+    lbound.y = std::min(lbound.y, positions[i].y);
+    lbound.z = std::min(lbound.z, positions[i].z);
+    ubound.x = std::max(ubound.x, positions[i].x);
+    ubound.y = std::max(ubound.y, positions[i].y);
+    ubound.z = std::max(ubound.z, positions[i].z);
   }
+  const CoordinateType extent = std::max(
+      std::max(ubound.x - lbound.x, ubound.y - lbound.y), ubound.z - lbound.z);
+  const CoordinateType maxCoord = (1 << 21) - 1;
+  const CoordinateType scale = extent > 0 ? maxCoord / extent : 0;
 
-  if (gridDim == 1)
-    for (size_t g = 0; g < globalDofCount_; ++g) {
-      const std::vector<LocalDof> &ldofs = acc(global2localDofs, g);
-      normals[g].x = 0.;
-      normals[g].y = 0.;
-      for (size_t l = 0; l < ldofs.size(); ++l) {
-        normals[g].x += elementNormals(0, acc(ldofs, l).entityIndex);
-        normals[g].y += elementNormals(1, acc(ldofs, l).entityIndex);
-      }
-      normals[g].x /= ldofs.size();
-      normals[g].y /= ldofs.size();
-    }
-  else // gridDim == 2
-    for (size_t g = 0; g < globalDofCount_; ++g) {
-      const std::vector<LocalDof> &ldofs = acc(global2localDofs, g);
-      normals[g].x = 0.;
-      normals[g].y = 0.;
-      normals[g].z = 0.;
-      for (size_t l = 0; l < ldofs.size(); ++l) {
-        normals[g].x += elementNormals(0, acc(ldofs, l).entityIndex);
-        normals[g].y += elementNormals(1, acc(ldofs, l).entityIndex);
-        normals[g].z += elementNormals(2, acc(ldofs, l).entityIndex);
-      }
-      normals[g].x /= ldofs.size();
-      normals[g].y /= ldofs.size();
-      normals[g].z /= ldofs.size();
+  std::vector<uint64_t> keys(globalDofCount_);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, globalDofCount_),
+                    [&](const tbb::blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+      keys[i] = mortonKey((positions[i].x - lbound.x) * scale,
+                          (positions[i].y - lbound.y) * scale,
+                          (positions[i].z - lbound.z) * scale);
+  });
+
+  // newToOld[n] is the original index of the DOF that becomes the nth one
+  std::vector<GlobalDofIndex> newToOld(globalDofCount_);
+  std::iota(newToOld.begin(), newToOld.end(), 0);
+  std::stable_sort(newToOld.begin(), newToOld.end(),
+                   [&keys](GlobalDofIndex a, GlobalDofIndex b) {
+    return keys[a] < keys[b];
+  });
+  std::vector<GlobalDofIndex> oldToNew(globalDofCount_);
+  for (size_t n = 0; n < globalDofCount_; ++n)
+    oldToNew[newToOld[n]] = n;
+
+  std::vector<std::vector<LocalDof>> sortedGlobal2localDofs(globalDofCount_);
+  for (size_t n = 0; n < globalDofCount_; ++n)
+    sortedGlobal2localDofs[n].swap(global2localDofs[newToOld[n]]);
+  global2localDofs.swap(sortedGlobal2localDofs);
+
+  for (size_t e = 0; e < local2globalDofs.size(); ++e)
+    for (size_t dof = 0; dof < local2globalDofs[e].size(); ++dof) {
+      GlobalDofIndex &globalDof = local2globalDofs[e][dof];
+      if (globalDof >= 0)
+        globalDof = oldToNew[globalDof];
     }
 }
 
@@ -188,12 +363,17 @@ void SpaceHelper<BasisFunctionType>::initializeLocal2FlatLocalDofMap(
     size_t flatLocalDofCount,
     const std::vector<std::vector<GlobalDofIndex>> &local2globalDofs,
     std::vector<LocalDof> &flatLocal2localDofs) {
-  flatLocal2localDofs.clear();
-  flatLocal2localDofs.reserve(flatLocalDofCount);
-  for (size_t e = 0; e < local2globalDofs.size(); ++e)
-    for (size_t dof = 0; dof < acc(local2globalDofs, e).size(); ++dof)
-      if (acc(acc(local2globalDofs, e), dof) >= 0)
-        flatLocal2localDofs.push_back(LocalDof(e, dof));
+  initializeLocal2FlatLocalDofMapImpl(flatLocalDofCount, local2globalDofs,
+                                      flatLocal2localDofs);
+}
+
+template <typename BasisFunctionType>
+void SpaceHelper<BasisFunctionType>::initializeLocal2FlatLocalDofMap(
+    size_t flatLocalDofCount,
+    const CompressedDofTable<GlobalDofIndex> &local2globalDofs,
+    std::vector<LocalDof> &flatLocal2localDofs) {
+  initializeLocal2FlatLocalDofMapImpl(flatLocalDofCount, local2globalDofs,
+                                      flatLocal2localDofs);
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(SpaceHelper);
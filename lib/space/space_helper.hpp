@@ -34,6 +34,7 @@ class GridView;
 struct LocalDof;
 template <typename CoordinateType> struct BoundingBox;
 template <typename BasisFunctionType> class Space;
+template <typename T> class CompressedDofTable;
 
 template <typename BasisFunctionType> class SpaceHelper {
 public:
@@ -51,15 +52,43 @@ public:
       const std::vector<std::vector<LocalDof>> &global2localDofs,
       std::vector<BoundingBox<CoordinateType>> &bboxes);
 
+  static void getFlatLocalDofBoundingBoxes_defaultImplementation(
+      const GridView &view, const std::vector<LocalDof> &flatLocal2localDofs,
+      std::vector<BoundingBox<CoordinateType>> &bboxes);
+
+  static void getDofPositions_defaultImplementation(
+      const std::vector<BoundingBox<CoordinateType>> &bboxes,
+      std::vector<Point3D<CoordinateType>> &positions);
+
   static void getGlobalDofNormals_defaultImplementation(
       const GridView &view,
       const std::vector<std::vector<LocalDof>> &global2localDofs,
       std::vector<Point3D<CoordinateType>> &normals);
+  static void getGlobalDofNormals_defaultImplementation(
+      const GridView &view,
+      const CompressedDofTable<LocalDof> &global2localDofs,
+      std::vector<Point3D<CoordinateType>> &normals);
+
+  /** \brief Renumber global DOFs along a space-filling curve.
+   *
+   *  Sort the global DOFs along a Morton (Z-order) curve through their
+   *  reference positions \p positions and update \p local2globalDofs and
+   *  \p global2localDofs accordingly. Negative entries of
+   *  \p local2globalDofs (local DOFs not mapped to any global DOF) are left
+   *  untouched. */
+  static void sortGlobalDofsAlongSpaceFillingCurve(
+      const std::vector<Point3D<CoordinateType>> &positions,
+      std::vector<std::vector<GlobalDofIndex>> &local2globalDofs,
+      std::vector<std::vector<LocalDof>> &global2localDofs);
 
   static void initializeLocal2FlatLocalDofMap(
       size_t flatLocalDofCount,
       const std::vector<std::vector<GlobalDofIndex>> &local2globalDofs,
       std::vector<LocalDof> &flatLocal2localDofs);
+  static void initializeLocal2FlatLocalDofMap(
+      size_t flatLocalDofCount,
+      const CompressedDofTable<GlobalDofIndex> &local2globalDofs,
+      std::vector<LocalDof> &flatLocal2localDofs);
 };
 
 } // namespace Bempp
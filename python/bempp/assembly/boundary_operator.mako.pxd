@@ -45,7 +45,9 @@ cdef extern from "bempp/assembly/py_boundary_operator_variants.hpp" namespace "B
         SpaceVariants domain() except+catch_exception
         string label() const
 
-    cdef shared_ptr[c_DiscreteBoundaryOperator[ResultType]] _boundary_operator_variant_weak_form "Bempp::boundary_op_variant_weak_form" [BasisFunctionType,ResultType] (const BoundaryOpVariants& variant)
+
+cdef extern from "bempp/assembly/py_boundary_operator_variants.hpp" namespace "Bempp" nogil:
+    cdef shared_ptr[c_DiscreteBoundaryOperator[ResultType]] _boundary_operator_variant_weak_form "Bempp::boundary_op_variant_weak_form" [BasisFunctionType,ResultType] (const BoundaryOpVariants& variant) except+catch_exception
 
 cdef extern from "bempp/assembly/py_discrete_operator_support.hpp" namespace "Bempp":
     cdef object py_get_sparse_from_discrete_operator[VALUE](shared_ptr[c_DiscreteBoundaryOperator[VALUE]])
@@ -58,6 +60,7 @@ cdef class GeneralBoundaryOperator(BoundaryOperatorBase):
     cdef BoundaryOpVariants impl_
     cdef ParameterList _parameters
     cdef cbool _is_sparse
+    cdef object _assemble_weak_form(self, DiscreteBoundaryOperator dbop)
 
 cdef class DenseBoundaryOperator(GeneralBoundaryOperator):
     pass
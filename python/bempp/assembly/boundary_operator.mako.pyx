@@ -174,20 +174,7 @@ cdef class GeneralBoundaryOperator(BoundaryOperatorBase):
 
     def _dense_weak_form(self):
 
-        cdef DenseDiscreteBoundaryOperator dbop = DenseDiscreteBoundaryOperator()
-        
-% for pybasis,cybasis in dtypes.items():
-%     for pyresult,cyresult in dtypes.items():
-%         if pyresult in compatible_dtypes[pybasis]:
-
-        if self.basis_type=="${pybasis}" and self.result_type=="${pyresult}":
-            dbop._impl_${pyresult}_.assign(_boundary_operator_variant_weak_form[${cybasis},${cyresult}](self.impl_))
-            dbop._dtype = self.result_type
-            return dbop
-%          endif
-%      endfor
-% endfor
-        raise ValueError("Incompatible basis and result types") 
+        return self._assemble_weak_form(DenseDiscreteBoundaryOperator())
 
     def _hmat_weak_form(self):
 
@@ -195,14 +182,24 @@ cdef class GeneralBoundaryOperator(BoundaryOperatorBase):
 
     def _default_weak_form(self):
 
-        cdef DiscreteBoundaryOperator dbop = DiscreteBoundaryOperator()
+        return self._assemble_weak_form(DiscreteBoundaryOperator())
+
+    cdef object _assemble_weak_form(self, DiscreteBoundaryOperator dbop):
+
+% for pyresult,cyresult in dtypes.items():
+        cdef shared_ptr[c_DiscreteBoundaryOperator[${cyresult}]] weak_form_${pyresult}
+% endfor
         
 % for pybasis,cybasis in dtypes.items():
 %     for pyresult,cyresult in dtypes.items():
 %         if pyresult in compatible_dtypes[pybasis]:
 
         if self.basis_type=="${pybasis}" and self.result_type=="${pyresult}":
-            dbop._impl_${pyresult}_.assign(_boundary_operator_variant_weak_form[${cybasis},${cyresult}](self.impl_))
+            # The assembly does not call back into Python, so other Python
+            # threads can run in the meantime
+            with nogil:
+                weak_form_${pyresult} = _boundary_operator_variant_weak_form[${cybasis},${cyresult}](self.impl_)
+            dbop._impl_${pyresult}_.assign(weak_form_${pyresult})
             dbop._dtype = self.result_type
             return dbop
 %          endif
@@ -3,13 +3,14 @@ from data_types import dtypes, scalar_cython_type
 %>
 
 from bempp.utils.armadillo cimport Mat
+from libcpp.string cimport string
 from bempp.utils.enum_types cimport TranspositionMode
 from bempp.utils cimport shared_ptr
 from bempp.utils cimport complex_float,complex_double
 cimport numpy as np
 
 
-cdef extern from "bempp/assembly/discrete_boundary_operator.hpp" namespace "Bempp":
+cdef extern from "bempp/assembly/discrete_boundary_operator.hpp" namespace "Bempp" nogil:
     cdef cppclass c_DiscreteBoundaryOperator "Bempp::DiscreteBoundaryOperator"[ValueType]:
         
         void apply(const TranspositionMode trans, const Mat[ValueType]& x_in,
@@ -22,6 +23,7 @@ cdef extern from "bempp/assembly/discrete_boundary_operator.hpp" namespace "Bemp
 
 cdef extern from "bempp/assembly/py_discrete_operator_support.hpp" namespace "Bempp":
     cdef object py_array_from_dense_operator[VALUE](const shared_ptr[const c_DiscreteBoundaryOperator[VALUE]]&)
+    cdef string py_assembly_report_json[VALUE](const shared_ptr[const c_DiscreteBoundaryOperator[VALUE]]&)
 
 cdef class DiscreteBoundaryOperatorBase:
     cdef object _dtype
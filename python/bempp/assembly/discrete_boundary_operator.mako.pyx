@@ -16,8 +16,10 @@ from bempp.utils.armadillo cimport armadillo_to_np_${pyvalue}
 from bempp.utils import combined_type
 cimport numpy as np
 import numpy as np
+import json
 cimport cython
 from libcpp cimport bool
+from libcpp.string cimport string
 
 
 cdef class DiscreteBoundaryOperatorBase:
@@ -143,6 +145,26 @@ cdef class DiscreteBoundaryOperator(DiscreteBoundaryOperatorBase):
                 return (rows,cols)
 % endfor
             raise ValueError("Unknown value type")
+
+    property assembly_report:
+        """ Record of the assembly of the operator as a dictionary, or None
+
+        The record is available for the weak forms of elementary integral
+        operators. It holds the wall-clock and CPU times of the assembly
+        phases, the numbers of singular, near and far element pairs
+        integrated with each quadrature rule, the number of cache hits,
+        the storage size in bytes and the number of threads used. """
+
+        def __get__(self):
+            cdef string report
+
+% for pyvalue,cyvalue in dtypes.items():
+            if self.dtype=="${pyvalue}":
+                report = py_assembly_report_json[${cyvalue}](self._impl_${pyvalue}_)
+% endfor
+            if report.empty():
+                return None
+            return json.loads(report.decode())
     
     def as_matrix(self):
 
@@ -158,7 +180,9 @@ cdef class DiscreteBoundaryOperator(DiscreteBoundaryOperatorBase):
 % for pyvalue,cyvalue in dtypes.items():
     cdef np.ndarray _as_matrix_${pyvalue}(self):
 
-        cdef Mat[${cyvalue}] mat_data = deref(self._impl_${pyvalue}_).asMatrix()
+        cdef Mat[${cyvalue}] mat_data
+        with nogil:
+            mat_data = deref(self._impl_${pyvalue}_).asMatrix()
         return armadillo_to_np_${pyvalue}(mat_data)
 
 % endfor
@@ -254,13 +278,16 @@ cdef class DiscreteBoundaryOperator(DiscreteBoundaryOperatorBase):
         cdef ${cyvalue} cpp_beta = beta
 % endif
 
+        # The Armadillo matrices use the memory of the arrays, which stay
+        # alive while the GIL is released
         arma_${pyvalue}_buff_x = new Mat[${cyvalue}](<${cyvalue}*>&x_in[0,0],xrows,xcols,False,True)
         arma_${pyvalue}_buff_y = new Mat[${cyvalue}](<${cyvalue}*>&y_inout[0,0],yrows,ycols,False,True)
 
-        deref(self._impl_${pyvalue}_).apply(trans,
-                deref(arma_${pyvalue}_buff_x),
-                deref(arma_${pyvalue}_buff_y),
-                cpp_alpha,cpp_beta)
+        with nogil:
+            deref(self._impl_${pyvalue}_).apply(trans,
+                    deref(arma_${pyvalue}_buff_x),
+                    deref(arma_${pyvalue}_buff_y),
+                    cpp_alpha,cpp_beta)
 
         del arma_${pyvalue}_buff_y
         del arma_${pyvalue}_buff_x
@@ -34,6 +34,8 @@ cdef extern from "bempp/assembly/grid_function.hpp" namespace "Bempp":
                         const c_Function[RESULT]& function,
                         ConstructionMode constructionMde) except+catch_exception
 
+        c_GridFunction(const c_GridFunction[BASIS,RESULT]& other)
+
  
 % for pybasis,cybasis in dtypes.items():
 %     for pyresult,cyresult in dtypes.items():
@@ -46,7 +48,9 @@ cdef extern from "bempp/assembly/grid_function.hpp" namespace "Bempp":
 
         const Col[RESULT]& coefficients() except+catch_exception
         void setCoefficients(const Col[RESULT]& coeffs) except+catch_exception
-        Col[RESULT] projections(const shared_ptr[const c_Space[BASIS]] &dualSpace)        
+        const Col[RESULT]& projections(const shared_ptr[const c_Space[BASIS]] &dualSpace) except+catch_exception
+        void axpy(RESULT alpha, const c_GridFunction[BASIS,RESULT]& other) except+catch_exception
+        void scale(RESULT alpha) except+catch_exception
 
     
 cdef extern from "bempp/assembly/py_functors.hpp" namespace "Bempp":
@@ -54,6 +58,9 @@ cdef extern from "bempp/assembly/py_functors.hpp" namespace "Bempp":
     cdef shared_ptr[c_Function[${cyvalue}]] _py_surface_normal_dependent_function_${pyvalue} "Bempp::_py_surface_normal_dependent_function<${ctypes(cyvalue)}>"(
             void (*callable)(object,object,int, object, object),object,
             int argumentDimension, int resultDimension) except+catch_exception
+    cdef shared_ptr[c_Function[${cyvalue}]] _py_vectorized_surface_normal_dependent_function_${pyvalue} "Bempp::_py_vectorized_surface_normal_dependent_function<${ctypes(cyvalue)}>"(
+            void (*callable)(object,object,int, object, object),object,
+            int argumentDimension, int resultDimension) except+catch_exception
 % endfor
 
 cdef class GridFunction:
@@ -62,6 +69,11 @@ cdef class GridFunction:
     cdef Space _space,
     cdef ParameterList _parameter_list
 
+    cdef GridFunction _copy(self)
+    cdef bint _can_combine_with(self, GridFunction other, object alpha)
+    cdef void _scale(self, object alpha) except *
+    cdef void _axpy(self, object alpha, GridFunction other) except *
+
 % for pybasis,cybasis in dtypes.items():
 %     for pyresult,cyresult in dtypes.items():
 %         if pyresult in compatible_dtypes[pybasis]:
@@ -52,6 +52,16 @@ cdef class GridFunction:
 
        If the input function returns complex data the keyword argument 
        'complex=True' needs to be specified in the contructor of the GridFunction.    
+
+       If the keyword argument 'vectorized=True' is given, the callable is
+       instead called with all quadrature points of a batch of elements at
+       once: x and n are then arrays of shape (3, N), result has shape
+       (codomain_dimension, N) and all points lie in the subdomain
+       domain_index. This avoids one Python call per quadrature point.::
+
+            fun(x,n,domain_index,result):
+                result[0,:] = np.sum(x*n,axis=0)
+
     2. By providing a vector of coefficients at the nodes. This is preferable if
        the coefficients of the data are coming from an external code.
 
@@ -70,6 +80,9 @@ cdef class GridFunction:
     fun : callable
         A Python function from which the GridFunction is constructed
         (optional).
+    vectorized : bool
+        Specify whether fun accepts arrays of points (optional, default
+        False).
     coefficients : np.ndarray
         A 1-dimensional array with the coefficients of the GridFunction
         at the interpolatoin points of the space (optional).
@@ -134,6 +147,7 @@ cdef class GridFunction:
 % for pyvalue,cyvalue in dtypes.items():
         cdef Col[${cyvalue}]* arma_data_${pyvalue}
         cdef ${scalar_cython_type(cyvalue)} [::1] data_view_${pyvalue}
+        cdef shared_ptr[c_Function[${cyvalue}]] fun_${pyvalue}
 % endfor
 
         if 'parameter_list' in kwargs:
@@ -167,12 +181,17 @@ cdef class GridFunction:
 %     for pyresult,cyresult in dtypes.items():
 %         if pyresult in compatible_dtypes[pybasis]:
             if (self._basis_type=="${pybasis}") and (self._result_type=="${pyresult}"):
+                if kwargs.get('vectorized',False):
+                    fun_${pyresult} = _py_vectorized_surface_normal_dependent_function_${pyresult}(
+                            _fun_interface,kwargs['fun'],3,self._space.codomain_dimension)
+                else:
+                    fun_${pyresult} = _py_surface_normal_dependent_function_${pyresult}(
+                            _fun_interface,kwargs['fun'],3,self._space.codomain_dimension)
                 self._impl_${pybasis}_${pyresult}.reset(
                         new c_GridFunction[${cybasis},${cyresult}](deref((<ParameterList>self.parameter_list).impl_),
                         _py_get_space_ptr[${cybasis}](self._space.impl_),
                         _py_get_space_ptr[${cybasis}]((<Space>kwargs['dual_space']).impl_),
-                        deref(_py_surface_normal_dependent_function_${pyresult}(_fun_interface,kwargs['fun'],3,
-                            self._space.codomain_dimension)),
+                        deref(fun_${pyresult}),
                         construction_mode(approx_mode)))
 %         endif
 %     endfor
@@ -195,7 +214,7 @@ cdef class GridFunction:
                 num_entries = kwargs['projections'].shape[0]
                 data_view_${pyresult} = np.require(kwargs['projections'],
                         "${pyresult}","F")
-                arma_data_${pyresult} = new Col[${cyresult}](<${cyresult}*>&data_view_${pyresult}[0],num_entries,True,False)
+                arma_data_${pyresult} = new Col[${cyresult}](<${cyresult}*>&data_view_${pyresult}[0],num_entries,False,True)
 
                 self._impl_${pybasis}_${pyresult}.reset(
                         new c_GridFunction[${cybasis},${cyresult}](deref((<ParameterList>self.parameter_list).impl_),
@@ -221,7 +240,7 @@ cdef class GridFunction:
                 num_entries = kwargs['coefficients'].shape[0]
                 data_view_${pyresult} = np.require(kwargs['coefficients'],
                         "${pyresult}","F")
-                arma_data_${pyresult} = new Col[${cyresult}](<${cyresult}*>&data_view_${pyresult}[0],num_entries,True,False)
+                arma_data_${pyresult} = new Col[${cyresult}](<${cyresult}*>&data_view_${pyresult}[0],num_entries,False,True)
 
                 self._impl_${pybasis}_${pyresult}.reset(
                         new c_GridFunction[${cybasis},${cyresult}](deref((<ParameterList>self.parameter_list).impl_),
@@ -313,15 +332,68 @@ cdef class GridFunction:
 %      endfor
 %  endfor
 
-    def __add__(self,GridFunction other):
+    cdef GridFunction _copy(self):
+        """ Return a GridFunction sharing the vectors of self until either
+            of them is modified in place. """
 
-        if not self.space.is_compatible(other.space):
-            raise ValueError("Spaces do not match")
+        cdef GridFunction result = GridFunction.__new__(GridFunction, self._space)
+        result._space = self._space
+        result._basis_type = self._basis_type
+        result._result_type = self._result_type
+        result._parameter_list = self._parameter_list
+% for pybasis,cybasis in dtypes.items():
+%     for pyresult,cyresult in dtypes.items():
+%         if pyresult in compatible_dtypes[pybasis]:
+        if (self._basis_type=="${pybasis}") and (self._result_type=="${pyresult}"):
+            result._impl_${pybasis}_${pyresult}.reset(
+                    new c_GridFunction[${cybasis},${cyresult}](deref(self._impl_${pybasis}_${pyresult})))
+%         endif
+%     endfor
+% endfor
+        return result
 
-        return GridFunction(self.space,
-                coefficients=self.coefficients+other.coefficients,
-                parameter_list=self.parameter_list)
+    cdef bint _can_combine_with(self, GridFunction other, object alpha):
+        """ Return whether alpha*other can be added to self in C++. """
+
+        return (other._space is self._space and
+                other._basis_type == self._basis_type and
+                other._result_type == self._result_type and
+                (self._result_type.kind == 'c' or not np.iscomplexobj(alpha)))
+
+    cdef void _scale(self, object alpha) except *:
+% for pybasis,cybasis in dtypes.items():
+%     for pyresult,cyresult in dtypes.items():
+%         if pyresult in compatible_dtypes[pybasis]:
+        if (self._basis_type=="${pybasis}") and (self._result_type=="${pyresult}"):
+%             if 'complex' in cyresult:
+            deref(self._impl_${pybasis}_${pyresult}).scale(
+                    ${cyresult}(np.real(alpha),np.imag(alpha)))
+%             else:
+            deref(self._impl_${pybasis}_${pyresult}).scale(alpha)
+%             endif
+%         endif
+%     endfor
+% endfor
+
+    cdef void _axpy(self, object alpha, GridFunction other) except *:
+% for pybasis,cybasis in dtypes.items():
+%     for pyresult,cyresult in dtypes.items():
+%         if pyresult in compatible_dtypes[pybasis]:
+        if (self._basis_type=="${pybasis}") and (self._result_type=="${pyresult}"):
+%             if 'complex' in cyresult:
+            deref(self._impl_${pybasis}_${pyresult}).axpy(
+                    ${cyresult}(np.real(alpha),np.imag(alpha)),
+                    deref(other._impl_${pybasis}_${pyresult}))
+%             else:
+            deref(self._impl_${pybasis}_${pyresult}).axpy(
+                    alpha,deref(other._impl_${pybasis}_${pyresult}))
+%             endif
+%         endif
+%     endfor
+% endfor
 
+    def __add__(self,GridFunction other):
+        return linear_combination([1.0,1.0],[self,other])
 
     def __mul__(self,object alpha):
 
@@ -329,18 +401,36 @@ cdef class GridFunction:
             return alpha*self
 
         if np.isscalar(alpha):
-            return GridFunction(self.space,
-                    coefficients=alpha*self.coefficients,
-                    parameter_list=self.parameter_list)
+            return linear_combination([alpha],[self])
         else:
             raise NotImplementedError("Cannot multiply Gridfunction with object of type "+str(type(alpha)))
 
     def __neg__(self):
-
-        return self.__mul__(-1.0)
+        return linear_combination([-1.0],[self])
 
     def __sub__(self,GridFunction other):
-        return self.__add__(-other)
+        return linear_combination([1.0,-1.0],[self,other])
+
+    def __iadd__(self,GridFunction other):
+
+        if not self._can_combine_with(other,1.0):
+            return self+other
+        self._axpy(1.0,other)
+        return self
+
+    def __isub__(self,GridFunction other):
+
+        if not self._can_combine_with(other,1.0):
+            return self-other
+        self._axpy(-1.0,other)
+        return self
+
+    def __imul__(self,object alpha):
+
+        if not np.isscalar(alpha) or not self._can_combine_with(self,alpha):
+            return self*alpha
+        self._scale(alpha)
+        return self
 
     property coefficients:
         """ Return or set the vector of coefficients. """
@@ -423,3 +513,50 @@ cdef class GridFunction:
 
         def __get__(self):
             return self._result_type
+
+
+def linear_combination(weights, grid_functions):
+    """
+
+    Return the GridFunction sum(w*f for w,f in zip(weights,grid_functions)).
+
+    The sum is evaluated in C++ without creating intermediate GridFunctions
+    and, where possible, without converting between coefficients and
+    projections. This is cheaper than the equivalent chain of + and *
+    operations, e.g. when computing residuals.
+
+    Parameters
+    ----------
+    weights : sequence of scalars
+        The weights of the functions.
+    grid_functions : sequence of bempp.GridFunction
+        The functions to combine. They must be defined over compatible
+        spaces.
+
+    """
+
+    cdef GridFunction first
+    cdef GridFunction result
+    cdef GridFunction f
+
+    if len(weights)!=len(grid_functions) or len(grid_functions)==0:
+        raise ValueError("weights and grid_functions must be nonempty and of the same length")
+
+    first = grid_functions[0]
+    fused = True
+    for w,f in zip(weights,grid_functions):
+        if not first.space.is_compatible(f.space):
+            raise ValueError("Spaces do not match")
+        fused = fused and first._can_combine_with(f,w)
+
+    if not fused:
+        # Mixed types: let numpy determine the result type
+        return GridFunction(first.space,
+                coefficients=sum(w*f.coefficients for w,f in zip(weights,grid_functions)),
+                parameter_list=first.parameter_list)
+
+    result = first._copy()
+    result._scale(weights[0])
+    for w,f in zip(weights[1:],grid_functions[1:]):
+        result._axpy(w,f)
+    return result
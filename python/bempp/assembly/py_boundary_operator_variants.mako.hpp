@@ -193,6 +193,10 @@ class BoundaryOpVariants {
         friend shared_ptr<const DiscreteBoundaryOperator<ResultType>>
         boundary_op_variant_weak_form(const BoundaryOpVariants& variant);
 
+        template<typename BasisFunctionType,typename ResultType>
+        friend const BoundaryOperator<BasisFunctionType,ResultType>&
+        boundary_op_variant_operator(const BoundaryOpVariants& variant);
+
         t_variant operator_;
 };
 #   undef BEMPP_EXPLICIT_CONSTRUCTOR
@@ -206,6 +210,15 @@ boundary_op_variant_weak_form(const BoundaryOpVariants& variant)
             variant.operator_).weakForm();
 }
 
+template<typename BasisFunctionType,typename ResultType>
+const BoundaryOperator<BasisFunctionType,ResultType>&
+boundary_op_variant_operator(const BoundaryOpVariants& variant)
+{
+
+    return boost::get<BoundaryOperator<BasisFunctionType,ResultType>>(
+            variant.operator_);
+}
+
 
 }
 #endif
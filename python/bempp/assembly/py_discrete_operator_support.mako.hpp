@@ -1,6 +1,7 @@
 #ifndef BEMPP_PYTHON_DISCRETE_OPERATOR_SUPPORT_HPP
 #define BEMPP_PYTHON_DISCRETE_OPERATOR_SUPPORT_HPP
 
+#include "bempp/assembly/assembly_report.hpp"
 #include "bempp/assembly/boundary_operator.hpp"
 #include "bempp/utils/py_types.hpp"
 #include "bempp/space/py_space_variants.hpp"
@@ -12,6 +13,8 @@
 #include "numpy/arrayobject.h"
 #include "Epetra_CrsMatrix.h"
 #include <boost/variant.hpp>
+#include <sstream>
+#include <string>
 #include <type_traits>
 
 
@@ -114,6 +117,17 @@ PyObject* py_array_from_dense_operator(const shared_ptr<const DiscreteBoundaryOp
             const DiscreteBoundaryOperator<ValueType>>(op)).asNumpyObject();
 }
 
+template <typename ValueType>
+std::string py_assembly_report_json(const shared_ptr<const DiscreteBoundaryOperator<ValueType>>& op){
+
+    shared_ptr<const AssemblyReport> report = op->assemblyReport();
+    if (!report)
+        return std::string();
+    std::ostringstream out;
+    writeJson(out, *report);
+    return out.str();
+}
+
 
 }
 
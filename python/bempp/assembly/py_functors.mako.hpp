@@ -4,6 +4,7 @@
 #include "bempp/fiber/surface_normal_and_domain_index_dependent_function.hpp"
 #include "bempp/fiber/scalar_traits.hpp"
 #include "bempp/utils/py_types.hpp"
+#include <algorithm>
 #include <vector>
 #include <armadillo>
 #include <Python.h>
@@ -102,6 +103,84 @@ private:
 };
 
 
+// Functor passing all points of a batch to the Python callable at once, as
+// arrays of shape (argumentDimension, pointCount)
+template <typename ValueType_>
+class PythonVectorizedFunctor
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+    typedef typename PythonFunctor<ValueType>::pyFunc_t pyFunc_t;
+
+    PythonVectorizedFunctor(
+        pyFunc_t pyFunc, PyObject* callable,
+        int argumentDimension, int resultDimension) :
+            m_pyFunc(pyFunc),
+            m_callable(callable),
+            m_argumentDimension(argumentDimension),
+            m_resultDimension(resultDimension)
+            {
+            Py_INCREF(m_callable);
+            }
+
+    PythonVectorizedFunctor(const PythonVectorizedFunctor<ValueType>& other):
+        m_pyFunc(other.m_pyFunc), m_callable(other.m_callable),
+        m_argumentDimension(other.m_argumentDimension),
+        m_resultDimension(other.m_resultDimension) {
+
+            Py_INCREF(m_callable);
+        }
+
+    ~PythonVectorizedFunctor(){
+
+        Py_DECREF(m_callable);
+    }
+
+    int argumentDimension() const {
+        return m_argumentDimension;
+    }
+
+    int resultDimension() const {
+        return m_resultDimension;
+    }
+
+    void evaluateAtPoints(const arma::Mat<CoordinateType>& points,
+                          const arma::Mat<CoordinateType>& normals,
+                          int domainIndex, arma::Mat<ValueType>& result_) const
+    {
+        npy_intp argumentDims[2] = {m_argumentDimension, (npy_intp)points.n_cols};
+        npy_intp resultDims[2] = {m_resultDimension, (npy_intp)points.n_cols};
+
+        // Fortran order, so that the data can be copied as a whole
+        PyObject* x = PyArray_ZEROS(2,argumentDims,NumpyType<CoordinateType>::value,1);
+        PyObject* normal = PyArray_ZEROS(2,argumentDims,NumpyType<CoordinateType>::value,1);
+        PyObject* result = PyArray_ZEROS(2,resultDims,NumpyType<ValueType>::value,1);
+
+        std::copy(points.memptr(),points.memptr()+points.n_elem,
+                  (CoordinateType*)PyArray_DATA(x));
+        std::copy(normals.memptr(),normals.memptr()+normals.n_elem,
+                  (CoordinateType*)PyArray_DATA(normal));
+
+        m_pyFunc(x,normal,domainIndex,result,m_callable);
+
+        const ValueType* resPtr = (const ValueType*)PyArray_DATA(result);
+        std::copy(resPtr,resPtr+result_.n_elem,result_.memptr());
+
+        Py_DECREF(x);
+        Py_DECREF(normal);
+        Py_DECREF(result);
+    }
+
+private:
+    pyFunc_t m_pyFunc;
+    PyObject* m_callable;
+    int m_argumentDimension;
+    int m_resultDimension;
+
+};
+
+
 template <typename ValueType>
 shared_ptr<Fiber::Function<ValueType>> _py_surface_normal_dependent_function(
         typename PythonFunctor<ValueType>::pyFunc_t pyFunc,PyObject* callable, 
@@ -111,6 +190,16 @@ shared_ptr<Fiber::Function<ValueType>> _py_surface_normal_dependent_function(
         new Fiber::SurfaceNormalAndDomainIndexDependentFunction<PythonFunctor<ValueType>>(
             PythonFunctor<ValueType>(pyFunc,callable,argumentDimension,resultDimension)));
 }
+
+template <typename ValueType>
+shared_ptr<Fiber::Function<ValueType>> _py_vectorized_surface_normal_dependent_function(
+        typename PythonFunctor<ValueType>::pyFunc_t pyFunc,PyObject* callable,
+        int argumentDimension, int resultDimension)
+{
+    return shared_ptr<Fiber::Function<ValueType>>(
+        new Fiber::SurfaceNormalAndDomainIndexDependentFunction<PythonVectorizedFunctor<ValueType>>(
+            PythonVectorizedFunctor<ValueType>(pyFunc,callable,argumentDimension,resultDimension)));
+}
 } // namespace Bempp
 
 
@@ -1,2 +1,3 @@
 from bempp.utils.parameter_list import ParameterList
 from .global_parameters import global_parameters
+from .memory import memory_usage, release_cached_memory, reset_peak_memory
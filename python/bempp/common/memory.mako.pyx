@@ -0,0 +1,33 @@
+import json
+from libcpp.string cimport string
+
+cdef extern from "bempp/common/py_memory.hpp" namespace "Bempp":
+    cdef string py_memory_usage_json()
+
+cdef extern from "fiber/memory_registry.hpp" namespace "Fiber":
+    size_t c_evict "Fiber::MemoryRegistry::evict" (size_t)
+    void c_reset_peak "Fiber::MemoryRegistry::resetPeak" ()
+
+def memory_usage():
+    """ Memory held by discrete operators and caches as a dictionary
+
+    The dictionary holds the live and peak numbers of bytes, the live bytes
+    of each category (denseMatrices, hMatrices, acaMatrices,
+    singularIntegralCaches and localDofListsCaches) and a list of
+    owners, usually operator labels, with their bytes in each category.
+    The budget enforced during assembly is set by the global parameter
+    'memoryBudget' (in MB). """
+
+    return json.loads(py_memory_usage_json().decode())
+
+def release_cached_memory(nbytes):
+    """ Release cached data, e.g. weak forms retained by the weak-form
+    caches of the contexts, until nbytes bytes are freed or nothing is
+    left to release. Return the number of bytes freed. """
+
+    return c_evict(nbytes)
+
+def reset_peak_memory():
+    """ Set the peak reported by memory_usage to the current live bytes. """
+
+    c_reset_peak()
@@ -0,0 +1,20 @@
+#ifndef BEMPP_PYTHON_MEMORY_HPP
+#define BEMPP_PYTHON_MEMORY_HPP
+
+#include "fiber/memory_registry.hpp"
+#include <sstream>
+#include <string>
+
+
+namespace Bempp {
+
+inline std::string py_memory_usage_json(){
+
+    std::ostringstream out;
+    Fiber::writeJson(out, Fiber::MemoryRegistry::usage());
+    return out.str();
+}
+
+}
+
+#endif
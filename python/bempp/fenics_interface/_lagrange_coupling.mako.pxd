@@ -5,4 +5,5 @@ from bempp.space.space cimport SpaceVariants
 
 cdef extern from "bempp/fenics_interface/py_lagrange_interface.hpp" namespace "Bempp":
     object _py_p1_vertex_map(const SpaceVariants)
+    object _py_lagrange_trace_matrix(const SpaceVariants, object, double) except +
 
@@ -7,4 +7,14 @@ def p1_vertex_map(Space space):
 
     return _py_p1_vertex_map(space.impl_)
 
+def lagrange_trace_matrix(Space space, fem_dof_positions, double tolerance=1E-10):
+    """
+    Return the trace matrix of a Lagrange finite-element space as a
+    scipy.sparse.csr_matrix.
 
+    The (i,j)th entry is 1 if the ith DOF of the continuous P1 or P2 space
+    'space' lies at the jth row of the (n x 3) array 'fem_dof_positions',
+    and 0 otherwise.
+    """
+
+    return _py_lagrange_trace_matrix(space.impl_, fem_dof_positions, tolerance)
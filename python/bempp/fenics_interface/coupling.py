@@ -20,14 +20,45 @@ def fenics_to_bempp_trace_data(fenics_space):
     family,degree = fenics_space_info(fenics_space)
 
     if family=="Lagrange":
-        if degree==1:
-            import p1_coupling
-            return p1_coupling.p1_trace(fenics_space)
+        if degree in (1,2):
+            return lagrange_trace(fenics_space)
         else:
             raise NotImplementedError()
     else:
         raise NotImplementedError()
 
+def lagrange_trace(fenics_space):
+    """
+    Returns tuple (space,trace_matrix) for a scalar P1 or P2 Lagrange space.
+
+    'space' is the BEM++ space of the same order on the boundary of the
+    mesh of 'fenics_space' and 'trace_matrix' the scipy.sparse.csr_matrix
+    mapping FEniCS coefficient vectors to BEM++ ones. The matrix is built
+    natively by matching the positions of the degrees of freedom.
+    """
+
+    import numpy as np
+    from bempp import function_space
+    from ._lagrange_coupling import lagrange_trace_matrix
+
+    family,degree = fenics_space_info(fenics_space)
+    if not (family=='Lagrange' and degree in (1,2)):
+        raise ValueError("fenics_space must be a P1 or P2 Lagrange space")
+
+    mesh = fenics_space.mesh()
+    space = function_space(boundary_grid_from_fenics_mesh(mesh),"P",degree)
+
+    if hasattr(fenics_space,'tabulate_dof_coordinates'):
+        dof_positions = fenics_space.tabulate_dof_coordinates()
+    else:
+        dof_positions = fenics_space.dofmap().tabulate_all_coordinates(mesh)
+    dof_positions = np.ascontiguousarray(
+        dof_positions.reshape(-1,mesh.geometry().dim()),dtype='float64')
+    if dof_positions.shape[1]!=3:
+        raise ValueError("fenics_space must be defined on a 3D mesh")
+
+    return (space,lagrange_trace_matrix(space,dof_positions))
+
 def fenics_space_info(fenics_space):
     """
     Returns tuple (family,degree) containing information about a FEniCS space
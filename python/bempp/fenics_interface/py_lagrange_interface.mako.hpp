@@ -6,6 +6,10 @@
 #include "bempp/common/shared_ptr.hpp"
 #include "bempp/grid/grid.hpp"
 #include "bempp/grid/concrete_grid.hpp"
+#include "bempp/assembly/discrete_sparse_boundary_operator.hpp"
+#include "bempp/assembly/lagrange_trace.hpp"
+#include "bempp/assembly/py_discrete_operator_support.hpp"
+#include <stdexcept>
 
 
 namespace Bempp {
@@ -50,6 +54,42 @@ namespace Bempp {
 
 
        } 
+
+   static inline PyObject* _py_lagrange_trace_matrix(
+           const SpaceVariants& spaceVariant, PyObject* femDofPositions,
+           double tolerance){
+
+       const Space<double>& space = *(_py_get_space_ptr<double>(spaceVariant));
+
+       // The (n x 3) C-ordered array of positions is a (3 x n) matrix in
+       // column-major order
+       PyObject* positions = PyArray_FROM_OTF(femDofPositions, NPY_FLOAT64,
+                                              NPY_ARRAY_IN_ARRAY);
+       if (!positions)
+           throw std::invalid_argument("_py_lagrange_trace_matrix(): "
+                                       "cannot convert femDofPositions");
+       PyArrayObject* array = reinterpret_cast<PyArrayObject*>(positions);
+       if (PyArray_NDIM(array) != 2 || PyArray_DIM(array, 1) != 3) {
+           Py_DECREF(positions);
+           throw std::invalid_argument("_py_lagrange_trace_matrix(): "
+                                       "femDofPositions must have shape (n, 3)");
+       }
+       shared_ptr<Epetra_CrsMatrix> matrix;
+       try {
+           const arma::Mat<double> positionMatrix(
+                   static_cast<double*>(PyArray_DATA(array)), 3,
+                   PyArray_DIM(array, 0), false /* copy_aux_mem */);
+           matrix = lagrangeTraceMatrix(space, positionMatrix, tolerance);
+       } catch (...) {
+           Py_DECREF(positions);
+           throw;
+       }
+       Py_DECREF(positions);
+
+       shared_ptr<const DiscreteBoundaryOperator<double>> op(
+               new DiscreteSparseBoundaryOperator<double>(matrix));
+       return py_get_sparse_from_discrete_operator<double>(op);
+       }
 }
 #endif
 
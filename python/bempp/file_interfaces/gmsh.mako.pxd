@@ -4,7 +4,7 @@ from libcpp.vector cimport vector
 from libcpp.string cimport string
 from bempp.utils cimport catch_exception
 from bempp.assembly.grid_function cimport c_GridFunction, GridFunction
-from bempp.utils.enum_types cimport GmshPostDataType
+from bempp.utils.enum_types cimport GmshPostDataType, GmshFileFormatType
 
 cdef extern from "bempp/io/gmsh.hpp" namespace "Bempp":
     cdef cppclass c_GmshIo "Bempp::GmshIo":
@@ -17,7 +17,7 @@ cdef extern from "bempp/io/gmsh.hpp" namespace "Bempp":
         vector[int] inverseNodePermutation() const
         vector[int] inverseElementPermutation() const
 
-        void write(string fileName) except+catch_exception
+        void write(string fileName, GmshFileFormatType format) except+catch_exception
 
     cdef void c_exportToGmsh "Bempp::exportToGmsh" [BASIS,RESULT](c_GridFunction[BASIS,RESULT],
             const char* dataLabel, c_GmshIo& gmsh, GmshPostDataType gmshPostDataType,
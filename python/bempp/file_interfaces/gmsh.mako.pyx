@@ -11,7 +11,7 @@ from bempp.utils.byte_conversion import convert_to_bytes
 from bempp.utils cimport complex_float, complex_double
 from cython.operator cimport dereference as deref
 from bempp.assembly.grid_function cimport GridFunction
-from bempp.utils.enum_types cimport gmsh_post_data_type
+from bempp.utils.enum_types cimport gmsh_post_data_type, gmsh_file_format
 from cython.operator cimport dereference as deref
 
 import os.path
@@ -162,7 +162,7 @@ To write an existing grid object to a new file ``grid.msh`` use
 
             return deref(self.impl_).inverseElementPermutation()
 
-    def write(self,file_name):
+    def write(self,file_name,file_format="ascii"):
         """ 
         
         Write data in Gmsh format. 
@@ -171,10 +171,14 @@ To write an existing grid object to a new file ``grid.msh`` use
         ----------
         file_name : string
             Name of file to write to (file is overwritten).
+        file_format : string
+            'ascii' (default) or 'binary'. Binary files are much faster
+            to write and read.
 
         """
 
-        deref(self.impl_).write(convert_to_bytes(file_name))
+        deref(self.impl_).write(convert_to_bytes(file_name),
+                gmsh_file_format(convert_to_bytes(file_format)))
 
     def save_grid_function(self,GridFunction grid_function, object data_label, object gmsh_type="element_node",
             object complex_mode="real"):
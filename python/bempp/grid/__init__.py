@@ -17,12 +17,22 @@ Functions
 .. autofunction:: grid_from_element_data
 .. autofunction:: structured_grid
 .. autofunction:: grid_from_sphere
+.. autofunction:: refine_grid
+.. autofunction:: sphere_grid
+.. autofunction:: ellipsoid_grid
+.. autofunction:: cube_grid
 
 """
 
 __all__ = ['Grid', 'structured_grid',
             'grid_from_element_data',
-            'grid_from_sphere']
+            'grid_from_sphere',
+            'refine_grid',
+            'sphere_grid',
+            'ellipsoid_grid',
+            'cube_grid']
 from .grid import Grid, structured_grid, grid_from_element_data, grid_from_sphere
+from .grid import refine_grid
+from .grid import sphere_grid, ellipsoid_grid, cube_grid
 
 
@@ -24,6 +24,12 @@ cdef extern from "<array>" namespace "std":
         c_element()
         int& operator[](int)
 
+cdef extern from "bempp/grid/grid_refinement.hpp" namespace "Bempp":
+
+    cdef enum GridRefinementType "Bempp::GridRefinement::Type":
+        UNIFORM_REFINEMENT "Bempp::GridRefinement::UNIFORM"
+        BARYCENTRIC_REFINEMENT "Bempp::GridRefinement::BARYCENTRIC"
+
 cdef extern from "bempp/grid/grid_factory.hpp" namespace "Bempp":
 
     shared_ptr[const c_Grid] cart_grid "Bempp::GridFactory::createStructuredGrid"(
@@ -41,6 +47,34 @@ cdef extern from "bempp/grid/grid_factory.hpp" namespace "Bempp":
             vector[int]& domainIndices
     ) except +catch_exception
 
+    shared_ptr[const c_Grid] c_refined_grid \
+            "Bempp::GridFactory::createRefinedGrid"(
+            const c_Grid& grid,
+            GridRefinementType refinementType,
+            vector[int]* fatherIndices
+    ) except +catch_exception
+
+    shared_ptr[const c_Grid] c_sphere_grid \
+            "Bempp::GridFactory::createSphereGrid"(
+            double radius,
+            Col[double]& origin,
+            double h
+    ) except +catch_exception
+
+    shared_ptr[const c_Grid] c_ellipsoid_grid \
+            "Bempp::GridFactory::createEllipsoidGrid"(
+            Col[double]& radii,
+            Col[double]& origin,
+            double h
+    ) except +catch_exception
+
+    shared_ptr[const c_Grid] c_cube_grid \
+            "Bempp::GridFactory::createCubeGrid"(
+            double length,
+            Col[double]& origin,
+            double h
+    ) except +catch_exception
+
 cdef extern from "bempp/grid/py_sphere.hpp" namespace "Bempp":
 
     cdef cppclass SphereMesh:
@@ -251,6 +285,48 @@ def structured_grid(lower_left,upper_right,subdivisions):
     del c_subdivisions
     return grid
 
+def refine_grid(Grid grid not None, refinement="uniform"):
+    """
+
+    Create a refined copy of a triangular grid.
+
+    Parameters
+    ----------
+    grid : bempp.Grid
+        The grid to refine.
+    refinement : string
+        Either 'uniform', which splits each element into four,
+        or 'barycentric', which splits each element into six
+        (default 'uniform').
+
+    Returns
+    -------
+    (grid, father_indices) : (bempp.Grid, np.ndarray[int])
+        The refined grid and, for each of its elements, the index
+        of the element of the original grid containing it.
+
+    Examples
+    --------
+    >>> fine_grid, fathers = refine_grid(grid_from_sphere(3))
+
+    """
+
+    cdef GridRefinementType refinement_type
+    cdef vector[int] father_indices
+    cdef Grid result = Grid.__new__(Grid)
+    if refinement == "uniform":
+        refinement_type = UNIFORM_REFINEMENT
+    elif refinement == "barycentric":
+        refinement_type = BARYCENTRIC_REFINEMENT
+    else:
+        raise ValueError("Unknown refinement type: " + str(refinement))
+    result.impl_ = c_refined_grid(deref(grid.impl_), refinement_type,
+            &father_indices)
+    fathers = _np.empty(father_indices.size(), dtype='intc')
+    for i in range(father_indices.size()):
+        fathers[i] = father_indices[i]
+    return result, fathers
+
 @cython.boundscheck(False)
 @cython.wraparound(False)
 def grid_from_sphere(int n, double radius=1.0, object origin = [0,0,0]):
@@ -323,7 +399,134 @@ def grid_from_sphere(int n, double radius=1.0, object origin = [0,0,0]):
 
     return grid_from_element_data(nodes,elements)
 
+def sphere_grid(double h, double radius=1.0, object origin=[0,0,0]):
+    """
 
+    Create a grid of a sphere with a given element size.
 
+    The sphere is triangulated by uniform refinement of an
+    icosahedron, without calling an external mesh generator.
 
-        
+    Parameters
+    ----------
+    h : float
+        The maximum element size.
+    radius : float
+        The radius of the sphere (default 1.0).
+    origin : list
+        List with 3 elements defining the centre of the sphere
+        (default [0,0,0]).
+
+    Returns
+    -------
+    grid : bempp.Grid
+        The discretization of the sphere.
+
+    Examples
+    --------
+    >>> grid = sphere_grid(0.1, 2, [0,1,0])
+
+    """
+
+    from numpy import require
+    cdef:
+        double[::1] origin_ptr = require(origin, "double", 'C')
+        Col[double]* c_origin
+        Grid grid = Grid.__new__(Grid)
+    if len(origin_ptr) != 3:
+        raise ValueError("origin must have 3 elements")
+    c_origin = new Col[double](&origin_ptr[0], 3, False, True)
+    try:
+        grid.impl_ = c_sphere_grid(radius, deref(c_origin), h)
+    finally:
+        del c_origin
+    return grid
+
+def ellipsoid_grid(double h, object radii, object origin=[0,0,0]):
+    """
+
+    Create a grid of an ellipsoid with a given element size.
+
+    Parameters
+    ----------
+    h : float
+        The maximum element size.
+    radii : list
+        List with the 3 semi-axes of the ellipsoid along the
+        coordinate axes.
+    origin : list
+        List with 3 elements defining the centre of the ellipsoid
+        (default [0,0,0]).
+
+    Returns
+    -------
+    grid : bempp.Grid
+        The discretization of the ellipsoid.
+
+    Examples
+    --------
+    >>> grid = ellipsoid_grid(0.1, [1,2,0.5])
+
+    """
+
+    from numpy import require
+    cdef:
+        double[::1] radii_ptr = require(radii, "double", 'C')
+        double[::1] origin_ptr = require(origin, "double", 'C')
+        Col[double]* c_radii
+        Col[double]* c_origin
+        Grid grid = Grid.__new__(Grid)
+    if len(radii_ptr) != 3 or len(origin_ptr) != 3:
+        raise ValueError("radii and origin must have 3 elements")
+    c_radii = new Col[double](&radii_ptr[0], 3, False, True)
+    c_origin = new Col[double](&origin_ptr[0], 3, False, True)
+    try:
+        grid.impl_ = c_ellipsoid_grid(deref(c_radii), deref(c_origin), h)
+    finally:
+        del c_radii
+        del c_origin
+    return grid
+
+def cube_grid(double h, double length=1.0, object origin=[0,0,0]):
+    """
+
+    Create a grid of the surface of a cube with a given element size.
+
+    Every face is divided into a structured grid of squares,
+    each split into two triangles.
+
+    Parameters
+    ----------
+    h : float
+        The maximum length of the element edges parallel to
+        the edges of the cube.
+    length : float
+        The edge length of the cube (default 1.0).
+    origin : list
+        List with 3 elements defining the corner of the cube
+        with the smallest coordinates (default [0,0,0]).
+
+    Returns
+    -------
+    grid : bempp.Grid
+        The discretization of the cube.
+
+    Examples
+    --------
+    >>> grid = cube_grid(0.1)
+
+    """
+
+    from numpy import require
+    cdef:
+        double[::1] origin_ptr = require(origin, "double", 'C')
+        Col[double]* c_origin
+        Grid grid = Grid.__new__(Grid)
+    if len(origin_ptr) != 3:
+        raise ValueError("origin must have 3 elements")
+    c_origin = new Col[double](&origin_ptr[0], 3, False, True)
+    try:
+        grid.impl_ = c_cube_grid(length, deref(c_origin), h)
+    finally:
+        del c_origin
+    return grid
@@ -1,7 +1,36 @@
 import scipy.sparse.linalg
 from bempp.assembly import BoundaryOperatorBase, GridFunction
+from bempp.assembly.boundary_operator import GeneralBoundaryOperator
+from .native_solvers import native_solve
 
-def gmres(A, b, tol=1E-5, restart=None, maxiter=None, M=None, callback=None):
+def _use_native(A, b, use_native, M, callback):
+    """ The native solvers need the C++ operator of A and cannot call back
+        into a Python preconditioner or callback. """
+
+    return (use_native and M is None and callback is None and
+            isinstance(A, GeneralBoundaryOperator) and
+            A.basis_type == b.basis_type and A.result_type == b.result_type)
+
+def _solve_native(A, b, method, tol, restart, maxiter):
+
+    coefficients, iteration_count, _, converged = native_solve(
+            A, b, method=method, tol=tol, restart=restart, maxiter=maxiter)
+
+    # Same convention for info as scipy: 0 on success and the number of
+    # iterations otherwise
+    info = 0 if converged else iteration_count
+    return (GridFunction(A.domain, result_type=b.result_type,
+                         coefficients=coefficients),
+            info)
+
+def gmres(A, b, tol=1E-5, restart=None, maxiter=None, M=None, callback=None,
+          use_native=True):
+    """ Solve A x = b with GMRES and return (x, info).
+
+    Unless a preconditioner M or a callback is given, or A is a Python
+    combination of operators, the solver of Belos runs the iteration in C++
+    (see bempp.linalg.native_solvers.native_solve). Set use_native=False to
+    always use scipy.sparse.linalg.gmres. """
 
     if not isinstance(A,BoundaryOperatorBase):
         raise ValueError("A must be of type BoundaryOperatorBase")
@@ -9,7 +38,10 @@ def gmres(A, b, tol=1E-5, restart=None, maxiter=None, M=None, callback=None):
     if not isinstance(b,GridFunction):
         raise ValueError("b must be of type GridFunction")
 
-    x, info = scipy.sparse.linalg.gmres(A.weak_form(), b.projections(A.dual_to_range), 
+    if _use_native(A, b, use_native, M, callback):
+        return _solve_native(A, b, "gmres", tol, restart, maxiter)
+
+    x, info = scipy.sparse.linalg.gmres(A.weak_form(), b.projections(A.dual_to_range),
             tol=tol, restart=restart, maxiter=maxiter, M=M, callback=callback)
 
     return (GridFunction(A.domain, result_type=b.result_type,coefficients = x.ravel()),
@@ -17,7 +49,10 @@ def gmres(A, b, tol=1E-5, restart=None, maxiter=None, M=None, callback=None):
 
 
 
-def cg(A, b, tol=1E-5, maxiter=None, M=None, callback=None):
+def cg(A, b, tol=1E-5, maxiter=None, M=None, callback=None, use_native=True):
+    """ Solve A x = b with CG and return (x, info).
+
+    See gmres() for when the iteration runs in C++. """
 
     if not isinstance(A,BoundaryOperatorBase):
         raise ValueError("A must be of type BoundaryOperatorBase")
@@ -25,11 +60,13 @@ def cg(A, b, tol=1E-5, maxiter=None, M=None, callback=None):
     if not isinstance(b,GridFunction):
         raise ValueError("b must be of type GridFunction")
 
-    x, info = scipy.sparse.linalg.cg(A.weak_form(), b.projections(A.dual_to_range), 
+    if _use_native(A, b, use_native, M, callback):
+        return _solve_native(A, b, "cg", tol, None, maxiter)
+
+    x, info = scipy.sparse.linalg.cg(A.weak_form(), b.projections(A.dual_to_range),
             tol=tol, maxiter=maxiter, M=M, callback=callback)
 
     return (GridFunction(A.domain, result_type=b.result_type,coefficients = x.ravel()),
             info)
-    
 
 
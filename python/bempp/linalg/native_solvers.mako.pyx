@@ -0,0 +1,83 @@
+<% from data_types import dtypes, compatible_dtypes, ctypes %>
+from libcpp cimport bool as cbool
+from libcpp.string cimport string
+from bempp.utils cimport catch_exception
+from bempp.utils cimport complex_float, complex_double
+from bempp.utils.armadillo cimport Col
+from bempp.assembly.boundary_operator cimport BoundaryOpVariants
+from bempp.assembly.boundary_operator cimport GeneralBoundaryOperator
+from bempp.assembly.grid_function cimport c_GridFunction, GridFunction
+from cython.operator cimport dereference as deref
+% for pyvalue in dtypes:
+from bempp.utils.armadillo cimport armadillo_col_to_np_${pyvalue}
+% endfor
+
+cdef extern from "bempp/linalg/py_iterative_solver.hpp" namespace "Bempp" nogil:
+    cdef Col[RESULT] c_py_iterative_solve "Bempp::py_iterative_solve" [BASIS, RESULT](
+            const BoundaryOpVariants& op,
+            const c_GridFunction[BASIS, RESULT]& rhs,
+            const string& method, double tol, int max_iteration_count,
+            int restart, int& iteration_count, double& achieved_tolerance,
+            cbool& converged) except+catch_exception
+
+
+def native_solve(GeneralBoundaryOperator A, GridFunction b, method="gmres",
+        tol=1E-5, restart=None, maxiter=None):
+    """ Solve A x = b with an iterative solver of Belos
+
+    The Krylov iteration runs in C++ on the weak form of A; only the
+    coefficients of the solution are handed back to Python. The global
+    interpreter lock is released during the solve.
+
+    Parameters
+    ----------
+    A : GeneralBoundaryOperator
+        The operator of the equation.
+    b : GridFunction
+        The right-hand side, with the same basis and result types as A.
+    method : string
+        'gmres' or 'cg'.
+    tol : float
+        Relative tolerance of the residual in the dual space to the range
+        of A.
+    restart : int
+        Restart length of GMRES (default: that of Belos).
+    maxiter : int
+        Maximum number of iterations (default: 1000).
+
+    Returns
+    -------
+    (coefficients, iteration_count, achieved_tolerance, converged)
+
+    """
+
+    if A.basis_type != b.basis_type or A.result_type != b.result_type:
+        raise ValueError("A and b must have the same basis and result types")
+
+    cdef string c_method = method.encode("UTF-8")
+    cdef double c_tol = tol
+    cdef int c_maxiter = 1000 if maxiter is None else maxiter
+    cdef int c_restart = 0 if restart is None else restart
+    cdef int iteration_count = 0
+    cdef double achieved_tolerance = 0
+    cdef cbool converged = False
+% for pyresult, cyresult in dtypes.items():
+    cdef Col[${cyresult}] coefficients_${pyresult}
+% endfor
+
+% for pybasis, cybasis in dtypes.items():
+%     for pyresult, cyresult in dtypes.items():
+%         if pyresult in compatible_dtypes[pybasis]:
+    if A.basis_type == "${pybasis}" and A.result_type == "${pyresult}":
+        with nogil:
+            coefficients_${pyresult} = c_py_iterative_solve[${cybasis},${cyresult}](
+                    A.impl_, deref(b._impl_${pybasis}_${pyresult}), c_method,
+                    c_tol, c_maxiter, c_restart, iteration_count,
+                    achieved_tolerance, converged)
+        return (armadillo_col_to_np_${pyresult}(coefficients_${pyresult}),
+                iteration_count, achieved_tolerance, converged)
+%         endif
+%     endfor
+% endfor
+
+    raise ValueError("Unknown basis or result type")
@@ -0,0 +1,64 @@
+#ifndef BEMPP_PYTHON_ITERATIVE_SOLVER_HPP
+#define BEMPP_PYTHON_ITERATIVE_SOLVER_HPP
+
+#include "bempp/assembly/py_boundary_operator_variants.hpp"
+#include "bempp/assembly/grid_function.hpp"
+#include "bempp/linalg/default_iterative_solver.hpp"
+#include "bempp/linalg/belos_solver_wrapper_fwd.hpp"
+#include "bempp/common/scalar_traits.hpp"
+#include "bempp/linalg/solution.hpp"
+#include <Teuchos_ParameterList.hpp>
+#include <stdexcept>
+#include <string>
+
+
+namespace Bempp {
+
+//! Solve op * x = rhs with Belos and return the coefficients of x
+/*!
+ * The Krylov iteration runs entirely in C++; the only data crossing into
+ * Python are the coefficients of the solution. method is "gmres" or "cg",
+ * restart is the GMRES restart length (0 for the Belos default). The number
+ * of iterations, the achieved tolerance and whether the solver converged are
+ * written to the last three arguments.
+ */
+template<typename BasisFunctionType,typename ResultType>
+arma::Col<ResultType> py_iterative_solve(
+        const BoundaryOpVariants& op,
+        const GridFunction<BasisFunctionType,ResultType>& rhs,
+        const std::string& method, double tol, int maxIterationCount,
+        int restart, int& iterationCount, double& achievedTolerance,
+        bool& converged)
+{
+
+    typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
+
+    Teuchos::RCP<Teuchos::ParameterList> paramList;
+    if (method == "gmres") {
+        paramList = defaultGmresParameterList(
+                static_cast<MagnitudeType>(tol), maxIterationCount);
+        if (restart > 0)
+            paramList->sublist("Solver Types")
+                .sublist("Pseudo Block GMRES").set("Num Blocks", restart);
+    }
+    else if (method == "cg")
+        paramList = defaultCgParameterList(
+                static_cast<MagnitudeType>(tol), maxIterationCount);
+    else
+        throw std::invalid_argument(
+                "py_iterative_solve(): method must be 'gmres' or 'cg'");
+
+    DefaultIterativeSolver<BasisFunctionType,ResultType> solver(
+            boundary_op_variant_operator<BasisFunctionType,ResultType>(op));
+    solver.initializeSolver(paramList);
+    Solution<BasisFunctionType,ResultType> solution = solver.solve(rhs);
+
+    iterationCount = solution.iterationCount();
+    achievedTolerance = solution.achievedTolerance();
+    converged = (solution.status() == SolutionStatus::CONVERGED);
+    return solution.gridFunction().coefficients();
+}
+
+}
+
+#endif
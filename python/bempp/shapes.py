@@ -187,9 +187,17 @@ def sphere(radius=1,origin=(0,0,0),h=0.1,grid=True,msh_file=False,parallel=True)
        - parallel (True/False)
             Run the function as parallelized MPI routine so that
             all processes return the same grid
+
+    Unless a .msh file is requested, the grid is generated in-process by
+    bempp.grid.sphere_grid, which does not need Gmsh and gives the same
+    grid on all processes.
     """
     import subprocess,os
 
+    if grid and not msh_file:
+        from bempp.grid import sphere_grid
+        return sphere_grid(h,radius,origin)
+
     sphere_stub = """
     Point(1) = {orig0,orig1,orig2,cl};
     Point(2) = {orig0+rad,orig1,orig2,cl};
@@ -265,9 +273,16 @@ def cube(length=1,origin=(0,0,0),h=0.1,grid=True,msh_file=False,parallel=True):
             Run the function as parallelized MPI routine so that
             all processes return the same grid
 
+    Unless a .msh file is requested, the grid is generated in-process by
+    bempp.grid.cube_grid, which does not need Gmsh and gives the same
+    grid on all processes.
     """
     import subprocess,os
 
+    if grid and not msh_file:
+        from bempp.grid import cube_grid
+        return cube_grid(h,length,origin)
+
     cube_stub = """
     Point(1) = {orig0,orig1,orig2,cl};
     Point(2) = {orig0+l,orig1,orig2,cl};
@@ -321,6 +336,24 @@ def cube(length=1,origin=(0,0,0),h=0.1,grid=True,msh_file=False,parallel=True):
     return __generate_grid_from_string(cube_geometry,grid,msh_file,parallel)
 
 
+def ellipsoid(radii=(1,1,1),origin=(0,0,0),h=0.1):
+    """
+    Return an ellipsoid grid.
+
+    The grid is generated in-process by bempp.grid.ellipsoid_grid.
+
+    *Parameters:*
+       - radii (3-tuple)
+            Semi-axes of the ellipsoid along the coordinate axes.
+       - origin (3-tuple)
+            Origin of the ellipsoid.
+       - h (real number)
+            Approximate element size.
+    """
+    from bempp.grid import ellipsoid_grid
+    return ellipsoid_grid(h,radii,origin)
+
+
 def almond():
     """
     Return a grid discretizing the Nasa almond shape.
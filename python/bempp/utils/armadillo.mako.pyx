@@ -5,55 +5,50 @@ cimport cython
 cimport numpy as np
 import numpy as np
 from bempp.utils cimport complex_float,complex_double
-from cython.operator cimport dereference as deref
+from libc.string cimport memcpy
+
+np.import_array()
+
+# The conversions copy the column-major data of Armadillo in one block into
+# a Fortran-ordered array.
 
 % for pyvalue,cyvalue in dtypes.items():
-@cython.boundscheck(False)
-@cython.wraparound(False)
 cdef np.ndarray armadillo_to_np_${pyvalue}(const Mat[${cyvalue}]& x):
     
-    cdef int rows = x.n_rows
-    cdef int cols = x.n_cols
-    cdef int j
-    cdef int i
+    cdef size_t rows = x.n_rows
+    cdef size_t cols = x.n_cols
 
-    cdef np.ndarray[${scalar_cython_type(cyvalue)},ndim=2,mode='fortran'] res = np.empty((rows,cols),dtype="${pyvalue}",order='F')
+    cdef np.ndarray res = np.empty((rows,cols),dtype="${pyvalue}",order='F')
 
-    for j in range(cols):
-        for i in range(rows):
-            res[i,j] = deref(<${scalar_cython_type(cyvalue)}*>&x.at(i,j))
+    if rows*cols>0:
+        memcpy(np.PyArray_DATA(res),<const void*>&x.at(0,0),
+                rows*cols*sizeof(${cyvalue}))
     return res
 % endfor
 
 
 % for pyvalue,cyvalue in dtypes.items():
-@cython.boundscheck(False)
-@cython.wraparound(False)
 cdef np.ndarray armadillo_col_to_np_${pyvalue}(const Col[${cyvalue}]& x):
     
-    cdef int rows = x.n_rows
-    cdef int i
+    cdef size_t rows = x.n_rows
 
-    cdef np.ndarray[${scalar_cython_type(cyvalue)},ndim=1,mode='fortran'] res = np.empty(rows,dtype="${pyvalue}",order='F')
+    cdef np.ndarray res = np.empty(rows,dtype="${pyvalue}",order='F')
 
-    for i in range(rows):
-        res[i] = deref(<${scalar_cython_type(cyvalue)}*>&x.at(i))
+    if rows>0:
+        memcpy(np.PyArray_DATA(res),<const void*>&x.at(0),
+                rows*sizeof(${cyvalue}))
     return res
 % endfor
 
 
-@cython.boundscheck(False)
-@cython.wraparound(False)
 cdef np.ndarray armadillo_to_np_int(const Mat[int]& x):
     
-    cdef int rows = x.n_rows
-    cdef int cols = x.n_cols
-    cdef int j
-    cdef int i
+    cdef size_t rows = x.n_rows
+    cdef size_t cols = x.n_cols
 
-    cdef np.ndarray[int,ndim=2,mode='fortran'] res = np.empty((rows,cols),dtype="intc",order='F')
+    cdef np.ndarray res = np.empty((rows,cols),dtype="intc",order='F')
 
-    for j in range(cols):
-        for i in range(rows):
-            res[i,j] = x.at(i,j)
+    if rows*cols>0:
+        memcpy(np.PyArray_DATA(res),<const void*>&x.at(0,0),
+                rows*cols*sizeof(int))
     return res
@@ -24,8 +24,12 @@ cdef extern from "bempp/io/gmsh.hpp":
         node "Bempp::GmshPostData::NODE"
         element "Bempp::GmshPostData::ELEMENT"
         element_node "Bempp::GmshPostData::ELEMENT_NODE"
+    cdef enum GmshFileFormatType "Bempp::GmshFileFormat::Type":
+        ascii_format "Bempp::GmshFileFormat::ASCII"
+        binary_format "Bempp::GmshFileFormat::BINARY"
 
 cdef SymmetryMode symmetry_mode(string name)
 cdef TranspositionMode transposition_mode(string name)
 cdef ConstructionMode construction_mode(string name)
 cdef GmshPostDataType gmsh_post_data_type(string name)
+cdef GmshFileFormatType gmsh_file_format(string name)
@@ -62,3 +62,17 @@ cdef GmshPostDataType gmsh_post_data_type(string name):
         raise ValueError("Unsupported gmsh type")
 
     return res
+
+
+cdef GmshFileFormatType gmsh_file_format(string name):
+
+    cdef GmshFileFormatType res
+
+    if name==string(b'ascii'):
+        res = ascii_format
+    elif name==string(b'binary'):
+        res = binary_format
+    else:
+        raise ValueError("Unsupported gmsh file format")
+
+    return res
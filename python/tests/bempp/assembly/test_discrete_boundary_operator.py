@@ -64,6 +64,46 @@ class TestDiscreteBoundaryOperator(object):
         op = laplace_slp(space_lin,space_lin,space_const).weak_form()
         assert op.shape==(space_const.global_dof_count,space_lin.global_dof_count)
 
+    def test_assembly_report(self,real_operator):
+
+        report = real_operator.assembly_report
+        assert report is not None
+        assert report['threadCount'] >= 1
+        assert report['storageSize'] > 0
+        counts = report['elementPairCounts']
+        assert counts['singular'] > 0
+        assert counts['near']+counts['far'] > 0
+        assert sum(rule['elementPairCount']+rule['cachedElementPairCount']
+                for rule in report['quadratureRules']) == sum(counts.values())
+        assert set(report['phases']) == set(['geometry','singularCaching',
+            'regularIntegrals','compression'])
+
+    def test_matvec_from_several_threads(self,real_operator):
+
+        from threading import Thread
+        x = np.random.rand(real_operator.shape[1],3)
+        expected = real_operator*x
+        results = [None]*4
+
+        def apply(i):
+            results[i] = real_operator*x
+        threads = [Thread(target=apply,args=(i,)) for i in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for result in results:
+            assert np.linalg.norm(result-expected) < 1E-12*np.linalg.norm(expected)
+
+    def test_memory_usage(self,real_operator):
+
+        from bempp.common import memory_usage
+        usage = memory_usage()
+        rows,cols = real_operator.shape
+        assert usage['categories']['denseMatrices'] >= 8*rows*cols
+        assert usage['liveBytes'] == sum(usage['categories'].values())
+        assert usage['peakBytes'] >= usage['liveBytes']
+
 class TestScaledDiscreteBoundaryOperator(object):
 
     @pytest.mark.parametrize('alpha',[2.0,2+1j])
@@ -56,8 +56,26 @@ class TestGridFunction(object):
 
         assert np.linalg.norm(expected-actual)<_eps
 
+    def test_linear_combination_of_grid_functions(self,space,dual_space):
 
+        from bempp.assembly.grid_function import linear_combination
+        u = GridFunction(space,coefficients=np.random.rand(space.global_dof_count))
+        v = GridFunction(space,coefficients=np.random.rand(space.global_dof_count))
+        res = linear_combination([2.0,-0.5],[u,v])
+        expected = 2*u.coefficients-0.5*v.coefficients
 
+        assert np.linalg.norm(expected-res.coefficients)<_eps
+        assert np.linalg.norm(expected-(2*u-0.5*v).coefficients)<_eps
 
+    def test_inplace_operations_on_grid_functions(self,space):
 
+        coefficients = np.random.rand(space.global_dof_count)
+        fun = GridFunction(space,coefficients=coefficients)
+        res = fun*1.0
+        res *= 3
+        res -= fun
+        res += fun
+
+        assert np.linalg.norm(3*coefficients-res.coefficients)<_eps
+        assert np.linalg.norm(coefficients-fun.coefficients)==0
 
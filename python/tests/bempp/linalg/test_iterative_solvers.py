@@ -0,0 +1,51 @@
+import pytest
+from bempp import grid_from_sphere
+from bempp import function_space
+from bempp.assembly import GridFunction
+from bempp.operators.boundary.laplace import single_layer as laplace_slp
+from bempp.linalg.iterative_solvers import gmres, cg
+
+import numpy as np
+
+_tol = 1E-8
+
+
+@pytest.fixture(scope='module')
+def space():
+    grid = grid_from_sphere(3)
+    return function_space(grid,"DP",0)
+
+@pytest.fixture(scope='module')
+def operator(space):
+    return laplace_slp(space,space,space)
+
+@pytest.fixture(scope='module')
+def rhs(space):
+    return GridFunction(space,coefficients=np.ones(space.global_dof_count))
+
+class TestIterativeSolvers(object):
+
+    def test_native_gmres_agrees_with_scipy(self,operator,rhs):
+
+        x_native, info_native = gmres(operator,rhs,tol=_tol)
+        x_scipy, info_scipy = gmres(operator,rhs,tol=_tol,use_native=False)
+
+        assert info_native==0
+        assert info_scipy==0
+        diff = x_native.coefficients-x_scipy.coefficients
+        assert np.linalg.norm(diff)<1E-5*np.linalg.norm(x_scipy.coefficients)
+
+    def test_native_cg_agrees_with_scipy(self,operator,rhs):
+
+        x_native, info_native = cg(operator,rhs,tol=_tol)
+        x_scipy, info_scipy = cg(operator,rhs,tol=_tol,use_native=False)
+
+        assert info_native==0
+        diff = x_native.coefficients-x_scipy.coefficients
+        assert np.linalg.norm(diff)<1E-5*np.linalg.norm(x_scipy.coefficients)
+
+    def test_native_gmres_reports_unconverged_solve(self,operator,rhs):
+
+        x, info = gmres(operator,rhs,tol=1E-14,maxiter=2)
+
+        assert info>0
@@ -0,0 +1,128 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Benchmarks of the matrix-vector product of ACA (AHMED) weak forms, in the
+// reduction and row-partitioned modes selected by AcaOptions::matvecMode.
+
+#include "bempp/common/config_ahmed.hpp"
+
+#ifdef WITH_AHMED
+
+#include "benchmark.hpp"
+#include "benchmark_problems.hpp"
+
+#include "assembly/aca_options.hpp"
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "space/space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <map>
+#include <random>
+#include <utility>
+
+using namespace Benchmarks;
+using namespace Bempp;
+
+namespace
+{
+
+typedef std::pair<std::string, AcaOptions::AcaMatvecMode> WeakFormKey;
+
+shared_ptr<const DiscreteBoundaryOperator<double> >
+laplaceSingleLayerAcaWeakForm(const std::string& path,
+                              AcaOptions::AcaMatvecMode mode)
+{
+    static std::map<WeakFormKey,
+            shared_ptr<const DiscreteBoundaryOperator<double> > > weakForms;
+    shared_ptr<const DiscreteBoundaryOperator<double> >& weakForm =
+            weakForms[WeakFormKey(path, mode)];
+    if (!weakForm) {
+        shared_ptr<const Grid> grid = loadGrid(path);
+        shared_ptr<const Space<double> > constants =
+                piecewiseConstants(grid);
+
+        AccuracyOptions accuracyOptions;
+        shared_ptr<NumericalQuadratureStrategy<double, double> > quadStrategy(
+                new NumericalQuadratureStrategy<double, double>(
+                    accuracyOptions));
+        AcaOptions acaOptions;
+        acaOptions.matvecMode = mode;
+        AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.switchToAcaMode(acaOptions);
+        shared_ptr<Context<double, double> > context(
+                new Context<double, double>(quadStrategy, assemblyOptions));
+
+        weakForm = laplace3dSingleLayerBoundaryOperator<double, double>(
+                    context, constants, constants, constants).weakForm();
+    }
+    return weakForm;
+}
+
+void benchmarkApply(BenchmarkState& state, AcaOptions::AcaMatvecMode mode)
+{
+    shared_ptr<const DiscreteBoundaryOperator<double> > weakForm =
+            laplaceSingleLayerAcaWeakForm(state.meshPath(state.argument()),
+                                          mode);
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(-1., 1.);
+    arma::Mat<double> x(weakForm->columnCount(), 1);
+    for (size_t i = 0; i < x.n_elem; ++i)
+        x[i] = distribution(generator);
+    arma::Mat<double> y(weakForm->rowCount(), 1);
+    y.fill(0.);
+
+    while (state.keepRunning())
+        weakForm->apply(NO_TRANSPOSE, x, y, 1., 0.);
+    state.setItemsProcessed(double(state.iterations()));
+    state.setCounter("rows", weakForm->rowCount());
+    state.setCounter("columns", weakForm->columnCount());
+}
+
+void benchmarkReductionApply(BenchmarkState& state)
+{
+    benchmarkApply(state, AcaOptions::REDUCTION_MATVEC);
+}
+
+void benchmarkRowPartitionedApply(BenchmarkState& state)
+{
+    benchmarkApply(state, AcaOptions::ROW_PARTITIONED_MATVEC);
+}
+
+} // namespace
+
+// The argument is the mesh file; the items processed are the products with
+// a single vector
+BEMPP_BENCHMARK("aca/apply_reduction/laplace_3d_single_layer",
+                benchmarkReductionApply,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
+BEMPP_BENCHMARK("aca/apply_row_partitioned/laplace_3d_single_layer",
+                benchmarkRowPartitionedApply,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
+
+#endif // WITH_AHMED
@@ -0,0 +1,155 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Benchmarks of the assembly of weak forms of boundary operators in dense
+// and H-matrix mode. Each iteration assembles the weak form from scratch,
+// starting with a new context.
+
+#include "benchmark.hpp"
+#include "benchmark_problems.hpp"
+
+#include "assembly/assembly_report.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/helmholtz_3d_single_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "grid/grid.hpp"
+#include "space/space.hpp"
+
+#include <complex>
+
+using namespace Benchmarks;
+using namespace Bempp;
+
+namespace
+{
+
+enum OperatorType
+{
+    LAPLACE_SINGLE_LAYER,
+    LAPLACE_DOUBLE_LAYER,
+    HELMHOLTZ_SINGLE_LAYER
+};
+
+template <typename ResultType>
+BoundaryOperator<double, ResultType> makeOperator(
+        OperatorType type, const ParameterList& parameters,
+        const shared_ptr<const Grid>& grid);
+
+template <>
+BoundaryOperator<double, double> makeOperator<double>(
+        OperatorType type, const ParameterList& parameters,
+        const shared_ptr<const Grid>& grid)
+{
+    shared_ptr<const Space<double> > constants = piecewiseConstants(grid);
+    if (type == LAPLACE_SINGLE_LAYER)
+        return laplace3dSingleLayerBoundaryOperator<double, double>(
+                    parameters, constants, constants, constants);
+    return laplace3dDoubleLayerBoundaryOperator<double, double>(
+                parameters, piecewiseLinears(grid), constants, constants);
+}
+
+template <>
+BoundaryOperator<double, std::complex<double> >
+makeOperator<std::complex<double> >(
+        OperatorType /* type */, const ParameterList& parameters,
+        const shared_ptr<const Grid>& grid)
+{
+    shared_ptr<const Space<double> > constants = piecewiseConstants(grid);
+    return helmholtz3dSingleLayerBoundaryOperator<double>(
+                parameters, constants, constants, constants,
+                std::complex<double>(2., 0.));
+}
+
+template <typename ResultType>
+void benchmarkAssembly(BenchmarkState& state, OperatorType type,
+                       const std::string& assemblyType)
+{
+    shared_ptr<const Grid> grid = loadGrid(state.meshPath(state.argument()));
+    const ParameterList parameters =
+            assemblyParameters(assemblyType, state.threadCount());
+
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > weakForm;
+    while (state.keepRunning()) {
+        // Release the previous weak form before assembling the next one
+        weakForm.reset();
+        weakForm = makeOperator<ResultType>(type, parameters, grid)
+                .weakForm();
+    }
+
+    const double entryCount =
+            double(weakForm->rowCount()) * weakForm->columnCount();
+    state.setItemsProcessed(state.iterations() * entryCount);
+    state.setCounter("rows", weakForm->rowCount());
+    state.setCounter("columns", weakForm->columnCount());
+    if (shared_ptr<const AssemblyReport> report = weakForm->assemblyReport())
+        state.setCounter("storage_bytes", report->storageSize);
+}
+
+void benchmarkDenseLaplaceSingleLayer(BenchmarkState& state)
+{
+    benchmarkAssembly<double>(state, LAPLACE_SINGLE_LAYER, "dense");
+}
+
+void benchmarkDenseLaplaceDoubleLayer(BenchmarkState& state)
+{
+    benchmarkAssembly<double>(state, LAPLACE_DOUBLE_LAYER, "dense");
+}
+
+void benchmarkHMatLaplaceSingleLayer(BenchmarkState& state)
+{
+    benchmarkAssembly<double>(state, LAPLACE_SINGLE_LAYER, "hmat");
+}
+
+void benchmarkHMatLaplaceDoubleLayer(BenchmarkState& state)
+{
+    benchmarkAssembly<double>(state, LAPLACE_DOUBLE_LAYER, "hmat");
+}
+
+void benchmarkHMatHelmholtzSingleLayer(BenchmarkState& state)
+{
+    benchmarkAssembly<std::complex<double> >(
+                state, HELMHOLTZ_SINGLE_LAYER, "hmat");
+}
+
+} // namespace
+
+// The argument is the mesh file
+BEMPP_BENCHMARK("assembly/dense/laplace_3d_single_layer",
+                benchmarkDenseLaplaceSingleLayer,
+                (BenchmarkArguments(), "sphere-ico-2.msh", "sphere-h-0.2.msh",
+                 "sphere-h-0.1.msh"), THREADED);
+BEMPP_BENCHMARK("assembly/dense/laplace_3d_double_layer",
+                benchmarkDenseLaplaceDoubleLayer,
+                (BenchmarkArguments(), "sphere-ico-2.msh", "sphere-h-0.2.msh",
+                 "sphere-h-0.1.msh"), THREADED);
+BEMPP_BENCHMARK("assembly/hmat/laplace_3d_single_layer",
+                benchmarkHMatLaplaceSingleLayer,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
+BEMPP_BENCHMARK("assembly/hmat/laplace_3d_double_layer",
+                benchmarkHMatLaplaceDoubleLayer,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
+BEMPP_BENCHMARK("assembly/hmat/helmholtz_3d_single_layer",
+                benchmarkHMatHelmholtzSingleLayer,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
@@ -0,0 +1,532 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+#include <tbb/task_scheduler_init.h>
+
+namespace Benchmarks
+{
+
+namespace
+{
+
+struct BenchmarkDefinition
+{
+    std::string name;
+    BenchmarkFunction function;
+    std::vector<std::string> arguments;
+    Threading threading;
+};
+
+std::vector<BenchmarkDefinition>& registry()
+{
+    // Function-level static, so that registration from other translation
+    // units during static initialisation is safe
+    static std::vector<BenchmarkDefinition> benchmarks;
+    return benchmarks;
+}
+
+std::string runName(const BenchmarkDefinition& benchmark,
+                    const std::string& argument, int threadCount)
+{
+    std::ostringstream name;
+    name << benchmark.name;
+    if (!argument.empty())
+        name << "/" << argument;
+    if (benchmark.threading == THREADED)
+        name << "/threads:" << threadCount;
+    return name.str();
+}
+
+std::vector<int> threadCounts(const BenchmarkDefinition& benchmark,
+                              const BenchmarkSettings& settings)
+{
+    if (benchmark.threading == SERIAL || settings.threadCounts.empty())
+        return std::vector<int>(1, 1);
+    return settings.threadCounts;
+}
+
+std::vector<std::string> arguments(const BenchmarkDefinition& benchmark)
+{
+    if (benchmark.arguments.empty())
+        return std::vector<std::string>(1, std::string());
+    return benchmark.arguments;
+}
+
+std::string formatTime(double seconds)
+{
+    static const char* units[] = {"s", "ms", "us", "ns"};
+    int unit = 0;
+    while (unit < 3 && seconds > 0. && seconds < 1.) {
+        seconds *= 1000.;
+        ++unit;
+    }
+    std::ostringstream str;
+    str << std::fixed << std::setprecision(seconds < 10. ? 3 : 1) << seconds
+        << " " << units[unit];
+    return str.str();
+}
+
+void printRun(std::ostream& out, const BenchmarkRun& run)
+{
+    std::string name = run.name;
+    if (!run.aggregate.empty())
+        name += "_" + run.aggregate;
+    out << std::left << std::setw(60) << name << std::right;
+    if (!run.error.empty()) {
+        out << " ERROR: " << run.error << std::endl;
+        return;
+    }
+    out << std::setw(14) << formatTime(run.wallTime)
+        << std::setw(14) << formatTime(run.cpuTime)
+        << std::setw(12) << run.iterations;
+    if (run.itemsPerSecond > 0.)
+        out << "  items/s=" << std::setprecision(4) << run.itemsPerSecond;
+    if (run.bytesPerSecond > 0.)
+        out << "  bytes/s=" << std::setprecision(4) << run.bytesPerSecond;
+    for (std::map<std::string, double>::const_iterator it =
+             run.counters.begin(); it != run.counters.end(); ++it)
+        out << "  " << it->first << "=" << it->second;
+    out << std::endl;
+}
+
+// Add the hardware counters per iteration and the derived rates to
+// run.counters
+void addHardwareCounters(const BenchmarkState& state,
+                         const BenchmarkSettings& settings,
+                         BenchmarkRun& run)
+{
+    typedef Fiber::HardwareCounter Counter;
+    const unsigned mask = state.hardwareCounterMask();
+    const double iterations = std::max<size_t>(state.iterations(), 1);
+    for (int c = 0; c < Counter::COUNTER_COUNT; ++c)
+        if (mask & (1u << c))
+            run.counters[Counter::name(c)] =
+                    state.hardwareCounts()[c] / iterations;
+
+    const double flops = state.flopsProcessed() > 0. ?
+                state.flopsProcessed() : -1.;
+    const Fiber::HardwareCounterRates rates(
+                state.hardwareCounts(), mask, state.wallTime(), flops);
+    if (rates.instructionsPerCycle >= 0.)
+        run.counters["instructionsPerCycle"] = rates.instructionsPerCycle;
+    if (rates.stalledCycleFraction >= 0.)
+        run.counters["stalledCycleFraction"] = rates.stalledCycleFraction;
+    if (rates.bandwidth >= 0.)
+        run.counters["bandwidth"] = rates.bandwidth;
+    if (rates.flopRate >= 0.)
+        run.counters["flopRate"] = rates.flopRate;
+    // Without a cache miss counter, the intensity is an upper bound based
+    // on the bytes the benchmark reports
+    double intensity = rates.arithmeticIntensity;
+    if (intensity < 0. && flops > 0. && state.bytesProcessed() > 0.)
+        intensity = flops / state.bytesProcessed();
+    if (intensity >= 0.)
+        run.counters["arithmeticIntensity"] = intensity;
+
+    // Position relative to the roof min(peak rate, intensity * bandwidth)
+    if (rates.flopRate >= 0. && intensity > 0. &&
+            settings.peakFlopRate > 0. && settings.peakBandwidth > 0.) {
+        const double memoryRoof = intensity * settings.peakBandwidth;
+        run.counters["rooflineFraction"] = rates.flopRate /
+                std::min(settings.peakFlopRate, memoryRoof);
+        run.counters["memoryBound"] =
+                memoryRoof < settings.peakFlopRate ? 1. : 0.;
+    }
+}
+
+BenchmarkRun aggregate(const std::vector<BenchmarkRun>& runs,
+                       const std::string& name)
+{
+    BenchmarkRun result = runs.front();
+    result.aggregate = name;
+    result.repetitionIndex = -1;
+
+    std::vector<double> wallTimes, cpuTimes;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        wallTimes.push_back(runs[i].wallTime);
+        cpuTimes.push_back(runs[i].cpuTime);
+    }
+    const double n = runs.size();
+    if (name == "mean" || name == "stddev") {
+        double wallMean = 0., cpuMean = 0.;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            wallMean += wallTimes[i] / n;
+            cpuMean += cpuTimes[i] / n;
+        }
+        result.wallTime = wallMean;
+        result.cpuTime = cpuMean;
+        if (name == "stddev") {
+            double wallVar = 0., cpuVar = 0.;
+            for (size_t i = 0; i < runs.size(); ++i) {
+                wallVar += (wallTimes[i] - wallMean) *
+                        (wallTimes[i] - wallMean);
+                cpuVar += (cpuTimes[i] - cpuMean) * (cpuTimes[i] - cpuMean);
+            }
+            result.wallTime = n > 1 ? std::sqrt(wallVar / (n - 1)) : 0.;
+            result.cpuTime = n > 1 ? std::sqrt(cpuVar / (n - 1)) : 0.;
+        }
+    } else if (name == "median") {
+        std::sort(wallTimes.begin(), wallTimes.end());
+        std::sort(cpuTimes.begin(), cpuTimes.end());
+        const size_t mid = runs.size() / 2;
+        result.wallTime = runs.size() % 2 ? wallTimes[mid] :
+                0.5 * (wallTimes[mid - 1] + wallTimes[mid]);
+        result.cpuTime = runs.size() % 2 ? cpuTimes[mid] :
+                0.5 * (cpuTimes[mid - 1] + cpuTimes[mid]);
+    } else { // min
+        result.wallTime = *std::min_element(wallTimes.begin(),
+                                            wallTimes.end());
+        result.cpuTime = *std::min_element(cpuTimes.begin(), cpuTimes.end());
+    }
+    // Rates are rescaled to the aggregated time per iteration
+    const double scale = result.wallTime > 0. && runs.front().wallTime > 0. ?
+                runs.front().wallTime / result.wallTime : 0.;
+    result.itemsPerSecond = name == "stddev" ? 0. :
+            runs.front().itemsPerSecond * scale;
+    result.bytesPerSecond = name == "stddev" ? 0. :
+            runs.front().bytesPerSecond * scale;
+    return result;
+}
+
+std::string jsonString(const std::string& str)
+{
+    std::ostringstream out;
+    out << '"';
+    for (size_t i = 0; i < str.size(); ++i) {
+        const char c = str[i];
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c == '\n')
+            out << "\\n";
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::sprintf(buffer, "\\u%04x", c);
+            out << buffer;
+        } else
+            out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+std::string jsonNumber(double value)
+{
+    if (!(value == value) || std::abs(value) > 1e300) // NaN or infinity
+        return "null";
+    std::ostringstream out;
+    out << std::setprecision(12) << value;
+    return out.str();
+}
+
+} // namespace
+
+BenchmarkArguments& BenchmarkArguments::operator,(int argument)
+{
+    std::ostringstream str;
+    str << argument;
+    m_arguments.push_back(str.str());
+    return *this;
+}
+
+BenchmarkSettings::BenchmarkSettings() :
+    minTime(0.5), maxIterations(1000000000), repetitions(1),
+    threadCounts(1, 1), hardwareCounters(false), peakFlopRate(0.),
+    peakBandwidth(0.)
+{
+}
+
+BenchmarkState::BenchmarkState(const std::string& argument, int threadCount,
+                               const BenchmarkSettings& settings) :
+    m_argument(argument), m_threadCount(threadCount), m_settings(settings),
+    m_iterations(0), m_running(false), m_paused(false), m_wallTime(0.),
+    m_cpuTime(0.), m_cpuStart(0), m_itemsProcessed(0.),
+    m_bytesProcessed(0.), m_flopsProcessed(0.)
+{
+    std::fill(m_hardwareStart,
+              m_hardwareStart + Fiber::HardwareCounter::COUNTER_COUNT, 0);
+    std::fill(m_hardwareCounts,
+              m_hardwareCounts + Fiber::HardwareCounter::COUNTER_COUNT, 0);
+    if (settings.hardwareCounters)
+        m_hardwareCounters.reset(new Fiber::HardwareCounters);
+}
+
+bool BenchmarkState::keepRunning()
+{
+    if (!m_running) {
+        if (m_iterations > 0)
+            throw std::logic_error("BenchmarkState::keepRunning(): "
+                                   "the loop has already finished");
+        m_running = true;
+        m_paused = false;
+        if (m_hardwareCounters)
+            m_hardwareCounters->read(m_hardwareStart);
+        m_wallStart = tbb::tick_count::now();
+        m_cpuStart = std::clock();
+        return true;
+    }
+    ++m_iterations;
+    double elapsed = m_wallTime;
+    if (!m_paused)
+        elapsed += (tbb::tick_count::now() - m_wallStart).seconds();
+    if (m_iterations < m_settings.maxIterations &&
+            elapsed < m_settings.minTime)
+        return true;
+    if (!m_paused)
+        pauseTiming();
+    m_running = false;
+    return false;
+}
+
+void BenchmarkState::pauseTiming()
+{
+    if (!m_running || m_paused)
+        throw std::logic_error("BenchmarkState::pauseTiming(): "
+                               "the timer is not running");
+    m_wallTime += (tbb::tick_count::now() - m_wallStart).seconds();
+    m_cpuTime += double(std::clock() - m_cpuStart) / CLOCKS_PER_SEC;
+    if (m_hardwareCounters) {
+        uint64_t now[Fiber::HardwareCounter::COUNTER_COUNT];
+        m_hardwareCounters->read(now);
+        for (int c = 0; c < Fiber::HardwareCounter::COUNTER_COUNT; ++c)
+            m_hardwareCounts[c] += now[c] - m_hardwareStart[c];
+    }
+    m_paused = true;
+}
+
+void BenchmarkState::resumeTiming()
+{
+    if (!m_running || !m_paused)
+        throw std::logic_error("BenchmarkState::resumeTiming(): "
+                               "the timer is not paused");
+    if (m_hardwareCounters)
+        m_hardwareCounters->read(m_hardwareStart);
+    m_wallStart = tbb::tick_count::now();
+    m_cpuStart = std::clock();
+    m_paused = false;
+}
+
+unsigned BenchmarkState::hardwareCounterMask() const
+{
+    return m_hardwareCounters ? m_hardwareCounters->availabilityMask() : 0;
+}
+
+int BenchmarkState::intArgument() const
+{
+    char* end = 0;
+    const long value = std::strtol(m_argument.c_str(), &end, 10);
+    if (m_argument.empty() || *end != '\0')
+        throw std::invalid_argument("BenchmarkState::intArgument(): "
+                                    "argument '" + m_argument +
+                                    "' is not an integer");
+    return static_cast<int>(value);
+}
+
+std::string BenchmarkState::meshPath(const std::string& fileName) const
+{
+    for (size_t i = 0; i < m_settings.meshDirectories.size(); ++i) {
+        const std::string path =
+                m_settings.meshDirectories[i] + "/" + fileName;
+        if (std::ifstream(path.c_str()).good())
+            return path;
+    }
+    throw std::runtime_error("BenchmarkState::meshPath(): mesh '" +
+                             fileName + "' not found in the mesh "
+                             "directories");
+}
+
+int registerBenchmark(const std::string& name,
+                      const BenchmarkFunction& function,
+                      const BenchmarkArguments& arguments,
+                      Threading threading)
+{
+    BenchmarkDefinition benchmark;
+    benchmark.name = name;
+    benchmark.function = function;
+    benchmark.arguments = arguments.arguments();
+    benchmark.threading = threading;
+    registry().push_back(benchmark);
+    return registry().size() - 1;
+}
+
+void listBenchmarks(const std::string& filter, std::ostream& out)
+{
+    const std::regex pattern(filter);
+    const std::vector<BenchmarkDefinition>& benchmarks = registry();
+    for (size_t b = 0; b < benchmarks.size(); ++b) {
+        const std::vector<std::string> args = arguments(benchmarks[b]);
+        for (size_t a = 0; a < args.size(); ++a) {
+            const std::string name = runName(benchmarks[b], args[a], 1);
+            if (std::regex_search(name, pattern))
+                out << name << std::endl;
+        }
+    }
+}
+
+std::vector<BenchmarkRun> runBenchmarks(const std::string& filter,
+                                        const BenchmarkSettings& settings,
+                                        std::ostream& progress)
+{
+    const std::regex pattern(filter);
+    const std::vector<BenchmarkDefinition>& benchmarks = registry();
+    const int repetitions = std::max(settings.repetitions, 1);
+    std::vector<BenchmarkRun> result;
+
+    progress << std::left << std::setw(60) << "Benchmark" << std::right
+             << std::setw(14) << "Time" << std::setw(14) << "CPU"
+             << std::setw(12) << "Iterations" << std::endl;
+    for (size_t b = 0; b < benchmarks.size(); ++b) {
+        const BenchmarkDefinition& benchmark = benchmarks[b];
+        const std::vector<std::string> args = arguments(benchmark);
+        const std::vector<int> threads = threadCounts(benchmark, settings);
+        for (size_t a = 0; a < args.size(); ++a)
+            for (size_t t = 0; t < threads.size(); ++t) {
+                const std::string name =
+                        runName(benchmark, args[a], threads[t]);
+                if (!std::regex_search(name, pattern))
+                    continue;
+
+                tbb::task_scheduler_init scheduler(threads[t]);
+                std::vector<BenchmarkRun> runs;
+                for (int r = 0; r < repetitions; ++r) {
+                    BenchmarkRun run;
+                    run.name = name;
+                    run.benchmark = benchmark.name;
+                    run.argument = args[a];
+                    run.threadCount = threads[t];
+                    run.repetitionIndex = r;
+                    run.repetitions = repetitions;
+
+                    BenchmarkState state(args[a], threads[t], settings);
+                    try {
+                        benchmark.function(state);
+                        if (state.iterations() == 0)
+                            throw std::logic_error(
+                                "the benchmark did not call keepRunning()");
+                    }
+                    catch (const std::exception& e) {
+                        run.error = e.what();
+                    }
+                    const double iterations =
+                            std::max<size_t>(state.iterations(), 1);
+                    run.iterations = state.iterations();
+                    run.wallTime = state.wallTime() / iterations;
+                    run.cpuTime = state.cpuTime() / iterations;
+                    run.itemsPerSecond = state.wallTime() > 0. ?
+                                state.itemsProcessed() / state.wallTime() : 0.;
+                    run.bytesPerSecond = state.wallTime() > 0. ?
+                                state.bytesProcessed() / state.wallTime() : 0.;
+                    run.counters = state.counters();
+                    if (run.error.empty())
+                        addHardwareCounters(state, settings, run);
+                    printRun(progress, run);
+                    result.push_back(run);
+                    if (!run.error.empty())
+                        break;
+                    runs.push_back(run);
+                }
+                if (runs.size() > 1) {
+                    const char* names[] = {"mean", "median", "stddev", "min"};
+                    for (int i = 0; i < 4; ++i) {
+                        result.push_back(aggregate(runs, names[i]));
+                        printRun(progress, result.back());
+                    }
+                }
+            }
+    }
+    return result;
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchmarkRun>& runs,
+               const BenchmarkSettings& settings)
+{
+    char date[64];
+    const std::time_t now = std::time(0);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S",
+                  std::localtime(&now));
+
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": " << jsonString(date) << ",\n"
+        << "    \"num_cpus\": "
+        << tbb::task_scheduler_init::default_num_threads() << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\",\n"
+#else
+        << "    \"library_build_type\": \"debug\",\n"
+#endif
+        << "    \"min_time\": " << jsonNumber(settings.minTime) << ",\n"
+        << "    \"repetitions\": " << settings.repetitions << "\n"
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const BenchmarkRun& run = runs[i];
+        const std::string name = run.aggregate.empty() ?
+                    run.name : run.name + "_" + run.aggregate;
+        out << (i ? "," : "") << "\n    {\n"
+            << "      \"name\": " << jsonString(name) << ",\n"
+            << "      \"run_name\": " << jsonString(run.name) << ",\n"
+            << "      \"run_type\": "
+            << (run.aggregate.empty() ? "\"iteration\"" : "\"aggregate\"")
+            << ",\n";
+        if (!run.aggregate.empty())
+            out << "      \"aggregate_name\": " << jsonString(run.aggregate)
+                << ",\n";
+        else
+            out << "      \"repetition_index\": " << run.repetitionIndex
+                << ",\n";
+        out << "      \"repetitions\": " << run.repetitions << ",\n"
+            << "      \"threads\": " << run.threadCount << ",\n"
+            << "      \"argument\": " << jsonString(run.argument) << ",\n"
+            << "      \"iterations\": " << run.iterations << ",\n";
+        if (!run.error.empty())
+            out << "      \"error_occurred\": true,\n"
+                << "      \"error_message\": " << jsonString(run.error)
+                << ",\n";
+        if (run.itemsPerSecond > 0.)
+            out << "      \"items_per_second\": "
+                << jsonNumber(run.itemsPerSecond) << ",\n";
+        if (run.bytesPerSecond > 0.)
+            out << "      \"bytes_per_second\": "
+                << jsonNumber(run.bytesPerSecond) << ",\n";
+        for (std::map<std::string, double>::const_iterator it =
+                 run.counters.begin(); it != run.counters.end(); ++it)
+            out << "      " << jsonString(it->first) << ": "
+                << jsonNumber(it->second) << ",\n";
+        out << "      \"real_time\": " << jsonNumber(run.wallTime * 1e9)
+            << ",\n"
+            << "      \"cpu_time\": " << jsonNumber(run.cpuTime * 1e9)
+            << ",\n"
+            << "      \"time_unit\": \"ns\"\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace Benchmarks
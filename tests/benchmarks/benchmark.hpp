@@ -0,0 +1,266 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_benchmark_hpp
+#define bempp_benchmark_hpp
+
+#include "fiber/hardware_counters.hpp"
+
+#include <cstddef>
+#include <ctime>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tbb/tick_count.h>
+
+/** \brief A minimal benchmark harness.
+ *
+ *  A benchmark is a function taking a BenchmarkState. It prepares its data,
+ *  then repeats the measured code as long as BenchmarkState::keepRunning()
+ *  returns true:
+ *
+ *  \code
+ *  void benchmarkSomething(BenchmarkState &state)
+ *  {
+ *      Data data = prepare(state.argument());
+ *      while (state.keepRunning())
+ *          doSomething(data);
+ *      state.setItemsProcessed(state.iterations() * data.size());
+ *  }
+ *  BEMPP_BENCHMARK("something", benchmarkSomething,
+ *                  (BenchmarkArguments(), "small", "large"), THREADED);
+ *  \endcode
+ *
+ *  Only the loop is timed. Every benchmark is run once per argument and, if
+ *  it is registered as THREADED, once per thread count of the sweep, with
+ *  the TBB scheduler restricted to that number of threads. The JSON output
+ *  follows the format of Google Benchmark, so that its comparison scripts
+ *  can be used to detect regressions between two runs.
+ *
+ *  If BenchmarkSettings::hardwareCounters is set, the hardware counters of
+ *  the thread running the loop (see Fiber::HardwareCounters) are recorded
+ *  while it is timed and reported per iteration, together with the derived
+ *  rates placing the benchmark in a roofline model. Since worker threads
+ *  are not counted, they are most meaningful for single-threaded runs. The
+ *  floating-point operations are taken from setFlopsProcessed() if the
+ *  benchmark calls it. */
+namespace Benchmarks
+{
+
+enum Threading
+{
+    /** \brief Run with a single thread only. */
+    SERIAL,
+    /** \brief Run once for each thread count of the sweep. */
+    THREADED
+};
+
+/** \brief List of the arguments a benchmark is run with. */
+class BenchmarkArguments
+{
+public:
+    BenchmarkArguments& operator,(const std::string& argument) {
+        m_arguments.push_back(argument);
+        return *this;
+    }
+    BenchmarkArguments& operator,(int argument);
+
+    const std::vector<std::string>& arguments() const {
+        return m_arguments;
+    }
+
+private:
+    std::vector<std::string> m_arguments;
+};
+
+/** \brief Settings of a benchmark run. */
+struct BenchmarkSettings
+{
+    BenchmarkSettings();
+
+    /** \brief Minimum time, in seconds, for which the loop of a benchmark
+     *  is repeated. */
+    double minTime;
+    /** \brief Maximum number of iterations of the loop of a benchmark. */
+    size_t maxIterations;
+    /** \brief Number of times each benchmark is repeated. */
+    int repetitions;
+    /** \brief Thread counts of the sweep done by THREADED benchmarks. */
+    std::vector<int> threadCounts;
+    /** \brief Directories searched by meshPath(). */
+    std::vector<std::string> meshDirectories;
+    /** \brief Whether to record hardware counters. */
+    bool hardwareCounters;
+    /** \brief Peak floating-point rate (operations per second) and memory
+     *  bandwidth (bytes per second) of the machine, used to compare the
+     *  benchmarks with the roofline model; 0 if unknown. */
+    double peakFlopRate;
+    double peakBandwidth;
+};
+
+/** \brief State passed to a benchmark function. */
+class BenchmarkState
+{
+public:
+    BenchmarkState(const std::string& argument, int threadCount,
+                   const BenchmarkSettings& settings);
+
+    /** \brief Return true while the measured code should be repeated.
+     *
+     *  The timer is started by the first call. */
+    bool keepRunning();
+
+    /** \brief Exclude the following code from the measurement. */
+    void pauseTiming();
+    /** \brief End a pauseTiming() section. */
+    void resumeTiming();
+
+    const std::string& argument() const { return m_argument; }
+    /** \brief Return the argument, converted to an integer. */
+    int intArgument() const;
+    int threadCount() const { return m_threadCount; }
+    size_t iterations() const { return m_iterations; }
+
+    /** \brief Record the number of items (e.g. kernel evaluations or
+     *  element pairs) processed by all the iterations. */
+    void setItemsProcessed(double items) { m_itemsProcessed = items; }
+    /** \brief Record the number of bytes processed by all the
+     *  iterations. */
+    void setBytesProcessed(double bytes) { m_bytesProcessed = bytes; }
+    /** \brief Record the number of floating-point operations done by all
+     *  the iterations, e.g. counted by hand. */
+    void setFlopsProcessed(double flops) { m_flopsProcessed = flops; }
+    /** \brief Record a user-defined quantity, e.g. the size of the
+     *  problem. */
+    void setCounter(const std::string& name, double value) {
+        m_counters[name] = value;
+    }
+
+    /** \brief Return the path of the mesh \p fileName in the first of the
+     *  mesh directories that contains it. */
+    std::string meshPath(const std::string& fileName) const;
+
+    double wallTime() const { return m_wallTime; }
+    double cpuTime() const { return m_cpuTime; }
+    double itemsProcessed() const { return m_itemsProcessed; }
+    double bytesProcessed() const { return m_bytesProcessed; }
+    double flopsProcessed() const { return m_flopsProcessed; }
+    /** \brief Return the hardware counter values accumulated over the
+     *  timed loop. */
+    const uint64_t* hardwareCounts() const { return m_hardwareCounts; }
+    /** \brief Return the availability mask of the hardware counters, 0 if
+     *  they are not recorded. */
+    unsigned hardwareCounterMask() const;
+    const std::map<std::string, double>& counters() const {
+        return m_counters;
+    }
+
+private:
+    std::string m_argument;
+    int m_threadCount;
+    const BenchmarkSettings& m_settings;
+    size_t m_iterations;
+    bool m_running;
+    bool m_paused;
+    double m_wallTime;
+    double m_cpuTime;
+    tbb::tick_count m_wallStart;
+    std::clock_t m_cpuStart;
+    double m_itemsProcessed;
+    double m_bytesProcessed;
+    double m_flopsProcessed;
+    std::map<std::string, double> m_counters;
+    std::unique_ptr<Fiber::HardwareCounters> m_hardwareCounters;
+    uint64_t m_hardwareStart[Fiber::HardwareCounter::COUNTER_COUNT];
+    uint64_t m_hardwareCounts[Fiber::HardwareCounter::COUNTER_COUNT];
+};
+
+typedef std::function<void(BenchmarkState&)> BenchmarkFunction;
+
+/** \brief Result of a single run of a benchmark. */
+struct BenchmarkRun
+{
+    /** \brief Name of the benchmark with its argument and thread count,
+     *  e.g. "assembly/dense/sphere-h-0.2/threads:4". */
+    std::string name;
+    std::string benchmark;
+    std::string argument;
+    int threadCount;
+    int repetitionIndex;
+    int repetitions;
+    size_t iterations;
+    /** \brief Wall time per iteration, in seconds. */
+    double wallTime;
+    /** \brief CPU time of the process per iteration, in seconds. */
+    double cpuTime;
+    double itemsPerSecond;
+    double bytesPerSecond;
+    std::map<std::string, double> counters;
+    /** \brief Empty for single runs; "mean", "median", "stddev" or "min"
+     *  for statistics of the repetitions. */
+    std::string aggregate;
+    /** \brief Message of the exception thrown by the benchmark, if any. */
+    std::string error;
+};
+
+/** \brief Register a benchmark; return its index.
+ *
+ *  Usually called through BEMPP_BENCHMARK. */
+int registerBenchmark(const std::string& name,
+                      const BenchmarkFunction& function,
+                      const BenchmarkArguments& arguments,
+                      Threading threading);
+
+/** \brief Print the names of the registered benchmarks matching \p filter
+ *  (a regular expression) with their arguments. */
+void listBenchmarks(const std::string& filter, std::ostream& out);
+
+/** \brief Run all the registered benchmarks whose full name matches the
+ *  regular expression \p filter, printing a summary of each run to
+ *  \p progress. */
+std::vector<BenchmarkRun> runBenchmarks(const std::string& filter,
+                                        const BenchmarkSettings& settings,
+                                        std::ostream& progress);
+
+/** \brief Write \p runs to \p out in the JSON format of Google
+ *  Benchmark. */
+void writeJson(std::ostream& out, const std::vector<BenchmarkRun>& runs,
+               const BenchmarkSettings& settings);
+
+} // namespace Benchmarks
+
+#define BEMPP_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BEMPP_BENCHMARK_CONCAT(a, b) BEMPP_BENCHMARK_CONCAT_IMPL(a, b)
+
+/** \brief Register a benchmark at static initialisation time.
+ *
+ *  \p arguments is a parenthesised, comma-separated list starting with
+ *  Benchmarks::BenchmarkArguments(), e.g.
+ *  <tt>(BenchmarkArguments(), 64, 256)</tt>. */
+#define BEMPP_BENCHMARK(name, function, arguments, threading)              \
+    static const int BEMPP_BENCHMARK_CONCAT(benchmarkIndex_, __LINE__) =    \
+        Benchmarks::registerBenchmark(name, function, arguments,           \
+                                      Benchmarks::threading)
+
+#endif
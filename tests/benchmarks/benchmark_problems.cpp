@@ -0,0 +1,73 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "benchmark_problems.hpp"
+
+#include "common/global_parameters.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <map>
+
+using namespace Bempp;
+
+namespace Benchmarks
+{
+
+shared_ptr<const Grid> loadGrid(const std::string& path)
+{
+    static std::map<std::string, shared_ptr<const Grid> > grids;
+    shared_ptr<const Grid>& grid = grids[path];
+    if (!grid) {
+        GridParameters params;
+        params.topology = GridParameters::TRIANGULAR;
+        grid = GridFactory::importGmshGrid(params, path,
+                                           false /* verbose */);
+    }
+    return grid;
+}
+
+shared_ptr<const Space<double> > piecewiseConstants(
+        const shared_ptr<const Grid>& grid)
+{
+    return shared_ptr<const Space<double> >(
+                new PiecewiseConstantScalarSpace<double>(grid));
+}
+
+shared_ptr<const Space<double> > piecewiseLinears(
+        const shared_ptr<const Grid>& grid)
+{
+    return shared_ptr<const Space<double> >(
+                new PiecewiseLinearContinuousScalarSpace<double>(grid));
+}
+
+ParameterList assemblyParameters(const std::string& assemblyType,
+                                 int threadCount)
+{
+    ParameterList parameters = GlobalParameters::parameterList();
+    parameters.set("boundaryOperatorAssemblyType", assemblyType);
+    parameters.set("maxThreadCount", threadCount);
+    parameters.set("verbosityLevel", -5);
+    return parameters;
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,62 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_benchmark_problems_hpp
+#define bempp_benchmark_problems_hpp
+
+#include "common/shared_ptr.hpp"
+#include "common/types.hpp"
+
+#include <string>
+
+namespace Bempp
+{
+class Grid;
+template <typename BasisFunctionType> class Space;
+} // namespace Bempp
+
+namespace Benchmarks
+{
+
+/** \brief Import the triangular grid stored in the Gmsh file \p path.
+ *
+ *  Grids are kept for the lifetime of the program, so that each mesh is
+ *  read only once. */
+Bempp::shared_ptr<const Bempp::Grid> loadGrid(const std::string& path);
+
+/** \brief Return the space of piecewise constant functions on \p grid. */
+Bempp::shared_ptr<const Bempp::Space<double> > piecewiseConstants(
+        const Bempp::shared_ptr<const Bempp::Grid>& grid);
+
+/** \brief Return the space of continuous piecewise linear functions on
+ *  \p grid. */
+Bempp::shared_ptr<const Bempp::Space<double> > piecewiseLinears(
+        const Bempp::shared_ptr<const Bempp::Grid>& grid);
+
+/** \brief Return the global parameters used by the assembly benchmarks.
+ *
+ *  \p assemblyType is "dense" or "hmat". Assembly runs on at most
+ *  \p threadCount threads and nothing is printed out. */
+Bempp::ParameterList assemblyParameters(const std::string& assemblyType,
+                                        int threadCount);
+
+} // namespace Benchmarks
+
+#endif
@@ -0,0 +1,57 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Benchmarks of the Gmsh reader.
+
+#include "benchmark.hpp"
+
+#include "io/gmsh.hpp"
+
+#include <fstream>
+
+using namespace Benchmarks;
+using namespace Bempp;
+
+namespace
+{
+
+void benchmarkRead(BenchmarkState& state)
+{
+    const std::string path = state.meshPath(state.argument());
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    const double fileSize = file.tellg();
+
+    int nodeCount = 0, elementCount = 0;
+    while (state.keepRunning()) {
+        GmshData data = GmshData::read(path);
+        nodeCount = data.numberOfNodes();
+        elementCount = data.numberOfElements();
+    }
+    state.setBytesProcessed(state.iterations() * fileSize);
+    state.setCounter("nodes", nodeCount);
+    state.setCounter("elements", elementCount);
+}
+
+} // namespace
+
+// The argument is the mesh file
+BEMPP_BENCHMARK("gmsh/read", benchmarkRead,
+                (BenchmarkArguments(), "sphere-ico-2.msh", "sphere-h-0.1.msh",
+                 "sphere-h-0.025.msh", "cube-h-0.00625.msh"), THREADED);
@@ -0,0 +1,120 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Benchmarks of the product of H-matrices with vectors. The H-matrix of the
+// weak form of the Laplace single-layer operator is assembled once per mesh
+// and kept for all the runs.
+
+#include "benchmark.hpp"
+#include "benchmark_problems.hpp"
+
+#include "assembly/boundary_operator.hpp"
+#include "assembly/discrete_hmat_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "hmat/hmatrix.hpp"
+#include "space/space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <map>
+#include <random>
+#include <stdexcept>
+
+using namespace Benchmarks;
+using namespace Bempp;
+
+namespace
+{
+
+typedef hmat::DefaultHMatrixType<double> HMatrix;
+
+shared_ptr<const HMatrix> laplaceSingleLayerHMatrix(const std::string& path)
+{
+    static std::map<std::string, shared_ptr<const HMatrix> > matrices;
+    shared_ptr<const HMatrix>& matrix = matrices[path];
+    if (!matrix) {
+        shared_ptr<const Grid> grid = loadGrid(path);
+        shared_ptr<const Space<double> > constants =
+                piecewiseConstants(grid);
+        BoundaryOperator<double, double> op =
+                laplace3dSingleLayerBoundaryOperator<double, double>(
+                    assemblyParameters("hmat", -1 /* automatic */),
+                    constants, constants, constants);
+        shared_ptr<const DiscreteHMatBoundaryOperator<double> > weakForm =
+                dynamic_pointer_cast<
+                    const DiscreteHMatBoundaryOperator<double> >(
+                    op.weakForm());
+        if (!weakForm)
+            throw std::logic_error("laplaceSingleLayerHMatrix(): "
+                                   "weak form is not an H-matrix");
+        matrix = weakForm->hMatrix();
+    }
+    return matrix;
+}
+
+void benchmarkApply(BenchmarkState& state, int columnCount)
+{
+    shared_ptr<const HMatrix> matrix =
+            laplaceSingleLayerHMatrix(state.meshPath(state.argument()));
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(-1., 1.);
+    arma::Mat<double> x(matrix->columns(), columnCount);
+    for (size_t i = 0; i < x.n_elem; ++i)
+        x[i] = distribution(generator);
+    arma::Mat<double> y(matrix->rows(), columnCount);
+    y.fill(0.);
+
+    while (state.keepRunning())
+        matrix->apply(x, y, hmat::NOTRANS, 1., 0.);
+    state.setItemsProcessed(double(state.iterations()) * columnCount);
+    // Each stored entry is read once and used in one multiply-add per
+    // column
+    const double entries =
+            matrix->statistics().memSizeKb * 1024. / sizeof(double);
+    state.setBytesProcessed(double(state.iterations()) * entries *
+                            sizeof(double));
+    state.setFlopsProcessed(double(state.iterations()) * 2. * entries *
+                            columnCount);
+    state.setCounter("rows", matrix->rows());
+    state.setCounter("columns", matrix->columns());
+}
+
+void benchmarkApplyToVector(BenchmarkState& state)
+{
+    benchmarkApply(state, 1);
+}
+
+void benchmarkApplyToBlock(BenchmarkState& state)
+{
+    benchmarkApply(state, 16);
+}
+
+} // namespace
+
+// The argument is the mesh file; the items processed are the products with
+// a single vector
+BEMPP_BENCHMARK("hmatrix/apply/laplace_3d_single_layer",
+                benchmarkApplyToVector,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
+BEMPP_BENCHMARK("hmatrix/apply_16_columns/laplace_3d_single_layer",
+                benchmarkApplyToBlock,
+                (BenchmarkArguments(), "sphere-h-0.1.msh", "sphere-h-0.05.msh"),
+                THREADED);
@@ -0,0 +1,111 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Benchmarks of the integrators of local weak forms: the local weak forms of
+// all element pairs of a mesh are evaluated on a single thread, without the
+// cache of singular integrals.
+
+#include "benchmark.hpp"
+#include "benchmark_problems.hpp"
+
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/elementary_integral_operator_base.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "fiber/local_assembler_for_integral_operators.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
+#include "space/space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace Benchmarks;
+using namespace Bempp;
+
+namespace
+{
+
+typedef ElementaryIntegralOperatorBase<double, double> ElementaryOperator;
+typedef ElementaryOperator::LocalAssembler LocalAssembler;
+
+void benchmarkLocalWeakForms(BenchmarkState& state, bool doubleLayer)
+{
+    shared_ptr<const Grid> grid = loadGrid(state.meshPath(state.argument()));
+    ParameterList parameters = assemblyParameters("dense", 1);
+    parameters.set("enableSingularIntegralCaching", false);
+
+    shared_ptr<const Space<double> > constants = piecewiseConstants(grid);
+    BoundaryOperator<double, double> op = doubleLayer ?
+                laplace3dDoubleLayerBoundaryOperator<double, double>(
+                    parameters, piecewiseLinears(grid), constants,
+                    constants) :
+                laplace3dSingleLayerBoundaryOperator<double, double>(
+                    parameters, constants, constants, constants);
+    shared_ptr<const ElementaryOperator> elementaryOp =
+            dynamic_pointer_cast<const ElementaryOperator>(
+                op.abstractOperator());
+    if (!elementaryOp)
+        throw std::logic_error("benchmarkLocalWeakForms(): "
+                               "not an elementary integral operator");
+    std::unique_ptr<LocalAssembler> assembler = elementaryOp->makeAssembler(
+                *op.context()->quadStrategy(), op.context()->assemblyOptions());
+
+    const int elementCount = grid->leafView()->entityCount(0);
+    std::vector<int> testElements(elementCount);
+    for (int e = 0; e < elementCount; ++e)
+        testElements[e] = e;
+
+    std::vector<arma::Mat<double> > localWeakForms;
+    while (state.keepRunning())
+        for (int trialElement = 0; trialElement < elementCount;
+             ++trialElement)
+            assembler->evaluateLocalWeakForms(TEST_TRIAL, testElements,
+                                              trialElement, ALL_DOFS,
+                                              localWeakForms);
+    state.setItemsProcessed(double(state.iterations()) *
+                            elementCount * elementCount);
+    state.setCounter("elements", elementCount);
+}
+
+void benchmarkLaplaceSingleLayer(BenchmarkState& state)
+{
+    benchmarkLocalWeakForms(state, false);
+}
+
+void benchmarkLaplaceDoubleLayer(BenchmarkState& state)
+{
+    benchmarkLocalWeakForms(state, true);
+}
+
+} // namespace
+
+// The argument is the mesh file
+BEMPP_BENCHMARK("integrators/laplace_3d_single_layer",
+                benchmarkLaplaceSingleLayer,
+                (BenchmarkArguments(), "sphere-ico-1.msh", "sphere-ico-2.msh",
+                 "sphere-h-0.2.msh"), SERIAL);
+BEMPP_BENCHMARK("integrators/laplace_3d_double_layer",
+                benchmarkLaplaceDoubleLayer,
+                (BenchmarkArguments(), "sphere-ico-1.msh", "sphere-ico-2.msh",
+                 "sphere-h-0.2.msh"), SERIAL);
@@ -0,0 +1,158 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Benchmarks of the evaluation of kernels on grids of test and trial points,
+// as done by the integrators for each element pair.
+
+#include "benchmark.hpp"
+
+#include "fiber/collection_of_4d_arrays.hpp"
+#include "fiber/default_collection_of_kernels.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/laplace_3d_adjoint_double_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_double_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_single_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_double_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_single_layer_potential_kernel_functor.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <cmath>
+#include <complex>
+#include <random>
+
+using namespace Benchmarks;
+
+namespace
+{
+
+// Fill geomData with pointCount random points, with unit normals, in the
+// unit cube shifted by offset along the x axis. A fixed seed keeps the runs
+// reproducible.
+template <typename CoordinateType>
+void makeRandomPoints(int pointCount, CoordinateType offset, unsigned seed,
+                      Fiber::GeometricalData<CoordinateType>& geomData)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<CoordinateType> distribution(0., 1.);
+    geomData.globals.set_size(3, pointCount);
+    geomData.normals.set_size(3, pointCount);
+    for (int point = 0; point < pointCount; ++point) {
+        CoordinateType norm = 0.;
+        for (int dim = 0; dim < 3; ++dim) {
+            geomData.globals(dim, point) = distribution(generator);
+            geomData.normals(dim, point) = distribution(generator) + 0.1;
+            norm += geomData.normals(dim, point) *
+                    geomData.normals(dim, point);
+        }
+        geomData.globals(0, point) += offset;
+        for (int dim = 0; dim < 3; ++dim)
+            geomData.normals(dim, point) /= std::sqrt(norm);
+    }
+    geomData.updateSoaLayout();
+}
+
+// flopsPerEvaluation is a nominal count of the floating-point operations of
+// one kernel evaluation, counting square roots, divisions and exponentials as
+// single operations; it gives the roofline position reported with
+// --counters.
+template <typename Functor>
+void benchmarkKernelOnGrid(BenchmarkState& state, const Functor& functor,
+                           double flopsPerEvaluation)
+{
+    typedef typename Functor::ValueType ValueType;
+    typedef typename Functor::CoordinateType CoordinateType;
+
+    Fiber::DefaultCollectionOfKernels<Functor> kernels(functor);
+    const int pointCount = state.intArgument();
+    Fiber::GeometricalData<CoordinateType> testGeomData, trialGeomData;
+    makeRandomPoints<CoordinateType>(pointCount, 0., 1, testGeomData);
+    makeRandomPoints<CoordinateType>(pointCount, 2., 2, trialGeomData);
+
+    Fiber::CollectionOf4dArrays<ValueType> result;
+    while (state.keepRunning())
+        kernels.evaluateOnGrid(testGeomData, trialGeomData, result);
+    const double evaluations = double(state.iterations()) *
+            pointCount * pointCount;
+    state.setItemsProcessed(evaluations);
+    state.setFlopsProcessed(evaluations * flopsPerEvaluation);
+}
+
+const std::complex<double> waveNumber(0.5, -5.);
+
+void benchmarkLaplaceSingleLayer(BenchmarkState& state)
+{
+    benchmarkKernelOnGrid(
+        state, Fiber::Laplace3dSingleLayerPotentialKernelFunctor<double>(),
+        10);
+}
+
+void benchmarkLaplaceDoubleLayer(BenchmarkState& state)
+{
+    benchmarkKernelOnGrid(
+        state, Fiber::Laplace3dDoubleLayerPotentialKernelFunctor<double>(),
+        18);
+}
+
+void benchmarkLaplaceAdjointDoubleLayer(BenchmarkState& state)
+{
+    benchmarkKernelOnGrid(
+        state,
+        Fiber::Laplace3dAdjointDoubleLayerPotentialKernelFunctor<double>(),
+        18);
+}
+
+void benchmarkModifiedHelmholtzSingleLayer(BenchmarkState& state)
+{
+    typedef std::complex<double> CT;
+    benchmarkKernelOnGrid(
+        state,
+        Fiber::ModifiedHelmholtz3dSingleLayerPotentialKernelFunctor<CT>(
+            waveNumber),
+        20);
+}
+
+void benchmarkModifiedHelmholtzDoubleLayer(BenchmarkState& state)
+{
+    typedef std::complex<double> CT;
+    benchmarkKernelOnGrid(
+        state,
+        Fiber::ModifiedHelmholtz3dDoubleLayerPotentialKernelFunctor<CT>(
+            waveNumber),
+        36);
+}
+
+} // namespace
+
+// The argument is the number of test and trial points
+BEMPP_BENCHMARK("kernels/laplace_3d_single_layer",
+                benchmarkLaplaceSingleLayer,
+                (BenchmarkArguments(), 6, 16, 64, 256), SERIAL);
+BEMPP_BENCHMARK("kernels/laplace_3d_double_layer",
+                benchmarkLaplaceDoubleLayer,
+                (BenchmarkArguments(), 6, 16, 64, 256), SERIAL);
+BEMPP_BENCHMARK("kernels/laplace_3d_adjoint_double_layer",
+                benchmarkLaplaceAdjointDoubleLayer,
+                (BenchmarkArguments(), 6, 16, 64, 256), SERIAL);
+BEMPP_BENCHMARK("kernels/modified_helmholtz_3d_single_layer",
+                benchmarkModifiedHelmholtzSingleLayer,
+                (BenchmarkArguments(), 6, 16, 64, 256), SERIAL);
+BEMPP_BENCHMARK("kernels/modified_helmholtz_3d_double_layer",
+                benchmarkModifiedHelmholtzDoubleLayer,
+                (BenchmarkArguments(), 6, 16, 64, 256), SERIAL);
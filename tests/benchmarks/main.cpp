@@ -0,0 +1,196 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "benchmark.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <tbb/task_scheduler_init.h>
+
+using namespace Benchmarks;
+
+namespace
+{
+
+void printUsage(const char* program)
+{
+    std::cout <<
+        "Run the BEM++ benchmarks.\n"
+        "Usage: " << program << " [options]\n"
+        "  --filter=REGEX      run only the benchmarks whose name matches "
+        "REGEX\n"
+        "  --list              list the benchmarks and exit\n"
+        "  --threads=N,M,...   thread counts of the sweep (default: powers "
+        "of 2\n"
+        "                      up to the number of cores)\n"
+        "  --min-time=SECONDS  minimum duration of each run (default: "
+        "0.5)\n"
+        "  --max-iterations=N  maximum number of iterations of each run\n"
+        "  --repetitions=N     repeat each run N times and report "
+        "statistics\n"
+        "  --json=FILE         write the results to FILE ('-' for the "
+        "standard\n"
+        "                      output) in the format of Google Benchmark\n"
+        "  --mesh-dir=DIR      look for meshes in DIR first (may be "
+        "repeated)\n"
+        "  --quick             run each benchmark once with a single "
+        "thread\n"
+        "                      (smoke test)\n"
+        "  --counters          record hardware counters (cycles, "
+        "instructions,\n"
+        "                      stalls, cache misses; floating-point "
+        "operations\n"
+        "                      if BEMPP_PERF_FLOP_EVENT is set) of the "
+        "thread\n"
+        "                      running each benchmark\n"
+        "  --peak-gflops=X     peak floating-point rate of the machine, "
+        "for the\n"
+        "                      roofline position reported with "
+        "--counters\n"
+        "  --peak-bandwidth=X  peak memory bandwidth in GB/s, ditto\n";
+}
+
+bool hasPrefix(const std::string& str, const std::string& prefix,
+               std::string& value)
+{
+    if (str.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    value = str.substr(prefix.size());
+    return true;
+}
+
+std::vector<int> parseThreadCounts(const std::string& str)
+{
+    std::vector<int> result;
+    std::istringstream in(str);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const int count = std::atoi(item.c_str());
+        if (count < 1)
+            throw std::invalid_argument("invalid thread count '" + item +
+                                        "'");
+        result.push_back(count);
+    }
+    if (result.empty())
+        throw std::invalid_argument("no thread counts given");
+    return result;
+}
+
+std::vector<int> defaultThreadCounts()
+{
+    const int maxCount = tbb::task_scheduler_init::default_num_threads();
+    std::vector<int> result;
+    for (int count = 1; count < maxCount; count *= 2)
+        result.push_back(count);
+    result.push_back(maxCount);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+    settings.threadCounts = defaultThreadCounts();
+    std::string filter = ".";
+    std::string jsonFile;
+    std::vector<std::string> meshDirectories;
+    bool list = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            std::string value;
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--list")
+                list = true;
+            else if (arg == "--quick") {
+                settings.minTime = 0.;
+                settings.repetitions = 1;
+                settings.threadCounts = std::vector<int>(1, 1);
+            } else if (arg == "--counters")
+                settings.hardwareCounters = true;
+            else if (hasPrefix(arg, "--peak-gflops=", value))
+                settings.peakFlopRate = 1e9 * std::atof(value.c_str());
+            else if (hasPrefix(arg, "--peak-bandwidth=", value))
+                settings.peakBandwidth = 1e9 * std::atof(value.c_str());
+            else if (hasPrefix(arg, "--filter=", value))
+                filter = value;
+            else if (hasPrefix(arg, "--threads=", value))
+                settings.threadCounts = parseThreadCounts(value);
+            else if (hasPrefix(arg, "--min-time=", value))
+                settings.minTime = std::atof(value.c_str());
+            else if (hasPrefix(arg, "--max-iterations=", value))
+                settings.maxIterations = std::atol(value.c_str());
+            else if (hasPrefix(arg, "--repetitions=", value))
+                settings.repetitions = std::atoi(value.c_str());
+            else if (hasPrefix(arg, "--json=", value))
+                jsonFile = value;
+            else if (hasPrefix(arg, "--mesh-dir=", value))
+                meshDirectories.push_back(value);
+            else
+                throw std::invalid_argument("unknown option '" + arg + "'");
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    settings.meshDirectories = meshDirectories;
+    settings.meshDirectories.push_back(BEMPP_BENCHMARK_MESH_DIR);
+    settings.meshDirectories.push_back(BEMPP_BENCHMARK_UNIT_TEST_MESH_DIR);
+
+    if (list) {
+        listBenchmarks(filter, std::cout);
+        return 0;
+    }
+
+    // With --json=- the progress report goes to the standard error, so that
+    // the standard output contains valid JSON only
+    std::ostream& progress = jsonFile == "-" ? std::cerr : std::cout;
+    const std::vector<BenchmarkRun> runs =
+            runBenchmarks(filter, settings, progress);
+
+    if (jsonFile == "-")
+        writeJson(std::cout, runs, settings);
+    else if (!jsonFile.empty()) {
+        std::ofstream out(jsonFile.c_str());
+        if (!out) {
+            std::cerr << argv[0] << ": cannot write to '" << jsonFile
+                      << "'\n";
+            return 2;
+        }
+        writeJson(out, runs, settings);
+    }
+
+    for (size_t i = 0; i < runs.size(); ++i)
+        if (!runs[i].error.empty())
+            return 1;
+    return 0;
+}
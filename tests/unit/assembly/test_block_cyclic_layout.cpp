@@ -0,0 +1,73 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "assembly/block_cyclic_layout.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace Bempp;
+
+BOOST_AUTO_TEST_SUITE(BlockCyclicLayoutTests)
+
+BOOST_AUTO_TEST_CASE(every_entry_is_stored_exactly_once)
+{
+    const std::size_t rows = 150, columns = 97;
+    const int processCount = 6, blockSize = 16;
+    std::vector<int> owners(rows * columns, -1);
+    std::size_t storedEntries = 0;
+    for (int rank = 0; rank < processCount; ++rank) {
+        BlockCyclicLayout layout(rows, columns, processCount, rank, blockSize);
+        BOOST_CHECK_EQUAL(layout.processRows(), 2);
+        BOOST_CHECK_EQUAL(layout.processColumns(), 3);
+        storedEntries += layout.localRows() * layout.localColumns();
+        for (std::size_t j = 0; j < layout.localColumns(); ++j)
+            for (std::size_t i = 0; i < layout.localRows(); ++i) {
+                const std::size_t row = layout.globalRow(i);
+                const std::size_t column = layout.globalColumn(j);
+                BOOST_REQUIRE(row < rows && column < columns);
+                BOOST_CHECK_EQUAL(layout.rowOwner(row), layout.processRow());
+                BOOST_CHECK_EQUAL(layout.columnOwner(column),
+                                  layout.processColumn());
+                BOOST_CHECK_EQUAL(layout.localRow(row), i);
+                BOOST_CHECK_EQUAL(layout.localColumn(column), j);
+                BOOST_CHECK_EQUAL(owners[row * columns + column], -1);
+                owners[row * columns + column] = rank;
+            }
+    }
+    BOOST_CHECK_EQUAL(storedEntries, rows * columns);
+}
+
+BOOST_AUTO_TEST_CASE(local_count_agrees_with_numroc)
+{
+    // 10 blocks of 4 and a partial block of 2 over 3 processes
+    BOOST_CHECK_EQUAL(BlockCyclicLayout::localCount(42, 4, 0, 3), 16u);
+    BOOST_CHECK_EQUAL(BlockCyclicLayout::localCount(42, 4, 1, 3), 14u);
+    BOOST_CHECK_EQUAL(BlockCyclicLayout::localCount(42, 4, 2, 3), 12u);
+}
+
+BOOST_AUTO_TEST_CASE(process_rows_must_divide_process_count)
+{
+    BOOST_CHECK_THROW(BlockCyclicLayout(10, 10, 6, 0, 4, 4),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -25,11 +25,15 @@
 #include "assembly/blocked_boundary_operator.hpp"
 #include "assembly/blocked_operator_structure.hpp"
 #include "assembly/context.hpp"
+#include "assembly/discrete_blocked_boundary_operator.hpp"
 #include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_hmat_boundary_operator.hpp"
 #include "assembly/identity_operator.hpp"
 #include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
 #include "assembly/modified_helmholtz_3d_single_layer_boundary_operator.hpp"
 #include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/scaled_discrete_boundary_operator.hpp"
+#include "common/global_parameters.hpp"
 #include "grid/grid_factory.hpp"
 #include "grid/grid.hpp"
 #include "space/piecewise_constant_scalar_space.hpp"
@@ -38,6 +42,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <boost/type_traits/is_complex.hpp>
+#include <tbb/task_scheduler_init.h>
 
 using namespace Bempp;
 
@@ -144,6 +149,59 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(
       10. * std::numeric_limits<RealType>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    weak_form_async_of_blocked_boundary_operator_matches_weak_form,
+    ValueType, result_types) {
+  // space  | PL0
+  // -------+---
+  // PC0    |  V
+  // PL1    |  V
+
+  typedef ValueType RT;
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  typedef RealType BFT;
+
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  shared_ptr<Grid> grid0 = GridFactory::importGmshGrid(
+      params, "meshes/cube-12-reoriented.msh", false /* verbose */);
+  shared_ptr<Grid> grid1 = GridFactory::importGmshGrid(
+      params, "meshes/cube-12-reoriented-shifted-on-x-by-2.msh",
+      false /* verbose */);
+
+  shared_ptr<Space<BFT>> pc0(new PiecewiseConstantScalarSpace<BFT>(grid0));
+  shared_ptr<Space<BFT>> pl0(
+      new PiecewiseLinearContinuousScalarSpace<BFT>(grid0));
+  shared_ptr<Space<BFT>> pl1(
+      new PiecewiseLinearContinuousScalarSpace<BFT>(grid1));
+
+  AssemblyOptions assemblyOptions;
+  assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+  shared_ptr<NumericalQuadratureStrategy<BFT, RT>> quadStrategy(
+      new NumericalQuadratureStrategy<BFT, RT>);
+  shared_ptr<Context<BFT, RT>> context(
+      new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+  BoundaryOperator<BFT, RT> op00 =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(context, pl0, pl0, pc0);
+  BoundaryOperator<BFT, RT> op10 =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(context, pl0, pl1, pl1);
+
+  BlockedOperatorStructure<BFT, RT> structure;
+  structure.setBlock(0, 0, op00);
+  structure.setBlock(1, 0, op10);
+  Bempp::BlockedBoundaryOperator<BFT, RT> blockedOp(structure);
+
+  arma::Mat<RT> blockedWeakForm = blockedOp.weakFormAsync().get()->asMatrix();
+  arma::Mat<RT> mat00 = op00.weakFormAsync().get()->asMatrix();
+  arma::Mat<RT> mat10 = op10.weakForm()->asMatrix();
+  arma::Mat<RT> nonblockedWeakForm = arma::join_cols(mat00, mat10);
+
+  BOOST_CHECK(check_arrays_are_close<ValueType>(
+      nonblockedWeakForm, blockedWeakForm,
+      10. * std::numeric_limits<RealType>::epsilon()));
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(
     blocked_boundary_operator_produces_correct_weak_form_for_2x3_operator,
     ValueType, result_types) {
@@ -1532,4 +1590,202 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(
 }
 
 #endif // WITH_AHMED
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    asDiscreteHMatBoundaryOperator_produces_correct_weak_form_for_2x2_operator,
+    ValueType, result_types) {
+  // space | PL  PL
+  // ------+-------
+  // PC    |  V   0
+  // PC    |  V   V
+
+  typedef ValueType RT;
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  typedef RealType BFT;
+
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+      params, "meshes/sphere-ico-1.msh", false /* verbose */);
+
+  shared_ptr<Space<BFT>> pwiseConstants(
+      new PiecewiseConstantScalarSpace<BFT>(grid));
+  shared_ptr<Space<BFT>> pwiseLinears(
+      new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+  AssemblyOptions assemblyOptions;
+  assemblyOptions.switchToHMatMode();
+  assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+  shared_ptr<NumericalQuadratureStrategy<BFT, RT>> quadStrategy(
+      new NumericalQuadratureStrategy<BFT, RT>);
+  shared_ptr<Context<BFT, RT>> context(
+      new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+  BoundaryOperator<BFT, RT> op =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+          context, pwiseLinears, pwiseLinears, pwiseConstants);
+
+  BlockedOperatorStructure<BFT, RT> structure;
+  structure.setBlock(0, 0, op);
+  structure.setBlock(1, 0, op);
+  structure.setBlock(1, 1, op);
+  Bempp::BlockedBoundaryOperator<BFT, RT> blockedOp(structure);
+
+  shared_ptr<const DiscreteBlockedBoundaryOperator<RT>> blockedWeakForm =
+      boost::dynamic_pointer_cast<const DiscreteBlockedBoundaryOperator<RT>>(
+          blockedOp.weakForm());
+  BOOST_REQUIRE(blockedWeakForm);
+
+  arma::Mat<RT> expected = blockedWeakForm->asMatrix();
+  arma::Mat<RT> merged =
+      blockedWeakForm->asDiscreteHMatBoundaryOperator()->asMatrix();
+
+  BOOST_CHECK(check_arrays_are_close<ValueType>(
+      expected, merged, 100. * std::numeric_limits<RealType>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    blocked_boundary_operator_assembles_blocks_equal_up_to_scalars_once,
+  ValueType, result_types) {
+  // space | PL   PL
+  // ------+---------
+  // PC    |  V   -V
+  // PC    | 2V    0
+
+  typedef ValueType RT;
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  typedef RealType BFT;
+  typedef DiscreteBoundaryOperator<RT> DiscreteOp;
+  typedef ScaledDiscreteBoundaryOperator<RT> ScaledDiscreteOp;
+
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+      params, "meshes/cube-12-reoriented.msh", false /* verbose */);
+
+  shared_ptr<Space<BFT>> pwiseConstants(
+      new PiecewiseConstantScalarSpace<BFT>(grid));
+  shared_ptr<Space<BFT>> pwiseLinears(
+      new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+  AssemblyOptions assemblyOptions;
+  assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+  shared_ptr<NumericalQuadratureStrategy<BFT, RT>> quadStrategy(
+      new NumericalQuadratureStrategy<BFT, RT>);
+  shared_ptr<Context<BFT, RT>> context(
+      new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+  // Three separately created, but equivalent operators
+  BoundaryOperator<BFT, RT> op00 =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+          context, pwiseLinears, pwiseLinears, pwiseConstants);
+  BoundaryOperator<BFT, RT> op01 =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+          context, pwiseLinears, pwiseLinears, pwiseConstants);
+  BoundaryOperator<BFT, RT> op10 =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+          context, pwiseLinears, pwiseLinears, pwiseConstants);
+
+  BlockedOperatorStructure<BFT, RT> structure;
+  structure.setBlock(0, 0, op00);
+  structure.setBlock(0, 1, -op01);
+  structure.setBlock(1, 0, static_cast<RT>(2.) * op10);
+  Bempp::BlockedBoundaryOperator<BFT, RT> blockedOp(structure);
+
+  shared_ptr<const DiscreteBlockedBoundaryOperator<RT>> blockedWeakForm =
+      boost::dynamic_pointer_cast<const DiscreteBlockedBoundaryOperator<RT>>(
+          blockedOp.weakForm());
+  BOOST_REQUIRE(blockedWeakForm);
+
+  shared_ptr<const DiscreteOp> block00 = blockedWeakForm->getComponent(0, 0);
+  shared_ptr<const ScaledDiscreteOp> block01 =
+      boost::dynamic_pointer_cast<const ScaledDiscreteOp>(
+          blockedWeakForm->getComponent(0, 1));
+  shared_ptr<const ScaledDiscreteOp> block10 =
+      boost::dynamic_pointer_cast<const ScaledDiscreteOp>(
+          blockedWeakForm->getComponent(1, 0));
+  BOOST_REQUIRE(block01);
+  BOOST_REQUIRE(block10);
+  BOOST_CHECK(block01->scaledOperator() == block00);
+  BOOST_CHECK(block10->scaledOperator() == block00);
+  BOOST_CHECK(block01->multiplier() == static_cast<RT>(-1.));
+  BOOST_CHECK(block10->multiplier() == static_cast<RT>(2.));
+
+  arma::Mat<RT> mat = op00.weakForm()->asMatrix();
+  arma::Mat<RT> zero(mat.n_rows, mat.n_cols);
+  zero.fill(0.);
+  arma::Mat<RT> expected = arma::join_cols(
+      arma::join_rows(mat, arma::Mat<RT>(-mat)),
+      arma::join_rows(arma::Mat<RT>(static_cast<RT>(2.) * mat), zero));
+
+  BOOST_CHECK(check_arrays_are_close<ValueType>(
+      expected, blockedWeakForm->asMatrix(),
+      10. * std::numeric_limits<RealType>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+    concurrent_blocks_sharing_hmatrix_apply_correctly,
+    ValueType, result_types) {
+  // space | PC   PC
+  // ------+---------
+  // PC    |  V   -V
+  // PC    | 2V    0
+
+  typedef ValueType RT;
+  typedef typename ScalarTraits<ValueType>::RealType RealType;
+  typedef RealType BFT;
+
+  // Several threads, so that the blocks, which share one H-matrix, are
+  // applied concurrently
+  tbb::task_scheduler_init scheduler(4);
+
+  GridParameters params;
+  params.topology = GridParameters::TRIANGULAR;
+  shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+      params, "meshes/sphere-ico-2.msh", false /* verbose */);
+
+  shared_ptr<Space<BFT>> pwiseConstants(
+      new PiecewiseConstantScalarSpace<BFT>(grid));
+
+  AssemblyOptions assemblyOptions;
+  assemblyOptions.switchToHMatMode();
+  assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+  ParameterList parameters = GlobalParameters::parameterList();
+  parameters.sublist("HMat").set("minBlockSize", static_cast<int>(16));
+  shared_ptr<NumericalQuadratureStrategy<BFT, RT>> quadStrategy(
+      new NumericalQuadratureStrategy<BFT, RT>);
+  shared_ptr<Context<BFT, RT>> context(
+      new Context<BFT, RT>(quadStrategy, assemblyOptions, parameters));
+
+  BoundaryOperator<BFT, RT> op =
+      laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+          context, pwiseConstants, pwiseConstants, pwiseConstants);
+
+  BlockedOperatorStructure<BFT, RT> structure;
+  structure.setBlock(0, 0, op);
+  structure.setBlock(0, 1, -op);
+  structure.setBlock(1, 0, static_cast<RT>(2.) * op);
+  Bempp::BlockedBoundaryOperator<BFT, RT> blockedOp(structure);
+  shared_ptr<const DiscreteBoundaryOperator<RT>> blockedWeakForm =
+      blockedOp.weakForm();
+
+  arma::Mat<RT> mat = op.weakForm()->asMatrix();
+  arma::Mat<RT> zero(mat.n_rows, mat.n_cols);
+  zero.fill(0.);
+  arma::Mat<RT> dense = arma::join_cols(
+      arma::join_rows(mat, arma::Mat<RT>(-mat)),
+      arma::join_rows(arma::Mat<RT>(static_cast<RT>(2.) * mat), zero));
+
+  arma::Mat<RT> x(dense.n_cols, 8);
+  x.randn();
+  arma::Mat<RT> expected = dense * x;
+  for (int i = 0; i < 10; ++i) {
+    arma::Mat<RT> y(dense.n_rows, x.n_cols);
+    blockedWeakForm->apply(NO_TRANSPOSE, x, y, static_cast<RT>(1.),
+                           static_cast<RT>(0.));
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+        expected, y, 1000. * std::numeric_limits<RealType>::epsilon()));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
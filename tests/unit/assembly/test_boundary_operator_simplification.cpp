@@ -0,0 +1,205 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/identity_operator.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <limits>
+
+using namespace Bempp;
+
+template <typename BFT, typename RT>
+struct SimplificationFixture
+{
+    SimplificationFixture()
+    {
+        grid = createRegularTriangularGrid();
+        space.reset(new PiecewiseConstantScalarSpace<BFT>(grid));
+
+        AccuracyOptions accuracyOptions;
+        shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+        AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        context.reset(new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+        slp = laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                context, space, space, space);
+        dlp = laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                context, space, space, space);
+        id = identityOperator<BFT, RT>(context, space, space, space);
+    }
+
+    shared_ptr<Grid> grid;
+    shared_ptr<Space<BFT> > space;
+    shared_ptr<Context<BFT, RT> > context;
+    BoundaryOperator<BFT, RT> slp, dlp, id;
+};
+
+BOOST_AUTO_TEST_SUITE(BoundaryOperatorSimplification)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(terms_with_zero_weight_are_dropped,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    BoundaryOperator<BFT, RT> op =
+            fixture.slp + static_cast<RT>(0.) * fixture.dlp;
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    op.weakForm()->asMatrix(),
+                    fixture.slp.weakForm()->asMatrix(),
+                    100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(cancelling_terms_give_null_weak_form,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    BoundaryOperator<BFT, RT> op = fixture.slp - fixture.slp;
+
+    arma::Mat<RT> matrix = op.weakForm()->asMatrix();
+    BOOST_CHECK_EQUAL(matrix.n_rows, fixture.space->globalDofCount());
+    BOOST_CHECK_EQUAL(matrix.n_cols, fixture.space->globalDofCount());
+    BOOST_CHECK(arma::all(arma::vectorise(matrix) == static_cast<RT>(0.)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(repeated_terms_are_merged,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    // The second single-layer operator is a separate object with the same
+    // identifier
+    BoundaryOperator<BFT, RT> op =
+            fixture.slp + fixture.dlp +
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.context, fixture.space, fixture.space, fixture.space);
+
+    arma::Mat<RT> expected =
+            static_cast<RT>(2.) * fixture.slp.weakForm()->asMatrix() +
+            fixture.dlp.weakForm()->asMatrix();
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    op.weakForm()->asMatrix(), expected,
+                    100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(scalings_of_factors_are_folded,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    BoundaryOperator<BFT, RT> op =
+            (static_cast<RT>(2.) * fixture.slp) *
+            (static_cast<RT>(3.) * fixture.dlp);
+    BoundaryOperator<BFT, RT> product = fixture.slp * fixture.dlp;
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    op.weakForm()->asMatrix(),
+                    static_cast<RT>(6.) * product.weakForm()->asMatrix(),
+                    1000. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(products_with_zero_give_null_weak_form,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    BoundaryOperator<BFT, RT> op =
+            fixture.slp * (static_cast<RT>(0.) * fixture.dlp);
+
+    arma::Mat<RT> matrix = op.weakForm()->asMatrix();
+    BOOST_CHECK_EQUAL(matrix.n_rows, fixture.space->globalDofCount());
+    BOOST_CHECK_EQUAL(matrix.n_cols, fixture.space->globalDofCount());
+    BOOST_CHECK(arma::all(arma::vectorise(matrix) == static_cast<RT>(0.)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(identity_factors_are_dropped,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    arma::Mat<RT> expected = fixture.slp.weakForm()->asMatrix();
+
+    BoundaryOperator<BFT, RT> left = fixture.id * fixture.slp;
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    left.weakForm()->asMatrix(), expected,
+                    10. * std::numeric_limits<CT>::epsilon()));
+    BoundaryOperator<BFT, RT> right = fixture.slp * fixture.id;
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    right.weakForm()->asMatrix(), expected,
+                    10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(equal_expressions_share_weak_forms,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    SimplificationFixture<BFT, RT> fixture;
+    BoundaryOperator<BFT, RT> op1 =
+            fixture.slp * (static_cast<RT>(2.) * fixture.dlp + fixture.slp);
+    BoundaryOperator<BFT, RT> op2 =
+            fixture.slp * (static_cast<RT>(2.) * fixture.dlp + fixture.slp);
+    BoundaryOperator<BFT, RT> op3 =
+            fixture.slp * (static_cast<RT>(3.) * fixture.dlp + fixture.slp);
+
+    shared_ptr<const DiscreteBoundaryOperator<RT> > weakForm1 =
+            op1.weakForm();
+    BOOST_CHECK_EQUAL(op2.weakForm().get(), weakForm1.get());
+    BOOST_CHECK(op3.weakForm().get() != weakForm1.get());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
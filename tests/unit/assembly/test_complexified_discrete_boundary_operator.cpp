@@ -120,4 +120,69 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_no_transpose_and
                     y, expected, 10. * std::numeric_limits<RealType>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_conjugate_transpose_and_several_columns,
+                              RealType, real_result_types)
+{
+    std::srand(1);
+
+    typedef std::complex<RealType> ComplexType;
+
+    ComplexifiedDiscreteBoundaryOperatorFixture<RealType> fixture;
+    arma::Mat<RealType> mat = fixture.op->asMatrix();
+    arma::Mat<ComplexType> complexMat(mat.n_rows, mat.n_cols);
+    complexMat.fill(0.);
+    complexMat.set_real(mat);
+
+    shared_ptr<const DiscreteBoundaryOperator<ComplexType> > dop = fixture.complexifiedOp;
+
+    ComplexType alpha(2., 3.);
+    ComplexType beta(4., -5.);
+
+    arma::Mat<ComplexType> x = generateRandomMatrix<ComplexType>(dop->rowCount(), 3);
+    arma::Mat<ComplexType> y = generateRandomMatrix<ComplexType>(dop->columnCount(), 3);
+
+    arma::Mat<ComplexType> expected = alpha * complexMat.t() * x + beta * y;
+
+    dop->apply(CONJUGATE_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<ComplexType>(
+                    y, expected, 10. * std::numeric_limits<RealType>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_transpose_and_matrix_split_into_column_blocks,
+                              RealType, real_result_types)
+{
+    std::srand(1);
+
+    typedef std::complex<RealType> ComplexType;
+
+    // Large enough for the products to be split into column blocks
+    arma::Mat<RealType> mat = generateRandomMatrix<RealType>(256, 300);
+    arma::Mat<RealType> stolenMat = mat;
+    shared_ptr<const DiscreteBoundaryOperator<RealType> > op(
+                new DiscreteDenseBoundaryOperator<RealType>(stolenMat, 2));
+    shared_ptr<const DiscreteBoundaryOperator<ComplexType> > dop =
+            complexify(op);
+    arma::Mat<ComplexType> complexMat(mat.n_rows, mat.n_cols);
+    complexMat.fill(0.);
+    complexMat.set_real(mat);
+
+    ComplexType alpha(2., 3.);
+    ComplexType beta(4., -5.);
+
+    arma::Col<ComplexType> x = generateRandomVector<ComplexType>(dop->rowCount());
+    arma::Col<ComplexType> y = generateRandomVector<ComplexType>(dop->columnCount());
+    arma::Col<ComplexType> expected = alpha * complexMat.st() * x + beta * y;
+    dop->apply(TRANSPOSE, x, y, alpha, beta);
+    BOOST_CHECK(check_arrays_are_close<ComplexType>(
+                    y, expected, 1000. * std::numeric_limits<RealType>::epsilon()));
+
+    x = generateRandomVector<ComplexType>(dop->columnCount());
+    y = generateRandomVector<ComplexType>(dop->rowCount());
+    expected = alpha * complexMat * x + beta * y;
+    dop->apply(NO_TRANSPOSE, x, y, alpha, beta);
+    BOOST_CHECK(check_arrays_are_close<ComplexType>(
+                    y, expected, 1000. * std::numeric_limits<RealType>::epsilon()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/modified_helmholtz_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+using namespace Bempp;
+
+namespace
+{
+
+const int THREAD_COUNT = 4;
+
+shared_ptr<Grid> createSphere()
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    return GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.4.msh", false /* verbose */);
+}
+
+template <typename BFT, typename RT>
+shared_ptr<Context<BFT, RT> > createContext(bool hmat)
+{
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>);
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    if (hmat)
+        assemblyOptions.switchToHMatMode();
+    return shared_ptr<Context<BFT, RT> >(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+}
+
+template <typename BFT, typename RT>
+BoundaryOperator<BFT, RT> createOperator(
+        const shared_ptr<const Context<BFT, RT> >& context,
+        const shared_ptr<const Space<BFT> >& pwiseLinears,
+        const shared_ptr<const Space<BFT> >& pwiseConstants,
+        int index)
+{
+    // Different wave numbers, so that the weak form cache of a shared
+    // context does not let the threads share their results
+    return modifiedHelmholtz3dSingleLayerBoundaryOperator<BFT, BFT, RT>(
+                context, pwiseLinears, pwiseLinears, pwiseConstants,
+                static_cast<BFT>(0.5 * (index + 1)));
+}
+
+// Assemble THREAD_COUNT operators on the same grid and spaces from as many
+// application threads at once, using one shared context or a context per
+// thread, and compare them with the operators assembled one by one.
+template <typename RT>
+void checkConcurrentAssembly(bool hmat, bool sharedContext,
+                             typename ScalarTraits<RT>::RealType tolerance)
+{
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    shared_ptr<Grid> grid = createSphere();
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    std::vector<arma::Mat<RT> > expected(THREAD_COUNT);
+    {
+        shared_ptr<Context<BFT, RT> > context = createContext<BFT, RT>(hmat);
+        for (int i = 0; i < THREAD_COUNT; ++i)
+            expected[i] = createOperator<BFT, RT>(
+                        context, pwiseLinears, pwiseConstants, i)
+                    .weakForm()->asMatrix();
+    }
+
+    shared_ptr<Context<BFT, RT> > context = createContext<BFT, RT>(hmat);
+    std::vector<arma::Mat<RT> > actual(THREAD_COUNT);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREAD_COUNT; ++i)
+        threads.push_back(std::thread([&, i]() {
+            shared_ptr<Context<BFT, RT> > threadContext =
+                    sharedContext ? context : createContext<BFT, RT>(hmat);
+            actual[i] = createOperator<BFT, RT>(
+                        threadContext, pwiseLinears, pwiseConstants, i)
+                    .weakForm()->asMatrix();
+        }));
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    for (int i = 0; i < THREAD_COUNT; ++i)
+        BOOST_CHECK(check_arrays_are_close<RT>(actual[i], expected[i],
+                                               tolerance));
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(ConcurrentAssembly)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+        dense_assemblies_from_several_threads_on_shared_context_are_correct,
+        ResultType, result_types)
+{
+    typedef typename ScalarTraits<ResultType>::RealType RealType;
+    checkConcurrentAssembly<ResultType>(
+                false /* hmat */, true /* shared context */,
+                100 * std::numeric_limits<RealType>::epsilon());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+        dense_assemblies_from_several_threads_on_own_contexts_are_correct,
+        ResultType, result_types)
+{
+    typedef typename ScalarTraits<ResultType>::RealType RealType;
+    checkConcurrentAssembly<ResultType>(
+                false /* hmat */, false /* shared context */,
+                100 * std::numeric_limits<RealType>::epsilon());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+        hmat_assemblies_from_several_threads_on_shared_context_are_correct,
+        ResultType, result_types)
+{
+    typedef typename ScalarTraits<ResultType>::RealType RealType;
+    checkConcurrentAssembly<ResultType>(
+                true /* hmat */, true /* shared context */,
+                1000 * std::numeric_limits<RealType>::epsilon());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
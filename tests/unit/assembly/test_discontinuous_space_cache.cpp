@@ -0,0 +1,222 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discontinuous_space_cache.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/synthetic_integral_operator.hpp"
+#include "assembly/synthetic_nonhypersingular_integral_operator_builder.hpp"
+
+#include "common/global_parameters.hpp"
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_segment.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <tbb/parallel_for.h>
+#include <vector>
+
+using namespace Bempp;
+
+namespace
+{
+
+shared_ptr<Grid> createSphere()
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    return GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.4.msh", false /* verbose */);
+}
+
+template <typename BFT, typename RT>
+shared_ptr<Context<BFT, RT> > createContext(bool barycentricOperatorReuse)
+{
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptions.enableBarycentricOperatorReuse(barycentricOperatorReuse);
+    return shared_ptr<Context<BFT, RT> >(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(DiscontinuousSpaceCache_)
+
+BOOST_AUTO_TEST_CASE(barycentric_operator_reuse_is_disabled_by_default)
+{
+    AssemblyOptions assemblyOptions;
+    BOOST_CHECK(!assemblyOptions.isBarycentricOperatorReuseEnabled());
+    assemblyOptions.enableBarycentricOperatorReuse();
+    BOOST_CHECK(assemblyOptions.isBarycentricOperatorReuseEnabled());
+
+    ParameterList parameters = GlobalParameters::parameterList();
+    BOOST_CHECK(!parameters.get<bool>("enableBarycentricOperatorReuse"));
+    parameters.set("enableBarycentricOperatorReuse", true);
+    Context<double, double> context(parameters);
+    BOOST_CHECK(context.assemblyOptions().isBarycentricOperatorReuseEnabled());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(equivalent_spaces_share_discontinuous_space,
+                              ValueType, basis_function_types)
+{
+    typedef ValueType BFT;
+    shared_ptr<Grid> grid = createSphere();
+    shared_ptr<const Space<BFT> > space1(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<const Space<BFT> > space2(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    DiscontinuousSpaceCache<BFT> cache;
+    shared_ptr<const Space<BFT> > discontinuousSpace1 =
+        cache.discontinuousSpace(space1);
+    shared_ptr<const Space<BFT> > discontinuousSpace2 =
+        cache.discontinuousSpace(space2);
+
+    BOOST_CHECK(discontinuousSpace1->isDiscontinuous());
+    BOOST_CHECK(discontinuousSpace1 == space1->discontinuousSpace(space1));
+    BOOST_CHECK(discontinuousSpace2 == discontinuousSpace1);
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(concurrent_calls_return_same_discontinuous_space,
+                              ValueType, basis_function_types)
+{
+    typedef ValueType BFT;
+    shared_ptr<Grid> grid = createSphere();
+    shared_ptr<const Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    const int callCount = 64;
+    std::vector<shared_ptr<const Space<BFT> > > results(callCount);
+    tbb::parallel_for(0, callCount, [&](int i) {
+        results[i] = space->discontinuousSpace(space);
+    });
+    for (int i = 0; i < callCount; ++i)
+        BOOST_CHECK(results[i] == results[0]);
+    BOOST_CHECK(results[0]->isDiscontinuous());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(different_spaces_do_not_share_discontinuous_space,
+                              ValueType, basis_function_types)
+{
+    typedef ValueType BFT;
+    shared_ptr<Grid> grid = createSphere();
+    shared_ptr<const Space<BFT> > wholeSpace(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<const Space<BFT> > segmentSpace(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(
+            grid, gridSegmentWithPositiveX(*grid)));
+    shared_ptr<const Space<BFT> > constantSpace(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<const Space<BFT> > otherGridSpace(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(createSphere()));
+
+    DiscontinuousSpaceCache<BFT> cache;
+    shared_ptr<const Space<BFT> > wholeDiscontinuous =
+        cache.discontinuousSpace(wholeSpace);
+    BOOST_CHECK(cache.discontinuousSpace(segmentSpace) != wholeDiscontinuous);
+    BOOST_CHECK(cache.discontinuousSpace(constantSpace) != wholeDiscontinuous);
+    BOOST_CHECK(cache.discontinuousSpace(otherGridSpace) !=
+                wholeDiscontinuous);
+    BOOST_CHECK_EQUAL(cache.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(expired_discontinuous_spaces_are_not_returned,
+                              ValueType, basis_function_types)
+{
+    typedef ValueType BFT;
+    shared_ptr<Grid> grid = createSphere();
+    DiscontinuousSpaceCache<BFT> cache;
+    {
+        shared_ptr<const Space<BFT> > space(
+            new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+        cache.discontinuousSpace(space);
+        BOOST_CHECK_EQUAL(cache.size(), 1u);
+    }
+    shared_ptr<const Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<const Space<BFT> > discontinuousSpace =
+        cache.discontinuousSpace(space);
+    BOOST_CHECK(discontinuousSpace == space->discontinuousSpace(space));
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(internal_operators_use_context_if_reuse_is_enabled,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef SyntheticIntegralOperator<BFT, RT> SyntheticOp;
+
+    shared_ptr<Grid> grid = createSphere();
+    shared_ptr<const Space<BFT> > space1(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<const Space<BFT> > space2(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    shared_ptr<const Context<BFT, RT> > internalContext, auxContext;
+
+    shared_ptr<const Context<BFT, RT> > reusingContext =
+        createContext<BFT, RT>(true);
+    SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
+        reusingContext, internalContext, auxContext);
+    BOOST_CHECK(internalContext == reusingContext);
+    BOOST_CHECK(internalDiscontinuousSpace(*reusingContext, space1) ==
+                internalDiscontinuousSpace(*reusingContext, space2));
+
+    shared_ptr<const Context<BFT, RT> > context =
+        createContext<BFT, RT>(false);
+    SyntheticOp::getContextsForInternalAndAuxiliaryOperators(
+        context, internalContext, auxContext);
+    BOOST_CHECK(internalContext != context);
+    BOOST_CHECK(internalDiscontinuousSpace(*context, space1) !=
+                internalDiscontinuousSpace(*context, space2));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(only_barycentric_spaces_are_reused,
+                              ValueType, basis_function_types)
+{
+    typedef ValueType BFT;
+    shared_ptr<Grid> grid = createSphere();
+    shared_ptr<const Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.enableBarycentricOperatorReuse();
+    BOOST_CHECK(!shouldReuseBarycentricOperator(assemblyOptions, space, space));
+    BOOST_CHECK(!shouldReuseBarycentricOperator(
+                    assemblyOptions, shared_ptr<const Space<BFT> >(), space));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "../random_arrays.hpp"
+
+#include "assembly/discrete_block_gauss_seidel_operator.hpp"
+#include "assembly/discrete_blocked_boundary_operator.hpp"
+#include "assembly/discrete_dense_boundary_operator.hpp"
+
+#include "fiber/_2d_array.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+using namespace Bempp;
+
+namespace
+{
+
+// 2 x 2 blocked operator with well-conditioned random blocks, and the
+// exact inverses of its diagonal blocks
+template <typename RT>
+struct BlockGaussSeidelFixture
+{
+    typedef shared_ptr<const DiscreteBoundaryOperator<RT> > OpPtr;
+
+    BlockGaussSeidelFixture(bool lowerTriangular)
+    {
+        const size_t sizes[] = {7, 5};
+        Fiber::_2dArray<OpPtr> blocks(2, 2);
+        std::vector<size_t> counts(sizes, sizes + 2);
+        dense.set_size(12, 12);
+        dense.zeros();
+        size_t offsets[] = {0, 7};
+        for (size_t i = 0; i < 2; ++i)
+            for (size_t j = 0; j < 2; ++j) {
+                if (lowerTriangular && j > i)
+                    continue;
+                arma::Mat<RT> block = generateRandomMatrix<RT>(sizes[i],
+                                                               sizes[j]);
+                if (i == j)
+                    block += RT(2. * sizes[i]) *
+                            arma::eye<arma::Mat<RT> >(sizes[i], sizes[i]);
+                dense.submat(offsets[i], offsets[j],
+                             offsets[i] + sizes[i] - 1,
+                             offsets[j] + sizes[j] - 1) = block;
+                blocks(i, j).reset(
+                            new DiscreteDenseBoundaryOperator<RT>(block));
+                if (i == j)
+                    inverses.push_back(OpPtr(
+                        new DiscreteDenseBoundaryOperator<RT>(
+                            arma::inv(block))));
+            }
+        op.reset(new DiscreteBlockedBoundaryOperator<RT>(blocks, counts,
+                                                         counts));
+    }
+
+    arma::Mat<RT> dense;
+    shared_ptr<const DiscreteBlockedBoundaryOperator<RT> > op;
+    std::vector<OpPtr> inverses;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(DiscreteBlockGaussSeidelOperatorTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(forward_sweep_inverts_block_lower_triangular_op,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    BlockGaussSeidelFixture<RT> fixture(true);
+    DiscreteBlockGaussSeidelOperator<RT> gaussSeidel(fixture.op,
+                                                     fixture.inverses);
+    BOOST_CHECK_EQUAL(gaussSeidel.rowCount(), 12u);
+    BOOST_CHECK_EQUAL(gaussSeidel.columnCount(), 12u);
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(12, 3);
+    arma::Mat<RT> y(12, 3);
+    gaussSeidel.apply(NO_TRANSPOSE, x, y, 1., 0.);
+    arma::Mat<RT> expected = arma::solve(fixture.dense, x);
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected, CT(1e-4)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(symmetric_sweep_agrees_with_dense_formula,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    BlockGaussSeidelFixture<RT> fixture(false);
+    DiscreteBlockGaussSeidelOperator<RT> gaussSeidel(
+                fixture.op, fixture.inverses, true /* symmetric */);
+
+    // Forward sweep y0 = (D + L)^{-1} x, backward sweep
+    // y = (D + U)^{-1} (x - L y0)
+    const arma::Mat<RT> &A = fixture.dense;
+    arma::Mat<RT> D = A, L = A, U = A;
+    D.submat(0, 7, 6, 11).zeros();
+    D.submat(7, 0, 11, 6).zeros();
+    L.zeros();
+    L.submat(7, 0, 11, 6) = A.submat(7, 0, 11, 6);
+    U.zeros();
+    U.submat(0, 7, 6, 11) = A.submat(0, 7, 6, 11);
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(12, 2);
+    arma::Mat<RT> y0 = arma::solve(arma::Mat<RT>(D + L), x);
+    arma::Mat<RT> expected =
+            arma::solve(arma::Mat<RT>(D + U), arma::Mat<RT>(x - L * y0));
+    arma::Mat<RT> y(12, 2);
+    gaussSeidel.apply(NO_TRANSPOSE, x, y, 1., 0.);
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected, CT(1e-4)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -26,6 +26,7 @@
 
 #include "assembly/assembly_options.hpp"
 #include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_dense_boundary_operator.hpp"
 #include "assembly/boundary_operator.hpp"
 #include "assembly/context.hpp"
 #include "assembly/identity_operator.hpp"
@@ -311,4 +312,50 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrix_input_and
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+// Products split into column blocks
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_by_column_blocks_agrees_with_matrix_product_for_all_transposition_modes, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    // Large enough for the products to be split into column blocks
+    const int rowCount = 300, columnCount = 250, rhsCount = 2;
+    arma::Mat<RT> mat = generateRandomMatrix<RT>(rowCount, columnCount);
+    const arma::Mat<RT> expectedMat = mat;
+    // (qualified, since the test suite has the same name as the class)
+    Bempp::DiscreteDenseBoundaryOperator<RT> dop(mat, 4);
+    BOOST_CHECK(mat.is_empty());
+
+    RT alpha(2.);
+    RT beta(3.);
+
+    const TranspositionMode modes[] = {NO_TRANSPOSE, CONJUGATE, TRANSPOSE,
+                                       CONJUGATE_TRANSPOSE};
+    for (int i = 0; i < 4; ++i) {
+        const bool transposed =
+                modes[i] == TRANSPOSE || modes[i] == CONJUGATE_TRANSPOSE;
+        arma::Mat<RT> opMat = expectedMat;
+        if (modes[i] == CONJUGATE)
+            opMat = arma::conj(expectedMat);
+        else if (modes[i] == TRANSPOSE)
+            opMat = expectedMat.st();
+        else if (modes[i] == CONJUGATE_TRANSPOSE)
+            opMat = expectedMat.t();
+
+        arma::Mat<RT> x = generateRandomMatrix<RT>(
+                    transposed ? rowCount : columnCount, rhsCount);
+        arma::Mat<RT> y = generateRandomMatrix<RT>(
+                    transposed ? columnCount : rowCount, rhsCount);
+        arma::Mat<RT> expected = alpha * opMat * x + beta * y;
+
+        dop.apply(modes[i], x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        y, expected, 100. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,193 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "../random_arrays.hpp"
+
+#include "assembly/discrete_dense_boundary_operator.hpp"
+#include "assembly/discrete_synthetic_boundary_operator.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <complex>
+#include <vector>
+
+// Tests
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename RT>
+struct DiscreteSyntheticBoundaryOperatorFixture
+{
+    typedef DiscreteBoundaryOperator<RT> DiscreteOp;
+
+    // A 5 x 7 integral operator combined with two pairs of local operators
+    // mapping from 4 and to 3 degrees of freedom
+    DiscreteSyntheticBoundaryOperatorFixture()
+    {
+        integralMatrix = generateRandomMatrix<RT>(5, 7);
+        integralOp.reset(new DiscreteDenseBoundaryOperator<RT>(integralMatrix));
+        for (int i = 0; i < 2; ++i) {
+            testMatrices.push_back(generateRandomMatrix<RT>(3, 5));
+            trialMatrices.push_back(generateRandomMatrix<RT>(7, 4));
+            testOps.push_back(shared_ptr<const DiscreteOp>(
+                new DiscreteDenseBoundaryOperator<RT>(testMatrices[i])));
+            trialOps.push_back(shared_ptr<const DiscreteOp>(
+                new DiscreteDenseBoundaryOperator<RT>(trialMatrices[i])));
+        }
+    }
+
+    arma::Mat<RT> integralMatrix;
+    std::vector<arma::Mat<RT> > testMatrices, trialMatrices;
+    shared_ptr<const DiscreteOp> integralOp;
+    std::vector<shared_ptr<const DiscreteOp> > testOps, trialOps;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(DiscreteSyntheticBoundaryOperator)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_to_block_works_correctly, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteSyntheticBoundaryOperatorFixture<RT> fixture;
+    Bempp::DiscreteSyntheticBoundaryOperator<RT> dop(
+        fixture.testOps, fixture.integralOp, fixture.trialOps);
+    BOOST_CHECK_EQUAL(dop.rowCount(), 3u);
+    BOOST_CHECK_EQUAL(dop.columnCount(), 4u);
+
+    arma::Mat<RT> expectedMatrix =
+        fixture.testMatrices[0] * fixture.integralMatrix *
+        fixture.trialMatrices[0] +
+        fixture.testMatrices[1] * fixture.integralMatrix *
+        fixture.trialMatrices[1];
+
+    RT alpha(2.);
+    RT beta(3.);
+    arma::Mat<RT> x = generateRandomMatrix<RT>(4, 2);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(3, 2);
+    arma::Mat<RT> expected = alpha * expectedMatrix * x + beta * y;
+
+    dop.apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(conjugate_transpose_apply_works_correctly, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteSyntheticBoundaryOperatorFixture<RT> fixture;
+    Bempp::DiscreteSyntheticBoundaryOperator<RT> dop(
+        fixture.testOps, fixture.integralOp, fixture.trialOps);
+
+    arma::Mat<RT> expectedMatrix =
+        fixture.testMatrices[0] * fixture.integralMatrix *
+        fixture.trialMatrices[0] +
+        fixture.testMatrices[1] * fixture.integralMatrix *
+        fixture.trialMatrices[1];
+
+    RT alpha(2.);
+    RT beta(0.);
+    arma::Mat<RT> x = generateRandomMatrix<RT>(3, 2);
+    arma::Mat<RT> y(4, 2);
+    y.fill(std::numeric_limits<CT>::quiet_NaN());
+    arma::Mat<RT> expected = alpha * expectedMatrix.t() * x;
+
+    dop.apply(CONJUGATE_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(y.is_finite());
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_works_correctly_without_trial_operators, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteSyntheticBoundaryOperatorFixture<RT> fixture;
+    Bempp::DiscreteSyntheticBoundaryOperator<RT> dop(
+        fixture.testOps, fixture.integralOp,
+        std::vector<shared_ptr<const DiscreteBoundaryOperator<RT> > >());
+    BOOST_CHECK_EQUAL(dop.columnCount(), 7u);
+
+    arma::Mat<RT> expectedMatrix =
+        (fixture.testMatrices[0] + fixture.testMatrices[1]) *
+        fixture.integralMatrix;
+
+    RT alpha(2.);
+    RT beta(3.);
+    arma::Mat<RT> x = generateRandomMatrix<RT>(7, 2);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(3, 2);
+    arma::Mat<RT> expected = alpha * expectedMatrix * x + beta * y;
+
+    dop.apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_works_correctly_without_test_operators, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteSyntheticBoundaryOperatorFixture<RT> fixture;
+    Bempp::DiscreteSyntheticBoundaryOperator<RT> dop(
+        std::vector<shared_ptr<const DiscreteBoundaryOperator<RT> > >(),
+        fixture.integralOp, fixture.trialOps);
+    BOOST_CHECK_EQUAL(dop.rowCount(), 5u);
+
+    arma::Mat<RT> expectedMatrix =
+        fixture.integralMatrix *
+        (fixture.trialMatrices[0] + fixture.trialMatrices[1]);
+
+    RT alpha(2.);
+    RT beta(0.);
+    arma::Mat<RT> x = generateRandomMatrix<RT>(4, 2);
+    arma::Mat<RT> y(5, 2);
+    y.fill(std::numeric_limits<CT>::quiet_NaN());
+    arma::Mat<RT> expected = alpha * expectedMatrix * x;
+
+    dop.apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(y.is_finite());
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
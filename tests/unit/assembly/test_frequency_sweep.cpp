@@ -0,0 +1,119 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "assembly/frequency_sweep.hpp"
+
+#include "fiber/memory_registry.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <tbb/atomic.h>
+#include <tbb/tick_count.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace Bempp;
+
+namespace
+{
+
+// Hold memory recorded in the registry for a while, so that frequencies
+// overlap if the sweep lets them
+void holdMemory(std::size_t bytes, tbb::atomic<int> &running,
+                tbb::atomic<int> &peak)
+{
+    Fiber::MemoryAllocation allocation(
+                Fiber::MemoryCategory::DENSE_MATRICES, bytes, "sweep test");
+    int current = ++running;
+    int previous = peak;
+    while (current > previous &&
+           peak.compare_and_swap(current, previous) != previous)
+        previous = peak;
+    tbb::tick_count start = tbb::tick_count::now();
+    while ((tbb::tick_count::now() - start).seconds() < 0.02)
+        ;
+    --running;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FrequencySweepDriver)
+
+BOOST_AUTO_TEST_CASE(results_are_handed_out_once_and_in_order)
+{
+    FrequencySweepOptions options;
+    options.maxThreadCount = 4;
+    options.maxConcurrentFrequencies = 3;
+    FrequencySweep sweep(options);
+
+    const std::size_t frequencyCount = 20;
+    std::vector<std::size_t> consumed;
+    sweep.run(frequencyCount,
+              [](std::size_t index) { return 2 * index; },
+              [&](std::size_t index, std::size_t result) {
+                  BOOST_CHECK_EQUAL(result, 2 * index);
+                  consumed.push_back(index);
+              });
+
+    BOOST_REQUIRE_EQUAL(consumed.size(), frequencyCount);
+    for (std::size_t i = 0; i < frequencyCount; ++i)
+        BOOST_CHECK_EQUAL(consumed[i], i);
+    BOOST_CHECK(sweep.peakConcurrency() <= 3);
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget_limits_the_number_of_concurrent_frequencies)
+{
+    const std::size_t megabyte = 1024 * 1024;
+    FrequencySweepOptions options;
+    options.maxThreadCount = 4;
+    options.maxConcurrentFrequencies = 4;
+    // Room for two frequencies on top of the memory already in use
+    options.memoryBudget =
+            Fiber::MemoryRegistry::liveBytes() / double(megabyte) + 2.5;
+    FrequencySweep sweep(options);
+
+    tbb::atomic<int> running, peak;
+    running = 0;
+    peak = 0;
+    sweep.run(12, [&](std::size_t) { holdMemory(megabyte, running, peak); });
+
+    BOOST_CHECK_EQUAL(sweep.memoryPerFrequency(), megabyte);
+    BOOST_CHECK(sweep.peakConcurrency() <= 2);
+    BOOST_CHECK(peak <= 2);
+}
+
+BOOST_AUTO_TEST_CASE(first_exception_of_a_task_is_rethrown)
+{
+    FrequencySweepOptions options;
+    options.maxThreadCount = 2;
+    FrequencySweep sweep(options);
+
+    tbb::atomic<int> processed;
+    processed = 0;
+    BOOST_CHECK_THROW(sweep.run(10, [&](std::size_t index) {
+                          ++processed;
+                          if (index == 3)
+                              throw std::runtime_error("failed");
+                      }),
+                      std::runtime_error);
+    // Frequencies are started in order, so all up to the failing one ran
+    BOOST_CHECK(processed >= 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
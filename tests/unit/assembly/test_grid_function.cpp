@@ -19,13 +19,16 @@
 // THE SOFTWARE.
 
 #include "../check_arrays_are_close.hpp"
+#include "../random_arrays.hpp"
 #include "../type_template.hpp"
 
 #include "assembly/assembly_options.hpp"
 #include "assembly/boundary_operator.hpp"
 #include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
 #include "assembly/grid_function.hpp"
 #include "assembly/identity_operator.hpp"
+#include "assembly/mass_matrix_cache.hpp"
 #include "assembly/numerical_quadrature_strategy.hpp"
 #include "assembly/surface_normal_independent_function.hpp"
 
@@ -187,4 +190,113 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(L2Norm_works_for_exponential_function_and_piecewis
     BOOST_CHECK_CLOSE(norm, expectedNorm, 1 /* percent */);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(conversions_reuse_cached_mass_matrices, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    Bempp::GridFunction<BFT, RT> fun(context, space, space,
+                surfaceNormalIndependentFunction(
+                    SinusoidalFunction<RT>()));
+    const arma::Col<RT> coefficients = fun.coefficients();
+    const arma::Col<RT> projections = fun.projections(space);
+
+    shared_ptr<MassMatrixCache<BFT, RT> > cache = context->massMatrixCache();
+    BOOST_CHECK_EQUAL(cache->size(), 1u);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > inverse =
+        cache->inverseMassMatrix(context, space, space);
+
+    // A second function over the same spaces is converted with the same
+    // factorised mass matrix
+    Bempp::GridFunction<BFT, RT> copy(context, space, space, projections);
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    copy.coefficients(), coefficients,
+                    100. * std::numeric_limits<CT>::epsilon()));
+    BOOST_CHECK_EQUAL(cache->size(), 1u);
+    BOOST_CHECK(cache->inverseMassMatrix(context, space, space) == inverse);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(linear_combination_agrees_with_operators, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    const size_t dofCount = space->globalDofCount();
+    arma::Col<RT> uCoeffs = generateRandomVector<RT>(dofCount);
+    arma::Col<RT> vCoeffs = generateRandomVector<RT>(dofCount);
+    arma::Col<RT> wProjs = generateRandomVector<RT>(dofCount);
+    Bempp::GridFunction<BFT, RT> u(context, space, uCoeffs);
+    Bempp::GridFunction<BFT, RT> v(context, space, vCoeffs);
+    Bempp::GridFunction<BFT, RT> w(context, space, space, wProjs);
+    const RT a = static_cast<RT>(2.), b = static_cast<RT>(-0.5);
+    const CT tol = 100. * std::numeric_limits<CT>::epsilon();
+
+    std::vector<RT> weights;
+    weights.push_back(a);
+    weights.push_back(b);
+    weights.push_back(static_cast<RT>(-1.));
+    std::vector<const Bempp::GridFunction<BFT, RT>*> functions;
+    functions.push_back(&u);
+    functions.push_back(&v);
+    functions.push_back(&w);
+    Bempp::GridFunction<BFT, RT> combination =
+        linearCombination(weights, functions);
+    BOOST_CHECK(combination.wasInitializedFromCoefficients());
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    combination.coefficients(),
+                    (a * u + b * v - w).coefficients(), tol));
+
+    // Functions initialized from projections are combined in projections
+    Bempp::GridFunction<BFT, RT> twice = w + w;
+    BOOST_CHECK(!twice.wasInitializedFromCoefficients());
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    twice.projections(space),
+                    arma::Col<RT>(static_cast<RT>(2.) * wProjs),
+                    tol));
+
+    // In-place updates leave copies sharing the original vectors intact
+    Bempp::GridFunction<BFT, RT> residual(u);
+    residual *= a;
+    residual.axpy(b, v);
+    residual -= w;
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    residual.coefficients(), combination.coefficients(),
+                    tol));
+    BOOST_CHECK(check_arrays_are_close<RT>(u.coefficients(), uCoeffs, 0.));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -101,4 +101,58 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(interpolated_matches_noniterpolated,
                     matNoninterpolated, matInterpolated, 100 * eps));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(split_singular_kernel_matches_unsplit,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef typename Fiber::ScalarTraits<BFT>::ComplexType RT;
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "meshes/cube-12-reoriented.msh",
+                false /* verbose */);
+
+    PiecewiseLinearContinuousScalarSpace<BFT> pwiseLinears(grid);
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AccuracyOptionsEx accuracyOptions;
+    NumericalQuadratureStrategy<BFT, RT> quadStrategy(accuracyOptions);
+    Context<BFT, RT> context(make_shared_from_ref(quadStrategy),
+                             assemblyOptions);
+
+    AccuracyOptionsEx splitAccuracyOptions;
+    splitAccuracyOptions.setSingularKernelSplitting(true, 4);
+    NumericalQuadratureStrategy<BFT, RT> splitQuadStrategy(
+                splitAccuracyOptions);
+    Context<BFT, RT> splitContext(make_shared_from_ref(splitQuadStrategy),
+                                  assemblyOptions);
+
+    const RT waveNumber(3.23, 0.31);
+
+    BoundaryOperator<BFT, RT> op =
+            helmholtz3dSingleLayerBoundaryOperator<BFT>(
+                make_shared_from_ref(context),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                waveNumber,
+                "", NO_SYMMETRY,
+                false);
+    BoundaryOperator<BFT, RT> opSplit =
+            helmholtz3dSingleLayerBoundaryOperator<BFT>(
+                make_shared_from_ref(splitContext),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                make_shared_from_ref(pwiseLinears),
+                waveNumber,
+                "", NO_SYMMETRY,
+                false);
+
+    arma::Mat<RT> mat = op.weakForm()->asMatrix();
+    arma::Mat<RT> matSplit = opSplit.weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<RT>(mat, matSplit, 1e-3));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_hmat_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+
+using namespace Bempp;
+
+namespace {
+
+// Dense and H-matrix weak forms of the single-layer operator on a sphere
+template <typename BFT>
+struct SingleLayerWeakForms
+{
+    typedef BFT RT;
+
+    SingleLayerWeakForms()
+    {
+        GridParameters params;
+        params.topology = GridParameters::TRIANGULAR;
+        shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                    params, "../../meshes/sphere-h-0.4.msh");
+        shared_ptr<Space<BFT> > pwiseConstants(
+                    new PiecewiseConstantScalarSpace<BFT>(grid));
+
+        AccuracyOptions accuracyOptions;
+        shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                    new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+        AssemblyOptions denseAssemblyOptions;
+        denseAssemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        AssemblyOptions hMatAssemblyOptions = denseAssemblyOptions;
+        hMatAssemblyOptions.switchToHMatMode();
+        shared_ptr<Context<BFT, RT> > denseContext(
+                    new Context<BFT, RT>(quadStrategy, denseAssemblyOptions));
+        shared_ptr<Context<BFT, RT> > hMatContext(
+                    new Context<BFT, RT>(quadStrategy, hMatAssemblyOptions));
+
+        dense = laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    denseContext, pwiseConstants, pwiseConstants,
+                    pwiseConstants).weakForm()->asMatrix();
+        hMat = laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    hMatContext, pwiseConstants, pwiseConstants,
+                    pwiseConstants).weakForm();
+    }
+
+    arma::Mat<RT> dense;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > hMat;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(HMatArithmetic)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(sum_agrees_with_dense_sum,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    SingleLayerWeakForms<BasisFunctionType> weakForms;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > sum =
+            hMatOperatorSum<RT>(weakForms.hMat, weakForms.hMat, 1e-4);
+
+    BOOST_CHECK(boost::dynamic_pointer_cast<
+                const DiscreteHMatBoundaryOperator<RT> >(sum));
+    arma::Mat<RT> expected = RT(2.) * weakForms.dense;
+    BOOST_CHECK(check_arrays_are_close<RT>(sum->asMatrix(), expected,
+                                           CT(1e-2)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(product_agrees_with_dense_product,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    SingleLayerWeakForms<BasisFunctionType> weakForms;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > product =
+            hMatOperatorProduct<RT>(weakForms.hMat, weakForms.hMat, 1e-4);
+
+    arma::Mat<RT> expected = weakForms.dense * weakForms.dense;
+    BOOST_CHECK(check_arrays_are_close<RT>(product->asMatrix(), expected,
+                                           CT(1e-2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
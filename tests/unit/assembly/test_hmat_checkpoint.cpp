@@ -0,0 +1,178 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/global_parameters.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <unistd.h>
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename BFT, typename RT>
+struct CheckpointFixture
+{
+    CheckpointFixture() : fileName("bempp_hmat_checkpoint_test.chk")
+    {
+        GridParameters params;
+        params.topology = GridParameters::TRIANGULAR;
+        shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                    params, "../../meshes/sphere-h-0.4.msh");
+        space.reset(new PiecewiseConstantScalarSpace<BFT>(grid));
+
+        AccuracyOptions accuracyOptions;
+        quadStrategy.reset(
+                    new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.switchToHMatMode();
+
+        parameters = GlobalParameters::parameterList();
+        parameters.sublist("HMat").set("checkpointFile", fileName);
+        parameters.sublist("HMat").set("checkpointInterval",
+                                       static_cast<double>(0));
+        std::remove(fileName.c_str());
+    }
+
+    ~CheckpointFixture()
+    {
+        std::remove(fileName.c_str());
+    }
+
+    // A new context per assembly, so that no weak form is cached
+    arma::Mat<RT> singleLayer(bool checkpointed) const
+    {
+        shared_ptr<Context<BFT, RT> > context(checkpointed ?
+                    new Context<BFT, RT>(quadStrategy, assemblyOptions,
+                                         parameters) :
+                    new Context<BFT, RT>(quadStrategy, assemblyOptions));
+        return laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    context, space, space, space).weakForm()->asMatrix();
+    }
+
+    arma::Mat<RT> doubleLayer(bool checkpointed) const
+    {
+        shared_ptr<Context<BFT, RT> > context(checkpointed ?
+                    new Context<BFT, RT>(quadStrategy, assemblyOptions,
+                                         parameters) :
+                    new Context<BFT, RT>(quadStrategy, assemblyOptions));
+        return laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                    context, space, space, space).weakForm()->asMatrix();
+    }
+
+    std::size_t fileSize() const
+    {
+        std::ifstream file(fileName.c_str(),
+                           std::ios::binary | std::ios::ate);
+        return file ? static_cast<std::size_t>(file.tellg()) : 0;
+    }
+
+    std::string fileName;
+    shared_ptr<Space<BFT> > space;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy;
+    AssemblyOptions assemblyOptions;
+    ParameterList parameters;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(HMatCheckpoint)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(restored_h_matrix_agrees_with_fresh_assembly,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    CheckpointFixture<BFT, RT> fixture;
+    arma::Mat<RT> expected = fixture.singleLayer(false);
+
+    arma::Mat<RT> first = fixture.singleLayer(true);
+    const std::size_t completeSize = fixture.fileSize();
+    BOOST_CHECK(completeSize > 0);
+    BOOST_CHECK(check_arrays_are_close<RT>(first, expected, CT(1e-4)));
+
+    // All leaves are restored, so nothing is appended
+    arma::Mat<RT> restored = fixture.singleLayer(true);
+    BOOST_CHECK_EQUAL(fixture.fileSize(), completeSize);
+    BOOST_CHECK(check_arrays_are_close<RT>(restored, first,
+                                           CT(10) *
+                                           std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(interrupted_checkpoint_is_completed,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    CheckpointFixture<BFT, RT> fixture;
+    arma::Mat<RT> expected = fixture.singleLayer(false);
+    fixture.singleLayer(true);
+    const std::size_t completeSize = fixture.fileSize();
+
+    // Cutting the file in the middle of a record simulates an interruption
+    // of the assembly
+    BOOST_REQUIRE_EQUAL(
+                ::truncate(fixture.fileName.c_str(), completeSize / 2 + 3), 0);
+    arma::Mat<RT> resumed = fixture.singleLayer(true);
+    BOOST_CHECK(fixture.fileSize() > completeSize / 2);
+    BOOST_CHECK(check_arrays_are_close<RT>(resumed, expected, CT(1e-4)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(checkpoint_of_other_operator_is_discarded,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    CheckpointFixture<BFT, RT> fixture;
+    fixture.singleLayer(true);
+
+    arma::Mat<RT> expected = fixture.doubleLayer(false);
+    arma::Mat<RT> actual = fixture.doubleLayer(true);
+    BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, CT(1e-4)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_hmat_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/global_parameters.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+
+using namespace Bempp;
+
+BOOST_AUTO_TEST_SUITE(HMatFrozenLayout)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(frozen_apply_agrees_with_tree_apply,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptions.switchToHMatMode();
+
+    ParameterList parameters = GlobalParameters::parameterList();
+    parameters.sublist("HMat").set("frozenLayout", true);
+    shared_ptr<Context<BFT, RT> > treeContext(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    shared_ptr<Context<BFT, RT> > frozenContext(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions,
+                                     parameters));
+
+    BoundaryOperator<BFT, RT> treeOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                treeContext, pwiseConstants, pwiseConstants,
+                pwiseConstants);
+    BoundaryOperator<BFT, RT> frozenOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                frozenContext, pwiseConstants, pwiseConstants,
+                pwiseConstants);
+
+    shared_ptr<const DiscreteHMatBoundaryOperator<RT> > frozenWeakForm =
+            boost::dynamic_pointer_cast<
+            const DiscreteHMatBoundaryOperator<RT> >(frozenOp.weakForm());
+    BOOST_REQUIRE(frozenWeakForm);
+    BOOST_CHECK(frozenWeakForm->hMatrix()->isFrozen());
+
+    const size_t size = frozenWeakForm->rowCount();
+    arma::Mat<RT> x(size, 3);
+    x.randn();
+    arma::Mat<RT> y0(size, 3);
+    y0.randn();
+
+    const TranspositionMode modes[] = {NO_TRANSPOSE, TRANSPOSE};
+    for (size_t i = 0; i < 2; ++i) {
+        arma::Mat<RT> expected = y0;
+        treeOp.weakForm()->apply(modes[i], x, expected, RT(2.), RT(0.5));
+        arma::Mat<RT> actual = y0;
+        frozenWeakForm->apply(modes[i], x, actual, RT(2.), RT(0.5));
+        BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, CT(1e-4)));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
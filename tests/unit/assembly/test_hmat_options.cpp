@@ -0,0 +1,108 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "assembly/hmat_options.hpp"
+#include "common/global_parameters.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+
+using namespace Bempp;
+
+BOOST_AUTO_TEST_SUITE(HMatOptionsFromParameters)
+
+BOOST_AUTO_TEST_CASE(default_options_agree_with_global_parameters)
+{
+    ParameterList parameters = GlobalParameters::parameterList();
+    const ParameterList &hMatParameters = parameters.sublist("HMat");
+    HMatOptions options;
+
+    BOOST_CHECK(options.indexWithGlobalDofs);
+    BOOST_CHECK_EQUAL(options.minBlockSize,
+                      static_cast<unsigned int>(
+                          hMatParameters.get<int>("minBlockSize")));
+    BOOST_CHECK_EQUAL(options.eta, hMatParameters.get<double>("eta"));
+    BOOST_CHECK_EQUAL(options.maxRank, hMatParameters.get<int>("maxRank"));
+    BOOST_CHECK(options.compressionAlgorithm == HMatOptions::ACA);
+    BOOST_CHECK(!options.adaptiveMaxRank);
+    BOOST_CHECK(!options.acaWarmStart);
+    BOOST_CHECK(options == HMatOptions(hMatParameters));
+    BOOST_CHECK_EQUAL(options.hash(), HMatOptions(hMatParameters).hash());
+}
+
+BOOST_AUTO_TEST_CASE(changed_parameter_changes_options_and_hash)
+{
+    ParameterList parameters = GlobalParameters::parameterList();
+    ParameterList &hMatParameters = parameters.sublist("HMat");
+    HMatOptions defaultOptions(hMatParameters);
+
+    hMatParameters.set("defaultCompressionAlg", std::string("aca+"));
+    hMatParameters.set("minBlockSize", static_cast<unsigned int>(20));
+    HMatOptions options(hMatParameters);
+
+    BOOST_CHECK(options.compressionAlgorithm == HMatOptions::ACA_PLUS);
+    BOOST_CHECK_EQUAL(options.minBlockSize, 20u);
+    BOOST_CHECK(options != defaultOptions);
+    BOOST_CHECK(options.hash() != defaultOptions.hash());
+}
+
+BOOST_AUTO_TEST_CASE(interpolation_options_are_read)
+{
+    ParameterList parameters = GlobalParameters::parameterList();
+    ParameterList &hMatParameters = parameters.sublist("HMat");
+    HMatOptions defaultOptions(hMatParameters);
+
+    hMatParameters.set("defaultCompressionAlg", std::string("interpolation"));
+    hMatParameters.set("interpolationOrder", 7);
+    HMatOptions options(hMatParameters);
+
+    BOOST_CHECK(options.compressionAlgorithm == HMatOptions::INTERPOLATION);
+    BOOST_CHECK_EQUAL(options.interpolationOrder, 7);
+    BOOST_CHECK_EQUAL(options.interpolationQuadratureOrder,
+                      defaultOptions.interpolationQuadratureOrder);
+    BOOST_CHECK(options != defaultOptions);
+}
+
+BOOST_AUTO_TEST_CASE(weak_admissibility_is_read)
+{
+    ParameterList parameters = GlobalParameters::parameterList();
+    ParameterList &hMatParameters = parameters.sublist("HMat");
+    HMatOptions defaultOptions(hMatParameters);
+    BOOST_CHECK(!defaultOptions.weakAdmissibility);
+
+    hMatParameters.set("admissibility", std::string("weak"));
+    HMatOptions options(hMatParameters);
+
+    BOOST_CHECK(options.weakAdmissibility);
+    BOOST_CHECK(options != defaultOptions);
+    BOOST_CHECK(options.hash() != defaultOptions.hash());
+}
+
+BOOST_AUTO_TEST_CASE(unsupported_value_throws)
+{
+    ParameterList parameters = GlobalParameters::parameterList();
+    ParameterList &hMatParameters = parameters.sublist("HMat");
+    hMatParameters.set("maxRankPolicy", std::string("unknown"));
+
+    BOOST_CHECK_THROW(HMatOptions options(hMatParameters),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,107 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_hmat_boundary_operator.hpp"
+#include "assembly/hmat_parameter_tuner.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+
+#include "common/global_parameters.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+
+using namespace Bempp;
+
+
+BOOST_AUTO_TEST_SUITE(HMatParameterTuning)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(tuned_parameters_meet_targets,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.2.msh");
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    ParameterList parameters = GlobalParameters::parameterList();
+    parameters.set("verbosityLevel", -5);
+    shared_ptr<Context<BFT, RT> > context(new Context<BFT, RT>(parameters));
+    BoundaryOperator<BFT, RT> op =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                context, pwiseConstants, pwiseConstants, pwiseConstants);
+
+    HMatTuningTargets targets;
+    targets.accuracy = 1e-3;
+    targets.memoryBudget = 10.;
+    targets.etaCandidates = std::vector<double>(1, 1.2);
+    targets.minBlockSizeCandidates = std::vector<int>{16, 64};
+    targets.maxBlockSizeCandidates = std::vector<int>(1, 2048);
+    HMatParameterTuner<BFT, RT> tuner(targets);
+    HMatTuningResult result = tuner.tune(op);
+
+    BOOST_CHECK(result.feasible);
+    BOOST_CHECK(result.predictedMemory <= targets.memoryBudget);
+    BOOST_CHECK(result.blockError <= targets.accuracy);
+    BOOST_CHECK(result.quadratureError <= targets.accuracy / 10);
+
+    // The emitted parameters are valid and give an H-matrix as accurate as
+    // requested
+    shared_ptr<Context<BFT, RT> > tunedContext(
+                new Context<BFT, RT>(result.parameters));
+    BOOST_CHECK_EQUAL(tunedContext->hMatOptions().eps,
+                      result.parameters.sublist("HMat").get<double>("eps"));
+    BoundaryOperator<BFT, RT> tunedOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                tunedContext, pwiseConstants, pwiseConstants, pwiseConstants);
+    shared_ptr<const DiscreteHMatBoundaryOperator<RT> > weakForm =
+            boost::dynamic_pointer_cast<
+            const DiscreteHMatBoundaryOperator<RT> >(tunedOp.weakForm());
+    BOOST_REQUIRE(weakForm);
+
+    ParameterList denseParameters = parameters;
+    denseParameters.set("boundaryOperatorAssemblyType", std::string("dense"));
+    shared_ptr<Context<BFT, RT> > denseContext(
+                new Context<BFT, RT>(denseParameters));
+    BoundaryOperator<BFT, RT> denseOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                denseContext, pwiseConstants, pwiseConstants, pwiseConstants);
+    arma::Mat<RT> expected = denseOp.weakForm()->asMatrix();
+    arma::Mat<RT> actual = weakForm->asMatrix();
+    BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, CT(1e-2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/integral_operators_on_space_pairs.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace Bempp;
+
+BOOST_AUTO_TEST_SUITE(IntegralOperatorsOnSpacePairs)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(operators_agree_with_separately_assembled_ones,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+    typedef shared_ptr<const Space<BFT> > SpacePtr;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    SpacePtr pwiseConstants(new PiecewiseConstantScalarSpace<BFT>(grid));
+    SpacePtr pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<const Context<BFT, RT> > context(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    std::vector<SpacePtr> domains, dualsToRanges;
+    domains.push_back(pwiseConstants);
+    dualsToRanges.push_back(pwiseConstants);
+    domains.push_back(pwiseLinears);
+    dualsToRanges.push_back(pwiseLinears);
+    domains.push_back(pwiseConstants);
+    dualsToRanges.push_back(pwiseLinears);
+
+    std::vector<BoundaryOperator<BFT, RT> > ops =
+            integralOperatorsOnSpacePairs<BFT, RT>(
+                context, domains, dualsToRanges, dualsToRanges,
+                [](const shared_ptr<const Context<BFT, RT> >& c,
+                   const SpacePtr& domain, const SpacePtr& range,
+                   const SpacePtr& dualToRange) {
+                    return laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                                c, domain, range, dualToRange);
+                });
+    BOOST_REQUIRE_EQUAL(ops.size(), domains.size());
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        BoundaryOperator<BFT, RT> expectedOp =
+                laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    context, domains[i], dualsToRanges[i], dualsToRanges[i]);
+        arma::Mat<RT> expected = expectedOp.weakForm()->asMatrix();
+        arma::Mat<RT> actual = ops[i].weakForm()->asMatrix();
+        BOOST_CHECK_EQUAL(actual.n_rows, dualsToRanges[i]->globalDofCount());
+        BOOST_CHECK_EQUAL(actual.n_cols, domains[i]->globalDofCount());
+        BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, CT(1e-4)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mismatched_lengths_are_rejected)
+{
+    typedef double BFT;
+    typedef double RT;
+    typedef shared_ptr<const Space<BFT> > SpacePtr;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    SpacePtr pwiseConstants(new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    shared_ptr<const Context<BFT, RT> > context(
+                new Context<BFT, RT>(quadStrategy, AssemblyOptions()));
+
+    std::vector<SpacePtr> domains(2, pwiseConstants);
+    std::vector<SpacePtr> dualsToRanges(1, pwiseConstants);
+    BOOST_CHECK_THROW(
+                (integralOperatorsOnSpacePairs<BFT, RT>(
+                     context, domains, dualsToRanges, dualsToRanges,
+                     [](const shared_ptr<const Context<BFT, RT> >& c,
+                        const SpacePtr& domain, const SpacePtr& range,
+                        const SpacePtr& dualToRange) {
+                         return laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                                     c, domain, range, dualToRange);
+                     })),
+                std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,153 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "create_regular_grid.hpp"
+
+#include "assembly/interpolated_function.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <stdexcept>
+
+// Tests
+
+using namespace Bempp;
+
+namespace
+{
+
+// Value of a linear function at the point x; linear interpolation on the
+// grid reproduces it exactly
+template <typename RT, typename CT>
+RT linearFunction(const CT* x)
+{
+    return RT(1.) + RT(2.) * x[0] - RT(3.) * x[1] + RT(0.5) * x[2];
+}
+
+template <typename CT>
+CT randomNumber()
+{
+    return CT(std::rand()) / CT(RAND_MAX);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(InterpolatedFunction)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_reproduces_linear_functions, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(4, 7);
+    std::unique_ptr<GridView> view = grid->leafView();
+    arma::Mat<CT> vertices;
+    arma::Mat<int> elementCorners;
+    arma::Mat<char> auxData;
+    view->getRawElementData(vertices, elementCorners, auxData);
+
+    arma::Mat<RT> vertexValues(1, vertices.n_cols);
+    for (size_t v = 0; v < vertices.n_cols; ++v)
+        vertexValues(0, v) = linearFunction<RT>(vertices.colptr(v));
+    Bempp::InterpolatedFunction<RT> fun(*grid, vertexValues);
+
+    // Random points inside random elements
+    const int pointCount = 1000;
+    arma::Mat<CT> points(3, pointCount);
+    arma::Mat<RT> expected(1, pointCount);
+    for (int p = 0; p < pointCount; ++p) {
+        const int e = std::rand() % elementCorners.n_cols;
+        CT l1 = randomNumber<CT>(), l2 = randomNumber<CT>();
+        if (l1 + l2 > 1) {
+            l1 = 1 - l1;
+            l2 = 1 - l2;
+        }
+        for (int d = 0; d < 3; ++d)
+            points(d, p) = (1 - l1 - l2) * vertices(d, elementCorners(0, e)) +
+                l1 * vertices(d, elementCorners(1, e)) +
+                l2 * vertices(d, elementCorners(2, e));
+        expected(0, p) = linearFunction<RT>(points.colptr(p));
+    }
+
+    arma::Mat<RT> values;
+    fun.evaluate(points, values);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(values, expected,
+                                           100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_reproduces_vertex_values, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(3, 4);
+    std::unique_ptr<GridView> view = grid->leafView();
+    arma::Mat<CT> vertices;
+    arma::Mat<int> elementCorners;
+    arma::Mat<char> auxData;
+    view->getRawElementData(vertices, elementCorners, auxData);
+
+    arma::Mat<RT> vertexValues(2, vertices.n_cols);
+    for (size_t v = 0; v < vertices.n_cols; ++v) {
+        vertexValues(0, v) = RT(randomNumber<CT>());
+        vertexValues(1, v) = RT(randomNumber<CT>());
+    }
+    Bempp::InterpolatedFunction<RT> fun(*grid, vertexValues);
+
+    arma::Mat<RT> values;
+    fun.evaluate(vertices, values);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(values, vertexValues,
+                                           100. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_throws_for_points_off_grid, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    std::unique_ptr<GridView> view = grid->leafView();
+    arma::Mat<RT> vertexValues(1, view->entityCount(2));
+    vertexValues.fill(1.);
+    Bempp::InterpolatedFunction<RT> fun(*grid, vertexValues);
+
+    arma::Mat<CT> points(3, 1);
+    points(0, 0) = 0.5;
+    points(1, 0) = 0.5;
+    points(2, 0) = 1.;
+    arma::Mat<RT> values;
+    BOOST_CHECK_THROW(fun.evaluate(points, values), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+
+#include "assembly/discrete_sparse_boundary_operator.hpp"
+#include "assembly/lagrange_trace.hpp"
+
+#include "common/types.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+#include "space/piecewise_polynomial_continuous_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <Epetra_CrsMatrix.h>
+#include <stdexcept>
+
+using namespace Bempp;
+
+namespace
+{
+
+// Positions of the DOFs of the space in reverse order, followed by a point
+// at the centre of the sphere that matches no DOF
+template <typename BFT>
+arma::Mat<double> reversedDofPositions(const Space<BFT>& space)
+{
+    typedef typename Space<BFT>::CoordinateType CT;
+    std::vector<Point3D<CT> > positions;
+    space.getGlobalDofPositions(positions);
+    const size_t dofCount = positions.size();
+    arma::Mat<double> result(3, dofCount + 1);
+    result.col(dofCount).fill(0.);
+    for (size_t i = 0; i < dofCount; ++i) {
+        result(0, dofCount - 1 - i) = positions[i].x;
+        result(1, dofCount - 1 - i) = positions[i].y;
+        result(2, dofCount - 1 - i) = positions[i].z;
+    }
+    return result;
+}
+
+template <typename BFT>
+void checkReversedTrace(const Space<BFT>& space)
+{
+    const int dofCount = space.globalDofCount();
+    shared_ptr<Epetra_CrsMatrix> trace =
+            lagrangeTraceMatrix(space, reversedDofPositions(space));
+    BOOST_CHECK_EQUAL(trace->NumGlobalRows(), dofCount);
+    BOOST_CHECK_EQUAL(trace->NumGlobalCols(), dofCount + 1);
+    BOOST_CHECK_EQUAL(trace->NumGlobalNonzeros(), dofCount);
+
+    DiscreteSparseBoundaryOperator<double> op(trace);
+    arma::Mat<double> matrix = op.asMatrix();
+    arma::Mat<double> expected(dofCount, dofCount + 1);
+    expected.fill(0.);
+    for (int i = 0; i < dofCount; ++i)
+        expected(i, dofCount - 1 - i) = 1.;
+    BOOST_CHECK_EQUAL(arma::accu(arma::abs(matrix - expected)), 0.);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LagrangeTrace)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(trace_of_p1_space_matches_dof_positions,
+                              BasisFunctionType, basis_function_types)
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    PiecewiseLinearContinuousScalarSpace<BasisFunctionType> space(grid);
+    checkReversedTrace(space);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(trace_of_p2_space_matches_dof_positions,
+                              BasisFunctionType, basis_function_types)
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    PiecewisePolynomialContinuousScalarSpace<BasisFunctionType> space(grid, 2);
+    checkReversedTrace(space);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(trace_requires_matching_positions,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    PiecewiseLinearContinuousScalarSpace<BFT> space(grid);
+    arma::Mat<double> positions = reversedDofPositions(space);
+    positions.shed_col(0);
+    BOOST_CHECK_THROW(lagrangeTraceMatrix(space, positions),
+                      std::runtime_error);
+
+    PiecewiseConstantScalarSpace<BFT> constantSpace(grid);
+    BOOST_CHECK_THROW(lagrangeTraceMatrix(constantSpace, positions),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
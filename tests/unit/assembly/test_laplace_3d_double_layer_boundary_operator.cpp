@@ -0,0 +1,133 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/assembly_report.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename BFT, typename RT>
+arma::Mat<RT> doubleLayerWeakForm(const shared_ptr<Grid> &grid,
+                                  bool hMatMode,
+                                  shared_ptr<const AssemblyReport> *report = 0)
+{
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    if (hMatMode)
+        assemblyOptions.switchToHMatMode();
+    else
+        assemblyOptions.switchToDenseMode();
+    shared_ptr<Context<BFT, RT> > context(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    BoundaryOperator<BFT, RT> op =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                context, pwiseLinears, pwiseConstants, pwiseConstants);
+    if (report)
+        *report = op.weakForm()->assemblyReport();
+    return op.weakForm()->asMatrix();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(Laplace3dDoubleLayerBoundaryOperator)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(regular_pairs_on_a_plane_are_not_integrated,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(8, 8);
+    shared_ptr<const AssemblyReport> report;
+    arma::Mat<RT> weakForm =
+            doubleLayerWeakForm<BFT, RT>(grid, false /* hMatMode */, &report);
+    BOOST_REQUIRE(report);
+
+    size_t onDemand = 0;
+    for (size_t i = 0; i < report->quadratureRules.size(); ++i)
+        onDemand += report->quadratureRules[i].elementPairCount;
+    BOOST_CHECK_EQUAL(onDemand, 0u);
+    BOOST_CHECK(arma::norm(weakForm, "fro") == 0.);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(hmat_weak_form_on_a_plane_is_zero,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(16, 16);
+    arma::Mat<RT> weakForm =
+            doubleLayerWeakForm<BFT, RT>(grid, true /* hMatMode */);
+    BOOST_CHECK(arma::norm(weakForm, "fro") == 0.);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(hmat_weak_form_on_a_sphere_agrees_with_dense,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh",
+                false /* verbose */);
+
+    arma::Mat<RT> expected =
+            doubleLayerWeakForm<BFT, RT>(grid, false /* hMatMode */);
+    arma::Mat<RT> actual =
+            doubleLayerWeakForm<BFT, RT>(grid, true /* hMatMode */);
+    BOOST_CHECK(arma::norm(expected, "fro") > 0.);
+    BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, CT(1e-3)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -22,6 +22,7 @@
 #include "../type_template.hpp"
 
 #include "assembly/assembly_options.hpp"
+#include "assembly/assembly_report.hpp"
 #include "assembly/discrete_boundary_operator.hpp"
 #include "assembly/boundary_operator.hpp"
 #include "assembly/context.hpp"
@@ -32,6 +33,7 @@
 
 #include "grid/grid_factory.hpp"
 #include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
 
 #include "space/piecewise_linear_continuous_scalar_space.hpp"
 #include "space/piecewise_constant_scalar_space.hpp"
@@ -109,4 +111,157 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(symmetric_matches_nonsymmetric_in_aca_mode,
 #   endif
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(equivalent_operators_share_weak_form,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh",
+                false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AccuracyOptions accuracyOptions;
+    NumericalQuadratureStrategy<BFT, RT> quadStrategy(accuracyOptions);
+
+    Context<BFT, RT> context(make_shared_from_ref(quadStrategy), assemblyOptions);
+
+    BoundaryOperator<BFT, RT> op1 =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                make_shared_from_ref(context),
+                pwiseConstants, pwiseLinears, pwiseConstants);
+    BoundaryOperator<BFT, RT> op2 =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                make_shared_from_ref(context),
+                pwiseConstants, pwiseLinears, pwiseConstants);
+    BoundaryOperator<BFT, RT> op3 =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                make_shared_from_ref(context),
+                pwiseLinears, pwiseLinears, pwiseLinears);
+
+    BOOST_CHECK(op1.weakForm() == op2.weakForm());
+    BOOST_CHECK(op1.weakForm() != op3.weakForm());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(weak_form_carries_assembly_report,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh",
+                false /* verbose */);
+    const size_t elementCount = grid->leafView()->entityCount(0);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptions.switchToDenseMode();
+    assemblyOptions.enableSingularIntegralCaching(true);
+    AccuracyOptions accuracyOptions;
+    NumericalQuadratureStrategy<BFT, RT> quadStrategy(accuracyOptions);
+
+    Context<BFT, RT> context(make_shared_from_ref(quadStrategy), assemblyOptions);
+
+    BoundaryOperator<BFT, RT> op =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                make_shared_from_ref(context),
+                pwiseConstants, pwiseConstants, pwiseConstants,
+                "", NO_SYMMETRY);
+    shared_ptr<const AssemblyReport> report = op.weakForm()->assemblyReport();
+    BOOST_REQUIRE(report);
+
+    // Every element pair is either integrated on demand or found in the cache
+    // of the precalculated singular pairs
+    size_t onDemand = 0, cached = 0;
+    for (size_t i = 0; i < report->quadratureRules.size(); ++i) {
+        onDemand += report->quadratureRules[i].elementPairCount;
+        cached += report->quadratureRules[i].cachedElementPairCount;
+    }
+    BOOST_CHECK_EQUAL(onDemand + report->cacheHitCount,
+                      elementCount * elementCount);
+    BOOST_CHECK_EQUAL(cached, report->cacheHitCount);
+    BOOST_CHECK_EQUAL(report->elementPairCount(AssemblyReport::SINGULAR_PAIRS),
+                      cached);
+    BOOST_CHECK_EQUAL(report->storageSize,
+                      elementCount * elementCount * sizeof(RT));
+    BOOST_CHECK(report->threadCount >= 1);
+    BOOST_CHECK(report->wallTime() > 0.);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(semi_analytic_near_field_agrees_with_quadrature,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh",
+                false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptions.switchToDenseMode();
+
+    // Reference: Sauter-Schwab rules and tensor Gauss rules of high order
+    AccuracyOptionsEx referenceAccuracyOptions;
+    referenceAccuracyOptions.setDoubleRegular(4);
+    referenceAccuracyOptions.setDoubleSingular(4);
+    AccuracyOptionsEx semiAnalyticAccuracyOptions = referenceAccuracyOptions;
+    semiAnalyticAccuracyOptions.setSemiAnalyticNearField(true, 2.);
+
+    shared_ptr<Context<BFT, RT> > referenceContext(
+                new Context<BFT, RT>(
+                    boost::make_shared<NumericalQuadratureStrategy<BFT, RT> >(
+                        referenceAccuracyOptions),
+                    assemblyOptions));
+    shared_ptr<Context<BFT, RT> > semiAnalyticContext(
+                new Context<BFT, RT>(
+                    boost::make_shared<NumericalQuadratureStrategy<BFT, RT> >(
+                        semiAnalyticAccuracyOptions),
+                    assemblyOptions));
+
+    const CT tolerance = boost::is_same<CT, float>::value ? 1e-4 : 1e-5;
+    for (int trialSpace = 0; trialSpace < 2; ++trialSpace) {
+        shared_ptr<Space<BFT> > space =
+                trialSpace == 0 ? pwiseConstants : pwiseLinears;
+        arma::Mat<RT> referenceMat =
+                laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    referenceContext, space, pwiseConstants, space)
+                .weakForm()->asMatrix();
+        arma::Mat<RT> semiAnalyticMat =
+                laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                    semiAnalyticContext, space, pwiseConstants, space)
+                .weakForm()->asMatrix();
+
+        // Compare the entries relative to the largest one
+        const RT scale = arma::abs(referenceMat).max();
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        semiAnalyticMat / scale, referenceMat / scale,
+                        tolerance));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
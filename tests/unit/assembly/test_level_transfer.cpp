@@ -0,0 +1,91 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/discrete_sparse_boundary_operator.hpp"
+#include "assembly/level_transfer.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <Epetra_CrsMatrix.h>
+#include <stdexcept>
+
+using namespace Bempp;
+
+BOOST_AUTO_TEST_SUITE(LevelTransfer)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(transfer_to_unrefined_level_is_a_permutation,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef BasisFunctionType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    BOOST_REQUIRE_EQUAL(grid->maxLevel(), 0);
+    PiecewiseLinearContinuousScalarSpace<BFT> space(grid);
+
+    std::vector<double> meshSizes;
+    shared_ptr<Epetra_CrsMatrix> transfer =
+            levelTransferMatrix(space, 0, &meshSizes);
+    BOOST_CHECK_EQUAL(transfer->NumGlobalRows(),
+                      int(space.globalDofCount()));
+    BOOST_CHECK_EQUAL(transfer->NumGlobalNonzeros(),
+                      int(space.globalDofCount()));
+    BOOST_CHECK_EQUAL(meshSizes.size(), space.globalDofCount());
+    for (size_t i = 0; i < meshSizes.size(); ++i)
+        BOOST_CHECK(meshSizes[i] > 0.);
+
+    // Nodal basis functions of the only level are the leaf basis functions
+    DiscreteSparseBoundaryOperator<RT> op(transfer);
+    arma::Mat<RT> matrix = op.asMatrix();
+    arma::Col<RT> rowSums = arma::sum(matrix, 1);
+    arma::Col<RT> expected(rowSums.n_rows);
+    expected.fill(1.);
+    BOOST_CHECK(check_arrays_are_close<RT>(rowSums, expected, CT(1e-6)));
+    arma::Col<RT> columnSums = arma::sum(matrix, 0).st();
+    BOOST_CHECK(check_arrays_are_close<RT>(columnSums, expected, CT(1e-6)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(transfer_requires_continuous_linear_space,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh");
+    PiecewiseConstantScalarSpace<BFT> space(grid);
+    BOOST_CHECK_THROW(levelTransferMatrix(space, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
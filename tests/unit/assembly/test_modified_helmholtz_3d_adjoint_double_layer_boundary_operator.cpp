@@ -26,7 +26,9 @@
 #include "assembly/boundary_operator.hpp"
 #include "assembly/context.hpp"
 #include "assembly/modified_helmholtz_3d_adjoint_double_layer_boundary_operator.hpp"
+#include "assembly/modified_helmholtz_3d_double_layer_boundary_operator.hpp"
 #include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/transposed_discrete_boundary_operator.hpp"
 
 #include "common/boost_make_shared_fwd.hpp"
 
@@ -104,4 +106,57 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(interpolated_matches_noniterpolated,
                     matNoninterpolated, matInterpolated, 100 * eps));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(weak_form_is_transpose_of_cached_double_layer,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef typename Fiber::ScalarTraits<BFT>::ComplexType RT;
+    typedef typename Fiber::ScalarTraits<BFT>::ComplexType KT;
+    typedef typename Fiber::ScalarTraits<BFT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-h-0.4.msh",
+                false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    shared_ptr<Context<BFT, RT> > context(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    const KT waveNumber(3.23, 0.31);
+
+    BoundaryOperator<BFT, RT> dlp =
+            modifiedHelmholtz3dDoubleLayerBoundaryOperator<BFT, KT, RT>(
+                context, pwiseLinears, pwiseConstants, pwiseConstants,
+                waveNumber);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dlpWeakForm =
+            dlp.weakForm();
+    // The adjoint double-layer operator on the swapped spaces, with a
+    // different range, must reuse the weak form assembled above
+    BoundaryOperator<BFT, RT> adlp =
+            modifiedHelmholtz3dAdjointDoubleLayerBoundaryOperator<BFT, KT, RT>(
+                context, pwiseConstants, pwiseConstants, pwiseLinears,
+                waveNumber);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > adlpWeakForm =
+            adlp.weakForm();
+
+    BOOST_CHECK(boost::dynamic_pointer_cast<
+                const TransposedDiscreteBoundaryOperator<RT> >(adlpWeakForm));
+
+    arma::Mat<RT> expected = arma::strans(dlpWeakForm->asMatrix());
+    arma::Mat<RT> actual = adlpWeakForm->asMatrix();
+    const CT eps = std::numeric_limits<CT>::epsilon();
+    BOOST_CHECK(check_arrays_are_close<RT>(actual, expected, 10 * eps));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,178 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../random_arrays.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/multi_grid_function.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/surface_normal_independent_function.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include <boost/test/floating_point_comparison.hpp>
+
+using namespace Bempp;
+
+namespace {
+
+template <typename ValueType_>
+class LinearFunction
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+    explicit LinearFunction(int coordinate) : m_coordinate(coordinate) {}
+
+    int argumentDimension() const { return 3; }
+    int resultDimension() const { return 1; }
+
+    inline void evaluate(const arma::Col<CoordinateType>& point,
+                         arma::Col<ValueType>& result) const {
+        result(0) = point(m_coordinate);
+    }
+
+private:
+    int m_coordinate;
+};
+
+template <typename BFT, typename RT>
+shared_ptr<Context<BFT, RT> > makeContext()
+{
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    return shared_ptr<Context<BFT, RT> >(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+}
+
+shared_ptr<Grid> loadSphere()
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    return GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.2.msh", false /* verbose */);
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(MultiGridFunction)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(conversions_agree_with_grid_functions, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = loadSphere();
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > dualSpace(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Context<BFT, RT> > context = makeContext<BFT, RT>();
+
+    const size_t columnCount = 3;
+    arma::Mat<RT> coefficients = generateRandomMatrix<RT>(
+        space->globalDofCount(), columnCount);
+    Bempp::MultiGridFunction<BFT, RT> functions(context, space, coefficients);
+    BOOST_CHECK(functions.wasInitializedFromCoefficients());
+    BOOST_CHECK_EQUAL(functions.columnCount(), columnCount);
+
+    const arma::Mat<RT>& projections = functions.projections(space);
+    Bempp::MultiGridFunction<BFT, RT> fromProjections(
+        context, space, space, projections);
+    BOOST_CHECK(!fromProjections.wasInitializedFromCoefficients());
+    const arma::Mat<RT>& convertedBack = fromProjections.coefficients();
+
+    const CT tol = 1000. * std::numeric_limits<CT>::epsilon();
+    std::vector<CT> norms = functions.L2Norms();
+    BOOST_REQUIRE_EQUAL(norms.size(), columnCount);
+    for (size_t i = 0; i < columnCount; ++i) {
+        Bempp::GridFunction<BFT, RT> column(
+            context, space, arma::Col<RT>(coefficients.col(i)));
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        arma::Col<RT>(projections.col(i)),
+                        column.projections(space), tol));
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        arma::Col<RT>(convertedBack.col(i)),
+                        column.coefficients(), tol));
+        BOOST_CHECK_CLOSE(norms[i], column.L2Norm(), 1e-6 /* percent */);
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        functions.column(i).coefficients(),
+                        column.coefficients(), 0.));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(approximation_agrees_with_make_grid_functions, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = loadSphere();
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Context<BFT, RT> > context = makeContext<BFT, RT>();
+
+    typedef SurfaceNormalIndependentFunction<LinearFunction<RT> > Fun;
+    std::vector<Fun> storage;
+    for (int c = 0; c < 3; ++c)
+        storage.push_back(surfaceNormalIndependentFunction(
+                              LinearFunction<RT>(c)));
+    std::vector<const Function<RT>*> functions;
+    for (size_t i = 0; i < storage.size(); ++i)
+        functions.push_back(&storage[i]);
+
+    Bempp::MultiGridFunction<BFT, RT> multi(context, space, space, functions);
+    std::vector<Bempp::GridFunction<BFT, RT> > expected =
+        makeGridFunctions<BFT, RT>(context, space, space, functions);
+
+    const CT tol = 100. * std::numeric_limits<CT>::epsilon();
+    BOOST_REQUIRE_EQUAL(multi.columnCount(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        arma::Col<RT>(multi.coefficients().col(i)),
+                        expected[i].coefficients(), tol));
+
+    // Gathering grid functions initialized from projections keeps them
+    Bempp::MultiGridFunction<BFT, RT> gathered(expected);
+    BOOST_CHECK(!gathered.wasInitializedFromCoefficients());
+    BOOST_CHECK(gathered.dualSpace() == space);
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    gathered.projections(space), multi.projections(space),
+                    tol));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
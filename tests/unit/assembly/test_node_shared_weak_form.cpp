@@ -0,0 +1,158 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_dense_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/node_shared_weak_form.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <limits>
+#include <string>
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename BFT, typename RT>
+struct NodeSharedWeakFormFixture
+{
+    NodeSharedWeakFormFixture() :
+        fileName("bempp_node_shared_weak_form_test.bin")
+    {
+        shared_ptr<Grid> grid = createRegularTriangularGrid();
+        shared_ptr<Space<BFT> > pwiseConstants(
+            new PiecewiseConstantScalarSpace<BFT>(grid));
+
+        AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+            new NumericalQuadratureStrategy<BFT, RT>);
+        shared_ptr<Context<BFT, RT> > context(
+            new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+        op = laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+            context, pwiseConstants, pwiseConstants, pwiseConstants);
+        removeFiles();
+    }
+
+    ~NodeSharedWeakFormFixture()
+    {
+        removeFiles();
+    }
+
+    void removeFiles() const
+    {
+        std::remove(fileName.c_str());
+        std::remove((fileName + ".lock").c_str());
+    }
+
+    std::string fileName;
+    BoundaryOperator<BFT, RT> op;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(NodeSharedWeakForm)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(saved_dense_operator_is_loaded_unchanged,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+    typedef DiscreteDenseBoundaryOperator<RT> DenseOp;
+
+    NodeSharedWeakFormFixture<BFT, RT> fixture;
+    arma::Mat<RT> expected = fixture.op.weakForm()->asMatrix();
+    DenseOp(expected).save(fixture.fileName);
+
+    shared_ptr<DenseOp> mapped = DenseOp::load(fixture.fileName, true);
+    shared_ptr<DenseOp> copied = DenseOp::load(fixture.fileName, false);
+    BOOST_CHECK(check_arrays_are_close<RT>(mapped->asMatrix(), expected,
+                                           CT(0)));
+    BOOST_CHECK(check_arrays_are_close<RT>(copied->asMatrix(), expected,
+                                           CT(0)));
+
+    arma::Col<RT> x(expected.n_cols);
+    x.fill(RT(1.));
+    arma::Col<RT> y(expected.n_rows, arma::fill::zeros);
+    mapped->apply(NO_TRANSPOSE, x, y, RT(2.), RT(0.));
+    arma::Col<RT> expectedProduct = RT(2.) * expected * x;
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    y, expectedProduct,
+                    CT(10) * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(node_shared_weak_form_agrees_with_weak_form,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    NodeSharedWeakFormFixture<BFT, RT> fixture;
+    arma::Mat<RT> expected = fixture.op.weakForm()->asMatrix();
+
+    // The first call assembles and writes the file, the second one only
+    // loads it
+    arma::Mat<RT> assembled =
+        nodeSharedWeakForm(fixture.op, fixture.fileName)->asMatrix();
+    arma::Mat<RT> attached =
+        nodeSharedWeakForm(fixture.op, fixture.fileName)->asMatrix();
+    BOOST_CHECK(check_arrays_are_close<RT>(assembled, expected, CT(0)));
+    BOOST_CHECK(check_arrays_are_close<RT>(attached, expected, CT(0)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(existing_file_is_used_without_assembly,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    NodeSharedWeakFormFixture<BFT, RT> fixture;
+    arma::Mat<RT> stored(3, 2);
+    stored.fill(RT(5.));
+    DiscreteDenseBoundaryOperator<RT>(stored).save(fixture.fileName);
+
+    arma::Mat<RT> result =
+        nodeSharedWeakForm(fixture.op, fixture.fileName)->asMatrix();
+    BOOST_CHECK(check_arrays_are_close<RT>(result, stored, CT(0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,121 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/plane_wave_projections.hpp"
+#include "assembly/surface_normal_independent_function.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+using namespace Bempp;
+
+template <typename ValueType_>
+class PlaneWaveFunction
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+    PlaneWaveFunction(ValueType waveNumber,
+                      const arma::Col<CoordinateType>& direction) :
+        m_waveNumber(waveNumber), m_direction(direction)
+    {}
+
+    int argumentDimension() const { return 3; }
+    int resultDimension() const { return 1; }
+
+    inline void evaluate(const arma::Col<CoordinateType>& point,
+                         arma::Col<ValueType>& result) const {
+        result(0) = std::exp(ValueType(0., 1.) * m_waveNumber *
+                             arma::dot(m_direction, point));
+    }
+
+private:
+    ValueType m_waveNumber;
+    arma::Col<CoordinateType> m_direction;
+};
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(PlaneWaveProjections)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(projections_agree_with_grid_functions, ResultType, complex_result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.singleRegular.setRelativeQuadratureOrder(4);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    const RT waveNumber = static_cast<RT>(2.);
+    const int directionCount = 20;
+    arma::Mat<CT> directions(3, directionCount);
+    for (int j = 0; j < directionCount; ++j) {
+        const CT theta = 0.3 * j, phi = 0.7 * j;
+        directions(0, j) = std::sin(theta) * std::cos(phi);
+        directions(1, j) = std::sin(theta) * std::sin(phi);
+        directions(2, j) = std::cos(theta);
+    }
+
+    arma::Mat<RT> projections = calculatePlaneWaveProjections<BFT>(
+        *context, space, directions, waveNumber,
+        AccuracyOptionsEx(accuracyOptions));
+    BOOST_CHECK_EQUAL(projections.n_rows, space->globalDofCount());
+    BOOST_CHECK_EQUAL(projections.n_cols, (size_t)directionCount);
+
+    arma::Mat<RT> expected(projections.n_rows, projections.n_cols);
+    for (int j = 0; j < directionCount; ++j) {
+        Bempp::GridFunction<BFT, RT> fun(context, space, space,
+                surfaceNormalIndependentFunction(
+                    PlaneWaveFunction<RT>(waveNumber, directions.col(j))));
+        expected.col(j) = fun.projections(space);
+    }
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    projections, expected,
+                    std::sqrt(std::numeric_limits<CT>::epsilon())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
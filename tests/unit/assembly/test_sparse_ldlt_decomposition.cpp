@@ -0,0 +1,130 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_trilinos.hpp"
+
+#ifdef WITH_TRILINOS
+
+#include "../check_arrays_are_close.hpp"
+#include "../random_arrays.hpp"
+
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/discrete_sparse_boundary_operator.hpp"
+#include "assembly/identity_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/sparse_ldlt_decomposition.hpp"
+
+#include "grid/grid.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <complex>
+
+using namespace Bempp;
+
+namespace {
+
+shared_ptr<const Epetra_CrsMatrix> continuousMassMatrix(
+        arma::Mat<double>& denseMatrix)
+{
+    typedef double BFT;
+    typedef double RT;
+
+    int nElementsX = 4, nElementsY = 5;
+    shared_ptr<Grid> grid = createRegularTriangularGrid(nElementsX, nElementsY);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+        new NumericalQuadratureStrategy<BFT, RT>);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    BoundaryOperator<BFT, RT> op = identityOperator<BFT, RT>(
+        context, space, space, space);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = op.weakForm();
+    denseMatrix = dop->asMatrix();
+    typedef DiscreteSparseBoundaryOperator<RT> SparseOp;
+    return SparseOp::castToSparse(dop)->epetraMatrix();
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(SparseLdlt)
+
+BOOST_AUTO_TEST_CASE(solve_works_for_continuous_mass_matrix)
+{
+    arma::Mat<double> A;
+    shared_ptr<const Epetra_CrsMatrix> mat = continuousMassMatrix(A);
+    SparseLdltDecomposition ldlt(*mat);
+
+    arma::Mat<double> b = generateRandomMatrix<double>(A.n_rows, 3);
+    arma::Mat<double> x = b;
+    ldlt.solve(x);
+    arma::Mat<double> expected = arma::solve(A, b);
+
+    BOOST_CHECK(check_arrays_are_close<double>(
+                    x, expected, 1e-12));
+}
+
+BOOST_AUTO_TEST_CASE(solve_works_for_complex_right_hand_sides)
+{
+    typedef std::complex<double> CT;
+
+    arma::Mat<double> A;
+    shared_ptr<const Epetra_CrsMatrix> mat = continuousMassMatrix(A);
+    SparseLdltDecomposition ldlt(*mat);
+
+    arma::Mat<CT> b = generateRandomMatrix<CT>(A.n_rows, 2);
+    arma::Mat<CT> x = b;
+    ldlt.solve(x);
+    arma::Mat<CT> expected = arma::solve(arma::Mat<CT>(A, 0. * A), b);
+
+    BOOST_CHECK(check_arrays_are_close<CT>(
+                    x, expected, 1e-12));
+}
+
+BOOST_AUTO_TEST_CASE(constructor_throws_for_singular_matrix)
+{
+    const int rowOffsets[] = {0, 1, 2};
+    const int colIndices[] = {0, 1};
+    const double values[] = {1., 0.};
+    BOOST_CHECK_THROW(SparseLdltDecomposition(2, rowOffsets, colIndices,
+                                              values),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif // WITH_TRILINOS
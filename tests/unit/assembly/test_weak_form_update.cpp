@@ -0,0 +1,170 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_view.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <limits>
+#include <vector>
+
+using namespace Bempp;
+
+namespace {
+
+// A sphere and a copy in which a vertex has been moved outwards, with the
+// elements touching that vertex
+struct DeformedSphereManager
+{
+    DeformedSphereManager()
+    {
+        GridParameters params;
+        params.topology = GridParameters::TRIANGULAR;
+        shared_ptr<Grid> duneGrid = GridFactory::importGmshGrid(
+                    params, "../../meshes/sphere-h-0.4.msh");
+        arma::Mat<double> vertices;
+        arma::Mat<int> corners;
+        arma::Mat<char> auxData;
+        std::vector<int> domainIndices;
+        duneGrid->leafView()->getRawElementData(vertices, corners, auxData,
+                                                domainIndices);
+        grid = GridFactory::createNativeGridFromConnectivityArrays(
+                    params, vertices, corners, domainIndices);
+
+        const int movedVertex = 0;
+        vertices.col(movedVertex) *= 1.1;
+        deformedGrid = GridFactory::createNativeGridFromConnectivityArrays(
+                    params, vertices, corners, domainIndices);
+        for (size_t e = 0; e < corners.n_cols; ++e)
+            for (size_t i = 0; i < corners.n_rows; ++i)
+                if (corners(i, e) == movedVertex)
+                    changedElements.push_back(e);
+    }
+
+    shared_ptr<Grid> grid;
+    shared_ptr<Grid> deformedGrid;
+    std::vector<int> changedElements;
+};
+
+// Return the weak forms of the single-layer operator on the deformed grid
+// updated from that on the original grid with \p assemblyOptions and
+// assembled from scratch with \p referenceAssemblyOptions
+template <typename BFT>
+void singleLayerWeakForms(const AssemblyOptions& assemblyOptions,
+                          const AssemblyOptions& referenceAssemblyOptions,
+                          arma::Mat<BFT>& updated, arma::Mat<BFT>& assembled)
+{
+    typedef BFT RT;
+    DeformedSphereManager mgr;
+    BOOST_REQUIRE(!mgr.changedElements.empty());
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    shared_ptr<Context<BFT, RT> > context(
+                new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    shared_ptr<Context<BFT, RT> > referenceContext(
+                new Context<BFT, RT>(quadStrategy, referenceAssemblyOptions));
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(mgr.grid));
+    shared_ptr<Space<BFT> > pwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(mgr.grid));
+    shared_ptr<Space<BFT> > deformedPwiseLinears(
+                new PiecewiseLinearContinuousScalarSpace<BFT>(
+                    mgr.deformedGrid));
+    shared_ptr<Space<BFT> > deformedPwiseConstants(
+                new PiecewiseConstantScalarSpace<BFT>(mgr.deformedGrid));
+
+    BoundaryOperator<BFT, RT> op =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                context, pwiseLinears, pwiseConstants, pwiseConstants);
+    BoundaryOperator<BFT, RT> deformedOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                context, deformedPwiseLinears, deformedPwiseConstants,
+                deformedPwiseConstants);
+    BoundaryOperator<BFT, RT> referenceOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                referenceContext, deformedPwiseLinears,
+                deformedPwiseConstants, deformedPwiseConstants);
+
+    updated = deformedOp.weakFormUpdatedFrom(
+                op, mgr.changedElements)->asMatrix();
+    assembled = referenceOp.weakForm()->asMatrix();
+    // The update must differ from the original weak form
+    BOOST_CHECK(!check_arrays_are_close<RT>(op.weakForm()->asMatrix(),
+                                            updated, 1e-4));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(WeakFormUpdate)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(dense_update_matches_assembly,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef typename Fiber::ScalarTraits<BFT>::RealType CT;
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    arma::Mat<BFT> updated, assembled;
+    singleLayerWeakForms(assemblyOptions, assemblyOptions, updated,
+                         assembled);
+
+    const CT eps = std::numeric_limits<CT>::epsilon();
+    BOOST_CHECK(check_arrays_are_close<BFT>(updated, assembled, 100 * eps));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(hmat_update_matches_assembly,
+                              BasisFunctionType, basis_function_types)
+{
+    typedef BasisFunctionType BFT;
+    typedef typename Fiber::ScalarTraits<BFT>::RealType CT;
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    AssemblyOptions referenceAssemblyOptions = assemblyOptions;
+    assemblyOptions.switchToHMatMode();
+    arma::Mat<BFT> updated, assembled;
+    singleLayerWeakForms(assemblyOptions, referenceAssemblyOptions, updated,
+                         assembled);
+
+    // The admissible blocks are approximated to the default accuracy
+    // (1e-3) of the H-matrix parameters
+    BOOST_CHECK(check_arrays_are_close<BFT>(updated, assembled, CT(1e-2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,174 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/identity_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "assembly/surface_normal_independent_function.hpp"
+#include "assembly/weighted_local_operator.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <limits>
+#include <stdexcept>
+
+using namespace Bempp;
+
+// z(x) = 1 + x_0
+template <typename ValueType_>
+class AffineFunction
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+    int argumentDimension() const { return 3; }
+    int resultDimension() const { return 1; }
+
+    inline void evaluate(const arma::Col<CoordinateType>& point,
+                         arma::Col<ValueType>& result) const {
+        result(0) = static_cast<ValueType>(1. + point(0));
+    }
+};
+
+template <typename BFT, typename RT>
+struct WeightedLocalOperatorFixture
+{
+    WeightedLocalOperatorFixture()
+    {
+        grid = createRegularTriangularGrid();
+        pwiseConstants.reset(new PiecewiseConstantScalarSpace<BFT>(grid));
+        pwiseLinears.reset(new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+        AccuracyOptions accuracyOptions;
+        shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+        AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        context.reset(new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    }
+
+    shared_ptr<Grid> grid;
+    shared_ptr<Space<BFT> > pwiseConstants;
+    shared_ptr<Space<BFT> > pwiseLinears;
+    shared_ptr<Context<BFT, RT> > context;
+};
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(WeightedLocalOperator)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(constant_coefficient_gives_scaled_identity, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    WeightedLocalOperatorFixture<BFT, RT> fixture;
+    Bempp::WeightedLocalOperator<BFT, RT> op(
+        fixture.context, fixture.pwiseLinears, fixture.pwiseConstants);
+    BoundaryOperator<BFT, RT> id = identityOperator<BFT, RT>(
+        fixture.context, fixture.pwiseLinears, fixture.pwiseLinears,
+        fixture.pwiseConstants);
+    arma::Mat<RT> expected = id.weakForm()->asMatrix();
+
+    const size_t pointCount = op.quadraturePoints().n_cols;
+    BOOST_CHECK_EQUAL(op.quadraturePointOffsets().back(), pointCount);
+
+    arma::Col<RT> coefficients(pointCount);
+    coefficients.fill(1.);
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    op.weakForm(coefficients)->asMatrix(), expected,
+                    100 * std::numeric_limits<CT>::epsilon()));
+
+    // The same object is refilled for another coefficient
+    coefficients.fill(static_cast<RT>(2.5));
+    arma::Mat<RT> scaled = static_cast<RT>(2.5) * expected;
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    op.weakForm(coefficients)->asMatrix(), scaled,
+                    100 * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(grid_function_coefficient_agrees_with_projections, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    WeightedLocalOperatorFixture<BFT, RT> fixture;
+    Bempp::WeightedLocalOperator<BFT, RT> op(
+        fixture.context, fixture.pwiseLinears, fixture.pwiseConstants,
+        1 /* coefficientOrder */);
+    GridFunction<BFT, RT> z(fixture.context, fixture.pwiseLinears,
+                            fixture.pwiseLinears,
+                            surfaceNormalIndependentFunction(
+                                AffineFunction<RT>()));
+
+    // z is piecewise linear, so its values are reproduced exactly
+    arma::Col<RT> values = op.coefficientValues(z);
+    const arma::Mat<CT> &points = op.quadraturePoints();
+    arma::Col<RT> expectedValues(points.n_cols);
+    for (size_t i = 0; i < points.n_cols; ++i)
+        expectedValues(i) = static_cast<RT>(1. + points(0, i));
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    values, expectedValues,
+                    1000 * std::numeric_limits<CT>::epsilon()));
+
+    // The piecewise linear trial functions sum up to one, so the row sums
+    // of the weak form are the projections of z on the test functions
+    arma::Col<RT> ones(fixture.pwiseLinears->globalDofCount());
+    ones.fill(1.);
+    arma::Col<RT> rowSums = op.weakForm(z)->asMatrix() * ones;
+    arma::Col<RT> expected = z.projections(fixture.pwiseConstants);
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    rowSums, expected,
+                    1000 * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(wrong_number_of_coefficients_throws, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    WeightedLocalOperatorFixture<BFT, RT> fixture;
+    Bempp::WeightedLocalOperator<BFT, RT> op(
+        fixture.context, fixture.pwiseLinears, fixture.pwiseLinears);
+    arma::Col<RT> coefficients(op.quadraturePoints().n_cols + 1);
+    coefficients.fill(1.);
+    std::vector<RT> values;
+    BOOST_CHECK_THROW(op.fillValues(coefficients, values),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
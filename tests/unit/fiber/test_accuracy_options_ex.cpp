@@ -232,4 +232,92 @@ BOOST_AUTO_TEST_CASE(quadratureOrder_agrees_with_setDoubleRegular_for_three_rela
     BOOST_CHECK_EQUAL(orderFar, defaultOrder + order3);
 }
 
+BOOST_AUTO_TEST_CASE(doubleRegularInSinglePrecision_is_true_only_in_the_far_band)
+{
+    Fiber::AccuracyOptionsEx opts;
+    const double maxNormalizedDistance1 = 2.;
+    const double maxNormalizedDistance2 = 4.;
+    std::vector<double> maxNormalizedDistances;
+    maxNormalizedDistances.push_back(maxNormalizedDistance1);
+    maxNormalizedDistances.push_back(maxNormalizedDistance2);
+    std::vector<int> orders(3, 0);
+    opts.setDoubleRegular(maxNormalizedDistances, orders);
+
+    BOOST_CHECK(!opts.singlePrecisionFarField());
+    BOOST_CHECK(!opts.doubleRegularInSinglePrecision(
+                    maxNormalizedDistance2 + 0.1));
+
+    opts.setSinglePrecisionFarField();
+    BOOST_CHECK(opts.singlePrecisionFarField());
+    BOOST_CHECK(!opts.doubleRegularInSinglePrecision(
+                    maxNormalizedDistance1 - 0.1));
+    BOOST_CHECK(!opts.doubleRegularInSinglePrecision(
+                    maxNormalizedDistance1 + 0.1));
+    BOOST_CHECK(opts.doubleRegularInSinglePrecision(
+                    maxNormalizedDistance2 + 0.1));
+}
+
+BOOST_AUTO_TEST_CASE(doubleRegularInSinglePrecision_is_false_for_a_single_band)
+{
+    Fiber::AccuracyOptionsEx opts;
+    opts.setDoubleRegular(2);
+    opts.setSinglePrecisionFarField();
+    BOOST_CHECK(!opts.doubleRegularInSinglePrecision(1e10));
+}
+
+BOOST_AUTO_TEST_CASE(doubleIntegralSemiAnalytic_is_true_only_in_the_near_field)
+{
+    Fiber::AccuracyOptionsEx opts;
+    BOOST_CHECK(!opts.semiAnalyticNearField());
+    BOOST_CHECK(!opts.doubleIntegralSemiAnalytic(0.));
+
+    const double maxNormalizedDistance = 1.5;
+    opts.setSemiAnalyticNearField(true, maxNormalizedDistance);
+    BOOST_CHECK(opts.semiAnalyticNearField());
+    BOOST_CHECK(opts.doubleIntegralSemiAnalytic(0.));
+    BOOST_CHECK(opts.doubleIntegralSemiAnalytic(maxNormalizedDistance - 0.1));
+    BOOST_CHECK(!opts.doubleIntegralSemiAnalytic(maxNormalizedDistance + 0.1));
+
+    opts.setSemiAnalyticNearField(false);
+    BOOST_CHECK(!opts.doubleIntegralSemiAnalytic(0.));
+}
+
+BOOST_AUTO_TEST_CASE(adaptiveDoubleRegularOrder_is_disabled_by_default)
+{
+    Fiber::AccuracyOptionsEx opts;
+    BOOST_CHECK_EQUAL(opts.adaptiveDoubleRegularTolerance(), 0.);
+    BOOST_CHECK_EQUAL(opts.adaptiveDoubleRegularOrder(1, 100., 1.), -1);
+}
+
+BOOST_AUTO_TEST_CASE(adaptiveDoubleRegularOrder_is_undefined_for_close_elements)
+{
+    Fiber::AccuracyOptionsEx opts;
+    opts.setAdaptiveDoubleRegular(1e-4);
+    BOOST_CHECK_EQUAL(opts.adaptiveDoubleRegularOrder(1, 1., 1.), -1);
+}
+
+BOOST_AUTO_TEST_CASE(adaptiveDoubleRegularOrder_decreases_with_distance_and_tolerance)
+{
+    Fiber::AccuracyOptionsEx opts;
+    const int basisOrder = 1;
+    opts.setAdaptiveDoubleRegular(1e-6);
+    const int orderNear = opts.adaptiveDoubleRegularOrder(basisOrder, 4., 1.);
+    const int orderFar = opts.adaptiveDoubleRegularOrder(basisOrder, 40., 1.);
+    BOOST_CHECK_GE(orderFar, basisOrder);
+    BOOST_CHECK_LT(orderFar, orderNear);
+
+    opts.setAdaptiveDoubleRegular(1e-3);
+    BOOST_CHECK_LT(opts.adaptiveDoubleRegularOrder(basisOrder, 4., 1.),
+                   orderNear);
+}
+
+BOOST_AUTO_TEST_CASE(adaptiveDoubleRegularOrder_grows_with_kernel_derivative_order)
+{
+    Fiber::AccuracyOptionsEx singleLayerOpts, doubleLayerOpts;
+    singleLayerOpts.setAdaptiveDoubleRegular(1e-8, 0);
+    doubleLayerOpts.setAdaptiveDoubleRegular(1e-8, 1);
+    BOOST_CHECK_GE(doubleLayerOpts.adaptiveDoubleRegularOrder(0, 4., 1.),
+                   singleLayerOpts.adaptiveDoubleRegularOrder(0, 4., 1.));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/array_memory_pool.hpp"
+#include "fiber/_3d_array.hpp"
+#include "fiber/collection_of_3d_arrays.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+
+// Tests
+
+using namespace Fiber;
+
+BOOST_AUTO_TEST_SUITE(ArrayMemoryPoolAllocation)
+
+BOOST_AUTO_TEST_CASE(blocks_are_aligned_and_reused)
+{
+    size_t capacity = 0;
+    void *block = ArrayMemoryPool::allocate(1000, capacity);
+    BOOST_CHECK_EQUAL(capacity, 1024u);
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(block) %
+                      ArrayMemoryPool::alignment, 0u);
+    ArrayMemoryPool::deallocate(block, capacity);
+    BOOST_CHECK_GE(ArrayMemoryPool::cachedBytes(), 1024u);
+
+    size_t otherCapacity = 0;
+    void *otherBlock = ArrayMemoryPool::allocate(600, otherCapacity);
+    BOOST_CHECK_EQUAL(otherBlock, block);
+    BOOST_CHECK_EQUAL(otherCapacity, capacity);
+    ArrayMemoryPool::deallocate(otherBlock, otherCapacity);
+
+    BOOST_CHECK_GE(ArrayMemoryPool::releaseCachedBlocks(), 1024u);
+    BOOST_CHECK_EQUAL(ArrayMemoryPool::cachedBytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(large_blocks_bypass_the_pool)
+{
+    ArrayMemoryPool::releaseCachedBlocks();
+    const size_t bytes = ArrayMemoryPool::maxPooledBlockSize + 1;
+    size_t capacity = 0;
+    void *block = ArrayMemoryPool::allocate(bytes, capacity);
+    BOOST_CHECK_GE(capacity, bytes);
+    ArrayMemoryPool::deallocate(block, capacity);
+    BOOST_CHECK_EQUAL(ArrayMemoryPool::cachedBytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(shrinking_array_keeps_its_storage)
+{
+    _3dArray<double> array(4, 5, 6);
+    array(3, 4, 5) = 1.;
+    const double *storage = array.begin();
+    array.set_size(2, 3, 4);
+    BOOST_CHECK_EQUAL(array.begin(), storage);
+    BOOST_CHECK_EQUAL(array.extent(2), 4u);
+    array.set_size(4, 5, 6);
+    BOOST_CHECK_EQUAL(array.begin(), storage);
+}
+
+BOOST_AUTO_TEST_CASE(new_complex_arrays_are_zero)
+{
+    _3dArray<std::complex<double>> array(2, 3, 4);
+    for (_3dArray<std::complex<double>>::const_iterator it = array.begin();
+         it != array.end(); ++it)
+        BOOST_CHECK_EQUAL(*it, std::complex<double>(0.));
+}
+
+BOOST_AUTO_TEST_CASE(arrays_of_objects_are_reallocated_when_shrinking)
+{
+    std::shared_ptr<int> value(new int(1));
+    {
+        _3dArray<std::shared_ptr<int>> array(2, 2, 2);
+        array(1, 1, 1) = value;
+        BOOST_CHECK_EQUAL(value.use_count(), 2);
+        array.set_size(1, 1, 1);
+        BOOST_CHECK_EQUAL(value.use_count(), 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(shrinking_collection_keeps_its_arrays)
+{
+    CollectionOf3dArrays<double> collection(3);
+    collection[1].set_size(2, 2, 2);
+    const double *storage = collection[1].begin();
+    collection.set_size(1);
+    collection.set_size(2);
+    BOOST_CHECK(collection[1].is_empty());
+    collection[1].set_size(2, 2, 2);
+    BOOST_CHECK_EQUAL(collection[1].begin(), storage);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
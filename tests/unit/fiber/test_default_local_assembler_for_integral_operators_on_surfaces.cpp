@@ -355,6 +355,77 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(
             ResultType>(true);
 }
 
+template <typename ResultType>
+void
+both_variants_of_evaluateLocalWeakForms_agree_for_separated_blocks(
+        bool cacheSingularIntegrals)
+{
+    DefaultLocalAssemblerForIntegralOperatorsOnSurfacesManager<
+            typename ScalarTraits<ResultType>::RealType, ResultType> mgr(
+                cacheSingularIntegrals);
+    typedef typename ScalarTraits<ResultType>::RealType CT;
+
+    // Elements in opposite corners of the grid share no vertices
+    const int elementCount = N_ELEMENTS_X * N_ELEMENTS_Y * 2;
+    std::vector<int> testIndices;
+    testIndices.push_back(0);
+    testIndices.push_back(1);
+    std::vector<int> trialIndices;
+    trialIndices.push_back(elementCount - 2);
+    trialIndices.push_back(elementCount - 1);
+    const CT nominalDistance = 0.5;
+
+    Fiber::_2dArray<arma::Mat<ResultType> > resultVariant2;
+    mgr.assembler->evaluateLocalWeakForms(testIndices, trialIndices,
+                                          resultVariant2, nominalDistance);
+
+    Fiber::_2dArray<arma::Mat<ResultType> > resultVariant1(
+                testIndices.size(), trialIndices.size());
+    std::vector<arma::Mat<ResultType> > colResult;
+    for (size_t trialI = 0; trialI < trialIndices.size(); ++trialI)
+    {
+        mgr.assembler->evaluateLocalWeakForms(Fiber::TEST_TRIAL, testIndices,
+                                              trialIndices[trialI],
+                                              Fiber::ALL_DOFS, colResult,
+                                              nominalDistance);
+        for (size_t testI = 0; testI < testIndices.size(); ++testI)
+            resultVariant1(testI, trialI) = colResult[testI];
+    }
+    BOOST_CHECK(check_arrays_are_close<ResultType>(
+                    resultVariant1, resultVariant2, 1e-6));
+
+    Fiber::_2dArray<arma::Mat<ResultType> > resultVariant3(
+                testIndices.size(), trialIndices.size());
+    std::vector<arma::Mat<ResultType> > rowResult;
+    for (size_t testI = 0; testI < testIndices.size(); ++testI)
+    {
+        mgr.assembler->evaluateLocalWeakForms(Fiber::TRIAL_TEST, trialIndices,
+                                              testIndices[testI],
+                                              Fiber::ALL_DOFS, rowResult,
+                                              nominalDistance);
+        for (size_t trialI = 0; trialI < trialIndices.size(); ++trialI)
+            resultVariant3(testI, trialI) = rowResult[trialI];
+    }
+    BOOST_CHECK(check_arrays_are_close<ResultType>(
+                    resultVariant3, resultVariant2, 1e-6));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+        both_variants_of_evaluateLocalWeakForms_agree_for_separated_blocks_and_cacheSingularIntegrals_false,
+        ResultType, result_types)
+{
+    both_variants_of_evaluateLocalWeakForms_agree_for_separated_blocks<
+            ResultType>(false);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+        both_variants_of_evaluateLocalWeakForms_agree_for_separated_blocks_and_cacheSingularIntegrals_true,
+        ResultType, result_types)
+{
+    both_variants_of_evaluateLocalWeakForms_agree_for_separated_blocks<
+            ResultType>(true);
+}
+
 template <typename ResultType>
 void
 evaluateLocalWeakForms_with_and_without_singular_integral_caching_gives_same_results(
@@ -0,0 +1,112 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/lagrange_scalar_shapeset.hpp"
+#include "fiber/scalar_traits.hpp"
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_case_template.hpp>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+namespace
+{
+
+// Compare the shapeset with a direct evaluation by Dune at a few points
+// of the reference triangle, twice to exercise the cached tables
+template <typename ValueType, int order>
+void checkAgainstDune()
+{
+    typedef Fiber::LagrangeScalarShapeset<3, ValueType, order> Shapeset;
+    typedef typename Shapeset::CoordinateType CT;
+    typedef Dune::Pk2DLocalBasis<CT, ValueType, order> DuneBasis;
+
+    arma::Mat<CT> points(2, 5);
+    points(0, 0) = 0.;   points(1, 0) = 0.;
+    points(0, 1) = 1.;   points(1, 1) = 0.;
+    points(0, 2) = 0.2;  points(1, 2) = 0.7;
+    points(0, 3) = 0.33; points(1, 3) = 0.33;
+    points(0, 4) = 0.05; points(1, 4) = 0.9;
+
+    Fiber::_3dArray<ValueType> expectedValues;
+    Fiber::_4dArray<ValueType> expectedDerivatives;
+    Fiber::evaluateShapeFunctionsWithDune<CT, ValueType, DuneBasis>(
+                points, Fiber::ALL_DOFS, expectedValues);
+    Fiber::evaluateShapeFunctionDerivativesWithDune<CT, ValueType, DuneBasis>(
+                points, Fiber::ALL_DOFS, expectedDerivatives);
+
+    const CT tol = 1e4 * std::numeric_limits<CT>::epsilon();
+    Shapeset shapeset;
+    for (int pass = 0; pass < 2; ++pass) {
+        Fiber::BasisData<ValueType> data;
+        shapeset.evaluate(Fiber::VALUES | Fiber::DERIVATIVES, points,
+                          Fiber::ALL_DOFS, data);
+        BOOST_CHECK(check_arrays_are_close<ValueType>(
+                        data.values, expectedValues, tol));
+        BOOST_CHECK(check_arrays_are_close<ValueType>(
+                        data.derivatives, expectedDerivatives, tol));
+    }
+
+    const int dof = shapeset.size() - 1;
+    Fiber::BasisData<ValueType> data;
+    shapeset.evaluate(Fiber::VALUES, points, dof, data);
+    BOOST_REQUIRE_EQUAL(data.values.extent(1), 1u);
+    for (size_t p = 0; p < points.n_cols; ++p)
+        BOOST_CHECK_SMALL(std::abs(data.values(0, 0, p) -
+                                   expectedValues(0, dof, p)), tol);
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(LagrangeScalarShapeset_triangle)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(size_and_order_are_correct,
+                              ValueType, basis_function_types)
+{
+    Fiber::LagrangeScalarShapeset<3, ValueType, 4> shapeset;
+    BOOST_CHECK_EQUAL(shapeset.size(), 15);
+    BOOST_CHECK_EQUAL(shapeset.order(), 4);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_agrees_with_dune_for_order_1,
+                              ValueType, basis_function_types)
+{
+    checkAgainstDune<ValueType, 1>();
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_agrees_with_dune_for_order_3,
+                              ValueType, basis_function_types)
+{
+    checkAgainstDune<ValueType, 3>();
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_agrees_with_dune_for_order_6,
+                              ValueType, basis_function_types)
+{
+    checkAgainstDune<ValueType, 6>();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/memory_registry.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+// Tests
+
+using namespace Fiber;
+
+BOOST_AUTO_TEST_SUITE(MemoryAccounting)
+
+BOOST_AUTO_TEST_CASE(allocations_are_counted_until_destroyed)
+{
+    const std::size_t live = MemoryRegistry::liveBytes();
+    const std::size_t dense =
+            MemoryRegistry::liveBytes(MemoryCategory::DENSE_MATRICES);
+    {
+        MemoryAllocation allocation(MemoryCategory::DENSE_MATRICES, 1000);
+        BOOST_CHECK_EQUAL(MemoryRegistry::liveBytes(), live + 1000);
+        allocation.grow(500);
+        BOOST_CHECK_EQUAL(
+                MemoryRegistry::liveBytes(MemoryCategory::DENSE_MATRICES),
+                dense + 1500);
+        allocation.resize(200);
+        BOOST_CHECK_EQUAL(allocation.bytes(), 200u);
+        BOOST_CHECK_EQUAL(MemoryRegistry::liveBytes(), live + 200);
+        BOOST_CHECK_GE(MemoryRegistry::peakBytes(), live + 1500);
+    }
+    BOOST_CHECK_EQUAL(MemoryRegistry::liveBytes(), live);
+}
+
+BOOST_AUTO_TEST_CASE(usage_lists_owners_by_category)
+{
+    MemoryAllocation a(MemoryCategory::HMATRICES, 300, "memory test A");
+    MemoryAllocation b(MemoryCategory::HMATRICES, 400, "memory test A");
+    MemoryAllocation c(MemoryCategory::SINGULAR_INTEGRAL_CACHES, 50);
+    c.setOwner("memory test B");
+
+    const MemoryUsage usage = MemoryRegistry::usage();
+    bool foundA = false, foundB = false;
+    for (std::size_t i = 0; i < usage.owners.size(); ++i) {
+        const MemoryOwnerUsage &owner = usage.owners[i];
+        if (owner.owner == "memory test A") {
+            foundA = true;
+            BOOST_CHECK_EQUAL(owner.category, MemoryCategory::HMATRICES);
+            BOOST_CHECK_EQUAL(owner.bytes, 700u);
+            BOOST_CHECK_EQUAL(owner.allocationCount, 2u);
+        } else if (owner.owner == "memory test B") {
+            foundB = true;
+            BOOST_CHECK_EQUAL(owner.bytes, 50u);
+        }
+    }
+    BOOST_CHECK(foundA);
+    BOOST_CHECK(foundB);
+
+    std::ostringstream os;
+    writeJson(os, usage);
+    BOOST_CHECK(os.str().find("\"owner\": \"memory test A\", "
+                              "\"category\": \"hMatrices\", "
+                              "\"bytes\": 700") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(makeRoom_calls_eviction_handlers_only_if_over_budget)
+{
+    std::unique_ptr<MemoryAllocation> cached(
+            new MemoryAllocation(MemoryCategory::DENSE_MATRICES, 1000));
+    int callCount = 0;
+    const int id = MemoryRegistry::addEvictionHandler(
+            [&](std::size_t) { ++callCount; cached.reset(); });
+
+    const std::size_t live = MemoryRegistry::liveBytes();
+    BOOST_CHECK(MemoryRegistry::makeRoom(1000000, 0));
+    BOOST_CHECK(MemoryRegistry::makeRoom(100, live + 100));
+    BOOST_CHECK_EQUAL(callCount, 0);
+
+    BOOST_CHECK(MemoryRegistry::makeRoom(500, live));
+    BOOST_CHECK_EQUAL(callCount, 1);
+    BOOST_CHECK_EQUAL(MemoryRegistry::liveBytes(), live - 1000);
+
+    // Nothing left to evict
+    BOOST_CHECK(!MemoryRegistry::makeRoom(2000, live));
+    MemoryRegistry::removeEvictionHandler(id);
+    BOOST_CHECK_EQUAL(MemoryRegistry::evict(1000), 0u);
+    BOOST_CHECK_EQUAL(callCount, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/hardware_counters.hpp"
+#include "fiber/profiler.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+
+// Tests
+
+using namespace Fiber;
+
+namespace {
+
+std::string summary()
+{
+    std::ostringstream os;
+    Profiler::writeJson(os);
+    return os.str();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(Profiling)
+
+BOOST_AUTO_TEST_CASE(nothing_is_recorded_while_disabled)
+{
+    Profiler::enable(false);
+    Profiler::reset();
+    {
+        ProfileRegion region("disabled region");
+        Profiler::addCount(ProfileCounter::INTEGRALS, 5);
+    }
+    const std::string json = summary();
+    BOOST_CHECK(json.find("disabled region") == std::string::npos);
+    BOOST_CHECK(json.find("\"integrals\": 5") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(nested_regions_are_identified_by_their_paths)
+{
+    Profiler::enable();
+    Profiler::reset();
+    {
+        ProfileRegion outer("outer");
+        for (int i = 0; i < 3; ++i) {
+            ProfileRegion inner(std::string("inner"));
+            Profiler::addCount(ProfileCounter::CACHE_HITS, 2);
+        }
+    }
+    Profiler::enable(false);
+    const std::string json = summary();
+    BOOST_CHECK(json.find("{\"path\": \"outer\", \"calls\": 1") !=
+                std::string::npos);
+    BOOST_CHECK(json.find("{\"path\": \"outer/inner\", \"calls\": 3") !=
+                std::string::npos);
+    BOOST_CHECK(json.find("\"cacheHits\": 6") != std::string::npos);
+
+    std::ostringstream trace;
+    Profiler::writeChromeTrace(trace);
+    BOOST_CHECK(trace.str().find("\"name\": \"inner\", \"ph\": \"X\"") !=
+                std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(regions_record_the_available_hardware_counters)
+{
+    // Which counters are available depends on the machine
+    const HardwareCounters counters;
+    Profiler::enable();
+    Profiler::enableHardwareCounters();
+    Profiler::reset();
+    {
+        ProfileRegion region("counted");
+        volatile double sum = 0.;
+        for (int i = 0; i < 100000; ++i)
+            sum += 0.5 * i;
+    }
+    Profiler::enableHardwareCounters(false);
+    Profiler::enable(false);
+    const std::string json = summary();
+    BOOST_CHECK(json.find("{\"path\": \"counted\", \"calls\": 1") !=
+                std::string::npos);
+    BOOST_CHECK_EQUAL(json.find("\"hardwareCounters\"") != std::string::npos,
+                      counters.availabilityMask() != 0);
+    if (counters.isAvailable(HardwareCounter::INSTRUCTIONS))
+        BOOST_CHECK(json.find("\"instructions\": 0,") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
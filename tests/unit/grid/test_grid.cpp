@@ -21,6 +21,7 @@
 #include "simple_triangular_grid_manager.hpp"
 #include "grid/grid_factory.hpp"
 #include "grid/structured_grid_factory.hpp"
+#include "fiber/element_bounding_volume_hierarchy.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
@@ -43,4 +44,36 @@ BOOST_AUTO_TEST_CASE(maxLevel_agrees_with_Dune)
     BOOST_CHECK_EQUAL(bemppGrid->maxLevel(), duneGrid->maxLevel());
 }
 
+BOOST_AUTO_TEST_CASE(elementBoundingVolumeHierarchy_finds_elements_within_distance)
+{
+    Bempp::shared_ptr<const Fiber::ElementBoundingVolumeHierarchy<double> > bvh =
+            bemppGrid->elementBoundingVolumeHierarchy();
+    BOOST_CHECK_EQUAL(bvh->elementCount(), 2 * N_ELEMENTS_X * N_ELEMENTS_Y);
+
+    const double point[3] = {0.5, 0.5, 2.};
+    std::vector<int> elements;
+    bvh->elementsWithinDistance(point, 1.5, elements);
+    BOOST_CHECK(elements.empty());
+    bvh->elementsWithinDistance(point, 2.5, elements);
+    BOOST_CHECK_EQUAL(elements.size(), (size_t)bvh->elementCount());
+}
+
+BOOST_AUTO_TEST_CASE(elementBoundingVolumeHierarchy_nearest_element_agrees_with_ray_intersection)
+{
+    Bempp::shared_ptr<const Fiber::ElementBoundingVolumeHierarchy<double> > bvh =
+            bemppGrid->elementBoundingVolumeHierarchy();
+
+    const double point[3] = {0.1, 0.05, 0.3};
+    const double direction[3] = {0., 0., -1.};
+    double distance, t;
+    const int nearest = bvh->nearestElement(point, distance);
+    const int hit = bvh->firstRayIntersection(point, direction, t);
+    BOOST_CHECK_EQUAL(nearest, hit);
+    BOOST_CHECK_CLOSE(distance, 0.3, 1e-10);
+    BOOST_CHECK_CLOSE(t, 0.3, 1e-10);
+
+    const double upwards[3] = {0., 0., 1.};
+    BOOST_CHECK_EQUAL(bvh->firstRayIntersection(point, upwards, t), -1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -22,11 +22,18 @@
 #include "grid/armadillo_helpers.hpp"
 #include "grid/entity_iterator.hpp"
 #include "grid/geometry.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_view.hpp"
+#include "io/gmsh.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include "../num_template.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
 using namespace Bempp;
 
 const double EPSILON = 1e-14;
@@ -120,3 +127,63 @@ BOOST_AUTO_TEST_CASE(jacobian_is_constant_everywhere_on_the_second_face)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(GridFactory_Gmsh)
+
+BOOST_AUTO_TEST_CASE(direct_import_agrees_with_dune_gmsh_reader)
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    std::vector<int> boundaryIds, domainIndices;
+    std::vector<int> duneBoundaryIds, duneDomainIndices;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-domains.msh",
+                boundaryIds, domainIndices, false /* verbose */);
+    shared_ptr<Grid> duneGrid = GridFactory::importGmshGrid(
+                params, "../../meshes/sphere-domains.msh",
+                duneBoundaryIds, duneDomainIndices, false /* verbose */,
+                true /* insertBoundarySegments */);
+
+    BOOST_CHECK(domainIndices == duneDomainIndices);
+
+    arma::Mat<double> vertices, duneVertices;
+    arma::Mat<int> corners, duneCorners;
+    arma::Mat<char> auxData;
+    grid->leafView()->getRawElementData(vertices, corners, auxData);
+    duneGrid->leafView()->getRawElementData(duneVertices, duneCorners,
+                                            auxData);
+    BOOST_REQUIRE_EQUAL(corners.n_cols, duneCorners.n_cols);
+    double maxDifference = 0.;
+    for (size_t e = 0; e < corners.n_cols; ++e)
+        for (int i = 0; i < 3; ++i)
+            for (int dim = 0; dim < 3; ++dim)
+                maxDifference = std::max(maxDifference, std::abs(
+                    vertices(dim, corners(i, e)) -
+                    duneVertices(dim, duneCorners(i, e))));
+    BOOST_CHECK_SMALL(maxDifference, EPSILON);
+}
+
+BOOST_AUTO_TEST_CASE(binary_msh_file_has_the_same_contents_as_ascii_file)
+{
+    GmshData data = GmshData::read(
+                std::string("../../meshes/sphere-h-0.4.msh"), -1);
+    std::vector<int> nodeIndices;
+    data.getNodeIndices(nodeIndices);
+    data.addNodeDataSet(std::vector<std::string>(1, "x"),
+                        std::vector<double>(1, 0.), 3, nodeIndices.size());
+    for (size_t i = 0; i < nodeIndices.size(); ++i) {
+        double x[3];
+        data.getNode(nodeIndices[i], x[0], x[1], x[2]);
+        data.addNodeData(0, nodeIndices[i], x);
+    }
+    data.write("test_grid_factory_binary.msh", GmshFileFormat::BINARY);
+    GmshData binaryData = GmshData::read(
+                std::string("test_grid_factory_binary.msh"), -1);
+
+    std::ostringstream ascii, binary;
+    data.write(ascii);
+    binaryData.write(binary);
+    BOOST_CHECK(ascii.str() == binary.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
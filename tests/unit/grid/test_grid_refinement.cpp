@@ -0,0 +1,160 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "simple_triangular_grid_manager.hpp"
+#include "grid/entity.hpp"
+#include "grid/entity_iterator.hpp"
+#include "grid/geometry.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_refinement.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/mapper.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace Bempp;
+
+namespace {
+
+// Sum of the areas of the elements of the leaf view of the grid, grouped
+// by the father indices
+std::vector<double> areasByFather(const Grid &grid,
+                                  const std::vector<int> &fatherIndices,
+                                  size_t fatherCount)
+{
+    std::vector<double> areas(fatherCount, 0.);
+    std::unique_ptr<GridView> view = grid.leafView();
+    const Mapper &mapper = view->elementMapper();
+    std::unique_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0> &e = it->entity();
+        areas[fatherIndices[mapper.entityIndex(e)]] += e.geometry().volume();
+        it->next();
+    }
+    return areas;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(GridRefinement_Triangular, SimpleTriangularGridManager)
+
+BOOST_AUTO_TEST_CASE(computeEdgeIndices_finds_each_edge_once)
+{
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    arma::Mat<char> auxData;
+    bemppGrid->leafView()->getRawElementData(vertices, elementCorners,
+                                             auxData);
+
+    arma::Mat<int> elementEdges, edgeVertices;
+    computeEdgeIndices(elementCorners, elementEdges, edgeVertices);
+
+    // Euler's formula for a disk: V - E + F = 1
+    const int edgeCount = N_ELEMENTS_X * (N_ELEMENTS_Y + 1) +
+        N_ELEMENTS_Y * (N_ELEMENTS_X + 1) + N_ELEMENTS_X * N_ELEMENTS_Y;
+    BOOST_CHECK_EQUAL((int) edgeVertices.n_cols, edgeCount);
+    BOOST_CHECK_EQUAL(bemppGrid->leafView()->entityCount(1),
+                      (size_t) edgeCount);
+
+    const int edgeCorners[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for (size_t e = 0; e < elementCorners.n_cols; ++e)
+        for (int k = 0; k < 3; ++k) {
+            const int a = elementCorners(edgeCorners[k][0], e);
+            const int b = elementCorners(edgeCorners[k][1], e);
+            BOOST_CHECK_EQUAL(edgeVertices(0, elementEdges(k, e)),
+                              std::min(a, b));
+            BOOST_CHECK_EQUAL(edgeVertices(1, elementEdges(k, e)),
+                              std::max(a, b));
+        }
+}
+
+BOOST_AUTO_TEST_CASE(uniform_refinement_splits_each_element_into_four)
+{
+    std::vector<int> fatherIndices;
+    shared_ptr<Grid> refinedGrid = GridFactory::createRefinedGrid(
+        *bemppGrid, GridRefinement::UNIFORM, &fatherIndices);
+    std::unique_ptr<GridView> view = bemppGrid->leafView();
+    std::unique_ptr<GridView> refinedView = refinedGrid->leafView();
+
+    BOOST_CHECK_EQUAL(refinedView->entityCount(0), 4 * view->entityCount(0));
+    BOOST_CHECK_EQUAL(refinedView->entityCount(2),
+                      view->entityCount(2) + view->entityCount(1));
+    BOOST_REQUIRE_EQUAL(fatherIndices.size(), refinedView->entityCount(0));
+
+    std::vector<double> areas =
+        areasByFather(*refinedGrid, fatherIndices, view->entityCount(0));
+    std::unique_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0> &e = it->entity();
+        BOOST_CHECK_CLOSE(areas[view->elementMapper().entityIndex(e)],
+                          e.geometry().volume(), 1e-10);
+        it->next();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(barycentric_refinement_splits_each_element_into_six)
+{
+    std::vector<int> fatherIndices;
+    shared_ptr<Grid> refinedGrid = GridFactory::createRefinedGrid(
+        *bemppGrid, GridRefinement::BARYCENTRIC, &fatherIndices);
+    std::unique_ptr<GridView> view = bemppGrid->leafView();
+    std::unique_ptr<GridView> refinedView = refinedGrid->leafView();
+
+    BOOST_CHECK_EQUAL(refinedView->entityCount(0), 6 * view->entityCount(0));
+    BOOST_CHECK_EQUAL(refinedView->entityCount(2),
+                      view->entityCount(2) + view->entityCount(1) +
+                      view->entityCount(0));
+
+    std::vector<double> areas =
+        areasByFather(*refinedGrid, fatherIndices, view->entityCount(0));
+    std::unique_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0> &e = it->entity();
+        BOOST_CHECK_CLOSE(areas[view->elementMapper().entityIndex(e)],
+                          e.geometry().volume(), 1e-10);
+        it->next();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(invalid_vertex_index_is_reported)
+{
+    arma::Mat<double> vertices(3, 3);
+    vertices.fill(0.);
+    arma::Mat<int> elementCorners(3, 2);
+    elementCorners.fill(0);
+    elementCorners(0, 0) = 1;
+    elementCorners(1, 0) = 2;
+    elementCorners(2, 1) = 3;
+
+    arma::Mat<double> newVertices;
+    arma::Mat<int> newElementCorners;
+    std::vector<int> newDomainIndices, fatherIndices;
+    BOOST_CHECK_THROW(refineTriangularGrid(GridRefinement::UNIFORM, vertices,
+                                           elementCorners, std::vector<int>(),
+                                           newVertices, newElementCorners,
+                                           newDomainIndices, fatherIndices),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -246,4 +246,34 @@ BOOST_AUTO_TEST_CASE(closedDomain_works)
     }
 }
 
+BOOST_AUTO_TEST_CASE(flag_constructor_agrees_with_set_constructor)
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.4.msh", false /* verbose */);
+
+    std::unique_ptr<GridView> view = grid->leafView();
+    boost::array<std::set<int>, 4> excludedIndices;
+    boost::array<std::vector<bool>, 4> excludedFlags;
+    for (int codim = 0; codim < 4; ++codim) {
+        const int entityCount = view->entityCount(codim);
+        excludedFlags[codim].resize(entityCount, false);
+        for (int index = codim; index < entityCount; index += 3) {
+            excludedIndices[codim].insert(index);
+            excludedFlags[codim][index] = true;
+        }
+    }
+    GridSegment segmentA(*grid, excludedIndices[0], excludedIndices[1],
+                         excludedIndices[2], excludedIndices[3], -1);
+    GridSegment segmentB(excludedFlags);
+
+    for (int codim = 0; codim < 4; ++codim) {
+        const int entityCount = view->entityCount(codim);
+        for (int index = -1; index <= entityCount; ++index)
+            BOOST_CHECK_EQUAL(segmentA.contains(codim, index),
+                              segmentB.contains(codim, index));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -20,12 +20,14 @@
 
 #include "test_grid_view.hpp"
 #include "grid/armadillo_helpers.hpp"
+#include "grid/element_connectivity.hpp"
 #include "grid/entity.hpp"
 #include "grid/entity_iterator.hpp"
 #include "grid/geometry.hpp"
 #include "grid/grid_factory.hpp"
 #include "grid/index_set.hpp"
 #include "grid/mapper.hpp"
+#include "fiber/raw_grid_geometry.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/version.hpp>
@@ -421,4 +423,125 @@ BOOST_AUTO_TEST_CASE_NUM_TEMPLATE(containsEntity_returns_true_for_second_entity_
     BOOST_CHECK(bemppGridView->containsEntity(it->entity()));
 }
 
+// rawGeometry()
+
+BOOST_AUTO_TEST_CASE(rawGeometry_is_shared_by_views_of_the_same_grid)
+{
+    std::unique_ptr<GridView> otherView = bemppGrid->leafView();
+    BOOST_CHECK(bemppGridView->rawGeometry<double>().get() ==
+                otherView->rawGeometry<double>().get());
+    BOOST_CHECK(bemppGridView->rawGeometry<float>().get() ==
+                otherView->rawGeometry<float>().get());
+}
+
+BOOST_AUTO_TEST_CASE(rawGeometry_agrees_with_getRawElementData)
+{
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    arma::Mat<char> auxData;
+    std::vector<int> domainIndices;
+    bemppGridView->getRawElementData(vertices, elementCorners, auxData,
+                                     domainIndices);
+
+    shared_ptr<const Fiber::RawGridGeometry<double> > geometry =
+        bemppGridView->rawGeometry<double>();
+    BOOST_CHECK(arma::accu(geometry->vertices() != vertices) == 0);
+    BOOST_CHECK(arma::accu(geometry->elementCornerIndices() !=
+                           elementCorners) == 0);
+    BOOST_CHECK(geometry->domainIndices() == domainIndices);
+}
+
+BOOST_AUTO_TEST_CASE(rawGeometry_integration_elements_and_normals_agree_with_Geometry)
+{
+    shared_ptr<const Fiber::RawGridGeometry<double> > geometry =
+        bemppGridView->rawGeometry<double>();
+    BOOST_REQUIRE_EQUAL(geometry->integrationElements().size(),
+                        bemppGridView->entityCount(0));
+    BOOST_REQUIRE_EQUAL(geometry->normals().n_cols,
+                        bemppGridView->entityCount(0));
+
+    arma::Mat<double> local(2, 1);
+    local.fill(1. / 3.);
+    const Mapper& mapper = bemppGridView->elementMapper();
+    std::unique_ptr<EntityIterator<0> > it = bemppGridView->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0>& e = it->entity();
+        const int index = mapper.entityIndex(e);
+        arma::Row<double> intElement;
+        arma::Mat<double> normal;
+        e.geometry().getIntegrationElements(local, intElement);
+        e.geometry().getNormals(local, normal);
+        BOOST_CHECK_CLOSE(geometry->integrationElements()[index],
+                          intElement(0), 1e-10);
+        for (int i = 0; i < 3; ++i)
+            BOOST_CHECK_SMALL(geometry->normals()(i, index) - normal(i, 0),
+                              1e-12);
+        it->next();
+    }
+}
+
+// elementConnectivity()
+
+BOOST_AUTO_TEST_CASE(elementConnectivity_is_shared_by_views_of_the_same_grid)
+{
+    std::unique_ptr<GridView> otherView = bemppGrid->leafView();
+    BOOST_CHECK(bemppGridView->elementConnectivity().get() ==
+                otherView->elementConnectivity().get());
+}
+
+BOOST_AUTO_TEST_CASE(elementConnectivity_agrees_with_index_set)
+{
+    shared_ptr<const ElementConnectivity> connectivity =
+        bemppGridView->elementConnectivity();
+    BOOST_REQUIRE_EQUAL(connectivity->elementCount(),
+                        bemppGridView->entityCount(0));
+    BOOST_CHECK_EQUAL(connectivity->edgeCount(), bemppGridView->entityCount(1));
+    BOOST_CHECK_EQUAL(connectivity->vertexCount(),
+                      bemppGridView->entityCount(2));
+
+    const IndexSet& indexSet = bemppGridView->indexSet();
+    std::unique_ptr<EntityIterator<0> > it = bemppGridView->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0>& e = it->entity();
+        const int index = indexSet.entityIndex(e);
+        BOOST_REQUIRE_EQUAL(connectivity->elementCornerCount(index), 3);
+        for (int i = 0; i < 3; ++i) {
+            BOOST_CHECK_EQUAL(connectivity->elementCorners()(i, index),
+                              indexSet.subEntityIndex(e, i, 2));
+            BOOST_CHECK_EQUAL(connectivity->elementEdges()(i, index),
+                              indexSet.subEntityIndex(e, i, 1));
+        }
+        BOOST_CHECK_EQUAL(connectivity->domainIndices()[index], e.domain());
+        it->next();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(elementConnectivity_neighbours_share_an_edge)
+{
+    shared_ptr<const ElementConnectivity> connectivity =
+        bemppGridView->elementConnectivity();
+    const arma::Mat<int>& edges = connectivity->elementEdges();
+    const arma::Mat<int>& neighbours = connectivity->elementNeighbours();
+    const std::vector<int>& offsets = connectivity->edgeElementOffsets();
+
+    int interiorEdgeCount = 0;
+    for (int e = 0; e < connectivity->elementCount(); ++e)
+        for (int i = 0; i < 3; ++i) {
+            const int edge = edges(i, e);
+            const int neighbour = neighbours(i, e);
+            if (offsets[edge + 1] - offsets[edge] == 2) {
+                BOOST_REQUIRE(neighbour >= 0);
+                BOOST_CHECK(neighbour != e);
+                BOOST_CHECK(arma::accu(edges.col(neighbour) == edge) == 1);
+                ++interiorEdgeCount;
+            } else
+                BOOST_CHECK_EQUAL(neighbour, -1);
+        }
+    // Each edge of the regular N_ELEMENTS_X x N_ELEMENTS_Y grid lying
+    // inside the rectangle is seen from two elements
+    const int boundaryEdgeCount = 2 * (N_ELEMENTS_X + N_ELEMENTS_Y);
+    BOOST_CHECK_EQUAL(interiorEdgeCount,
+                      2 * (connectivity->edgeCount() - boundaryEdgeCount));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,243 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "grid/element_connectivity.hpp"
+#include "grid/entity.hpp"
+#include "grid/entity_iterator.hpp"
+#include "grid/geometry.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/id_set.hpp"
+#include "grid/index_set.hpp"
+#include "grid/mapper.hpp"
+#include "grid/native_triangular_grid.hpp"
+#include "grid/reverse_element_mapper.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace Bempp;
+
+namespace {
+
+// The same mesh as a Dune grid and as a native grid
+struct NativeTriangularGridManager
+{
+    NativeTriangularGridManager()
+    {
+        GridParameters params;
+        params.topology = GridParameters::TRIANGULAR;
+        duneGrid = GridFactory::importGmshGrid(
+                    params, "../../meshes/sphere-h-0.4.msh");
+        arma::Mat<char> auxData;
+        duneGrid->leafView()->getRawElementData(vertices, corners, auxData,
+                                                domainIndices);
+        grid = GridFactory::createNativeGridFromConnectivityArrays(
+                    params, vertices, corners, domainIndices);
+        view = grid->leafView();
+    }
+
+    shared_ptr<Grid> duneGrid;
+    shared_ptr<Grid> grid;
+    std::unique_ptr<GridView> view;
+    arma::Mat<double> vertices;
+    arma::Mat<int> corners;
+    std::vector<int> domainIndices;
+};
+
+double totalArea(const GridView &view)
+{
+    double area = 0.;
+    std::unique_ptr<EntityIterator<0> > it = view.entityIterator<0>();
+    while (!it->finished()) {
+        area += it->entity().geometry().volume();
+        it->next();
+    }
+    return area;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(NativeTriangularGrid_Sphere,
+                         NativeTriangularGridManager)
+
+BOOST_AUTO_TEST_CASE(entityCount_agrees_with_dune_grid)
+{
+    std::unique_ptr<GridView> duneView = duneGrid->leafView();
+    for (int codim = 0; codim <= 3; ++codim)
+        BOOST_CHECK_EQUAL(view->entityCount(codim),
+                          duneView->entityCount(codim));
+    // The sphere is closed: V - E + F = 2
+    BOOST_CHECK_EQUAL(int(view->entityCount(2)) - int(view->entityCount(1)) +
+                      int(view->entityCount(0)), 2);
+}
+
+BOOST_AUTO_TEST_CASE(getRawElementData_returns_the_arrays_given_to_the_factory)
+{
+    arma::Mat<double> nativeVertices;
+    arma::Mat<int> nativeCorners;
+    arma::Mat<char> auxData;
+    std::vector<int> nativeDomainIndices;
+    view->getRawElementData(nativeVertices, nativeCorners, auxData,
+                            nativeDomainIndices);
+    BOOST_CHECK(arma::accu(nativeVertices != vertices) == 0);
+    BOOST_CHECK(arma::accu(nativeCorners != corners) == 0);
+    BOOST_CHECK(nativeDomainIndices == domainIndices);
+}
+
+BOOST_AUTO_TEST_CASE(element_areas_agree_with_dune_grid)
+{
+    const double area = totalArea(*view);
+    BOOST_CHECK_CLOSE(area, totalArea(*duneGrid->leafView()), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(subentities_agree_with_index_set_and_connectivity)
+{
+    const int edgeCorners[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    const IndexSet &indexSet = view->indexSet();
+    shared_ptr<const ElementConnectivity> connectivity =
+        view->elementConnectivity();
+    std::unique_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0> &element = it->entity();
+        const int index = indexSet.entityIndex(element);
+        BOOST_CHECK_EQUAL(element.domain(), domainIndices[index]);
+
+        std::unique_ptr<EntityIterator<2> > vit =
+            element.subEntityIterator<2>();
+        for (int i = 0; i < 3; ++i, vit->next()) {
+            BOOST_REQUIRE(!vit->finished());
+            BOOST_CHECK_EQUAL(indexSet.entityIndex(vit->entity()),
+                              size_t(corners(i, index)));
+            BOOST_CHECK_EQUAL(indexSet.subEntityIndex(element, i, 2),
+                              size_t(corners(i, index)));
+        }
+        BOOST_CHECK(vit->finished());
+
+        std::unique_ptr<EntityIterator<1> > eit =
+            element.subEntityIterator<1>();
+        for (int i = 0; i < 3; ++i, eit->next()) {
+            BOOST_REQUIRE(!eit->finished());
+            const size_t edge = indexSet.entityIndex(eit->entity());
+            BOOST_CHECK_EQUAL(edge, indexSet.subEntityIndex(element, i, 1));
+            BOOST_CHECK_EQUAL(int(edge),
+                              connectivity->elementEdges()(i, index));
+            arma::Mat<double> edgeEnds;
+            eit->entity().geometry().getCorners(edgeEnds);
+            arma::Col<double> a = vertices.col(corners(edgeCorners[i][0],
+                                                       index));
+            arma::Col<double> b = vertices.col(corners(edgeCorners[i][1],
+                                                       index));
+            const double sumOfLengths =
+                arma::norm(edgeEnds.col(0) - a, 2) +
+                arma::norm(edgeEnds.col(1) - b, 2);
+            const double sumOfLengthsSwapped =
+                arma::norm(edgeEnds.col(0) - b, 2) +
+                arma::norm(edgeEnds.col(1) - a, 2);
+            BOOST_CHECK_SMALL(std::min(sumOfLengths, sumOfLengthsSwapped),
+                              1e-14);
+        }
+        BOOST_CHECK(eit->finished());
+        it->next();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(every_edge_of_the_sphere_has_two_neighbours)
+{
+    shared_ptr<const ElementConnectivity> connectivity =
+        view->elementConnectivity();
+    BOOST_CHECK(connectivity.get() ==
+                grid->leafView()->elementConnectivity().get());
+    BOOST_CHECK_EQUAL(3 * connectivity->elementCount(),
+                      2 * connectivity->edgeCount());
+    BOOST_CHECK_EQUAL(arma::accu(connectivity->elementNeighbours()
+                                     .rows(0, 2) < 0), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ids_are_unique_across_codimensions)
+{
+    const IdSet &idSet = grid->globalIdSet();
+    std::set<IdSet::IdType> ids;
+    std::unique_ptr<EntityIterator<0> > it0 = view->entityIterator<0>();
+    for (; !it0->finished(); it0->next())
+        ids.insert(idSet.entityId(it0->entity()));
+    std::unique_ptr<EntityIterator<1> > it1 = view->entityIterator<1>();
+    for (; !it1->finished(); it1->next())
+        ids.insert(idSet.entityId(it1->entity()));
+    std::unique_ptr<EntityIterator<2> > it2 = view->entityIterator<2>();
+    for (; !it2->finished(); it2->next())
+        ids.insert(idSet.entityId(it2->entity()));
+    BOOST_CHECK_EQUAL(ids.size(), view->entityCount(0) +
+                      view->entityCount(1) + view->entityCount(2));
+}
+
+BOOST_AUTO_TEST_CASE(reverseElementMapper_and_frozen_pointers_keep_the_element)
+{
+    const ReverseElementMapper &reverseMapper = view->reverseElementMapper();
+    const Mapper &mapper = view->elementMapper();
+    for (size_t i = 0; i < view->entityCount(0); ++i)
+        BOOST_CHECK_EQUAL(
+            mapper.entityIndex(reverseMapper.entityPointer(i).entity()), i);
+    BOOST_CHECK(view->containsEntity(
+                    reverseMapper.entityPointer(0).entity()));
+}
+
+BOOST_AUTO_TEST_CASE(elements_have_no_father_and_no_sons)
+{
+    std::unique_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    const Entity<0> &element = it->entity();
+    BOOST_CHECK(!element.hasFather());
+    BOOST_CHECK(!element.father());
+    BOOST_CHECK(element.isLeaf());
+    BOOST_CHECK(element.sonIterator(grid->maxLevel())->finished());
+    BOOST_CHECK_THROW(grid->levelView(1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(createRefinedGrid_returns_a_native_grid)
+{
+    std::vector<int> fatherIndices;
+    shared_ptr<Grid> refinedGrid = GridFactory::createRefinedGrid(
+                *grid, GridRefinement::UNIFORM, &fatherIndices);
+    BOOST_CHECK(dynamic_cast<const NativeTriangularGrid *>(
+                    refinedGrid.get()) != 0);
+    std::unique_ptr<GridView> refinedView = refinedGrid->leafView();
+    BOOST_CHECK_EQUAL(refinedView->entityCount(0), 4 * view->entityCount(0));
+    BOOST_CHECK_EQUAL(fatherIndices.size(), refinedView->entityCount(0));
+    BOOST_CHECK_CLOSE(totalArea(*refinedView), totalArea(*view), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_vertex_index_is_rejected)
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    arma::Mat<int> invalidCorners = corners;
+    invalidCorners(1, 0) = vertices.n_cols;
+    BOOST_CHECK_THROW(GridFactory::createNativeGridFromConnectivityArrays(
+                          params, vertices, invalidCorners),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
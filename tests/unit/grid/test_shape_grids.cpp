@@ -0,0 +1,169 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_refinement.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/shape_grids.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+using namespace Bempp;
+
+namespace {
+
+// Volume enclosed by an outwards oriented closed triangulation
+double enclosedVolume(const arma::Mat<double> &vertices,
+                      const arma::Mat<int> &elementCorners)
+{
+    double volume = 0.;
+    for (size_t e = 0; e < elementCorners.n_cols; ++e)
+        volume += arma::dot(vertices.col(elementCorners(0, e)),
+                            arma::cross(vertices.col(elementCorners(1, e)),
+                                        vertices.col(elementCorners(2, e))));
+    return volume / 6.;
+}
+
+double maxEdgeLength(const arma::Mat<double> &vertices,
+                     const arma::Mat<int> &elementCorners)
+{
+    double result = 0.;
+    for (size_t e = 0; e < elementCorners.n_cols; ++e)
+        for (int i = 0; i < 3; ++i)
+            result = std::max(result, arma::norm(
+                vertices.col(elementCorners(i, e)) -
+                vertices.col(elementCorners((i + 1) % 3, e)), 2));
+    return result;
+}
+
+// Check that every edge is shared by exactly two elements and that the
+// Euler characteristic is that of a sphere
+void checkClosedSurface(const arma::Mat<double> &vertices,
+                        const arma::Mat<int> &elementCorners)
+{
+    arma::Mat<int> elementEdges, edgeVertices;
+    computeEdgeIndices(elementCorners, elementEdges, edgeVertices);
+    BOOST_CHECK_EQUAL(2 * edgeVertices.n_cols, 3 * elementCorners.n_cols);
+    BOOST_CHECK_EQUAL(int(vertices.n_cols) - int(edgeVertices.n_cols) +
+                      int(elementCorners.n_cols), 2);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ShapeGrids)
+
+BOOST_AUTO_TEST_CASE(sphere_is_closed_fine_enough_and_oriented_outwards)
+{
+    arma::Col<double> origin(3);
+    origin(0) = 1.; origin(1) = -2.; origin(2) = 0.5;
+    const double radius = 2., h = 0.3;
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    sphereConnectivityArrays(radius, origin, h, vertices, elementCorners);
+
+    BOOST_CHECK_EQUAL(elementCorners.n_cols % 20, 0);
+    checkClosedSurface(vertices, elementCorners);
+    BOOST_CHECK(maxEdgeLength(vertices, elementCorners) <= h);
+    for (size_t v = 0; v < vertices.n_cols; ++v)
+        BOOST_CHECK_CLOSE(arma::norm(vertices.col(v) - origin, 2),
+                          radius, 1e-10);
+
+    arma::Mat<double> centred = vertices;
+    centred.each_col() -= origin;
+    const double exactVolume = 4. / 3. * M_PI * std::pow(radius, 3);
+    const double volume = enclosedVolume(centred, elementCorners);
+    BOOST_CHECK(volume > 0.95 * exactVolume);
+    BOOST_CHECK(volume < exactVolume);
+}
+
+BOOST_AUTO_TEST_CASE(ellipsoid_is_stretched_along_the_axes)
+{
+    arma::Col<double> origin(3, arma::fill::zeros);
+    arma::Col<double> radii(3);
+    radii(0) = 1.; radii(1) = 2.; radii(2) = 0.5;
+    const double h = 0.25;
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    ellipsoidConnectivityArrays(radii, origin, h, vertices, elementCorners);
+
+    checkClosedSurface(vertices, elementCorners);
+    BOOST_CHECK(maxEdgeLength(vertices, elementCorners) <= h);
+    for (size_t v = 0; v < vertices.n_cols; ++v)
+        BOOST_CHECK_CLOSE(arma::norm(vertices.col(v) / radii, 2), 1., 1e-10);
+    const double exactVolume = 4. / 3. * M_PI * arma::prod(radii);
+    BOOST_CHECK_CLOSE(enclosedVolume(vertices, elementCorners), exactVolume,
+                      5.);
+}
+
+BOOST_AUTO_TEST_CASE(cube_is_closed_structured_and_oriented_outwards)
+{
+    arma::Col<double> origin(3);
+    origin(0) = -1.; origin(1) = 0.; origin(2) = 2.;
+    const double length = 1.5, h = 0.4; // four subdivisions per edge
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    cubeConnectivityArrays(length, origin, h, vertices, elementCorners);
+
+    BOOST_CHECK_EQUAL(vertices.n_cols, 6 * 4 * 4 + 2);
+    BOOST_CHECK_EQUAL(elementCorners.n_cols, 12 * 4 * 4);
+    checkClosedSurface(vertices, elementCorners);
+    BOOST_CHECK_CLOSE(arma::min(vertices.row(0)), -1., 1e-10);
+    BOOST_CHECK_CLOSE(arma::max(vertices.row(2)), 3.5, 1e-10);
+
+    arma::Mat<double> centred = vertices;
+    centred.each_col() -= origin;
+    BOOST_CHECK_CLOSE(enclosedVolume(centred, elementCorners),
+                      std::pow(length, 3), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(grid_factory_creates_sphere_grid)
+{
+    arma::Col<double> origin(3, arma::fill::zeros);
+    shared_ptr<Grid> grid = GridFactory::createSphereGrid(1., origin, 0.5);
+    BOOST_REQUIRE(grid);
+    std::unique_ptr<GridView> view = grid->leafView();
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    sphereConnectivityArrays(1., origin, 0.5, vertices, elementCorners);
+    BOOST_CHECK_EQUAL(view->entityCount(0), elementCorners.n_cols);
+    BOOST_CHECK_EQUAL(view->entityCount(2), vertices.n_cols);
+}
+
+BOOST_AUTO_TEST_CASE(nonpositive_sizes_are_rejected)
+{
+    arma::Col<double> origin(3, arma::fill::zeros);
+    arma::Mat<double> vertices;
+    arma::Mat<int> elementCorners;
+    BOOST_CHECK_THROW(sphereConnectivityArrays(1., origin, 0., vertices,
+                                               elementCorners),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(cubeConnectivityArrays(-1., origin, 0.1, vertices,
+                                             elementCorners),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
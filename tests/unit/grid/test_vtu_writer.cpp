@@ -0,0 +1,118 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "simple_triangular_grid_manager.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/vtu_writer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+using namespace Bempp;
+
+namespace {
+
+std::string readFile(const std::string &fileName)
+{
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+size_t countOccurrences(const std::string &text, const std::string &pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + pattern.size()))
+        ++count;
+    return count;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(VtuWriter_Triangular, SimpleTriangularGridManager)
+
+BOOST_AUTO_TEST_CASE(raw_cell_data_are_written_in_the_first_appended_array)
+{
+    std::unique_ptr<GridView> view = bemppGrid->leafView();
+    const size_t cellCount = view->entityCount(0);
+    arma::Mat<double> data(1, cellCount);
+    for (size_t i = 0; i < cellCount; ++i)
+        data(0, i) = 0.5 * i;
+
+    VtuWriter writer(*view);
+    writer.addCellData(data, "values");
+    const std::string fileName = writer.write("test_vtu_writer_raw");
+    BOOST_CHECK_EQUAL(fileName, "test_vtu_writer_raw.vtu");
+
+    const std::string contents = readFile(fileName);
+    BOOST_CHECK(contents.find("NumberOfPoints=\"20\" NumberOfCells=\"24\"") !=
+                std::string::npos);
+    BOOST_CHECK(contents.find("Name=\"values\"") != std::string::npos);
+
+    const std::string marker = "<AppendedData encoding=\"raw\">\n_";
+    const size_t begin = contents.find(marker);
+    BOOST_REQUIRE(begin != std::string::npos);
+    const char *appended = contents.data() + begin + marker.size();
+    std::uint64_t byteCount;
+    std::memcpy(&byteCount, appended, sizeof(byteCount));
+    BOOST_REQUIRE_EQUAL(byteCount, cellCount * sizeof(double));
+    for (size_t i = 0; i < cellCount; ++i) {
+        double value;
+        std::memcpy(&value, appended + sizeof(byteCount) + i * sizeof(double),
+                    sizeof(double));
+        BOOST_CHECK_EQUAL(value, data(0, i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pieces_are_collected_in_a_pvtu_file)
+{
+    std::unique_ptr<GridView> view = bemppGrid->leafView();
+    arma::Mat<double> data(3, view->entityCount(2));
+    data.fill(1.);
+
+    VtuWriter writer(*view);
+    writer.addVertexData(data, "vectors");
+    const std::string fileName =
+        writer.write("test_vtu_writer_pieces", VtuWriter::APPENDED_RAW, 3);
+    BOOST_CHECK_EQUAL(fileName, "test_vtu_writer_pieces.pvtu");
+
+    const std::string contents = readFile(fileName);
+    BOOST_CHECK_EQUAL(countOccurrences(contents, "<Piece Source="), 3u);
+    BOOST_CHECK(contents.find("Name=\"vectors\"") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(addCellData_throws_for_wrong_number_of_columns)
+{
+    std::unique_ptr<GridView> view = bemppGrid->leafView();
+    arma::Mat<double> data(1, view->entityCount(0) + 1);
+
+    VtuWriter writer(*view);
+    BOOST_CHECK_THROW(writer.addCellData(data, "values"),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,154 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+#include "../assembly/create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/identity_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+#include "grid/grid.hpp"
+#include "linalg/convolution_quadrature.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <limits>
+
+using namespace Bempp;
+
+// The operator family K(s) = s I is the Laplace transform of the time
+// derivative, so the CQ solution of K(d/dt) phi = M u, with M the mass
+// matrix, is the backward difference approximation of the integral of u
+
+template <typename RT>
+arma::Mat<typename ScalarTraits<RT>::RealType>
+solveIdentityFamily(ConvolutionQuadratureOptions::Method method,
+                    size_t timeStepCount,
+                    arma::Mat<typename ScalarTraits<RT>::RealType> &u,
+                    arma::Mat<typename ScalarTraits<RT>::RealType> &expected)
+{
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid();
+    shared_ptr<Space<BFT> > space(new PiecewiseConstantScalarSpace<BFT>(grid));
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+            new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    BoundaryOperator<BFT, RT> id =
+        identityOperator<BFT, RT>(context, space, space, space);
+    arma::Mat<CT> mass = arma::real(id.weakForm()->asMatrix());
+
+    const CT dt = 0.1;
+    const size_t dofCount = space->globalDofCount();
+    u.set_size(dofCount, timeStepCount);
+    for (size_t n = 0; n < timeStepCount; ++n)
+        for (size_t i = 0; i < dofCount; ++i)
+            u(i, n) = std::sin(0.3 * n + i);
+
+    // (3 phi_n - 4 phi_{n-1} + phi_{n-2}) / (2 dt) = u_n for BDF2 and
+    // (phi_n - phi_{n-1}) / dt = u_n for BDF1
+    expected.zeros(dofCount, timeStepCount);
+    for (size_t n = 0; n < timeStepCount; ++n) {
+        if (method == ConvolutionQuadratureOptions::BDF1) {
+            expected.col(n) = dt * u.col(n);
+            if (n >= 1)
+                expected.col(n) += expected.col(n - 1);
+        } else {
+            expected.col(n) = 2. * dt * u.col(n);
+            if (n >= 1)
+                expected.col(n) += 4. * expected.col(n - 1);
+            if (n >= 2)
+                expected.col(n) -= expected.col(n - 2);
+            expected.col(n) /= 3.;
+        }
+    }
+
+    ConvolutionQuadratureOptions options;
+    options.method = method;
+    options.batchSize = 2;
+    ConvolutionQuadrature<BFT> cq(timeStepCount, dt, options);
+    return cq.solve([&](RT s) { return s * id; }, arma::Mat<CT>(mass * u));
+}
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(ConvolutionQuadrature)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(laplace_parameters_are_conjugate_symmetric,
+                              ValueType, complex_result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    ConvolutionQuadratureOptions options;
+    options.method = ConvolutionQuadratureOptions::BDF1;
+    options.radius = 0.9;
+    const size_t timeStepCount = 7;
+    Bempp::ConvolutionQuadrature<BFT> cq(timeStepCount, 0.5, options);
+    const std::vector<RT> &s = cq.laplaceParameters();
+    BOOST_REQUIRE_EQUAL(s.size(), timeStepCount);
+    BOOST_CHECK_CLOSE(std::real(s[0]), CT(0.2), 1e-3 /* percent */);
+    BOOST_CHECK_SMALL(std::imag(s[0]), CT(1e-6));
+    for (size_t l = 1; l < timeStepCount; ++l)
+        BOOST_CHECK_SMALL(std::abs(s[l] - std::conj(s[timeStepCount - l])),
+                          CT(1e-5));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(bdf1_solution_agrees_with_time_stepping,
+                              ValueType, complex_result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    // 12 steps exercise the transform of lengths other than powers of two
+    arma::Mat<CT> u, expected;
+    arma::Mat<CT> phi = solveIdentityFamily<RT>(
+        ConvolutionQuadratureOptions::BDF1, 12, u, expected);
+    BOOST_CHECK(check_arrays_are_close<CT>(
+                    phi, expected,
+                    100 * std::sqrt(std::numeric_limits<CT>::epsilon())));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(bdf2_solution_agrees_with_time_stepping,
+                              ValueType, complex_result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    arma::Mat<CT> u, expected;
+    arma::Mat<CT> phi = solveIdentityFamily<RT>(
+        ConvolutionQuadratureOptions::BDF2, 16, u, expected);
+    BOOST_CHECK(check_arrays_are_close<CT>(
+                    phi, expected,
+                    100 * std::sqrt(std::numeric_limits<CT>::epsilon())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -27,6 +27,7 @@
 #include "assembly/blocked_operator_structure.hpp"
 #include "linalg/default_direct_solver.hpp"
 
+#include <boost/make_shared.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <boost/type_traits/is_complex.hpp>
@@ -165,4 +166,45 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(boundary_operator_agrees_with_2x2_blocked_boundary
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(async_solve_agrees_with_solve_and_can_be_cancelled,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    arma::Col<RT> solutionVector;
+    {
+        DirectSolver solver(fixture.lhsOp);
+        Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+        solutionVector = solution.gridFunction().coefficients();
+    }
+
+    DenseLuOptions options;
+    options.tileSize = 4;
+    DirectSolver solver(fixture.lhsOp, options);
+
+    // Cancel the factorization as soon as its first panel is done
+    shared_ptr<SolveControl> control;
+    control = boost::make_shared<SolveControl>(
+        [&control](const SolveProgress &progress) {
+            if (progress.fraction > 0)
+                control->cancel();
+        });
+    std::future<Solution<BFT, RT> > cancelledSolution =
+        solver.solveAsync(fixture.rhs, control);
+    BOOST_CHECK_THROW(cancelledSolution.get(), SolveCancelledError);
+
+    // The factorization is restarted by the next solve
+    Solution<BFT, RT> asyncSolution = solver.solveAsync(fixture.rhs).get();
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solutionVector, asyncSolution.gridFunction().coefficients(),
+                    solverTol * 10));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -32,6 +32,7 @@
 #include "linalg/default_iterative_solver.hpp"
 #include "linalg/solver.hpp"
 
+#include <boost/make_shared.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <boost/type_traits/is_complex.hpp>
@@ -355,6 +356,86 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(boundary_operator_agrees_with_2x2_blocked_boundary
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(collecting_statistics_does_not_change_solution,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture(
+        PIECEWISE_LINEARS, PIECEWISE_LINEARS, PIECEWISE_LINEARS, PIECEWISE_LINEARS);
+
+    typedef Bempp::DefaultIterativeSolver<BFT, RT> IterSolver;
+    const RealType solverTol = 1e-6;
+
+    IterSolver solver(
+        fixture.lhsOp, ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+    solver.initializeSolver(defaultGmresParameterList(solverTol));
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK(solver.statistics().iterations.empty());
+
+    size_t callbackCount = 0;
+    solver.collectStatistics(
+        true, [&callbackCount](const SolverIterationStatistics &) {
+            ++callbackCount;
+        });
+    Solution<BFT, RT> instrumentedSolution = solver.solve(fixture.rhs);
+    const SolverStatistics &statistics = solver.statistics();
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(),
+                    instrumentedSolution.gridFunction().coefficients(),
+                    solverTol));
+    BOOST_CHECK_EQUAL(callbackCount, statistics.iterations.size());
+    BOOST_CHECK_EQUAL(statistics.operatorApplyCount,
+                      statistics.iterations.size());
+    BOOST_CHECK_GE(statistics.iterations.size(),
+                   size_t(instrumentedSolution.iterationCount()));
+    BOOST_CHECK_LE(statistics.operatorTime, statistics.time);
+    BOOST_CHECK_EQUAL(statistics.residual,
+                      instrumentedSolution.achievedTolerance());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(async_solve_agrees_with_solve_and_can_be_cancelled,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture(
+        PIECEWISE_LINEARS, PIECEWISE_LINEARS, PIECEWISE_LINEARS, PIECEWISE_LINEARS);
+
+    typedef Bempp::DefaultIterativeSolver<BFT, RT> IterSolver;
+    const RealType solverTol = 1e-6;
+
+    IterSolver solver(
+        fixture.lhsOp, ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+    solver.initializeSolver(defaultGmresParameterList(solverTol));
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+
+    int lastIteration = 0;
+    shared_ptr<SolveControl> control = boost::make_shared<SolveControl>(
+        [&lastIteration](const SolveProgress &progress) {
+            lastIteration = progress.iteration;
+        });
+    Solution<BFT, RT> asyncSolution =
+        solver.solveAsync(fixture.rhs, control).get();
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(),
+                    asyncSolution.gridFunction().coefficients(),
+                    solverTol));
+    BOOST_CHECK_GT(lastIteration, 0);
+
+    shared_ptr<SolveControl> cancelledControl =
+        boost::make_shared<SolveControl>();
+    cancelledControl->cancel();
+    std::future<Solution<BFT, RT> > cancelledSolution =
+        solver.solveAsync(fixture.rhs, cancelledControl);
+    BOOST_CHECK_THROW(cancelledSolution.get(), SolveCancelledError);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif
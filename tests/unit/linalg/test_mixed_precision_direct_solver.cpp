@@ -0,0 +1,133 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+
+#include "laplace_3d_dirichlet_fixture.hpp"
+
+#include "assembly/blocked_boundary_operator.hpp"
+#include "assembly/blocked_operator_structure.hpp"
+#include "linalg/default_direct_solver.hpp"
+#include "linalg/mixed_precision_direct_solver.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <boost/type_traits/is_complex.hpp>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(MixedPrecisionDirectSolver)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(solution_agrees_with_DefaultDirectSolver,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    const RealType solverTol =
+        boost::is_same<RealType, float>::value ? 1e-5 : 1e-10;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    Bempp::DefaultDirectSolver<BFT, RT> directSolver(fixture.lhsOp);
+    arma::Col<RT> expected =
+        directSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    Bempp::MixedPrecisionDirectSolver<BFT, RT> solver(fixture.lhsOp,
+                                                      solverTol);
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    BOOST_CHECK(solution.achievedTolerance() <= solverTol);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(), expected,
+                    solverTol * 100));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiple_rhs_agree_with_single_rhs,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    const RealType solverTol =
+        boost::is_same<RealType, float>::value ? 1e-5 : 1e-10;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+    Bempp::MixedPrecisionDirectSolver<BFT, RT> solver(fixture.lhsOp,
+                                                      solverTol);
+    arma::Col<RT> expected =
+        solver.solve(fixture.rhs).gridFunction().coefficients();
+
+    std::vector<GridFunction<BFT, RT> > rhs(2);
+    rhs[0] = fixture.rhs;
+    rhs[1] = 2. * fixture.rhs;
+    std::vector<Solution<BFT, RT> > solutions = solver.solveMultipleRhs(rhs);
+    BOOST_REQUIRE_EQUAL(solutions.size(), 2);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solutions[0].gridFunction().coefficients(), expected,
+                    solverTol * 100));
+    arma::Col<RT> halfSolution =
+        solutions[1].gridFunction().coefficients() / 2.;
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    halfSolution, expected, solverTol * 100));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(boundary_operator_agrees_with_trivial_1x1_blocked_boundary_operator,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::MixedPrecisionDirectSolver<BFT, RT> Solver;
+    const RealType solverTol =
+        boost::is_same<RealType, float>::value ? 1e-5 : 1e-10;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    arma::Col<RT> solutionVectorNonblocked;
+    {
+        Solver solver(fixture.lhsOp, solverTol);
+        Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+        solutionVectorNonblocked = solution.gridFunction().coefficients();
+    }
+
+    BlockedOperatorStructure<BFT, RT> structure;
+    structure.setBlock(0, 0, fixture.lhsOp);
+    BlockedBoundaryOperator<BFT, RT> lhsBlockedOp(structure);
+    std::vector<GridFunction<BFT, RT> > blockedRhs(1);
+    blockedRhs[0] = fixture.rhs;
+
+    Solver solver(lhsBlockedOp, solverTol);
+    BlockedSolution<BFT, RT> solution = solver.solve(blockedRhs);
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    arma::Col<RT> solutionVectorBlocked =
+        solution.gridFunction(0).coefficients();
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solutionVectorNonblocked, solutionVectorBlocked,
+                    solverTol * 100));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
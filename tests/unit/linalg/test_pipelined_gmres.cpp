@@ -0,0 +1,155 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "bempp/common/config_trilinos.hpp"
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+
+#include "laplace_3d_dirichlet_fixture.hpp"
+
+#include "linalg/default_direct_solver.hpp"
+#include "linalg/pipelined_gmres.hpp"
+#ifdef WITH_TRILINOS
+#include "linalg/default_iterative_solver.hpp"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+using namespace Bempp;
+
+namespace {
+
+// Well-conditioned nonsymmetric matrix with a widely varying diagonal
+template <typename ValueType> arma::Mat<ValueType> testMatrix(int size)
+{
+    arma::arma_rng::set_seed(1);
+    arma::Mat<ValueType> A = arma::randu<arma::Mat<ValueType>>(size, size);
+    A /= ValueType(size);
+    for (int i = 0; i < size; ++i)
+        A(i, i) += ValueType(1 + i);
+    return A;
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(PipelinedGmres)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(solution_agrees_with_direct_solve,
+                              ValueType, result_types)
+{
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+
+    const RealType tol = boost::is_same<RealType, float>::value ? 1e-5 : 1e-10;
+    const int size = 60;
+    const arma::Mat<ValueType> A = testMatrix<ValueType>(size);
+    const arma::Col<ValueType> b = arma::randu<arma::Col<ValueType>>(size);
+    const arma::Col<ValueType> expected = arma::solve(A, b);
+
+    PipelinedGmresOptions options;
+    options.tolerance = tol;
+    options.restart = 10;
+    arma::Col<ValueType> x(size);
+    x.zeros();
+    PipelinedGmresStatus<RealType> status = pipelinedGmres<ValueType>(
+        [&](const arma::Col<ValueType> &in, arma::Col<ValueType> &out)
+        { out = A * in; },
+        std::function<void(const arma::Col<ValueType> &,
+                           arma::Col<ValueType> &)>(),
+        b, x, options);
+
+    BOOST_CHECK(status.converged);
+    BOOST_CHECK(status.relativeResidual <= tol);
+    BOOST_CHECK(status.iterationCount > options.restart);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(x, expected, tol * 100));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(preconditioner_reduces_iteration_count,
+                              ValueType, result_types)
+{
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+
+    const RealType tol = boost::is_same<RealType, float>::value ? 1e-5 : 1e-10;
+    const int size = 60;
+    const arma::Mat<ValueType> A = testMatrix<ValueType>(size);
+    const arma::Col<ValueType> b = arma::randu<arma::Col<ValueType>>(size);
+    const arma::Col<ValueType> expected = arma::solve(A, b);
+    const arma::Col<ValueType> inverseDiagonal = 1. / A.diag();
+
+    PipelinedGmresOptions options;
+    options.tolerance = tol;
+    std::function<void(const arma::Col<ValueType> &, arma::Col<ValueType> &)>
+        applyOperator = [&](const arma::Col<ValueType> &in,
+                            arma::Col<ValueType> &out) { out = A * in; };
+
+    arma::Col<ValueType> x(size);
+    x.zeros();
+    PipelinedGmresStatus<RealType> plain = pipelinedGmres<ValueType>(
+        applyOperator, std::function<void(const arma::Col<ValueType> &,
+                                          arma::Col<ValueType> &)>(),
+        b, x, options);
+    x.zeros();
+    PipelinedGmresStatus<RealType> preconditioned = pipelinedGmres<ValueType>(
+        applyOperator,
+        [&](const arma::Col<ValueType> &in, arma::Col<ValueType> &out)
+        { out = inverseDiagonal % in; },
+        b, x, options);
+
+    BOOST_CHECK(plain.converged);
+    BOOST_CHECK(preconditioned.converged);
+    BOOST_CHECK(preconditioned.iterationCount < plain.iterationCount);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(x, expected, tol * 100));
+}
+
+#ifdef WITH_TRILINOS
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(DefaultIterativeSolver_agrees_with_DefaultDirectSolver,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    const RealType solverTol =
+        boost::is_same<RealType, float>::value ? 1e-5 : 1e-8;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    Bempp::DefaultDirectSolver<BFT, RT> directSolver(fixture.lhsOp);
+    arma::Col<RT> expected =
+        directSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    Bempp::DefaultIterativeSolver<BFT, RT> solver(fixture.lhsOp);
+    solver.initializeSolver(
+        defaultPipelinedGmresParameterList(solverTol, 1000, 20));
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    BOOST_CHECK(solution.achievedTolerance() <= solverTol);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(), expected,
+                    solverTol * 100));
+}
+
+#endif // WITH_TRILINOS
+
+BOOST_AUTO_TEST_SUITE_END()
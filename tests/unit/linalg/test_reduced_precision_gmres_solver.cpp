@@ -0,0 +1,91 @@
+// Copyright (C) 2011-2015 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+
+#include "laplace_3d_dirichlet_fixture.hpp"
+
+#include "linalg/default_direct_solver.hpp"
+#include "linalg/reduced_precision_gmres_solver.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(ReducedPrecisionGmresSolver)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(solution_agrees_with_DefaultDirectSolver,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    // Well below single precision for double, so that the restarts must
+    // recover the accuracy lost by rounding the basis
+    const RealType solverTol =
+        boost::is_same<RealType, float>::value ? 1e-5 : 1e-10;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    Bempp::DefaultDirectSolver<BFT, RT> directSolver(fixture.lhsOp);
+    arma::Col<RT> expected =
+        directSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    Bempp::ReducedPrecisionGmresSolver<BFT, RT> solver(fixture.lhsOp,
+                                                       solverTol, 200);
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    BOOST_CHECK(solution.achievedTolerance() <= solverTol);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(), expected,
+                    solverTol * 100));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(short_restart_cycles_converge,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    const RealType solverTol =
+        boost::is_same<RealType, float>::value ? 1e-5 : 1e-8;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    Bempp::DefaultDirectSolver<BFT, RT> directSolver(fixture.lhsOp);
+    arma::Col<RT> expected =
+        directSolver.solve(fixture.rhs).gridFunction().coefficients();
+
+    Bempp::ReducedPrecisionGmresSolver<BFT, RT> solver(fixture.lhsOp,
+                                                       solverTol, 5, 2000);
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(), expected,
+                    solverTol * 100));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
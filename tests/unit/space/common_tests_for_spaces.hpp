@@ -145,6 +145,52 @@ void global2local_matches_local2global(const Space<BasisFunctionType>& space)
     }
 }
 
+template <typename BasisFunctionType>
+void dof_tables_match_dof_mappings(const Space<BasisFunctionType>& space)
+{
+    const int gdofCount = space.globalDofCount();
+    std::vector<int> gdofIndices(gdofCount);
+    for (int i = 0; i < gdofCount; ++i)
+        acc(gdofIndices, i) = i;
+    std::vector<std::vector<LocalDof> > ldofs;
+    std::vector<std::vector<BasisFunctionType> > ldofWeights;
+    space.global2localDofs(gdofIndices, ldofs, ldofWeights);
+
+    const typename Space<BasisFunctionType>::GlobalToLocalDofTable& table =
+        space.globalToLocalDofTable();
+    BOOST_CHECK_EQUAL(table.offsets.size(), gdofCount + 1);
+    BOOST_CHECK_EQUAL(table.localDofs.size(), table.offsets.back());
+    BOOST_CHECK_EQUAL(table.localDofWeights.size(), table.offsets.back());
+    for (int gdof = 0; gdof < gdofCount; ++gdof) {
+        const int start = acc(table.offsets, gdof);
+        BOOST_CHECK_EQUAL(acc(table.offsets, gdof + 1) - start,
+                          acc(ldofs, gdof).size());
+        for (int j = 0; j < acc(ldofs, gdof).size(); ++j) {
+            BOOST_CHECK_EQUAL(acc(table.localDofs, start + j).entityIndex,
+                              acc(acc(ldofs, gdof), j).entityIndex);
+            BOOST_CHECK_EQUAL(acc(table.localDofs, start + j).dofIndex,
+                              acc(acc(ldofs, gdof), j).dofIndex);
+            BOOST_CHECK_EQUAL(acc(table.localDofWeights, start + j),
+                              acc(acc(ldofWeights, gdof), j));
+        }
+    }
+
+    const int flatLdofCount = space.flatLocalDofCount();
+    std::vector<int> flatLdofIndices(flatLdofCount);
+    for (int i = 0; i < flatLdofCount; ++i)
+        acc(flatLdofIndices, i) = i;
+    std::vector<LocalDof> flatLdofs;
+    space.flatLocal2localDofs(flatLdofIndices, flatLdofs);
+    const std::vector<LocalDof>& flatTable = space.flatLocalToLocalDofTable();
+    BOOST_CHECK_EQUAL(flatTable.size(), flatLdofCount);
+    for (int i = 0; i < flatLdofCount; ++i) {
+        BOOST_CHECK_EQUAL(acc(flatTable, i).entityIndex,
+                          acc(flatLdofs, i).entityIndex);
+        BOOST_CHECK_EQUAL(acc(flatTable, i).dofIndex,
+                          acc(flatLdofs, i).dofIndex);
+    }
+}
+
 template <typename BasisFunctionType>
 void complement_is_really_a_complement(
         const shared_ptr<Space<BasisFunctionType> >& space,
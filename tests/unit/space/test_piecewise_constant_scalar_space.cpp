@@ -133,4 +133,20 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(complement_is_really_a_complement_, ResultType, re
     complement_is_really_a_complement(space, space1, space2);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(dof_tables_match_dof_mappings_, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        (new PiecewiseConstantScalarSpace<BFT>(grid)));
+
+    dof_tables_match_dof_mappings<BFT>(*space);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
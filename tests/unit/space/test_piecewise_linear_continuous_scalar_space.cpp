@@ -30,6 +30,8 @@
 
 #include "space/piecewise_linear_continuous_scalar_space.hpp"
 
+#include <algorithm>
+
 #include <boost/type_traits/is_complex.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 
@@ -170,4 +172,74 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(complement_is_really_a_complement_, ResultType, re
     complement_is_really_a_complement(space, space1, space2);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(local2global_matches_global2local_in_space_filling_curve_order, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        (new PiecewiseLinearContinuousScalarSpace<BFT>(
+             grid, GridSegment::wholeGrid(*grid), false /* strictlyOnSegment */,
+             SPACE_FILLING_CURVE_ORDER)));
+
+    local2global_matches_global2local<BFT>(*space);
+    global2local_matches_local2global<BFT>(*space);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(space_filling_curve_order_permutes_global_dofs, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    PiecewiseLinearContinuousScalarSpace<BFT> space(grid);
+    PiecewiseLinearContinuousScalarSpace<BFT> sortedSpace(
+        grid, GridSegment::wholeGrid(*grid), false /* strictlyOnSegment */,
+        SPACE_FILLING_CURVE_ORDER);
+    BOOST_REQUIRE_EQUAL(space.globalDofCount(), sortedSpace.globalDofCount());
+    BOOST_CHECK(!space.spaceIsCompatible(sortedSpace));
+
+    // The reference positions of the global DOFs must be a permutation of
+    // the original ones
+    std::vector<Point3D<CT> > positions, sortedPositions;
+    space.getGlobalDofPositions(positions);
+    sortedSpace.getGlobalDofPositions(sortedPositions);
+    std::vector<std::vector<CT> > coords, sortedCoords;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        coords.push_back({positions[i].x, positions[i].y, positions[i].z});
+        sortedCoords.push_back({sortedPositions[i].x, sortedPositions[i].y,
+                                sortedPositions[i].z});
+    }
+    std::sort(coords.begin(), coords.end());
+    std::sort(sortedCoords.begin(), sortedCoords.end());
+    BOOST_CHECK(coords == sortedCoords);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(dof_tables_match_dof_mappings_, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        (new PiecewiseLinearContinuousScalarSpace<BFT>(grid)));
+
+    dof_tables_match_dof_mappings<BFT>(*space);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
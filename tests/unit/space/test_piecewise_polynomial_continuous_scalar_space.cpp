@@ -244,6 +244,61 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(cubic_function_can_be_expanded_in_cubic_space, Res
     BOOST_CHECK_SMALL(relativeError, 1000 * std::numeric_limits<CT>::epsilon() /* percent */);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(batched_l2_errors_agree_with_individual_ones, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewisePolynomialContinuousScalarSpace<BFT>(grid, 1));
+
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.singleRegular.setRelativeQuadratureOrder(2);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+        new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    GridFunction<BFT, RT> function(
+        context, space, space,
+        surfaceNormalIndependentFunction(QuadraticFunction<RT>()));
+
+    SurfaceNormalIndependentFunction<LinearFunction<RT> > linear(
+        (LinearFunction<RT>()));
+    SurfaceNormalIndependentFunction<QuadraticFunction<RT> > quadratic(
+        (QuadraticFunction<RT>()));
+    SurfaceNormalIndependentFunction<CubicFunction<RT> > cubic(
+        (CubicFunction<RT>()));
+    std::vector<const Fiber::Function<RT>*> refFunctions;
+    refFunctions.push_back(&linear);
+    refFunctions.push_back(&quadratic);
+    refFunctions.push_back(&cubic);
+
+    std::vector<CT> absoluteErrors, relativeErrors;
+    estimateL2Errors(function, refFunctions, *quadStrategy,
+                     EvaluationOptions(), absoluteErrors, relativeErrors);
+    BOOST_REQUIRE_EQUAL(absoluteErrors.size(), refFunctions.size());
+    BOOST_REQUIRE_EQUAL(relativeErrors.size(), refFunctions.size());
+
+    for (size_t i = 0; i < refFunctions.size(); ++i) {
+        CT absoluteError, relativeError;
+        estimateL2Error(function, *refFunctions[i], *quadStrategy,
+                        absoluteError, relativeError);
+        BOOST_CHECK_CLOSE(absoluteErrors[i], absoluteError,
+                          100 * std::numeric_limits<CT>::epsilon() /* percent */);
+        BOOST_CHECK_CLOSE(relativeErrors[i], relativeError,
+                          100 * std::numeric_limits<CT>::epsilon() /* percent */);
+    }
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(local2global_matches_global2local_for_quadratic_space, ResultType, result_types)
 {
     typedef ResultType RT;